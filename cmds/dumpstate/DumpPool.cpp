@@ -18,9 +18,12 @@
 
 #include "DumpPool.h"
 
+#include <algorithm>
 #include <array>
 #include <thread>
 
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
 #include <log/log.h>
 
 #include "dumpstate.h"
@@ -59,15 +62,18 @@ DumpPool::~DumpPool() {
         return;
     }
     while (!tasks_.empty()) tasks_.pop();
+    deadlines_.clear();
 
     shutdown_ = true;
     condition_variable_.notify_all();
+    deadline_condition_variable_.notify_all();
     lock.unlock();
 
     for (auto& thread : threads_) {
         thread.join();
     }
     threads_.clear();
+    deadline_thread_.join();
     deleteTempFiles(tmp_root_);
     MYLOGI("shutdown thread pool\n");
 }
@@ -86,6 +92,10 @@ void DumpPool::start(int thread_counts) {
             loop();
         }));
     }
+    deadline_thread_ = std::thread([=]() {
+        setThreadName(pthread_self(), 0);
+        watchDeadlines();
+    });
 }
 
 void DumpPool::deleteTempFiles() {
@@ -163,6 +173,68 @@ void DumpPool::setThreadName(const pthread_t thread, int id) {
     pthread_setname_np(thread, name.data());
 }
 
+bool DumpPool::handOver(TaskResult* result, const std::string& path) {
+    std::lock_guard lock(result->lock);
+    if (result->handed_over) {
+        return false;
+    }
+    result->handed_over = true;
+    result->promise.set_value(path);
+    return true;
+}
+
+void DumpPool::addDeadline(const std::string& duration_title, std::chrono::milliseconds deadline,
+        std::shared_ptr<TaskResult> result, const std::string& path) {
+    std::unique_lock lock(lock_);
+    deadlines_.push_back({std::chrono::steady_clock::now() + deadline, duration_title, deadline,
+                          std::move(result), path});
+    deadline_condition_variable_.notify_one();
+}
+
+void DumpPool::handOverPartialOutput(const Deadline& deadline) {
+    std::lock_guard lock(deadline.result->lock);
+    if (deadline.result->handed_over) {
+        return;
+    }
+    MYLOGE("%s did not finish in %lldms\n", deadline.duration_title.c_str(),
+           static_cast<long long>(deadline.deadline.count()));
+    // The task goes on writing to its own file, so hand over a copy of what it has written.
+    std::string output;
+    std::unique_ptr<TmpFile> tmp_file_ptr = createTempFile();
+    if (tmp_file_ptr) {
+        android::base::ReadFileToString(deadline.path, &output);
+        output += android::base::StringPrintf(
+                "\n*** %s did not finish in %lldms, its output is incomplete\n",
+                deadline.duration_title.c_str(),
+                static_cast<long long>(deadline.deadline.count()));
+        android::base::WriteStringToFd(output, tmp_file_ptr->fd.get());
+        fsync(tmp_file_ptr->fd.get());
+    }
+    deadline.result->handed_over = true;
+    deadline.result->promise.set_value(tmp_file_ptr ? tmp_file_ptr->path : "");
+}
+
+void DumpPool::watchDeadlines() {
+    std::unique_lock lock(lock_);
+    while (!shutdown_) {
+        if (deadlines_.empty()) {
+            deadline_condition_variable_.wait(lock);
+            continue;
+        }
+        auto next = std::min_element(deadlines_.begin(), deadlines_.end(),
+                [](const Deadline& a, const Deadline& b) { return a.time < b.time; });
+        if (const auto time = next->time; std::chrono::steady_clock::now() < time) {
+            deadline_condition_variable_.wait_until(lock, time);
+            continue;
+        }
+        Deadline deadline = std::move(*next);
+        deadlines_.erase(next);
+        lock.unlock();
+        handOverPartialOutput(deadline);
+        lock.lock();
+    }
+}
+
 void DumpPool::loop() {
     std::unique_lock lock(lock_);
     while (!shutdown_) {
@@ -170,7 +242,7 @@ void DumpPool::loop() {
             condition_variable_.wait(lock);
             continue;
         } else {
-            std::packaged_task<std::string()> task = std::move(tasks_.front());
+            Task task = std::move(tasks_.front());
             tasks_.pop();
             lock.unlock();
             std::invoke(task);
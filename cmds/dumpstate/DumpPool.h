@@ -17,9 +17,11 @@
 #ifndef FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
 #define FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
 
+#include <chrono>
 #include <future>
 #include <queue>
 #include <string>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/macros.h>
@@ -69,6 +71,10 @@ inline void WaitForTask(std::future<std::string> future) {
  * enqueueTaskWithFd method in DumpPool to enqueue the task to the pool. The
  * std::placeholders::_1 is a placeholder for DumpPool to pass a fd argument.
  *
+ * A task that is enqueued with a deadline is given up on once it has run for
+ * longer than that: WaitForTask dumps what it has output so far, with a note
+ * that it is incomplete, instead of waiting for the rest.
+ *
  * std::futures returned by `enqueueTask*()` must all have their `get` methods
  * called, or have been destroyed before the DumpPool itself is destroyed.
  */
@@ -112,7 +118,7 @@ class DumpPool {
     std::future<std::string> enqueueTask(const std::string& duration_title, F&& f, Args&&... args) {
         std::function<void(void)> func = std::bind(std::forward<F>(f),
                 std::forward<Args>(args)...);
-        auto future = post(duration_title, func);
+        auto future = post(duration_title, func, std::chrono::milliseconds::zero());
         if (threads_.empty()) {
             start();
         }
@@ -130,9 +136,24 @@ class DumpPool {
      */
     template<class F, class... Args> std::future<std::string> enqueueTaskWithFd(
             const std::string& duration_title, F&& f, Args&&... args) {
+        return enqueueTaskWithFdAndDeadline(duration_title, std::chrono::milliseconds::zero(),
+                std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    /*
+     * Same as enqueueTaskWithFd, but the task only has |deadline| to run. Once
+     * that has passed, the future is given the output of the task so far, and
+     * the rest of it is dropped. The task should only write to its fd, since it
+     * may still be running when dumpstate has moved on.
+     *
+     * |deadline| The time the task may run for, or zero for no deadline.
+     */
+    template<class F, class... Args> std::future<std::string> enqueueTaskWithFdAndDeadline(
+            const std::string& duration_title, std::chrono::milliseconds deadline, F&& f,
+            Args&&... args) {
         std::function<void(int)> func = std::bind(std::forward<F>(f),
                 std::forward<Args>(args)...);
-        auto future = post(duration_title, func);
+        auto future = post(duration_title, func, deadline);
         if (threads_.empty()) {
             start();
         }
@@ -147,28 +168,63 @@ class DumpPool {
     static const std::string PREFIX_TMPFILE_NAME;
 
   private:
-    using Task = std::packaged_task<std::string()>;
+    using Task = std::function<void()>;
+
+    /*
+     * The path of the output of a task. It is handed over either by the task
+     * when it finishes or, with the partial output, when its deadline passes,
+     * whichever comes first.
+     */
+    struct TaskResult {
+        std::mutex lock;
+        bool handed_over = false;
+        std::promise<std::string> promise;
+    };
+
+    struct Deadline {
+        std::chrono::steady_clock::time_point time;
+        std::string duration_title;
+        std::chrono::milliseconds deadline;
+        std::shared_ptr<TaskResult> result;
+        std::string path;
+    };
 
     template<class T> void invokeTask(T dump_func, const std::string& duration_title, int out_fd);
 
     template<class T>
-    std::future<std::string> post(const std::string& duration_title, T dump_func) {
-        Task packaged_task([=]() {
+    std::future<std::string> post(const std::string& duration_title, T dump_func,
+            std::chrono::milliseconds deadline) {
+        auto result = std::make_shared<TaskResult>();
+        Task task([=]() {
             std::unique_ptr<TmpFile> tmp_file_ptr = createTempFile();
             if (!tmp_file_ptr) {
-                return std::string("");
+                handOver(result.get(), "");
+                return;
+            }
+            if (deadline.count() > 0) {
+                addDeadline(duration_title, deadline, result, tmp_file_ptr->path);
             }
             invokeTask(dump_func, duration_title, tmp_file_ptr->fd.get());
             fsync(tmp_file_ptr->fd.get());
-            return std::string(tmp_file_ptr->path);
+            if (!handOver(result.get(), tmp_file_ptr->path)) {
+                // The deadline has passed, and the partial output was handed over instead.
+                unlink(tmp_file_ptr->path);
+            }
         });
         std::unique_lock lock(lock_);
-        auto future = packaged_task.get_future();
-        tasks_.push(std::move(packaged_task));
+        auto future = result->promise.get_future();
+        tasks_.push(std::move(task));
         condition_variable_.notify_one();
         return future;
     }
 
+    /* Returns false if the result was already handed over. */
+    static bool handOver(TaskResult* result, const std::string& path);
+    void addDeadline(const std::string& duration_title, std::chrono::milliseconds deadline,
+            std::shared_ptr<TaskResult> result, const std::string& path);
+    void handOverPartialOutput(const Deadline& deadline);
+    void watchDeadlines();
+
     typedef struct {
       android::base::unique_fd fd;
       char path[1024];
@@ -194,11 +250,14 @@ class DumpPool {
     std::string tmp_root_;
     bool shutdown_;
     bool log_duration_; // For test purpose only, the default value is true.
-    std::mutex lock_;  // A lock for the tasks_.
+    std::mutex lock_;  // A lock for the tasks_ and deadlines_.
     std::condition_variable condition_variable_;
+    std::condition_variable deadline_condition_variable_;
 
     std::vector<std::thread> threads_;
+    std::thread deadline_thread_;
     std::queue<Task> tasks_;
+    std::vector<Deadline> deadlines_;
 
     DISALLOW_COPY_AND_ASSIGN(DumpPool);
 };
@@ -16,6 +16,8 @@
 
 #include "TaskQueue.h"
 
+#include <pthread.h>
+
 namespace android {
 namespace os {
 namespace dumpstate {
@@ -24,8 +26,27 @@ TaskQueue::~TaskQueue() {
     run(/* do_cancel = */true);
 }
 
+void TaskQueue::start() {
+    std::unique_lock lock(lock_);
+    if (thread_.joinable()) {
+        return;
+    }
+    thread_ = std::thread([this]() {
+        pthread_setname_np(pthread_self(), "dumpstate_zip");
+        loop();
+    });
+}
+
 void TaskQueue::run(bool do_cancel) {
     std::unique_lock lock(lock_);
+    if (thread_.joinable()) {
+        stopping_ = true;
+        condition_variable_.notify_all();
+        lock.unlock();
+        thread_.join();
+        lock.lock();
+        stopping_ = false;
+    }
     while (!tasks_.empty()) {
         auto task = tasks_.front();
         tasks_.pop();
@@ -35,6 +56,22 @@ void TaskQueue::run(bool do_cancel) {
     }
 }
 
+void TaskQueue::loop() {
+    std::unique_lock lock(lock_);
+    while (true) {
+        condition_variable_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+        if (stopping_) {
+            // run() takes care of the rest.
+            return;
+        }
+        auto task = std::move(tasks_.front());
+        tasks_.pop();
+        lock.unlock();
+        std::invoke(task, /* do_cancel = */false);
+        lock.lock();
+    }
+}
+
 }  // namespace dumpstate
 }  // namespace os
 }  // namespace android
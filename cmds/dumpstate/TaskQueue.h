@@ -17,8 +17,10 @@
 #ifndef FRAMEWORK_NATIVE_CMD_TASKQUEUE_H_
 #define FRAMEWORK_NATIVE_CMD_TASKQUEUE_H_
 
+#include <condition_variable>
 #include <mutex>
 #include <queue>
+#include <thread>
 
 #include <android-base/macros.h>
 
@@ -31,6 +33,9 @@ namespace dumpstate {
  * which are needed to run in a single thread. The task is a callable function
  * included a cancel task boolean parameter. The TaskQueue could
  * cancel the task in the destructor if the task has never been called.
+ *
+ * The tasks either all run when run() is called, or, once start() is called,
+ * one after another on a thread of the TaskQueue as they are added.
  */
 class TaskQueue {
   public:
@@ -51,10 +56,19 @@ class TaskQueue {
         tasks_.emplace([=](bool cancelled) {
             std::invoke(func, cancelled);
         });
+        condition_variable_.notify_one();
     }
 
     /*
-     * Invokes all tasks in the task queue.
+     * Starts a thread that invokes the tasks as they are added, until run() is
+     * called. The thread has the credentials of the caller, so it should be
+     * started after dumpstate drops root.
+     */
+    void start();
+
+    /*
+     * Invokes all tasks in the task queue. Stops the thread started by start()
+     * first, after the task that it is running.
      *
      * |do_cancel| true to cancel all tasks in the queue.
      */
@@ -63,8 +77,13 @@ class TaskQueue {
   private:
     using Task = std::function<void(bool)>;
 
+    void loop();
+
     std::mutex lock_;
+    std::condition_variable condition_variable_;
     std::queue<Task> tasks_;
+    std::thread thread_;
+    bool stopping_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(TaskQueue);
 };
@@ -252,6 +252,10 @@ static const std::string DUMP_BOARD_TASK = "dumpstate_board()";
 static const std::string DUMP_CHECKINS_TASK = "DUMP CHECKINS";
 static const std::string SERIALIZE_PERFETTO_TRACE_TASK = "SERIALIZE PERFETTO TRACE";
 
+// The checkins only write to their fd, so when they take longer than this, the bugreport goes on
+// with what they have output so far.
+static const std::chrono::milliseconds DUMP_CHECKINS_DEADLINE = std::chrono::seconds(60);
+
 namespace android {
 namespace os {
 namespace {
@@ -863,6 +867,7 @@ status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
 
     // Logging statement  below is useful to time how long each entry takes, but it's too verbose.
     // MYLOGD("Adding zip entry %s\n", entry_name.c_str());
+    std::lock_guard zip_lock(zip_lock_);
     size_t flags = ZipWriter::kCompress | ZipWriter::kDefaultCompression;
     int32_t err = zip_writer_->StartEntryWithTime(valid_name.c_str(), flags,
                                                   get_mtime(fd, ds.now_));
@@ -956,6 +961,7 @@ void Dumpstate::AddDir(const std::string& dir, bool recursive) {
 
 bool Dumpstate::AddTextZipEntry(const std::string& entry_name, const std::string& content) {
     MYLOGD("Adding zip text entry %s\n", entry_name.c_str());
+    std::lock_guard zip_lock(zip_lock_);
     size_t flags = ZipWriter::kCompress | ZipWriter::kDefaultCompression;
     int32_t err = zip_writer_->StartEntryWithTime(entry_name.c_str(), flags, ds.now_);
     if (err != 0) {
@@ -1365,7 +1371,10 @@ static Dumpstate::RunStatus RunDumpsysProto(const std::string& title, int priori
             dumpsys.stopDumpThread(dumpTerminated);
         }
         ZipWriter::FileEntry file_entry;
-        ds.zip_writer_->GetLastEntry(&file_entry);
+        {
+            std::lock_guard zip_lock(ds.zip_lock_);
+            ds.zip_writer_->GetLastEntry(&file_entry);
+        }
 
         auto elapsed_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::steady_clock::now() - start);
@@ -1669,6 +1678,7 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
         // Pool was shutdown in DumpstateDefaultAfterCritical method in order to
         // drop root user. Restarts it.
         ds.dump_pool_->start(/* thread_counts = */3);
+        ds.zip_entry_tasks_->start();
 
         dump_hals = ds.dump_pool_->enqueueTaskWithFd(DUMP_HALS_TASK, &DumpHals, _1);
         dump_incident_report = ds.dump_pool_->enqueueTask(
@@ -1677,7 +1687,8 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
             DUMP_NETSTATS_PROTO_TASK, &DumpNetstatsProto);
         dump_board = ds.dump_pool_->enqueueTaskWithFd(
             DUMP_BOARD_TASK, &Dumpstate::DumpstateBoard, &ds, _1);
-        dump_checkins = ds.dump_pool_->enqueueTaskWithFd(DUMP_CHECKINS_TASK, &DumpCheckins, _1);
+        dump_checkins = ds.dump_pool_->enqueueTaskWithFdAndDeadline(
+            DUMP_CHECKINS_TASK, DUMP_CHECKINS_DEADLINE, &DumpCheckins, _1);
     }
 
     // Dump various things. Note that anything that takes "long" (i.e. several seconds) should
@@ -2074,6 +2085,7 @@ static void DumpstateTelephonyOnly(const std::string& calling_package) {
     std::future<std::string> dump_board;
     if (ds.dump_pool_) {
         ds.dump_pool_->start(/*thread_counts =*/2);
+        ds.zip_entry_tasks_->start();
 
         // DumpstateBoard takes long time, post it to the another thread in the pool,
         // if pool is available.
@@ -2184,6 +2196,7 @@ static void DumpstateWifiOnly() {
     // thread is needed for DumpHals in the DumpstateRadioCommon.
     if (ds.dump_pool_) {
         ds.dump_pool_->start(/*thread_counts =*/1);
+        ds.zip_entry_tasks_->start();
     }
 
     DumpstateRadioCommon();
@@ -22,6 +22,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -519,6 +520,10 @@ class Dumpstate {
     // Pointer to the zip structure.
     std::unique_ptr<ZipWriter> zip_writer_;
 
+    // Held while an entry is written to zip_writer_, since the entries of zip_entry_tasks_ are
+    // added from its own thread.
+    std::mutex zip_lock_;
+
     // Binder object listening to progress.
     android::sp<android::os::IDumpstateListener> listener_;
 
@@ -538,7 +543,7 @@ class Dumpstate {
     std::unique_ptr<android::os::dumpstate::DumpPool> dump_pool_;
 
     // A task queue to collect adding zip entry tasks inside dump tasks if the
-    // parallel run is enabled.
+    // parallel run is enabled. Its thread compresses them while dumpstate goes on.
     std::unique_ptr<android::os::dumpstate::TaskQueue> zip_entry_tasks_;
 
     // A callback to IncidentCompanion service, which checks user consent for sharing the
@@ -1782,6 +1782,32 @@ TEST_F(DumpPoolTest, EnqueueTask_withDurationLog) {
     EXPECT_THAT(getTempFileCounts(kTestDataPath), Eq(0));
 }
 
+TEST_F(DumpPoolTest, EnqueueTaskWithFdAndDeadline) {
+    auto dump_func_1 = [](int out_fd) {
+        dprintf(out_fd, "A");
+        sleep(1);
+        dprintf(out_fd, "B");
+    };
+    auto dump_func_2 = [](int out_fd) {
+        dprintf(out_fd, "C");
+    };
+    setLogDuration(/* log_duration = */false);
+    auto t1 = dump_pool_->enqueueTaskWithFdAndDeadline("1", std::chrono::milliseconds(100),
+            dump_func_1, std::placeholders::_1);
+    auto t2 = dump_pool_->enqueueTaskWithFdAndDeadline("2", std::chrono::seconds(10),
+            dump_func_2, std::placeholders::_1);
+
+    WaitForTask(std::move(t1), "", out_fd_.get());
+    WaitForTask(std::move(t2), "", out_fd_.get());
+
+    std::string result;
+    ReadFileToString(out_path_, &result);
+    EXPECT_THAT(result,
+            StrEq("A\n*** 1 did not finish in 100ms, its output is incomplete\nC\n"));
+    dump_pool_.reset();
+    EXPECT_THAT(getTempFileCounts(kTestDataPath), Eq(0));
+}
+
 class TaskQueueTest : public DumpstateBaseTest {
 public:
     void SetUp() {
@@ -1833,6 +1859,30 @@ TEST_F(TaskQueueTest, runTask_withCancelled) {
     EXPECT_TRUE(is_task2_cancelled);
 }
 
+TEST_F(TaskQueueTest, runTask_started) {
+    std::promise<std::thread::id> task1_thread;
+    auto task_1 = [&](bool task_cancelled) {
+        EXPECT_FALSE(task_cancelled);
+        task1_thread.set_value(std::this_thread::get_id());
+    };
+    task_queue_.start();
+    task_queue_.add(task_1, std::placeholders::_1);
+
+    // The task runs without waiting for run().
+    auto future = task1_thread.get_future();
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(10)));
+    EXPECT_NE(std::this_thread::get_id(), future.get());
+
+    bool is_task2_cancelled = false;
+    auto task_2 = [&](bool task_cancelled) {
+        is_task2_cancelled = task_cancelled;
+    };
+    task_queue_.run(/* do_cancel = */true);
+    task_queue_.add(task_2, std::placeholders::_1);
+    task_queue_.run(/* do_cancel = */true);
+
+    EXPECT_TRUE(is_task2_cancelled);
+}
 
 }  // namespace dumpstate
 }  // namespace os
@@ -15,8 +15,12 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <iomanip>
+#include <mutex>
+#include <optional>
 #include <thread>
 
 #include <android-base/file.h>
@@ -39,6 +43,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -65,8 +70,8 @@ static void usage() {
         "usage: dumpsys\n"
         "         To dump all services.\n"
         "or:\n"
-        "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--clients] [--dump] [--pid] [--thread] "
-        "[--help | "
+        "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--parallel N] [--clients] [--dump] [--pid] "
+        "[--thread] [--help | "
         "-l | --skip SERVICES "
         "| SERVICE [ARGS]]\n"
         "         --help: shows this help\n"
@@ -76,6 +81,8 @@ static void usage() {
         "         --clients: dump client PIDs instead of usual dump\n"
         "         --dump: ask the service to dump itself (this is the default)\n"
         "         --pid: dump PID instead of usual dump\n"
+        "         --parallel N: dump up to N services at the same time. The output of each\n"
+        "               service is buffered and written in the usual order\n"
         "         --proto: filter services that support dumping data in proto format. Dumps\n"
         "               will be in proto format.\n"
         "         --priority LEVEL: filter services based on specified priority\n"
@@ -83,6 +90,10 @@ static void usage() {
         "         --skip SERVICES: dumps all services but SERVICES (comma-separated list)\n"
         "         --stability: dump binder stability information instead of usual dump\n"
         "         --thread: dump thread usage instead of usual dump\n"
+        "         --transaction-stats: dump the latency and size of the binder transactions that\n"
+        "               the service host process makes, instead of usual dump\n"
+        "         --enable-transaction-stats, --disable-transaction-stats: start or stop\n"
+        "               collecting transaction stats, then dump them\n"
         "         SERVICE [ARGS]: dumps only service SERVICE, optionally passing ARGS to it\n");
 }
 
@@ -135,13 +146,18 @@ int Dumpsys::main(int argc, char* const argv[]) {
     bool asProto = false;
     int dumpTypeFlags = 0;
     int timeoutArgMs = 10000;
+    int parallelDumps = 1;
     int priorityFlags = IServiceManager::DUMP_FLAG_PRIORITY_ALL;
     static struct option longOptions[] = {
         {"help", no_argument, 0, 0},           {"clients", no_argument, 0, 0},
         {"dump", no_argument, 0, 0},           {"pid", no_argument, 0, 0},
         {"priority", required_argument, 0, 0}, {"proto", no_argument, 0, 0},
         {"skip", no_argument, 0, 0},           {"stability", no_argument, 0, 0},
-        {"thread", no_argument, 0, 0},         {0, 0, 0, 0}};
+        {"thread", no_argument, 0, 0},         {"transaction-stats", no_argument, 0, 0},
+        {"enable-transaction-stats", no_argument, 0, 0},
+        {"disable-transaction-stats", no_argument, 0, 0},
+        {"parallel", required_argument, 0, 0},
+        {0, 0, 0, 0}};
 
     // Must reset optind, otherwise subsequent calls will fail (wouldn't happen on main.cpp, but
     // happens on test cases).
@@ -182,6 +198,19 @@ int Dumpsys::main(int argc, char* const argv[]) {
                 dumpTypeFlags |= TYPE_THREAD;
             } else if (!strcmp(longOptions[optionIndex].name, "clients")) {
                 dumpTypeFlags |= TYPE_CLIENTS;
+            } else if (!strcmp(longOptions[optionIndex].name, "transaction-stats")) {
+                dumpTypeFlags |= TYPE_TRANSACTION_STATS;
+            } else if (!strcmp(longOptions[optionIndex].name, "enable-transaction-stats")) {
+                dumpTypeFlags |= TYPE_TRANSACTION_STATS | TYPE_TRANSACTION_STATS_ENABLE;
+            } else if (!strcmp(longOptions[optionIndex].name, "disable-transaction-stats")) {
+                dumpTypeFlags |= TYPE_TRANSACTION_STATS | TYPE_TRANSACTION_STATS_DISABLE;
+            } else if (!strcmp(longOptions[optionIndex].name, "parallel")) {
+                char* endptr;
+                parallelDumps = strtol(optarg, &endptr, 10);
+                if (*endptr != '\0' || parallelDumps <= 0) {
+                    fprintf(stderr, "Error: invalid parallel dumps number: '%s'\n", optarg);
+                    return -1;
+                }
             }
             break;
 
@@ -271,6 +300,16 @@ int Dumpsys::main(int argc, char* const argv[]) {
         return 0;
     }
 
+    if (parallelDumps > 1 && N > 1) {
+        Vector<String16> dumpedServices;
+        for (const auto& serviceName : services) {
+            if (!IsSkipped(skippedServices, serviceName)) dumpedServices.add(serviceName);
+        }
+        writeDumpsInParallel(dumpedServices, parallelDumps, dumpTypeFlags, args, priorityFlags,
+                             std::chrono::milliseconds(timeoutArgMs), asProto);
+        return 0;
+    }
+
     for (size_t i = 0; i < N; i++) {
         const String16& serviceName = services[i];
         if (IsSkipped(skippedServices, serviceName)) continue;
@@ -304,6 +343,90 @@ int Dumpsys::main(int argc, char* const argv[]) {
     return 0;
 }
 
+// Writes the section of a service, which startDumpThread was called for, to fd and stops the
+// dump thread.
+static void writeBufferedDump(Dumpsys& dumpsys, int fd, const String16& serviceName,
+                              int priorityFlags, std::chrono::milliseconds timeout, bool asProto) {
+    dumpsys.writeDumpHeader(fd, serviceName, priorityFlags);
+    std::chrono::duration<double> elapsedDuration;
+    size_t bytesWritten = 0;
+    status_t status =
+            dumpsys.writeDump(fd, serviceName, timeout, asProto, elapsedDuration, bytesWritten);
+    if (status == TIMED_OUT) {
+        WriteStringToFd(StringPrintf("\n*** SERVICE '%s' DUMP TIMEOUT (%llums) EXPIRED ***\n\n",
+                                     String8(serviceName).c_str(), timeout.count()),
+                        fd);
+    }
+    dumpsys.writeDumpFooter(fd, serviceName, elapsedDuration);
+    dumpsys.stopDumpThread(status == OK);
+}
+
+void Dumpsys::writeDumpsInParallel(const Vector<String16>& services, size_t threadCount,
+                                   int dumpTypeFlags, const Vector<String16>& args,
+                                   int priorityFlags, std::chrono::milliseconds timeout,
+                                   bool asProto) const {
+    // The section of each service, with its header and footer, is written to a memfd by the
+    // thread that dumps it, and copied to stdout in the order of the services once it is done.
+    struct Section {
+        unique_fd fd;
+        bool done = false;
+    };
+    std::vector<Section> sections(services.size());
+    std::mutex lock;
+    std::condition_variable doneCondition;
+    std::atomic_size_t next = 0;
+
+    auto dumpServices = [&]() {
+        for (size_t i = next++; i < services.size(); i = next++) {
+            const String16& serviceName = services[i];
+            // Each service needs its own dump thread and pipe.
+            Dumpsys dumpsys(sm_);
+            unique_fd fd;
+            if (dumpsys.startDumpThread(dumpTypeFlags, serviceName, args) == OK) {
+                fd.reset(memfd_create("dumpsys", MFD_CLOEXEC));
+                if (fd == -1) {
+                    std::cerr << "Failed to create the buffer for " << serviceName << ": "
+                              << strerror(errno) << std::endl;
+                    dumpsys.stopDumpThread(/* dumpComplete = */ false);
+                } else {
+                    writeBufferedDump(dumpsys, fd.get(), serviceName, priorityFlags, timeout,
+                                      asProto);
+                }
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            sections[i].fd = std::move(fd);
+            sections[i].done = true;
+            doneCondition.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::min(threadCount, services.size()); i++) {
+        threads.emplace_back(dumpServices);
+    }
+
+    for (auto& section : sections) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            doneCondition.wait(guard, [&section]() { return section.done; });
+        }
+        if (section.fd == -1 || lseek(section.fd.get(), 0, SEEK_SET) != 0) continue;
+        char buf[4096];
+        ssize_t rc;
+        while ((rc = TEMP_FAILURE_RETRY(read(section.fd.get(), buf, sizeof(buf)))) > 0) {
+            if (!WriteFully(STDOUT_FILENO, buf, rc)) {
+                std::cerr << "Failed to write a buffered dump: " << strerror(errno) << std::endl;
+                break;
+            }
+        }
+        section.fd.reset();
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
 Vector<String16> Dumpsys::listServices(int priorityFilterFlags, bool filterByProto) const {
     Vector<String16> services = sm_->listServices(priorityFilterFlags);
     services.sort(sort_func);
@@ -406,6 +529,17 @@ static status_t dumpClientsToFd(const sp<IBinder>& service, const unique_fd& fd)
     return OK;
 }
 
+static status_t dumpTransactionStatsToFd(const sp<IBinder>& service, const unique_fd& fd,
+                                         std::optional<bool> enable) {
+    std::string stats;
+    status_t status = service->getTransactionStats(&stats, enable);
+    if (status != OK) {
+        return status;
+    }
+    WriteStringToFd(stats, fd.get());
+    return OK;
+}
+
 static void reportDumpError(const String16& serviceName, status_t error, const char* context) {
     if (error == OK) return;
 
@@ -450,6 +584,13 @@ status_t Dumpsys::startDumpThread(int dumpTypeFlags, const String16& serviceName
             status_t err = dumpClientsToFd(service, remote_end);
             reportDumpError(serviceName, err, "dumping clients info");
         }
+        if (dumpTypeFlags & TYPE_TRANSACTION_STATS) {
+            std::optional<bool> enable;
+            if (dumpTypeFlags & TYPE_TRANSACTION_STATS_ENABLE) enable = true;
+            if (dumpTypeFlags & TYPE_TRANSACTION_STATS_DISABLE) enable = false;
+            status_t err = dumpTransactionStatsToFd(service, remote_end, enable);
+            reportDumpError(serviceName, err, "dumping transaction stats");
+        }
 
         // other types always act as a header, this is usually longer
         if (dumpTypeFlags & TYPE_DUMP) {
@@ -57,6 +57,10 @@ class Dumpsys {
         TYPE_STABILITY = 0x4,  // dump stability information of server
         TYPE_THREAD = 0x8,     // dump thread usage of server only
         TYPE_CLIENTS = 0x10,   // dump pid of clients
+        TYPE_TRANSACTION_STATS = 0x20,  // dump transaction stats of server
+        // starts or stops collecting transaction stats before dumping them
+        TYPE_TRANSACTION_STATS_ENABLE = 0x40,
+        TYPE_TRANSACTION_STATS_DISABLE = 0x80,
     };
 
     /**
@@ -126,6 +130,14 @@ class Dumpsys {
     }
 
   private:
+    /**
+     * Dumps the services on up to {@code threadCount} threads at the same time, and writes their
+     * sections to stdout in the order of {@code services}, as the sequential dump would.
+     */
+    void writeDumpsInParallel(const Vector<String16>& services, size_t threadCount,
+                              int dumpTypeFlags, const Vector<String16>& args, int priorityFlags,
+                              std::chrono::milliseconds timeout, bool asProto) const;
+
     android::IServiceManager* sm_;
     std::thread activeThread_;
     mutable android::base::unique_fd redirectFd_;
@@ -250,6 +250,14 @@ class DumpsysTest : public Test {
         EXPECT_THAT(stdout_, HasSubstr("was the duration of dumpsys " + service + ", ending at: "));
     }
 
+    void AssertDumpedInOrder(const std::vector<std::string>& dumps) {
+        size_t position = 0;
+        for (const std::string& dump : dumps) {
+            position = stdout_.find(dump, position);
+            EXPECT_NE(position, std::string::npos) << dump << " is missing or out of order";
+        }
+    }
+
     void AssertNotDumped(const std::string& dump) {
         EXPECT_THAT(stdout_, Not(HasSubstr(dump)));
     }
@@ -454,6 +462,26 @@ TEST_F(DumpsysTest, DumpMultipleServices) {
     AssertDumped("running3", "dump3");
 }
 
+// Tests 'dumpsys --parallel 2', which should keep the order of the services even when a later
+// service finishes first
+TEST_F(DumpsysTest, DumpMultipleServicesInParallel) {
+    ExpectListServices({"running1", "stopped2", "running3", "running4"});
+    ExpectDumpAndHang("running1", 1, "dump1");
+    ExpectCheckService("stopped2", false);
+    ExpectDump("running3", "dump3");
+    ExpectDump("running4", "dump4");
+
+    CallMain({"--parallel", "2"});
+
+    AssertRunningServices({"running1", "running3", "running4"});
+    AssertDumped("running1", "dump1");
+    AssertStopped("stopped2");
+    AssertDumped("running3", "dump3");
+    AssertDumped("running4", "dump4");
+    AssertDumpedInOrder({"DUMP OF SERVICE running1:", "DUMP OF SERVICE running3:",
+                         "DUMP OF SERVICE running4:"});
+}
+
 // Tests 'dumpsys --skip skipped3 skipped5', which should skip these services
 TEST_F(DumpsysTest, DumpWithSkip) {
     ExpectListServices({"running1", "stopped2", "skipped3", "running4", "skipped5"});
@@ -657,6 +685,28 @@ TEST_F(DumpsysTest, ListServiceWithClients) {
     const std::string format("Client PIDs are not available for local binders.\n");
     AssertOutputFormat(format);
 }
+
+// Tests 'dumpsys --transaction-stats service_name'
+TEST_F(DumpsysTest, ListServiceWithTransactionStats) {
+    ExpectCheckService("Locksmith");
+
+    CallMain({"--transaction-stats", "Locksmith"});
+
+    AssertOutputContains("Binder transaction stats: ");
+}
+
+// Tests 'dumpsys --enable-transaction-stats service_name'
+TEST_F(DumpsysTest, EnableTransactionStats) {
+    ExpectCheckService("Locksmith");
+    ExpectCheckService("Valet");
+
+    CallMain({"--enable-transaction-stats", "Locksmith"});
+    AssertOutputContains("Binder transaction stats: enabled");
+
+    CallMain({"--disable-transaction-stats", "Valet"});
+    AssertOutputContains("Binder transaction stats: disabled");
+}
+
 // Tests 'dumpsys --thread --stability'
 TEST_F(DumpsysTest, ListAllServicesWithMultipleOptions) {
     ExpectListServices({"Locksmith", "Valet"});
@@ -282,4 +282,27 @@ Composer* blendShrink() {
     return new BlendShrinkComp();
 }
 
+CompositionDesc describeComposition(Composer* (*composerFactory)()) {
+    // The blending composers modulate the layer with .75 premultiplied, which is a plane alpha.
+    if (composerFactory == opaque) {
+        return { true, true, false, 1.0f };
+    } else if (composerFactory == opaqueShrink) {
+        return { true, true, true, 1.0f };
+    } else if (composerFactory == blend) {
+        return { true, false, false, .75f };
+    } else if (composerFactory == blendShrink) {
+        return { true, false, true, .75f };
+    }
+    return { false, false, false, 0.0f };
+}
+
+LayerDesc shrinkLayer(const LayerDesc& desc) {
+    LayerDesc ld = desc;
+    ld.x += desc.width / 128;
+    ld.y += desc.height / 128;
+    ld.width -= desc.width / 64;
+    ld.height -= desc.height / 64;
+    return ld;
+}
+
 } // namespace android
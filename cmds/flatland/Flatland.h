@@ -20,6 +20,8 @@
 #include <GLES2/gl2.h>
 
 #include <gui/GLConsumer.h>
+#include <ui/GraphicBuffer.h>
+#include <utils/Timers.h>
 
 namespace android {
 
@@ -58,6 +60,20 @@ Composer* opaqueShrink();
 Composer* blend();
 Composer* blendShrink();
 
+// How a layer is composed by its composer, for the backends which compose it with something
+// other than the Composer classes.
+struct CompositionDesc {
+    bool composed;
+    bool opaque;
+    bool shrink;
+    float alpha;
+};
+
+CompositionDesc describeComposition(Composer* (*composerFactory)());
+
+// Returns the layer the way the shrinking composers compose it on every other frame.
+LayerDesc shrinkLayer(const LayerDesc& desc);
+
 class Renderer {
 public:
     virtual ~Renderer() {}
@@ -68,4 +84,33 @@ public:
 
 Renderer* staticGradient();
 
+// Fills a CPU-writable buffer with the gradient that staticGradient draws, without the dither.
+bool fillGradient(const sp<GraphicBuffer>& buffer);
+
+enum class Backend {
+    // The Composer classes, with GLES.
+    GL,
+    // RenderEngine, the way SurfaceFlinger composes layers on the GPU.
+    SKIA_GL,
+    SKIA_VK,
+    // A layer for each window, composed by SurfaceFlinger and the hardware composer.
+    HWC,
+};
+
+// Runs the frames of a scenario at one resolution. The layers are already scaled to it.
+class Runner {
+public:
+    virtual ~Runner() {}
+    virtual bool setUp() = 0;
+    virtual void tearDown() = 0;
+    // Returns the time between the end of the last warm-up frame and the end of the last frame,
+    // or -1 on error.
+    virtual nsecs_t run(uint32_t warmUpFrames, uint32_t totalFrames) = 0;
+};
+
+Runner* renderEngineRunner(Backend backend, const LayerDesc* layers, size_t numLayers,
+        uint32_t width, uint32_t height);
+Runner* hwcRunner(const sp<IBinder>& displayToken, const LayerDesc* layers, size_t numLayers,
+        uint32_t width, uint32_t height);
+
 } // namespace android
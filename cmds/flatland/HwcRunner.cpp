@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <binder/ProcessState.h>
+#include <gui/SurfaceComposerClient.h>
+#include <ui/DisplayMode.h>
+#include <ui/DisplayState.h>
+#include <ui/Fence.h>
+#include <utils/Trace.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <string.h>
+
+#include "Flatland.h"
+
+namespace android {
+
+// Gives the layers of a scenario to SurfaceFlinger as a layer per window, so that they are
+// composed the way the windows of apps are: by the hardware composer, or by SurfaceFlinger on the
+// GPU for the layers which the hardware composer hands back. The scenario is scaled to fit the
+// display, the way -d shows the frames of the other backends.
+//
+// Each frame gives every layer a new buffer, with the same content, so that SurfaceFlinger
+// presents every frame. The time of a frame is the time between the present fences, so a frame
+// which the display keeps up with takes a refresh period.
+class HwcRunner : public Runner {
+public:
+    HwcRunner(const sp<IBinder>& displayToken, const LayerDesc* layers, size_t numLayers,
+            uint32_t width, uint32_t height) :
+        mDisplayToken(displayToken),
+        mLayerDescs(layers, layers + numLayers),
+        mWidth(width),
+        mHeight(height),
+        mFrame(0),
+        mCompletedFrames(0),
+        mRunFirstFrame(0) {
+    }
+
+    virtual bool setUp() {
+        ATRACE_CALL();
+
+        // The transaction callbacks arrive on the binder threads.
+        ProcessState::self()->startThreadPool();
+
+        mClient = sp<SurfaceComposerClient>::make();
+        status_t err = mClient->initCheck();
+        if (err != NO_ERROR) {
+            fprintf(stderr, "SurfaceComposerClient::initCheck error: %#x\n", err);
+            return false;
+        }
+
+        ui::DisplayState state;
+        err = SurfaceComposerClient::getDisplayState(mDisplayToken, &state);
+        if (err != NO_ERROR) {
+            fprintf(stderr, "SurfaceComposerClient::getDisplayState error: %#x\n", err);
+            return false;
+        }
+
+        ui::DisplayMode mode;
+        err = SurfaceComposerClient::getActiveDisplayMode(mDisplayToken, &mode);
+        if (err != NO_ERROR) {
+            fprintf(stderr, "SurfaceComposer::getActiveDisplayMode failed: %#x\n", err);
+            return false;
+        }
+        float scaleX = static_cast<float>(mode.resolution.getWidth()) / mWidth;
+        float scaleY = static_cast<float>(mode.resolution.getHeight()) / mHeight;
+        float scale = scaleX < scaleY ? scaleX : scaleY;
+
+        mContainer = mClient->createSurface(String8("Flatland"), 0, 0, PIXEL_FORMAT_RGBA_8888,
+                ISurfaceComposerClient::eFXSurfaceContainer);
+        if (mContainer == nullptr || !mContainer->isValid()) {
+            fprintf(stderr, "Failed to create SurfaceControl.\n");
+            return false;
+        }
+
+        SurfaceComposerClient::Transaction t;
+        t.setLayerStack(mContainer, state.layerStack)
+                .setLayer(mContainer, 0x7FFFFFFF)
+                .setMatrix(mContainer, scale, 0.0f, 0.0f, scale)
+                .show(mContainer);
+
+        for (const LayerDesc& ld : mLayerDescs) {
+            Layer layer;
+            layer.comp = describeComposition(ld.composerFactory);
+            if (layer.comp.composed && !setUpLayer(ld, &layer, t)) {
+                return false;
+            }
+            mLayers.push_back(layer);
+        }
+
+        t.apply(true /* synchronous */);
+        return true;
+    }
+
+    virtual void tearDown() {
+        ATRACE_CALL();
+
+        if (mContainer != nullptr) {
+            // The layers are destroyed once their SurfaceControls are released.
+            SurfaceComposerClient::Transaction().hide(mContainer).apply(true /* synchronous */);
+        }
+        mLayers.clear();
+        mContainer.clear();
+        mClient.clear();
+    }
+
+    virtual nsecs_t run(uint32_t warmUpFrames, uint32_t totalFrames) {
+        ATRACE_CALL();
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mRunFirstFrame = mFrame;
+        mPresentFences.assign(totalFrames, nullptr);
+        for (uint32_t i = 0; i < totalFrames; i++) {
+            // Keep one frame queued behind the one which is presented, which also leaves the
+            // buffers of a frame alone until the display is done with them.
+            if (i > 0 && !waitForCompletedLocked(lock, mFrame - 1)) {
+                return -1;
+            }
+            lock.unlock();
+            doFrame();
+            lock.lock();
+        }
+        if (!waitForCompletedLocked(lock, mFrame)) {
+            return -1;
+        }
+
+        sp<Fence> startFence = mPresentFences[warmUpFrames - 1];
+        sp<Fence> endFence = mPresentFences[totalFrames - 1];
+        lock.unlock();
+
+        if (startFence == nullptr || endFence == nullptr) {
+            fprintf(stderr, "SurfaceFlinger did not present a frame.\n");
+            return -1;
+        }
+        endFence->waitForever("flatland");
+        return endFence->getSignalTime() - startFence->getSignalTime();
+    }
+
+private:
+    enum { NUM_BUFFERS = 3 };
+
+    struct Layer {
+        CompositionDesc comp;
+        sp<SurfaceControl> surfaceControl;
+        sp<GraphicBuffer> buffers[NUM_BUFFERS];
+    };
+
+    bool setUpLayer(const LayerDesc& ld, Layer* layer, SurfaceComposerClient::Transaction& t) {
+        layer->surfaceControl = mClient->createSurface(String8("Flatland Layer"), ld.width,
+                ld.height, PIXEL_FORMAT_RGBA_8888, ISurfaceComposerClient::eFXSurfaceBufferState,
+                mContainer->getHandle());
+        if (layer->surfaceControl == nullptr || !layer->surfaceControl->isValid()) {
+            fprintf(stderr, "Failed to create SurfaceControl.\n");
+            return false;
+        }
+
+        for (size_t i = 0; i < NUM_BUFFERS; i++) {
+            sp<GraphicBuffer> buffer = sp<GraphicBuffer>::make(ld.width, ld.height,
+                    HAL_PIXEL_FORMAT_RGBA_8888, 1u,
+                    GRALLOC_USAGE_HW_COMPOSER | GRALLOC_USAGE_HW_TEXTURE |
+                            GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN,
+                    "flatland");
+            if (buffer->initCheck() != NO_ERROR) {
+                fprintf(stderr, "GraphicBuffer allocation error: %#x\n", buffer->initCheck());
+                return false;
+            }
+            bool result = i == 0 ? fillGradient(buffer) : copyBuffer(layer->buffers[0], buffer);
+            if (!result) {
+                return false;
+            }
+            layer->buffers[i] = buffer;
+        }
+
+        t.setLayer(layer->surfaceControl, int32_t(mLayers.size()))
+                .setPosition(layer->surfaceControl, float(ld.x), float(ld.y))
+                .setFlags(layer->surfaceControl,
+                        layer->comp.opaque ? layer_state_t::eLayerOpaque : 0,
+                        layer_state_t::eLayerOpaque)
+                .setAlpha(layer->surfaceControl, layer->comp.alpha)
+                .show(layer->surfaceControl);
+        return true;
+    }
+
+    static bool copyBuffer(const sp<GraphicBuffer>& src, const sp<GraphicBuffer>& dst) {
+        void* srcPixels;
+        void* dstPixels;
+        status_t err = src->lock(GRALLOC_USAGE_SW_READ_OFTEN, &srcPixels);
+        if (err != NO_ERROR) {
+            fprintf(stderr, "GraphicBuffer::lock error: %#x\n", err);
+            return false;
+        }
+        err = dst->lock(GRALLOC_USAGE_SW_WRITE_OFTEN, &dstPixels);
+        if (err != NO_ERROR) {
+            fprintf(stderr, "GraphicBuffer::lock error: %#x\n", err);
+            src->unlock();
+            return false;
+        }
+
+        const size_t rowBytes = size_t(src->getWidth()) * 4;
+        for (uint32_t y = 0; y < src->getHeight(); y++) {
+            memcpy(static_cast<uint8_t*>(dstPixels) + y * size_t(dst->getStride()) * 4,
+                    static_cast<uint8_t*>(srcPixels) + y * size_t(src->getStride()) * 4,
+                    rowBytes);
+        }
+
+        dst->unlock();
+        src->unlock();
+        return true;
+    }
+
+    void doFrame() {
+        // As with the shrinking composers, every other frame is the one with the layers shrunk.
+        const uint32_t frame = mFrame++;
+        const bool parity = (frame % 2) == 0;
+
+        SurfaceComposerClient::Transaction t;
+        for (size_t i = 0; i < mLayers.size(); i++) {
+            const Layer& layer = mLayers[i];
+            if (!layer.comp.composed) {
+                continue;
+            }
+            t.setBuffer(layer.surfaceControl, layer.buffers[frame % NUM_BUFFERS]);
+            if (layer.comp.shrink) {
+                const LayerDesc& ld = mLayerDescs[i];
+                const LayerDesc shrunk = parity ? shrinkLayer(ld) : ld;
+                t.setPosition(layer.surfaceControl, float(shrunk.x), float(shrunk.y))
+                        .setMatrix(layer.surfaceControl, float(shrunk.width) / float(ld.width),
+                                0.0f, 0.0f, float(shrunk.height) / float(ld.height));
+            }
+        }
+        t.addTransactionCompletedCallback(
+                [this, frame](void* /*context*/, nsecs_t /*latchTime*/,
+                        const sp<Fence>& presentFence,
+                        const std::vector<SurfaceControlStats>& /*stats*/) {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mPresentFences[frame - mRunFirstFrame] = presentFence;
+                    mCompletedFrames++;
+                    mCondition.notify_all();
+                },
+                nullptr);
+        t.apply();
+    }
+
+    // Waits until |count| frames have completed since the runner was set up.
+    bool waitForCompletedLocked(std::unique_lock<std::mutex>& lock, uint32_t count) {
+        const bool completed = mCondition.wait_for(lock, std::chrono::seconds(1),
+                [this, count] { return mCompletedFrames >= count; });
+        if (!completed) {
+            fprintf(stderr, "Timed out waiting for SurfaceFlinger to present a frame.\n");
+        }
+        return completed;
+    }
+
+    const sp<IBinder> mDisplayToken;
+    const std::vector<LayerDesc> mLayerDescs;
+    const uint32_t mWidth;
+    const uint32_t mHeight;
+
+    sp<SurfaceComposerClient> mClient;
+    sp<SurfaceControl> mContainer;
+    std::vector<Layer> mLayers;
+
+    uint32_t mFrame;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    uint32_t mCompletedFrames;
+    // The present fence of each frame of the current run. A run only returns once all of its
+    // frames have completed, so no callback of an earlier run is left to arrive.
+    uint32_t mRunFirstFrame;
+    std::vector<sp<Fence>> mPresentFences;
+};
+
+Runner* hwcRunner(const sp<IBinder>& displayToken, const LayerDesc* layers, size_t numLayers,
+        uint32_t width, uint32_t height) {
+    return new HwcRunner(displayToken, layers, numLayers, width, height);
+}
+
+} // namespace android
@@ -30,6 +30,8 @@
 #include <math.h>
 #include <getopt.h>
 
+#include <memory>
+
 #include "Flatland.h"
 #include "GLHelper.h"
 
@@ -39,6 +41,26 @@ static uint32_t    g_SleepBetweenSamplesMs = 0;
 static bool        g_PresentToWindow       = false;
 static size_t      g_BenchmarkNameLen      = 0;
 static sp<IBinder> g_DisplayToken          = nullptr;
+static Vector<Backend> g_Backends;
+
+static const struct {
+    const char* name;
+    Backend backend;
+} backendNames[] = {
+    { "gl",     Backend::GL },
+    { "skiagl", Backend::SKIA_GL },
+    { "skiavk", Backend::SKIA_VK },
+    { "hwc",    Backend::HWC },
+};
+
+static const char* backendName(Backend backend) {
+    for (size_t i = 0; i < NELEMS(backendNames); i++) {
+        if (backendNames[i].backend == backend) {
+            return backendNames[i].name;
+        }
+    }
+    return "?";
+}
 
 struct BenchmarkDesc {
     // The name of the test.
@@ -371,7 +393,27 @@ private:
     Composer* mComposer;
 };
 
-class BenchmarkRunner {
+static size_t countLayers(const BenchmarkDesc& desc) {
+    size_t i;
+    for (i = 0; i < MAX_NUM_LAYERS; i++) {
+        if (desc.layers[i].rendererFactory == nullptr) {
+            break;
+        }
+    }
+    return i;
+}
+
+// Scale the layer to match the current screen size.
+static LayerDesc scaleLayer(const LayerDesc& desc, float scaleFactor) {
+    LayerDesc ld = desc;
+    ld.x = int32_t(scaleFactor * float(ld.x));
+    ld.y = int32_t(scaleFactor * float(ld.y));
+    ld.width = uint32_t(scaleFactor * float(ld.width));
+    ld.height = uint32_t(scaleFactor * float(ld.height));
+    return ld;
+}
+
+class BenchmarkRunner : public Runner {
 
 public:
 
@@ -384,7 +426,7 @@ public:
         mWindowSurface(EGL_NO_SURFACE) {
     }
 
-    bool setUp() {
+    virtual bool setUp() {
         ATRACE_CALL();
 
         bool result;
@@ -408,12 +450,7 @@ public:
         }
 
         for (size_t i = 0; i < mNumLayers; i++) {
-            // Scale the layer to match the current screen size.
-            LayerDesc ld = mDesc.layers[i];
-            ld.x = int32_t(scaleFactor * float(ld.x));
-            ld.y = int32_t(scaleFactor * float(ld.y));
-            ld.width = uint32_t(scaleFactor * float(ld.width));
-            ld.height = uint32_t(scaleFactor * float(ld.height));
+            LayerDesc ld = scaleLayer(mDesc.layers[i], scaleFactor);
 
             // Set up the layer.
             result = mLayers[i].setUp(ld, mGLHelper);
@@ -438,7 +475,7 @@ public:
         return true;
     }
 
-    void tearDown() {
+    virtual void tearDown() {
         ATRACE_CALL();
 
         for (size_t i = 0; i < mNumLayers; i++) {
@@ -459,7 +496,7 @@ public:
         }
     }
 
-    nsecs_t run(uint32_t warmUpFrames, uint32_t totalFrames) {
+    virtual nsecs_t run(uint32_t warmUpFrames, uint32_t totalFrames) {
         ATRACE_CALL();
 
         bool result;
@@ -552,16 +589,6 @@ private:
         return true;
     }
 
-    static size_t countLayers(const BenchmarkDesc& desc) {
-        size_t i;
-        for (i = 0; i < MAX_NUM_LAYERS; i++) {
-            if (desc.layers[i].rendererFactory == nullptr) {
-                break;
-            }
-        }
-        return i;
-    }
-
     const BenchmarkDesc& mDesc;
     const size_t mInstance;
     const size_t mNumLayers;
@@ -588,20 +615,41 @@ static int cmpDouble(const double* lhs, const double* rhs) {
     return 0;
 }
 
+static Runner* createRunner(const BenchmarkDesc& b, size_t run, Backend backend) {
+    if (backend == Backend::GL) {
+        return new BenchmarkRunner(b, run);
+    }
+
+    float scaleFactor = float(b.runHeights[run]) / float(b.height);
+    uint32_t w = uint32_t(scaleFactor * float(b.width));
+    uint32_t h = b.runHeights[run];
+
+    LayerDesc layers[MAX_NUM_LAYERS];
+    size_t numLayers = countLayers(b);
+    for (size_t i = 0; i < numLayers; i++) {
+        layers[i] = scaleLayer(b.layers[i], scaleFactor);
+    }
+
+    if (backend == Backend::HWC) {
+        return hwcRunner(g_DisplayToken, layers, numLayers, w, h);
+    }
+    return renderEngineRunner(backend, layers, numLayers, w, h);
+}
+
 // Run a single benchmark and print the result.
-static bool runTest(const BenchmarkDesc b, size_t run) {
+static bool runTest(const BenchmarkDesc b, size_t run, Backend backend) {
     bool success = true;
     double prevResult = 0.0, result = 0.0;
     Vector<double> samples;
 
     uint32_t runHeight = b.runHeights[run];
     uint32_t runWidth = b.width * runHeight / b.height;
-    printf(" %-*s | %4d x %4d | ", static_cast<int>(g_BenchmarkNameLen), b.name,
-            runWidth, runHeight);
+    printf(" %-*s | %-7s | %4d x %4d | ", static_cast<int>(g_BenchmarkNameLen), b.name,
+            backendName(backend), runWidth, runHeight);
     fflush(stdout);
 
-    BenchmarkRunner r(b, run);
-    if (!r.setUp()) {
+    std::unique_ptr<Runner> r(createRunner(b, run, backend));
+    if (!r->setUp()) {
         fprintf(stderr, "error initializing runner.\n");
         return false;
     }
@@ -617,7 +665,7 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
     // Find the number of frames needed to run for over 100ms.
     double runTime = 0.0;
     while (true) {
-        runTime = double(r.run(warmUpFrames, totalFrames));
+        runTime = double(r->run(warmUpFrames, totalFrames));
         if (runTime < 50e6) {
             warmUpFrames *= 2;
             totalFrames *= 2;
@@ -649,7 +697,7 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
         }
 
         for (size_t i = 0; i < newSamples; i++) {
-            double sample = double(r.run(warmUpFrames, totalFrames));
+            double sample = double(r->run(warmUpFrames, totalFrames));
 
             if (g_SleepBetweenSamplesMs > 0) {
                 usleep(g_SleepBetweenSamplesMs  * 1000);
@@ -676,7 +724,7 @@ done:
 
     printf("\n");
     fflush(stdout);
-    r.tearDown();
+    r->tearDown();
 
     return success;
 }
@@ -686,7 +734,7 @@ static void printResultsTableHeader() {
     size_t len = strlen(scenario);
     size_t leftPad = (g_BenchmarkNameLen - len) / 2;
     size_t rightPad = g_BenchmarkNameLen - len - leftPad;
-    printf(" %*s%s%*s | Resolution  | Time (ms)\n",
+    printf(" %*s%s%*s | Backend | Resolution  | Time (ms)\n",
             static_cast<int>(leftPad), "",
             "Scenario", static_cast<int>(rightPad), "");
 }
@@ -698,8 +746,10 @@ static bool runTests() {
     for (size_t i = 0; i < NELEMS(benchmarks); i++) {
         const BenchmarkDesc& b = benchmarks[i];
         for (size_t j = 0; j < MAX_TEST_RUNS && b.runHeights[j]; j++) {
-            if (!runTest(b, j)) {
-                return false;
+            for (size_t k = 0; k < g_Backends.size(); k++) {
+                if (!runTest(b, j, g_Backends[k])) {
+                    return false;
+                }
             }
         }
     }
@@ -726,10 +776,12 @@ static void showHelp(const char* cmd) {
       stderr,
       "options include:\n"
       "  -s N            sleep for N ms between samples\n"
-      "  -d              display the test frame to a window\n"
+      "  -d              display the test frame to a window (gl backend only)\n"
       "  -i display-id   specify a display ID to use for multi-display device\n"
       "                  see \"dumpsys SurfaceFlinger --display-id\" for valid "
       "display IDs\n"
+      "  -b backend      compose with the given backend, which may be repeated:\n"
+      "                  gl (the default), skiagl, skiavk, hwc, or all\n"
       "  --help          print this helpful message and exit\n");
 }
 
@@ -755,7 +807,7 @@ int main(int argc, char** argv) {
             {     0,               0, 0,  0 }
         };
 
-        ret = getopt_long(argc, argv, "ds:i:",
+        ret = getopt_long(argc, argv, "ds:i:b:",
                           long_options, &option_index);
 
         if (ret < 0) {
@@ -779,6 +831,26 @@ int main(int argc, char** argv) {
                 }
             break;
 
+            case 'b':
+                if (!strcmp(optarg, "all")) {
+                    for (size_t i = 0; i < NELEMS(backendNames); i++) {
+                        g_Backends.add(backendNames[i].backend);
+                    }
+                    break;
+                }
+                for (size_t i = 0; i < NELEMS(backendNames); i++) {
+                    if (!strcmp(optarg, backendNames[i].name)) {
+                        g_Backends.add(backendNames[i].backend);
+                        break;
+                    }
+                    if (i + 1 == NELEMS(backendNames)) {
+                        fprintf(stderr, "Invalid backend: %s.\n", optarg);
+                        showHelp(argv[0]);
+                        exit(2);
+                    }
+                }
+            break;
+
             case 0:
                 if (strcmp(long_options[option_index].name, "help")) {
                     showHelp(argv[0]);
@@ -808,6 +880,10 @@ int main(int argc, char** argv) {
         exit(6);
     }
 
+    if (g_Backends.isEmpty()) {
+        g_Backends.add(Backend::GL);
+    }
+
     g_BenchmarkNameLen = maxBenchmarkNameLen();
 
     printf(" cmdline:");
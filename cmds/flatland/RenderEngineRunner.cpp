@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <renderengine/DisplaySettings.h>
+#include <renderengine/LayerSettings.h>
+#include <renderengine/RenderEngine.h>
+#include <renderengine/impl/ExternalTexture.h>
+#include <ui/Fence.h>
+#include <utils/Trace.h>
+
+#include <memory>
+#include <vector>
+
+#include "Flatland.h"
+
+namespace android {
+
+using renderengine::RenderEngine;
+
+// Composes the layers of a scenario with RenderEngine, the way SurfaceFlinger composes the layers
+// which the hardware composer does not. The layers are drawn once, and each frame composes them
+// into the next buffer of a ring of output buffers, as if it were a swapchain.
+class RenderEngineRunner : public Runner {
+public:
+    RenderEngineRunner(Backend backend, const LayerDesc* layers, size_t numLayers,
+            uint32_t width, uint32_t height) :
+        mBackend(backend),
+        mLayerDescs(layers, layers + numLayers),
+        mWidth(width),
+        mHeight(height),
+        mFrame(0) {
+    }
+
+    virtual bool setUp() {
+        ATRACE_CALL();
+
+        auto args = renderengine::RenderEngineCreationArgs::Builder()
+                .setPixelFormat(static_cast<int>(ui::PixelFormat::RGBA_8888))
+                .setImageCacheSize(MAX_NUM_LAYERS + NUM_OUTPUT_BUFFERS)
+                .setContextPriority(RenderEngine::ContextPriority::REALTIME)
+                .setThreaded(RenderEngine::Threaded::YES)
+                .setGraphicsApi(mBackend == Backend::SKIA_VK ?
+                        RenderEngine::GraphicsApi::VK : RenderEngine::GraphicsApi::GL)
+                .build();
+        mRenderEngine = RenderEngine::create(args);
+        if (mRenderEngine == nullptr) {
+            fprintf(stderr, "RenderEngine::create failed.\n");
+            return false;
+        }
+
+        for (const LayerDesc& ld : mLayerDescs) {
+            std::shared_ptr<renderengine::ExternalTexture> texture;
+            if (describeComposition(ld.composerFactory).composed) {
+                texture = allocateTexture(ld.width, ld.height,
+                        GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_SW_WRITE_OFTEN,
+                        renderengine::impl::ExternalTexture::Usage::READABLE);
+                if (texture == nullptr || !fillGradient(texture->getBuffer())) {
+                    return false;
+                }
+            }
+            mLayerTextures.push_back(texture);
+        }
+
+        for (size_t i = 0; i < NUM_OUTPUT_BUFFERS; i++) {
+            mOutputs[i] = allocateTexture(mWidth, mHeight,
+                    GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE,
+                    renderengine::impl::ExternalTexture::Usage::WRITEABLE);
+            if (mOutputs[i] == nullptr) {
+                return false;
+            }
+            mOutputFences[i] = Fence::NO_FENCE;
+        }
+
+        return true;
+    }
+
+    virtual void tearDown() {
+        ATRACE_CALL();
+
+        for (size_t i = 0; i < NUM_OUTPUT_BUFFERS; i++) {
+            if (mOutputFences[i] != nullptr) {
+                mOutputFences[i]->waitForever("flatland");
+                mOutputFences[i].clear();
+            }
+            mOutputs[i].reset();
+        }
+        mLayerTextures.clear();
+        mRenderEngine.reset();
+    }
+
+    virtual nsecs_t run(uint32_t warmUpFrames, uint32_t totalFrames) {
+        ATRACE_CALL();
+
+        sp<Fence> startFence;
+        sp<Fence> endFence;
+        for (uint32_t i = 0; i < totalFrames; i++) {
+            sp<Fence> fence = doFrame();
+            if (fence == nullptr) {
+                return -1;
+            }
+            if (i + 1 == warmUpFrames) {
+                startFence = fence;
+            }
+            endFence = fence;
+        }
+
+        endFence->waitForever("flatland");
+        return endFence->getSignalTime() - startFence->getSignalTime();
+    }
+
+private:
+    enum { NUM_OUTPUT_BUFFERS = 3 };
+
+    std::shared_ptr<renderengine::ExternalTexture> allocateTexture(uint32_t w, uint32_t h,
+            uint64_t usage, uint32_t textureUsage) {
+        sp<GraphicBuffer> buffer = sp<GraphicBuffer>::make(w, h, HAL_PIXEL_FORMAT_RGBA_8888,
+                1u, usage, "flatland");
+        if (buffer->initCheck() != NO_ERROR) {
+            fprintf(stderr, "GraphicBuffer allocation error: %#x\n", buffer->initCheck());
+            return nullptr;
+        }
+        return std::make_shared<renderengine::impl::ExternalTexture>(buffer, *mRenderEngine,
+                textureUsage);
+    }
+
+    // Returns the fence which signals once the GPU has composed the frame, or nullptr on error.
+    sp<Fence> doFrame() {
+        // As with the shrinking composers, every other frame is the one with the layers shrunk.
+        const bool parity = (mFrame % 2) == 0;
+        const size_t output = mFrame % NUM_OUTPUT_BUFFERS;
+        mFrame++;
+
+        std::vector<renderengine::LayerSettings> layers;
+        for (size_t i = 0; i < mLayerDescs.size(); i++) {
+            const CompositionDesc comp = describeComposition(mLayerDescs[i].composerFactory);
+            if (!comp.composed) {
+                continue;
+            }
+            const LayerDesc ld = comp.shrink && parity ?
+                    shrinkLayer(mLayerDescs[i]) : mLayerDescs[i];
+            const float bufferWidth = float(mLayerDescs[i].width);
+            const float bufferHeight = float(mLayerDescs[i].height);
+
+            renderengine::LayerSettings layer;
+            layer.geometry.boundaries = FloatRect(0.0f, 0.0f, bufferWidth, bufferHeight);
+            layer.geometry.positionTransform =
+                    mat4::translate(vec4(float(ld.x), float(ld.y), 0.0f, 1.0f)) *
+                    mat4::scale(vec4(float(ld.width) / bufferWidth,
+                            float(ld.height) / bufferHeight, 1.0f, 1.0f));
+            layer.source.buffer.buffer = mLayerTextures[i];
+            layer.source.buffer.useTextureFiltering = comp.shrink;
+            layer.source.buffer.isOpaque = comp.opaque;
+            layer.alpha = half(comp.alpha);
+            layer.sourceDataspace = ui::Dataspace::V0_SRGB;
+            layers.push_back(layer);
+        }
+
+        const Rect displayRect(int32_t(mWidth), int32_t(mHeight));
+        renderengine::DisplaySettings display;
+        display.physicalDisplay = displayRect;
+        display.clip = displayRect;
+        display.outputDataspace = ui::Dataspace::V0_SRGB;
+        display.maxLuminance = 500.0f;
+
+        // The buffer is reused once the frame which last composed into it is done, the way a
+        // swapchain hands it back.
+        base::unique_fd bufferFence(mOutputFences[output]->dup());
+        FenceResult result = mRenderEngine->drawLayers(display, layers, mOutputs[output],
+                std::move(bufferFence)).get();
+        if (!result.ok()) {
+            fprintf(stderr, "RenderEngine::drawLayers error: %#x\n", result.error());
+            return nullptr;
+        }
+        mOutputFences[output] = result.value();
+        return mOutputFences[output];
+    }
+
+    const Backend mBackend;
+    const std::vector<LayerDesc> mLayerDescs;
+    const uint32_t mWidth;
+    const uint32_t mHeight;
+
+    std::unique_ptr<RenderEngine> mRenderEngine;
+    // The texture of each layer, or nullptr for the layers which are not composed.
+    std::vector<std::shared_ptr<renderengine::ExternalTexture>> mLayerTextures;
+    std::shared_ptr<renderengine::ExternalTexture> mOutputs[NUM_OUTPUT_BUFFERS];
+    sp<Fence> mOutputFences[NUM_OUTPUT_BUFFERS];
+    uint32_t mFrame;
+};
+
+Runner* renderEngineRunner(Backend backend, const LayerDesc* layers, size_t numLayers,
+        uint32_t width, uint32_t height) {
+    return new RenderEngineRunner(backend, layers, numLayers, width, height);
+}
+
+} // namespace android
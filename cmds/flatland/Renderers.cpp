@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <string.h>
+
 #include "Flatland.h"
 #include "GLHelper.h"
 
@@ -193,5 +195,35 @@ Renderer* staticGradient() {
     return new NoRenderer;
 }
 
+bool fillGradient(const sp<GraphicBuffer>& buffer) {
+    const float* color0 = genColor();
+    const float* color1 = genColor();
+
+    uint8_t* pixels;
+    status_t err = buffer->lock(GRALLOC_USAGE_SW_WRITE_OFTEN,
+            reinterpret_cast<void**>(&pixels));
+    if (err != NO_ERROR) {
+        fprintf(stderr, "GraphicBuffer::lock error: %#x\n", err);
+        return false;
+    }
+
+    // The gradient runs along x, so every row is the same.
+    const uint32_t w = buffer->getWidth();
+    const uint32_t h = buffer->getHeight();
+    const size_t rowBytes = size_t(buffer->getStride()) * 4;
+    for (uint32_t x = 0; x < w; x++) {
+        float interp = w > 1 ? float(x) / float(w - 1) : 0.0f;
+        for (int c = 0; c < 4; c++) {
+            float value = color0[c] + (color1[c] - color0[c]) * interp;
+            pixels[x * 4 + c] = uint8_t(value * 255.0f + 0.5f);
+        }
+    }
+    for (uint32_t y = 1; y < h; y++) {
+        memcpy(pixels + y * rowBytes, pixels, w * 4);
+    }
+
+    buffer->unlock();
+    return true;
+}
 
 } // namespace android
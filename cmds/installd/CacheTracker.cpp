@@ -22,6 +22,9 @@
 #include <sys/xattr.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <thread>
+
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
 
@@ -33,16 +36,25 @@ using android::base::StringPrintf;
 namespace android {
 namespace installd {
 
+// Most trackers have their stats from quotas, so a few threads are enough to keep
+// the trackers that walk their trees off the critical path.
+static constexpr size_t kMaxLoadStatsThreads = 4;
+
 CacheTracker::CacheTracker(userid_t userId, appid_t appId, const std::string& uuid)
       : cacheUsed(0),
         cacheQuota(0),
         mUserId(userId),
         mAppId(appId),
         mItemsLoaded(false),
-        mUuid(uuid) {
+        mUuid(uuid),
+        mCancelled(false) {
 }
 
 CacheTracker::~CacheTracker() {
+    if (mItemsFuture.valid()) {
+        mCancelled = true;
+        mItemsFuture.wait();
+    }
 }
 
 std::string CacheTracker::toString() {
@@ -58,6 +70,7 @@ void CacheTracker::loadStats() {
     ATRACE_BEGIN("loadStats quota");
     cacheUsed = 0;
     if (loadQuotaStats()) {
+        ATRACE_END();
         return;
     }
     ATRACE_END();
@@ -102,7 +115,7 @@ void CacheTracker::loadItemsFrom(const std::string& path) {
         PLOG(WARNING) << "Failed to fts_open " << path;
         return;
     }
-    while ((p = fts_read(fts)) != nullptr) {
+    while ((p = fts_read(fts)) != nullptr && !mCancelled) {
         if (p->fts_level == 0) continue;
 
         // Create tracking nodes for everything we encounter
@@ -190,12 +203,42 @@ void CacheTracker::loadItems() {
 void CacheTracker::ensureItems() {
     if (mItemsLoaded) {
         return;
+    } else if (mItemsFuture.valid()) {
+        mItemsFuture.get();
+        mItemsLoaded = true;
     } else {
         loadItems();
         mItemsLoaded = true;
     }
 }
 
+void CacheTracker::prefetchItems() {
+    if (mItemsLoaded || mItemsFuture.valid()) {
+        return;
+    }
+    mItemsFuture = std::async(std::launch::async, [this]() { loadItems(); });
+}
+
+void CacheTracker::loadAllStats(const std::vector<std::shared_ptr<CacheTracker>>& trackers) {
+    const size_t threadCount = std::min({trackers.size(), kMaxLoadStatsThreads,
+            static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency()))});
+    std::atomic_size_t next(0);
+    auto load = [&trackers, &next]() {
+        for (size_t i = next++; i < trackers.size(); i = next++) {
+            trackers[i]->loadStats();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(load);
+    }
+    load();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
 int CacheTracker::getCacheRatio() {
     if (cacheQuota == 0) {
         return 0;
@@ -17,9 +17,12 @@
 #ifndef ANDROID_INSTALLD_CACHE_TRACKER_H
 #define ANDROID_INSTALLD_CACHE_TRACKER_H
 
+#include <atomic>
+#include <future>
 #include <memory>
 #include <string>
 #include <queue>
+#include <vector>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -50,9 +53,14 @@ public:
     void loadItems();
 
     void ensureItems();
+    /* Start loading the items on another thread, which a later ensureItems() waits for. */
+    void prefetchItems();
 
     int getCacheRatio();
 
+    /* Load the stats of all these trackers, spread across a few threads. */
+    static void loadAllStats(const std::vector<std::shared_ptr<CacheTracker>>& trackers);
+
     int64_t cacheUsed;
     int64_t cacheQuota;
 
@@ -66,6 +74,10 @@ private:
 
     std::vector<std::string> mDataPaths;
 
+    // Set when the tracker is destroyed while its items are still being prefetched.
+    std::atomic_bool mCancelled;
+    std::future<void> mItemsFuture;
+
     bool loadQuotaStats();
     void loadItemsFrom(const std::string& path);
 
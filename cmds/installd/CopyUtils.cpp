@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CopyUtils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fts.h>
+#include <linux/fs.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+
+using android::base::unique_fd;
+
+namespace android {
+namespace installd {
+
+namespace {
+
+// Most of the files of an app are small, so the copy mostly waits on the metadata of the
+// filesystem and a few files are copied at the same time.
+constexpr size_t kMaxCopyThreads = 4;
+constexpr size_t kCopyChunkSize = 1 << 20;
+constexpr size_t kReadWriteBufferSize = 64 * 1024;
+
+struct Entry {
+    std::string from;
+    std::string to;
+    struct stat st;
+};
+
+struct CopyState {
+    // Cleared by the first file that the filesystem cannot reflink or copy_file_range, so that
+    // the rest of the files do not try again.
+    std::atomic_bool reflinkSupported = true;
+    std::atomic_bool copyFileRangeSupported = true;
+    std::atomic_int64_t bytes = 0;
+    std::atomic_int64_t reflinkedBytes = 0;
+};
+
+bool IsUnsupported(int error) {
+    return error == EOPNOTSUPP || error == ENOTTY || error == EINVAL || error == EXDEV ||
+            error == ENOSYS;
+}
+
+bool CopyXattrs(const std::string& from, const std::string& to) {
+    ssize_t size = llistxattr(from.c_str(), nullptr, 0);
+    if (size <= 0) {
+        if (size < 0) PLOG(WARNING) << "Failed to list xattrs of " << from;
+        return size == 0;
+    }
+    std::vector<char> names(size);
+    size = llistxattr(from.c_str(), names.data(), names.size());
+    if (size < 0) {
+        PLOG(WARNING) << "Failed to list xattrs of " << from;
+        return false;
+    }
+    std::vector<char> value;
+    for (const char* name = names.data(); name < names.data() + size; name += strlen(name) + 1) {
+        ssize_t valueSize = lgetxattr(from.c_str(), name, nullptr, 0);
+        if (valueSize >= 0) {
+            value.resize(valueSize);
+            valueSize = lgetxattr(from.c_str(), name, value.data(), value.size());
+        }
+        if (valueSize < 0 || lsetxattr(to.c_str(), name, value.data(), valueSize, 0) != 0) {
+            PLOG(WARNING) << "Failed to copy xattr " << name << " of " << from;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Give "to" the owner, mode, xattrs and timestamps of "from". The timestamps go last, as the
+// others would change them.
+bool CopyMetadata(const Entry& entry) {
+    const char* to = entry.to.c_str();
+    if (lchown(to, entry.st.st_uid, entry.st.st_gid) != 0) {
+        PLOG(WARNING) << "Failed to chown " << to;
+        return false;
+    }
+    if (!S_ISLNK(entry.st.st_mode) && chmod(to, entry.st.st_mode & 07777) != 0) {
+        PLOG(WARNING) << "Failed to chmod " << to;
+        return false;
+    }
+    if (!CopyXattrs(entry.from, entry.to)) {
+        return false;
+    }
+    const struct timespec times[] = {entry.st.st_atim, entry.st.st_mtim};
+    if (utimensat(AT_FDCWD, to, times, AT_SYMLINK_NOFOLLOW) != 0) {
+        PLOG(WARNING) << "Failed to set the timestamps of " << to;
+        return false;
+    }
+    return true;
+}
+
+// Like "cp -F", remove the destination rather than write into it.
+bool RemoveExisting(const std::string& path) {
+    if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+        PLOG(WARNING) << "Failed to remove " << path;
+        return false;
+    }
+    return true;
+}
+
+bool CopyData(int in, int out, const Entry& entry, CopyState* state) {
+    if (state->reflinkSupported) {
+        if (ioctl(out, FICLONE, in) == 0) {
+            state->bytes += entry.st.st_size;
+            state->reflinkedBytes += entry.st.st_size;
+            return true;
+        }
+        if (!IsUnsupported(errno)) {
+            PLOG(WARNING) << "Failed to reflink " << entry.from;
+            return false;
+        }
+        state->reflinkSupported = false;
+    }
+
+    std::vector<char> buffer;
+    while (true) {
+        ssize_t n;
+        if (state->copyFileRangeSupported) {
+            n = copy_file_range(in, nullptr, out, nullptr, kCopyChunkSize, 0);
+            if (n < 0 && IsUnsupported(errno)) {
+                // Both offsets are where the last chunk left them, so read() carries on from there.
+                state->copyFileRangeSupported = false;
+                continue;
+            }
+        } else {
+            buffer.resize(kReadWriteBufferSize);
+            n = read(in, buffer.data(), buffer.size());
+            if (n > 0 && !android::base::WriteFully(out, buffer.data(), n)) {
+                n = -1;
+            }
+        }
+        if (n == 0) {
+            return true;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            PLOG(WARNING) << "Failed to copy " << entry.from;
+            return false;
+        }
+        state->bytes += n;
+    }
+}
+
+bool CopyFile(const Entry& entry, CopyState* state) {
+    unique_fd in(open(entry.from.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+    if (in == -1) {
+        PLOG(WARNING) << "Failed to open " << entry.from;
+        return false;
+    }
+    if (!RemoveExisting(entry.to)) {
+        return false;
+    }
+    unique_fd out(open(entry.to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+                       0600));
+    if (out == -1) {
+        PLOG(WARNING) << "Failed to create " << entry.to;
+        return false;
+    }
+    return CopyData(in.get(), out.get(), entry, state) && CopyMetadata(entry);
+}
+
+bool CopySymlink(const Entry& entry) {
+    std::string target;
+    if (!android::base::Readlink(entry.from, &target)) {
+        PLOG(WARNING) << "Failed to read the link " << entry.from;
+        return false;
+    }
+    if (!RemoveExisting(entry.to)) {
+        return false;
+    }
+    if (symlink(target.c_str(), entry.to.c_str()) != 0) {
+        PLOG(WARNING) << "Failed to create the link " << entry.to;
+        return false;
+    }
+    return CopyMetadata(entry);
+}
+
+bool CreateDirectory(const Entry& entry) {
+    if (mkdir(entry.to.c_str(), 0700) == 0) {
+        return true;
+    }
+    struct stat st;
+    if (errno == EEXIST && lstat(entry.to.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        return true;
+    }
+    PLOG(WARNING) << "Failed to create " << entry.to;
+    return false;
+}
+
+bool CopyFiles(const std::vector<Entry>& files, CopyState* state) {
+    std::atomic_size_t next = 0;
+    std::atomic_bool failed = false;
+    auto copy = [&]() {
+        for (size_t i = next++; i < files.size() && !failed; i = next++) {
+            if (!CopyFile(files[i], state)) {
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(files.size(), kMaxCopyThreads); i++) {
+        threads.emplace_back(copy);
+    }
+    copy();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return !failed;
+}
+
+}  // namespace
+
+bool CopyDirectoryRecursive(const std::string& from, const std::string& to) {
+    const auto start = std::chrono::steady_clock::now();
+    const std::string root = to + "/" + android::base::Basename(from);
+
+    // Create the directories and links as they are found, and leave the files, which is where
+    // the data is, for the threads.
+    std::vector<Entry> directories;
+    std::vector<Entry> files;
+    char* argv[] = {const_cast<char*>(from.c_str()), nullptr};
+    FTS* fts = fts_open(argv, FTS_PHYSICAL | FTS_NOCHDIR, nullptr);
+    if (fts == nullptr) {
+        PLOG(WARNING) << "Failed to fts_open " << from;
+        return false;
+    }
+    bool ok = true;
+    FTSENT* p;
+    while (ok && (p = fts_read(fts)) != nullptr) {
+        Entry entry{p->fts_path, root + (p->fts_path + from.size()), {}};
+        switch (p->fts_info) {
+            case FTS_D:
+                entry.st = *p->fts_statp;
+                ok = CreateDirectory(entry);
+                directories.push_back(std::move(entry));
+                break;
+            case FTS_DP:
+                break;
+            case FTS_F:
+                entry.st = *p->fts_statp;
+                files.push_back(std::move(entry));
+                break;
+            case FTS_SL:
+            case FTS_SLNONE:
+                entry.st = *p->fts_statp;
+                ok = CopySymlink(entry);
+                break;
+            default:
+                // Special files, and the errors of the walk, are left to cp.
+                LOG(WARNING) << "Cannot copy " << p->fts_path << " (" << p->fts_info << ")";
+                ok = false;
+                break;
+        }
+    }
+    fts_close(fts);
+
+    CopyState state;
+    ok = ok && CopyFiles(files, &state);
+    // The entries of a directory change its timestamps, so the deepest directories go first.
+    for (auto it = directories.rbegin(); ok && it != directories.rend(); it++) {
+        ok = CopyMetadata(*it);
+    }
+    if (!ok) {
+        return false;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+    LOG(INFO) << "Copied " << from << " to " << to << ": " << files.size() << " files, "
+              << state.bytes << " bytes (" << state.reflinkedBytes << " reflinked) in "
+              << elapsed.count() << " ms";
+    return true;
+}
+
+}  // namespace installd
+}  // namespace android
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_INSTALLD_COPY_UTILS_H_
+#define ANDROID_INSTALLD_COPY_UTILS_H_
+
+#include <string>
+
+namespace android {
+namespace installd {
+
+/*
+ * Copy the directory "from", with everything in it, into the existing directory "to", like
+ * "cp -F -R -P --preserve=mode,ownership,timestamps,xattr" does. The data of the files is shared
+ * with FICLONE where the filesystem supports it, and copied in the kernel with copy_file_range
+ * otherwise, by a few threads at the same time.
+ *
+ * Return false if anything could not be copied, such as a special file. The copy may then be
+ * partial, and is best finished by cp, which replaces what was already copied.
+ */
+bool CopyDirectoryRecursive(const std::string& from, const std::string& to);
+
+}  // namespace installd
+}  // namespace android
+
+#endif  // ANDROID_INSTALLD_COPY_UTILS_H_
@@ -16,6 +16,7 @@
 
 #include "InstalldNativeService.h"
 
+#include <dirent.h>
 #include <errno.h>
 #include <fts.h>
 #include <inttypes.h>
@@ -36,9 +37,15 @@
 #include <sys/xattr.h>
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
 #include <regex>
 #include <thread>
 #include <unordered_set>
@@ -72,6 +79,7 @@
 #include "utils.h"
 
 #include "CacheTracker.h"
+#include "CopyUtils.h"
 #include "CrateManager.h"
 #include "MatchExtensionGen.h"
 #include "QuotaUtils.h"
@@ -467,6 +475,7 @@ status_t InstalldNativeService::dump(int fd, const Vector<String16>& /* args */)
     }
 
     dprintf(fd, "is_dexopt_blocked:%d\n", android::installd::is_dexopt_blocked());
+    dprintf(fd, "%s", android::installd::dump_dex2oat_queue().c_str());
 
     return NO_ERROR;
 }
@@ -514,6 +523,104 @@ private:
     const std::string& mPath;
 };
 
+/**
+ * Perform recursive restorecon of the given package directory, like
+ * selinux_android_restorecon_pkgdir() with SELINUX_ANDROID_RESTORECON_RECURSE does, but on a few
+ * threads at the same time. libselinux compares the label of each entry with the one it should
+ * have and leaves it alone if they match, so the time goes into the walk and the lookups, which
+ * the threads share. Like the recursive restorecon, this stays on the filesystem of the path.
+ */
+static int restorecon_pkgdir_parallel(const std::string& path, const std::string& seInfo,
+                                      uid_t uid) {
+    ScopedTrace tracer("restorecon-parallel");
+    constexpr size_t kMaxRestoreconThreads = 4;
+    constexpr size_t kProgressInterval = 10000;
+    const auto start = std::chrono::steady_clock::now();
+
+    struct stat rootStat;
+    if (lstat(path.c_str(), &rootStat) != 0) {
+        PLOG(ERROR) << "Failed to lstat " << path;
+        return -1;
+    }
+
+    std::atomic_size_t entries = 0;
+    auto restorecon = [&](const std::string& entry) {
+        if (selinux_android_restorecon_pkgdir(entry.c_str(), seInfo.c_str(), uid, 0) < 0) {
+            PLOG(ERROR) << "Failed restorecon for " << entry;
+            return false;
+        }
+        if (size_t count = ++entries; count % kProgressInterval == 0) {
+            LOG(INFO) << "Restorecon of " << path << " has checked " << count << " entries";
+        }
+        return true;
+    };
+    // Relabels what is in the directory, except for the subdirectories, which are returned so
+    // that any thread can take them.
+    auto visit = [&](const std::string& dir, std::vector<std::string>* subdirs) {
+        std::unique_ptr<DIR, decltype(&closedir)> d(opendir(dir.c_str()), closedir);
+        if (!d) {
+            PLOG(ERROR) << "Failed to opendir " << dir;
+            return false;
+        }
+        struct dirent* de;
+        while ((de = readdir(d.get())) != nullptr) {
+            if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) {
+                continue;
+            }
+            std::string entry = dir + "/" + de->d_name;
+            struct stat st;
+            if ((de->d_type == DT_DIR || de->d_type == DT_UNKNOWN) &&
+                fstatat(dirfd(d.get()), de->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+                S_ISDIR(st.st_mode) && st.st_dev == rootStat.st_dev) {
+                subdirs->push_back(std::move(entry));
+            } else if (!restorecon(entry)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::vector<std::string> pending = {path};
+    size_t busy = 0;
+    bool failed = false;
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> l(lock);
+        while (true) {
+            cv.wait(l, [&] { return failed || !pending.empty() || busy == 0; });
+            if (failed || pending.empty()) {
+                return;
+            }
+            std::string dir = std::move(pending.back());
+            pending.pop_back();
+            busy++;
+            l.unlock();
+            std::vector<std::string> subdirs;
+            const bool ok = restorecon(dir) && visit(dir, &subdirs);
+            l.lock();
+            busy--;
+            failed |= !ok;
+            std::move(subdirs.begin(), subdirs.end(), std::back_inserter(pending));
+            cv.notify_all();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < kMaxRestoreconThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+    LOG(DEBUG) << "Restorecon of " << path << " checked " << entries << " entries in "
+               << elapsed.count() << " ms";
+    return failed ? -1 : 0;
+}
+
 /**
  * Perform restorecon of the given path, but only perform recursive restorecon
  * if the label of that top-level file actually changed.  This can save us
@@ -566,8 +673,7 @@ static int restorecon_app_data_lazy(const std::string& path, const std::string&
             // Temporary mark the folder as "in-progress" to resume in case of reboot/other failure.
             RestoreconInProgress fence(path);
 
-            if (selinux_android_restorecon_pkgdir(path.c_str(), seInfo.c_str(), uid,
-                                                  SELINUX_ANDROID_RESTORECON_RECURSE) < 0) {
+            if (restorecon_pkgdir_parallel(path, seInfo, uid) < 0) {
                 PLOG(ERROR) << "Failed recursive restorecon for " << path;
                 return -1;
             }
@@ -996,13 +1102,48 @@ binder::Status InstalldNativeService::createAppDataBatched(
 
     // Locking is performed depeer in the callstack.
 
-    std::vector<android::os::CreateAppDataResult> results;
-    for (const auto &arg : args) {
-        android::os::CreateAppDataResult result;
-        createAppData(arg, &result);
-        results.push_back(result);
+    std::vector<android::os::CreateAppDataResult> results(args.size());
+#ifdef GRANULAR_LOCKS
+    // Each package and user is locked on its own, so the data of different ones is created in
+    // parallel. The entries for the same package and user are created in order by one worker.
+    std::vector<std::vector<size_t>> groups;
+    {
+        std::map<std::pair<std::string, int32_t>, size_t> groupIndices;
+        for (size_t i = 0; i < args.size(); i++) {
+            auto [it, inserted] =
+                    groupIndices.try_emplace({args[i].packageName, args[i].userId}, groups.size());
+            if (inserted) {
+                groups.emplace_back();
+            }
+            groups[it->second].push_back(i);
+        }
     }
-    *_aidl_return = results;
+
+    // The workers do not serve a binder call, so their calling UID is installd's own, and the
+    // caller was already checked above.
+    constexpr size_t kMaxCreateAppDataThreads = 4;
+    std::atomic_size_t nextGroup = 0;
+    auto worker = [&]() {
+        for (size_t group; (group = nextGroup++) < groups.size();) {
+            for (size_t i : groups[group]) {
+                createAppData(args[i], &results[i]);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(kMaxCreateAppDataThreads, groups.size()); i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+#else
+    for (size_t i = 0; i < args.size(); i++) {
+        createAppData(args[i], &results[i]);
+    }
+#endif // GRANULAR_LOCKS
+    *_aidl_return = std::move(results);
     return ok();
 }
 
@@ -1564,6 +1705,11 @@ binder::Status InstalldNativeService::fixupAppData(const std::optional<std::stri
 }
 
 static int32_t copy_directory_recursive(const char* from, const char* to) {
+    if (CopyDirectoryRecursive(from, to)) {
+        return 0;
+    }
+    LOG(WARNING) << "Falling back to cp to copy " << from << " to " << to;
+
     char* argv[] =
             {(char*)kCpPath,
              (char*)"-F", /* delete any existing destination file first (--remove-destination) */
@@ -2210,9 +2356,14 @@ binder::Status InstalldNativeService::freeCache(const std::optional<std::string>
         };
         std::priority_queue<std::shared_ptr<CacheTracker>,
                 std::vector<std::shared_ptr<CacheTracker>>, decltype(cmp)> queue(cmp);
+        std::vector<std::shared_ptr<CacheTracker>> trackerList;
+        trackerList.reserve(trackers.size());
         for (const auto& it : trackers) {
-            it.second->loadStats();
-            queue.push(it.second);
+            trackerList.push_back(it.second);
+        }
+        CacheTracker::loadAllStats(trackerList);
+        for (const auto& tracker : trackerList) {
+            queue.push(tracker);
         }
         atrace_pm_end();
 
@@ -2241,6 +2392,11 @@ binder::Status InstalldNativeService::freeCache(const std::optional<std::string>
                 }
                 active = queue.top(); queue.pop();
                 active->ensureItems();
+                // The next tracker is likely to be needed once this one is purged
+                // below it, so scan its items while purging this one
+                if (!queue.empty()) {
+                    queue.top()->prefetchItems();
+                }
                 continue;
             }
 
@@ -2722,6 +2878,46 @@ binder::Status InstalldNativeService::getAppSize(const std::optional<std::string
     return ok();
 }
 
+binder::Status InstalldNativeService::getAppSizeBatched(
+        const std::vector<android::os::GetAppSizeArgs>& args,
+        std::vector<int64_t>* _aidl_return) {
+    ENFORCE_UID(AID_SYSTEM);
+    // NOTE: Locking is relaxed on this method, since it's limited to
+    // read-only measurements without mutation.
+
+    // The packages are measured independently of each other, and the manual walks spend most of
+    // their time waiting on the disk, so a few of them run at the same time.
+    constexpr size_t kMaxGetAppSizeThreads = 4;
+    std::vector<std::vector<int64_t>> sizes(args.size());
+    std::vector<binder::Status> statuses(args.size());
+    std::atomic_size_t next = 0;
+    auto measure = [&]() {
+        for (size_t i = next++; i < args.size(); i = next++) {
+            const auto& arg = args[i];
+            statuses[i] = getAppSize(arg.uuid, arg.packageNames, arg.userId, arg.flags, arg.appId,
+                                     arg.ceDataInodes, arg.codePaths, &sizes[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(args.size(), kMaxGetAppSizeThreads); i++) {
+        threads.emplace_back(measure);
+    }
+    measure();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<int64_t> ret;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (!statuses[i].isOk()) {
+            return statuses[i];
+        }
+        ret.insert(ret.end(), sizes[i].begin(), sizes[i].end());
+    }
+    *_aidl_return = ret;
+    return ok();
+}
+
 struct external_sizes {
     int64_t audioSize;
     int64_t videoSize;
@@ -3427,22 +3623,19 @@ binder::Status InstalldNativeService::restoreconAppDataLocked(
 
     binder::Status res = ok();
 
-    // SELINUX_ANDROID_RESTORECON_DATADATA flag is set by libselinux. Not needed here.
-    unsigned int seflags = SELINUX_ANDROID_RESTORECON_RECURSE;
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
     const char* pkgName = packageName.c_str();
-    const char* seinfo = seInfo.c_str();
 
     uid_t uid = multiuser_get_uid(userId, appId);
     if (flags & FLAG_STORAGE_CE) {
         auto path = create_data_user_ce_package_path(uuid_, userId, pkgName);
-        if (selinux_android_restorecon_pkgdir(path.c_str(), seinfo, uid, seflags) < 0) {
+        if (restorecon_pkgdir_parallel(path, seInfo, uid) < 0) {
             res = error("restorecon failed for " + path);
         }
     }
     if (flags & FLAG_STORAGE_DE) {
         auto path = create_data_user_de_package_path(uuid_, userId, pkgName);
-        if (selinux_android_restorecon_pkgdir(path.c_str(), seinfo, uid, seflags) < 0) {
+        if (restorecon_pkgdir_parallel(path, seInfo, uid) < 0) {
             res = error("restorecon failed for " + path);
         }
     }
@@ -3459,11 +3652,8 @@ binder::Status InstalldNativeService::restoreconSdkDataLocked(
 
     binder::Status res = ok();
 
-    // SELINUX_ANDROID_RESTORECON_DATADATA flag is set by libselinux. Not needed here.
-    unsigned int seflags = SELINUX_ANDROID_RESTORECON_RECURSE;
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
     const char* pkgName = packageName.c_str();
-    const char* seinfo = seInfo.c_str();
 
     uid_t uid = multiuser_get_sdk_sandbox_uid(userId, appId);
     constexpr int storageFlags[2] = {FLAG_STORAGE_CE, FLAG_STORAGE_DE};
@@ -3478,10 +3668,9 @@ binder::Status InstalldNativeService::restoreconSdkDataLocked(
             LOG(INFO) << "Missing source " << packagePath;
             continue;
         }
-        const auto subDirHandler = [&packagePath, &seinfo, &uid, &seflags,
-                                    &res](const std::string& subDir) {
+        const auto subDirHandler = [&packagePath, &seInfo, &uid, &res](const std::string& subDir) {
             const auto& fullpath = packagePath + "/" + subDir;
-            if (selinux_android_restorecon_pkgdir(fullpath.c_str(), seinfo, uid, seflags) < 0) {
+            if (restorecon_pkgdir_parallel(fullpath, seInfo, uid) < 0) {
                 res = error("restorecon failed for " + fullpath);
             }
         };
@@ -4048,6 +4237,10 @@ binder::Status InstalldNativeService::enableFsverity(const sp<IFsveritySetupAuth
     }
 
     unique_fd rfd(open(procFdPath.c_str(), O_RDONLY | O_CLOEXEC));
+    // The kernel reads the whole file through rfd to build the Merkle tree, so let it read ahead
+    // further, and start on the file before the ioctl.
+    posix_fadvise(rfd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(rfd.get(), 0, 0, POSIX_FADV_WILLNEED);
     fsverity_enable_arg arg = {};
     arg.version = 1;
     arg.hash_algorithm = FS_VERITY_HASH_ALG_SHA256;
@@ -15,7 +15,9 @@
  */
 #define LOG_TAG "installd"
 
+#include <dirent.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
@@ -28,7 +30,10 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <condition_variable>
 #include <iomanip>
 #include <mutex>
 #include <unordered_set>
@@ -87,8 +92,28 @@ constexpr int kShortTimeoutMs = 60000; // 1 minute.
 // aborted before that watchdog would take down the system server.
 constexpr int kLongTimeoutMs = 570000; // 9.5 minutes.
 
+// Returns the number of CPU clusters, which are the cores that share a cpufreq policy.
+int count_cpu_clusters() {
+    int clusters = 0;
+    DIR* dir = opendir("/sys/devices/system/cpu/cpufreq");
+    if (dir != nullptr) {
+        struct dirent* ent;
+        while ((ent = readdir(dir)) != nullptr) {
+            if (strncmp(ent->d_name, "policy", strlen("policy")) == 0) {
+                clusters++;
+            }
+        }
+        closedir(dir);
+    }
+    return std::max(clusters, 1);
+}
+
 class DexOptStatus {
  public:
+    // Each dex2oat already runs as many threads as the cores that it may use, so more than one
+    // per CPU cluster only makes them contend for the same cores.
+    DexOptStatus() : max_running_dex2oat_(count_cpu_clusters()) {}
+
     // Check if dexopt is cancelled and fork if it is not cancelled.
     // cancelled is set to true if cancelled. Otherwise it will be set to false.
     // If it is not cancelled, it will return the return value of fork() call.
@@ -124,6 +149,43 @@ class DexOptStatus {
         return dexopt_blocked_;
     }
 
+    // Waits until a dex2oat process may be started, with foreground requests going ahead of
+    // background ones. Returns false if dexopt got blocked while waiting.
+    bool acquire_dex2oat_slot(bool background) {
+        std::unique_lock<std::mutex> lock(dexopt_lock_);
+        int& waiting = background ? waiting_background_dex2oat_ : waiting_foreground_dex2oat_;
+        const auto start = std::chrono::steady_clock::now();
+        waiting++;
+        dex2oat_slot_condition_.wait(lock, [this, background]() {
+            return dexopt_blocked_ || (running_dex2oat_ < max_running_dex2oat_ &&
+                                       (!background || waiting_foreground_dex2oat_ == 0));
+        });
+        waiting--;
+        dex2oat_wait_time_ += std::chrono::steady_clock::now() - start;
+        if (dexopt_blocked_) {
+            return false;
+        }
+        running_dex2oat_++;
+        return true;
+    }
+
+    void release_dex2oat_slot() {
+        std::lock_guard<std::mutex> lock(dexopt_lock_);
+        running_dex2oat_--;
+        finished_dex2oat_++;
+        dex2oat_slot_condition_.notify_all();
+    }
+
+    std::string dump_dex2oat_queue() {
+        std::lock_guard<std::mutex> lock(dexopt_lock_);
+        return StringPrintf("dex2oat: running:%d/%d waiting_foreground:%d waiting_background:%d "
+                            "finished:%" PRIu64 " total_wait_ms:%" PRId64 "\n",
+                            running_dex2oat_, max_running_dex2oat_, waiting_foreground_dex2oat_,
+                            waiting_background_dex2oat_, finished_dex2oat_,
+                            static_cast<int64_t>(std::chrono::duration_cast<
+                                    std::chrono::milliseconds>(dex2oat_wait_time_).count()));
+    }
+
     // Enable or disable dexopt blocking.
     void control_dexopt_blocking(bool block) {
         std::lock_guard<std::mutex> lock(dexopt_lock_);
@@ -131,6 +193,8 @@ class DexOptStatus {
         if (!block) {
             return;
         }
+        // Blocked, also cancel the requests that are waiting to run
+        dex2oat_slot_condition_.notify_all();
         // Blocked, also kill currently running tasks
         for (auto pid : dexopt_pids_) {
             LOG(INFO) << "control_dexopt_blocking kill pid:" << pid;
@@ -149,10 +213,39 @@ class DexOptStatus {
     std::unordered_set<pid_t> dexopt_pids_ GUARDED_BY(dexopt_lock_);
     // PIDs of child processes killed by cancellation.
     std::unordered_set<pid_t> dexopt_killed_pids_ GUARDED_BY(dexopt_lock_);
+
+    // Signaled when a dex2oat slot is released, or when dexopt is blocked.
+    std::condition_variable dex2oat_slot_condition_;
+    const int max_running_dex2oat_;
+    int running_dex2oat_ GUARDED_BY(dexopt_lock_) = 0;
+    int waiting_foreground_dex2oat_ GUARDED_BY(dexopt_lock_) = 0;
+    int waiting_background_dex2oat_ GUARDED_BY(dexopt_lock_) = 0;
+    uint64_t finished_dex2oat_ GUARDED_BY(dexopt_lock_) = 0;
+    std::chrono::steady_clock::duration dex2oat_wait_time_ GUARDED_BY(dexopt_lock_){};
 };
 
 android::base::NoDestructor<DexOptStatus> dexopt_status_;
 
+// Holds one of the dex2oat slots of dexopt_status_ while it is in scope.
+class Dex2oatSlot {
+ public:
+    explicit Dex2oatSlot(bool background)
+        : acquired_(dexopt_status_->acquire_dex2oat_slot(background)) {}
+
+    ~Dex2oatSlot() {
+        if (acquired_) {
+            dexopt_status_->release_dex2oat_slot();
+        }
+    }
+
+    bool acquired() const { return acquired_; }
+
+ private:
+    const bool acquired_;
+
+    DISALLOW_COPY_AND_ASSIGN(Dex2oatSlot);
+};
+
 } // namespace
 
 namespace android {
@@ -1614,6 +1707,10 @@ bool is_dexopt_blocked() {
     return dexopt_status_->is_dexopt_blocked();
 }
 
+std::string dump_dex2oat_queue() {
+    return dexopt_status_->dump_dex2oat_queue();
+}
+
 enum SecondaryDexOptProcessResult {
     kSecondaryDexOptProcessOk = 0,
     kSecondaryDexOptProcessCancelled = 1,
@@ -1968,8 +2065,9 @@ int dexopt(const char* dex_path, uid_t uid, const char* pkgname, const char* ins
                       enable_hidden_api_checks, generate_compact_dex, compile_without_image,
                       background_job_compile, compilation_reason);
 
-    bool cancelled = false;
-    pid_t pid = dexopt_status_->check_cancellation_and_fork(&cancelled);
+    Dex2oatSlot slot(background_job_compile);
+    bool cancelled = !slot.acquired();
+    pid_t pid = cancelled ? -1 : dexopt_status_->check_cancellation_and_fork(&cancelled);
     if (cancelled) {
         *completed = false;
         reference_profile.DisableCleanup();
@@ -2265,25 +2363,12 @@ bool hash_secondary_dex_file(const std::string& dex_path, const std::string& pkg
             _exit(DexoptReturnCodes::kHashOpenPath);
         }
 
-        SHA256_CTX ctx;
-        SHA256_Init(&ctx);
-
-        std::vector<uint8_t> buffer(65536);
-        while (true) {
-            ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, buffer.data(), buffer.size()));
-            if (bytes_read == 0) {
-                break;
-            } else if (bytes_read == -1) {
-                async_safe_format_log(ANDROID_LOG_ERROR, LOG_TAG,
-                        "Failed to read secondary dex %s: %d", dex_path.c_str(), errno);
-                _exit(DexoptReturnCodes::kHashReadDex);
-            }
-
-            SHA256_Update(&ctx, buffer.data(), bytes_read);
-        }
-
         std::array<uint8_t, SHA256_DIGEST_LENGTH> hash;
-        SHA256_Final(hash.data(), &ctx);
+        if (!sha256_fd(fd, &hash)) {
+            async_safe_format_log(ANDROID_LOG_ERROR, LOG_TAG,
+                    "Failed to read secondary dex %s: %d", dex_path.c_str(), errno);
+            _exit(DexoptReturnCodes::kHashReadDex);
+        }
         if (!WriteFully(pipe_write, hash.data(), hash.size())) {
             _exit(DexoptReturnCodes::kHashWrite);
         }
@@ -132,6 +132,9 @@ bool is_dexopt_blocked();
 
 void control_dexopt_blocking(bool block);
 
+// Returns the state of the queue of dex2oat processes, for dumpsys.
+std::string dump_dex2oat_queue();
+
 bool calculate_oat_file_path_default(char path[PKG_PATH_MAX], const char *oat_dir,
         const char *apk_path, const char *instruction_set);
 
@@ -14,7 +14,9 @@
  ** limitations under the License.
  */
 
+#include <dirent.h>
 #include <fcntl.h>
+#include <linux/ioprio.h>
 #include <linux/unistd.h>
 #include <sys/mount.h>
 #include <sys/stat.h>
@@ -25,11 +27,13 @@
 #include <array>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/macros.h>
+#include <android-base/parseint.h>
 #include <android-base/scopeguard.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
@@ -134,32 +138,62 @@ static void TryExtraMount(const char* name, const char* slot, const char* target
     (void)TryMountWithFstypes(block_device.c_str(), target);
 }
 
+// Returns the number of CPU clusters, which are the cores that share a cpufreq policy. As in
+// dexopt, each dex2oat runs as many threads as the cores it may use, so more jobs than clusters
+// only make them contend for the same cores.
+static int CountCpuClusters() {
+    int clusters = 0;
+    DIR* dir = opendir("/sys/devices/system/cpu/cpufreq");
+    if (dir != nullptr) {
+        for (dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+            if (std::string_view(entry->d_name).starts_with("policy")) {
+                clusters++;
+            }
+        }
+        closedir(dir);
+    }
+    return std::max(clusters, 1);
+}
+
 // Entry for otapreopt_chroot. Expected parameters are:
 //
-//   [cmd] [status-fd] [target-slot-suffix]
+//   [cmd] [status-fd] [target-slot-suffix] [--jobs=N]
 //
 // The file descriptor denoted by status-fd will be closed. Dexopt commands on
 // the form
 //
 //   "dexopt" [dexopt-params]
 //
-// are then read from stdin until EOF and passed on to /system/bin/otapreopt one
-// by one. After each call a line with the current command count is written to
-// stdout and flushed.
+// are then read from stdin until EOF and passed on to /system/bin/otapreopt, with
+// up to N of them running at a time. N defaults to 1, and 0 picks the number of
+// CPU clusters. After each call completes a line with the number of completed
+// commands is written to stdout and flushed.
 static int otapreopt_chroot(const int argc, char **arg) {
     // Validate arguments
     if (argc == 2 && std::string_view(arg[1]) == "--version") {
         // Accept a single --version flag, to allow the script to tell this binary
-        // from the earlier one.
-        std::cout << "2" << std::endl;
+        // from the earlier ones. Version 3 accepts --jobs.
+        std::cout << "3" << std::endl;
         return 0;
     }
-    if (argc != 3) {
+    if (argc != 3 && argc != 4) {
         LOG(ERROR) << "Wrong number of arguments: " << argc;
         exit(208);
     }
     const char* status_fd = arg[1];
     const char* slot_suffix = arg[2];
+    int jobs = 1;
+    if (argc == 4) {
+        std::string_view jobs_arg(arg[3]);
+        if (!jobs_arg.starts_with("--jobs=") ||
+            !android::base::ParseInt(std::string(jobs_arg.substr(strlen("--jobs="))), &jobs, 0)) {
+            LOG(ERROR) << "Invalid argument: " << jobs_arg;
+            exit(208);
+        }
+        if (jobs == 0) {
+            jobs = CountCpuClusters();
+        }
+    }
 
     // Set O_CLOEXEC on standard fds. They are coming from the caller, we do not
     // want to pass them on across our fork/exec into a different domain.
@@ -352,6 +386,48 @@ static int otapreopt_chroot(const int argc, char **arg) {
 
     // Now go on and read dexopt lines from stdin and pass them on to otapreopt.
 
+    if (jobs > 1) {
+        // The jobs which run in parallel share the I/O bandwidth that a single one used to have
+        // to itself. Leave the rest of the system ahead of them, the way their dex2oat runs in the
+        // background for CPU. The priority is inherited by the otapreopt processes.
+        if (syscall(__NR_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                    IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, 7)) != 0) {
+            PLOG(WARNING) << "Failed to lower I/O priority";
+        }
+    }
+
+    // The commands which are running, by pid, with their number.
+    std::map<pid_t, std::pair<int, std::vector<std::string>>> running;
+    int completed = 0;
+    auto complete = [&](pid_t pid, int status) {
+        auto it = running.find(pid);
+        if (it == running.end()) {
+            return;
+        }
+        std::string error_msg;
+        if (!CheckExecStatus(it->second.second, status, &error_msg)) {
+            LOG(ERROR) << "Running otapreopt failed for command " << it->second.first << ": "
+                       << error_msg;
+        }
+        running.erase(it);
+
+        // Print the count to stdout and flush to indicate progress.
+        std::cout << ++completed << std::endl;
+    };
+    auto wait_for_any = [&]() {
+        int status;
+        pid_t pid = TEMP_FAILURE_RETRY(waitpid(-1, &status, 0));
+        if (pid == -1) {
+            PLOG(ERROR) << "waitpid failed with " << running.size() << " commands running";
+            // Nothing can be waited for anymore, so count them as failed.
+            while (!running.empty()) {
+                complete(running.begin()->first, -1);
+            }
+            return;
+        }
+        complete(pid, status);
+    };
+
     int count = 1;
     for (std::array<char, 10000> linebuf;
          std::cin.clear(), std::cin.getline(&linebuf[0], linebuf.size()); ++count) {
@@ -360,6 +436,8 @@ static int otapreopt_chroot(const int argc, char **arg) {
 
         if (std::cin.fail()) {
             LOG(ERROR) << "Command exceeds max length " << linebuf.size() << " - skipped: " << line;
+            // Shown as progress along with the next command which completes.
+            completed++;
             continue;
         }
 
@@ -367,17 +445,24 @@ static int otapreopt_chroot(const int argc, char **arg) {
         std::vector<std::string> cmd{"/system/bin/otapreopt", slot_suffix};
         std::move(tokenized_line.begin(), tokenized_line.end(), std::back_inserter(cmd));
 
+        while (running.size() >= static_cast<size_t>(jobs)) {
+            wait_for_any();
+        }
+
         LOG(INFO) << "Command " << count << ": " << android::base::Join(cmd, " ");
 
         // Fork and execute otapreopt in its own process.
         std::string error_msg;
-        bool exec_result = Exec(cmd, &error_msg);
-        if (!exec_result) {
-            LOG(ERROR) << "Running otapreopt failed: " << error_msg;
+        pid_t pid = ExecAsync(cmd, &error_msg);
+        if (pid == -1) {
+            LOG(ERROR) << "Running otapreopt failed for command " << count << ": " << error_msg;
+            std::cout << ++completed << std::endl;
+            continue;
         }
-
-        // Print the count to stdout and flush to indicate progress.
-        std::cout << count << std::endl;
+        running.emplace(pid, std::make_pair(count, std::move(cmd)));
+    }
+    while (!running.empty()) {
+        wait_for_any();
     }
 
     LOG(INFO) << "No more dexopt commands";
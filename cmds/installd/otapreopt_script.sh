@@ -81,7 +81,8 @@ else
   echo "Pre-reboot Dexopt is too old. Fall back to otapreopt."
 fi
 
-if [ "$(/system/bin/otapreopt_chroot --version)" != 2 ]; then
+CHROOT_VERSION="$(/system/bin/otapreopt_chroot --version)"
+if [ "$CHROOT_VERSION" != 2 ] && [ "$CHROOT_VERSION" != 3 ]; then
   # We require an updated chroot wrapper that reads dexopt commands from stdin.
   # Even if we kept compat with the old binary, the OTA preopt wouldn't work due
   # to missing sepolicy rules, so there's no use spending time trying to dexopt
@@ -90,6 +91,13 @@ if [ "$(/system/bin/otapreopt_chroot --version)" != 2 ]; then
   exit 0
 fi
 
+# Version 3 runs several otapreopt jobs in parallel. 0 lets it pick the number
+# of CPU clusters.
+CHROOT_ARGS=()
+if [ "$CHROOT_VERSION" = 3 ]; then
+  CHROOT_ARGS+=("--jobs=$(getprop ro.otapreopt.jobs 0)")
+fi
+
 PREPARE=$(cmd otadexopt prepare)
 # Note: Ignore preparation failures. Step and done will fail and exit this.
 #       This is necessary to support suspends - the OTA service will keep
@@ -125,7 +133,7 @@ function report_progress {
 }
 
 print_otadexopt_cmds | \
-  /system/bin/otapreopt_chroot $STATUS_FD $TARGET_SLOT_SUFFIX | \
+  /system/bin/otapreopt_chroot $STATUS_FD $TARGET_SLOT_SUFFIX "${CHROOT_ARGS[@]}" | \
   report_progress
 
 if [ "$DONE" = "OTA incomplete." ] ; then
@@ -17,6 +17,8 @@
 #ifndef OTAPREOPT_UTILS_H_
 #define OTAPREOPT_UTILS_H_
 
+#include <sys/types.h>
+
 #include <regex>
 #include <string>
 #include <vector>
@@ -33,6 +35,14 @@ static inline bool ValidateTargetSlotSuffix(const std::string& input) {
 // Wrapper on fork/execv to run a command in a subprocess.
 bool Exec(const std::vector<std::string>& arg_vector, std::string* error_msg);
 
+// Starts a command in a subprocess like Exec, but does not wait for it. Returns the pid of the
+// subprocess, or -1 if the fork failed.
+pid_t ExecAsync(const std::vector<std::string>& arg_vector, std::string* error_msg);
+
+// Checks the wait status of a subprocess started by ExecAsync.
+bool CheckExecStatus(const std::vector<std::string>& arg_vector, int status,
+                     std::string* error_msg);
+
 }  // namespace installd
 }  // namespace android
 
@@ -23,6 +23,7 @@
 #include <android-base/stringprintf.h>
 #include <cutils/properties.h>
 #include <gtest/gtest.h>
+#include <private/android_filesystem_config.h>
 
 #include "InstalldNativeService.h"
 #include "globals.h"
@@ -159,6 +160,32 @@ TEST_F(CacheTest, FreeCache_All) {
     EXPECT_EQ(-1, exists("com.example/cache/foo/two"));
 }
 
+TEST_F(CacheTest, FreeCache_ManyApps) {
+    LOG(INFO) << "FreeCache_ManyApps";
+
+    // Each app has its own UID, and so its own tracker
+    constexpr int kAppCount = 12;
+    for (int i = 0; i < kAppCount; i++) {
+        const std::string app = StringPrintf("com.example%d", i);
+        mkdir(app.c_str());
+        mkdir((app + "/cache").c_str());
+        touch((app + "/cache/one").c_str(), 1 * kMbInBytes, 60 + i);
+        touch((app + "/cache/two").c_str(), 2 * kMbInBytes, 120 + i);
+        const uid_t uid = AID_APP_START + i;
+        const std::string fullPath = "/data/local/tmp/user/0/" + app;
+        EXPECT_EQ(0, ::chown(fullPath.c_str(), uid, uid));
+    }
+
+    service->freeCache(testUuid, kTbInBytes,
+            FLAG_FREE_CACHE_V2 | FLAG_FREE_CACHE_V2_DEFY_QUOTA);
+
+    for (int i = 0; i < kAppCount; i++) {
+        const std::string app = StringPrintf("com.example%d", i);
+        EXPECT_EQ(-1, exists((app + "/cache/one").c_str()));
+        EXPECT_EQ(-1, exists((app + "/cache/two").c_str()));
+    }
+}
+
 TEST_F(CacheTest, FreeCache_NonAggressive) {
     LOG(INFO) << "FreeCache_NonAggressive";
 
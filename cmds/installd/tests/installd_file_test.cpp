@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "CopyUtils.h"
 #include "restorable_file.h"
 #include "unique_file.h"
 #include "utils.h"
@@ -517,5 +518,56 @@ TEST_F(FileTest, TestRestorableFileRemoveFileAndTmpFileWithContentAndTmpFile) {
     ASSERT_FILE_NOT_EXISTING(backupFile);
 }
 
+TEST_F(FileTest, TestCopyDirectoryRecursive) {
+    std::string from = GetTestFilePath("from");
+    std::string to = GetTestFilePath("to");
+    ASSERT_EQ(0, mkdir(from.c_str(), 0751));
+    ASSERT_EQ(0, mkdir((from + "/dir").c_str(), 0700));
+    ASSERT_EQ(0, mkdir(to.c_str(), 0700));
+    ASSERT_EQ(0, mkdir((to + "/from").c_str(), 0700));
+    std::string large(3 * 1024 * 1024 + 7, 'x');
+    CreateTestFileWithContents(from + "/large", large);
+    for (int i = 0; i < 20; i++) {
+        CreateTestFileWithContents(android::base::StringPrintf("%s/dir/%d", from.c_str(), i),
+                                   std::to_string(i));
+    }
+    ASSERT_EQ(0, chmod((from + "/dir/0").c_str(), 0640));
+    ASSERT_EQ(0, symlink("dir/0", (from + "/link").c_str()));
+    // The existing file is replaced, as "cp -F" does.
+    CreateTestFileWithContents(to + "/from/large", "OriginalContent");
+
+    ASSERT_TRUE(CopyDirectoryRecursive(from, to));
+
+    ASSERT_FILE_CONTENT((to + "/from/large"), large);
+    for (int i = 0; i < 20; i++) {
+        ASSERT_FILE_CONTENT(android::base::StringPrintf("%s/from/dir/%d", to.c_str(), i),
+                            std::to_string(i));
+    }
+    std::string target;
+    ASSERT_TRUE(android::base::Readlink(to + "/from/link", &target));
+    ASSERT_EQ("dir/0", target);
+
+    struct stat fromSt, toSt;
+    for (const char* path : {"", "/dir", "/dir/0", "/large"}) {
+        ASSERT_EQ(0, lstat((from + path).c_str(), &fromSt));
+        ASSERT_EQ(0, lstat((to + "/from" + path).c_str(), &toSt));
+        EXPECT_EQ(fromSt.st_mode, toSt.st_mode) << path;
+        EXPECT_EQ(fromSt.st_uid, toSt.st_uid) << path;
+        EXPECT_EQ(fromSt.st_mtim.tv_sec, toSt.st_mtim.tv_sec) << path;
+        EXPECT_EQ(fromSt.st_mtim.tv_nsec, toSt.st_mtim.tv_nsec) << path;
+    }
+}
+
+TEST_F(FileTest, TestCopyDirectoryRecursiveSpecialFile) {
+    std::string from = GetTestFilePath("from");
+    std::string to = GetTestFilePath("to");
+    ASSERT_EQ(0, mkdir(from.c_str(), 0700));
+    ASSERT_EQ(0, mkdir(to.c_str(), 0700));
+    ASSERT_EQ(0, mkfifo((from + "/fifo").c_str(), 0600));
+
+    // Special files are left to cp.
+    ASSERT_FALSE(CopyDirectoryRecursive(from, to));
+}
+
 } // namespace installd
 } // namespace android
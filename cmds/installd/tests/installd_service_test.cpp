@@ -547,6 +547,41 @@ TEST_F(ServiceTest, GetAppSizeWrongSizes) {
                                            &externalStorageSize));
 }
 
+TEST_F(ServiceTest, GetAppSizeBatched) {
+    std::vector<android::os::GetAppSizeArgs> args;
+    std::vector<int64_t> expected;
+    for (int32_t i = 0; i < 6; i++) {
+        android::os::GetAppSizeArgs arg;
+        arg.packageNames = {StringPrintf("com.example.batched%d", i)};
+        arg.userId = 0;
+        arg.flags = FLAG_STORAGE_DE | FLAG_STORAGE_CE;
+        arg.appId = kTestAppId + i;
+        arg.ceDataInodes = {0};
+
+        std::vector<int64_t> sizes;
+        ASSERT_BINDER_SUCCESS(service->getAppSize(arg.uuid, arg.packageNames, arg.userId,
+                                                  arg.flags, arg.appId, arg.ceDataInodes,
+                                                  arg.codePaths, &sizes));
+        expected.insert(expected.end(), sizes.begin(), sizes.end());
+        args.push_back(std::move(arg));
+    }
+
+    std::vector<int64_t> sizes;
+    ASSERT_BINDER_SUCCESS(service->getAppSizeBatched(args, &sizes));
+    EXPECT_EQ(expected, sizes);
+}
+
+TEST_F(ServiceTest, GetAppSizeBatchedWrongSizes) {
+    android::os::GetAppSizeArgs arg;
+    arg.packageNames = {"package1", "package2"};
+    arg.flags = InstalldNativeService::FLAG_USE_QUOTA;
+    arg.appId = -1;
+    arg.ceDataInodes = {0};
+
+    std::vector<int64_t> sizes;
+    EXPECT_BINDER_FAIL(service->getAppSizeBatched({arg}, &sizes));
+}
+
 class FsverityTest : public ServiceTest {
 protected:
     binder::Status createFsveritySetupAuthToken(const std::string& path, int open_mode,
@@ -1240,6 +1275,34 @@ TEST_F(SdkSandboxDataTest, CreateAppData_CreatesSdkPackageData_WithoutCeFlag) {
     CheckFileAccess("misc_de/0/sdksandbox/com.foo", kSystemUid, kSystemUid, S_IFDIR | 0751);
 }
 
+TEST_F(SdkSandboxDataTest, CreateAppDataBatched_ReturnsResultsInOrder) {
+    std::vector<android::os::CreateAppDataArgs> args;
+    for (int i = 0; i < 8; i++) {
+        args.push_back(createAppDataArgs("com.foo" + std::to_string(i)));
+    }
+    args[3].packageName = "com/foo3";
+    // The entries for the same package and user are created in order, so this one deletes the sdk
+    // data that the first one created.
+    args.push_back(createAppDataArgs("com.foo1"));
+    args.back().flags = FLAG_STORAGE_CE | FLAG_STORAGE_DE;
+
+    std::vector<android::os::CreateAppDataResult> results;
+    ASSERT_BINDER_SUCCESS(service->createAppDataBatched(args, &results));
+    ASSERT_EQ(args.size(), results.size());
+
+    for (size_t i = 0; i < args.size(); i++) {
+        if (i == 3) {
+            EXPECT_EQ(binder::Status::EX_ILLEGAL_ARGUMENT, results[i].exceptionCode);
+            continue;
+        }
+        EXPECT_EQ(binder::Status::EX_NONE, results[i].exceptionCode) << "For entry " << i;
+        EXPECT_TRUE(exists(("/data/local/tmp/user/0/" + args[i].packageName).c_str()))
+                << "For entry " << i;
+    }
+    ASSERT_FALSE(exists("/data/local/tmp/misc_ce/0/sdksandbox/com.foo1"));
+    CheckFileAccess("misc_ce/0/sdksandbox/com.foo2", kSystemUid, kSystemUid, S_IFDIR | 0751);
+}
+
 TEST_F(SdkSandboxDataTest, ReconcileSdkData) {
     android::os::ReconcileSdkDataArgs args =
             reconcileSdkDataArgs("com.foo", {"bar@random1", "baz@random2"});
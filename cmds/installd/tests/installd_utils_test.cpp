@@ -19,6 +19,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/scopeguard.h>
 #include <gmock/gmock.h>
@@ -757,5 +758,29 @@ TEST_F(UtilsTest, RemoveFileAtFd) {
     close(fd);
 }
 
+TEST_F(UtilsTest, Sha256Fd) {
+    std::string filename = "/data/local/tmp/tempfile-XXXXXX";
+    int fd = mkstemp(filename.data());
+    ASSERT_GE(fd, 0);
+    auto cleanup = android::base::make_scope_guard([&] {
+        close(fd);
+        unlink(filename.c_str());
+    });
+
+    // Spans several reads, the last of them partial.
+    std::string content(5 * 1024 * 1024 / 2, '\0');
+    for (size_t i = 0; i < content.size(); i++) {
+        content[i] = static_cast<char>(i * 7);
+    }
+    ASSERT_TRUE(android::base::WriteStringToFd(content, fd));
+    ASSERT_EQ(lseek(fd, 0, SEEK_SET), 0);
+
+    std::array<uint8_t, SHA256_DIGEST_LENGTH> expected;
+    SHA256(reinterpret_cast<const uint8_t*>(content.data()), content.size(), expected.data());
+    std::array<uint8_t, SHA256_DIGEST_LENGTH> hash;
+    ASSERT_TRUE(sha256_fd(fd, &hash));
+    EXPECT_EQ(hash, expected);
+}
+
 }  // namespace installd
 }  // namespace android
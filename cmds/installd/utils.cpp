@@ -22,6 +22,7 @@
 #include <poll.h>
 #include <stdlib.h>
 #include <sys/capability.h>
+#include <sys/mman.h>
 #include <sys/pidfd.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
@@ -1445,5 +1446,41 @@ bool remove_file_at_fd(int fd, /*out*/ std::string* path) {
     return true;
 }
 
+// Large enough that the time goes to hashing rather than to read calls. BoringSSL hashes with the
+// CPU's SHA instructions, e.g. the ARMv8 crypto extensions, where there are any.
+static constexpr size_t kSha256ReadSize = 1024 * 1024;
+
+bool sha256_fd(int fd, /*out*/ std::array<uint8_t, SHA256_DIGEST_LENGTH>* hash) {
+    // The file is read once from front to back, so let the kernel read ahead further.
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Page aligned, and not from the heap, which a forked child must not use.
+    void* buffer = mmap(nullptr, kSha256ReadSize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+        return false;
+    }
+
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+    bool success = true;
+    while (true) {
+        ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, buffer, kSha256ReadSize));
+        if (bytes_read == 0) {
+            break;
+        } else if (bytes_read == -1) {
+            success = false;
+            break;
+        }
+        SHA256_Update(&ctx, buffer, bytes_read);
+    }
+    SHA256_Final(hash->data(), &ctx);
+
+    int saved_errno = errno;
+    munmap(buffer, kSha256ReadSize);
+    errno = saved_errno;
+    return success;
+}
+
 }  // namespace installd
 }  // namespace android
@@ -18,6 +18,7 @@
 #ifndef UTILS_H_
 #define UTILS_H_
 
+#include <array>
 #include <functional>
 #include <string>
 #include <vector>
@@ -28,6 +29,7 @@
 #include <utime.h>
 
 #include <cutils/multiuser.h>
+#include <openssl/sha.h>
 
 #include <installd_constants.h>
 
@@ -189,6 +191,10 @@ void drop_capabilities(uid_t uid);
 // `path` if present.
 bool remove_file_at_fd(int fd, /*out*/ std::string* path = nullptr);
 
+// Computes the SHA-256 of the rest of the file behind `fd`, reading it front to back. Returns false
+// with errno set if a read fails. Does not allocate, so it is safe to use in a forked child.
+bool sha256_fd(int fd, /*out*/ std::array<uint8_t, SHA256_DIGEST_LENGTH>* hash);
+
 }  // namespace installd
 }  // namespace android
 
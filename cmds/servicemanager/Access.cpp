@@ -46,13 +46,20 @@ static std::string getPidcon(pid_t pid) {
     return result;
 }
 
-static struct selabel_handle* getSehandle() {
-    static struct selabel_handle* gSehandle = nullptr;
-    if (gSehandle != nullptr && selinux_status_updated()) {
+// Bounds the memory of the decision cache, which is dropped as a whole once full. There are far
+// fewer pairs of caller context and service than this in practice.
+constexpr size_t kMaxCachedDecisions = 4096;
+
+static struct selabel_handle* gSehandle = nullptr;
+
+static void closeSehandle() {
+    if (gSehandle != nullptr) {
         selabel_close(gSehandle);
         gSehandle = nullptr;
     }
+}
 
+static struct selabel_handle* getSehandle() {
     if (gSehandle == nullptr) {
         gSehandle = kIsVendor
             ? selinux_android_vendor_service_context_handle()
@@ -126,15 +133,61 @@ Access::CallingContext Access::getCallingContext() {
 }
 
 bool Access::canFind(const CallingContext& ctx,const std::string& name) {
-    return actionAllowedFromLookup(ctx, name, "find");
+    return cachedActionAllowed(ctx, "find", name,
+                               [&] { return actionAllowedFromLookup(ctx, name, "find"); });
 }
 
 bool Access::canAdd(const CallingContext& ctx, const std::string& name) {
-    return actionAllowedFromLookup(ctx, name, "add");
+    return cachedActionAllowed(ctx, "add", name,
+                               [&] { return actionAllowedFromLookup(ctx, name, "add"); });
 }
 
 bool Access::canList(const CallingContext& ctx) {
-    return actionAllowed(ctx, mThisProcessContext, "list", "service_manager");
+    const std::string tname = "service_manager";
+    return cachedActionAllowed(ctx, "list", tname, [&] {
+        return actionAllowed(ctx, mThisProcessContext, "list", tname);
+    });
+}
+
+Access::CacheStats Access::getCacheStats() const {
+    CacheStats stats = mCacheStats;
+    stats.size = mAllowed.size();
+    return stats;
+}
+
+template <typename Check>
+bool Access::cachedActionAllowed(const CallingContext& sctx, const char* perm,
+                                 const std::string& tname, Check check) {
+#ifdef __ANDROID__
+    // This reads the status page, and also covers the service contexts that the lookup uses.
+    if (selinux_status_updated() > 0) {
+        closeSehandle();
+        mAllowed.clear();
+        mCacheStats.invalidations++;
+    }
+
+    // Callers without a context are checked, and denied, every time.
+    if (sctx.sid.empty()) return check();
+
+    std::string key = sctx.sid + '\n' + perm + '\n' + tname;
+    if (mAllowed.count(key) > 0) {
+        mCacheStats.hits++;
+        return true;
+    }
+
+    mCacheStats.misses++;
+    if (!check()) return false;
+
+    if (mAllowed.size() >= kMaxCachedDecisions) mAllowed.clear();
+    mAllowed.insert(std::move(key));
+    return true;
+#else
+    (void)sctx;
+    (void)perm;
+    (void)tname;
+
+    return check();
+#endif
 }
 
 bool Access::actionAllowed(const CallingContext& sctx, const char* tctx, const char* perm,
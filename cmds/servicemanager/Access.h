@@ -16,8 +16,10 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <sys/types.h>
+#include <unordered_set>
 
 namespace android {
 
@@ -46,13 +48,31 @@ public:
     virtual bool canAdd(const CallingContext& ctx, const std::string& name);
     virtual bool canList(const CallingContext& ctx);
 
+    // Allowed decisions are cached by caller context, permission and service name until the
+    // SELinux policy is reloaded or the enforcing mode changes. Denials are always checked
+    // again, so that each of them is audited.
+    struct CacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t invalidations = 0;
+        size_t size = 0;
+    };
+    CacheStats getCacheStats() const;
+
 private:
     bool actionAllowed(const CallingContext& sctx, const char* tctx, const char* perm,
             const std::string& tname);
     bool actionAllowedFromLookup(const CallingContext& sctx, const std::string& name,
             const char *perm);
+    template <typename Check>
+    bool cachedActionAllowed(const CallingContext& sctx, const char* perm,
+                             const std::string& tname, Check check);
 
     char* mThisProcessContext = nullptr;
+
+    // Only used from the thread of servicemanager's looper.
+    std::unordered_set<std::string> mAllowed;
+    CacheStats mCacheStats;
 };
 
 };
@@ -16,9 +16,12 @@
 
 #include "ServiceManager.h"
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
 #include <android-base/properties.h>
 #include <android-base/scopeguard.h>
+#include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 #include <binder/BpBinder.h>
 #include <binder/IPCThreadState.h>
@@ -26,6 +29,7 @@
 #include <binder/Stability.h>
 #include <cutils/android_filesystem_config.h>
 #include <cutils/multiuser.h>
+#include <inttypes.h>
 #include <thread>
 
 #if !defined(VENDORSERVICEMANAGER) && !defined(__ANDROID_RECOVERY__)
@@ -66,6 +70,9 @@ constexpr uint32_t kProtoApexName = perfetto_protos_AndroidTrackEvent_apex_name_
 
 #endif // !(defined(VENDORSERVICEMANAGER) || defined(__ANDROID_RECOVERY__))
 
+// Bounds the work done by one getServices call, which holds up every other caller.
+constexpr size_t kMaxServicesPerLookup = 256;
+
 bool is_multiuser_uid_isolated(uid_t uid) {
     uid_t appid = multiuser_get_app_id(uid);
     return appid >= AID_ISOLATED_START && appid <= AID_ISOLATED_END;
@@ -396,7 +403,7 @@ Status ServiceManager::getService(const std::string& name, sp<IBinder>* outBinde
     SM_PERFETTO_TRACE_FUNC(PERFETTO_TE_PROTO_FIELDS(
             PERFETTO_TE_PROTO_FIELD_CSTR(kProtoServiceName, name.c_str())));
 
-    *outBinder = tryGetBinder(name, true);
+    *outBinder = tryGetBinder(mAccess->getCallingContext(), name, true);
     // returns ok regardless of result for legacy reasons
     return Status::ok();
 }
@@ -405,43 +412,63 @@ Status ServiceManager::getService2(const std::string& name, os::Service* outServ
     SM_PERFETTO_TRACE_FUNC(PERFETTO_TE_PROTO_FIELDS(
             PERFETTO_TE_PROTO_FIELD_CSTR(kProtoServiceName, name.c_str())));
 
-    *outService = tryGetService(name, true);
+    *outService = tryGetService(mAccess->getCallingContext(), name, true);
     // returns ok regardless of result for legacy reasons
     return Status::ok();
 }
 
+Status ServiceManager::getServices(const std::vector<std::string>& names,
+                                   std::vector<os::Service>* outServices) {
+    SM_PERFETTO_TRACE_FUNC();
+
+    if (names.size() > kMaxServicesPerLookup) {
+        return Status::fromExceptionCode(Status::EX_ILLEGAL_ARGUMENT, "Too many services.");
+    }
+
+    // The calling context is looked up once for all of the names.
+    auto ctx = mAccess->getCallingContext();
+
+    outServices->clear();
+    outServices->reserve(names.size());
+    for (const std::string& name : names) {
+        outServices->push_back(tryGetService(ctx, name, true));
+    }
+    // returns ok regardless of result, like getService2
+    return Status::ok();
+}
+
 Status ServiceManager::checkService(const std::string& name, os::Service* outService) {
     SM_PERFETTO_TRACE_FUNC(PERFETTO_TE_PROTO_FIELDS(
             PERFETTO_TE_PROTO_FIELD_CSTR(kProtoServiceName, name.c_str())));
 
-    *outService = tryGetService(name, false);
+    *outService = tryGetService(mAccess->getCallingContext(), name, false);
     // returns ok regardless of result for legacy reasons
     return Status::ok();
 }
 
-os::Service ServiceManager::tryGetService(const std::string& name, bool startIfNotFound) {
+os::Service ServiceManager::tryGetService(const Access::CallingContext& ctx,
+                                          const std::string& name, bool startIfNotFound) {
     std::optional<std::string> accessorName;
 #ifndef VENDORSERVICEMANAGER
     accessorName = getVintfAccessorName(name);
 #endif
     if (accessorName.has_value()) {
-        auto ctx = mAccess->getCallingContext();
         if (!mAccess->canFind(ctx, name)) {
             return os::Service::make<os::Service::Tag::accessor>(nullptr);
         }
         return os::Service::make<os::Service::Tag::accessor>(
-                tryGetBinder(*accessorName, startIfNotFound));
+                tryGetBinder(ctx, *accessorName, startIfNotFound));
     } else {
-        return os::Service::make<os::Service::Tag::binder>(tryGetBinder(name, startIfNotFound));
+        return os::Service::make<os::Service::Tag::binder>(
+                tryGetBinder(ctx, name, startIfNotFound));
     }
 }
 
-sp<IBinder> ServiceManager::tryGetBinder(const std::string& name, bool startIfNotFound) {
+sp<IBinder> ServiceManager::tryGetBinder(const Access::CallingContext& ctx,
+                                         const std::string& name, bool startIfNotFound) {
     SM_PERFETTO_TRACE_FUNC(PERFETTO_TE_PROTO_FIELDS(
             PERFETTO_TE_PROTO_FIELD_CSTR(kProtoServiceName, name.c_str())));
 
-    auto ctx = mAccess->getCallingContext();
-
     sp<IBinder> out;
     Service* service = nullptr;
     if (auto it = mNameToService.find(name); it != mNameToService.end()) {
@@ -459,11 +486,29 @@ sp<IBinder> ServiceManager::tryGetBinder(const std::string& name, bool startIfNo
         return nullptr;
     }
 
+    auto lazyIt = mNameToLazyService.find(name);
+    LazyService* lazyService = lazyIt != mNameToLazyService.end() ? &lazyIt->second : nullptr;
+
     if (!out && startIfNotFound) {
+        // Only the first of the calls made while the service starts is a cold start.
+        if (lazyService && !lazyService->starting) {
+            lazyService->starting = true;
+            lazyService->coldStarts++;
+            recordLazyServiceDemand(lazyService);
+        }
         tryStartService(ctx, name);
     }
 
     if (out) {
+        if (service->keptByPolicy) {
+            service->keptByPolicy = false;
+            if (lazyService) {
+                lazyService->avoidedColdStarts++;
+                recordLazyServiceDemand(lazyService);
+            }
+        }
+        service->lastClientTime = std::chrono::steady_clock::now();
+
         // Force onClients to get sent, and then make sure the timerfd won't clear it
         // by setting guaranteeClient again. This logic could be simplified by using
         // a time-based guarantee. However, forcing onClients(true) to get sent
@@ -573,8 +618,17 @@ Status ServiceManager::addService(const std::string& name, const sp<IBinder>& bi
             .hasClients = prevClients, // see b/279898063, matters if existing callbacks
             .guaranteeClient = false,
             .ctx = ctx,
+            .lastClientTime = std::chrono::steady_clock::now(),
     };
 
+    if (auto lazyIt = mNameToLazyService.find(name); lazyIt != mNameToLazyService.end()) {
+        LazyService& lazyService = lazyIt->second;
+        // Nobody asked for a service which was prewarmed yet.
+        mNameToService[name].keptByPolicy = lazyService.prewarming;
+        lazyService.starting = false;
+        lazyService.prewarming = false;
+    }
+
     if (auto it = mNameToRegistrationCallback.find(name); it != mNameToRegistrationCallback.end()) {
         // If someone is currently waiting on the service, notify the service that
         // we're waiting and flush it to the service.
@@ -987,6 +1041,10 @@ bool ServiceManager::handleServiceClientCallback(size_t knownClients,
     if (count == -1) return true;
 
     bool hasKernelReportedClients = static_cast<size_t>(count) > knownClients;
+    if (hasKernelReportedClients) {
+        service.lastClientTime = std::chrono::steady_clock::now();
+        service.keptByPolicy = false;
+    }
 
     if (service.guaranteeClient) {
         if (!service.hasClients && !hasKernelReportedClients) {
@@ -1007,8 +1065,12 @@ bool ServiceManager::handleServiceClientCallback(size_t knownClients,
     // But limit rate of shutting down service.
     if (isCalledOnInterval) {
         if (!hasKernelReportedClients && service.hasClients) {
-            sendClientCallbackNotifications(serviceName, false,
-                                            "we now have no record of a client");
+            if (isKeptAliveByPolicy(serviceName, service)) {
+                service.keptByPolicy = true;
+            } else {
+                sendClientCallbackNotifications(serviceName, false,
+                                                "we now have no record of a client");
+            }
         }
     }
 
@@ -1044,6 +1106,80 @@ void ServiceManager::sendClientCallbackNotifications(const std::string& serviceN
     service.hasClients = hasClients;
 }
 
+bool ServiceManager::isKeptAliveByPolicy(const std::string& serviceName,
+                                         const Service& service) const {
+    auto lazyIt = mNameToLazyService.find(serviceName);
+    if (lazyIt == mNameToLazyService.end()) return false;
+    return std::chrono::steady_clock::now() - service.lastClientTime <
+            lazyIt->second.policy.keepAlive;
+}
+
+void ServiceManager::recordLazyServiceDemand(LazyService* lazyService) {
+    if (lazyService->policy.prewarmDemand == 0) return;
+    (void)getRecentLazyServiceDemand(lazyService);
+    lazyService->demand.push_back(std::chrono::steady_clock::now());
+}
+
+size_t ServiceManager::getRecentLazyServiceDemand(LazyService* lazyService) {
+    const auto windowStart = std::chrono::steady_clock::now() - lazyService->policy.prewarmWindow;
+    while (!lazyService->demand.empty() && lazyService->demand.front() < windowStart) {
+        lazyService->demand.pop_front();
+    }
+    return lazyService->demand.size();
+}
+
+static bool parseLazyServicePolicyField(std::string_view field,
+                                        ServiceManager::LazyServicePolicy* policy) {
+    uint32_t seconds;
+    if (base::ConsumePrefix(&field, "keepalive=")) {
+        if (!base::ParseUint(std::string(field), &seconds)) return false;
+        policy->keepAlive = std::chrono::seconds(seconds);
+        return true;
+    }
+    if (base::ConsumePrefix(&field, "prewarm=")) {
+        std::vector<std::string> values = base::Split(std::string(field), "/");
+        if (values.size() != 2 || !base::ParseUint(values[0], &policy->prewarmDemand) ||
+            !base::ParseUint(values[1], &seconds)) {
+            return false;
+        }
+        policy->prewarmWindow = std::chrono::seconds(seconds);
+        return true;
+    }
+    return false;
+}
+
+std::optional<std::map<std::string, ServiceManager::LazyServicePolicy>>
+ServiceManager::parseLazyServicePolicies(const std::string& config) {
+    std::map<std::string, LazyServicePolicy> policies;
+    for (const std::string& rawLine : base::Split(config, "\n")) {
+        const std::string line = base::Trim(rawLine);
+        if (line.empty() || line[0] == '#') continue;
+
+        const std::vector<std::string> fields = base::Tokenize(line, " \t");
+        if (!isValidServiceName(fields[0])) {
+            ALOGE("Invalid service name in lazy service policy: %s", line.c_str());
+            return std::nullopt;
+        }
+        LazyServicePolicy policy;
+        for (size_t i = 1; i < fields.size(); i++) {
+            if (!parseLazyServicePolicyField(fields[i], &policy)) {
+                ALOGE("Invalid field '%s' in lazy service policy: %s", fields[i].c_str(),
+                      line.c_str());
+                return std::nullopt;
+            }
+        }
+        policies[fields[0]] = policy;
+    }
+    return policies;
+}
+
+void ServiceManager::setLazyServicePolicy(const std::string& name,
+                                          const LazyServicePolicy& policy) {
+    LazyService& lazyService = mNameToLazyService[name];
+    lazyService.policy = policy;
+    lazyService.demand.clear();
+}
+
 Status ServiceManager::tryUnregisterService(const std::string& name, const sp<IBinder>& binder) {
     SM_PERFETTO_TRACE_FUNC(PERFETTO_TE_PROTO_FIELDS(
             PERFETTO_TE_PROTO_FIELD_CSTR(kProtoServiceName, name.c_str())));
@@ -1110,6 +1246,20 @@ Status ServiceManager::tryUnregisterService(const std::string& name, const sp<IB
     ALOGI("%s Unregistering %s", ctx.toDebugString().c_str(), name.c_str());
     mNameToService.erase(name);
 
+    if (auto lazyIt = mNameToLazyService.find(name); lazyIt != mNameToLazyService.end()) {
+        LazyService& lazyService = lazyIt->second;
+        const LazyServicePolicy& policy = lazyService.policy;
+        const size_t demand = getRecentLazyServiceDemand(&lazyService);
+        if (policy.prewarmDemand > 0 && demand >= policy.prewarmDemand) {
+            ALOGI("Prewarming %s, which was asked for %zu times in the last %lldms", name.c_str(),
+                  demand, static_cast<long long>(policy.prewarmWindow.count()));
+            lazyService.starting = true;
+            lazyService.prewarming = true;
+            lazyService.prewarms++;
+            tryStartService(ctx, name);
+        }
+    }
+
     return Status::ok();
 }
 
@@ -1165,6 +1315,36 @@ Status ServiceManager::getServiceDebugInfo(std::vector<ServiceDebugInfo>* outRet
     return Status::ok();
 }
 
+status_t ServiceManager::dump(int fd, const Vector<String16>& /*args*/) {
+    if (!mAccess->canList(mAccess->getCallingContext())) {
+        return PERMISSION_DENIED;
+    }
+
+    const Access::CacheStats stats = mAccess->getCacheStats();
+    const uint64_t lookups = stats.hits + stats.misses;
+    const std::string out = base::StringPrintf(
+            "SELinux access cache: %zu allowed decisions, %" PRIu64 " hits, %" PRIu64
+            " misses (%.1f%% hit rate), %" PRIu64 " invalidations\n",
+            stats.size, stats.hits, stats.misses,
+            lookups > 0 ? 100.0 * stats.hits / lookups : 0.0, stats.invalidations);
+    std::string lazyServices;
+    for (const auto& [name, lazyService] : mNameToLazyService) {
+        base::StringAppendF(&lazyServices,
+                            "Lazy service %s: keep-alive %lldms, prewarm on %zu demand in %lldms, "
+                            "%zu cold starts, %zu prewarms, %zu cold starts avoided\n",
+                            name.c_str(),
+                            static_cast<long long>(lazyService.policy.keepAlive.count()),
+                            lazyService.policy.prewarmDemand,
+                            static_cast<long long>(lazyService.policy.prewarmWindow.count()),
+                            lazyService.coldStarts, lazyService.prewarms,
+                            lazyService.avoidedColdStarts);
+    }
+    if (!base::WriteStringToFd(out + lazyServices, fd)) {
+        return -errno;
+    }
+    return OK;
+}
+
 void ServiceManager::clear() {
     mNameToService.clear();
     mNameToRegistrationCallback.clear();
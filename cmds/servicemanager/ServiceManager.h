@@ -24,6 +24,11 @@
 #include "perfetto/public/te_category_macros.h"
 #endif // !defined(VENDORSERVICEMANAGER) && !defined(__ANDROID_RECOVERY__)
 
+#include <chrono>
+#include <deque>
+#include <map>
+#include <optional>
+
 #include "Access.h"
 
 namespace android {
@@ -46,6 +51,8 @@ public:
     // getService will try to start any services it cannot find
     binder::Status getService(const std::string& name, sp<IBinder>* outBinder) override;
     binder::Status getService2(const std::string& name, os::Service* outService) override;
+    binder::Status getServices(const std::vector<std::string>& names,
+                               std::vector<os::Service>* outServices) override;
     binder::Status checkService(const std::string& name, os::Service* outService) override;
     binder::Status addService(const std::string& name, const sp<IBinder>& binder,
                               bool allowIsolated, int32_t dumpPriority) override;
@@ -68,6 +75,8 @@ public:
     binder::Status tryUnregisterService(const std::string& name, const sp<IBinder>& binder) override;
     binder::Status getServiceDebugInfo(std::vector<ServiceDebugInfo>* outReturn) override;
     void binderDied(const wp<IBinder>& who) override;
+    // Prints the stats of the SELinux access cache.
+    status_t dump(int fd, const Vector<String16>& args) override;
     void handleClientCallbacks();
 
     /**
@@ -76,6 +85,26 @@ public:
      */
     void clear();
 
+    // How a lazy service is treated once it has no clients.
+    struct LazyServicePolicy {
+        // How long the service is told that it still has clients after its last one went away,
+        // and after it registered, so that a client which comes back soon does not have to wait
+        // for it to be started again.
+        std::chrono::milliseconds keepAlive{0};
+        // When the service shuts down after it was asked for while not running, or while it was
+        // only running because of this policy, at least |prewarmDemand| times in the last
+        // |prewarmWindow|, it is started again right away. Disabled if 0.
+        size_t prewarmDemand = 0;
+        std::chrono::milliseconds prewarmWindow{0};
+    };
+
+    // Parses one policy per line, as "<service name> [keepalive=<seconds>]
+    // [prewarm=<demand>/<seconds>]". Empty lines and lines starting with '#' are skipped.
+    // Returns std::nullopt if any line is malformed.
+    static std::optional<std::map<std::string, LazyServicePolicy>> parseLazyServicePolicies(
+            const std::string& config);
+    void setLazyServicePolicy(const std::string& name, const LazyServicePolicy& policy);
+
 protected:
     virtual void tryStartService(const Access::CallingContext& ctx, const std::string& name);
 
@@ -87,6 +116,10 @@ private:
         bool hasClients = false; // notifications sent on true -> false.
         bool guaranteeClient = false; // forces the client check to true
         Access::CallingContext ctx;   // process that originally registers this
+        // when the service registered or was last seen with a client
+        std::chrono::steady_clock::time_point lastClientTime;
+        // whether the service is only running because of its LazyServicePolicy
+        bool keptByPolicy = false;
 
         // the number of clients of the service, including servicemanager itself
         ssize_t getNodeStrongRefCount();
@@ -98,6 +131,19 @@ private:
     using ClientCallbackMap = std::map<std::string, std::vector<sp<IClientCallback>>>;
     using ServiceMap = std::map<std::string, Service>;
 
+    struct LazyService {
+        LazyServicePolicy policy;
+        // the times at which the service was asked for while it was not running, or while it was
+        // only running because of the policy, within the prewarm window
+        std::deque<std::chrono::steady_clock::time_point> demand;
+        // whether the service was started, and has not registered yet
+        bool starting = false;
+        bool prewarming = false;
+        size_t coldStarts = 0;
+        size_t prewarms = 0;
+        size_t avoidedColdStarts = 0;
+    };
+
     // removes a callback from mNameToRegistrationCallback, removing it if the vector is empty
     // this updates iterator to the next location
     void removeRegistrationCallback(const wp<IBinder>& who,
@@ -112,9 +158,18 @@ private:
     // removes a callback from mNameToClientCallback, deleting the entry if the vector is empty
     // this updates the iterator to the next location
     void removeClientCallback(const wp<IBinder>& who, ClientCallbackMap::iterator* it);
-
-    os::Service tryGetService(const std::string& name, bool startIfNotFound);
-    sp<IBinder> tryGetBinder(const std::string& name, bool startIfNotFound);
+    // whether the policy of the service keeps it running although it has no clients
+    bool isKeptAliveByPolicy(const std::string& serviceName, const Service& service) const;
+    // records that a client asked for the service, which was not running or only running because
+    // of its policy
+    static void recordLazyServiceDemand(LazyService* lazyService);
+    // drops the demand from before the prewarm window, and returns how much is left
+    static size_t getRecentLazyServiceDemand(LazyService* lazyService);
+
+    os::Service tryGetService(const Access::CallingContext& ctx, const std::string& name,
+                              bool startIfNotFound);
+    sp<IBinder> tryGetBinder(const Access::CallingContext& ctx, const std::string& name,
+                             bool startIfNotFound);
     binder::Status canAddService(const Access::CallingContext& ctx, const std::string& name,
                                  std::optional<std::string>* accessor);
     binder::Status canFindService(const Access::CallingContext& ctx, const std::string& name,
@@ -123,6 +178,7 @@ private:
     ServiceMap mNameToService;
     ServiceCallbackMap mNameToRegistrationCallback;
     ClientCallbackMap mNameToClientCallback;
+    std::map<std::string, LazyService> mNameToLazyService;
 
     std::unique_ptr<Access> mAccess;
 };
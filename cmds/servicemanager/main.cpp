@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/properties.h>
 #include <binder/IPCThreadState.h>
@@ -56,6 +57,27 @@ using ::android::sp;
 using ::android::base::SetProperty;
 using ::android::os::IServiceManager;
 
+#ifdef VENDORSERVICEMANAGER
+constexpr char kLazyServicePolicyPath[] = "/vendor/etc/vndservicemanager/lazy_services.conf";
+#else
+constexpr char kLazyServicePolicyPath[] = "/system/etc/servicemanager/lazy_services.conf";
+#endif
+
+// Applies the keep-alive and prewarm policies of lazy services, if the device has any.
+static void loadLazyServicePolicies(const sp<ServiceManager>& manager) {
+    std::string config;
+    if (!android::base::ReadFileToString(kLazyServicePolicyPath, &config)) return;
+
+    auto policies = ServiceManager::parseLazyServicePolicies(config);
+    if (!policies) {
+        LOG(ERROR) << "Ignoring malformed lazy service policies in " << kLazyServicePolicyPath;
+        return;
+    }
+    for (const auto& [name, policy] : *policies) {
+        manager->setLazyServicePolicy(name, policy);
+    }
+}
+
 class BinderCallback : public LooperCallback {
 public:
     static sp<BinderCallback> setupTo(const sp<Looper>& looper) {
@@ -168,6 +190,7 @@ int main(int argc, char** argv) {
     if (!manager->addService("manager", manager, false /*allowIsolated*/, IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk()) {
         LOG(ERROR) << "Could not self register servicemanager";
     }
+    loadLazyServicePolicies(manager);
 
     IPCThreadState::self()->setTheContextObject(manager);
     if (!ps->becomeContextManager()) {
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <android-base/file.h>
 #include <android-base/properties.h>
 #include <android-base/strings.h>
 #include <android/os/BnServiceCallback.h>
@@ -233,6 +234,49 @@ TEST(GetService, NoPermissionsForGettingService) {
     EXPECT_EQ(nullptr, outBinder);
 }
 
+TEST(GetServices, ReturnsEachInOrder) {
+    auto sm = getPermissiveServiceManager();
+
+    sp<IBinder> serviceA = getBinder();
+    sp<IBinder> serviceB = getBinder();
+    EXPECT_TRUE(sm->addService("foo", serviceA, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+    EXPECT_TRUE(sm->addService("bar", serviceB, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+
+    std::vector<Service> out;
+    EXPECT_TRUE(sm->getServices({"bar", "missing", "foo"}, &out).isOk());
+    ASSERT_EQ(3u, out.size());
+    EXPECT_EQ(serviceB, out[0].get<Service::Tag::binder>());
+    EXPECT_EQ(nullptr, out[1].get<Service::Tag::binder>());
+    EXPECT_EQ(serviceA, out[2].get<Service::Tag::binder>());
+}
+
+TEST(GetServices, ChecksEachService) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    // One lookup of the calling context for adding each service, and one for getServices.
+    EXPECT_CALL(*access, getCallingContext()).Times(3).WillRepeatedly(
+            Return(Access::CallingContext{}));
+    EXPECT_CALL(*access, canAdd(_, _)).WillRepeatedly(Return(true));
+    EXPECT_CALL(*access, canFind(_, "foo")).WillRepeatedly(Return(false));
+    EXPECT_CALL(*access, canFind(_, "bar")).WillRepeatedly(Return(true));
+
+    sp<ServiceManager> sm = sp<NiceMock<MockServiceManager>>::make(std::move(access));
+
+    sp<IBinder> serviceB = getBinder();
+    EXPECT_TRUE(sm->addService("foo", getBinder(), false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+    EXPECT_TRUE(sm->addService("bar", serviceB, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+
+    std::vector<Service> out;
+    EXPECT_TRUE(sm->getServices({"foo", "bar"}, &out).isOk());
+    ASSERT_EQ(2u, out.size());
+    EXPECT_EQ(nullptr, out[0].get<Service::Tag::binder>());
+    EXPECT_EQ(serviceB, out[1].get<Service::Tag::binder>());
+}
+
 TEST(GetService, AllowedFromIsolated) {
     std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
 
@@ -295,6 +339,54 @@ TEST(GetService, NotAllowedFromIsolated) {
     EXPECT_EQ(nullptr, outBinder);
 }
 
+TEST(Dump, AccessCacheStats) {
+    auto sm = getPermissiveServiceManager();
+
+    android::base::TemporaryFile file;
+    EXPECT_EQ(android::OK, sm->dump(file.fd, {}));
+
+    std::string out;
+    ASSERT_TRUE(android::base::ReadFileToString(file.path, &out));
+    EXPECT_TRUE(StartsWith(out, "SELinux access cache: ")) << out;
+}
+
+TEST(Dump, LazyServiceColdStarts) {
+    auto sm = getPermissiveServiceManager();
+    sm->setLazyServicePolicy("foo", {.keepAlive = std::chrono::seconds(30)});
+
+    // Asking again while the service starts is the same cold start.
+    sp<IBinder> outBinder;
+    EXPECT_TRUE(sm->getService("foo", &outBinder).isOk());
+    EXPECT_TRUE(sm->getService("foo", &outBinder).isOk());
+    EXPECT_EQ(nullptr, outBinder);
+    EXPECT_TRUE(sm->addService("foo", getBinder(), false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+    EXPECT_TRUE(sm->getService("foo", &outBinder).isOk());
+    EXPECT_NE(nullptr, outBinder);
+
+    android::base::TemporaryFile file;
+    EXPECT_EQ(android::OK, sm->dump(file.fd, {}));
+
+    std::string out;
+    ASSERT_TRUE(android::base::ReadFileToString(file.path, &out));
+    EXPECT_NE(std::string::npos,
+              out.find("Lazy service foo: keep-alive 30000ms, prewarm on 0 demand in 0ms, "
+                       "1 cold starts, 0 prewarms, 0 cold starts avoided\n"))
+            << out;
+}
+
+TEST(Dump, NoPermissions) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    EXPECT_CALL(*access, getCallingContext()).WillOnce(Return(Access::CallingContext{}));
+    EXPECT_CALL(*access, canList(_)).WillOnce(Return(false));
+
+    sp<ServiceManager> sm = sp<NiceMock<MockServiceManager>>::make(std::move(access));
+
+    android::base::TemporaryFile file;
+    EXPECT_EQ(android::PERMISSION_DENIED, sm->dump(file.fd, {}));
+}
+
 TEST(ListServices, NoPermissions) {
     std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
 
@@ -564,3 +656,33 @@ TEST(ServiceNotifications, GetMultipleNotification) {
     EXPECT_THAT(cb->registrations, ElementsAre("asdfasdf", "asdfasdf"));
     EXPECT_THAT(cb->registrations, ElementsAre("asdfasdf", "asdfasdf"));
 }
+
+TEST(LazyServicePolicy, Parse) {
+    auto policies = ServiceManager::parseLazyServicePolicies(
+            "# camera\n"
+            "android.hardware.camera.provider.ICameraProvider/internal/0 keepalive=60\n"
+            "\n"
+            "  drm  keepalive=10 prewarm=3/600  \n"
+            "media\n");
+    ASSERT_TRUE(policies.has_value());
+    ASSERT_EQ(3u, policies->size());
+
+    const auto& camera = policies->at("android.hardware.camera.provider.ICameraProvider/internal/0");
+    EXPECT_EQ(std::chrono::seconds(60), camera.keepAlive);
+    EXPECT_EQ(0u, camera.prewarmDemand);
+
+    const auto& drm = policies->at("drm");
+    EXPECT_EQ(std::chrono::seconds(10), drm.keepAlive);
+    EXPECT_EQ(3u, drm.prewarmDemand);
+    EXPECT_EQ(std::chrono::seconds(600), drm.prewarmWindow);
+
+    EXPECT_EQ(std::chrono::seconds(0), policies->at("media").keepAlive);
+}
+
+TEST(LazyServicePolicy, ParseMalformed) {
+    EXPECT_FALSE(ServiceManager::parseLazyServicePolicies("foo keepalive=-1").has_value());
+    EXPECT_FALSE(ServiceManager::parseLazyServicePolicies("foo prewarm=3").has_value());
+    EXPECT_FALSE(ServiceManager::parseLazyServicePolicies("foo prewarm=3/a").has_value());
+    EXPECT_FALSE(ServiceManager::parseLazyServicePolicies("foo linger=5").has_value());
+    EXPECT_FALSE(ServiceManager::parseLazyServicePolicies("foo$bar keepalive=5").has_value());
+}
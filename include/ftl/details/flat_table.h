@@ -0,0 +1,508 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace android::ftl::details {
+
+// Every slot of a FlatTable has a control byte, which holds 7 bits of the hash of the key if the
+// slot is full, and has its high bit set otherwise.
+using Ctrl = std::uint8_t;
+
+constexpr Ctrl kEmptyCtrl = 0x80;
+constexpr Ctrl kDeletedCtrl = 0xfe;
+
+constexpr bool is_full(Ctrl ctrl) {
+  return (ctrl & 0x80) == 0;
+}
+
+// The slots of a group that matched a query, with 2^Shift bits per slot.
+template <int Shift>
+class GroupMask {
+ public:
+  constexpr explicit GroupMask(std::uint64_t bits) : bits_(bits) {}
+
+  constexpr explicit operator bool() const { return bits_ != 0; }
+
+  constexpr std::size_t lowest() const {
+    return static_cast<std::size_t>(std::countr_zero(bits_)) >> Shift;
+  }
+
+  constexpr void clear_lowest() { bits_ &= bits_ - 1; }
+
+ private:
+  std::uint64_t bits_;
+};
+
+#if defined(__SSE2__) && !defined(__aarch64__)
+
+// Matches 16 control bytes at once.
+class Group {
+ public:
+  static constexpr std::size_t kWidth = 16;
+  using Mask = GroupMask<0>;
+
+  explicit Group(const Ctrl* ctrl)
+      : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+  Mask match(Ctrl h2) const {
+    const __m128i equal = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(h2)), ctrl_);
+    return Mask(static_cast<std::uint32_t>(_mm_movemask_epi8(equal)));
+  }
+
+  Mask match_empty() const { return match(kEmptyCtrl); }
+
+  Mask match_empty_or_deleted() const {
+    return Mask(static_cast<std::uint32_t>(_mm_movemask_epi8(ctrl_)));
+  }
+
+ private:
+  __m128i ctrl_;
+};
+
+#else
+
+// Matches 8 control bytes at once, with NEON or within a 64-bit word.
+class Group {
+ public:
+  static constexpr std::size_t kWidth = 8;
+  using Mask = GroupMask<3>;
+
+  explicit Group(const Ctrl* ctrl) { std::memcpy(&ctrl_, ctrl, sizeof(ctrl_)); }
+
+  Mask match(Ctrl h2) const {
+#if defined(__aarch64__)
+    const uint8x8_t equal = vceq_u8(vcreate_u8(ctrl_), vdup_n_u8(h2));
+    return Mask(vget_lane_u64(vreinterpret_u64_u8(equal), 0) & kMsbs);
+#else
+    // A borrow may cause a false positive, but only above a true match, and only for a full slot,
+    // whose key is then compared.
+    const std::uint64_t x = ctrl_ ^ (kLsbs * h2);
+    return Mask((x - kLsbs) & ~x & kMsbs);
+#endif
+  }
+
+  Mask match_empty() const { return match(kEmptyCtrl); }
+
+  Mask match_empty_or_deleted() const { return Mask(ctrl_ & kMsbs); }
+
+ private:
+  static constexpr std::uint64_t kLsbs = 0x0101010101010101;
+  static constexpr std::uint64_t kMsbs = 0x8080808080808080;
+
+  std::uint64_t ctrl_;
+};
+
+#endif
+
+// Open-addressing hash table backing FlatMap and FlatSet, whose values of type T are keyed by
+// KeyOf. The slots are split into groups of control bytes that are matched at once, and probed in
+// triangular order from the group selected by the hash.
+//
+// Up to N values are stored inline. If N is at most kMaxLinearCapacity, the inline slots are kept
+// dense and searched linearly without hashing, which is faster at that size. Either way, the table
+// is rehashed into dynamic memory once it outgrows its inline slots.
+//
+template <typename T, std::size_t N, typename Hash, typename KeyEqual, typename KeyOf>
+class FlatTable {
+  static_assert(N > 0, "FlatTable must have inline slots");
+
+ public:
+  using key_type = std::remove_cvref_t<decltype(KeyOf{}(std::declval<const T&>()))>;
+
+  static constexpr std::size_t kMaxLinearCapacity = 8;
+  static constexpr bool kLinear = N <= kMaxLinearCapacity;
+
+  template <typename U>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::remove_const_t<U>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = U*;
+    using reference = U&;
+
+    Iterator() = default;
+
+    template <typename W, typename = std::enable_if_t<std::is_convertible_v<W*, U*>>>
+    Iterator(const Iterator<W>& other) : ctrl_(other.ctrl_), end_(other.end_), slot_(other.slot_) {}
+
+    reference operator*() const { return *slot_; }
+    pointer operator->() const { return slot_; }
+
+    Iterator& operator++() {
+      ++ctrl_;
+      ++slot_;
+      skip_free();
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator previous = *this;
+      ++*this;
+      return previous;
+    }
+
+    bool operator==(const Iterator& other) const { return ctrl_ == other.ctrl_; }
+    bool operator!=(const Iterator& other) const { return ctrl_ != other.ctrl_; }
+
+   private:
+    friend class FlatTable;
+
+    template <typename>
+    friend class Iterator;
+
+    Iterator(const Ctrl* ctrl, const Ctrl* end, U* slot) : ctrl_(ctrl), end_(end), slot_(slot) {
+      skip_free();
+    }
+
+    void skip_free() {
+      while (ctrl_ != end_ && !is_full(*ctrl_)) {
+        ++ctrl_;
+        ++slot_;
+      }
+    }
+
+    const Ctrl* ctrl_ = nullptr;
+    const Ctrl* end_ = nullptr;
+    U* slot_ = nullptr;
+  };
+
+  using iterator = Iterator<T>;
+  using const_iterator = Iterator<const T>;
+
+  FlatTable() { reset_inline(); }
+
+  FlatTable(const FlatTable& other) : FlatTable() { copy_from(other); }
+
+  FlatTable(FlatTable&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : FlatTable() {
+    move_from(other);
+  }
+
+  FlatTable& operator=(const FlatTable& other) {
+    if (this != &other) {
+      release();
+      copy_from(other);
+    }
+    return *this;
+  }
+
+  FlatTable& operator=(FlatTable&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other) {
+      release();
+      move_from(other);
+    }
+    return *this;
+  }
+
+  ~FlatTable() { release(); }
+
+  std::size_t size() const { return size_; }
+  bool dynamic() const { return !is_inline(); }
+
+  iterator begin() { return {ctrl_, ctrl_ + capacity_, slots_}; }
+  const_iterator begin() const { return {ctrl_, ctrl_ + capacity_, slots_}; }
+
+  iterator end() { return {ctrl_ + capacity_, ctrl_ + capacity_, slots_ + capacity_}; }
+  const_iterator end() const { return {ctrl_ + capacity_, ctrl_ + capacity_, slots_ + capacity_}; }
+
+  const_iterator find(const key_type& key) const {
+    return const_cast<FlatTable&>(*this).find(key);
+  }
+
+  iterator find(const key_type& key) {
+    const std::size_t index = find_index(key);
+    return index == kNotFound ? end() : iterator_at(index);
+  }
+
+  // Constructs a value for the key from the arguments, unless the key already has one. The
+  // arguments must not refer to values in the table, which may be moved before construction.
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+    if (const std::size_t index = find_index(key); index != kNotFound) {
+      return {iterator_at(index), false};
+    }
+    const std::size_t index = prepare_insert(key);
+    std::construct_at(slots_ + index, std::forward<Args>(args)...);
+    return {iterator_at(index), true};
+  }
+
+  // Replaces the value of the iterator with one constructed from the arguments, which may refer to
+  // the replaced value. The key of the new value must be the same.
+  template <typename... Args>
+  void replace(iterator it, Args&&... args) {
+    T value(std::forward<Args>(args)...);
+    T* const slot = const_cast<T*>(it.slot_);
+    std::destroy_at(slot);
+    std::construct_at(slot, std::move(value));
+  }
+
+  bool erase(const key_type& key) {
+    const std::size_t index = find_index(key);
+    if (index == kNotFound) return false;
+    erase_at(index);
+    return true;
+  }
+
+  void clear() {
+    destroy_values();
+    std::fill_n(ctrl_, capacity_, kEmptyCtrl);
+    size_ = 0;
+    growth_left_ = max_load(capacity_);
+  }
+
+ private:
+  static constexpr std::size_t kNotFound = static_cast<std::size_t>(-1);
+
+  // The number of values a table can store before it is rehashed, which leaves enough empty slots
+  // for probes to end early.
+  static constexpr std::size_t max_load(std::size_t capacity) { return capacity - capacity / 8; }
+
+  static constexpr std::size_t capacity_for(std::size_t size) {
+    std::size_t capacity = Group::kWidth;
+    while (max_load(capacity) < size) capacity *= 2;
+    return capacity;
+  }
+
+  static constexpr std::size_t kInlineCapacity = kLinear ? N : capacity_for(N);
+
+  // Visits every group in triangular order, since the number of groups is a power of two.
+  class Probe {
+   public:
+    Probe(std::size_t hash, std::size_t mask) : mask_(mask), group_(hash & mask) {}
+
+    std::size_t offset() const { return group_ * Group::kWidth; }
+
+    void next() { group_ = (group_ + ++step_) & mask_; }
+
+   private:
+    const std::size_t mask_;
+    std::size_t group_;
+    std::size_t step_ = 0;
+  };
+
+  // Returns the hash that selects the first group to probe, and the 7 bits for the control byte.
+  // The hash is mixed first, given that std::hash is the identity for integers.
+  static std::pair<std::size_t, Ctrl> hash(const key_type& key) {
+    std::uint64_t hash = static_cast<std::uint64_t>(Hash{}(key)) * 0x9e3779b97f4a7c15;
+    hash ^= hash >> 32;
+    return {static_cast<std::size_t>(hash >> 7), static_cast<Ctrl>(hash & 0x7f)};
+  }
+
+  bool is_inline() const { return ctrl_ == inline_ctrl_.data(); }
+  bool is_linear() const { return kLinear && is_inline(); }
+
+  T* inline_slots() { return reinterpret_cast<T*>(inline_storage_); }
+
+  std::size_t group_mask() const { return capacity_ / Group::kWidth - 1; }
+
+  iterator iterator_at(std::size_t index) {
+    return {ctrl_ + index, ctrl_ + capacity_, slots_ + index};
+  }
+
+  std::size_t find_index(const key_type& key) const {
+    if (is_linear()) {
+      for (std::size_t i = 0; i < size_; i++) {
+        if (KeyEqual{}(KeyOf{}(slots_[i]), key)) return i;
+      }
+      return kNotFound;
+    }
+
+    const auto [h1, h2] = hash(key);
+    for (Probe probe(h1, group_mask());; probe.next()) {
+      const Group group(ctrl_ + probe.offset());
+      for (auto match = group.match(h2); match; match.clear_lowest()) {
+        const std::size_t index = probe.offset() + match.lowest();
+        if (KeyEqual{}(KeyOf{}(slots_[index]), key)) return index;
+      }
+      if (group.match_empty()) return kNotFound;
+    }
+  }
+
+  std::size_t find_free(std::size_t h1) const {
+    for (Probe probe(h1, group_mask());; probe.next()) {
+      if (const auto free = Group(ctrl_ + probe.offset()).match_empty_or_deleted()) {
+        return probe.offset() + free.lowest();
+      }
+    }
+  }
+
+  // Claims a free slot for a key that the table does not have, rehashing first if the slot would
+  // leave too few empty ones.
+  std::size_t prepare_insert(const key_type& key) {
+    if (is_linear()) {
+      if (size_ < N) {
+        ctrl_[size_] = 0;
+        return size_++;
+      }
+      rehash(capacity_for(size_ + 1));
+    }
+
+    const auto [h1, h2] = hash(key);
+    std::size_t index = find_free(h1);
+    if (growth_left_ == 0 && ctrl_[index] == kEmptyCtrl) {
+      // Mostly deleted slots are reclaimed without growing, unless the slots are inline.
+      const bool reclaim = !is_inline() && size_ < max_load(capacity_) / 2;
+      rehash(reclaim ? capacity_ : capacity_ * 2);
+      index = find_free(h1);
+    }
+
+    if (ctrl_[index] == kEmptyCtrl) growth_left_--;
+    ctrl_[index] = h2;
+    size_++;
+    return index;
+  }
+
+  void erase_at(std::size_t index) {
+    std::destroy_at(slots_ + index);
+    size_--;
+
+    if (is_linear()) {
+      if (index != size_) {
+        std::construct_at(slots_ + index, std::move(slots_[size_]));
+        std::destroy_at(slots_ + size_);
+      }
+      ctrl_[size_] = kEmptyCtrl;
+      return;
+    }
+
+    // Probes for other keys would have ended at this group anyway if it has an empty slot.
+    if (Group(ctrl_ + (index & ~(Group::kWidth - 1))).match_empty()) {
+      ctrl_[index] = kEmptyCtrl;
+      growth_left_++;
+    } else {
+      ctrl_[index] = kDeletedCtrl;
+    }
+  }
+
+  void rehash(std::size_t capacity) {
+    Ctrl* const old_ctrl = ctrl_;
+    T* const old_slots = slots_;
+    const std::size_t old_capacity = capacity_;
+    const bool was_inline = is_inline();
+
+    allocate(capacity);
+    growth_left_ = max_load(capacity) - size_;
+
+    for (std::size_t i = 0; i < old_capacity; i++) {
+      if (!is_full(old_ctrl[i])) continue;
+
+      T& value = old_slots[i];
+      const auto [h1, h2] = hash(KeyOf{}(value));
+      const std::size_t index = find_free(h1);
+      ctrl_[index] = h2;
+      std::construct_at(slots_ + index, std::move(value));
+      std::destroy_at(&value);
+    }
+
+    if (!was_inline) deallocate(old_ctrl, old_slots, old_capacity);
+  }
+
+  void allocate(std::size_t capacity) {
+    ctrl_ = new Ctrl[capacity];
+    slots_ = std::allocator<T>().allocate(capacity);
+    capacity_ = capacity;
+    std::fill_n(ctrl_, capacity, kEmptyCtrl);
+  }
+
+  static void deallocate(Ctrl* ctrl, T* slots, std::size_t capacity) {
+    delete[] ctrl;
+    std::allocator<T>().deallocate(slots, capacity);
+  }
+
+  void reset_inline() {
+    ctrl_ = inline_ctrl_.data();
+    slots_ = inline_slots();
+    capacity_ = kInlineCapacity;
+    size_ = 0;
+    growth_left_ = max_load(kInlineCapacity);
+    inline_ctrl_.fill(kEmptyCtrl);
+  }
+
+  void destroy_values() {
+    for (std::size_t i = 0; i < capacity_; i++) {
+      if (is_full(ctrl_[i])) std::destroy_at(slots_ + i);
+    }
+  }
+
+  void release() {
+    destroy_values();
+    if (!is_inline()) deallocate(ctrl_, slots_, capacity_);
+    reset_inline();
+  }
+
+  // Copies the slots as they are, so that the values need not be hashed again. The table must be
+  // empty and inline.
+  void copy_from(const FlatTable& other) {
+    if (!other.is_inline()) allocate(other.capacity_);
+    std::copy_n(other.ctrl_, capacity_, ctrl_);
+    for (std::size_t i = 0; i < capacity_; i++) {
+      if (is_full(ctrl_[i])) std::construct_at(slots_ + i, other.slots_[i]);
+    }
+    size_ = other.size_;
+    growth_left_ = other.growth_left_;
+  }
+
+  // Takes over the dynamic memory of the other table, or moves its inline slots as they are. The
+  // table must be empty and inline.
+  void move_from(FlatTable& other) {
+    if (!other.is_inline()) {
+      ctrl_ = other.ctrl_;
+      slots_ = other.slots_;
+      capacity_ = other.capacity_;
+      size_ = other.size_;
+      growth_left_ = other.growth_left_;
+      other.reset_inline();
+      return;
+    }
+
+    std::copy_n(other.ctrl_, capacity_, ctrl_);
+    for (std::size_t i = 0; i < capacity_; i++) {
+      if (is_full(ctrl_[i])) std::construct_at(slots_ + i, std::move(other.slots_[i]));
+    }
+    size_ = other.size_;
+    growth_left_ = other.growth_left_;
+    other.clear();
+  }
+
+  Ctrl* ctrl_;
+  T* slots_;
+  std::size_t capacity_;
+  std::size_t size_;
+  std::size_t growth_left_;
+
+  std::array<Ctrl, kInlineCapacity> inline_ctrl_;
+  alignas(T) std::byte inline_storage_[kInlineCapacity * sizeof(T)];
+};
+
+}  // namespace android::ftl::details
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ftl/details/flat_table.h>
+#include <ftl/optional.h>
+
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <utility>
+
+namespace android::ftl {
+
+// Associative container with unique, unordered keys, and the hashed counterpart of SmallMap. Like
+// SmallMap, key-value pairs are stored inline until the size exceeds N, at which point they are
+// relocated to dynamic memory, and lookup is done via immutable getters rather than a subscript
+// operator. Unlike SmallMap, lookup does not degrade linearly with size: pairs are stored in an
+// open-addressing table whose control bytes are probed a group at a time, with SIMD if available.
+//
+// Whether the inline pairs are searched linearly or hashed is decided at compile time from N. Up to
+// FlatMap::kMaxLinearCapacity, searching linearly without hashing is faster, so FlatMap behaves
+// like SmallMap until it becomes dynamic. Beyond that, the inline pairs are hashed as well.
+//
+// Pairs are relocated on rehash, which invalidates all iterators, so emplacing a pair invalidates
+// all iterators. Erasing a pair only invalidates iterators to it while the map is dynamic, but may
+// relocate the last pair while the map is searched linearly.
+//
+// Example usage:
+//
+//   ftl::FlatMap<int, std::string, 32> map;
+//   assert(map.empty());
+//   assert(!map.dynamic());
+//
+//   map.try_emplace(123, "abc");
+//   map.try_emplace(42, 3u, '?');
+//   assert(map.size() == 2u);
+//
+//   assert(map.contains(123));
+//   assert(map.get(42).transform([](const std::string& s) { return s.size(); }) == 3u);
+//
+//   map.emplace_or_replace(42, "xyz");
+//   assert(map.get(42)->get() == "xyz");
+//
+//   assert(map.erase(123));
+//   assert(!map.contains(123));
+//
+template <typename K, typename V, std::size_t N, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>>
+class FlatMap final {
+  struct KeyOf {
+    const K& operator()(const std::pair<const K, V>& pair) const { return pair.first; }
+  };
+
+  using Table = details::FlatTable<std::pair<const K, V>, N, Hash, KeyEqual, KeyOf>;
+
+ public:
+  using key_type = K;
+  using mapped_type = V;
+
+  using value_type = std::pair<const K, V>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using reference = value_type&;
+  using iterator = typename Table::iterator;
+
+  using const_reference = const value_type&;
+  using const_iterator = typename Table::const_iterator;
+
+  static constexpr std::size_t kMaxLinearCapacity = Table::kMaxLinearCapacity;
+
+  // Creates an empty map.
+  FlatMap() = default;
+
+  static constexpr size_type static_capacity() { return N; }
+
+  // Returns whether the inline pairs are searched linearly rather than hashed.
+  static constexpr bool linear() { return Table::kLinear; }
+
+  size_type size() const { return table_.size(); }
+  bool empty() const { return size() == 0; }
+
+  // Returns whether the map is backed by static or dynamic storage.
+  bool dynamic() const { return table_.dynamic(); }
+
+  iterator begin() { return table_.begin(); }
+  const_iterator begin() const { return cbegin(); }
+  const_iterator cbegin() const { return table_.begin(); }
+
+  iterator end() { return table_.end(); }
+  const_iterator end() const { return cend(); }
+  const_iterator cend() const { return table_.end(); }
+
+  // Returns whether a mapping exists for the given key.
+  bool contains(const key_type& key) const { return find(key) != end(); }
+
+  // Returns a reference to the value for the given key, or std::nullopt if the key was not found.
+  auto get(const key_type& key) const -> Optional<std::reference_wrapper<const mapped_type>> {
+    if (const auto it = find(key); it != end()) {
+      return std::cref(it->second);
+    }
+    return {};
+  }
+
+  auto get(const key_type& key) -> Optional<std::reference_wrapper<mapped_type>> {
+    if (const auto it = find(key); it != end()) {
+      return std::ref(it->second);
+    }
+    return {};
+  }
+
+  // Returns an iterator to an existing mapping for the given key, or the end() iterator otherwise.
+  const_iterator find(const key_type& key) const { return table_.find(key); }
+  iterator find(const key_type& key) { return table_.find(key); }
+
+  // Inserts a mapping unless it exists. Returns an iterator to the inserted or existing mapping,
+  // and whether the mapping was inserted.
+  //
+  // The arguments must not refer to values in the map, since the map may be rehashed first.
+  //
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+    return table_.try_emplace(key, std::piecewise_construct, std::forward_as_tuple(key),
+                              std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  // Replaces a mapping if it exists, and returns an iterator to it. Returns the end() iterator
+  // otherwise.
+  //
+  // The value is replaced via move constructor, so type V does not need to define copy/move
+  // assignment. The arguments may directly or indirectly refer to the mapping being replaced.
+  //
+  template <typename... Args>
+  iterator try_replace(const key_type& key, Args&&... args) {
+    const auto it = find(key);
+    if (it == end()) return it;
+    table_.replace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                   std::forward_as_tuple(std::forward<Args>(args)...));
+    return it;
+  }
+
+  // In-place counterpart of std::unordered_map's insert_or_assign. Returns true on emplace, or
+  // false on replace.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace_or_replace(const key_type& key, Args&&... args) {
+    if (const auto it = find(key); it != end()) {
+      table_.replace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                     std::forward_as_tuple(std::forward<Args>(args)...));
+      return {it, false};
+    }
+    return try_emplace(key, std::forward<Args>(args)...);
+  }
+
+  // Removes a mapping if it exists, and returns whether it did.
+  bool erase(const key_type& key) { return table_.erase(key); }
+
+  // Removes all mappings, but keeps the dynamic memory of the map, if any.
+  void clear() { table_.clear(); }
+
+ private:
+  Table table_;
+};
+
+// Returns whether the key-value pairs of two maps are equal.
+template <typename K, typename V, std::size_t N, std::size_t M, typename H, typename E>
+bool operator==(const FlatMap<K, V, N, H, E>& lhs, const FlatMap<K, V, M, H, E>& rhs) {
+  if (lhs.size() != rhs.size()) return false;
+
+  for (const auto& [k, v] : lhs) {
+    const auto& lv = v;
+    if (!rhs.get(k).transform([&lv](const V& rv) { return lv == rv; }).value_or(false)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace android::ftl
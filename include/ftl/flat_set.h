@@ -0,0 +1,115 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ftl/details/flat_table.h>
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace android::ftl {
+
+// Set of unique, unordered keys, stored like the keys of FlatMap: inline until the size exceeds N,
+// searched linearly if N is at most FlatSet::kMaxLinearCapacity, and hashed otherwise. Keys are
+// immutable, so only const iterators are provided. Iterators are invalidated like those of FlatMap.
+//
+// Example usage:
+//
+//   ftl::FlatSet<int, 16> set;
+//   assert(set.emplace(42).second);
+//   assert(!set.emplace(42).second);
+//
+//   assert(set.contains(42));
+//   assert(set.erase(42));
+//   assert(set.empty());
+//
+template <typename K, std::size_t N, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>>
+class FlatSet final {
+  struct KeyOf {
+    const K& operator()(const K& key) const { return key; }
+  };
+
+  using Table = details::FlatTable<K, N, Hash, KeyEqual, KeyOf>;
+
+ public:
+  using key_type = K;
+  using value_type = K;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using const_reference = const value_type&;
+  using const_iterator = typename Table::const_iterator;
+  using iterator = const_iterator;
+
+  static constexpr std::size_t kMaxLinearCapacity = Table::kMaxLinearCapacity;
+
+  // Creates an empty set.
+  FlatSet() = default;
+
+  static constexpr size_type static_capacity() { return N; }
+
+  // Returns whether the inline keys are searched linearly rather than hashed.
+  static constexpr bool linear() { return Table::kLinear; }
+
+  size_type size() const { return table_.size(); }
+  bool empty() const { return size() == 0; }
+
+  // Returns whether the set is backed by static or dynamic storage.
+  bool dynamic() const { return table_.dynamic(); }
+
+  const_iterator begin() const { return cbegin(); }
+  const_iterator cbegin() const { return table_.begin(); }
+
+  const_iterator end() const { return cend(); }
+  const_iterator cend() const { return table_.end(); }
+
+  bool contains(const key_type& key) const { return find(key) != end(); }
+
+  // Returns an iterator to the key, or the end() iterator if the set does not have it.
+  const_iterator find(const key_type& key) const { return table_.find(key); }
+
+  // Inserts the key unless the set has it. Returns an iterator to the inserted or existing key,
+  // and whether the key was inserted.
+  std::pair<const_iterator, bool> emplace(const key_type& key) {
+    return table_.try_emplace(key, key);
+  }
+
+  // Removes the key if the set has it, and returns whether it did.
+  bool erase(const key_type& key) { return table_.erase(key); }
+
+  // Removes all keys, but keeps the dynamic memory of the set, if any.
+  void clear() { table_.clear(); }
+
+ private:
+  Table table_;
+};
+
+// Returns whether two sets have the same keys.
+template <typename K, std::size_t N, std::size_t M, typename H, typename E>
+bool operator==(const FlatSet<K, N, H, E>& lhs, const FlatSet<K, M, H, E>& rhs) {
+  if (lhs.size() != rhs.size()) return false;
+
+  for (const auto& key : lhs) {
+    if (!rhs.contains(key)) return false;
+  }
+
+  return true;
+}
+
+}  // namespace android::ftl
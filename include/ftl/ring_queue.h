@@ -0,0 +1,312 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace android::ftl {
+namespace details {
+
+// The destructive interference size, given that libc++ does not define it.
+constexpr std::size_t kCacheLineSize = 64;
+
+// Lets a thread wait for the other side of a queue, without the other side making a futex call on
+// every push or pop when no thread is waiting.
+class QueueSignal {
+ public:
+  // Blocks until the predicate holds. The other side must call notify() after every change that
+  // may make it hold.
+  template <typename Predicate>
+  void wait_until(Predicate ready) {
+    while (!ready()) {
+      waiters_.fetch_add(1, std::memory_order_relaxed);
+      // Either notify() sees the waiter, or the predicate sees the change that preceded it.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const std::uint32_t epoch = epoch_.load(std::memory_order_relaxed);
+      if (!ready()) epoch_.wait(epoch, std::memory_order_relaxed);
+      waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  void notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) return;
+    epoch_.fetch_add(1, std::memory_order_relaxed);
+    epoch_.notify_all();
+  }
+
+ private:
+  std::atomic<std::uint32_t> epoch_ = 0;
+  std::atomic<std::uint32_t> waiters_ = 0;
+};
+
+template <typename T>
+struct alignas(T) RingStorage {
+  T* get() { return std::launder(reinterpret_cast<T*>(bytes)); }
+
+  std::byte bytes[sizeof(T)];
+};
+
+}  // namespace details
+
+// Fixed-capacity, lock-free FIFO queue for one producer thread and one consumer thread. Values are
+// stored in a ring of N slots allocated with the queue, so pushing never allocates. The producer
+// and consumer positions are on separate cache lines, and each side caches the position of the
+// other, so that it only reads the other's cache line when the ring looks full or empty.
+//
+// The try_ operations fail rather than block when the queue is full or empty, while push, emplace,
+// and pop wait for the other side.
+//
+// N must be a power of two.
+//
+// Example usage:
+//
+//   ftl::SpscQueue<int, 4> queue;
+//   assert(queue.try_push(1));
+//   assert(queue.try_emplace(2));
+//
+//   assert(queue.try_pop() == 1);
+//   assert(queue.pop() == 2);
+//   assert(!queue.try_pop());
+//
+template <typename T, std::size_t N>
+class SpscQueue final {
+  static_assert(std::has_single_bit(N), "Capacity must be a power of two");
+
+ public:
+  using value_type = T;
+
+  SpscQueue() = default;
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  ~SpscQueue() {
+    while (try_pop());
+  }
+
+  static constexpr std::size_t capacity() { return N; }
+
+  // The size is exact if the queue is quiescent, and a snapshot otherwise.
+  std::size_t size() const {
+    const std::size_t head = head_.load(std::memory_order_acquire);
+    return tail_.load(std::memory_order_acquire) - head;
+  }
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() == N; }
+
+  // Producer operations. The value is only constructed from the arguments if there is space, so
+  // they are left intact on failure.
+  template <typename... Args>
+  bool try_emplace(Args&&... args) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == N) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == N) return false;
+    }
+
+    std::construct_at(slots_[tail % N].get(), std::forward<Args>(args)...);
+    tail_.store(tail + 1, std::memory_order_release);
+    readable_.notify();
+    return true;
+  }
+
+  bool try_push(const T& value) { return try_emplace(value); }
+  bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+  template <typename... Args>
+  void emplace(Args&&... args) {
+    while (!try_emplace(std::forward<Args>(args)...)) {
+      writable_.wait_until([this] { return !full(); });
+    }
+  }
+
+  void push(const T& value) { emplace(value); }
+  void push(T&& value) { emplace(std::move(value)); }
+
+  // Consumer operations.
+  std::optional<T> try_pop() {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) return std::nullopt;
+    }
+
+    T* const slot = slots_[head % N].get();
+    std::optional<T> value(std::move(*slot));
+    std::destroy_at(slot);
+    head_.store(head + 1, std::memory_order_release);
+    writable_.notify();
+    return value;
+  }
+
+  T pop() {
+    for (;;) {
+      if (auto value = try_pop()) return std::move(*value);
+      readable_.wait_until([this] { return !empty(); });
+    }
+  }
+
+ private:
+  // Written by the consumer.
+  alignas(details::kCacheLineSize) std::atomic<std::size_t> head_ = 0;
+  std::size_t cached_tail_ = 0;
+
+  // Written by the producer.
+  alignas(details::kCacheLineSize) std::atomic<std::size_t> tail_ = 0;
+  std::size_t cached_head_ = 0;
+
+  alignas(details::kCacheLineSize) details::QueueSignal readable_;
+  details::QueueSignal writable_;
+
+  alignas(details::kCacheLineSize) std::array<details::RingStorage<T>, N> slots_;
+};
+
+// Fixed-capacity, lock-free FIFO queue for any number of producer threads and one consumer thread.
+// Like SpscQueue, values are stored in a ring of N slots allocated with the queue, and the try_
+// operations fail rather than block.
+//
+// Every slot has a sequence number, which tells producers whether it is free for their position
+// and the consumer whether it was published. Producers claim a position with a compare-exchange,
+// and then construct and publish the value, so the values of each producer are popped in the order
+// it pushed them. A position that was claimed but not yet published keeps later values from being
+// popped: try_pop fails, and pop waits, even though the queue is not empty().
+//
+// N must be a power of two.
+//
+template <typename T, std::size_t N>
+class MpscQueue final {
+  static_assert(std::has_single_bit(N), "Capacity must be a power of two");
+
+ public:
+  using value_type = T;
+
+  MpscQueue() {
+    for (std::size_t i = 0; i < N; i++) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  ~MpscQueue() {
+    while (try_pop());
+  }
+
+  static constexpr std::size_t capacity() { return N; }
+
+  // The size counts claimed positions, and is a snapshot unless the queue is quiescent.
+  std::size_t size() const {
+    const std::size_t head = head_.load(std::memory_order_acquire);
+    return tail_.load(std::memory_order_acquire) - head;
+  }
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() >= N; }
+
+  // Producer operations, which may be called concurrently. The value is only constructed from the
+  // arguments if there is space, so they are left intact on failure.
+  template <typename... Args>
+  bool try_emplace(Args&&... args) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[tail % N];
+      const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto lag = static_cast<std::ptrdiff_t>(sequence - tail);
+
+      if (lag == 0) {
+        if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+          std::construct_at(slot.storage.get(), std::forward<Args>(args)...);
+          slot.sequence.store(tail + 1, std::memory_order_release);
+          readable_.notify();
+          return true;
+        }
+      } else if (lag < 0) {
+        // The consumer has yet to pop the value from the previous lap.
+        return false;
+      } else {
+        tail = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool try_push(const T& value) { return try_emplace(value); }
+  bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+  template <typename... Args>
+  void emplace(Args&&... args) {
+    while (!try_emplace(std::forward<Args>(args)...)) {
+      writable_.wait_until([this] { return !full(); });
+    }
+  }
+
+  void push(const T& value) { emplace(value); }
+  void push(T&& value) { emplace(std::move(value)); }
+
+  // Consumer operations.
+  std::optional<T> try_pop() {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (!published(head)) return std::nullopt;
+
+    Slot& slot = slots_[head % N];
+    T* const value = slot.storage.get();
+    std::optional<T> result(std::move(*value));
+    std::destroy_at(value);
+    slot.sequence.store(head + N, std::memory_order_release);
+    head_.store(head + 1, std::memory_order_release);
+    writable_.notify();
+    return result;
+  }
+
+  T pop() {
+    for (;;) {
+      if (auto value = try_pop()) return std::move(*value);
+      readable_.wait_until([this] { return published(head_.load(std::memory_order_relaxed)); });
+    }
+  }
+
+ private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    details::RingStorage<T> storage;
+  };
+
+  bool published(std::size_t head) const {
+    return slots_[head % N].sequence.load(std::memory_order_acquire) == head + 1;
+  }
+
+  // Written by the consumer.
+  alignas(details::kCacheLineSize) std::atomic<std::size_t> head_ = 0;
+
+  // Written by the producers.
+  alignas(details::kCacheLineSize) std::atomic<std::size_t> tail_ = 0;
+
+  alignas(details::kCacheLineSize) details::QueueSignal readable_;
+  details::QueueSignal writable_;
+
+  alignas(details::kCacheLineSize) std::array<Slot, N> slots_;
+};
+
+}  // namespace android::ftl
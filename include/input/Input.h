@@ -37,6 +37,7 @@
 #include <array>
 #include <limits>
 #include <queue>
+#include <vector>
 
 /*
  * Additional private constants not defined in ndk/ui/input.h.
@@ -1173,6 +1174,9 @@ private:
 
 /*
  * An input event factory implementation that maintains a pool of input events.
+ *
+ * A recycled event keeps the storage of its pointers and samples, so an event that is created
+ * again from the pool does not allocate unless it gets more samples than it had before.
  */
 class PooledInputEventFactory : public InputEventFactoryInterface {
 public:
@@ -1191,12 +1195,12 @@ public:
 private:
     const size_t mMaxPoolSize;
 
-    std::queue<std::unique_ptr<KeyEvent>> mKeyEventPool;
-    std::queue<std::unique_ptr<MotionEvent>> mMotionEventPool;
-    std::queue<std::unique_ptr<FocusEvent>> mFocusEventPool;
-    std::queue<std::unique_ptr<CaptureEvent>> mCaptureEventPool;
-    std::queue<std::unique_ptr<DragEvent>> mDragEventPool;
-    std::queue<std::unique_ptr<TouchModeEvent>> mTouchModeEventPool;
+    std::vector<std::unique_ptr<KeyEvent>> mKeyEventPool;
+    std::vector<std::unique_ptr<MotionEvent>> mMotionEventPool;
+    std::vector<std::unique_ptr<FocusEvent>> mFocusEventPool;
+    std::vector<std::unique_ptr<CaptureEvent>> mCaptureEventPool;
+    std::vector<std::unique_ptr<DragEvent>> mDragEventPool;
+    std::vector<std::unique_ptr<TouchModeEvent>> mTouchModeEventPool;
 };
 
 /**
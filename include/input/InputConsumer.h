@@ -23,6 +23,7 @@
  */
 
 #include "InputTransport.h"
+#include "MapNodePool.h"
 
 namespace android {
 
@@ -128,6 +129,9 @@ private:
         std::vector<InputMessage> samples;
     };
     std::vector<Batch> mBatches;
+    // The sample storage of consumed batches, kept for the next ones so that batching a steady
+    // stream of samples does not allocate.
+    std::vector<std::vector<InputMessage>> mSpareBatchSamples;
 
     // Touch state per device and source, only for sources of class pointer.
     struct History {
@@ -228,6 +232,7 @@ private:
     // events are finished. It should not grow infinitely because if an event is not ack'd, ANR
     // will be raised for that connection, and no further events will be posted to that channel.
     std::unordered_map<uint32_t /*seq*/, nsecs_t /*consumeTime*/> mConsumeTimes;
+    MapNodePool<std::unordered_map<uint32_t, nsecs_t>> mConsumeTimeNodes;
 
     status_t consumeBatch(InputEventFactoryInterface* factory, nsecs_t frameTime, uint32_t* outSeq,
                           InputEvent** outEvent);
@@ -237,6 +242,8 @@ private:
     void updateTouchState(InputMessage& msg);
     void resampleTouchState(nsecs_t frameTime, MotionEvent* event, const InputMessage* next);
 
+    void startBatch(const InputMessage& msg);
+    void eraseBatch(size_t index);
     ssize_t findBatch(int32_t deviceId, int32_t source) const;
     ssize_t findTouchState(int32_t deviceId, int32_t source) const;
 
@@ -19,9 +19,13 @@
 #include <map>
 #include <memory>
 #include <optional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
 
 #include <input/Input.h>
 #include <input/InputTransport.h>
+#include <input/MapNodePool.h>
 #include <input/Resampler.h>
 #include <utils/Looper.h>
 
@@ -88,6 +92,12 @@ public:
      * Must be called exactly once for each event received through the callbacks.
      */
     void finishInputEvent(uint32_t seq, bool handled);
+    /**
+     * Give back a motion event that was received through the callbacks, once it is no longer
+     * needed. The next motion events are built in the recycled ones, so that consuming a steady
+     * stream of events does not allocate.
+     */
+    void recycleMotionEvent(std::unique_ptr<MotionEvent> event);
     void reportTimeline(int32_t inputEventId, nsecs_t gpuCompletedTime, nsecs_t presentTime);
     /**
      * If you want to consume all events immediately (disable batching), then you still must call
@@ -168,6 +178,7 @@ private:
      * will be raised for that connection, and no further events will be posted to that channel.
      */
     std::unordered_map<uint32_t /*seq*/, nsecs_t /*consumeTime*/> mConsumeTimes;
+    MapNodePool<std::unordered_map<uint32_t, nsecs_t>> mConsumeTimeNodes;
     /**
      * Find and return the consumeTime associated with the provided sequence number. Crashes if
      * the provided seq number is not found.
@@ -178,13 +189,23 @@ private:
     /**
      * Read all of the available events from the InputChannel
      */
-    std::vector<InputMessage> readAllMessages();
+    void readAllMessages(std::vector<InputMessage>& outMessages);
+    /**
+     * The storage of the messages that were last read, kept for the next read.
+     */
+    std::vector<InputMessage> mReadBuffer;
 
     /**
      * Send InputMessage to the corresponding InputConsumerCallbacks function.
      * @param msg
      */
-    void handleMessage(const InputMessage& msg) const;
+    void handleMessage(const InputMessage& msg);
+
+    /**
+     * Motion events given back by the caller, which the next motion events are built in.
+     */
+    std::vector<std::unique_ptr<MotionEvent>> mRecycledMotionEvents;
+    std::unique_ptr<MotionEvent> obtainMotionEvent(const InputMessage& msg);
 
     // Batching
     /**
@@ -192,7 +213,7 @@ private:
      * to the InputConsumerCallbacks immediately. If there are batches remaining,
      * notify InputConsumerCallbacks.
      */
-    void handleMessages(std::vector<InputMessage>&& messages);
+    void handleMessages(const std::vector<InputMessage>& messages);
     /**
      * Batched InputMessages, per deviceId.
      * For each device, we are storing a queue of batched messages. These will all be collapsed into
@@ -200,6 +221,7 @@ private:
      * `consumeBatchedInputEvents`.
      */
     std::map<DeviceId, std::queue<InputMessage>> mBatches;
+    MapNodePool<std::map<DeviceId, std::queue<InputMessage>>> mBatchNodes;
     /**
      * Creates a MotionEvent by consuming samples from the provided queue. If one message has
      * eventTime > adjustedFrameTime, all subsequent messages in the queue will be skipped. It is
@@ -248,6 +270,7 @@ private:
      * the batched MotionEvent that it received.
      */
     std::map<uint32_t, std::vector<uint32_t>> mBatchedSequenceNumbers;
+    MapNodePool<std::map<uint32_t, std::vector<uint32_t>>> mBatchedSequenceNumberNodes;
 };
 
 } // namespace android
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/result.h>
+#include <android-base/unique_fd.h>
+#include <input/InputTransport.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace android {
+
+/*
+ * A single-producer, single-consumer queue of input messages in shared memory.
+ *
+ * One process writes to the ring and another reads from it, without any system call. The ring
+ * does not wake up the reader: the writer has to tell the reader separately when push() says
+ * that the reader may be waiting for a message.
+ *
+ * The memory is shared with the other process, which is not trusted. Everything that is read
+ * from the ring is validated, and only a sanitized copy of each message is written to it.
+ */
+class InputMessageRing {
+public:
+    /* Creates a new ring that holds up to 'capacity' messages, which must be a power of two. */
+    static std::unique_ptr<InputMessageRing> create(const std::string& name, uint32_t capacity);
+
+    /* Maps a ring that was created by another InputMessageRing, given its shared memory fd. */
+    static std::unique_ptr<InputMessageRing> map(android::base::unique_fd fd);
+
+    ~InputMessageRing();
+
+    inline int getFd() const { return mFd.get(); }
+    inline uint32_t getCapacity() const { return mCapacity; }
+
+    /* Return a duplicate of the fd of the shared memory, to map the ring somewhere else. */
+    android::base::unique_fd dupFd() const;
+
+    /* Add a message to the ring.
+     *
+     * Return false if the ring is full, in which case nothing was written.
+     * Otherwise, outNeedsWakeup is set when the reader had read everything before this message,
+     * so it may be waiting for this one and needs to be woken up.
+     */
+    bool push(const InputMessage& msg, bool& outNeedsWakeup);
+
+    /* Remove the oldest message from the ring.
+     *
+     * Return WOULD_BLOCK if the ring is empty.
+     * Return BAD_VALUE if the ring or the message was corrupted by the other process.
+     */
+    android::base::Result<InputMessage> pop();
+
+    /* Tells whether there is a message in the ring. */
+    bool empty() const;
+
+private:
+    // The producer and the consumer each write one of the indices, so they are kept on separate
+    // cache lines. Both only ever increase, and are taken modulo the capacity.
+    struct Header {
+        alignas(64) std::atomic<uint32_t> head;
+        alignas(64) std::atomic<uint32_t> tail;
+    };
+    static_assert(std::atomic<uint32_t>::is_always_lock_free,
+                  "the indices must work across processes");
+
+    struct Slot {
+        uint32_t size;
+        uint32_t empty;
+        InputMessage message;
+    };
+
+    InputMessageRing(android::base::unique_fd fd, void* memory, size_t size, uint32_t capacity);
+
+    static size_t getMemorySize(uint32_t capacity);
+
+    android::base::unique_fd mFd;
+    void* mMemory;
+    size_t mSize;
+    // The capacity comes from the size of the memory rather than from the memory itself, so the
+    // other process cannot change it.
+    uint32_t mCapacity;
+    Header* mHeader;
+    Slot* mSlots;
+};
+
+} // namespace android
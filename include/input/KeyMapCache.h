@@ -0,0 +1,94 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace android {
+
+/**
+ * Keeps the maps parsed from key layout and key character map files, so that a keyboard that
+ * reconnects, or another keyboard with the same layout, does not parse the same file again.
+ *
+ * An entry is found by a key, such as the name of the file, and by the hash of the contents that
+ * it was parsed from. It is only used if those contents are still the same, so an entry of a file
+ * that has changed is parsed again. The cache keeps up to maxSize entries, and evicts the least
+ * recently used one.
+ *
+ * The maps are shared by everyone who finds them, so Map should be immutable, or const.
+ */
+template <typename Map>
+class KeyMapCache {
+public:
+    explicit KeyMapCache(size_t maxSize) : mMaxSize(maxSize) {}
+
+    /* Return the map parsed from these contents, or nullptr if there is none. */
+    std::shared_ptr<Map> find(const std::string& key, const std::string& contents) {
+        const size_t hash = std::hash<std::string>{}(contents);
+        std::scoped_lock lock(mLock);
+        for (auto it = mEntries.begin(); it != mEntries.end(); it++) {
+            if (it->hash == hash && it->key == key && it->contents == contents) {
+                mEntries.splice(mEntries.begin(), mEntries, it);
+                return mEntries.front().map;
+            }
+        }
+        return nullptr;
+    }
+
+    /* Keep a map that was parsed from these contents, in place of the previous one of this key. */
+    void insert(const std::string& key, std::string contents, std::shared_ptr<Map> map) {
+        const size_t hash = std::hash<std::string>{}(contents);
+        std::scoped_lock lock(mLock);
+        mEntries.remove_if([&key](const Entry& entry) { return entry.key == key; });
+        mEntries.push_front({key, hash, std::move(contents), std::move(map)});
+        if (mEntries.size() > mMaxSize) {
+            mEntries.pop_back();
+        }
+    }
+
+    void clear() {
+        std::scoped_lock lock(mLock);
+        mEntries.clear();
+    }
+
+    size_t size() const {
+        std::scoped_lock lock(mLock);
+        return mEntries.size();
+    }
+
+private:
+    struct Entry {
+        std::string key;
+        size_t hash;
+        std::string contents;
+        std::shared_ptr<Map> map;
+    };
+
+    const size_t mMaxSize;
+    mutable std::mutex mLock;
+    // The most recently used entry is first.
+    std::list<Entry> mEntries GUARDED_BY(mLock);
+};
+
+} // namespace android
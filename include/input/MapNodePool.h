@@ -0,0 +1,74 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace android {
+
+/**
+ * Keeps the nodes of the entries that are erased from a node-based map, such as std::map or
+ * std::unordered_map, and reuses them for the entries that are inserted next. A map whose entries
+ * come and go at a steady rate then stops allocating.
+ *
+ * The mapped value of a reused node is whatever it was when its entry was erased, so that a
+ * container keeps its capacity. The caller resets it.
+ */
+template <typename Map>
+class MapNodePool {
+public:
+    using key_type = typename Map::key_type;
+    using iterator = typename Map::iterator;
+
+    /* Keeps up to maxSize nodes. */
+    explicit MapNodePool(size_t maxSize) : mMaxSize(maxSize) { mNodes.reserve(maxSize); }
+
+    /**
+     * Insert an entry for key if there is none, in a reused node if there is one.
+     * Return the entry, and whether it was inserted.
+     */
+    std::pair<iterator, bool> tryEmplace(Map& map, const key_type& key) {
+        if (mNodes.empty()) {
+            return map.try_emplace(key);
+        }
+        if (iterator it = map.find(key); it != map.end()) {
+            return {it, false};
+        }
+        typename Map::node_type node = std::move(mNodes.back());
+        mNodes.pop_back();
+        node.key() = key;
+        return {map.insert(std::move(node)).position, true};
+    }
+
+    /* Erase an entry, and keep its node if the pool is not full. */
+    void erase(Map& map, iterator it) {
+        typename Map::node_type node = map.extract(it);
+        if (mNodes.size() < mMaxSize) {
+            mNodes.push_back(std::move(node));
+        }
+    }
+
+    size_t size() const { return mNodes.size(); }
+
+private:
+    const size_t mMaxSize;
+    std::vector<typename Map::node_type> mNodes;
+};
+
+} // namespace android
@@ -23,6 +23,7 @@
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <android-base/result.h>
 #include <android-base/thread_annotations.h>
@@ -87,10 +88,25 @@ private:
  * The offset is used to provide additional flexibility to the caller, in case the default present
  * time (typically provided by the choreographer) does not account for some delays, or to simply
  * reduce the aggressiveness of the prediction. Offset can be positive or negative.
+ *
+ * By default, the model runs on the calling thread whenever a prediction is requested. In the
+ * asynchronous inference mode, it runs on a dedicated thread instead, every time new samples are
+ * recorded, and 'predict' extrapolates from the latest completed inference without waiting for the
+ * model. Its predictions may then be based on samples that are one or two events old.
  */
 class MotionPredictor {
 public:
     using ReportAtomFunction = MotionPredictorMetricsManager::ReportAtomFunction;
+    using Delegate = TfLiteMotionPredictorModel::Delegate;
+
+    enum class InferenceMode {
+        // Run the model on the thread that calls 'predict'.
+        SYNCHRONOUS,
+        // Run the model on a dedicated thread, seeded with the samples passed to 'record'.
+        ASYNCHRONOUS,
+
+        ftl_last = ASYNCHRONOUS
+    };
 
     /**
      * Parameters:
@@ -103,10 +119,18 @@ public:
      *
      * reportAtomFunction: the function that will be called to report prediction metrics. If
      * omitted, the implementation will choose a default metrics reporting mechanism.
+     *
+     * inferenceMode: the thread on which the model runs.
+     *
+     * delegate: the TfLite delegate that runs the model. If it cannot be applied, the model runs
+     * on the CPU with the built-in kernels.
      */
     MotionPredictor(nsecs_t predictionTimestampOffsetNanos,
                     std::function<bool()> checkEnableMotionPrediction = isMotionPredictionEnabled,
-                    ReportAtomFunction reportAtomFunction = {});
+                    ReportAtomFunction reportAtomFunction = {},
+                    InferenceMode inferenceMode = InferenceMode::SYNCHRONOUS,
+                    Delegate delegate = Delegate::NONE);
+    ~MotionPredictor();
 
     /**
      * Record the actual motion received by the view. This event will be used for calculating the
@@ -122,10 +146,32 @@ public:
     bool isPredictionAvailable(int32_t deviceId, int32_t source);
 
 private:
+    class InferenceThread;
+
+    // The output of one run of the model, along with the state of the buffers that it ran on.
+    struct Inference {
+        std::vector<float> r;
+        std::vector<float> phi;
+        std::vector<float> pressure;
+        TfLiteMotionPredictorSample::Point axisFrom;
+        TfLiteMotionPredictorSample::Point axisTo;
+        int64_t lastTimestamp = 0;
+        float jerkMagnitude = 0;
+        // How long the model took to run.
+        nsecs_t latency = 0;
+        // The number of gestures that had ended before the one that the inference is for.
+        size_t gesture = 0;
+    };
+
     const nsecs_t mPredictionTimestampOffsetNanos;
     const std::function<bool()> mCheckMotionPredictionEnabled;
+    const InferenceMode mInferenceMode;
+    const Delegate mDelegate;
 
+    // In the asynchronous mode, the model, the buffers, and the jerk tracker are owned by
+    // mInferenceThread instead.
     std::unique_ptr<TfLiteMotionPredictorModel> mModel;
+    TfLiteMotionPredictorModel::Config mConfig;
 
     std::unique_ptr<TfLiteMotionPredictorBuffers> mBuffers;
     std::optional<MotionEvent> mLastEvent;
@@ -136,10 +182,24 @@ private:
 
     const ReportAtomFunction mReportAtomFunction;
 
+    // The inference that the predictions are made from. In the asynchronous mode, this is the
+    // latest one that the inference thread completed.
+    Inference mInference;
+    bool mHasInference = false;
+    // The number of gestures that have ended.
+    size_t mGesture = 0;
+
+    std::unique_ptr<InferenceThread> mInferenceThread;
+
     // Initialize prediction model and associated objects.
     // Called during lazy initialization.
     // TODO: b/210158587 Consider removing lazy initialization.
     void initializeObjects();
+
+    // Run the model on the buffers, and store its outputs in inference.
+    static void runInference(TfLiteMotionPredictorModel& model,
+                             const TfLiteMotionPredictorBuffers& buffers,
+                             const JerkTracker& jerkTracker, Inference& inference);
 };
 
 } // namespace android
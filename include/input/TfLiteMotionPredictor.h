@@ -115,8 +115,18 @@ public:
         float jerkAlpha = 1;
     };
 
-    // Creates a model from an encoded Flatbuffer model.
-    static std::unique_ptr<TfLiteMotionPredictorModel> create();
+    // The TfLite delegates that the model can run on, instead of the built-in kernels.
+    enum class Delegate {
+        NONE,
+        XNNPACK,
+        NNAPI,
+
+        ftl_last = NNAPI
+    };
+
+    // Creates a model from an encoded Flatbuffer model. If the delegate cannot be applied, the
+    // model runs with the built-in kernels.
+    static std::unique_ptr<TfLiteMotionPredictorModel> create(Delegate delegate = Delegate::NONE);
 
     ~TfLiteMotionPredictorModel();
 
@@ -147,7 +157,9 @@ public:
 
 private:
     explicit TfLiteMotionPredictorModel(std::unique_ptr<android::base::MappedFile> model,
-                                        Config config);
+                                        Config config, Delegate delegate);
+
+    void applyDelegate(Delegate delegate);
 
     void allocateTensors();
     void attachInputTensors();
@@ -20,6 +20,7 @@
 
 #include <stdint.h>
 #include <sys/time.h>
+#include <memory>
 #include <vector>
 
 namespace android {
@@ -28,11 +29,19 @@ namespace android {
  * Represents data from a single scan of the touchscreen device.
  * Similar in concept to a video frame, but the touch strength is used as
  * the values instead.
+ *
+ * The data is immutable and shared between the copies of a frame, so that a frame can be passed
+ * from the reader to the listeners of the motion events without copying the heatmap.
  */
 class TouchVideoFrame {
 public:
     TouchVideoFrame(uint32_t height, uint32_t width, std::vector<int16_t> data,
             const struct timeval& timestamp);
+    /**
+     * Create a frame that shares |data|, which must not be null, with its other owners.
+     */
+    static TouchVideoFrame fromSharedData(uint32_t height, uint32_t width,
+            std::shared_ptr<const std::vector<int16_t>> data, const struct timeval& timestamp);
 
     bool operator==(const TouchVideoFrame& rhs) const;
 
@@ -59,13 +68,18 @@ public:
     /**
      * Rotate the video frame.
      * The rotation value is an enum from ui/Rotation.h
+     * The rotated data is a new array, so the other copies of the frame are not affected.
      */
     void rotate(ui::Rotation orientation);
 
 private:
+    struct SharedDataTag {};
+    TouchVideoFrame(SharedDataTag, uint32_t height, uint32_t width,
+            std::shared_ptr<const std::vector<int16_t>> data, const struct timeval& timestamp);
+
     uint32_t mHeight;
     uint32_t mWidth;
-    std::vector<int16_t> mData;
+    std::shared_ptr<const std::vector<int16_t>> mData;
     struct timeval mTimestamp;
 
     /**
@@ -21,6 +21,7 @@
 #include <input/RingBuffer.h>
 #include <utils/BitSet.h>
 #include <utils/Timers.h>
+#include <array>
 #include <map>
 #include <set>
 
@@ -212,6 +213,7 @@ public:
     LeastSquaresVelocityTrackerStrategy(uint32_t degree, Weighting weighting = Weighting::NONE);
     ~LeastSquaresVelocityTrackerStrategy() override;
 
+    void addMovement(nsecs_t eventTime, int32_t pointerId, float position) override;
     std::optional<float> getVelocity(int32_t pointerId) const override;
 
 private:
@@ -220,17 +222,45 @@ private:
     // changes in direction.
     static const nsecs_t HORIZON = 100 * 1000000; // 100 ms
 
+    // Highest degree that is fitted from running sums instead of from the movements.
+    static constexpr uint32_t MAX_INCREMENTAL_DEGREE = 2;
+
+    /**
+     * Running sums for the least-squares fit of the movements of one pointer, other than the
+     * newest one. Each movement adds its squared weight times x^k and times x^k * y, where x is
+     * the time of the movement in seconds since `anchorTime` and y is its position.
+     *
+     * The newest movement is left out because its weight is the only one that changes when a
+     * movement is added. All the others are weighted based on the movement that follows them.
+     */
+    struct Moments {
+        nsecs_t anchorTime;
+        std::array<double, 2 * MAX_INCREMENTAL_DEGREE + 1> sumX;
+        std::array<double, MAX_INCREMENTAL_DEGREE + 1> sumXY;
+    };
+
     float chooseWeight(int32_t pointerId, uint32_t index) const;
+    float chooseIncrementalWeight(nsecs_t eventTime, nsecs_t nextEventTime) const;
+
+    void accumulate(Moments& moments, const Movement& movement, float weight, double sign) const;
+    void removeOldestMovement(Moments& moments, RingBuffer<Movement>& movements) const;
+    void rebuildMoments(Moments& moments, const RingBuffer<Movement>& movements) const;
+
     /**
-     * An optimized least-squares solver for degree 2 and no weight (i.e. `Weighting.NONE`).
-     * The provided container of movements shall NOT be empty, and shall have the movements in
-     * chronological order.
+     * Solves the least-squares fit of the given degree, which shall be 1 or 2, from the moments of
+     * a pointer and its newest movement. This takes the same time regardless of the number of
+     * movements.
      */
-    std::optional<float> solveUnweightedLeastSquaresDeg2(
-            const RingBuffer<Movement>& movements) const;
+    std::optional<float> solveIncrementalLeastSquares(const Moments& moments,
+                                                      const Movement& newestMovement,
+                                                      uint32_t degree) const;
 
     const uint32_t mDegree;
     const Weighting mWeighting;
+    // Whether the fits up to MAX_INCREMENTAL_DEGREE are solved from mMoments. The weights of the
+    // other weightings depend on the age of the movements, so every fit needs all of them.
+    const bool mIncremental;
+    std::array<Moments, MAX_POINTER_ID + 1> mMoments;
 };
 
 /*
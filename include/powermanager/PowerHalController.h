@@ -25,6 +25,10 @@
 #include <powermanager/PowerHalWrapper.h>
 #include <powermanager/PowerHintSessionWrapper.h>
 
+#include <array>
+#include <chrono>
+#include <optional>
+
 namespace android {
 
 namespace power {
@@ -73,8 +77,20 @@ public:
             int tgid, int uid) override;
     virtual HalResult<void> closeSessionChannel(int tgid, int uid) override;
 
+    // Skip a setBoost() that repeats the boost and duration of one sent less than window ago,
+    // which the HAL is still applying. Zero, the default, sends every boost.
+    void setBoostCoalescingWindow(std::chrono::nanoseconds window);
+    // Number of setBoost() calls that were skipped this way.
+    int64_t getCoalescedBoostCount();
+
 private:
+    struct SentBoost {
+        int32_t durationMs;
+        std::chrono::steady_clock::time_point time;
+    };
+
     std::mutex mConnectedHalMutex;
+    std::mutex mBoostMutex;
     std::unique_ptr<HalConnector> mHalConnector;
 
     // Shared pointers to keep global pointer and allow local copies to be used in
@@ -82,6 +98,15 @@ private:
     std::shared_ptr<HalWrapper> mConnectedHal GUARDED_BY(mConnectedHalMutex) = nullptr;
     const std::shared_ptr<HalWrapper> mDefaultHal = std::make_shared<EmptyHalWrapper>();
 
+    std::chrono::nanoseconds mBoostCoalescingWindow GUARDED_BY(mBoostMutex) =
+            std::chrono::nanoseconds::zero();
+    std::array<std::optional<SentBoost>,
+               static_cast<int32_t>(
+                       *(ndk::enum_range<aidl::android::hardware::power::Boost>().end() - 1)) +
+                       1>
+            mLastSentBoosts GUARDED_BY(mBoostMutex);
+    int64_t mCoalescedBoostCount GUARDED_BY(mBoostMutex) = 0;
+
     std::shared_ptr<HalWrapper> initHal();
     template <typename T>
     HalResult<T> processHalResult(HalResult<T>&& result, const char* functionName);
@@ -25,6 +25,11 @@
 #include <android-base/thread_annotations.h>
 #include "HalResult.h"
 
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <vector>
+
 namespace android::power {
 
 // Wrapper for power hint sessions, which allows for better mocking,
@@ -46,9 +51,33 @@ public:
                                     bool in_enabled);
     virtual HalResult<aidl::android::hardware::power::SessionConfig> getSessionConfig();
 
+    // Buffer the durations of reportActualWorkDuration() and send them in one call once
+    // maxDurations of them are buffered, or once the oldest is maxDelay old. The buffer is
+    // also sent ahead of a new target and before the session is paused or closed. The default
+    // of one duration sends every report on its own.
+    void setReportBatching(size_t maxDurations, std::chrono::nanoseconds maxDelay);
+    // Send the buffered durations, if any.
+    virtual HalResult<void> flushActualWorkDurations();
+    // Number of calls to the HAL saved by batching durations and by skipping repeated targets.
+    int64_t getCoalescedCallCount();
+
 private:
+    HalResult<void> sendActualWorkDurations(
+            const std::vector<::aidl::android::hardware::power::WorkDuration>& durations);
+    HalResult<void> flushActualWorkDurationsLocked() REQUIRES(mBatchMutex);
+
     std::shared_ptr<aidl::android::hardware::power::IPowerHintSession> mSession;
     int32_t mInterfaceVersion;
+
+    std::mutex mBatchMutex;
+    size_t mMaxBatchedDurations GUARDED_BY(mBatchMutex) = 1;
+    std::chrono::nanoseconds mMaxBatchDelay GUARDED_BY(mBatchMutex) =
+            std::chrono::nanoseconds::zero();
+    std::vector<::aidl::android::hardware::power::WorkDuration> mBatchedDurations
+            GUARDED_BY(mBatchMutex);
+    std::chrono::steady_clock::time_point mFirstBatchedTime GUARDED_BY(mBatchMutex);
+    std::optional<int64_t> mLastTargetDuration GUARDED_BY(mBatchMutex);
+    int64_t mCoalescedCallCount GUARDED_BY(mBatchMutex) = 0;
 };
 
 } // namespace android::power
\ No newline at end of file
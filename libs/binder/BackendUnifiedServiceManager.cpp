@@ -172,6 +172,56 @@ binder::Status BackendUnifiedServiceManager::getService2(const ::std::string& na
     return status;
 }
 
+binder::Status BackendUnifiedServiceManager::getServices(const ::std::vector<::std::string>& names,
+                                                         ::std::vector<os::Service>* _out) {
+    _out->assign(names.size(), os::Service::make<os::Service::Tag::binder>(nullptr));
+
+    // Only the services which are not cached are looked up.
+    std::vector<std::string> uncachedNames;
+    std::vector<size_t> uncachedIndices;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (!returnIfCached(names[i], &(*_out)[i])) {
+            uncachedNames.push_back(names[i]);
+            uncachedIndices.push_back(i);
+        }
+    }
+    if (uncachedNames.empty()) {
+        return binder::Status::ok();
+    }
+
+    std::vector<os::Service> services;
+    binder::Status status = mTheRealServiceManager->getServices(uncachedNames, &services);
+    if (status.exceptionCode() == binder::Status::EX_TRANSACTION_FAILED &&
+        status.transactionError() == UNKNOWN_TRANSACTION) {
+        // The service manager predates getServices.
+        for (size_t i : uncachedIndices) {
+            if (status = getService2(names[i], &(*_out)[i]); !status.isOk()) {
+                return status;
+            }
+        }
+        return binder::Status::ok();
+    }
+    if (!status.isOk()) {
+        return status;
+    }
+    if (services.size() != uncachedNames.size()) {
+        ALOGE("getServices returned %zu services for %zu names", services.size(),
+              uncachedNames.size());
+        return binder::Status::fromStatusT(BAD_VALUE);
+    }
+
+    for (size_t i = 0; i < services.size(); i++) {
+        status = toBinderService(uncachedNames[i], services[i], &(*_out)[uncachedIndices[i]]);
+        if (status.isOk()) {
+            status = updateCache(uncachedNames[i], services[i]);
+        }
+        if (!status.isOk()) {
+            return status;
+        }
+    }
+    return binder::Status::ok();
+}
+
 binder::Status BackendUnifiedServiceManager::checkService(const ::std::string& name,
                                                           os::Service* _out) {
     os::Service service;
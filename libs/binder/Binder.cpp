@@ -40,12 +40,16 @@
 #include "BuildFlags.h"
 #include "OS.h"
 #include "RpcState.h"
+#include "TransactionRecorder.h"
+#include "TransactionStats.h"
 
 namespace android {
 
 using android::binder::unique_fd;
 
 constexpr uid_t kUidRoot = 0;
+constexpr uid_t kUidSystem = 1000;
+constexpr uid_t kUidShell = 2000;
 
 // Service implementations inherit from BBinder and IBinder, and this is frozen
 // in prebuilts.
@@ -185,6 +189,28 @@ status_t IBinder::getDebugPid(pid_t* out) {
     return OK;
 }
 
+static std::string transactionStats(std::optional<bool> enable) {
+    if (enable.has_value()) {
+        TransactionStats::setEnabled(*enable);
+    }
+    return TransactionStats::dump();
+}
+
+status_t IBinder::getTransactionStats(std::string* out, std::optional<bool> enable) {
+    if (localBinder() != nullptr) {
+        *out = transactionStats(enable);
+        return OK;
+    }
+
+    Parcel data;
+    Parcel reply;
+    status_t status = data.writeInt32(enable.has_value() ? *enable : -1);
+    if (status != OK) return status;
+    status = transact(TRANSACTION_STATS_TRANSACTION, data, &reply);
+    if (status != OK) return status;
+    return reply.readUtf8FromUtf16(out);
+}
+
 status_t IBinder::setRpcClientDebug(unique_fd socketFd, const sp<IBinder>& keepAliveBinder) {
     if (!kEnableRpcDevServers) {
         ALOGW("setRpcClientDebug disallowed because RPC is not enabled");
@@ -290,7 +316,7 @@ public:
     std::set<sp<RpcServerLink>> mRpcServerLinks;
     BpBinder::ObjectManager mObjects;
 
-    unique_fd mRecordingFd;
+    std::unique_ptr<TransactionRecorder> mRecorder;
 };
 
 // ---------------------------------------------------------------------------
@@ -327,10 +353,22 @@ status_t BBinder::startRecordingTransactions(const Parcel& data) {
         ALOGI("Could not start Binder recording. Another is already in progress.");
         return INVALID_OPERATION;
     } else {
-        status_t readStatus = data.readUniqueFileDescriptor(&(e->mRecordingFd));
+        unique_fd fd;
+        status_t readStatus = data.readUniqueFileDescriptor(&fd);
         if (readStatus != OK) {
             return readStatus;
         }
+        // Older clients only send the fd.
+        uint32_t flags = 0;
+        if (data.dataAvail() >= sizeof(flags) && (readStatus = data.readUint32(&flags)) != OK) {
+            return readStatus;
+        }
+        if ((flags & ~BpBinder::RECORDING_COMPRESSED) != 0) {
+            ALOGE("Unknown Binder recording flags %" PRIx32, flags);
+            return BAD_VALUE;
+        }
+        const bool compress = (flags & BpBinder::RECORDING_COMPRESSED) != 0;
+        e->mRecorder = TransactionRecorder::make(std::move(fd), compress);
         mRecordingOn = true;
         ALOGI("Started Binder recording.");
         return NO_ERROR;
@@ -354,8 +392,11 @@ status_t BBinder::stopRecordingTransactions() {
     Extras* e = getOrCreateExtras();
     RpcMutexUniqueLock lock(e->mLock);
     if (mRecordingOn) {
-        e->mRecordingFd.reset();
+        // Writes the rest of the recording before returning, so the caller can read all of it.
+        std::unique_ptr<TransactionRecorder> recorder = std::move(e->mRecorder);
         mRecordingOn = false;
+        lock.unlock();
+        recorder.reset();
         ALOGI("Stopped Binder recording.");
         return NO_ERROR;
     } else {
@@ -404,6 +445,22 @@ status_t BBinder::transact(
             err = setRpcClientDebug(data);
             break;
         }
+        case TRANSACTION_STATS_TRANSACTION: {
+            uid_t uid = IPCThreadState::self()->getCallingUid();
+            if (uid != kUidRoot && uid != kUidSystem && uid != kUidShell) {
+                ALOGE("Transaction stats not allowed for client %" PRIu32, uid);
+                err = PERMISSION_DENIED;
+                break;
+            }
+            LOG_ALWAYS_FATAL_IF(reply == nullptr, "reply == nullptr");
+            const int32_t enable = data.readInt32();
+            err = reply->writeUtf8AsUtf16(
+                    transactionStats(enable < 0 ? std::nullopt : std::optional<bool>(enable != 0)));
+            break;
+        }
+        case BATCH_TRANSACTION:
+            err = transactBatch(data, flags);
+            break;
         default:
             err = onTransact(code, data, reply, flags);
             break;
@@ -429,9 +486,8 @@ status_t BBinder::transact(
                     fromDetails(getInterfaceDescriptor(), code, flags, ts, data,
                                 reply ? *reply : emptyReply, err);
             if (transaction) {
-                if (status_t err = transaction->dumpToFile(e->mRecordingFd); err != NO_ERROR) {
-                    ALOGI("Failed to dump RecordedTransaction to file with error %d", err);
-                }
+                // Queued to be written on the recorder's thread.
+                e->mRecorder->record(*transaction);
             } else {
                 ALOGI("Failed to create RecordedTransaction object.");
             }
@@ -641,6 +697,42 @@ void BBinder::setParceled() {
     mParceled = true;
 }
 
+status_t BBinder::transactBatch(const Parcel& data, uint32_t flags) {
+    // See OnewayBatch.h for the format.
+    if ((flags & FLAG_ONEWAY) == 0 || data.isForRpc()) {
+        ALOGE("Batches must be oneway kernel binder transactions");
+        return BAD_TYPE;
+    }
+
+    uint32_t count;
+    status_t status = data.readUint32(&count);
+    if (status != OK) return status;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t code;
+        uint32_t size;
+        if ((status = data.readUint32(&code)) != OK) return status;
+        if ((status = data.readUint32(&size)) != OK) return status;
+        if (code < FIRST_CALL_TRANSACTION || code > LAST_CALL_TRANSACTION) {
+            ALOGE("Batched transaction has invalid code %" PRIu32, code);
+            return BAD_VALUE;
+        }
+        const void* buffer = data.readInplace(size);
+        if (buffer == nullptr) return BAD_VALUE;
+
+        Parcel call;
+        if ((status = call.setData(static_cast<const uint8_t*>(buffer), size)) != OK) {
+            return status;
+        }
+        Parcel reply;
+        // Like any oneway transaction, an error of one call does not affect the next ones.
+        status = transact(code, call, &reply, flags);
+        ALOGW_IF(status != OK, "Batched transaction %" PRIu32 " failed: %s", code,
+                 statusToString(status).c_str());
+    }
+    return OK;
+}
+
 status_t BBinder::setRpcClientDebug(const Parcel& data) {
     if (!kEnableRpcDevServers) {
         ALOGW("%s: disallowed because RPC is not enabled", __PRETTY_FUNCTION__);
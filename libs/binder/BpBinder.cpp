@@ -28,6 +28,8 @@
 #include <stdio.h>
 
 #include "BuildFlags.h"
+#include "OnewayBatch.h"
+#include "TransactionStats.h"
 #include "file.h"
 
 //#undef ALOGV
@@ -252,7 +254,9 @@ BpBinder::BpBinder(Handle&& handle)
         mObitsSent(false),
         mObituaries(nullptr),
         mDescriptorCache(kDescriptorUninit),
-        mTrackedUid(-1) {
+        mTrackedUid(-1),
+        mTransactionStatsInterface(TransactionStats::kUnknownInterface),
+        mOnewayBatching(false) {
     extendObjectLifetime(OBJECT_LIFETIME_WEAK);
 }
 
@@ -341,9 +345,10 @@ status_t BpBinder::pingBinder()
     return transact(PING_TRANSACTION, data, &reply);
 }
 
-status_t BpBinder::startRecordingBinder(const unique_fd& fd) {
+status_t BpBinder::startRecordingBinder(const unique_fd& fd, uint32_t flags) {
     Parcel send, reply;
     send.writeUniqueFileDescriptor(fd);
+    send.writeUint32(flags);
     return transact(START_RECORDING_TRANSACTION, send, &reply);
 }
 
@@ -367,6 +372,18 @@ status_t BpBinder::dump(int fd, const Vector<String16>& args)
     return err;
 }
 
+void BpBinder::recordTransactionStats(uint32_t code, const Parcel& data, const Parcel* reply,
+                                      std::chrono::nanoseconds latency) {
+    uint32_t interface = mTransactionStatsInterface.load(std::memory_order_relaxed);
+    if (interface == TransactionStats::kUnknownInterface && code >= FIRST_CALL_TRANSACTION &&
+        code <= LAST_CALL_TRANSACTION) {
+        interface = TransactionStats::interfaceOf(data);
+        mTransactionStatsInterface.store(interface, std::memory_order_relaxed);
+    }
+    TransactionStats::record(interface, code, latency, data.dataSize(),
+                             reply ? reply->dataSize() : 0);
+}
+
 // NOLINTNEXTLINE(google-default-arguments)
 status_t BpBinder::transact(
     uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags)
@@ -394,6 +411,10 @@ status_t BpBinder::transact(
             }
         }
 
+        const bool recordStats = TransactionStats::isEnabled();
+        const auto start = recordStats ? TransactionStats::Clock::now()
+                                       : TransactionStats::Clock::time_point();
+
         status_t status;
         if (isRpcBinder()) [[unlikely]] {
             status = rpcSession()->transact(sp<IBinder>::fromExisting(this), code, data, reply,
@@ -404,7 +425,21 @@ status_t BpBinder::transact(
                 return INVALID_OPERATION;
             }
 
-            status = IPCThreadState::self()->transact(binderHandle(), code, data, reply, flags);
+            if (mOnewayBatching.load(std::memory_order_acquire)) [[unlikely]] {
+                if (OnewayBatch::isBatchable(code, data, flags)) {
+                    status = mOnewayBatch->append(wp<BpBinder>(this), binderHandle(), code, data);
+                } else {
+                    // Keeps the order of the calls.
+                    (void)mOnewayBatch->flush(binderHandle());
+                    status = IPCThreadState::self()->transact(binderHandle(), code, data, reply,
+                                                              flags);
+                }
+            } else {
+                status = IPCThreadState::self()->transact(binderHandle(), code, data, reply, flags);
+            }
+        }
+        if (recordStats) [[unlikely]] {
+            recordTransactionStats(code, data, reply, TransactionStats::Clock::now() - start);
         }
         if (data.dataSize() > LOG_TRANSACTIONS_OVER_SIZE) {
             RpcMutexUniqueLock _l(mLock);
@@ -424,6 +459,17 @@ status_t BpBinder::transact(
 status_t BpBinder::linkToDeath(
     const sp<DeathRecipient>& recipient, void* cookie, uint32_t flags)
 {
+    return linkToDeathInternal(recipient, cookie, flags, /*batched=*/false);
+}
+
+// NOLINTNEXTLINE(google-default-arguments)
+status_t BpBinder::linkToDeathBatched(const sp<IBinder::BatchedDeathRecipient>& recipient,
+                                      void* cookie, uint32_t flags) {
+    return linkToDeathInternal(recipient, cookie, flags, /*batched=*/true);
+}
+
+status_t BpBinder::linkToDeathInternal(const sp<DeathRecipient>& recipient, void* cookie,
+                                       uint32_t flags, bool batched) {
     if (isRpcBinder()) {
         if (rpcSession()->getMaxIncomingThreads() < 1) {
             ALOGE("Cannot register a DeathRecipient without any incoming threads. Need to set max "
@@ -448,6 +494,7 @@ status_t BpBinder::linkToDeath(
     ob.recipient = recipient;
     ob.cookie = cookie;
     ob.flags = flags;
+    ob.batched = batched;
 
     LOG_ALWAYS_FATAL_IF(recipient == nullptr,
                         "linkToDeath(): recipient must be non-NULL");
@@ -689,6 +736,15 @@ void BpBinder::reportOneDeath(const Obituary& obit)
     ALOGV("Reporting death to recipient: %p\n", recipient.get());
     if (recipient == nullptr) return;
 
+    if constexpr (kEnableKernelIpc) {
+        // A thread pool thread reports it along with the deaths that it gets right after.
+        if (obit.batched && !isRpcBinder()) {
+            auto batched = sp<IBinder::BatchedDeathRecipient>::cast(recipient);
+            if (IPCThreadState::self()->deferObituary(batched, wp<BpBinder>::fromExisting(this))) {
+                return;
+            }
+        }
+    }
     recipient->binderDied(wp<BpBinder>::fromExisting(this));
 }
 
@@ -794,6 +850,10 @@ void BpBinder::onLastStrongRef(const void* /*id*/) {
         return;
     }
 
+    if (mOnewayBatch != nullptr) {
+        (void)mOnewayBatch->flush(binderHandle());
+    }
+
     ALOGV("onLastStrongRef BpBinder %p handle %d\n", this, binderHandle());
     IF_ALOGV() {
         printRefs();
@@ -873,6 +933,39 @@ void BpBinder::enableCountByUid() { sCountByUidEnabled.store(true); }
 void BpBinder::disableCountByUid() { sCountByUidEnabled.store(false); }
 void BpBinder::setCountByUidEnabled(bool enable) { sCountByUidEnabled.store(enable); }
 
+status_t BpBinder::setOnewayBatching(std::chrono::microseconds window, size_t maxBytes) {
+    if (isRpcBinder() || !kEnableKernelIpc) {
+        ALOGE("Oneway batching is only supported for kernel binders");
+        return INVALID_OPERATION;
+    }
+
+    RpcMutexUniqueLock _l(mLock);
+    if (window == std::chrono::microseconds::zero()) {
+        mOnewayBatching.store(false, std::memory_order_release);
+        return mOnewayBatch != nullptr ? mOnewayBatch->flush(binderHandle()) : OK;
+    }
+
+    if (mOnewayBatch == nullptr) {
+        mOnewayBatch = std::make_unique<OnewayBatch>();
+    }
+    mOnewayBatch->setLimits(window, maxBytes);
+    mOnewayBatching.store(true, std::memory_order_release);
+    return OK;
+}
+
+status_t BpBinder::flushOnewayBatch() {
+    OnewayBatch* batch;
+    {
+        RpcMutexUniqueLock _l(mLock);
+        batch = mOnewayBatch.get();
+    }
+    return batch != nullptr ? batch->flush(binderHandle()) : OK;
+}
+
+void BpBinder::setTransactionStatsEnabled(bool enable) {
+    TransactionStats::setEnabled(enable);
+}
+
 void BpBinder::setBinderProxyCountEventCallback(binder_proxy_limit_callback cbl,
                                                 binder_proxy_warning_callback cbw) {
     RpcMutexUniqueLock _l(sTrackingLock);
@@ -57,6 +57,14 @@ public:
     [[nodiscard]] status_t triggerablePoll(const android::RpcTransportFd& transportFd,
                                            int16_t event);
 
+#ifndef BINDER_RPC_SINGLE_THREADED
+    /**
+     * The read end of the pipe, for transports which poll it along with
+     * their own operations. It gets POLLHUP once triggered.
+     */
+    binder::borrowed_fd pollFd() const { return mRead; }
+#endif
+
 private:
 #ifdef BINDER_RPC_SINGLE_THREADED
     bool mTriggered = false;
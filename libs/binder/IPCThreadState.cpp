@@ -27,6 +27,7 @@
 #include <atomic>
 #include <errno.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sched.h>
 #include <signal.h>
@@ -34,6 +35,7 @@
 #include <sys/ioctl.h>
 #include <sys/resource.h>
 #include <unistd.h>
+#include <unordered_map>
 
 #include "Utils.h"
 #include "binder_module.h"
@@ -675,6 +677,13 @@ status_t IPCThreadState::getAndExecuteCommand()
     status_t result;
     int32_t cmd;
 
+    // Deaths that arrive together are read one at a time, so the deferred ones are only reported
+    // once the driver has nothing else to read.
+    if (mProcess->mHasDeferredObituaries && mIn.dataPosition() >= mIn.dataSize() &&
+        !hasPendingCommands()) {
+        reportDeferredObituaries();
+    }
+
     result = talkWithDriver();
     if (result >= NO_ERROR) {
         size_t IN = mIn.dataAvail();
@@ -693,11 +702,13 @@ status_t IPCThreadState::getAndExecuteCommand()
             mProcess->mStarvationStartTime
                     .compare_exchange_strong(expected, std::chrono::steady_clock::now());
         }
+        mProcess->onCommandStarted(newThreadsCount);
 
         result = executeCommand(cmd);
 
         size_t maxThreads = mProcess->mMaxThreads;
         newThreadsCount = mProcess->mExecutingThreadsCount.fetch_sub(1) - 1;
+        mProcess->onCommandFinished();
         if (newThreadsCount < maxThreads) {
             auto starvationStartTime =
                     mProcess->mStarvationStartTime.exchange(ProcessState::never());
@@ -721,6 +732,46 @@ status_t IPCThreadState::getAndExecuteCommand()
     return result;
 }
 
+bool IPCThreadState::deferObituary(const sp<IBinder::BatchedDeathRecipient>& recipient,
+                                   const wp<IBinder>& who) {
+    // Whichever thread of the threadpool runs out of commands last reports them.
+    if (!mIsLooper) return false;
+
+    std::lock_guard lock(mProcess->mDeferredObituariesLock);
+    mProcess->mDeferredObituaries.push_back({recipient, who});
+    mProcess->mHasDeferredObituaries = true;
+    return true;
+}
+
+void IPCThreadState::reportDeferredObituaries() {
+    std::vector<ProcessState::DeferredObituary> obituaries;
+    {
+        std::lock_guard lock(mProcess->mDeferredObituariesLock);
+        obituaries.swap(mProcess->mDeferredObituaries);
+        mProcess->mHasDeferredObituaries = false;
+    }
+    if (obituaries.empty()) return;
+
+    // The deaths of each recipient, in the order in which the recipients first got one.
+    std::vector<std::pair<sp<IBinder::BatchedDeathRecipient>, std::vector<wp<IBinder>>>> batches;
+    std::unordered_map<IBinder::BatchedDeathRecipient*, size_t> batchIndices;
+    for (auto& obituary : obituaries) {
+        auto [it, inserted] = batchIndices.try_emplace(obituary.recipient.get(), batches.size());
+        if (inserted) {
+            batches.emplace_back(std::move(obituary.recipient), std::vector<wp<IBinder>>());
+        }
+        batches[it->second].second.push_back(std::move(obituary.who));
+    }
+    for (const auto& [recipient, who] : batches) {
+        recipient->bindersDied(who);
+    }
+}
+
+bool IPCThreadState::hasPendingCommands() const {
+    pollfd pfd{.fd = mProcess->mDriverFD, .events = POLLIN};
+    return TEMP_FAILURE_RETRY(poll(&pfd, 1, 0)) > 0 && (pfd.revents & POLLIN);
+}
+
 // When we've cleared the incoming command queue, process any pending derefs
 void IPCThreadState::processPendingDerefs()
 {
@@ -795,11 +846,22 @@ void IPCThreadState::joinThreadPool(bool isMain)
         if(result == TIMED_OUT && !isMain) {
             break;
         }
+
+        // Or if the threadpool has idled for long enough, once this thread has drained the
+        // commands that it already read.
+        if (result == NO_ERROR && !isMain && mIn.dataPosition() >= mIn.dataSize() &&
+            mProcess->shouldRetireThread()) {
+            processPendingDerefs();
+            break;
+        }
     } while (result != -ECONNREFUSED && result != -EBADF);
 
     LOG_THREADPOOL("**** THREAD %p (PID %d) IS LEAVING THE THREAD POOL err=%d\n",
         (void*)pthread_self(), getpid(), result);
 
+    // The threads that stay may not read anything else for a while.
+    reportDeferredObituaries();
+
     mOut.writeInt32(BC_EXIT_LOOPER);
     mIsLooper = false;
     talkWithDriver(false);
@@ -1416,6 +1478,12 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
                 "Not enough command data for brTRANSACTION");
             if (result != NO_ERROR) break;
 
+            // The transaction may rely on the cleanup after the deaths that came before it. They
+            // are reported once the transaction has been read, since they may make calls.
+            if (mProcess->mHasDeferredObituaries) {
+                reportDeferredObituaries();
+            }
+
             Parcel buffer;
             buffer.ipcSetDataReference(
                 reinterpret_cast<const uint8_t*>(tr.data.ptr.buffer),
@@ -85,6 +85,15 @@ const String16& IServiceManager::getInterfaceDescriptor() const {
 IServiceManager::IServiceManager() {}
 IServiceManager::~IServiceManager() {}
 
+std::vector<sp<IBinder>> IServiceManager::getServices(const std::vector<String16>& names) {
+    std::vector<sp<IBinder>> services;
+    services.reserve(names.size());
+    for (const String16& name : names) {
+        services.push_back(checkService(name));
+    }
+    return services;
+}
+
 // From the old libbinder IServiceManager interface to IServiceManager.
 class CppBackendShim : public IServiceManager {
 public:
@@ -121,6 +130,7 @@ public:
                                         const sp<AidlRegistrationCallback>& cb) override;
 
     std::vector<IServiceManager::ServiceDebugInfo> getServiceDebugInfo() override;
+    std::vector<sp<IBinder>> getServices(const std::vector<String16>& names) override;
     // for legacy ABI
     const String16& getInterfaceDescriptor() const override {
         return mUnifiedServiceManager->getInterfaceDescriptor();
@@ -823,6 +833,27 @@ std::vector<IServiceManager::ServiceDebugInfo> CppBackendShim::getServiceDebugIn
     return ret;
 }
 
+std::vector<sp<IBinder>> CppBackendShim::getServices(const std::vector<String16>& names) {
+    std::vector<std::string> names8;
+    names8.reserve(names.size());
+    for (const String16& name : names) {
+        names8.push_back(String8(name).c_str());
+    }
+
+    std::vector<Service> services;
+    if (Status status = mUnifiedServiceManager->getServices(names8, &services); !status.isOk()) {
+        ALOGW("%s Failed to get services: %s", __FUNCTION__, status.toString8().c_str());
+        return std::vector<sp<IBinder>>(names.size());
+    }
+
+    std::vector<sp<IBinder>> ret;
+    ret.reserve(services.size());
+    for (const Service& service : services) {
+        ret.push_back(service.get<Service::Tag::binder>());
+    }
+    return ret;
+}
+
 #ifndef __ANDROID__
 // CppBackendShim for host. Implements the old libbinder android::IServiceManager API.
 // The internal implementation of the AIDL interface android::os::IServiceManager calls into
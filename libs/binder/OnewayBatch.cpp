@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OnewayBatch"
+
+#include "OnewayBatch.h"
+
+#include <binder/BpBinder.h>
+#include <binder/IPCThreadState.h>
+#include <utils/Log.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace android {
+
+namespace {
+
+// Sends the batches whose window has elapsed, on a thread started by the first batch.
+class Flusher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static Flusher& get() {
+        // Leaked, since the thread never exits.
+        static Flusher* const sFlusher = new Flusher;
+        return *sFlusher;
+    }
+
+    void schedule(Clock::time_point deadline, const wp<BpBinder>& binder) {
+        std::lock_guard _l(mLock);
+        if (!mStarted) {
+            std::thread([this] { loop(); }).detach();
+            mStarted = true;
+        }
+        const bool earliest = mDeadlines.empty() || deadline < mDeadlines.begin()->first;
+        mDeadlines.emplace(deadline, binder);
+        if (earliest) mCondition.notify_one();
+    }
+
+private:
+    void loop() {
+        std::unique_lock _l(mLock);
+        for (;;) {
+            if (mDeadlines.empty()) {
+                mCondition.wait(_l);
+                continue;
+            }
+
+            auto it = mDeadlines.begin();
+            if (Clock::now() < it->first) {
+                mCondition.wait_until(_l, it->first);
+                continue;
+            }
+
+            wp<BpBinder> binder = std::move(it->second);
+            mDeadlines.erase(it);
+
+            _l.unlock();
+            // Already flushed if the last strong reference is gone.
+            if (sp<BpBinder> strong = binder.promote(); strong != nullptr) {
+                (void)strong->flushOnewayBatch();
+            }
+            _l.lock();
+        }
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::multimap<Clock::time_point, wp<BpBinder>> mDeadlines;
+    bool mStarted = false;
+};
+
+} // namespace
+
+bool OnewayBatch::isBatchable(uint32_t code, const Parcel& data, uint32_t flags) {
+    return flags == IBinder::FLAG_ONEWAY && code >= IBinder::FIRST_CALL_TRANSACTION &&
+            code <= IBinder::LAST_CALL_TRANSACTION && data.objectsCount() == 0;
+}
+
+void OnewayBatch::setLimits(std::chrono::microseconds window, size_t maxBytes) {
+    RpcMutexLockGuard _l(mLock);
+    mWindow = window;
+    mMaxBytes = maxBytes;
+}
+
+status_t OnewayBatch::append(const wp<BpBinder>& binder, int32_t handle, uint32_t code,
+                             const Parcel& data) {
+    RpcMutexLockGuard _l(mLock);
+
+    // Code and size of each call.
+    constexpr size_t kCallHeaderSize = 2 * sizeof(uint32_t);
+    const size_t callSize = kCallHeaderSize + data.dataSize();
+
+    status_t status = OK;
+    if (mCount > 0 && mCalls.dataSize() + callSize > mMaxBytes) {
+        status = flushLocked(handle);
+    }
+    // Count of calls, and the call.
+    if (sizeof(uint32_t) + callSize > mMaxBytes) {
+        return IPCThreadState::self()->transact(handle, code, data, nullptr, IBinder::FLAG_ONEWAY);
+    }
+
+    if (mCount == 0) {
+        mCalls.setDataSize(0);
+        mCalls.setDataPosition(0);
+        // Count of calls, written when the batch is sent.
+        mCalls.writeUint32(0);
+        Flusher::get().schedule(std::chrono::steady_clock::now() + mWindow, binder);
+    }
+    mCalls.writeUint32(code);
+    mCalls.writeUint32(static_cast<uint32_t>(data.dataSize()));
+    mCalls.write(data.data(), data.dataSize());
+    mCount++;
+
+    return status;
+}
+
+status_t OnewayBatch::flush(int32_t handle) {
+    RpcMutexLockGuard _l(mLock);
+    return flushLocked(handle);
+}
+
+status_t OnewayBatch::flushLocked(int32_t handle) {
+    if (mCount == 0) return OK;
+
+    const size_t size = mCalls.dataSize();
+    mCalls.setDataPosition(0);
+    mCalls.writeUint32(mCount);
+    mCalls.setDataPosition(size);
+    mCount = 0;
+
+    // Sent under the lock, so that batches are sent in order. Oneway transactions do not block.
+    status_t status = IPCThreadState::self()->transact(handle, IBinder::BATCH_TRANSACTION, mCalls,
+                                                       nullptr, IBinder::FLAG_ONEWAY);
+    ALOGW_IF(status != OK, "Failed to send batch of oneway transactions: %s",
+             statusToString(status).c_str());
+    return status;
+}
+
+} // namespace android
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <binder/Parcel.h>
+#include <binder/RpcThreads.h>
+#include <utils/RefBase.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace android {
+
+class BpBinder;
+
+// Oneway transactions to a kernel BpBinder, queued to be sent as one BATCH_TRANSACTION. See
+// BpBinder::setOnewayBatching.
+//
+// The batch is a count, followed by the code, size and data of each call. BBinder unpacks it and
+// executes the calls in order.
+class OnewayBatch {
+public:
+    // Whether a transaction can join a batch. It must be a oneway user call, and it must not carry
+    // any objects, since they would reference offsets into its own parcel.
+    static bool isBatchable(uint32_t code, const Parcel& data, uint32_t flags);
+
+    void setLimits(std::chrono::microseconds window, size_t maxBytes);
+
+    // Queues a call, first sending the pending calls if the call would not fit with them, or sends
+    // it on its own if it does not fit in an empty batch either. The batch is sent within the
+    // window of its first call at the latest.
+    status_t append(const wp<BpBinder>& binder, int32_t handle, uint32_t code, const Parcel& data);
+
+    // Sends the pending calls, if any.
+    status_t flush(int32_t handle);
+
+private:
+    status_t flushLocked(int32_t handle);
+
+    RpcMutex mLock;
+    std::chrono::microseconds mWindow{0};
+    size_t mMaxBytes = 0;
+    Parcel mCalls;
+    uint32_t mCount = 0;
+};
+
+} // namespace android
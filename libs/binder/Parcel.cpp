@@ -581,8 +581,7 @@ status_t Parcel::appendFrom(const Parcel* parcel, size_t offset, size_t len) {
                     return NO_MEMORY; // overflow
                 size_t newSize = ((kernelFields->mObjectsSize + numObjects) * 3) / 2;
                 if (newSize > SIZE_MAX / sizeof(binder_size_t)) return NO_MEMORY; // overflow
-                binder_size_t* objects = (binder_size_t*)realloc(kernelFields->mObjects,
-                                                                 newSize * sizeof(binder_size_t));
+                binder_size_t* objects = reallocObjects(newSize);
                 if (objects == (binder_size_t*)nullptr) {
                     return NO_MEMORY;
                 }
@@ -1829,8 +1828,7 @@ restart_write:
         if ((kernelFields->mObjectsSize + 2) > SIZE_MAX / 3) return NO_MEMORY; // overflow
         size_t newSize = ((kernelFields->mObjectsSize + 2) * 3) / 2;
         if (newSize > SIZE_MAX / sizeof(binder_size_t)) return NO_MEMORY; // overflow
-        binder_size_t* objects =
-                (binder_size_t*)realloc(kernelFields->mObjects, newSize * sizeof(binder_size_t));
+        binder_size_t* objects = reallocObjects(newSize);
         if (objects == nullptr) return NO_MEMORY;
         kernelFields->mObjects = objects;
         kernelFields->mObjectsCapacity = newSize;
@@ -2933,10 +2931,9 @@ void Parcel::freeDataNoInit()
             if (mDeallocZero) {
                 zeroMemory(mData, mDataSize);
             }
-            free(mData);
+            if (!isInlineData()) free(mData);
         }
-        auto* kernelFields = maybeKernelFields();
-        if (kernelFields && kernelFields->mObjects) free(kernelFields->mObjects);
+        if (maybeKernelFields()) freeObjects();
     }
 }
 
@@ -2971,6 +2968,44 @@ static uint8_t* reallocZeroFree(uint8_t* data, size_t oldCapacity, size_t newCap
     return newData;
 }
 
+uint8_t* Parcel::reallocData(size_t desired) {
+    if (mData != nullptr && !isInlineData()) {
+        return reallocZeroFree(mData, mDataCapacity, desired, mDeallocZero);
+    }
+
+    if (desired > 0 && desired <= kInlineDataCapacity) return mInlineData;
+
+    uint8_t* data = desired > 0 ? (uint8_t*)malloc(desired) : nullptr;
+    if (mData && (data || desired == 0)) {
+        if (data) memcpy(data, mData, std::min(mDataCapacity, desired));
+        if (mDeallocZero) zeroMemory(mData, mDataCapacity);
+    }
+    return data;
+}
+
+binder_size_t* Parcel::reallocObjects(size_t capacity) {
+    auto* kernelFields = maybeKernelFields();
+    binder_size_t* objects = kernelFields->mObjects;
+    if (objects != nullptr && objects != mInlineObjects) {
+        return (binder_size_t*)realloc(objects, capacity * sizeof(binder_size_t));
+    }
+
+    if (capacity <= kInlineObjectsCapacity) return mInlineObjects;
+
+    auto* heapObjects = (binder_size_t*)malloc(capacity * sizeof(binder_size_t));
+    if (heapObjects && objects) {
+        memcpy(heapObjects, objects,
+               std::min(kernelFields->mObjectsSize, capacity) * sizeof(binder_size_t));
+    }
+    return heapObjects;
+}
+
+void Parcel::freeObjects() {
+    auto* kernelFields = maybeKernelFields();
+    if (kernelFields->mObjects != mInlineObjects) free(kernelFields->mObjects);
+    kernelFields->mObjects = nullptr;
+}
+
 status_t Parcel::restartWrite(size_t desired)
 {
     if (desired > INT32_MAX) {
@@ -2986,7 +3021,7 @@ status_t Parcel::restartWrite(size_t desired)
 
     releaseObjects();
 
-    uint8_t* data = reallocZeroFree(mData, mDataCapacity, desired, mDeallocZero);
+    uint8_t* data = reallocData(desired);
     if (!data && desired > mDataCapacity) {
         LOG_ALWAYS_FATAL("out of memory");
         mError = NO_MEMORY;
@@ -3013,8 +3048,7 @@ status_t Parcel::restartWrite(size_t desired)
     ALOGV("restartWrite Setting data pos of %p to %zu", this, mDataPos);
 
     if (auto* kernelFields = maybeKernelFields()) {
-        free(kernelFields->mObjects);
-        kernelFields->mObjects = nullptr;
+        freeObjects();
         kernelFields->mObjectsSize = kernelFields->mObjectsCapacity = 0;
         kernelFields->mNextObjectHint = 0;
         kernelFields->mObjectsSorted = false;
@@ -3071,7 +3105,7 @@ status_t Parcel::continueWrite(size_t desired)
 
         // If there is a different owner, we need to take
         // posession.
-        uint8_t* data = (uint8_t*)malloc(desired);
+        uint8_t* data = desired <= kInlineDataCapacity ? mInlineData : (uint8_t*)malloc(desired);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -3079,9 +3113,11 @@ status_t Parcel::continueWrite(size_t desired)
         binder_size_t* objects = nullptr;
 
         if (kernelFields && objectsSize) {
-            objects = (binder_size_t*)calloc(objectsSize, sizeof(binder_size_t));
+            objects = objectsSize <= kInlineObjectsCapacity
+                    ? mInlineObjects
+                    : (binder_size_t*)calloc(objectsSize, sizeof(binder_size_t));
             if (!objects) {
-                free(data);
+                if (data != mInlineData) free(data);
 
                 mError = NO_MEMORY;
                 return NO_MEMORY;
@@ -3096,7 +3132,7 @@ status_t Parcel::continueWrite(size_t desired)
         }
         if (rpcFields) {
             if (status_t status = truncateRpcObjects(objectsSize); status != OK) {
-                free(data);
+                if (data != mInlineData) free(data);
                 return status;
             }
         }
@@ -3148,13 +3184,10 @@ status_t Parcel::continueWrite(size_t desired)
             }
 
             if (objectsSize == 0) {
-                free(kernelFields->mObjects);
-                kernelFields->mObjects = nullptr;
+                freeObjects();
                 kernelFields->mObjectsCapacity = 0;
             } else {
-                binder_size_t* objects =
-                        (binder_size_t*)realloc(kernelFields->mObjects,
-                                                objectsSize * sizeof(binder_size_t));
+                binder_size_t* objects = reallocObjects(objectsSize);
                 if (objects) {
                     kernelFields->mObjects = objects;
                     kernelFields->mObjectsCapacity = objectsSize;
@@ -3175,7 +3208,7 @@ status_t Parcel::continueWrite(size_t desired)
 
         // We own the data, so we can just do a realloc().
         if (desired > mDataCapacity) {
-            uint8_t* data = reallocZeroFree(mData, mDataCapacity, desired, mDeallocZero);
+            uint8_t* data = reallocData(desired);
             if (data) {
                 LOG_ALLOC("Parcel %p: continue from %zu to %zu capacity", this, mDataCapacity,
                         desired);
@@ -3200,7 +3233,7 @@ status_t Parcel::continueWrite(size_t desired)
 
     } else {
         // This is the first data.  Easy!
-        uint8_t* data = (uint8_t*)malloc(desired);
+        uint8_t* data = desired <= kInlineDataCapacity ? mInlineData : (uint8_t*)malloc(desired);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
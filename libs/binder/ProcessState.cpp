@@ -42,6 +42,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <algorithm>
 #include <mutex>
 
 #define BINDER_VM_SIZE ((1 * 1024 * 1024) - sysconf(_SC_PAGE_SIZE) * 2)
@@ -441,8 +442,11 @@ void ProcessState::spawnPooledThread(bool isMain)
 status_t ProcessState::setThreadPoolMaxThreadCount(size_t maxThreads) {
     LOG_ALWAYS_FATAL_IF(mThreadPoolStarted && maxThreads < mMaxThreads,
            "Binder threadpool cannot be shrunk after starting");
+    std::unique_lock<std::mutex> _l(mLock);
     status_t result = NO_ERROR;
-    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &maxThreads) != -1) {
+    // The kernel counts the threads that retired as started. See setThreadPoolIdleTimeout.
+    size_t kernelMaxThreads = maxThreads + mRetiredThreads;
+    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &kernelMaxThreads) != -1) {
         mMaxThreads = maxThreads;
     } else {
         result = -errno;
@@ -451,6 +455,92 @@ status_t ProcessState::setThreadPoolMaxThreadCount(size_t maxThreads) {
     return result;
 }
 
+void ProcessState::setThreadPoolIdleTimeout(std::chrono::milliseconds idleTimeout) {
+    mLastBusyTime = std::chrono::steady_clock::now();
+    mIdleTimeout = idleTimeout;
+}
+
+ProcessState::ThreadPoolStats ProcessState::getThreadPoolStats() const {
+    ThreadPoolStats stats{
+            .currentThreads = mCurrentThreads,
+            .executingThreads = mExecutingThreadsCount,
+            .peakExecutingThreads = mPeakExecutingThreads,
+            .retiredThreads = mRetiredThreads,
+            .saturationCount = mSaturationCount,
+            .totalSaturationTime = std::chrono::nanoseconds(mTotalSaturationNs.load()),
+            .maxSaturationTime = std::chrono::nanoseconds(mMaxSaturationNs.load()),
+    };
+
+    // Include the ongoing saturation, if any.
+    auto saturationStartTime = mSaturationStartTime.load();
+    if (saturationStartTime != never()) {
+        auto saturationTime = std::chrono::steady_clock::now() - saturationStartTime;
+        stats.saturationCount++;
+        stats.totalSaturationTime += saturationTime;
+        stats.maxSaturationTime = std::max<std::chrono::nanoseconds>(stats.maxSaturationTime,
+                                                                     saturationTime);
+    }
+    return stats;
+}
+
+void ProcessState::onCommandStarted(size_t executing) {
+    size_t peak = mPeakExecutingThreads.load(std::memory_order_relaxed);
+    while (executing > peak &&
+           !mPeakExecutingThreads.compare_exchange_weak(peak, executing,
+                                                        std::memory_order_relaxed)) {
+    }
+
+    if (executing >= mCurrentThreads) {
+        auto expected = never();
+        mSaturationStartTime.compare_exchange_strong(expected, std::chrono::steady_clock::now());
+    }
+}
+
+void ProcessState::onCommandFinished() {
+    if (mSaturationStartTime.load(std::memory_order_relaxed) == never()) return;
+
+    auto saturationStartTime = mSaturationStartTime.exchange(never());
+    if (saturationStartTime == never()) return;
+
+    auto now = std::chrono::steady_clock::now();
+    int64_t saturationNs =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - saturationStartTime).count();
+    mSaturationCount++;
+    mTotalSaturationNs += saturationNs;
+    int64_t maxNs = mMaxSaturationNs.load(std::memory_order_relaxed);
+    while (saturationNs > maxNs &&
+           !mMaxSaturationNs.compare_exchange_weak(maxNs, saturationNs,
+                                                   std::memory_order_relaxed)) {
+    }
+    mLastBusyTime = now;
+}
+
+bool ProcessState::shouldRetireThread() {
+    auto idleTimeout = mIdleTimeout.load(std::memory_order_relaxed);
+    if (idleTimeout == std::chrono::milliseconds::zero()) return false;
+
+    // Keep another idle thread besides the calling one, so that the next command does not have
+    // to wait for the kernel to start a thread.
+    if (mCurrentThreads - mExecutingThreadsCount < 2) return false;
+    if (mSaturationStartTime.load() != never()) return false;
+
+    auto now = std::chrono::steady_clock::now();
+    auto lastBusyTime = mLastBusyTime.load();
+    if (now - lastBusyTime < idleTimeout) return false;
+    // Lets only one thread retire per idle timeout.
+    if (!mLastBusyTime.compare_exchange_strong(lastBusyTime, now)) return false;
+
+    std::unique_lock<std::mutex> _l(mLock);
+    size_t kernelMaxThreads = mMaxThreads + mRetiredThreads + 1;
+    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &kernelMaxThreads) == -1) {
+        ALOGE("Binder ioctl to set max threads failed: %s", strerror(errno));
+        return false;
+    }
+    mRetiredThreads++;
+    mKernelStartedThreads--;
+    return true;
+}
+
 size_t ProcessState::getThreadPoolMaxTotalThreadCount() const {
     // Need to read `mKernelStartedThreads` before `mThreadPoolStarted` (with
     // non-relaxed memory ordering) to avoid a race like the following:
@@ -579,6 +669,14 @@ ProcessState::ProcessState(const char* driver)
         mCurrentThreads(0),
         mKernelStartedThreads(0),
         mStarvationStartTime(never()),
+        mSaturationStartTime(never()),
+        mLastBusyTime(never()),
+        mPeakExecutingThreads(0),
+        mSaturationCount(0),
+        mTotalSaturationNs(0),
+        mMaxSaturationNs(0),
+        mIdleTimeout(std::chrono::milliseconds::zero()),
+        mRetiredThreads(0),
         mForked(false),
         mThreadPoolStarted(false),
         mThreadPoolSeq(1),
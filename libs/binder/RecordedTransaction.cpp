@@ -24,6 +24,8 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <algorithm>
+#include <cstring>
+#include <vector>
 
 using namespace android::binder::impl;
 using android::Parcel;
@@ -111,6 +113,8 @@ static_assert(PADDING8(8) == 0);
 //
 // No effort is made to ensure the expected chunks are present. A single
 // End Chunk may therefore produce an empty, meaningless RecordedTransaction.
+//
+// A recording may also be compressed, as described in TransactionRecorder.cpp.
 
 RecordedTransaction::RecordedTransaction(RecordedTransaction&& t) noexcept {
     mData = t.mData;
@@ -176,6 +180,17 @@ static_assert(sizeof(ChunkDescriptor) % 8 == 0);
 constexpr uint32_t kMaxChunkDataSize = 0xfffffff0;
 typedef uint64_t transaction_checksum_t;
 
+// XOR of the 64-bit words of data, whose size is a multiple of 8.
+static transaction_checksum_t checksumOf(const uint8_t* data, size_t size) {
+    transaction_checksum_t checksum = 0;
+    for (size_t offset = 0; offset < size; offset += sizeof(transaction_checksum_t)) {
+        transaction_checksum_t word;
+        memcpy(&word, data + offset, sizeof(word));
+        checksum ^= word;
+    }
+    return checksum;
+}
+
 std::optional<RecordedTransaction> RecordedTransaction::fromFile(const unique_fd& fd) {
     RecordedTransaction t;
     ChunkDescriptor chunk;
@@ -259,131 +274,177 @@ std::optional<RecordedTransaction> RecordedTransaction::fromFile(const unique_fd
             return std::nullopt;
         }
 
-        switch (chunk.chunkType) {
-            case HEADER_CHUNK: {
-                if (chunk.dataSize != static_cast<uint32_t>(sizeof(TransactionHeader))) {
-                    ALOGE("Header Chunk indicated size %" PRIu32 "; Expected %zu.", chunk.dataSize,
-                          sizeof(TransactionHeader));
-                    return std::nullopt;
-                }
-                t.mData.mHeader = *reinterpret_cast<TransactionHeader*>(payloadMap);
-                break;
-            }
-            case INTERFACE_NAME_CHUNK: {
-                t.mData.mInterfaceName =
-                        std::string(reinterpret_cast<char*>(payloadMap), chunk.dataSize);
-                break;
+        if (t.applyChunk(chunk.chunkType, chunk.dataSize,
+                         reinterpret_cast<const uint8_t*>(payloadMap)) != android::NO_ERROR) {
+            return std::nullopt;
+        }
+    } while (chunk.chunkType != END_CHUNK);
+
+    return std::optional<RecordedTransaction>(std::move(t));
+}
+
+android::status_t RecordedTransaction::fromBuffer(
+        const uint8_t* data, size_t size, std::optional<RecordedTransaction>* outTransaction,
+        size_t* outConsumed) {
+    RecordedTransaction t;
+    size_t position = 0;
+    ChunkDescriptor chunk;
+    do {
+        if (size - position < sizeof(ChunkDescriptor)) return NOT_ENOUGH_DATA;
+        memcpy(&chunk, data + position, sizeof(ChunkDescriptor));
+
+        if (chunk.dataSize > kMaxChunkDataSize) {
+            ALOGE("Chunk data exceeds maximum size.");
+            return BAD_VALUE;
+        }
+        const size_t chunkSize = sizeof(ChunkDescriptor) + chunk.dataSize +
+                PADDING8(chunk.dataSize) + sizeof(transaction_checksum_t);
+        if (size - position < chunkSize) return NOT_ENOUGH_DATA;
+
+        if (checksumOf(data + position, chunkSize) != 0) {
+            ALOGE("Checksum failed.");
+            return BAD_VALUE;
+        }
+        if (status_t status = t.applyChunk(chunk.chunkType, chunk.dataSize,
+                                           data + position + sizeof(ChunkDescriptor));
+            status != NO_ERROR) {
+            return status;
+        }
+        position += chunkSize;
+    } while (chunk.chunkType != END_CHUNK);
+
+    outTransaction->emplace(std::move(t));
+    *outConsumed = position;
+    return NO_ERROR;
+}
+
+android::status_t RecordedTransaction::applyChunk(uint32_t chunkType, uint32_t dataSize,
+                                                  const uint8_t* data) {
+    switch (chunkType) {
+        case HEADER_CHUNK: {
+            if (dataSize != static_cast<uint32_t>(sizeof(TransactionHeader))) {
+                ALOGE("Header Chunk indicated size %" PRIu32 "; Expected %zu.", dataSize,
+                      sizeof(TransactionHeader));
+                return BAD_VALUE;
             }
-            case DATA_PARCEL_CHUNK: {
-                if (t.mSentDataOnly.setData(reinterpret_cast<const unsigned char*>(payloadMap),
-                                            chunk.dataSize) != android::NO_ERROR) {
-                    ALOGE("Failed to set sent parcel data.");
-                    return std::nullopt;
-                }
-                break;
+            memcpy(&mData.mHeader, data, sizeof(TransactionHeader));
+            break;
+        }
+        case INTERFACE_NAME_CHUNK: {
+            mData.mInterfaceName = std::string(reinterpret_cast<const char*>(data), dataSize);
+            break;
+        }
+        case DATA_PARCEL_CHUNK: {
+            if (mSentDataOnly.setData(data, dataSize) != android::NO_ERROR) {
+                ALOGE("Failed to set sent parcel data.");
+                return BAD_VALUE;
             }
-            case REPLY_PARCEL_CHUNK: {
-                if (t.mReplyDataOnly.setData(reinterpret_cast<const unsigned char*>(payloadMap),
-                                             chunk.dataSize) != android::NO_ERROR) {
-                    ALOGE("Failed to set reply parcel data.");
-                    return std::nullopt;
-                }
-                break;
+            break;
+        }
+        case REPLY_PARCEL_CHUNK: {
+            if (mReplyDataOnly.setData(data, dataSize) != android::NO_ERROR) {
+                ALOGE("Failed to set reply parcel data.");
+                return BAD_VALUE;
             }
-            case DATA_PARCEL_OBJECT_CHUNK: {
-                const uint64_t* objects = reinterpret_cast<const uint64_t*>(payloadMap);
-                size_t metaDataSize = (chunk.dataSize / sizeof(uint64_t));
-                ALOGI("Total objects found in saved parcel %zu", metaDataSize);
-                for (size_t index = 0; index < metaDataSize; ++index) {
-                    t.mData.mSentObjectData.push_back(objects[index]);
-                }
-                break;
+            break;
+        }
+        case DATA_PARCEL_OBJECT_CHUNK: {
+            size_t metaDataSize = (dataSize / sizeof(uint64_t));
+            ALOGI("Total objects found in saved parcel %zu", metaDataSize);
+            for (size_t index = 0; index < metaDataSize; ++index) {
+                uint64_t object;
+                memcpy(&object, data + index * sizeof(uint64_t), sizeof(uint64_t));
+                mData.mSentObjectData.push_back(object);
             }
-            case END_CHUNK:
-                break;
-            default:
-                ALOGI("Unrecognized chunk.");
-                break;
+            break;
         }
-    } while (chunk.chunkType != END_CHUNK);
-
-    return std::optional<RecordedTransaction>(std::move(t));
+        case END_CHUNK:
+            break;
+        default:
+            ALOGI("Unrecognized chunk.");
+            break;
+    }
+    return NO_ERROR;
 }
 
-android::status_t RecordedTransaction::writeChunk(borrowed_fd fd, uint32_t chunkType,
-                                                  size_t byteCount, const uint8_t* data) const {
+android::status_t RecordedTransaction::appendChunk(std::vector<uint8_t>* out, uint32_t chunkType,
+                                                   size_t byteCount, const uint8_t* data) {
     if (byteCount > kMaxChunkDataSize) {
         ALOGE("Chunk data exceeds maximum size");
         return BAD_VALUE;
     }
     ChunkDescriptor descriptor = {.chunkType = chunkType,
                                   .dataSize = static_cast<uint32_t>(byteCount)};
-    // Prepare Chunk content as byte *
-    const std::byte* descriptorBytes = reinterpret_cast<const std::byte*>(&descriptor);
-    const std::byte* dataBytes = reinterpret_cast<const std::byte*>(data);
-
-    // Add Chunk to intermediate buffer, except checksum
-    std::vector<std::byte> buffer;
-    buffer.insert(buffer.end(), descriptorBytes, descriptorBytes + sizeof(ChunkDescriptor));
-    buffer.insert(buffer.end(), dataBytes, dataBytes + byteCount);
-    std::byte zero{0};
-    buffer.insert(buffer.end(), PADDING8(byteCount), zero);
-
-    // Calculate checksum from buffer
-    transaction_checksum_t* checksumData = reinterpret_cast<transaction_checksum_t*>(buffer.data());
-    transaction_checksum_t checksumValue = 0;
-    for (size_t idx = 0; idx < (buffer.size() / sizeof(transaction_checksum_t)); idx++) {
-        checksumValue ^= checksumData[idx];
-    }
-
-    // Write checksum to buffer
-    std::byte* checksumBytes = reinterpret_cast<std::byte*>(&checksumValue);
-    buffer.insert(buffer.end(), checksumBytes, checksumBytes + sizeof(transaction_checksum_t));
-
-    // Write buffer to file
-    if (!WriteFully(fd, buffer.data(), buffer.size())) {
-        ALOGE("Failed to write chunk fd %d", fd.get());
-        return UNKNOWN_ERROR;
-    }
+    const uint8_t* descriptorBytes = reinterpret_cast<const uint8_t*>(&descriptor);
+
+    // Add Chunk to the buffer, except checksum
+    const size_t chunkStart = out->size();
+    out->insert(out->end(), descriptorBytes, descriptorBytes + sizeof(ChunkDescriptor));
+    if (byteCount > 0) out->insert(out->end(), data, data + byteCount);
+    out->insert(out->end(), PADDING8(byteCount), 0);
+
+    // Calculate checksum from the chunk, then append it
+    transaction_checksum_t checksumValue =
+            checksumOf(out->data() + chunkStart, out->size() - chunkStart);
+    const uint8_t* checksumBytes = reinterpret_cast<const uint8_t*>(&checksumValue);
+    out->insert(out->end(), checksumBytes, checksumBytes + sizeof(transaction_checksum_t));
     return NO_ERROR;
 }
 
-android::status_t RecordedTransaction::dumpToFile(const unique_fd& fd) const {
+android::status_t RecordedTransaction::appendTo(std::vector<uint8_t>* out) const {
+    const size_t start = out->size();
+    // Drops the partial transaction on failure.
+    auto guard = make_scope_guard([out, start] { out->resize(start); });
+
     if (NO_ERROR !=
-        writeChunk(fd, HEADER_CHUNK, sizeof(TransactionHeader),
-                   reinterpret_cast<const uint8_t*>(&(mData.mHeader)))) {
-        ALOGE("Failed to write transactionHeader to fd %d", fd.get());
+        appendChunk(out, HEADER_CHUNK, sizeof(TransactionHeader),
+                    reinterpret_cast<const uint8_t*>(&(mData.mHeader)))) {
+        ALOGE("Failed to write transactionHeader");
         return UNKNOWN_ERROR;
     }
     if (NO_ERROR !=
-        writeChunk(fd, INTERFACE_NAME_CHUNK, mData.mInterfaceName.size() * sizeof(uint8_t),
-                   reinterpret_cast<const uint8_t*>(mData.mInterfaceName.c_str()))) {
-        ALOGI("Failed to write Interface Name Chunk to fd %d", fd.get());
+        appendChunk(out, INTERFACE_NAME_CHUNK, mData.mInterfaceName.size() * sizeof(uint8_t),
+                    reinterpret_cast<const uint8_t*>(mData.mInterfaceName.c_str()))) {
+        ALOGI("Failed to write Interface Name Chunk");
         return UNKNOWN_ERROR;
     }
 
     if (NO_ERROR !=
-        writeChunk(fd, DATA_PARCEL_CHUNK, mSentDataOnly.dataBufferSize(), mSentDataOnly.data())) {
-        ALOGE("Failed to write sent Parcel to fd %d", fd.get());
+        appendChunk(out, DATA_PARCEL_CHUNK, mSentDataOnly.dataBufferSize(),
+                    mSentDataOnly.data())) {
+        ALOGE("Failed to write sent Parcel");
         return UNKNOWN_ERROR;
     }
 
     if (NO_ERROR !=
-        writeChunk(fd, REPLY_PARCEL_CHUNK, mReplyDataOnly.dataBufferSize(),
-                   mReplyDataOnly.data())) {
-        ALOGE("Failed to write reply Parcel to fd %d", fd.get());
+        appendChunk(out, REPLY_PARCEL_CHUNK, mReplyDataOnly.dataBufferSize(),
+                    mReplyDataOnly.data())) {
+        ALOGE("Failed to write reply Parcel");
         return UNKNOWN_ERROR;
     }
 
     if (NO_ERROR !=
-        writeChunk(fd, DATA_PARCEL_OBJECT_CHUNK, mData.mSentObjectData.size() * sizeof(uint64_t),
-                   reinterpret_cast<const uint8_t*>(mData.mSentObjectData.data()))) {
-        ALOGE("Failed to write sent parcel object metadata to fd %d", fd.get());
+        appendChunk(out, DATA_PARCEL_OBJECT_CHUNK, mData.mSentObjectData.size() * sizeof(uint64_t),
+                    reinterpret_cast<const uint8_t*>(mData.mSentObjectData.data()))) {
+        ALOGE("Failed to write sent parcel object metadata");
         return UNKNOWN_ERROR;
     }
 
-    if (NO_ERROR != writeChunk(fd, END_CHUNK, 0, nullptr)) {
-        ALOGE("Failed to write end chunk to fd %d", fd.get());
+    if (NO_ERROR != appendChunk(out, END_CHUNK, 0, nullptr)) {
+        ALOGE("Failed to write end chunk");
+        return UNKNOWN_ERROR;
+    }
+    guard.release();
+    return NO_ERROR;
+}
+
+android::status_t RecordedTransaction::dumpToFile(const unique_fd& fd) const {
+    std::vector<uint8_t> buffer;
+    if (status_t status = appendTo(&buffer); status != NO_ERROR) {
+        return status;
+    }
+    if (!WriteFully(fd, buffer.data(), buffer.size())) {
+        ALOGE("Failed to write transaction to fd %d", fd.get());
         return UNKNOWN_ERROR;
     }
     return NO_ERROR;
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcEventLoop"
+
+#include "RpcEventLoop.h"
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+
+#include <log/log.h>
+
+#include "FdTrigger.h"
+#include "RpcState.h"
+#include "Utils.h"
+
+// Single-threaded builds serve a connection when it is joined, so they have no event loop.
+#ifndef BINDER_RPC_SINGLE_THREADED
+
+namespace android {
+
+using android::binder::borrowed_fd;
+using android::binder::unique_fd;
+
+namespace {
+// The data of an epoll event is the ID of a connection, shifted left by one, with the low bit set
+// for the shutdown trigger of its session rather than for its socket.
+constexpr uint64_t kShutdownEventBit = 1;
+// The shutdown trigger of the event loop itself.
+constexpr uint64_t kEventLoopShutdownData = UINT64_MAX;
+
+constexpr uint32_t kSocketEvents = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+} // namespace
+
+std::shared_ptr<RpcEventLoop> RpcEventLoop::make(size_t threads) {
+    LOG_ALWAYS_FATAL_IF(threads == 0, "RpcEventLoop is useless without threads");
+
+    std::shared_ptr<RpcEventLoop> loop(new RpcEventLoop());
+    loop->mEpoll.reset(epoll_create1(EPOLL_CLOEXEC));
+    if (!loop->mEpoll.ok()) {
+        ALOGE("Could not create epoll: %s", strerror(errno));
+        return nullptr;
+    }
+    loop->mShutdownTrigger = FdTrigger::make();
+    if (loop->mShutdownTrigger == nullptr) return nullptr;
+
+    // Not one-shot, so that every thread wakes up once the trigger is hung up.
+    epoll_event event{.events = 0, .data = {.u64 = kEventLoopShutdownData}};
+    if (epoll_ctl(loop->mEpoll.get(), EPOLL_CTL_ADD, loop->mShutdownTrigger->pollFd().get(),
+                  &event) != 0) {
+        ALOGE("Could not watch event loop shutdown trigger: %s", strerror(errno));
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        loop->mThreads.emplace_back(&RpcEventLoop::threadMain, loop.get());
+    }
+    return loop;
+}
+
+RpcEventLoop::~RpcEventLoop() {
+    shutdown();
+}
+
+void RpcEventLoop::join(sp<RpcSession>&& session, RpcSession::PreJoinSetupResult&& setupResult,
+                        borrowed_fd fd) {
+    // The thread which set up the connection does not wait on it.
+    session->endJoinThreadOwnership();
+
+    Connection connection{
+            .session = std::move(session),
+            .connection = std::move(setupResult.connection),
+            .fd = fd,
+    };
+    if (setupResult.status != OK) {
+        ALOGE("Connection failed to init, closing with status %s",
+              statusToString(setupResult.status).c_str());
+        end(std::move(connection));
+        return;
+    }
+    LOG_ALWAYS_FATAL_IF(connection.connection == nullptr,
+                        "must have connection if setup succeeded");
+    connection.session->clearConnectionTid(connection.connection);
+
+    connection.shutdownFd.reset(
+            fcntl(connection.session->mShutdownTrigger->pollFd().get(), F_DUPFD_CLOEXEC, 0));
+    if (!connection.shutdownFd.ok()) {
+        ALOGE("Could not duplicate session shutdown trigger: %s", strerror(errno));
+        end(std::move(connection));
+        return;
+    }
+
+    RpcMutexUniqueLock _l(mLock);
+    if (mShutdown) {
+        _l.unlock();
+        end(std::move(connection));
+        return;
+    }
+
+    const uint64_t id = mNextId++;
+    epoll_event socketEvent{.events = kSocketEvents, .data = {.u64 = id << 1}};
+    epoll_event shutdownEvent{.events = EPOLLONESHOT,
+                              .data = {.u64 = (id << 1) | kShutdownEventBit}};
+    // Both are added under mLock, so that an event is only seen once the connection is listed.
+    auto it = mConnections.emplace(id, std::move(connection)).first;
+    const bool watchingSocket =
+            epoll_ctl(mEpoll.get(), EPOLL_CTL_ADD, it->second.fd.get(), &socketEvent) == 0;
+    if (!watchingSocket ||
+        epoll_ctl(mEpoll.get(), EPOLL_CTL_ADD, it->second.shutdownFd.get(), &shutdownEvent) != 0) {
+        ALOGE("Could not watch connection: %s", strerror(errno));
+        if (watchingSocket) {
+            (void)epoll_ctl(mEpoll.get(), EPOLL_CTL_DEL, it->second.fd.get(), nullptr);
+        }
+        Connection failed = std::move(it->second);
+        mConnections.erase(it);
+        _l.unlock();
+        end(std::move(failed));
+    }
+}
+
+void RpcEventLoop::shutdown() {
+    {
+        RpcMutexLockGuard _l(mLock);
+        if (mShutdown) return;
+        mShutdown = true;
+    }
+
+    if (mShutdownTrigger != nullptr) mShutdownTrigger->trigger();
+    for (RpcMaybeThread& thread : mThreads) {
+        thread.join();
+    }
+    mThreads.clear();
+
+    // No thread serves the connections anymore.
+    std::map<uint64_t, Connection> connections;
+    {
+        RpcMutexLockGuard _l(mLock);
+        for (const auto& [id, connection] : mConnections) {
+            (void)id;
+            removeLocked(connection);
+        }
+        connections = std::move(mConnections);
+        mConnections.clear();
+    }
+    for (auto& [id, connection] : connections) {
+        (void)id;
+        end(std::move(connection));
+    }
+}
+
+void RpcEventLoop::threadMain() {
+    RpcSession::runAttachedToJavaVm([this] {
+        while (true) {
+            // One event at a time, so that the others are left to the threads which are idle.
+            epoll_event event;
+            int ret = TEMP_FAILURE_RETRY(epoll_wait(mEpoll.get(), &event, 1, -1));
+            if (ret < 0) {
+                ALOGE("epoll_wait failed, stopping event loop thread: %s", strerror(errno));
+                return;
+            }
+            if (ret == 0) continue;
+            if (event.data.u64 == kEventLoopShutdownData) return;
+            onEvent(event.data.u64);
+        }
+    });
+}
+
+void RpcEventLoop::onEvent(uint64_t data) {
+    const uint64_t id = data >> 1;
+    sp<RpcSession> session;
+    sp<RpcSession::RpcConnection> rpcConnection;
+    bool shutdown;
+    {
+        RpcMutexLockGuard _l(mLock);
+        auto it = mConnections.find(id);
+        // Ended after the event was read.
+        if (it == mConnections.end()) return;
+        Connection& connection = it->second;
+        if (data & kShutdownEventBit) connection.shutdown = true;
+        // The thread which serves it sees the shutdown once it is done.
+        if (connection.busy) return;
+        connection.busy = true;
+        session = connection.session;
+        rpcConnection = connection.connection;
+        shutdown = connection.shutdown;
+    }
+
+    status_t status = shutdown ? DEAD_OBJECT
+                               : RpcSession::executeArrivedCommands(session, rpcConnection);
+    if (status != OK) {
+        LOG_RPC_DETAIL("Binder connection closing w/ status %s", statusToString(status).c_str());
+    }
+
+    RpcMutexUniqueLock _l(mLock);
+    auto it = mConnections.find(id);
+    LOG_ALWAYS_FATAL_IF(it == mConnections.end(), "Busy connection was ended");
+    Connection& connection = it->second;
+    connection.busy = false;
+    if (status == OK && !connection.shutdown) {
+        epoll_event socketEvent{.events = kSocketEvents, .data = {.u64 = id << 1}};
+        if (epoll_ctl(mEpoll.get(), EPOLL_CTL_MOD, connection.fd.get(), &socketEvent) == 0) {
+            return;
+        }
+        ALOGE("Could not watch connection again: %s", strerror(errno));
+    }
+    removeLocked(connection);
+    Connection ended = std::move(connection);
+    mConnections.erase(it);
+    _l.unlock();
+    end(std::move(ended));
+}
+
+void RpcEventLoop::removeLocked(const Connection& connection) {
+    // The fds have to be removed before they are closed, since the shutdown fd refers to the same
+    // file as the trigger, which stays open.
+    (void)epoll_ctl(mEpoll.get(), EPOLL_CTL_DEL, connection.fd.get(), nullptr);
+    (void)epoll_ctl(mEpoll.get(), EPOLL_CTL_DEL, connection.shutdownFd.get(), nullptr);
+}
+
+void RpcEventLoop::end(Connection&& connection) {
+    connection.shutdownFd.reset();
+    RpcSession::endIncomingConnection(std::move(connection.session), connection.connection);
+}
+
+} // namespace android
+
+#endif // BINDER_RPC_SINGLE_THREADED
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <binder/RpcSession.h>
+#include <binder/RpcThreads.h>
+#include <binder/unique_fd.h>
+
+namespace android {
+
+class FdTrigger;
+
+/**
+ * Serves the incoming connections of the sessions of an RpcServer from a fixed pool of threads,
+ * instead of a thread per connection which waits on it even while it is idle. The socket of each
+ * connection is watched with epoll, along with the shutdown trigger of its session, and the
+ * commands on it are only read and executed once it is readable.
+ *
+ * A connection is served by one thread at a time, which also serves the nested calls that the
+ * commands it executes make on the connection. Once the connection or its session is shut down,
+ * the connection is ended the way RpcSession::join ends it.
+ */
+class RpcEventLoop {
+public:
+    /** Returns nullptr for error case */
+    static std::shared_ptr<RpcEventLoop> make(size_t threads);
+    ~RpcEventLoop();
+
+    /**
+     * Takes over a connection which RpcServer set up on the calling thread, in place of
+     * RpcSession::join. |fd| is the socket of the transport of the connection.
+     */
+    void join(sp<RpcSession>&& session, RpcSession::PreJoinSetupResult&& setupResult,
+              binder::borrowed_fd fd);
+
+    /**
+     * Stops the threads, and ends the connections which are still served. Connections which join
+     * afterwards are ended right away.
+     */
+    void shutdown();
+
+private:
+    struct Connection {
+        sp<RpcSession> session;
+        sp<RpcSession::RpcConnection> connection;
+        binder::borrowed_fd fd;
+        // A duplicate of the poll fd of the shutdown trigger of the session, since epoll can only
+        // watch an fd once.
+        binder::unique_fd shutdownFd;
+        // Whether a thread is serving the connection, which is then the one to end it.
+        bool busy = false;
+        bool shutdown = false;
+    };
+
+    RpcEventLoop() = default;
+
+    void threadMain();
+    void onEvent(uint64_t data);
+    // Removes the connection from epoll. It is ended once mLock is released.
+    void removeLocked(const Connection& connection);
+    static void end(Connection&& connection);
+
+    binder::unique_fd mEpoll;
+    std::unique_ptr<FdTrigger> mShutdownTrigger;
+    std::vector<RpcMaybeThread> mThreads;
+
+    RpcMutex mLock; // for below
+    bool mShutdown = false;
+    uint64_t mNextId = 0;
+    std::map<uint64_t, Connection> mConnections;
+};
+
+} // namespace android
@@ -34,6 +34,7 @@
 #include "BuildFlags.h"
 #include "FdTrigger.h"
 #include "OS.h"
+#include "RpcEventLoop.h"
 #include "RpcSocketAddress.h"
 #include "RpcState.h"
 #include "RpcTransportUtils.h"
@@ -139,6 +140,17 @@ size_t RpcServer::getMaxThreads() {
     return mMaxThreads;
 }
 
+void RpcServer::setEventLoopThreads(size_t threads) {
+    LOG_ALWAYS_FATAL_IF(!kEnableRpcThreads && threads > 0,
+                        "Event loop is not supported on single-threaded libbinder");
+    LOG_ALWAYS_FATAL_IF(mJoinThreadRunning, "Cannot set event loop threads while running");
+    mEventLoopThreads = threads;
+}
+
+size_t RpcServer::getEventLoopThreads() {
+    return mEventLoopThreads;
+}
+
 bool RpcServer::setProtocolVersion(uint32_t version) {
     if (!RpcState::validateProtocolVersion(version)) {
         return false;
@@ -262,6 +274,12 @@ void RpcServer::join() {
         mJoinThreadRunning = true;
         mShutdownTrigger = FdTrigger::make();
         LOG_ALWAYS_FATAL_IF(mShutdownTrigger == nullptr, "Cannot create join signaler");
+        if constexpr (kEnableRpcThreads) {
+            if (mEventLoopThreads > 0) {
+                mEventLoop = RpcEventLoop::make(mEventLoopThreads);
+                LOG_ALWAYS_FATAL_IF(mEventLoop == nullptr, "Cannot create event loop");
+            }
+        }
     }
 
     status_t status;
@@ -293,10 +311,21 @@ void RpcServer::join() {
 
         {
             RpcMutexLockGuard _l(mLock);
+            std::function<void(sp<RpcSession>&&, RpcSession::PreJoinSetupResult&&)> joinFn =
+                    RpcSession::join;
+            if constexpr (kEnableRpcThreads) {
+                if (mEventLoop != nullptr) {
+                    joinFn = [eventLoop = mEventLoop, fd = borrowed_fd(clientSocket.fd.get())](
+                                     sp<RpcSession>&& session,
+                                     RpcSession::PreJoinSetupResult&& setupResult) {
+                        eventLoop->join(std::move(session), std::move(setupResult), fd);
+                    };
+                }
+            }
             RpcMaybeThread thread =
                     RpcMaybeThread(&RpcServer::establishConnection,
                                    sp<RpcServer>::fromExisting(this), std::move(clientSocket), addr,
-                                   addrLen, RpcSession::join);
+                                   addrLen, std::move(joinFn));
 
             auto& threadRef = mConnectingThreads[thread.get_id()];
             threadRef = std::move(thread);
@@ -348,6 +377,15 @@ bool RpcServer::shutdown() {
         }
     }
 
+    // The sessions have ended, so the threads of the event loop are idle, and none of them
+    // needs mLock anymore.
+    if constexpr (kEnableRpcThreads) {
+        if (mEventLoop != nullptr) {
+            mEventLoop->shutdown();
+            mEventLoop = nullptr;
+        }
+    }
+
     // At this point, we know join() is about to exit, but the thread that calls
     // join() may not have exited yet.
     // If RpcServer owns the join thread (aka start() is called), make sure the thread exits;
@@ -24,6 +24,7 @@
 #include <poll.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <string_view>
 
 #include <binder/BpBinder.h>
@@ -277,6 +278,103 @@ status_t RpcSession::transact(const sp<IBinder>& binder, uint32_t code, const Pa
                              sp<RpcSession>::fromExisting(this), reply, flags);
 }
 
+status_t RpcSession::startPipeline(std::unique_ptr<Pipeline>* out) {
+    std::optional<uint32_t> version = getProtocolVersion();
+    if (!version.has_value() ||
+        *version < RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID) {
+        ALOGE("Pipelined transactions need RPC binder protocol version %" PRIu32
+              ", but the session uses %s.",
+              RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID,
+              version.has_value() ? std::to_string(*version).c_str() : "none yet");
+        return INVALID_OPERATION;
+    }
+
+    std::unique_ptr<Pipeline> pipeline(new Pipeline(sp<RpcSession>::fromExisting(this)));
+    if (status_t status = ExclusiveConnection::find(pipeline->mSession, ConnectionUse::CLIENT,
+                                                    &pipeline->mConnection);
+        status != OK) {
+        return status;
+    }
+    *out = std::move(pipeline);
+    return OK;
+}
+
+status_t RpcSession::checkPipelinedTransaction(const sp<IBinder>& binder, uint32_t code) {
+    BpBinder* proxy = binder->remoteBinder();
+    if (proxy == nullptr || !proxy->isRpcBinder() ||
+        proxy->getPrivateAccessor().rpcSession() != this) {
+        ALOGE("Pipeline can only send transactions to binders of its session.");
+        return BAD_VALUE;
+    }
+
+    // Like BpBinder::transact.
+    if (code >= IBinder::FIRST_CALL_TRANSACTION && code <= IBinder::LAST_CALL_TRANSACTION) {
+        using android::internal::Stability;
+
+        int16_t stability = Stability::getRepr(proxy);
+        Stability::Level required = Stability::getLocalLevel();
+        if (!Stability::check(stability, required)) {
+            ALOGE("Cannot do a user transaction on a %s binder in a %s context.",
+                  Stability::levelString(stability).c_str(),
+                  Stability::levelString(required).c_str());
+            return BAD_TYPE;
+        }
+    }
+    return OK;
+}
+
+RpcSession::Pipeline::Pipeline(const sp<RpcSession>& session)
+      : mSession(session), mThreadId(binder::os::GetThreadId()) {}
+
+RpcSession::Pipeline::~Pipeline() {
+    while (!mIds.empty()) {
+        Parcel reply;
+        if (waitForReply(mIds.back(), &reply) != OK) break;
+    }
+
+    // The session failed, so the remaining replies will never be read.
+    for (uint32_t id : mIds) {
+        mConnection.get()->pendingReplies.erase(id);
+    }
+}
+
+status_t RpcSession::Pipeline::transact(const sp<IBinder>& binder, uint32_t code,
+                                        const Parcel& data, uint32_t* outId) {
+    LOG_ALWAYS_FATAL_IF(binder::os::GetThreadId() != mThreadId,
+                        "Pipeline must be used on the thread which started it.");
+
+    if (status_t status = mSession->checkPipelinedTransaction(binder, code); status != OK) {
+        return status;
+    }
+
+    uint32_t id;
+    if (status_t status =
+                mSession->state()->transactPipelined(mConnection.get(), binder, code, data,
+                                                     mSession, &id);
+        status != OK) {
+        return status;
+    }
+    mIds.push_back(id);
+    *outId = id;
+    return OK;
+}
+
+status_t RpcSession::Pipeline::waitForReply(uint32_t id, Parcel* reply) {
+    LOG_ALWAYS_FATAL_IF(binder::os::GetThreadId() != mThreadId,
+                        "Pipeline must be used on the thread which started it.");
+
+    if (std::find(mIds.begin(), mIds.end(), id) == mIds.end()) {
+        ALOGE("Pipeline is not waiting for a reply to transaction %" PRIu32 ".", id);
+        return BAD_VALUE;
+    }
+
+    status_t status = mSession->state()->waitForReply(mConnection.get(), mSession, id, reply);
+    // Either the reply has been read, or the session has failed. Nested calls served meanwhile
+    // may have used this pipeline too.
+    if (auto it = std::find(mIds.begin(), mIds.end(), id); it != mIds.end()) mIds.erase(it);
+    return status;
+}
+
 status_t RpcSession::sendDecStrong(const BpBinder* binder) {
     // target is 0 because this is used to free BpBinder objects
     return sendDecStrongToTarget(binder->getPrivateAccessor().rpcAddress(), 0 /*target*/);
@@ -443,14 +541,23 @@ void RpcSession::join(sp<RpcSession>&& session, PreJoinSetupResult&& setupResult
               statusToString(setupResult.status).c_str());
     }
 
+    session->endJoinThreadOwnership();
+    endIncomingConnection(std::move(session), connection);
+}
+
+void RpcSession::endJoinThreadOwnership() {
+    RpcMutexLockGuard _l(mMutex);
+    auto it = mConnections.mThreads.find(rpc_this_thread::get_id());
+    LOG_ALWAYS_FATAL_IF(it == mConnections.mThreads.end());
+    it->second.detach();
+    mConnections.mThreads.erase(it);
+}
+
+void RpcSession::endIncomingConnection(sp<RpcSession>&& session,
+                                       const sp<RpcConnection>& connection) {
     sp<RpcSession::EventListener> listener;
     {
         RpcMutexLockGuard _l(session->mMutex);
-        auto it = session->mConnections.mThreads.find(rpc_this_thread::get_id());
-        LOG_ALWAYS_FATAL_IF(it == session->mConnections.mThreads.end());
-        it->second.detach();
-        session->mConnections.mThreads.erase(it);
-
         listener = session->mEventListener.promote();
     }
 
@@ -467,6 +574,27 @@ void RpcSession::join(sp<RpcSession>&& session, PreJoinSetupResult&& setupResult
     }
 }
 
+status_t RpcSession::executeArrivedCommands(const sp<RpcSession>& session,
+                                            const sp<RpcConnection>& connection) {
+    {
+        RpcMutexLockGuard _l(session->mMutex);
+        connection->exclusiveTid = binder::os::GetThreadId();
+    }
+    status_t status;
+    do {
+        status = session->state()->getAndExecuteCommand(connection, session,
+                                                        RpcState::CommandType::ANY);
+        // A transport may have read ahead more than the socket shows, such as TLS.
+    } while (status == OK && connection->rpcTransport->pollRead() == OK);
+    session->clearConnectionTid(connection);
+    return status;
+}
+
+void RpcSession::runAttachedToJavaVm(const std::function<void()>& fn) {
+    [[maybe_unused]] JavaThreadAttacher javaThreadAttacher;
+    fn();
+}
+
 sp<RpcServer> RpcSession::server() {
     RpcServer* unsafeServer = mForServer.unsafe_get();
     sp<RpcServer> server = mForServer.promote();
@@ -540,6 +540,57 @@ status_t RpcState::transact(const sp<RpcSession::RpcConnection>& connection,
 status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connection,
                                    uint64_t address, uint32_t code, const Parcel& data,
                                    const sp<RpcSession>& session, Parcel* reply, uint32_t flags) {
+    uint32_t transactionId;
+    if (status_t status =
+                sendTransaction(connection, address, code, data, session, flags, &transactionId);
+        status != OK) {
+        return status;
+    }
+
+    if (flags & IBinder::FLAG_ONEWAY) {
+        LOG_RPC_DETAIL("Oneway command, so no longer waiting on RpcTransport %p",
+                       connection->rpcTransport.get());
+
+        // Do not wait on result.
+        return OK;
+    }
+
+    LOG_ALWAYS_FATAL_IF(reply == nullptr, "Reply parcel must be used for synchronous transaction.");
+
+    return waitForReply(connection, session, transactionId, reply);
+}
+
+status_t RpcState::transactPipelined(const sp<RpcSession::RpcConnection>& connection,
+                                     const sp<IBinder>& binder, uint32_t code, const Parcel& data,
+                                     const sp<RpcSession>& session, uint32_t* outTransactionId) {
+    LOG_ALWAYS_FATAL_IF(session->getProtocolVersion().value() <
+                        RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID);
+
+    std::string errorMsg;
+    if (status_t status = validateParcel(session, data, &errorMsg); status != OK) {
+        ALOGE("Refusing to send RPC on binder %p code %" PRIu32 ": Parcel %p failed validation: %s",
+              binder.get(), code, &data, errorMsg.c_str());
+        return status;
+    }
+    uint64_t address;
+    if (status_t status = onBinderLeaving(session, binder, &address); status != OK) return status;
+
+    uint32_t transactionId;
+    if (status_t status =
+                sendTransaction(connection, address, code, data, session, 0, &transactionId);
+        status != OK) {
+        return status;
+    }
+
+    connection->pendingReplies.try_emplace(transactionId);
+    *outTransactionId = transactionId;
+    return OK;
+}
+
+status_t RpcState::sendTransaction(const sp<RpcSession::RpcConnection>& connection,
+                                   uint64_t address, uint32_t code, const Parcel& data,
+                                   const sp<RpcSession>& session, uint32_t flags,
+                                   uint32_t* outTransactionId) {
     LOG_ALWAYS_FATAL_IF(!data.isForRpc());
     LOG_ALWAYS_FATAL_IF(data.objectsCount() != 0);
 
@@ -579,6 +630,16 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
             .bodySize = bodySize,
     };
 
+    // Zero for older protocol versions, which match a reply with the transaction sent last.
+    uint32_t transactionId = 0;
+    if (!(flags & IBinder::FLAG_ONEWAY) &&
+        session->getProtocolVersion().value() >=
+                RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID) {
+        // The connection is used by this thread only, like its transport.
+        transactionId = ++connection->lastTransactionId;
+        if (transactionId == 0) transactionId = ++connection->lastTransactionId;
+    }
+
     RpcWireTransaction transaction{
             .address = RpcWireAddress::fromRaw(address),
             .code = code,
@@ -586,6 +647,7 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
             .asyncNumber = asyncNumber,
             // bodySize didn't overflow => this cast is safe
             .parcelDataSize = static_cast<uint32_t>(data.dataSize()),
+            .transactionId = transactionId,
     };
 
     // Oneway calls have no sync point, so if many are sent before, whether this
@@ -626,17 +688,8 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
         return status;
     }
 
-    if (flags & IBinder::FLAG_ONEWAY) {
-        LOG_RPC_DETAIL("Oneway command, so no longer waiting on RpcTransport %p",
-                       connection->rpcTransport.get());
-
-        // Do not wait on result.
-        return OK;
-    }
-
-    LOG_ALWAYS_FATAL_IF(reply == nullptr, "Reply parcel must be used for synchronous transaction.");
-
-    return waitForReply(connection, session, reply);
+    *outTransactionId = transactionId;
+    return OK;
 }
 
 static void cleanup_reply_data(const uint8_t* data, size_t dataSize, const binder_size_t* objects,
@@ -648,10 +701,20 @@ static void cleanup_reply_data(const uint8_t* data, size_t dataSize, const binde
 }
 
 status_t RpcState::waitForReply(const sp<RpcSession::RpcConnection>& connection,
-                                const sp<RpcSession>& session, Parcel* reply) {
-    std::vector<std::variant<unique_fd, borrowed_fd>> ancillaryFds;
-    RpcWireHeader command;
+                                const sp<RpcSession>& session, uint32_t transactionId,
+                                Parcel* reply) {
+    RpcSession::RpcConnection::PendingReply pending;
     while (true) {
+        // The reply may have been read while waiting for another one.
+        if (auto it = connection->pendingReplies.find(transactionId);
+            it != connection->pendingReplies.end() && it->second.received) {
+            pending = std::move(it->second);
+            connection->pendingReplies.erase(it);
+            break;
+        }
+
+        std::vector<std::variant<unique_fd, borrowed_fd>> ancillaryFds;
+        RpcWireHeader command;
         iovec iov{&command, sizeof(command)};
         if (status_t status = rpcRec(connection, session, "command header (for reply)", &iov, 1,
                                      enableAncillaryFds(session->getFileDescriptorTransportMode())
@@ -660,17 +723,52 @@ status_t RpcState::waitForReply(const sp<RpcSession::RpcConnection>& connection,
             status != OK)
             return status;
 
-        if (command.command == RPC_COMMAND_REPLY) break;
+        if (command.command == RPC_COMMAND_REPLY) {
+            uint32_t replyTransactionId;
+            if (status_t status = readReply(connection, session, command, std::move(ancillaryFds),
+                                            &replyTransactionId, &pending);
+                status != OK)
+                return status;
+
+            if (replyTransactionId == transactionId) {
+                // Only present for transactions of a Pipeline.
+                connection->pendingReplies.erase(transactionId);
+                break;
+            }
+
+            auto it = connection->pendingReplies.find(replyTransactionId);
+            if (it == connection->pendingReplies.end() || it->second.received) {
+                ALOGE("Received reply to unexpected transaction %" PRIu32
+                      " while waiting for %" PRIu32 ". Terminating!",
+                      replyTransactionId, transactionId);
+                (void)session->shutdownAndWait(false);
+                return BAD_VALUE;
+            }
+            it->second = std::move(pending);
+            pending = {};
+            continue;
+        }
 
         if (status_t status = processCommand(connection, session, command, CommandType::ANY,
                                              std::move(ancillaryFds));
             status != OK)
             return status;
-
-        // Reset to avoid spurious use-after-move warning from clang-tidy.
-        ancillaryFds = decltype(ancillaryFds)();
     }
 
+    if (pending.status != OK) return pending.status;
+
+    return reply->rpcSetDataReference(session, pending.data.release(), pending.dataSize,
+                                      pending.objectTable, pending.objectTableSize,
+                                      std::move(pending.ancillaryFds), cleanup_reply_data);
+}
+
+status_t RpcState::readReply(
+        const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
+        const RpcWireHeader& command,
+        std::vector<std::variant<unique_fd, borrowed_fd>>&& ancillaryFds,
+        uint32_t* outTransactionId, RpcSession::RpcConnection::PendingReply* out) {
+    LOG_ALWAYS_FATAL_IF(command.command != RPC_COMMAND_REPLY, "command: %d", command.command);
+
     const size_t rpcReplyWireSize = RpcWireReply::wireSize(session->getProtocolVersion().value());
 
     if (command.bodySize < rpcReplyWireSize) {
@@ -694,7 +792,10 @@ status_t RpcState::waitForReply(const sp<RpcSession::RpcConnection>& connection,
         status != OK)
         return status;
 
-    if (rpcReply.status != OK) return rpcReply.status;
+    *outTransactionId = rpcReply.transactionId;
+    out->received = true;
+    out->status = rpcReply.status;
+    if (rpcReply.status != OK) return OK;
 
     Span<const uint8_t> parcelSpan = {data.data(), data.size()};
     Span<const uint32_t> objectTableSpan;
@@ -720,10 +821,34 @@ status_t RpcState::waitForReply(const sp<RpcSession::RpcConnection>& connection,
         objectTableSpan = *maybeSpan;
     }
 
-    data.release();
-    return reply->rpcSetDataReference(session, parcelSpan.data, parcelSpan.size,
-                                      objectTableSpan.data, objectTableSpan.size,
-                                      std::move(ancillaryFds), cleanup_reply_data);
+    out->data.reset(data.release());
+    out->dataSize = parcelSpan.size;
+    out->objectTable = objectTableSpan.data;
+    out->objectTableSize = objectTableSpan.size;
+    out->ancillaryFds = std::move(ancillaryFds);
+    return OK;
+}
+
+status_t RpcState::processReply(
+        const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
+        const RpcWireHeader& command,
+        std::vector<std::variant<unique_fd, borrowed_fd>>&& ancillaryFds) {
+    RpcSession::RpcConnection::PendingReply pending;
+    uint32_t transactionId;
+    if (status_t status = readReply(connection, session, command, std::move(ancillaryFds),
+                                    &transactionId, &pending);
+        status != OK)
+        return status;
+
+    auto it = connection->pendingReplies.find(transactionId);
+    if (it == connection->pendingReplies.end() || it->second.received) {
+        ALOGE("Received reply to unexpected transaction %" PRIu32 ". Terminating!",
+              transactionId);
+        (void)session->shutdownAndWait(false);
+        return BAD_VALUE;
+    }
+    it->second = std::move(pending);
+    return OK;
 }
 
 status_t RpcState::sendDecStrongToTarget(const sp<RpcSession::RpcConnection>& connection,
@@ -822,6 +947,10 @@ status_t RpcState::processCommand(
             return processTransact(connection, session, command, std::move(ancillaryFds));
         case RPC_COMMAND_DEC_STRONG:
             return processDecStrong(connection, session, command);
+        case RPC_COMMAND_REPLY:
+            // Only expected while transactions of a Pipeline are outstanding.
+            if (connection->pendingReplies.empty()) break;
+            return processReply(connection, session, command, std::move(ancillaryFds));
     }
 
     // We should always know the version of the opposing side, and since the
@@ -1135,7 +1264,8 @@ processTransactInternalTailCall:
             // version.
             // NOTE: bodySize didn't overflow => this cast is safe
             .parcelDataSize = static_cast<uint32_t>(reply.dataSize()),
-            .reserved = {0, 0, 0},
+            .transactionId = transaction->transactionId,
+            .reserved = {0, 0},
     };
     iovec iovs[]{
             {&cmdReply, sizeof(RpcWireHeader)},
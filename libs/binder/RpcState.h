@@ -90,6 +90,17 @@ public:
                                            const sp<RpcSession>& session, Parcel* reply,
                                            uint32_t flags);
 
+    // Sends a synchronous transaction without waiting for its reply, which is read by
+    // waitForReply with the returned ID. See RpcSession::Pipeline.
+    [[nodiscard]] status_t transactPipelined(const sp<RpcSession::RpcConnection>& connection,
+                                             const sp<IBinder>& binder, uint32_t code,
+                                             const Parcel& data, const sp<RpcSession>& session,
+                                             uint32_t* outTransactionId);
+    // Reads the reply of a synchronous transaction, processing the commands received meanwhile.
+    [[nodiscard]] status_t waitForReply(const sp<RpcSession::RpcConnection>& connection,
+                                        const sp<RpcSession>& session, uint32_t transactionId,
+                                        Parcel* reply);
+
     /**
      * The ownership model here carries an implicit strong refcount whenever a
      * binder is sent across processes. Since we have a local strong count in
@@ -200,8 +211,20 @@ private:
                                   std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>*
                                           ancillaryFds = nullptr);
 
-    [[nodiscard]] status_t waitForReply(const sp<RpcSession::RpcConnection>& connection,
-                                        const sp<RpcSession>& session, Parcel* reply);
+    [[nodiscard]] status_t sendTransaction(const sp<RpcSession::RpcConnection>& connection,
+                                           uint64_t address, uint32_t code, const Parcel& data,
+                                           const sp<RpcSession>& session, uint32_t flags,
+                                           uint32_t* outTransactionId);
+    [[nodiscard]] status_t readReply(
+            const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
+            const RpcWireHeader& command,
+            std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>&& ancillaryFds,
+            uint32_t* outTransactionId, RpcSession::RpcConnection::PendingReply* out);
+    // Keeps a reply read while waiting for another one, or while sending a transaction.
+    [[nodiscard]] status_t processReply(
+            const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
+            const RpcWireHeader& command,
+            std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>&& ancillaryFds);
     [[nodiscard]] status_t processCommand(
             const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
             const RpcWireHeader& command, CommandType type,
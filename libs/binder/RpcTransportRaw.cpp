@@ -21,12 +21,17 @@
 #include <stddef.h>
 #include <sys/socket.h>
 
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#endif
+
 #include <binder/RpcTransportRaw.h>
 
 #include "FdTrigger.h"
 #include "OS.h"
 #include "RpcState.h"
 #include "RpcTransportUtils.h"
+#include "vm_sockets.h"
 
 namespace android {
 
@@ -34,6 +39,16 @@ using namespace android::binder::impl;
 using android::binder::borrowed_fd;
 using android::binder::unique_fd;
 
+#if defined(__linux__)
+// Writes at least this large are sent with MSG_ZEROCOPY, on sockets that support it. Below this,
+// pinning the pages and waiting for the completion costs more than copying.
+constexpr size_t kZeroCopyMinBytes = 16 * 1024;
+
+// How often to check for a shutdown while waiting for zero-copy completions, which the trigger FD
+// can't interrupt.
+constexpr int kZeroCopyPollMs = 100;
+#endif
+
 // RpcTransport with TLS disabled.
 class RpcTransportRaw : public RpcTransport {
 public:
@@ -61,6 +76,13 @@ public:
             FdTrigger* fdTrigger, iovec* iovs, int niovs,
             const std::optional<SmallFunction<status_t()>>& altPoll,
             const std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override {
+#if defined(__linux__)
+        if ((ancillaryFds == nullptr || ancillaryFds->empty()) &&
+            totalSize(iovs, niovs) >= kZeroCopyMinBytes && enableZeroCopy()) {
+            return interruptableWriteFullyZeroCopy(fdTrigger, iovs, niovs, altPoll);
+        }
+#endif
+
         bool sentFds = false;
         auto send = [&](iovec* iovs, int niovs) -> ssize_t {
             ssize_t ret = binder::os::sendMessageOnSocket(mSocket, iovs, niovs,
@@ -86,7 +108,127 @@ public:
     bool isWaiting() override { return mSocket.isInPollingState(); }
 
 private:
+#if defined(__linux__)
+    static size_t totalSize(const iovec* iovs, int niovs) {
+        size_t size = 0;
+        for (int i = 0; i < niovs; i++) {
+            size += iovs[i].iov_len;
+        }
+        return size;
+    }
+
+    // Zero-copy sends are only used on vsock sockets. The kernel only releases the pages of a
+    // send once it no longer needs them, which for TCP means once the peer acknowledged the
+    // data, and if the peer is itself blocked writing to this socket, waiting for that would
+    // deadlock. vsock only sends what the peer has room for.
+    bool enableZeroCopy() {
+        if (mZeroCopy == ZeroCopy::UNKNOWN) {
+            mZeroCopy = ZeroCopy::UNSUPPORTED;
+
+            sockaddr_storage addr;
+            socklen_t addrLen = sizeof(addr);
+            int enable = 1;
+            const int fd = mSocket.fd.get();
+            if (getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addrLen) == 0 &&
+                addr.ss_family == AF_VSOCK &&
+                setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) == 0) {
+                mZeroCopy = ZeroCopy::ENABLED;
+            }
+        }
+        return mZeroCopy == ZeroCopy::ENABLED;
+    }
+
+    status_t interruptableWriteFullyZeroCopy(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll) {
+        status_t completionStatus = OK;
+        auto send = [&](iovec* iovs, int niovs) -> ssize_t {
+            msghdr msg{
+                    .msg_iov = iovs,
+                    .msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(niovs),
+            };
+            const int flags = MSG_NOSIGNAL | MSG_ZEROCOPY;
+            ssize_t ret = TEMP_FAILURE_RETRY(sendmsg(mSocket.fd.get(), &msg, flags));
+            if (ret > 0) {
+                mZeroCopySent++;
+                return ret;
+            }
+            if (ret == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS)) {
+                return ret;
+            }
+
+            // Pending completions would make the socket poll with POLLERR, which the caller
+            // takes as a dead connection, and pin memory that a retry may need.
+            int savedErrno = errno;
+            if (completionStatus = waitForZeroCopyCompletions(fdTrigger); completionStatus != OK) {
+                errno = EPIPE;
+                return -1;
+            }
+            if (savedErrno != ENOBUFS) {
+                errno = savedErrno;
+                return -1;
+            }
+            // Out of memory to pin pages with, so copy instead.
+            return TEMP_FAILURE_RETRY(sendmsg(mSocket.fd.get(), &msg, MSG_NOSIGNAL));
+        };
+
+        status_t status = interruptableReadOrWrite(mSocket, fdTrigger, iovs, niovs, send,
+                                                   "sendmsg", POLLOUT, altPoll);
+        if (completionStatus != OK) return completionStatus;
+        // The caller may reuse the buffers once this returns.
+        if (status_t waitStatus = waitForZeroCopyCompletions(fdTrigger); status == OK) {
+            status = waitStatus;
+        }
+        return status;
+    }
+
+    status_t waitForZeroCopyCompletions(FdTrigger* fdTrigger) {
+        while (mZeroCopyCompleted != mZeroCopySent) {
+            alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(sock_extended_err)) + 64];
+            msghdr msg{
+                    .msg_control = control,
+                    .msg_controllen = sizeof(control),
+            };
+            ssize_t ret = TEMP_FAILURE_RETRY(
+                    recvmsg(mSocket.fd.get(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT));
+            if (ret < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) return -errno;
+                if (fdTrigger->isTriggered()) return DEAD_OBJECT;
+
+                // The error queue only signals POLLERR, which is polled for without asking.
+                pollfd pfd{.fd = mSocket.fd.get(), .events = 0, .revents = 0};
+                if (TEMP_FAILURE_RETRY(poll(&pfd, 1, kZeroCopyPollMs)) < 0) return -errno;
+                if (pfd.revents & (POLLHUP | POLLNVAL)) return DEAD_OBJECT;
+                continue;
+            }
+
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+                 cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                const auto* err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+                if (err->ee_origin != SO_EE_ORIGIN_ZEROCOPY || err->ee_errno != 0) {
+                    ALOGE("Unexpected error on socket while waiting for zero-copy sends: %s",
+                          strerror(err->ee_errno));
+                    return DEAD_OBJECT;
+                }
+                // Completions cover the inclusive range [ee_info, ee_data] of sends.
+                mZeroCopyCompleted += err->ee_data - err->ee_info + 1;
+                if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                    // The kernel copied the data anyway, so stop paying for the completions.
+                    mZeroCopy = ZeroCopy::UNSUPPORTED;
+                }
+            }
+        }
+        return OK;
+    }
+#endif
+
     android::RpcTransportFd mSocket;
+
+    enum class ZeroCopy { UNKNOWN, ENABLED, UNSUPPORTED };
+    ZeroCopy mZeroCopy = ZeroCopy::UNKNOWN;
+    // Numbers of MSG_ZEROCOPY sends, and of their completions.
+    uint32_t mZeroCopySent = 0;
+    uint32_t mZeroCopyCompleted = 0;
 };
 
 // RpcTransportCtx with TLS disabled.
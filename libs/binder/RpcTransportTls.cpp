@@ -30,6 +30,8 @@
 #include "RpcState.h"
 #include "Utils.h"
 
+#include <deque>
+#include <mutex>
 #include <sstream>
 
 #define SHOULD_LOG_TLS_DETAIL false
@@ -459,6 +461,7 @@ public:
 
 protected:
     static ssl_verify_result_t sslCustomVerify(SSL* ssl, uint8_t* outAlert);
+    virtual void configure(SSL_CTX*) {}
     virtual void preHandshake(Ssl* ssl) const = 0;
     bssl::UniquePtr<SSL_CTX> mCtx;
     std::shared_ptr<RpcCertificateVerifier> mCertVerifier;
@@ -512,11 +515,16 @@ std::unique_ptr<RpcTransportCtxTls> RpcTransportCtxTls::create(
     // Require at least TLS 1.3
     TEST_AND_RETURN(nullptr, SSL_CTX_set_min_proto_version(ctx.get(), TLS1_3_VERSION));
 
+    // Resumed sessions skip certificate verification by default. Verify the certificate that
+    // the session was established with again, so that the verifier sees every connection.
+    SSL_CTX_set_reverify_on_resume(ctx.get(), 1);
+
     if constexpr (SHOULD_LOG_TLS_DETAIL) { // NOLINT
         SSL_CTX_set_info_callback(ctx.get(), sslDebugLog);
     }
 
     auto ret = std::make_unique<Impl>();
+    ret->configure(ctx.get());
     // RpcTransportCtxTls* -> void*
     TEST_AND_RETURN(nullptr, SSL_CTX_set_app_data(ctx.get(), reinterpret_cast<void*>(ret.get())));
     ret->mCtx = std::move(ctx);
@@ -542,11 +550,50 @@ protected:
     }
 };
 
+// Connections after the first of a session resume the TLS session of an earlier connection,
+// using the tickets that the server sends after each handshake, which skips the key exchange and
+// the certificate messages.
 class RpcTransportCtxTlsClient : public RpcTransportCtxTls {
 protected:
+    void configure(SSL_CTX* ctx) override {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT);
+        SSL_CTX_sess_set_new_cb(ctx, newSession);
+    }
+
     void preHandshake(Ssl* ssl) const override {
         ssl->call(SSL_set_connect_state).errorQueue.clear();
+        if (bssl::UniquePtr<SSL_SESSION> session = takeSession(); session != nullptr) {
+            ssl->call(SSL_set_session, session.get()).errorQueue.clear();
+        }
+    }
+
+private:
+    // Tickets of TLS 1.3 are single use, and the server sends more than one per connection.
+    static constexpr size_t kMaxSessions = 8;
+
+    static int newSession(SSL* ssl, SSL_SESSION* session) {
+        auto ctx = reinterpret_cast<RpcTransportCtxTlsClient*>(
+                SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+        LOG_ALWAYS_FATAL_IF(ctx == nullptr);
+
+        std::lock_guard<std::mutex> lock(ctx->mSessionsMutex);
+        ctx->mSessions.emplace_back(session);
+        if (ctx->mSessions.size() > kMaxSessions) ctx->mSessions.pop_front();
+        return 1; // Takes ownership of the session.
+    }
+
+    bssl::UniquePtr<SSL_SESSION> takeSession() const {
+        std::lock_guard<std::mutex> lock(mSessionsMutex);
+        while (!mSessions.empty()) {
+            bssl::UniquePtr<SSL_SESSION> session = std::move(mSessions.back());
+            mSessions.pop_back();
+            if (SSL_SESSION_is_resumable(session.get())) return session;
+        }
+        return nullptr;
     }
+
+    mutable std::mutex mSessionsMutex;
+    mutable std::deque<bssl::UniquePtr<SSL_SESSION>> mSessions;
 };
 
 std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryTls::newServerCtx() const {
@@ -0,0 +1,480 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcUringTransport"
+#include <log/log.h>
+
+#include <liburing.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include <binder/RpcTransportUring.h>
+
+#include "FdTrigger.h"
+#include "OS.h"
+#include "RpcState.h"
+#include "RpcTransportUtils.h"
+
+namespace android {
+
+using namespace android::binder::impl;
+using android::binder::borrowed_fd;
+using android::binder::unique_fd;
+
+namespace {
+
+// Enough for an operation in each direction, the polls linked to them, the trigger and the
+// cancellation of all of them.
+constexpr unsigned kRingEntries = 16;
+
+// Reads are done into this buffer when the socket can't carry FDs. It is larger than most
+// transactions, so that a command, and often the commands following it, are read in one go.
+constexpr size_t kReadAheadSize = 32 * 1024;
+
+enum : uint64_t {
+    kTagIo = 1,
+    kTagIoPoll,
+    kTagRead,
+    kTagReadPoll,
+    kTagCancel,
+    // Followed by one tag for each FdTrigger that is polled, so that the completion of the poll
+    // of a previous trigger is not mistaken for the current one.
+    kTagTrigger,
+};
+
+// Consumes 'size' bytes from the front of 'iovs', and any empty iovecs after them.
+void advance(iovec*& iovs, int& niovs, size_t size) {
+    while (niovs > 0 && size >= iovs[0].iov_len) {
+        size -= iovs[0].iov_len;
+        iovs++;
+        niovs--;
+    }
+    if (size > 0) {
+        LOG_ALWAYS_FATAL_IF(niovs == 0, "Reached the end of iovecs with %zu bytes remaining",
+                            size);
+        iovs[0].iov_base = reinterpret_cast<char*>(iovs[0].iov_base) + size;
+        iovs[0].iov_len -= size;
+    }
+}
+
+} // namespace
+
+// RpcTransport with TLS disabled, which submits its socket operations to an io_uring. An
+// operation and the poll it may need are submitted and waited for in one system call, and the
+// read of the next command is submitted along with each write, so a round trip of a transaction
+// usually takes two system calls, instead of up to four with RpcTransportRaw.
+class RpcTransportUring : public RpcTransport {
+public:
+    static std::unique_ptr<RpcTransport> make(android::RpcTransportFd socket) {
+        auto transport =
+                std::unique_ptr<RpcTransportUring>(new RpcTransportUring(std::move(socket)));
+        if (int ret = io_uring_queue_init(kRingEntries, &transport->mRing, 0); ret < 0) {
+            ALOGE("Could not set up io_uring: %s", strerror(-ret));
+            return nullptr;
+        }
+        transport->mRingInitialized = true;
+
+        // Only UNIX domain sockets can carry FDs, and they arrive with the bytes that they were
+        // sent with, so reading ahead on them would drop the FDs of following commands.
+        sockaddr_storage addr;
+        socklen_t addrLen = sizeof(addr);
+        if (getsockname(transport->mSocket.fd.get(), reinterpret_cast<sockaddr*>(&addr),
+                        &addrLen) == 0 &&
+            addr.ss_family != AF_UNIX) {
+            transport->mReadAhead = std::make_unique<uint8_t[]>(kReadAheadSize);
+            iovec iov{transport->mReadAhead.get(), kReadAheadSize};
+            // This may fail because of RLIMIT_MEMLOCK, in which case plain reads are used.
+            transport->mReadAheadRegistered =
+                    io_uring_register_buffers(&transport->mRing, &iov, 1) == 0;
+        }
+        return transport;
+    }
+
+    ~RpcTransportUring() override {
+        if (!mRingInitialized) return;
+
+        // The kernel may still write to the read-ahead buffer until the read completes.
+        if (mIoInFlight || mReadInFlight) {
+            cancelInFlight();
+            while (mIoInFlight || mReadInFlight) {
+                (void)submitAndWait();
+            }
+        }
+        io_uring_queue_exit(&mRing);
+    }
+
+    status_t pollRead(void) override {
+        if (mReadAhead != nullptr) {
+            reapCompletions();
+            if (mReadAheadStart < mReadAheadEnd) return OK;
+            if (mReadAheadError != OK) return mReadAheadError;
+            if (mReadInFlight) return WOULD_BLOCK;
+        }
+
+        uint8_t buf;
+        ssize_t ret = TEMP_FAILURE_RETRY(
+                ::recv(mSocket.fd.get(), &buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT));
+        if (ret < 0) {
+            int savedErrno = errno;
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                return WOULD_BLOCK;
+            }
+
+            LOG_RPC_DETAIL("RpcTransport poll(): %s", strerror(savedErrno));
+            return -savedErrno;
+        } else if (ret == 0) {
+            return DEAD_OBJECT;
+        }
+
+        return OK;
+    }
+
+    status_t interruptableWriteFully(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll,
+            const std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override {
+        if (ancillaryFds != nullptr && !ancillaryFds->empty()) {
+            bool sentFds = false;
+            auto send = [&](iovec* iovs, int niovs) -> ssize_t {
+                ssize_t ret = binder::os::sendMessageOnSocket(mSocket, iovs, niovs,
+                                                              sentFds ? nullptr : ancillaryFds);
+                sentFds |= ret > 0;
+                return ret;
+            };
+            return interruptableReadOrWrite(mSocket, fdTrigger, iovs, niovs, send, "sendmsg",
+                                            POLLOUT, altPoll);
+        }
+
+        if (niovs < 0) return BAD_VALUE;
+        if (status_t status = armTrigger(fdTrigger); status != OK) return status;
+
+        bool pollFirst = false;
+        advance(iovs, niovs, 0);
+        while (niovs > 0) {
+            msghdr msg{
+                    .msg_iov = iovs,
+                    .msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(niovs),
+            };
+            if (pollFirst) prepareLinkedPoll(kTagIoPoll, POLLOUT);
+            io_uring_sqe* sqe = getSqe();
+            io_uring_prep_sendmsg(sqe, mSocket.fd.get(), &msg, MSG_NOSIGNAL);
+            io_uring_sqe_set_data64(sqe, kTagIo);
+            mIoInFlight = true;
+
+            // The reply, or the next command, is read once it arrives, without another system
+            // call to start reading it.
+            startReadAhead();
+
+            if (status_t status = waitFor(mIoInFlight); status != OK) return status;
+
+            if (mIoResult == -EAGAIN || mIoResult == -EWOULDBLOCK) {
+                // See interruptableReadOrWrite, the other side may be waiting for us to read.
+                if (altPoll) {
+                    if (status_t status = (*altPoll)(); status != OK) return status;
+                    if (fdTrigger->isTriggered()) return DEAD_OBJECT;
+                } else {
+                    pollFirst = true;
+                }
+                continue;
+            }
+            if (mIoResult < 0) {
+                LOG_RPC_DETAIL("RpcTransport sendmsg(): %s", strerror(-mIoResult));
+                return mIoResult;
+            }
+            if (mIoResult == 0) return DEAD_OBJECT;
+
+            advance(iovs, niovs, mIoResult);
+            pollFirst = false;
+        }
+        return OK;
+    }
+
+    status_t interruptableReadFully(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll,
+            std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override {
+        if (mReadAhead == nullptr && (ancillaryFds != nullptr || altPoll)) {
+            auto recv = [&](iovec* iovs, int niovs) -> ssize_t {
+                return binder::os::receiveMessageFromSocket(mSocket, iovs, niovs, ancillaryFds);
+            };
+            return interruptableReadOrWrite(mSocket, fdTrigger, iovs, niovs, recv, "recvmsg",
+                                            POLLIN, altPoll);
+        }
+
+        if (niovs < 0) return BAD_VALUE;
+        if (status_t status = armTrigger(fdTrigger); status != OK) return status;
+
+        advance(iovs, niovs, 0);
+        return mReadAhead != nullptr ? readFromReadAhead(iovs, niovs) : receive(iovs, niovs);
+    }
+
+    bool isWaiting() override { return mWaiting.load(std::memory_order_relaxed); }
+
+private:
+    explicit RpcTransportUring(android::RpcTransportFd socket) : mSocket(std::move(socket)) {}
+
+    status_t readFromReadAhead(iovec* iovs, int niovs) {
+        while (true) {
+            while (niovs > 0 && mReadAheadStart < mReadAheadEnd) {
+                size_t size = std::min(iovs[0].iov_len, mReadAheadEnd - mReadAheadStart);
+                memcpy(iovs[0].iov_base, mReadAhead.get() + mReadAheadStart, size);
+                mReadAheadStart += size;
+                advance(iovs, niovs, size);
+            }
+            if (niovs == 0) return OK;
+            if (mReadAheadError != OK) return mReadAheadError;
+
+            startReadAhead();
+            if (status_t status = waitFor(mReadInFlight); status != OK) return status;
+        }
+    }
+
+    status_t receive(iovec* iovs, int niovs) {
+        while (niovs > 0) {
+            msghdr msg{
+                    .msg_iov = iovs,
+                    .msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(niovs),
+            };
+            prepareLinkedPoll(kTagIoPoll, POLLIN);
+            io_uring_sqe* sqe = getSqe();
+            io_uring_prep_recvmsg(sqe, mSocket.fd.get(), &msg, 0);
+            io_uring_sqe_set_data64(sqe, kTagIo);
+            mIoInFlight = true;
+
+            if (status_t status = waitFor(mIoInFlight); status != OK) return status;
+
+            if (mIoResult == -EAGAIN || mIoResult == -EWOULDBLOCK) continue;
+            if (mIoResult < 0) {
+                LOG_RPC_DETAIL("RpcTransport recvmsg(): %s", strerror(-mIoResult));
+                return mIoResult;
+            }
+            if (mIoResult == 0) return DEAD_OBJECT;
+
+            advance(iovs, niovs, mIoResult);
+        }
+        return OK;
+    }
+
+    // Starts reading into the read-ahead buffer, once everything read before has been consumed.
+    // The read is linked to a poll, since the socket is non-blocking, and would otherwise fail
+    // with EAGAIN until there is data.
+    void startReadAhead() {
+        if (mReadAhead == nullptr || mReadInFlight || mReadAheadError != OK ||
+            mReadAheadStart < mReadAheadEnd) {
+            return;
+        }
+        mReadAheadStart = mReadAheadEnd = 0;
+
+        prepareLinkedPoll(kTagReadPoll, POLLIN);
+        io_uring_sqe* sqe = getSqe();
+        if (mReadAheadRegistered) {
+            io_uring_prep_read_fixed(sqe, mSocket.fd.get(), mReadAhead.get(), kReadAheadSize, 0,
+                                     0);
+        } else {
+            io_uring_prep_read(sqe, mSocket.fd.get(), mReadAhead.get(), kReadAheadSize, 0);
+        }
+        io_uring_sqe_set_data64(sqe, kTagRead);
+        mReadInFlight = true;
+    }
+
+    void prepareLinkedPoll(uint64_t tag, int16_t event) {
+        io_uring_sqe* sqe = getSqe();
+        io_uring_prep_poll_add(sqe, mSocket.fd.get(), event);
+        io_uring_sqe_set_data64(sqe, tag);
+        sqe->flags |= IOSQE_IO_LINK;
+    }
+
+    // Polls for the trigger alongside the operations of this transport. The trigger changes
+    // when a connection accepted by an RpcServer joins a session.
+    status_t armTrigger(FdTrigger* fdTrigger) {
+        if (fdTrigger->isTriggered()) return DEAD_OBJECT;
+        if (fdTrigger == mTrigger) return OK;
+
+        if (mTrigger != nullptr) cancel(mTriggerTag);
+        mTrigger = fdTrigger;
+        mTriggerTag++;
+        mTriggered = false;
+
+        io_uring_sqe* sqe = getSqe();
+        // The trigger only ever gets POLLHUP, which is polled for without asking.
+        io_uring_prep_poll_add(sqe, fdTrigger->pollFd().get(), POLLIN);
+        io_uring_sqe_set_data64(sqe, mTriggerTag);
+        return OK;
+    }
+
+    // Waits until 'inFlight' is cleared by the completion of its operation. If the trigger fires
+    // first, the operations in flight are cancelled, since they use the buffers of the caller or
+    // of this transport, and DEAD_OBJECT is returned once they completed.
+    status_t waitFor(const bool& inFlight) {
+        bool cancelled = false;
+        while (inFlight || (cancelled && (mIoInFlight || mReadInFlight))) {
+            mWaiting.store(true, std::memory_order_relaxed);
+            (void)submitAndWait();
+            mWaiting.store(false, std::memory_order_relaxed);
+
+            if (mTriggered && !cancelled) {
+                cancelInFlight();
+                cancelled = true;
+            }
+        }
+        return mTriggered ? DEAD_OBJECT : OK;
+    }
+
+    status_t submitAndWait() {
+        int ret = io_uring_submit_and_wait(&mRing, 1);
+        // Anything else would mean that the buffers of operations in flight may be written to
+        // after they are released.
+        LOG_ALWAYS_FATAL_IF(ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY,
+                            "io_uring_submit_and_wait failed: %s", strerror(-ret));
+        reapCompletions();
+        return ret < 0 ? ret : OK;
+    }
+
+    void reapCompletions() {
+        io_uring_cqe* cqe;
+        while (io_uring_peek_cqe(&mRing, &cqe) == 0) {
+            const uint64_t tag = io_uring_cqe_get_data64(cqe);
+            const int32_t res = cqe->res;
+            io_uring_cqe_seen(&mRing, cqe);
+
+            switch (tag) {
+                case kTagIo:
+                    mIoInFlight = false;
+                    mIoResult = res;
+                    break;
+                case kTagRead:
+                    mReadInFlight = false;
+                    if (res > 0) {
+                        mReadAheadEnd += res;
+                    } else if (res != -EAGAIN && res != -EWOULDBLOCK) {
+                        LOG_RPC_DETAIL("RpcTransport read(): %s", strerror(-res));
+                        mReadAheadError = res == 0 || res == -ECANCELED ? DEAD_OBJECT : res;
+                    }
+                    break;
+                case kTagIoPoll:
+                case kTagReadPoll:
+                case kTagCancel:
+                    // Failed polls also fail the operations linked to them.
+                    break;
+                default:
+                    if (tag == mTriggerTag && res != -ECANCELED) mTriggered = true;
+                    break;
+            }
+        }
+    }
+
+    void cancelInFlight() {
+        if (mIoInFlight) {
+            cancel(kTagIoPoll);
+            cancel(kTagIo);
+        }
+        if (mReadInFlight) {
+            cancel(kTagReadPoll);
+            cancel(kTagRead);
+        }
+    }
+
+    void cancel(uint64_t tag) {
+        io_uring_sqe* sqe = getSqe();
+        io_uring_prep_cancel64(sqe, tag, 0);
+        io_uring_sqe_set_data64(sqe, kTagCancel);
+    }
+
+    io_uring_sqe* getSqe() {
+        io_uring_sqe* sqe = io_uring_get_sqe(&mRing);
+        if (sqe == nullptr) {
+            (void)io_uring_submit(&mRing);
+            sqe = io_uring_get_sqe(&mRing);
+        }
+        LOG_ALWAYS_FATAL_IF(sqe == nullptr, "io_uring submission queue is full");
+        return sqe;
+    }
+
+    android::RpcTransportFd mSocket;
+    io_uring mRing;
+    bool mRingInitialized = false;
+    std::atomic_bool mWaiting = false;
+
+    FdTrigger* mTrigger = nullptr;
+    uint64_t mTriggerTag = kTagTrigger;
+    bool mTriggered = false;
+
+    // The write or exact read in flight, and its result.
+    bool mIoInFlight = false;
+    int32_t mIoResult = 0;
+
+    std::unique_ptr<uint8_t[]> mReadAhead;
+    bool mReadAheadRegistered = false;
+    bool mReadInFlight = false;
+    // Bytes read ahead, which have not been consumed yet.
+    size_t mReadAheadStart = 0;
+    size_t mReadAheadEnd = 0;
+    // Returned once what was read ahead is consumed.
+    status_t mReadAheadError = OK;
+};
+
+// RpcTransportCtx with TLS disabled, using io_uring.
+class RpcTransportCtxUring : public RpcTransportCtx {
+public:
+    std::unique_ptr<RpcTransport> newTransport(android::RpcTransportFd socket,
+                                               FdTrigger*) const override {
+        return RpcTransportUring::make(std::move(socket));
+    }
+    std::vector<uint8_t> getCertificate(RpcCertificateFormat) const override { return {}; }
+};
+
+std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryUring::newServerCtx() const {
+    return std::make_unique<RpcTransportCtxUring>();
+}
+
+std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryUring::newClientCtx() const {
+    return std::make_unique<RpcTransportCtxUring>();
+}
+
+const char* RpcTransportCtxFactoryUring::toCString() const {
+    return "uring";
+}
+
+std::unique_ptr<RpcTransportCtxFactory> RpcTransportCtxFactoryUring::make() {
+    io_uring ring;
+    if (int ret = io_uring_queue_init(kRingEntries, &ring, 0); ret < 0) {
+        ALOGW("io_uring is not available: %s", strerror(-ret));
+        return nullptr;
+    }
+
+    bool supported = false;
+    if (io_uring_probe* probe = io_uring_get_probe_ring(&ring); probe != nullptr) {
+        supported = true;
+        for (int op : {IORING_OP_SENDMSG, IORING_OP_RECVMSG, IORING_OP_READ, IORING_OP_READ_FIXED,
+                       IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL}) {
+            supported &= io_uring_opcode_supported(probe, op) != 0;
+        }
+        io_uring_free_probe(probe);
+    }
+    io_uring_queue_exit(&ring);
+
+    if (!supported) {
+        ALOGW("io_uring does not support the operations needed for RPC binder");
+        return nullptr;
+    }
+    return std::unique_ptr<RpcTransportCtxFactoryUring>(new RpcTransportCtxFactoryUring());
+}
+
+} // namespace android
@@ -139,7 +139,12 @@ struct RpcWireTransaction {
     // The size of the Parcel data directly following RpcWireTransaction.
     uint32_t parcelDataSize;
 
-    uint32_t reserved[3];
+    // -- Fields below only used starting at protocol version 2 --
+
+    // Non-zero for synchronous transactions, and echoed in their RpcWireReply.
+    uint32_t transactionId;
+
+    uint32_t reserved[2];
 
     uint8_t data[];
 };
@@ -153,7 +158,12 @@ struct RpcWireReply {
     // The size of the Parcel data directly following RpcWireReply.
     uint32_t parcelDataSize;
 
-    uint32_t reserved[3];
+    // -- Fields below only used starting at protocol version 2 --
+
+    // RpcWireTransaction::transactionId of the transaction this replies to.
+    uint32_t transactionId;
+
+    uint32_t reserved[2];
 
     // Byte size of RpcWireReply in the wire protocol.
     static size_t wireSize(uint32_t protocolVersion) {
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "TransactionRecorder"
+
+#include "TransactionRecorder.h"
+
+#include <binder/IBinder.h>
+#include <lz4.h>
+#include <utils/Log.h>
+
+#include <inttypes.h>
+#include <unistd.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "file.h"
+
+namespace android {
+
+using binder::borrowed_fd;
+using binder::ReadFully;
+using binder::unique_fd;
+using binder::WriteFully;
+using binder::debug::RecordedTransaction;
+
+// A compressed recording is a sequence of frames, each a FrameHeader followed by compressedSize
+// bytes of an LZ4 block. Decompressed and concatenated, the frames are an uncompressed recording,
+// as described in RecordedTransaction.cpp. Frames are compressed independently, and a transaction
+// may span frames.
+//
+// An uncompressed recording starts with the chunk type of a header chunk, which tells the two
+// apart.
+
+namespace {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic error "-Wpadded"
+struct FrameHeader {
+    uint32_t magic = 0;
+    uint32_t uncompressedSize = 0;
+    uint32_t compressedSize = 0;
+    uint32_t reserved = 0;
+};
+#pragma clang diagnostic pop
+static_assert(sizeof(FrameHeader) == 16);
+
+constexpr uint32_t kFrameMagic = B_PACK_CHARS('B', 'R', 'Z', '4');
+constexpr size_t kFrameSize = 64 * 1024;
+
+// Like ReadFully, but stops at the end of the file. Returns the number of bytes read, or -1.
+ssize_t readUpTo(borrowed_fd fd, void* data, size_t size) {
+    uint8_t* bytes = static_cast<uint8_t*>(data);
+    size_t total = 0;
+    while (total < size) {
+        const ssize_t n = TEMP_FAILURE_RETRY(read(fd.get(), bytes + total, size - total));
+        if (n < 0) return -1;
+        if (n == 0) break;
+        total += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(total);
+}
+
+class ThreadedRecorder : public TransactionRecorder {
+public:
+    ThreadedRecorder(unique_fd fd, bool compress)
+          : mFd(std::move(fd)), mCompress(compress), mThread([this] { loop(); }) {}
+    ~ThreadedRecorder() override;
+
+    void record(const RecordedTransaction& transaction) override;
+
+private:
+    void loop();
+    bool write(const std::vector<uint8_t>& data);
+
+    const unique_fd mFd;
+    const bool mCompress;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    // Serialized transactions, in order.
+    std::vector<uint8_t> mQueue;
+    uint64_t mDropped = 0;
+    bool mStopping = false;
+
+    // Only used by the writer thread.
+    std::vector<uint8_t> mFrame;
+    bool mFailed = false;
+
+    std::thread mThread;
+};
+
+ThreadedRecorder::~ThreadedRecorder() {
+    {
+        std::lock_guard _l(mLock);
+        mStopping = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+void ThreadedRecorder::record(const RecordedTransaction& transaction) {
+    std::lock_guard _l(mLock);
+    const size_t queued = mQueue.size();
+    if (serialize(transaction, &mQueue) != NO_ERROR) return;
+
+    if (mQueue.size() > kMaxQueuedBytes) {
+        mQueue.resize(queued);
+        mDropped++;
+        return;
+    }
+    if (queued == 0) mCondition.notify_one();
+}
+
+void ThreadedRecorder::loop() {
+    std::vector<uint8_t> pending;
+    std::unique_lock _l(mLock);
+    for (;;) {
+        mCondition.wait(_l, [this] { return mStopping || !mQueue.empty(); });
+        if (mQueue.empty()) break;
+
+        pending.clear();
+        pending.swap(mQueue);
+        _l.unlock();
+        // The rest of the recording is dropped after a failure, since it could not be parsed.
+        if (!mFailed && !write(pending)) {
+            ALOGE("Failed to write recorded transactions to fd %d: %s", mFd.get(),
+                  strerror(errno));
+            mFailed = true;
+        }
+        _l.lock();
+    }
+
+    ALOGW_IF(mDropped > 0, "Dropped %" PRIu64 " transactions from the recording, since writing it "
+             "fell behind", mDropped);
+}
+
+bool ThreadedRecorder::write(const std::vector<uint8_t>& data) {
+    if (!mCompress) return WriteFully(mFd, data.data(), data.size());
+
+    mFrame.resize(sizeof(FrameHeader) + LZ4_compressBound(static_cast<int>(kFrameSize)));
+    for (size_t offset = 0; offset < data.size(); offset += kFrameSize) {
+        const size_t size = std::min(kFrameSize, data.size() - offset);
+        const int compressedSize =
+                LZ4_compress_default(reinterpret_cast<const char*>(data.data() + offset),
+                                     reinterpret_cast<char*>(mFrame.data() + sizeof(FrameHeader)),
+                                     static_cast<int>(size),
+                                     static_cast<int>(mFrame.size() - sizeof(FrameHeader)));
+        if (compressedSize <= 0) {
+            ALOGE("Failed to compress %zu bytes of the recording", size);
+            return false;
+        }
+
+        const FrameHeader header = {
+                .magic = kFrameMagic,
+                .uncompressedSize = static_cast<uint32_t>(size),
+                .compressedSize = static_cast<uint32_t>(compressedSize),
+        };
+        memcpy(mFrame.data(), &header, sizeof(header));
+        if (!WriteFully(mFd, mFrame.data(), sizeof(header) + compressedSize)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::unique_ptr<TransactionRecorder> TransactionRecorder::make(unique_fd fd, bool compress) {
+    return std::make_unique<ThreadedRecorder>(std::move(fd), compress);
+}
+
+namespace binder::debug {
+
+RecordingReader::RecordingReader(unique_fd fd) : mFd(std::move(fd)) {}
+
+std::optional<RecordedTransaction> RecordingReader::next() {
+    for (;;) {
+        if (mPosition < mBuffer.size()) {
+            std::optional<RecordedTransaction> transaction;
+            size_t consumed = 0;
+            status_t status = RecordedTransaction::fromBuffer(mBuffer.data() + mPosition,
+                                                              mBuffer.size() - mPosition,
+                                                              &transaction, &consumed);
+            if (status == NO_ERROR) {
+                mPosition += consumed;
+                return transaction;
+            }
+            if (status != NOT_ENOUGH_DATA) return std::nullopt;
+        }
+
+        if (!readFrame()) {
+            ALOGE_IF(mPosition < mBuffer.size(), "Recording ends within a transaction");
+            return std::nullopt;
+        }
+    }
+}
+
+bool RecordingReader::readFrame() {
+    mBuffer.erase(mBuffer.begin(), mBuffer.begin() + mPosition);
+    mPosition = 0;
+
+    if (!mCompressed.has_value()) {
+        uint32_t magic = 0;
+        const off_t start = lseek(mFd.get(), 0, SEEK_CUR);
+        if (start == -1 || readUpTo(mFd, &magic, sizeof(magic)) < 0 ||
+            lseek(mFd.get(), start, SEEK_SET) == -1) {
+            ALOGE("Failed to read recording from fd %d: %s", mFd.get(), strerror(errno));
+            return false;
+        }
+        mCompressed = magic == kFrameMagic;
+    }
+
+    const size_t buffered = mBuffer.size();
+    if (!*mCompressed) {
+        mBuffer.resize(buffered + kFrameSize);
+        const ssize_t size = readUpTo(mFd, mBuffer.data() + buffered, kFrameSize);
+        mBuffer.resize(buffered + std::max<ssize_t>(size, 0));
+        return size > 0;
+    }
+
+    FrameHeader header;
+    const ssize_t size = readUpTo(mFd, &header, sizeof(header));
+    if (size == 0) return false;
+    if (size != static_cast<ssize_t>(sizeof(header)) || header.magic != kFrameMagic ||
+        header.uncompressedSize > kFrameSize ||
+        header.compressedSize >
+                static_cast<uint32_t>(LZ4_compressBound(static_cast<int>(kFrameSize)))) {
+        ALOGE("Malformed frame in recording from fd %d", mFd.get());
+        return false;
+    }
+
+    std::vector<uint8_t> compressed(header.compressedSize);
+    if (!ReadFully(mFd, compressed.data(), compressed.size())) {
+        ALOGE("Recording from fd %d ends within a frame", mFd.get());
+        return false;
+    }
+    mBuffer.resize(buffered + header.uncompressedSize);
+    const int decompressedSize =
+            LZ4_decompress_safe(reinterpret_cast<const char*>(compressed.data()),
+                                reinterpret_cast<char*>(mBuffer.data() + buffered),
+                                static_cast<int>(header.compressedSize),
+                                static_cast<int>(header.uncompressedSize));
+    if (decompressedSize != static_cast<int>(header.uncompressedSize)) {
+        ALOGE("Failed to decompress frame in recording from fd %d", mFd.get());
+        mBuffer.resize(buffered);
+        return false;
+    }
+    return true;
+}
+
+} // namespace binder::debug
+
+} // namespace android
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <binder/RecordedTransaction.h>
+#include <binder/unique_fd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace android {
+
+// Writes the transactions that a BBinder records to a file on a thread of its own, so that
+// recording does not add file I/O to binder threads. See BBinder::startRecordingTransactions.
+//
+// Up to kMaxQueuedBytes of transactions wait to be written, beyond which transactions are dropped
+// rather than blocking the binder thread. Destroying the recorder writes the queued transactions.
+class TransactionRecorder {
+public:
+    static constexpr size_t kMaxQueuedBytes = 8 * 1024 * 1024;
+
+    // If 'compress' is set, the recording is written in LZ4 frames. RecordingReader reads both.
+    static std::unique_ptr<TransactionRecorder> make(binder::unique_fd fd, bool compress);
+    virtual ~TransactionRecorder() = default;
+
+    virtual void record(const binder::debug::RecordedTransaction& transaction) = 0;
+
+protected:
+    static status_t serialize(const binder::debug::RecordedTransaction& transaction,
+                              std::vector<uint8_t>* out) {
+        return transaction.appendTo(out);
+    }
+};
+
+} // namespace android
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TransactionStats.h"
+
+#include <binder/IBinder.h>
+#include <binder/Parcel.h>
+#include <binder/RpcThreads.h>
+#include <utils/String8.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+
+std::atomic_bool TransactionStats::sEnabled = false;
+
+namespace {
+
+constexpr size_t kBuckets = 20;
+
+// Bucket 0 counts zeroes, bucket i counts values in [2^(i-1), 2^i), and the last bucket also
+// counts everything beyond.
+struct Histogram {
+    std::array<std::atomic<uint32_t>, kBuckets> counts{};
+
+    void add(uint64_t value) {
+        const size_t bucket = std::min<size_t>(std::bit_width(value), kBuckets - 1);
+        counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void dump(std::string& out, const char* label) const {
+        out += "    ";
+        out += label;
+        out += ":";
+        for (size_t i = 0; i < kBuckets; i++) {
+            const uint32_t count = counts[i].load(std::memory_order_relaxed);
+            if (count == 0) continue;
+
+            if (i == 0) {
+                out += " 0";
+            } else if (i == kBuckets - 1) {
+                out += " >=" + std::to_string(uint64_t{1} << (i - 1));
+            } else {
+                out += " " + std::to_string(uint64_t{1} << (i - 1)) + "-" +
+                        std::to_string((uint64_t{1} << i) - 1);
+            }
+            out += "=" + std::to_string(count);
+        }
+        out += "\n";
+    }
+};
+
+struct Entry {
+    // Zero if free, and (interface + 1) << 32 | code once claimed.
+    std::atomic<uint64_t> key = 0;
+
+    std::atomic<uint64_t> count = 0;
+    std::atomic<uint64_t> totalLatencyUs = 0;
+    std::atomic<uint64_t> maxLatencyUs = 0;
+
+    Histogram latencyUs;
+    Histogram requestSize;
+    Histogram replySize;
+};
+
+constexpr size_t kEntries = 512;
+static_assert(std::has_single_bit(kEntries));
+
+// Bounds the probing of a full table, at which point transactions are dropped.
+constexpr size_t kMaxProbes = 16;
+
+struct Table {
+    std::array<Entry, kEntries> entries;
+    std::atomic<uint64_t> dropped = 0;
+};
+
+// Allocated when first enabled and never freed, so recording does not race with disabling.
+std::atomic<Table*> gTable = nullptr;
+
+struct Interfaces {
+    RpcMutex lock;
+    std::vector<std::string> names = {"<unknown>"};
+    std::unordered_map<std::string, uint32_t> indices;
+};
+
+Interfaces& interfaces() {
+    static Interfaces* const sInterfaces = new Interfaces;
+    return *sInterfaces;
+}
+
+std::string codeToString(uint32_t code) {
+    if (code >= IBinder::FIRST_CALL_TRANSACTION && code <= IBinder::LAST_CALL_TRANSACTION) {
+        return std::to_string(code);
+    }
+
+    // System transaction codes are packed characters, like '_PNG'.
+    std::string chars;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        const char c = static_cast<char>((code >> shift) & 0xff);
+        if (c < ' ' || c > '~') return std::to_string(code);
+        chars += c;
+    }
+    return "'" + chars + "'";
+}
+
+} // namespace
+
+void TransactionStats::setEnabled(bool enabled) {
+    if (enabled && gTable.load(std::memory_order_acquire) == nullptr) {
+        auto* table = new Table();
+        Table* expected = nullptr;
+        if (!gTable.compare_exchange_strong(expected, table, std::memory_order_acq_rel)) {
+            delete table;
+        }
+    }
+    sEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint32_t TransactionStats::interfaceOf(const Parcel& data) {
+    const size_t position = data.dataPosition();
+    data.setDataPosition(0);
+
+    bool valid = true;
+    if (!data.isForRpc()) {
+        // Skip the strict mode policy and work source, and check the header written by
+        // Parcel::writeInterfaceToken.
+        data.readInt32();
+        data.readInt32();
+        switch (data.readInt32()) {
+            case B_PACK_CHARS('S', 'Y', 'S', 'T'):
+            case B_PACK_CHARS('V', 'N', 'D', 'R'):
+            case B_PACK_CHARS('R', 'E', 'C', 'O'):
+            case B_PACK_CHARS('U', 'N', 'K', 'N'):
+                break;
+            default:
+                valid = false;
+                break;
+        }
+    }
+
+    size_t length = 0;
+    const char16_t* token = valid ? data.readString16Inplace(&length) : nullptr;
+    std::string descriptor = token ? String8(token, length).c_str() : "";
+    data.setDataPosition(position);
+
+    if (descriptor.empty()) return kUnknownInterface;
+
+    Interfaces& registry = interfaces();
+    RpcMutexLockGuard _l(registry.lock);
+    const auto [it, inserted] =
+            registry.indices.try_emplace(std::move(descriptor), registry.names.size());
+    if (inserted) registry.names.push_back(it->first);
+    return it->second;
+}
+
+void TransactionStats::record(uint32_t interface, uint32_t code, Clock::duration latency,
+                              size_t requestSize, size_t replySize) {
+    Table* const table = gTable.load(std::memory_order_acquire);
+    if (table == nullptr) return;
+
+    const uint64_t key = (uint64_t{interface} + 1) << 32 | code;
+    const uint64_t hash = key * 0x9e3779b97f4a7c15;
+
+    Entry* entry = nullptr;
+    for (size_t probe = 0; probe < kMaxProbes; probe++) {
+        Entry& candidate = table->entries[((hash >> 32) + probe) % kEntries];
+        uint64_t current = candidate.key.load(std::memory_order_acquire);
+        if (current == 0 &&
+            candidate.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+            entry = &candidate;
+            break;
+        }
+        if (current == key) {
+            entry = &candidate;
+            break;
+        }
+    }
+
+    if (entry == nullptr) {
+        table->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const uint64_t latencyUs =
+            std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+
+    entry->count.fetch_add(1, std::memory_order_relaxed);
+    entry->totalLatencyUs.fetch_add(latencyUs, std::memory_order_relaxed);
+    uint64_t maxLatencyUs = entry->maxLatencyUs.load(std::memory_order_relaxed);
+    while (latencyUs > maxLatencyUs &&
+           !entry->maxLatencyUs.compare_exchange_weak(maxLatencyUs, latencyUs,
+                                                      std::memory_order_relaxed)) {
+    }
+
+    entry->latencyUs.add(latencyUs);
+    entry->requestSize.add(requestSize);
+    entry->replySize.add(replySize);
+}
+
+std::string TransactionStats::dump() {
+    std::string out = "Binder transaction stats: ";
+    out += isEnabled() ? "enabled" : "disabled";
+    out += "\n";
+
+    const Table* const table = gTable.load(std::memory_order_acquire);
+    if (table == nullptr) return out;
+
+    std::vector<std::string> names;
+    {
+        Interfaces& registry = interfaces();
+        RpcMutexLockGuard _l(registry.lock);
+        names = registry.names;
+    }
+
+    // Sorted by interface descriptor, then code.
+    std::map<std::tuple<std::string, uint32_t>, const Entry*> sorted;
+    for (const Entry& entry : table->entries) {
+        const uint64_t key = entry.key.load(std::memory_order_acquire);
+        if (key == 0) continue;
+
+        const uint32_t interface = static_cast<uint32_t>(key >> 32) - 1;
+        const uint32_t code = static_cast<uint32_t>(key);
+        sorted.emplace(std::make_tuple(interface < names.size() ? names[interface] : names[0],
+                                       code),
+                       &entry);
+    }
+
+    for (const auto& [key, entry] : sorted) {
+        const auto& [name, code] = key;
+        const uint64_t count = entry->count.load(std::memory_order_relaxed);
+        const uint64_t totalLatencyUs = entry->totalLatencyUs.load(std::memory_order_relaxed);
+
+        out += "  " + name + " code " + codeToString(code) + ": count=" + std::to_string(count) +
+                " mean_us=" + std::to_string(count ? totalLatencyUs / count : 0) + " max_us=" +
+                std::to_string(entry->maxLatencyUs.load(std::memory_order_relaxed)) + "\n";
+        entry->latencyUs.dump(out, "latency_us");
+        entry->requestSize.dump(out, "request_bytes");
+        entry->replySize.dump(out, "reply_bytes");
+    }
+
+    const uint64_t dropped = table->dropped.load(std::memory_order_relaxed);
+    if (dropped > 0) {
+        out += "  " + std::to_string(dropped) + " transactions dropped, since the table is full\n";
+    }
+    return out;
+}
+
+} // namespace android
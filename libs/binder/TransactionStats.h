@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace android {
+
+class Parcel;
+
+// Opt-in histograms of the round-trip latency, and the request and reply sizes, of the
+// transactions that this process makes through BpBinder, per interface descriptor and code.
+//
+// Recording is lock-free. The interface of a proxy is resolved once from the interface token of
+// its first call, and (interface, code) pairs claim entries of a fixed-size table, so recording a
+// transaction is a handful of relaxed atomic increments. Transactions of pairs that no longer fit
+// in the table are only counted as dropped.
+class TransactionStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Attributed to transactions whose interface is not known.
+    static constexpr uint32_t kUnknownInterface = 0;
+
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    // Returns the interface whose token starts `data`, or kUnknownInterface if there is none.
+    static uint32_t interfaceOf(const Parcel& data);
+
+    static void record(uint32_t interface, uint32_t code, Clock::duration latency,
+                       size_t requestSize, size_t replySize);
+
+    static std::string dump();
+
+private:
+    static std::atomic_bool sEnabled;
+};
+
+} // namespace android
@@ -123,6 +123,7 @@ private:
     void removeRpcServerLink(const sp<RpcServerLink>& link);
     [[nodiscard]] status_t startRecordingTransactions(const Parcel& data);
     [[nodiscard]] status_t stopRecordingTransactions();
+    [[nodiscard]] status_t transactBatch(const Parcel& data, uint32_t flags);
 
     std::atomic<Extras*> mExtras;
 
@@ -21,7 +21,10 @@
 #include <binder/RpcThreads.h>
 #include <binder/unique_fd.h>
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <memory>
 #include <optional>
 #include <unordered_map>
 #include <variant>
@@ -30,6 +33,7 @@
 namespace android {
 
 class IPCThreadState;
+class OnewayBatch;
 class RpcSession;
 class RpcState;
 namespace internal {
@@ -62,6 +66,14 @@ public:
     LIBBINDER_EXPORTED virtual status_t linkToDeath(const sp<DeathRecipient>& recipient,
                                                     void* cookie = nullptr, uint32_t flags = 0);
 
+    // Like linkToDeath, but the deaths of the binders which the recipient is linked to are
+    // reported together when a binder thread pool thread gets them one after the other, as when
+    // the process that hosts them dies. Ends with unlinkToDeath.
+    // NOLINTNEXTLINE(google-default-arguments)
+    LIBBINDER_EXPORTED status_t linkToDeathBatched(
+            const sp<IBinder::BatchedDeathRecipient>& recipient, void* cookie = nullptr,
+            uint32_t flags = 0);
+
     // NOLINTNEXTLINE(google-default-arguments)
     LIBBINDER_EXPORTED virtual status_t unlinkToDeath(const wp<DeathRecipient>& recipient,
                                                       void* cookie = nullptr, uint32_t flags = 0,
@@ -96,11 +108,37 @@ public:
     LIBBINDER_EXPORTED static void setBinderProxyCountWatermarks(int high, int low, int warning);
     LIBBINDER_EXPORTED static uint32_t getBinderProxyCount();
 
+    // Starts or stops collecting the latency and size of the transactions that this process
+    // makes, per interface and code. See IBinder::getTransactionStats.
+    LIBBINDER_EXPORTED static void setTransactionStatsEnabled(bool enable);
+
+    // Collects consecutive oneway calls to this binder into one kernel transaction, which the
+    // receiving BBinder unpacks into the original calls, in order. A batch is sent once 'window'
+    // has elapsed since its first call, before it would exceed 'maxBytes', and before any other
+    // transaction to this binder. Calls that carry binders or file descriptors are not batched.
+    //
+    // Since a batched call is only queued, transact returns the status of sending the previous
+    // batch, if it did, and errors of sending a batch later are only logged.
+    //
+    // A zero 'window' sends the pending calls and stops batching. Only for kernel binders.
+    LIBBINDER_EXPORTED status_t setOnewayBatching(std::chrono::microseconds window,
+                                                  size_t maxBytes);
+    // Sends the pending batch of oneway calls, if any. See setOnewayBatching.
+    LIBBINDER_EXPORTED status_t flushOnewayBatch();
+
     LIBBINDER_EXPORTED std::optional<int32_t> getDebugBinderHandle() const;
 
-    // Start recording transactions to the unique_fd.
+    // Flags for startRecordingBinder.
+    enum : uint32_t {
+        // Writes the recording in LZ4 frames. Read it with binder::debug::RecordingReader.
+        RECORDING_COMPRESSED = 1 << 0,
+    };
+
+    // Start recording transactions to the unique_fd. The binder writes them on a thread of its
+    // own, and drops transactions rather than blocking when writing falls behind.
     // See RecordedTransaction.h for more details.
-    LIBBINDER_EXPORTED status_t startRecordingBinder(const binder::unique_fd& fd);
+    LIBBINDER_EXPORTED status_t startRecordingBinder(const binder::unique_fd& fd,
+                                                     uint32_t flags = 0);
     // Stop the current recording.
     LIBBINDER_EXPORTED status_t stopRecordingBinder();
 
@@ -206,6 +244,8 @@ private:
         wp<DeathRecipient> recipient;
         void* cookie;
         uint32_t flags;
+        // Whether recipient is a BatchedDeathRecipient.
+        bool batched = false;
     };
 
     void onFrozenStateChanged(bool isFrozen);
@@ -216,8 +256,12 @@ private:
         bool initialStateReceived = false;
     };
 
+    status_t linkToDeathInternal(const sp<DeathRecipient>& recipient, void* cookie, uint32_t flags,
+                                 bool batched);
     void reportOneDeath(const Obituary& obit);
     bool isDescriptorCached() const;
+    void recordTransactionStats(uint32_t code, const Parcel& data, const Parcel* reply,
+                                std::chrono::nanoseconds latency);
 
     mutable RpcMutex mLock;
     volatile int32_t mAlive;
@@ -227,6 +271,11 @@ private:
     ObjectManager mObjects;
     mutable String16 mDescriptorCache;
     int32_t mTrackedUid;
+    // Interface that transaction stats are attributed to, once resolved from a call.
+    std::atomic<uint32_t> mTransactionStatsInterface;
+    // Set once oneway batching is first enabled, and kept until destruction.
+    std::unique_ptr<OnewayBatch> mOnewayBatch;
+    std::atomic_bool mOnewayBatching;
 
     static RpcMutex sTrackingLock;
     static std::unordered_map<int32_t, uint32_t> sTrackingMap;
@@ -24,6 +24,9 @@
 #include <utils/Vector.h>
 
 #include <functional>
+#include <optional>
+#include <string>
+#include <vector>
 
 // linux/binder.h defines this, but we don't want to include it here in order to
 // avoid exporting the kernel headers
@@ -65,6 +68,8 @@ public:
         EXTENSION_TRANSACTION = B_PACK_CHARS('_', 'E', 'X', 'T'),
         DEBUG_PID_TRANSACTION = B_PACK_CHARS('_', 'P', 'I', 'D'),
         SET_RPC_CLIENT_TRANSACTION = B_PACK_CHARS('_', 'R', 'P', 'C'),
+        TRANSACTION_STATS_TRANSACTION = B_PACK_CHARS('_', 'T', 'S', 'T'),
+        BATCH_TRANSACTION = B_PACK_CHARS('_', 'B', 'A', 'T'),
 
         // See android.os.IBinder.TWEET_TRANSACTION
         // Most importantly, messages can be anything not exceeding 130 UTF-8
@@ -161,6 +166,15 @@ public:
      */
     status_t                getDebugPid(pid_t* outPid);
 
+    /**
+     * Get the transaction stats of the process hosting this binder, for debugging. These are
+     * histograms of the latency and size of the transactions that the process made, per interface
+     * and code. If @a enable is set, collection is started or stopped first. Collection is off by
+     * default, and only root, system, and shell may get the stats of another process.
+     */
+    status_t                getTransactionStats(std::string* out,
+                                                std::optional<bool> enable = std::nullopt);
+
     /**
      * Set the RPC client fd to this binder service, for debugging. This is only available on
      * debuggable builds.
@@ -202,6 +216,17 @@ public:
         virtual void binderDied(const wp<IBinder>& who) = 0;
     };
 
+    /**
+     * A DeathRecipient which is told in one call about the binders that die together, such as the
+     * binders of a process that died, so that it can clean up after all of them at once. See
+     * BpBinder::linkToDeathBatched.
+     */
+    class BatchedDeathRecipient : public DeathRecipient {
+    public:
+        virtual void bindersDied(const std::vector<wp<IBinder>>& who) = 0;
+        void binderDied(const wp<IBinder>& who) override { bindersDied({who}); }
+    };
+
     class FrozenStateChangeCallback : public virtual RefBase {
     public:
         enum class State {
@@ -209,6 +209,8 @@ public:
     LIBBINDER_EXPORTED static const int32_t kUnsetWorkSource = -1;
 
 private:
+    friend class BpBinder;
+
     IPCThreadState();
     ~IPCThreadState();
 
@@ -223,6 +225,16 @@ private:
     void processPendingDerefs();
     void processPostWriteDerefs();
 
+    // Defers the death of who to be reported to recipient along with the deaths that the
+    // threadpool reads right after it. Returns false if this thread is not in the threadpool, in
+    // which case it should be reported right away.
+    bool deferObituary(const sp<IBinder::BatchedDeathRecipient>& recipient,
+                       const wp<IBinder>& who);
+    // Reports the deferred deaths of the process, in one call to each recipient.
+    void reportDeferredObituaries();
+    // Whether the driver has commands that this thread could read without waiting.
+    bool hasPendingCommands() const;
+
     void clearCaller();
 
     static  void                threadDestructor(void *st);
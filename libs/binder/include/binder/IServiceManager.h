@@ -149,6 +149,13 @@ public:
         int pid;
     };
     virtual std::vector<ServiceDebugInfo> getServiceDebugInfo() = 0;
+
+    /**
+     * Retrieve existing services in one call to the service manager, non-blocking. The result
+     * has an entry for each of names, which is nullptr if that service does not exist yet.
+     * Services which are lazy are started, so a following waitForService returns sooner.
+     */
+    virtual std::vector<sp<IBinder>> getServices(const std::vector<String16>& names);
 };
 
 LIBBINDER_EXPORTED sp<IServiceManager> defaultServiceManager();
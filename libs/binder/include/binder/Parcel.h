@@ -17,6 +17,7 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <limits>
 #include <map> // for legacy reasons
 #include <optional>
@@ -673,6 +674,13 @@ private:
     void                releaseObjects();
     void                acquireObjects();
     status_t            growData(size_t len);
+    // Returns a data buffer of `desired` bytes holding the start of the current data, which must
+    // be owned, or nullptr if it could not be allocated. For `desired` of 0, frees the buffer.
+    uint8_t*            reallocData(size_t desired);
+    // Returns an object offsets buffer of `capacity` entries holding the current offsets, which
+    // must be owned, or nullptr if it could not be allocated.
+    binder_size_t*      reallocObjects(size_t capacity);
+    void                freeObjects();
     // Clear the Parcel and set the capacity to `desired`.
     // Doesn't reset the RPC session association.
     status_t            restartWrite(size_t desired);
@@ -1390,6 +1398,16 @@ private:
 
     size_t mReserved;
 
+    // Most transactions are small enough for their data and object offsets to be stored in the
+    // Parcel itself, so that mData and mObjects only point to heap buffers for larger ones.
+    static constexpr size_t kInlineDataCapacity = 256;
+    static constexpr size_t kInlineObjectsCapacity = 4;
+
+    bool isInlineData() const { return mData == mInlineData; }
+
+    alignas(std::max_align_t) uint8_t mInlineData[kInlineDataCapacity];
+    binder_size_t mInlineObjects[kInlineObjectsCapacity];
+
     class Blob {
     public:
         LIBBINDER_EXPORTED Blob();
@@ -35,11 +35,14 @@ public:
     explicit ParcelableHolder(Stability stability) : mStability(stability){}
     virtual ~ParcelableHolder() = default;
     ParcelableHolder(const ParcelableHolder& other) {
-        mParcelable = other.mParcelable;
         mParcelableName = other.mParcelableName;
         if (other.mParcelPtr) {
+            // The parcelable unparceled from it, if any, is left to be unparceled again, so that
+            // it is not shared with a copy which may modify it.
             mParcelPtr = std::make_unique<Parcel>();
             mParcelPtr->appendFrom(other.mParcelPtr.get(), 0, other.mParcelPtr->dataSize());
+        } else {
+            mParcelable = other.mParcelable;
         }
         mStability = other.mStability;
     }
@@ -72,41 +75,56 @@ public:
         return android::OK;
     }
 
+    /**
+     * Returns the held parcelable, which the caller may modify, so the holder is parceled from it
+     * from then on.
+     */
     template <typename T>
     status_t getParcelable(std::shared_ptr<T>* ret) const {
+        std::shared_ptr<const T> parcelable;
+        status_t status = getParcelable(&parcelable);
+        if (parcelable) this->mParcelPtr = nullptr;
+        *ret = std::const_pointer_cast<T>(parcelable);
+        return status;
+    }
+
+    /**
+     * Returns the held parcelable without allowing it to be modified. It is unparceled on the
+     * first call and kept for the later ones, and the parcel which it was read from is still
+     * written as is, so that a holder which is only passed along is not parceled again.
+     */
+    template <typename T>
+    status_t getParcelable(std::shared_ptr<const T>* ret) const {
         static_assert(std::is_base_of<Parcelable, T>::value, "T must be derived from Parcelable");
-        const String16& parcelableDesc = T::getParcelableDescriptor();
-        if (!this->mParcelPtr) {
-            if (!this->mParcelable || !this->mParcelableName) {
-                ALOGD("empty ParcelableHolder");
-                *ret = nullptr;
-                return android::OK;
-            } else if (parcelableDesc != *mParcelableName) {
-                ALOGD("extension class name mismatch expected:%s actual:%s",
-                      String8(*mParcelableName).c_str(), String8(parcelableDesc).c_str());
-                *ret = nullptr;
-                return android::BAD_VALUE;
-            }
-            *ret = std::static_pointer_cast<T>(mParcelable);
+        *ret = nullptr;
+        if (!this->mParcelPtr && (!this->mParcelable || !this->mParcelableName)) {
+            ALOGD("empty ParcelableHolder");
             return android::OK;
         }
-        this->mParcelPtr->setDataPosition(0);
-        status_t status = this->mParcelPtr->readString16(&this->mParcelableName);
-        if (status != android::OK || parcelableDesc != this->mParcelableName) {
-            this->mParcelableName = std::nullopt;
-            *ret = nullptr;
-            return status;
+        if (this->mParcelPtr && !this->mParcelableName) {
+            this->mParcelPtr->setDataPosition(0);
+            status_t status = this->mParcelPtr->readString16(&this->mParcelableName);
+            if (status != android::OK) return status;
         }
-        this->mParcelable = std::make_shared<T>();
-        status = mParcelable.get()->readFromParcel(this->mParcelPtr.get());
-        if (status != android::OK) {
-            this->mParcelableName = std::nullopt;
-            this->mParcelable = nullptr;
-            *ret = nullptr;
-            return status;
+        const String16& parcelableDesc = T::getParcelableDescriptor();
+        if (!this->mParcelableName || parcelableDesc != *this->mParcelableName) {
+            if (this->mParcelPtr) return android::OK;
+            ALOGD("extension class name mismatch expected:%s actual:%s",
+                  String8(*mParcelableName).c_str(), String8(parcelableDesc).c_str());
+            return android::BAD_VALUE;
         }
-        this->mParcelPtr = nullptr;
-        *ret = std::static_pointer_cast<T>(mParcelable);
+        if (!this->mParcelable) {
+            // Past the name, which was read already.
+            this->mParcelPtr->setDataPosition(0);
+            std::optional<String16> name;
+            status_t status = this->mParcelPtr->readString16(&name);
+            if (status != android::OK) return status;
+            auto parcelable = std::make_shared<T>();
+            status = parcelable->readFromParcel(this->mParcelPtr.get());
+            if (status != android::OK) return status;
+            this->mParcelable = std::move(parcelable);
+        }
+        *ret = std::static_pointer_cast<const T>(this->mParcelable);
         return android::OK;
     }
 
@@ -27,6 +27,7 @@
 #include <chrono>
 #include <condition_variable>
 #include <mutex>
+#include <vector>
 
 // ---------------------------------------------------------------------------
 namespace android {
@@ -130,6 +131,32 @@ public:
      */
     LIBBINDER_EXPORTED bool isThreadPoolStarted() const;
 
+    // Makes the threadpool shrink once it has idled. A pooled thread that finishes a command
+    // retires, rather than waiting for the next one, when no command had to wait for a free thread
+    // within the last 'idleTimeout', and at least one other thread is idle. At most one thread
+    // retires per 'idleTimeout', and the kernel starts a replacement as soon as every remaining
+    // thread is busy, so the threadpool grows back up to setThreadPoolMaxThreadCount under load.
+    //
+    // Zero, the default, keeps every thread that the kernel started.
+    LIBBINDER_EXPORTED void setThreadPoolIdleTimeout(std::chrono::milliseconds idleTimeout);
+
+    struct ThreadPoolStats {
+        // Threads that have joined the threadpool, and those of them executing a command.
+        size_t currentThreads;
+        size_t executingThreads;
+        // Most threads that were executing a command at once.
+        size_t peakExecutingThreads;
+        // Pooled threads that retired after idling. See setThreadPoolIdleTimeout.
+        size_t retiredThreads;
+        // Times that every thread of the threadpool was busy, so that incoming commands had to
+        // wait for a free thread, and the total and longest duration of those waits.
+        uint64_t saturationCount;
+        std::chrono::nanoseconds totalSaturationTime;
+        std::chrono::nanoseconds maxSaturationTime;
+    };
+    // Utilization and queueing metrics of the threadpool, since the process started.
+    LIBBINDER_EXPORTED ThreadPoolStats getThreadPoolStats() const;
+
     enum class DriverFeature {
         ONEWAY_SPAM_DETECTION,
         EXTENDED_ERROR,
@@ -155,6 +182,14 @@ private:
     ProcessState& operator=(const ProcessState& o);
     String8 makeBinderThreadName();
 
+    // Called by IPCThreadState when a thread of the threadpool starts executing a command, with the
+    // number of threads now executing one, and when it finishes.
+    void onCommandStarted(size_t executingThreads);
+    void onCommandFinished();
+    // Whether a pooled thread that just finished a command should leave the threadpool. If so, the
+    // thread is counted as retired.
+    bool shouldRetireThread();
+
     struct handle_entry {
         IBinder* binder;
         RefBase::weakref_type* refs;
@@ -181,9 +216,31 @@ private:
     std::atomic_size_t mKernelStartedThreads;
     // Time when thread pool was emptied
     std::atomic<std::chrono::steady_clock::time_point> mStarvationStartTime;
+    // Time when every thread inside the thread pool became busy, if they still are.
+    std::atomic<std::chrono::steady_clock::time_point> mSaturationStartTime;
+    // Time when the thread pool was last saturated, or a thread last retired.
+    std::atomic<std::chrono::steady_clock::time_point> mLastBusyTime;
+    std::atomic_size_t mPeakExecutingThreads;
+    std::atomic_uint64_t mSaturationCount;
+    std::atomic_int64_t mTotalSaturationNs;
+    std::atomic_int64_t mMaxSaturationNs;
+    // See setThreadPoolIdleTimeout. The kernel never forgets the threads that it started, so its
+    // max thread count is raised by the number of pooled threads that retired.
+    std::atomic<std::chrono::milliseconds> mIdleTimeout;
+    std::atomic_size_t mRetiredThreads;
 
     static constexpr auto never = &std::chrono::steady_clock::time_point::min;
 
+    // The deaths of binders linked with BpBinder::linkToDeathBatched, which the threadpool
+    // reports once it has read the deaths that arrived along with them.
+    struct DeferredObituary {
+        sp<IBinder::BatchedDeathRecipient> recipient;
+        wp<IBinder> who;
+    };
+    std::mutex mDeferredObituariesLock;
+    std::vector<DeferredObituary> mDeferredObituaries;
+    std::atomic_bool mHasDeferredObituaries = false;
+
     mutable std::mutex mLock; // protects everything below.
 
     Vector<handle_entry> mHandleToObject;
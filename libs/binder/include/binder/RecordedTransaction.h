@@ -20,9 +20,13 @@
 #include <binder/Parcel.h>
 #include <binder/unique_fd.h>
 #include <mutex>
+#include <optional>
+#include <vector>
 
 namespace android {
 
+class TransactionRecorder;
+
 namespace binder::debug {
 
 // Warning: Transactions are sequentially recorded to the file descriptor in a
@@ -54,10 +58,23 @@ public:
     LIBBINDER_EXPORTED const std::vector<uint64_t>& getObjectOffsets() const;
 
 private:
+    friend class RecordingReader;
+    friend class ::android::TransactionRecorder;
+
     RecordedTransaction() = default;
 
-    android::status_t writeChunk(const binder::borrowed_fd, uint32_t chunkType, size_t byteCount,
-                                 const uint8_t* data) const;
+    // Reads the transaction at the start of data. Returns NOT_ENOUGH_DATA if data ends before it
+    // does.
+    static status_t fromBuffer(const uint8_t* data, size_t size,
+                               std::optional<RecordedTransaction>* outTransaction,
+                               size_t* outConsumed);
+    // Appends the transaction to out, in the format that dumpToFile writes.
+    status_t appendTo(std::vector<uint8_t>* out) const;
+
+    // Takes in the payload of a chunk whose checksum has been verified.
+    status_t applyChunk(uint32_t chunkType, uint32_t dataSize, const uint8_t* data);
+    static status_t appendChunk(std::vector<uint8_t>* out, uint32_t chunkType, size_t byteCount,
+                                const uint8_t* data);
 
 #pragma clang diagnostic push
 #pragma clang diagnostic error "-Wpadded"
@@ -84,6 +101,27 @@ private:
     Parcel mReplyDataOnly;
 };
 
+// Reads the transactions of a recording in order, whether or not it was compressed. See
+// BpBinder::startRecordingBinder.
+class RecordingReader {
+public:
+    LIBBINDER_EXPORTED explicit RecordingReader(binder::unique_fd fd);
+
+    // The next transaction, or std::nullopt at the end of the recording or if the rest of it is
+    // malformed.
+    LIBBINDER_EXPORTED std::optional<RecordedTransaction> next();
+
+private:
+    // Appends the next frame of the recording to mBuffer. False at the end of the file.
+    bool readFrame();
+
+    binder::unique_fd mFd;
+    std::optional<bool> mCompressed;
+    // Bytes of the uncompressed recording, of which those before mPosition were read.
+    std::vector<uint8_t> mBuffer;
+    size_t mPosition = 0;
+};
+
 } // namespace binder::debug
 
 } // namespace android
@@ -31,6 +31,7 @@
 namespace android {
 
 class FdTrigger;
+class RpcEventLoop;
 class RpcServerTrusty;
 class RpcSocketAddress;
 
@@ -140,6 +141,23 @@ public:
     LIBBINDER_EXPORTED void setMaxThreads(size_t threads);
     LIBBINDER_EXPORTED size_t getMaxThreads();
 
+    /**
+     * By default, each incoming connection of a session is served by a thread of its own, which
+     * waits on it for the next command, so that every idle connection still costs a thread. If
+     * this is set, the connections of all the sessions are instead watched by an event loop with
+     * this many threads, and a connection only takes one of them while commands on it are
+     * executed.
+     *
+     * The threads then bound how many commands are executed at once across all sessions. As with
+     * too few threads in a session, calls which wait on each other can deadlock once they take
+     * up all of the threads.
+     *
+     * This must be called before join(). Zero, the default, is thread-per-connection. Not
+     * supported on single-threaded libbinder.
+     */
+    LIBBINDER_EXPORTED void setEventLoopThreads(size_t threads);
+    LIBBINDER_EXPORTED size_t getEventLoopThreads();
+
     /**
      * By default, the latest protocol version which is supported by a client is
      * used. However, this can be used in order to prevent newer protocol
@@ -272,6 +290,7 @@ private:
 
     const std::unique_ptr<RpcTransportCtx> mCtx;
     size_t mMaxThreads = 1;
+    size_t mEventLoopThreads = 0;
     std::optional<uint32_t> mProtocolVersion;
     // A mode is supported if the N'th bit is on, where N is the mode enum's value.
     std::bitset<8> mSupportedFileDescriptorTransportModes = std::bitset<8>().set(
@@ -282,6 +301,8 @@ private:
     std::unique_ptr<RpcMaybeThread> mJoinThread;
     bool mJoinThreadRunning = false;
     std::map<RpcMaybeThread::id, RpcMaybeThread> mConnectingThreads;
+    // Set while joined, if mEventLoopThreads is.
+    std::shared_ptr<RpcEventLoop> mEventLoop;
 
     sp<IBinder> mRootObject;
     wp<IBinder> mRootObjectWeak;
@@ -24,12 +24,15 @@
 #include <utils/RefBase.h>
 
 #include <map>
+#include <memory>
 #include <optional>
+#include <variant>
 #include <vector>
 
 namespace android {
 
 class Parcel;
+class RpcEventLoop;
 class RpcServer;
 class RpcServerTrusty;
 class RpcSocketAddress;
@@ -37,9 +40,9 @@ class RpcState;
 class RpcTransport;
 class FdTrigger;
 
-constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION_NEXT = 2;
+constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION_NEXT = 3;
 constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION_EXPERIMENTAL = 0xF0000000;
-constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION = 1;
+constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION = 2;
 
 // Starting with this version:
 //
@@ -47,6 +50,12 @@ constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION = 1;
 // * RpcWireTransaction and RpcWireReplyV1 include the parcel data size.
 constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_EXPLICIT_PARCEL_SIZE = 1;
 
+// Starting with this version:
+//
+// * RpcWireTransaction and RpcWireReply carry a transaction ID, so that several synchronous
+//   transactions may be outstanding on one connection (see RpcSession::Pipeline).
+constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID = 2;
+
 /**
  * This represents a session (group of connections) between a client
  * and a server. Multiple connections are needed for multiple parallel "binder"
@@ -197,6 +206,15 @@ public:
                                                        const Parcel& data, Parcel* reply,
                                                        uint32_t flags);
 
+    class Pipeline;
+
+    /**
+     * Starts sending synchronous transactions on one connection without waiting for the reply of
+     * each before sending the next, see Pipeline. Returns INVALID_OPERATION if the protocol
+     * version is older than RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID.
+     */
+    [[nodiscard]] LIBBINDER_EXPORTED status_t startPipeline(std::unique_ptr<Pipeline>* out);
+
     /**
      * Generally, you should not call this, unless you are testing error
      * conditions, as this is called automatically by BpBinders when they are
@@ -231,6 +249,7 @@ private:
     friend RpcServer;
     friend RpcServerTrusty;
     friend RpcState;
+    friend RpcEventLoop;
     explicit RpcSession(std::unique_ptr<RpcTransportCtx> ctx);
 
     static constexpr size_t kDefaultMaxOutgoingConnections = 10;
@@ -242,6 +261,9 @@ private:
     // for 'target', see RpcState::sendDecStrongToTarget
     [[nodiscard]] status_t sendDecStrongToTarget(uint64_t address, size_t target);
 
+    // Whether a Pipeline may send a transaction with 'code' to 'binder'.
+    [[nodiscard]] status_t checkPipelinedTransaction(const sp<IBinder>& binder, uint32_t code);
+
     class EventListener : public virtual RefBase {
     public:
         virtual void onSessionAllIncomingThreadsEnded(const sp<RpcSession>& session) = 0;
@@ -268,6 +290,24 @@ private:
         std::optional<uint64_t> exclusiveTid;
 
         bool allowNested = false;
+
+        // Starting at RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID, synchronous
+        // transactions carry an ID which their reply carries back, so that the replies of
+        // several transactions outstanding on this connection can be told apart.
+        uint32_t lastTransactionId = 0;
+
+        // A reply which was read while waiting for another one.
+        struct PendingReply {
+            bool received = false;
+            status_t status = OK;
+            std::unique_ptr<uint8_t[]> data;
+            size_t dataSize = 0;
+            const uint32_t* objectTable = nullptr;
+            size_t objectTableSize = 0;
+            std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>> ancillaryFds;
+        };
+        // Transactions of a Pipeline waiting for their reply, by ID.
+        std::map<uint32_t, PendingReply> pendingReplies;
     };
 
     [[nodiscard]] status_t readId();
@@ -290,6 +330,18 @@ private:
     PreJoinSetupResult preJoinSetup(std::unique_ptr<RpcTransport> rpcTransport);
     // join on thread passed to preJoinThreadOwnership
     static void join(sp<RpcSession>&& session, PreJoinSetupResult&& result);
+    // The parts of join which it ends with, for RpcEventLoop to take over a connection from the
+    // thread which set it up. endJoinThreadOwnership releases the thread passed to
+    // preJoinThreadOwnership, and must be called on it.
+    void endJoinThreadOwnership();
+    static void endIncomingConnection(sp<RpcSession>&& session,
+                                      const sp<RpcConnection>& connection);
+    // For RpcEventLoop, executes the commands which have arrived on an incoming connection, on
+    // the calling thread. Returns OK if the connection can be served again.
+    [[nodiscard]] static status_t executeArrivedCommands(const sp<RpcSession>& session,
+                                                         const sp<RpcConnection>& connection);
+    // Runs |fn| with the calling thread attached to the JVM, if there is one, like join does.
+    static void runAttachedToJavaVm(const std::function<void()>& fn);
 
     [[nodiscard]] status_t setupClient(
             const std::function<status_t(const std::vector<uint8_t>& sessionId, bool incoming)>&
@@ -404,4 +456,37 @@ private:
     } mConnections;
 };
 
+/**
+ * Synchronous transactions which are sent back to back on one connection of an RpcSession, so
+ * that a high-latency connection carries several of them at once, instead of one per round trip.
+ * The remote side executes them in order, one at a time, and their replies may be waited for in
+ * any order.
+ *
+ * A pipeline holds its connection until it is destroyed, and it must only be used on the thread
+ * that started it. That thread serves the nested calls that the remote side makes while it waits
+ * for a reply. While the remote side itself waits for the reply of a nested call, it executes the
+ * transactions that it receives as nested in that call.
+ */
+class RpcSession::Pipeline {
+public:
+    // Waits for the replies which have not been waited for.
+    LIBBINDER_EXPORTED ~Pipeline();
+
+    // Sends a transaction to a binder of this session, and returns the ID of its reply.
+    [[nodiscard]] LIBBINDER_EXPORTED status_t transact(const sp<IBinder>& binder, uint32_t code,
+                                                       const Parcel& data, uint32_t* outId);
+    // Reads the reply of a transaction sent by this pipeline. Each reply can be read once.
+    [[nodiscard]] LIBBINDER_EXPORTED status_t waitForReply(uint32_t id, Parcel* reply);
+
+private:
+    friend RpcSession;
+    explicit Pipeline(const sp<RpcSession>& session);
+
+    sp<RpcSession> mSession;
+    ExclusiveConnection mConnection;
+    uint64_t mThreadId;
+    // Transactions waiting for their reply.
+    std::vector<uint32_t> mIds;
+};
+
 } // namespace android
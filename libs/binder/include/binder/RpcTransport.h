@@ -45,10 +45,12 @@ class RpcTransportRaw;
 class RpcTransportTls;
 class RpcTransportTipcAndroid;
 class RpcTransportTipcTrusty;
+class RpcTransportUring;
 class RpcTransportCtxRaw;
 class RpcTransportCtxTls;
 class RpcTransportCtxTipcAndroid;
 class RpcTransportCtxTipcTrusty;
+class RpcTransportCtxUring;
 
 // Represents a socket connection.
 // No thread-safety is guaranteed for these APIs.
@@ -118,6 +120,7 @@ private:
     friend class ::android::RpcTransportTls;
     friend class ::android::RpcTransportTipcAndroid;
     friend class ::android::RpcTransportTipcTrusty;
+    friend class ::android::RpcTransportUring;
 
     RpcTransport() = default;
 };
@@ -149,6 +152,7 @@ private:
     friend class ::android::RpcTransportCtxTls;
     friend class ::android::RpcTransportCtxTipcAndroid;
     friend class ::android::RpcTransportCtxTipcTrusty;
+    friend class ::android::RpcTransportCtxUring;
 
     RpcTransportCtx() = default;
 };
@@ -24,6 +24,7 @@ namespace android {
 
 class BpBinder;
 class ProcessState;
+class RpcSession;
 
 namespace internal {
 
@@ -122,6 +123,7 @@ private:
 
     // only expose internal APIs inside of libbinder, for checking stability
     friend ::android::BpBinder;
+    friend ::android::RpcSession;
 
     // so that it can mark the context object (only the root object doesn't go
     // through Parcel)
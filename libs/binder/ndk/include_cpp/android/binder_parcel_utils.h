@@ -32,11 +32,16 @@
 #include <android/binder_parcel.h>
 
 #include <array>
+#include <cstdlib>
 #include <optional>
 #include <string>
 #include <type_traits>
 #include <vector>
 
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
 namespace ndk {
 
 namespace {
@@ -1378,6 +1383,134 @@ inline binder_status_t AParcel_readVector(const AParcel* parcel,
 
 // @END
 
+/**
+ * A read-only view of a primitive array in the data of a parcel, read without copying it. It is
+ * valid until the parcel is modified or deleted. Only arrays of int32_t, uint32_t, float and bytes
+ * can be viewed. See AParcel_readInt32ArrayView.
+ *
+ * AIDL parameters of this type are read and written with AParcel_readData and AParcel_writeData,
+ * like std::vector.
+ */
+template <typename T>
+class ParcelArrayView {
+   public:
+    ParcelArrayView() = default;
+    ParcelArrayView(const T* data, size_t size) : mData(data), mSize(size) {}
+
+    const T* data() const { return mData; }
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+    const T* begin() const { return mData; }
+    const T* end() const { return mData + mSize; }
+
+    /**
+     * Aborts if index is out of range.
+     */
+    const T& operator[](size_t index) const {
+        if (index >= mSize) {
+            syslog(LOG_ERR, "Index %zu out of range of a parcel array view of size %zu", index,
+                   mSize);
+            abort();
+        }
+        return mData[index];
+    }
+
+    std::vector<T> toVector() const { return std::vector<T>(begin(), end()); }
+
+#if __cplusplus >= 202002L
+    operator std::span<const T>() const { return std::span<const T>(mData, mSize); }
+#endif
+
+   private:
+    const T* mData = nullptr;
+    size_t mSize = 0;
+};
+
+#if !defined(__ANDROID_API__) || __ANDROID_API__ >= 36
+
+/**
+ * Reads a view of an optional array from the next location in a non-null parcel.
+ */
+template <typename T>
+static inline binder_status_t AParcel_readArrayView(const AParcel* parcel,
+                                                    std::optional<ParcelArrayView<T>>* view) {
+    const T* data = nullptr;
+    int32_t length = 0;
+    binder_status_t status;
+    if constexpr (std::is_same_v<int32_t, T>) {
+        status = AParcel_readInt32ArrayView(parcel, &data, &length);
+    } else if constexpr (std::is_same_v<uint32_t, T>) {
+        status = AParcel_readUint32ArrayView(parcel, &data, &length);
+    } else if constexpr (std::is_same_v<float, T>) {
+        status = AParcel_readFloatArrayView(parcel, &data, &length);
+    } else if constexpr (std::is_same_v<int8_t, T> || std::is_same_v<uint8_t, T>) {
+        const int8_t* bytes = nullptr;
+        status = AParcel_readByteArrayView(parcel, &bytes, &length);
+        data = reinterpret_cast<const T*>(bytes);
+    } else {
+        static_assert(dependent_false_v<T>, "arrays of this type cannot be viewed");
+    }
+    if (status != STATUS_OK) return status;
+
+    if (length < 0) {
+        view->reset();
+    } else {
+        view->emplace(data, static_cast<size_t>(length));
+    }
+    return STATUS_OK;
+}
+
+/**
+ * Reads a view of an array from the next location in a non-null parcel.
+ */
+template <typename T>
+static inline binder_status_t AParcel_readArrayView(const AParcel* parcel,
+                                                    ParcelArrayView<T>* view) {
+    std::optional<ParcelArrayView<T>> nullableView;
+    if (binder_status_t status = AParcel_readArrayView(parcel, &nullableView);
+        status != STATUS_OK) {
+        return status;
+    }
+    if (!nullableView) return STATUS_UNEXPECTED_NULL;
+    *view = *nullableView;
+    return STATUS_OK;
+}
+
+#endif  // !defined(__ANDROID_API__) || __ANDROID_API__ >= 36
+
+/**
+ * Writes the array of a view to the next location in a non-null parcel.
+ */
+template <typename T>
+static inline binder_status_t AParcel_writeArrayView(AParcel* parcel,
+                                                     const ParcelArrayView<T>& view) {
+    if (view.size() > INT32_MAX) return STATUS_BAD_VALUE;
+    const int32_t length = static_cast<int32_t>(view.size());
+
+    if constexpr (std::is_same_v<int32_t, T>) {
+        return AParcel_writeInt32Array(parcel, view.data(), length);
+    } else if constexpr (std::is_same_v<uint32_t, T>) {
+        return AParcel_writeUint32Array(parcel, view.data(), length);
+    } else if constexpr (std::is_same_v<float, T>) {
+        return AParcel_writeFloatArray(parcel, view.data(), length);
+    } else if constexpr (std::is_same_v<int8_t, T> || std::is_same_v<uint8_t, T>) {
+        return AParcel_writeByteArray(parcel, reinterpret_cast<const int8_t*>(view.data()),
+                                      length);
+    } else {
+        static_assert(dependent_false_v<T>, "arrays of this type cannot be viewed");
+    }
+}
+
+/**
+ * Writes the array of an optional view to the next location in a non-null parcel.
+ */
+template <typename T>
+static inline binder_status_t AParcel_writeArrayView(
+        AParcel* parcel, const std::optional<ParcelArrayView<T>>& view) {
+    if (!view) return AParcel_writeInt32(parcel, -1);
+    return AParcel_writeArrayView(parcel, *view);
+}
+
 /**
  * Convenience API for writing the size of a vector.
  */
@@ -1609,6 +1742,8 @@ template <typename T>
 static inline binder_status_t AParcel_writeData(AParcel* parcel, const T& value) {
     if constexpr (is_specialization_v<T, std::vector>) {
         return AParcel_writeVector(parcel, value);
+    } else if constexpr (is_specialization_v<T, ParcelArrayView>) {
+        return AParcel_writeArrayView(parcel, value);
     } else if constexpr (is_fixed_array_v<T>) {
         return AParcel_writeFixedArray(parcel, value);
     } else if constexpr (std::is_same_v<std::string, T>) {
@@ -1650,6 +1785,9 @@ static inline binder_status_t AParcel_writeNullableData(AParcel* parcel, const T
     if constexpr (is_specialization_v<T, std::optional> &&
                   is_specialization_v<first_template_type_t<T>, std::vector>) {
         return AParcel_writeVector(parcel, value);
+    } else if constexpr (is_specialization_v<T, std::optional> &&
+                         is_specialization_v<first_template_type_t<T>, ParcelArrayView>) {
+        return AParcel_writeArrayView(parcel, value);
     } else if constexpr (is_specialization_v<T, std::optional> &&
                          is_fixed_array_v<first_template_type_t<T>>) {
         return AParcel_writeNullableFixedArrayWithNullableData(parcel, value);
@@ -1676,6 +1814,8 @@ template <typename T>
 static inline binder_status_t AParcel_readData(const AParcel* parcel, T* value) {
     if constexpr (is_specialization_v<T, std::vector>) {
         return AParcel_readVector(parcel, value);
+    } else if constexpr (is_specialization_v<T, ParcelArrayView>) {
+        return AParcel_readArrayView(parcel, value);
     } else if constexpr (is_fixed_array_v<T>) {
         return AParcel_readFixedArray(parcel, value);
     } else if constexpr (std::is_same_v<std::string, T>) {
@@ -1717,6 +1857,9 @@ static inline binder_status_t AParcel_readNullableData(const AParcel* parcel, T*
     if constexpr (is_specialization_v<T, std::optional> &&
                   is_specialization_v<first_template_type_t<T>, std::vector>) {
         return AParcel_readVector(parcel, value);
+    } else if constexpr (is_specialization_v<T, std::optional> &&
+                         is_specialization_v<first_template_type_t<T>, ParcelArrayView>) {
+        return AParcel_readArrayView(parcel, value);
     } else if constexpr (is_specialization_v<T, std::optional> &&
                          is_fixed_array_v<first_template_type_t<T>>) {
         return AParcel_readNullableFixedArrayWithNullableData(parcel, value);
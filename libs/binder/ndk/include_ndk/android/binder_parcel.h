@@ -1207,6 +1207,77 @@ binder_status_t AParcel_marshal(const AParcel* parcel, uint8_t* buffer, size_t s
 binder_status_t AParcel_unmarshal(AParcel* parcel, const uint8_t* buffer, size_t len)
         __INTRODUCED_IN(33);
 
+// Parcels store the elements of other arrays widened (bool, char16_t) or only 4-byte aligned
+// (int64_t, uint64_t, double), so only these arrays can be viewed in place.
+
+/**
+ * Reads an array of int32_t from the next location in a non-null parcel, without copying it.
+ *
+ * On success, *arrayData points at the elements in the data of the parcel, which stay valid until
+ * the parcel is modified or deleted. It is null if the array is empty or null.
+ *
+ * Available since API level 36.
+ *
+ * \param parcel the parcel to read from.
+ * \param arrayData where to put the address of the elements.
+ * \param length where to put the length of the array, or -1 if the array is null.
+ *
+ * \return STATUS_OK on successful read.
+ */
+binder_status_t AParcel_readInt32ArrayView(const AParcel* parcel, const int32_t** arrayData,
+                                           int32_t* length) __INTRODUCED_IN(36);
+
+/**
+ * Reads an array of uint32_t from the next location in a non-null parcel, without copying it.
+ *
+ * On success, *arrayData points at the elements in the data of the parcel, which stay valid until
+ * the parcel is modified or deleted. It is null if the array is empty or null.
+ *
+ * Available since API level 36.
+ *
+ * \param parcel the parcel to read from.
+ * \param arrayData where to put the address of the elements.
+ * \param length where to put the length of the array, or -1 if the array is null.
+ *
+ * \return STATUS_OK on successful read.
+ */
+binder_status_t AParcel_readUint32ArrayView(const AParcel* parcel, const uint32_t** arrayData,
+                                            int32_t* length) __INTRODUCED_IN(36);
+
+/**
+ * Reads an array of float from the next location in a non-null parcel, without copying it.
+ *
+ * On success, *arrayData points at the elements in the data of the parcel, which stay valid until
+ * the parcel is modified or deleted. It is null if the array is empty or null.
+ *
+ * Available since API level 36.
+ *
+ * \param parcel the parcel to read from.
+ * \param arrayData where to put the address of the elements.
+ * \param length where to put the length of the array, or -1 if the array is null.
+ *
+ * \return STATUS_OK on successful read.
+ */
+binder_status_t AParcel_readFloatArrayView(const AParcel* parcel, const float** arrayData,
+                                           int32_t* length) __INTRODUCED_IN(36);
+
+/**
+ * Reads an array of int8_t from the next location in a non-null parcel, without copying it.
+ *
+ * On success, *arrayData points at the elements in the data of the parcel, which stay valid until
+ * the parcel is modified or deleted. It is null if the array is empty or null.
+ *
+ * Available since API level 36.
+ *
+ * \param parcel the parcel to read from.
+ * \param arrayData where to put the address of the elements.
+ * \param length where to put the length of the array, or -1 if the array is null.
+ *
+ * \return STATUS_OK on successful read.
+ */
+binder_status_t AParcel_readByteArrayView(const AParcel* parcel, const int8_t** arrayData,
+                                          int32_t* length) __INTRODUCED_IN(36);
+
 __END_DECLS
 
 /** @} */
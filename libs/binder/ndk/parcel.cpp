@@ -185,6 +185,28 @@ binder_status_t ReadArray<char16_t>(const AParcel* parcel, void* arrayData,
     return STATUS_OK;
 }
 
+template <typename T>
+binder_status_t ReadArrayView(const AParcel* parcel, const T** arrayData, int32_t* length) {
+    // Parcel data is only aligned to 4 bytes.
+    static_assert(alignof(T) <= sizeof(int32_t));
+
+    if (binder_status_t status = ReadAndValidateArraySize(parcel, length); status != STATUS_OK) {
+        return status;
+    }
+
+    *arrayData = nullptr;
+    if (*length <= 0) return STATUS_OK;
+
+    int32_t size = 0;
+    if (__builtin_smul_overflow(sizeof(T), *length, &size)) return STATUS_NO_MEMORY;
+
+    const void* data = parcel->get()->readInplace(size);
+    if (data == nullptr) return STATUS_NO_MEMORY;
+
+    *arrayData = static_cast<const T*>(data);
+    return STATUS_OK;
+}
+
 template <typename T>
 binder_status_t WriteArray(AParcel* parcel, const void* arrayData, int32_t length,
                            ArrayGetter<T> getter, status_t (Parcel::*write)(T)) {
@@ -731,4 +753,24 @@ binder_status_t AParcel_unmarshal(AParcel* parcel, const uint8_t* buffer, size_t
     return STATUS_OK;
 }
 
+binder_status_t AParcel_readInt32ArrayView(const AParcel* parcel, const int32_t** arrayData,
+                                           int32_t* length) {
+    return ReadArrayView<int32_t>(parcel, arrayData, length);
+}
+
+binder_status_t AParcel_readUint32ArrayView(const AParcel* parcel, const uint32_t** arrayData,
+                                            int32_t* length) {
+    return ReadArrayView<uint32_t>(parcel, arrayData, length);
+}
+
+binder_status_t AParcel_readFloatArrayView(const AParcel* parcel, const float** arrayData,
+                                           int32_t* length) {
+    return ReadArrayView<float>(parcel, arrayData, length);
+}
+
+binder_status_t AParcel_readByteArrayView(const AParcel* parcel, const int8_t** arrayData,
+                                          int32_t* length) {
+    return ReadArrayView<int8_t>(parcel, arrayData, length);
+}
+
 // @END
@@ -965,6 +965,53 @@ TEST(NdkBinder, ConvertToPlatformParcel) {
     EXPECT_EQ(42, pparcel->readInt32());
 }
 
+TEST(NdkBinder, ReadArrayViews) {
+    ndk::ScopedAParcel parcel = ndk::ScopedAParcel(AParcel_create());
+    std::vector<int32_t> ints = {1, 2, 3};
+    std::vector<uint8_t> bytes = {4, 5, 6, 7, 8};
+    std::optional<std::vector<float>> floats;
+    ASSERT_EQ(STATUS_OK, ndk::AParcel_writeVector(parcel.get(), ints));
+    ASSERT_EQ(STATUS_OK, ndk::AParcel_writeVector(parcel.get(), bytes));
+    ASSERT_EQ(STATUS_OK, ndk::AParcel_writeVector(parcel.get(), floats));
+    ASSERT_EQ(STATUS_OK, AParcel_setDataPosition(parcel.get(), 0));
+
+    ndk::ParcelArrayView<int32_t> intView;
+    ASSERT_EQ(STATUS_OK, ndk::AParcel_readData(parcel.get(), &intView));
+    EXPECT_EQ(ints, intView.toVector());
+    ndk::ParcelArrayView<uint8_t> byteView;
+    ASSERT_EQ(STATUS_OK, ndk::AParcel_readData(parcel.get(), &byteView));
+    EXPECT_EQ(bytes, byteView.toVector());
+    std::optional<ndk::ParcelArrayView<float>> floatView = ndk::ParcelArrayView<float>();
+    ASSERT_EQ(STATUS_OK, ndk::AParcel_readNullableData(parcel.get(), &floatView));
+    EXPECT_FALSE(floatView.has_value());
+
+    // The views point into the data of the parcel, rather than at copies.
+    const android::Parcel* pparcel = AParcel_viewPlatformParcel(parcel.get());
+    const uint8_t* begin = pparcel->data();
+    const uint8_t* end = begin + pparcel->dataSize();
+    EXPECT_GE(reinterpret_cast<const uint8_t*>(intView.data()), begin);
+    EXPECT_LE(reinterpret_cast<const uint8_t*>(intView.end()), end);
+    EXPECT_GE(byteView.data(), begin);
+    EXPECT_LE(byteView.end(), end);
+}
+
+TEST(NdkBinder, ReadArrayViewErrors) {
+    ndk::ScopedAParcel parcel = ndk::ScopedAParcel(AParcel_create());
+    std::optional<std::vector<int32_t>> ints;
+    ASSERT_EQ(STATUS_OK, ndk::AParcel_writeVector(parcel.get(), ints));
+    // A length beyond the end of the parcel.
+    ASSERT_EQ(STATUS_OK, AParcel_writeInt32(parcel.get(), 1000));
+    ASSERT_EQ(STATUS_OK, AParcel_writeInt32(parcel.get(), 1));
+    ASSERT_EQ(STATUS_OK, AParcel_setDataPosition(parcel.get(), 0));
+
+    ndk::ParcelArrayView<int32_t> view;
+    EXPECT_EQ(STATUS_UNEXPECTED_NULL, ndk::AParcel_readData(parcel.get(), &view));
+
+    const int32_t* data = nullptr;
+    int32_t length = 0;
+    EXPECT_NE(STATUS_OK, AParcel_readInt32ArrayView(parcel.get(), &data, &length));
+}
+
 TEST(NdkBinder, GetAndVerifyScopedAIBinder_Weak) {
     LIBBINDER_IGNORE("-Wdeprecated-declarations")
     ndk::SpAIBinder remoteBinder(AServiceManager_getService(kBinderNdkUnitTestService));
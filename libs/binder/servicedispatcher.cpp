@@ -131,6 +131,11 @@ public:
         // We can't send BpBinder for regular binder over RPC.
         return android::binder::Status::fromStatusT(android::INVALID_OPERATION);
     }
+    android::binder::Status getServices(const std::vector<std::string>&,
+                                        std::vector<android::os::Service>*) override {
+        // We can't send BpBinder for regular binder over RPC.
+        return android::binder::Status::fromStatusT(android::INVALID_OPERATION);
+    }
     android::binder::Status addService(const std::string&, const android::sp<android::IBinder>&,
                                        bool, int32_t) override {
         // We can't send BpBinder for RPC over regular binder.
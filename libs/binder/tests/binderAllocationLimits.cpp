@@ -162,6 +162,15 @@ TEST(BinderAllocation, ParcelOnStack) {
     imaginary_use = p.data();
 }
 
+TEST(BinderAllocation, SmallParcelOnStack) {
+    const auto m = ScopeDisallowMalloc();
+    Parcel p;
+    for (int32_t i = 0; i < 64; i++) {
+        p.writeInt32(i);
+    }
+    imaginary_use = p.data();
+}
+
 TEST(BinderAllocation, GetServiceManager) {
     defaultServiceManager(); // first call may alloc
     const auto m = ScopeDisallowMalloc();
@@ -213,15 +222,9 @@ TEST(BinderAllocation, SmallTransaction) {
     String16 empty_descriptor = String16("");
     sp<IServiceManager> manager = defaultServiceManager();
 
-    size_t mallocs = 0;
-    const auto on_malloc = OnMalloc([&](size_t bytes) {
-        mallocs++;
-        // Parcel should allocate a small amount by default
-        EXPECT_EQ(bytes, 128u);
-    });
+    // The request and reply fit in the Parcels themselves.
+    const auto m = ScopeDisallowMalloc();
     manager->checkService(empty_descriptor);
-
-    EXPECT_EQ(mallocs, 1u);
 }
 
 TEST(RpcBinderAllocation, SetupRpcServer) {
@@ -68,6 +68,16 @@ public:
         return binder::Status::ok();
     }
 
+    binder::Status getServices(const std::vector<std::string>& names,
+                               std::vector<os::Service>* _out) override {
+        _out->clear();
+        for (const std::string& name : names) {
+            sp<IBinder> binder = innerSm.getService(String16(name.c_str()));
+            _out->push_back(os::Service::make<os::Service::Tag::binder>(binder));
+        }
+        return binder::Status::ok();
+    }
+
     binder::Status addService(const std::string& name, const sp<IBinder>& service,
                               bool allowIsolated, int32_t dumpPriority) override {
         return binder::Status::fromStatusT(
@@ -189,6 +199,27 @@ TEST_F(LibbinderCacheTest, DoNotCacheServiceNotInList) {
     EXPECT_EQ(binder2, result);
 }
 
+TEST_F(LibbinderCacheTest, GetServicesFillsCache) {
+    sp<IBinder> binder1 = sp<BBinder>::make();
+    sp<IBinder> binder2 = sp<BBinder>::make();
+    String16 missingName = String16("MissingLibbinderCacheTest");
+
+    EXPECT_EQ(OK, mServiceManager->addService(kCachedServiceName, binder1));
+    std::vector<sp<IBinder>> result =
+            mServiceManager->getServices({kCachedServiceName, missingName});
+    ASSERT_EQ(2u, result.size());
+    EXPECT_EQ(binder1, result[0]);
+    EXPECT_EQ(nullptr, result[1]);
+
+    // Replace the service, which the cache should not see.
+    EXPECT_EQ(OK, mServiceManager->addService(kCachedServiceName, binder2));
+    result = mServiceManager->getServices({kCachedServiceName});
+    ASSERT_EQ(1u, result.size());
+    EXPECT_EQ(kUseLibbinderCache ? binder1 : binder2, result[0]);
+    EXPECT_EQ(kUseLibbinderCache ? binder1 : binder2,
+              mServiceManager->checkService(kCachedServiceName));
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
 
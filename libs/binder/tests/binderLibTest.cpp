@@ -22,6 +22,8 @@
 
 #include <chrono>
 #include <fstream>
+#include <mutex>
+#include <numeric>
 #include <thread>
 
 #include <gmock/gmock.h>
@@ -62,6 +64,7 @@ using android::binder::Status;
 using android::binder::unique_fd;
 using std::chrono_literals::operator""ms;
 using testing::ExplainMatchResult;
+using testing::HasSubstr;
 using testing::Matcher;
 using testing::Not;
 using testing::WithParamInterface;
@@ -131,7 +134,10 @@ enum BinderLibTestTranscationCode {
     BINDER_LIB_TEST_LOCK_UNLOCK,
     BINDER_LIB_TEST_PROCESS_LOCK,
     BINDER_LIB_TEST_UNLOCK_AFTER_MS,
-    BINDER_LIB_TEST_PROCESS_TEMPORARY_LOCK
+    BINDER_LIB_TEST_PROCESS_TEMPORARY_LOCK,
+    BINDER_LIB_TEST_GET_THREAD_POOL_STATS,
+    BINDER_LIB_TEST_APPEND_ONEWAY_VALUE,
+    BINDER_LIB_TEST_GET_ONEWAY_VALUES,
 };
 
 pid_t start_server_process(int arg2, bool usePoll = false)
@@ -536,6 +542,30 @@ class TestDeathRecipient : public IBinder::DeathRecipient, public BinderLibTestE
         };
 };
 
+class TestBatchedDeathRecipient : public IBinder::BatchedDeathRecipient,
+                                  public BinderLibTestEvent {
+public:
+    explicit TestBatchedDeathRecipient(size_t expectedDeaths) : mExpectedDeaths(expectedDeaths) {}
+
+    size_t getDeathCount() {
+        std::lock_guard lock(mMutex);
+        return mDeathCount;
+    }
+
+private:
+    void bindersDied(const std::vector<wp<IBinder>>& who) override {
+        std::lock_guard lock(mMutex);
+        mDeathCount += who.size();
+        if (mDeathCount >= mExpectedDeaths) {
+            triggerEvent();
+        }
+    }
+
+    const size_t mExpectedDeaths;
+    std::mutex mMutex;
+    size_t mDeathCount = 0;
+};
+
 TEST_F(BinderLibTest, CannotUseBinderAfterFork) {
     // EXPECT_DEATH works by forking the process
     EXPECT_DEATH({ ProcessState::self(); }, "libbinder ProcessState can not be used after fork");
@@ -603,6 +633,60 @@ TEST_F(BinderLibTest, NopTransactionClear) {
                 StatusEq(NO_ERROR));
 }
 
+TEST_F(BinderLibTest, TransactionStats) {
+    std::string stats;
+    EXPECT_THAT(m_server->getTransactionStats(&stats, true), StatusEq(NO_ERROR));
+    EXPECT_THAT(stats, HasSubstr("Binder transaction stats: enabled"));
+    EXPECT_THAT(m_server->getTransactionStats(&stats, false), StatusEq(NO_ERROR));
+    EXPECT_THAT(stats, HasSubstr("Binder transaction stats: disabled"));
+
+    BpBinder::setTransactionStatsEnabled(true);
+    Parcel data, reply;
+    data.writeInterfaceToken(String16("android.binder.ITransactionStatsTest"));
+    EXPECT_THAT(m_server->transact(BINDER_LIB_TEST_NOP_TRANSACTION, data, &reply),
+                StatusEq(NO_ERROR));
+    BpBinder::setTransactionStatsEnabled(false);
+
+    // A local binder reports the stats of this process.
+    EXPECT_THAT(sp<BBinder>::make()->getTransactionStats(&stats), StatusEq(NO_ERROR));
+    EXPECT_THAT(stats,
+                HasSubstr("android.binder.ITransactionStatsTest code " +
+                          std::to_string(BINDER_LIB_TEST_NOP_TRANSACTION) + ": count=1"));
+}
+
+TEST_F(BinderLibTest, OnewayBatching) {
+    sp<IBinder> server = addServer();
+    ASSERT_TRUE(server != nullptr);
+    BpBinder* proxy = server->remoteBinder();
+    ASSERT_NE(proxy, nullptr);
+
+    constexpr int32_t kCalls = 100;
+    // Small enough for the calls to take several batches.
+    EXPECT_THAT(proxy->setOnewayBatching(10ms, 256), StatusEq(NO_ERROR));
+    for (int32_t i = 0; i < kCalls; i++) {
+        Parcel data;
+        data.writeInt32(i);
+        EXPECT_THAT(server->transact(BINDER_LIB_TEST_APPEND_ONEWAY_VALUE, data, nullptr,
+                                     TF_ONE_WAY),
+                    StatusEq(NO_ERROR));
+    }
+    EXPECT_THAT(proxy->setOnewayBatching(0ms, 0), StatusEq(NO_ERROR));
+
+    std::vector<int32_t> expected(kCalls);
+    std::iota(expected.begin(), expected.end(), 0);
+
+    // Oneway calls can be executed after a later call from this thread.
+    std::vector<int32_t> values;
+    for (int i = 0; i < 100 && values.size() < expected.size(); i++) {
+        Parcel data, reply;
+        EXPECT_THAT(server->transact(BINDER_LIB_TEST_GET_ONEWAY_VALUES, data, &reply),
+                    StatusEq(NO_ERROR));
+        EXPECT_THAT(reply.readInt32Vector(&values), StatusEq(NO_ERROR));
+        if (values.size() < expected.size()) usleep(10000);
+    }
+    EXPECT_EQ(values, expected);
+}
+
 TEST_F(BinderLibTest, Freeze) {
     if (!checkFreezeSupport()) {
         GTEST_SKIP() << "Skipping test for kernels that do not support proceess freezing";
@@ -855,6 +939,40 @@ TEST_F(BinderLibTest, DeathNotificationMultiple)
     }
 }
 
+TEST_F(BinderLibTest, DeathNotificationBatched) {
+    constexpr size_t kCreatedBinderCount = 4;
+    sp<IBinder> server = addServer();
+    ASSERT_NE(nullptr, server);
+
+    std::vector<sp<IBinder>> binders{server};
+    for (size_t i = 0; i < kCreatedBinderCount; i++) {
+        Parcel data, reply;
+        ASSERT_THAT(server->transact(BINDER_LIB_TEST_CREATE_BINDER_TRANSACTION, data, &reply),
+                    StatusEq(NO_ERROR));
+        binders.push_back(reply.readStrongBinder());
+    }
+
+    auto recipient = sp<TestBatchedDeathRecipient>::make(binders.size());
+    for (const auto& binder : binders) {
+        ASSERT_NE(nullptr, binder->remoteBinder());
+        EXPECT_THAT(binder->remoteBinder()->linkToDeathBatched(recipient), StatusEq(NO_ERROR));
+    }
+
+    {
+        Parcel data, reply;
+        EXPECT_THAT(server->transact(BINDER_LIB_TEST_EXIT_TRANSACTION, data, &reply, TF_ONE_WAY),
+                    StatusEq(OK));
+    }
+    IPCThreadState::self()->flushCommands();
+
+    // How many calls the deaths are split across depends on how fast they are read.
+    EXPECT_THAT(recipient->waitEvent(5), StatusEq(NO_ERROR));
+    EXPECT_EQ(binders.size(), recipient->getDeathCount());
+    for (const auto& binder : binders) {
+        EXPECT_THAT(binder->unlinkToDeath(recipient), StatusEq(DEAD_OBJECT));
+    }
+}
+
 TEST_F(BinderLibTest, DeathNotificationThread)
 {
     status_t ret;
@@ -1702,6 +1820,36 @@ TEST_F(BinderLibTest, ThreadPoolAvailableThreads) {
     EXPECT_EQ(replyi, kKernelThreads + 2);
 }
 
+TEST_F(BinderLibTest, ThreadPoolStats) {
+    Parcel data, reply;
+    sp<IBinder> server = addServer();
+    ASSERT_TRUE(server != nullptr);
+    EXPECT_THAT(server->transact(BINDER_LIB_TEST_PROCESS_LOCK, data, &reply), NO_ERROR);
+
+    // Keeps every thread of the other process busy. See ThreadPoolAvailableThreads.
+    std::vector<std::thread> ts;
+    for (size_t i = 0; i < kKernelThreads + 1; i++) {
+        ts.push_back(std::thread([&] {
+            Parcel local_reply;
+            EXPECT_THAT(server->transact(BINDER_LIB_TEST_LOCK_UNLOCK, data, &local_reply),
+                        NO_ERROR);
+        }));
+    }
+    sleep(1);
+
+    data.writeInt32(500);
+    EXPECT_THAT(server->transact(BINDER_LIB_TEST_UNLOCK_AFTER_MS, data, &reply), NO_ERROR);
+    for (auto& t : ts) {
+        t.join();
+    }
+
+    EXPECT_THAT(server->transact(BINDER_LIB_TEST_GET_THREAD_POOL_STATS, data, &reply),
+                StatusEq(NO_ERROR));
+    EXPECT_EQ(reply.readUint64(), static_cast<uint64_t>(kKernelThreads + 2));
+    EXPECT_GE(reply.readUint64(), 1u);
+    EXPECT_GE(std::chrono::nanoseconds(reply.readInt64()), 400ms);
+}
+
 TEST_F(BinderLibTest, ThreadPoolStarted) {
     Parcel data, reply;
     sp<IBinder> server = addServer();
@@ -2310,6 +2458,22 @@ public:
                 reply->writeInt32(ProcessState::self()->getThreadPoolMaxTotalThreadCount());
                 return NO_ERROR;
             }
+            case BINDER_LIB_TEST_APPEND_ONEWAY_VALUE: {
+                std::lock_guard<std::mutex> _l(m_onewayValuesMutex);
+                m_onewayValues.push_back(data.readInt32());
+                return NO_ERROR;
+            }
+            case BINDER_LIB_TEST_GET_ONEWAY_VALUES: {
+                std::lock_guard<std::mutex> _l(m_onewayValuesMutex);
+                return reply->writeInt32Vector(m_onewayValues);
+            }
+            case BINDER_LIB_TEST_GET_THREAD_POOL_STATS: {
+                ProcessState::ThreadPoolStats stats = ProcessState::self()->getThreadPoolStats();
+                reply->writeUint64(stats.peakExecutingThreads);
+                reply->writeUint64(stats.saturationCount);
+                reply->writeInt64(stats.maxSaturationTime.count());
+                return NO_ERROR;
+            }
             case BINDER_LIB_TEST_IS_THREADPOOL_STARTED: {
                 reply->writeBool(ProcessState::self()->isThreadPoolStarted());
                 return NO_ERROR;
@@ -2357,6 +2521,8 @@ private:
     sp<IBinder> m_callback;
     bool m_exitOnDestroy;
     std::mutex m_blockMutex;
+    std::mutex m_onewayValuesMutex;
+    std::vector<int32_t> m_onewayValues;
     sp<TestFrozenStateChangeCallback> frozenStateChangeCallback;
 };
 
@@ -169,4 +169,23 @@ BENCHMARK(BM_CharVector)->Apply(VectorArgs);
 BENCHMARK(BM_Int32Vector)->Apply(VectorArgs);
 BENCHMARK(BM_Int64Vector)->Apply(VectorArgs);
 
+/*
+  Parcel constructed, written and destroyed, like the request or reply of a transaction.
+  Payloads of up to 256 bytes are stored in the Parcel itself, so only larger ones allocate.
+*/
+static void BM_ParcelWrite(benchmark::State& state) {
+    const size_t words = state.range(0) / sizeof(int32_t);
+
+    while (state.KeepRunning()) {
+        android::Parcel p;
+        for (size_t i = 0; i < words; i++) {
+            p.writeInt32(static_cast<int32_t>(i));
+        }
+        benchmark::DoNotOptimize(p.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_ParcelWrite)->RangeMultiplier(2)->Range(16, 1024);
+
 BENCHMARK_MAIN();
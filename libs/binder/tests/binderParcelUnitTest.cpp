@@ -229,6 +229,40 @@ TEST(Parcel, AppendWithBinder) {
     ASSERT_EQ(b2, p2.readStrongBinder());
 }
 
+TEST(Parcel, GrowBeyondInlineStorage) {
+    std::vector<sp<IBinder>> binders;
+    for (int i = 0; i < 16; i++) {
+        binders.push_back(sp<BBinder>::make());
+    }
+
+    Parcel p;
+    for (int i = 0; i < 16; i++) {
+        p.writeInt32(i);
+        p.writeStrongBinder(binders[i]);
+    }
+    for (int i = 0; i < 256; i++) {
+        p.writeInt32(i);
+    }
+    ASSERT_EQ(16, p.objectsCount());
+
+    p.setDataPosition(0);
+    for (int i = 0; i < 16; i++) {
+        ASSERT_EQ(i, p.readInt32());
+        ASSERT_EQ(binders[i], p.readStrongBinder());
+    }
+    for (int i = 0; i < 256; i++) {
+        ASSERT_EQ(i, p.readInt32());
+    }
+
+    // Shrinking drops the objects beyond the new size, and writing starts afresh.
+    p.setDataSize(sizeof(int32_t));
+    ASSERT_EQ(0, p.objectsCount());
+    p.freeData();
+    p.writeInt32(42);
+    p.setDataPosition(0);
+    ASSERT_EQ(42, p.readInt32());
+}
+
 TEST(Parcel, AppendWithBinderPartial) {
     sp<IBinder> b1 = sp<BBinder>::make();
     sp<IBinder> b2 = sp<BBinder>::make();
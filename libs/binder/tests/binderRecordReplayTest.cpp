@@ -45,6 +45,7 @@ using android::binder::borrowed_fd;
 using android::binder::Status;
 using android::binder::unique_fd;
 using android::binder::debug::RecordedTransaction;
+using android::binder::debug::RecordingReader;
 using parcelables::SingleDataParcelable;
 
 const String16 kServerName = String16("binderRecordReplay");
@@ -164,7 +165,8 @@ public:
 
     template <typename T, typename U>
     void recordReplay(Status (IBinderRecordReplayTest::*set)(T), U recordedValue,
-                      Status (IBinderRecordReplayTest::*get)(U*), U changedValue) {
+                      Status (IBinderRecordReplayTest::*get)(U*), U changedValue,
+                      uint32_t recordingFlags = 0) {
         using ReplayFunc = decltype(&replayFuzzService);
         vector<ReplayFunc> replayFunctions = {&replayFuzzService};
         if (!std::is_same_v<U, unique_fd> && !std::is_same_v<U, sp<IBinder>>) {
@@ -175,11 +177,11 @@ public:
 
         for (auto replayFunc : replayFunctions) {
             unique_fd fd(open("/data/local/tmp/binderRecordReplayTest.rec",
-                              O_RDWR | O_CREAT | O_CLOEXEC, 0666));
+                              O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
             ASSERT_TRUE(fd.ok());
 
             // record a transaction
-            mBpBinder->startRecordingBinder(fd);
+            mBpBinder->startRecordingBinder(fd, recordingFlags);
             auto status = (*mInterface.*set)(std::move(recordedValue));
             EXPECT_TRUE(status.isOk());
             mBpBinder->stopRecordingBinder();
@@ -207,7 +209,12 @@ public:
 
             // replay transaction
             ASSERT_EQ(0, lseek(fd.get(), 0, SEEK_SET));
-            std::optional<RecordedTransaction> transaction = RecordedTransaction::fromFile(fd);
+            std::optional<RecordedTransaction> transaction;
+            if (recordingFlags & BpBinder::RECORDING_COMPRESSED) {
+                transaction = RecordingReader(unique_fd(dup(fd.get()))).next();
+            } else {
+                transaction = RecordedTransaction::fromFile(fd);
+            }
             ASSERT_NE(transaction, std::nullopt);
 
             const RecordedTransaction& recordedTransaction = *transaction;
@@ -236,7 +243,7 @@ public:
         }
     }
 
-private:
+protected:
     sp<BpBinder> mBpBinder;
     sp<IBinderRecordReplayTest> mInterface;
 };
@@ -260,6 +267,11 @@ TEST_F(BinderRecordReplayTest, ReplayInt) {
     recordReplay(&IBinderRecordReplayTest::setInt, 3, &IBinderRecordReplayTest::getInt, 5);
 }
 
+TEST_F(BinderRecordReplayTest, ReplayIntCompressed) {
+    recordReplay(&IBinderRecordReplayTest::setInt, 3, &IBinderRecordReplayTest::getInt, 5,
+                 BpBinder::RECORDING_COMPRESSED);
+}
+
 TEST_F(BinderRecordReplayTest, ReplayFloat) {
     recordReplay(&IBinderRecordReplayTest::setFloat, 1.1f, &IBinderRecordReplayTest::getFloat,
                  22.0f);
@@ -391,6 +403,43 @@ TEST_F(BinderRecordReplayTest, ReplayFd) {
                  &IBinderRecordReplayTest::getFileDescriptor, unique_fd(dup(changed)));
 }
 
+TEST_F(BinderRecordReplayTest, ReplayStringArrayCompressed) {
+    std::vector<String16> savedArray = {String16("This is saved value"), String16()};
+    std::vector<String16> changedArray = {String16("This is changed value")};
+    recordReplay(&IBinderRecordReplayTest::setStringArray, savedArray,
+                 &IBinderRecordReplayTest::getStringArray, changedArray,
+                 BpBinder::RECORDING_COMPRESSED);
+}
+
+TEST_F(BinderRecordReplayTest, ReadAllCompressedTransactions) {
+    // More than fits in one frame of the compressed recording.
+    constexpr int kTransactions = 2000;
+
+    unique_fd fd(open("/data/local/tmp/binderRecordReplayTest.rec",
+                      O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+    ASSERT_TRUE(fd.ok());
+
+    ASSERT_EQ(OK, mBpBinder->startRecordingBinder(fd, BpBinder::RECORDING_COMPRESSED));
+    for (int i = 0; i < kTransactions; i++) {
+        EXPECT_TRUE(mInterface->setInt(i).isOk());
+    }
+    ASSERT_EQ(OK, mBpBinder->stopRecordingBinder());
+
+    ASSERT_EQ(0, lseek(fd.get(), 0, SEEK_SET));
+    RecordingReader reader(unique_fd(dup(fd.get())));
+    for (int i = 0; i < kTransactions; i++) {
+        std::optional<RecordedTransaction> transaction = reader.next();
+        ASSERT_NE(transaction, std::nullopt) << i;
+        EXPECT_EQ(BnBinderRecordReplayTest::TRANSACTION_setInt, transaction->getCode());
+
+        const Parcel& data = transaction->getDataParcel();
+        data.setDataPosition(0);
+        EXPECT_TRUE(data.enforceInterface(IBinderRecordReplayTest::descriptor));
+        EXPECT_EQ(i, data.readInt32());
+    }
+    EXPECT_EQ(reader.next(), std::nullopt);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
 
@@ -29,6 +29,7 @@
 #include <binder/RpcTlsUtils.h>
 #include <binder/RpcTransportRaw.h>
 #include <binder/RpcTransportTls.h>
+#include <binder/RpcTransportUring.h>
 #include <openssl/ssl.h>
 
 #include <thread>
@@ -55,6 +56,7 @@ using android::RpcSession;
 using android::RpcTransportCtxFactory;
 using android::RpcTransportCtxFactoryRaw;
 using android::RpcTransportCtxFactoryTls;
+using android::RpcTransportCtxFactoryUring;
 using android::sp;
 using android::status_t;
 using android::statusToString;
@@ -118,6 +120,7 @@ enum Transport {
     KERNEL,
     RPC,
     RPC_TLS,
+    RPC_URING,
 };
 
 static const std::initializer_list<int64_t> kTransportList = {
@@ -126,6 +129,7 @@ static const std::initializer_list<int64_t> kTransportList = {
 #endif
         Transport::RPC,
         Transport::RPC_TLS,
+        Transport::RPC_URING,
 };
 
 std::unique_ptr<RpcTransportCtxFactory> makeFactoryTls() {
@@ -145,6 +149,10 @@ static sp<IBinder> gRpcBinder;
 // Skip certificate validation to simplify the setup process.
 static sp<RpcSession> gSessionTls = RpcSession::make(makeFactoryTls());
 static sp<IBinder> gRpcTlsBinder;
+// Falls back to the raw transport where io_uring is not available, which the label shows.
+static sp<RpcSession> gSessionUring;
+static sp<IBinder> gRpcUringBinder;
+static bool gUringAvailable = false;
 #ifdef __BIONIC__
 static const String16 kKernelBinderInstance = String16(u"binderRpcBenchmark-control");
 static sp<IBinder> gKernelBinder;
@@ -161,6 +169,8 @@ static sp<IBinder> getBinderForOptions(benchmark::State& state) {
             return gRpcBinder;
         case RPC_TLS:
             return gRpcTlsBinder;
+        case RPC_URING:
+            return gRpcUringBinder;
         default:
             LOG(FATAL) << "Unknown transport value: " << transport;
             return nullptr;
@@ -181,6 +191,9 @@ static void SetLabel(benchmark::State& state) {
         case RPC_TLS:
             state.SetLabel("rpc_tls");
             break;
+        case RPC_URING:
+            state.SetLabel(gUringAvailable ? "rpc_uring" : "rpc_uring_unavailable");
+            break;
         default:
             LOG(FATAL) << "Unknown transport value: " << transport;
     }
@@ -244,11 +257,15 @@ void BM_throughputForTransportAndBytes(benchmark::State& state) {
         CHECK(ret.isOk()) << ret;
     }
 
+    // Sent and received.
+    state.SetBytesProcessed(state.iterations() * bytes.size() * 2);
     SetLabel(state);
 }
 BENCHMARK(BM_throughputForTransportAndBytes)
         ->ArgsProduct({kTransportList,
-                       {64, 1024, 2048, 4096, 8182, 16364, 32728, 65535, 65536, 65537}});
+                       {64, 1024, 2048, 4096, 8182, 16364, 32728, 65535, 65536, 65537,
+                        // Close to the largest transaction that RPC binder accepts.
+                        98304}});
 
 void BM_collectProxies(benchmark::State& state) {
     sp<IBinder> binder = getBinderForOptions(state);
@@ -301,9 +318,37 @@ void BM_repeatBinder(benchmark::State& state) {
 }
 BENCHMARK(BM_repeatBinder)->ArgsProduct({kTransportList});
 
+// Connections that a session to each RPC server makes.
+static constexpr size_t kRpcSessionConnections = 4;
+static std::string gRpcAddr;
+static std::string gRpcTlsAddr;
+
+// Connects a new session and shuts it down, which for TLS includes resuming the TLS session of
+// the first connection on the other connections.
+void BM_setupSession(benchmark::State& state) {
+    Transport transport = static_cast<Transport>(state.range(0));
+    const std::string& addr = transport == RPC_TLS ? gRpcTlsAddr : gRpcAddr;
+
+    while (state.KeepRunning()) {
+        // Generating keys is not part of the setup being measured.
+        state.PauseTiming();
+        auto factory =
+                transport == RPC_TLS ? makeFactoryTls() : RpcTransportCtxFactoryRaw::make();
+        state.ResumeTiming();
+
+        sp<RpcSession> session = RpcSession::make(std::move(factory));
+        CHECK_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+        CHECK(session->shutdownAndWait(true));
+    }
+
+    SetLabel(state);
+}
+BENCHMARK(BM_setupSession)->ArgsProduct({{Transport::RPC, Transport::RPC_TLS}});
+
 void forkRpcServer(const char* addr, const sp<RpcServer>& server) {
     if (0 == fork()) {
         prctl(PR_SET_PDEATHSIG, SIGHUP); // racey, okay
+        server->setMaxThreads(kRpcSessionConnections);
         server->setRootObject(sp<MyBinderRpcBenchmark>::make());
         CHECK_EQ(OK, server->setupUnixDomainServer(addr));
         server->join();
@@ -344,18 +389,32 @@ int main(int argc, char** argv) {
 
     std::string tmp = getenv("TMPDIR") ?: "/tmp";
 
-    std::string addr = tmp + "/binderRpcBenchmark";
-    (void)unlink(addr.c_str());
-    forkRpcServer(addr.c_str(), RpcServer::make(RpcTransportCtxFactoryRaw::make()));
-    setupClient(gSession, addr.c_str());
+    gRpcAddr = tmp + "/binderRpcBenchmark";
+    (void)unlink(gRpcAddr.c_str());
+    forkRpcServer(gRpcAddr.c_str(), RpcServer::make(RpcTransportCtxFactoryRaw::make()));
+    setupClient(gSession, gRpcAddr.c_str());
     gRpcBinder = gSession->getRootObject();
 
-    std::string tlsAddr = tmp + "/binderRpcTlsBenchmark";
-    (void)unlink(tlsAddr.c_str());
-    forkRpcServer(tlsAddr.c_str(), RpcServer::make(makeFactoryTls()));
-    setupClient(gSessionTls, tlsAddr.c_str());
+    gRpcTlsAddr = tmp + "/binderRpcTlsBenchmark";
+    (void)unlink(gRpcTlsAddr.c_str());
+    forkRpcServer(gRpcTlsAddr.c_str(), RpcServer::make(makeFactoryTls()));
+    setupClient(gSessionTls, gRpcTlsAddr.c_str());
     gRpcTlsBinder = gSessionTls->getRootObject();
 
+    auto makeFactoryUring = []() -> std::unique_ptr<RpcTransportCtxFactory> {
+        if (auto factory = RpcTransportCtxFactoryUring::make(); factory != nullptr) {
+            return factory;
+        }
+        return RpcTransportCtxFactoryRaw::make();
+    };
+    gUringAvailable = RpcTransportCtxFactoryUring::make() != nullptr;
+    std::string uringAddr = tmp + "/binderRpcUringBenchmark";
+    (void)unlink(uringAddr.c_str());
+    forkRpcServer(uringAddr.c_str(), RpcServer::make(makeFactoryUring()));
+    gSessionUring = RpcSession::make(makeFactoryUring());
+    setupClient(gSessionUring, uringAddr.c_str());
+    gRpcUringBinder = gSessionUring->getRootObject();
+
     ::benchmark::RunSpecifiedBenchmarks();
     return 0;
 }
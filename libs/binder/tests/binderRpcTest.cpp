@@ -1639,6 +1639,46 @@ TEST_P(BinderRpcServerOnly, Shutdown) {
             << "After server->shutdown() returns true, join() did not stop after 2s";
 }
 
+TEST_P(BinderRpcServerOnly, EventLoop) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+    if (std::get<0>(GetParam()) != RpcSecurity::RAW) {
+        GTEST_SKIP() << "Test skipped because the client does not set up certificates";
+    }
+
+    auto addr = allocateSocketAddress();
+    auto server = RpcServer::make(newTlsFactory(std::get<0>(GetParam())));
+    ASSERT_TRUE(server->setProtocolVersion(std::get<1>(GetParam())));
+    server->setMaxThreads(3);
+    // Fewer threads than connections, which would each need one of their own otherwise.
+    server->setEventLoopThreads(2);
+    server->setRootObject(sp<BBinder>::make());
+    ASSERT_EQ(OK, server->setupUnixDomainServer(addr.c_str()));
+    server->start();
+
+    std::vector<sp<RpcSession>> sessions;
+    for (size_t i = 0; i < 3; i++) {
+        auto session = RpcSession::make();
+        ASSERT_TRUE(session->setProtocolVersion(std::get<1>(GetParam())));
+        ASSERT_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+        sessions.push_back(session);
+    }
+    for (size_t i = 0; i < 10; i++) {
+        for (const auto& session : sessions) {
+            sp<IBinder> root = session->getRootObject();
+            ASSERT_NE(nullptr, root);
+            EXPECT_EQ(OK, root->pingBinder());
+        }
+    }
+
+    for (const auto& session : sessions) {
+        EXPECT_TRUE(session->shutdownAndWait(true));
+    }
+    ASSERT_TRUE(server->shutdown());
+    EXPECT_TRUE(server->listSessions().empty());
+}
+
 INSTANTIATE_TEST_SUITE_P(BinderRpc, BinderRpcServerOnly,
                          ::testing::Combine(::testing::ValuesIn(RpcSecurityValues()),
                                             ::testing::ValuesIn(testVersions())),
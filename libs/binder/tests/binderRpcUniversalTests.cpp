@@ -148,6 +148,61 @@ TEST_P(BinderRpc, UnknownTransaction) {
     EXPECT_EQ(UNKNOWN_TRANSACTION, proc.rootBinder->transact(1337, data, &reply, 0));
 }
 
+TEST_P(BinderRpc, PipelinedTransactions) {
+    auto proc = createRpcTestSocketServerProcess({});
+    sp<RpcSession> session = proc.proc->sessions.at(0).session;
+
+    std::unique_ptr<RpcSession::Pipeline> pipeline;
+    if (session->getProtocolVersion() <
+        RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID) {
+        EXPECT_EQ(INVALID_OPERATION, session->startPipeline(&pipeline));
+        GTEST_SKIP() << "Pipelined transactions need a newer protocol version";
+    }
+    ASSERT_EQ(OK, session->startPipeline(&pipeline));
+
+    // Alternate between transactions which succeed and fail, to tell their replies apart.
+    constexpr size_t kNumTransactions = 16;
+    std::vector<uint32_t> ids;
+    for (size_t i = 0; i < kNumTransactions; i++) {
+        Parcel data;
+        data.markForBinder(proc.rootBinder);
+        uint32_t id;
+        ASSERT_EQ(OK,
+                  pipeline->transact(proc.rootBinder,
+                                     i % 2 == 0 ? IBinder::INTERFACE_TRANSACTION : 1337, data,
+                                     &id));
+        ids.push_back(id);
+    }
+
+    // Other transactions still work meanwhile, even if they share the connection.
+    std::string doubled;
+    EXPECT_OK(proc.rootIface->doubleString("cool ", &doubled));
+    EXPECT_EQ("cool cool ", doubled);
+
+    // In reverse, so that the other replies are read while waiting for the last one.
+    for (size_t i = kNumTransactions; i-- > 0;) {
+        Parcel reply;
+        if (i % 2 == 0) {
+            ASSERT_EQ(OK, pipeline->waitForReply(ids[i], &reply));
+            EXPECT_EQ(IBinderRpcTest::descriptor, reply.readString16());
+        } else {
+            EXPECT_EQ(UNKNOWN_TRANSACTION, pipeline->waitForReply(ids[i], &reply));
+        }
+    }
+
+    // Each reply can only be read once.
+    Parcel reply;
+    EXPECT_EQ(BAD_VALUE, pipeline->waitForReply(ids[0], &reply));
+
+    // Replies which are not waited for are read when the pipeline is destroyed.
+    Parcel data;
+    data.markForBinder(proc.rootBinder);
+    uint32_t id;
+    ASSERT_EQ(OK, pipeline->transact(proc.rootBinder, IBinder::PING_TRANSACTION, data, &id));
+    pipeline.reset();
+    EXPECT_EQ(OK, proc.rootBinder->pingBinder());
+}
+
 TEST_P(BinderRpc, SendSomethingOneway) {
     auto proc = createRpcTestSocketServerProcess({});
     EXPECT_OK(proc.rootIface->sendString("asdf"));
@@ -170,6 +225,20 @@ TEST_P(BinderRpc, SendAndGetResultBackBig) {
     EXPECT_EQ(single + single, doubled);
 }
 
+TEST_P(BinderRpc, SendAndGetResultBackHuge) {
+    if (socketType() == SocketType::TIPC) {
+        GTEST_SKIP() << "Trusty has a limit of 4096 bytes for the entire RPC Binder message";
+    }
+
+    auto proc = createRpcTestSocketServerProcess({});
+    // Large enough to be sent with MSG_ZEROCOPY where it is supported, but small enough for the
+    // doubled reply to fit in one transaction.
+    std::string single = std::string(20000, 'a');
+    std::string doubled;
+    EXPECT_OK(proc.rootIface->doubleString(single, &doubled));
+    EXPECT_EQ(single + single, doubled);
+}
+
 TEST_P(BinderRpc, InvalidNullBinderReturn) {
     auto proc = createRpcTestSocketServerProcess({});
 
@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the same workload over each binder transport, so that their numbers can be compared. Each
+// run is a transport, a payload size, sync or oneway calls, the number of file descriptors and
+// binders in each call, and a number of client threads. Besides time and throughput, runs report
+// the p50, p90 and p99 latency of a call.
+//
+// Use --benchmark_format=json or --benchmark_out=<file> for machine-readable results. Transports
+// that are not available on the device, like vsock loopback, and combinations that a transport
+// does not support, like file descriptors over TLS, are reported as skipped with an error.
+
+#include <BnBinderTransportBenchmark.h>
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+#include <binder/Binder.h>
+#include <binder/IPCThreadState.h>
+#include <binder/IServiceManager.h>
+#include <binder/ParcelFileDescriptor.h>
+#include <binder/ProcessState.h>
+#include <binder/RpcCertificateVerifier.h>
+#include <binder/RpcServer.h>
+#include <binder/RpcSession.h>
+#include <binder/RpcTlsTestUtils.h>
+#include <binder/RpcTransportRaw.h>
+#include <binder/RpcTransportTls.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/vm_sockets.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../file.h"
+
+using android::BBinder;
+using android::defaultServiceManager;
+using android::IBinder;
+using android::interface_cast;
+using android::IPCThreadState;
+using android::OK;
+using android::ProcessState;
+using android::RpcAuthPreSigned;
+using android::RpcCertificateVerifierNoOp;
+using android::RpcServer;
+using android::RpcSession;
+using android::RpcTransportCtxFactory;
+using android::RpcTransportCtxFactoryRaw;
+using android::RpcTransportCtxFactoryTls;
+using android::sp;
+using android::status_t;
+using android::statusToString;
+using android::String16;
+using android::binder::ReadFully;
+using android::binder::Status;
+using android::binder::unique_fd;
+using android::binder::WriteFully;
+using android::os::ParcelFileDescriptor;
+
+using FileDescriptorTransportMode = RpcSession::FileDescriptorTransportMode;
+
+// Client threads of the largest runs. Servers have two threads for each, since a thread waiting
+// for oneway calls blocks while another processes them.
+static constexpr int kMaxClientThreads = 4;
+static constexpr size_t kServerThreads = 2 * kMaxClientThreads + 1;
+
+// Oneway calls that a client thread sends before waiting for the server to process them, which
+// bounds the calls queued in the server.
+static constexpr int64_t kOnewayWindow = 16;
+
+class MyBinderTransportBenchmark : public BnBinderTransportBenchmark {
+public:
+    Status makeWorker(sp<IBinderTransportBenchmark>* out) override {
+        *out = sp<MyBinderTransportBenchmark>::make();
+        return Status::ok();
+    }
+    Status call(const std::vector<uint8_t>&, const std::vector<ParcelFileDescriptor>&,
+                const std::vector<sp<IBinder>>&) override {
+        return Status::ok();
+    }
+    Status callOneway(const std::vector<uint8_t>&, const std::vector<ParcelFileDescriptor>&,
+                      const std::vector<sp<IBinder>>&) override {
+        {
+            std::lock_guard<std::mutex> l(mMutex);
+            mOnewayCount++;
+        }
+        mCv.notify_all();
+        return Status::ok();
+    }
+    Status waitForOneway(int64_t count) override {
+        std::unique_lock<std::mutex> l(mMutex);
+        mCv.wait(l, [&] { return mOnewayCount >= count; });
+        return Status::ok();
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    int64_t mOnewayCount = 0;
+};
+
+enum Transport {
+    KERNEL,
+    RPC_UNIX,
+    RPC_VSOCK,
+    RPC_TLS,
+    TRANSPORT_COUNT,
+};
+
+struct Target {
+    const char* name;
+    sp<IBinderTransportBenchmark> root;
+    bool supportsFds = false;
+};
+
+static Target gTargets[TRANSPORT_COUNT] = {
+        {.name = "kernel"},
+        {.name = "rpc_unix"},
+        {.name = "rpc_vsock"},
+        {.name = "rpc_tls"},
+};
+
+static std::unique_ptr<RpcTransportCtxFactory> makeFactory(Transport transport) {
+    if (transport != RPC_TLS) return RpcTransportCtxFactoryRaw::make();
+
+    // Certificate validation happens during the handshake and does not affect the results.
+    auto pkey = android::makeKeyPairForSelfSignedCert();
+    CHECK_NE(pkey.get(), nullptr);
+    auto cert = android::makeSelfSignedCert(pkey.get(), android::kCertValidSeconds);
+    CHECK_NE(cert.get(), nullptr);
+    auto verifier = std::make_shared<RpcCertificateVerifierNoOp>(OK);
+    auto auth = std::make_unique<RpcAuthPreSigned>(std::move(pkey), std::move(cert));
+    return RpcTransportCtxFactoryTls::make(verifier, std::move(auth));
+}
+
+static void reportLatencies(benchmark::State& state, std::vector<int64_t>* latenciesNs) {
+    if (latenciesNs->empty()) return;
+    std::sort(latenciesNs->begin(), latenciesNs->end());
+
+    static constexpr std::pair<const char*, size_t> kPercentiles[] = {
+            {"p50_ns", 50},
+            {"p90_ns", 90},
+            {"p99_ns", 99},
+    };
+    for (const auto& [name, percentile] : kPercentiles) {
+        const size_t index = (latenciesNs->size() - 1) * percentile / 100;
+        state.counters[name] = benchmark::Counter(static_cast<double>((*latenciesNs)[index]),
+                                                  benchmark::Counter::kAvgThreads);
+    }
+}
+
+void BM_transaction(benchmark::State& state) {
+    const Target& target = gTargets[state.range(0)];
+    const size_t payloadSize = static_cast<size_t>(state.range(1));
+    const bool oneway = state.range(2) != 0;
+    const size_t fdCount = static_cast<size_t>(state.range(3));
+    const size_t binderCount = static_cast<size_t>(state.range(4));
+    state.SetLabel(target.name);
+
+    if (target.root == nullptr) {
+        state.SkipWithError("transport not available");
+        return;
+    }
+    if (fdCount > 0 && !target.supportsFds) {
+        state.SkipWithError("transport does not support file descriptors");
+        return;
+    }
+
+    sp<IBinderTransportBenchmark> worker;
+    Status ret = target.root->makeWorker(&worker);
+    CHECK(ret.isOk()) << ret;
+
+    std::vector<uint8_t> payload(payloadSize, 'a');
+    std::vector<ParcelFileDescriptor> fds;
+    for (size_t i = 0; i < fdCount; i++) {
+        unique_fd fd(open("/dev/null", O_RDONLY | O_CLOEXEC));
+        CHECK(fd.ok());
+        fds.emplace_back(std::move(fd));
+    }
+    std::vector<sp<IBinder>> binders;
+    for (size_t i = 0; i < binderCount; i++) {
+        binders.push_back(sp<BBinder>::make());
+    }
+
+    std::vector<int64_t> latenciesNs;
+    int64_t onewaySent = 0;
+    while (state.KeepRunning()) {
+        const auto start = std::chrono::steady_clock::now();
+        if (oneway) {
+            ret = worker->callOneway(payload, fds, binders);
+            if (ret.isOk() && ++onewaySent % kOnewayWindow == 0) {
+                ret = worker->waitForOneway(onewaySent);
+            }
+        } else {
+            ret = worker->call(payload, fds, binders);
+        }
+        latenciesNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::steady_clock::now() - start)
+                                      .count());
+        CHECK(ret.isOk()) << ret;
+    }
+    if (oneway) {
+        ret = worker->waitForOneway(onewaySent);
+        CHECK(ret.isOk()) << ret;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * payloadSize);
+    reportLatencies(state, &latenciesNs);
+}
+BENCHMARK(BM_transaction)
+        ->ArgNames({"transport", "bytes", "oneway", "fds", "binders"})
+        ->ArgsProduct({{KERNEL, RPC_UNIX, RPC_VSOCK, RPC_TLS},
+                       {64, 4096, 65536},
+                       {0, 1},
+                       {0, 4},
+                       {0, 4}})
+        ->Threads(1)
+        ->Threads(kMaxClientThreads)
+        ->UseRealTime();
+
+// Starts an RPC server in a child process. Returns the vsock port that it listens on, or 0 for a
+// unix domain socket server, or std::nullopt if it could not be set up.
+static std::optional<unsigned> forkRpcServer(Transport transport, const std::string& addr) {
+    int pipeFds[2];
+    CHECK_EQ(0, pipe2(pipeFds, O_CLOEXEC));
+    unique_fd readEnd(pipeFds[0]);
+    unique_fd writeEnd(pipeFds[1]);
+
+    if (0 == fork()) {
+        prctl(PR_SET_PDEATHSIG, SIGHUP); // racey, okay
+        readEnd.reset();
+
+        sp<RpcServer> server = RpcServer::make(makeFactory(transport));
+        server->setMaxThreads(kServerThreads);
+        server->setRootObject(sp<MyBinderTransportBenchmark>::make());
+        unsigned port = 0;
+        status_t status;
+        if (transport == RPC_VSOCK) {
+            status = server->setupVsockServer(VMADDR_CID_LOCAL, VMADDR_PORT_ANY, &port);
+        } else {
+            if (transport == RPC_UNIX) {
+                server->setSupportedFileDescriptorTransportModes(
+                        {FileDescriptorTransportMode::NONE, FileDescriptorTransportMode::UNIX});
+            }
+            status = server->setupUnixDomainServer(addr.c_str());
+        }
+
+        const int32_t result[] = {status, static_cast<int32_t>(port)};
+        CHECK(WriteFully(writeEnd, result, sizeof(result)));
+        writeEnd.reset();
+        if (status == OK) server->join();
+        exit(1);
+    }
+
+    writeEnd.reset();
+    int32_t result[2];
+    CHECK(ReadFully(readEnd, result, sizeof(result)));
+    if (result[0] != OK) {
+        LOG(WARNING) << gTargets[transport].name
+                     << " server not available: " << statusToString(result[0]);
+        return std::nullopt;
+    }
+    return static_cast<unsigned>(result[1]);
+}
+
+static void setupRpcTarget(Transport transport, const std::string& addr) {
+    std::optional<unsigned> port = forkRpcServer(transport, addr);
+    if (!port) return;
+
+    sp<RpcSession> session = RpcSession::make(makeFactory(transport));
+    if (transport == RPC_UNIX) {
+        session->setFileDescriptorTransportMode(FileDescriptorTransportMode::UNIX);
+    }
+    status_t status = transport == RPC_VSOCK ? session->setupVsockClient(VMADDR_CID_LOCAL, *port)
+                                             : session->setupUnixDomainClient(addr.c_str());
+    if (status != OK) {
+        LOG(WARNING) << "Could not connect " << gTargets[transport].name << ": "
+                     << statusToString(status);
+        return;
+    }
+
+    gTargets[transport].root = interface_cast<IBinderTransportBenchmark>(session->getRootObject());
+    gTargets[transport].supportsFds = transport == RPC_UNIX;
+}
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+#ifdef __BIONIC__
+    static const String16 kKernelBinderInstance = String16(u"binderTransportBenchmark");
+    if (0 == fork()) {
+        prctl(PR_SET_PDEATHSIG, SIGHUP); // racey, okay
+        ProcessState::self()->setThreadPoolMaxThreadCount(kServerThreads);
+        CHECK_EQ(OK,
+                 defaultServiceManager()->addService(kKernelBinderInstance,
+                                                     sp<MyBinderTransportBenchmark>::make()));
+        ProcessState::self()->startThreadPool();
+        IPCThreadState::self()->joinThreadPool();
+        exit(1);
+    }
+
+    ProcessState::self()->setThreadPoolMaxThreadCount(1);
+    ProcessState::self()->startThreadPool();
+
+    gTargets[KERNEL].root = interface_cast<IBinderTransportBenchmark>(
+            defaultServiceManager()->waitForService(kKernelBinderInstance));
+    CHECK_NE(nullptr, gTargets[KERNEL].root.get());
+    gTargets[KERNEL].supportsFds = true;
+#endif
+
+    std::string tmp = getenv("TMPDIR") ?: "/tmp";
+    std::string unixAddr = tmp + "/binderTransportBenchmark";
+    std::string tlsAddr = tmp + "/binderTransportTlsBenchmark";
+    (void)unlink(unixAddr.c_str());
+    (void)unlink(tlsAddr.c_str());
+
+    setupRpcTarget(RPC_UNIX, unixAddr);
+    setupRpcTarget(RPC_VSOCK, "");
+    setupRpcTarget(RPC_TLS, tlsAddr);
+
+    ::benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -22,8 +22,13 @@
 #include <dirent.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <string.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <numeric>
 #include <optional>
@@ -63,6 +68,18 @@ static unique_fd gConcurrentMapFd;
 static unique_fd gUidLastUpdateMapFd;
 static unique_fd gPidTisMapFd;
 
+// Scratch space of the reads of the uid maps, kept across calls so that once they have seen the
+// largest maps they no longer allocate.
+static std::mutex gUidMapsReadMutex;
+static std::vector<uint8_t> gReadKeys;
+static std::vector<uint8_t> gReadValues;
+static std::vector<std::pair<uint32_t, uint64_t>> gUidLastUpdates;
+static std::vector<uint32_t> gReadUids;
+// Cleared the first time that the kernel turns down BPF_MAP_LOOKUP_BATCH.
+static std::atomic_bool gBatchLookupSupported = true;
+// Entries read per syscall at first. Doubled when a hash bucket holds more than that.
+static constexpr uint32_t INITIAL_BATCH_SIZE = 256;
+
 static std::optional<std::vector<uint32_t>> readNumbersFromFile(const std::string &path) {
     std::string data;
 
@@ -337,10 +354,115 @@ std::optional<std::vector<std::vector<uint64_t>>> getUidCpuFreqTimes(uint32_t ui
     return out;
 }
 
-static std::optional<bool> uidUpdatedSince(uint32_t uid, uint64_t lastUpdate,
-                                           uint64_t *newLastUpdate) {
-    uint64_t uidLastUpdate;
-    if (findMapEntry(gUidLastUpdateMapFd, &uid, &uidLastUpdate)) return {};
+// Kernels before 5.6 do not know of BPF_MAP_LOOKUP_BATCH, and later ones may not support it for
+// every type of map (ENOTSUPP, which userspace headers do not define).
+static bool isBatchLookupUnsupported(int error) {
+    constexpr int ENOTSUPP = 524;
+    return error == EINVAL || error == ENOTSUPP || error == EOPNOTSUPP || error == ENOSYS;
+}
+
+// Read every entry of mapFd into gReadKeys and gReadValues with BPF_MAP_LOOKUP_BATCH, which takes
+// a syscall per batch of entries rather than two per entry. valueCount is the number of values
+// per entry: the number of CPUs for per-CPU maps, 1 otherwise.
+// Return contains no value on error, with errno set, otherwise the number of entries read.
+template <class Key, class Value>
+static std::optional<size_t> lookupMapBatch(int mapFd, uint32_t valueCount) {
+    // For hash maps, where the kernel stopped is a bucket index rather than a key.
+    static_assert(sizeof(Key) <= sizeof(uint64_t));
+    uint64_t inBatch = 0, outBatch = 0;
+    const size_t valueSize = sizeof(Value) * valueCount;
+    uint32_t batchSize = INITIAL_BATCH_SIZE;
+    size_t count = 0;
+    bool first = true;
+    while (true) {
+        if (gReadKeys.size() < (count + batchSize) * sizeof(Key)) {
+            gReadKeys.resize((count + batchSize) * sizeof(Key));
+        }
+        if (gReadValues.size() < (count + batchSize) * valueSize) {
+            gReadValues.resize((count + batchSize) * valueSize);
+        }
+
+        union bpf_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.batch.in_batch = first ? 0 : reinterpret_cast<uintptr_t>(&inBatch);
+        attr.batch.out_batch = reinterpret_cast<uintptr_t>(&outBatch);
+        attr.batch.keys = reinterpret_cast<uintptr_t>(&gReadKeys[count * sizeof(Key)]);
+        attr.batch.values = reinterpret_cast<uintptr_t>(&gReadValues[count * valueSize]);
+        attr.batch.count = batchSize;
+        attr.batch.map_fd = mapFd;
+        if (syscall(__NR_bpf, BPF_MAP_LOOKUP_BATCH, &attr, sizeof(attr)) == 0) {
+            count += attr.batch.count;
+            inBatch = outBatch;
+            first = false;
+            continue;
+        }
+        if (errno == ENOENT) {
+            // The end of the map.
+            return count + attr.batch.count;
+        }
+        if (errno != ENOSPC) return {};
+        // The next bucket does not fit; retry it with a larger batch.
+        batchSize *= 2;
+    }
+}
+
+// Call fn(key, values) for each entry of mapFd, where values points to valueCount values. The
+// map is read in batches where the kernel supports it, and key by key otherwise.
+// Returns false on error or if fn does, true otherwise. Must be called with gUidMapsReadMutex held.
+template <class Key, class Value, class Fn>
+static bool forEachMapEntry(int mapFd, uint32_t valueCount, Fn fn) {
+    if (gBatchLookupSupported) {
+        auto count = lookupMapBatch<Key, Value>(mapFd, valueCount);
+        if (count.has_value()) {
+            const size_t valueSize = sizeof(Value) * valueCount;
+            for (size_t i = 0; i < *count; ++i) {
+                const Key &key = *reinterpret_cast<const Key *>(&gReadKeys[i * sizeof(Key)]);
+                if (!fn(key, reinterpret_cast<const Value *>(&gReadValues[i * valueSize]))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        if (!isBatchLookupUnsupported(errno)) return false;
+        gBatchLookupSupported = false;
+    }
+
+    Key key, prevKey;
+    if (getFirstMapKey(mapFd, &key)) return errno == ENOENT;
+    if (gReadValues.size() < sizeof(Value) * valueCount) {
+        gReadValues.resize(sizeof(Value) * valueCount);
+    }
+    const Value *values = reinterpret_cast<const Value *>(gReadValues.data());
+    do {
+        if (findMapEntry(mapFd, &key, gReadValues.data())) return false;
+        if (!fn(key, values)) return false;
+    } while (prevKey = key, !getNextMapKey(mapFd, &prevKey, &key));
+    return errno == ENOENT;
+}
+
+// Read the time of the last update of every uid into gUidLastUpdates, sorted by uid, so that
+// filtering the uids of the other maps takes no syscalls. Must be called with gUidMapsReadMutex
+// held.
+static bool readUidLastUpdates() {
+    gUidLastUpdates.clear();
+    if (!forEachMapEntry<uint32_t, uint64_t>(gUidLastUpdateMapFd, 1,
+                                             [](const uint32_t &uid, const uint64_t *lastUpdate) {
+                                                 gUidLastUpdates.emplace_back(uid, *lastUpdate);
+                                                 return true;
+                                             })) {
+        return false;
+    }
+    std::sort(gUidLastUpdates.begin(), gUidLastUpdates.end());
+    return true;
+}
+
+// Must be called after readUidLastUpdates(), with gUidMapsReadMutex still held.
+static bool uidUpdatedSince(uint32_t uid, uint64_t lastUpdate, uint64_t *newLastUpdate) {
+    auto it = std::lower_bound(gUidLastUpdates.begin(), gUidLastUpdates.end(),
+                               std::make_pair(uid, uint64_t(0)));
+    // A uid that first ran after gUidLastUpdates was read has been updated since.
+    if (it == gUidLastUpdates.end() || it->first != uid) return true;
+    const uint64_t uidLastUpdate = it->second;
     // Updates that occurred during the previous read may have been missed. To mitigate
     // this, don't ignore entries updated up to 1s before *lastUpdate
     constexpr uint64_t NSEC_PER_SEC = 1000000000;
@@ -349,6 +471,34 @@ static std::optional<bool> uidUpdatedSince(uint32_t uid, uint64_t lastUpdate,
     return true;
 }
 
+// Zero the times of every uid in times, keeping their vectors for the entries about to be read.
+static void zeroUidTimes(std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>> *times) {
+    for (auto &[uid, policyTimes] : *times) {
+        for (auto &vec : policyTimes) std::fill(vec.begin(), vec.end(), 0);
+    }
+}
+
+static void zeroUidTimes(std::unordered_map<uint32_t, concurrent_time_t> *times) {
+    for (auto &[uid, ct] : *times) {
+        std::fill(ct.active.begin(), ct.active.end(), 0);
+        for (auto &vec : ct.policy) std::fill(vec.begin(), vec.end(), 0);
+    }
+}
+
+// Remove the uids that are not in gReadUids from times. Must be called with gUidMapsReadMutex
+// held.
+template <class Times>
+static void eraseUnreadUids(std::unordered_map<uint32_t, Times> *times) {
+    std::sort(gReadUids.begin(), gReadUids.end());
+    for (auto it = times->begin(); it != times->end();) {
+        if (std::binary_search(gReadUids.begin(), gReadUids.end(), it->first)) {
+            ++it;
+        } else {
+            it = times->erase(it);
+        }
+    }
+}
+
 // Retrieve the times in ns that each uid spent running at each CPU freq.
 // Return contains no value on error, otherwise it contains a map from uids to vectors of vectors
 // using the format:
@@ -365,45 +515,51 @@ getUidsCpuFreqTimes() {
 // Return format is the same as getUidsCpuFreqTimes()
 std::optional<std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>>>
 getUidsUpdatedCpuFreqTimes(uint64_t *lastUpdate) {
-    if (!gInitialized && !initGlobals()) return {};
-    time_key_t key, prevKey;
     std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>> map;
-    if (getFirstMapKey(gTisMapFd, &key)) {
-        if (errno == ENOENT) return map;
-        return std::nullopt;
-    }
+    if (!getUidsUpdatedCpuFreqTimes(lastUpdate, &map)) return {};
+    return map;
+}
+
+// Same as above, but into times, which on success holds the updated UIDs only. Reusing times
+// across calls saves allocating the vectors of the UIDs that it already holds.
+// Returns false on error, true otherwise.
+bool getUidsUpdatedCpuFreqTimes(
+        uint64_t *lastUpdate,
+        std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>> *times) {
+    if (!gInitialized && !initGlobals()) return false;
+    std::lock_guard<std::mutex> guard(gUidMapsReadMutex);
+    if (lastUpdate && !readUidLastUpdates()) return false;
 
     std::vector<std::vector<uint64_t>> mapFormat;
     for (const auto &freqList : gPolicyFreqs) mapFormat.emplace_back(freqList.size(), 0);
 
+    zeroUidTimes(times);
+    gReadUids.clear();
     uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
-    std::vector<tis_val_t> vals(gNCpus);
-    do {
-        if (lastUpdate) {
-            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate);
-            if (!uidUpdated.has_value()) return {};
-            if (!*uidUpdated) continue;
-        }
-        if (findMapEntry(gTisMapFd, &key, vals.data())) return {};
-        if (map.find(key.uid) == map.end()) map.emplace(key.uid, mapFormat);
+    auto addTimes = [&](const time_key_t &key, const tis_val_t *vals) {
+        if (lastUpdate && !uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate)) return true;
+        auto it = times->find(key.uid);
+        if (it == times->end()) it = times->emplace(key.uid, mapFormat).first;
+        gReadUids.push_back(key.uid);
 
         auto offset = key.bucket * FREQS_PER_ENTRY;
         auto nextOffset = (key.bucket + 1) * FREQS_PER_ENTRY;
         for (uint32_t i = 0; i < gNPolicies; ++i) {
             if (offset >= gPolicyFreqs[i].size()) continue;
-            auto begin = map[key.uid][i].begin() + offset;
+            auto begin = it->second[i].begin() + offset;
             auto end = nextOffset < gPolicyFreqs[i].size() ? begin + FREQS_PER_ENTRY :
-                map[key.uid][i].end();
+                it->second[i].end();
             for (const auto &cpu : gPolicyCpus[i]) {
                 std::transform(begin, end, std::begin(vals[gCpuIndexMap[cpu]].ar), begin,
                                std::plus<uint64_t>());
             }
         }
-        prevKey = key;
-    } while (prevKey = key, !getNextMapKey(gTisMapFd, &prevKey, &key));
-    if (errno != ENOENT) return {};
+        return true;
+    };
+    if (!forEachMapEntry<time_key_t, tis_val_t>(gTisMapFd, gNCpus, addTimes)) return false;
+    eraseUnreadUids(times);
     if (lastUpdate && newLastUpdate > *lastUpdate) *lastUpdate = newLastUpdate;
-    return map;
+    return true;
 }
 
 static bool verifyConcurrentTimes(const concurrent_time_t &ct) {
@@ -477,63 +633,74 @@ std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsConcurrent
 // Return format is the same as getUidsConcurrentTimes()
 std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsUpdatedConcurrentTimes(
         uint64_t *lastUpdate) {
-    if (!gInitialized && !initGlobals()) return {};
-    time_key_t key, prevKey;
     std::unordered_map<uint32_t, concurrent_time_t> ret;
-    if (getFirstMapKey(gConcurrentMapFd, &key)) {
-        if (errno == ENOENT) return ret;
-        return {};
-    }
-
-    concurrent_time_t retFormat = {.active = std::vector<uint64_t>(gNCpus, 0)};
-    for (const auto &cpuList : gPolicyCpus) retFormat.policy.emplace_back(cpuList.size(), 0);
-
-    std::vector<concurrent_val_t> vals(gNCpus);
-    std::vector<uint64_t>::iterator activeBegin, activeEnd, policyBegin, policyEnd;
-
-    uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
-    do {
-        if (key.bucket > (gNCpus - 1) / CPUS_PER_ENTRY) return {};
-        if (lastUpdate) {
-            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate);
-            if (!uidUpdated.has_value()) return {};
-            if (!*uidUpdated) continue;
-        }
-        if (findMapEntry(gConcurrentMapFd, &key, vals.data())) return {};
-        if (ret.find(key.uid) == ret.end()) ret.emplace(key.uid, retFormat);
-
-        auto offset = key.bucket * CPUS_PER_ENTRY;
-        auto nextOffset = (key.bucket + 1) * CPUS_PER_ENTRY;
-
-        activeBegin = ret[key.uid].active.begin();
-        activeEnd = nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY : ret[key.uid].active.end();
+    if (!getUidsUpdatedConcurrentTimes(lastUpdate, &ret)) return {};
+    return ret;
+}
 
-        for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) {
-            std::transform(activeBegin, activeEnd, std::begin(vals[cpu].active), activeBegin,
-                           std::plus<uint64_t>());
-        }
+// Same as above, but into times, which on success holds the updated UIDs only. Reusing times
+// across calls saves allocating the vectors of the UIDs that it already holds.
+// Returns false on error, true otherwise.
+bool getUidsUpdatedConcurrentTimes(uint64_t *lastUpdate,
+                                   std::unordered_map<uint32_t, concurrent_time_t> *times) {
+    if (!gInitialized && !initGlobals()) return false;
+    {
+        std::lock_guard<std::mutex> guard(gUidMapsReadMutex);
+        if (lastUpdate && !readUidLastUpdates()) return false;
+
+        concurrent_time_t retFormat = {.active = std::vector<uint64_t>(gNCpus, 0)};
+        for (const auto &cpuList : gPolicyCpus) retFormat.policy.emplace_back(cpuList.size(), 0);
+
+        zeroUidTimes(times);
+        gReadUids.clear();
+        uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
+        auto addTimes = [&](const time_key_t &key, const concurrent_val_t *vals) {
+            if (key.bucket > (gNCpus - 1) / CPUS_PER_ENTRY) return false;
+            if (lastUpdate && !uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate)) return true;
+            auto it = times->find(key.uid);
+            if (it == times->end()) it = times->emplace(key.uid, retFormat).first;
+            gReadUids.push_back(key.uid);
+
+            auto offset = key.bucket * CPUS_PER_ENTRY;
+            auto nextOffset = (key.bucket + 1) * CPUS_PER_ENTRY;
+
+            auto activeBegin = it->second.active.begin() + offset;
+            auto activeEnd =
+                    nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY : it->second.active.end();
+
+            for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) {
+                std::transform(activeBegin, activeEnd, std::begin(vals[cpu].active), activeBegin,
+                               std::plus<uint64_t>());
+            }
 
-        for (uint32_t policy = 0; policy < gNPolicies; ++policy) {
-            if (offset >= gPolicyCpus[policy].size()) continue;
-            policyBegin = ret[key.uid].policy[policy].begin() + offset;
-            policyEnd = nextOffset < gPolicyCpus[policy].size() ? policyBegin + CPUS_PER_ENTRY
-                                                                : ret[key.uid].policy[policy].end();
+            for (uint32_t policy = 0; policy < gNPolicies; ++policy) {
+                if (offset >= gPolicyCpus[policy].size()) continue;
+                auto policyBegin = it->second.policy[policy].begin() + offset;
+                auto policyEnd = nextOffset < gPolicyCpus[policy].size()
+                        ? policyBegin + CPUS_PER_ENTRY
+                        : it->second.policy[policy].end();
 
-            for (const auto &cpu : gPolicyCpus[policy]) {
-                std::transform(policyBegin, policyEnd, std::begin(vals[gCpuIndexMap[cpu]].policy),
-                               policyBegin, std::plus<uint64_t>());
+                for (const auto &cpu : gPolicyCpus[policy]) {
+                    std::transform(policyBegin, policyEnd,
+                                   std::begin(vals[gCpuIndexMap[cpu]].policy), policyBegin,
+                                   std::plus<uint64_t>());
+                }
             }
+            return true;
+        };
+        if (!forEachMapEntry<time_key_t, concurrent_val_t>(gConcurrentMapFd, gNCpus, addTimes)) {
+            return false;
         }
-    } while (prevKey = key, !getNextMapKey(gConcurrentMapFd, &prevKey, &key));
-    if (errno != ENOENT) return {};
-    for (const auto &[key, value] : ret) {
+        eraseUnreadUids(times);
+        if (lastUpdate && newLastUpdate > *lastUpdate) *lastUpdate = newLastUpdate;
+    }
+    for (auto &[uid, value] : *times) {
         if (!verifyConcurrentTimes(value)) {
-            auto val = getUidConcurrentTimes(key, false);
-            if (val.has_value()) ret[key] = val.value();
+            auto val = getUidConcurrentTimes(uid, false);
+            if (val.has_value()) value = std::move(*val);
         }
     }
-    if (lastUpdate && newLastUpdate > *lastUpdate) *lastUpdate = newLastUpdate;
-    return ret;
+    return true;
 }
 
 // Clear all time in state data for a given uid. Returns false on error, true otherwise.
@@ -30,6 +30,9 @@ std::optional<std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>>>
     getUidsCpuFreqTimes();
 std::optional<std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>>>
     getUidsUpdatedCpuFreqTimes(uint64_t *lastUpdate);
+bool getUidsUpdatedCpuFreqTimes(
+        uint64_t *lastUpdate,
+        std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>> *times);
 std::optional<std::vector<std::vector<uint32_t>>> getCpuFreqs();
 
 struct concurrent_time_t {
@@ -41,6 +44,8 @@ std::optional<concurrent_time_t> getUidConcurrentTimes(uint32_t uid, bool retry
 std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsConcurrentTimes();
 std::optional<std::unordered_map<uint32_t, concurrent_time_t>>
     getUidsUpdatedConcurrentTimes(uint64_t *lastUpdate);
+bool getUidsUpdatedConcurrentTimes(uint64_t *lastUpdate,
+                                   std::unordered_map<uint32_t, concurrent_time_t> *times);
 bool clearUidTimes(unsigned int uid);
 
 bool startTrackingProcessCpuTimes(pid_t pid);
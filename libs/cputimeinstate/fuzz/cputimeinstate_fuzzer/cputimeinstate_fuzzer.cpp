@@ -33,6 +33,8 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
     uint64_t lastUpdate = fdp.ConsumeIntegral<uint64_t>();
     uint16_t aggregationKey = fdp.ConsumeIntegral<uint16_t>();
     pid_t pid = fdp.ConsumeIntegral<pid_t>();
+    std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>> cpuFreqTimes;
+    std::unordered_map<uint32_t, concurrent_time_t> concurrentTimes;
     std::vector<uint16_t> aggregationKeys;
     uint16_t aggregationKeysSize = fdp.ConsumeIntegralInRange<size_t>(0, MAX_VEC_SIZE);
     for (uint16_t i = 0; i < aggregationKeysSize; i++) {
@@ -46,6 +48,8 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
                 [&]() { getUidsUpdatedCpuFreqTimes(&lastUpdate); },
                 [&]() { getUidConcurrentTimes(uid);},
                 [&]() { getUidsUpdatedConcurrentTimes(&lastUpdate); },
+                [&]() { getUidsUpdatedCpuFreqTimes(&lastUpdate, &cpuFreqTimes); },
+                [&]() { getUidsUpdatedConcurrentTimes(&lastUpdate, &concurrentTimes); },
                 [&]() { startAggregatingTaskCpuTimes(pid, aggregationKey); },
                 [&]() { getAggregatedTaskCpuFreqTimes(pid, aggregationKeys); },
         });
@@ -209,6 +209,33 @@ TEST_F(TimeInStateTest, AllUidUpdatedTimeInState) {
     }
 }
 
+TEST_F(TimeInStateTest, AllUidUpdatedTimeInStateReusedMap) {
+    std::unordered_map<uint32_t, vector<vector<uint64_t>>> map;
+    uint64_t lastUpdate = 0;
+    ASSERT_TRUE(getUidsUpdatedCpuFreqTimes(&lastUpdate, &map));
+    ASSERT_FALSE(map.empty());
+    ASSERT_NE(lastUpdate, (uint64_t)0);
+    auto map1 = map;
+    uint64_t oldLastUpdate = lastUpdate;
+
+    // Sleep briefly to trigger a context switch, ensuring we see at least one update.
+    struct timespec ts;
+    ts.tv_sec = 0;
+    ts.tv_nsec = 1000000;
+    nanosleep (&ts, NULL);
+
+    ASSERT_TRUE(getUidsUpdatedCpuFreqTimes(&lastUpdate, &map));
+    ASSERT_FALSE(map.empty());
+    ASSERT_NE(lastUpdate, oldLastUpdate);
+    // The uids that have not run since the first call are no longer in the map.
+    ASSERT_LT(map.size(), map1.size());
+
+    for (const auto &[uid, newTimes] : map) {
+        ASSERT_NE(map1.find(uid), map1.end());
+        ASSERT_NO_FATAL_FAILURE(TestCheckUpdate(map1[uid], newTimes));
+    }
+}
+
 TEST_F(TimeInStateTest, TotalAndAllUidTimeInStateConsistent) {
     auto allUid = getUidsCpuFreqTimes();
     auto total = getTotalCpuFreqTimes();
@@ -312,6 +339,34 @@ TEST_F(TimeInStateTest, AllUidUpdatedConcurrentTimes) {
     }
 }
 
+TEST_F(TimeInStateTest, AllUidUpdatedConcurrentTimesReusedMap) {
+    std::unordered_map<uint32_t, concurrent_time_t> map;
+    uint64_t lastUpdate = 0;
+    ASSERT_TRUE(getUidsUpdatedConcurrentTimes(&lastUpdate, &map));
+    ASSERT_FALSE(map.empty());
+    ASSERT_NE(lastUpdate, (uint64_t)0);
+    auto map1 = map;
+    uint64_t oldLastUpdate = lastUpdate;
+
+    // Sleep briefly to trigger a context switch, ensuring we see at least one update.
+    struct timespec ts;
+    ts.tv_sec = 0;
+    ts.tv_nsec = 1000000;
+    nanosleep (&ts, NULL);
+
+    ASSERT_TRUE(getUidsUpdatedConcurrentTimes(&lastUpdate, &map));
+    ASSERT_FALSE(map.empty());
+    ASSERT_NE(lastUpdate, oldLastUpdate);
+    // The uids that have not run since the first call are no longer in the map.
+    ASSERT_LT(map.size(), map1.size());
+
+    for (const auto &[uid, newTimes] : map) {
+        ASSERT_NE(map1.find(uid), map1.end());
+        ASSERT_NO_FATAL_FAILURE(TestCheckUpdate({map1[uid].active}, {newTimes.active}));
+        ASSERT_NO_FATAL_FAILURE(TestCheckUpdate(map1[uid].policy, newTimes.policy));
+    }
+}
+
 TEST_F(TimeInStateTest, SingleAndAllUidConcurrentTimesConsistent) {
     uint64_t zero = 0;
     auto maps = {getUidsConcurrentTimes(), getUidsUpdatedConcurrentTimes(&zero)};
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ftl/flat_map.h>
+#include <ftl/small_map.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace {
+
+// The keys are spread like display IDs, rather than consecutive.
+std::vector<std::uint64_t> makeKeys(std::size_t count, std::uint64_t seed) {
+  std::vector<std::uint64_t> keys;
+  keys.reserve(count);
+  for (std::size_t i = 0; i < count; i++) {
+    keys.push_back((seed + i) * 0x9e3779b97f4a7c15);
+  }
+  return keys;
+}
+
+// Looks up keys that are in the map, or none of them if Hit is false.
+template <typename Map, bool Hit>
+void BM_Lookup(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  const auto keys = makeKeys(size, 1);
+
+  Map map;
+  for (const auto key : keys) map.try_emplace(key, key);
+
+  const auto queries = Hit ? keys : makeKeys(size, size + 1);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.contains(queries[i]));
+    if (++i == queries.size()) i = 0;
+  }
+}
+
+// Fills the map from empty, including its move to dynamic memory.
+template <typename Map>
+void BM_Fill(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  const auto keys = makeKeys(size, 1);
+
+  for (auto _ : state) {
+    Map map;
+    for (const auto key : keys) map.try_emplace(key, key);
+    benchmark::DoNotOptimize(map);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * size));
+}
+
+// Replaces the oldest key of a full map, as when displays are hotplugged.
+template <typename Map>
+void BM_Churn(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  const auto keys = makeKeys(size * 2, 1);
+
+  Map map;
+  for (std::size_t i = 0; i < size; i++) map.try_emplace(keys[i], keys[i]);
+
+  std::size_t oldest = 0;
+  for (auto _ : state) {
+    map.erase(keys[oldest]);
+    const std::size_t newest = (oldest + size) % keys.size();
+    map.try_emplace(keys[newest], keys[newest]);
+    oldest = (oldest + 1) % keys.size();
+  }
+}
+
+using UnorderedMap = std::unordered_map<std::uint64_t, std::uint64_t>;
+
+// Sizes that fit inline in the maps with small capacity.
+void smallSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Arg(1)->Arg(2)->Arg(4);
+}
+
+// Sizes that fit inline in the maps with large capacity, or outgrow them.
+void largeSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Arg(8)->Arg(16)->Arg(32)->Arg(128);
+}
+
+template <typename Map>
+void registerBenchmarks(const char* name, void (*sizes)(benchmark::internal::Benchmark*)) {
+  const std::string prefix = std::string(name) + '/';
+  benchmark::RegisterBenchmark((prefix + "LookupHit").c_str(), BM_Lookup<Map, true>)->Apply(sizes);
+  benchmark::RegisterBenchmark((prefix + "LookupMiss").c_str(), BM_Lookup<Map, false>)
+      ->Apply(sizes);
+  benchmark::RegisterBenchmark((prefix + "Fill").c_str(), BM_Fill<Map>)->Apply(sizes);
+  benchmark::RegisterBenchmark((prefix + "Churn").c_str(), BM_Churn<Map>)->Apply(sizes);
+}
+
+[[maybe_unused]] const bool kRegistered = [] {
+  registerBenchmarks<ftl::SmallMap<std::uint64_t, std::uint64_t, 4>>("SmallMap<4>", smallSizes);
+  registerBenchmarks<ftl::FlatMap<std::uint64_t, std::uint64_t, 4>>("FlatMap<4>", smallSizes);
+  registerBenchmarks<UnorderedMap>("unordered_map", smallSizes);
+
+  registerBenchmarks<ftl::SmallMap<std::uint64_t, std::uint64_t, 32>>("SmallMap<32>", largeSizes);
+  registerBenchmarks<ftl::FlatMap<std::uint64_t, std::uint64_t, 32>>("FlatMap<32>", largeSizes);
+  registerBenchmarks<UnorderedMap>("unordered_map", largeSizes);
+  return true;
+}();
+
+}  // namespace
+}  // namespace android
@@ -0,0 +1,259 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ftl/flat_map.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace android::test {
+
+using ftl::FlatMap;
+
+// Keep in sync with example usage in header file.
+TEST(FlatMap, Example) {
+  ftl::FlatMap<int, std::string, 32> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.dynamic());
+
+  map.try_emplace(123, "abc");
+  map.try_emplace(42, 3u, '?');
+  EXPECT_EQ(map.size(), 2u);
+
+  EXPECT_TRUE(map.contains(123));
+  EXPECT_EQ(map.get(42).transform([](const std::string& s) { return s.size(); }), 3u);
+
+  map.emplace_or_replace(42, "xyz");
+  EXPECT_EQ(map.get(42)->get(), "xyz");
+
+  EXPECT_TRUE(map.erase(123));
+  EXPECT_FALSE(map.contains(123));
+}
+
+TEST(FlatMap, Linear) {
+  static_assert(FlatMap<int, int, 1>::linear());
+  static_assert(FlatMap<int, int, FlatMap<int, int, 1>::kMaxLinearCapacity>::linear());
+  static_assert(!FlatMap<int, int, FlatMap<int, int, 1>::kMaxLinearCapacity + 1>::linear());
+  static_assert(FlatMap<int, int, 3>::static_capacity() == 3u);
+}
+
+TEST(FlatMap, TryEmplace) {
+  FlatMap<int, std::string, 2> map;
+
+  {
+    const auto [it, ok] = map.try_emplace(1, "a");
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(it->first, 1);
+    EXPECT_EQ(it->second, "a");
+  }
+  {
+    const auto [it, ok] = map.try_emplace(1, "b");
+    ASSERT_FALSE(ok);
+    EXPECT_EQ(it->second, "a");
+  }
+
+  map.try_emplace(2, "b");
+  EXPECT_FALSE(map.dynamic());
+
+  map.try_emplace(3, "c");
+  EXPECT_TRUE(map.dynamic());
+  EXPECT_EQ(map.size(), 3u);
+
+  EXPECT_EQ(map.get(1)->get(), "a");
+  EXPECT_EQ(map.get(2)->get(), "b");
+  EXPECT_EQ(map.get(3)->get(), "c");
+  EXPECT_FALSE(map.get(4));
+}
+
+TEST(FlatMap, Replace) {
+  // The value type does not need to be assignable.
+  struct Value {
+    const int value;
+  };
+
+  FlatMap<int, Value, 4> map;
+  EXPECT_EQ(map.try_replace(1, 10), map.end());
+
+  EXPECT_TRUE(map.emplace_or_replace(1, 10).second);
+  EXPECT_FALSE(map.emplace_or_replace(1, 20).second);
+  EXPECT_EQ(map.get(1)->get().value, 20);
+
+  // The arguments may refer to the replaced value.
+  const auto it = map.try_replace(1, map.get(1)->get().value + 1);
+  ASSERT_NE(it, map.end());
+  EXPECT_EQ(it->second.value, 21);
+}
+
+TEST(FlatMap, EraseLinear) {
+  FlatMap<int, std::unique_ptr<int>, 4> map;
+  for (int i = 0; i < 4; i++) {
+    map.try_emplace(i, std::make_unique<int>(i));
+  }
+
+  EXPECT_TRUE(map.erase(1));
+  EXPECT_FALSE(map.erase(1));
+  EXPECT_EQ(map.size(), 3u);
+
+  for (int i : {0, 2, 3}) {
+    ASSERT_TRUE(map.contains(i));
+    EXPECT_EQ(*map.get(i)->get(), i);
+  }
+  EXPECT_FALSE(map.contains(1));
+}
+
+TEST(FlatMap, EraseHashed) {
+  FlatMap<int, int, 16> map;
+  for (int i = 0; i < 16; i++) {
+    map.try_emplace(i, -i);
+  }
+  EXPECT_FALSE(map.dynamic());
+
+  for (int i = 0; i < 16; i += 2) {
+    EXPECT_TRUE(map.erase(i));
+  }
+  EXPECT_EQ(map.size(), 8u);
+
+  for (int i = 0; i < 16; i++) {
+    EXPECT_EQ(map.contains(i), i % 2 == 1);
+  }
+}
+
+TEST(FlatMap, Iterate) {
+  FlatMap<int, int, 16> map;
+  for (int i = 0; i < 100; i++) {
+    map.try_emplace(i, i * 2);
+  }
+  EXPECT_TRUE(map.dynamic());
+
+  std::size_t count = 0;
+  int sum = 0;
+  for (const auto& [key, value] : map) {
+    EXPECT_EQ(value, key * 2);
+    count++;
+    sum += key;
+  }
+  EXPECT_EQ(count, 100u);
+  EXPECT_EQ(sum, 99 * 100 / 2);
+
+  for (auto& [key, value] : map) {
+    value = key;
+  }
+  EXPECT_EQ(map.get(42), 42);
+}
+
+TEST(FlatMap, CopyAndMove) {
+  FlatMap<int, std::string, 8> inlineMap;
+  inlineMap.try_emplace(1, "one");
+  inlineMap.try_emplace(2, "two");
+
+  FlatMap<int, std::string, 8> dynamicMap;
+  for (int i = 0; i < 20; i++) {
+    dynamicMap.try_emplace(i, std::to_string(i));
+  }
+  ASSERT_TRUE(dynamicMap.dynamic());
+
+  for (const auto& map : {inlineMap, dynamicMap}) {
+    auto copy = map;
+    EXPECT_EQ(copy, map);
+    EXPECT_EQ(copy.dynamic(), map.dynamic());
+
+    const auto moved = std::move(copy);
+    EXPECT_EQ(moved, map);
+    EXPECT_TRUE(copy.empty());
+    EXPECT_FALSE(copy.dynamic());
+
+    copy = moved;
+    EXPECT_EQ(copy, map);
+  }
+
+  auto map = dynamicMap;
+  map = inlineMap;
+  EXPECT_EQ(map, inlineMap);
+  map = std::move(dynamicMap);
+  EXPECT_EQ(map.size(), 20u);
+}
+
+TEST(FlatMap, Clear) {
+  FlatMap<int, int, 16> map;
+  for (int i = 0; i < 40; i++) {
+    map.try_emplace(i, i);
+  }
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.dynamic());
+  EXPECT_EQ(map.begin(), map.end());
+  EXPECT_FALSE(map.contains(0));
+
+  map.try_emplace(0, 0);
+  EXPECT_EQ(map.get(0), 0);
+}
+
+TEST(FlatMap, CollidingHashes) {
+  struct Hash {
+    std::size_t operator()(int key) const { return static_cast<std::size_t>(key % 2); }
+  };
+
+  FlatMap<int, int, 16, Hash> map;
+  for (int i = 0; i < 50; i++) {
+    map.try_emplace(i, i);
+  }
+  for (int i = 0; i < 50; i += 3) {
+    EXPECT_TRUE(map.erase(i));
+  }
+  for (int i = 0; i < 50; i++) {
+    EXPECT_EQ(map.contains(i), i % 3 != 0);
+  }
+}
+
+// Checks the map against std::unordered_map under random churn, which reuses deleted slots and
+// rehashes in place.
+template <std::size_t N>
+void churn() {
+  FlatMap<std::uint32_t, std::uint32_t, N> map;
+  std::unordered_map<std::uint32_t, std::uint32_t> reference;
+
+  std::mt19937 random(N);
+  std::uniform_int_distribution<std::uint32_t> keys(0, 200);
+  for (int i = 0; i < 20000; i++) {
+    const std::uint32_t key = keys(random);
+    if (random() % 3 == 0) {
+      EXPECT_EQ(map.erase(key), reference.erase(key) == 1);
+    } else {
+      EXPECT_EQ(map.try_emplace(key, i).second, reference.try_emplace(key, i).second);
+    }
+    ASSERT_EQ(map.size(), reference.size());
+  }
+
+  for (const auto& [key, value] : reference) {
+    EXPECT_EQ(map.get(key), value);
+  }
+  for (const auto& [key, value] : map) {
+    EXPECT_EQ(reference.at(key), value);
+  }
+}
+
+TEST(FlatMap, Churn) {
+  churn<4>();
+  churn<16>();
+  churn<64>();
+}
+
+}  // namespace android::test
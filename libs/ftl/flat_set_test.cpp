@@ -0,0 +1,57 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ftl/flat_set.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace android::test {
+
+using ftl::FlatSet;
+
+// Keep in sync with example usage in header file.
+TEST(FlatSet, Example) {
+  ftl::FlatSet<int, 16> set;
+  EXPECT_TRUE(set.emplace(42).second);
+  EXPECT_FALSE(set.emplace(42).second);
+
+  EXPECT_TRUE(set.contains(42));
+  EXPECT_TRUE(set.erase(42));
+  EXPECT_TRUE(set.empty());
+}
+
+TEST(FlatSet, Grow) {
+  FlatSet<std::string, 4> set;
+  for (int i = 0; i < 10; i++) {
+    set.emplace(std::to_string(i));
+  }
+  EXPECT_TRUE(set.dynamic());
+  EXPECT_EQ(set.size(), 10u);
+  EXPECT_EQ(*set.find("7"), "7");
+  EXPECT_EQ(set.find("10"), set.end());
+
+  FlatSet<std::string, 16> other;
+  for (int i = 9; i >= 0; i--) {
+    other.emplace(std::to_string(i));
+  }
+  EXPECT_EQ(set, other);
+
+  other.erase("0");
+  EXPECT_NE(set, other);
+}
+
+}  // namespace android::test
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ftl/ring_queue.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android::test {
+
+using ftl::MpscQueue;
+using ftl::SpscQueue;
+
+// Keep in sync with example usage in header file.
+TEST(RingQueue, Example) {
+  ftl::SpscQueue<int, 4> queue;
+  EXPECT_TRUE(queue.try_push(1));
+  EXPECT_TRUE(queue.try_emplace(2));
+
+  EXPECT_EQ(queue.try_pop(), 1);
+  EXPECT_EQ(queue.pop(), 2);
+  EXPECT_FALSE(queue.try_pop());
+}
+
+template <typename Queue>
+class RingQueueTest : public testing::Test {};
+
+using Queues =
+    testing::Types<SpscQueue<std::unique_ptr<int>, 4>, MpscQueue<std::unique_ptr<int>, 4>>;
+TYPED_TEST_SUITE(RingQueueTest, Queues);
+
+TYPED_TEST(RingQueueTest, Full) {
+  TypeParam queue;
+  EXPECT_TRUE(queue.empty());
+
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.try_push(std::make_unique<int>(i)));
+  }
+  EXPECT_TRUE(queue.full());
+  EXPECT_EQ(queue.size(), 4u);
+
+  // The value is left intact if the queue is full.
+  auto value = std::make_unique<int>(4);
+  EXPECT_FALSE(queue.try_push(std::move(value)));
+  ASSERT_TRUE(value);
+
+  EXPECT_EQ(*queue.pop(), 0);
+  EXPECT_TRUE(queue.try_push(std::move(value)));
+  EXPECT_FALSE(value);
+
+  for (int i = 1; i <= 4; i++) {
+    const auto value = queue.try_pop();
+    ASSERT_TRUE(value);
+    EXPECT_EQ(**value, i);
+  }
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.try_pop());
+}
+
+TYPED_TEST(RingQueueTest, Wrap) {
+  TypeParam queue;
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(queue.try_emplace(new int(i)));
+    EXPECT_TRUE(queue.try_emplace(new int(-i)));
+    EXPECT_EQ(*queue.pop(), i);
+    EXPECT_EQ(*queue.pop(), -i);
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(RingQueue, Destroy) {
+  const auto value = std::make_shared<int>(42);
+  {
+    SpscQueue<std::shared_ptr<int>, 2> spsc;
+    MpscQueue<std::shared_ptr<int>, 2> mpsc;
+    EXPECT_TRUE(spsc.try_push(value));
+    EXPECT_TRUE(mpsc.try_push(value));
+    EXPECT_EQ(value.use_count(), 3);
+  }
+  EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(RingQueue, SpscBlocking) {
+  constexpr int kCount = 10'000;
+  SpscQueue<int, 8> queue;
+
+  std::thread producer([&queue] {
+    for (int i = 0; i < kCount; i++) {
+      queue.push(i);
+    }
+  });
+
+  for (int i = 0; i < kCount; i++) {
+    ASSERT_EQ(queue.pop(), i);
+  }
+
+  producer.join();
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(RingQueue, MpscBlocking) {
+  constexpr int kProducers = 4;
+  constexpr int kCount = 10'000;
+  MpscQueue<std::pair<int, int>, 16> queue;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; p++) {
+    producers.emplace_back([&queue, p] {
+      for (int i = 0; i < kCount; i++) {
+        queue.emplace(p, i);
+      }
+    });
+  }
+
+  // The values of each producer are popped in order.
+  std::vector<int> next(kProducers, 0);
+  for (int i = 0; i < kProducers * kCount; i++) {
+    const auto [p, value] = queue.pop();
+    ASSERT_EQ(value, next[p]++);
+  }
+
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(next, std::vector<int>(kProducers, kCount));
+}
+
+TEST(RingQueue, MpscNonBlocking) {
+  constexpr int kProducers = 4;
+  constexpr int kCount = 10'000;
+  MpscQueue<std::string, 4> queue;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; p++) {
+    producers.emplace_back([&queue] {
+      for (int i = 0; i < kCount;) {
+        if (queue.try_push(std::to_string(i))) {
+          i++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  int popped = 0;
+  while (popped < kProducers * kCount) {
+    if (queue.try_pop()) {
+      popped++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace android::test
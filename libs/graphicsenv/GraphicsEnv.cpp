@@ -33,6 +33,7 @@
 #include <log/log.h>
 #include <nativeloader/dlext_namespaces.h>
 #include <sys/prctl.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 
 #include <memory>
@@ -132,6 +133,20 @@ static const char* kFormerlyVndkspLibrariesList =
     "libutilscallstack.so:"
     "libz.so";
 
+// What to preload in zygote. See GraphicsEnv::preloadInZygote.
+static const char* ZYGOTE_PRELOAD_PROPERTY = "ro.gfx.driver.zygote_preload";
+static const char* ZYGOTE_PRELOAD_NONE = "none";
+static const char* ZYGOTE_PRELOAD_SYSTEM = "system";
+static const char* ZYGOTE_PRELOAD_UPDATABLE = "updatable";
+
+// The properties whose values name the driver libraries, in the order that the EGL and Vulkan
+// loaders look for them.
+static constexpr const char* kGlesDriverSuffixProperties[] = {"persist.graphics.egl",
+                                                              "ro.hardware.egl",
+                                                              "ro.board.platform"};
+static constexpr const char* kVulkanDriverSuffixProperties[] = {"ro.hardware.vulkan",
+                                                                "ro.board.platform"};
+
 static std::string vndkVersionStr() {
 #ifdef __BIONIC__
     return base::GetProperty("ro.vndk.version", "");
@@ -246,20 +261,15 @@ void GraphicsEnv::setDriverPathAndSphalLibraries(const std::string& path,
 bool GraphicsEnv::linkDriverNamespaceLocked(android_namespace_t* destNamespace,
                                             android_namespace_t* vndkNamespace,
                                             const std::string& sharedSphalLibraries) {
-    const std::string llndkLibraries = getSystemNativeLibraries(NativeLibrary::LLNDK);
-    if (llndkLibraries.empty()) {
+    if (!readSystemNativeLibrariesLocked()) {
         return false;
     }
-    if (!android_link_namespaces(destNamespace, nullptr, llndkLibraries.c_str())) {
+    if (!android_link_namespaces(destNamespace, nullptr, mLlndkLibraries.c_str())) {
         ALOGE("Failed to link default namespace[%s]", dlerror());
         return false;
     }
 
-    const std::string vndkspLibraries = getSystemNativeLibraries(NativeLibrary::VNDKSP);
-    if (vndkspLibraries.empty()) {
-        return false;
-    }
-    if (!android_link_namespaces(destNamespace, vndkNamespace, vndkspLibraries.c_str())) {
+    if (!android_link_namespaces(destNamespace, vndkNamespace, mVndkspLibraries.c_str())) {
         ALOGE("Failed to link vndk namespace[%s]", dlerror());
         return false;
     }
@@ -284,6 +294,40 @@ bool GraphicsEnv::linkDriverNamespaceLocked(android_namespace_t* destNamespace,
     return true;
 }
 
+bool GraphicsEnv::readSystemNativeLibrariesLocked() {
+    if (mLlndkLibraries.empty()) {
+        mLlndkLibraries = getSystemNativeLibraries(NativeLibrary::LLNDK);
+    }
+    if (mVndkspLibraries.empty()) {
+        mVndkspLibraries = getSystemNativeLibraries(NativeLibrary::VNDKSP);
+    }
+    return !mLlndkLibraries.empty() && !mVndkspLibraries.empty();
+}
+
+android_namespace_t* GraphicsEnv::createDriverNamespaceLocked(const std::string& path,
+                                                              const std::string& sphalLibraries) {
+    ATRACE_CALL();
+
+    auto vndkNamespace = android_get_exported_namespace(isVndkEnabled() ? "vndk" : "sphal");
+    if (!vndkNamespace) {
+        return nullptr;
+    }
+
+    android_namespace_t* driverNamespace =
+            android_create_namespace("updatable gfx driver",
+                                     path.c_str(), // ld_library_path
+                                     path.c_str(), // default_library_path
+                                     ANDROID_NAMESPACE_TYPE_ISOLATED,
+                                     nullptr, // permitted_when_isolated_path
+                                     nullptr);
+
+    if (!linkDriverNamespaceLocked(driverNamespace, vndkNamespace, sphalLibraries)) {
+        return nullptr;
+    }
+
+    return driverNamespace;
+}
+
 android_namespace_t* GraphicsEnv::getDriverNamespace() {
     std::lock_guard<std::mutex> lock(mNamespaceMutex);
 
@@ -316,23 +360,15 @@ android_namespace_t* GraphicsEnv::getDriverNamespace() {
         ALOGI("Driver path is setup via UPDATABLE_GFX_DRIVER: %s", mDriverPath.c_str());
     }
 
-    auto vndkNamespace = android_get_exported_namespace(isVndkEnabled() ? "vndk" : "sphal");
-    if (!vndkNamespace) {
-        mDriverNamespace = nullptr;
+    if (mPreloadedDriverNamespace && mPreloadedDriverPath == mDriverPath &&
+        mPreloadedSphalLibraries == mSphalLibraries) {
+        ALOGD("Using updatable driver preloaded in zygote, which saved %.2fms",
+              mPreloadedDriverTime / 1e6);
+        mDriverNamespace = mPreloadedDriverNamespace;
         return mDriverNamespace;
     }
 
-    mDriverNamespace = android_create_namespace("updatable gfx driver",
-                                                mDriverPath.c_str(), // ld_library_path
-                                                mDriverPath.c_str(), // default_library_path
-                                                ANDROID_NAMESPACE_TYPE_ISOLATED,
-                                                nullptr, // permitted_when_isolated_path
-                                                nullptr);
-
-    if (!linkDriverNamespaceLocked(mDriverNamespace, vndkNamespace, mSphalLibraries)) {
-        mDriverNamespace = nullptr;
-    }
-
+    mDriverNamespace = createDriverNamespaceLocked(mDriverPath, mSphalLibraries);
     return mDriverNamespace;
 }
 
@@ -340,6 +376,89 @@ std::string GraphicsEnv::getDriverPath() const {
     return mDriverPath;
 }
 
+/**
+ * APIs for zygote
+ */
+
+void GraphicsEnv::preloadInZygote(const std::string& path, const std::string& sphalLibraries) {
+    ATRACE_CALL();
+
+    const std::string preload = base::GetProperty(ZYGOTE_PRELOAD_PROPERTY, ZYGOTE_PRELOAD_SYSTEM);
+    if (preload == ZYGOTE_PRELOAD_NONE) {
+        return;
+    }
+    if (preload != ZYGOTE_PRELOAD_SYSTEM && preload != ZYGOTE_PRELOAD_UPDATABLE) {
+        ALOGE("Unknown %s value '%s', preloading %s", ZYGOTE_PRELOAD_PROPERTY, preload.c_str(),
+              ZYGOTE_PRELOAD_SYSTEM);
+    }
+
+    std::lock_guard<std::mutex> lock(mNamespaceMutex);
+
+    const nsecs_t startTime = systemTime();
+    if (!readSystemNativeLibrariesLocked()) {
+        ALOGE("Failed to preload the system native library lists");
+        return;
+    }
+    const nsecs_t listsTime = systemTime();
+    ALOGI("Preloaded the system native library lists in %.2fms", (listsTime - startTime) / 1e6);
+
+    if (preload != ZYGOTE_PRELOAD_UPDATABLE || path.empty() || mPreloadedDriverNamespace) {
+        return;
+    }
+
+    mPreloadedDriverNamespace = createDriverNamespaceLocked(path, sphalLibraries);
+    if (!mPreloadedDriverNamespace) {
+        ALOGE("Failed to preload the updatable driver namespace for %s", path.c_str());
+        return;
+    }
+    mPreloadedDriverPath = path;
+    mPreloadedSphalLibraries = sphalLibraries;
+    preloadDriverLibrariesLocked(mPreloadedDriverNamespace);
+    // The library lists are read by every app process that creates a namespace, so they are
+    // counted as saved too.
+    mPreloadedDriverTime = systemTime() - startTime;
+    ALOGI("Preloaded updatable driver %s in %.2fms", path.c_str(),
+          (systemTime() - listsTime) / 1e6);
+}
+
+void GraphicsEnv::preloadDriverLibrariesLocked(android_namespace_t* driverNamespace) {
+    ATRACE_CALL();
+
+    const android_dlextinfo dlextinfo = {
+            .flags = ANDROID_DLEXT_USE_NAMESPACE,
+            .library_namespace = driverNamespace,
+    };
+    // Loads the first of names that can be loaded, as the loaders do.
+    const auto preloadFirst = [&](const std::vector<std::string>& names) {
+        for (const std::string& name : names) {
+            if (void* so = android_dlopen_ext(name.c_str(), RTLD_LOCAL | RTLD_NOW, &dlextinfo)) {
+                ALOGV("Preloaded %s", name.c_str());
+                mPreloadedDriverLibraries.push_back(so);
+                return true;
+            }
+        }
+        return false;
+    };
+    const auto namesFor = [](const auto& properties, const std::string& prefix) {
+        std::vector<std::string> names;
+        for (const char* property : properties) {
+            const std::string suffix = base::GetProperty(property, "");
+            if (!suffix.empty()) {
+                names.push_back(prefix + suffix + ".so");
+            }
+        }
+        return names;
+    };
+
+    // The EGL loader prefers a single GLES library over separate EGL and GLES libraries.
+    if (!preloadFirst(namesFor(kGlesDriverSuffixProperties, "libGLES_")) &&
+        preloadFirst(namesFor(kGlesDriverSuffixProperties, "libEGL_"))) {
+        preloadFirst(namesFor(kGlesDriverSuffixProperties, "libGLESv1_CM_"));
+        preloadFirst(namesFor(kGlesDriverSuffixProperties, "libGLESv2_"));
+    }
+    preloadFirst(namesFor(kVulkanDriverSuffixProperties, "vulkan."));
+}
+
 /**
  * APIs for GpuStats
  */
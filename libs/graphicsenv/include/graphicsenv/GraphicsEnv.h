@@ -65,6 +65,21 @@ public:
     android_namespace_t* getDriverNamespace();
     std::string getDriverPath() const;
 
+    /*
+     * Apis for zygote
+     */
+    // Preload in zygote, before app processes are forked, the driver set up that each app process
+    // would otherwise do on its first GL or Vulkan call. What is preloaded is set per device by
+    // ro.gfx.driver.zygote_preload:
+    //     "none":      nothing.
+    //     "system":    the llndk and vndk-sp library lists that the namespaces of ANGLE and of
+    //                  the updatable driver are linked with. This is the default.
+    //     "updatable": also the namespace and the libraries of the updatable driver at path, with
+    //                  sphalLibraries as in setDriverPathAndSphalLibraries.
+    // The system driver itself is preloaded by the EGL and Vulkan loaders. An app process only
+    // uses the preloaded updatable driver if it is set up with the same path and sphal libraries.
+    void preloadInZygote(const std::string& path, const std::string& sphalLibraries);
+
     /*
      * Apis for GpuStats
      */
@@ -148,6 +163,13 @@ private:
     bool linkDriverNamespaceLocked(android_namespace_t* destNamespace,
                                    android_namespace_t* vndkNamespace,
                                    const std::string& sharedSphalLibraries);
+    // Read the llndk and vndk-sp library lists, if they have not already been read.
+    bool readSystemNativeLibrariesLocked();
+    // Create and link an updatable driver namespace for the driver at path.
+    android_namespace_t* createDriverNamespaceLocked(const std::string& path,
+                                                     const std::string& sphalLibraries);
+    // Load the libraries that the loaders look for in the updatable driver namespace.
+    void preloadDriverLibrariesLocked(android_namespace_t* driverNamespace);
     // Check whether this process is ready to send stats.
     bool readyToSendGpuStatsLocked();
     // Send the initial complete GpuStats to GpuService.
@@ -167,6 +189,21 @@ private:
     std::string mSphalLibraries;
     // Updatable driver namespace.
     android_namespace_t* mDriverNamespace = nullptr;
+    // Colon separated llndk and vndk-sp libraries, read once per process.
+    std::string mLlndkLibraries;
+    std::string mVndkspLibraries;
+
+    /**
+     * Zygote preloading variables.
+     */
+    // Updatable driver namespace created in zygote, and the path and sphal libraries it is for.
+    android_namespace_t* mPreloadedDriverNamespace = nullptr;
+    std::string mPreloadedDriverPath;
+    std::string mPreloadedSphalLibraries;
+    // Handles of the libraries loaded in the preloaded namespace, which stay loaded.
+    std::vector<void*> mPreloadedDriverLibraries;
+    // Time spent in zygote on the preloaded namespace, which an app process that uses it saves.
+    int64_t mPreloadedDriverTime = 0;
 
     /**
      * ANGLE variables.
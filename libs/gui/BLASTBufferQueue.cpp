@@ -32,6 +32,7 @@
 #include <sys/eventfd.h>
 
 #include <gui/FrameRateUtils.h>
+#include <gui/FrameTransactionAggregator.h>
 #include <gui/GLConsumer.h>
 #include <gui/IProducerListener.h>
 #include <gui/Surface.h>
@@ -241,6 +242,9 @@ BLASTBufferQueue::BLASTBufferQueue(const std::string& name, const sp<SurfaceCont
 
 BLASTBufferQueue::~BLASTBufferQueue() {
     TransactionCompletedListener::getInstance()->removeQueueStallListener(this);
+    if (mTransactionAggregator) {
+        mTransactionAggregator->unregisterQueue(this);
+    }
     if (mPendingTransactions.empty()) {
         return;
     }
@@ -312,6 +316,7 @@ void BLASTBufferQueue::update(const sp<SurfaceControl>& surface, uint32_t width,
         }
     }
     if (applyTransaction) {
+        flushTransactionAggregatorLocked();
         // All transactions on our apply token are one-way. See comment on mAppliedLastTransaction
         t.setApplyToken(mApplyToken).apply(false, true);
     }
@@ -469,6 +474,18 @@ void BLASTBufferQueue::releaseBufferCallback(
                                 false /* fakeRelease */);
 }
 
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BUFFER_RELEASE_CHANNEL)
+void BLASTBufferQueue::releaseBufferCallbacks(
+        const std::vector<gui::BufferReleaseChannel::Message>& releases) {
+    std::lock_guard _lock{mMutex};
+    BBQ_TRACE("releases=%zu", releases.size());
+    for (const auto& release : releases) {
+        releaseBufferCallbackLocked(release.releaseCallbackId, release.releaseFence,
+                                    release.maxAcquiredBufferCount, false /* fakeRelease */);
+    }
+}
+#endif
+
 void BLASTBufferQueue::releaseBufferCallbackLocked(
         const ReleaseCallbackId& id, const sp<Fence>& releaseFence,
         std::optional<uint32_t> currentMaxAcquiredBufferCount, bool fakeRelease) {
@@ -698,7 +715,15 @@ status_t BLASTBufferQueue::acquireNextBufferLocked(
     }
 
     mergePendingTransactions(t, bufferItem.mFrameNumber);
-    if (applyTransaction) {
+    if (applyTransaction && mTransactionAggregator) {
+        mTransactionAggregator->add(this, t,
+                                    bufferItem.mIsAutoTimestamp
+                                            ? std::nullopt
+                                            : std::make_optional(bufferItem.mTimestamp));
+        mAppliedLastTransaction = true;
+        mLastAppliedFrameNumber = bufferItem.mFrameNumber;
+    } else if (applyTransaction) {
+        flushTransactionAggregatorLocked();
         // All transactions on our apply token are one-way. See comment on mAppliedLastTransaction
         t->setApplyToken(mApplyToken).apply(false, true);
         mAppliedLastTransaction = true;
@@ -1027,6 +1052,7 @@ void BLASTBufferQueue::applyPendingTransactions(uint64_t frameNumber) {
 
     SurfaceComposerClient::Transaction t;
     mergePendingTransactions(&t, frameNumber);
+    flushTransactionAggregatorLocked();
     // All transactions on our apply token are one-way. See comment on mAppliedLastTransaction
     t.setApplyToken(mApplyToken).apply(false, true);
 }
@@ -1271,6 +1297,32 @@ void BLASTBufferQueue::setApplyToken(sp<IBinder> applyToken) {
     mApplyToken = std::move(applyToken);
 }
 
+void BLASTBufferQueue::setTransactionAggregator(
+        const sp<FrameTransactionAggregator>& aggregator) {
+    std::lock_guard _lock{mMutex};
+    if (mTransactionAggregator == aggregator) {
+        return;
+    }
+    if (mTransactionAggregator) {
+        mTransactionAggregator->unregisterQueue(this);
+    }
+    mTransactionAggregator = aggregator;
+    if (mTransactionAggregator) {
+        mTransactionAggregator->registerQueue(this);
+        mApplyToken = mTransactionAggregator->getApplyToken();
+    } else {
+        mApplyToken = sp<BBinder>::make();
+    }
+}
+
+void BLASTBufferQueue::flushTransactionAggregatorLocked() {
+    // Transactions this queue added to the aggregator must reach SurfaceFlinger before the ones
+    // it applies itself.
+    if (mTransactionAggregator) {
+        mTransactionAggregator->flush();
+    }
+}
+
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BUFFER_RELEASE_CHANNEL)
 
 BLASTBufferQueue::BufferReleaseReader::BufferReleaseReader(
@@ -1320,9 +1372,8 @@ BLASTBufferQueue::BufferReleaseReader& BLASTBufferQueue::BufferReleaseReader::op
     return *this;
 }
 
-status_t BLASTBufferQueue::BufferReleaseReader::readBlocking(ReleaseCallbackId& outId,
-                                                             sp<Fence>& outFence,
-                                                             uint32_t& outMaxAcquiredBufferCount) {
+status_t BLASTBufferQueue::BufferReleaseReader::readBlocking(
+        std::vector<gui::BufferReleaseChannel::Message>& outMessages) {
     epoll_event event{};
     while (true) {
         int eventCount = epoll_wait(mEpollFd.get(), &event, 1 /* maxevents */, -1 /* timeout */);
@@ -1345,7 +1396,12 @@ status_t BLASTBufferQueue::BufferReleaseReader::readBlocking(ReleaseCallbackId&
     }
 
     std::lock_guard lock{mMutex};
-    return mEndpoint->readReleaseFence(outId, outFence, outMaxAcquiredBufferCount);
+    // Drain every release that has arrived, so that they are handled under a single BBQ lock.
+    status_t status = mEndpoint->readReleaseFences(outMessages);
+    while (status == OK) {
+        status = mEndpoint->readReleaseFences(outMessages);
+    }
+    return outMessages.empty() ? status : OK;
 }
 
 void BLASTBufferQueue::BufferReleaseReader::interruptBlockingRead() {
@@ -1360,19 +1416,17 @@ void BLASTBufferQueue::BufferReleaseThread::start(const sp<BLASTBufferQueue>& bb
     mReader = bbq->mBufferReleaseReader;
     std::thread([running = mRunning, reader = mReader, weakBbq = wp<BLASTBufferQueue>(bbq)]() {
         pthread_setname_np(pthread_self(), "BufferReleaseThread");
+        std::vector<gui::BufferReleaseChannel::Message> releases;
         while (*running) {
-            ReleaseCallbackId id;
-            sp<Fence> fence;
-            uint32_t maxAcquiredBufferCount;
-            if (status_t status = reader->readBlocking(id, fence, maxAcquiredBufferCount);
-                status != OK) {
+            releases.clear();
+            if (status_t status = reader->readBlocking(releases); status != OK) {
                 continue;
             }
             sp<BLASTBufferQueue> bbq = weakBbq.promote();
             if (!bbq) {
                 return;
             }
-            bbq->releaseBufferCallback(id, fence, maxAcquiredBufferCount);
+            bbq->releaseBufferCallbacks(releases);
         }
     }).detach();
 }
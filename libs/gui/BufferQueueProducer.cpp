@@ -93,10 +93,8 @@ BufferQueueProducer::BufferQueueProducer(const sp<BufferQueueCore>& core,
 
 BufferQueueProducer::~BufferQueueProducer() {}
 
-status_t BufferQueueProducer::requestBuffer(int slot, sp<GraphicBuffer>* buf) {
-    ATRACE_CALL();
+status_t BufferQueueProducer::requestBufferLocked(int slot, sp<GraphicBuffer>* buf) {
     BQ_LOGV("requestBuffer: slot %d", slot);
-    std::lock_guard<std::mutex> lock(mCore->mMutex);
 
     if (mCore->mIsAbandoned) {
         BQ_LOGE("requestBuffer: BufferQueue has been abandoned");
@@ -123,6 +121,25 @@ status_t BufferQueueProducer::requestBuffer(int slot, sp<GraphicBuffer>* buf) {
     return NO_ERROR;
 }
 
+status_t BufferQueueProducer::requestBuffer(int slot, sp<GraphicBuffer>* buf) {
+    ATRACE_CALL();
+    std::lock_guard<std::mutex> lock(mCore->mMutex);
+    return requestBufferLocked(slot, buf);
+}
+
+status_t BufferQueueProducer::requestBuffers(const std::vector<int32_t>& slots,
+                                             std::vector<RequestBufferOutput>* outputs) {
+    ATRACE_CALL();
+    outputs->clear();
+    outputs->reserve(slots.size());
+    std::lock_guard<std::mutex> lock(mCore->mMutex);
+    for (int32_t slot : slots) {
+        RequestBufferOutput& output = outputs->emplace_back();
+        output.result = requestBufferLocked(static_cast<int>(slot), &output.buffer);
+    }
+    return NO_ERROR;
+}
+
 status_t BufferQueueProducer::setMaxDequeuedBufferCount(
         int maxDequeuedBuffers) {
     int maxBufferCount;
@@ -392,301 +409,456 @@ status_t BufferQueueProducer::waitForFreeSlotThenRelock(FreeSlotCaller caller,
     return NO_ERROR;
 }
 
-status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* outFence,
-                                            uint32_t width, uint32_t height, PixelFormat format,
-                                            uint64_t usage, uint64_t* outBufferAge,
-                                            FrameEventHistoryDelta* outTimestamps) {
-    ATRACE_CALL();
-    { // Autolock scope
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
-        mConsumerName = mCore->mConsumerName;
-
-        if (mCore->mIsAbandoned) {
-            BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
-            return NO_INIT;
-        }
-
-        if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
-            BQ_LOGE("dequeueBuffer: BufferQueue has no connected producer");
-            return NO_INIT;
-        }
-    } // Autolock scope
-
-    BQ_LOGV("dequeueBuffer: w=%u h=%u format=%#x, usage=%#" PRIx64, width, height, format, usage);
+// The state of a buffer being dequeued, carried from the part of the dequeue that holds
+// mCore->mMutex to the parts that allocate and wait without it.
+struct BufferQueueProducer::DequeuedBuffer {
+    int slot = BufferQueueCore::INVALID_BUFFER_SLOT;
+    sp<Fence> fence = Fence::NO_FENCE;
+    status_t returnFlags = NO_ERROR;
+    uint64_t bufferAge = 0;
 
-    if ((width && !height) || (!width && height)) {
-        BQ_LOGE("dequeueBuffer: invalid size: w=%u h=%u", width, height);
-        return BAD_VALUE;
-    }
+    // The attributes of the buffer, with the defaults of the BufferQueue applied.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    PixelFormat format = 0;
+    uint64_t usage = 0;
 
-    status_t returnFlags = NO_ERROR;
     EGLDisplay eglDisplay = EGL_NO_DISPLAY;
     EGLSyncKHR eglFence = EGL_NO_SYNC_KHR;
     bool attachedByConsumer = false;
 
-    sp<IConsumerListener> listener;
     bool callOnFrameDequeued = false;
     uint64_t bufferId = 0; // Only used if callOnFrameDequeued == true
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
     std::vector<gui::AdditionalOptions> allocOptions;
     uint32_t allocOptionsGenId = 0;
 #endif
+};
+
+status_t BufferQueueProducer::dequeueBufferLocked(std::unique_lock<std::mutex>& lock,
+                                                  bool waitForAllocation,
+                                                  DequeuedBuffer* outBuffer) {
+    // If we don't have a free buffer, but we are currently allocating, we wait until allocation
+    // is finished such that we don't allocate in parallel.
+    if (waitForAllocation && mCore->mFreeBuffers.empty() && mCore->mIsAllocating) {
+        mDequeueWaitingForAllocation = true;
+        mCore->waitWhileAllocatingLocked(lock);
+        mDequeueWaitingForAllocation = false;
+        mDequeueWaitingForAllocationCondition.notify_all();
+    }
 
-    { // Autolock scope
-        std::unique_lock<std::mutex> lock(mCore->mMutex);
+    uint32_t& width = outBuffer->width;
+    uint32_t& height = outBuffer->height;
+    PixelFormat& format = outBuffer->format;
+    uint64_t& usage = outBuffer->usage;
 
-        // If we don't have a free buffer, but we are currently allocating, we wait until allocation
-        // is finished such that we don't allocate in parallel.
-        if (mCore->mFreeBuffers.empty() && mCore->mIsAllocating) {
-            mDequeueWaitingForAllocation = true;
-            mCore->waitWhileAllocatingLocked(lock);
-            mDequeueWaitingForAllocation = false;
-            mDequeueWaitingForAllocationCondition.notify_all();
-        }
-
-        if (format == 0) {
-            format = mCore->mDefaultBufferFormat;
-        }
+    if (format == 0) {
+        format = mCore->mDefaultBufferFormat;
+    }
 
-        // Enable the usage bits the consumer requested
-        usage |= mCore->mConsumerUsageBits;
+    // Enable the usage bits the consumer requested
+    usage |= mCore->mConsumerUsageBits;
 
-        const bool useDefaultSize = !width && !height;
-        if (useDefaultSize) {
-            width = mCore->mDefaultWidth;
-            height = mCore->mDefaultHeight;
-            if (mCore->mAutoPrerotation &&
-                (mCore->mTransformHintInUse & NATIVE_WINDOW_TRANSFORM_ROT_90)) {
-                std::swap(width, height);
-            }
+    const bool useDefaultSize = !width && !height;
+    if (useDefaultSize) {
+        width = mCore->mDefaultWidth;
+        height = mCore->mDefaultHeight;
+        if (mCore->mAutoPrerotation &&
+            (mCore->mTransformHintInUse & NATIVE_WINDOW_TRANSFORM_ROT_90)) {
+            std::swap(width, height);
         }
+    }
 
-        int found = BufferItem::INVALID_BUFFER_SLOT;
-        while (found == BufferItem::INVALID_BUFFER_SLOT) {
-            status_t status = waitForFreeSlotThenRelock(FreeSlotCaller::Dequeue, lock, &found);
-            if (status != NO_ERROR) {
-                return status;
-            }
+    int found = BufferItem::INVALID_BUFFER_SLOT;
+    while (found == BufferItem::INVALID_BUFFER_SLOT) {
+        status_t status = waitForFreeSlotThenRelock(FreeSlotCaller::Dequeue, lock, &found);
+        if (status != NO_ERROR) {
+            return status;
+        }
 
-            // This should not happen
-            if (found == BufferQueueCore::INVALID_BUFFER_SLOT) {
-                BQ_LOGE("dequeueBuffer: no available buffer slots");
-                return -EBUSY;
-            }
+        // This should not happen
+        if (found == BufferQueueCore::INVALID_BUFFER_SLOT) {
+            BQ_LOGE("dequeueBuffer: no available buffer slots");
+            return -EBUSY;
+        }
 
-            const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
+        const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
 
-            // If we are not allowed to allocate new buffers,
-            // waitForFreeSlotThenRelock must have returned a slot containing a
-            // buffer. If this buffer would require reallocation to meet the
-            // requested attributes, we free it and attempt to get another one.
-            if (!mCore->mAllowAllocation) {
-                if (buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage)) {
-                    if (mCore->mSharedBufferSlot == found) {
-                        BQ_LOGE("dequeueBuffer: cannot re-allocate a sharedbuffer");
-                        return BAD_VALUE;
-                    }
-                    mCore->mFreeSlots.insert(found);
-                    mCore->clearBufferSlotLocked(found);
-                    found = BufferItem::INVALID_BUFFER_SLOT;
-                    continue;
+        // If we are not allowed to allocate new buffers,
+        // waitForFreeSlotThenRelock must have returned a slot containing a
+        // buffer. If this buffer would require reallocation to meet the
+        // requested attributes, we free it and attempt to get another one.
+        if (!mCore->mAllowAllocation) {
+            if (buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage)) {
+                if (mCore->mSharedBufferSlot == found) {
+                    BQ_LOGE("dequeueBuffer: cannot re-allocate a sharedbuffer");
+                    return BAD_VALUE;
                 }
+                mCore->mFreeSlots.insert(found);
+                mCore->clearBufferSlotLocked(found);
+                found = BufferItem::INVALID_BUFFER_SLOT;
+                continue;
             }
         }
+    }
 
-        const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
+    const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
 
-        bool needsReallocation = buffer == nullptr ||
-                buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage);
+    bool needsReallocation = buffer == nullptr ||
+            buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage);
 
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-        needsReallocation |= mSlots[found].mAdditionalOptionsGenerationId !=
-                mCore->mAdditionalOptionsGenerationId;
+    needsReallocation |= mSlots[found].mAdditionalOptionsGenerationId !=
+            mCore->mAdditionalOptionsGenerationId;
 #endif
 
-        if (mCore->mSharedBufferSlot == found && needsReallocation) {
-            BQ_LOGE("dequeueBuffer: cannot re-allocate a shared buffer");
-            return BAD_VALUE;
-        }
+    if (mCore->mSharedBufferSlot == found && needsReallocation) {
+        BQ_LOGE("dequeueBuffer: cannot re-allocate a shared buffer");
+        return BAD_VALUE;
+    }
 
-        if (mCore->mSharedBufferSlot != found) {
-            mCore->mActiveBuffers.insert(found);
-        }
-        *outSlot = found;
-        ATRACE_BUFFER_INDEX(found);
+    if (mCore->mSharedBufferSlot != found) {
+        mCore->mActiveBuffers.insert(found);
+    }
+    outBuffer->slot = found;
+    ATRACE_BUFFER_INDEX(found);
 
-        attachedByConsumer = mSlots[found].mNeedsReallocation;
-        mSlots[found].mNeedsReallocation = false;
+    outBuffer->attachedByConsumer = mSlots[found].mNeedsReallocation;
+    mSlots[found].mNeedsReallocation = false;
 
-        mSlots[found].mBufferState.dequeue();
+    mSlots[found].mBufferState.dequeue();
 
-        if (needsReallocation) {
-            if (CC_UNLIKELY(ATRACE_ENABLED())) {
-                if (buffer == nullptr) {
-                    ATRACE_FORMAT_INSTANT("%s buffer reallocation: null", mConsumerName.c_str());
-                } else {
-                    ATRACE_FORMAT_INSTANT("%s buffer reallocation actual %dx%d format:%d "
-                                          "layerCount:%d "
-                                          "usage:%d requested: %dx%d format:%d layerCount:%d "
-                                          "usage:%d ",
-                                          mConsumerName.c_str(), width, height, format,
-                                          BQ_LAYER_COUNT, usage, buffer->getWidth(),
-                                          buffer->getHeight(), buffer->getPixelFormat(),
-                                          buffer->getLayerCount(), buffer->getUsage());
-                }
+    if (needsReallocation) {
+        if (CC_UNLIKELY(ATRACE_ENABLED())) {
+            if (buffer == nullptr) {
+                ATRACE_FORMAT_INSTANT("%s buffer reallocation: null", mConsumerName.c_str());
+            } else {
+                ATRACE_FORMAT_INSTANT("%s buffer reallocation actual %dx%d format:%d "
+                                      "layerCount:%d "
+                                      "usage:%d requested: %dx%d format:%d layerCount:%d "
+                                      "usage:%d ",
+                                      mConsumerName.c_str(), width, height, format,
+                                      BQ_LAYER_COUNT, usage, buffer->getWidth(),
+                                      buffer->getHeight(), buffer->getPixelFormat(),
+                                      buffer->getLayerCount(), buffer->getUsage());
             }
-            mSlots[found].mAcquireCalled = false;
-            mSlots[found].mGraphicBuffer = nullptr;
-            mSlots[found].mRequestBufferCalled = false;
-            mSlots[found].mEglDisplay = EGL_NO_DISPLAY;
-            mSlots[found].mEglFence = EGL_NO_SYNC_KHR;
-            mSlots[found].mFence = Fence::NO_FENCE;
-            mCore->mBufferAge = 0;
-            mCore->mIsAllocating = true;
+        }
+        mSlots[found].mAcquireCalled = false;
+        mSlots[found].mGraphicBuffer = nullptr;
+        mSlots[found].mRequestBufferCalled = false;
+        mSlots[found].mEglDisplay = EGL_NO_DISPLAY;
+        mSlots[found].mEglFence = EGL_NO_SYNC_KHR;
+        mSlots[found].mFence = Fence::NO_FENCE;
+        mCore->mBufferAge = 0;
+        mCore->mIsAllocating = true;
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-            allocOptions = mCore->mAdditionalOptions;
-            allocOptionsGenId = mCore->mAdditionalOptionsGenerationId;
+        outBuffer->allocOptions = mCore->mAdditionalOptions;
+        outBuffer->allocOptionsGenId = mCore->mAdditionalOptionsGenerationId;
 #endif
 
-            returnFlags |= BUFFER_NEEDS_REALLOCATION;
-        } else {
-            // We add 1 because that will be the frame number when this buffer
-            // is queued
-            mCore->mBufferAge = mCore->mFrameCounter + 1 - mSlots[found].mFrameNumber;
-        }
+        outBuffer->returnFlags |= BUFFER_NEEDS_REALLOCATION;
+    } else {
+        // We add 1 because that will be the frame number when this buffer
+        // is queued
+        mCore->mBufferAge = mCore->mFrameCounter + 1 - mSlots[found].mFrameNumber;
+    }
+    outBuffer->bufferAge = mCore->mBufferAge;
 
-        BQ_LOGV("dequeueBuffer: setting buffer age to %" PRIu64,
-                mCore->mBufferAge);
+    BQ_LOGV("dequeueBuffer: setting buffer age to %" PRIu64,
+            mCore->mBufferAge);
 
-        if (CC_UNLIKELY(mSlots[found].mFence == nullptr)) {
-            BQ_LOGE("dequeueBuffer: about to return a NULL fence - "
-                    "slot=%d w=%d h=%d format=%u",
-                    found, buffer->width, buffer->height, buffer->format);
-        }
+    if (CC_UNLIKELY(mSlots[found].mFence == nullptr)) {
+        BQ_LOGE("dequeueBuffer: about to return a NULL fence - "
+                "slot=%d w=%d h=%d format=%u",
+                found, buffer->width, buffer->height, buffer->format);
+    }
 
-        eglDisplay = mSlots[found].mEglDisplay;
-        eglFence = mSlots[found].mEglFence;
-        // Don't return a fence in shared buffer mode, except for the first
-        // frame.
-        *outFence = (mCore->mSharedBufferMode &&
-                mCore->mSharedBufferSlot == found) ?
-                Fence::NO_FENCE : mSlots[found].mFence;
-        mSlots[found].mEglFence = EGL_NO_SYNC_KHR;
-        mSlots[found].mFence = Fence::NO_FENCE;
+    outBuffer->eglDisplay = mSlots[found].mEglDisplay;
+    outBuffer->eglFence = mSlots[found].mEglFence;
+    // Don't return a fence in shared buffer mode, except for the first
+    // frame.
+    outBuffer->fence = (mCore->mSharedBufferMode &&
+            mCore->mSharedBufferSlot == found) ?
+            Fence::NO_FENCE : mSlots[found].mFence;
+    mSlots[found].mEglFence = EGL_NO_SYNC_KHR;
+    mSlots[found].mFence = Fence::NO_FENCE;
+
+    // If shared buffer mode has just been enabled, cache the slot of the
+    // first buffer that is dequeued and mark it as the shared buffer.
+    if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
+            BufferQueueCore::INVALID_BUFFER_SLOT) {
+        mCore->mSharedBufferSlot = found;
+        mSlots[found].mBufferState.mShared = true;
+    }
+
+    if (!(outBuffer->returnFlags & BUFFER_NEEDS_REALLOCATION)) {
+        outBuffer->callOnFrameDequeued = true;
+        outBuffer->bufferId = mSlots[found].mGraphicBuffer->getId();
+    }
+    return NO_ERROR;
+}
+
+sp<GraphicBuffer> BufferQueueProducer::allocateDequeuedBuffer(
+        const DequeuedBuffer& dequeued) const {
+    BQ_LOGV("dequeueBuffer: allocating a new buffer for slot %d", dequeued.slot);
+
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+    std::vector<GraphicBufferAllocator::AdditionalOptions> tempOptions;
+    tempOptions.reserve(dequeued.allocOptions.size());
+    for (const auto& it : dequeued.allocOptions) {
+        tempOptions.emplace_back(it.name.c_str(), it.value);
+    }
+    const GraphicBufferAllocator::AllocationRequest allocRequest = {
+            .importBuffer = true,
+            .width = dequeued.width,
+            .height = dequeued.height,
+            .format = dequeued.format,
+            .layerCount = BQ_LAYER_COUNT,
+            .usage = dequeued.usage,
+            .requestorName = {mConsumerName.c_str(), mConsumerName.size()},
+            .extras = std::move(tempOptions),
+    };
+    return new GraphicBuffer(allocRequest);
+#else
+    return new GraphicBuffer(dequeued.width, dequeued.height, dequeued.format, BQ_LAYER_COUNT,
+                             dequeued.usage, {mConsumerName.c_str(), mConsumerName.size()});
+#endif
+}
+
+status_t BufferQueueProducer::attachAllocatedBufferLocked(
+        DequeuedBuffer* dequeued, const sp<GraphicBuffer>& graphicBuffer) {
+    status_t error = graphicBuffer->initCheck();
+    if (error == NO_ERROR && !mCore->mIsAbandoned) {
+        graphicBuffer->setGenerationNumber(mCore->mGenerationNumber);
+        mSlots[dequeued->slot].mGraphicBuffer = graphicBuffer;
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+        mSlots[dequeued->slot].mAdditionalOptionsGenerationId = dequeued->allocOptionsGenId;
+#endif
+        dequeued->callOnFrameDequeued = true;
+        dequeued->bufferId = mSlots[dequeued->slot].mGraphicBuffer->getId();
+    }
+
+    if (error != NO_ERROR) {
+        mCore->mFreeSlots.insert(dequeued->slot);
+        mCore->clearBufferSlotLocked(dequeued->slot);
+        BQ_LOGE("dequeueBuffer: createGraphicBuffer failed");
+        return error;
+    }
+
+    if (mCore->mIsAbandoned) {
+        mCore->mFreeSlots.insert(dequeued->slot);
+        mCore->clearBufferSlotLocked(dequeued->slot);
+        BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
+        return NO_INIT;
+    }
+    return NO_ERROR;
+}
+
+void BufferQueueProducer::finishDequeue(DequeuedBuffer* dequeued) {
+    if (dequeued->attachedByConsumer) {
+        dequeued->returnFlags |= BUFFER_NEEDS_REALLOCATION;
+    }
 
-        // If shared buffer mode has just been enabled, cache the slot of the
-        // first buffer that is dequeued and mark it as the shared buffer.
-        if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
-                BufferQueueCore::INVALID_BUFFER_SLOT) {
-            mCore->mSharedBufferSlot = found;
-            mSlots[found].mBufferState.mShared = true;
+    if (dequeued->eglFence != EGL_NO_SYNC_KHR) {
+        EGLint result = eglClientWaitSyncKHR(dequeued->eglDisplay, dequeued->eglFence, 0,
+                1000000000);
+        // If something goes wrong, log the error, but return the buffer without
+        // synchronizing access to it. It's too late at this point to abort the
+        // dequeue operation.
+        if (result == EGL_FALSE) {
+            BQ_LOGE("dequeueBuffer: error %#x waiting for fence",
+                    eglGetError());
+        } else if (result == EGL_TIMEOUT_EXPIRED_KHR) {
+            BQ_LOGE("dequeueBuffer: timeout waiting for fence");
         }
+        eglDestroySyncKHR(dequeued->eglDisplay, dequeued->eglFence);
+    }
+
+    BQ_LOGV("dequeueBuffer: returning slot=%d/%" PRIu64 " buf=%p flags=%#x",
+            dequeued->slot,
+            mSlots[dequeued->slot].mFrameNumber,
+            mSlots[dequeued->slot].mGraphicBuffer != nullptr ?
+            mSlots[dequeued->slot].mGraphicBuffer->handle : nullptr, dequeued->returnFlags);
+}
+
+status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* outFence,
+                                            uint32_t width, uint32_t height, PixelFormat format,
+                                            uint64_t usage, uint64_t* outBufferAge,
+                                            FrameEventHistoryDelta* outTimestamps) {
+    ATRACE_CALL();
+    { // Autolock scope
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        mConsumerName = mCore->mConsumerName;
 
-        if (!(returnFlags & BUFFER_NEEDS_REALLOCATION)) {
-            callOnFrameDequeued = true;
-            bufferId = mSlots[*outSlot].mGraphicBuffer->getId();
+        if (mCore->mIsAbandoned) {
+            BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
+            return NO_INIT;
         }
 
-        listener = mCore->mConsumerListener;
+        if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
+            BQ_LOGE("dequeueBuffer: BufferQueue has no connected producer");
+            return NO_INIT;
+        }
     } // Autolock scope
 
-    if (returnFlags & BUFFER_NEEDS_REALLOCATION) {
-        BQ_LOGV("dequeueBuffer: allocating a new buffer for slot %d", *outSlot);
+    BQ_LOGV("dequeueBuffer: w=%u h=%u format=%#x, usage=%#" PRIx64, width, height, format, usage);
 
-#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-        std::vector<GraphicBufferAllocator::AdditionalOptions> tempOptions;
-        tempOptions.reserve(allocOptions.size());
-        for (const auto& it : allocOptions) {
-            tempOptions.emplace_back(it.name.c_str(), it.value);
+    if ((width && !height) || (!width && height)) {
+        BQ_LOGE("dequeueBuffer: invalid size: w=%u h=%u", width, height);
+        return BAD_VALUE;
+    }
+
+    DequeuedBuffer dequeued{.width = width, .height = height, .format = format, .usage = usage};
+    sp<IConsumerListener> listener;
+
+    { // Autolock scope
+        std::unique_lock<std::mutex> lock(mCore->mMutex);
+        status_t status = dequeueBufferLocked(lock, /*waitForAllocation*/ true, &dequeued);
+        if (status != NO_ERROR) {
+            return status;
         }
-        const GraphicBufferAllocator::AllocationRequest allocRequest = {
-                .importBuffer = true,
-                .width = width,
-                .height = height,
-                .format = format,
-                .layerCount = BQ_LAYER_COUNT,
-                .usage = usage,
-                .requestorName = {mConsumerName.c_str(), mConsumerName.size()},
-                .extras = std::move(tempOptions),
-        };
-        sp<GraphicBuffer> graphicBuffer = new GraphicBuffer(allocRequest);
-#else
-        sp<GraphicBuffer> graphicBuffer =
-                new GraphicBuffer(width, height, format, BQ_LAYER_COUNT, usage,
-                                  {mConsumerName.c_str(), mConsumerName.size()});
-#endif
+        *outSlot = dequeued.slot;
+        listener = mCore->mConsumerListener;
+    } // Autolock scope
 
-        status_t error = graphicBuffer->initCheck();
+    if (dequeued.returnFlags & BUFFER_NEEDS_REALLOCATION) {
+        sp<GraphicBuffer> graphicBuffer = allocateDequeuedBuffer(dequeued);
 
         { // Autolock scope
             std::lock_guard<std::mutex> lock(mCore->mMutex);
-
-            if (error == NO_ERROR && !mCore->mIsAbandoned) {
-                graphicBuffer->setGenerationNumber(mCore->mGenerationNumber);
-                mSlots[*outSlot].mGraphicBuffer = graphicBuffer;
-#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-                mSlots[*outSlot].mAdditionalOptionsGenerationId = allocOptionsGenId;
-#endif
-                callOnFrameDequeued = true;
-                bufferId = mSlots[*outSlot].mGraphicBuffer->getId();
-            }
+            status_t error = attachAllocatedBufferLocked(&dequeued, graphicBuffer);
 
             mCore->mIsAllocating = false;
             mCore->mIsAllocatingCondition.notify_all();
 
             if (error != NO_ERROR) {
-                mCore->mFreeSlots.insert(*outSlot);
-                mCore->clearBufferSlotLocked(*outSlot);
-                BQ_LOGE("dequeueBuffer: createGraphicBuffer failed");
                 return error;
             }
 
-            if (mCore->mIsAbandoned) {
-                mCore->mFreeSlots.insert(*outSlot);
-                mCore->clearBufferSlotLocked(*outSlot);
-                BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
-                return NO_INIT;
-            }
-
             VALIDATE_CONSISTENCY();
         } // Autolock scope
     }
 
-    if (listener != nullptr && callOnFrameDequeued) {
-        listener->onFrameDequeued(bufferId);
+    if (listener != nullptr && dequeued.callOnFrameDequeued) {
+        listener->onFrameDequeued(dequeued.bufferId);
     }
 
-    if (attachedByConsumer) {
-        returnFlags |= BUFFER_NEEDS_REALLOCATION;
+    finishDequeue(&dequeued);
+
+    *outFence = dequeued.fence;
+    if (outBufferAge) {
+        *outBufferAge = dequeued.bufferAge;
     }
+    addAndGetFrameTimestamps(nullptr, outTimestamps);
 
-    if (eglFence != EGL_NO_SYNC_KHR) {
-        EGLint result = eglClientWaitSyncKHR(eglDisplay, eglFence, 0,
-                1000000000);
-        // If something goes wrong, log the error, but return the buffer without
-        // synchronizing access to it. It's too late at this point to abort the
-        // dequeue operation.
-        if (result == EGL_FALSE) {
-            BQ_LOGE("dequeueBuffer: error %#x waiting for fence",
-                    eglGetError());
-        } else if (result == EGL_TIMEOUT_EXPIRED_KHR) {
-            BQ_LOGE("dequeueBuffer: timeout waiting for fence");
+    return dequeued.returnFlags;
+}
+
+status_t BufferQueueProducer::dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                                             std::vector<DequeueBufferOutput>* outputs) {
+    ATRACE_CALL();
+    outputs->clear();
+    outputs->resize(inputs.size());
+
+    std::vector<DequeuedBuffer> dequeued(inputs.size());
+    sp<IConsumerListener> listener;
+    bool allocating = false;
+
+    { // Autolock scope
+        std::unique_lock<std::mutex> lock(mCore->mMutex);
+        mConsumerName = mCore->mConsumerName;
+
+        for (size_t i = 0; i < inputs.size(); i++) {
+            const DequeueBufferInput& input = inputs[i];
+            DequeueBufferOutput& output = (*outputs)[i];
+
+            if (mCore->mIsAbandoned) {
+                BQ_LOGE("dequeueBuffers: BufferQueue has been abandoned");
+                output.result = NO_INIT;
+                continue;
+            }
+
+            if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
+                BQ_LOGE("dequeueBuffers: BufferQueue has no connected producer");
+                output.result = NO_INIT;
+                continue;
+            }
+
+            if ((input.width && !input.height) || (!input.width && input.height)) {
+                BQ_LOGE("dequeueBuffers: invalid size: w=%u h=%u", input.width, input.height);
+                output.result = BAD_VALUE;
+                continue;
+            }
+
+            dequeued[i].width = input.width;
+            dequeued[i].height = input.height;
+            dequeued[i].format = input.format;
+            dequeued[i].usage = input.usage;
+            // The reallocations of this batch happen after its slots are dequeued, so only wait
+            // for allocations made by others.
+            output.result = dequeueBufferLocked(lock, /*waitForAllocation*/ !allocating,
+                                                &dequeued[i]);
+            if (output.result != NO_ERROR) {
+                dequeued[i].slot = BufferQueueCore::INVALID_BUFFER_SLOT;
+                continue;
+            }
+            if (dequeued[i].returnFlags & BUFFER_NEEDS_REALLOCATION) {
+                allocating = true;
+            }
+        }
+        listener = mCore->mConsumerListener;
+    } // Autolock scope
+
+    if (allocating) {
+        std::vector<sp<GraphicBuffer>> graphicBuffers(inputs.size());
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (dequeued[i].slot != BufferQueueCore::INVALID_BUFFER_SLOT &&
+                (dequeued[i].returnFlags & BUFFER_NEEDS_REALLOCATION)) {
+                graphicBuffers[i] = allocateDequeuedBuffer(dequeued[i]);
+            }
         }
-        eglDestroySyncKHR(eglDisplay, eglFence);
+
+        { // Autolock scope
+            std::lock_guard<std::mutex> lock(mCore->mMutex);
+            for (size_t i = 0; i < inputs.size(); i++) {
+                if (graphicBuffers[i] == nullptr) {
+                    continue;
+                }
+                status_t error = attachAllocatedBufferLocked(&dequeued[i], graphicBuffers[i]);
+                if (error != NO_ERROR) {
+                    (*outputs)[i].result = error;
+                    dequeued[i].slot = BufferQueueCore::INVALID_BUFFER_SLOT;
+                }
+            }
+
+            mCore->mIsAllocating = false;
+            mCore->mIsAllocatingCondition.notify_all();
+
+            VALIDATE_CONSISTENCY();
+        } // Autolock scope
     }
 
-    BQ_LOGV("dequeueBuffer: returning slot=%d/%" PRIu64 " buf=%p flags=%#x",
-            *outSlot,
-            mSlots[*outSlot].mFrameNumber,
-            mSlots[*outSlot].mGraphicBuffer != nullptr ?
-            mSlots[*outSlot].mGraphicBuffer->handle : nullptr, returnFlags);
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (dequeued[i].slot == BufferQueueCore::INVALID_BUFFER_SLOT) {
+            continue;
+        }
+        if (listener != nullptr && dequeued[i].callOnFrameDequeued) {
+            listener->onFrameDequeued(dequeued[i].bufferId);
+        }
 
-    if (outBufferAge) {
-        *outBufferAge = mCore->mBufferAge;
+        finishDequeue(&dequeued[i]);
+
+        DequeueBufferOutput& output = (*outputs)[i];
+        output.result = dequeued[i].returnFlags;
+        output.slot = dequeued[i].slot;
+        output.fence = dequeued[i].fence;
+        output.bufferAge = dequeued[i].bufferAge;
+        if (inputs[i].getTimestamps) {
+            addAndGetFrameTimestamps(nullptr, &output.timestamps.emplace());
+        }
     }
-    addAndGetFrameTimestamps(nullptr, outTimestamps);
 
-    return returnFlags;
+    return NO_ERROR;
 }
 
 status_t BufferQueueProducer::detachBuffer(int slot) {
@@ -796,7 +968,7 @@ status_t BufferQueueProducer::detachNextBuffer(sp<GraphicBuffer>* outBuffer,
         }
 
         int found = mCore->mFreeBuffers.front();
-        mCore->mFreeBuffers.remove(found);
+        mCore->mFreeBuffers.pop_front();
         mCore->mFreeSlots.insert(found);
 
         BQ_LOGV("detachNextBuffer detached slot %d", found);
@@ -884,11 +1056,22 @@ status_t BufferQueueProducer::attachBuffer(int* outSlot,
     return returnFlags;
 }
 
-status_t BufferQueueProducer::queueBuffer(int slot,
-        const QueueBufferInput &input, QueueBufferOutput *output) {
-    ATRACE_CALL();
-    ATRACE_BUFFER_INDEX(slot);
+// A frame queued while holding mCore->mMutex, and the callbacks to make for it once the lock is
+// released.
+struct BufferQueueProducer::QueuedFrame {
+    BufferItem item;
+    QueueBufferOutput* output = nullptr;
+    bool getFrameTimestamps = false;
+    NewFrameEventsEntry frameEvents;
+    sp<IConsumerListener> frameAvailableListener;
+    sp<IConsumerListener> frameReplacedListener;
+    sp<Fence> lastQueuedFence;
+    bool throttleEgl = false;
+};
 
+status_t BufferQueueProducer::queueBufferLocked(int slot, const QueueBufferInput& input,
+                                                QueueBufferOutput* output,
+                                                QueuedFrame* outFrame) {
     int64_t requestedPresentTimestamp;
     bool isAutoTimestamp;
     android_dataspace dataSpace;
@@ -909,8 +1092,6 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         return BAD_VALUE;
     }
 
-    auto acquireFenceTime = std::make_shared<FenceTime>(acquireFence);
-
     switch (scalingMode) {
         case NATIVE_WINDOW_SCALING_MODE_FREEZE:
         case NATIVE_WINDOW_SCALING_MODE_SCALE_TO_WINDOW:
@@ -922,213 +1103,210 @@ status_t BufferQueueProducer::queueBuffer(int slot,
             return BAD_VALUE;
     }
 
-    sp<IConsumerListener> frameAvailableListener;
-    sp<IConsumerListener> frameReplacedListener;
-    int callbackTicket = 0;
-    uint64_t currentFrameNumber = 0;
-    BufferItem item;
-    int connectedApi;
-    bool enableEglCpuThrottling = true;
-    sp<Fence> lastQueuedFence;
-
-    { // Autolock scope
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
+    if (mCore->mIsAbandoned) {
+        BQ_LOGE("queueBuffer: BufferQueue has been abandoned");
+        return NO_INIT;
+    }
 
-        if (mCore->mIsAbandoned) {
-            BQ_LOGE("queueBuffer: BufferQueue has been abandoned");
-            return NO_INIT;
-        }
+    if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
+        BQ_LOGE("queueBuffer: BufferQueue has no connected producer");
+        return NO_INIT;
+    }
 
-        if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
-            BQ_LOGE("queueBuffer: BufferQueue has no connected producer");
-            return NO_INIT;
-        }
+    if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS) {
+        BQ_LOGE("queueBuffer: slot index %d out of range [0, %d)",
+                slot, BufferQueueDefs::NUM_BUFFER_SLOTS);
+        return BAD_VALUE;
+    } else if (!mSlots[slot].mBufferState.isDequeued()) {
+        BQ_LOGE("queueBuffer: slot %d is not owned by the producer "
+                "(state = %s)", slot, mSlots[slot].mBufferState.string());
+        return BAD_VALUE;
+    } else if (!mSlots[slot].mRequestBufferCalled) {
+        BQ_LOGE("queueBuffer: slot %d was queued without requesting "
+                "a buffer", slot);
+        return BAD_VALUE;
+    }
 
-        if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS) {
-            BQ_LOGE("queueBuffer: slot index %d out of range [0, %d)",
-                    slot, BufferQueueDefs::NUM_BUFFER_SLOTS);
-            return BAD_VALUE;
-        } else if (!mSlots[slot].mBufferState.isDequeued()) {
-            BQ_LOGE("queueBuffer: slot %d is not owned by the producer "
-                    "(state = %s)", slot, mSlots[slot].mBufferState.string());
-            return BAD_VALUE;
-        } else if (!mSlots[slot].mRequestBufferCalled) {
-            BQ_LOGE("queueBuffer: slot %d was queued without requesting "
-                    "a buffer", slot);
-            return BAD_VALUE;
-        }
+    // If shared buffer mode has just been enabled, cache the slot of the
+    // first buffer that is queued and mark it as the shared buffer.
+    if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
+            BufferQueueCore::INVALID_BUFFER_SLOT) {
+        mCore->mSharedBufferSlot = slot;
+        mSlots[slot].mBufferState.mShared = true;
+    }
 
-        // If shared buffer mode has just been enabled, cache the slot of the
-        // first buffer that is queued and mark it as the shared buffer.
-        if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
-                BufferQueueCore::INVALID_BUFFER_SLOT) {
-            mCore->mSharedBufferSlot = slot;
-            mSlots[slot].mBufferState.mShared = true;
-        }
+    BQ_LOGV("queueBuffer: slot=%d/%" PRIu64 " time=%" PRIu64 " dataSpace=%d"
+            " validHdrMetadataTypes=0x%x crop=[%d,%d,%d,%d] transform=%#x scale=%s",
+            slot, mCore->mFrameCounter + 1, requestedPresentTimestamp, dataSpace,
+            hdrMetadata.validTypes, crop.left, crop.top, crop.right, crop.bottom,
+            transform,
+            BufferItem::scalingModeName(static_cast<uint32_t>(scalingMode)));
+
+    const sp<GraphicBuffer>& graphicBuffer(mSlots[slot].mGraphicBuffer);
+    Rect bufferRect(graphicBuffer->getWidth(), graphicBuffer->getHeight());
+    Rect croppedRect(Rect::EMPTY_RECT);
+    crop.intersect(bufferRect, &croppedRect);
+    if (croppedRect != crop) {
+        BQ_LOGE("queueBuffer: crop rect is not contained within the "
+                "buffer in slot %d", slot);
+        return BAD_VALUE;
+    }
 
-        BQ_LOGV("queueBuffer: slot=%d/%" PRIu64 " time=%" PRIu64 " dataSpace=%d"
-                " validHdrMetadataTypes=0x%x crop=[%d,%d,%d,%d] transform=%#x scale=%s",
-                slot, mCore->mFrameCounter + 1, requestedPresentTimestamp, dataSpace,
-                hdrMetadata.validTypes, crop.left, crop.top, crop.right, crop.bottom,
-                transform,
-                BufferItem::scalingModeName(static_cast<uint32_t>(scalingMode)));
-
-        const sp<GraphicBuffer>& graphicBuffer(mSlots[slot].mGraphicBuffer);
-        Rect bufferRect(graphicBuffer->getWidth(), graphicBuffer->getHeight());
-        Rect croppedRect(Rect::EMPTY_RECT);
-        crop.intersect(bufferRect, &croppedRect);
-        if (croppedRect != crop) {
-            BQ_LOGE("queueBuffer: crop rect is not contained within the "
-                    "buffer in slot %d", slot);
-            return BAD_VALUE;
-        }
+    // Override UNKNOWN dataspace with consumer default
+    if (dataSpace == HAL_DATASPACE_UNKNOWN) {
+        dataSpace = mCore->mDefaultBufferDataSpace;
+    }
 
-        // Override UNKNOWN dataspace with consumer default
-        if (dataSpace == HAL_DATASPACE_UNKNOWN) {
-            dataSpace = mCore->mDefaultBufferDataSpace;
-        }
+    auto acquireFenceTime = std::make_shared<FenceTime>(acquireFence);
 
-        mSlots[slot].mFence = acquireFence;
-        mSlots[slot].mBufferState.queue();
-
-        // Increment the frame counter and store a local version of it
-        // for use outside the lock on mCore->mMutex.
-        ++mCore->mFrameCounter;
-        currentFrameNumber = mCore->mFrameCounter;
-        mSlots[slot].mFrameNumber = currentFrameNumber;
-
-        item.mAcquireCalled = mSlots[slot].mAcquireCalled;
-        item.mGraphicBuffer = mSlots[slot].mGraphicBuffer;
-        item.mCrop = crop;
-        item.mTransform = transform &
-                ~static_cast<uint32_t>(NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY);
-        item.mTransformToDisplayInverse =
-                (transform & NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY) != 0;
-        item.mScalingMode = static_cast<uint32_t>(scalingMode);
-        item.mTimestamp = requestedPresentTimestamp;
-        item.mIsAutoTimestamp = isAutoTimestamp;
-        item.mDataSpace = dataSpace;
-        item.mHdrMetadata = hdrMetadata;
-        item.mFrameNumber = currentFrameNumber;
-        item.mSlot = slot;
-        item.mFence = acquireFence;
-        item.mFenceTime = acquireFenceTime;
-        item.mIsDroppable = mCore->mAsyncMode ||
-                (mConsumerIsSurfaceFlinger && mCore->mQueueBufferCanDrop) ||
-                (mCore->mLegacyBufferDrop && mCore->mQueueBufferCanDrop) ||
-                (mCore->mSharedBufferMode && mCore->mSharedBufferSlot == slot);
-        item.mSurfaceDamage = surfaceDamage;
-        item.mQueuedBuffer = true;
-        item.mAutoRefresh = mCore->mSharedBufferMode && mCore->mAutoRefresh;
-        item.mApi = mCore->mConnectedApi;
-
-        mStickyTransform = stickyTransform;
-
-        // Cache the shared buffer data so that the BufferItem can be recreated.
-        if (mCore->mSharedBufferMode) {
-            mCore->mSharedBufferCache.crop = crop;
-            mCore->mSharedBufferCache.transform = transform;
-            mCore->mSharedBufferCache.scalingMode = static_cast<uint32_t>(
-                    scalingMode);
-            mCore->mSharedBufferCache.dataspace = dataSpace;
-        }
+    mSlots[slot].mFence = acquireFence;
+    mSlots[slot].mBufferState.queue();
+
+    // Increment the frame counter and store a local version of it
+    // for use outside the lock on mCore->mMutex.
+    ++mCore->mFrameCounter;
+    const uint64_t currentFrameNumber = mCore->mFrameCounter;
+    mSlots[slot].mFrameNumber = currentFrameNumber;
+
+    BufferItem& item = outFrame->item;
+    item.mAcquireCalled = mSlots[slot].mAcquireCalled;
+    item.mGraphicBuffer = mSlots[slot].mGraphicBuffer;
+    item.mCrop = crop;
+    item.mTransform = transform &
+            ~static_cast<uint32_t>(NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY);
+    item.mTransformToDisplayInverse =
+            (transform & NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY) != 0;
+    item.mScalingMode = static_cast<uint32_t>(scalingMode);
+    item.mTimestamp = requestedPresentTimestamp;
+    item.mIsAutoTimestamp = isAutoTimestamp;
+    item.mDataSpace = dataSpace;
+    item.mHdrMetadata = hdrMetadata;
+    item.mFrameNumber = currentFrameNumber;
+    item.mSlot = slot;
+    item.mFence = acquireFence;
+    item.mFenceTime = acquireFenceTime;
+    item.mIsDroppable = mCore->mAsyncMode ||
+            (mConsumerIsSurfaceFlinger && mCore->mQueueBufferCanDrop) ||
+            (mCore->mLegacyBufferDrop && mCore->mQueueBufferCanDrop) ||
+            (mCore->mSharedBufferMode && mCore->mSharedBufferSlot == slot);
+    item.mSurfaceDamage = surfaceDamage;
+    item.mQueuedBuffer = true;
+    item.mAutoRefresh = mCore->mSharedBufferMode && mCore->mAutoRefresh;
+    item.mApi = mCore->mConnectedApi;
+
+    mStickyTransform = stickyTransform;
+
+    // Cache the shared buffer data so that the BufferItem can be recreated.
+    if (mCore->mSharedBufferMode) {
+        mCore->mSharedBufferCache.crop = crop;
+        mCore->mSharedBufferCache.transform = transform;
+        mCore->mSharedBufferCache.scalingMode = static_cast<uint32_t>(
+                scalingMode);
+        mCore->mSharedBufferCache.dataspace = dataSpace;
+    }
 
-        output->bufferReplaced = false;
-        if (mCore->mQueue.empty()) {
-            // When the queue is empty, we can ignore mDequeueBufferCannotBlock
-            // and simply queue this buffer
-            mCore->mQueue.push_back(item);
-            frameAvailableListener = mCore->mConsumerListener;
-        } else {
-            // When the queue is not empty, we need to look at the last buffer
-            // in the queue to see if we need to replace it
-            const BufferItem& last = mCore->mQueue.itemAt(
-                    mCore->mQueue.size() - 1);
-            if (last.mIsDroppable) {
-
-                if (!last.mIsStale) {
-                    mSlots[last.mSlot].mBufferState.freeQueued();
-
-                    // After leaving shared buffer mode, the shared buffer will
-                    // still be around. Mark it as no longer shared if this
-                    // operation causes it to be free.
-                    if (!mCore->mSharedBufferMode &&
-                            mSlots[last.mSlot].mBufferState.isFree()) {
-                        mSlots[last.mSlot].mBufferState.mShared = false;
-                    }
-                    // Don't put the shared buffer on the free list.
-                    if (!mSlots[last.mSlot].mBufferState.isShared()) {
-                        mCore->mActiveBuffers.erase(last.mSlot);
-                        mCore->mFreeBuffers.push_back(last.mSlot);
-                        output->bufferReplaced = true;
-                    }
+    output->bufferReplaced = false;
+    if (mCore->mQueue.empty()) {
+        // When the queue is empty, we can ignore mDequeueBufferCannotBlock
+        // and simply queue this buffer
+        mCore->mQueue.push_back(item);
+        outFrame->frameAvailableListener = mCore->mConsumerListener;
+    } else {
+        // When the queue is not empty, we need to look at the last buffer
+        // in the queue to see if we need to replace it
+        const BufferItem& last = mCore->mQueue.itemAt(
+                mCore->mQueue.size() - 1);
+        if (last.mIsDroppable) {
+
+            if (!last.mIsStale) {
+                mSlots[last.mSlot].mBufferState.freeQueued();
+
+                // After leaving shared buffer mode, the shared buffer will
+                // still be around. Mark it as no longer shared if this
+                // operation causes it to be free.
+                if (!mCore->mSharedBufferMode &&
+                        mSlots[last.mSlot].mBufferState.isFree()) {
+                    mSlots[last.mSlot].mBufferState.mShared = false;
                 }
-
-                // Make sure to merge the damage rect from the frame we're about
-                // to drop into the new frame's damage rect.
-                if (last.mSurfaceDamage.bounds() == Rect::INVALID_RECT ||
-                    item.mSurfaceDamage.bounds() == Rect::INVALID_RECT) {
-                    item.mSurfaceDamage = Region::INVALID_REGION;
-                } else {
-                    item.mSurfaceDamage |= last.mSurfaceDamage;
+                // Don't put the shared buffer on the free list.
+                if (!mSlots[last.mSlot].mBufferState.isShared()) {
+                    mCore->mActiveBuffers.erase(last.mSlot);
+                    mCore->mFreeBuffers.push_back(last.mSlot);
+                    output->bufferReplaced = true;
                 }
+            }
 
-                // Overwrite the droppable buffer with the incoming one
-                mCore->mQueue.editItemAt(mCore->mQueue.size() - 1) = item;
-                frameReplacedListener = mCore->mConsumerListener;
+            // Make sure to merge the damage rect from the frame we're about
+            // to drop into the new frame's damage rect.
+            if (last.mSurfaceDamage.bounds() == Rect::INVALID_RECT ||
+                item.mSurfaceDamage.bounds() == Rect::INVALID_RECT) {
+                item.mSurfaceDamage = Region::INVALID_REGION;
             } else {
-                mCore->mQueue.push_back(item);
-                frameAvailableListener = mCore->mConsumerListener;
+                item.mSurfaceDamage |= last.mSurfaceDamage;
             }
+
+            // Overwrite the droppable buffer with the incoming one
+            mCore->mQueue.editItemAt(mCore->mQueue.size() - 1) = item;
+            outFrame->frameReplacedListener = mCore->mConsumerListener;
+        } else {
+            mCore->mQueue.push_back(item);
+            outFrame->frameAvailableListener = mCore->mConsumerListener;
         }
+    }
 
-        mCore->mBufferHasBeenQueued = true;
-        mCore->mDequeueCondition.notify_all();
-        mCore->mLastQueuedSlot = slot;
+    mCore->mBufferHasBeenQueued = true;
+    mCore->mLastQueuedSlot = slot;
 
-        output->width = mCore->mDefaultWidth;
-        output->height = mCore->mDefaultHeight;
-        output->transformHint = mCore->mTransformHintInUse = mCore->mTransformHint;
-        output->numPendingBuffers = static_cast<uint32_t>(mCore->mQueue.size());
-        output->nextFrameNumber = mCore->mFrameCounter + 1;
+    output->width = mCore->mDefaultWidth;
+    output->height = mCore->mDefaultHeight;
+    output->transformHint = mCore->mTransformHintInUse = mCore->mTransformHint;
+    output->numPendingBuffers = static_cast<uint32_t>(mCore->mQueue.size());
+    output->nextFrameNumber = mCore->mFrameCounter + 1;
 
-        ATRACE_INT(mCore->mConsumerName.c_str(), static_cast<int32_t>(mCore->mQueue.size()));
+    ATRACE_INT(mCore->mConsumerName.c_str(), static_cast<int32_t>(mCore->mQueue.size()));
 #ifndef NO_BINDER
-        mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
+    mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
 #endif
-        // Take a ticket for the callback functions
-        callbackTicket = mNextCallbackTicket++;
 
-        VALIDATE_CONSISTENCY();
+    VALIDATE_CONSISTENCY();
 
-        connectedApi = mCore->mConnectedApi;
-        if (flags::bq_producer_throttles_only_async_mode()) {
-            enableEglCpuThrottling = mCore->mAsyncMode || mCore->mDequeueBufferCannotBlock;
-        }
-        lastQueuedFence = std::move(mLastQueueBufferFence);
+    bool enableEglCpuThrottling = true;
+    if (flags::bq_producer_throttles_only_async_mode()) {
+        enableEglCpuThrottling = mCore->mAsyncMode || mCore->mDequeueBufferCannotBlock;
+    }
+    outFrame->throttleEgl =
+            mCore->mConnectedApi == NATIVE_WINDOW_API_EGL && enableEglCpuThrottling;
+    outFrame->lastQueuedFence = std::move(mLastQueueBufferFence);
+
+    mLastQueueBufferFence = std::move(acquireFence);
+    mLastQueuedCrop = item.mCrop;
+    mLastQueuedTransform = item.mTransform;
+
+    outFrame->output = output;
+    outFrame->getFrameTimestamps = getFrameTimestamps;
+    outFrame->frameEvents = {.frameNumber = currentFrameNumber,
+                             .requestedPresentTime = requestedPresentTimestamp,
+                             .acquireFence = std::move(acquireFenceTime)};
+    return NO_ERROR;
+}
 
-        mLastQueueBufferFence = std::move(acquireFence);
-        mLastQueuedCrop = item.mCrop;
-        mLastQueuedTransform = item.mTransform;
-    } // Autolock scope
+void BufferQueueProducer::onFramesQueued(int callbackTicket, QueuedFrame* frames,
+                                         size_t frameCount) {
+    for (size_t i = 0; i < frameCount; i++) {
+        QueuedFrame& frame = frames[i];
 
-    // It is okay not to clear the GraphicBuffer when the consumer is SurfaceFlinger because
-    // it is guaranteed that the BufferQueue is inside SurfaceFlinger's process and
-    // there will be no Binder call
-    if (!mConsumerIsSurfaceFlinger) {
-        item.mGraphicBuffer.clear();
-    }
+        // It is okay not to clear the GraphicBuffer when the consumer is SurfaceFlinger because
+        // it is guaranteed that the BufferQueue is inside SurfaceFlinger's process and
+        // there will be no Binder call
+        if (!mConsumerIsSurfaceFlinger) {
+            frame.item.mGraphicBuffer.clear();
+        }
 
-    // Update and get FrameEventHistory.
-    nsecs_t postedTime = systemTime(SYSTEM_TIME_MONOTONIC);
-    NewFrameEventsEntry newFrameEventsEntry = {
-        currentFrameNumber,
-        postedTime,
-        requestedPresentTimestamp,
-        std::move(acquireFenceTime)
-    };
-    addAndGetFrameTimestamps(&newFrameEventsEntry,
-            getFrameTimestamps ? &output->frameTimestamps : nullptr);
+        // Update and get FrameEventHistory.
+        frame.frameEvents.postedTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        addAndGetFrameTimestamps(&frame.frameEvents,
+                frame.getFrameTimestamps ? &frame.output->frameTimestamps : nullptr);
+    }
 
     // Call back without the main BufferQueue lock held, but with the callback
     // lock held so we can ensure that callbacks occur in order
@@ -1139,10 +1317,13 @@ status_t BufferQueueProducer::queueBuffer(int slot,
             mCallbackCondition.wait(lock);
         }
 
-        if (frameAvailableListener != nullptr) {
-            frameAvailableListener->onFrameAvailable(item);
-        } else if (frameReplacedListener != nullptr) {
-            frameReplacedListener->onFrameReplaced(item);
+        for (size_t i = 0; i < frameCount; i++) {
+            const QueuedFrame& frame = frames[i];
+            if (frame.frameAvailableListener != nullptr) {
+                frame.frameAvailableListener->onFrameAvailable(frame.item);
+            } else if (frame.frameReplacedListener != nullptr) {
+                frame.frameReplacedListener->onFrameReplaced(frame.item);
+            }
         }
 
         ++mCurrentCallbackTicket;
@@ -1150,82 +1331,178 @@ status_t BufferQueueProducer::queueBuffer(int slot,
     }
 
     // Wait without lock held
-    if (connectedApi == NATIVE_WINDOW_API_EGL && enableEglCpuThrottling) {
-        // Waiting here allows for two full buffers to be queued but not a
-        // third. In the event that frames take varying time, this makes a
-        // small trade-off in favor of latency rather than throughput.
-        lastQueuedFence->waitForever("Throttling EGL Production");
+    for (size_t i = 0; i < frameCount; i++) {
+        if (frames[i].throttleEgl) {
+            // Waiting here allows for two full buffers to be queued but not a
+            // third. In the event that frames take varying time, this makes a
+            // small trade-off in favor of latency rather than throughput.
+            frames[i].lastQueuedFence->waitForever("Throttling EGL Production");
+        }
     }
+}
+
+status_t BufferQueueProducer::queueBuffer(int slot,
+        const QueueBufferInput &input, QueueBufferOutput *output) {
+    ATRACE_CALL();
+    ATRACE_BUFFER_INDEX(slot);
 
+    QueuedFrame frame;
+    int callbackTicket = 0;
+
+    { // Autolock scope
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        status_t status = queueBufferLocked(slot, input, output, &frame);
+        if (status != NO_ERROR) {
+            return status;
+        }
+        mCore->mDequeueCondition.notify_all();
+
+        // Take a ticket for the callback functions
+        callbackTicket = mNextCallbackTicket++;
+    } // Autolock scope
+
+    onFramesQueued(callbackTicket, &frame, 1);
     return NO_ERROR;
 }
 
-status_t BufferQueueProducer::cancelBuffer(int slot, const sp<Fence>& fence) {
+status_t BufferQueueProducer::queueBuffers(const std::vector<QueueBufferInput>& inputs,
+                                           std::vector<QueueBufferOutput>* outputs) {
     ATRACE_CALL();
-    BQ_LOGV("cancelBuffer: slot %d", slot);
+    outputs->clear();
+    outputs->resize(inputs.size());
 
-    sp<IConsumerListener> listener;
-    bool callOnFrameCancelled = false;
-    uint64_t bufferId = 0; // Only used if callOnFrameCancelled == true
-    {
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
+    std::vector<QueuedFrame> frames;
+    frames.reserve(inputs.size());
+    int callbackTicket = 0;
 
-        if (mCore->mIsAbandoned) {
-            BQ_LOGE("cancelBuffer: BufferQueue has been abandoned");
-            return NO_INIT;
+    { // Autolock scope
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        for (size_t i = 0; i < inputs.size(); i++) {
+            QueueBufferOutput& output = (*outputs)[i];
+            QueuedFrame& frame = frames.emplace_back();
+            output.result = queueBufferLocked(inputs[i].slot, inputs[i], &output, &frame);
+            if (output.result != NO_ERROR) {
+                frames.pop_back();
+            }
         }
-
-        if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
-            BQ_LOGE("cancelBuffer: BufferQueue has no connected producer");
-            return NO_INIT;
+        if (frames.empty()) {
+            return NO_ERROR;
         }
+        mCore->mDequeueCondition.notify_all();
 
-        if (mCore->mSharedBufferMode) {
-            BQ_LOGE("cancelBuffer: cannot cancel a buffer in shared buffer mode");
-            return BAD_VALUE;
-        }
+        // Take a single ticket for the callbacks of the whole batch, so that they are made in
+        // the order the frames were queued.
+        callbackTicket = mNextCallbackTicket++;
+    } // Autolock scope
 
-        if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS) {
-            BQ_LOGE("cancelBuffer: slot index %d out of range [0, %d)", slot,
-                    BufferQueueDefs::NUM_BUFFER_SLOTS);
-            return BAD_VALUE;
-        } else if (!mSlots[slot].mBufferState.isDequeued()) {
-            BQ_LOGE("cancelBuffer: slot %d is not owned by the producer "
-                    "(state = %s)",
-                    slot, mSlots[slot].mBufferState.string());
-            return BAD_VALUE;
-        } else if (fence == nullptr) {
-            BQ_LOGE("cancelBuffer: fence is NULL");
-            return BAD_VALUE;
-        }
+    onFramesQueued(callbackTicket, frames.data(), frames.size());
+    return NO_ERROR;
+}
 
-        mSlots[slot].mBufferState.cancel();
+status_t BufferQueueProducer::cancelBufferLocked(int slot, const sp<Fence>& fence,
+                                                 std::optional<uint64_t>* outCancelledBufferId) {
+    BQ_LOGV("cancelBuffer: slot %d", slot);
 
-        // After leaving shared buffer mode, the shared buffer will still be around.
-        // Mark it as no longer shared if this operation causes it to be free.
-        if (!mCore->mSharedBufferMode && mSlots[slot].mBufferState.isFree()) {
-            mSlots[slot].mBufferState.mShared = false;
-        }
+    if (mCore->mIsAbandoned) {
+        BQ_LOGE("cancelBuffer: BufferQueue has been abandoned");
+        return NO_INIT;
+    }
+
+    if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
+        BQ_LOGE("cancelBuffer: BufferQueue has no connected producer");
+        return NO_INIT;
+    }
+
+    if (mCore->mSharedBufferMode) {
+        BQ_LOGE("cancelBuffer: cannot cancel a buffer in shared buffer mode");
+        return BAD_VALUE;
+    }
+
+    if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS) {
+        BQ_LOGE("cancelBuffer: slot index %d out of range [0, %d)", slot,
+                BufferQueueDefs::NUM_BUFFER_SLOTS);
+        return BAD_VALUE;
+    } else if (!mSlots[slot].mBufferState.isDequeued()) {
+        BQ_LOGE("cancelBuffer: slot %d is not owned by the producer "
+                "(state = %s)",
+                slot, mSlots[slot].mBufferState.string());
+        return BAD_VALUE;
+    } else if (fence == nullptr) {
+        BQ_LOGE("cancelBuffer: fence is NULL");
+        return BAD_VALUE;
+    }
+
+    mSlots[slot].mBufferState.cancel();
+
+    // After leaving shared buffer mode, the shared buffer will still be around.
+    // Mark it as no longer shared if this operation causes it to be free.
+    if (!mCore->mSharedBufferMode && mSlots[slot].mBufferState.isFree()) {
+        mSlots[slot].mBufferState.mShared = false;
+    }
+
+    // Don't put the shared buffer on the free list.
+    if (!mSlots[slot].mBufferState.isShared()) {
+        mCore->mActiveBuffers.erase(slot);
+        mCore->mFreeBuffers.push_back(slot);
+    }
+
+    auto gb = mSlots[slot].mGraphicBuffer;
+    if (gb != nullptr) {
+        *outCancelledBufferId = gb->getId();
+    }
+    mSlots[slot].mFence = fence;
+    VALIDATE_CONSISTENCY();
+    return NO_ERROR;
+}
+
+status_t BufferQueueProducer::cancelBuffer(int slot, const sp<Fence>& fence) {
+    ATRACE_CALL();
 
-        // Don't put the shared buffer on the free list.
-        if (!mSlots[slot].mBufferState.isShared()) {
-            mCore->mActiveBuffers.erase(slot);
-            mCore->mFreeBuffers.push_back(slot);
+    sp<IConsumerListener> listener;
+    std::optional<uint64_t> cancelledBufferId;
+    {
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        status_t status = cancelBufferLocked(slot, fence, &cancelledBufferId);
+        if (status != NO_ERROR) {
+            return status;
         }
+        mCore->mDequeueCondition.notify_all();
+        listener = mCore->mConsumerListener;
+    }
 
-        auto gb = mSlots[slot].mGraphicBuffer;
-        if (gb != nullptr) {
-            callOnFrameCancelled = true;
-            bufferId = gb->getId();
+    if (listener != nullptr && cancelledBufferId) {
+        listener->onFrameCancelled(*cancelledBufferId);
+    }
+
+    return NO_ERROR;
+}
+
+status_t BufferQueueProducer::cancelBuffers(const std::vector<CancelBufferInput>& inputs,
+                                            std::vector<status_t>* results) {
+    ATRACE_CALL();
+    results->clear();
+    results->reserve(inputs.size());
+
+    sp<IConsumerListener> listener;
+    std::vector<uint64_t> cancelledBufferIds;
+    {
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        for (const CancelBufferInput& input : inputs) {
+            std::optional<uint64_t> cancelledBufferId;
+            status_t& result = results->emplace_back();
+            result = cancelBufferLocked(input.slot, input.fence, &cancelledBufferId);
+            if (result == NO_ERROR && cancelledBufferId) {
+                cancelledBufferIds.push_back(*cancelledBufferId);
+            }
         }
-        mSlots[slot].mFence = fence;
         mCore->mDequeueCondition.notify_all();
         listener = mCore->mConsumerListener;
-        VALIDATE_CONSISTENCY();
     }
 
-    if (listener != nullptr && callOnFrameCancelled) {
-        listener->onFrameCancelled(bufferId);
+    if (listener != nullptr) {
+        for (uint64_t bufferId : cancelledBufferIds) {
+            listener->onFrameCancelled(bufferId);
+        }
     }
 
     return NO_ERROR;
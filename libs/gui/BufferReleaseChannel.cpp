@@ -20,6 +20,10 @@
 #include <sys/socket.h>
 #include <sys/uio.h>
 
+#include <algorithm>
+#include <array>
+#include <iterator>
+
 #include <android-base/result.h>
 #include <android/binder_status.h>
 #include <binder/Parcel.h>
@@ -136,9 +140,35 @@ status_t BufferReleaseChannel::Message::unflatten(void const*& buffer, size_t& s
 status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFence(
         ReleaseCallbackId& outReleaseCallbackId, sp<Fence>& outReleaseFence,
         uint32_t& outMaxAcquiredBufferCount) {
-    Message message;
-    mFlattenedBuffer.resize(message.getFlattenedSize());
-    std::array<uint8_t, CMSG_SPACE(sizeof(int))> controlMessageBuffer;
+    if (mNextPendingMessage == mPendingMessages.size()) {
+        mPendingMessages.clear();
+        mNextPendingMessage = 0;
+        if (status_t err = readReleaseFences(mPendingMessages); err != OK) {
+            return err;
+        }
+    }
+
+    Message& message = mPendingMessages[mNextPendingMessage++];
+    outReleaseCallbackId = message.releaseCallbackId;
+    outReleaseFence = std::move(message.releaseFence);
+    outMaxAcquiredBufferCount = message.maxAcquiredBufferCount;
+
+    return OK;
+}
+
+status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFences(
+        std::vector<Message>& outMessages) {
+    // Return the releases readReleaseFence has already read first, to keep them in order.
+    if (mNextPendingMessage < mPendingMessages.size()) {
+        std::move(mPendingMessages.begin() + mNextPendingMessage, mPendingMessages.end(),
+                  std::back_inserter(outMessages));
+        mPendingMessages.clear();
+        mNextPendingMessage = 0;
+        return OK;
+    }
+
+    mFlattenedBuffer.resize(sizeof(uint32_t) + kMaxBatchSize * Message().getFlattenedSize());
+    std::array<uint8_t, CMSG_SPACE(sizeof(int) * kMaxBatchSize)> controlMessageBuffer;
 
     iovec iov{
             .iov_base = mFlattenedBuffer.data(),
@@ -152,7 +182,7 @@ status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFence(
             .msg_controllen = controlMessageBuffer.size(),
     };
 
-    int result;
+    ssize_t result;
     do {
         result = recvmsg(mFd, &msg, 0);
     } while (result == -1 && errno == EINTR);
@@ -174,7 +204,7 @@ status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFence(
         return UNKNOWN_ERROR;
     }
 
-    size_t dataLen = msg.msg_iov->iov_len;
+    size_t dataLen = static_cast<size_t>(result);
     const void* data = static_cast<const void*>(msg.msg_iov->iov_base);
     if (!data) {
         ALOGE("Error reading release fence from socket: no buffer data");
@@ -188,13 +218,24 @@ status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFence(
         fdCount = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
     }
 
-    if (status_t err = message.unflatten(data, dataLen, fdData, fdCount); err != OK) {
-        return err;
+    uint32_t messageCount = 0;
+    if (dataLen < sizeof(messageCount)) {
+        ALOGE("Error reading release fence from socket: no message count");
+        return UNKNOWN_ERROR;
+    }
+    FlattenableUtils::read(data, dataLen, messageCount);
+    if (messageCount == 0 || messageCount > kMaxBatchSize) {
+        ALOGE("Error reading release fence from socket: bad message count %u", messageCount);
+        return UNKNOWN_ERROR;
     }
 
-    outReleaseCallbackId = message.releaseCallbackId;
-    outReleaseFence = std::move(message.releaseFence);
-    outMaxAcquiredBufferCount = message.maxAcquiredBufferCount;
+    for (uint32_t i = 0; i < messageCount; i++) {
+        Message message;
+        if (status_t err = message.unflatten(data, dataLen, fdData, fdCount); err != OK) {
+            return err;
+        }
+        outMessages.push_back(std::move(message));
+    }
 
     return OK;
 }
@@ -202,22 +243,58 @@ status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFence(
 int BufferReleaseChannel::ProducerEndpoint::writeReleaseFence(const ReleaseCallbackId& callbackId,
                                                               const sp<Fence>& fence,
                                                               uint32_t maxAcquiredBufferCount) {
-    Message message{callbackId, fence ? fence : Fence::NO_FENCE, maxAcquiredBufferCount};
-    mFlattenedBuffer.resize(message.getFlattenedSize());
-    int flattenedFd;
+    const Message message{callbackId, fence, maxAcquiredBufferCount};
+    return writeBatch(&message, 1);
+}
+
+status_t BufferReleaseChannel::ProducerEndpoint::writeReleaseFences(
+        const std::vector<Message>& messages) {
+    for (size_t i = 0; i < messages.size(); i += kMaxBatchSize) {
+        const size_t count = std::min(kMaxBatchSize, messages.size() - i);
+        if (status_t err = writeBatch(&messages[i], count); err != OK) {
+            return err;
+        }
+    }
+    return OK;
+}
+
+status_t BufferReleaseChannel::ProducerEndpoint::writeBatch(const Message* messages,
+                                                            size_t count) {
+    // Signaled fences are sent as NO_FENCE, since the consumer can reuse the buffer right away
+    // and there is no need to pass their fds.
+    std::array<Message, kMaxBatchSize> batch;
+    size_t flattenedSize = sizeof(uint32_t);
+    for (size_t i = 0; i < count; i++) {
+        batch[i] = messages[i];
+        if (!batch[i].releaseFence ||
+            (batch[i].releaseFence->isValid() &&
+             batch[i].releaseFence->getStatus() == Fence::Status::Signaled)) {
+            batch[i].releaseFence = Fence::NO_FENCE;
+        }
+        flattenedSize += batch[i].getFlattenedSize();
+    }
+
+    mFlattenedBuffer.resize(flattenedSize);
+    std::array<int, kMaxBatchSize> flattenedFds;
+    size_t flattenedFdCount = 0;
     {
         // Make copies of needed items since flatten modifies them, and we don't
         // want to send anything if there's an error during flatten.
         void* flattenedBufferPtr = mFlattenedBuffer.data();
         size_t flattenedBufferSize = mFlattenedBuffer.size();
-        int* flattenedFdPtr = &flattenedFd;
-        size_t flattenedFdCount = 1;
-        if (status_t err = message.flatten(flattenedBufferPtr, flattenedBufferSize, flattenedFdPtr,
-                                           flattenedFdCount);
-            err != OK) {
-            ALOGE("Failed to flatten BufferReleaseChannel message.");
-            return err;
+        int* flattenedFdPtr = flattenedFds.data();
+        size_t flattenedFdSpace = flattenedFds.size();
+        FlattenableUtils::write(flattenedBufferPtr, flattenedBufferSize,
+                                static_cast<uint32_t>(count));
+        for (size_t i = 0; i < count; i++) {
+            if (status_t err = batch[i].flatten(flattenedBufferPtr, flattenedBufferSize,
+                                                flattenedFdPtr, flattenedFdSpace);
+                err != OK) {
+                ALOGE("Failed to flatten BufferReleaseChannel message.");
+                return err;
+            }
         }
+        flattenedFdCount = flattenedFds.size() - flattenedFdSpace;
     }
 
     iovec iov{
@@ -230,16 +307,16 @@ int BufferReleaseChannel::ProducerEndpoint::writeReleaseFence(const ReleaseCallb
             .msg_iovlen = 1,
     };
 
-    std::array<uint8_t, CMSG_SPACE(sizeof(int))> controlMessageBuffer;
-    if (fence && fence->isValid()) {
+    std::array<uint8_t, CMSG_SPACE(sizeof(int) * kMaxBatchSize)> controlMessageBuffer;
+    if (flattenedFdCount > 0) {
         msg.msg_control = controlMessageBuffer.data();
-        msg.msg_controllen = controlMessageBuffer.size();
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * flattenedFdCount);
 
         cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
         cmsg->cmsg_level = SOL_SOCKET;
         cmsg->cmsg_type = SCM_RIGHTS;
-        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
-        memcpy(CMSG_DATA(cmsg), &flattenedFd, sizeof(int));
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * flattenedFdCount);
+        memcpy(CMSG_DATA(cmsg), flattenedFds.data(), sizeof(int) * flattenedFdCount);
     }
 
     int result;
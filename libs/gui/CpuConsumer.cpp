@@ -21,6 +21,7 @@
 #include <com_android_graphics_libgui_flags.h>
 #include <gui/BufferItem.h>
 #include <gui/CpuConsumer.h>
+#include <ui/GraphicBufferMapper.h>
 #include <utils/Log.h>
 
 #define CC_LOGV(x, ...) ALOGV("[%s] " x, mName.c_str(), ##__VA_ARGS__)
@@ -101,7 +102,18 @@ static bool isPossiblyYUV(PixelFormat format) {
     }
 }
 
-status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) const {
+// Sets the fields of a locked buffer that change with each frame.
+static void setFrameInfo(const BufferItem& item, CpuConsumer::LockedBuffer* outBuffer) {
+    outBuffer->crop = item.mCrop;
+    outBuffer->transform = item.mTransform;
+    outBuffer->scalingMode = item.mScalingMode;
+    outBuffer->timestamp = item.mTimestamp;
+    outBuffer->dataSpace = item.mDataSpace;
+    outBuffer->frameNumber = item.mFrameNumber;
+}
+
+status_t CpuConsumer::lockBufferItem(const BufferItem& item, const Rect& bounds,
+                                     LockedBuffer* outBuffer) const {
     android_ycbcr ycbcr = android_ycbcr();
 
     PixelFormat format = item.mGraphicBuffer->getPixelFormat();
@@ -109,7 +121,7 @@ status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBu
     if (isPossiblyYUV(format)) {
         int fenceFd = item.mFence.get() ? item.mFence->dup() : -1;
         status_t err = item.mGraphicBuffer->lockAsyncYCbCr(GraphicBuffer::USAGE_SW_READ_OFTEN,
-                                                           item.mCrop, &ycbcr, fenceFd);
+                                                           bounds, &ycbcr, fenceFd);
         if (err == OK) {
             flexFormat = HAL_PIXEL_FORMAT_YCbCr_420_888;
             if (format != HAL_PIXEL_FORMAT_YCbCr_420_888) {
@@ -133,7 +145,7 @@ status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBu
         void* bufferPointer = nullptr;
         int fenceFd = item.mFence.get() ? item.mFence->dup() : -1;
         status_t err = item.mGraphicBuffer->lockAsync(GraphicBuffer::USAGE_SW_READ_OFTEN,
-                                                      item.mCrop, &bufferPointer, fenceFd);
+                                                      bounds, &bufferPointer, fenceFd);
         if (err != OK) {
             CC_LOGE("Unable to lock buffer for CPU reading: %s (%d)", strerror(-err), err);
             return err;
@@ -152,16 +164,82 @@ status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBu
     outBuffer->format = format;
     outBuffer->flexFormat = flexFormat;
 
-    outBuffer->crop = item.mCrop;
-    outBuffer->transform = item.mTransform;
-    outBuffer->scalingMode = item.mScalingMode;
-    outBuffer->timestamp = item.mTimestamp;
-    outBuffer->dataSpace = item.mDataSpace;
-    outBuffer->frameNumber = item.mFrameNumber;
+    setFrameInfo(item, outBuffer);
 
     return OK;
 }
 
+bool CpuConsumer::rereadPersistentMappingLocked(const BufferItem& item, LockedBuffer* outBuffer) {
+    PersistentMapping& mapping = mPersistentMappings[item.mSlot];
+    if (mapping.mGraphicBuffer == nullptr) {
+        return false;
+    }
+    if (mapping.mGraphicBuffer != item.mGraphicBuffer) {
+        releasePersistentMappingLocked(item.mSlot);
+        return false;
+    }
+
+    // The buffer stayed locked while the producer wrote to it, so wait for the writes here
+    // rather than in gralloc.
+    status_t err = item.mFence->waitForever("CpuConsumer::lockNextBuffer");
+    if (err == OK) {
+        err = GraphicBufferMapper::get().rereadLockedBuffer(item.mGraphicBuffer->handle);
+    }
+    if (err != OK) {
+        releasePersistentMappingLocked(item.mSlot);
+        if (err == INVALID_OPERATION) {
+            CC_LOGW("Persistent mappings are not supported by gralloc, disabling them");
+            mPersistentMappingEnabled = false;
+            for (int i = 0; i < BufferQueue::NUM_BUFFER_SLOTS; i++) {
+                releasePersistentMappingLocked(i);
+            }
+        }
+        return false;
+    }
+
+    *outBuffer = mapping.mLockedBuffer;
+    setFrameInfo(item, outBuffer);
+    return true;
+}
+
+void CpuConsumer::releasePersistentMappingLocked(int slot) {
+    PersistentMapping& mapping = mPersistentMappings[slot];
+    if (mapping.mGraphicBuffer == nullptr) {
+        return;
+    }
+
+    bool lockedByUser = false;
+    for (size_t i = 0; i < mMaxLockedBuffers; i++) {
+        AcquiredBuffer& ab = mAcquiredBuffers.editItemAt(i);
+        if (ab.mPersistentlyMapped && ab.mGraphicBuffer == mapping.mGraphicBuffer) {
+            ab.mPersistentlyMapped = false;
+            lockedByUser = true;
+        }
+    }
+    if (!lockedByUser) {
+        status_t err = mapping.mGraphicBuffer->unlock();
+        if (err != OK) {
+            CC_LOGE("%s: Unable to unlock graphic buffer in slot %d", __FUNCTION__, slot);
+        }
+    }
+    mapping.mGraphicBuffer.clear();
+}
+
+void CpuConsumer::freeBufferLocked(int slotIndex) {
+    releasePersistentMappingLocked(slotIndex);
+    ConsumerBase::freeBufferLocked(slotIndex);
+}
+
+void CpuConsumer::setPersistentMappingEnabled(bool enabled) {
+    Mutex::Autolock _l(mMutex);
+    mPersistentMappingEnabled = enabled;
+    if (!enabled) {
+        for (int i = 0; i < BufferQueue::NUM_BUFFER_SLOTS; i++) {
+            releasePersistentMappingLocked(i);
+        }
+    }
+}
+
 status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
     status_t err;
 
@@ -190,9 +268,19 @@ status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
         b.mGraphicBuffer = mSlots[b.mSlot].mGraphicBuffer;
     }
 
-    err = lockBufferItem(b, nativeBuffer);
-    if (err != OK) {
-        return err;
+    bool persistentlyMapped =
+            mPersistentMappingEnabled && rereadPersistentMappingLocked(b, nativeBuffer);
+    if (!persistentlyMapped) {
+        // A persistent mapping covers the whole buffer, since the crop may change between frames.
+        const bool persist = mPersistentMappingEnabled;
+        err = lockBufferItem(b, persist ? b.mGraphicBuffer->getBounds() : b.mCrop, nativeBuffer);
+        if (err != OK) {
+            return err;
+        }
+        if (persist) {
+            mPersistentMappings[b.mSlot] = {b.mGraphicBuffer, *nativeBuffer};
+            persistentlyMapped = true;
+        }
     }
 
     // find an unused AcquiredBuffer
@@ -203,6 +291,7 @@ status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
     ab.mSlot = b.mSlot;
     ab.mGraphicBuffer = b.mGraphicBuffer;
     ab.mLockedBufferId = getLockedBufferId(*nativeBuffer);
+    ab.mPersistentlyMapped = persistentlyMapped;
 
     mCurrentLockedBuffers++;
 
@@ -222,6 +311,14 @@ status_t CpuConsumer::unlockBuffer(const LockedBuffer &nativeBuffer) {
 
     AcquiredBuffer& ab = mAcquiredBuffers.editItemAt(lockedIdx);
 
+    if (ab.mPersistentlyMapped) {
+        // The buffer stays locked, and the CPU only read it, so the consumer is done with it.
+        releaseBufferLocked(ab.mSlot, ab.mGraphicBuffer);
+        ab.reset();
+        mCurrentLockedBuffers--;
+        return OK;
+    }
+
     int fenceFd = -1;
     status_t err = ab.mGraphicBuffer->unlockAsync(&fenceFd);
     if (err != OK) {
@@ -20,6 +20,7 @@
 
 #include <utils/Errors.h>
 
+#include <com_android_graphics_libgui_flags.h>
 #include <gui/DisplayEventReceiver.h>
 #include <gui/VsyncEventData.h>
 
@@ -53,6 +54,16 @@ DisplayEventReceiver::DisplayEventReceiver(gui::ISurfaceComposer::VsyncSource vs
                 mInitError = std::make_optional<status_t>(status.transactionError());
                 mDataChannel.reset();
                 mEventConnection.clear();
+            } else if (com::android::graphics::libgui::flags::shared_vsync_event_data()) {
+                os::ParcelFileDescriptor sharedVsyncEventData;
+                status = mEventConnection->getSharedVsyncEventData(&sharedVsyncEventData);
+                if (status.isOk()) {
+                    gui::SharedVsyncEventData::createReader("DisplayEventReceiver",
+                                                            sharedVsyncEventData.release(),
+                                                            mSharedVsyncEventData);
+                } else {
+                    ALOGW("getSharedVsyncEventData failed: %s", status.toString8().c_str());
+                }
             }
         } else {
             ALOGE("DisplayEventConnection creation failed: status=%s", status.toString8().c_str());
@@ -96,6 +107,14 @@ status_t DisplayEventReceiver::requestNextVsync() {
 
 status_t DisplayEventReceiver::getLatestVsyncEventData(
         ParcelableVsyncEventData* outVsyncEventData) const {
+    // The frame timelines of the last vsync event match those SurfaceFlinger would predict now,
+    // until the deadline of the preferred one passes.
+    if (mSharedVsyncEventData &&
+        mSharedVsyncEventData->read(outVsyncEventData->vsync) == NO_ERROR &&
+        outVsyncEventData->vsync.preferredDeadlineTimestamp() > systemTime()) {
+        return NO_ERROR;
+    }
+
     if (mEventConnection != nullptr) {
         auto status = mEventConnection->getLatestVsyncEventData(outVsyncEventData);
         if (!status.isOk()) {
@@ -565,6 +565,14 @@ void ConsumerFrameEventHistory::resize(size_t newSize) {
 // FrameEventsDelta
 // ============================================================================
 
+// Polls the fence before taking its snapshot, so that a fence which has already signaled is sent
+// to the producer as its signal time. That saves duplicating its fd into the parcel and having the
+// producer poll it again, and lets the FenceTime close its fd here.
+static FenceTime::Snapshot getPolledSnapshot(const std::shared_ptr<FenceTime>& fence) {
+    fence->getSignalTime();
+    return fence->getSnapshot();
+}
+
 FrameEventsDelta::FrameEventsDelta(
         size_t index,
         const FrameEvents& frameTimestamps,
@@ -580,15 +588,13 @@ FrameEventsDelta::FrameEventsDelta(
       mLastRefreshStartTime(frameTimestamps.lastRefreshStartTime),
       mDequeueReadyTime(frameTimestamps.dequeueReadyTime) {
     if (dirtyFields.isDirty<FrameEvent::GPU_COMPOSITION_DONE>()) {
-        mGpuCompositionDoneFence =
-                frameTimestamps.gpuCompositionDoneFence->getSnapshot();
+        mGpuCompositionDoneFence = getPolledSnapshot(frameTimestamps.gpuCompositionDoneFence);
     }
     if (dirtyFields.isDirty<FrameEvent::DISPLAY_PRESENT>()) {
-        mDisplayPresentFence =
-                frameTimestamps.displayPresentFence->getSnapshot();
+        mDisplayPresentFence = getPolledSnapshot(frameTimestamps.displayPresentFence);
     }
     if (dirtyFields.isDirty<FrameEvent::RELEASE>()) {
-        mReleaseFence = frameTimestamps.releaseFence->getSnapshot();
+        mReleaseFence = getPolledSnapshot(frameTimestamps.releaseFence);
     }
 }
 
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include <gui/FrameTransactionAggregator.h>
+#include <gui/TraceUtils.h>
+
+#include <pthread.h>
+
+#include <algorithm>
+
+namespace android {
+
+FrameTransactionAggregator::FrameTransactionAggregator(std::chrono::nanoseconds deadline)
+      : mDeadline(deadline) {
+    mThread = std::thread(&FrameTransactionAggregator::threadMain, this);
+    pthread_setname_np(mThread.native_handle(), "FrameTxAggregator");
+}
+
+FrameTransactionAggregator::~FrameTransactionAggregator() {
+    {
+        std::lock_guard lock(mMutex);
+        flushLocked();
+        mStopped = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+void FrameTransactionAggregator::flush() {
+    std::lock_guard lock(mMutex);
+    flushLocked();
+}
+
+FrameTransactionAggregator::Stats FrameTransactionAggregator::getStats() const {
+    std::lock_guard lock(mMutex);
+    return mStats;
+}
+
+void FrameTransactionAggregator::registerQueue(const BLASTBufferQueue* queue) {
+    std::lock_guard lock(mMutex);
+    mQueues.insert(queue);
+}
+
+void FrameTransactionAggregator::unregisterQueue(const BLASTBufferQueue* queue) {
+    std::lock_guard lock(mMutex);
+    mQueues.erase(queue);
+    // Apply what the queue added before it goes away, and what the remaining queues were only
+    // waiting on it for.
+    if (mContributors.erase(queue) || (!mContributors.empty() && mContributors == mQueues)) {
+        flushLocked();
+    }
+}
+
+void FrameTransactionAggregator::add(const BLASTBufferQueue* queue,
+                                     SurfaceComposerClient::Transaction* t,
+                                     std::optional<nsecs_t> desiredPresentTime) {
+    std::lock_guard lock(mMutex);
+    const nsecs_t presentTime = desiredPresentTime.value_or(systemTime());
+    if (mContributors.count(queue) ||
+        (!mContributors.empty() &&
+         (std::max(mLatestPresentTime, presentTime) -
+                  std::min(mEarliestPresentTime, presentTime) >
+          kMaxPresentTimeSpread))) {
+        flushLocked();
+    }
+
+    if (mContributors.empty()) {
+        mEarliestPresentTime = presentTime;
+        mLatestPresentTime = presentTime;
+    } else {
+        mEarliestPresentTime = std::min(mEarliestPresentTime, presentTime);
+        mLatestPresentTime = std::max(mLatestPresentTime, presentTime);
+    }
+    if (desiredPresentTime) {
+        mDesiredPresentTime = std::min(mDesiredPresentTime.value_or(*desiredPresentTime),
+                                       *desiredPresentTime);
+    }
+
+    mTransaction.merge(std::move(*t));
+    mContributors.insert(queue);
+    mStats.mergedTransactions++;
+
+    if (mContributors.size() >= mQueues.size()) {
+        flushLocked();
+    } else if (!mFlushTime) {
+        mFlushTime = std::chrono::steady_clock::now() + mDeadline;
+        mCondition.notify_one();
+    }
+}
+
+void FrameTransactionAggregator::flushLocked() {
+    mFlushTime.reset();
+    if (mContributors.empty()) {
+        return;
+    }
+    ATRACE_FORMAT("FrameTransactionAggregator::flush queues=%zu", mContributors.size());
+    if (mDesiredPresentTime) {
+        mTransaction.setDesiredPresentTime(*mDesiredPresentTime);
+        mDesiredPresentTime.reset();
+    }
+    // All transactions on the apply token are one-way, like those of the queues themselves.
+    mTransaction.setApplyToken(mApplyToken).apply(false, true);
+    mTransaction.clear();
+    mContributors.clear();
+    mStats.flushes++;
+}
+
+void FrameTransactionAggregator::threadMain() {
+    std::unique_lock lock(mMutex);
+    while (!mStopped) {
+        if (!mFlushTime) {
+            mCondition.wait(lock);
+        } else if (mCondition.wait_until(lock, *mFlushTime) == std::cv_status::timeout) {
+            ATRACE_NAME("FrameTransactionAggregator deadline");
+            flushLocked();
+        }
+    }
+}
+
+} // namespace android
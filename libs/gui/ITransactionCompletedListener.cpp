@@ -38,7 +38,8 @@ enum class Tag : uint32_t {
     ON_RELEASE_BUFFER,
     ON_TRANSACTION_QUEUE_STALLED,
     ON_TRUSTED_PRESENTATION_CHANGED,
-    LAST = ON_TRUSTED_PRESENTATION_CHANGED,
+    ON_BUFFER_UNCACHED,
+    LAST = ON_BUFFER_UNCACHED,
 };
 
 } // Anonymous namespace
@@ -225,6 +226,32 @@ status_t TransactionStats::readFromParcel(const Parcel* input) {
     return input->readParcelableVector(&surfaceStats);
 }
 
+status_t ReleasedBufferStats::writeToParcel(Parcel* output) const {
+    SAFE_PARCEL(output->writeParcelable, callbackId);
+    if (releaseFence) {
+        SAFE_PARCEL(output->writeBool, true);
+        SAFE_PARCEL(output->write, *releaseFence);
+    } else {
+        SAFE_PARCEL(output->writeBool, false);
+    }
+    SAFE_PARCEL(output->writeUint32, currentMaxAcquiredBufferCount);
+    return NO_ERROR;
+}
+
+status_t ReleasedBufferStats::readFromParcel(const Parcel* input) {
+    SAFE_PARCEL(input->readParcelable, &callbackId);
+    bool hasFence = false;
+    SAFE_PARCEL(input->readBool, &hasFence);
+    if (hasFence) {
+        releaseFence = sp<Fence>::make();
+        SAFE_PARCEL(input->read, *releaseFence);
+    } else {
+        releaseFence = Fence::NO_FENCE;
+    }
+    SAFE_PARCEL(input->readUint32, &currentMaxAcquiredBufferCount);
+    return NO_ERROR;
+}
+
 status_t ListenerStats::writeToParcel(Parcel* output) const {
     status_t err = output->writeInt32(static_cast<int32_t>(transactionStats.size()));
     if (err != NO_ERROR) {
@@ -236,7 +263,7 @@ status_t ListenerStats::writeToParcel(Parcel* output) const {
             return err;
         }
     }
-    return NO_ERROR;
+    return output->writeParcelableVector(releasedBuffers);
 }
 
 status_t ListenerStats::readFromParcel(const Parcel* input) {
@@ -250,7 +277,7 @@ status_t ListenerStats::readFromParcel(const Parcel* input) {
         }
         transactionStats.push_back(stats);
     }
-    return NO_ERROR;
+    return input->readParcelableVector(&releasedBuffers);
 }
 
 ListenerStats ListenerStats::createEmpty(
@@ -296,6 +323,11 @@ public:
         callRemoteAsync<decltype(&ITransactionCompletedListener::onTrustedPresentationChanged)>(
                 Tag::ON_TRUSTED_PRESENTATION_CHANGED, id, inTrustedPresentationState);
     }
+
+    void onBufferUncached(uint64_t cacheId) override {
+        callRemoteAsync<decltype(&ITransactionCompletedListener::onBufferUncached)>(
+                Tag::ON_BUFFER_UNCACHED, cacheId);
+    }
 };
 
 // Out-of-line virtual method definitions to trigger vtable emission in this translation unit (see
@@ -322,6 +354,8 @@ status_t BnTransactionCompletedListener::onTransact(uint32_t code, const Parcel&
         case Tag::ON_TRUSTED_PRESENTATION_CHANGED:
             return callLocalAsync(data, reply,
                                   &ITransactionCompletedListener::onTrustedPresentationChanged);
+        case Tag::ON_BUFFER_UNCACHED:
+            return callLocalAsync(data, reply, &ITransactionCompletedListener::onBufferUncached);
     }
 }
 
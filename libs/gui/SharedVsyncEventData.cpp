@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "SharedVsyncEventData"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cutils/ashmem.h>
+#include <gui/SharedVsyncEventData.h>
+#include <utils/Log.h>
+
+namespace android::gui {
+
+// The vsync data is copied in 32 bit words, so that every access to the page is atomic and the
+// layout doesn't depend on the ABI of the writer and reader beyond that of VsyncEventData.
+struct SharedVsyncEventData::Page {
+    static_assert(std::is_trivially_copyable_v<VsyncEventData>);
+    static_assert(sizeof(VsyncEventData) % sizeof(uint32_t) == 0);
+    static_assert(std::atomic<uint32_t>::is_always_lock_free);
+    static constexpr size_t kWords = sizeof(VsyncEventData) / sizeof(uint32_t);
+
+    // Odd while the writer updates the words, and zero until the first vsync data is published.
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[kWords];
+};
+
+namespace {
+
+// A reader only races with the writer while a vsync is being published, which takes a fraction
+// of a microsecond, so this is only reached if the writer was preempted.
+constexpr int kMaxReadAttempts = 8;
+
+// The page is never smaller than 4KiB, which is checked to fit the vsync data.
+constexpr size_t kMinPageSize = 4096;
+
+size_t pageSize() {
+    return static_cast<size_t>(getpagesize());
+}
+
+} // namespace
+
+SharedVsyncEventData::Writer::~Writer() {
+    munmap(mPage, pageSize());
+}
+
+void SharedVsyncEventData::Writer::publish(const VsyncEventData& vsyncData) {
+    uint32_t words[Page::kWords];
+    std::memcpy(words, &vsyncData, sizeof(words));
+
+    const uint32_t sequence = mPage->sequence.load(std::memory_order_relaxed);
+    mPage->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < Page::kWords; i++) {
+        mPage->words[i].store(words[i], std::memory_order_relaxed);
+    }
+    mPage->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+android::base::unique_fd SharedVsyncEventData::Writer::dupReaderFd() const {
+    android::base::unique_fd fd(fcntl(mFd.get(), F_DUPFD_CLOEXEC, 0));
+    ALOGE_IF(!fd.ok(), "[%s] Failed to duplicate page fd. errno=%d message='%s'", mName.c_str(),
+             errno, strerror(errno));
+    return fd;
+}
+
+SharedVsyncEventData::Reader::~Reader() {
+    munmap(const_cast<Page*>(mPage), pageSize());
+}
+
+status_t SharedVsyncEventData::Reader::read(VsyncEventData& outVsyncData) const {
+    uint32_t words[Page::kWords];
+    for (int attempt = 0; attempt < kMaxReadAttempts; attempt++) {
+        const uint32_t sequence = mPage->sequence.load(std::memory_order_acquire);
+        if (sequence == 0) {
+            return NOT_ENOUGH_DATA;
+        }
+        if (sequence & 1) {
+            continue;
+        }
+        for (size_t i = 0; i < Page::kWords; i++) {
+            words[i] = mPage->words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mPage->sequence.load(std::memory_order_relaxed) == sequence) {
+            std::memcpy(&outVsyncData, words, sizeof(words));
+            return OK;
+        }
+    }
+    return WOULD_BLOCK;
+}
+
+status_t SharedVsyncEventData::createWriter(std::string name, std::unique_ptr<Writer>& outWriter) {
+    static_assert(sizeof(Page) <= kMinPageSize);
+    outWriter.reset();
+
+    android::base::unique_fd fd(ashmem_create_region(name.c_str(), pageSize()));
+    if (!fd.ok()) {
+        ALOGE("[%s] Failed to create page. errno=%d message='%s'", name.c_str(), errno,
+              strerror(errno));
+        return -errno;
+    }
+
+    void* page = mmap(nullptr, pageSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (page == MAP_FAILED) {
+        ALOGE("[%s] Failed to map page. errno=%d message='%s'", name.c_str(), errno,
+              strerror(errno));
+        return -errno;
+    }
+
+    // Only the mapping above may write to the page, the readers' fds can only be mapped read-only.
+    if (ashmem_set_prot_region(fd.get(), PROT_READ) == -1) {
+        const int error = errno;
+        ALOGE("[%s] Failed to make page read-only. errno=%d message='%s'", name.c_str(), error,
+              strerror(error));
+        munmap(page, pageSize());
+        return -error;
+    }
+
+    outWriter.reset(new Writer(std::move(name), std::move(fd), new (page) Page{}));
+    return OK;
+}
+
+status_t SharedVsyncEventData::createReader(std::string name, android::base::unique_fd fd,
+                                            std::unique_ptr<Reader>& outReader) {
+    outReader.reset();
+
+    const int size = ashmem_get_size_region(fd.get());
+    if (size < 0 || static_cast<size_t>(size) < pageSize()) {
+        ALOGE("[%s] Page has invalid size %d", name.c_str(), size);
+        return BAD_VALUE;
+    }
+
+    void* page = mmap(nullptr, pageSize(), PROT_READ, MAP_SHARED, fd.get(), 0);
+    if (page == MAP_FAILED) {
+        ALOGE("[%s] Failed to map page. errno=%d message='%s'", name.c_str(), errno,
+              strerror(errno));
+        return -errno;
+    }
+
+    outReader.reset(new Reader(std::move(name), static_cast<const Page*>(page)));
+    return OK;
+}
+
+} // namespace android::gui
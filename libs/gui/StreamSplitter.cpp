@@ -33,6 +33,8 @@
 
 #include <system/window.h>
 
+#include <algorithm>
+
 namespace android {
 
 status_t StreamSplitter::createSplitter(
@@ -58,13 +60,13 @@ status_t StreamSplitter::createSplitter(
 
 StreamSplitter::StreamSplitter(const sp<IGraphicBufferConsumer>& inputQueue)
       : mIsAbandoned(false), mMutex(), mReleaseCondition(),
-        mOutstandingBuffers(0), mInput(inputQueue), mOutputs(), mBuffers() {}
+        mOutstandingBuffers(0), mMaxQueuedBuffersPerOutput(0),
+        mInput(inputQueue), mOutputs(), mBuffers() {}
 
 StreamSplitter::~StreamSplitter() {
     mInput->consumerDisconnect();
-    Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
-    for (; output != mOutputs.end(); ++output) {
-        (*output)->disconnect(NATIVE_WINDOW_API_CPU);
+    for (const Output& output : mOutputs) {
+        output.producer->disconnect(NATIVE_WINDOW_API_CPU);
     }
 
     if (mBuffers.size() > 0) {
@@ -91,7 +93,7 @@ status_t StreamSplitter::addOutput(
         return status;
     }
 
-    mOutputs.push_back(outputQueue);
+    mOutputs.emplace_back(outputQueue);
 
     return NO_ERROR;
 }
@@ -101,18 +103,42 @@ void StreamSplitter::setName(const String8 &name) {
     mInput->setConsumerName(name);
 }
 
+void StreamSplitter::setMaxQueuedBuffersPerOutput(size_t maxQueuedBuffers) {
+    Mutex::Autolock lock(mMutex);
+    mMaxQueuedBuffersPerOutput = maxQueuedBuffers;
+
+    // A blocked onFrameAvailable call no longer needs to wait for the outputs
+    mReleaseCondition.broadcast();
+}
+
+std::vector<StreamSplitter::OutputStats> StreamSplitter::getOutputStats() const {
+    Mutex::Autolock lock(mMutex);
+    std::vector<OutputStats> stats;
+    stats.reserve(mOutputs.size());
+    for (const Output& output : mOutputs) {
+        stats.push_back(output.stats);
+    }
+    return stats;
+}
+
 void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
     ATRACE_CALL();
     Mutex::Autolock lock(mMutex);
 
-    // The current policy is that if any one consumer is consuming buffers too
+    // The default policy is that if any one consumer is consuming buffers too
     // slowly, the splitter will stall the rest of the outputs by not acquiring
     // any more buffers from the input. This will cause back pressure on the
     // input queue, slowing down its producer.
+    //
+    // If the number of buffers queued to each output is bounded, an output
+    // that holds too many drops the buffer instead. Every outstanding buffer is
+    // then held by an output, so their number is bounded too and there is no
+    // need to block.
 
     // If there are too many outstanding buffers, we block until a buffer is
     // released back to the input in onBufferReleased
-    while (mOutstandingBuffers >= MAX_OUTSTANDING_BUFFERS) {
+    while (mMaxQueuedBuffersPerOutput == 0 &&
+            mOutstandingBuffers >= MAX_OUTSTANDING_BUFFERS) {
         mReleaseCondition.wait(mMutex);
 
         // If the splitter is abandoned while we are waiting, the release
@@ -139,8 +165,10 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             "detaching buffer from input failed (%d)", status);
 
     // Initialize our reference count for this buffer
-    mBuffers.add(bufferItem.mGraphicBuffer->getId(),
-            new BufferTracker(bufferItem.mGraphicBuffer));
+    sp<BufferTracker> tracker = new BufferTracker(bufferItem.mGraphicBuffer);
+    tracker->setQueueTime(systemTime());
+    mBuffers.add(bufferItem.mGraphicBuffer->getId(), tracker);
+    size_t releaseCount = 0;
 
     IGraphicBufferProducer::QueueBufferInput queueInput(
             bufferItem.mTimestamp, bufferItem.mIsAutoTimestamp,
@@ -148,18 +176,28 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             static_cast<int32_t>(bufferItem.mScalingMode),
             bufferItem.mTransform, bufferItem.mFence);
 
-    // Attach and queue the buffer to each of the outputs
-    Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
-    for (; output != mOutputs.end(); ++output) {
+    // Attach and queue the buffer to each of the outputs. IGraphicBufferProducer
+    // has no call that attaches a buffer to several queues, but the buffer is
+    // shared by all of them rather than copied.
+    for (Output& output : mOutputs) {
+        if (shouldDropLocked(output)) {
+            // The output is lagging, so count it as having released the buffer
+            // already rather than waiting for it
+            ++output.stats.droppedBuffers;
+            releaseCount = tracker->incrementReleaseCountLocked();
+            ALOGV("dropped buffer %#" PRIx64 " for output %p",
+                    bufferItem.mGraphicBuffer->getId(), output.producer.get());
+            continue;
+        }
+
         int slot;
-        status = (*output)->attachBuffer(&slot, bufferItem.mGraphicBuffer);
+        status = output.producer->attachBuffer(&slot, bufferItem.mGraphicBuffer);
         if (status == NO_INIT) {
             // If we just discovered that this output has been abandoned, note
             // that, increment the release count so that we still release this
             // buffer eventually, and move on to the next output
             onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
+            releaseCount = tracker->incrementReleaseCountLocked();
             continue;
         } else {
             LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
@@ -167,22 +205,29 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
         }
 
         IGraphicBufferProducer::QueueBufferOutput queueOutput;
-        status = (*output)->queueBuffer(slot, queueInput, &queueOutput);
+        status = output.producer->queueBuffer(slot, queueInput, &queueOutput);
         if (status == NO_INIT) {
             // If we just discovered that this output has been abandoned, note
             // that, increment the release count so that we still release this
             // buffer eventually, and move on to the next output
             onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
+            releaseCount = tracker->incrementReleaseCountLocked();
             continue;
         } else {
             LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
                     "queueing buffer to output failed (%d)", status);
         }
 
+        ++output.heldBuffers;
+        ++output.stats.queuedBuffers;
+
         ALOGV("queued buffer %#" PRIx64 " to output %p",
-                bufferItem.mGraphicBuffer->getId(), output->get());
+                bufferItem.mGraphicBuffer->getId(), output.producer.get());
+    }
+
+    // If no output took the buffer, none of them will release it
+    if (releaseCount == mOutputs.size()) {
+        releaseToInputLocked(tracker);
     }
 }
 
@@ -207,7 +252,15 @@ void StreamSplitter::onBufferReleasedByOutput(
     ALOGV("detached buffer %#" PRIx64 " from output %p",
           buffer->getId(), from.get());
 
-    const sp<BufferTracker>& tracker = mBuffers.editValueFor(buffer->getId());
+    sp<BufferTracker> tracker = mBuffers.valueFor(buffer->getId());
+
+    if (Output* output = findOutputLocked(from)) {
+        const nsecs_t holdTime = systemTime() - tracker->getQueueTime();
+        --output->heldBuffers;
+        ++output->stats.releasedBuffers;
+        output->stats.totalHoldTime += holdTime;
+        output->stats.maxHoldTime = std::max(output->stats.maxHoldTime, holdTime);
+    }
 
     // Merge the release fence of the incoming buffer so that the fence we send
     // back to the input includes all of the outputs' fences
@@ -221,16 +274,22 @@ void StreamSplitter::onBufferReleasedByOutput(
         return;
     }
 
+    releaseToInputLocked(tracker);
+}
+
+void StreamSplitter::releaseToInputLocked(const sp<BufferTracker>& tracker) {
+    const uint64_t bufferId = tracker->getBuffer()->getId();
+
     // If we've been abandoned, we can't return the buffer to the input, so just
     // stop tracking it and move on
     if (mIsAbandoned) {
-        mBuffers.removeItem(buffer->getId());
+        mBuffers.removeItem(bufferId);
         return;
     }
 
     // Attach and release the buffer back to the input
     int consumerSlot;
-    status = mInput->attachBuffer(&consumerSlot, tracker->getBuffer());
+    status_t status = mInput->attachBuffer(&consumerSlot, tracker->getBuffer());
     LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
             "attaching buffer to input failed (%d)", status);
 
@@ -239,17 +298,32 @@ void StreamSplitter::onBufferReleasedByOutput(
     LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
             "releasing buffer to input failed (%d)", status);
 
-    ALOGV("released buffer %#" PRIx64 " to input", buffer->getId());
+    ALOGV("released buffer %#" PRIx64 " to input", bufferId);
 
     // We no longer need to track the buffer once it has been returned to the
     // input
-    mBuffers.removeItem(buffer->getId());
+    mBuffers.removeItem(bufferId);
 
     // Notify any waiting onFrameAvailable calls
     --mOutstandingBuffers;
     mReleaseCondition.signal();
 }
 
+StreamSplitter::Output* StreamSplitter::findOutputLocked(
+        const sp<IGraphicBufferProducer>& producer) {
+    for (Output& output : mOutputs) {
+        if (output.producer == producer) {
+            return &output;
+        }
+    }
+    return nullptr;
+}
+
+bool StreamSplitter::shouldDropLocked(const Output& output) const {
+    return mMaxQueuedBuffersPerOutput > 0 &&
+            output.heldBuffers >= mMaxQueuedBuffersPerOutput;
+}
+
 void StreamSplitter::onAbandonedLocked() {
     ALOGE("one of my outputs has abandoned me");
     if (!mIsAbandoned) {
@@ -276,7 +350,8 @@ void StreamSplitter::OutputListener::binderDied(const wp<IBinder>& /* who */) {
 }
 
 StreamSplitter::BufferTracker::BufferTracker(const sp<GraphicBuffer>& buffer)
-      : mBuffer(buffer), mMergedFence(Fence::NO_FENCE), mReleaseCount(0) {}
+      : mBuffer(buffer), mMergedFence(Fence::NO_FENCE), mReleaseCount(0),
+        mQueueTime(0) {}
 
 StreamSplitter::BufferTracker::~BufferTracker() {}
 
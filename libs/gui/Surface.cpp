@@ -25,7 +25,9 @@
 #include <cstdint>
 #include <deque>
 #include <mutex>
+#include <optional>
 #include <thread>
+#include <utility>
 
 #include <inttypes.h>
 
@@ -150,6 +152,9 @@ Surface::Surface(const sp<IGraphicBufferProducer>& bufferProducer, bool controll
 }
 
 Surface::~Surface() {
+    if (mDequeuePrefetcher) {
+        mDequeuePrefetcher->stop();
+    }
     if (mConnectedToCpu) {
         Surface::disconnect(NATIVE_WINDOW_API_CPU);
     }
@@ -615,11 +620,214 @@ void Surface::getDequeueBufferInputLocked(
     dequeueInput->getTimestamps = mEnableFrameTimestamps;
 }
 
+struct Surface::PrefetchedBuffer {
+    IGraphicBufferProducer::DequeueBufferInput input;
+    status_t result = NO_INIT;
+    int slot = -1;
+    sp<Fence> fence;
+    uint64_t bufferAge = 0;
+    FrameEventHistoryDelta frameTimestamps;
+    // How long IGraphicBufferProducer::dequeueBuffer took on the helper thread.
+    nsecs_t duration = 0;
+};
+
+// Runs IGraphicBufferProducer::dequeueBuffer on its own thread. The state is shared with that
+// thread so that a Surface can go away while a dequeue is still blocked.
+class Surface::DequeuePrefetcher {
+public:
+    explicit DequeuePrefetcher(sp<IGraphicBufferProducer> producer)
+          : mProducer(std::move(producer)) {}
+
+    static std::shared_ptr<DequeuePrefetcher> start(sp<IGraphicBufferProducer> producer) {
+        auto prefetcher = std::make_shared<DequeuePrefetcher>(std::move(producer));
+        std::thread([prefetcher] {
+            pthread_setname_np(pthread_self(), "DequeuePrefetch");
+            prefetcher->threadMain();
+        }).detach();
+        return prefetcher;
+    }
+
+    // Starts dequeueing a buffer, unless one is already dequeued or being dequeued.
+    void request(const IGraphicBufferProducer::DequeueBufferInput& input) {
+        std::lock_guard lock(mMutex);
+        if (mInFlight || mResult) {
+            return;
+        }
+        mRequest = input;
+        mCondition.notify_all();
+    }
+
+    // Waits for a dequeue that is in flight, and returns the buffer it dequeued, if any.
+    std::optional<PrefetchedBuffer> take() {
+        std::unique_lock lock(mMutex);
+        mRequest.reset();
+        if (mInFlight) {
+            ATRACE_NAME("waitForPrefetchedBuffer");
+            mCondition.wait(lock, [this] { return !mInFlight; });
+        }
+        return std::exchange(mResult, std::nullopt);
+    }
+
+    // Stops the thread and cancels its buffer, including one it is still dequeueing.
+    void stop() {
+        std::optional<PrefetchedBuffer> prefetched;
+        {
+            std::lock_guard lock(mMutex);
+            mStopped = true;
+            prefetched = std::exchange(mResult, std::nullopt);
+            mCondition.notify_all();
+        }
+        if (prefetched && prefetched->result >= 0) {
+            mProducer->cancelBuffer(prefetched->slot, prefetched->fence);
+        }
+    }
+
+private:
+    void threadMain() {
+        std::unique_lock lock(mMutex);
+        while (true) {
+            mCondition.wait(lock, [this] { return mStopped || mRequest; });
+            if (mStopped) {
+                return;
+            }
+
+            PrefetchedBuffer prefetched;
+            prefetched.input = *std::exchange(mRequest, std::nullopt);
+            mInFlight = true;
+            lock.unlock();
+
+            {
+                ATRACE_NAME("prefetchDequeueBuffer");
+                const nsecs_t startTime = systemTime();
+                const auto& input = prefetched.input;
+                prefetched.result =
+                        mProducer->dequeueBuffer(&prefetched.slot, &prefetched.fence, input.width,
+                                                 input.height, input.format, input.usage,
+                                                 &prefetched.bufferAge,
+                                                 input.getTimestamps ? &prefetched.frameTimestamps
+                                                                     : nullptr);
+                prefetched.duration = systemTime() - startTime;
+            }
+
+            lock.lock();
+            mInFlight = false;
+            mCondition.notify_all();
+            if (mStopped) {
+                lock.unlock();
+                if (prefetched.result >= 0) {
+                    mProducer->cancelBuffer(prefetched.slot, prefetched.fence);
+                }
+                return;
+            }
+            mResult = std::move(prefetched);
+        }
+    }
+
+    const sp<IGraphicBufferProducer> mProducer;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::optional<IGraphicBufferProducer::DequeueBufferInput> mRequest;
+    bool mInFlight = false;
+    std::optional<PrefetchedBuffer> mResult;
+    bool mStopped = false;
+};
+
+void Surface::enableDequeuePrefetch(bool enable) {
+    ATRACE_CALL();
+    Mutex::Autolock lock(mMutex);
+    if (enable == (mDequeuePrefetcher != nullptr)) {
+        return;
+    }
+    if (enable) {
+        mDequeuePrefetcher = DequeuePrefetcher::start(mGraphicBufferProducer);
+    } else {
+        discardPrefetchedBufferLocked();
+        mDequeuePrefetcher->stop();
+        mDequeuePrefetcher.reset();
+    }
+}
+
+bool Surface::takePrefetchedBuffer(const std::shared_ptr<DequeuePrefetcher>& prefetcher,
+                                   const IGraphicBufferProducer::DequeueBufferInput& input,
+                                   int* outSlot, sp<Fence>* outFence, status_t* outResult,
+                                   FrameEventHistoryDelta* outFrameTimestamps) {
+    if (!prefetcher) {
+        return false;
+    }
+
+    const nsecs_t startTime = systemTime();
+    std::optional<PrefetchedBuffer> prefetched = prefetcher->take();
+    if (!prefetched) {
+        return false;
+    }
+
+    const auto& prefetchedInput = prefetched->input;
+    if (prefetched->result < 0 || prefetchedInput.width != input.width ||
+        prefetchedInput.height != input.height || prefetchedInput.format != input.format ||
+        prefetchedInput.usage != input.usage ||
+        prefetchedInput.getTimestamps != input.getTimestamps) {
+        Mutex::Autolock lock(mMutex);
+        cancelPrefetchedBufferLocked(*prefetched, true /* cancel */);
+        return false;
+    }
+
+    const nsecs_t waitTime = systemTime() - startTime;
+    const nsecs_t savedTime = std::max(prefetched->duration - waitTime, nsecs_t{0});
+    ATRACE_FORMAT_INSTANT("dequeueBuffer prefetched, saved %" PRId64 "us", ns2us(savedTime));
+
+    *outSlot = prefetched->slot;
+    *outFence = std::move(prefetched->fence);
+    *outResult = prefetched->result;
+    *outFrameTimestamps = std::move(prefetched->frameTimestamps);
+    mBufferAge = prefetched->bufferAge;
+    return true;
+}
+
+void Surface::discardPrefetchedBufferLocked(bool cancel) {
+    if (!mDequeuePrefetcher) {
+        return;
+    }
+    if (std::optional<PrefetchedBuffer> prefetched = mDequeuePrefetcher->take()) {
+        cancelPrefetchedBufferLocked(*prefetched, cancel);
+    }
+}
+
+void Surface::cancelPrefetchedBufferLocked(PrefetchedBuffer& prefetched, bool cancel) {
+    if (prefetched.result < 0) {
+        return;
+    }
+    ATRACE_NAME("cancelPrefetchedBuffer");
+
+    // Keep the local state in step with the producer's, as if the buffer had been dequeued.
+    if (prefetched.result & IGraphicBufferProducer::RELEASE_ALL_BUFFERS) {
+        freeAllBuffers();
+    }
+    if (prefetched.input.getTimestamps) {
+        mFrameEventHistory->applyDelta(prefetched.frameTimestamps);
+    }
+    sp<GraphicBuffer>& gbuf(mSlots[prefetched.slot].buffer);
+    if ((prefetched.result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) &&
+        gbuf != nullptr) {
+        // The slot has a new buffer that was never requested, so request it when the slot is
+        // dequeued again.
+        if (mReportRemovedBuffers) {
+            mRemovedBuffers.push_back(gbuf);
+        }
+        gbuf = nullptr;
+    }
+
+    if (cancel) {
+        mGraphicBufferProducer->cancelBuffer(prefetched.slot, prefetched.fence);
+    }
+}
+
 int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
     ATRACE_FORMAT("dequeueBuffer - %s", getDebugName());
     ALOGV("Surface::dequeueBuffer");
 
     IGraphicBufferProducer::DequeueBufferInput dqInput;
+    std::shared_ptr<DequeuePrefetcher> prefetcher;
     {
         Mutex::Autolock lock(mMutex);
         if (mReportRemovedBuffers) {
@@ -627,6 +835,7 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
         }
 
         getDequeueBufferInputLocked(&dqInput);
+        prefetcher = mDequeuePrefetcher;
 
         if (mSharedBufferMode && mAutoRefresh && mSharedBufferSlot !=
                 BufferItem::INVALID_BUFFER_SLOT) {
@@ -644,11 +853,14 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
     nsecs_t startTime = systemTime();
 
     FrameEventHistoryDelta frameTimestamps;
-    status_t result = mGraphicBufferProducer->dequeueBuffer(&buf, &fence, dqInput.width,
-                                                            dqInput.height, dqInput.format,
-                                                            dqInput.usage, &mBufferAge,
-                                                            dqInput.getTimestamps ?
-                                                                    &frameTimestamps : nullptr);
+    status_t result;
+    if (!takePrefetchedBuffer(prefetcher, dqInput, &buf, &fence, &result, &frameTimestamps)) {
+        result = mGraphicBufferProducer->dequeueBuffer(&buf, &fence, dqInput.width,
+                                                       dqInput.height, dqInput.format,
+                                                       dqInput.usage, &mBufferAge,
+                                                       dqInput.getTimestamps ? &frameTimestamps
+                                                                             : nullptr);
+    }
     mLastDequeueDuration = systemTime() - startTime;
 
     if (result < 0) {
@@ -799,6 +1011,7 @@ int Surface::dequeueBuffers(std::vector<BatchBuffer>* buffers) {
         if (mReportRemovedBuffers) {
             mRemovedBuffers.clear();
         }
+        discardPrefetchedBufferLocked();
 
         getDequeueBufferInputLocked(&input);
     } // Drop the lock so that we can still touch the Surface while blocking in IGBP::dequeueBuffers
@@ -1188,6 +1401,13 @@ void Surface::onBufferQueuedLocked(int slot, sp<Fence> fence,
 
     mQueueBufferCondition.broadcast();
 
+    // Only prefetch when the next dequeue is the one that would block the render loop.
+    if (mDequeuePrefetcher && !mSharedBufferMode && mDequeuedSlots.empty()) {
+        IGraphicBufferProducer::DequeueBufferInput dequeueInput;
+        getDequeueBufferInputLocked(&dequeueInput);
+        mDequeuePrefetcher->request(dequeueInput);
+    }
+
     if (CC_UNLIKELY(atrace_is_tag_enabled(ATRACE_TAG_GRAPHICS))) {
         static gui::FenceMonitor gpuCompletionThread("GPU completion");
         gpuCompletionThread.queueFence(fence);
@@ -2132,6 +2352,8 @@ int Surface::disconnect(int api, IGraphicBufferProducer::DisconnectMode mode) {
     mSharedBufferHasBeenQueued = false;
     freeAllBuffers();
     int err = mGraphicBufferProducer->disconnect(api, mode);
+    // Disconnecting unblocks a prefetch in flight, and frees any buffer it dequeued.
+    discardPrefetchedBufferLocked(false /* cancel */);
     if (!err) {
         mReqFormat = 0;
         mReqWidth = 0;
@@ -2174,6 +2396,7 @@ int Surface::detachNextBuffer(sp<GraphicBuffer>* outBuffer,
     if (mReportRemovedBuffers) {
         mRemovedBuffers.clear();
     }
+    discardPrefetchedBufferLocked();
 
     sp<GraphicBuffer> buffer(nullptr);
     sp<Fence> fence(nullptr);
@@ -2212,6 +2435,7 @@ int Surface::attachBuffer(ANativeWindowBuffer* buffer)
     if (mReportRemovedBuffers) {
         mRemovedBuffers.clear();
     }
+    discardPrefetchedBufferLocked();
 
     sp<GraphicBuffer> graphicBuffer(static_cast<GraphicBuffer*>(buffer));
     uint32_t priorGeneration = graphicBuffer->mGenerationNumber;
@@ -2267,6 +2491,7 @@ int Surface::setBufferCount(int bufferCount)
     ATRACE_CALL();
     ALOGV("Surface::setBufferCount");
     Mutex::Autolock lock(mMutex);
+    discardPrefetchedBufferLocked();
 
     status_t err = NO_ERROR;
     if (bufferCount == 0) {
@@ -2291,6 +2516,7 @@ int Surface::setMaxDequeuedBufferCount(int maxDequeuedBuffers) {
     ATRACE_CALL();
     ALOGV("Surface::setMaxDequeuedBufferCount");
     Mutex::Autolock lock(mMutex);
+    discardPrefetchedBufferLocked();
 
     status_t err = mGraphicBufferProducer->setMaxDequeuedBufferCount(
             maxDequeuedBuffers);
@@ -2304,6 +2530,7 @@ int Surface::setAsyncMode(bool async) {
     ATRACE_CALL();
     ALOGV("Surface::setAsyncMode");
     Mutex::Autolock lock(mMutex);
+    discardPrefetchedBufferLocked();
 
     status_t err = mGraphicBufferProducer->setAsyncMode(async);
     ALOGE_IF(err, "IGraphicBufferProducer::setAsyncMode(%d) returned %s",
@@ -2316,6 +2543,7 @@ int Surface::setSharedBufferMode(bool sharedBufferMode) {
     ATRACE_CALL();
     ALOGV("Surface::setSharedBufferMode (%d)", sharedBufferMode);
     Mutex::Autolock lock(mMutex);
+    discardPrefetchedBufferLocked();
 
     status_t err = mGraphicBufferProducer->setSharedBufferMode(
             sharedBufferMode);
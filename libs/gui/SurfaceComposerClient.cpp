@@ -39,6 +39,7 @@
 
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
+#include <binder/ParcelFileDescriptor.h>
 #include <binder/ProcessState.h>
 
 #include <system/graphics.h>
@@ -51,6 +52,7 @@
 #include <gui/LayerState.h>
 #include <gui/Surface.h>
 #include <gui/SurfaceComposerClient.h>
+#include <gui/TransactionChannel.h>
 #include <gui/WindowInfo.h>
 #include <private/gui/ParcelUtils.h>
 #include <ui/DisplayMode.h>
@@ -91,6 +93,121 @@ int64_t generateId() {
 
 constexpr int64_t INVALID_VSYNC = -1;
 
+// Producer side of the process' TransactionChannel, see gui/TransactionChannel.h.
+class TransactionChannelClient {
+public:
+    static TransactionChannelClient& getInstance() {
+        static TransactionChannelClient sInstance;
+        return sInstance;
+    }
+
+    void setEnabled(bool enabled) {
+        std::scoped_lock lock(mMutex);
+        mEnabled = enabled;
+        if (!enabled) {
+            mProducer.reset();
+            mApplyToken.clear();
+            mRegisteredLayerIds.clear();
+        }
+    }
+
+    bool isEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+    // Sends the message over the channel. Returns false if the transaction has to be sent through
+    // binder instead.
+    bool send(const gui::TransactionChannel::Message& message,
+              const std::vector<sp<IBinder>>& layerHandles, const sp<IBinder>& applyToken) {
+        std::scoped_lock lock(mMutex);
+        if (!mEnabled || mFailed) {
+            return false;
+        }
+        if (!mProducer && !connectLocked(applyToken)) {
+            mFailed = true;
+            return false;
+        }
+        // SurfaceFlinger applies channel transactions with the token the channel was set up with.
+        if (applyToken != mApplyToken) {
+            return false;
+        }
+
+        for (size_t i = 0; i < message.layerUpdates.size(); i++) {
+            const int32_t layerId = message.layerUpdates[i].layerId;
+            if (mRegisteredLayerIds.count(layerId)) {
+                continue;
+            }
+            int32_t registeredLayerId = -1;
+            binder::Status status =
+                    ComposerServiceAIDL::getComposerService()
+                            ->registerTransactionChannelLayer(layerHandles[i], &registeredLayerId);
+            if (!status.isOk() || registeredLayerId != layerId) {
+                ALOGW("Failed to register layer %d with the transaction channel", layerId);
+                return false;
+            }
+            mRegisteredLayerIds.insert(layerId);
+        }
+
+        if (status_t err = mProducer->writeMessage(message); err != OK) {
+            // Stop using the channel rather than risk reordering transactions. Whatever was
+            // written so far is drained before the next binder transaction is applied.
+            ALOGW("Failed to write to the transaction channel: %s", statusToString(err).c_str());
+            mProducer.reset();
+            mFailed = true;
+            return false;
+        }
+        return true;
+    }
+
+    // Calls sendTransaction to send the transaction with the given id through binder. If the
+    // channel is in use, SurfaceFlinger is told first so it can place the transaction between the
+    // ones sent over the channel.
+    template <typename F>
+    void sendBinderTransaction(uint64_t transactionId, F&& sendTransaction) {
+        if (!isEnabled()) {
+            sendTransaction();
+            return;
+        }
+
+        std::scoped_lock lock(mMutex);
+        if (mProducer) {
+            gui::TransactionChannel::Message barrier;
+            barrier.type = gui::TransactionChannel::MessageType::BinderBarrier;
+            barrier.transactionId = transactionId;
+            if (mProducer->writeMessage(barrier) != OK) {
+                mProducer.reset();
+                mFailed = true;
+            }
+        }
+        sendTransaction();
+    }
+
+private:
+    bool connectLocked(const sp<IBinder>& applyToken) REQUIRES(mMutex) {
+        base::unique_fd consumerFd;
+        std::unique_ptr<gui::TransactionChannel::ProducerEndpoint> producer;
+        if (gui::TransactionChannel::open("TransactionChannel", consumerFd, producer) != OK) {
+            return false;
+        }
+        binder::Status status = ComposerServiceAIDL::getComposerService()
+                                        ->setTransactionChannel(os::ParcelFileDescriptor(
+                                                                        std::move(consumerFd)),
+                                                                applyToken);
+        if (!status.isOk()) {
+            ALOGW("Failed to set up the transaction channel: %s", status.toString8().c_str());
+            return false;
+        }
+        mProducer = std::move(producer);
+        mApplyToken = applyToken;
+        return true;
+    }
+
+    std::atomic<bool> mEnabled = false;
+    std::mutex mMutex;
+    bool mFailed GUARDED_BY(mMutex) = false;
+    std::unique_ptr<gui::TransactionChannel::ProducerEndpoint> mProducer GUARDED_BY(mMutex);
+    sp<IBinder> mApplyToken GUARDED_BY(mMutex);
+    std::unordered_set<int32_t> mRegisteredLayerIds GUARDED_BY(mMutex);
+};
+
 } // namespace
 
 const std::string SurfaceComposerClient::kEmpty{};
@@ -471,6 +588,13 @@ void TransactionCompletedListener::addSurfaceControlToCallbacks(
 }
 
 void TransactionCompletedListener::onTransactionCompleted(ListenerStats listenerStats) {
+    // Buffers released in the same frame are batched with the transaction stats, and are
+    // delivered first, in the order they were released.
+    for (const auto& releasedBuffer : listenerStats.releasedBuffers) {
+        onReleaseBuffer(releasedBuffer.callbackId, releasedBuffer.releaseFence,
+                        releasedBuffer.currentMaxAcquiredBufferCount);
+    }
+
     std::unordered_map<CallbackId, CallbackTranslation, CallbackIdHash> callbacksMap;
     {
         std::lock_guard<std::mutex> lock(mMutex);
@@ -737,6 +861,8 @@ void removeDeadBufferCallback(void* /*context*/, uint64_t graphicBufferId);
  *        transaction.
  *     3. The client only references the Buffers by ID, and uses buffer->addDeathCallback
  *        to auto-evict destroyed buffers.
+ *     4. When the server runs over its memory budget it evicts entries on its own and
+ *        notifies the client through onBufferUncached, which drops them from this cache.
  */
 class BufferCache : public Singleton<BufferCache> {
 public:
@@ -780,6 +906,12 @@ public:
         }
     }
 
+    // Drops a buffer that the server has already uncached, without telling it again.
+    void forget(uint64_t cacheId) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBuffers.erase(cacheId);
+    }
+
 private:
     client_cache_t findLeastRecentlyUsedBuffer() REQUIRES(mMutex) {
         auto itr = mBuffers.begin();
@@ -818,6 +950,10 @@ void removeDeadBufferCallback(void* /*context*/, uint64_t graphicBufferId) {
     BufferCache::getInstance().uncache(graphicBufferId);
 }
 
+void TransactionCompletedListener::onBufferUncached(uint64_t cacheId) {
+    BufferCache::getInstance().forget(cacheId);
+}
+
 // ---------------------------------------------------------------------------
 
 SurfaceComposerClient::Transaction::Transaction() {
@@ -1345,11 +1481,27 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous, bool oneWay
 
     sp<IBinder> applyToken = mApplyToken ? mApplyToken : getDefaultApplyToken();
 
-    sp<ISurfaceComposer> sf(ComposerService::getComposerService());
-    sf->setTransactionState(mFrameTimelineInfo, composerStates, displayStates, flags, applyToken,
-                            mInputWindowCommands, mDesiredPresentTime, mIsAutoTimestamp,
-                            mUncacheBuffers, hasListenerCallbacks, listenerCallbacks, mId,
-                            mMergedTransactionIds);
+    if (com::android::graphics::libgui::flags::transaction_channel() && !synchronous &&
+        displayStates.empty() && TransactionChannelClient::getInstance().isEnabled() &&
+        applyThroughTransactionChannel(flags, applyToken)) {
+        mId = generateId();
+        clear();
+        mStatus = NO_ERROR;
+        return NO_ERROR;
+    }
+
+    const auto sendTransaction = [&] {
+        sp<ISurfaceComposer> sf(ComposerService::getComposerService());
+        sf->setTransactionState(mFrameTimelineInfo, composerStates, displayStates, flags,
+                                applyToken, mInputWindowCommands, mDesiredPresentTime,
+                                mIsAutoTimestamp, mUncacheBuffers, hasListenerCallbacks,
+                                listenerCallbacks, mId, mMergedTransactionIds);
+    };
+    if (com::android::graphics::libgui::flags::transaction_channel()) {
+        TransactionChannelClient::getInstance().sendBinderTransaction(mId, sendTransaction);
+    } else {
+        sendTransaction();
+    }
     mId = generateId();
 
     // Clear the current states and flags
@@ -1363,6 +1515,37 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous, bool oneWay
     return NO_ERROR;
 }
 
+bool SurfaceComposerClient::Transaction::applyThroughTransactionChannel(
+        uint32_t flags, const sp<IBinder>& applyToken) {
+    if (mComposerStates.empty() ||
+        mComposerStates.size() > gui::TransactionChannel::kMaxLayerUpdates ||
+        !mListenerCallbacks.empty() || !mInputWindowCommands.empty() ||
+        !mUncacheBuffers.empty() || !mMergedTransactionIds.empty() || mEarlyWakeupStart ||
+        mEarlyWakeupEnd || !mIsAutoTimestamp ||
+        mFrameTimelineInfo.vsyncId != FrameTimelineInfo::INVALID_VSYNC_ID) {
+        return false;
+    }
+
+    gui::TransactionChannel::Message message;
+    message.transactionId = mId;
+    message.flags = flags & ISurfaceComposer::eAnimation;
+    std::vector<sp<IBinder>> layerHandles;
+    layerHandles.reserve(mComposerStates.size());
+    for (const auto& [_, composerState] : mComposerStates) {
+        const layer_state_t& state = composerState.state;
+        if ((state.what & ~gui::TransactionChannel::kSupportedChanges) || !state.surface) {
+            return false;
+        }
+        message.layerUpdates.push_back(gui::TransactionChannel::LayerUpdate::fromLayerState(state));
+        layerHandles.push_back(state.surface);
+    }
+    return TransactionChannelClient::getInstance().send(message, layerHandles, applyToken);
+}
+
+void SurfaceComposerClient::Transaction::setTransactionChannelEnabled(bool enabled) {
+    TransactionChannelClient::getInstance().setEnabled(enabled);
+}
+
 sp<IBinder> SurfaceComposerClient::Transaction::sApplyToken = new BBinder();
 
 std::mutex SurfaceComposerClient::Transaction::sApplyTokenMutex;
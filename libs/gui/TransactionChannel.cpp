@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "TransactionChannel"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include <gui/TransactionChannel.h>
+#include <utils/Log.h>
+
+namespace android::gui {
+
+namespace {
+
+// Every field is written as a 32 bit value so the wire format doesn't depend on the alignment
+// rules of the producer's or consumer's ABI.
+constexpr size_t kHeaderSize = 5 * sizeof(uint32_t);
+constexpr size_t kLayerUpdateSize = 18 * sizeof(uint32_t);
+
+template <typename T>
+static inline constexpr uint32_t low32(const T n) {
+    return static_cast<uint32_t>(static_cast<uint64_t>(n));
+}
+
+template <typename T>
+static inline constexpr uint32_t high32(const T n) {
+    return static_cast<uint32_t>(static_cast<uint64_t>(n) >> 32);
+}
+
+template <typename T>
+static inline constexpr T to64(const uint32_t lo, const uint32_t hi) {
+    return static_cast<T>(static_cast<uint64_t>(hi) << 32 | lo);
+}
+
+} // namespace
+
+TransactionChannel::LayerUpdate TransactionChannel::LayerUpdate::fromLayerState(
+        const layer_state_t& state) {
+    LayerUpdate update;
+    update.layerId = state.layerId;
+    update.what = state.what & kSupportedChanges;
+    update.x = state.x;
+    update.y = state.y;
+    update.z = state.z;
+    update.alpha = state.color.a;
+    update.matrix = state.matrix;
+    update.crop = state.crop;
+    update.cornerRadius = state.cornerRadius;
+    return update;
+}
+
+void TransactionChannel::LayerUpdate::applyTo(layer_state_t& state) const {
+    state.layerId = layerId;
+    state.what = what & kSupportedChanges;
+    state.x = x;
+    state.y = y;
+    state.z = z;
+    state.color.a = alpha;
+    state.matrix = matrix;
+    state.crop = crop;
+    state.cornerRadius = cornerRadius;
+}
+
+size_t TransactionChannel::Message::getFlattenedSize() const {
+    return kHeaderSize + layerUpdates.size() * kLayerUpdateSize;
+}
+
+status_t TransactionChannel::Message::flatten(void* buffer, size_t size) const {
+    if (size < getFlattenedSize() || layerUpdates.size() > kMaxLayerUpdates) {
+        return NO_MEMORY;
+    }
+
+    FlattenableUtils::write(buffer, size, static_cast<uint32_t>(type));
+    FlattenableUtils::write(buffer, size, low32(transactionId));
+    FlattenableUtils::write(buffer, size, high32(transactionId));
+    FlattenableUtils::write(buffer, size, flags);
+    FlattenableUtils::write(buffer, size, static_cast<uint32_t>(layerUpdates.size()));
+    for (const LayerUpdate& update : layerUpdates) {
+        FlattenableUtils::write(buffer, size, update.layerId);
+        FlattenableUtils::write(buffer, size, low32(update.what));
+        FlattenableUtils::write(buffer, size, high32(update.what));
+        FlattenableUtils::write(buffer, size, update.x);
+        FlattenableUtils::write(buffer, size, update.y);
+        FlattenableUtils::write(buffer, size, update.z);
+        FlattenableUtils::write(buffer, size, update.alpha);
+        FlattenableUtils::write(buffer, size, update.matrix.dsdx);
+        FlattenableUtils::write(buffer, size, update.matrix.dtdx);
+        FlattenableUtils::write(buffer, size, update.matrix.dtdy);
+        FlattenableUtils::write(buffer, size, update.matrix.dsdy);
+        FlattenableUtils::write(buffer, size, update.crop.left);
+        FlattenableUtils::write(buffer, size, update.crop.top);
+        FlattenableUtils::write(buffer, size, update.crop.right);
+        FlattenableUtils::write(buffer, size, update.crop.bottom);
+        FlattenableUtils::write(buffer, size, update.cornerRadius);
+    }
+    return OK;
+}
+
+status_t TransactionChannel::Message::unflatten(void const* buffer, size_t size) {
+    if (size < kHeaderSize) {
+        return BAD_VALUE;
+    }
+
+    uint32_t rawType = 0;
+    uint32_t transactionIdLo = 0, transactionIdHi = 0;
+    uint32_t layerUpdateCount = 0;
+    FlattenableUtils::read(buffer, size, rawType);
+    if (rawType > static_cast<uint32_t>(MessageType::BinderBarrier)) {
+        return BAD_VALUE;
+    }
+    type = static_cast<MessageType>(rawType);
+    FlattenableUtils::read(buffer, size, transactionIdLo);
+    FlattenableUtils::read(buffer, size, transactionIdHi);
+    transactionId = to64<uint64_t>(transactionIdLo, transactionIdHi);
+    FlattenableUtils::read(buffer, size, flags);
+    FlattenableUtils::read(buffer, size, layerUpdateCount);
+    // The size must match exactly, the data comes from an untrusted process.
+    if (layerUpdateCount > kMaxLayerUpdates || size != layerUpdateCount * kLayerUpdateSize) {
+        return BAD_VALUE;
+    }
+
+    layerUpdates.resize(layerUpdateCount);
+    for (LayerUpdate& update : layerUpdates) {
+        uint32_t whatLo = 0, whatHi = 0;
+        FlattenableUtils::read(buffer, size, update.layerId);
+        FlattenableUtils::read(buffer, size, whatLo);
+        FlattenableUtils::read(buffer, size, whatHi);
+        update.what = to64<uint64_t>(whatLo, whatHi) & kSupportedChanges;
+        FlattenableUtils::read(buffer, size, update.x);
+        FlattenableUtils::read(buffer, size, update.y);
+        FlattenableUtils::read(buffer, size, update.z);
+        FlattenableUtils::read(buffer, size, update.alpha);
+        FlattenableUtils::read(buffer, size, update.matrix.dsdx);
+        FlattenableUtils::read(buffer, size, update.matrix.dtdx);
+        FlattenableUtils::read(buffer, size, update.matrix.dtdy);
+        FlattenableUtils::read(buffer, size, update.matrix.dsdy);
+        FlattenableUtils::read(buffer, size, update.crop.left);
+        FlattenableUtils::read(buffer, size, update.crop.top);
+        FlattenableUtils::read(buffer, size, update.crop.right);
+        FlattenableUtils::read(buffer, size, update.crop.bottom);
+        FlattenableUtils::read(buffer, size, update.cornerRadius);
+    }
+    return OK;
+}
+
+TransactionChannel::ConsumerEndpoint::ConsumerEndpoint(std::string name,
+                                                       android::base::unique_fd fd)
+      : mName(std::move(name)), mFd(std::move(fd)) {
+    // The consumer may be handed over by another process, don't rely on its socket flags.
+    const int flags = fcntl(mFd.get(), F_GETFL, 0);
+    if (flags == -1 || fcntl(mFd.get(), F_SETFL, flags | O_NONBLOCK) == -1) {
+        ALOGE("[%s] Failed to set consumer socket to non-blocking mode. errno=%d message='%s'",
+              mName.c_str(), errno, strerror(errno));
+    }
+}
+
+status_t TransactionChannel::ConsumerEndpoint::readMessage(Message& outMessage) {
+    // One extra byte so a message that is too large is truncated and rejected below.
+    mFlattenedBuffer.resize(kHeaderSize + kMaxLayerUpdates * kLayerUpdateSize + 1);
+
+    ssize_t result;
+    do {
+        result = recv(mFd.get(), mFlattenedBuffer.data(), mFlattenedBuffer.size(), MSG_DONTWAIT);
+    } while (result == -1 && errno == EINTR);
+    if (result == -1) {
+        if (errno == EWOULDBLOCK || errno == EAGAIN) {
+            return WOULD_BLOCK;
+        }
+        ALOGE("[%s] Error reading transaction from socket: error %#x (%s)", mName.c_str(), errno,
+              strerror(errno));
+        return UNKNOWN_ERROR;
+    }
+    if (result == 0) {
+        return DEAD_OBJECT;
+    }
+
+    if (status_t err = outMessage.unflatten(mFlattenedBuffer.data(), static_cast<size_t>(result));
+        err != OK) {
+        ALOGE("[%s] Error reading transaction from socket: malformed message", mName.c_str());
+        return err;
+    }
+    return OK;
+}
+
+status_t TransactionChannel::ProducerEndpoint::writeMessage(const Message& message) {
+    mFlattenedBuffer.resize(message.getFlattenedSize());
+    if (status_t err = message.flatten(mFlattenedBuffer.data(), mFlattenedBuffer.size());
+        err != OK) {
+        ALOGE("[%s] Failed to flatten TransactionChannel message.", mName.c_str());
+        return err;
+    }
+
+    ssize_t result;
+    do {
+        result = send(mFd.get(), mFlattenedBuffer.data(), mFlattenedBuffer.size(),
+                      MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (result == -1 && errno == EINTR);
+    if (result == -1) {
+        if (errno == EWOULDBLOCK || errno == EAGAIN) {
+            return WOULD_BLOCK;
+        }
+        ALOGD("[%s] Error writing transaction to socket: error %#x (%s)", mName.c_str(), errno,
+              strerror(errno));
+        return -errno;
+    }
+    return OK;
+}
+
+status_t TransactionChannel::open(std::string name, android::base::unique_fd& outConsumerFd,
+                                  std::unique_ptr<ProducerEndpoint>& outProducer) {
+    outConsumerFd.reset();
+    outProducer.reset();
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets)) {
+        ALOGE("[%s] Failed to create socket pair. errorno=%d message='%s'", name.c_str(), errno,
+              strerror(errno));
+        return -errno;
+    }
+
+    android::base::unique_fd consumerFd(sockets[0]);
+    android::base::unique_fd producerFd(sockets[1]);
+
+    // Socket buffer size. A frame rarely has more than a handful of transactions in flight.
+    size_t bufferSize = 16 * 1024;
+    if (setsockopt(producerFd.get(), SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize)) ==
+        -1) {
+        ALOGE("[%s] Failed to set producer socket send buffer size. errno=%d message='%s'",
+              name.c_str(), errno, strerror(errno));
+        return -errno;
+    }
+
+    // Make the consumer read-only
+    if (shutdown(consumerFd.get(), SHUT_WR) == -1) {
+        ALOGE("[%s] Failed to shutdown writing on consumer socket. errno=%d message='%s'",
+              name.c_str(), errno, strerror(errno));
+        return -errno;
+    }
+
+    // Make the producer write-only
+    if (shutdown(producerFd.get(), SHUT_RD) == -1) {
+        ALOGE("[%s] Failed to shutdown reading on producer socket. errno=%d message='%s'",
+              name.c_str(), errno, strerror(errno));
+        return -errno;
+    }
+
+    outConsumerFd = std::move(consumerFd);
+    outProducer = std::make_unique<ProducerEndpoint>(std::move(name), std::move(producerFd));
+    return OK;
+}
+
+} // namespace android::gui
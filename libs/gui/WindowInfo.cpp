@@ -59,6 +59,68 @@ std::ostream& operator<<(std::ostream& out, const Region& region) {
     return out;
 }
 
+// How the transform is written to the parcel. Most windows are only translated, if at all, so
+// only the components that are not implied by the type of the transform are written.
+enum class ParcelledTransform : uint8_t {
+    IDENTITY,
+    TRANSLATE,
+    MATRIX,
+};
+
+// How the touchable region is written to the parcel. Most windows are touchable in a single
+// rect, which is written without the header and rect array of a flattened Region.
+enum class ParcelledRegion : uint8_t {
+    EMPTY,
+    RECT,
+    RECTS,
+};
+
+// The fields of WindowInfo that have a fixed size, which are written to the parcel as one block
+// and read back with a single copy.
+struct FixedFields {
+    int64_t dispatchingTimeout;
+    int32_t id;
+    int32_t layoutParamsFlags;
+    int32_t layoutParamsType;
+    Rect frame;
+    int32_t contentWidth;
+    int32_t contentHeight;
+    int32_t surfaceInset;
+    float globalScaleFactor;
+    float alpha;
+    int32_t touchOcclusionMode;
+    int32_t ownerPid;
+    int32_t ownerUid;
+    int32_t inputConfig;
+    int32_t displayId;
+    ParcelledTransform transform;
+    ParcelledRegion touchableRegion;
+    uint8_t replaceTouchableRegionWithCrop;
+    uint8_t canOccludePresentation;
+};
+
+static_assert(std::is_trivially_copyable_v<FixedFields>);
+// The parcel pads every write to 4 bytes, so the block wastes none.
+static_assert(sizeof(FixedFields) % 4 == 0);
+
+ParcelledTransform getParcelledTransform(const ui::Transform& transform) {
+    switch (transform.getType()) {
+        case ui::Transform::IDENTITY:
+            return ParcelledTransform::IDENTITY;
+        case ui::Transform::TRANSLATE:
+            return ParcelledTransform::TRANSLATE;
+        default:
+            return ParcelledTransform::MATRIX;
+    }
+}
+
+ParcelledRegion getParcelledRegion(const Region& region) {
+    if (region.isEmpty()) {
+        return ParcelledRegion::EMPTY;
+    }
+    return region.isRect() ? ParcelledRegion::RECT : ParcelledRegion::RECTS;
+}
+
 } // namespace
 
 void WindowInfo::setInputConfig(ftl::Flags<InputConfig> config, bool value) {
@@ -105,6 +167,12 @@ bool WindowInfo::operator==(const WindowInfo& info) const {
             info.canOccludePresentation == canOccludePresentation;
 }
 
+bool WindowInfo::hasSameContent(const WindowInfo& other) const {
+    return *this == other && other.windowToken == windowToken && other.alpha == alpha &&
+            other.touchableRegionCropHandle == touchableRegionCropHandle &&
+            other.focusTransferTarget == focusTransferTarget;
+}
+
 status_t WindowInfo::writeToParcel(android::Parcel* parcel) const {
     if (parcel == nullptr) {
         ALOGE("%s: Null parcel", __func__);
@@ -121,41 +189,78 @@ status_t WindowInfo::writeToParcel(android::Parcel* parcel) const {
     static_assert(sizeof(ownerPid.val()) == 4u);
     static_assert(sizeof(ownerUid.val()) == 4u);
 
+    const ParcelledTransform parcelledTransform = getParcelledTransform(transform);
+    const ParcelledRegion parcelledRegion = getParcelledRegion(touchableRegion);
+
+    const FixedFields fixed{
+            .dispatchingTimeout = dispatchingTimeout.count(),
+            .id = id,
+            .layoutParamsFlags = static_cast<int32_t>(layoutParamsFlags.get()),
+            .layoutParamsType = static_cast<int32_t>(layoutParamsType),
+            .frame = frame,
+            .contentWidth = contentSize.width,
+            .contentHeight = contentSize.height,
+            .surfaceInset = surfaceInset,
+            .globalScaleFactor = globalScaleFactor,
+            .alpha = alpha,
+            .touchOcclusionMode = static_cast<int32_t>(touchOcclusionMode),
+            .ownerPid = ownerPid.val(),
+            .ownerUid = static_cast<int32_t>(ownerUid.val()),
+            .inputConfig = static_cast<int32_t>(inputConfig.get()),
+            .displayId = displayId.val(),
+            .transform = parcelledTransform,
+            .touchableRegion = parcelledRegion,
+            .replaceTouchableRegionWithCrop = replaceTouchableRegionWithCrop,
+            .canOccludePresentation = canOccludePresentation,
+    };
+
+    status_t status = parcel->write(&fixed, sizeof(fixed));
+    if (status != OK) {
+        return status;
+    }
+
+    switch (parcelledTransform) {
+        case ParcelledTransform::IDENTITY:
+            break;
+        case ParcelledTransform::TRANSLATE: {
+            const float translation[] = {transform.tx(), transform.ty()};
+            status = parcel->write(translation, sizeof(translation));
+            break;
+        }
+        case ParcelledTransform::MATRIX: {
+            const float matrix[] = {transform.dsdx(), transform.dtdx(), transform.tx(),
+                                    transform.dtdy(), transform.dsdy(), transform.ty()};
+            status = parcel->write(matrix, sizeof(matrix));
+            break;
+        }
+    }
+    if (status != OK) {
+        return status;
+    }
+
+    switch (parcelledRegion) {
+        case ParcelledRegion::EMPTY:
+            break;
+        case ParcelledRegion::RECT:
+            status = parcel->write(touchableRegion.getBounds());
+            break;
+        case ParcelledRegion::RECTS:
+            status = parcel->write(touchableRegion);
+            break;
+    }
+    if (status != OK) {
+        return status;
+    }
+
     // clang-format off
-    status_t status = parcel->writeStrongBinder(token) ?:
-        parcel->writeInt64(dispatchingTimeout.count()) ?:
-        parcel->writeInt32(id) ?:
-        parcel->writeUtf8AsUtf16(name) ?:
-        parcel->writeInt32(layoutParamsFlags.get()) ?:
-        parcel->writeInt32(
-                static_cast<std::underlying_type_t<WindowInfo::Type>>(layoutParamsType)) ?:
-        parcel->write(frame) ?:
-        parcel->writeInt32(contentSize.width) ?:
-        parcel->writeInt32(contentSize.height) ?:
-        parcel->writeInt32(surfaceInset) ?:
-        parcel->writeFloat(globalScaleFactor) ?:
-        parcel->writeFloat(alpha) ?:
-        parcel->writeFloat(transform.dsdx()) ?:
-        parcel->writeFloat(transform.dtdx()) ?:
-        parcel->writeFloat(transform.tx()) ?:
-        parcel->writeFloat(transform.dtdy()) ?:
-        parcel->writeFloat(transform.dsdy()) ?:
-        parcel->writeFloat(transform.ty()) ?:
-        parcel->writeInt32(static_cast<int32_t>(touchOcclusionMode)) ?:
-        parcel->writeInt32(ownerPid.val()) ?:
-        parcel->writeInt32(ownerUid.val()) ?:
-        parcel->writeUtf8AsUtf16(packageName) ?:
-        parcel->writeInt32(inputConfig.get()) ?:
-        parcel->writeInt32(displayId.val()) ?:
+    return parcel->writeString8(name.c_str(), name.size()) ?:
+        parcel->writeString8(packageName.c_str(), packageName.size()) ?:
         applicationInfo.writeToParcel(parcel) ?:
-        parcel->write(touchableRegion) ?:
-        parcel->writeBool(replaceTouchableRegionWithCrop) ?:
+        parcel->writeStrongBinder(token) ?:
         parcel->writeStrongBinder(touchableRegionCropHandle.promote()) ?:
         parcel->writeStrongBinder(windowToken) ?:
-        parcel->writeStrongBinder(focusTransferTarget) ?:
-        parcel->writeBool(canOccludePresentation);
+        parcel->writeStrongBinder(focusTransferTarget);
     // clang-format on
-    return status;
 }
 
 status_t WindowInfo::readFromParcel(const android::Parcel* parcel) {
@@ -167,62 +272,100 @@ status_t WindowInfo::readFromParcel(const android::Parcel* parcel) {
         return OK;
     }
 
-    token = parcel->readStrongBinder();
-    dispatchingTimeout = static_cast<decltype(dispatchingTimeout)>(parcel->readInt64());
-    status_t status = parcel->readInt32(&id) ?: parcel->readUtf8FromUtf16(&name);
+    FixedFields fixed;
+    status_t status = parcel->read(&fixed, sizeof(fixed));
+    if (status != OK) {
+        return status;
+    }
+
+    switch (fixed.transform) {
+        case ParcelledTransform::IDENTITY:
+            transform.reset();
+            break;
+        case ParcelledTransform::TRANSLATE: {
+            float translation[2];
+            status = parcel->read(translation, sizeof(translation));
+            transform.reset();
+            transform.set(translation[0], translation[1]);
+            break;
+        }
+        case ParcelledTransform::MATRIX: {
+            float m[6];
+            status = parcel->read(m, sizeof(m));
+            transform.set({m[0], m[1], m[2], m[3], m[4], m[5], 0, 0, 1});
+            break;
+        }
+        default:
+            return BAD_VALUE;
+    }
+    if (status != OK) {
+        return status;
+    }
+
+    switch (fixed.touchableRegion) {
+        case ParcelledRegion::EMPTY:
+            touchableRegion.clear();
+            break;
+        case ParcelledRegion::RECT: {
+            Rect rect;
+            status = parcel->read(rect);
+            touchableRegion.set(rect);
+            break;
+        }
+        case ParcelledRegion::RECTS:
+            status = parcel->read(touchableRegion);
+            break;
+        default:
+            return BAD_VALUE;
+    }
     if (status != OK) {
         return status;
     }
 
-    float dsdx, dtdx, tx, dtdy, dsdy, ty;
-    int32_t lpFlags, lpType, touchOcclusionModeInt, inputConfigInt, ownerPidInt, ownerUidInt,
-            displayIdInt;
+    // The strings are copied straight out of the parcel, without converting them from UTF-16.
+    size_t length;
+    const char* string = parcel->readString8Inplace(&length);
+    if (string == nullptr) {
+        return BAD_VALUE;
+    }
+    name.assign(string, length);
+    string = parcel->readString8Inplace(&length);
+    if (string == nullptr) {
+        return BAD_VALUE;
+    }
+    packageName.assign(string, length);
+
     sp<IBinder> touchableRegionCropHandleSp;
 
     // clang-format off
-    status = parcel->readInt32(&lpFlags) ?:
-        parcel->readInt32(&lpType) ?:
-        parcel->read(frame) ?:
-        parcel->readInt32(&contentSize.width) ?:
-        parcel->readInt32(&contentSize.height) ?:
-        parcel->readInt32(&surfaceInset) ?:
-        parcel->readFloat(&globalScaleFactor) ?:
-        parcel->readFloat(&alpha) ?:
-        parcel->readFloat(&dsdx) ?:
-        parcel->readFloat(&dtdx) ?:
-        parcel->readFloat(&tx) ?:
-        parcel->readFloat(&dtdy) ?:
-        parcel->readFloat(&dsdy) ?:
-        parcel->readFloat(&ty) ?:
-        parcel->readInt32(&touchOcclusionModeInt) ?:
-        parcel->readInt32(&ownerPidInt) ?:
-        parcel->readInt32(&ownerUidInt) ?:
-        parcel->readUtf8FromUtf16(&packageName) ?:
-        parcel->readInt32(&inputConfigInt) ?:
-        parcel->readInt32(&displayIdInt) ?:
-        applicationInfo.readFromParcel(parcel) ?:
-        parcel->read(touchableRegion) ?:
-        parcel->readBool(&replaceTouchableRegionWithCrop) ?:
+    status = applicationInfo.readFromParcel(parcel) ?:
+        parcel->readNullableStrongBinder(&token) ?:
         parcel->readNullableStrongBinder(&touchableRegionCropHandleSp) ?:
         parcel->readNullableStrongBinder(&windowToken) ?:
-        parcel->readNullableStrongBinder(&focusTransferTarget) ?:
-        parcel->readBool(&canOccludePresentation);
-
+        parcel->readNullableStrongBinder(&focusTransferTarget);
     // clang-format on
 
     if (status != OK) {
         return status;
     }
 
-    layoutParamsFlags = ftl::Flags<Flag>(lpFlags);
-    layoutParamsType = static_cast<Type>(lpType);
-    transform.set({dsdx, dtdx, tx, dtdy, dsdy, ty, 0, 0, 1});
-    touchOcclusionMode = static_cast<TouchOcclusionMode>(touchOcclusionModeInt);
-    inputConfig = ftl::Flags<InputConfig>(inputConfigInt);
-    ownerPid = Pid{ownerPidInt};
-    ownerUid = Uid{static_cast<uid_t>(ownerUidInt)};
+    dispatchingTimeout = static_cast<decltype(dispatchingTimeout)>(fixed.dispatchingTimeout);
+    id = fixed.id;
+    layoutParamsFlags = ftl::Flags<Flag>(fixed.layoutParamsFlags);
+    layoutParamsType = static_cast<Type>(fixed.layoutParamsType);
+    frame = fixed.frame;
+    contentSize = ui::Size(fixed.contentWidth, fixed.contentHeight);
+    surfaceInset = fixed.surfaceInset;
+    globalScaleFactor = fixed.globalScaleFactor;
+    alpha = fixed.alpha;
+    touchOcclusionMode = static_cast<TouchOcclusionMode>(fixed.touchOcclusionMode);
+    ownerPid = Pid{fixed.ownerPid};
+    ownerUid = Uid{static_cast<uid_t>(fixed.ownerUid)};
+    inputConfig = ftl::Flags<InputConfig>(fixed.inputConfig);
+    displayId = ui::LogicalDisplayId{fixed.displayId};
+    replaceTouchableRegionWithCrop = fixed.replaceTouchableRegionWithCrop != 0;
+    canOccludePresentation = fixed.canOccludePresentation != 0;
     touchableRegionCropHandle = touchableRegionCropHandleSp;
-    displayId = ui::LogicalDisplayId{displayIdInt};
 
     return OK;
 }
@@ -14,13 +14,19 @@
  * limitations under the License.
  */
 
+#include <inttypes.h>
+#include <optional>
+
 #include <android/gui/ISurfaceComposer.h>
+#include <com_android_graphics_libgui_flags.h>
 #include <gui/AidlUtil.h>
 #include <gui/WindowInfosListenerReporter.h>
 #include "gui/WindowInfosUpdate.h"
 
 namespace android {
 
+using namespace com::android::graphics::libgui;
+
 using gui::DisplayInfo;
 using gui::WindowInfo;
 using gui::WindowInfosListener;
@@ -45,6 +51,9 @@ status_t WindowInfosListenerReporter::addWindowInfosListener(
             if (status == OK) {
                 mWindowInfosPublisher = std::move(listenerInfo.windowInfosPublisher);
                 mListenerId = listenerInfo.listenerId;
+                if (flags::window_infos_delta_updates()) {
+                    mWindowInfosPublisher->enableDeltaUpdates(mListenerId);
+                }
             }
         }
 
@@ -93,18 +102,36 @@ binder::Status WindowInfosListenerReporter::onWindowInfosChanged(
     std::unordered_set<sp<WindowInfosListener>, gui::SpHash<WindowInfosListener>>
             windowInfosListeners;
 
+    // Listeners always receive the complete list of windows.
+    std::optional<gui::WindowInfosUpdate> resolvedUpdate;
     {
         std::scoped_lock lock(mListenersMutex);
         for (auto listener : mWindowInfosListeners) {
             windowInfosListeners.insert(listener);
         }
 
-        mLastWindowInfos = update.windowInfos;
+        if (update.isDelta) {
+            if (update.baseGeneration != mLastGeneration ||
+                !update.applyDelta(mLastWindowInfos)) {
+                ALOGW("Dropping window infos delta %" PRId64 " based on %" PRId64
+                      ", last generation %" PRId64 ". Requesting a complete update.",
+                      update.generation, update.baseGeneration, mLastGeneration);
+                mWindowInfosPublisher->enableDeltaUpdates(mListenerId);
+                mWindowInfosPublisher->ackWindowInfosReceived(update.vsyncId, mListenerId);
+                return binder::Status::ok();
+            }
+            resolvedUpdate.emplace(mLastWindowInfos, update.displayInfos, update.vsyncId,
+                                   update.timestamp);
+            resolvedUpdate->generation = update.generation;
+        } else {
+            mLastWindowInfos = update.windowInfos;
+        }
         mLastDisplayInfos = update.displayInfos;
+        mLastGeneration = update.generation;
     }
 
     for (auto listener : windowInfosListeners) {
-        listener->onWindowInfosChanged(update);
+        listener->onWindowInfosChanged(resolvedUpdate ? *resolvedUpdate : update);
     }
 
     mWindowInfosPublisher->ackWindowInfosReceived(update.vsyncId, mListenerId);
@@ -119,6 +146,9 @@ void WindowInfosListenerReporter::reconnect(const sp<gui::ISurfaceComposer>& com
         composerService->addWindowInfosListener(this, &listenerInfo);
         mWindowInfosPublisher = std::move(listenerInfo.windowInfosPublisher);
         mListenerId = listenerInfo.listenerId;
+        if (flags::window_infos_delta_updates()) {
+            mWindowInfosPublisher->enableDeltaUpdates(mListenerId);
+        }
     }
 }
 
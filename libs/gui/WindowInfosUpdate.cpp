@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <inttypes.h>
+#include <unordered_map>
+
 #include <gui/WindowInfosUpdate.h>
 #include <private/gui/ParcelUtils.h>
 
@@ -43,6 +46,10 @@ status_t WindowInfosUpdate::readFromParcel(const android::Parcel* parcel) {
 
     SAFE_PARCEL(parcel->readInt64, &vsyncId);
     SAFE_PARCEL(parcel->readInt64, &timestamp);
+    SAFE_PARCEL(parcel->readBool, &isDelta);
+    SAFE_PARCEL(parcel->readInt64, &generation);
+    SAFE_PARCEL(parcel->readInt64, &baseGeneration);
+    SAFE_PARCEL(parcel->readInt32Vector, &windowIds);
 
     return OK;
 }
@@ -65,8 +72,50 @@ status_t WindowInfosUpdate::writeToParcel(android::Parcel* parcel) const {
 
     SAFE_PARCEL(parcel->writeInt64, vsyncId);
     SAFE_PARCEL(parcel->writeInt64, timestamp);
+    SAFE_PARCEL(parcel->writeBool, isDelta);
+    SAFE_PARCEL(parcel->writeInt64, generation);
+    SAFE_PARCEL(parcel->writeInt64, baseGeneration);
+    SAFE_PARCEL(parcel->writeInt32Vector, windowIds);
 
     return OK;
 }
 
+bool WindowInfosUpdate::applyDelta(std::vector<WindowInfo>& inOutWindowInfos) const {
+    if (!isDelta) {
+        inOutWindowInfos = windowInfos;
+        return true;
+    }
+
+    std::unordered_map<int32_t, const WindowInfo*> updatedWindows;
+    updatedWindows.reserve(windowInfos.size());
+    for (const auto& windowInfo : windowInfos) {
+        updatedWindows.emplace(windowInfo.id, &windowInfo);
+    }
+    std::unordered_map<int32_t, WindowInfo*> previousWindows;
+    previousWindows.reserve(inOutWindowInfos.size());
+    for (auto& windowInfo : inOutWindowInfos) {
+        previousWindows.emplace(windowInfo.id, &windowInfo);
+    }
+
+    for (int32_t id : windowIds) {
+        if (!updatedWindows.contains(id) && !previousWindows.contains(id)) {
+            ALOGE("%s: window %d is missing from delta update %" PRId64, __func__, id,
+                  generation);
+            return false;
+        }
+    }
+
+    std::vector<WindowInfo> result;
+    result.reserve(windowIds.size());
+    for (int32_t id : windowIds) {
+        if (auto it = updatedWindows.find(id); it != updatedWindows.end()) {
+            result.push_back(*it->second);
+        } else {
+            result.push_back(std::move(*previousWindows[id]));
+        }
+    }
+    inOutWindowInfos = std::move(result);
+    return true;
+}
+
 } // namespace android::gui
@@ -37,6 +37,7 @@ namespace android {
 
 class BLASTBufferQueue;
 class BufferItemConsumer;
+class FrameTransactionAggregator;
 
 class BLASTBufferItemConsumer : public BufferItemConsumer {
 public:
@@ -117,6 +118,10 @@ public:
     void releaseBufferCallbackLocked(const ReleaseCallbackId& id, const sp<Fence>& releaseFence,
                                      std::optional<uint32_t> currentMaxAcquiredBufferCount,
                                      bool fakeRelease) REQUIRES(mMutex);
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BUFFER_RELEASE_CHANNEL)
+    // Handles a batch of releases read from the BufferReleaseChannel under a single lock.
+    void releaseBufferCallbacks(const std::vector<gui::BufferReleaseChannel::Message>& releases);
+#endif
 
     bool syncNextTransaction(std::function<void(SurfaceComposerClient::Transaction*)> callback,
                              bool acquireSingleBuffer = true);
@@ -143,6 +148,13 @@ public:
      */
     void setTransactionHangCallback(std::function<void(const std::string&)> callback);
     void setApplyToken(sp<IBinder>);
+
+    /**
+     * Merge the transactions for acquired buffers with those of the other queues registered with
+     * the aggregator, which then applies them once per frame. This also replaces the apply token
+     * with the aggregator's. Pass nullptr to apply them separately again.
+     */
+    void setTransactionAggregator(const sp<FrameTransactionAggregator>& aggregator);
     virtual ~BLASTBufferQueue();
 
     void onFirstRef() override;
@@ -273,6 +285,10 @@ private:
     // transactions from other parts of the client from blocking this transaction.
     sp<IBinder> mApplyToken GUARDED_BY(mMutex) = sp<BBinder>::make();
 
+    // Merges the transactions for acquired buffers with those of other queues, if set.
+    sp<FrameTransactionAggregator> mTransactionAggregator GUARDED_BY(mMutex);
+    void flushTransactionAggregatorLocked() REQUIRES(mMutex);
+
     // Guards access to mDequeueTimestamps since we cannot hold to mMutex in onFrameDequeued or
     // we will deadlock.
     std::mutex mTimestampMutex;
@@ -323,14 +339,14 @@ private:
         BufferReleaseReader(std::unique_ptr<gui::BufferReleaseChannel::ConsumerEndpoint>);
         BufferReleaseReader& operator=(BufferReleaseReader&&);
 
-        // Block until we can read a buffer release message.
+        // Block until we can read buffer release messages, then read all the releases that are
+        // available into outMessages.
         //
         // Returns:
-        // * OK if a ReleaseCallbackId and Fence were successfully read.
+        // * OK if at least one release was successfully read.
         // * WOULD_BLOCK if the blocking read was interrupted by interruptBlockingRead.
         // * UNKNOWN_ERROR if something went wrong.
-        status_t readBlocking(ReleaseCallbackId& outId, sp<Fence>& outReleaseFence,
-                              uint32_t& outMaxAcquiredBufferCount);
+        status_t readBlocking(std::vector<gui::BufferReleaseChannel::Message>& outMessages);
 
         // Signals the reader's eventfd to wake up any threads waiting on readBlocking.
         void interruptBlockingRead();
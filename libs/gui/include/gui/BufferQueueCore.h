@@ -23,6 +23,7 @@
 #include <gui/BufferItem.h>
 #include <gui/BufferQueueDefs.h>
 #include <gui/BufferSlot.h>
+#include <gui/BufferSlotSet.h>
 #include <gui/OccupancyTracker.h>
 
 #include <utils/NativeHandle.h>
@@ -32,8 +33,6 @@
 #include <utils/Trace.h>
 #include <utils/Vector.h>
 
-#include <list>
-#include <set>
 #include <mutex>
 #include <condition_variable>
 
@@ -209,18 +208,18 @@ private:
 
     // mFreeSlots contains all of the slots which are FREE and do not currently
     // have a buffer attached.
-    std::set<int> mFreeSlots;
+    BufferSlotSet mFreeSlots;
 
     // mFreeBuffers contains all of the slots which are FREE and currently have
-    // a buffer attached.
-    std::list<int> mFreeBuffers;
+    // a buffer attached, in the order they were freed.
+    BufferSlotQueue mFreeBuffers;
 
     // mUnusedSlots contains all slots that are currently unused. They should be
     // free and not have a buffer attached.
-    std::list<int> mUnusedSlots;
+    BufferSlotQueue mUnusedSlots;
 
     // mActiveBuffers contains all slots which have a non-FREE buffer attached.
-    std::set<int> mActiveBuffers;
+    BufferSlotSet mActiveBuffers;
 
     // mDequeueCondition is a condition variable used for dequeueBuffer in
     // synchronous mode.
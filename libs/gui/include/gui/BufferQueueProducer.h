@@ -22,6 +22,11 @@
 
 #include <gui/IGraphicBufferProducer.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <vector>
+
 namespace android {
 
 class IBinder;
@@ -47,6 +52,11 @@ public:
     // flags indicating that previously-returned buffers are no longer valid.
     virtual status_t requestBuffer(int slot, sp<GraphicBuffer>* buf);
 
+    // See IGraphicBufferProducer::requestBuffers. All of the buffers are
+    // requested under a single lock of the BufferQueue.
+    status_t requestBuffers(const std::vector<int32_t>& slots,
+                            std::vector<RequestBufferOutput>* outputs) override;
+
     // see IGraphicsBufferProducer::setMaxDequeuedBufferCount
     virtual status_t setMaxDequeuedBufferCount(int maxDequeuedBuffers);
 
@@ -93,6 +103,12 @@ public:
                                    uint64_t* outBufferAge,
                                    FrameEventHistoryDelta* outTimestamps) override;
 
+    // See IGraphicBufferProducer::dequeueBuffers. The slots are dequeued under
+    // a single lock of the BufferQueue, and the buffers that need to be
+    // reallocated are allocated together once all of the slots are dequeued.
+    status_t dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                            std::vector<DequeueBufferOutput>* outputs) override;
+
     // See IGraphicBufferProducer::detachBuffer
     virtual status_t detachBuffer(int slot);
 
@@ -121,6 +137,12 @@ public:
     virtual status_t queueBuffer(int slot,
             const QueueBufferInput& input, QueueBufferOutput* output);
 
+    // See IGraphicBufferProducer::queueBuffers. The buffers are queued under
+    // a single lock of the BufferQueue, and the consumer callbacks for all of
+    // them are made in order under a single callback ticket.
+    status_t queueBuffers(const std::vector<QueueBufferInput>& inputs,
+                          std::vector<QueueBufferOutput>* outputs) override;
+
     // cancelBuffer returns a dequeued buffer to the BufferQueue, but doesn't
     // queue it for use by the consumer.
     //
@@ -128,6 +150,12 @@ public:
     // will usually be the one obtained from dequeueBuffer.
     virtual status_t cancelBuffer(int slot, const sp<Fence>& fence);
 
+    // See IGraphicBufferProducer::cancelBuffers. The buffers are cancelled
+    // under a single lock of the BufferQueue, which wakes up waiting dequeues
+    // once.
+    status_t cancelBuffers(const std::vector<CancelBufferInput>& inputs,
+                           std::vector<status_t>* results) override;
+
     // Query native window attributes.  The "what" values are enumerated in
     // window.h (e.g. NATIVE_WINDOW_FORMAT).
     virtual int query(int what, int* outValue);
@@ -245,6 +273,33 @@ private:
     status_t waitForFreeSlotThenRelock(FreeSlotCaller caller, std::unique_lock<std::mutex>& lock,
             int* found) const;
 
+    // The single buffer operations with mCore->mMutex held, shared by the
+    // batched operations so that they lock the BufferQueue once per batch.
+    status_t requestBufferLocked(int slot, sp<GraphicBuffer>* buf);
+    status_t cancelBufferLocked(int slot, const sp<Fence>& fence,
+                                std::optional<uint64_t>* outCancelledBufferId);
+
+    // dequeueBuffer is split into a part that dequeues a slot with
+    // mCore->mMutex held, the allocation of the slot's buffer without the lock
+    // if it needs to be reallocated, and the wait for its EGL fence. If
+    // waitForAllocation is false, the dequeue does not wait for buffers that
+    // are being allocated.
+    struct DequeuedBuffer;
+    status_t dequeueBufferLocked(std::unique_lock<std::mutex>& lock, bool waitForAllocation,
+                                 DequeuedBuffer* outBuffer);
+    sp<GraphicBuffer> allocateDequeuedBuffer(const DequeuedBuffer& dequeued) const;
+    status_t attachAllocatedBufferLocked(DequeuedBuffer* dequeued,
+                                         const sp<GraphicBuffer>& graphicBuffer);
+    void finishDequeue(DequeuedBuffer* dequeued);
+
+    // queueBuffer is split into a part that queues the frame with
+    // mCore->mMutex held, and a part that calls the consumer back for the
+    // frames queued under one callback ticket.
+    struct QueuedFrame;
+    status_t queueBufferLocked(int slot, const QueueBufferInput& input, QueueBufferOutput* output,
+                               QueuedFrame* outFrame);
+    void onFramesQueued(int callbackTicket, QueuedFrame* frames, size_t frameCount);
+
     sp<BufferQueueCore> mCore;
 
     // This references mCore->mSlots. Lock mCore->mMutex while accessing.
@@ -53,6 +53,14 @@ private:
     };
 
 public:
+    struct Message;
+
+    /**
+     * The most releases sent in one socket message. Each release whose fence has not signaled yet
+     * passes one fd.
+     */
+    static constexpr size_t kMaxBatchSize = 16;
+
     class ConsumerEndpoint : public Endpoint {
     public:
         ConsumerEndpoint(std::string name, android::base::unique_fd fd)
@@ -68,8 +76,19 @@ public:
         status_t readReleaseFence(ReleaseCallbackId& outReleaseCallbackId,
                                   sp<Fence>& outReleaseFence, uint32_t& maxAcquiredBufferCount);
 
+        /**
+         * Reads the batch of releases sent in the next socket message from the
+         * BufferReleaseChannel, and appends them to outMessages.
+         *
+         * Returns the same errors as readReleaseFence.
+         */
+        status_t readReleaseFences(std::vector<Message>& outMessages);
+
     private:
         std::vector<uint8_t> mFlattenedBuffer;
+        // Releases read in a batch that readReleaseFence has not returned yet.
+        std::vector<Message> mPendingMessages;
+        size_t mNextPendingMessage = 0;
     };
 
     class ProducerEndpoint : public Endpoint, public Parcelable {
@@ -84,7 +103,15 @@ public:
         status_t writeReleaseFence(const ReleaseCallbackId&, const sp<Fence>& releaseFence,
                                    uint32_t maxAcquiredBufferCount);
 
+        /**
+         * Writes the releases in batches of up to kMaxBatchSize, each with a single sendmsg.
+         * Fences that have already signaled are sent as Fence::NO_FENCE, without their fds.
+         */
+        status_t writeReleaseFences(const std::vector<Message>& messages);
+
     private:
+        status_t writeBatch(const Message* messages, size_t count);
+
         std::vector<uint8_t> mFlattenedBuffer;
     };
 
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_GUI_BUFFERSLOTSET_H
+#define ANDROID_GUI_BUFFERSLOTSET_H
+
+#include <ui/BufferQueueDefs.h>
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace android {
+
+// A set of buffer slots stored as a bitmask, iterated in increasing order like the std::set it
+// replaces in BufferQueueCore. It never allocates, and finds its lowest slot in constant time.
+class BufferSlotSet {
+public:
+    static_assert(BufferQueueDefs::NUM_BUFFER_SLOTS <= 64);
+
+    // Iterates over a copy of the set taken when the iterator was created, so the set can be
+    // modified while it is iterated.
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = int;
+
+        explicit const_iterator(uint64_t bits) : mBits(bits) {}
+
+        int operator*() const { return std::countr_zero(mBits); }
+        const_iterator& operator++() {
+            mBits &= mBits - 1;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        bool operator==(const const_iterator& other) const { return mBits == other.mBits; }
+        bool operator!=(const const_iterator& other) const { return mBits != other.mBits; }
+
+    private:
+        uint64_t mBits;
+    };
+
+    bool empty() const { return mBits == 0; }
+    size_t size() const { return static_cast<size_t>(std::popcount(mBits)); }
+    size_t count(int slot) const { return (mBits >> slot) & 1; }
+
+    void insert(int slot) { mBits |= bit(slot); }
+    void erase(int slot) { mBits &= ~bit(slot); }
+    void erase(const_iterator it) { erase(*it); }
+    void clear() { mBits = 0; }
+
+    const_iterator begin() const { return const_iterator(mBits); }
+    const_iterator end() const { return const_iterator(0); }
+
+private:
+    static uint64_t bit(int slot) { return uint64_t{1} << slot; }
+
+    uint64_t mBits = 0;
+};
+
+// A queue of distinct buffer slots in a fixed ring, which replaces the std::list of slots in
+// BufferQueueCore where their order matters. It never allocates. Adding and removing slots at
+// either end and checking whether a slot is queued take constant time. Removing a slot from the
+// middle is linear in the number of queued slots.
+class BufferSlotQueue {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = int;
+
+        const_iterator(const BufferSlotQueue* queue, size_t position)
+              : mQueue(queue), mPosition(position) {}
+
+        int operator*() const { return mQueue->at(mPosition); }
+        const_iterator& operator++() {
+            mPosition++;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        bool operator==(const const_iterator& other) const {
+            return mPosition == other.mPosition;
+        }
+        bool operator!=(const const_iterator& other) const {
+            return mPosition != other.mPosition;
+        }
+
+    private:
+        const BufferSlotQueue* mQueue;
+        size_t mPosition;
+    };
+
+    bool empty() const { return mSize == 0; }
+    size_t size() const { return mSize; }
+    size_t count(int slot) const { return mSlots.count(slot); }
+
+    int front() const { return at(0); }
+    int back() const { return at(mSize - 1); }
+
+    void push_back(int slot) {
+        mRing[index(mSize)] = static_cast<uint8_t>(slot);
+        mSize++;
+        mSlots.insert(slot);
+    }
+    void push_front(int slot) {
+        mHead = index(kCapacity - 1);
+        mRing[mHead] = static_cast<uint8_t>(slot);
+        mSize++;
+        mSlots.insert(slot);
+    }
+    void pop_front() {
+        mSlots.erase(front());
+        mHead = index(1);
+        mSize--;
+    }
+    void pop_back() {
+        mSlots.erase(back());
+        mSize--;
+    }
+
+    // Removes the slot if it is queued, keeping the order of the other slots.
+    void remove(int slot) {
+        if (!count(slot)) {
+            return;
+        }
+        size_t position = 0;
+        while (at(position) != slot) {
+            position++;
+        }
+        for (; position + 1 < mSize; position++) {
+            mRing[index(position)] = mRing[index(position + 1)];
+        }
+        mSize--;
+        mSlots.erase(slot);
+    }
+
+    void clear() {
+        mHead = 0;
+        mSize = 0;
+        mSlots.clear();
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, mSize); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+private:
+    static constexpr size_t kCapacity = BufferQueueDefs::NUM_BUFFER_SLOTS;
+    static_assert(std::has_single_bit(kCapacity));
+
+    size_t index(size_t position) const { return (mHead + position) & (kCapacity - 1); }
+    int at(size_t position) const { return mRing[index(position)]; }
+
+    std::array<uint8_t, kCapacity> mRing{};
+    size_t mHead = 0;
+    size_t mSize = 0;
+    BufferSlotSet mSlots;
+};
+
+} // namespace android
+
+#endif // ANDROID_GUI_BUFFERSLOTSET_H
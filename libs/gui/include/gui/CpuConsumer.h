@@ -25,6 +25,7 @@
 
 #include <utils/Vector.h>
 
+#include <array>
 
 namespace android {
 
@@ -121,6 +122,13 @@ class CpuConsumer : public ConsumerBase
     // lockNextBuffer.
     status_t unlockBuffer(const LockedBuffer &nativeBuffer);
 
+    // Keeps each buffer locked for CPU reading for as long as it stays in its slot, instead of
+    // locking it in lockNextBuffer and unlocking it in unlockBuffer. A buffer that is acquired
+    // again then only waits for its fence and has the CPU caches invalidated. This requires
+    // gralloc 4.0+, without it the buffers are locked and unlocked for each frame. Disabled by
+    // default.
+    void setPersistentMappingEnabled(bool enabled);
+
   private:
     // Maximum number of buffers that can be locked at a time
     const size_t mMaxLockedBuffers;
@@ -135,27 +143,51 @@ class CpuConsumer : public ConsumerBase
         int mSlot;
         sp<GraphicBuffer> mGraphicBuffer;
         uintptr_t mLockedBufferId;
+        // Whether the buffer stays locked in mPersistentMappings when it is unlocked.
+        bool mPersistentlyMapped;
 
         AcquiredBuffer() :
                 mSlot(BufferQueue::INVALID_BUFFER_SLOT),
-                mLockedBufferId(kUnusedId) {
+                mLockedBufferId(kUnusedId),
+                mPersistentlyMapped(false) {
         }
 
         void reset() {
             mSlot = BufferQueue::INVALID_BUFFER_SLOT;
             mGraphicBuffer.clear();
             mLockedBufferId = kUnusedId;
+            mPersistentlyMapped = false;
         }
     };
 
+    // A buffer kept locked in its slot, with the pointers and layout it was locked with.
+    struct PersistentMapping {
+        sp<GraphicBuffer> mGraphicBuffer;
+        LockedBuffer mLockedBuffer;
+    };
+
     size_t findAcquiredBufferLocked(uintptr_t id) const;
 
-    status_t lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) const;
+    status_t lockBufferItem(const BufferItem& item, const Rect& bounds,
+                            LockedBuffer* outBuffer) const;
+
+    // Returns true if the buffer of the item is persistently mapped, after invalidating the CPU
+    // caches for the new frame.
+    bool rereadPersistentMappingLocked(const BufferItem& item, LockedBuffer* outBuffer);
+
+    // Unlocks the persistently mapped buffer of the slot, or leaves that to unlockBuffer if the
+    // buffer is still locked by the user.
+    void releasePersistentMappingLocked(int slot);
+
+    void freeBufferLocked(int slotIndex) override;
 
     Vector<AcquiredBuffer> mAcquiredBuffers;
 
     // Count of currently locked buffers
     size_t mCurrentLockedBuffers;
+
+    bool mPersistentMappingEnabled = false;
+    std::array<PersistentMapping, BufferQueue::NUM_BUFFER_SLOTS> mPersistentMappings;
 };
 
 } // namespace android
@@ -28,6 +28,7 @@
 
 #include <android/gui/ISurfaceComposer.h>
 #include <binder/IInterface.h>
+#include <gui/SharedVsyncEventData.h>
 #include <gui/VsyncEventData.h>
 
 #include <ui/DisplayId.h>
@@ -184,13 +185,16 @@ public:
     status_t requestNextVsync();
 
     /**
-     * getLatestVsyncEventData() gets the latest vsync event data.
+     * getLatestVsyncEventData() gets the latest vsync event data. If the frame timelines of the
+     * last vsync event sent to the receiver are still current, they are read from shared memory
+     * without a binder call.
      */
     status_t getLatestVsyncEventData(ParcelableVsyncEventData* outVsyncEventData) const;
 
 private:
     sp<IDisplayEventConnection> mEventConnection;
     std::unique_ptr<gui::BitTube> mDataChannel;
+    std::unique_ptr<gui::SharedVsyncEventData::Reader> mSharedVsyncEventData;
     std::optional<status_t> mInitError;
 };
 
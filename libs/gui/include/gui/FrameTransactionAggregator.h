@@ -0,0 +1,103 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_set>
+
+#include <android-base/thread_annotations.h>
+#include <binder/Binder.h>
+#include <gui/SurfaceComposerClient.h>
+#include <utils/RefBase.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+class BLASTBufferQueue;
+
+// Merges the transactions that the BLASTBufferQueues registered with it create for their acquired
+// buffers, so that a process driving several of them sends one transaction per frame instead of
+// one per queue.
+//
+// The merged transaction is applied once every registered queue has added a buffer to it, when
+// flush() is called, for example from the vsync callback of the process, or when the deadline
+// after its first buffer passes. A queue that adds a second buffer before then flushes the first.
+// So does a buffer whose desired present time is too far from those already merged, since the
+// merged transaction is presented at the earliest of their times.
+//
+// All the registered queues apply their transactions on the apply token of the aggregator, so
+// that a queue's transactions still reach SurfaceFlinger in order.
+class FrameTransactionAggregator : public RefBase {
+public:
+    static constexpr std::chrono::nanoseconds kDefaultDeadline = std::chrono::milliseconds(4);
+    // How far apart the desired present times of the merged buffers may be. A buffer without one
+    // is counted as desired now.
+    static constexpr nsecs_t kMaxPresentTimeSpread = ms2ns(4);
+
+    explicit FrameTransactionAggregator(std::chrono::nanoseconds deadline = kDefaultDeadline);
+    ~FrameTransactionAggregator() override;
+
+    // Applies the merged transaction, if any queue has added a buffer to it.
+    void flush();
+
+    const sp<IBinder>& getApplyToken() const { return mApplyToken; }
+
+    // The number of merged transactions applied, and of queue transactions merged into them.
+    struct Stats {
+        size_t flushes = 0;
+        size_t mergedTransactions = 0;
+    };
+    Stats getStats() const;
+
+private:
+    friend class BLASTBufferQueue;
+
+    void registerQueue(const BLASTBufferQueue* queue);
+    void unregisterQueue(const BLASTBufferQueue* queue);
+
+    // Merges a transaction that the queue would otherwise have applied, and clears it.
+    void add(const BLASTBufferQueue* queue, SurfaceComposerClient::Transaction* t,
+             std::optional<nsecs_t> desiredPresentTime);
+
+    void flushLocked() REQUIRES(mMutex);
+    void threadMain();
+
+    const std::chrono::nanoseconds mDeadline;
+    const sp<IBinder> mApplyToken = sp<BBinder>::make();
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::unordered_set<const BLASTBufferQueue*> mQueues GUARDED_BY(mMutex);
+    std::unordered_set<const BLASTBufferQueue*> mContributors GUARDED_BY(mMutex);
+    SurfaceComposerClient::Transaction mTransaction GUARDED_BY(mMutex);
+    std::optional<std::chrono::steady_clock::time_point> mFlushTime GUARDED_BY(mMutex);
+    // The earliest and latest present times of the merged buffers.
+    nsecs_t mEarliestPresentTime GUARDED_BY(mMutex) = 0;
+    nsecs_t mLatestPresentTime GUARDED_BY(mMutex) = 0;
+    // The earliest desired present time of the merged buffers that have one.
+    std::optional<nsecs_t> mDesiredPresentTime GUARDED_BY(mMutex);
+    Stats mStats GUARDED_BY(mMutex);
+    bool mStopped GUARDED_BY(mMutex) = false;
+    std::thread mThread;
+};
+
+} // namespace android
@@ -152,6 +152,25 @@ public:
     std::vector<SurfaceStats> surfaceStats;
 };
 
+// A buffer that was released outside of a completed transaction, such as a buffer that was
+// dropped before it was latched.
+class ReleasedBufferStats : public Parcelable {
+public:
+    status_t writeToParcel(Parcel* output) const override;
+    status_t readFromParcel(const Parcel* input) override;
+
+    ReleasedBufferStats() = default;
+    ReleasedBufferStats(ReleaseCallbackId callbackId, const sp<Fence>& releaseFence,
+                        uint32_t currentMaxAcquiredBufferCount)
+          : callbackId(callbackId),
+            releaseFence(releaseFence),
+            currentMaxAcquiredBufferCount(currentMaxAcquiredBufferCount) {}
+
+    ReleaseCallbackId callbackId;
+    sp<Fence> releaseFence;
+    uint32_t currentMaxAcquiredBufferCount = 0;
+};
+
 class ListenerStats : public Parcelable {
 public:
     status_t writeToParcel(Parcel* output) const override;
@@ -163,6 +182,9 @@ public:
 
     sp<IBinder> listener;
     std::vector<TransactionStats> transactionStats;
+    // Released buffers that are delivered with the transaction stats of the same frame, instead
+    // of in one onReleaseBuffer call each.
+    std::vector<ReleasedBufferStats> releasedBuffers;
 };
 
 class ITransactionCompletedListener : public IInterface {
@@ -177,6 +199,10 @@ public:
     virtual void onTransactionQueueStalled(const String8& name) = 0;
 
     virtual void onTrustedPresentationChanged(int id, bool inTrustedPresentationState) = 0;
+
+    // SurfaceFlinger evicted the buffer it cached for this client under cacheId, so the client
+    // needs to send the buffer again the next time it uses it.
+    virtual void onBufferUncached(uint64_t cacheId) = 0;
 };
 
 class BnTransactionCompletedListener : public SafeBnInterface<ITransactionCompletedListener> {
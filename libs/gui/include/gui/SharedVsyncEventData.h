@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <android-base/unique_fd.h>
+
+#include <gui/VsyncEventData.h>
+#include <utils/Errors.h>
+
+namespace android::gui {
+
+/**
+ * A page of shared memory where SurfaceFlinger publishes the VsyncEventData of the last vsync
+ * event it sent to a display event connection, so that the app can look up the latest frame
+ * timelines without a binder call.
+ *
+ * The page is written under a seqlock by a single Writer in SurfaceFlinger and mapped read-only
+ * by the Reader in the app. Reading never blocks the writer, and only retries if it raced with a
+ * vsync being published.
+ */
+class SharedVsyncEventData {
+private:
+    struct Page;
+
+public:
+    class Writer {
+    public:
+        ~Writer();
+
+        // Publishes the vsync data. Must not be called concurrently.
+        void publish(const VsyncEventData& vsyncData);
+
+        // Returns a duplicate of the file descriptor of the page, which can only be mapped
+        // read-only.
+        android::base::unique_fd dupReaderFd() const;
+
+    private:
+        friend class SharedVsyncEventData;
+
+        Writer(std::string name, android::base::unique_fd fd, Page* page)
+              : mName(std::move(name)), mFd(std::move(fd)), mPage(page) {}
+
+        const std::string mName;
+        const android::base::unique_fd mFd;
+        Page* const mPage;
+    };
+
+    class Reader {
+    public:
+        ~Reader();
+
+        /**
+         * Reads the vsync data last published by the writer.
+         *
+         * Returns OK on success.
+         * Returns NOT_ENOUGH_DATA if no vsync data was published yet.
+         * Returns WOULD_BLOCK if every attempt raced with the writer.
+         */
+        status_t read(VsyncEventData& outVsyncData) const;
+
+    private:
+        friend class SharedVsyncEventData;
+
+        Reader(std::string name, const Page* page) : mName(std::move(name)), mPage(page) {}
+
+        const std::string mName;
+        const Page* const mPage;
+    };
+
+    /**
+     * Creates the page and its writer.
+     *
+     * Return OK on success.
+     */
+    static status_t createWriter(std::string name, std::unique_ptr<Writer>& outWriter);
+
+    /**
+     * Maps the page of a writer, from a file descriptor returned by dupReaderFd().
+     *
+     * Return OK on success.
+     */
+    static status_t createReader(std::string name, android::base::unique_fd fd,
+                                 std::unique_ptr<Reader>& outReader);
+};
+
+} // namespace android::gui
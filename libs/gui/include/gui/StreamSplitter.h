@@ -24,6 +24,9 @@
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
+
+#include <vector>
 
 namespace android {
 
@@ -66,6 +69,32 @@ public:
     // setName sets the consumer name of the input queue
     void setName(const String8& name);
 
+    // setMaxQueuedBuffersPerOutput bounds the number of buffers that each
+    // output may hold, i.e. that were queued to it and that it has not released
+    // yet. A buffer queued to the input while an output holds that many is
+    // dropped by that output, which is not waited on to release it, so a
+    // lagging output no longer stalls the others and onFrameAvailable no longer
+    // blocks. The default of 0 queues every buffer to every output, so that the
+    // slowest output paces the input.
+    void setMaxQueuedBuffersPerOutput(size_t maxQueuedBuffers);
+
+    struct OutputStats {
+        // The number of buffers queued to the output, and dropped because it
+        // already held the maximum number of buffers
+        uint64_t queuedBuffers = 0;
+        uint64_t droppedBuffers = 0;
+
+        // The time between a buffer being queued to the output and the output
+        // releasing it, summed over the released buffers and at most
+        uint64_t releasedBuffers = 0;
+        nsecs_t totalHoldTime = 0;
+        nsecs_t maxHoldTime = 0;
+    };
+
+    // getOutputStats returns the statistics of each output, in the order in
+    // which they were added
+    std::vector<OutputStats> getOutputStats() const;
+
 private:
     // From IConsumerListener
     //
@@ -133,6 +162,10 @@ private:
         const sp<GraphicBuffer>& getBuffer() const { return mBuffer; }
         const sp<Fence>& getMergedFence() const { return mMergedFence; }
 
+        // The time at which the buffer was queued to the outputs
+        nsecs_t getQueueTime() const { return mQueueTime; }
+        void setQueueTime(nsecs_t queueTime) { mQueueTime = queueTime; }
+
         void mergeFence(const sp<Fence>& with);
 
         // Returns the new value
@@ -151,6 +184,17 @@ private:
         sp<GraphicBuffer> mBuffer; // One instance that holds this native handle
         sp<Fence> mMergedFence;
         size_t mReleaseCount;
+        nsecs_t mQueueTime;
+    };
+
+    struct Output {
+        explicit Output(const sp<IGraphicBufferProducer>& producer)
+              : producer(producer) {}
+
+        sp<IGraphicBufferProducer> producer;
+        // The number of buffers queued to the output that it has not released
+        size_t heldBuffers = 0;
+        OutputStats stats;
     };
 
     // Only called from createSplitter
@@ -161,17 +205,31 @@ private:
 
     static const int MAX_OUTSTANDING_BUFFERS = 2;
 
+    // Returns the output that the producer interface belongs to, or nullptr.
+    // This must be called with mMutex locked.
+    Output* findOutputLocked(const sp<IGraphicBufferProducer>& producer);
+
+    // Returns whether the buffer should be dropped by the output rather than
+    // queued to it. This must be called with mMutex locked.
+    bool shouldDropLocked(const Output& output) const;
+
+    // Attaches the buffer back to the input and releases it with the merged
+    // release fence of the outputs, then allows a blocked onFrameAvailable call
+    // to proceed. This must be called with mMutex locked.
+    void releaseToInputLocked(const sp<BufferTracker>& tracker);
+
     // mIsAbandoned is set to true when an output dies. Once the StreamSplitter
     // has been abandoned, it will continue to detach buffers from other
     // outputs, but it will disconnect from the input and not attempt to
     // communicate with it further.
     bool mIsAbandoned;
 
-    Mutex mMutex;
+    mutable Mutex mMutex;
     Condition mReleaseCondition;
     int mOutstandingBuffers;
+    size_t mMaxQueuedBuffersPerOutput;
     sp<IGraphicBufferConsumer> mInput;
-    Vector<sp<IGraphicBufferProducer> > mOutputs;
+    std::vector<Output> mOutputs;
 
     // Map of GraphicBuffer IDs (GraphicBuffer::getId()) to buffer tracking
     // objects (which are mostly for counting how many outputs have released the
@@ -242,6 +242,15 @@ public:
      */
     void enableFrameTimestamps(bool enable);
 
+    /* Enables or disables prefetching of the next buffer. When enabled, the
+     * next buffer is dequeued on a helper thread as soon as a buffer is queued
+     * while no other buffer is dequeued, so that the next dequeueBuffer usually
+     * returns it right away. The prefetched buffer is only returned if the
+     * next dequeueBuffer asks for the same size, format and usage, and is
+     * cancelled otherwise. It is disabled by default.
+     */
+    void enableDequeuePrefetch(bool enable);
+
     status_t getCompositorTiming(
             nsecs_t* compositeDeadline, nsecs_t* compositeInterval,
             nsecs_t* compositeToPresentLatency);
@@ -534,6 +543,22 @@ protected:
     void onBufferQueuedLocked(int slot, sp<Fence> fence,
             const IGraphicBufferProducer::QueueBufferOutput& output);
 
+    // Dequeues buffers ahead of time for enableDequeuePrefetch.
+    class DequeuePrefetcher;
+    struct PrefetchedBuffer;
+
+    // Returns the buffer prefetched for a dequeueBuffer with the given input, waiting for it if
+    // it is still being dequeued. Returns false if there is none, or it does not match.
+    bool takePrefetchedBuffer(const std::shared_ptr<DequeuePrefetcher>& prefetcher,
+                              const IGraphicBufferProducer::DequeueBufferInput& input, int* outSlot,
+                              sp<Fence>* outFence, status_t* outResult,
+                              FrameEventHistoryDelta* outFrameTimestamps);
+
+    // Returns a prefetched buffer that won't be used to the producer. If cancel is false, the
+    // producer has already disconnected, and only the local state is updated.
+    void discardPrefetchedBufferLocked(bool cancel = true);
+    void cancelPrefetchedBufferLocked(PrefetchedBuffer& prefetched, bool cancel);
+
     struct BufferSlot {
         sp<GraphicBuffer> buffer;
         Region dirtyRegion;
@@ -742,6 +767,9 @@ protected:
 
     // Buffers that are successfully dequeued/attached and handed to clients
     std::unordered_set<int> mDequeuedSlots;
+
+    // Set while dequeue prefetching is enabled.
+    std::shared_ptr<DequeuePrefetcher> mDequeuePrefetcher;
 };
 
 } // namespace android
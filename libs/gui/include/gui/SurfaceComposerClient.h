@@ -435,6 +435,9 @@ public:
         static std::mutex sApplyTokenMutex;
         void releaseBufferIfOverwriting(const layer_state_t& state);
         static void mergeFrameTimelineInfo(FrameTimelineInfo& t, const FrameTimelineInfo& other);
+        // Sends the transaction over the process' TransactionChannel if it only carries changes
+        // the channel supports. Returns false if it has to go through binder.
+        bool applyThroughTransactionChannel(uint32_t flags, const sp<IBinder>& applyToken);
         // Tracks registered callbacks
         sp<TransactionCompletedListener> mTransactionCompletedListener = nullptr;
 
@@ -802,6 +805,13 @@ public:
         static sp<IBinder> getDefaultApplyToken();
         static void setDefaultApplyToken(sp<IBinder> applyToken);
 
+        /**
+         * Lets this process send transactions that only change the position, matrix, alpha,
+         * crop, corner radius or z of layers over a socket instead of binder. Other transactions,
+         * synchronous ones and ones using a custom apply token are unaffected.
+         */
+        static void setTransactionChannelEnabled(bool enabled);
+
         static status_t sendSurfaceFlushJankDataTransaction(const sp<SurfaceControl>& sc);
     };
 
@@ -1047,6 +1057,8 @@ public:
 
     void onTrustedPresentationChanged(int id, bool presentedWithinThresholds) override;
 
+    void onBufferUncached(uint64_t cacheId) override;
+
 private:
     ReleaseBufferCallback popReleaseBufferCallbackLocked(const ReleaseCallbackId&) REQUIRES(mMutex);
     static sp<TransactionCompletedListener> sInstance;
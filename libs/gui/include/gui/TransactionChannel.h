@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <android-base/unique_fd.h>
+
+#include <gui/LayerState.h>
+#include <ui/Rect.h>
+#include <utils/Errors.h>
+#include <utils/Flattenable.h>
+
+namespace android::gui {
+
+/**
+ * IPC wrapper to send simple transactions from apps to SurfaceFlinger via a local unix domain
+ * socket instead of a binder call.
+ *
+ * Only plain geometry updates to layers that were registered with
+ * ISurfaceComposer::registerTransactionChannelLayer can be sent over the channel. Anything that
+ * carries binder objects, buffers, fences or callbacks still goes through
+ * ISurfaceComposer::setTransactionState. The producer writes a BinderBarrier message before each
+ * transaction it sends through binder, and SurfaceFlinger holds back the messages that follow it
+ * until that transaction has arrived, so the two paths stay ordered.
+ */
+class TransactionChannel {
+public:
+    // The layer_state_t changes that can be sent over the channel.
+    static constexpr uint64_t kSupportedChanges = layer_state_t::ePositionChanged |
+            layer_state_t::eLayerChanged | layer_state_t::eAlphaChanged |
+            layer_state_t::eMatrixChanged | layer_state_t::eCropChanged |
+            layer_state_t::eCornerRadiusChanged;
+
+    // Transactions that touch more layers than this are sent via binder.
+    static constexpr size_t kMaxLayerUpdates = 16;
+
+    struct LayerUpdate {
+        int32_t layerId = -1;
+        uint64_t what = 0;
+        float x = 0;
+        float y = 0;
+        int32_t z = 0;
+        float alpha = 1.f;
+        layer_state_t::matrix22_t matrix;
+        Rect crop = Rect::INVALID_RECT;
+        float cornerRadius = 0;
+
+        bool operator==(const LayerUpdate&) const = default;
+
+        // Copies the supported changes in the layer state into a LayerUpdate and back.
+        static LayerUpdate fromLayerState(const layer_state_t& state);
+        void applyTo(layer_state_t& state) const;
+    };
+
+    enum class MessageType : uint32_t {
+        // Applies the layer updates in the message.
+        Transaction = 0,
+        // The process sent the transaction with transactionId through binder. Messages that
+        // follow are applied after that transaction.
+        BinderBarrier = 1,
+    };
+
+    struct Message : public LightFlattenable<Message> {
+        MessageType type = MessageType::Transaction;
+        uint64_t transactionId = 0;
+        // ISurfaceComposer transaction flags. Only eAnimation is forwarded.
+        uint32_t flags = 0;
+        std::vector<LayerUpdate> layerUpdates;
+
+        // LightFlattenable protocol
+        bool isFixedSize() const { return false; }
+        size_t getFlattenedSize() const;
+        status_t flatten(void* buffer, size_t size) const;
+        status_t unflatten(void const* buffer, size_t size);
+    };
+
+    class ConsumerEndpoint {
+    public:
+        ConsumerEndpoint(std::string name, android::base::unique_fd fd);
+
+        /**
+         * Reads a message from the TransactionChannel.
+         *
+         * Returns OK on success.
+         * Returns WOULD_BLOCK if there is no message present.
+         * Returns DEAD_OBJECT if the producer has closed the channel.
+         * Other errors indicate that the message was malformed or the channel is broken.
+         */
+        status_t readMessage(Message& outMessage);
+
+        const android::base::unique_fd& getFd() const { return mFd; }
+
+    private:
+        std::string mName;
+        android::base::unique_fd mFd;
+        std::vector<uint8_t> mFlattenedBuffer;
+    };
+
+    class ProducerEndpoint {
+    public:
+        ProducerEndpoint(std::string name, android::base::unique_fd fd)
+              : mName(std::move(name)), mFd(std::move(fd)) {}
+
+        /**
+         * Writes a message to the TransactionChannel. Returns WOULD_BLOCK if the socket buffer is
+         * full, in which case the caller should fall back to binder.
+         */
+        status_t writeMessage(const Message& message);
+
+    private:
+        std::string mName;
+        android::base::unique_fd mFd;
+        std::vector<uint8_t> mFlattenedBuffer;
+    };
+
+    /**
+     * Create the two endpoints that make up the TransactionChannel. The consumer file descriptor
+     * is released to SurfaceFlinger.
+     *
+     * Return OK on success.
+     */
+    static status_t open(std::string name, android::base::unique_fd& outConsumerFd,
+                         std::unique_ptr<ProducerEndpoint>& outProducer);
+};
+
+} // namespace android::gui
@@ -266,6 +266,10 @@ struct WindowInfo : public Parcelable {
 
     bool operator==(const WindowInfo& inputChannel) const;
 
+    // Unlike operator==, also compares the fields that don't take part in window identity, so
+    // that two infos compare equal only if listeners would observe no difference between them.
+    bool hasSameContent(const WindowInfo& other) const;
+
     status_t writeToParcel(android::Parcel* parcel) const override;
 
     status_t readFromParcel(const android::Parcel* parcel) override;
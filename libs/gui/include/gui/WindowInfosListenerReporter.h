@@ -46,6 +46,8 @@ private:
 
     std::vector<gui::WindowInfo> mLastWindowInfos GUARDED_BY(mListenersMutex);
     std::vector<gui::DisplayInfo> mLastDisplayInfos GUARDED_BY(mListenersMutex);
+    // Generation of mLastWindowInfos, used to check that delta updates apply on top of it.
+    int64_t mLastGeneration GUARDED_BY(mListenersMutex) = 0;
 
     sp<gui::IWindowInfosPublisher> mWindowInfosPublisher;
     int64_t mListenerId;
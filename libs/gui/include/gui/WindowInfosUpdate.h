@@ -37,6 +37,23 @@ struct WindowInfosUpdate : public Parcelable {
     int64_t vsyncId;
     int64_t timestamp;
 
+    // Incremental updates are only sent to listeners that opted in through
+    // IWindowInfosPublisher#enableDeltaUpdates.
+    //
+    // If isDelta is true, windowInfos only holds the windows that were added or changed since the
+    // update identified by baseGeneration, and windowIds lists the ids of every window in the
+    // same order a complete update would have them. Windows missing from windowIds were removed.
+    // displayInfos is always complete.
+    bool isDelta = false;
+    int64_t generation = 0;
+    int64_t baseGeneration = 0;
+    std::vector<int32_t> windowIds;
+
+    // Applies a delta update on top of the complete list of windows from the update with
+    // generation baseGeneration. Returns false, leaving inOutWindowInfos untouched, if the delta
+    // references a window that is neither in the delta nor in inOutWindowInfos.
+    bool applyDelta(std::vector<WindowInfo>& inOutWindowInfos) const;
+
     status_t writeToParcel(android::Parcel*) const override;
     status_t readFromParcel(const android::Parcel*) override;
 };
@@ -24,6 +24,7 @@
 #include <gui/BufferQueueCore.h>
 #include <gui/BufferQueueProducer.h>
 #include <gui/FrameTimestamps.h>
+#include <gui/FrameTransactionAggregator.h>
 #include <gui/IGraphicBufferProducer.h>
 #include <gui/IProducerListener.h>
 #include <gui/Surface.h>
@@ -190,6 +191,10 @@ public:
         mBlastBufferQueueAdapter->setApplyToken(std::move(applyToken));
     }
 
+    void setTransactionAggregator(const sp<FrameTransactionAggregator>& aggregator) {
+        mBlastBufferQueueAdapter->setTransactionAggregator(aggregator);
+    }
+
 private:
     sp<TestBLASTBufferQueue> mBlastBufferQueueAdapter;
 };
@@ -578,6 +583,43 @@ TEST_F(BLASTBufferQueueTest, setApplyToken) {
               firstTransaction.mCallbackReceivedTimeStamp);
 }
 
+TEST_F(BLASTBufferQueueTest, TransactionAggregatorMergesFramesOfRegisteredQueues) {
+    sp<SurfaceControl> otherSurfaceControl =
+            mClient->createSurface(String8("OtherTestSurface"), mDisplayWidth, mDisplayHeight,
+                                   PIXEL_FORMAT_RGBA_8888,
+                                   ISurfaceComposerClient::eFXSurfaceBufferState,
+                                   /*parent*/ mRootSurfaceControl->getHandle());
+    // The deadline is long enough that only the second frame can flush the first.
+    auto aggregator = sp<FrameTransactionAggregator>::make(std::chrono::seconds(5));
+
+    BLASTBufferQueueHelper adapter(mSurfaceControl, mDisplayWidth, mDisplayHeight);
+    BLASTBufferQueueHelper otherAdapter(otherSurfaceControl, mDisplayWidth, mDisplayHeight);
+    adapter.setTransactionAggregator(aggregator);
+    otherAdapter.setTransactionAggregator(aggregator);
+    sp<IGraphicBufferProducer> igbProducer;
+    sp<IGraphicBufferProducer> otherIgbProducer;
+    setUpProducer(adapter, igbProducer);
+    setUpProducer(otherAdapter, otherIgbProducer);
+
+    queueBuffer(igbProducer, 0, 0, 255, /*presentTimeDelay*/ 0);
+    EXPECT_EQ(0u, aggregator->getStats().flushes);
+    queueBuffer(otherIgbProducer, 0, 0, 255, /*presentTimeDelay*/ 0);
+    EXPECT_EQ(1u, aggregator->getStats().flushes);
+    EXPECT_EQ(2u, aggregator->getStats().mergedTransactions);
+
+    adapter.waitForCallbacks();
+    otherAdapter.waitForCallbacks();
+
+    // A second frame from the same queue flushes its first one.
+    queueBuffer(igbProducer, 255, 0, 0, /*presentTimeDelay*/ 0);
+    queueBuffer(igbProducer, 0, 255, 0, /*presentTimeDelay*/ 0);
+    EXPECT_EQ(2u, aggregator->getStats().flushes);
+    aggregator->flush();
+    EXPECT_EQ(3u, aggregator->getStats().flushes);
+    EXPECT_EQ(4u, aggregator->getStats().mergedTransactions);
+    adapter.waitForCallbacks();
+}
+
 TEST_F(BLASTBufferQueueTest, SetCrop_Item) {
     uint8_t r = 255;
     uint8_t g = 0;
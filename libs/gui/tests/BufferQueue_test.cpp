@@ -42,7 +42,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <future>
+#include <set>
 #include <thread>
 
 #include <com_android_graphics_libgui_flags.h>
@@ -1192,6 +1194,94 @@ TEST_F(BufferQueueTest, TestBufferReplacedInQueueBuffer) {
     ASSERT_EQ(true, output.bufferReplaced);
 }
 
+struct FrameCountingConsumer : public BnConsumerListener {
+    void onFrameAvailable(const BufferItem& /* item */) override { framesAvailable++; }
+    void onFrameDequeued(const uint64_t /* bufferId */) override { framesDequeued++; }
+    void onFrameCancelled(const uint64_t /* bufferId */) override { framesCancelled++; }
+    void onBuffersReleased() override {}
+    void onSidebandStreamChanged() override {}
+
+    std::atomic<int> framesAvailable = 0;
+    std::atomic<int> framesDequeued = 0;
+    std::atomic<int> framesCancelled = 0;
+};
+
+TEST_F(BufferQueueTest, BatchedOperationsBehaveLikeSingleOperations) {
+    constexpr size_t kBatchSize = 3;
+
+    createBufferQueue();
+    sp<FrameCountingConsumer> consumer = sp<FrameCountingConsumer>::make();
+    ASSERT_EQ(OK, mConsumer->consumerConnect(consumer, false));
+    IGraphicBufferProducer::QueueBufferOutput output;
+    ASSERT_EQ(OK,
+              mProducer->connect(new StubProducerListener, NATIVE_WINDOW_API_CPU, false, &output));
+    ASSERT_EQ(OK, mConsumer->setMaxAcquiredBufferCount(static_cast<int>(kBatchSize)));
+    ASSERT_EQ(OK, mProducer->setMaxDequeuedBufferCount(static_cast<int>(kBatchSize)));
+
+    IGraphicBufferProducer::DequeueBufferInput dequeueInput{};
+    dequeueInput.usage = TEST_PRODUCER_USAGE_BITS;
+    const std::vector<IGraphicBufferProducer::DequeueBufferInput>
+            dequeueInputs(kBatchSize, dequeueInput);
+
+    // The first dequeue allocates every buffer.
+    std::vector<IGraphicBufferProducer::DequeueBufferOutput> dequeueOutputs;
+    ASSERT_EQ(NO_ERROR, mProducer->dequeueBuffers(dequeueInputs, &dequeueOutputs));
+    ASSERT_EQ(kBatchSize, dequeueOutputs.size());
+    std::vector<int32_t> slots;
+    for (const auto& dequeueOutput : dequeueOutputs) {
+        EXPECT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION, dequeueOutput.result);
+        slots.push_back(dequeueOutput.slot);
+    }
+    EXPECT_EQ(kBatchSize, std::set<int32_t>(slots.begin(), slots.end()).size());
+
+    std::vector<IGraphicBufferProducer::RequestBufferOutput> requestOutputs;
+    ASSERT_EQ(NO_ERROR, mProducer->requestBuffers(slots, &requestOutputs));
+    ASSERT_EQ(kBatchSize, requestOutputs.size());
+    for (const auto& requestOutput : requestOutputs) {
+        EXPECT_EQ(OK, requestOutput.result);
+        EXPECT_NE(nullptr, requestOutput.buffer);
+    }
+
+    std::vector<IGraphicBufferProducer::CancelBufferInput> cancelInputs(kBatchSize);
+    for (size_t i = 0; i < kBatchSize; i++) {
+        cancelInputs[i].slot = slots[i];
+        cancelInputs[i].fence = Fence::NO_FENCE;
+    }
+    std::vector<status_t> cancelResults;
+    ASSERT_EQ(NO_ERROR, mProducer->cancelBuffers(cancelInputs, &cancelResults));
+    EXPECT_EQ(std::vector<status_t>(kBatchSize, OK), cancelResults);
+    EXPECT_EQ(static_cast<int>(kBatchSize), consumer->framesCancelled);
+
+    // The buffers are reused, and a slot that is not dequeued fails on its own.
+    ASSERT_EQ(NO_ERROR, mProducer->dequeueBuffers(dequeueInputs, &dequeueOutputs));
+    std::vector<IGraphicBufferProducer::QueueBufferInput> queueInputs;
+    for (size_t i = 0; i < kBatchSize; i++) {
+        EXPECT_EQ(OK, dequeueOutputs[i].result);
+        queueInputs.emplace_back(static_cast<int64_t>(i), false, HAL_DATASPACE_UNKNOWN,
+                                 Rect::INVALID_RECT, NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                 Fence::NO_FENCE, /*sticky*/ 0, /*getFrameTimestamps*/ false,
+                                 dequeueOutputs[i].slot);
+    }
+    queueInputs.push_back(queueInputs.front());
+    std::vector<IGraphicBufferProducer::QueueBufferOutput> queueOutputs;
+    ASSERT_EQ(NO_ERROR, mProducer->queueBuffers(queueInputs, &queueOutputs));
+    ASSERT_EQ(kBatchSize + 1, queueOutputs.size());
+    for (size_t i = 0; i < kBatchSize; i++) {
+        EXPECT_EQ(OK, queueOutputs[i].result);
+    }
+    EXPECT_EQ(BAD_VALUE, queueOutputs.back().result);
+    EXPECT_EQ(static_cast<int>(2 * kBatchSize), consumer->framesDequeued);
+    EXPECT_EQ(static_cast<int>(kBatchSize), consumer->framesAvailable);
+
+    // The frames are acquired in the order they were queued.
+    for (size_t i = 0; i < kBatchSize; i++) {
+        BufferItem item;
+        ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 0));
+        EXPECT_EQ(static_cast<int64_t>(i), item.mTimestamp);
+        EXPECT_EQ(queueInputs[i].slot, item.mSlot);
+    }
+}
+
 struct BufferDetachedListener : public BnProducerListener {
 public:
     BufferDetachedListener() = default;
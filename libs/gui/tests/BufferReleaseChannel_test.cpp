@@ -135,4 +135,47 @@ TEST(BufferReleaseChannelTest, ProduceAndConsume) {
     }
 }
 
+// Verify that a batch of releases is read back in order from a single socket message, with only
+// the fences that have an fd passing one.
+TEST(BufferReleaseChannelTest, ProduceAndConsumeBatch) {
+    std::unique_ptr<BufferReleaseChannel::ConsumerEndpoint> consumer;
+    std::shared_ptr<BufferReleaseChannel::ProducerEndpoint> producer;
+    ASSERT_EQ(OK, BufferReleaseChannel::open("test-channel"s, consumer, producer));
+
+    sp<Fence> fence = sp<Fence>::make(memfd_create("fake-fence-fd", 0));
+
+    std::vector<BufferReleaseChannel::Message> messages;
+    for (uint64_t i = 0; i < BufferReleaseChannel::kMaxBatchSize + 2; i++) {
+        messages.emplace_back(ReleaseCallbackId{i, i + 1}, i % 2 ? fence : Fence::NO_FENCE,
+                              static_cast<uint32_t>(i + 2));
+    }
+    ASSERT_EQ(OK, producer->writeReleaseFences(messages));
+
+    std::vector<BufferReleaseChannel::Message> consumed;
+    ASSERT_EQ(OK, consumer->readReleaseFences(consumed));
+    ASSERT_EQ(BufferReleaseChannel::kMaxBatchSize, consumed.size());
+
+    // The rest of the releases were sent in a second message.
+    ReleaseCallbackId consumerId;
+    sp<Fence> consumerFence;
+    uint32_t maxAcquiredBufferCount;
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_EQ(OK,
+                  consumer->readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+        consumed.emplace_back(consumerId, consumerFence, maxAcquiredBufferCount);
+    }
+    ASSERT_EQ(WOULD_BLOCK,
+              consumer->readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+
+    for (uint64_t i = 0; i < messages.size(); i++) {
+        ASSERT_EQ(messages[i].releaseCallbackId, consumed[i].releaseCallbackId);
+        ASSERT_EQ(messages[i].maxAcquiredBufferCount, consumed[i].maxAcquiredBufferCount);
+        if (i % 2) {
+            ASSERT_TRUE(is_same_file(fence->get(), consumed[i].releaseFence->get()));
+        } else {
+            ASSERT_FALSE(consumed[i].releaseFence->isValid());
+        }
+    }
+}
+
 } // namespace android
\ No newline at end of file
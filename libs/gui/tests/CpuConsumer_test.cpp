@@ -605,6 +605,44 @@ TEST_P(CpuConsumerTest, FromCpuManyInQueue) {
     }
 }
 
+// Persistently mapped buffers show the contents of each new frame queued to them.
+TEST_P(CpuConsumerTest, FromCpuPersistentMapping) {
+    status_t err;
+    CpuConsumerTestParams params = GetParam();
+
+    const int numInQueue = 3;
+    const int numRounds = 4;
+    ASSERT_NO_FATAL_FAILURE(configureANW(mANW, params, numInQueue));
+    mCC->setPersistentMappingEnabled(true);
+
+    for (int round = 0; round < numRounds; round++) {
+        uint32_t stride[numInQueue];
+        for (int i = 0; i < numInQueue; i++) {
+            ASSERT_NO_FATAL_FAILURE(
+                    produceOneFrame(mANW, params, round * numInQueue + i + 1, &stride[i]));
+        }
+
+        for (int i = 0; i < numInQueue; i++) {
+            CpuConsumer::LockedBuffer b;
+            err = mCC->lockNextBuffer(&b);
+            ASSERT_NO_ERROR(err, "getNextBuffer error: ");
+
+            ASSERT_TRUE(b.data != nullptr);
+            EXPECT_EQ(params.width, b.width);
+            EXPECT_EQ(params.height, b.height);
+            EXPECT_EQ(params.format, b.format);
+            EXPECT_EQ(stride[i], b.stride);
+            EXPECT_EQ(round * numInQueue + i + 1, b.timestamp);
+
+            checkAnyBuffer(b, GetParam().format);
+
+            mCC->unlockBuffer(b);
+        }
+    }
+
+    mCC->setPersistentMappingEnabled(false);
+}
+
 // This test is disabled because the HAL_PIXEL_FORMAT_RAW16 format is not
 // supported on all devices.
 TEST_P(CpuConsumerTest, FromCpuLockMax) {
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <binder/Binder.h>
+#include <binder/Parcel.h>
+
+#include <gui/LayerState.h>
+
+namespace android {
+
+namespace test {
+
+TEST(LayerState, ParcellingChangedProperties) {
+    layer_state_t s;
+    s.surface = sp<BBinder>::make();
+    s.layerId = 42;
+    s.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged |
+            layer_state_t::eCropChanged | layer_state_t::eBlurRegionsChanged |
+            layer_state_t::eHasListenerCallbacksChanged;
+    s.x = 12.5f;
+    s.y = -3.f;
+    s.color.a = 0.25f;
+    s.crop = Rect(1, 2, 30, 40);
+    BlurRegion region;
+    region.blurRadius = 7;
+    region.alpha = 0.5f;
+    region.right = 10;
+    region.bottom = 20;
+    s.blurRegions.push_back(region);
+    std::vector<CallbackId> callbackIds{CallbackId(3, CallbackId::Type::ON_COMPLETE)};
+    s.listeners.emplace_back(sp<BBinder>::make(), callbackIds);
+
+    Parcel p;
+    ASSERT_EQ(OK, s.write(p));
+    p.setDataPosition(0);
+
+    layer_state_t s2;
+    ASSERT_EQ(OK, s2.read(p));
+    EXPECT_EQ(p.dataSize(), p.dataPosition());
+    EXPECT_EQ(s.surface, s2.surface);
+    EXPECT_EQ(s.layerId, s2.layerId);
+    EXPECT_EQ(s.what, s2.what);
+    EXPECT_EQ(s.x, s2.x);
+    EXPECT_EQ(s.y, s2.y);
+    EXPECT_EQ(s.color.a, s2.color.a);
+    EXPECT_EQ(s.crop, s2.crop);
+    ASSERT_EQ(1u, s2.blurRegions.size());
+    EXPECT_EQ(region.blurRadius, s2.blurRegions[0].blurRadius);
+    EXPECT_EQ(region.alpha, s2.blurRegions[0].alpha);
+    EXPECT_EQ(region.right, s2.blurRegions[0].right);
+    EXPECT_EQ(region.bottom, s2.blurRegions[0].bottom);
+    ASSERT_EQ(1u, s2.listeners.size());
+    EXPECT_EQ(s.listeners[0].transactionCompletedListener,
+              s2.listeners[0].transactionCompletedListener);
+    EXPECT_EQ(s.listeners[0].callbackIds, s2.listeners[0].callbackIds);
+}
+
+// Properties that are not flagged as changed are not written, and keep their default values.
+TEST(LayerState, ParcellingSkipsUnchangedProperties) {
+    layer_state_t s;
+    s.layerId = 42;
+    s.what = layer_state_t::ePositionChanged;
+    s.x = 1.f;
+    s.y = 2.f;
+    s.z = 5;
+    s.cornerRadius = 8.f;
+    s.crop = Rect(0, 0, 10, 10);
+
+    Parcel p;
+    ASSERT_EQ(OK, s.write(p));
+
+    layer_state_t fullState;
+    fullState.what = ~uint64_t{0};
+    Parcel fullParcel;
+    ASSERT_EQ(OK, fullState.write(fullParcel));
+    EXPECT_LT(p.dataSize() * 4, fullParcel.dataSize());
+
+    p.setDataPosition(0);
+    layer_state_t s2;
+    ASSERT_EQ(OK, s2.read(p));
+    EXPECT_EQ(p.dataSize(), p.dataPosition());
+    EXPECT_EQ(s.x, s2.x);
+    EXPECT_EQ(s.y, s2.y);
+    EXPECT_EQ(0, s2.z);
+    EXPECT_EQ(0.f, s2.cornerRadius);
+    EXPECT_EQ(Rect::INVALID_RECT, s2.crop);
+}
+
+} // namespace test
+} // namespace android
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <binder/Parcel.h>
+
+#include <gui/ITransactionCompletedListener.h>
+
+namespace android {
+
+namespace test {
+
+TEST(ListenerStats, ParcellingReleasedBuffers) {
+    ListenerStats stats;
+    stats.transactionStats.emplace_back(
+            std::vector<CallbackId>{CallbackId(1, CallbackId::Type::ON_COMPLETE)});
+    stats.releasedBuffers.emplace_back(ReleaseCallbackId(10, 1), Fence::NO_FENCE, 2u);
+    stats.releasedBuffers.emplace_back(ReleaseCallbackId(11, 4), Fence::NO_FENCE, 3u);
+
+    Parcel p;
+    ASSERT_EQ(NO_ERROR, stats.writeToParcel(&p));
+    p.setDataPosition(0);
+
+    ListenerStats stats2;
+    ASSERT_EQ(NO_ERROR, stats2.readFromParcel(&p));
+    ASSERT_EQ(1u, stats2.transactionStats.size());
+    ASSERT_EQ(1u, stats2.transactionStats[0].callbackIds.size());
+    EXPECT_EQ(1, stats2.transactionStats[0].callbackIds[0].id);
+
+    ASSERT_EQ(2u, stats2.releasedBuffers.size());
+    EXPECT_EQ(ReleaseCallbackId(10, 1), stats2.releasedBuffers[0].callbackId);
+    EXPECT_EQ(2u, stats2.releasedBuffers[0].currentMaxAcquiredBufferCount);
+    EXPECT_EQ(ReleaseCallbackId(11, 4), stats2.releasedBuffers[1].callbackId);
+    EXPECT_EQ(3u, stats2.releasedBuffers[1].currentMaxAcquiredBufferCount);
+    ASSERT_NE(nullptr, stats2.releasedBuffers[1].releaseFence);
+    EXPECT_FALSE(stats2.releasedBuffers[1].releaseFence->isValid());
+}
+
+TEST(ListenerStats, ParcellingWithoutTransactions) {
+    ListenerStats stats;
+    stats.releasedBuffers.emplace_back(ReleaseCallbackId(10, 1), nullptr, 2u);
+
+    Parcel p;
+    ASSERT_EQ(NO_ERROR, stats.writeToParcel(&p));
+    p.setDataPosition(0);
+
+    ListenerStats stats2;
+    ASSERT_EQ(NO_ERROR, stats2.readFromParcel(&p));
+    EXPECT_TRUE(stats2.transactionStats.empty());
+    ASSERT_EQ(1u, stats2.releasedBuffers.size());
+    EXPECT_EQ(ReleaseCallbackId(10, 1), stats2.releasedBuffers[0].callbackId);
+}
+
+} // namespace test
+} // namespace android
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <thread>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <gui/SharedVsyncEventData.h>
+
+using namespace std::string_literals;
+using android::gui::SharedVsyncEventData;
+using android::gui::VsyncEventData;
+
+namespace android {
+
+namespace {
+
+VsyncEventData makeVsyncEventData(int64_t vsyncId) {
+    VsyncEventData vsyncData{};
+    vsyncData.frameInterval = 16'666'667;
+    vsyncData.preferredFrameTimelineIndex = 1;
+    vsyncData.frameTimelinesLength = 3;
+    for (uint32_t i = 0; i < vsyncData.frameTimelinesLength; i++) {
+        vsyncData.frameTimelines[i].vsyncId = vsyncId + i;
+        vsyncData.frameTimelines[i].deadlineTimestamp = vsyncId * 1000 + i;
+        vsyncData.frameTimelines[i].expectedPresentationTime = vsyncId * 2000 + i;
+    }
+    return vsyncData;
+}
+
+void expectEq(const VsyncEventData& expected, const VsyncEventData& actual) {
+    EXPECT_EQ(expected.frameInterval, actual.frameInterval);
+    EXPECT_EQ(expected.preferredFrameTimelineIndex, actual.preferredFrameTimelineIndex);
+    ASSERT_EQ(expected.frameTimelinesLength, actual.frameTimelinesLength);
+    for (uint32_t i = 0; i < expected.frameTimelinesLength; i++) {
+        EXPECT_EQ(expected.frameTimelines[i].vsyncId, actual.frameTimelines[i].vsyncId);
+        EXPECT_EQ(expected.frameTimelines[i].deadlineTimestamp,
+                  actual.frameTimelines[i].deadlineTimestamp);
+        EXPECT_EQ(expected.frameTimelines[i].expectedPresentationTime,
+                  actual.frameTimelines[i].expectedPresentationTime);
+    }
+}
+
+} // namespace
+
+TEST(SharedVsyncEventDataTest, ReadsPublishedVsyncEventData) {
+    std::unique_ptr<SharedVsyncEventData::Writer> writer;
+    ASSERT_EQ(OK, SharedVsyncEventData::createWriter("test-page"s, writer));
+    std::unique_ptr<SharedVsyncEventData::Reader> reader;
+    ASSERT_EQ(OK, SharedVsyncEventData::createReader("test-page"s, writer->dupReaderFd(), reader));
+
+    VsyncEventData result;
+    EXPECT_EQ(NOT_ENOUGH_DATA, reader->read(result));
+
+    writer->publish(makeVsyncEventData(10));
+    ASSERT_EQ(OK, reader->read(result));
+    expectEq(makeVsyncEventData(10), result);
+
+    writer->publish(makeVsyncEventData(20));
+    ASSERT_EQ(OK, reader->read(result));
+    expectEq(makeVsyncEventData(20), result);
+}
+
+// The page is written by SurfaceFlinger only, apps must not be able to map it writable.
+TEST(SharedVsyncEventDataTest, ReaderFdCannotBeMappedWritable) {
+    std::unique_ptr<SharedVsyncEventData::Writer> writer;
+    ASSERT_EQ(OK, SharedVsyncEventData::createWriter("test-page"s, writer));
+    base::unique_fd fd = writer->dupReaderFd();
+    ASSERT_TRUE(fd.ok());
+
+    const size_t size = static_cast<size_t>(getpagesize());
+    void* page = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    EXPECT_EQ(MAP_FAILED, page);
+    if (page != MAP_FAILED) {
+        munmap(page, size);
+    }
+}
+
+// Readers never observe a partially published VsyncEventData.
+TEST(SharedVsyncEventDataTest, ReadsAreConsistentWhileWriting) {
+    std::unique_ptr<SharedVsyncEventData::Writer> writer;
+    ASSERT_EQ(OK, SharedVsyncEventData::createWriter("test-page"s, writer));
+    std::unique_ptr<SharedVsyncEventData::Reader> reader;
+    ASSERT_EQ(OK, SharedVsyncEventData::createReader("test-page"s, writer->dupReaderFd(), reader));
+    writer->publish(makeVsyncEventData(1));
+
+    constexpr int64_t kPublishCount = 10000;
+    std::thread writerThread([&] {
+        for (int64_t vsyncId = 2; vsyncId <= kPublishCount; vsyncId++) {
+            writer->publish(makeVsyncEventData(vsyncId));
+        }
+    });
+
+    VsyncEventData result;
+    int64_t lastVsyncId = 0;
+    while (lastVsyncId < kPublishCount) {
+        if (reader->read(result) != OK) {
+            continue;
+        }
+        const int64_t vsyncId = result.frameTimelines[0].vsyncId;
+        ASSERT_GE(vsyncId, lastVsyncId);
+        expectEq(makeVsyncEventData(vsyncId), result);
+        lastVsyncId = vsyncId;
+    }
+    writerThread.join();
+}
+
+} // namespace android
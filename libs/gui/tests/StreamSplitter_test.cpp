@@ -222,4 +222,93 @@ TEST_F(StreamSplitterTest, OutputAbandonment) {
                                            nullptr, nullptr));
 }
 
+TEST_F(StreamSplitterTest, LaggingOutputDropsBuffers) {
+    sp<IGraphicBufferProducer> inputProducer;
+    sp<IGraphicBufferConsumer> inputConsumer;
+    BufferQueue::createBufferQueue(&inputProducer, &inputConsumer);
+
+    // The first output never acquires its buffers, the second one releases
+    // each buffer as soon as it is queued
+    sp<IGraphicBufferProducer> laggingProducer;
+    sp<IGraphicBufferConsumer> laggingConsumer;
+    BufferQueue::createBufferQueue(&laggingProducer, &laggingConsumer);
+    ASSERT_EQ(OK, laggingConsumer->consumerConnect(new FakeListener, false));
+
+    sp<IGraphicBufferProducer> outputProducer;
+    sp<IGraphicBufferConsumer> outputConsumer;
+    BufferQueue::createBufferQueue(&outputProducer, &outputConsumer);
+    ASSERT_EQ(OK, outputConsumer->consumerConnect(new FakeListener, false));
+
+    sp<StreamSplitter> splitter;
+    status_t status = StreamSplitter::createSplitter(inputConsumer, &splitter);
+    ASSERT_EQ(OK, status);
+    ASSERT_EQ(OK, splitter->addOutput(laggingProducer));
+    ASSERT_EQ(OK, splitter->addOutput(outputProducer));
+    splitter->setMaxQueuedBuffersPerOutput(1);
+
+    IGraphicBufferProducer::QueueBufferOutput qbOutput;
+    ASSERT_EQ(OK,
+              inputProducer->connect(new StubProducerListener, NATIVE_WINDOW_API_CPU, false,
+                                     &qbOutput));
+
+    IGraphicBufferProducer::QueueBufferInput qbInput(0, false,
+            HAL_DATASPACE_UNKNOWN, Rect(0, 0, 1, 1),
+            NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+
+    const int NUM_BUFFERS = 3;
+    for (int i = 0; i < NUM_BUFFERS; ++i) {
+        int slot;
+        sp<Fence> fence;
+        status = inputProducer->dequeueBuffer(&slot, &fence, 0, 0, 0,
+                GRALLOC_USAGE_SW_WRITE_OFTEN, nullptr, nullptr);
+        ASSERT_GE(status, OK);
+        if (status & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            sp<GraphicBuffer> buffer;
+            ASSERT_EQ(OK, inputProducer->requestBuffer(slot, &buffer));
+        }
+
+        // This would block if the splitter waited for the lagging output
+        ASSERT_EQ(OK, inputProducer->queueBuffer(slot, qbInput, &qbOutput));
+
+        BufferItem item;
+        ASSERT_EQ(OK, outputConsumer->acquireBuffer(&item, 0));
+        ASSERT_EQ(OK, outputConsumer->releaseBuffer(item.mSlot,
+                    item.mFrameNumber, EGL_NO_DISPLAY, EGL_NO_SYNC_KHR,
+                    Fence::NO_FENCE));
+    }
+
+    std::vector<StreamSplitter::OutputStats> stats = splitter->getOutputStats();
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_EQ(1u, stats[0].queuedBuffers);
+    EXPECT_EQ(uint64_t(NUM_BUFFERS - 1), stats[0].droppedBuffers);
+    EXPECT_EQ(0u, stats[0].releasedBuffers);
+    EXPECT_EQ(uint64_t(NUM_BUFFERS), stats[1].queuedBuffers);
+    EXPECT_EQ(0u, stats[1].droppedBuffers);
+    EXPECT_EQ(uint64_t(NUM_BUFFERS), stats[1].releasedBuffers);
+    EXPECT_GE(stats[1].maxHoldTime, 0);
+    EXPECT_LE(stats[1].maxHoldTime, stats[1].totalHoldTime);
+
+    // Once the lagging output releases its buffer, it is queued the next one
+    BufferItem item;
+    ASSERT_EQ(OK, laggingConsumer->acquireBuffer(&item, 0));
+    ASSERT_EQ(OK, laggingConsumer->releaseBuffer(item.mSlot, item.mFrameNumber,
+                EGL_NO_DISPLAY, EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+
+    int slot;
+    sp<Fence> fence;
+    status = inputProducer->dequeueBuffer(&slot, &fence, 0, 0, 0,
+            GRALLOC_USAGE_SW_WRITE_OFTEN, nullptr, nullptr);
+    ASSERT_GE(status, OK);
+    if (status & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+        sp<GraphicBuffer> buffer;
+        ASSERT_EQ(OK, inputProducer->requestBuffer(slot, &buffer));
+    }
+    ASSERT_EQ(OK, inputProducer->queueBuffer(slot, qbInput, &qbOutput));
+    ASSERT_EQ(OK, laggingConsumer->acquireBuffer(&item, 0));
+
+    stats = splitter->getOutputStats();
+    EXPECT_EQ(2u, stats[0].queuedBuffers);
+    EXPECT_EQ(1u, stats[0].releasedBuffers);
+}
+
 } // namespace android
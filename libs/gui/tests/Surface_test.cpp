@@ -495,6 +495,50 @@ TEST_F(SurfaceTest, DynamicSetBufferCount) {
     ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
 }
 
+TEST_F(SurfaceTest, DequeuePrefetch) {
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+
+    sp<MockConsumer> mockConsumer(new MockConsumer);
+    consumer->consumerConnect(mockConsumer, false);
+    consumer->setConsumerName(String8("TestConsumer"));
+
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+    surface->enableDequeuePrefetch(true);
+
+    ASSERT_EQ(NO_ERROR, native_window_api_connect(window.get(), NATIVE_WINDOW_API_CPU));
+    ASSERT_EQ(NO_ERROR, native_window_set_buffer_count(window.get(), 6));
+    ASSERT_EQ(NO_ERROR, native_window_set_usage(window.get(), TEST_PRODUCER_USAGE_BITS));
+
+    int fence;
+    ANativeWindowBuffer* buffer;
+    ANativeWindowBuffer* queuedBuffer;
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &queuedBuffer, &fence));
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), queuedBuffer, fence));
+
+    // The buffer prefetched after the queue is a different one, dequeued with the same usage.
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    EXPECT_NE(queuedBuffer, buffer);
+    EXPECT_EQ(TEST_PRODUCER_USAGE_BITS, buffer->usage & TEST_PRODUCER_USAGE_BITS);
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+
+    // A buffer prefetched with the old usage is cancelled, and one with the new usage dequeued.
+    ASSERT_EQ(NO_ERROR,
+              native_window_set_usage(window.get(),
+                                      TEST_PRODUCER_USAGE_BITS | GRALLOC_USAGE_SW_WRITE_RARELY));
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fence));
+    EXPECT_EQ(static_cast<uint64_t>(GRALLOC_USAGE_SW_WRITE_RARELY),
+              buffer->usage & GRALLOC_USAGE_SW_WRITE_RARELY);
+    ASSERT_EQ(NO_ERROR, window->queueBuffer(window.get(), buffer, fence));
+
+    // Changing the buffer count cancels the prefetched buffer rather than failing.
+    ASSERT_EQ(NO_ERROR, native_window_set_buffer_count(window.get(), 5));
+    surface->enableDequeuePrefetch(false);
+    ASSERT_EQ(NO_ERROR, native_window_api_disconnect(window.get(), NATIVE_WINDOW_API_CPU));
+}
+
 TEST_F(SurfaceTest, GetAndFlushRemovedBuffers) {
     sp<IGraphicBufferProducer> producer;
     sp<IGraphicBufferConsumer> consumer;
@@ -1015,6 +1059,16 @@ public:
         return binder::Status::ok();
     }
 
+    binder::Status setTransactionChannel(const os::ParcelFileDescriptor& /*channel*/,
+                                         const sp<IBinder>& /*applyToken*/) override {
+        return binder::Status::ok();
+    }
+
+    binder::Status registerTransactionChannelLayer(const sp<IBinder>& /*layerHandle*/,
+                                                   int32_t* /*outLayerId*/) override {
+        return binder::Status::ok();
+    }
+
 protected:
     IBinder* onAsBinder() override { return nullptr; }
 
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <gui/ISurfaceComposer.h>
+#include <gui/TransactionChannel.h>
+
+using namespace std::string_literals;
+using android::gui::TransactionChannel;
+
+namespace android {
+
+namespace {
+
+TransactionChannel::Message makeMessage(uint64_t transactionId, size_t layerCount) {
+    TransactionChannel::Message message;
+    message.transactionId = transactionId;
+    message.flags = ISurfaceComposer::eAnimation;
+    for (size_t i = 0; i < layerCount; i++) {
+        TransactionChannel::LayerUpdate update;
+        update.layerId = static_cast<int32_t>(i + 1);
+        update.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged;
+        update.x = 1.5f * i;
+        update.y = -2.f;
+        update.z = static_cast<int32_t>(i);
+        update.alpha = 0.5f;
+        update.matrix = {1.f, 2.f, 3.f, 4.f};
+        update.crop = Rect(0, 0, 10, 20);
+        update.cornerRadius = 8.f;
+        message.layerUpdates.push_back(update);
+    }
+    return message;
+}
+
+} // namespace
+
+TEST(TransactionChannelTest, MessageFlattenable) {
+    const TransactionChannel::Message message = makeMessage(0x1234567890ull, 3);
+
+    std::vector<uint8_t> buffer(message.getFlattenedSize());
+    ASSERT_EQ(OK, message.flatten(buffer.data(), buffer.size()));
+
+    TransactionChannel::Message result;
+    ASSERT_EQ(OK, result.unflatten(buffer.data(), buffer.size()));
+    EXPECT_EQ(TransactionChannel::MessageType::Transaction, result.type);
+    EXPECT_EQ(message.transactionId, result.transactionId);
+    EXPECT_EQ(message.flags, result.flags);
+    EXPECT_EQ(message.layerUpdates, result.layerUpdates);
+}
+
+// The channel carries data from untrusted processes, malformed messages must be rejected.
+TEST(TransactionChannelTest, RejectsMalformedMessages) {
+    const TransactionChannel::Message message = makeMessage(1, 2);
+    std::vector<uint8_t> buffer(message.getFlattenedSize());
+    ASSERT_EQ(OK, message.flatten(buffer.data(), buffer.size()));
+
+    TransactionChannel::Message result;
+    EXPECT_EQ(BAD_VALUE, result.unflatten(buffer.data(), buffer.size() - 1));
+    EXPECT_EQ(BAD_VALUE, result.unflatten(buffer.data(), 3));
+
+    // Layer count doesn't match the size of the message.
+    buffer[4 * sizeof(uint32_t)] = 3;
+    EXPECT_EQ(BAD_VALUE, result.unflatten(buffer.data(), buffer.size()));
+
+    // Unknown message type.
+    buffer[4 * sizeof(uint32_t)] = 2;
+    buffer[0] = 7;
+    EXPECT_EQ(BAD_VALUE, result.unflatten(buffer.data(), buffer.size()));
+}
+
+TEST(TransactionChannelTest, LayerUpdateOnlyCopiesSupportedChanges) {
+    layer_state_t state;
+    state.layerId = 5;
+    state.what = layer_state_t::ePositionChanged | layer_state_t::eBufferChanged;
+    state.x = 3.f;
+    state.y = 4.f;
+
+    const auto update = TransactionChannel::LayerUpdate::fromLayerState(state);
+    EXPECT_EQ(layer_state_t::ePositionChanged, update.what);
+
+    layer_state_t result;
+    update.applyTo(result);
+    EXPECT_EQ(5, result.layerId);
+    EXPECT_EQ(layer_state_t::ePositionChanged, result.what);
+    EXPECT_EQ(3.f, result.x);
+    EXPECT_EQ(4.f, result.y);
+}
+
+// Verify that the TransactionChannel consumer returns WOULD_BLOCK when there's no message
+// available and DEAD_OBJECT once the producer is gone.
+TEST(TransactionChannelTest, ConsumerEndpointIsNonBlocking) {
+    base::unique_fd consumerFd;
+    std::unique_ptr<TransactionChannel::ProducerEndpoint> producer;
+    ASSERT_EQ(OK, TransactionChannel::open("test-channel"s, consumerFd, producer));
+    TransactionChannel::ConsumerEndpoint consumer("test-channel"s, std::move(consumerFd));
+
+    TransactionChannel::Message message;
+    EXPECT_EQ(WOULD_BLOCK, consumer.readMessage(message));
+
+    producer.reset();
+    EXPECT_EQ(DEAD_OBJECT, consumer.readMessage(message));
+}
+
+// Verify that messages written to the producer are read back in order by the consumer.
+TEST(TransactionChannelTest, ProduceAndConsume) {
+    base::unique_fd consumerFd;
+    std::unique_ptr<TransactionChannel::ProducerEndpoint> producer;
+    ASSERT_EQ(OK, TransactionChannel::open("test-channel"s, consumerFd, producer));
+    TransactionChannel::ConsumerEndpoint consumer("test-channel"s, std::move(consumerFd));
+
+    for (uint64_t i = 0; i < 16; i++) {
+        TransactionChannel::Message message = makeMessage(i, i % 4);
+        if (i % 5 == 0) {
+            message.type = TransactionChannel::MessageType::BinderBarrier;
+            message.layerUpdates.clear();
+        }
+        ASSERT_EQ(OK, producer->writeMessage(message));
+    }
+
+    for (uint64_t i = 0; i < 16; i++) {
+        TransactionChannel::Message message;
+        ASSERT_EQ(OK, consumer.readMessage(message));
+        EXPECT_EQ(i, message.transactionId);
+        if (i % 5 == 0) {
+            EXPECT_EQ(TransactionChannel::MessageType::BinderBarrier, message.type);
+            EXPECT_TRUE(message.layerUpdates.empty());
+        } else {
+            EXPECT_EQ(TransactionChannel::MessageType::Transaction, message.type);
+            EXPECT_EQ(makeMessage(i, i % 4).layerUpdates, message.layerUpdates);
+        }
+    }
+    TransactionChannel::Message message;
+    EXPECT_EQ(WOULD_BLOCK, consumer.readMessage(message));
+}
+
+} // namespace android
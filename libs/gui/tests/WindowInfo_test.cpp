@@ -102,6 +102,34 @@ TEST(WindowInfo, Parcelling) {
     ASSERT_EQ(i.focusTransferTarget, i2.focusTransferTarget);
 }
 
+TEST(WindowInfo, ParcellingTransformsAndTouchableRegions) {
+    ui::Transform translate;
+    translate.set(10, -20);
+    ui::Transform matrix;
+    matrix.set({0.4, -1, 100, 0.5, 0, 40, 0, 0, 1});
+    Region rects(Rect(0, 0, 10, 10));
+    rects.orSelf(Rect(20, 20, 30, 40));
+
+    // Read every case into the same WindowInfo, so that none of them keeps state from the last.
+    WindowInfo i2;
+    for (const ui::Transform& transform : {ui::Transform(), translate, matrix}) {
+        for (const Region& region : {Region(), Region(Rect(5, 6, 7, 8)), rects}) {
+            WindowInfo i;
+            i.name = "Foobar";
+            i.transform = transform;
+            i.touchableRegion = region;
+
+            Parcel p;
+            ASSERT_EQ(OK, i.writeToParcel(&p));
+            p.setDataPosition(0);
+            ASSERT_EQ(OK, i2.readFromParcel(&p));
+            ASSERT_EQ(i.transform, i2.transform);
+            ASSERT_TRUE(i.touchableRegion.hasSameRects(i2.touchableRegion));
+            ASSERT_EQ(p.dataSize(), p.dataPosition());
+        }
+    }
+}
+
 TEST(InputApplicationInfo, Parcelling) {
     InputApplicationInfo i;
     i.token = new BBinder();
@@ -0,0 +1,358 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gui/BLASTBufferQueue.h>
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/IProducerListener.h>
+#include <gui/SurfaceComposerClient.h>
+#include <hardware/gralloc.h>
+#include <system/window.h>
+#include <ui/Fence.h>
+
+#include "RemoteBufferQueue.h"
+
+namespace {
+// The number of heap allocations made by the process, to count those made by the BufferQueue.
+std::atomic<size_t> gAllocations = 0;
+} // namespace
+
+void* operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = malloc(size)) {
+        return ptr;
+    }
+    abort();
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace android {
+namespace {
+
+constexpr uint64_t kUsage = GRALLOC_USAGE_SW_READ_RARELY;
+
+// The round trip benchmarks run with buffer counts that cover double, triple and deep buffering,
+// and with square buffers from a thumbnail to 2048x2048.
+void bufferCountsAndSizes(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"buffers", "size"})->ArgsProduct({{2, 3, 8}, {64, 1024, 2048}});
+}
+
+class StubConsumerListener : public BnConsumerListener {
+public:
+    void onFrameAvailable(const BufferItem&) override {}
+    void onBuffersReleased() override {}
+    void onSidebandStreamChanged() override {}
+};
+
+IGraphicBufferProducer::QueueBufferInput makeQueueBufferInput(uint32_t size) {
+    return IGraphicBufferProducer::QueueBufferInput(0, false, HAL_DATASPACE_UNKNOWN,
+                                                    Rect(size, size),
+                                                    NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                    Fence::NO_FENCE);
+}
+
+// Moves batchSize buffers of size by size pixels from the producer to the consumer and back, with
+// one call per buffer or, if batched, with the batched IGraphicBufferProducer calls. Without a
+// consumer, the remote consumer releases each buffer as soon as it is queued.
+class RoundTrip {
+public:
+    RoundTrip(const sp<IGraphicBufferProducer>& producer,
+              const sp<IGraphicBufferConsumer>& consumer, uint32_t size, int batchSize,
+              bool batched)
+          : mProducer(producer),
+            mConsumer(consumer),
+            mSize(size),
+            mBatchSize(batchSize),
+            mBatched(batched) {
+        IGraphicBufferProducer::DequeueBufferInput dequeueInput;
+        dequeueInput.width = size;
+        dequeueInput.height = size;
+        dequeueInput.format = 0;
+        dequeueInput.usage = kUsage;
+        dequeueInput.getTimestamps = false;
+        mDequeueInputs.assign(batchSize, dequeueInput);
+
+        mQueueInputs.reserve(batchSize);
+        for (int i = 0; i < batchSize; i++) {
+            mQueueInputs.push_back(makeQueueBufferInput(size));
+        }
+    }
+
+    void run() {
+        if (mBatched) {
+            dequeueBatch();
+        } else {
+            for (int i = 0; i < mBatchSize; i++) {
+                dequeue(&mQueueInputs[i].slot);
+            }
+        }
+
+        if (mBatched) {
+            mProducer->queueBuffers(mQueueInputs, &mQueueOutputs);
+        } else {
+            IGraphicBufferProducer::QueueBufferOutput output;
+            for (const auto& input : mQueueInputs) {
+                mProducer->queueBuffer(input.slot, input, &output);
+            }
+        }
+
+        if (mConsumer) {
+            for (int i = 0; i < mBatchSize; i++) {
+                BufferItem item;
+                mConsumer->acquireBuffer(&item, 0);
+                mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber, Fence::NO_FENCE);
+            }
+        }
+    }
+
+private:
+    void dequeue(int* outSlot) {
+        sp<Fence> fence;
+        const status_t result = mProducer->dequeueBuffer(outSlot, &fence, mSize, mSize, 0, kUsage,
+                                                         nullptr, nullptr);
+        if (result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            sp<GraphicBuffer> buffer;
+            mProducer->requestBuffer(*outSlot, &buffer);
+        }
+    }
+
+    void dequeueBatch() {
+        mProducer->dequeueBuffers(mDequeueInputs, &mDequeueOutputs);
+        mRequestSlots.clear();
+        for (int i = 0; i < mBatchSize; i++) {
+            const auto& output = mDequeueOutputs[i];
+            mQueueInputs[i].slot = output.slot;
+            if (output.result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+                mRequestSlots.push_back(output.slot);
+            }
+        }
+        if (!mRequestSlots.empty()) {
+            mProducer->requestBuffers(mRequestSlots, &mRequestOutputs);
+        }
+    }
+
+    const sp<IGraphicBufferProducer> mProducer;
+    const sp<IGraphicBufferConsumer> mConsumer;
+    const uint32_t mSize;
+    const int mBatchSize;
+    const bool mBatched;
+
+    std::vector<IGraphicBufferProducer::DequeueBufferInput> mDequeueInputs;
+    std::vector<IGraphicBufferProducer::DequeueBufferOutput> mDequeueOutputs;
+    std::vector<int32_t> mRequestSlots;
+    std::vector<IGraphicBufferProducer::RequestBufferOutput> mRequestOutputs;
+    std::vector<IGraphicBufferProducer::QueueBufferInput> mQueueInputs;
+    std::vector<IGraphicBufferProducer::QueueBufferOutput> mQueueOutputs;
+};
+
+// Measures the round trips of buffers through the producer, with a buffer count of
+// state.range(0) and buffers of state.range(1) by state.range(1) pixels. Each iteration moves
+// every buffer that can be dequeued at once if batched, and one buffer otherwise, and the items
+// processed are the buffers.
+void runRoundTrips(benchmark::State& state, const sp<IGraphicBufferProducer>& producer,
+                   const sp<IGraphicBufferConsumer>& consumer, bool batched) {
+    const int bufferCount = static_cast<int>(state.range(0));
+    const uint32_t size = static_cast<uint32_t>(state.range(1));
+    const int batchSize = batched ? bufferCount - 1 : 1;
+
+    IGraphicBufferProducer::QueueBufferOutput output;
+    if (producer->connect(nullptr, NATIVE_WINDOW_API_CPU, false, &output) != NO_ERROR) {
+        state.SkipWithError("Failed to connect to the producer");
+        return;
+    }
+    producer->setMaxDequeuedBufferCount(bufferCount - 1);
+
+    RoundTrip roundTrip(producer, consumer, size, batchSize, batched);
+
+    // Allocate every buffer the queue will cycle through before measuring.
+    for (int i = 0; i < bufferCount * 2; i++) {
+        roundTrip.run();
+    }
+
+    for (auto _ : state) {
+        roundTrip.run();
+    }
+    state.SetItemsProcessed(state.iterations() * batchSize);
+
+    // Disconnecting frees the buffers, so that the next run allocates buffers of its own size.
+    producer->disconnect(NATIVE_WINDOW_API_CPU);
+}
+
+void runLocalRoundTrips(benchmark::State& state, bool batched) {
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+    consumer->consumerConnect(sp<StubConsumerListener>::make(), false);
+    consumer->setMaxAcquiredBufferCount(1);
+
+    runRoundTrips(state, producer, consumer, batched);
+
+    consumer->consumerDisconnect();
+}
+
+void runRemoteRoundTrips(benchmark::State& state, bool batched) {
+    const sp<IGraphicBufferProducer> producer = getRemoteBufferQueueProducer();
+    if (!producer) {
+        state.SkipWithError("The remote BufferQueue is not available");
+        return;
+    }
+    runRoundTrips(state, producer, nullptr, batched);
+}
+
+// SurfaceFlinger releases the buffers of the BLASTBufferQueue once it latches the next one, so
+// these round trips are paced by the display.
+void runBLASTBufferQueueRoundTrips(benchmark::State& state, bool batched) {
+    const uint32_t size = static_cast<uint32_t>(state.range(1));
+
+    const sp<SurfaceComposerClient> client = sp<SurfaceComposerClient>::make();
+    if (client->initCheck() != NO_ERROR) {
+        state.SkipWithError("SurfaceFlinger is not available");
+        return;
+    }
+    const sp<SurfaceControl> surface =
+            client->createSurface(String8("BLASTBufferQueueBenchmark"), size, size,
+                                  PIXEL_FORMAT_RGBA_8888,
+                                  ISurfaceComposerClient::eFXSurfaceBufferState,
+                                  /*parent*/ nullptr);
+    if (!surface) {
+        state.SkipWithError("Failed to create the surface");
+        return;
+    }
+    SurfaceComposerClient::Transaction()
+            .setLayerStack(surface, ui::DEFAULT_LAYER_STACK)
+            .setLayer(surface, std::numeric_limits<int32_t>::max())
+            .show(surface)
+            .apply(/*synchronous*/ true);
+
+    const sp<BLASTBufferQueue> queue =
+            sp<BLASTBufferQueue>::make("BLASTBufferQueueBenchmark", surface, size, size,
+                                       PIXEL_FORMAT_RGBA_8888);
+    runRoundTrips(state, queue->getIGraphicBufferProducer(), nullptr, batched);
+
+    SurfaceComposerClient::Transaction().reparent(surface, nullptr).apply(/*synchronous*/ true);
+}
+
+// Cycles buffers through a BufferQueue with state.range(0) buffers, counting the allocations
+// made while dequeueing and releasing them once every buffer has been allocated.
+void BM_BufferQueueCycle(benchmark::State& state) {
+    const int bufferCount = static_cast<int>(state.range(0));
+
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+    consumer->consumerConnect(sp<StubConsumerListener>::make(), false);
+    consumer->setMaxAcquiredBufferCount(1);
+    IGraphicBufferProducer::QueueBufferOutput output;
+    producer->connect(sp<StubProducerListener>::make(), NATIVE_WINDOW_API_CPU, false, &output);
+    producer->setMaxDequeuedBufferCount(bufferCount - 1);
+
+    const IGraphicBufferProducer::QueueBufferInput input(0, false, HAL_DATASPACE_UNKNOWN,
+                                                         Rect(1, 1),
+                                                         NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                         Fence::NO_FENCE);
+
+    auto cycle = [&](size_t* dequeueAllocations, size_t* releaseAllocations) {
+        int slot;
+        sp<Fence> fence;
+        size_t allocations = gAllocations.load(std::memory_order_relaxed);
+        const status_t result = producer->dequeueBuffer(&slot, &fence, 1, 1, 0, kUsage, nullptr,
+                                                        nullptr);
+        *dequeueAllocations += gAllocations.load(std::memory_order_relaxed) - allocations;
+        if (result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            sp<GraphicBuffer> buffer;
+            producer->requestBuffer(slot, &buffer);
+        }
+        producer->queueBuffer(slot, input, &output);
+
+        BufferItem item;
+        consumer->acquireBuffer(&item, 0);
+        allocations = gAllocations.load(std::memory_order_relaxed);
+        consumer->releaseBuffer(item.mSlot, item.mFrameNumber, Fence::NO_FENCE);
+        *releaseAllocations += gAllocations.load(std::memory_order_relaxed) - allocations;
+    };
+
+    // Allocate every buffer the queue will cycle through before measuring.
+    size_t ignored = 0;
+    for (int i = 0; i < bufferCount * 2; i++) {
+        cycle(&ignored, &ignored);
+    }
+
+    size_t dequeueAllocations = 0;
+    size_t releaseAllocations = 0;
+    for (auto _ : state) {
+        cycle(&dequeueAllocations, &releaseAllocations);
+    }
+
+    state.counters["dequeue_allocs"] =
+            benchmark::Counter(dequeueAllocations, benchmark::Counter::kAvgIterations);
+    state.counters["release_allocs"] =
+            benchmark::Counter(releaseAllocations, benchmark::Counter::kAvgIterations);
+
+    producer->disconnect(NATIVE_WINDOW_API_CPU);
+    consumer->consumerDisconnect();
+}
+BENCHMARK(BM_BufferQueueCycle)->Arg(2)->Arg(3)->Arg(8);
+
+// A BufferQueue whose producer and consumer are in the benchmark process.
+void BM_BufferQueueRoundTrip(benchmark::State& state) {
+    runLocalRoundTrips(state, /*batched*/ false);
+}
+BENCHMARK(BM_BufferQueueRoundTrip)->Apply(bufferCountsAndSizes);
+
+void BM_BufferQueueBatchedRoundTrip(benchmark::State& state) {
+    runLocalRoundTrips(state, /*batched*/ true);
+}
+BENCHMARK(BM_BufferQueueBatchedRoundTrip)->Apply(bufferCountsAndSizes);
+
+// A BufferQueue in another process, whose producer is called through binder.
+void BM_RemoteBufferQueueRoundTrip(benchmark::State& state) {
+    runRemoteRoundTrips(state, /*batched*/ false);
+}
+BENCHMARK(BM_RemoteBufferQueueRoundTrip)->Apply(bufferCountsAndSizes)->UseRealTime();
+
+void BM_RemoteBufferQueueBatchedRoundTrip(benchmark::State& state) {
+    runRemoteRoundTrips(state, /*batched*/ true);
+}
+BENCHMARK(BM_RemoteBufferQueueBatchedRoundTrip)->Apply(bufferCountsAndSizes)->UseRealTime();
+
+// A BLASTBufferQueue whose buffers SurfaceFlinger presents.
+void BM_BLASTBufferQueueRoundTrip(benchmark::State& state) {
+    runBLASTBufferQueueRoundTrips(state, /*batched*/ false);
+}
+BENCHMARK(BM_BLASTBufferQueueRoundTrip)->Apply(bufferCountsAndSizes)->UseRealTime();
+
+void BM_BLASTBufferQueueBatchedRoundTrip(benchmark::State& state) {
+    runBLASTBufferQueueRoundTrips(state, /*batched*/ true);
+}
+BENCHMARK(BM_BLASTBufferQueueBatchedRoundTrip)->Apply(bufferCountsAndSizes)->UseRealTime();
+
+} // namespace
+} // namespace android
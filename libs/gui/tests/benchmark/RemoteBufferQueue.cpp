@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RemoteBufferQueue.h"
+
+#include <sys/prctl.h>
+#include <unistd.h>
+
+#include <csignal>
+
+#include <binder/IPCThreadState.h>
+#include <binder/IServiceManager.h>
+#include <binder/ProcessState.h>
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/IConsumerListener.h>
+#include <gui/IGraphicBufferConsumer.h>
+#include <ui/Fence.h>
+#include <utils/Log.h>
+
+namespace android {
+namespace {
+
+const String16 kProducerName("libgui_benchmark_remote_producer");
+
+// Releases each buffer as soon as it is queued, so that the producer only waits for binder.
+class ReleasingConsumerListener : public BnConsumerListener {
+public:
+    explicit ReleasingConsumerListener(const sp<IGraphicBufferConsumer>& consumer)
+          : mConsumer(consumer) {}
+
+    void onFrameAvailable(const BufferItem&) override {
+        BufferItem item;
+        if (mConsumer->acquireBuffer(&item, 0) == NO_ERROR) {
+            mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber, Fence::NO_FENCE);
+        }
+    }
+    void onBuffersReleased() override {}
+    void onSidebandStreamChanged() override {}
+
+private:
+    const sp<IGraphicBufferConsumer> mConsumer;
+};
+
+} // namespace
+
+void forkRemoteBufferQueue() {
+    if (fork() != 0) {
+        return;
+    }
+
+    // Exit with the benchmark process.
+    prctl(PR_SET_PDEATHSIG, SIGHUP);
+
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+    // The BufferQueue only keeps a weak reference to its listener.
+    const sp<ReleasingConsumerListener> listener =
+            sp<ReleasingConsumerListener>::make(consumer);
+    LOG_ALWAYS_FATAL_IF(consumer->consumerConnect(listener, false) != NO_ERROR,
+                        "Failed to connect to the remote BufferQueue");
+    LOG_ALWAYS_FATAL_IF(defaultServiceManager()->addService(kProducerName,
+                                                            IInterface::asBinder(producer)) !=
+                                NO_ERROR,
+                        "Failed to register the remote BufferQueue");
+    ProcessState::self()->startThreadPool();
+    IPCThreadState::self()->joinThreadPool();
+    LOG_ALWAYS_FATAL("Shouldn't be here");
+}
+
+sp<IGraphicBufferProducer> getRemoteBufferQueueProducer() {
+    static const sp<IGraphicBufferProducer> producer =
+            interface_cast<IGraphicBufferProducer>(
+                    defaultServiceManager()->waitForService(kProducerName));
+    return producer;
+}
+
+} // namespace android
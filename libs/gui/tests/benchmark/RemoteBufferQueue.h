@@ -0,0 +1,33 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <gui/IGraphicBufferProducer.h>
+#include <utils/StrongPointer.h>
+
+namespace android {
+
+// Forks a process that hosts a BufferQueue, whose consumer acquires and releases each buffer as
+// soon as it is queued, and registers its producer with the service manager. This must be called
+// before the benchmark process uses binder, or the forked process inherits its binder state.
+void forkRemoteBufferQueue();
+
+// Returns the producer of the BufferQueue hosted by the forked process, or nullptr if it failed to
+// start.
+sp<IGraphicBufferProducer> getRemoteBufferQueueProducer();
+
+} // namespace android
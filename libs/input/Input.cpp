@@ -1256,6 +1256,13 @@ void TouchModeEvent::initialize(const TouchModeEvent& from) {
 
 PooledInputEventFactory::PooledInputEventFactory(size_t maxPoolSize) :
         mMaxPoolSize(maxPoolSize) {
+    // Reserving the pools up front means that recycling an event never allocates.
+    mKeyEventPool.reserve(maxPoolSize);
+    mMotionEventPool.reserve(maxPoolSize);
+    mFocusEventPool.reserve(maxPoolSize);
+    mCaptureEventPool.reserve(maxPoolSize);
+    mDragEventPool.reserve(maxPoolSize);
+    mTouchModeEventPool.reserve(maxPoolSize);
 }
 
 PooledInputEventFactory::~PooledInputEventFactory() {
@@ -1265,8 +1272,8 @@ KeyEvent* PooledInputEventFactory::createKeyEvent() {
     if (mKeyEventPool.empty()) {
         return new KeyEvent();
     }
-    KeyEvent* event = mKeyEventPool.front().release();
-    mKeyEventPool.pop();
+    KeyEvent* event = mKeyEventPool.back().release();
+    mKeyEventPool.pop_back();
     return event;
 }
 
@@ -1274,8 +1281,8 @@ MotionEvent* PooledInputEventFactory::createMotionEvent() {
     if (mMotionEventPool.empty()) {
         return new MotionEvent();
     }
-    MotionEvent* event = mMotionEventPool.front().release();
-    mMotionEventPool.pop();
+    MotionEvent* event = mMotionEventPool.back().release();
+    mMotionEventPool.pop_back();
     return event;
 }
 
@@ -1283,8 +1290,8 @@ FocusEvent* PooledInputEventFactory::createFocusEvent() {
     if (mFocusEventPool.empty()) {
         return new FocusEvent();
     }
-    FocusEvent* event = mFocusEventPool.front().release();
-    mFocusEventPool.pop();
+    FocusEvent* event = mFocusEventPool.back().release();
+    mFocusEventPool.pop_back();
     return event;
 }
 
@@ -1292,8 +1299,8 @@ CaptureEvent* PooledInputEventFactory::createCaptureEvent() {
     if (mCaptureEventPool.empty()) {
         return new CaptureEvent();
     }
-    CaptureEvent* event = mCaptureEventPool.front().release();
-    mCaptureEventPool.pop();
+    CaptureEvent* event = mCaptureEventPool.back().release();
+    mCaptureEventPool.pop_back();
     return event;
 }
 
@@ -1301,8 +1308,8 @@ DragEvent* PooledInputEventFactory::createDragEvent() {
     if (mDragEventPool.empty()) {
         return new DragEvent();
     }
-    DragEvent* event = mDragEventPool.front().release();
-    mDragEventPool.pop();
+    DragEvent* event = mDragEventPool.back().release();
+    mDragEventPool.pop_back();
     return event;
 }
 
@@ -1310,8 +1317,8 @@ TouchModeEvent* PooledInputEventFactory::createTouchModeEvent() {
     if (mTouchModeEventPool.empty()) {
         return new TouchModeEvent();
     }
-    TouchModeEvent* event = mTouchModeEventPool.front().release();
-    mTouchModeEventPool.pop();
+    TouchModeEvent* event = mTouchModeEventPool.back().release();
+    mTouchModeEventPool.pop_back();
     return event;
 }
 
@@ -1319,14 +1326,14 @@ void PooledInputEventFactory::recycle(InputEvent* event) {
     switch (event->getType()) {
         case InputEventType::KEY: {
             if (mKeyEventPool.size() < mMaxPoolSize) {
-                mKeyEventPool.push(std::unique_ptr<KeyEvent>(static_cast<KeyEvent*>(event)));
+                mKeyEventPool.push_back(std::unique_ptr<KeyEvent>(static_cast<KeyEvent*>(event)));
                 return;
             }
             break;
         }
         case InputEventType::MOTION: {
             if (mMotionEventPool.size() < mMaxPoolSize) {
-                mMotionEventPool.push(
+                mMotionEventPool.push_back(
                         std::unique_ptr<MotionEvent>(static_cast<MotionEvent*>(event)));
                 return;
             }
@@ -1334,14 +1341,15 @@ void PooledInputEventFactory::recycle(InputEvent* event) {
         }
         case InputEventType::FOCUS: {
             if (mFocusEventPool.size() < mMaxPoolSize) {
-                mFocusEventPool.push(std::unique_ptr<FocusEvent>(static_cast<FocusEvent*>(event)));
+                mFocusEventPool.push_back(
+                        std::unique_ptr<FocusEvent>(static_cast<FocusEvent*>(event)));
                 return;
             }
             break;
         }
         case InputEventType::CAPTURE: {
             if (mCaptureEventPool.size() < mMaxPoolSize) {
-                mCaptureEventPool.push(
+                mCaptureEventPool.push_back(
                         std::unique_ptr<CaptureEvent>(static_cast<CaptureEvent*>(event)));
                 return;
             }
@@ -1349,14 +1357,15 @@ void PooledInputEventFactory::recycle(InputEvent* event) {
         }
         case InputEventType::DRAG: {
             if (mDragEventPool.size() < mMaxPoolSize) {
-                mDragEventPool.push(std::unique_ptr<DragEvent>(static_cast<DragEvent*>(event)));
+                mDragEventPool.push_back(
+                        std::unique_ptr<DragEvent>(static_cast<DragEvent*>(event)));
                 return;
             }
             break;
         }
         case InputEventType::TOUCH_MODE: {
             if (mTouchModeEventPool.size() < mMaxPoolSize) {
-                mTouchModeEventPool.push(
+                mTouchModeEventPool.push_back(
                         std::unique_ptr<TouchModeEvent>(static_cast<TouchModeEvent*>(event)));
                 return;
             }
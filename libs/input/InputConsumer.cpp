@@ -172,6 +172,12 @@ const nsecs_t RESAMPLE_MAX_PREDICTION = 8 * NANOS_PER_MS;
  */
 const char* PROPERTY_RESAMPLING_ENABLED = "ro.input.resampling";
 
+// Storage kept from consumed batches. There is usually one batch per device that is moving.
+constexpr size_t MAX_SPARE_BATCHES = 4;
+
+// Storage kept from finished events. It covers the events that are in flight at a high rate.
+constexpr size_t MAX_SPARE_CONSUME_TIMES = 64;
+
 inline float lerp(float a, float b, float alpha) {
     return a + alpha * (b - a);
 }
@@ -205,7 +211,9 @@ InputConsumer::InputConsumer(const std::shared_ptr<InputChannel>& channel,
                                        mChannel->getName().c_str(), this)),
         mLifetimeTraceCookie(
                 static_cast<int32_t>(reinterpret_cast<std::uintptr_t>(this) & 0xFFFFFFFF)),
-        mMsgDeferred(false) {
+        mMsgDeferred(false),
+        mConsumeTimeNodes(MAX_SPARE_CONSUME_TIMES) {
+    mSpareBatchSamples.reserve(MAX_SPARE_BATCHES);
     ATRACE_ASYNC_BEGIN(mLifetimeTraceTag.c_str(), /*cookie=*/mLifetimeTraceCookie);
 }
 
@@ -238,10 +246,11 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
             android::base::Result<InputMessage> result = mChannel->receiveMessage();
             if (result.ok()) {
                 mMsg = std::move(result.value());
-                const auto [_, inserted] =
-                        mConsumeTimes.emplace(mMsg.header.seq, systemTime(SYSTEM_TIME_MONOTONIC));
+                const auto [it, inserted] =
+                        mConsumeTimeNodes.tryEmplace(mConsumeTimes, mMsg.header.seq);
                 LOG_ALWAYS_FATAL_IF(!inserted, "Already have a consume time for seq=%" PRIu32,
                                     mMsg.header.seq);
+                it->second = systemTime(SYSTEM_TIME_MONOTONIC);
 
                 // Trace the event processing timeline - event was just read from the socket
                 ATRACE_ASYNC_BEGIN(mProcessingTraceTag.c_str(), /*cookie=*/mMsg.header.seq);
@@ -293,15 +302,14 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                             const InputMessage& msg = batch.samples[i];
                             sendFinishedSignal(msg.header.seq, false);
                         }
-                        batch.samples.erase(batch.samples.begin(), batch.samples.begin() + count);
-                        mBatches.erase(mBatches.begin() + batchIndex);
+                        eraseBatch(batchIndex);
                     } else {
                         // We cannot append to the batch in progress, so we need to consume
                         // the previous batch right now and defer the new message until later.
                         mMsgDeferred = true;
                         status_t result = consumeSamples(factory, batch, batch.samples.size(),
                                                          outSeq, outEvent);
-                        mBatches.erase(mBatches.begin() + batchIndex);
+                        eraseBatch(batchIndex);
                         if (result) {
                             return result;
                         }
@@ -316,9 +324,7 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                 // Start a new batch if needed.
                 if (mMsg.body.motion.action == AMOTION_EVENT_ACTION_MOVE ||
                     mMsg.body.motion.action == AMOTION_EVENT_ACTION_HOVER_MOVE) {
-                    Batch batch;
-                    batch.samples.push_back(mMsg);
-                    mBatches.push_back(batch);
+                    startBatch(mMsg);
                     ALOGD_IF(DEBUG_TRANSPORT_CONSUMER,
                              "channel '%s' consumer ~ started batch event",
                              mChannel->getName().c_str());
@@ -400,7 +406,7 @@ status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory, nsecs_
         Batch& batch = mBatches[i];
         if (frameTime < 0) {
             result = consumeSamples(factory, batch, batch.samples.size(), outSeq, outEvent);
-            mBatches.erase(mBatches.begin() + i);
+            eraseBatch(i);
             return result;
         }
 
@@ -416,7 +422,7 @@ status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory, nsecs_
         result = consumeSamples(factory, batch, split + 1, outSeq, outEvent);
         const InputMessage* next;
         if (batch.samples.empty()) {
-            mBatches.erase(mBatches.begin() + i);
+            eraseBatch(i);
             next = nullptr;
         } else {
             next = &batch.samples[0];
@@ -775,7 +781,9 @@ nsecs_t InputConsumer::getConsumeTime(uint32_t seq) const {
 }
 
 void InputConsumer::popConsumeTime(uint32_t seq) {
-    mConsumeTimes.erase(seq);
+    if (auto it = mConsumeTimes.find(seq); it != mConsumeTimes.end()) {
+        mConsumeTimeNodes.erase(mConsumeTimes, it);
+    }
 }
 
 status_t InputConsumer::sendUnchainedFinishedSignal(uint32_t seq, bool handled) {
@@ -815,6 +823,25 @@ bool InputConsumer::probablyHasInput() const {
     return hasPendingBatch() || mChannel->probablyHasInput();
 }
 
+void InputConsumer::startBatch(const InputMessage& msg) {
+    Batch batch;
+    if (!mSpareBatchSamples.empty()) {
+        batch.samples = std::move(mSpareBatchSamples.back());
+        mSpareBatchSamples.pop_back();
+    }
+    batch.samples.push_back(msg);
+    mBatches.push_back(std::move(batch));
+}
+
+void InputConsumer::eraseBatch(size_t index) {
+    std::vector<InputMessage>& samples = mBatches[index].samples;
+    if (mSpareBatchSamples.size() < MAX_SPARE_BATCHES) {
+        samples.clear();
+        mSpareBatchSamples.push_back(std::move(samples));
+    }
+    mBatches.erase(mBatches.begin() + index);
+}
+
 ssize_t InputConsumer::findBatch(int32_t deviceId, int32_t source) const {
     for (size_t i = 0; i < mBatches.size(); i++) {
         const Batch& batch = mBatches[i];
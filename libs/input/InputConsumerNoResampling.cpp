@@ -17,6 +17,8 @@
 #define LOG_TAG "InputConsumerNoResampling"
 #define ATRACE_TAG ATRACE_TAG_INPUT
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 
 #include <inttypes.h>
@@ -26,6 +28,7 @@
 #include <android-base/stringprintf.h>
 #include <cutils/properties.h>
 #include <ftl/enum.h>
+#include <ftl/small_vector.h>
 #include <utils/Trace.h>
 
 #include <com_android_input_flags.h>
@@ -46,6 +49,15 @@ using std::chrono::nanoseconds;
 const bool DEBUG_TRANSPORT_CONSUMER =
         __android_log_is_loggable(ANDROID_LOG_DEBUG, LOG_TAG "Consumer", ANDROID_LOG_INFO);
 
+// Motion events kept for the next ones, once the caller gives them back.
+constexpr size_t MAX_RECYCLED_MOTION_EVENTS = 4;
+
+// Map entries kept for the next ones. This covers the events in flight at a high rate, and the
+// devices that are moving at the same time.
+constexpr size_t MAX_SPARE_CONSUME_TIMES = 64;
+constexpr size_t MAX_SPARE_BATCHES = 4;
+constexpr size_t MAX_SPARE_BATCHED_SEQUENCE_NUMBERS = 16;
+
 std::unique_ptr<KeyEvent> createKeyEvent(const InputMessage& msg) {
     std::unique_ptr<KeyEvent> event = std::make_unique<KeyEvent>();
     event->initialize(msg.body.key.eventId, msg.body.key.deviceId, msg.body.key.source,
@@ -75,16 +87,13 @@ std::unique_ptr<DragEvent> createDragEvent(const InputMessage& msg) {
     return event;
 }
 
-std::unique_ptr<MotionEvent> createMotionEvent(const InputMessage& msg) {
-    std::unique_ptr<MotionEvent> event = std::make_unique<MotionEvent>();
+void initializeMotionEvent(MotionEvent& event, const InputMessage& msg) {
     const uint32_t pointerCount = msg.body.motion.pointerCount;
-    std::vector<PointerProperties> pointerProperties;
-    pointerProperties.reserve(pointerCount);
-    std::vector<PointerCoords> pointerCoords;
-    pointerCoords.reserve(pointerCount);
+    std::array<PointerProperties, MAX_POINTERS> pointerProperties;
+    std::array<PointerCoords, MAX_POINTERS> pointerCoords;
     for (uint32_t i = 0; i < pointerCount; i++) {
-        pointerProperties.push_back(msg.body.motion.pointers[i].properties);
-        pointerCoords.push_back(msg.body.motion.pointers[i].coords);
+        pointerProperties[i] = msg.body.motion.pointers[i].properties;
+        pointerCoords[i] = msg.body.motion.pointers[i].coords;
     }
 
     ui::Transform transform;
@@ -94,24 +103,28 @@ std::unique_ptr<MotionEvent> createMotionEvent(const InputMessage& msg) {
     displayTransform.set({msg.body.motion.dsdxRaw, msg.body.motion.dtdxRaw, msg.body.motion.txRaw,
                           msg.body.motion.dtdyRaw, msg.body.motion.dsdyRaw, msg.body.motion.tyRaw,
                           0, 0, 1});
-    event->initialize(msg.body.motion.eventId, msg.body.motion.deviceId, msg.body.motion.source,
-                      ui::LogicalDisplayId{msg.body.motion.displayId}, msg.body.motion.hmac,
-                      msg.body.motion.action, msg.body.motion.actionButton, msg.body.motion.flags,
-                      msg.body.motion.edgeFlags, msg.body.motion.metaState,
-                      msg.body.motion.buttonState, msg.body.motion.classification, transform,
-                      msg.body.motion.xPrecision, msg.body.motion.yPrecision,
-                      msg.body.motion.xCursorPosition, msg.body.motion.yCursorPosition,
-                      displayTransform, msg.body.motion.downTime, msg.body.motion.eventTime,
-                      pointerCount, pointerProperties.data(), pointerCoords.data());
+    event.initialize(msg.body.motion.eventId, msg.body.motion.deviceId, msg.body.motion.source,
+                     ui::LogicalDisplayId{msg.body.motion.displayId}, msg.body.motion.hmac,
+                     msg.body.motion.action, msg.body.motion.actionButton, msg.body.motion.flags,
+                     msg.body.motion.edgeFlags, msg.body.motion.metaState,
+                     msg.body.motion.buttonState, msg.body.motion.classification, transform,
+                     msg.body.motion.xPrecision, msg.body.motion.yPrecision,
+                     msg.body.motion.xCursorPosition, msg.body.motion.yCursorPosition,
+                     displayTransform, msg.body.motion.downTime, msg.body.motion.eventTime,
+                     pointerCount, pointerProperties.data(), pointerCoords.data());
+}
+
+std::unique_ptr<MotionEvent> createMotionEvent(const InputMessage& msg) {
+    std::unique_ptr<MotionEvent> event = std::make_unique<MotionEvent>();
+    initializeMotionEvent(*event, msg);
     return event;
 }
 
 void addSample(MotionEvent& event, const InputMessage& msg) {
     uint32_t pointerCount = msg.body.motion.pointerCount;
-    std::vector<PointerCoords> pointerCoords;
-    pointerCoords.reserve(pointerCount);
+    std::array<PointerCoords, MAX_POINTERS> pointerCoords;
     for (uint32_t i = 0; i < pointerCount; i++) {
-        pointerCoords.push_back(msg.body.motion.pointers[i].coords);
+        pointerCoords[i] = msg.body.motion.pointers[i].coords;
     }
 
     // TODO(b/329770983): figure out if it's safe to combine events with mismatching metaState
@@ -187,7 +200,11 @@ InputConsumerNoResampling::InputConsumerNoResampling(const std::shared_ptr<Input
         mLooper{looper},
         mCallbacks{callbacks},
         mResampler{std::move(resampler)},
-        mFdEvents(0) {
+        mFdEvents(0),
+        mConsumeTimeNodes(MAX_SPARE_CONSUME_TIMES),
+        mBatchNodes(MAX_SPARE_BATCHES),
+        mBatchedSequenceNumberNodes(MAX_SPARE_BATCHED_SEQUENCE_NUMBERS) {
+    mRecycledMotionEvents.reserve(MAX_RECYCLED_MOTION_EVENTS);
     LOG_ALWAYS_FATAL_IF(mLooper == nullptr);
     mCallback = sp<LooperEventCallback>::make(
             std::bind(&InputConsumerNoResampling::handleReceiveCallback, this,
@@ -225,7 +242,12 @@ int InputConsumerNoResampling::handleReceiveCallback(int events) {
 
     int handledEvents = 0;
     if (events & ALOOPER_EVENT_INPUT) {
-        handleMessages(readAllMessages());
+        // Take the buffer, in case a callback reads from the channel again.
+        std::vector<InputMessage> messages = std::move(mReadBuffer);
+        messages.clear();
+        readAllMessages(messages);
+        handleMessages(messages);
+        mReadBuffer = std::move(messages);
         handledEvents |= ALOOPER_EVENT_INPUT;
     }
 
@@ -277,11 +299,28 @@ void InputConsumerNoResampling::finishInputEvent(uint32_t seq, bool handled) {
         for (uint32_t subSeq : it->second) {
             mOutboundQueue.push(createFinishedMessage(subSeq, handled, popConsumeTime(subSeq)));
         }
-        mBatchedSequenceNumbers.erase(it);
+        mBatchedSequenceNumberNodes.erase(mBatchedSequenceNumbers, it);
     }
     processOutboundEvents();
 }
 
+void InputConsumerNoResampling::recycleMotionEvent(std::unique_ptr<MotionEvent> event) {
+    ensureCalledOnLooperThread(__func__);
+    if (event != nullptr && mRecycledMotionEvents.size() < MAX_RECYCLED_MOTION_EVENTS) {
+        mRecycledMotionEvents.push_back(std::move(event));
+    }
+}
+
+std::unique_ptr<MotionEvent> InputConsumerNoResampling::obtainMotionEvent(const InputMessage& msg) {
+    if (mRecycledMotionEvents.empty()) {
+        return createMotionEvent(msg);
+    }
+    std::unique_ptr<MotionEvent> event = std::move(mRecycledMotionEvents.back());
+    mRecycledMotionEvents.pop_back();
+    initializeMotionEvent(*event, msg);
+    return event;
+}
+
 bool InputConsumerNoResampling::probablyHasInput() const {
     // Ideally, this would only be allowed to run on the looper thread, and in production, it will.
     // However, for testing, it's convenient to call this while the looper thread is blocked, so
@@ -303,7 +342,7 @@ nsecs_t InputConsumerNoResampling::popConsumeTime(uint32_t seq) {
     LOG_ALWAYS_FATAL_IF(it == mConsumeTimes.end(), "Could not find consume time for seq=%" PRIu32,
                         seq);
     nsecs_t consumeTime = it->second;
-    mConsumeTimes.erase(it);
+    mConsumeTimeNodes.erase(mConsumeTimes, it);
     return consumeTime;
 }
 
@@ -318,7 +357,7 @@ void InputConsumerNoResampling::setFdEvents(int events) {
     }
 }
 
-void InputConsumerNoResampling::handleMessages(std::vector<InputMessage>&& messages) {
+void InputConsumerNoResampling::handleMessages(const std::vector<InputMessage>& messages) {
     // TODO(b/297226446) : add resampling
     for (const InputMessage& msg : messages) {
         if (msg.header.type == InputMessage::Type::MOTION) {
@@ -331,7 +370,8 @@ void InputConsumerNoResampling::handleMessages(std::vector<InputMessage>&& messa
                      isFromSource(source, AINPUT_SOURCE_CLASS_JOYSTICK));
             if (batchableEvent) {
                 // add it to batch
-                mBatches[deviceId].emplace(msg);
+                // A reused batch is empty, since batches are only erased once consumed.
+                mBatchNodes.tryEmplace(mBatches, deviceId).first->second.emplace(msg);
             } else {
                 // consume all pending batches for this device immediately
                 consumeBatchedInputEvents(deviceId, /*requestedFrameTime=*/std::nullopt);
@@ -349,10 +389,14 @@ void InputConsumerNoResampling::handleMessages(std::vector<InputMessage>&& messa
     // "mBatches" variable could change when 'InputConsumerCallbacks::onBatchedInputEventPending' is
     // invoked. We also can't notify the InputConsumerCallbacks in a while loop until mBatches is
     // empty, because the receiver could choose to not consume the batch immediately.
-    std::set<int32_t> pendingBatchSources;
+    ftl::SmallVector<int32_t, 4> pendingBatchSources;
     for (const auto& [_, pendingMessages] : mBatches) {
         // Assume that all messages for a given device has the same source.
-        pendingBatchSources.insert(pendingMessages.front().body.motion.source);
+        const int32_t source = pendingMessages.front().body.motion.source;
+        if (std::find(pendingBatchSources.begin(), pendingBatchSources.end(), source) ==
+            pendingBatchSources.end()) {
+            pendingBatchSources.push_back(source);
+        }
     }
     for (const int32_t source : pendingBatchSources) {
         const bool sourceStillRemaining =
@@ -365,26 +409,26 @@ void InputConsumerNoResampling::handleMessages(std::vector<InputMessage>&& messa
     }
 }
 
-std::vector<InputMessage> InputConsumerNoResampling::readAllMessages() {
-    std::vector<InputMessage> messages;
+void InputConsumerNoResampling::readAllMessages(std::vector<InputMessage>& outMessages) {
     while (true) {
         android::base::Result<InputMessage> result = mChannel->receiveMessage();
         if (result.ok()) {
             const InputMessage& msg = *result;
-            const auto [_, inserted] =
-                    mConsumeTimes.emplace(msg.header.seq, systemTime(SYSTEM_TIME_MONOTONIC));
+            const auto [it, inserted] =
+                    mConsumeTimeNodes.tryEmplace(mConsumeTimes, msg.header.seq);
             LOG_ALWAYS_FATAL_IF(!inserted, "Already have a consume time for seq=%" PRIu32,
                                 msg.header.seq);
+            it->second = systemTime(SYSTEM_TIME_MONOTONIC);
 
             // Trace the event processing timeline - event was just read from the socket
             // TODO(b/329777420): distinguish between multiple instances of InputConsumer
             // in the same process.
             ATRACE_ASYNC_BEGIN("InputConsumer processing", /*cookie=*/msg.header.seq);
-            messages.push_back(msg);
+            outMessages.push_back(msg);
         } else { // !result.ok()
             switch (result.error().code()) {
                 case WOULD_BLOCK: {
-                    return messages;
+                    return;
                 }
                 case DEAD_OBJECT: {
                     LOG(FATAL) << "Got a dead object for " << mChannel->getName();
@@ -403,7 +447,7 @@ std::vector<InputMessage> InputConsumerNoResampling::readAllMessages() {
     }
 }
 
-void InputConsumerNoResampling::handleMessage(const InputMessage& msg) const {
+void InputConsumerNoResampling::handleMessage(const InputMessage& msg) {
     switch (msg.header.type) {
         case InputMessage::Type::KEY: {
             std::unique_ptr<KeyEvent> keyEvent = createKeyEvent(msg);
@@ -412,7 +456,7 @@ void InputConsumerNoResampling::handleMessage(const InputMessage& msg) const {
         }
 
         case InputMessage::Type::MOTION: {
-            std::unique_ptr<MotionEvent> motionEvent = createMotionEvent(msg);
+            std::unique_ptr<MotionEvent> motionEvent = obtainMotionEvent(msg);
             mCallbacks.onMotionEvent(std::move(motionEvent), msg.header.seq);
             break;
         }
@@ -456,6 +500,7 @@ InputConsumerNoResampling::createBatchedMotionEvent(const nsecs_t requestedFrame
                                                     std::queue<InputMessage>& messages) {
     std::unique_ptr<MotionEvent> motionEvent;
     std::optional<uint32_t> firstSeqForBatch;
+    std::vector<uint32_t>* batchedSequenceNumbers = nullptr;
     const nanoseconds resampleLatency =
             (mResampler != nullptr) ? mResampler->getResampleLatency() : nanoseconds{0};
     const nanoseconds adjustedFrameTime = nanoseconds{requestedFrameTime} - resampleLatency;
@@ -463,14 +508,18 @@ InputConsumerNoResampling::createBatchedMotionEvent(const nsecs_t requestedFrame
     while (!messages.empty() &&
            (messages.front().body.motion.eventTime <= adjustedFrameTime.count())) {
         if (motionEvent == nullptr) {
-            motionEvent = createMotionEvent(messages.front());
+            motionEvent = obtainMotionEvent(messages.front());
             firstSeqForBatch = messages.front().header.seq;
-            const auto [_, inserted] = mBatchedSequenceNumbers.insert({*firstSeqForBatch, {}});
+            const auto [it, inserted] =
+                    mBatchedSequenceNumberNodes.tryEmplace(mBatchedSequenceNumbers,
+                                                           *firstSeqForBatch);
             LOG_IF(FATAL, !inserted)
                     << "The sequence " << messages.front().header.seq << " was already present!";
+            it->second.clear();
+            batchedSequenceNumbers = &it->second;
         } else {
             addSample(*motionEvent, messages.front());
-            mBatchedSequenceNumbers[*firstSeqForBatch].push_back(messages.front().header.seq);
+            batchedSequenceNumbers->push_back(messages.front().header.seq);
         }
         messages.pop();
     }
@@ -517,7 +566,13 @@ bool InputConsumerNoResampling::consumeBatchedInputEvents(
             break;
         }
     }
-    std::erase_if(mBatches, [](const auto& pair) { return pair.second.empty(); });
+    for (auto it = mBatches.begin(); it != mBatches.end();) {
+        auto next = std::next(it);
+        if (it->second.empty()) {
+            mBatchNodes.erase(mBatches, it);
+        }
+        it = next;
+    }
     return producedEvents;
 }
 
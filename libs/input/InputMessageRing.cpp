@@ -0,0 +1,167 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "InputMessageRing"
+
+#include <input/InputMessageRing.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <android-base/logging.h>
+#include <cutils/ashmem.h>
+#include <utils/Errors.h>
+
+#include <new>
+
+namespace android {
+
+namespace {
+
+bool isPowerOfTwo(uint32_t n) {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+} // namespace
+
+size_t InputMessageRing::getMemorySize(uint32_t capacity) {
+    return sizeof(Header) + capacity * sizeof(Slot);
+}
+
+std::unique_ptr<InputMessageRing> InputMessageRing::create(const std::string& name,
+                                                           uint32_t capacity) {
+    if (!isPowerOfTwo(capacity)) {
+        LOG(ERROR) << "Ring capacity must be a power of two, not " << capacity;
+        return nullptr;
+    }
+    const size_t size = getMemorySize(capacity);
+    android::base::unique_fd fd(ashmem_create_region(name.c_str(), size));
+    if (!fd.ok()) {
+        PLOG(ERROR) << "Could not create the shared memory for ring '" << name << "'";
+        return nullptr;
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (memory == MAP_FAILED) {
+        PLOG(ERROR) << "Could not map the shared memory for ring '" << name << "'";
+        return nullptr;
+    }
+    new (memory) Header{};
+    return std::unique_ptr<InputMessageRing>(
+            new InputMessageRing(std::move(fd), memory, size, capacity));
+}
+
+std::unique_ptr<InputMessageRing> InputMessageRing::map(android::base::unique_fd fd) {
+    if (!ashmem_valid(fd.get())) {
+        LOG(ERROR) << "Ring fd " << fd.get() << " is not shared memory";
+        return nullptr;
+    }
+    const int regionSize = ashmem_get_size_region(fd.get());
+    const size_t size = regionSize < 0 ? 0 : static_cast<size_t>(regionSize);
+    if (size < sizeof(Header) || (size - sizeof(Header)) % sizeof(Slot) != 0) {
+        LOG(ERROR) << "Ring fd " << fd.get() << " has an invalid size " << regionSize;
+        return nullptr;
+    }
+    const size_t slotCount = (size - sizeof(Header)) / sizeof(Slot);
+    if (slotCount > UINT32_MAX || !isPowerOfTwo(static_cast<uint32_t>(slotCount))) {
+        LOG(ERROR) << "Ring fd " << fd.get() << " has an invalid capacity " << slotCount;
+        return nullptr;
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (memory == MAP_FAILED) {
+        PLOG(ERROR) << "Could not map the shared memory of ring fd " << fd.get();
+        return nullptr;
+    }
+    return std::unique_ptr<InputMessageRing>(
+            new InputMessageRing(std::move(fd), memory, size, static_cast<uint32_t>(slotCount)));
+}
+
+InputMessageRing::InputMessageRing(android::base::unique_fd fd, void* memory, size_t size,
+                                   uint32_t capacity)
+      : mFd(std::move(fd)),
+        mMemory(memory),
+        mSize(size),
+        mCapacity(capacity),
+        mHeader(static_cast<Header*>(memory)),
+        mSlots(reinterpret_cast<Slot*>(static_cast<uint8_t*>(memory) + sizeof(Header))) {}
+
+InputMessageRing::~InputMessageRing() {
+    munmap(mMemory, mSize);
+}
+
+android::base::unique_fd InputMessageRing::dupFd() const {
+    return android::base::unique_fd(::fcntl(mFd.get(), F_DUPFD_CLOEXEC, 0));
+}
+
+bool InputMessageRing::push(const InputMessage& msg, bool& outNeedsWakeup) {
+    const uint32_t head = mHeader->head.load(std::memory_order_relaxed);
+    const uint32_t tail = mHeader->tail.load();
+    if (head - tail >= mCapacity) {
+        return false;
+    }
+
+    InputMessage cleanMsg;
+    msg.getSanitizedCopy(&cleanMsg);
+    Slot& slot = mSlots[head & (mCapacity - 1)];
+    slot.size = msg.size();
+    memcpy(&slot.message, &cleanMsg, slot.size);
+
+    // Publishing the message and then reading the tail, while the reader advances the tail and
+    // then reads the head, guarantees that at least one of the two sees the other: either the
+    // reader finds this message, or the writer finds that the reader ran out of messages.
+    mHeader->head.store(head + 1);
+    outNeedsWakeup = mHeader->tail.load() == head;
+    return true;
+}
+
+android::base::Result<InputMessage> InputMessageRing::pop() {
+    const uint32_t tail = mHeader->tail.load(std::memory_order_relaxed);
+    const uint32_t head = mHeader->head.load();
+    if (head == tail) {
+        return android::base::Error(WOULD_BLOCK);
+    }
+    if (head - tail > mCapacity) {
+        LOG(ERROR) << "Ring fd " << mFd.get() << " is corrupted, head=" << head
+                   << " tail=" << tail;
+        return android::base::Error(BAD_VALUE);
+    }
+
+    // Copy the message out before validating it, since the writer could still change the slot.
+    const Slot& slot = mSlots[tail & (mCapacity - 1)];
+    const uint32_t size = slot.size;
+    if (size > sizeof(InputMessage)) {
+        LOG(ERROR) << "Ring fd " << mFd.get() << " has a message of invalid size " << size;
+        return android::base::Error(BAD_VALUE);
+    }
+    InputMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    memcpy(&msg, &slot.message, size);
+    mHeader->tail.store(tail + 1);
+
+    if (!msg.isValid(size)) {
+        LOG(ERROR) << "Ring fd " << mFd.get() << " has an invalid message of size " << size;
+        return android::base::Error(BAD_VALUE);
+    }
+    return msg;
+}
+
+bool InputMessageRing::empty() const {
+    return mHeader->head.load() == mHeader->tail.load(std::memory_order_relaxed);
+}
+
+} // namespace android
@@ -13,6 +13,7 @@
 #include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <android-base/logging.h>
@@ -25,6 +26,7 @@
 #include <utils/Trace.h>
 
 #include <com_android_input_flags.h>
+#include <input/InputMessageRing.h>
 #include <input/InputTransport.h>
 #include <input/PrintTools.h>
 #include <input/TraceTools.h>
@@ -94,6 +96,10 @@ android::base::unique_fd dupChannelFd(int fd) {
 // behind processing touches.
 constexpr size_t SOCKET_BUFFER_SIZE = 32 * 1024;
 
+// What goes through the socket of a channel with shared memory rings. Its content doesn't matter,
+// only that there is something to read.
+constexpr uint8_t RING_DOORBELL = 1;
+
 /**
  * Crash if the events that are getting sent to the InputPublisher are inconsistent.
  * Enable this via "adb shell setprop log.tag.InputTransportVerifyEvents DEBUG"
@@ -103,6 +109,16 @@ bool verifyEvents() {
             __android_log_is_loggable(ANDROID_LOG_DEBUG, LOG_TAG "VerifyEvents", ANDROID_LOG_INFO);
 }
 
+status_t sendErrorToStatus(int error) {
+    if (error == EAGAIN || error == EWOULDBLOCK) {
+        return WOULD_BLOCK;
+    }
+    if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
+        return DEAD_OBJECT;
+    }
+    return -error;
+}
+
 } // namespace
 
 using android::base::Result;
@@ -337,8 +353,21 @@ std::unique_ptr<InputChannel> InputChannel::create(const std::string& name,
 
 std::unique_ptr<InputChannel> InputChannel::create(
         android::os::InputChannelCore&& parceledChannel) {
-    return InputChannel::create(parceledChannel.name, parceledChannel.fd.release(),
-                                parceledChannel.token);
+    std::unique_ptr<InputChannel> channel =
+            InputChannel::create(parceledChannel.name, parceledChannel.fd.release(),
+                                 parceledChannel.token);
+    if (!parceledChannel.sendRing && !parceledChannel.receiveRing) {
+        return channel;
+    }
+    if (parceledChannel.sendRing && parceledChannel.receiveRing) {
+        channel->mSendRing = InputMessageRing::map(parceledChannel.sendRing->release());
+        channel->mReceiveRing = InputMessageRing::map(parceledChannel.receiveRing->release());
+    }
+    if (channel->mSendRing == nullptr || channel->mReceiveRing == nullptr) {
+        ALOGE("channel '%s' ~ Could not map the shared memory rings", channel->getName().c_str());
+        return nullptr;
+    }
+    return channel;
 }
 
 InputChannel::InputChannel(const std::string name, android::base::unique_fd fd, sp<IBinder> token) {
@@ -383,11 +412,39 @@ status_t InputChannel::openInputChannelPair(const std::string& name,
     return OK;
 }
 
+status_t InputChannel::openInputChannelPair(const std::string& name, uint32_t ringCapacity,
+                                            std::unique_ptr<InputChannel>& outServerChannel,
+                                            std::unique_ptr<InputChannel>& outClientChannel) {
+    status_t result = openInputChannelPair(name, outServerChannel, outClientChannel);
+    if (result != OK) {
+        return result;
+    }
+
+    std::unique_ptr<InputMessageRing> toClient = InputMessageRing::create(name, ringCapacity);
+    std::unique_ptr<InputMessageRing> toServer = InputMessageRing::create(name, ringCapacity);
+    if (toClient != nullptr && toServer != nullptr) {
+        outClientChannel->mSendRing = InputMessageRing::map(toServer->dupFd());
+        outClientChannel->mReceiveRing = InputMessageRing::map(toClient->dupFd());
+    }
+    if (outClientChannel->mSendRing == nullptr || outClientChannel->mReceiveRing == nullptr) {
+        ALOGE("channel '%s' ~ Could not create the shared memory rings", name.c_str());
+        outServerChannel.reset();
+        outClientChannel.reset();
+        return NO_MEMORY;
+    }
+    outServerChannel->mSendRing = std::move(toClient);
+    outServerChannel->mReceiveRing = std::move(toServer);
+    return OK;
+}
+
 status_t InputChannel::sendMessage(const InputMessage* msg) {
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("sendMessage(inputChannel=%s, seq=0x%" PRIx32 ", type=%s)",
                                 name.c_str(), msg->header.seq,
                                 ftl::enum_string(msg->header.type).c_str()));
+    if (mSendRing != nullptr) {
+        return sendMessageThroughRing(*msg);
+    }
     const size_t msgLength = msg->size();
     InputMessage cleanMsg;
     msg->getSanitizedCopy(&cleanMsg);
@@ -400,13 +457,7 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
         int error = errno;
         ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ error sending message of type %s, %s",
                  name.c_str(), ftl::enum_string(msg->header.type).c_str(), strerror(error));
-        if (error == EAGAIN || error == EWOULDBLOCK) {
-            return WOULD_BLOCK;
-        }
-        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
-            return DEAD_OBJECT;
-        }
-        return -error;
+        return sendErrorToStatus(error);
     }
 
     if (size_t(nWrite) != msgLength) {
@@ -422,7 +473,141 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
     return OK;
 }
 
+status_t InputChannel::sendMessages(const InputMessage* msgs, size_t count, size_t& outSentCount) {
+    ATRACE_NAME_IF(ATRACE_ENABLED(),
+                   StringPrintf("sendMessages(inputChannel=%s, count=%zu)", name.c_str(), count));
+    outSentCount = 0;
+    if (mSendRing != nullptr) {
+        // One doorbell is enough for the whole batch.
+        bool needsWakeup = false;
+        for (; outSentCount < count; outSentCount++) {
+            bool messageNeedsWakeup;
+            if (!mSendRing->push(msgs[outSentCount], messageNeedsWakeup)) {
+                break;
+            }
+            needsWakeup |= messageNeedsWakeup;
+        }
+        const status_t status = needsWakeup ? ringDoorbell() : OK;
+        if (status != OK) {
+            return status;
+        }
+        return outSentCount == count ? OK : WOULD_BLOCK;
+    }
+    std::vector<InputMessage> cleanMsgs(count);
+    std::vector<iovec> iovs(count);
+    std::vector<mmsghdr> headers(count);
+    for (size_t i = 0; i < count; i++) {
+        msgs[i].getSanitizedCopy(&cleanMsgs[i]);
+        iovs[i].iov_base = &cleanMsgs[i];
+        iovs[i].iov_len = msgs[i].size();
+        headers[i].msg_hdr.msg_iov = &iovs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // Each message is its own packet, so a partial sendmmsg leaves the rest untouched.
+    while (outSentCount < count) {
+        int nSent;
+        do {
+            nSent = ::sendmmsg(getFd(), headers.data() + outSentCount, count - outSentCount,
+                               MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (nSent == -1 && errno == EINTR);
+
+        if (nSent < 0) {
+            int error = errno;
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                     "channel '%s' ~ error sending message %zu of %zu, of type %s, %s",
+                     name.c_str(), outSentCount + 1, count,
+                     ftl::enum_string(msgs[outSentCount].header.type).c_str(), strerror(error));
+            return sendErrorToStatus(error);
+        }
+
+        for (size_t i = outSentCount; i < outSentCount + nSent; i++) {
+            if (headers[i].msg_len != iovs[i].iov_len) {
+                ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                         "channel '%s' ~ error sending message type %s, send was incomplete",
+                         name.c_str(), ftl::enum_string(msgs[i].header.type).c_str());
+                outSentCount = i;
+                return DEAD_OBJECT;
+            }
+        }
+        outSentCount += nSent;
+    }
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ sent %zu messages", name.c_str(), count);
+    return OK;
+}
+
+status_t InputChannel::sendMessageThroughRing(const InputMessage& msg) {
+    bool needsWakeup;
+    if (!mSendRing->push(msg, needsWakeup)) {
+        ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ ring is full for message of type %s",
+                 name.c_str(), ftl::enum_string(msg.header.type).c_str());
+        return WOULD_BLOCK;
+    }
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ pushed message of type %s to ring",
+             name.c_str(), ftl::enum_string(msg.header.type).c_str());
+    return needsWakeup ? ringDoorbell() : OK;
+}
+
+status_t InputChannel::ringDoorbell() {
+    ssize_t nWrite;
+    do {
+        nWrite = ::send(getFd(), &RING_DOORBELL, sizeof(RING_DOORBELL),
+                        MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (nWrite == -1 && errno == EINTR);
+
+    if (nWrite < 0) {
+        const status_t status = sendErrorToStatus(errno);
+        // A full socket is full of doorbells that the other endpoint has yet to read, and it will
+        // drain the ring when it reads them.
+        return status == WOULD_BLOCK ? OK : status;
+    }
+    return OK;
+}
+
+android::base::Result<InputMessage> InputChannel::receiveMessageFromRing() {
+    while (true) {
+        android::base::Result<InputMessage> result = mReceiveRing->pop();
+        if (result.ok() || result.error().code() != WOULD_BLOCK) {
+            return result;
+        }
+
+        // The ring is empty. Reading a doorbell either finds that the other endpoint pushed to the
+        // ring since, or leaves the socket empty so that the next message wakes this endpoint up.
+        uint8_t doorbell;
+        ssize_t nRead;
+        do {
+            nRead = ::recv(getFd(), &doorbell, sizeof(doorbell), MSG_DONTWAIT);
+        } while (nRead == -1 && errno == EINTR);
+
+        if (nRead < 0) {
+            const int error = errno;
+            if (error == EAGAIN || error == EWOULDBLOCK) {
+                return android::base::Error(WOULD_BLOCK);
+            }
+            if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED) {
+                return android::base::Error(DEAD_OBJECT);
+            }
+            return android::base::Error(-error);
+        }
+        if (nRead == 0) { // check for EOF
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                     "channel '%s' ~ receive message failed because peer was closed",
+                     name.c_str());
+            return android::base::Error(DEAD_OBJECT);
+        }
+    }
+}
+
 android::base::Result<InputMessage> InputChannel::receiveMessage() {
+    if (mReceiveRing != nullptr) {
+        android::base::Result<InputMessage> result = receiveMessageFromRing();
+        ALOGD_IF(DEBUG_CHANNEL_MESSAGES && result.ok(),
+                 "channel '%s' ~ received message of type %s from ring", name.c_str(),
+                 ftl::enum_string(result->header.type).c_str());
+        return result;
+    }
+
     ssize_t nRead;
     InputMessage msg;
     do {
@@ -467,6 +652,9 @@ android::base::Result<InputMessage> InputChannel::receiveMessage() {
 }
 
 bool InputChannel::probablyHasInput() const {
+    if (mReceiveRing != nullptr && !mReceiveRing->empty()) {
+        return true;
+    }
     struct pollfd pfds = {.fd = fd.get(), .events = POLLIN};
     if (::poll(&pfds, /*nfds=*/1, /*timeout=*/0) <= 0) {
         // This can be a false negative because EINTR and ENOMEM are not handled. The latter should
@@ -486,6 +674,9 @@ void InputChannel::waitForMessage(std::chrono::milliseconds timeout) const {
     if (timeout < 0ms) {
         LOG(FATAL) << "Timeout cannot be negative, received " << timeout.count();
     }
+    if (mReceiveRing != nullptr && !mReceiveRing->empty()) {
+        return;
+    }
     struct pollfd pfds = {.fd = fd.get(), .events = POLLIN};
     int ret;
     std::chrono::time_point<std::chrono::steady_clock> stopTime =
@@ -500,13 +691,26 @@ void InputChannel::waitForMessage(std::chrono::milliseconds timeout) const {
 
 std::unique_ptr<InputChannel> InputChannel::dup() const {
     base::unique_fd newFd(dupChannelFd(fd.get()));
-    return InputChannel::create(getName(), std::move(newFd), getConnectionToken());
+    std::unique_ptr<InputChannel> channel =
+            InputChannel::create(getName(), std::move(newFd), getConnectionToken());
+    if (hasSharedMemoryRings()) {
+        channel->mSendRing = InputMessageRing::map(mSendRing->dupFd());
+        channel->mReceiveRing = InputMessageRing::map(mReceiveRing->dupFd());
+        LOG_ALWAYS_FATAL_IF(channel->mSendRing == nullptr || channel->mReceiveRing == nullptr,
+                            "channel '%s' ~ Could not duplicate the shared memory rings",
+                            getName().c_str());
+    }
+    return channel;
 }
 
 void InputChannel::copyTo(android::os::InputChannelCore& outChannel) const {
     outChannel.name = getName();
     outChannel.fd.reset(dupChannelFd(fd.get()));
     outChannel.token = getConnectionToken();
+    if (hasSharedMemoryRings()) {
+        outChannel.sendRing = android::os::ParcelFileDescriptor(mSendRing->dupFd());
+        outChannel.receiveRing = android::os::ParcelFileDescriptor(mReceiveRing->dupFd());
+    }
 }
 
 void InputChannel::moveChannel(std::unique_ptr<InputChannel> from,
@@ -514,6 +718,10 @@ void InputChannel::moveChannel(std::unique_ptr<InputChannel> from,
     outChannel.name = from->getName();
     outChannel.fd = android::os::ParcelFileDescriptor(std::move(from->fd));
     outChannel.token = from->getConnectionToken();
+    if (from->hasSharedMemoryRings()) {
+        outChannel.sendRing = android::os::ParcelFileDescriptor(from->mSendRing->dupFd());
+        outChannel.receiveRing = android::os::ParcelFileDescriptor(from->mReceiveRing->dupFd());
+    }
 }
 
 sp<IBinder> InputChannel::getConnectionToken() const {
@@ -567,7 +775,7 @@ status_t InputPublisher::publishKeyEvent(uint32_t seq, int32_t eventId, int32_t
     msg.body.key.repeatCount = repeatCount;
     msg.body.key.downTime = downTime;
     msg.body.key.eventTime = eventTime;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishMotionEvent(
@@ -583,7 +791,8 @@ status_t InputPublisher::publishMotionEvent(
                    StringPrintf("publishMotionEvent(inputChannel=%s, action=%s)",
                                 mChannel->getName().c_str(),
                                 MotionEvent::actionToString(action).c_str()));
-    if (verifyEvents()) {
+    // Batched events are verified once they are sent.
+    if (verifyEvents() && !mBatching) {
         Result<void> result =
                 mInputVerifier.processMovement(deviceId, source, action, pointerCount,
                                                pointerProperties, pointerCoords, flags);
@@ -658,7 +867,7 @@ status_t InputPublisher::publishMotionEvent(
         msg.body.motion.pointers[i].coords = pointerCoords[i];
     }
 
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool hasFocus) {
@@ -673,7 +882,7 @@ status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool h
     msg.header.seq = seq;
     msg.body.focus.eventId = eventId;
     msg.body.focus.hasFocus = hasFocus;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishCaptureEvent(uint32_t seq, int32_t eventId,
@@ -690,7 +899,7 @@ status_t InputPublisher::publishCaptureEvent(uint32_t seq, int32_t eventId,
     msg.header.seq = seq;
     msg.body.capture.eventId = eventId;
     msg.body.capture.pointerCaptureEnabled = pointerCaptureEnabled;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishDragEvent(uint32_t seq, int32_t eventId, float x, float y,
@@ -709,7 +918,7 @@ status_t InputPublisher::publishDragEvent(uint32_t seq, int32_t eventId, float x
     msg.body.drag.isExiting = isExiting;
     msg.body.drag.x = x;
     msg.body.drag.y = y;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bool isInTouchMode) {
@@ -725,9 +934,59 @@ status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bo
     msg.header.seq = seq;
     msg.body.touchMode.eventId = eventId;
     msg.body.touchMode.isInTouchMode = isInTouchMode;
+    return sendMessage(msg);
+}
+
+void InputPublisher::beginBatch() {
+    mBatching = true;
+}
+
+status_t InputPublisher::sendBatch(size_t& outSentCount) {
+    mBatching = false;
+    status_t status = mChannel->sendMessages(mBatch.data(), mBatch.size(), outSentCount);
+    if (verifyEvents()) {
+        for (size_t i = 0; i < outSentCount; i++) {
+            if (mBatch[i].header.type != InputMessage::Type::MOTION) {
+                continue;
+            }
+            if (status_t verifyStatus = verifySentMotion(mBatch[i]); verifyStatus != OK) {
+                status = verifyStatus;
+                break;
+            }
+        }
+    }
+    mBatch.clear();
+    return status;
+}
+
+status_t InputPublisher::sendMessage(const InputMessage& msg) {
+    if (mBatching) {
+        mBatch.push_back(msg);
+        return OK;
+    }
     return mChannel->sendMessage(&msg);
 }
 
+status_t InputPublisher::verifySentMotion(const InputMessage& msg) {
+    const uint32_t pointerCount = msg.body.motion.pointerCount;
+    PointerProperties pointerProperties[MAX_POINTERS];
+    PointerCoords pointerCoords[MAX_POINTERS];
+    for (uint32_t i = 0; i < pointerCount; i++) {
+        pointerProperties[i] = msg.body.motion.pointers[i].properties;
+        pointerCoords[i] = msg.body.motion.pointers[i].coords;
+    }
+    Result<void> result =
+            mInputVerifier.processMovement(msg.body.motion.deviceId, msg.body.motion.source,
+                                           msg.body.motion.action, pointerCount,
+                                           pointerProperties, pointerCoords,
+                                           msg.body.motion.flags);
+    if (!result.ok()) {
+        LOG(ERROR) << "Bad stream: " << result.error();
+        return BAD_VALUE;
+    }
+    return OK;
+}
+
 android::base::Result<InputPublisher::ConsumerResponse> InputPublisher::receiveConsumerResponse() {
     android::base::Result<InputMessage> result = mChannel->receiveMessage();
     if (!result.ok()) {
@@ -19,11 +19,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <android-base/file.h>
 #include <android/keycodes.h>
 #include <attestation/HmacKeyManager.h>
 #include <binder/Parcel.h>
 #include <input/InputEventLabels.h>
 #include <input/KeyCharacterMap.h>
+#include <input/KeyMapCache.h>
 #include <input/Keyboard.h>
 
 #include <utils/Errors.h>
@@ -43,6 +45,10 @@
 namespace android {
 
 static const char* WHITESPACE = " \t\r";
+
+// The base maps of all of the connected devices, and the overlays of a few languages, fit in the
+// cache.
+static constexpr size_t MAX_CACHED_KEY_CHARACTER_MAPS = 32;
 static const char* WHITESPACE_OR_PROPERTY_DELIMITER = " \t\r,:";
 
 struct Modifier {
@@ -84,29 +90,30 @@ static String8 toString(const char16_t* chars, size_t numChars) {
 
 KeyCharacterMap::KeyCharacterMap(const std::string& filename) : mLoadFileName(filename) {}
 
+static KeyMapCache<const KeyCharacterMap>& keyCharacterMapCache() {
+    static auto& cache = *new KeyMapCache<const KeyCharacterMap>(MAX_CACHED_KEY_CHARACTER_MAPS);
+    return cache;
+}
+
 base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::string& filename,
                                                                      Format format) {
-    Tokenizer* tokenizer;
-    status_t status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
-    if (status) {
-        return Errorf("Error {} opening key character map file {}.", status, filename.c_str());
-    }
-    std::shared_ptr<KeyCharacterMap> map =
-            std::shared_ptr<KeyCharacterMap>(new KeyCharacterMap(filename));
-    if (!map.get()) {
-        ALOGE("Error allocating key character map.");
-        return Errorf("Error allocating key character map.");
+    std::string contents;
+    if (!base::ReadFileToString(filename, &contents)) {
+        return Errorf("Error {} opening key character map file {}.", -errno, filename.c_str());
     }
-    std::unique_ptr<Tokenizer> t(tokenizer);
-    status = map->load(t.get(), format);
-    if (status == OK) {
-        return map;
-    }
-    return Errorf("Load KeyCharacterMap failed {}.", status);
+    return loadContents(filename, contents.c_str(), format);
 }
 
 base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::loadContents(
         const std::string& filename, const char* contents, Format format) {
+    // The same contents parse differently as a base map and as an overlay.
+    const std::string cacheKey = filename + "#" + std::to_string(static_cast<int32_t>(format));
+    if (std::shared_ptr<const KeyCharacterMap> cached =
+                keyCharacterMapCache().find(cacheKey, contents)) {
+        // The map may be combined with an overlay later, so it can't be the cached one.
+        return std::make_shared<KeyCharacterMap>(*cached);
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::fromContents(String8(filename.c_str()), contents, &tokenizer);
     if (status) {
@@ -122,6 +129,8 @@ base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::loadContents(
     std::unique_ptr<Tokenizer> t(tokenizer);
     status = map->load(t.get(), format);
     if (status == OK) {
+        keyCharacterMapCache().insert(cacheKey, contents,
+                                      std::make_shared<const KeyCharacterMap>(*map));
         return map;
     }
     return Errorf("Load KeyCharacterMap failed {}.", status);
@@ -155,15 +164,20 @@ void KeyCharacterMap::clear() {
 
 status_t KeyCharacterMap::reloadBaseFromFile() {
     clear();
-    Tokenizer* tokenizer;
-    status_t status = Tokenizer::open(String8(mLoadFileName.c_str()), &tokenizer);
-    if (status) {
-        ALOGE("Error %s opening key character map file %s.", statusToString(status).c_str(),
-              mLoadFileName.c_str());
-        return status;
-    }
-    std::unique_ptr<Tokenizer> t(tokenizer);
-    return load(t.get(), KeyCharacterMap::Format::BASE);
+    // The base map is usually still cached, so that removing an overlay does not parse it again.
+    base::Result<std::shared_ptr<KeyCharacterMap>> result =
+            load(mLoadFileName, KeyCharacterMap::Format::BASE);
+    if (!result.ok()) {
+        ALOGE("Error reloading key character map file %s: %s", mLoadFileName.c_str(),
+              result.error().message().c_str());
+        return UNKNOWN_ERROR;
+    }
+    KeyCharacterMap& baseMap = **result;
+    mKeys = std::move(baseMap.mKeys);
+    mType = baseMap.mType;
+    mKeysByScanCode = std::move(baseMap.mKeysByScanCode);
+    mKeysByUsageCode = std::move(baseMap.mKeysByUsageCode);
+    return OK;
 }
 
 void KeyCharacterMap::combine(const KeyCharacterMap& overlay) {
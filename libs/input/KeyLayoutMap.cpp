@@ -16,11 +16,13 @@
 
 #define LOG_TAG "KeyLayoutMap"
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android/keycodes.h>
 #include <ftl/enum.h>
 #include <input/InputEventLabels.h>
 #include <input/KeyLayoutMap.h>
+#include <input/KeyMapCache.h>
 #include <input/Keyboard.h>
 #include <log/log.h>
 #include <utils/Errors.h>
@@ -54,6 +56,14 @@ const bool DEBUG_MAPPING =
 namespace android {
 namespace {
 
+// The key layouts of all of the connected devices, and a few more, fit in the cache.
+constexpr size_t MAX_CACHED_KEY_LAYOUT_MAPS = 32;
+
+KeyMapCache<KeyLayoutMap>& keyLayoutMapCache() {
+    static auto& cache = *new KeyMapCache<KeyLayoutMap>(MAX_CACHED_KEY_LAYOUT_MAPS);
+    return cache;
+}
+
 std::optional<int> parseInt(const char* str) {
     char* end;
     errno = 0;
@@ -137,6 +147,20 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::loadContents(const std
 
 base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string& filename,
                                                                const char* contents) {
+    // Read the file up front, so that a map that was parsed from the same contents before can be
+    // shared. If the file can't be read, opening the tokenizer reports the error.
+    std::string cacheContents;
+    if (contents != nullptr) {
+        cacheContents = contents;
+    } else if (base::ReadFileToString(filename, &cacheContents)) {
+        contents = cacheContents.c_str();
+    }
+    if (contents != nullptr) {
+        if (std::shared_ptr<KeyLayoutMap> map = keyLayoutMapCache().find(filename, cacheContents)) {
+            return map;
+        }
+    }
+
     Tokenizer* tokenizer;
     status_t status;
     if (contents == nullptr) {
@@ -160,6 +184,9 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string
         return Errorf("Missing kernel config");
     }
     map->mLoadFileName = filename;
+    if (contents != nullptr) {
+        keyLayoutMapCache().insert(filename, cacheContents, map);
+    }
     return ret;
 }
 
@@ -18,22 +18,30 @@
 
 #include <input/MotionPredictor.h>
 
+#include <pthread.h>
+
 #include <algorithm>
 #include <array>
 #include <cinttypes>
 #include <cmath>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include <android-base/logging.h>
 #include <android-base/strings.h>
+#include <android-base/thread_annotations.h>
 #include <android/input.h>
 #include <com_android_input_flags.h>
+#include <system/thread_defs.h>
+#include <utils/AndroidThreads.h>
 
 #include <attestation/HmacKeyManager.h>
 #include <ftl/enum.h>
@@ -144,31 +152,217 @@ std::optional<float> JerkTracker::jerkMagnitude() const {
     return std::nullopt;
 }
 
+// --- MotionPredictor::InferenceThread ---
+
+/**
+ * Runs the model on a dedicated thread. The samples are handed over in the order that they were
+ * recorded, and the thread runs the model once on all of the samples that it received since the
+ * last run, so that it never falls behind the caller by more than one inference.
+ */
+class MotionPredictor::InferenceThread {
+public:
+    explicit InferenceThread(std::unique_ptr<TfLiteMotionPredictorModel> model);
+    ~InferenceThread();
+
+    // Add a sample to the current gesture. It is used by the next inference that is requested.
+    void pushSample(int64_t timestamp, const TfLiteMotionPredictorSample& sample);
+    // End the current gesture.
+    void endGesture();
+    // Run the model on the samples that have been pushed so far.
+    void requestInference();
+
+    // If an inference has completed since the last call, swap it into 'inference', and return
+    // true. This never waits for the model.
+    bool takeInference(Inference& inference);
+
+private:
+    struct PendingSample {
+        int64_t timestamp;
+        TfLiteMotionPredictorSample sample;
+    };
+
+    // Only accessed on the inference thread.
+    const std::unique_ptr<TfLiteMotionPredictorModel> mModel;
+    TfLiteMotionPredictorBuffers mBuffers;
+    JerkTracker mJerkTracker;
+    size_t mGesture = 0;
+    Inference mRunningInference;
+
+    std::mutex mLock;
+    std::condition_variable mWakeCondition;
+    bool mExit GUARDED_BY(mLock) = false;
+    bool mInferenceRequested GUARDED_BY(mLock) = false;
+    // The samples that the thread has yet to add to its buffers. An empty entry ends a gesture.
+    std::vector<std::optional<PendingSample>> mPendingSamples GUARDED_BY(mLock);
+    Inference mCompletedInference GUARDED_BY(mLock);
+    bool mHasCompletedInference GUARDED_BY(mLock) = false;
+
+    // Initialize the thread last, so that it does not access the members before they are
+    // constructed.
+    std::thread mThread;
+
+    void threadLoop();
+};
+
+MotionPredictor::InferenceThread::InferenceThread(std::unique_ptr<TfLiteMotionPredictorModel> model)
+      : mModel(std::move(model)),
+        mBuffers(mModel->inputLength()),
+        // See MotionPredictor::initializeObjects.
+        mJerkTracker(/*normalizedDt=*/true, mModel->config().jerkAlpha),
+        mThread([this]() { threadLoop(); }) {}
+
+MotionPredictor::InferenceThread::~InferenceThread() {
+    {
+        std::scoped_lock lock(mLock);
+        mExit = true;
+    }
+    mWakeCondition.notify_all();
+    mThread.join();
+}
+
+void MotionPredictor::InferenceThread::pushSample(int64_t timestamp,
+                                                  const TfLiteMotionPredictorSample& sample) {
+    std::scoped_lock lock(mLock);
+    mPendingSamples.push_back(PendingSample{timestamp, sample});
+}
+
+void MotionPredictor::InferenceThread::endGesture() {
+    std::scoped_lock lock(mLock);
+    mPendingSamples.push_back(std::nullopt);
+    mHasCompletedInference = false;
+}
+
+void MotionPredictor::InferenceThread::requestInference() {
+    {
+        std::scoped_lock lock(mLock);
+        mInferenceRequested = true;
+    }
+    mWakeCondition.notify_all();
+}
+
+bool MotionPredictor::InferenceThread::takeInference(Inference& inference) {
+    std::scoped_lock lock(mLock);
+    if (!mHasCompletedInference) {
+        return false;
+    }
+    std::swap(inference, mCompletedInference);
+    mHasCompletedInference = false;
+    return true;
+}
+
+void MotionPredictor::InferenceThread::threadLoop() {
+    pthread_setname_np(pthread_self(), "MotionPredictor");
+    // The predictions are needed for the next frame, so run at the priority of the UI thread.
+    androidSetThreadPriority(/*tid=*/0, ANDROID_PRIORITY_DISPLAY);
+
+    std::vector<std::optional<PendingSample>> samples;
+    while (true) {
+        {
+            std::unique_lock lock(mLock);
+            base::ScopedLockAssertion assumeLocked(mLock);
+            while (!mExit && !mInferenceRequested) {
+                mWakeCondition.wait(lock);
+            }
+            if (mExit) {
+                return;
+            }
+            mInferenceRequested = false;
+            std::swap(samples, mPendingSamples);
+        }
+
+        for (const std::optional<PendingSample>& pending : samples) {
+            if (!pending) {
+                mBuffers.reset();
+                mJerkTracker.reset();
+                mGesture++;
+                continue;
+            }
+            mBuffers.pushSample(pending->timestamp, pending->sample);
+            mJerkTracker.pushSample(pending->timestamp, pending->sample.position.x,
+                                    pending->sample.position.y);
+        }
+        samples.clear();
+        if (!mBuffers.isReady()) {
+            continue;
+        }
+
+        runInference(*mModel, mBuffers, mJerkTracker, mRunningInference);
+        mRunningInference.gesture = mGesture;
+        std::scoped_lock lock(mLock);
+        std::swap(mCompletedInference, mRunningInference);
+        mHasCompletedInference = true;
+    }
+}
+
 // --- MotionPredictor ---
 
 MotionPredictor::MotionPredictor(nsecs_t predictionTimestampOffsetNanos,
                                  std::function<bool()> checkMotionPredictionEnabled,
-                                 ReportAtomFunction reportAtomFunction)
+                                 ReportAtomFunction reportAtomFunction,
+                                 InferenceMode inferenceMode, Delegate delegate)
       : mPredictionTimestampOffsetNanos(predictionTimestampOffsetNanos),
         mCheckMotionPredictionEnabled(std::move(checkMotionPredictionEnabled)),
+        mInferenceMode(inferenceMode),
+        mDelegate(delegate),
         mReportAtomFunction(reportAtomFunction) {}
 
+MotionPredictor::~MotionPredictor() {}
+
 void MotionPredictor::initializeObjects() {
-    mModel = TfLiteMotionPredictorModel::create();
-    LOG_ALWAYS_FATAL_IF(!mModel);
+    std::unique_ptr<TfLiteMotionPredictorModel> model =
+            TfLiteMotionPredictorModel::create(mDelegate);
+    LOG_ALWAYS_FATAL_IF(!model);
+    mConfig = model->config();
+
+    mMetricsManager =
+            std::make_unique<MotionPredictorMetricsManager>(mConfig.predictionInterval,
+                                                            model->outputLength(),
+                                                            mReportAtomFunction);
+
+    if (mInferenceMode == InferenceMode::ASYNCHRONOUS) {
+        mInferenceThread = std::make_unique<InferenceThread>(std::move(model));
+        return;
+    }
+    mModel = std::move(model);
 
     // mJerkTracker assumes normalized dt = 1 between recorded samples because
     // the underlying mModel input also assumes fixed-interval samples.
     // Normalized dt as 1 is also used to correspond with the similar Jank
     // implementation from the JetPack MotionPredictor implementation.
-    mJerkTracker = std::make_unique<JerkTracker>(/*normalizedDt=*/true, mModel->config().jerkAlpha);
+    mJerkTracker = std::make_unique<JerkTracker>(/*normalizedDt=*/true, mConfig.jerkAlpha);
 
     mBuffers = std::make_unique<TfLiteMotionPredictorBuffers>(mModel->inputLength());
+}
 
-    mMetricsManager =
-            std::make_unique<MotionPredictorMetricsManager>(mModel->config().predictionInterval,
-                                                            mModel->outputLength(),
-                                                            mReportAtomFunction);
+void MotionPredictor::runInference(TfLiteMotionPredictorModel& model,
+                                   const TfLiteMotionPredictorBuffers& buffers,
+                                   const JerkTracker& jerkTracker, Inference& inference) {
+    const nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    buffers.copyTo(model);
+    LOG_ALWAYS_FATAL_IF(!model.invoke());
+    inference.latency = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+
+    if (isDebug()) {
+        ALOGD("mInputR: %s", base::Join(model.inputR(), ", ").c_str());
+        ALOGD("mInputPhi: %s", base::Join(model.inputPhi(), ", ").c_str());
+        ALOGD("mInputPressure: %s", base::Join(model.inputPressure(), ", ").c_str());
+        ALOGD("mInputTilt: %s", base::Join(model.inputTilt(), ", ").c_str());
+        ALOGD("mInputOrientation: %s", base::Join(model.inputOrientation(), ", ").c_str());
+        ALOGD("inference latency: %" PRId64 "us", ns2us(inference.latency));
+    }
+
+    // Read out the predictions. The vectors keep their capacity from the previous inferences.
+    const std::span<const float> predictedR = model.outputR();
+    const std::span<const float> predictedPhi = model.outputPhi();
+    const std::span<const float> predictedPressure = model.outputPressure();
+    inference.r.assign(predictedR.begin(), predictedR.end());
+    inference.phi.assign(predictedPhi.begin(), predictedPhi.end());
+    inference.pressure.assign(predictedPressure.begin(), predictedPressure.end());
+
+    inference.axisFrom = buffers.axisFrom().position;
+    inference.axisTo = buffers.axisTo().position;
+    inference.lastTimestamp = buffers.lastTimestamp();
+    inference.jerkMagnitude = jerkTracker.jerkMagnitude().value_or(0);
 }
 
 android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
@@ -187,7 +381,7 @@ android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
         return {};
     }
 
-    if (!mModel) {
+    if (!mMetricsManager) {
         initializeObjects();
     }
 
@@ -197,8 +391,13 @@ android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
     const int32_t action = event.getActionMasked();
     if (action == AMOTION_EVENT_ACTION_UP || action == AMOTION_EVENT_ACTION_CANCEL) {
         ALOGD_IF(isDebug(), "End of event stream");
-        mBuffers->reset();
-        mJerkTracker->reset();
+        if (mInferenceThread) {
+            mInferenceThread->endGesture();
+        } else {
+            mBuffers->reset();
+            mJerkTracker->reset();
+        }
+        mGesture++;
         mLastEvent.reset();
         return {};
     } else if (action != AMOTION_EVENT_ACTION_DOWN && action != AMOTION_EVENT_ACTION_MOVE) {
@@ -224,18 +423,23 @@ android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
             continue;
         }
         const PointerCoords* coords = event.getHistoricalRawPointerCoords(0, i);
-        mBuffers->pushSample(event.getHistoricalEventTime(i),
-                             {
-                                     .position.x = coords->getAxisValue(AMOTION_EVENT_AXIS_X),
-                                     .position.y = coords->getAxisValue(AMOTION_EVENT_AXIS_Y),
-                                     .pressure = event.getHistoricalPressure(0, i),
-                                     .tilt = event.getHistoricalAxisValue(AMOTION_EVENT_AXIS_TILT,
-                                                                          0, i),
-                                     .orientation = event.getHistoricalOrientation(0, i),
-                             });
-        mJerkTracker->pushSample(event.getHistoricalEventTime(i),
-                                 coords->getAxisValue(AMOTION_EVENT_AXIS_X),
-                                 coords->getAxisValue(AMOTION_EVENT_AXIS_Y));
+        const TfLiteMotionPredictorSample sample{
+                .position.x = coords->getAxisValue(AMOTION_EVENT_AXIS_X),
+                .position.y = coords->getAxisValue(AMOTION_EVENT_AXIS_Y),
+                .pressure = event.getHistoricalPressure(0, i),
+                .tilt = event.getHistoricalAxisValue(AMOTION_EVENT_AXIS_TILT, 0, i),
+                .orientation = event.getHistoricalOrientation(0, i),
+        };
+        if (mInferenceThread) {
+            mInferenceThread->pushSample(event.getHistoricalEventTime(i), sample);
+            continue;
+        }
+        mBuffers->pushSample(event.getHistoricalEventTime(i), sample);
+        mJerkTracker->pushSample(event.getHistoricalEventTime(i), sample.position.x,
+                                 sample.position.y);
+    }
+    if (mInferenceThread) {
+        mInferenceThread->requestInference();
     }
 
     if (!mLastEvent) {
@@ -247,30 +451,35 @@ android::base::Result<void> MotionPredictor::record(const MotionEvent& event) {
 }
 
 std::unique_ptr<MotionEvent> MotionPredictor::predict(nsecs_t timestamp) {
-    if (mBuffers == nullptr || !mBuffers->isReady()) {
-        return nullptr;
-    }
+    if (mInferenceThread) {
+        if (mInferenceThread->takeInference(mInference)) {
+            mHasInference = true;
+            mMetricsManager->onInference(mInference.latency);
+        }
+        // Do not extrapolate from the inference of a gesture that has already ended.
+        if (!mHasInference || mInference.gesture != mGesture) {
+            return nullptr;
+        }
+    } else {
+        if (mBuffers == nullptr || !mBuffers->isReady()) {
+            return nullptr;
+        }
 
-    LOG_ALWAYS_FATAL_IF(!mModel);
-    mBuffers->copyTo(*mModel);
-    LOG_ALWAYS_FATAL_IF(!mModel->invoke());
+        LOG_ALWAYS_FATAL_IF(!mModel);
+        runInference(*mModel, *mBuffers, *mJerkTracker, mInference);
+        mMetricsManager->onInference(mInference.latency);
+    }
 
-    // Read out the predictions.
-    const std::span<const float> predictedR = mModel->outputR();
-    const std::span<const float> predictedPhi = mModel->outputPhi();
-    const std::span<const float> predictedPressure = mModel->outputPressure();
+    const std::span<const float> predictedR = mInference.r;
+    const std::span<const float> predictedPhi = mInference.phi;
+    const std::span<const float> predictedPressure = mInference.pressure;
 
-    TfLiteMotionPredictorSample::Point axisFrom = mBuffers->axisFrom().position;
-    TfLiteMotionPredictorSample::Point axisTo = mBuffers->axisTo().position;
+    TfLiteMotionPredictorSample::Point axisFrom = mInference.axisFrom;
+    TfLiteMotionPredictorSample::Point axisTo = mInference.axisTo;
 
     if (isDebug()) {
         ALOGD("axisFrom: %f, %f", axisFrom.x, axisFrom.y);
         ALOGD("axisTo: %f, %f", axisTo.x, axisTo.y);
-        ALOGD("mInputR: %s", base::Join(mModel->inputR(), ", ").c_str());
-        ALOGD("mInputPhi: %s", base::Join(mModel->inputPhi(), ", ").c_str());
-        ALOGD("mInputPressure: %s", base::Join(mModel->inputPressure(), ", ").c_str());
-        ALOGD("mInputTilt: %s", base::Join(mModel->inputTilt(), ", ").c_str());
-        ALOGD("mInputOrientation: %s", base::Join(mModel->inputOrientation(), ", ").c_str());
         ALOGD("predictedR: %s", base::Join(predictedR, ", ").c_str());
         ALOGD("predictedPhi: %s", base::Join(predictedPhi, ", ").c_str());
         ALOGD("predictedPressure: %s", base::Join(predictedPressure, ", ").c_str());
@@ -280,23 +489,22 @@ std::unique_ptr<MotionEvent> MotionPredictor::predict(nsecs_t timestamp) {
     const MotionEvent& event = *mLastEvent;
     bool hasPredictions = false;
     std::unique_ptr<MotionEvent> prediction = std::make_unique<MotionEvent>();
-    int64_t predictionTime = mBuffers->lastTimestamp();
+    int64_t predictionTime = mInference.lastTimestamp;
     const int64_t futureTime = timestamp + mPredictionTimestampOffsetNanos;
 
-    const float jerkMagnitude = mJerkTracker->jerkMagnitude().value_or(0);
-    const float fractionKept =
-            1 - normalizeRange(jerkMagnitude, mModel->config().lowJerk, mModel->config().highJerk);
+    const float jerkMagnitude = mInference.jerkMagnitude;
+    const float fractionKept = 1 - normalizeRange(jerkMagnitude, mConfig.lowJerk, mConfig.highJerk);
     // float to ensure proper division below.
     const float predictionTimeWindow = futureTime - predictionTime;
     const int maxNumPredictions = static_cast<int>(
-            std::ceil(predictionTimeWindow / mModel->config().predictionInterval * fractionKept));
+            std::ceil(predictionTimeWindow / mConfig.predictionInterval * fractionKept));
     ALOGD_IF(isDebug(),
              "jerk (d^3p/normalizedDt^3): %f, fraction of prediction window pruned: %f, max number "
              "of predictions: %d",
              jerkMagnitude, 1 - fractionKept, maxNumPredictions);
     for (size_t i = 0; i < static_cast<size_t>(predictedR.size()) && predictionTime <= futureTime;
          ++i) {
-        if (predictedR[i] < mModel->config().distanceNoiseFloor) {
+        if (predictedR[i] < mConfig.distanceNoiseFloor) {
             // Stop predicting when the predicted output is below the model's noise floor.
             //
             // We assume that all subsequent predictions in the batch are unreliable because later
@@ -332,7 +540,7 @@ std::unique_ptr<MotionEvent> MotionPredictor::predict(nsecs_t timestamp) {
                             event.getRawPointerCoords(0)->getAxisValue(
                                     AMOTION_EVENT_AXIS_ORIENTATION));
 
-        predictionTime += mModel->config().predictionInterval;
+        predictionTime += mConfig.predictionInterval;
         if (i == 0) {
             hasPredictions = true;
             prediction->initialize(InputEvent::nextId(), event.getDeviceId(), event.getSource(),
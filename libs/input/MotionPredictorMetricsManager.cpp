@@ -133,11 +133,20 @@ void MotionPredictorMetricsManager::onPredict(const MotionEvent& predictionEvent
     std::sort(mRecentPredictions.begin(), mRecentPredictions.end());
 }
 
+void MotionPredictorMetricsManager::onInference(nsecs_t inferenceLatency) {
+    mInferenceLatencySum += inferenceLatency;
+    mMaxInferenceLatency = std::max(mMaxInferenceLatency, inferenceLatency);
+    ++mInferenceCount;
+}
+
 void MotionPredictorMetricsManager::clearStrokeData() {
     mRecentGroundTruthPoints.clear();
     mRecentPredictions.clear();
     std::fill(mAggregatedMetrics.begin(), mAggregatedMetrics.end(), AggregatedStrokeMetrics{});
     std::fill(mAtomFields.begin(), mAtomFields.end(), AtomFields{});
+    mInferenceLatencySum = 0;
+    mMaxInferenceLatency = 0;
+    mInferenceCount = 0;
 }
 
 void MotionPredictorMetricsManager::incorporateNewGroundTruth(
@@ -369,6 +378,14 @@ void MotionPredictorMetricsManager::computeAtomFields() {
                     static_cast<int>(averageOffTrajectoryRmse * 1000);
         }
     }
+
+    // Inference latency: like the scale-invariant errors, it is reported in the last time bucket.
+    if (mInferenceCount > 0) {
+        mAtomFields.back().inferenceLatencyMeanMicros =
+                static_cast<int>(ns2us(mInferenceLatencySum / mInferenceCount));
+        mAtomFields.back().inferenceLatencyMaxMicros =
+                static_cast<int>(ns2us(mMaxInferenceLatency));
+    }
 }
 
 void MotionPredictorMetricsManager::reportMetrics() {
@@ -17,6 +17,7 @@
 #define LOG_TAG "LegacyResampler"
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 
 #include <android-base/logging.h>
@@ -66,14 +67,38 @@ inline float lerp(float a, float b, float alpha) {
     return a + alpha * (b - a);
 }
 
-PointerCoords calculateResampledCoords(const PointerCoords& a, const PointerCoords& b,
-                                       float alpha) {
-    // We use the value of alpha to initialize resampledCoords with the latest sample information.
-    PointerCoords resampledCoords = (alpha < 1.0f) ? a : b;
-    resampledCoords.isResampled = true;
-    resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_X, lerp(a.getX(), b.getX(), alpha));
-    resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_Y, lerp(a.getY(), b.getY(), alpha));
-    return resampledCoords;
+/**
+ * Resamples the coordinates of pointerCount pointers between a and b. The resampled axes of all
+ * the pointers are gathered into arrays first, so that they are computed in a single loop that
+ * the compiler can vectorize, rather than through the getters and setters of each pointer.
+ */
+void calculateResampledCoords(const std::array<const PointerCoords*, MAX_POINTERS>& a,
+                              const std::array<const PointerCoords*, MAX_POINTERS>& b,
+                              size_t pointerCount, float alpha,
+                              std::array<PointerCoords, MAX_POINTERS>& outResampledCoords) {
+    std::array<float, MAX_POINTERS> ax, ay, bx, by;
+    for (size_t i = 0; i < pointerCount; ++i) {
+        ax[i] = a[i]->getX();
+        ay[i] = a[i]->getY();
+        bx[i] = b[i]->getX();
+        by[i] = b[i]->getY();
+    }
+
+    std::array<float, MAX_POINTERS> resampledX, resampledY;
+    for (size_t i = 0; i < pointerCount; ++i) {
+        resampledX[i] = lerp(ax[i], bx[i], alpha);
+        resampledY[i] = lerp(ay[i], by[i], alpha);
+    }
+
+    for (size_t i = 0; i < pointerCount; ++i) {
+        // We use the value of alpha to initialize resampledCoords with the latest sample
+        // information.
+        PointerCoords& resampledCoords = outResampledCoords[i];
+        resampledCoords = (alpha < 1.0f) ? *a[i] : *b[i];
+        resampledCoords.isResampled = true;
+        resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_X, resampledX[i]);
+        resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_Y, resampledY[i]);
+    }
 }
 } // namespace
 
@@ -165,12 +190,19 @@ std::optional<LegacyResampler::Sample> LegacyResampler::attemptInterpolation(
     const float alpha =
             std::chrono::duration<float, std::milli>(resampleTime - pastSample.eventTime) / delta;
 
+    const size_t pointerCount = pastSample.pointers.size();
+    std::array<const PointerCoords*, MAX_POINTERS> pastCoords, futureCoords;
+    for (size_t i = 0; i < pointerCount; ++i) {
+        pastCoords[i] = &pastSample.pointers[i].coords;
+        futureCoords[i] = &futureSample.body.motion.pointers[i].coords;
+    }
+    std::array<PointerCoords, MAX_POINTERS> resampledCoords;
+    calculateResampledCoords(pastCoords, futureCoords, pointerCount, alpha, resampledCoords);
+
     std::vector<Pointer> resampledPointers;
-    for (size_t i = 0; i < pastSample.pointers.size(); ++i) {
-        const PointerCoords& resampledCoords =
-                calculateResampledCoords(pastSample.pointers[i].coords,
-                                         futureSample.body.motion.pointers[i].coords, alpha);
-        resampledPointers.push_back(Pointer{pastSample.pointers[i].properties, resampledCoords});
+    resampledPointers.reserve(pointerCount);
+    for (size_t i = 0; i < pointerCount; ++i) {
+        resampledPointers.push_back(Pointer{pastSample.pointers[i].properties, resampledCoords[i]});
     }
     return Sample{resampleTime, resampledPointers};
 }
@@ -225,12 +257,20 @@ std::optional<LegacyResampler::Sample> LegacyResampler::attemptExtrapolation(
             std::chrono::duration<float, std::milli>(newResampleTime - pastSample.eventTime) /
             delta;
 
+    const size_t pointerCount = presentSample.pointers.size();
+    std::array<const PointerCoords*, MAX_POINTERS> pastCoords, presentCoords;
+    for (size_t i = 0; i < pointerCount; ++i) {
+        pastCoords[i] = &pastSample.pointers[i].coords;
+        presentCoords[i] = &presentSample.pointers[i].coords;
+    }
+    std::array<PointerCoords, MAX_POINTERS> resampledCoords;
+    calculateResampledCoords(pastCoords, presentCoords, pointerCount, alpha, resampledCoords);
+
     std::vector<Pointer> resampledPointers;
-    for (size_t i = 0; i < presentSample.pointers.size(); ++i) {
-        const PointerCoords& resampledCoords =
-                calculateResampledCoords(pastSample.pointers[i].coords,
-                                         presentSample.pointers[i].coords, alpha);
-        resampledPointers.push_back(Pointer{presentSample.pointers[i].properties, resampledCoords});
+    resampledPointers.reserve(pointerCount);
+    for (size_t i = 0; i < pointerCount; ++i) {
+        resampledPointers.push_back(
+                Pointer{presentSample.pointers[i].properties, resampledCoords[i]});
     }
     return Sample{newResampleTime, resampledPointers};
 }
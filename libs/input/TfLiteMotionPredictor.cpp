@@ -35,11 +35,14 @@
 #include <android-base/mapped_file.h>
 #define ATRACE_TAG ATRACE_TAG_INPUT
 #include <cutils/trace.h>
+#include <ftl/enum.h>
 #include <log/log.h>
 #include <utils/Timers.h>
 
 #include "tensorflow/lite/core/api/error_reporter.h"
 #include "tensorflow/lite/core/api/op_resolver.h"
+#include "tensorflow/lite/delegates/nnapi/nnapi_delegate.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/kernels/builtin_op_kernels.h"
 #include "tensorflow/lite/model.h"
@@ -165,6 +168,30 @@ std::unique_ptr<tflite::OpResolver> createOpResolver() {
     return resolver;
 }
 
+void deleteNnApiDelegate(TfLiteDelegate* delegate) {
+    delete static_cast<tflite::StatefulNnApiDelegate*>(delegate);
+}
+
+tflite::Interpreter::TfLiteDelegatePtr createDelegate(
+        TfLiteMotionPredictorModel::Delegate delegate) {
+    switch (delegate) {
+        case TfLiteMotionPredictorModel::Delegate::NONE:
+            break;
+        case TfLiteMotionPredictorModel::Delegate::XNNPACK: {
+            TfLiteXNNPackDelegateOptions options = TfLiteXNNPackDelegateOptionsDefault();
+            // The model is small, and runs on the thread that invokes it.
+            options.num_threads = 1;
+            return tflite::Interpreter::TfLiteDelegatePtr(TfLiteXNNPackDelegateCreate(&options),
+                                                          TfLiteXNNPackDelegateDelete);
+        }
+        case TfLiteMotionPredictorModel::Delegate::NNAPI: {
+            return tflite::Interpreter::TfLiteDelegatePtr(new tflite::StatefulNnApiDelegate(),
+                                                          deleteNnApiDelegate);
+        }
+    }
+    return tflite::Interpreter::TfLiteDelegatePtr(nullptr, [](TfLiteDelegate*) {});
+}
+
 } // namespace
 
 TfLiteMotionPredictorBuffers::TfLiteMotionPredictorBuffers(size_t inputLength)
@@ -252,7 +279,7 @@ void TfLiteMotionPredictorBuffers::pushSample(int64_t timestamp,
     mInputOrientation.pushBack(orientation);
 }
 
-std::unique_ptr<TfLiteMotionPredictorModel> TfLiteMotionPredictorModel::create() {
+std::unique_ptr<TfLiteMotionPredictorModel> TfLiteMotionPredictorModel::create(Delegate delegate) {
     const std::string modelPath = getModelPath();
     android::base::unique_fd fd(open(modelPath.c_str(), O_RDONLY));
     if (fd == -1) {
@@ -287,11 +314,11 @@ std::unique_ptr<TfLiteMotionPredictorModel> TfLiteMotionPredictorModel::create()
     };
 
     return std::unique_ptr<TfLiteMotionPredictorModel>(
-            new TfLiteMotionPredictorModel(std::move(modelBuffer), std::move(config)));
+            new TfLiteMotionPredictorModel(std::move(modelBuffer), std::move(config), delegate));
 }
 
 TfLiteMotionPredictorModel::TfLiteMotionPredictorModel(
-        std::unique_ptr<android::base::MappedFile> model, Config config)
+        std::unique_ptr<android::base::MappedFile> model, Config config, Delegate delegate)
       : mFlatBuffer(std::move(model)), mConfig(std::move(config)) {
     CHECK(mFlatBuffer);
     mErrorReporter = std::make_unique<LoggingErrorReporter>();
@@ -307,6 +334,7 @@ TfLiteMotionPredictorModel::TfLiteMotionPredictorModel(
     if (builder(&mInterpreter) != kTfLiteOk || !mInterpreter) {
         LOG_ALWAYS_FATAL("Failed to build interpreter");
     }
+    applyDelegate(delegate);
 
     mRunner = mInterpreter->GetSignatureRunner(SIGNATURE_KEY);
     LOG_ALWAYS_FATAL_IF(!mRunner, "Failed to find runner for signature '%s'", SIGNATURE_KEY);
@@ -316,6 +344,18 @@ TfLiteMotionPredictorModel::TfLiteMotionPredictorModel(
 
 TfLiteMotionPredictorModel::~TfLiteMotionPredictorModel() {}
 
+void TfLiteMotionPredictorModel::applyDelegate(Delegate delegate) {
+    tflite::Interpreter::TfLiteDelegatePtr delegatePtr = createDelegate(delegate);
+    if (!delegatePtr) {
+        return;
+    }
+    // The interpreter owns the delegate, and goes back to the built-in kernels if it fails.
+    if (mInterpreter->ModifyGraphWithDelegate(std::move(delegatePtr)) != kTfLiteOk) {
+        LOG(WARNING) << "Failed to apply the " << ftl::enum_string(delegate)
+                     << " delegate, running the model with the built-in kernels";
+    }
+}
+
 void TfLiteMotionPredictorModel::allocateTensors() {
     if (mRunner->AllocateTensors() != kTfLiteOk) {
         LOG_ALWAYS_FATAL("Failed to allocate tensors");
@@ -426,7 +426,9 @@ LeastSquaresVelocityTrackerStrategy::LeastSquaresVelocityTrackerStrategy(uint32_
       : AccumulatingVelocityTrackerStrategy(HORIZON /*horizonNanos*/,
                                             true /*maintainHorizonDuringAdd*/),
         mDegree(degree),
-        mWeighting(weighting) {}
+        mWeighting(weighting),
+        mIncremental(weighting == Weighting::NONE || weighting == Weighting::DELTA),
+        mMoments() {}
 
 LeastSquaresVelocityTrackerStrategy::~LeastSquaresVelocityTrackerStrategy() {}
 
@@ -596,53 +598,133 @@ static std::optional<float> solveLeastSquares(const std::vector<float>& x,
     return outB[1];
 }
 
-/*
- * Optimized unweighted second-order least squares fit. About 2x speed improvement compared to
- * the default implementation
- */
-std::optional<float> LeastSquaresVelocityTrackerStrategy::solveUnweightedLeastSquaresDeg2(
-        const RingBuffer<Movement>& movements) const {
-    // Solving y = a*x^2 + b*x + c, where
-    //      - "x" is age (i.e. duration since latest movement) of the movemnets
-    //      - "y" is positions of the movements.
-    float sxi = 0, sxiyi = 0, syi = 0, sxi2 = 0, sxi3 = 0, sxi2yi = 0, sxi4 = 0;
-
-    const size_t count = movements.size();
-    const Movement& newestMovement = movements[count - 1];
-    for (size_t i = 0; i < count; i++) {
+void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, int32_t pointerId,
+                                                      float position) {
+    if (!mIncremental) {
+        AccumulatingVelocityTrackerStrategy::addMovement(eventTime, pointerId, position);
+        return;
+    }
+
+    // This goes through the same steps as AccumulatingVelocityTrackerStrategy::addMovement, while
+    // keeping the moments up to date with every movement but the newest one.
+    auto [ringBufferIt, _] = mMovements.try_emplace(pointerId, HISTORY_SIZE);
+    RingBuffer<Movement>& movements = ringBufferIt->second;
+    Moments& moments = mMoments[pointerId];
+    if (movements.size() == 0) {
+        moments = {.anchorTime = eventTime};
+    }
+
+    if (movements.size() != 0 && movements[movements.size() - 1].eventTime == eventTime) {
+        // Replace the movement that has the same time, as the base class does. The movement
+        // before it becomes the newest one, so it leaves the moments.
+        movements.popBack();
+        if (const size_t size = movements.size(); size != 0) {
+            const Movement& movement = movements[size - 1];
+            const float weight = chooseIncrementalWeight(movement.eventTime, eventTime);
+            accumulate(moments, movement, weight, -1);
+        }
+    }
+    if (movements.size() == HISTORY_SIZE) {
+        removeOldestMovement(moments, movements);
+    }
+    if (const size_t size = movements.size(); size != 0) {
+        const Movement& movement = movements[size - 1];
+        accumulate(moments, movement, chooseIncrementalWeight(movement.eventTime, eventTime),
+                   1);
+    }
+    movements.pushBack({eventTime, position});
+
+    while (eventTime - movements[0].eventTime > mHorizonNanos) {
+        removeOldestMovement(moments, movements);
+    }
+
+    // Keep the times small, so that the fit stays accurate. This also discards the rounding
+    // errors of the movements that were removed.
+    if (movements[0].eventTime - moments.anchorTime > mHorizonNanos) {
+        rebuildMoments(moments, movements);
+    }
+}
+
+void LeastSquaresVelocityTrackerStrategy::accumulate(Moments& moments, const Movement& movement,
+                                                     float weight, double sign) const {
+    // The times are converted in double precision, like the sums.
+    const double x = (movement.eventTime - moments.anchorTime) * 1E-9;
+    const double w2 = sign * weight * weight;
+    double term = w2;
+    for (size_t i = 0; i < moments.sumX.size(); i++) {
+        moments.sumX[i] += term;
+        if (i < moments.sumXY.size()) {
+            moments.sumXY[i] += term * movement.position;
+        }
+        term *= x;
+    }
+}
+
+void LeastSquaresVelocityTrackerStrategy::removeOldestMovement(
+        Moments& moments, RingBuffer<Movement>& movements) const {
+    // The oldest movement is never the newest one here, so it is part of the moments.
+    const Movement& oldest = movements[0];
+    const float weight = chooseIncrementalWeight(oldest.eventTime, movements[1].eventTime);
+    accumulate(moments, oldest, weight, -1);
+    movements.popFront();
+}
+
+void LeastSquaresVelocityTrackerStrategy::rebuildMoments(
+        Moments& moments, const RingBuffer<Movement>& movements) const {
+    moments = {.anchorTime = movements[0].eventTime};
+    for (size_t i = 0; i + 1 < movements.size(); i++) {
         const Movement& movement = movements[i];
-        nsecs_t age = newestMovement.eventTime - movement.eventTime;
-        float xi = -age * SECONDS_PER_NANO;
-        float yi = movement.position;
-
-        float xi2 = xi*xi;
-        float xi3 = xi2*xi;
-        float xi4 = xi3*xi;
-        float xiyi = xi*yi;
-        float xi2yi = xi2*yi;
-
-        sxi += xi;
-        sxi2 += xi2;
-        sxiyi += xiyi;
-        sxi2yi += xi2yi;
-        syi += yi;
-        sxi3 += xi3;
-        sxi4 += xi4;
+        const float weight =
+                chooseIncrementalWeight(movement.eventTime, movements[i + 1].eventTime);
+        accumulate(moments, movement, weight, 1);
     }
+}
 
-    float Sxx = sxi2 - sxi*sxi / count;
-    float Sxy = sxiyi - sxi*syi / count;
-    float Sxx2 = sxi3 - sxi*sxi2 / count;
-    float Sx2y = sxi2yi - sxi2*syi / count;
-    float Sx2x2 = sxi4 - sxi2*sxi2 / count;
+/*
+ * Solves the same least-squares fit as solveLeastSquares, from the weighted sums of the powers of
+ * the movement times. An unweighted quadratic fit only gives up when the system is singular, while
+ * the other fits give up when solveLeastSquares would.
+ */
+std::optional<float> LeastSquaresVelocityTrackerStrategy::solveIncrementalLeastSquares(
+        const Moments& moments, const Movement& newestMovement, uint32_t degree) const {
+    Moments total = moments;
+    accumulate(total, newestMovement, /*weight=*/1.0f, 1);
+    const std::array<double, 2 * MAX_INCREMENTAL_DEGREE + 1>& sx = total.sumX;
+    const std::array<double, MAX_INCREMENTAL_DEGREE + 1>& sxy = total.sumXY;
+
+    // Center the sums on the weighted mean of the times and of the positions.
+    const double Sxx = sx[2] - sx[1] * sx[1] / sx[0];
+    const double Sxy = sxy[1] - sx[1] * sxy[0] / sx[0];
+    const bool checkLinearDependence = degree != 2 || mWeighting != Weighting::NONE;
+    // Same threshold as the Gram-Schmidt process of solveLeastSquares, which stops when the norm
+    // of a column of the weighted matrix is this small once the previous columns are taken out.
+    constexpr double MIN_NORM = 0.000001;
+    if (checkLinearDependence && Sxx < MIN_NORM * MIN_NORM) {
+        ALOGD_IF(DEBUG_STRATEGY, "  - no solution, Sxx=%f", Sxx);
+        return std::nullopt;
+    }
+    if (degree == 1) {
+        return Sxy / Sxx;
+    }
 
-    float denominator = Sxx*Sx2x2 - Sxx2*Sxx2;
+    const double Sxx2 = sx[3] - sx[1] * sx[2] / sx[0];
+    const double Sx2y = sxy[2] - sx[2] * sxy[0] / sx[0];
+    const double Sx2x2 = sx[4] - sx[2] * sx[2] / sx[0];
+    const double denominator = Sxx * Sx2x2 - Sxx2 * Sxx2;
+    if (checkLinearDependence && denominator < MIN_NORM * MIN_NORM * Sxx) {
+        ALOGD_IF(DEBUG_STRATEGY, "  - no solution, denominator=%f", denominator);
+        return std::nullopt;
+    }
     if (denominator == 0) {
         ALOGW("division by 0 when computing velocity, Sxx=%f, Sx2x2=%f, Sxx2=%f", Sxx, Sx2x2, Sxx2);
         return std::nullopt;
     }
 
-    return (Sxy * Sx2x2 - Sx2y * Sxx2) / denominator;
+    // y = b0 + b1 * x + b2 * x^2, so the velocity of the newest movement is b1 + 2 * b2 * x.
+    const double b1 = (Sxy * Sx2x2 - Sx2y * Sxx2) / denominator;
+    const double b2 = (Sx2y * Sxx - Sxy * Sxx2) / denominator;
+    const double newestX = (newestMovement.eventTime - moments.anchorTime) * 1E-9;
+    return b1 + 2 * b2 * newestX;
 }
 
 std::optional<float> LeastSquaresVelocityTrackerStrategy::getVelocity(int32_t pointerId) const {
@@ -666,9 +748,8 @@ std::optional<float> LeastSquaresVelocityTrackerStrategy::getVelocity(int32_t po
         return std::nullopt;
     }
 
-    if (degree == 2 && mWeighting == Weighting::NONE) {
-        // Optimize unweighted, quadratic polynomial fit
-        return solveUnweightedLeastSquaresDeg2(movements);
+    if (mIncremental && degree <= MAX_INCREMENTAL_DEGREE) {
+        return solveIncrementalLeastSquares(mMoments[pointerId], movements[size - 1], degree);
     }
 
     // Iterate over movement samples in reverse time order and collect samples.
@@ -694,22 +775,11 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint3
     const size_t size = movements.size();
     switch (mWeighting) {
         case Weighting::DELTA: {
-            // Weight points based on how much time elapsed between them and the next
-            // point so that points that "cover" a shorter time span are weighed less.
-            //   delta  0ms: 0.5
-            //   delta 10ms: 1.0
             if (index == size - 1) {
                 return 1.0f;
             }
-            float deltaMillis =
-                    (movements[index + 1].eventTime - movements[index].eventTime) * 0.000001f;
-            if (deltaMillis < 0) {
-                return 0.5f;
-            }
-            if (deltaMillis < 10) {
-                return 0.5f + deltaMillis * 0.05;
-            }
-            return 1.0f;
+            return chooseIncrementalWeight(movements[index].eventTime,
+                                           movements[index + 1].eventTime);
         }
 
         case Weighting::CENTRAL: {
@@ -756,6 +826,26 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint3
     }
 }
 
+float LeastSquaresVelocityTrackerStrategy::chooseIncrementalWeight(nsecs_t eventTime,
+                                                                   nsecs_t nextEventTime) const {
+    if (mWeighting != Weighting::DELTA) {
+        // Only used for the weightings that do not depend on the age of the movements.
+        return 1.0f;
+    }
+    // Weight points based on how much time elapsed between them and the next
+    // point so that points that "cover" a shorter time span are weighed less.
+    //   delta  0ms: 0.5
+    //   delta 10ms: 1.0
+    float deltaMillis = (nextEventTime - eventTime) * 0.000001f;
+    if (deltaMillis < 0) {
+        return 0.5f;
+    }
+    if (deltaMillis < 10) {
+        return 0.5f + deltaMillis * 0.05;
+    }
+    return 1.0f;
+}
+
 // --- IntegratingVelocityTrackerStrategy ---
 
 IntegratingVelocityTrackerStrategy::IntegratingVelocityTrackerStrategy(uint32_t degree) :
@@ -240,4 +240,89 @@ TEST_F(InputChannelTest, DuplicateChannelAndAssertEqual) {
     EXPECT_EQ(*serverChannel == *dupChan, true) << "inputchannel should be equal after duplication";
 }
 
+TEST_F(InputChannelTest, SharedMemoryRings_SendAndReceiveInBothDirections) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", /*ringCapacity=*/4, serverChannel,
+                                                 clientChannel));
+    ASSERT_TRUE(serverChannel->hasSharedMemoryRings());
+    ASSERT_TRUE(clientChannel->hasSharedMemoryRings());
+
+    InputMessage serverMsg = {};
+    serverMsg.header.type = InputMessage::Type::KEY;
+    for (uint32_t seq = 1; seq <= 4; seq++) {
+        serverMsg.header.seq = seq;
+        ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+    }
+    serverMsg.header.seq = 5;
+    EXPECT_EQ(WOULD_BLOCK, serverChannel->sendMessage(&serverMsg))
+            << "the channel should be full when its ring is";
+
+    ASSERT_TRUE(clientChannel->probablyHasInput());
+    for (uint32_t seq = 1; seq <= 4; seq++) {
+        android::base::Result<InputMessage> clientMsg = clientChannel->receiveMessage();
+        ASSERT_TRUE(clientMsg.ok());
+        EXPECT_EQ(InputMessage::Type::KEY, clientMsg->header.type);
+        EXPECT_EQ(seq, clientMsg->header.seq);
+    }
+    android::base::Result<InputMessage> noMsg = clientChannel->receiveMessage();
+    ASSERT_FALSE(noMsg.ok());
+    EXPECT_EQ(WOULD_BLOCK, noMsg.error().code());
+    EXPECT_FALSE(clientChannel->probablyHasInput())
+            << "the doorbells should have been read along with the messages";
+
+    InputMessage clientReply = {};
+    clientReply.header.type = InputMessage::Type::FINISHED;
+    clientReply.header.seq = 1;
+    clientReply.body.finished.handled = true;
+    ASSERT_EQ(OK, clientChannel->sendMessage(&clientReply));
+
+    android::base::Result<InputMessage> serverReply = serverChannel->receiveMessage();
+    ASSERT_TRUE(serverReply.ok());
+    EXPECT_EQ(InputMessage::Type::FINISHED, serverReply->header.type);
+    EXPECT_TRUE(serverReply->body.finished.handled);
+}
+
+TEST_F(InputChannelTest, SharedMemoryRings_SurviveParceling) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", /*ringCapacity=*/8, serverChannel,
+                                                 clientChannel));
+
+    android::os::InputChannelCore parceledChannel;
+    InputChannel::moveChannel(std::move(clientChannel), parceledChannel);
+    std::unique_ptr<InputChannel> receivedChannel =
+            InputChannel::create(std::move(parceledChannel));
+    ASSERT_NE(nullptr, receivedChannel);
+    ASSERT_TRUE(receivedChannel->hasSharedMemoryRings());
+
+    InputMessage serverMsg = {};
+    serverMsg.header.type = InputMessage::Type::KEY;
+    serverMsg.header.seq = 1;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+
+    android::base::Result<InputMessage> clientMsg = receivedChannel->receiveMessage();
+    ASSERT_TRUE(clientMsg.ok());
+    EXPECT_EQ(1u, clientMsg->header.seq);
+}
+
+TEST_F(InputChannelTest, SharedMemoryRings_ReceiveWhenPeerClosed_ReturnsAnError) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    ASSERT_EQ(OK,
+              InputChannel::openInputChannelPair("channel name", /*ringCapacity=*/4, serverChannel,
+                                                 clientChannel));
+
+    InputMessage serverMsg = {};
+    serverMsg.header.type = InputMessage::Type::KEY;
+    serverMsg.header.seq = 1;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+    serverChannel.reset(); // close server channel
+
+    // What was sent before the peer closed is still received.
+    ASSERT_TRUE(clientChannel->receiveMessage().ok());
+    android::base::Result<InputMessage> msg = clientChannel->receiveMessage();
+    ASSERT_FALSE(msg.ok());
+    EXPECT_EQ(DEAD_OBJECT, msg.error().code());
+}
+
 } // namespace android
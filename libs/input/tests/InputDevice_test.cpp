@@ -167,6 +167,30 @@ TEST_F(InputDeviceKeyMapTest, keyCharacterMapBadLedLabel) {
     ASSERT_FALSE(ret.ok()) << "Should not be able to load KeyLayout at " << klPath;
 }
 
+TEST(InputDeviceKeyLayoutTest, LoadingTheSameFileAgainSharesTheMap) {
+    std::string klPath = base::GetExecutableDirectory() + "/data/hid_fallback_mapping.kl";
+    base::Result<std::shared_ptr<KeyLayoutMap>> first = KeyLayoutMap::load(klPath);
+    ASSERT_TRUE(first.ok()) << "Unable to load KeyLayout at " << klPath;
+    base::Result<std::shared_ptr<KeyLayoutMap>> second = KeyLayoutMap::load(klPath);
+    ASSERT_TRUE(second.ok()) << "Unable to load KeyLayout at " << klPath;
+
+    EXPECT_EQ(first->get(), second->get());
+}
+
+TEST(InputDeviceKeyCharacterMapTest, LoadingTheSameFileAgainReturnsAnEqualCopy) {
+    std::string kcmPath = base::GetExecutableDirectory() + "/data/french.kcm";
+    base::Result<std::shared_ptr<KeyCharacterMap>> first =
+            KeyCharacterMap::load(kcmPath, KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(first.ok()) << "Cannot load KeyCharacterMap at " << kcmPath;
+    base::Result<std::shared_ptr<KeyCharacterMap>> second =
+            KeyCharacterMap::load(kcmPath, KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(second.ok()) << "Cannot load KeyCharacterMap at " << kcmPath;
+
+    // The maps can be combined with overlays, so they must not be shared.
+    EXPECT_NE(first->get(), second->get());
+    EXPECT_EQ(**first, **second);
+}
+
 TEST(InputDeviceKeyLayoutTest, HidUsageCodesFallbackMapping) {
     std::string klPath = base::GetExecutableDirectory() + "/data/hid_fallback_mapping.kl";
     base::Result<std::shared_ptr<KeyLayoutMap>> ret = KeyLayoutMap::load(klPath);
@@ -698,4 +698,31 @@ TEST_F(InputPublisherAndConsumerTest, PublishMultipleEvents_EndToEnd) {
     ASSERT_NO_FATAL_FAILURE(publishAndConsumeTouchModeEvent());
 }
 
+TEST_F(InputPublisherAndConsumerTest, PublishBatch_SendsEventsInOrderWhenTheBatchIsSent) {
+    constexpr size_t eventCount = 10;
+    mPublisher->beginBatch();
+    for (uint32_t seq = 1; seq <= eventCount; seq++) {
+        ASSERT_EQ(OK, mPublisher->publishFocusEvent(seq, InputEvent::nextId(), seq % 2 == 0));
+    }
+    ASSERT_FALSE(mConsumer->probablyHasInput()) << "nothing should be sent before sendBatch";
+
+    size_t sentCount = 0;
+    ASSERT_EQ(OK, mPublisher->sendBatch(sentCount));
+    ASSERT_EQ(eventCount, sentCount);
+
+    for (uint32_t seq = 1; seq <= eventCount; seq++) {
+        uint32_t consumeSeq;
+        InputEvent* event;
+        ASSERT_EQ(OK,
+                  mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq,
+                                     &event));
+        ASSERT_EQ(InputEventType::FOCUS, event->getType());
+        EXPECT_EQ(seq, consumeSeq);
+        EXPECT_EQ(seq % 2 == 0, static_cast<FocusEvent*>(event)->getHasFocus());
+    }
+
+    // Publishing goes back to sending each event once the batch is sent.
+    ASSERT_NO_FATAL_FAILURE(publishAndConsumeFocusEvent());
+}
+
 } // namespace android
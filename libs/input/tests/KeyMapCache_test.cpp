@@ -0,0 +1,63 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <input/KeyMapCache.h>
+
+namespace android {
+namespace {
+
+TEST(KeyMapCacheTest, FindsMapsParsedFromTheSameContents) {
+    KeyMapCache<const int> cache(/*maxSize=*/2);
+    std::shared_ptr<const int> map = std::make_shared<const int>(1);
+    cache.insert("a.kl", "key 1 A", map);
+
+    EXPECT_EQ(map, cache.find("a.kl", "key 1 A"));
+    // The file has changed since it was parsed.
+    EXPECT_EQ(nullptr, cache.find("a.kl", "key 1 B"));
+    EXPECT_EQ(nullptr, cache.find("b.kl", "key 1 A"));
+}
+
+TEST(KeyMapCacheTest, ReplacesTheEntryOfTheSameKey) {
+    KeyMapCache<const int> cache(/*maxSize=*/2);
+    cache.insert("a.kl", "key 1 A", std::make_shared<const int>(1));
+    cache.insert("a.kl", "key 1 B", std::make_shared<const int>(2));
+
+    EXPECT_EQ(1u, cache.size());
+    EXPECT_EQ(nullptr, cache.find("a.kl", "key 1 A"));
+    ASSERT_NE(nullptr, cache.find("a.kl", "key 1 B"));
+    EXPECT_EQ(2, *cache.find("a.kl", "key 1 B"));
+}
+
+TEST(KeyMapCacheTest, EvictsTheLeastRecentlyUsedEntry) {
+    KeyMapCache<const int> cache(/*maxSize=*/2);
+    cache.insert("a.kl", "key 1 A", std::make_shared<const int>(1));
+    cache.insert("b.kl", "key 1 B", std::make_shared<const int>(2));
+    ASSERT_NE(nullptr, cache.find("a.kl", "key 1 A"));
+
+    cache.insert("c.kl", "key 1 C", std::make_shared<const int>(3));
+
+    EXPECT_EQ(2u, cache.size());
+    EXPECT_NE(nullptr, cache.find("a.kl", "key 1 A"));
+    EXPECT_EQ(nullptr, cache.find("b.kl", "key 1 B"));
+    EXPECT_NE(nullptr, cache.find("c.kl", "key 1 C"));
+}
+
+} // namespace
+} // namespace android
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <input/MapNodePool.h>
+
+namespace android {
+namespace {
+
+TEST(MapNodePoolTest, ReusesTheNodesOfErasedEntries) {
+    std::map<int, std::vector<int>> map;
+    MapNodePool<std::map<int, std::vector<int>>> pool(/*maxSize=*/1);
+
+    auto [it, inserted] = pool.tryEmplace(map, 1);
+    ASSERT_TRUE(inserted);
+    it->second.assign({1, 2, 3});
+    const std::vector<int>::size_type capacity = it->second.capacity();
+    pool.erase(map, it);
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(1u, pool.size());
+
+    // The mapped value of the reused node keeps its capacity, for the caller to reset.
+    std::tie(it, inserted) = pool.tryEmplace(map, 2);
+    ASSERT_TRUE(inserted);
+    ASSERT_EQ(0u, pool.size());
+    EXPECT_EQ(2, it->first);
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), it->second);
+    it->second.clear();
+    EXPECT_EQ(capacity, it->second.capacity());
+}
+
+TEST(MapNodePoolTest, DoesNotReplaceExistingEntries) {
+    std::unordered_map<int, int> map;
+    MapNodePool<std::unordered_map<int, int>> pool(/*maxSize=*/2);
+
+    pool.tryEmplace(map, 1).first->second = 10;
+    pool.erase(map, pool.tryEmplace(map, 2).first);
+
+    auto [it, inserted] = pool.tryEmplace(map, 1);
+    EXPECT_FALSE(inserted);
+    EXPECT_EQ(10, it->second);
+    EXPECT_EQ(1u, pool.size()) << "the spare node should not have been used";
+}
+
+TEST(MapNodePoolTest, KeepsAtMostMaxSizeNodes) {
+    std::unordered_map<int, int> map;
+    MapNodePool<std::unordered_map<int, int>> pool(/*maxSize=*/2);
+
+    for (int key = 0; key < 4; key++) {
+        pool.tryEmplace(map, key);
+    }
+    while (!map.empty()) {
+        pool.erase(map, map.begin());
+    }
+    EXPECT_EQ(2u, pool.size());
+}
+
+} // namespace
+} // namespace android
@@ -1005,5 +1005,37 @@ TEST(MotionPredictorMetricsManagerTest, MismatchedInputAndPredictionInterval) {
     runMetricsManager(groundTruthPoints, predictionPoints, reportedAtomFields);
 }
 
+// Inference latency test:
+//  • Input: a stroke with perfect predictions, and an inference latency reported for each of them.
+//  • Expectation: the mean and maximum latency are reported in the last time bucket only.
+TEST(MotionPredictorMetricsManagerTest, ReportsInferenceLatencyInLastBucket) {
+    std::vector<AtomFields> reportedAtomFields;
+    MotionPredictorMetricsManager metricsManager(TEST_PREDICTION_INTERVAL_NANOS,
+                                                 TEST_MAX_NUM_PREDICTIONS,
+                                                 createMockReportAtomFunction(reportedAtomFields));
+
+    const std::vector<GroundTruthPoint> groundTruthPoints =
+            generateConstantGroundTruthPoints(GroundTruthPoint{{.position = Eigen::Vector2f(0, 0),
+                                                                .pressure = 0.5f},
+                                                               .timestamp = TEST_INITIAL_TIMESTAMP},
+                                              /*numPoints=*/3);
+    metricsManager.onRecord(makeMotionEvent(groundTruthPoints[0]));
+    metricsManager.onInference(/*inferenceLatency=*/1'000'000);
+    metricsManager.onPredict(makeMotionEvent(generateConstantPredictions(groundTruthPoints[0])));
+    metricsManager.onRecord(makeMotionEvent(groundTruthPoints[1]));
+    metricsManager.onInference(/*inferenceLatency=*/3'000'000);
+    metricsManager.onPredict(makeMotionEvent(generateConstantPredictions(groundTruthPoints[1])));
+    metricsManager.onRecord(makeMotionEvent(groundTruthPoints[2]));
+    metricsManager.onRecord(makeLiftMotionEvent());
+
+    ASSERT_EQ(TEST_MAX_NUM_PREDICTIONS, reportedAtomFields.size());
+    for (size_t i = 0; i + 1 < reportedAtomFields.size(); ++i) {
+        EXPECT_EQ(NO_DATA_SENTINEL, reportedAtomFields[i].inferenceLatencyMeanMicros);
+        EXPECT_EQ(NO_DATA_SENTINEL, reportedAtomFields[i].inferenceLatencyMaxMicros);
+    }
+    EXPECT_EQ(2000, reportedAtomFields.back().inferenceLatencyMeanMicros);
+    EXPECT_EQ(3000, reportedAtomFields.back().inferenceLatencyMaxMicros);
+}
+
 } // namespace
 } // namespace android
@@ -17,6 +17,7 @@
 // TODO(b/331815574): Decouple this test from assumed config values.
 #include <chrono>
 #include <cmath>
+#include <thread>
 
 #include <com_android_input_flags.h>
 #include <flag_macros.h>
@@ -214,6 +215,30 @@ TEST(MotionPredictorTest, FollowsGesture) {
     EXPECT_EQ(nullptr, predictor.predict(100 * NSEC_PER_MSEC));
 }
 
+TEST(MotionPredictorTest, AsynchronousInferenceFollowsGesture) {
+    MotionPredictor predictor(/*predictionTimestampOffsetNanos=*/0,
+                              []() { return true /*enable prediction*/; },
+                              /*reportAtomFunction=*/{},
+                              MotionPredictor::InferenceMode::ASYNCHRONOUS);
+    predictor.record(getMotionEvent(DOWN, 3.75, 3, 20ms));
+    predictor.record(getMotionEvent(MOVE, 4.8, 3, 30ms));
+    predictor.record(getMotionEvent(MOVE, 6.2, 3, 40ms));
+    predictor.record(getMotionEvent(MOVE, 8, 3, 50ms));
+
+    // The prediction is available once the inference thread has run the model.
+    std::unique_ptr<MotionEvent> predicted;
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (!(predicted = predictor.predict(90 * NSEC_PER_MSEC)) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_NE(nullptr, predicted);
+
+    // The inferences of a gesture that has ended are not used.
+    predictor.record(getMotionEvent(UP, 10.25, 3, 60ms));
+    EXPECT_EQ(nullptr, predictor.predict(100 * NSEC_PER_MSEC));
+}
+
 TEST(MotionPredictorTest, MultipleDevicesNotSupported) {
     MotionPredictor predictor(/*predictionTimestampOffsetNanos=*/0,
                               []() { return true /*enable prediction*/; });
@@ -477,6 +477,27 @@ TEST_F(ResamplerTest, MultiplePointerSingleSampleInterpolation) {
                                                Pointer{.x = 3.2f, .y = 3.2f, .isResampled = true}});
 }
 
+TEST_F(ResamplerTest, MaxPointersSingleSampleInterpolation) {
+    std::vector<Pointer> pastPointers;
+    std::vector<Pointer> futurePointers;
+    std::vector<PointerCoords> expectedCoords;
+    for (int32_t id = 0; id < static_cast<int32_t>(MAX_POINTERS); ++id) {
+        pastPointers.push_back({.id = id, .x = 1.0f * id, .y = -2.0f * id});
+        futurePointers.push_back({.id = id, .x = 1.0f * id + 5.0f, .y = -2.0f * id - 10.0f});
+        expectedCoords.push_back(
+                Pointer{.x = 1.0f * id + 3.0f, .y = -2.0f * id - 6.0f, .isResampled = true});
+    }
+    MotionEvent motionEvent =
+            InputStream{{InputSample{5ms, pastPointers}}, AMOTION_EVENT_ACTION_MOVE};
+    const InputMessage futureSample = InputSample{15ms, futurePointers};
+
+    const MotionEvent originalMotionEvent = motionEvent;
+
+    mResampler->resampleMotionEvent(16ms, motionEvent, &futureSample);
+
+    assertMotionEventIsResampledAndCoordsNear(originalMotionEvent, motionEvent, expectedCoords);
+}
+
 TEST_F(ResamplerTest, MultiplePointerSingleSampleExtrapolation) {
     MotionEvent firstMotionEvent =
             InputStream{{InputSample{5ms,
@@ -68,6 +68,17 @@ TEST(TouchVideoFrame, Equality) {
     ASSERT_FALSE(frame == changedTimestampFrame);
 }
 
+TEST(TouchVideoFrame, CopiesShareData) {
+    TouchVideoFrame frame(3, 2, {1, 2, 3, 4, 5, 6}, TIMESTAMP);
+    TouchVideoFrame copy = frame;
+    ASSERT_EQ(frame.getData().data(), copy.getData().data());
+
+    // Rotating a copy leaves the other copies as they were.
+    copy.rotate(ui::ROTATION_180);
+    ASSERT_EQ(TouchVideoFrame(3, 2, {1, 2, 3, 4, 5, 6}, TIMESTAMP), frame);
+    ASSERT_EQ(TouchVideoFrame(3, 2, {6, 5, 4, 3, 2, 1}, TIMESTAMP), copy);
+}
+
 // --- Rotate 90 degrees ---
 
 TEST(TouchVideoFrame, Rotate90_0x0) {
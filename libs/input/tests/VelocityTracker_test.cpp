@@ -492,6 +492,26 @@ TEST_F(VelocityTrackerTest, ThreePointsLinearVelocityTest) {
     computeAndCheckVelocity(VelocityTracker::Strategy::LSQ2, motions, AMOTION_EVENT_AXIS_X, 500);
 }
 
+/**
+ * The least squares strategies keep running sums of the movements, which must stay accurate over
+ * a long gesture, and across a pause that empties the horizon.
+ */
+TEST_F(VelocityTrackerTest, LongLinearMotionTest) {
+    // Fixed velocity at 5 points per 10 milliseconds, far away from the origin.
+    std::vector<PlanarMotionEventEntry> motions;
+    for (std::chrono::nanoseconds t = 0ms; t <= 1s; t += 8ms) {
+        motions.push_back({t, {{10000 + t.count() * 0.0000005f, 0}}});
+    }
+    for (std::chrono::nanoseconds t = 1300ms; t <= 2s; t += 8ms) {
+        motions.push_back({t, {{10000 + t.count() * 0.0000005f, 0}}});
+    }
+    motions.push_back(motions.back()); // ACTION_UP
+    computeAndCheckVelocity(VelocityTracker::Strategy::LSQ1, motions, AMOTION_EVENT_AXIS_X, 500);
+    computeAndCheckVelocity(VelocityTracker::Strategy::LSQ2, motions, AMOTION_EVENT_AXIS_X, 500);
+    computeAndCheckVelocity(VelocityTracker::Strategy::WLSQ2_DELTA, motions, AMOTION_EVENT_AXIS_X,
+                            500);
+}
+
 /**
  * When the stream is terminated with ACTION_CANCEL, the resulting velocity should be 0.
  */
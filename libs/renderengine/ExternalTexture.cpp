@@ -22,25 +22,64 @@
 
 namespace android::renderengine::impl {
 
+namespace {
+thread_local ExternalTexture::Batch* tCurrentBatch = nullptr;
+} // namespace
+
+ExternalTexture::Batch::Batch(renderengine::RenderEngine& renderEngine)
+      : mRenderEngine(renderEngine), mPrevious(tCurrentBatch) {
+    tCurrentBatch = this;
+}
+
+ExternalTexture::Batch::~Batch() {
+    tCurrentBatch = mPrevious;
+    SFTRACE_CALL();
+    // The buffers are mapped before any is unmapped. RenderEngine counts the mappings of each
+    // buffer, so a buffer that was unmapped and mapped again in the batch stays mapped.
+    if (!mMapped.empty()) {
+        mRenderEngine.mapExternalTextureBuffers(mMapped, false);
+    }
+    if (!mMappedRenderable.empty()) {
+        mRenderEngine.mapExternalTextureBuffers(mMappedRenderable, true);
+    }
+    if (!mUnmapped.empty()) {
+        mRenderEngine.unmapExternalTextureBuffers(std::move(mUnmapped));
+    }
+}
+
 ExternalTexture::ExternalTexture(const sp<GraphicBuffer>& buffer,
                                  renderengine::RenderEngine& renderEngine, uint32_t usage)
       : mBuffer(buffer), mRenderEngine(renderEngine), mWritable(usage & WRITEABLE) {
     LOG_ALWAYS_FATAL_IF(buffer == nullptr,
                         "Attempted to bind a null buffer to an external texture!");
-    mRenderEngine.mapExternalTextureBuffer(mBuffer, mWritable);
+    map();
 }
 
 ExternalTexture::~ExternalTexture() {
-    mRenderEngine.unmapExternalTextureBuffer(std::move(mBuffer));
+    unmap(std::move(mBuffer));
 }
 
 void ExternalTexture::remapBuffer() {
     SFTRACE_CALL();
-    {
-        auto buf = mBuffer;
-        mRenderEngine.unmapExternalTextureBuffer(std::move(buf));
+    unmap(sp<GraphicBuffer>(mBuffer));
+    map();
+}
+
+void ExternalTexture::map() {
+    if (tCurrentBatch && &tCurrentBatch->mRenderEngine == &mRenderEngine) {
+        (mWritable ? tCurrentBatch->mMappedRenderable : tCurrentBatch->mMapped)
+                .push_back(mBuffer);
+        return;
     }
     mRenderEngine.mapExternalTextureBuffer(mBuffer, mWritable);
 }
 
+void ExternalTexture::unmap(sp<GraphicBuffer>&& buffer) {
+    if (tCurrentBatch && &tCurrentBatch->mRenderEngine == &mRenderEngine) {
+        tCurrentBatch->mUnmapped.push_back(std::move(buffer));
+        return;
+    }
+    mRenderEngine.unmapExternalTextureBuffer(std::move(buffer));
+}
+
 } // namespace android::renderengine::impl
@@ -0,0 +1,439 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <renderengine/RecordedScene.h>
+
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdlib>
+#include <initializer_list>
+
+namespace android {
+namespace renderengine {
+
+// Each line of a recording is a key followed by its values, separated by spaces. A scene starts
+// with a "scene" line followed by the display settings, and each of its layers starts with a
+// "layer" line followed by its settings. Settings that have their default value are omitted.
+//
+//   scene
+//   output 1080 2400 1 2816
+//   physicalDisplay 0 0 1080 2400
+//   ...
+//   layer com.android.launcher#42
+//   boundaries 0 0 1080 2400
+//   ...
+
+namespace {
+
+using base::StringAppendF;
+
+void appendFloats(std::string& result, const char* key, std::initializer_list<float> values) {
+    result.append(key);
+    for (float value : values) {
+        // 9 significant digits are enough to read back the same float.
+        StringAppendF(&result, " %.9g", value);
+    }
+    result.append("\n");
+}
+
+void appendInts(std::string& result, const char* key, std::initializer_list<int64_t> values) {
+    result.append(key);
+    for (int64_t value : values) {
+        StringAppendF(&result, " %" PRId64, value);
+    }
+    result.append("\n");
+}
+
+void appendMatrix(std::string& result, const char* key, const mat4& matrix) {
+    result.append(key);
+    for (size_t i = 0; i < 16; i++) {
+        StringAppendF(&result, " %.9g", matrix.asArray()[i]);
+    }
+    result.append("\n");
+}
+
+void appendRect(std::string& result, const char* key, const Rect& rect) {
+    appendInts(result, key, {rect.left, rect.top, rect.right, rect.bottom});
+}
+
+void appendRect(std::string& result, const char* key, const FloatRect& rect) {
+    appendFloats(result, key, {rect.left, rect.top, rect.right, rect.bottom});
+}
+
+void appendBufferInfo(std::string& result, const char* key, const ExternalTexture& texture) {
+    StringAppendF(&result, "%s %" PRIu32 " %" PRIu32 " %" PRId32 " %" PRIu64 "\n", key,
+                  texture.getWidth(), texture.getHeight(),
+                  static_cast<int32_t>(texture.getPixelFormat()), texture.getUsage());
+}
+
+void appendDisplay(std::string& result, const DisplaySettings& display) {
+    const DisplaySettings defaults;
+    appendRect(result, "physicalDisplay", display.physicalDisplay);
+    appendRect(result, "clip", display.clip);
+    if (display.damage != defaults.damage) {
+        appendRect(result, "damage", display.damage);
+    }
+    appendFloats(result, "maxLuminance", {display.maxLuminance});
+    appendFloats(result, "currentLuminanceNits", {display.currentLuminanceNits});
+    appendInts(result, "outputDataspace", {static_cast<int32_t>(display.outputDataspace)});
+    if (display.colorTransform != defaults.colorTransform) {
+        appendMatrix(result, "colorTransform", display.colorTransform);
+    }
+    appendInts(result, "deviceHandlesColorTransform", {display.deviceHandlesColorTransform});
+    appendInts(result, "orientation", {display.orientation});
+    appendFloats(result, "targetLuminanceNits", {display.targetLuminanceNits});
+    appendInts(result, "dimmingStage", {static_cast<int32_t>(display.dimmingStage)});
+    appendInts(result, "renderIntent", {static_cast<int32_t>(display.renderIntent)});
+    appendInts(result, "tonemapStrategy", {static_cast<int32_t>(display.tonemapStrategy)});
+    appendFloats(result, "targetHdrSdrRatio", {display.targetHdrSdrRatio});
+    appendInts(result, "priority", {static_cast<int32_t>(display.priority)});
+}
+
+void appendLayer(std::string& result, const LayerSettings& layer) {
+    const LayerSettings defaults;
+    // Layer names may contain spaces, so the name is the rest of the line.
+    StringAppendF(&result, "layer %s\n", layer.name.c_str());
+    appendRect(result, "boundaries", layer.geometry.boundaries);
+    if (layer.geometry.positionTransform != defaults.geometry.positionTransform) {
+        appendMatrix(result, "positionTransform", layer.geometry.positionTransform);
+    }
+    if (layer.geometry.roundedCornersRadius != defaults.geometry.roundedCornersRadius) {
+        appendFloats(result, "roundedCornersRadius",
+                     {layer.geometry.roundedCornersRadius.x,
+                      layer.geometry.roundedCornersRadius.y});
+        appendRect(result, "roundedCornersCrop", layer.geometry.roundedCornersCrop);
+    }
+
+    const Buffer& buffer = layer.source.buffer;
+    if (buffer.buffer) {
+        appendBufferInfo(result, "buffer", *buffer.buffer);
+        appendInts(result, "useTextureFiltering", {buffer.useTextureFiltering});
+        if (buffer.textureTransform != defaults.source.buffer.textureTransform) {
+            appendMatrix(result, "textureTransform", buffer.textureTransform);
+        }
+        appendInts(result, "usePremultipliedAlpha", {buffer.usePremultipliedAlpha});
+        appendInts(result, "isOpaque", {buffer.isOpaque});
+        appendFloats(result, "maxLuminanceNits", {buffer.maxLuminanceNits});
+    } else {
+        appendFloats(result, "solidColor",
+                     {layer.source.solidColor.r, layer.source.solidColor.g,
+                      layer.source.solidColor.b});
+    }
+
+    appendFloats(result, "alpha", {layer.alpha});
+    appendInts(result, "sourceDataspace", {static_cast<int32_t>(layer.sourceDataspace)});
+    if (layer.colorTransform != defaults.colorTransform) {
+        appendMatrix(result, "colorTransform", layer.colorTransform);
+    }
+    appendInts(result, "disableBlending", {layer.disableBlending});
+    appendInts(result, "skipContentDraw", {layer.skipContentDraw});
+
+    const ShadowSettings& shadow = layer.shadow;
+    if (shadow != defaults.shadow) {
+        appendFloats(result, "shadow",
+                     {shadow.boundaries.left, shadow.boundaries.top, shadow.boundaries.right,
+                      shadow.boundaries.bottom, shadow.ambientColor.r, shadow.ambientColor.g,
+                      shadow.ambientColor.b, shadow.ambientColor.a, shadow.spotColor.r,
+                      shadow.spotColor.g, shadow.spotColor.b, shadow.spotColor.a,
+                      shadow.lightPos.x, shadow.lightPos.y, shadow.lightPos.z, shadow.lightRadius,
+                      shadow.length, shadow.casterIsTranslucent ? 1.f : 0.f});
+    }
+
+    if (layer.backgroundBlurRadius > 0) {
+        appendInts(result, "backgroundBlurRadius", {layer.backgroundBlurRadius});
+    }
+    for (const BlurRegion& region : layer.blurRegions) {
+        appendFloats(result, "blurRegion",
+                     {static_cast<float>(region.blurRadius), region.cornerRadiusTL,
+                      region.cornerRadiusTR, region.cornerRadiusBL, region.cornerRadiusBR,
+                      region.alpha, static_cast<float>(region.left),
+                      static_cast<float>(region.top), static_cast<float>(region.right),
+                      static_cast<float>(region.bottom)});
+    }
+    if (layer.blurRegionTransform != defaults.blurRegionTransform) {
+        appendMatrix(result, "blurRegionTransform", layer.blurRegionTransform);
+    }
+    if (layer.blurBackdropId != 0) {
+        StringAppendF(&result, "blurBackdropId %" PRIu64 "\n", layer.blurBackdropId);
+    }
+
+    const StretchEffect& stretch = layer.stretchEffect;
+    if (stretch != defaults.stretchEffect) {
+        appendFloats(result, "stretchEffect",
+                     {stretch.width, stretch.height, stretch.vectorX, stretch.vectorY,
+                      stretch.maxAmountX, stretch.maxAmountY, stretch.mappedChildBounds.left,
+                      stretch.mappedChildBounds.top, stretch.mappedChildBounds.right,
+                      stretch.mappedChildBounds.bottom});
+    }
+
+    const EdgeExtensionEffect& edgeExtension = layer.edgeExtensionEffect;
+    if (edgeExtension.hasEffect()) {
+        appendInts(result, "edgeExtensionEffect",
+                   {edgeExtension.extendsEdge(LEFT), edgeExtension.extendsEdge(RIGHT),
+                    edgeExtension.extendsEdge(TOP), edgeExtension.extendsEdge(BOTTOM)});
+    }
+
+    appendFloats(result, "whitePointNits", {layer.whitePointNits});
+}
+
+// The values of one line of a recording.
+class Values {
+public:
+    explicit Values(std::vector<std::string> tokens) : mTokens(std::move(tokens)) {}
+
+    bool read(float& value) {
+        const char* token = next();
+        if (!token) return false;
+        char* end;
+        value = std::strtof(token, &end);
+        return *end == '\0';
+    }
+
+    bool read(int64_t& value) {
+        const char* token = next();
+        if (!token) return false;
+        char* end;
+        errno = 0;
+        value = std::strtoll(token, &end, 10);
+        return *end == '\0' && errno == 0;
+    }
+
+    bool read(uint64_t& value) {
+        const char* token = next();
+        if (!token || token[0] == '-') return false;
+        char* end;
+        errno = 0;
+        value = std::strtoull(token, &end, 10);
+        return *end == '\0' && errno == 0;
+    }
+
+    template <typename T>
+    bool readInt(T& value) {
+        int64_t result;
+        if (!read(result)) return false;
+        value = static_cast<T>(result);
+        return true;
+    }
+
+    bool read(bool& value) {
+        int64_t result;
+        if (!read(result) || (result != 0 && result != 1)) return false;
+        value = result == 1;
+        return true;
+    }
+
+    bool read(mat4& matrix) {
+        for (size_t i = 0; i < 16; i++) {
+            if (!read(matrix[i / 4][i % 4])) return false;
+        }
+        return true;
+    }
+
+    bool read(Rect& rect) {
+        return readInt(rect.left) && readInt(rect.top) && readInt(rect.right) &&
+                readInt(rect.bottom);
+    }
+
+    bool read(FloatRect& rect) {
+        return read(rect.left) && read(rect.top) && read(rect.right) && read(rect.bottom);
+    }
+
+    bool read(RecordedScene::BufferInfo& info) {
+        return readInt(info.width) && readInt(info.height) && readInt(info.format) &&
+                read(info.usage);
+    }
+
+    // Skips the values of a setting that is not understood.
+    void skip() { mNext = mTokens.size(); }
+
+    // Whether every value on the line was read.
+    bool done() const { return mNext == mTokens.size(); }
+
+private:
+    const char* next() { return mNext < mTokens.size() ? mTokens[mNext++].c_str() : nullptr; }
+
+    std::vector<std::string> mTokens;
+    size_t mNext = 0;
+};
+
+bool parseDisplay(const std::string& key, Values& values, RecordedScene& scene) {
+    DisplaySettings& display = scene.display;
+    if (key == "output") return values.read(scene.output);
+    if (key == "physicalDisplay") return values.read(display.physicalDisplay);
+    if (key == "clip") return values.read(display.clip);
+    if (key == "damage") return values.read(display.damage);
+    if (key == "maxLuminance") return values.read(display.maxLuminance);
+    if (key == "currentLuminanceNits") return values.read(display.currentLuminanceNits);
+    if (key == "outputDataspace") return values.readInt(display.outputDataspace);
+    if (key == "colorTransform") return values.read(display.colorTransform);
+    if (key == "deviceHandlesColorTransform") {
+        return values.read(display.deviceHandlesColorTransform);
+    }
+    if (key == "orientation") return values.readInt(display.orientation);
+    if (key == "targetLuminanceNits") return values.read(display.targetLuminanceNits);
+    if (key == "dimmingStage") return values.readInt(display.dimmingStage);
+    if (key == "renderIntent") return values.readInt(display.renderIntent);
+    if (key == "tonemapStrategy") return values.readInt(display.tonemapStrategy);
+    if (key == "targetHdrSdrRatio") return values.read(display.targetHdrSdrRatio);
+    if (key == "priority") return values.readInt(display.priority);
+    values.skip();
+    return true;
+}
+
+bool parseLayer(const std::string& key, Values& values, LayerSettings& layer,
+                std::optional<RecordedScene::BufferInfo>& bufferInfo) {
+    Buffer& buffer = layer.source.buffer;
+    if (key == "boundaries") return values.read(layer.geometry.boundaries);
+    if (key == "positionTransform") return values.read(layer.geometry.positionTransform);
+    if (key == "roundedCornersRadius") {
+        return values.read(layer.geometry.roundedCornersRadius.x) &&
+                values.read(layer.geometry.roundedCornersRadius.y);
+    }
+    if (key == "roundedCornersCrop") return values.read(layer.geometry.roundedCornersCrop);
+    if (key == "buffer") return values.read(bufferInfo.emplace());
+    if (key == "useTextureFiltering") return values.read(buffer.useTextureFiltering);
+    if (key == "textureTransform") return values.read(buffer.textureTransform);
+    if (key == "usePremultipliedAlpha") return values.read(buffer.usePremultipliedAlpha);
+    if (key == "isOpaque") return values.read(buffer.isOpaque);
+    if (key == "maxLuminanceNits") return values.read(buffer.maxLuminanceNits);
+    if (key == "solidColor") {
+        float r, g, b;
+        if (!values.read(r) || !values.read(g) || !values.read(b)) return false;
+        layer.source.solidColor = half3(r, g, b);
+        return true;
+    }
+    if (key == "alpha") {
+        float alpha;
+        if (!values.read(alpha)) return false;
+        layer.alpha = half(alpha);
+        return true;
+    }
+    if (key == "sourceDataspace") return values.readInt(layer.sourceDataspace);
+    if (key == "colorTransform") return values.read(layer.colorTransform);
+    if (key == "disableBlending") return values.read(layer.disableBlending);
+    if (key == "skipContentDraw") return values.read(layer.skipContentDraw);
+    if (key == "shadow") {
+        ShadowSettings& shadow = layer.shadow;
+        float casterIsTranslucent;
+        if (!values.read(shadow.boundaries) || !values.read(shadow.ambientColor.r) ||
+            !values.read(shadow.ambientColor.g) || !values.read(shadow.ambientColor.b) ||
+            !values.read(shadow.ambientColor.a) || !values.read(shadow.spotColor.r) ||
+            !values.read(shadow.spotColor.g) || !values.read(shadow.spotColor.b) ||
+            !values.read(shadow.spotColor.a) || !values.read(shadow.lightPos.x) ||
+            !values.read(shadow.lightPos.y) || !values.read(shadow.lightPos.z) ||
+            !values.read(shadow.lightRadius) || !values.read(shadow.length) ||
+            !values.read(casterIsTranslucent)) {
+            return false;
+        }
+        shadow.casterIsTranslucent = casterIsTranslucent != 0.f;
+        return true;
+    }
+    if (key == "backgroundBlurRadius") return values.readInt(layer.backgroundBlurRadius);
+    if (key == "blurRegion") {
+        BlurRegion region;
+        float blurRadius, left, top, right, bottom;
+        if (!values.read(blurRadius) || !values.read(region.cornerRadiusTL) ||
+            !values.read(region.cornerRadiusTR) || !values.read(region.cornerRadiusBL) ||
+            !values.read(region.cornerRadiusBR) || !values.read(region.alpha) ||
+            !values.read(left) || !values.read(top) || !values.read(right) ||
+            !values.read(bottom)) {
+            return false;
+        }
+        region.blurRadius = static_cast<uint32_t>(blurRadius);
+        region.left = static_cast<int>(left);
+        region.top = static_cast<int>(top);
+        region.right = static_cast<int>(right);
+        region.bottom = static_cast<int>(bottom);
+        layer.blurRegions.push_back(region);
+        return true;
+    }
+    if (key == "blurRegionTransform") return values.read(layer.blurRegionTransform);
+    if (key == "blurBackdropId") return values.read(layer.blurBackdropId);
+    if (key == "stretchEffect") {
+        StretchEffect& stretch = layer.stretchEffect;
+        return values.read(stretch.width) && values.read(stretch.height) &&
+                values.read(stretch.vectorX) && values.read(stretch.vectorY) &&
+                values.read(stretch.maxAmountX) && values.read(stretch.maxAmountY) &&
+                values.read(stretch.mappedChildBounds);
+    }
+    if (key == "edgeExtensionEffect") {
+        bool left, right, top, bottom;
+        if (!values.read(left) || !values.read(right) || !values.read(top) ||
+            !values.read(bottom)) {
+            return false;
+        }
+        layer.edgeExtensionEffect = EdgeExtensionEffect(left, right, top, bottom);
+        return true;
+    }
+    if (key == "whitePointNits") return values.read(layer.whitePointNits);
+    values.skip();
+    return true;
+}
+
+} // namespace
+
+void appendRecordedScene(std::string& result, const DisplaySettings& display,
+                         const std::vector<LayerSettings>& layers,
+                         const ExternalTexture& output) {
+    result.append("scene\n");
+    appendBufferInfo(result, "output", output);
+    appendDisplay(result, display);
+    for (const LayerSettings& layer : layers) {
+        appendLayer(result, layer);
+    }
+}
+
+std::optional<std::vector<RecordedScene>> parseRecordedScenes(const std::string& contents) {
+    std::vector<RecordedScene> scenes;
+    for (const std::string& line : base::Split(contents, "\n")) {
+        std::vector<std::string> tokens = base::Tokenize(line, " ");
+        if (tokens.empty() || tokens.front().front() == '#') {
+            continue;
+        }
+
+        const std::string key = std::move(tokens.front());
+        tokens.erase(tokens.begin());
+        if (key == "scene") {
+            scenes.emplace_back();
+            continue;
+        }
+        if (scenes.empty()) {
+            return std::nullopt;
+        }
+
+        RecordedScene& scene = scenes.back();
+        if (key == "layer") {
+            scene.layers.push_back({.name = line.size() > 6 ? line.substr(6) : ""});
+            scene.layerBuffers.emplace_back();
+            continue;
+        }
+
+        Values values(std::move(tokens));
+        const bool parsed = scene.layers.empty()
+                ? parseDisplay(key, values, scene)
+                : parseLayer(key, values, scene.layers.back(), scene.layerBuffers.back());
+        if (!parsed || !values.done()) {
+            return std::nullopt;
+        }
+    }
+    return scenes;
+}
+
+} // namespace renderengine
+} // namespace android
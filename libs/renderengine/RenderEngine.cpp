@@ -78,7 +78,11 @@ std::unique_ptr<RenderEngine> RenderEngine::create(const RenderEngineCreationArg
     }
 
     if (args.threaded == Threaded::YES) {
-        return renderengine::threaded::RenderEngineThreaded::create(createInstanceFactory);
+        const bool parallelCapture = args.parallelCapture && args.graphicsApi == GraphicsApi::GL;
+        ALOGW_IF(args.parallelCapture && !parallelCapture,
+                 "Parallel capture was requested, but is only supported with GL");
+        return renderengine::threaded::RenderEngineThreaded::create(createInstanceFactory,
+                                                                    parallelCapture);
     } else {
         return createInstanceFactory();
     }
@@ -116,7 +120,7 @@ ftl::Future<FenceResult> RenderEngine::drawGainmap(
     std::future<FenceResult> resultFuture = resultPromise->get_future();
     updateProtectedContext({}, {sdr.get(), hdr.get(), gainmap.get()});
     drawGainmapInternal(std::move(resultPromise), sdr, std::move(sdrFence), hdr,
-                        std::move(hdrFence), hdrSdrRatio, dataspace, gainmap);
+                        std::move(hdrFence), hdrSdrRatio, dataspace, gainmap, gainmap->getBounds());
     return resultFuture;
 }
 
@@ -135,5 +139,18 @@ void RenderEngine::updateProtectedContext(const std::vector<LayerSettings>& laye
     useProtectedContext(needsProtectedContext);
 }
 
+void RenderEngine::mapExternalTextureBuffers(const std::vector<sp<GraphicBuffer>>& buffers,
+                                             bool isRenderable) {
+    for (const sp<GraphicBuffer>& buffer : buffers) {
+        mapExternalTextureBuffer(buffer, isRenderable);
+    }
+}
+
+void RenderEngine::unmapExternalTextureBuffers(std::vector<sp<GraphicBuffer>>&& buffers) {
+    for (sp<GraphicBuffer>& buffer : buffers) {
+        unmapExternalTextureBuffer(std::move(buffer));
+    }
+}
+
 } // namespace renderengine
 } // namespace android
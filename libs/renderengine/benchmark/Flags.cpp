@@ -20,6 +20,8 @@
 
 namespace {
 bool gSave = false;
+const char* gScenesPath = nullptr;
+constexpr char kScenesFlag[] = "--scenes=";
 }
 
 namespace renderenginebench {
@@ -29,6 +31,8 @@ void parseFlagsForHelp(int argc, char** argv) {
         if (!strcmp(argv[i], "--help")) {
             printf("RenderEngineBench-specific flags:\n");
             printf("[--save]: Save the output to the device to confirm drawing result.\n");
+            printf("[--scenes=<path>]: Replay the scenes recorded with "
+                   "debug.renderengine.capture_scenes.\n");
             break;
         }
     }
@@ -38,6 +42,8 @@ void parseFlags(int argc, char** argv) {
     for (int i = 0; i < argc; i++) {
         if (!strcmp(argv[i], "--save")) {
             gSave = true;
+        } else if (!strncmp(argv[i], kScenesFlag, strlen(kScenesFlag))) {
+            gScenesPath = argv[i] + strlen(kScenesFlag);
         }
     }
 }
@@ -45,4 +51,8 @@ void parseFlags(int argc, char** argv) {
 bool save() {
     return gSave;
 }
+
+const char* scenesPath() {
+    return gScenesPath;
+}
 } // namespace renderenginebench
@@ -21,10 +21,14 @@
 #include <log/log.h>
 #include <renderengine/ExternalTexture.h>
 #include <renderengine/LayerSettings.h>
+#include <renderengine/RecordedScene.h>
 #include <renderengine/RenderEngine.h>
 #include <renderengine/impl/ExternalTexture.h>
+#include <utils/Timers.h>
 
+#include <algorithm>
 #include <mutex>
+#include <string>
 
 using namespace android;
 using namespace android::renderengine;
@@ -76,7 +80,9 @@ std::pair<uint32_t, uint32_t> getDisplaySize() {
 
 static std::unique_ptr<RenderEngine> createRenderEngine(
         RenderEngine::Threaded threaded, RenderEngine::GraphicsApi graphicsApi,
-        RenderEngine::BlurAlgorithm blurAlgorithm = RenderEngine::BlurAlgorithm::KAWASE) {
+        RenderEngine::BlurAlgorithm blurAlgorithm = RenderEngine::BlurAlgorithm::KAWASE,
+        bool parallelCapture = false,
+        RenderEngine::SkiaBackend skiaBackend = RenderEngine::SkiaBackend::GANESH) {
     auto args = RenderEngineCreationArgs::Builder()
                         .setPixelFormat(static_cast<int>(ui::PixelFormat::RGBA_8888))
                         .setImageCacheSize(1)
@@ -86,6 +92,8 @@ static std::unique_ptr<RenderEngine> createRenderEngine(
                         .setContextPriority(RenderEngine::ContextPriority::REALTIME)
                         .setThreaded(threaded)
                         .setGraphicsApi(graphicsApi)
+                        .setSkiaBackend(skiaBackend)
+                        .setParallelCapture(parallelCapture)
                         .build();
     return RenderEngine::create(args);
 }
@@ -240,7 +248,8 @@ template <class... Args>
 void BM_homescreen_blur(benchmark::State& benchState, Args&&... args) {
     auto args_tuple = std::make_tuple(std::move(args)...);
     auto re = createRenderEngine(static_cast<RenderEngine::Threaded>(std::get<0>(args_tuple)),
-                                 static_cast<RenderEngine::GraphicsApi>(std::get<1>(args_tuple)));
+                                 static_cast<RenderEngine::GraphicsApi>(std::get<1>(args_tuple)),
+                                 static_cast<RenderEngine::BlurAlgorithm>(std::get<2>(args_tuple)));
 
     auto [width, height] = getDisplaySize();
     auto srcBuffer = createTexture(*re, kHomescreenPath);
@@ -274,6 +283,50 @@ void BM_homescreen_blur(benchmark::State& benchState, Args&&... args) {
     benchDrawLayers(*re, layers, benchState, "homescreen_blurred");
 }
 
+/**
+ * Same as BM_homescreen_blur, but with a backdrop id that stays the same from frame to frame, so
+ * RenderEngine reuses the blur it generated for the first one.
+ */
+template <class... Args>
+void BM_homescreen_cachedBlur(benchmark::State& benchState, Args&&... args) {
+    auto args_tuple = std::make_tuple(std::move(args)...);
+    auto re = createRenderEngine(static_cast<RenderEngine::Threaded>(std::get<0>(args_tuple)),
+                                 static_cast<RenderEngine::GraphicsApi>(std::get<1>(args_tuple)),
+                                 static_cast<RenderEngine::BlurAlgorithm>(std::get<2>(args_tuple)));
+
+    auto [width, height] = getDisplaySize();
+    auto srcBuffer = createTexture(*re, kHomescreenPath);
+
+    const FloatRect layerRect(0, 0, width, height);
+    LayerSettings layer{
+            .geometry =
+                    Geometry{
+                            .boundaries = layerRect,
+                    },
+            .source =
+                    PixelSource{
+                            .buffer =
+                                    Buffer{
+                                            .buffer = srcBuffer,
+                                    },
+                    },
+            .alpha = half(1.0f),
+    };
+    LayerSettings blurLayer{
+            .geometry =
+                    Geometry{
+                            .boundaries = layerRect,
+                    },
+            .alpha = half(1.0f),
+            .skipContentDraw = true,
+            .backgroundBlurRadius = 60,
+            .blurBackdropId = 1,
+    };
+
+    auto layers = std::vector<LayerSettings>{layer, blurLayer};
+    benchDrawLayers(*re, layers, benchState, "homescreen_cached_blur");
+}
+
 template <class... Args>
 void BM_homescreen_edgeExtension(benchmark::State& benchState, Args&&... args) {
     auto args_tuple = std::make_tuple(std::move(args)...);
@@ -309,6 +362,58 @@ void BM_homescreen_edgeExtension(benchmark::State& benchState, Args&&... args) {
     benchDrawLayers(*re, layers, benchState, "homescreen_edge_extension");
 }
 
+/**
+ * Submit a composition and a screenshot of the homescreen at the same time, and wait for both of
+ * them, to measure the throughput with and without drawing screenshots on a second context.
+ */
+template <class... Args>
+void BM_homescreen_concurrentCapture(benchmark::State& benchState, Args&&... args) {
+    auto args_tuple = std::make_tuple(std::move(args)...);
+    auto re = createRenderEngine(static_cast<RenderEngine::Threaded>(std::get<0>(args_tuple)),
+                                 static_cast<RenderEngine::GraphicsApi>(std::get<1>(args_tuple)),
+                                 RenderEngine::BlurAlgorithm::KAWASE,
+                                 static_cast<bool>(std::get<2>(args_tuple)));
+
+    auto [width, height] = getDisplaySize();
+    auto srcBuffer = createTexture(*re, kHomescreenPath);
+    auto compositionBuffer = allocateBuffer(*re, width, height);
+    auto captureBuffer = allocateBuffer(*re, width, height, 0, "capture");
+
+    const FloatRect layerRect(0, 0, width, height);
+    LayerSettings layer{
+            .geometry =
+                    Geometry{
+                            .boundaries = layerRect,
+                    },
+            .source =
+                    PixelSource{
+                            .buffer =
+                                    Buffer{
+                                            .buffer = srcBuffer,
+                                    },
+                    },
+            .alpha = half(1.0f),
+    };
+    const auto layers = std::vector<LayerSettings>{layer};
+
+    const Rect displayRect(0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height));
+    const DisplaySettings composition{
+            .physicalDisplay = displayRect,
+            .clip = displayRect,
+            .maxLuminance = 500,
+    };
+    DisplaySettings capture = composition;
+    capture.priority = DisplaySettings::Priority::Capture;
+
+    for (auto _ : benchState) {
+        auto captureFuture = re->drawLayers(capture, layers, captureBuffer, base::unique_fd());
+        auto compositionFuture =
+                re->drawLayers(composition, layers, compositionBuffer, base::unique_fd());
+        compositionFuture.get().value()->waitForever(LOG_TAG);
+        captureFuture.get().value()->waitForever(LOG_TAG);
+    }
+}
+
 BENCHMARK_CAPTURE(BM_homescreen_blur, gaussian, RenderEngine::Threaded::YES,
                   RenderEngine::GraphicsApi::GL, RenderEngine::BlurAlgorithm::GAUSSIAN);
 
@@ -318,8 +423,161 @@ BENCHMARK_CAPTURE(BM_homescreen_blur, kawase, RenderEngine::Threaded::YES,
 BENCHMARK_CAPTURE(BM_homescreen_blur, kawase_dual_filter, RenderEngine::Threaded::YES,
                   RenderEngine::GraphicsApi::GL, RenderEngine::BlurAlgorithm::KAWASE_DUAL_FILTER);
 
+BENCHMARK_CAPTURE(BM_homescreen_cachedBlur, gaussian, RenderEngine::Threaded::YES,
+                  RenderEngine::GraphicsApi::GL, RenderEngine::BlurAlgorithm::GAUSSIAN);
+
+BENCHMARK_CAPTURE(BM_homescreen_cachedBlur, kawase, RenderEngine::Threaded::YES,
+                  RenderEngine::GraphicsApi::GL, RenderEngine::BlurAlgorithm::KAWASE);
+
+BENCHMARK_CAPTURE(BM_homescreen_cachedBlur, kawase_dual_filter, RenderEngine::Threaded::YES,
+                  RenderEngine::GraphicsApi::GL, RenderEngine::BlurAlgorithm::KAWASE_DUAL_FILTER);
+
 BENCHMARK_CAPTURE(BM_homescreen, SkiaGLThreaded, RenderEngine::Threaded::YES,
                   RenderEngine::GraphicsApi::GL);
 
 BENCHMARK_CAPTURE(BM_homescreen_edgeExtension, SkiaGLThreaded, RenderEngine::Threaded::YES,
                   RenderEngine::GraphicsApi::GL);
+
+BENCHMARK_CAPTURE(BM_homescreen_concurrentCapture, SkiaGLThreaded, RenderEngine::Threaded::YES,
+                  RenderEngine::GraphicsApi::GL, /*parallelCapture*/ false);
+
+BENCHMARK_CAPTURE(BM_homescreen_concurrentCapture, SkiaGLThreadedParallelCapture,
+                  RenderEngine::Threaded::YES, RenderEngine::GraphicsApi::GL,
+                  /*parallelCapture*/ true);
+
+///////////////////////////////////////////////////////////////////////////////
+//  Recorded scenes
+///////////////////////////////////////////////////////////////////////////////
+
+struct Backend {
+    const char* name;
+    RenderEngine::GraphicsApi graphicsApi;
+    RenderEngine::SkiaBackend skiaBackend;
+};
+
+constexpr Backend kBackends[] = {
+        {"SkiaGL", RenderEngine::GraphicsApi::GL, RenderEngine::SkiaBackend::GANESH},
+        {"SkiaVkGanesh", RenderEngine::GraphicsApi::VK, RenderEngine::SkiaBackend::GANESH},
+        {"SkiaVkGraphite", RenderEngine::GraphicsApi::VK, RenderEngine::SkiaBackend::GRAPHITE},
+};
+
+/**
+ * Allocate a buffer with the size and format of a recorded one. The recorded usage is not used,
+ * since protected buffers cannot be drawn without a protected display.
+ */
+static std::shared_ptr<ExternalTexture> allocateRecordedBuffer(
+        RenderEngine& re, const RecordedScene::BufferInfo& info, std::string name) {
+    return std::make_shared<
+            impl::ExternalTexture>(sp<GraphicBuffer>::make(info.width, info.height, info.format,
+                                                           1u,
+                                                           GRALLOC_USAGE_HW_RENDER |
+                                                                   GRALLOC_USAGE_HW_TEXTURE,
+                                                           std::move(name)),
+                                   re,
+                                   impl::ExternalTexture::Usage::READABLE |
+                                           impl::ExternalTexture::Usage::WRITEABLE);
+}
+
+/**
+ * Fill a buffer with an opaque color, since the contents of recorded buffers are not recorded.
+ */
+static void fillBuffer(RenderEngine& re, const std::shared_ptr<ExternalTexture>& buffer) {
+    const Rect rect(static_cast<int32_t>(buffer->getWidth()),
+                    static_cast<int32_t>(buffer->getHeight()));
+    const DisplaySettings display{
+            .physicalDisplay = rect,
+            .clip = rect,
+    };
+    const LayerSettings layer{
+            .geometry = Geometry{.boundaries = rect.toFloatRect()},
+            .source = PixelSource{.solidColor = half3(0.5f, 0.5f, 0.5f)},
+            .alpha = half(1.0f),
+    };
+    re.drawLayers(display, {layer}, buffer, base::unique_fd()).get().value()->waitForever(LOG_TAG);
+}
+
+/**
+ * Replay a recorded scene, reporting per frame:
+ * - cpuSubmitUs: the time until drawLayers returned the fence, which covers recording and
+ *   submitting the GPU work.
+ * - gpuUs: the time from then until the fence signaled, which is the GPU work that did not
+ *   overlap with submission.
+ * And for the first frame, which is excluded from the averages:
+ * - firstFrameUs: the time until its fence signaled.
+ * - shaderCompiles: the shaders compiled to draw it, each of which stalled the frame.
+ */
+static void BM_recordedScene(benchmark::State& benchState, Backend backend,
+                             const RecordedScene& scene) {
+    auto re = createRenderEngine(RenderEngine::Threaded::YES, backend.graphicsApi,
+                                 RenderEngine::BlurAlgorithm::KAWASE, /*parallelCapture*/ false,
+                                 backend.skiaBackend);
+
+    auto outputBuffer = allocateRecordedBuffer(*re, scene.output, "output");
+    std::vector<LayerSettings> layers = scene.layers;
+    for (size_t i = 0; i < layers.size(); i++) {
+        if (const auto& info = scene.layerBuffers[i]) {
+            auto buffer = allocateRecordedBuffer(*re, *info, "source");
+            fillBuffer(*re, buffer);
+            layers[i].source.buffer.buffer = std::move(buffer);
+        }
+    }
+
+    const auto draw = [&](nsecs_t& cpuTime, nsecs_t& gpuTime) {
+        const nsecs_t start = systemTime();
+        sp<Fence> fence =
+                re->drawLayers(scene.display, layers, outputBuffer, base::unique_fd())
+                        .get()
+                        .value();
+        const nsecs_t submitted = systemTime();
+        fence->waitForever(LOG_TAG);
+        const nsecs_t signalTime = fence->getSignalTime();
+        cpuTime = submitted - start;
+        gpuTime = signalTime > 0 && signalTime != Fence::SIGNAL_TIME_PENDING
+                ? std::max(signalTime - submitted, nsecs_t{0})
+                : 0;
+    };
+
+    const int shadersBefore = re->reportShadersCompiled();
+    nsecs_t cpuTime, gpuTime;
+    draw(cpuTime, gpuTime);
+    const nsecs_t firstFrameTime = cpuTime + gpuTime;
+    const int shaderCompiles = re->reportShadersCompiled() - shadersBefore;
+
+    nsecs_t totalCpuTime = 0;
+    nsecs_t totalGpuTime = 0;
+    for (auto _ : benchState) {
+        draw(cpuTime, gpuTime);
+        totalCpuTime += cpuTime;
+        totalGpuTime += gpuTime;
+    }
+
+    const double frames = static_cast<double>(std::max(benchState.iterations(),
+                                                       benchmark::IterationCount{1}));
+    benchState.counters["cpuSubmitUs"] = static_cast<double>(ns2us(totalCpuTime)) / frames;
+    benchState.counters["gpuUs"] = static_cast<double>(ns2us(totalGpuTime)) / frames;
+    benchState.counters["firstFrameUs"] = static_cast<double>(ns2us(firstFrameTime));
+    benchState.counters["shaderCompiles"] = shaderCompiles;
+}
+
+void renderenginebench::registerRecordedScenes() {
+    const char* const path = renderenginebench::scenesPath();
+    if (!path) {
+        return;
+    }
+
+    std::string contents;
+    LOG_ALWAYS_FATAL_IF(!base::ReadFileToString(path, &contents), "Failed to read %s", path);
+    std::optional<std::vector<RecordedScene>> scenes = parseRecordedScenes(contents);
+    LOG_ALWAYS_FATAL_IF(!scenes, "Failed to parse the scenes in %s", path);
+
+    // Benchmarks are run after this returns, so the scenes must outlive it.
+    static const std::vector<RecordedScene> sScenes = std::move(*scenes);
+    for (const Backend& backend : kBackends) {
+        for (size_t i = 0; i < sScenes.size(); i++) {
+            const std::string name =
+                    std::string("BM_recordedScene/") + backend.name + "/" + std::to_string(i);
+            benchmark::RegisterBenchmark(name.c_str(), BM_recordedScene, backend,
+                                         std::cref(sScenes[i]));
+        }
+    }
+}
@@ -27,6 +27,8 @@ namespace renderenginebench {
  *
  * --save Save the output buffer to a file to verify that it drew as
  *  expected.
+ * --scenes=<path> Replay the scenes recorded with debug.renderengine.capture_scenes
+ *  against every backend.
  */
 void parseFlags(int argc, char** argv);
 
@@ -42,6 +44,16 @@ void parseFlagsForHelp(int argc, char** argv);
  */
 bool save();
 
+/**
+ * The file to replay recorded scenes from, or nullptr if --scenes was not used.
+ */
+const char* scenesPath();
+
+/**
+ * Register a benchmark per backend for each scene in scenesPath(), if any.
+ */
+void registerRecordedScenes();
+
 /**
  * Decode the image at 'path' into 'buffer'.
  *
@@ -27,6 +27,7 @@ int main(int argc, char** argv) {
     // google-benchmark's flags, since Initialize will consume and remove flags
     // it recognizes.
     renderenginebench::parseFlags(argc, argv);
+    renderenginebench::registerRecordedScenes();
     benchmark::RunSpecifiedBenchmarks();
     return 0;
 }
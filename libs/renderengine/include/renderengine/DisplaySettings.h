@@ -20,6 +20,7 @@
 #include <aidl/android/hardware/graphics/composer3/RenderIntent.h>
 #include <iosfwd>
 
+#include <ftl/enum.h>
 #include <math/mat4.h>
 #include <renderengine/PrintMatrix.h>
 #include <ui/DisplayId.h>
@@ -50,6 +51,12 @@ struct DisplaySettings {
     // z=1.
     Rect clip = Rect::INVALID_RECT;
 
+    // Rectangle in the same space as physicalDisplay that bounds the pixels that need to be
+    // redrawn. The rest of the buffer must already contain what this draw would produce there.
+    // RenderEngine redraws the whole buffer when this is invalid, or when a layer has blur, since
+    // blurring reads pixels outside of the damage.
+    Rect damage = Rect::INVALID_RECT;
+
     // Maximum luminance pulled from the display's HDR capabilities.
     float maxLuminance = 1.0f;
 
@@ -105,11 +112,22 @@ struct DisplaySettings {
 
     // For now, meaningful primarily when the TonemappingStrategy is Local
     float targetHdrSdrRatio = 1.f;
+
+    // What the draw is for. A threaded RenderEngine runs pending draws for composition before
+    // those for flattening, and those before draws for screenshots and region sampling.
+    enum class Priority {
+        Composition,
+        Flattening,
+        Capture,
+        ftl_last = Capture,
+    };
+    Priority priority = Priority::Composition;
 };
 
 static inline bool operator==(const DisplaySettings& lhs, const DisplaySettings& rhs) {
     return lhs.namePlusId == rhs.namePlusId && lhs.physicalDisplay == rhs.physicalDisplay &&
-            lhs.clip == rhs.clip && lhs.maxLuminance == rhs.maxLuminance &&
+            lhs.clip == rhs.clip && lhs.damage == rhs.damage &&
+            lhs.maxLuminance == rhs.maxLuminance &&
             lhs.currentLuminanceNits == rhs.currentLuminanceNits &&
             lhs.outputDataspace == rhs.outputDataspace &&
             lhs.colorTransform == rhs.colorTransform &&
@@ -148,6 +166,8 @@ static inline void PrintTo(const DisplaySettings& settings, ::std::ostream* os)
     PrintTo(settings.physicalDisplay, os);
     *os << "\n    .clip = ";
     PrintTo(settings.clip, os);
+    *os << "\n    .damage = ";
+    PrintTo(settings.damage, os);
     *os << "\n    .maxLuminance = " << settings.maxLuminance;
     *os << "\n    .currentLuminanceNits = " << settings.currentLuminanceNits;
     *os << "\n    .outputDataspace = ";
@@ -161,6 +181,7 @@ static inline void PrintTo(const DisplaySettings& settings, ::std::ostream* os)
         << aidl::android::hardware::graphics::composer3::toString(settings.dimmingStage).c_str();
     *os << "\n    .renderIntent = "
         << aidl::android::hardware::graphics::composer3::toString(settings.renderIntent).c_str();
+    *os << "\n    .priority = " << ftl::enum_string(settings.priority);
     *os << "\n}";
 }
 
@@ -63,6 +63,10 @@ struct Buffer {
     bool isOpaque = false;
 
     float maxLuminanceNits = 0.0;
+
+    // The frame number of the content of the buffer, which identifies the content together with
+    // the buffer ID. 0 if unknown, in which case nothing derived from the content is cached.
+    uint64_t frameNumber = 0;
 };
 
 // Metadata describing the layer geometry.
@@ -134,6 +138,11 @@ struct LayerSettings {
     // coordinate space as LayerSettings.geometry
     mat4 blurRegionTransform = mat4();
 
+    // Identifies what is drawn beneath this layer, when it blurs its background. Layers with the
+    // same nonzero id blur the same pixels, so a blur generated for an earlier frame may be
+    // reused. If 0, the blur is generated every time.
+    uint64_t blurBackdropId = 0;
+
     StretchEffect stretchEffect;
     EdgeExtensionEffect edgeExtensionEffect;
 
@@ -154,7 +163,8 @@ static inline bool operator==(const Buffer& lhs, const Buffer& rhs) {
             lhs.useTextureFiltering == rhs.useTextureFiltering &&
             lhs.textureTransform == rhs.textureTransform &&
             lhs.usePremultipliedAlpha == rhs.usePremultipliedAlpha &&
-            lhs.isOpaque == rhs.isOpaque && lhs.maxLuminanceNits == rhs.maxLuminanceNits;
+            lhs.isOpaque == rhs.isOpaque && lhs.maxLuminanceNits == rhs.maxLuminanceNits &&
+            lhs.frameNumber == rhs.frameNumber;
 }
 
 static inline bool operator==(const Geometry& lhs, const Geometry& rhs) {
@@ -185,6 +195,7 @@ static inline bool operator==(const LayerSettings& lhs, const LayerSettings& rhs
             lhs.skipContentDraw == rhs.skipContentDraw && lhs.shadow == rhs.shadow &&
             lhs.backgroundBlurRadius == rhs.backgroundBlurRadius &&
             lhs.blurRegionTransform == rhs.blurRegionTransform &&
+            lhs.blurBackdropId == rhs.blurBackdropId &&
             lhs.stretchEffect == rhs.stretchEffect &&
             lhs.edgeExtensionEffect == rhs.edgeExtensionEffect &&
             lhs.whitePointNits == rhs.whitePointNits;
@@ -202,6 +213,7 @@ static inline void PrintTo(const Buffer& settings, ::std::ostream* os) {
     *os << "\n    .usePremultipliedAlpha = " << settings.usePremultipliedAlpha;
     *os << "\n    .isOpaque = " << settings.isOpaque;
     *os << "\n    .maxLuminanceNits = " << settings.maxLuminanceNits;
+    *os << "\n    .frameNumber = " << settings.frameNumber;
     *os << "\n}";
 }
 
@@ -289,6 +301,9 @@ static inline void PrintTo(const LayerSettings& settings, ::std::ostream* os) {
     }
     *os << "\n    .blurRegionTransform = ";
     PrintMatrix(settings.blurRegionTransform, os);
+    if (settings.blurBackdropId) {
+        *os << "\n    .blurBackdropId = " << settings.blurBackdropId;
+    }
     if (settings.stretchEffect != StretchEffect()) {
         *os << "\n    .stretchEffect = ";
         PrintTo(settings.stretchEffect, os);
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <renderengine/DisplaySettings.h>
+#include <renderengine/LayerSettings.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace renderengine {
+
+// A call to drawLayers recorded from composition, so that RenderEngineBench can replay it.
+//
+// The contents of buffers are not recorded, only their size, format and usage. Buffer fences are
+// not recorded either, so a replayed scene never waits on other work.
+struct RecordedScene {
+    struct BufferInfo {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        int32_t format = 0;
+        uint64_t usage = 0;
+    };
+
+    DisplaySettings display;
+    BufferInfo output;
+    std::vector<LayerSettings> layers;
+    // The buffer sampled by each layer, if any, in the same order as layers. The buffers in
+    // layers are left empty.
+    std::vector<std::optional<BufferInfo>> layerBuffers;
+};
+
+// Appends a text description of the draw to result. Scenes can be appended one after another to
+// the same file.
+void appendRecordedScene(std::string& result, const DisplaySettings& display,
+                         const std::vector<LayerSettings>& layers,
+                         const ExternalTexture& output);
+
+// Reads the scenes written by appendRecordedScene. Lines that are not understood are skipped, so
+// that older readers can read newer recordings. Returns nullopt if a line is malformed.
+std::optional<std::vector<RecordedScene>> parseRecordedScenes(const std::string& contents);
+
+} // namespace renderengine
+} // namespace android
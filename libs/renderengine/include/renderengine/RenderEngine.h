@@ -44,6 +44,12 @@
  */
 #define PROPERTY_DEBUG_RENDERENGINE_CAPTURE_SKIA_MS "debug.renderengine.capture_skia_ms"
 
+/**
+ * Records the layers drawn for this many frames to a file that RenderEngineBench can replay with
+ * --scenes. Reset to 0 once the frames have been recorded.
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_CAPTURE_SCENES "debug.renderengine.capture_scenes"
+
 /**
  * Set to the most recently saved file once the capture is finished.
  */
@@ -54,6 +60,53 @@
  */
 #define PROPERTY_DEBUG_RENDERENGINE_BLUR_ALGORITHM "debug.renderengine.blur_algorithm"
 
+/**
+ * Draws screenshots on a second threaded RenderEngine with its own GPU context, so they can run
+ * at the same time as composition.
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_PARALLEL_CAPTURE "debug.renderengine.parallel_capture"
+
+/**
+ * The file that the shaders compiled by RenderEngine are saved to, so that later boots prime the
+ * shader cache with them instead of with a fixed set of layers. Unset to disable.
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_SHADER_CACHE_FILE "debug.renderengine.shader_cache_file"
+
+/**
+ * Limits the estimated size of the textures that RenderEngine keeps for mapped buffers. Textures
+ * that weren't used recently are released over the limit, and imported again when drawn. Set to 0
+ * for no limit.
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_TEXTURE_CACHE_BUDGET_MB \
+    "debug.renderengine.texture_cache_budget_mb"
+
+/**
+ * Limits the size of the shadows that RenderEngine rasterizes once and reuses while the caster and
+ * the shadow settings stay the same. Shadows that weren't used recently are released over the
+ * limit. Set to 0 to draw every shadow directly.
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_SHADOW_CACHE_BUDGET_KB \
+    "debug.renderengine.shadow_cache_budget_kb"
+
+/**
+ * Tone maps HDR layers by sampling a 3D LUT that is rebuilt whenever the tone mapping parameters
+ * change, instead of evaluating the tone mapping curve for every pixel.
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_TONEMAP_LUT "debug.renderengine.tonemap_lut"
+
+/**
+ * Compiles the gamut conversions of color management shaders in as constants, and leaves out tone
+ * mapping between SDR dataspaces, instead of passing them as uniforms.
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_SPECIALIZE_LINEAR_EFFECTS \
+    "debug.renderengine.specialize_linear_effects"
+
+/**
+ * Draws gainmaps in bands of this many rows, which the threaded RenderEngine queues separately so
+ * that composition can draw between them. Set to 0 to draw gainmaps in one pass.
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_GAINMAP_TILE_ROWS "debug.renderengine.gainmap_tile_rows"
+
 /**
  * Allows recording of Skia drawing commands with systrace.
  */
@@ -102,6 +155,7 @@ struct PrimeCacheConfig {
     bool cacheTransparentImageDimmedLayers = true;
     bool cacheClippedDimmedImageLayers = true;
     bool cacheUltraHDR = true;
+    bool cacheSpecializedLinearEffects = true;
 };
 
 class RenderEngine {
@@ -251,6 +305,10 @@ public:
 
     virtual void setEnableTracing(bool /*tracingEnabled*/) {}
 
+    // Returns the number of shaders compiled since RenderEngine was created, or 0 if the backend
+    // does not report it. Used by RenderEngineBench to count shader compile stalls.
+    virtual int reportShadersCompiled() { return 0; }
+
 protected:
     RenderEngine() : RenderEngine(Threaded::NO) {}
 
@@ -280,6 +338,12 @@ protected:
     // that's conflict serializable, i.e. unmap a buffer should never occur before binding the
     // buffer if the caller called mapExternalTextureBuffer before calling unmap.
     virtual void unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer) = 0;
+    // Maps and unmaps GPU resources for each of the buffers in order, as the calls above do. A
+    // threaded RenderEngine processes the buffers together as one operation, rather than queueing
+    // one operation per buffer.
+    virtual void mapExternalTextureBuffers(const std::vector<sp<GraphicBuffer>>& buffers,
+                                           bool isRenderable);
+    virtual void unmapExternalTextureBuffers(std::vector<sp<GraphicBuffer>>&& buffers);
 
     // A thread safe query to determine if any post rendering cleanup is necessary.  Returning true
     // is a signal that calling the postRenderCleanup method would be a no-op and that callers can
@@ -302,12 +366,14 @@ protected:
             const DisplaySettings& display, const std::vector<LayerSettings>& layers,
             const std::shared_ptr<ExternalTexture>& buffer, base::unique_fd&& bufferFence) = 0;
 
+    // Only draws the region of the gainmap, in gainmap pixels. The gainmap may be smaller than the
+    // SDR and HDR buffers, which are then downsampled to it.
     virtual void drawGainmapInternal(
             const std::shared_ptr<std::promise<FenceResult>>&& resultPromise,
             const std::shared_ptr<ExternalTexture>& sdr, base::borrowed_fd&& sdrFence,
             const std::shared_ptr<ExternalTexture>& hdr, base::borrowed_fd&& hdrFence,
             float hdrSdrRatio, ui::Dataspace dataspace,
-            const std::shared_ptr<ExternalTexture>& gainmap) = 0;
+            const std::shared_ptr<ExternalTexture>& gainmap, const Rect& region) = 0;
 };
 
 struct RenderEngineCreationArgs {
@@ -321,6 +387,9 @@ struct RenderEngineCreationArgs {
     RenderEngine::Threaded threaded;
     RenderEngine::GraphicsApi graphicsApi;
     RenderEngine::SkiaBackend skiaBackend;
+    // Whether a threaded RenderEngine draws with DisplaySettings::Priority::Capture on a second
+    // instance. Only supported with GL, since a Vulkan RenderEngine can't have a second instance.
+    bool parallelCapture;
 
     struct Builder;
 
@@ -332,7 +401,7 @@ private:
                              RenderEngine::ContextPriority _contextPriority,
                              RenderEngine::Threaded _threaded,
                              RenderEngine::GraphicsApi _graphicsApi,
-                             RenderEngine::SkiaBackend _skiaBackend)
+                             RenderEngine::SkiaBackend _skiaBackend, bool _parallelCapture)
           : pixelFormat(_pixelFormat),
             imageCacheSize(_imageCacheSize),
             enableProtectedContext(_enableProtectedContext),
@@ -341,7 +410,8 @@ private:
             contextPriority(_contextPriority),
             threaded(_threaded),
             graphicsApi(_graphicsApi),
-            skiaBackend(_skiaBackend) {}
+            skiaBackend(_skiaBackend),
+            parallelCapture(_parallelCapture) {}
     RenderEngineCreationArgs() = delete;
 };
 
@@ -384,10 +454,15 @@ struct RenderEngineCreationArgs::Builder {
         this->skiaBackend = skiaBackend;
         return *this;
     }
+    Builder& setParallelCapture(bool parallelCapture) {
+        this->parallelCapture = parallelCapture;
+        return *this;
+    }
     RenderEngineCreationArgs build() const {
         return RenderEngineCreationArgs(pixelFormat, imageCacheSize, enableProtectedContext,
                                         precacheToneMapperShaderOnly, blurAlgorithm,
-                                        contextPriority, threaded, graphicsApi, skiaBackend);
+                                        contextPriority, threaded, graphicsApi, skiaBackend,
+                                        parallelCapture);
     }
 
 private:
@@ -401,6 +476,7 @@ private:
     RenderEngine::Threaded threaded = RenderEngine::Threaded::YES;
     RenderEngine::GraphicsApi graphicsApi = RenderEngine::GraphicsApi::GL;
     RenderEngine::SkiaBackend skiaBackend = RenderEngine::SkiaBackend::GANESH;
+    bool parallelCapture = false;
 };
 
 } // namespace renderengine
@@ -20,6 +20,8 @@
 #include <renderengine/ExternalTexture.h>
 #include <ui/GraphicBuffer.h>
 
+#include <vector>
+
 namespace android::renderengine::impl {
 
 class RenderEngine;
@@ -53,7 +55,33 @@ public:
     }
     void remapBuffer() override;
 
+    // While a Batch is alive, the ExternalTextures of its RenderEngine that are created and
+    // destroyed on the same thread only map and unmap their buffers once the Batch is destroyed,
+    // all together. This way a threaded RenderEngine queues one operation for them, rather than
+    // one per buffer. The textures created in the scope of a Batch should not be drawn before it
+    // is destroyed.
+    class Batch {
+    public:
+        explicit Batch(android::renderengine::RenderEngine& renderEngine);
+        ~Batch();
+
+    private:
+        friend class ExternalTexture;
+
+        DISALLOW_COPY_AND_ASSIGN(Batch);
+
+        android::renderengine::RenderEngine& mRenderEngine;
+        // The Batch that was current on this thread before this one.
+        Batch* const mPrevious;
+        std::vector<sp<GraphicBuffer>> mMapped;
+        std::vector<sp<GraphicBuffer>> mMappedRenderable;
+        std::vector<sp<GraphicBuffer>> mUnmapped;
+    };
+
 private:
+    void map();
+    void unmap(sp<GraphicBuffer>&& buffer);
+
     sp<GraphicBuffer> mBuffer;
     android::renderengine::RenderEngine& mRenderEngine;
     const bool mWritable;
@@ -28,6 +28,7 @@
 #include "utils/Timers.h"
 
 #include <com_android_graphics_libgui_flags.h>
+#include <shaders/shaders.h>
 
 namespace android::renderengine::skia {
 
@@ -621,6 +622,38 @@ static void drawP3ImageLayers(SkiaRenderEngine* renderengine, const DisplaySetti
     }
 }
 
+// Draws an image layer for each of shaders::getCommonLinearEffects(), with a color transform so
+// that each of them needs a LinearEffect.
+static void drawCommonLinearEffectLayers(SkiaRenderEngine* renderengine,
+                                         const DisplaySettings& display,
+                                         const std::shared_ptr<ExternalTexture>& dstTexture,
+                                         const std::shared_ptr<ExternalTexture>& srcTexture) {
+    const Rect& displayRect = display.physicalDisplay;
+    FloatRect rect(0, 0, displayRect.width(), displayRect.height());
+    for (const shaders::LinearEffect& effect : shaders::getCommonLinearEffects()) {
+        DisplaySettings effectDisplay = display;
+        effectDisplay.outputDataspace = effect.outputDataspace;
+        LayerSettings layer{
+                .geometry =
+                        Geometry{
+                                .positionTransform = mat4(),
+                                .boundaries = rect,
+                                .roundedCornersCrop = rect,
+                        },
+                .source = PixelSource{.buffer = Buffer{.buffer = srcTexture,
+                                                       .maxLuminanceNits = 1000.f,
+                                                       .usePremultipliedAlpha = true,
+                                                       .isOpaque = !effect.undoPremultipliedAlpha}},
+                .alpha = 1.f,
+                .sourceDataspace = effect.inputDataspace,
+                .colorTransform = kScaleAsymmetric,
+        };
+
+        std::vector<LayerSettings> layers{layer};
+        renderengine->drawLayers(effectDisplay, layers, dstTexture, base::unique_fd());
+    }
+}
+
 static void drawEdgeExtensionLayers(SkiaRenderEngine* renderengine, const DisplaySettings& display,
                                     const std::shared_ptr<ExternalTexture>& dstTexture,
                                     const std::shared_ptr<ExternalTexture>& srcTexture) {
@@ -827,6 +860,10 @@ void Cache::primeShaderCache(SkiaRenderEngine* renderengine, PrimeCacheConfig co
             drawP3ImageLayers(renderengine, p3DisplayEnhance, dstTexture, externalTexture);
         }
 
+        if (config.cacheSpecializedLinearEffects && renderengine->specializesLinearEffects()) {
+            drawCommonLinearEffectLayers(renderengine, display, dstTexture, externalTexture);
+        }
+
         // draw one final layer synchronously to force GL submit
         LayerSettings layer{
                 .source = PixelSource{.solidColor = half3(0.f, 0.f, 0.f)},
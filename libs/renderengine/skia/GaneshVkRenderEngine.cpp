@@ -58,6 +58,9 @@ std::unique_ptr<SkiaGpuContext> GaneshVkRenderEngine::createContext(
 
 void GaneshVkRenderEngine::waitFence(SkiaGpuContext* context, base::borrowed_fd fenceFd) {
     if (fenceFd.get() < 0) return;
+    // Most buffers have been released by the time they're drawn, so skip importing fences that
+    // have already signaled.
+    if (sync_wait(fenceFd.get(), 0) == 0) return;
 
     const int dupedFd = dup(fenceFd.get());
     if (dupedFd < 0) {
@@ -67,6 +67,9 @@ std::unique_ptr<SkiaGpuContext> GraphiteVkRenderEngine::createContext(
 
 void GraphiteVkRenderEngine::waitFence(SkiaGpuContext*, base::borrowed_fd fenceFd) {
     if (fenceFd.get() < 0) return;
+    // Most buffers have been released by the time they're drawn, so skip importing fences that
+    // have already signaled.
+    if (sync_wait(fenceFd.get(), 0) == 0) return;
 
     int dupedFd = dup(fenceFd.get());
     if (dupedFd < 0) {
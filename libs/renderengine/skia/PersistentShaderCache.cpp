@@ -0,0 +1,222 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "RenderEngine"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "PersistentShaderCache.h"
+
+#include <android-base/file.h>
+#include <android-base/properties.h>
+#include <common/trace.h>
+#include <log/log.h>
+#include <renderengine/RenderEngine.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "debug/CommonPool.h"
+
+namespace android::renderengine::skia {
+
+namespace {
+
+void appendUint32(std::string& result, uint32_t value) {
+    result.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendBytes(std::string& result, const void* data, size_t size) {
+    appendUint32(result, static_cast<uint32_t>(size));
+    result.append(static_cast<const char*>(data), size);
+}
+
+// Reads from a serialized cache, and fails all reads past the end.
+class Reader {
+public:
+    explicit Reader(const std::string& contents) : mContents(contents) {}
+
+    bool readUint32(uint32_t& value) {
+        if (mContents.size() - mOffset < sizeof(value)) {
+            return false;
+        }
+        std::memcpy(&value, mContents.data() + mOffset, sizeof(value));
+        mOffset += sizeof(value);
+        return true;
+    }
+
+    bool readString(std::string& value) {
+        uint32_t size;
+        if (!readUint32(size) || mContents.size() - mOffset < size) {
+            return false;
+        }
+        value.assign(mContents, mOffset, size);
+        mOffset += size;
+        return true;
+    }
+
+    bool readData(sk_sp<SkData>& value) {
+        uint32_t size;
+        if (!readUint32(size) || mContents.size() - mOffset < size) {
+            return false;
+        }
+        value = SkData::MakeWithCopy(mContents.data() + mOffset, size);
+        mOffset += size;
+        return true;
+    }
+
+private:
+    const std::string& mContents;
+    size_t mOffset = 0;
+};
+
+std::string keyString(const SkData& key) {
+    return std::string(static_cast<const char*>(key.data()), key.size());
+}
+
+} // namespace
+
+PersistentShaderCache* PersistentShaderCache::getInstance() {
+    static const std::unique_ptr<PersistentShaderCache> sInstance = [] {
+        std::string path = base::GetProperty(PROPERTY_DEBUG_RENDERENGINE_SHADER_CACHE_FILE, "");
+        if (path.empty()) {
+            return std::unique_ptr<PersistentShaderCache>();
+        }
+        auto cache =
+                std::make_unique<PersistentShaderCache>(std::move(path),
+                                                        base::GetProperty("ro.build.fingerprint",
+                                                                          ""));
+        cache->load();
+        return cache;
+    }();
+    return sInstance.get();
+}
+
+PersistentShaderCache::PersistentShaderCache(std::string path, std::string buildFingerprint)
+      : mPath(std::move(path)), mBuildFingerprint(std::move(buildFingerprint)) {}
+
+bool PersistentShaderCache::load() {
+    SFTRACE_CALL();
+    std::string contents;
+    if (!base::ReadFileToString(mPath, &contents)) {
+        return false;
+    }
+    if (!deserialize(contents)) {
+        ALOGW("Discarding stale or corrupt shader cache %s", mPath.c_str());
+        return false;
+    }
+    ALOGD("Loaded %zu shaders from %s", size(), mPath.c_str());
+    return true;
+}
+
+void PersistentShaderCache::store(const SkData& key, const SkData& data) {
+    std::lock_guard lock(mMutex);
+    if (mKeys.count(keyString(key)) != 0 || mShaders.size() >= kMaxShaders ||
+        mBytes + key.size() + data.size() > kMaxBytes) {
+        return;
+    }
+    mKeys.insert(keyString(key));
+    mShaders.emplace_back(SkData::MakeWithCopy(key.data(), key.size()),
+                          SkData::MakeWithCopy(data.data(), data.size()));
+    mBytes += key.size() + data.size();
+    mChanged = true;
+}
+
+void PersistentShaderCache::saveIfChanged() {
+    if (!mChanged) {
+        return;
+    }
+    {
+        std::lock_guard lock(mMutex);
+        const nsecs_t now = systemTime();
+        if (now - mLastSaveRequestTime < kMinSaveInterval || !mChanged.exchange(false)) {
+            return;
+        }
+        mLastSaveRequestTime = now;
+    }
+    CommonPool::post([this] {
+        if (!save()) {
+            ALOGW("Failed to save the shader cache to %s", mPath.c_str());
+        }
+    });
+}
+
+bool PersistentShaderCache::save() {
+    SFTRACE_CALL();
+    const std::string contents = serialize();
+
+    // Write to a temporary file first, so a crash never leaves a partially written cache.
+    std::lock_guard lock(mSaveMutex);
+    const std::string tempPath = mPath + ".tmp";
+    if (!base::WriteStringToFile(contents, tempPath)) {
+        return false;
+    }
+    return std::rename(tempPath.c_str(), mPath.c_str()) == 0;
+}
+
+std::vector<PersistentShaderCache::Shader> PersistentShaderCache::getShaders() const {
+    std::lock_guard lock(mMutex);
+    return mShaders;
+}
+
+size_t PersistentShaderCache::size() const {
+    std::lock_guard lock(mMutex);
+    return mShaders.size();
+}
+
+std::string PersistentShaderCache::serialize() const {
+    std::string result;
+    appendUint32(result, kMagic);
+    appendUint32(result, kVersion);
+    appendBytes(result, mBuildFingerprint.data(), mBuildFingerprint.size());
+
+    std::lock_guard lock(mMutex);
+    appendUint32(result, static_cast<uint32_t>(mShaders.size()));
+    for (const auto& [key, data] : mShaders) {
+        appendBytes(result, key->data(), key->size());
+        appendBytes(result, data->data(), data->size());
+    }
+    return result;
+}
+
+bool PersistentShaderCache::deserialize(const std::string& contents) {
+    Reader reader(contents);
+    uint32_t magic, version, count;
+    std::string buildFingerprint;
+    if (!reader.readUint32(magic) || magic != kMagic || !reader.readUint32(version) ||
+        version != kVersion || !reader.readString(buildFingerprint) ||
+        buildFingerprint != mBuildFingerprint || !reader.readUint32(count)) {
+        return false;
+    }
+
+    std::vector<Shader> shaders;
+    for (uint32_t i = 0; i < count; i++) {
+        sk_sp<SkData> key, data;
+        if (!reader.readData(key) || !reader.readData(data)) {
+            return false;
+        }
+        shaders.emplace_back(std::move(key), std::move(data));
+    }
+
+    for (const auto& [key, data] : shaders) {
+        store(*key, *data);
+    }
+    mChanged = false;
+    return true;
+}
+
+} // namespace android::renderengine::skia
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <include/core/SkData.h>
+#include <include/core/SkRefCnt.h>
+#include <utils/Timers.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace android::renderengine::skia {
+
+/**
+ * Records the shaders Skia compiles, and saves them to a file so that the next boot can compile
+ * them ahead of time instead of drawing a fixed set of layers. Shaders are saved as SkSL, so they
+ * can be precompiled by both the GL and Vulkan Ganesh backends.
+ *
+ * The file is discarded when it was written by a different version of this class or a different
+ * build, since the SkSL may not match what that build of Skia generates.
+ *
+ * Thread-safe, since every RenderEngine instance in the process records to the same cache.
+ */
+class PersistentShaderCache {
+public:
+    using Shader = std::pair<sk_sp<SkData>, sk_sp<SkData>>;
+
+    // Returns the cache for the file in PROPERTY_DEBUG_RENDERENGINE_SHADER_CACHE_FILE, loading it
+    // on the first call. Returns nullptr if the property is not set.
+    static PersistentShaderCache* getInstance();
+
+    PersistentShaderCache(std::string path, std::string buildFingerprint);
+
+    // Reads the shaders saved by a previous boot. Returns false if the file is missing or stale.
+    bool load();
+
+    // Records a shader Skia compiled. Shaders are not recorded once the cache is full.
+    void store(const SkData& key, const SkData& data);
+
+    // Writes the cache in the background if shaders were recorded since the last write, at most
+    // once every kMinSaveInterval.
+    void saveIfChanged();
+
+    // Writes the cache now. Returns false on failure.
+    bool save();
+
+    std::vector<Shader> getShaders() const;
+    size_t size() const;
+
+private:
+    static constexpr uint32_t kMagic = 0x52455343; // 'RESC'
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kMaxShaders = 1024;
+    static constexpr size_t kMaxBytes = 4 * 1024 * 1024;
+    static constexpr nsecs_t kMinSaveInterval = s2ns(10);
+
+    std::string serialize() const;
+    bool deserialize(const std::string& contents);
+
+    const std::string mPath;
+    const std::string mBuildFingerprint;
+
+    mutable std::mutex mMutex;
+    std::vector<Shader> mShaders GUARDED_BY(mMutex);
+    // The contents of the keys in mShaders.
+    std::unordered_set<std::string> mKeys GUARDED_BY(mMutex);
+    size_t mBytes GUARDED_BY(mMutex) = 0;
+
+    std::atomic_bool mChanged = false;
+    nsecs_t mLastSaveRequestTime GUARDED_BY(mMutex) = 0;
+    // Serializes writes to the file.
+    std::mutex mSaveMutex;
+};
+
+} // namespace android::renderengine::skia
@@ -49,6 +49,7 @@
 #include <SkString.h>
 #include <SkSurface.h>
 #include <SkTileMode.h>
+#include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <common/FlagManager.h>
 #include <common/trace.h>
@@ -64,7 +65,9 @@
 #include <ui/DebugUtils.h>
 #include <ui/GraphicBuffer.h>
 #include <ui/HdrRenderTypeUtils.h>
+#include <ui/PixelFormat.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <deque>
@@ -258,10 +261,34 @@ void trace(sp<Fence> fence) {
 using base::StringAppendF;
 
 std::future<void> SkiaRenderEngine::primeCache(PrimeCacheConfig config) {
-    Cache::primeShaderCache(this, config);
+    if (!primeRecordedShaders()) {
+        Cache::primeShaderCache(this, config);
+    }
     return {};
 }
 
+bool SkiaRenderEngine::primeRecordedShaders() {
+    if (!mPersistentShaderCache || mPersistentShaderCache->size() == 0) {
+        return false;
+    }
+    SFTRACE_CALL();
+
+    const nsecs_t timeBefore = systemTime();
+    size_t compiled = 0;
+    const auto shaders = mPersistentShaderCache->getShaders();
+    for (const auto& [key, data] : shaders) {
+        if (getActiveContext()->precompileShader(*key, *data)) {
+            compiled++;
+        }
+    }
+    const nsecs_t timeAfter = systemTime();
+    ALOGD("Precompiled %zu of %zu recorded shaders in %.3fms", compiled, shaders.size(),
+          static_cast<float>(timeAfter - timeBefore) / 1.0E6);
+
+    // Fall back to the fixed set of layers if the backend can't precompile recorded shaders.
+    return compiled > 0;
+}
+
 sk_sp<SkData> SkiaRenderEngine::SkSLCacheMonitor::load(const SkData& key) {
     // This "cache" does not actually cache anything. It just allows us to
     // monitor Skia's internal cache. So this method always returns null.
@@ -272,6 +299,9 @@ void SkiaRenderEngine::SkSLCacheMonitor::store(const SkData& key, const SkData&
                                                const SkString& description) {
     mShadersCachedSinceLastCall++;
     mTotalShadersCompiled++;
+    if (mPersistentShaderCache) {
+        mPersistentShaderCache->store(key, data);
+    }
     SFTRACE_FORMAT("SF cache: %i shaders", mTotalShadersCompiled);
 }
 
@@ -285,7 +315,22 @@ void SkiaRenderEngine::setEnableTracing(bool tracingEnabled) {
 
 SkiaRenderEngine::SkiaRenderEngine(Threaded threaded, PixelFormat pixelFormat,
                                    BlurAlgorithm blurAlgorithm)
-      : RenderEngine(threaded), mDefaultPixelFormat(pixelFormat) {
+      : RenderEngine(threaded),
+        mPersistentShaderCache(PersistentShaderCache::getInstance()),
+        mDefaultPixelFormat(pixelFormat),
+        mTextureCacheBudgetBytes(static_cast<size_t>(
+                base::GetUintProperty<uint32_t>(PROPERTY_DEBUG_RENDERENGINE_TEXTURE_CACHE_BUDGET_MB,
+                                                0)) *
+                                 1024 * 1024),
+        mUseTonemapLut(base::GetBoolProperty(PROPERTY_DEBUG_RENDERENGINE_TONEMAP_LUT, false)),
+        mSpecializeLinearEffects(
+                base::GetBoolProperty(PROPERTY_DEBUG_RENDERENGINE_SPECIALIZE_LINEAR_EFFECTS,
+                                      false)),
+        mShadowCacheBudgetBytes(static_cast<size_t>(base::GetUintProperty<uint32_t>(
+                                        PROPERTY_DEBUG_RENDERENGINE_SHADOW_CACHE_BUDGET_KB, 0)) *
+                                1024) {
+    mSkSLCacheMonitor.setPersistentShaderCache(mPersistentShaderCache);
+
     switch (blurAlgorithm) {
         case BlurAlgorithm::GAUSSIAN: {
             ALOGD("Background Blurs Enabled (Gaussian algorithm)");
@@ -326,6 +371,13 @@ void SkiaRenderEngine::finishRenderingAndAbandonContexts() {
     // before ~SkiaGpuContext is called.
     mTextureCleanupMgr.setDeferredStatus(false);
     mTextureCleanupMgr.cleanup();
+    mBlurCache.clear();
+    if (mMouriMap) {
+        mMouriMap->clearCache();
+    }
+    mShadowCache.clear();
+    mShadowCacheBytes = 0;
+    mTonemapLuts.clear();
 
     // ~SkiaGpuContext must be called before GPU API contexts are torn down.
     mContext.reset();
@@ -423,13 +475,12 @@ void SkiaRenderEngine::mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer,
     }
     // We don't attempt to map a buffer if the buffer contains protected content. In GL this is
     // important because GPU resources for protected buffers are much more limited. (In Vk we
-    // simply match the existing behavior for protected buffers.)  We also never cache any
-    // buffers while in a protected context.
+    // simply match the existing behavior for protected buffers.)
     const bool isProtectedBuffer = buffer->getUsage() & GRALLOC_USAGE_PROTECTED;
     // Don't attempt to map buffers if we're not gpu sampleable. Callers shouldn't send a buffer
     // over to RenderEngine.
     const bool isGpuSampleable = buffer->getUsage() & GRALLOC_USAGE_HW_TEXTURE;
-    if (isProtectedBuffer || isProtected() || !isGpuSampleable) {
+    if (isProtectedBuffer || !isGpuSampleable) {
         return;
     }
     SFTRACE_CALL();
@@ -443,16 +494,67 @@ void SkiaRenderEngine::mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer,
     std::lock_guard<std::mutex> lock(mRenderingMutex);
     mGraphicBufferExternalRefs[buffer->getId()]++;
 
+    // We never cache any buffers while in a protected context. The buffer is still tracked, so
+    // that its texture is imported and cached the first time it is drawn in the unprotected
+    // context, instead of on every draw.
+    if (isProtected()) {
+        return;
+    }
+
     if (const auto& iter = cache.find(buffer->getId()); iter == cache.end()) {
         if (FlagManager::getInstance().renderable_buffer_usage()) {
             isRenderable = buffer->getUsage() & GRALLOC_USAGE_HW_RENDER;
         }
-        std::unique_ptr<SkiaBackendTexture> backendTexture =
-                context->makeBackendTexture(buffer->toAHardwareBuffer(), isRenderable);
-        auto imageTextureRef =
-                std::make_shared<AutoBackendTexture::LocalRef>(std::move(backendTexture),
-                                                               mTextureCleanupMgr);
-        cache.insert({buffer->getId(), imageTextureRef});
+        cacheTexture(buffer, importTexture(buffer, isRenderable));
+    }
+}
+
+std::shared_ptr<AutoBackendTexture::LocalRef> SkiaRenderEngine::importTexture(
+        const sp<GraphicBuffer>& buffer, bool isRenderable) {
+    const nsecs_t start = systemTime();
+    std::unique_ptr<SkiaBackendTexture> backendTexture =
+            getActiveContext()->makeBackendTexture(buffer->toAHardwareBuffer(), isRenderable);
+    auto texture = std::make_shared<AutoBackendTexture::LocalRef>(std::move(backendTexture),
+                                                                  mTextureCleanupMgr);
+    const nsecs_t duration = systemTime() - start;
+
+    mTextureCacheStats.imports++;
+    mTextureCacheStats.totalImportTime += duration;
+    mTextureCacheStats.maxImportTime = std::max(mTextureCacheStats.maxImportTime, duration);
+    return texture;
+}
+
+void SkiaRenderEngine::cacheTexture(const sp<GraphicBuffer>& buffer,
+                                    std::shared_ptr<AutoBackendTexture::LocalRef> texture) {
+    uint32_t bytesPerPixel = android::bytesPerPixel(buffer->getPixelFormat());
+    if (bytesPerPixel == 0) {
+        // YUV formats take less, but this keeps the estimate on the safe side.
+        bytesPerPixel = 4;
+    }
+    const size_t bytes = static_cast<size_t>(buffer->getStride()) * buffer->getHeight() *
+            buffer->getLayerCount() * bytesPerPixel;
+
+    mTextureLru.push_front(buffer->getId());
+    mTextureCache.insert({buffer->getId(), {std::move(texture), bytes, mTextureLru.begin()}});
+    mTextureCacheBytes += bytes;
+
+    if (mTextureCacheBudgetBytes == 0) {
+        return;
+    }
+    // Never evict the texture that was just added, even if it is over budget by itself. Textures
+    // that are being drawn are only released once the draw no longer references them.
+    while (mTextureCacheBytes > mTextureCacheBudgetBytes && mTextureLru.size() > 1) {
+        SFTRACE_NAME("evictTexture");
+        eraseCachedTexture(mTextureLru.back());
+        mTextureCacheStats.evictions++;
+    }
+}
+
+void SkiaRenderEngine::eraseCachedTexture(GraphicBufferId id) {
+    if (const auto iter = mTextureCache.find(id); iter != mTextureCache.end()) {
+        mTextureCacheBytes -= iter->second.bytes;
+        mTextureLru.erase(iter->second.lruPosition);
+        mTextureCache.erase(iter);
     }
 }
 
@@ -482,7 +584,7 @@ void SkiaRenderEngine::unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer) {
         useProtectedContext(buffer->getUsage() & GRALLOC_USAGE_PROTECTED);
 
         if (iter->second == 0) {
-            mTextureCache.erase(buffer->getId());
+            eraseCachedTexture(buffer->getId());
             mGraphicBufferExternalRefs.erase(buffer->getId());
         }
 
@@ -499,13 +601,26 @@ std::shared_ptr<AutoBackendTexture::LocalRef> SkiaRenderEngine::getOrCreateBacke
     // Do not lookup the buffer in the cache for protected contexts
     if (!isProtected()) {
         if (const auto& it = mTextureCache.find(buffer->getId()); it != mTextureCache.end()) {
-            return it->second;
+            mTextureLru.splice(mTextureLru.begin(), mTextureLru, it->second.lruPosition);
+            if (!it->second.drawn) {
+                it->second.drawn = true;
+                mTextureCacheStats.readyOnFirstDraw++;
+            }
+            return it->second.texture;
         }
     }
-    std::unique_ptr<SkiaBackendTexture> backendTexture =
-            getActiveContext()->makeBackendTexture(buffer->toAHardwareBuffer(), isOutputBuffer);
-    return std::make_shared<AutoBackendTexture::LocalRef>(std::move(backendTexture),
-                                                          mTextureCleanupMgr);
+
+    // A mapped buffer is only missing from the cache if its texture was evicted, so cache it again.
+    // Make it renderable if the buffer is, so it can be used both as an input and as an output.
+    if (!isProtected() && mGraphicBufferExternalRefs.count(buffer->getId()) != 0) {
+        const bool isRenderable = isOutputBuffer || (buffer->getUsage() & GRALLOC_USAGE_HW_RENDER);
+        auto texture = importTexture(buffer, isRenderable);
+        mTextureCacheStats.reimports++;
+        cacheTexture(buffer, texture);
+        mTextureCache.at(buffer->getId()).drawn = true;
+        return texture;
+    }
+    return importTexture(buffer, isOutputBuffer);
 }
 
 bool SkiaRenderEngine::canSkipPostRenderCleanup() const {
@@ -517,6 +632,9 @@ void SkiaRenderEngine::cleanupPostRender() {
     SFTRACE_CALL();
     std::lock_guard<std::mutex> lock(mRenderingMutex);
     mTextureCleanupMgr.cleanup();
+    if (mPersistentShaderCache) {
+        mPersistentShaderCache->saveIfChanged();
+    }
 }
 
 sk_sp<SkShader> SkiaRenderEngine::createRuntimeEffectShader(
@@ -561,19 +679,50 @@ sk_sp<SkShader> SkiaRenderEngine::createRuntimeEffectShader(
         if (usingLocalTonemap) {
             const float inputRatio =
                     hdrType == HdrRenderType::GENERIC_HDR ? 1.0f : parameters.layerDimmingRatio;
-            static MouriMap kMapper;
-            shader = kMapper.mouriMap(getActiveContext(), shader, inputRatio,
-                                      parameters.display.targetHdrSdrRatio);
+            if (!mMouriMap) {
+                mMouriMap = std::make_unique<MouriMap>();
+            }
+            shader = mMouriMap->mouriMap(getActiveContext(), shader, inputRatio,
+                                         parameters.display.targetHdrSdrRatio,
+                                         graphicBuffer->getId(),
+                                         parameters.layer.source.buffer.frameNumber);
         }
 
         // disable tonemapping if we already locally tonemapped
         auto inputDataspace =
                 usingLocalTonemap ? parameters.outputDataSpace : parameters.layer.sourceDataspace;
+        mat4 colorTransform = parameters.layer.colorTransform;
+        const bool dim = !usingLocalTonemap;
+
+        // Dimming scales the LUT's output, so that brightness changes don't rebuild the LUT. That
+        // is only the same as dimming before the color transform if the transform has no offset.
+        sk_sp<SkImage> lut;
+        float lutGain = 1.f;
+        if (mUseTonemapLut &&
+            shaders::canUseLinearEffectLut({.inputDataspace = inputDataspace,
+                                            .outputDataspace = parameters.outputDataSpace})) {
+            mat4 lutTransform = colorTransform;
+            if (dim && colorTransform[3] == vec4(0.f, 0.f, 0.f, 1.f)) {
+                lutGain = parameters.layerDimmingRatio;
+            } else if (dim) {
+                lutTransform *= mat4::scale(vec4(parameters.layerDimmingRatio,
+                                                 parameters.layerDimmingRatio,
+                                                 parameters.layerDimmingRatio, 1.f));
+            }
+            lut = getOrCreateTonemapLut(inputDataspace, parameters.outputDataSpace, lutTransform,
+                                        parameters.display.maxLuminance,
+                                        parameters.display.currentLuminanceNits,
+                                        parameters.layer.source.buffer.maxLuminanceNits,
+                                        parameters.display.renderIntent);
+        }
+
         auto effect =
                 shaders::LinearEffect{.inputDataspace = inputDataspace,
                                       .outputDataspace = parameters.outputDataSpace,
                                       .undoPremultipliedAlpha = parameters.undoPremultipliedAlpha,
-                                      .fakeOutputDataspace = parameters.fakeOutputDataspace};
+                                      .fakeOutputDataspace = parameters.fakeOutputDataspace,
+                                      .sampleLut = lut != nullptr,
+                                      .specialized = mSpecializeLinearEffects};
 
         auto effectIter = mRuntimeEffects.find(effect);
         sk_sp<SkRuntimeEffect> runtimeEffect = nullptr;
@@ -584,9 +733,11 @@ sk_sp<SkShader> SkiaRenderEngine::createRuntimeEffectShader(
             runtimeEffect = effectIter->second;
         }
 
-        mat4 colorTransform = parameters.layer.colorTransform;
+        if (lut) {
+            return createLinearEffectLutShader(shader, runtimeEffect, std::move(lut), lutGain);
+        }
 
-        if (!usingLocalTonemap) {
+        if (dim) {
             colorTransform *=
                     mat4::scale(vec4(parameters.layerDimmingRatio, parameters.layerDimmingRatio,
                                      parameters.layerDimmingRatio, 1.f));
@@ -602,6 +753,49 @@ sk_sp<SkShader> SkiaRenderEngine::createRuntimeEffectShader(
     return shader;
 }
 
+sk_sp<SkImage> SkiaRenderEngine::getOrCreateTonemapLut(
+        ui::Dataspace inputDataspace, ui::Dataspace outputDataspace, const mat4& colorTransform,
+        float maxDisplayLuminance, float currentDisplayLuminanceNits, float maxLuminance,
+        aidl::android::hardware::graphics::composer3::RenderIntent renderIntent) {
+    SkiaGpuContext* context = getActiveContext();
+    const auto it = std::find_if(mTonemapLuts.begin(), mTonemapLuts.end(),
+                                 [&](const TonemapLut& lut) {
+                                     return lut.inputDataspace == inputDataspace &&
+                                             lut.outputDataspace == outputDataspace &&
+                                             lut.colorTransform == colorTransform &&
+                                             lut.maxDisplayLuminance == maxDisplayLuminance &&
+                                             lut.currentDisplayLuminanceNits ==
+                                             currentDisplayLuminanceNits &&
+                                             lut.maxLuminance == maxLuminance &&
+                                             lut.renderIntent == renderIntent &&
+                                             lut.context == context;
+                                 });
+    if (it != mTonemapLuts.end()) {
+        TonemapLut lut = std::move(*it);
+        mTonemapLuts.erase(it);
+        mTonemapLuts.push_front(std::move(lut));
+        return mTonemapLuts.front().image;
+    }
+
+    SFTRACE_NAME("BuildTonemapLut");
+    mTonemapLutBuilds++;
+    const shaders::LinearEffect effect{.inputDataspace = inputDataspace,
+                                       .outputDataspace = outputDataspace};
+    // A backend that can't upload the LUT caches nullptr, so that the LUT isn't built again.
+    sk_sp<SkImage> image = context->makeTextureImage(makeLinearEffectLutImage(
+            shaders::buildLinearEffectLut(effect, colorTransform, maxDisplayLuminance,
+                                          currentDisplayLuminanceNits, maxLuminance,
+                                          renderIntent)));
+
+    if (mTonemapLuts.size() >= kMaxTonemapLuts) {
+        mTonemapLuts.pop_back();
+    }
+    mTonemapLuts.push_front({inputDataspace, outputDataspace, colorTransform, maxDisplayLuminance,
+                             currentDisplayLuminanceNits, maxLuminance, renderIntent, context,
+                             image});
+    return image;
+}
+
 void SkiaRenderEngine::initCanvas(SkCanvas* canvas, const DisplaySettings& display) {
     if (CC_UNLIKELY(mCapture->isCaptureRunning())) {
         // Record display settings when capture is running.
@@ -710,6 +904,41 @@ private:
     AutoBackendTexture::CleanupManager& mMgr;
 };
 
+sk_sp<SkImage> SkiaRenderEngine::generateBlur(SkiaGpuContext* context,
+                                              const LayerSettings& layer, uint32_t radius,
+                                              const sk_sp<SkImage>& blurInput,
+                                              const SkRect& blurRect) {
+    if (layer.blurBackdropId == 0) {
+        return mBlurFilter->generate(context, radius, blurInput, blurRect);
+    }
+
+    const auto it = std::find_if(mBlurCache.begin(), mBlurCache.end(),
+                                 [&](const CachedBlur& blur) {
+                                     return blur.backdropId == layer.blurBackdropId &&
+                                             blur.radius == radius &&
+                                             blur.blurRect == blurRect &&
+                                             blur.inputInfo == blurInput->imageInfo() &&
+                                             blur.context == context;
+                                 });
+    if (it != mBlurCache.end()) {
+        SFTRACE_NAME("CachedBlur");
+        mBlurCacheHits++;
+        CachedBlur blur = std::move(*it);
+        mBlurCache.erase(it);
+        mBlurCache.push_front(std::move(blur));
+        return mBlurCache.front().image;
+    }
+
+    mBlurCacheMisses++;
+    sk_sp<SkImage> image = mBlurFilter->generate(context, radius, blurInput, blurRect);
+    if (mBlurCache.size() >= kMaxCachedBlurs) {
+        mBlurCache.pop_back();
+    }
+    mBlurCache.push_front({layer.blurBackdropId, radius, blurRect, blurInput->imageInfo(), context,
+                           image});
+    return image;
+}
+
 void SkiaRenderEngine::drawLayersInternal(
         const std::shared_ptr<std::promise<FenceResult>>&& resultPromise,
         const DisplaySettings& display, const std::vector<LayerSettings>& layers,
@@ -740,6 +969,7 @@ void SkiaRenderEngine::drawLayersInternal(
 
     sk_sp<SkSurface> dstSurface = surfaceTextureRef->getOrCreateSurface(display.outputDataspace);
 
+    mSceneCapture.record(display, layers, *buffer);
     SkCanvas* dstCanvas = mCapture->tryCapture(dstSurface.get());
     if (dstCanvas == nullptr) {
         ALOGE("Cannot acquire canvas from Skia.");
@@ -797,7 +1027,18 @@ void SkiaRenderEngine::drawLayersInternal(
         }
     }
 
+    // Only redraw the damaged part of the buffer, unless a blur needs to read the layers beneath
+    // it outside of the damage.
+    const bool drawDamageOnly = display.damage.isValid() &&
+            std::none_of(layers.begin(), layers.end(), [ctModifiesAlpha](const auto& layer) {
+                return layerHasBlur(layer, ctModifiesAlpha);
+            });
+
     AutoSaveRestore surfaceAutoSaveRestore(canvas);
+    if (drawDamageOnly) {
+        SFTRACE_FORMAT("PartialRedraw %dx%d", display.damage.width(), display.damage.height());
+        canvas->clipRect(getSkRect(display.damage));
+    }
     // Clear the entire canvas with a transparent black to prevent ghost images.
     canvas->clear(SK_ColorTRANSPARENT);
     initCanvas(canvas, display);
@@ -867,6 +1108,10 @@ void SkiaRenderEngine::drawLayersInternal(
         const auto [bounds, roundRectClip] =
                 getBoundsAndClip(layer.geometry.boundaries, layer.geometry.roundedCornersCrop,
                                  layer.geometry.roundedCornersRadius);
+        // Skip layers outside of the damage. Shadows are drawn outside of the layer's bounds.
+        if (drawDamageOnly && layer.shadow.length <= 0 && canvas->quickReject(bounds.rect())) {
+            continue;
+        }
         if (mBlurFilter && layerHasBlur(layer, ctModifiesAlpha)) {
             std::unordered_map<uint32_t, sk_sp<SkImage>> cachedBlurs;
 
@@ -901,8 +1146,8 @@ void SkiaRenderEngine::drawLayersInternal(
             if (blurRect.width() > 0 && blurRect.height() > 0) {
                 if (layer.backgroundBlurRadius > 0) {
                     SFTRACE_NAME("BackgroundBlur");
-                    auto blurredImage = mBlurFilter->generate(context, layer.backgroundBlurRadius,
-                                                              blurInput, blurRect);
+                    auto blurredImage = generateBlur(context, layer, layer.backgroundBlurRadius,
+                                                     blurInput, blurRect);
 
                     cachedBlurs[layer.backgroundBlurRadius] = blurredImage;
 
@@ -915,8 +1160,8 @@ void SkiaRenderEngine::drawLayersInternal(
                     if (cachedBlurs[region.blurRadius] == nullptr) {
                         SFTRACE_NAME("BlurRegion");
                         cachedBlurs[region.blurRadius] =
-                                mBlurFilter->generate(context, region.blurRadius, blurInput,
-                                                      blurRect);
+                                generateBlur(context, layer, region.blurRadius, blurInput,
+                                             blurRect);
                     }
 
                     mBlurFilter->drawBlurRegion(canvas, getBlurRRect(region), region.blurRadius,
@@ -948,7 +1193,7 @@ void SkiaRenderEngine::drawLayersInternal(
             // looks more like the intent.
             const auto& rrect =
                     shadowBounds.isRect() && !shadowClip.isEmpty() ? shadowClip : shadowBounds;
-            drawShadow(canvas, rrect, layer.shadow);
+            drawShadow(context, canvas, rrect, layer.shadow);
         }
 
         const float layerDimmingRatio = layer.whitePointNits <= 0.f
@@ -1209,27 +1454,33 @@ void SkiaRenderEngine::drawGainmapInternal(
         const std::shared_ptr<ExternalTexture>& sdr, base::borrowed_fd&& sdrFence,
         const std::shared_ptr<ExternalTexture>& hdr, base::borrowed_fd&& hdrFence,
         float hdrSdrRatio, ui::Dataspace dataspace,
-        const std::shared_ptr<ExternalTexture>& gainmap) {
+        const std::shared_ptr<ExternalTexture>& gainmap, const Rect& region) {
+    SFTRACE_FORMAT("%s %dx%d", __func__, region.width(), region.height());
     std::lock_guard<std::mutex> lock(mRenderingMutex);
     auto context = getActiveContext();
     auto surfaceTextureRef = getOrCreateBackendTexture(gainmap->getBuffer(), true);
     sk_sp<SkSurface> dstSurface =
             surfaceTextureRef->getOrCreateSurface(ui::Dataspace::V0_SRGB_LINEAR);
 
+    // Maps gainmap pixels to SDR and HDR pixels, for a gainmap that is smaller than its inputs.
+    const SkMatrix gainmapToInput =
+            SkMatrix::Scale(static_cast<float>(sdr->getWidth()) / gainmap->getWidth(),
+                            static_cast<float>(sdr->getHeight()) / gainmap->getHeight());
+
     waitFence(context, sdrFence);
     const auto sdrTextureRef = getOrCreateBackendTexture(sdr->getBuffer(), false);
     const auto sdrImage = sdrTextureRef->makeImage(dataspace, kPremul_SkAlphaType);
     const auto sdrShader =
             sdrImage->makeShader(SkTileMode::kClamp, SkTileMode::kClamp,
                                  SkSamplingOptions({SkFilterMode::kLinear, SkMipmapMode::kNone}),
-                                 nullptr);
+                                 &gainmapToInput);
     waitFence(context, hdrFence);
     const auto hdrTextureRef = getOrCreateBackendTexture(hdr->getBuffer(), false);
     const auto hdrImage = hdrTextureRef->makeImage(dataspace, kPremul_SkAlphaType);
     const auto hdrShader =
             hdrImage->makeShader(SkTileMode::kClamp, SkTileMode::kClamp,
                                  SkSamplingOptions({SkFilterMode::kLinear, SkMipmapMode::kNone}),
-                                 nullptr);
+                                 &gainmapToInput);
 
     static GainmapFactory kGainmapFactory;
     const auto gainmapShader = kGainmapFactory.createSkShader(sdrShader, hdrShader, hdrSdrRatio);
@@ -1238,7 +1489,7 @@ void SkiaRenderEngine::drawGainmapInternal(
     SkPaint paint;
     paint.setShader(gainmapShader);
     paint.setBlendMode(SkBlendMode::kSrc);
-    canvas->drawPaint(paint);
+    canvas->drawRect(getSkRect(region), paint);
 
     auto drawFence = sp<Fence>::make(flushAndSubmit(context, dstSurface));
     trace(drawFence);
@@ -1253,18 +1504,129 @@ size_t SkiaRenderEngine::getMaxViewportDims() const {
     return mContext->getMaxRenderTargetSize();
 }
 
-void SkiaRenderEngine::drawShadow(SkCanvas* canvas,
-                                  const SkRRect& casterRRect,
-                                  const ShadowSettings& settings) {
-    SFTRACE_CALL();
+static bool isWithinTolerance(float cached, float value, float tolerance) {
+    return std::abs(value - cached) <= tolerance * std::max(std::abs(cached), 1.0f);
+}
+
+// Whether the shadow of a caster can be drawn by scaling the shadow of a cached one. The shadow
+// is blurred, so being off by a fraction of its size is not visible.
+static bool shadowCasterMatches(const SkRRect& cached, const SkRRect& caster, float tolerance) {
+    const SkRect& cachedRect = cached.rect();
+    const SkRect& rect = caster.rect();
+    if (!isWithinTolerance(cachedRect.width(), rect.width(), tolerance) ||
+        !isWithinTolerance(cachedRect.height(), rect.height(), tolerance) ||
+        std::abs(rect.centerX() - cachedRect.centerX()) > tolerance * cachedRect.width() ||
+        std::abs(rect.centerY() - cachedRect.centerY()) > tolerance * cachedRect.height()) {
+        return false;
+    }
+    for (const auto corner : {SkRRect::kUpperLeft_Corner, SkRRect::kUpperRight_Corner,
+                              SkRRect::kLowerRight_Corner, SkRRect::kLowerLeft_Corner}) {
+        if (!isWithinTolerance(cached.radii(corner).fX, caster.radii(corner).fX, tolerance) ||
+            !isWithinTolerance(cached.radii(corner).fY, caster.radii(corner).fY, tolerance)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether the settings cast the same shadow, ignoring the bounds, which are replaced by the caster.
+static bool shadowSettingsMatch(const ShadowSettings& lhs, const ShadowSettings& rhs) {
+    return lhs.ambientColor == rhs.ambientColor && lhs.spotColor == rhs.spotColor &&
+            lhs.lightPos == rhs.lightPos && lhs.lightRadius == rhs.lightRadius &&
+            lhs.length == rhs.length && lhs.casterIsTranslucent == rhs.casterIsTranslucent;
+}
+
+static void drawShadowWithSkia(SkCanvas* canvas, const SkRRect& casterRRect,
+                               const ShadowSettings& settings, const SkPoint3& lightPos) {
     const float casterZ = settings.length / 2.0f;
     const auto flags =
             settings.casterIsTranslucent ? kTransparentOccluder_ShadowFlag : kNone_ShadowFlag;
 
     SkShadowUtils::DrawShadow(canvas, SkPath::RRect(casterRRect), SkPoint3::Make(0, 0, casterZ),
-                              getSkPoint3(settings.lightPos), settings.lightRadius,
-                              getSkColor(settings.ambientColor), getSkColor(settings.spotColor),
-                              flags);
+                              lightPos, settings.lightRadius, getSkColor(settings.ambientColor),
+                              getSkColor(settings.spotColor), flags);
+}
+
+const SkiaRenderEngine::CachedShadow* SkiaRenderEngine::getOrCreateShadow(
+        SkiaGpuContext* context, const sk_sp<SkColorSpace>& colorSpace,
+        const SkRRect& casterRRect, const ShadowSettings& settings) {
+    const auto it = std::find_if(mShadowCache.begin(), mShadowCache.end(),
+                                 [&](const CachedShadow& shadow) {
+                                     return shadow.context == context &&
+                                             SkColorSpace::Equals(shadow.image->colorSpace(),
+                                                                  colorSpace.get()) &&
+                                             shadowSettingsMatch(shadow.settings, settings) &&
+                                             shadowCasterMatches(shadow.casterRRect, casterRRect,
+                                                                 kShadowScaleTolerance);
+                                 });
+    if (it != mShadowCache.end()) {
+        mShadowCacheHits++;
+        mShadowCache.splice(mShadowCache.begin(), mShadowCache, it);
+        return &mShadowCache.front();
+    }
+
+    mShadowCacheMisses++;
+    const SkPoint3 lightPos = getSkPoint3(settings.lightPos);
+    const auto flags =
+            settings.casterIsTranslucent ? kTransparentOccluder_ShadowFlag : kNone_ShadowFlag;
+    SkRect bounds;
+    if (!SkShadowUtils::GetLocalBounds(SkMatrix::I(), SkPath::RRect(casterRRect),
+                                       SkPoint3::Make(0, 0, settings.length / 2.0f), lightPos,
+                                       settings.lightRadius, flags, &bounds)) {
+        return nullptr;
+    }
+    const SkIRect imageBounds = bounds.roundOut();
+    const size_t bytes = static_cast<size_t>(imageBounds.width()) *
+            static_cast<size_t>(imageBounds.height()) * 4;
+    if (imageBounds.isEmpty() || bytes > mShadowCacheBudgetBytes) {
+        return nullptr;
+    }
+
+    SFTRACE_NAME("rasterizeShadow");
+    sk_sp<SkSurface> surface = context->createRenderTarget(
+            SkImageInfo::MakeN32Premul(imageBounds.width(), imageBounds.height(), colorSpace));
+    if (!surface) {
+        return nullptr;
+    }
+    SkCanvas* shadowCanvas = surface->getCanvas();
+    shadowCanvas->clear(SK_ColorTRANSPARENT);
+    shadowCanvas->translate(-imageBounds.fLeft, -imageBounds.fTop);
+    // The light is in device space, and does not follow the canvas matrix.
+    drawShadowWithSkia(shadowCanvas, casterRRect, settings,
+                       SkPoint3::Make(lightPos.fX - imageBounds.fLeft,
+                                      lightPos.fY - imageBounds.fTop, lightPos.fZ));
+
+    mShadowCache.push_front({casterRRect, settings, context, SkRect::Make(imageBounds),
+                             surface->makeImageSnapshot(), bytes});
+    mShadowCacheBytes += bytes;
+    // Never evict the shadow that was just added, like the texture cache.
+    while (mShadowCacheBytes > mShadowCacheBudgetBytes && mShadowCache.size() > 1) {
+        mShadowCacheBytes -= mShadowCache.back().bytes;
+        mShadowCache.pop_back();
+    }
+    return &mShadowCache.front();
+}
+
+void SkiaRenderEngine::drawShadow(SkiaGpuContext* context, SkCanvas* canvas,
+                                  const SkRRect& casterRRect, const ShadowSettings& settings) {
+    SFTRACE_CALL();
+    SkRRect deviceRRect;
+    const CachedShadow* shadow = mShadowCacheBudgetBytes > 0 &&
+                    casterRRect.transform(canvas->getTotalMatrix(), &deviceRRect)
+            ? getOrCreateShadow(context, canvas->imageInfo().refColorSpace(), deviceRRect, settings)
+            : nullptr;
+    if (!shadow) {
+        drawShadowWithSkia(canvas, casterRRect, settings, getSkPoint3(settings.lightPos));
+        return;
+    }
+
+    // Stretch the cached shadow to the caster, which may be slightly off from the cached one.
+    const SkRect dst = SkMatrix::RectToRect(shadow->casterRRect.rect(), deviceRRect.rect())
+                               .mapRect(shadow->bounds);
+    canvas->save();
+    canvas->resetMatrix();
+    canvas->drawImageRect(shadow->image, dst, SkSamplingOptions(SkFilterMode::kLinear));
+    canvas->restore();
 }
 
 void SkiaRenderEngine::onActiveDisplaySizeChanged(ui::Size size) {
@@ -1298,6 +1660,10 @@ void SkiaRenderEngine::dump(std::string& result) {
     StringAppendF(&result, "RenderEngine is in protected context: %d\n", mInProtectedContext);
     StringAppendF(&result, "RenderEngine shaders cached since last dump/primeCache: %d\n",
                   mSkSLCacheMonitor.shadersCachedSinceLastCall());
+    if (mPersistentShaderCache) {
+        StringAppendF(&result, "RenderEngine persistent shader cache: %zu shaders\n",
+                      mPersistentShaderCache->size());
+    }
 
     std::vector<ResourcePair> cpuResourceMap = {
             {"skia/sk_resource_cache/bitmap_", "Bitmaps"},
@@ -1337,14 +1703,51 @@ void SkiaRenderEngine::dump(std::string& result) {
         }
         StringAppendF(&result, "RenderEngine AHB/BackendTexture cache size: %zu\n",
                       mTextureCache.size());
-        StringAppendF(&result, "Dumping buffer ids...\n");
-        // TODO(178539829): It would be nice to know which layer these are coming from and what
-        // the texture sizes are.
-        for (const auto& [id, unused] : mTextureCache) {
-            StringAppendF(&result, "- 0x%" PRIx64 "\n", id);
+        StringAppendF(&result, "RenderEngine AHB/BackendTexture cache bytes: %zu (budget: %zu)\n",
+                      mTextureCacheBytes, mTextureCacheBudgetBytes);
+        const TextureCacheStats& stats = mTextureCacheStats;
+        const double meanImportTime = stats.imports == 0
+                ? 0.0
+                : static_cast<double>(stats.totalImportTime) / static_cast<double>(stats.imports);
+        StringAppendF(&result,
+                      "RenderEngine texture imports: %" PRIu64 " (mean=%.3fms max=%.3fms) "
+                      "reimports: %" PRIu64 " evictions: %" PRIu64
+                      " ready on first draw: %" PRIu64 "\n",
+                      stats.imports, meanImportTime / 1e6,
+                      static_cast<double>(stats.maxImportTime) / 1e6, stats.reimports,
+                      stats.evictions, stats.readyOnFirstDraw);
+        StringAppendF(&result, "Dumping buffer ids, most recently used first...\n");
+        // TODO(178539829): It would be nice to know which layer these are coming from.
+        for (const GraphicBufferId id : mTextureLru) {
+            StringAppendF(&result, "- 0x%" PRIx64 " - %zu KiB\n", id,
+                          mTextureCache.at(id).bytes / 1024);
+        }
+        StringAppendF(&result, "\n");
+
+        const uint64_t blurLookups = mBlurCacheHits + mBlurCacheMisses;
+        StringAppendF(&result,
+                      "RenderEngine blur cache: %zu/%zu entries, %" PRIu64 " hits, %" PRIu64
+                      " misses (%.2f%% hit rate)\n",
+                      mBlurCache.size(), kMaxCachedBlurs, mBlurCacheHits, mBlurCacheMisses,
+                      blurLookups ? 100.0 * static_cast<double>(mBlurCacheHits) /
+                                      static_cast<double>(blurLookups)
+                                  : 0.0);
+        if (mMouriMap) {
+            mMouriMap->dump(result);
         }
         StringAppendF(&result, "\n");
 
+        const uint64_t shadowLookups = mShadowCacheHits + mShadowCacheMisses;
+        StringAppendF(&result,
+                      "RenderEngine shadow cache: %zu shadows, %zu/%zu KiB, %" PRIu64
+                      " hits, %" PRIu64 " misses (%.2f%% hit rate)\n",
+                      mShadowCache.size(), mShadowCacheBytes / 1024,
+                      mShadowCacheBudgetBytes / 1024, mShadowCacheHits, mShadowCacheMisses,
+                      shadowLookups ? 100.0 * static_cast<double>(mShadowCacheHits) /
+                                      static_cast<double>(shadowLookups)
+                                    : 0.0);
+        StringAppendF(&result, "\n");
+
         SkiaMemoryReporter gpuProtectedReporter(gpuResourceMap, true);
         if (mProtectedContext) {
             mProtectedContext->dumpMemoryStatistics(&gpuProtectedReporter);
@@ -1356,6 +1759,10 @@ void SkiaRenderEngine::dump(std::string& result) {
         gpuProtectedReporter.logOutput(result, true);
 
         StringAppendF(&result, "\n");
+        StringAppendF(&result, "RenderEngine tone mapping LUTs: %s, %zu/%zu cached, %" PRIu64
+                      " built\n",
+                      mUseTonemapLut ? "enabled" : "disabled", mTonemapLuts.size(),
+                      kMaxTonemapLuts, mTonemapLutBuilds);
         StringAppendF(&result, "RenderEngine runtime effects: %zu\n", mRuntimeEffects.size());
         for (const auto& [linearEffect, unused] : mRuntimeEffects) {
             StringAppendF(&result, "- inputDataspace: %s\n",
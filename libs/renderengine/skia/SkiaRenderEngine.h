@@ -27,18 +27,24 @@
 #include <renderengine/ExternalTexture.h>
 #include <renderengine/RenderEngine.h>
 #include <sys/types.h>
+#include <utils/Timers.h>
 
+#include <deque>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
 
 #include "AutoBackendTexture.h"
+#include "PersistentShaderCache.h"
 #include "android-base/macros.h"
 #include "compat/SkiaGpuContext.h"
+#include "debug/SceneCapture.h"
 #include "debug/SkiaCapture.h"
 #include "filters/BlurFilter.h"
 #include "filters/EdgeExtensionShaderFactory.h"
 #include "filters/LinearEffect.h"
+#include "filters/MouriMap.h"
 #include "filters/StretchShaderFactory.h"
 
 class SkData;
@@ -68,7 +74,8 @@ public:
         return mBlurFilter != nullptr;
     }
     void onActiveDisplaySizeChanged(ui::Size size) override final;
-    int reportShadersCompiled();
+    int reportShadersCompiled() override;
+    bool specializesLinearEffects() const { return mSpecializeLinearEffects; }
 
     virtual void setEnableTracing(bool tracingEnabled) override final;
 
@@ -101,7 +108,7 @@ protected:
     bool isProtected() const { return mInProtectedContext; }
 
     // Implements PersistentCache as a way to monitor what SkSL shaders Skia has
-    // cached.
+    // cached, and records them to a PersistentShaderCache if there is one.
     class SkSLCacheMonitor : public GrContextOptions::PersistentCache {
     public:
         SkSLCacheMonitor() = default;
@@ -119,12 +126,18 @@ protected:
 
         int totalShadersCompiled() const { return mTotalShadersCompiled; }
 
+        void setPersistentShaderCache(PersistentShaderCache* cache) {
+            mPersistentShaderCache = cache;
+        }
+
     private:
+        PersistentShaderCache* mPersistentShaderCache = nullptr;
         int mShadersCachedSinceLastCall = 0;
         int mTotalShadersCompiled = 0;
     };
 
     SkSLCacheMonitor mSkSLCacheMonitor;
+    PersistentShaderCache* const mPersistentShaderCache;
 
 private:
     void mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer,
@@ -132,11 +145,15 @@ private:
     void unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer) override final;
     bool canSkipPostRenderCleanup() const override final;
 
+    // Precompiles the shaders recorded by mPersistentShaderCache. Returns false if none were
+    // compiled.
+    bool primeRecordedShaders();
+
     std::shared_ptr<AutoBackendTexture::LocalRef> getOrCreateBackendTexture(
             const sp<GraphicBuffer>& buffer, bool isOutputBuffer) REQUIRES(mRenderingMutex);
     void initCanvas(SkCanvas* canvas, const DisplaySettings& display);
-    void drawShadow(SkCanvas* canvas, const SkRRect& casterRRect,
-                    const ShadowSettings& shadowSettings);
+    void drawShadow(SkiaGpuContext* context, SkCanvas* canvas, const SkRRect& casterRRect,
+                    const ShadowSettings& shadowSettings) REQUIRES(mRenderingMutex);
     void drawLayersInternal(const std::shared_ptr<std::promise<FenceResult>>&& resultPromise,
                             const DisplaySettings& display,
                             const std::vector<LayerSettings>& layers,
@@ -148,7 +165,8 @@ private:
                              const std::shared_ptr<ExternalTexture>& hdr,
                              base::borrowed_fd&& hdrFence, float hdrSdrRatio,
                              ui::Dataspace dataspace,
-                             const std::shared_ptr<ExternalTexture>& gainmap) override final;
+                             const std::shared_ptr<ExternalTexture>& gainmap,
+                             const Rect& region) override final;
 
     void dump(std::string& result) override final;
 
@@ -165,7 +183,8 @@ private:
         const ui::Dataspace fakeOutputDataspace;
         const SkRect& imageBounds;
     };
-    sk_sp<SkShader> createRuntimeEffectShader(const RuntimeEffectShaderParameters&);
+    sk_sp<SkShader> createRuntimeEffectShader(const RuntimeEffectShaderParameters&)
+            REQUIRES(mRenderingMutex);
 
     const PixelFormat mDefaultPixelFormat;
 
@@ -176,10 +195,83 @@ private:
     // Number of external holders of ExternalTexture references, per GraphicBuffer ID.
     std::unordered_map<GraphicBufferId, int32_t> mGraphicBufferExternalRefs
             GUARDED_BY(mRenderingMutex);
-    std::unordered_map<GraphicBufferId, std::shared_ptr<AutoBackendTexture::LocalRef>> mTextureCache
-            GUARDED_BY(mRenderingMutex);
+
+    struct CachedTexture {
+        std::shared_ptr<AutoBackendTexture::LocalRef> texture;
+        // An estimate of the GPU memory the texture uses.
+        size_t bytes;
+        std::list<GraphicBufferId>::iterator lruPosition;
+        // False until the texture is first drawn.
+        bool drawn = false;
+    };
+
+    struct TextureCacheStats {
+        uint64_t imports = 0;
+        nsecs_t totalImportTime = 0;
+        nsecs_t maxImportTime = 0;
+        // Imports for buffers that were still mapped, after their texture was evicted or when it
+        // was not imported because they were mapped in the protected context.
+        uint64_t reimports = 0;
+        uint64_t evictions = 0;
+        // First draws of buffers whose texture was imported when they were mapped, which would
+        // otherwise have imported it during the draw.
+        uint64_t readyOnFirstDraw = 0;
+    };
+
+    // Imports a texture for the buffer, and records how long that took.
+    std::shared_ptr<AutoBackendTexture::LocalRef> importTexture(const sp<GraphicBuffer>& buffer,
+                                                                bool isRenderable)
+            REQUIRES(mRenderingMutex);
+    // Adds a texture as the most recently used one, and evicts the least recently used textures
+    // until the cache is back under budget.
+    void cacheTexture(const sp<GraphicBuffer>& buffer,
+                      std::shared_ptr<AutoBackendTexture::LocalRef> texture)
+            REQUIRES(mRenderingMutex);
+    void eraseCachedTexture(GraphicBufferId id) REQUIRES(mRenderingMutex);
+
+    // Textures for mapped buffers. A texture may be evicted while its buffer is still mapped, in
+    // which case it is imported again the next time the buffer is drawn.
+    std::unordered_map<GraphicBufferId, CachedTexture> mTextureCache GUARDED_BY(mRenderingMutex);
+    // The IDs in mTextureCache, most recently used first.
+    std::list<GraphicBufferId> mTextureLru GUARDED_BY(mRenderingMutex);
+    size_t mTextureCacheBytes GUARDED_BY(mRenderingMutex) = 0;
+    // No budget if 0.
+    const size_t mTextureCacheBudgetBytes;
+    TextureCacheStats mTextureCacheStats GUARDED_BY(mRenderingMutex);
     std::unordered_map<shaders::LinearEffect, sk_sp<SkRuntimeEffect>, shaders::LinearEffectHasher>
             mRuntimeEffects;
+
+    // The parameters a tone mapping LUT was built for.
+    struct TonemapLut {
+        ui::Dataspace inputDataspace;
+        ui::Dataspace outputDataspace;
+        mat4 colorTransform;
+        float maxDisplayLuminance;
+        float currentDisplayLuminanceNits;
+        float maxLuminance;
+        aidl::android::hardware::graphics::composer3::RenderIntent renderIntent;
+        const SkiaGpuContext* context;
+        sk_sp<SkImage> image;
+    };
+
+    // Returns the LUT for the parameters, building and uploading it if none of the recently used
+    // LUTs match. Returns nullptr if the backend can't upload the LUT.
+    sk_sp<SkImage> getOrCreateTonemapLut(
+            ui::Dataspace inputDataspace, ui::Dataspace outputDataspace,
+            const mat4& colorTransform, float maxDisplayLuminance,
+            float currentDisplayLuminanceNits, float maxLuminance,
+            aidl::android::hardware::graphics::composer3::RenderIntent renderIntent);
+
+    // Whether HDR layers are tone mapped with a LUT, on backends that can upload it.
+    const bool mUseTonemapLut;
+    static constexpr size_t kMaxTonemapLuts = 4;
+    // Most recently used first.
+    std::deque<TonemapLut> mTonemapLuts;
+    uint64_t mTonemapLutBuilds = 0;
+
+    // Whether the LinearEffects of layers are specialized for their dataspaces.
+    const bool mSpecializeLinearEffects;
+
     AutoBackendTexture::CleanupManager mTextureCleanupMgr GUARDED_BY(mRenderingMutex);
 
     StretchShaderFactory mStretchShaderFactory;
@@ -188,8 +280,64 @@ private:
     sp<Fence> mLastDrawFence;
     BlurFilter* mBlurFilter = nullptr;
 
+    struct CachedBlur {
+        uint64_t backdropId;
+        uint32_t radius;
+        SkRect blurRect;
+        SkImageInfo inputInfo;
+        const SkiaGpuContext* context;
+        sk_sp<SkImage> image;
+    };
+
+    // Blurs blurInput, reusing the blur generated for an earlier frame if the layer's backdrop
+    // has not changed since.
+    sk_sp<SkImage> generateBlur(SkiaGpuContext* context, const LayerSettings& layer,
+                                uint32_t radius, const sk_sp<SkImage>& blurInput,
+                                const SkRect& blurRect) REQUIRES(mRenderingMutex);
+
+    static constexpr size_t kMaxCachedBlurs = 8;
+    // Blurs of layers with a blurBackdropId, most recently used first.
+    std::deque<CachedBlur> mBlurCache GUARDED_BY(mRenderingMutex);
+    uint64_t mBlurCacheHits GUARDED_BY(mRenderingMutex) = 0;
+    uint64_t mBlurCacheMisses GUARDED_BY(mRenderingMutex) = 0;
+
+    // Local tone mapper, which keeps the statistics of the last few HDR buffers it mapped.
+    // Created on first use, as most devices never map locally.
+    std::unique_ptr<MouriMap> mMouriMap GUARDED_BY(mRenderingMutex);
+
+    struct CachedShadow {
+        // The caster in device space.
+        SkRRect casterRRect;
+        ShadowSettings settings;
+        const SkiaGpuContext* context;
+        // Where image was drawn in device space.
+        SkRect bounds;
+        sk_sp<SkImage> image;
+        size_t bytes;
+    };
+
+    // Returns the shadow of the caster, rasterizing it in the color space if none of the cached
+    // shadows match. Cached shadows match casters that are within kShadowScaleTolerance of their
+    // size and position. Returns nullptr if the shadow can't be cached.
+    const CachedShadow* getOrCreateShadow(SkiaGpuContext* context,
+                                          const sk_sp<SkColorSpace>& colorSpace,
+                                          const SkRRect& casterRRect,
+                                          const ShadowSettings& settings)
+            REQUIRES(mRenderingMutex);
+
+    static constexpr float kShadowScaleTolerance = 0.02f;
+    // Shadows are not cached if 0.
+    const size_t mShadowCacheBudgetBytes;
+    // Most recently used first.
+    std::list<CachedShadow> mShadowCache GUARDED_BY(mRenderingMutex);
+    size_t mShadowCacheBytes GUARDED_BY(mRenderingMutex) = 0;
+    uint64_t mShadowCacheHits GUARDED_BY(mRenderingMutex) = 0;
+    uint64_t mShadowCacheMisses GUARDED_BY(mRenderingMutex) = 0;
+
     // Object to capture commands send to Skia.
     std::unique_ptr<SkiaCapture> mCapture;
+    // Records the layers drawn, for replaying in RenderEngineBench.
+    SceneCapture mSceneCapture GUARDED_BY(mRenderingMutex);
 
     // Mutex guarding rendering operations, so that internal state related to
     // rendering that is potentially modified by multiple threads is guaranteed thread-safe.
@@ -35,6 +35,7 @@
 #include <common/trace.h>
 #include <sync/sync.h>
 
+#include <cinttypes>
 #include <memory>
 #include <string>
 
@@ -178,6 +179,10 @@ void SkiaVkRenderEngine::appendBackendSpecificInfoToDump(std::string& result) {
         return;
     }
 
+    StringAppendF(&result, "\n Exportable semaphores: %zu created, %" PRIu64 " reused\n",
+                  sVulkanInterface.getExportableSemaphoreCount(),
+                  sVulkanInterface.getReusedExportableSemaphoreCount());
+
     StringAppendF(&result, "\n Instance extensions:\n");
     for (const auto& name : sVulkanInterface.getInstanceExtensionNames()) {
         StringAppendF(&result, "\n %s\n", name.c_str());
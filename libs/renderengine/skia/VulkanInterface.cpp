@@ -54,6 +54,14 @@ VulkanBackendContext VulkanInterface::getGraphiteBackendContext() {
 };
 
 VkSemaphore VulkanInterface::createExportableSemaphore() {
+    std::lock_guard lock(mSemaphoreMutex);
+    if (!mFreeExportableSemaphores.empty()) {
+        VkSemaphore semaphore = mFreeExportableSemaphores.back();
+        mFreeExportableSemaphores.pop_back();
+        mExportableSemaphoresReused++;
+        return semaphore;
+    }
+
     VkExportSemaphoreCreateInfo exportInfo;
     exportInfo.sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO;
     exportInfo.pNext = nullptr;
@@ -71,6 +79,8 @@ VkSemaphore VulkanInterface::createExportableSemaphore() {
         return VK_NULL_HANDLE;
     }
 
+    mExportableSemaphores.insert(semaphore);
+    mExportableSemaphoresCreated++;
     return semaphore;
 }
 
@@ -117,15 +127,39 @@ int VulkanInterface::exportSemaphoreSyncFd(VkSemaphore semaphore) {
     VkResult err = mFuncs.vkGetSemaphoreFdKHR(mDevice, &getFdInfo, &res);
     if (VK_SUCCESS != err) {
         ALOGE("%s: failed to export semaphore, err: %d", __func__, err);
+        // The semaphore may still be signaled, so it must not be reused.
+        std::lock_guard lock(mSemaphoreMutex);
+        mExportableSemaphores.erase(semaphore);
         return -1;
     }
     return res;
 }
 
 void VulkanInterface::destroySemaphore(VkSemaphore semaphore) {
+    {
+        std::lock_guard lock(mSemaphoreMutex);
+        const auto it = mExportableSemaphores.find(semaphore);
+        if (it != mExportableSemaphores.end()) {
+            if (mFreeExportableSemaphores.size() < kMaxFreeExportableSemaphores) {
+                mFreeExportableSemaphores.push_back(semaphore);
+                return;
+            }
+            mExportableSemaphores.erase(it);
+        }
+    }
     mFuncs.vkDestroySemaphore(mDevice, semaphore, nullptr);
 }
 
+size_t VulkanInterface::getExportableSemaphoreCount() const {
+    std::lock_guard lock(mSemaphoreMutex);
+    return mExportableSemaphoresCreated;
+}
+
+uint64_t VulkanInterface::getReusedExportableSemaphoreCount() const {
+    std::lock_guard lock(mSemaphoreMutex);
+    return mExportableSemaphoresReused;
+}
+
 void VulkanInterface::onVkDeviceFault(void* callbackContext, const std::string& description,
                                       const std::vector<VkDeviceFaultAddressInfoEXT>& addressInfos,
                                       const std::vector<VkDeviceFaultVendorInfoEXT>& vendorInfos,
@@ -558,6 +592,16 @@ void VulkanInterface::teardown() {
     // Core resources that must be destroyed using Vulkan functions.
     if (mDevice != VK_NULL_HANDLE) {
         mFuncs.vkDeviceWaitIdle(mDevice);
+        {
+            std::lock_guard lock(mSemaphoreMutex);
+            for (VkSemaphore semaphore : mFreeExportableSemaphores) {
+                mFuncs.vkDestroySemaphore(mDevice, semaphore, nullptr);
+            }
+            mFreeExportableSemaphores.clear();
+            mExportableSemaphores.clear();
+            mExportableSemaphoresCreated = 0;
+            mExportableSemaphoresReused = 0;
+        }
         mFuncs.vkDestroyDevice(mDevice, nullptr);
         mDevice = VK_NULL_HANDLE;
     }
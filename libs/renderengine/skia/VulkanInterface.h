@@ -20,8 +20,13 @@
 #include <include/gpu/vk/VulkanExtensions.h>
 #include <include/gpu/vk/VulkanTypes.h>
 
+#include <android-base/thread_annotations.h>
 #include <vulkan/vulkan.h>
 
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
 using namespace skgpu;
 
 namespace android {
@@ -47,11 +52,17 @@ public:
     // TODO(b/309785258) Combine these into one now that they are the same implementation.
     VulkanBackendContext getGaneshBackendContext();
     VulkanBackendContext getGraphiteBackendContext();
+    // Exportable semaphores are recycled by destroySemaphore once their sync fd has been exported,
+    // since exporting a sync fd unsignals the semaphore, so most frames don't create one.
     VkSemaphore createExportableSemaphore();
     VkSemaphore importSemaphoreFromSyncFd(int syncFd);
     int exportSemaphoreSyncFd(VkSemaphore semaphore);
     void destroySemaphore(VkSemaphore semaphore);
 
+    // The number of exportable semaphores created, and how many times one was reused instead.
+    size_t getExportableSemaphoreCount() const;
+    uint64_t getReusedExportableSemaphoreCount() const;
+
     bool isInitialized() const { return mInitialized; }
     bool isRealtimePriority() const { return mIsRealtimePriority; }
     const std::vector<std::string>& getInstanceExtensionNames() { return mInstanceExtensionNames; }
@@ -69,6 +80,8 @@ private:
         PFN_vkDestroyInstance vkDestroyInstance = nullptr;
     };
 
+    static constexpr size_t kMaxFreeExportableSemaphores = 8;
+
     static void onVkDeviceFault(void* callbackContext, const std::string& description,
                                 const std::vector<VkDeviceFaultAddressInfoEXT>& addressInfos,
                                 const std::vector<VkDeviceFaultVendorInfoEXT>& vendorInfos,
@@ -96,6 +109,15 @@ private:
 
     std::vector<std::string> mInstanceExtensionNames;
     std::vector<std::string> mDeviceExtensionNames;
+
+    mutable std::mutex mSemaphoreMutex;
+    // All exportable semaphores that are alive, so destroySemaphore can tell them apart from
+    // imported ones.
+    std::unordered_set<VkSemaphore> mExportableSemaphores GUARDED_BY(mSemaphoreMutex);
+    // Exportable semaphores that are unsignaled and unused.
+    std::vector<VkSemaphore> mFreeExportableSemaphores GUARDED_BY(mSemaphoreMutex);
+    size_t mExportableSemaphoresCreated GUARDED_BY(mSemaphoreMutex) = 0;
+    uint64_t mExportableSemaphoresReused GUARDED_BY(mSemaphoreMutex) = 0;
 };
 
 } // namespace skia
@@ -21,6 +21,7 @@
 #include <include/core/SkTraceMemoryDump.h>
 #include <include/gpu/ganesh/GrDirectContext.h>
 #include <include/gpu/ganesh/GrTypes.h>
+#include <include/gpu/ganesh/SkImageGanesh.h>
 #include <include/gpu/ganesh/SkSurfaceGanesh.h>
 #include <include/gpu/ganesh/gl/GrGLDirectContext.h>
 #include <include/gpu/ganesh/gl/GrGLInterface.h>
@@ -44,6 +45,9 @@ static GrContextOptions ganeshOptions(GrContextOptions::PersistentCache& skSLCac
     options.fDisableDistanceFieldPaths = true;
     options.fReducedShaderVariations = true;
     options.fPersistentCache = &skSLCacheMonitor;
+    // Cache SkSL rather than program binaries, so cached shaders can be precompiled by a later
+    // boot. Drivers still cache the binaries they compile.
+    options.fShaderCacheStrategy = GrContextOptions::ShaderCacheStrategy::kSkSL;
     return options;
 }
 } // namespace
@@ -105,6 +109,14 @@ void GaneshGpuContext::setResourceCacheLimit(size_t maxResourceBytes) {
     mGrContext->setResourceCacheLimit(maxResourceBytes);
 }
 
+bool GaneshGpuContext::precompileShader(const SkData& key, const SkData& data) {
+    return mGrContext->precompileShader(key, data);
+}
+
+sk_sp<SkImage> GaneshGpuContext::makeTextureImage(const sk_sp<SkImage>& image) {
+    return SkImages::TextureFromImage(mGrContext.get(), image);
+}
+
 void GaneshGpuContext::purgeUnlockedScratchResources() {
     mGrContext->purgeUnlockedResources(GrPurgeResourceOptions::kScratchResourcesOnly);
 }
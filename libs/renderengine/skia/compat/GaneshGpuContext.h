@@ -39,6 +39,8 @@ public:
     bool isAbandonedOrDeviceLost() override;
     void setResourceCacheLimit(size_t maxResourceBytes) override;
 
+    bool precompileShader(const SkData& key, const SkData& data) override;
+    sk_sp<SkImage> makeTextureImage(const sk_sp<SkImage>& image) override;
     void purgeUnlockedScratchResources() override;
     void resetContextIfApplicable() override;
 
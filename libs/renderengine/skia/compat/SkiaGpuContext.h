@@ -19,6 +19,8 @@
 #undef LOG_TAG
 #define LOG_TAG "RenderEngine"
 
+#include <include/core/SkData.h>
+#include <include/core/SkImage.h>
 #include <include/core/SkSurface.h>
 #include <include/gpu/ganesh/GrDirectContext.h>
 #include <include/gpu/ganesh/gl/GrGLInterface.h>
@@ -104,6 +106,18 @@ public:
     virtual size_t getMaxTextureSize() const = 0;
     virtual void setResourceCacheLimit(size_t maxResourceBytes) = 0;
 
+    /**
+     * Compiles a shader that a GrContextOptions::PersistentCache stored. Returns false if it could
+     * not be compiled, or if the backend doesn't support precompiling cached shaders.
+     */
+    virtual bool precompileShader(const SkData&, const SkData&) { return false; }
+
+    /**
+     * Uploads a raster image, so that it isn't uploaded again every time it is drawn. Returns
+     * nullptr if it could not be uploaded, or if the backend doesn't support uploading images.
+     */
+    virtual sk_sp<SkImage> makeTextureImage(const sk_sp<SkImage>&) { return nullptr; }
+
     virtual void purgeUnlockedScratchResources() = 0;
     virtual void resetContextIfApplicable() = 0; // No-op outside of GL (&& Ganesh at this point.)
 
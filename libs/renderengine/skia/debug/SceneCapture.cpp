@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SceneCapture.h"
+
+#undef LOG_TAG
+#define LOG_TAG "RenderEngine"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include <android-base/file.h>
+#include <android-base/properties.h>
+#include <android-base/stringprintf.h>
+#include <common/trace.h>
+#include <log/log.h>
+#include <renderengine/RecordedScene.h>
+#include <renderengine/RenderEngine.h>
+#include <sys/stat.h>
+
+#include <chrono>
+
+#include "CommonPool.h"
+
+namespace android {
+namespace renderengine {
+namespace skia {
+
+// Written next to the SKPs recorded by SkiaCapture, so the same setup applies.
+static const std::string CAPTURED_FILE_DIR = "/data/misc/mskps";
+
+void SceneCapture::record(const DisplaySettings& display, const std::vector<LayerSettings>& layers,
+                          const ExternalTexture& output) {
+    if (CC_LIKELY(mFramesRemaining == 0)) {
+        mFramesRemaining = base::GetIntProperty(PROPERTY_DEBUG_RENDERENGINE_CAPTURE_SCENES, 0);
+        if (CC_LIKELY(mFramesRemaining <= 0)) {
+            mFramesRemaining = 0;
+            return;
+        }
+        ALOGD("Recording %d scenes", mFramesRemaining);
+        base::SetProperty(PROPERTY_DEBUG_RENDERENGINE_CAPTURE_FILENAME, "");
+        mScenes = "# RenderEngine scenes\n";
+    }
+
+    SFTRACE_CALL();
+    appendRecordedScene(mScenes, display, layers, output);
+    if (--mFramesRemaining == 0) {
+        writeToFile();
+        // Reset the property so the capture can be restarted by setting it again, without
+        // restarting the process.
+        base::SetProperty(PROPERTY_DEBUG_RENDERENGINE_CAPTURE_SCENES, "0");
+    }
+}
+
+void SceneCapture::writeToFile() {
+    std::string name = base::StringPrintf("%s/re_scenes_%lld.txt", CAPTURED_FILE_DIR.c_str(),
+                                          static_cast<long long>(std::chrono::steady_clock::now()
+                                                                         .time_since_epoch()
+                                                                         .count()));
+    CommonPool::post([scenes = std::move(mScenes), name = std::move(name)] {
+        mkdir(CAPTURED_FILE_DIR.c_str(), 0700);
+        if (!base::WriteStringToFile(scenes, name)) {
+            ALOGE("Failed to save scenes to %s", name.c_str());
+            return;
+        }
+        ALOGD("Scenes saved to %s.", name.c_str());
+        base::SetProperty(PROPERTY_DEBUG_RENDERENGINE_CAPTURE_FILENAME, name);
+    });
+    mScenes.clear();
+}
+
+} // namespace skia
+} // namespace renderengine
+} // namespace android
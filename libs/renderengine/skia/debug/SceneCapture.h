@@ -0,0 +1,51 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <renderengine/DisplaySettings.h>
+#include <renderengine/ExternalTexture.h>
+#include <renderengine/LayerSettings.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace renderengine {
+namespace skia {
+
+/**
+ * Records the LayerSettings drawn by RenderEngine for the number of frames set in
+ * PROPERTY_DEBUG_RENDERENGINE_CAPTURE_SCENES, and writes them to a file that RenderEngineBench can
+ * replay with --scenes. Unlike SkiaCapture, this records what RenderEngine was asked to draw
+ * rather than the Skia calls it made, so the scenes can be replayed against any backend.
+ */
+class SceneCapture {
+public:
+    // Called for every drawLayers. Normally returns after checking the property.
+    void record(const DisplaySettings& display, const std::vector<LayerSettings>& layers,
+                const ExternalTexture& output);
+
+private:
+    void writeToFile();
+
+    int mFramesRemaining = 0;
+    std::string mScenes;
+};
+
+} // namespace skia
+} // namespace renderengine
+} // namespace android
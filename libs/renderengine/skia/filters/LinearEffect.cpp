@@ -18,11 +18,15 @@
 
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <SkImage.h>
+#include <SkPixmap.h>
+#include <SkSamplingOptions.h>
 #include <SkString.h>
 #include <common/trace.h>
 #include <log/log.h>
 #include <shaders/shaders.h>
 
+#include <math/half.h>
 #include <math/mat4.h>
 
 namespace android {
@@ -62,6 +66,41 @@ sk_sp<SkShader> createLinearEffectShader(
     return effectBuilder.makeShader();
 }
 
+sk_sp<SkShader> createLinearEffectLutShader(sk_sp<SkShader> shader,
+                                            sk_sp<SkRuntimeEffect> runtimeEffect,
+                                            sk_sp<SkImage> lut, float gain) {
+    SFTRACE_CALL();
+    SkRuntimeShaderBuilder effectBuilder(runtimeEffect);
+
+    effectBuilder.child("child") = shader;
+    // The LUT holds linear colors, which must not be color managed.
+    effectBuilder.child("in_lut") =
+            lut->makeRawShader(SkTileMode::kClamp, SkTileMode::kClamp,
+                               SkSamplingOptions(SkFilterMode::kLinear));
+    effectBuilder.uniform("in_lutGain") = gain;
+
+    return effectBuilder.makeShader();
+}
+
+sk_sp<SkImage> makeLinearEffectLutImage(const std::vector<vec3>& lut) {
+    SFTRACE_CALL();
+    constexpr int kSize = static_cast<int>(shaders::kLinearEffectLutSize);
+    LOG_ALWAYS_FATAL_IF(lut.size() != static_cast<size_t>(kSize * kSize * kSize),
+                        "Unexpected LUT size %zu", lut.size());
+
+    // Half floats keep the LUT filterable on every GPU, and fit the extended range of the output.
+    std::vector<half4> pixels;
+    pixels.reserve(lut.size());
+    for (const vec3& color : lut) {
+        pixels.emplace_back(color.r, color.g, color.b, 1.f);
+    }
+
+    const SkImageInfo info = SkImageInfo::Make(kSize * kSize, kSize, kRGBA_F16_SkColorType,
+                                               kUnpremul_SkAlphaType);
+    const SkPixmap pixmap(info, pixels.data(), info.minRowBytes());
+    return SkImages::RasterFromPixmapCopy(pixmap);
+}
+
 } // namespace skia
 } // namespace renderengine
 } // namespace android
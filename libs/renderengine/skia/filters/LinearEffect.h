@@ -19,8 +19,10 @@
 #include <math/mat4.h>
 
 #include <optional>
+#include <vector>
 
 #include <shaders/shaders.h>
+#include "SkImage.h"
 #include "SkRuntimeEffect.h"
 #include "SkShader.h"
 #include "ui/GraphicTypes.h"
@@ -49,6 +51,17 @@ sk_sp<SkShader> createLinearEffectShader(
         sk_sp<SkRuntimeEffect> runtimeEffect, const mat4& colorTransform, float maxDisplayLuminance,
         float currentDisplayLuminanceNits, float maxLuminance, AHardwareBuffer* buffer,
         aidl::android::hardware::graphics::composer3::RenderIntent renderIntent);
+
+// Same as createLinearEffectShader, for a runtimeEffect built with LinearEffect::sampleLut. The
+// lut is an image of the colors returned by shaders::buildLinearEffectLut, and its output is
+// multiplied by gain.
+sk_sp<SkShader> createLinearEffectLutShader(sk_sp<SkShader> inputShader,
+                                            sk_sp<SkRuntimeEffect> runtimeEffect,
+                                            sk_sp<SkImage> lut, float gain);
+
+// Makes an image of a LUT returned by shaders::buildLinearEffectLut, in the layout that
+// createLinearEffectLutShader expects.
+sk_sp<SkImage> makeLinearEffectLutImage(const std::vector<vec3>& lut);
 } // namespace skia
 } // namespace renderengine
 } // namespace android
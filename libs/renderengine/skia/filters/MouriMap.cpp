@@ -18,6 +18,11 @@
 #include <SkColorType.h>
 #include <SkPaint.h>
 #include <SkTileMode.h>
+#include <android-base/stringprintf.h>
+#include <common/trace.h>
+
+#include <algorithm>
+#include <cinttypes>
 
 namespace android {
 namespace renderengine {
@@ -31,11 +36,13 @@ sk_sp<SkRuntimeEffect> makeEffect(const SkString& sksl) {
 const SkString kCrosstalkAndChunk16x16(R"(
     uniform shader bitmap;
     uniform float hdrSdrRatio;
+    uniform float stride;
     vec4 main(vec2 xy) {
         float maximum = 0.0;
         for (int y = 0; y < 16; y++) {
             for (int x = 0; x < 16; x++) {
-                float3 linear = toLinearSrgb(bitmap.eval((xy - 0.5) * 16 + 0.5 + vec2(x, y)).rgb) * hdrSdrRatio;
+                float2 sampleXy = (xy - 0.5) * 16 * stride + 0.5 + vec2(x, y) * stride;
+                float3 linear = toLinearSrgb(bitmap.eval(sampleXy).rgb) * hdrSdrRatio;
                 float maxRGB = max(linear.r, max(linear.g, linear.b));
                 maximum = max(maximum, log2(max(maxRGB, 1.0)));
             }
@@ -116,19 +123,70 @@ MouriMap::MouriMap()
         mTonemap(makeEffect(kTonemap)) {}
 
 sk_sp<SkShader> MouriMap::mouriMap(SkiaGpuContext* context, sk_sp<SkShader> input,
-                                   float hdrSdrRatio, float targetHdrSdrRatio) {
-    auto downchunked = downchunk(context, input, hdrSdrRatio);
-    auto localLux = blur(context, downchunked.get());
-    return tonemap(input, localLux.get(), hdrSdrRatio, targetHdrSdrRatio);
+                                   float hdrSdrRatio, float targetHdrSdrRatio, uint64_t bufferId,
+                                   uint64_t frameNumber) {
+    if (bufferId == 0 || frameNumber == 0) {
+        return tonemap(input, localLux(context, input, hdrSdrRatio), hdrSdrRatio,
+                       targetHdrSdrRatio);
+    }
+
+    SkMatrix matrix;
+    const SkImage* image = input->isAImage(&matrix, (SkTileMode*)nullptr);
+    const auto it = std::find_if(mCache.begin(), mCache.end(), [&](const CachedLocalLux& cached) {
+        return cached.bufferId == bufferId && cached.frameNumber == frameNumber &&
+                cached.hdrSdrRatio == hdrSdrRatio && cached.matrix == matrix &&
+                cached.inputInfo == image->imageInfo() && cached.context == context;
+    });
+    if (it != mCache.end()) {
+        SFTRACE_NAME("CachedLocalLux");
+        mCacheHits++;
+        CachedLocalLux cached = std::move(*it);
+        mCache.erase(it);
+        mCache.push_front(std::move(cached));
+    } else {
+        mCacheMisses++;
+        // A buffer only holds one frame at a time, so the local luminance of its older frames
+        // will not be used again.
+        std::erase_if(mCache,
+                      [&](const CachedLocalLux& cached) { return cached.bufferId == bufferId; });
+        if (mCache.size() >= kMaxCachedLocalLux) {
+            mCache.pop_back();
+        }
+        mCache.push_front({bufferId, frameNumber, hdrSdrRatio, matrix, image->imageInfo(), context,
+                           localLux(context, input, hdrSdrRatio)});
+    }
+    return tonemap(input, mCache.front().localLux, hdrSdrRatio, targetHdrSdrRatio);
+}
+
+void MouriMap::dump(std::string& result) const {
+    base::StringAppendF(&result,
+                        "MouriMap local luminance cache: %zu/%zu entries, %" PRIu64
+                        " hits, %" PRIu64 " misses\n",
+                        mCache.size(), kMaxCachedLocalLux, mCacheHits, mCacheMisses);
+}
+
+MouriMap::LocalLux MouriMap::localLux(SkiaGpuContext* context, const sk_sp<SkShader>& input,
+                                      float hdrSdrRatio) const {
+    SFTRACE_CALL();
+    const SkImage* image = input->isAImage((SkMatrix*)nullptr, (SkTileMode*)nullptr);
+    const float inputScale = std::max(1.0f,
+                                      static_cast<float>(std::max(image->width(),
+                                                                  image->height())) /
+                                              kMaxStatisticsDimension);
+    auto downchunked = downchunk(context, input, hdrSdrRatio, inputScale);
+    return {blur(context, downchunked.get()), inputScale};
 }
 
 sk_sp<SkImage> MouriMap::downchunk(SkiaGpuContext* context, sk_sp<SkShader> input,
-                                   float hdrSdrRatio) const {
+                                   float hdrSdrRatio, float inputScale) const {
     SkMatrix matrix;
     SkImage* image = input->isAImage(&matrix, (SkTileMode*)nullptr);
     SkRuntimeShaderBuilder crosstalkAndChunk16x16Builder(mCrosstalkAndChunk16x16);
     crosstalkAndChunk16x16Builder.child("bitmap") = input;
     crosstalkAndChunk16x16Builder.uniform("hdrSdrRatio") = hdrSdrRatio;
+    // Inputs larger than kMaxStatisticsDimension are sampled every inputScale pixels, so that the
+    // cost of the first pass is bounded.
+    crosstalkAndChunk16x16Builder.uniform("stride") = inputScale;
     // TODO: fp16 might be overkill. Most practical surfaces use 8-bit RGB for HDR UI and 10-bit YUV
     // for HDR video. These downsample operations compute log2(max(linear RGB, 1.0)). So we don't
     // care about LDR precision since they all resolve to LDR-max. For appropriately mastered HDR
@@ -140,10 +198,11 @@ sk_sp<SkImage> MouriMap::downchunk(SkiaGpuContext* context, sk_sp<SkShader> inpu
     // to be really conservative we can try to use R16 or even RGBA1010102 to fake an R10 surface,
     // which would cut write bandwidth significantly.
     static constexpr auto kFirstDownscaleAmount = 16;
+    const float firstDownscale = kFirstDownscaleAmount * inputScale;
     sk_sp<SkSurface> firstDownsampledSurface = context->createRenderTarget(
             image->imageInfo()
-                    .makeWH(std::max(1, image->width() / kFirstDownscaleAmount),
-                            std::max(1, image->height() / kFirstDownscaleAmount))
+                    .makeWH(std::max(1, static_cast<int>(image->width() / firstDownscale)),
+                            std::max(1, static_cast<int>(image->height() / firstDownscale)))
                     .makeColorType(kRGBA_F16_SkColorType));
     LOG_ALWAYS_FATAL_IF(!firstDownsampledSurface, "%s: Failed to create surface!", __func__);
     auto firstDownsampledImage =
@@ -168,15 +227,16 @@ sk_sp<SkImage> MouriMap::blur(SkiaGpuContext* context, SkImage* input) const {
     LOG_ALWAYS_FATAL_IF(!blurSurface, "%s: Failed to create surface!", __func__);
     return makeImage(blurSurface.get(), blurBuilder);
 }
-sk_sp<SkShader> MouriMap::tonemap(sk_sp<SkShader> input, SkImage* localLux, float hdrSdrRatio,
-                                  float targetHdrSdrRatio) const {
+sk_sp<SkShader> MouriMap::tonemap(sk_sp<SkShader> input, const LocalLux& localLux,
+                                  float hdrSdrRatio, float targetHdrSdrRatio) const {
     static constexpr float kScaleFactor = 1.0f / 128.0f;
     SkRuntimeShaderBuilder tonemapBuilder(mTonemap);
     tonemapBuilder.child("image") = input;
     tonemapBuilder.child("lux") =
-            localLux->makeRawShader(SkTileMode::kClamp, SkTileMode::kClamp,
-                                    SkSamplingOptions(SkFilterMode::kLinear, SkMipmapMode::kNone));
-    tonemapBuilder.uniform("scaleFactor") = kScaleFactor;
+            localLux.image->makeRawShader(SkTileMode::kClamp, SkTileMode::kClamp,
+                                          SkSamplingOptions(SkFilterMode::kLinear,
+                                                            SkMipmapMode::kNone));
+    tonemapBuilder.uniform("scaleFactor") = kScaleFactor / localLux.inputScale;
     tonemapBuilder.uniform("hdrSdrRatio") = hdrSdrRatio;
     tonemapBuilder.uniform("targetHdrSdrRatio") = targetHdrSdrRatio;
     return tonemapBuilder.makeShader();
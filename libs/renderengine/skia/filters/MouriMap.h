@@ -17,6 +17,10 @@
 #include <SkImage.h>
 #include <SkRuntimeEffect.h>
 #include <SkShader.h>
+
+#include <deque>
+#include <string>
+
 #include "../compat/SkiaGpuContext.h"
 namespace android {
 namespace renderengine {
@@ -57,6 +61,10 @@ namespace skia {
  * typically not suitable to be ran "frequently", at high refresh rates (e.g., 120hz). However,
  * MouriMap is sufficiently fast enough for infrequent composition where preserving SDR detail is
  * most important, such as for screenshots.
+ *
+ * To bound that cost, the local luminance of inputs larger than kMaxStatisticsDimension is
+ * computed from a subset of their pixels, and the local luminance of a buffer is kept until the
+ * buffer holds a new frame, so that a paused video or a still image is only analyzed once.
  */
 class MouriMap {
 public:
@@ -65,15 +73,52 @@ public:
     // The HDR/SDR ratio describes the luminace range of the input. 1.0 means SDR. Anything larger
     // then 1.0 means that there is headroom above the SDR region.
     // Similarly, the target HDR/SDR ratio describes the luminance range of the output.
+    // The buffer ID and frame number identify the content of the input, so that its local
+    // luminance is reused while they stay the same. The local luminance is computed every time if
+    // either is 0.
     sk_sp<SkShader> mouriMap(SkiaGpuContext* context, sk_sp<SkShader> input, float inputHdrSdrRatio,
-                             float targetHdrSdrRatio);
+                             float targetHdrSdrRatio, uint64_t bufferId = 0,
+                             uint64_t frameNumber = 0);
+
+    // Drops the cached local luminance, which must be done before the GPU context that it was
+    // computed with is destroyed.
+    void clearCache() { mCache.clear(); }
+
+    void dump(std::string& result) const;
+
+    // The local luminance of larger inputs is computed as if they were downscaled to fit.
+    static constexpr int kMaxStatisticsDimension = 2048;
 
 private:
-    sk_sp<SkImage> downchunk(SkiaGpuContext* context, sk_sp<SkShader> input,
-                             float hdrSdrRatio) const;
+    // The blurred local luminance of an input, in 1/128th of the input size divided by
+    // inputScale.
+    struct LocalLux {
+        sk_sp<SkImage> image;
+        float inputScale;
+    };
+    LocalLux localLux(SkiaGpuContext* context, const sk_sp<SkShader>& input,
+                      float hdrSdrRatio) const;
+    sk_sp<SkImage> downchunk(SkiaGpuContext* context, sk_sp<SkShader> input, float hdrSdrRatio,
+                             float inputScale) const;
     sk_sp<SkImage> blur(SkiaGpuContext* context, SkImage* input) const;
-    sk_sp<SkShader> tonemap(sk_sp<SkShader> input, SkImage* localLux, float hdrSdrRatio,
+    sk_sp<SkShader> tonemap(sk_sp<SkShader> input, const LocalLux& localLux, float hdrSdrRatio,
                             float targetHdrSdrRatio) const;
+
+    struct CachedLocalLux {
+        uint64_t bufferId;
+        uint64_t frameNumber;
+        float hdrSdrRatio;
+        SkMatrix matrix;
+        SkImageInfo inputInfo;
+        const SkiaGpuContext* context;
+        LocalLux localLux;
+    };
+    static constexpr size_t kMaxCachedLocalLux = 4;
+    // Most recently used first.
+    std::deque<CachedLocalLux> mCache;
+    uint64_t mCacheHits = 0;
+    uint64_t mCacheMisses = 0;
+
     const sk_sp<SkRuntimeEffect> mCrosstalkAndChunk16x16;
     const sk_sp<SkRuntimeEffect> mChunk8x8;
     const sk_sp<SkRuntimeEffect> mBlur;
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../skia/PersistentShaderCache.h"
+
+namespace android::renderengine::skia {
+namespace {
+
+sk_sp<SkData> makeData(const std::string& contents) {
+    return SkData::MakeWithCopy(contents.data(), contents.size());
+}
+
+std::string toString(const sk_sp<SkData>& data) {
+    return std::string(static_cast<const char*>(data->data()), data->size());
+}
+
+TEST(PersistentShaderCacheTest, savedShadersAreLoaded) {
+    TemporaryFile file;
+    {
+        PersistentShaderCache cache(file.path, "fingerprint");
+        cache.store(*makeData("key1"), *makeData("data1"));
+        cache.store(*makeData("key2"), *makeData("data2"));
+        ASSERT_TRUE(cache.save());
+    }
+
+    PersistentShaderCache cache(file.path, "fingerprint");
+    ASSERT_TRUE(cache.load());
+    const auto shaders = cache.getShaders();
+    ASSERT_EQ(2u, shaders.size());
+    EXPECT_EQ("key1", toString(shaders[0].first));
+    EXPECT_EQ("data1", toString(shaders[0].second));
+    EXPECT_EQ("key2", toString(shaders[1].first));
+    EXPECT_EQ("data2", toString(shaders[1].second));
+}
+
+TEST(PersistentShaderCacheTest, storesEachKeyOnce) {
+    TemporaryFile file;
+    PersistentShaderCache cache(file.path, "fingerprint");
+    cache.store(*makeData("key"), *makeData("data"));
+    cache.store(*makeData("key"), *makeData("other data"));
+    ASSERT_EQ(1u, cache.size());
+    EXPECT_EQ("data", toString(cache.getShaders().front().second));
+}
+
+TEST(PersistentShaderCacheTest, discardsShadersFromOtherBuilds) {
+    TemporaryFile file;
+    {
+        PersistentShaderCache cache(file.path, "fingerprint");
+        cache.store(*makeData("key"), *makeData("data"));
+        ASSERT_TRUE(cache.save());
+    }
+
+    PersistentShaderCache cache(file.path, "other fingerprint");
+    EXPECT_FALSE(cache.load());
+    EXPECT_EQ(0u, cache.size());
+}
+
+TEST(PersistentShaderCacheTest, discardsTruncatedFiles) {
+    TemporaryFile file;
+    {
+        PersistentShaderCache cache(file.path, "fingerprint");
+        cache.store(*makeData("key"), *makeData("data"));
+        ASSERT_TRUE(cache.save());
+    }
+    std::string contents;
+    ASSERT_TRUE(base::ReadFileToString(file.path, &contents));
+    contents.resize(contents.size() - 1);
+    ASSERT_TRUE(base::WriteStringToFile(contents, file.path));
+
+    PersistentShaderCache cache(file.path, "fingerprint");
+    EXPECT_FALSE(cache.load());
+    EXPECT_EQ(0u, cache.size());
+}
+
+} // namespace
+} // namespace android::renderengine::skia
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "RecordedSceneTest"
+
+#include <gtest/gtest.h>
+#include <renderengine/RecordedScene.h>
+#include <renderengine/mock/FakeExternalTexture.h>
+
+namespace android::renderengine {
+namespace {
+
+using mock::FakeExternalTexture;
+
+TEST(RecordedSceneTest, recordedScenesAreParsed) {
+    const auto output = std::make_shared<FakeExternalTexture>(1080, 2400, 1, PIXEL_FORMAT_RGBA_8888,
+                                                              GRALLOC_USAGE_HW_RENDER);
+    const auto source =
+            std::make_shared<FakeExternalTexture>(540, 1200, 2, PIXEL_FORMAT_RGBA_1010102,
+                                                  GRALLOC_USAGE_HW_TEXTURE);
+
+    const DisplaySettings display{
+            .physicalDisplay = Rect(0, 0, 1080, 2400),
+            .clip = Rect(0, 0, 1080, 2400),
+            .damage = Rect(0, 100, 1080, 200),
+            .maxLuminance = 1000.f,
+            .outputDataspace = ui::Dataspace::DISPLAY_P3,
+            .colorTransform = mat4::scale(vec4(0.5f, 0.25f, 0.125f, 1.f)),
+            .orientation = ui::Transform::ROT_90,
+            .targetLuminanceNits = 500.f,
+            .tonemapStrategy = DisplaySettings::TonemapStrategy::Local,
+            .targetHdrSdrRatio = 2.5f,
+            .priority = DisplaySettings::Priority::Capture,
+    };
+
+    LayerSettings bufferLayer{
+            .geometry =
+                    Geometry{
+                            .boundaries = FloatRect(0.5f, 1.f, 540.f, 1200.f),
+                            .positionTransform = mat4::translate(vec4(10.f, 20.f, 0.f, 1.f)),
+                            .roundedCornersRadius = vec2(32.f, 32.f),
+                            .roundedCornersCrop = FloatRect(0, 0, 540, 1200),
+                    },
+            .source =
+                    PixelSource{
+                            .buffer =
+                                    Buffer{
+                                            .buffer = source,
+                                            .useTextureFiltering = true,
+                                            .usePremultipliedAlpha = false,
+                                            .maxLuminanceNits = 203.f,
+                                    },
+                    },
+            .alpha = half(0.75f),
+            .sourceDataspace = ui::Dataspace::BT2020_ITU_PQ,
+            .backgroundBlurRadius = 40,
+            .blurBackdropId = 1ull << 40,
+            .edgeExtensionEffect = EdgeExtensionEffect(true, false, true, false),
+            .name = "a layer with spaces#1",
+            .whitePointNits = 200.f,
+    };
+    LayerSettings colorLayer{
+            .geometry = Geometry{.boundaries = FloatRect(0, 0, 100, 100)},
+            .source = PixelSource{.solidColor = half3(0.25f, 0.5f, 1.f)},
+            .alpha = half(1.f),
+            .disableBlending = true,
+            .blurRegions = {BlurRegion{.blurRadius = 20,
+                                       .cornerRadiusTL = 1.f,
+                                       .cornerRadiusTR = 2.f,
+                                       .cornerRadiusBL = 3.f,
+                                       .cornerRadiusBR = 4.f,
+                                       .alpha = 0.5f,
+                                       .left = 0,
+                                       .top = 0,
+                                       .right = 100,
+                                       .bottom = 100}},
+            .name = "color",
+    };
+    colorLayer.shadow.boundaries = FloatRect(0, 0, 100, 100);
+    colorLayer.shadow.ambientColor = vec4(0.f, 0.f, 0.f, 0.1f);
+    colorLayer.shadow.lightPos = vec3(540.f, -100.f, 600.f);
+    colorLayer.shadow.length = 8.f;
+
+    std::string recording;
+    appendRecordedScene(recording, display, {bufferLayer, colorLayer}, *output);
+    appendRecordedScene(recording, DisplaySettings{}, {}, *output);
+
+    const auto scenes = parseRecordedScenes(recording);
+    ASSERT_TRUE(scenes);
+    ASSERT_EQ(2u, scenes->size());
+
+    const RecordedScene& scene = scenes->front();
+    EXPECT_EQ(display, scene.display);
+    EXPECT_EQ(display.tonemapStrategy, scene.display.tonemapStrategy);
+    EXPECT_EQ(display.targetHdrSdrRatio, scene.display.targetHdrSdrRatio);
+    EXPECT_EQ(display.priority, scene.display.priority);
+    EXPECT_EQ(1080u, scene.output.width);
+    EXPECT_EQ(2400u, scene.output.height);
+    EXPECT_EQ(PIXEL_FORMAT_RGBA_8888, scene.output.format);
+    EXPECT_EQ(static_cast<uint64_t>(GRALLOC_USAGE_HW_RENDER), scene.output.usage);
+
+    ASSERT_EQ(2u, scene.layers.size());
+    ASSERT_EQ(2u, scene.layerBuffers.size());
+    ASSERT_TRUE(scene.layerBuffers[0]);
+    EXPECT_EQ(540u, scene.layerBuffers[0]->width);
+    EXPECT_EQ(1200u, scene.layerBuffers[0]->height);
+    EXPECT_EQ(PIXEL_FORMAT_RGBA_1010102, scene.layerBuffers[0]->format);
+    EXPECT_FALSE(scene.layerBuffers[1]);
+
+    LayerSettings parsedBufferLayer = scene.layers[0];
+    EXPECT_EQ(nullptr, parsedBufferLayer.source.buffer.buffer);
+    parsedBufferLayer.source.buffer.buffer = source;
+    EXPECT_EQ(bufferLayer, parsedBufferLayer);
+    EXPECT_EQ(bufferLayer.name, parsedBufferLayer.name);
+    EXPECT_EQ(colorLayer, scene.layers[1]);
+
+    EXPECT_TRUE(scenes->back().layers.empty());
+}
+
+TEST(RecordedSceneTest, unknownSettingsAreSkipped) {
+    const auto scenes = parseRecordedScenes("scene\n"
+                                            "maxLuminance 500\n"
+                                            "someNewSetting 1 2 3\n"
+                                            "layer name\n"
+                                            "alpha 0.5\n"
+                                            "anotherNewSetting\n");
+    ASSERT_TRUE(scenes);
+    ASSERT_EQ(1u, scenes->size());
+    EXPECT_EQ(500.f, scenes->front().display.maxLuminance);
+    ASSERT_EQ(1u, scenes->front().layers.size());
+    EXPECT_EQ(half(0.5f), scenes->front().layers.front().alpha);
+}
+
+TEST(RecordedSceneTest, malformedScenesAreRejected) {
+    EXPECT_FALSE(parseRecordedScenes("maxLuminance 500\n"));
+    EXPECT_FALSE(parseRecordedScenes("scene\nmaxLuminance bright\n"));
+    EXPECT_FALSE(parseRecordedScenes("scene\nclip 0 0 100\n"));
+    EXPECT_FALSE(parseRecordedScenes("scene\nlayer\nalpha 0.5 0.5\n"));
+    EXPECT_FALSE(parseRecordedScenes("scene\nlayer\ndisableBlending 2\n"));
+}
+
+} // namespace
+} // namespace android::renderengine
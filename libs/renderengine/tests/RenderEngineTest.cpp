@@ -1587,6 +1587,72 @@ TEST_P(RenderEngineTest, drawLayers_fillRedBufferAndEmptyBuffer) {
     expectBufferColor(fullscreenRect(), 0, 0, 0, 0);
 }
 
+TEST_P(RenderEngineTest, drawLayers_onlyRedrawsDamage) {
+    if (!GetParam()->apiSupported()) {
+        GTEST_SKIP();
+    }
+    initializeRenderEngine();
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+    settings.outputDataspace = ui::Dataspace::V0_SRGB_LINEAR;
+
+    renderengine::LayerSettings layer{
+            .geometry.boundaries = fullscreenRect().toFloatRect(),
+            .source.solidColor = half3(1.0f, 0.0f, 0.0f),
+            .alpha = 1.f,
+    };
+    invokeDraw(settings, {layer});
+    expectBufferColor(fullscreenRect(), 255, 0, 0, 255);
+
+    // Only the damaged half of the buffer turns green.
+    const Rect damage(DEFAULT_DISPLAY_WIDTH / 2, DEFAULT_DISPLAY_HEIGHT);
+    settings.damage = damage;
+    layer.source.solidColor = half3(0.0f, 1.0f, 0.0f);
+    invokeDraw(settings, {layer});
+    expectBufferColor(damage, 0, 255, 0, 255);
+    expectBufferColor(Rect(DEFAULT_DISPLAY_WIDTH / 2, 0, DEFAULT_DISPLAY_WIDTH,
+                           DEFAULT_DISPLAY_HEIGHT),
+                      255, 0, 0, 255);
+}
+
+TEST_P(RenderEngineTest, drawLayers_reusesBlurOfUnchangedBackdrop) {
+    if (!GetParam()->apiSupported()) {
+        GTEST_SKIP();
+    }
+    initializeRenderEngine();
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+    settings.outputDataspace = ui::Dataspace::V0_SRGB_LINEAR;
+
+    renderengine::LayerSettings background{
+            .geometry.boundaries = fullscreenRect().toFloatRect(),
+            .source.solidColor = half3(1.0f, 0.0f, 0.0f),
+            .alpha = 1.f,
+    };
+    renderengine::LayerSettings blur{
+            .geometry.boundaries = fullscreenRect().toFloatRect(),
+            .alpha = 1.f,
+            .skipContentDraw = true,
+            .backgroundBlurRadius = 40,
+            .blurBackdropId = 1,
+    };
+    const Rect center(DEFAULT_DISPLAY_WIDTH / 4, DEFAULT_DISPLAY_HEIGHT / 4,
+                      DEFAULT_DISPLAY_WIDTH * 3 / 4, DEFAULT_DISPLAY_HEIGHT * 3 / 4);
+    invokeDraw(settings, {background, blur});
+    expectBufferColor(center, 255, 0, 0, 255, 1);
+
+    // The backdrop id claims nothing changed beneath the blur, so the red blur is reused.
+    background.source.solidColor = half3(0.0f, 1.0f, 0.0f);
+    invokeDraw(settings, {background, blur});
+    expectBufferColor(center, 255, 0, 0, 255, 1);
+
+    blur.blurBackdropId = 2;
+    invokeDraw(settings, {background, blur});
+    expectBufferColor(center, 0, 255, 0, 255, 1);
+}
+
 TEST_P(RenderEngineTest, drawLayers_withoutBuffers_withColorTransform) {
     if (!GetParam()->apiSupported()) {
         GTEST_SKIP();
@@ -2134,6 +2200,29 @@ TEST_P(RenderEngineTest, drawLayers_fillShadow_castsWithoutCasterLayer) {
     expectShadowColorWithoutCaster(casterBounds.toFloatRect(), settings, backgroundColor);
 }
 
+TEST_P(RenderEngineTest, drawLayers_fillShadow_reusesCachedShadow) {
+    if (!GetParam()->apiSupported()) {
+        GTEST_SKIP();
+    }
+    property_set(PROPERTY_DEBUG_RENDERENGINE_SHADOW_CACHE_BUDGET_KB, "4096");
+    initializeRenderEngine();
+    property_set(PROPERTY_DEBUG_RENDERENGINE_SHADOW_CACHE_BUDGET_KB, "0");
+
+    const ubyte4 backgroundColor(static_cast<uint8_t>(255), static_cast<uint8_t>(255),
+                                 static_cast<uint8_t>(255), static_cast<uint8_t>(255));
+    const float shadowLength = 5.0f;
+    Rect casterBounds(DEFAULT_DISPLAY_WIDTH / 3.0f, DEFAULT_DISPLAY_HEIGHT / 3.0f);
+    casterBounds.offsetBy(shadowLength + 1, shadowLength + 1);
+    ShadowSettings settings = getShadowSettings(vec2(casterBounds.left, casterBounds.top),
+                                                shadowLength, false /* casterIsTranslucent */);
+
+    // The first draw rasterizes the shadow, and the second one draws the cached shadow.
+    for (int i = 0; i < 2; i++) {
+        drawShadowWithoutCaster(casterBounds.toFloatRect(), settings, backgroundColor);
+        expectShadowColorWithoutCaster(casterBounds.toFloatRect(), settings, backgroundColor);
+    }
+}
+
 TEST_P(RenderEngineTest, drawLayers_fillShadow_casterLayerMinSize) {
     if (!GetParam()->apiSupported()) {
         GTEST_SKIP();
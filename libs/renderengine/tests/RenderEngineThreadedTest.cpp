@@ -19,6 +19,7 @@
 #include <gtest/gtest.h>
 #include <hardware/gralloc.h>
 #include <renderengine/impl/ExternalTexture.h>
+#include <renderengine/mock/FakeExternalTexture.h>
 #include <renderengine/mock/RenderEngine.h>
 #include <ui/PixelFormat.h>
 #include "../threaded/RenderEngineThreaded.h"
@@ -185,6 +186,142 @@ TEST_F(RenderEngineThreadedTest, drawLayers) {
     ASSERT_TRUE(result.ok());
 }
 
+TEST_F(RenderEngineThreadedTest, drawLayers_runsCompositionBeforeCapture) {
+    // Keep the thread busy while both draws are queued.
+    std::promise<void> busy;
+    std::promise<void> idle;
+    std::shared_future<void> idleFuture = idle.get_future().share();
+    EXPECT_CALL(*mRenderEngine, onActiveDisplaySizeChanged(_)).WillOnce([&](ui::Size) {
+        busy.set_value();
+        idleFuture.wait();
+    });
+    mThreadedRE->onActiveDisplaySizeChanged(ui::Size(1, 1));
+    busy.get_future().wait();
+
+    renderengine::DisplaySettings captureSettings{.namePlusId = "capture"};
+    captureSettings.priority = renderengine::DisplaySettings::Priority::Capture;
+    const renderengine::DisplaySettings compositionSettings{.namePlusId = "composition"};
+    std::vector<renderengine::LayerSettings> layers;
+    std::shared_ptr<renderengine::ExternalTexture> buffer = std::make_shared<
+            renderengine::impl::
+                    ExternalTexture>(sp<GraphicBuffer>::make(), *mRenderEngine,
+                                     renderengine::impl::ExternalTexture::Usage::READABLE |
+                                             renderengine::impl::ExternalTexture::Usage::WRITEABLE);
+
+    const auto draw = [](const std::shared_ptr<std::promise<FenceResult>>&& resultPromise,
+                         const renderengine::DisplaySettings&,
+                         const std::vector<renderengine::LayerSettings>&,
+                         const std::shared_ptr<renderengine::ExternalTexture>&,
+                         base::unique_fd&&) { resultPromise->set_value(Fence::NO_FENCE); };
+    EXPECT_CALL(*mRenderEngine, useProtectedContext(false)).Times(2);
+    {
+        testing::InSequence sequence;
+        EXPECT_CALL(*mRenderEngine,
+                    drawLayersInternal(_,
+                                       testing::Field(&renderengine::DisplaySettings::namePlusId,
+                                                      Eq("composition")),
+                                       _, _, _))
+                .WillOnce(draw);
+        EXPECT_CALL(*mRenderEngine,
+                    drawLayersInternal(_,
+                                       testing::Field(&renderengine::DisplaySettings::namePlusId,
+                                                      Eq("capture")),
+                                       _, _, _))
+                .WillOnce(draw);
+    }
+
+    ftl::Future<FenceResult> captureFuture =
+            mThreadedRE->drawLayers(captureSettings, layers, buffer, base::unique_fd());
+    ftl::Future<FenceResult> compositionFuture =
+            mThreadedRE->drawLayers(compositionSettings, layers, buffer, base::unique_fd());
+    idle.set_value();
+
+    ASSERT_TRUE(compositionFuture.get().ok());
+    ASSERT_TRUE(captureFuture.get().ok());
+
+    std::string dump;
+    EXPECT_CALL(*mRenderEngine, dump(_));
+    mThreadedRE->dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("Capture: queued=0 count=1"));
+}
+
+TEST(RenderEngineThreadedParallelCaptureTest, drawLayers_drawsCaptureWhileComposing) {
+    // Both instances are created by the same factory, in no particular order.
+    auto* firstRenderEngine = new renderengine::mock::RenderEngine();
+    auto* secondRenderEngine = new renderengine::mock::RenderEngine();
+    std::atomic<int> instances = 0;
+    auto threadedRE = renderengine::threaded::RenderEngineThreaded::create(
+            [&]() -> std::unique_ptr<renderengine::RenderEngine> {
+                return std::unique_ptr<renderengine::RenderEngine>(
+                        instances++ == 0 ? firstRenderEngine : secondRenderEngine);
+            },
+            /*parallelCapture*/ true);
+
+    renderengine::DisplaySettings captureSettings{.namePlusId = "capture"};
+    captureSettings.priority = renderengine::DisplaySettings::Priority::Capture;
+    const renderengine::DisplaySettings compositionSettings{.namePlusId = "composition"};
+    std::vector<renderengine::LayerSettings> layers;
+    std::shared_ptr<renderengine::ExternalTexture> buffer = std::make_shared<
+            renderengine::impl::
+                    ExternalTexture>(sp<GraphicBuffer>::make(), *firstRenderEngine,
+                                     renderengine::impl::ExternalTexture::Usage::READABLE |
+                                             renderengine::impl::ExternalTexture::Usage::WRITEABLE);
+
+    // Composition blocks until the capture is done, which would never happen if they were drawn
+    // on the same thread.
+    std::promise<void> composing;
+    std::promise<void> captured;
+    std::shared_future<void> capturedFuture = captured.get_future().share();
+    const auto draw = [&](const std::shared_ptr<std::promise<FenceResult>>&& resultPromise,
+                          const renderengine::DisplaySettings& display,
+                          const std::vector<renderengine::LayerSettings>&,
+                          const std::shared_ptr<renderengine::ExternalTexture>&,
+                          base::unique_fd&&) {
+        if (display.namePlusId == "composition") {
+            composing.set_value();
+            capturedFuture.wait();
+        }
+        resultPromise->set_value(Fence::NO_FENCE);
+    };
+    for (auto* renderEngine : {firstRenderEngine, secondRenderEngine}) {
+        EXPECT_CALL(*renderEngine, useProtectedContext(false));
+        EXPECT_CALL(*renderEngine, drawLayersInternal(_, _, _, _, _)).WillOnce(draw);
+    }
+
+    ftl::Future<FenceResult> compositionFuture =
+            threadedRE->drawLayers(compositionSettings, layers, buffer, base::unique_fd());
+    composing.get_future().wait();
+
+    // The capture completes while composition is still in progress.
+    ftl::Future<FenceResult> captureFuture =
+            threadedRE->drawLayers(captureSettings, layers, buffer, base::unique_fd());
+    ASSERT_TRUE(captureFuture.get().ok());
+    captured.set_value();
+    ASSERT_TRUE(compositionFuture.get().ok());
+}
+
+TEST_F(RenderEngineThreadedTest, drawGainmap_drawsWholeGainmap) {
+    using renderengine::ExternalTexture;
+    using renderengine::mock::FakeExternalTexture;
+    const auto sdr = std::make_shared<FakeExternalTexture>(8, 8, 1, PIXEL_FORMAT_RGBA_8888, 0);
+    const auto hdr = std::make_shared<FakeExternalTexture>(8, 8, 2, PIXEL_FORMAT_RGBA_FP16, 0);
+    const auto gainmap = std::make_shared<FakeExternalTexture>(4, 4, 3, PIXEL_FORMAT_RGBA_8888, 0);
+
+    EXPECT_CALL(*mRenderEngine, useProtectedContext(false));
+    EXPECT_CALL(*mRenderEngine, drawGainmapInternal(_, _, _, _, _, _, _, _, Eq(Rect(4, 4))))
+            .WillOnce([](const std::shared_ptr<std::promise<FenceResult>>&& resultPromise,
+                         const std::shared_ptr<ExternalTexture>&, base::borrowed_fd&&,
+                         const std::shared_ptr<ExternalTexture>&, base::borrowed_fd&&, float,
+                         ui::Dataspace, const std::shared_ptr<ExternalTexture>&,
+                         const Rect&) { resultPromise->set_value(Fence::NO_FENCE); });
+
+    ftl::Future<FenceResult> future =
+            mThreadedRE->drawGainmap(sdr, base::borrowed_fd(-1), hdr, base::borrowed_fd(-1), 2.f,
+                                     ui::Dataspace::V0_SRGB, gainmap);
+    ASSERT_TRUE(future.valid());
+    EXPECT_TRUE(future.get().ok());
+}
+
 TEST_F(RenderEngineThreadedTest, drawLayers_protectedLayer) {
     renderengine::DisplaySettings settings;
     auto layerBuffer = sp<GraphicBuffer>::make();
@@ -246,4 +383,90 @@ TEST_F(RenderEngineThreadedTest, drawLayers_protectedOutputBuffer) {
     ASSERT_TRUE(result.ok());
 }
 
+// Records the buffers that it is asked to map and unmap, and whether they came one at a time.
+class TextureRecordingRenderEngine : public renderengine::mock::RenderEngine {
+public:
+    struct Record {
+        std::vector<std::string> calls;
+        std::vector<uint64_t> mapped;
+        std::vector<uint64_t> unmapped;
+    };
+
+    explicit TextureRecordingRenderEngine(Record& record) : mRecord(record) {}
+
+protected:
+    void mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer, bool) override {
+        mRecord.calls.push_back("map");
+        mRecord.mapped.push_back(buffer->getId());
+    }
+    void unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer) override {
+        mRecord.calls.push_back("unmap");
+        mRecord.unmapped.push_back(buffer->getId());
+    }
+    void mapExternalTextureBuffers(const std::vector<sp<GraphicBuffer>>& buffers,
+                                   bool isRenderable) override {
+        mRecord.calls.push_back(isRenderable ? "mapBatch(renderable)" : "mapBatch");
+        for (const auto& buffer : buffers) {
+            mRecord.mapped.push_back(buffer->getId());
+        }
+    }
+    void unmapExternalTextureBuffers(std::vector<sp<GraphicBuffer>>&& buffers) override {
+        mRecord.calls.push_back("unmapBatch");
+        for (const auto& buffer : buffers) {
+            mRecord.unmapped.push_back(buffer->getId());
+        }
+    }
+
+private:
+    Record& mRecord;
+};
+
+TEST(RenderEngineThreadedBatchTest, batchMapsAndUnmapsTexturesTogether) {
+    TextureRecordingRenderEngine::Record record;
+    auto* recordingRE = new TextureRecordingRenderEngine(record);
+    auto threadedRE = renderengine::threaded::RenderEngineThreaded::create(
+            [recordingRE]() { return std::unique_ptr<renderengine::RenderEngine>(recordingRE); });
+
+    const auto buffer1 = sp<GraphicBuffer>::make();
+    const auto buffer2 = sp<GraphicBuffer>::make();
+    const auto buffer3 = sp<GraphicBuffer>::make();
+    std::vector<std::shared_ptr<renderengine::ExternalTexture>> textures;
+    {
+        renderengine::impl::ExternalTexture::Batch batch(*threadedRE);
+        for (const auto& buffer : {buffer1, buffer2}) {
+            textures.push_back(std::make_shared<renderengine::impl::ExternalTexture>(
+                    buffer, *threadedRE, renderengine::impl::ExternalTexture::Usage::READABLE));
+        }
+        textures.push_back(std::make_shared<renderengine::impl::ExternalTexture>(
+                buffer3, *threadedRE, renderengine::impl::ExternalTexture::Usage::WRITEABLE));
+        // Remapping within the batch keeps the buffer mapped.
+        textures[0]->remapBuffer();
+    }
+    {
+        renderengine::impl::ExternalTexture::Batch batch(*threadedRE);
+        textures.clear();
+    }
+    // Outside of a batch, the buffer is mapped and unmapped by itself.
+    {
+        renderengine::impl::ExternalTexture texture(buffer1, *threadedRE,
+                                                    renderengine::impl::ExternalTexture::Usage::
+                                                            READABLE);
+    }
+
+    // The queue runs in order, so the work above is done once this returns.
+    EXPECT_CALL(*recordingRE, getContextPriority()).WillOnce(Return(2));
+    threadedRE->getContextPriority();
+
+    EXPECT_THAT(record.calls,
+                testing::ElementsAre("mapBatch", "mapBatch(renderable)", "unmapBatch",
+                                     "unmapBatch", "map", "unmap"));
+    EXPECT_THAT(record.mapped,
+                testing::ElementsAre(buffer1->getId(), buffer2->getId(), buffer1->getId(),
+                                     buffer3->getId(), buffer1->getId()));
+    EXPECT_THAT(record.unmapped,
+                testing::UnorderedElementsAre(buffer1->getId(), buffer1->getId(),
+                                              buffer2->getId(), buffer3->getId(),
+                                              buffer1->getId()));
+}
+
 } // namespace android
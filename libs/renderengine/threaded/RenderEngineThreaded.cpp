@@ -19,9 +19,12 @@
 #include "RenderEngineThreaded.h"
 
 #include <sched.h>
+#include <algorithm>
 #include <chrono>
+#include <cinttypes>
 #include <future>
 
+#include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <common/trace.h>
 #include <private/gui/SyncFeatures.h>
@@ -33,12 +36,24 @@ namespace android {
 namespace renderengine {
 namespace threaded {
 
-std::unique_ptr<RenderEngineThreaded> RenderEngineThreaded::create(CreateInstanceFactory factory) {
-    return std::make_unique<RenderEngineThreaded>(std::move(factory));
+std::unique_ptr<RenderEngineThreaded> RenderEngineThreaded::create(CreateInstanceFactory factory,
+                                                                   bool parallelCapture) {
+    return std::make_unique<RenderEngineThreaded>(std::move(factory), parallelCapture);
 }
 
-RenderEngineThreaded::RenderEngineThreaded(CreateInstanceFactory factory)
-      : RenderEngine(Threaded::YES) {
+RenderEngineThreaded::RenderEngineThreaded(CreateInstanceFactory factory, bool parallelCapture)
+      : RenderEngineThreaded(factory, "RenderEngine") {
+    if (parallelCapture) {
+        // The constructor is private, so make_unique can't call it.
+        mCaptureEngine.reset(new RenderEngineThreaded(std::move(factory), "RenderEngineCapture"));
+    }
+}
+
+RenderEngineThreaded::RenderEngineThreaded(CreateInstanceFactory factory, const char* threadName)
+      : RenderEngine(Threaded::YES),
+        mThreadName(threadName),
+        mGainmapTileRows(
+                base::GetIntProperty(PROPERTY_DEBUG_RENDERENGINE_GAINMAP_TILE_ROWS, 0)) {
     SFTRACE_CALL();
 
     std::lock_guard lockThread(mThreadMutex);
@@ -99,12 +114,7 @@ void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_S
     while (mRunning) {
         const auto getNextTask = [this]() -> std::optional<Work> {
             std::scoped_lock lock(mThreadMutex);
-            if (!mFunctionCalls.empty()) {
-                Work task = mFunctionCalls.front();
-                mFunctionCalls.pop();
-                return std::make_optional<Work>(task);
-            }
-            return std::nullopt;
+            return mFunctionCalls.pop();
         };
 
         const auto task = getNextTask();
@@ -123,6 +133,48 @@ void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_S
     mRenderEngine.reset();
 }
 
+void RenderEngineThreaded::WorkQueue::push(Priority priority, Work work) {
+    mQueues[static_cast<size_t>(priority)].push({std::move(work), systemTime()});
+}
+
+bool RenderEngineThreaded::WorkQueue::empty() const {
+    return std::all_of(mQueues.begin(), mQueues.end(),
+                       [](const auto& queue) { return queue.empty(); });
+}
+
+auto RenderEngineThreaded::WorkQueue::pop() -> std::optional<Work> {
+    for (size_t i = 0; i < kPriorityCount; i++) {
+        auto& queue = mQueues[i];
+        if (queue.empty()) {
+            continue;
+        }
+        QueuedWork queuedWork = std::move(queue.front());
+        queue.pop();
+
+        const nsecs_t latency = systemTime() - queuedWork.queueTime;
+        QueueLatency& queueLatency = mLatencies[i];
+        queueLatency.count++;
+        queueLatency.total += latency;
+        queueLatency.max = std::max(queueLatency.max, latency);
+        return std::make_optional<Work>(std::move(queuedWork.work));
+    }
+    return std::nullopt;
+}
+
+void RenderEngineThreaded::WorkQueue::dump(std::string& result) const {
+    result.append("RenderEngineThreaded queue latency:\n");
+    for (size_t i = 0; i < kPriorityCount; i++) {
+        const QueueLatency& latency = mLatencies[i];
+        const double mean = latency.count == 0
+                ? 0.0
+                : static_cast<double>(latency.total) / static_cast<double>(latency.count);
+        base::StringAppendF(&result,
+                            "    %s: queued=%zu count=%" PRIu64 " mean=%.3fms max=%.3fms\n",
+                            ftl::enum_string(static_cast<Priority>(i)).c_str(), mQueues[i].size(),
+                            latency.count, mean / 1e6, static_cast<double>(latency.max) / 1e6);
+    }
+}
+
 void RenderEngineThreaded::waitUntilInitialized() const {
     if (!mIsInitialized) {
         std::unique_lock<std::mutex> lock(mInitializedMutex);
@@ -172,6 +224,16 @@ void RenderEngineThreaded::dump(std::string& result) {
     mCondition.notify_one();
     // Note: This is an rvalue.
     result.assign(resultFuture.get());
+
+    {
+        std::lock_guard lock(mThreadMutex);
+        mFunctionCalls.dump(result);
+    }
+
+    if (mCaptureEngine) {
+        result.append("\nCapture RenderEngine:\n");
+        mCaptureEngine->dump(result);
+    }
 }
 
 void RenderEngineThreaded::mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer,
@@ -204,6 +266,36 @@ void RenderEngineThreaded::unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer
     mCondition.notify_one();
 }
 
+void RenderEngineThreaded::mapExternalTextureBuffers(const std::vector<sp<GraphicBuffer>>& buffers,
+                                                     bool isRenderable) {
+    SFTRACE_CALL();
+    // This function is designed so it can run asynchronously, so we do not need to wait
+    // for the futures.
+    {
+        std::lock_guard lock(mThreadMutex);
+        mFunctionCalls.push([=](renderengine::RenderEngine& instance) {
+            SFTRACE_FORMAT("REThreaded::mapExternalTextureBuffers %zu", buffers.size());
+            instance.mapExternalTextureBuffers(buffers, isRenderable);
+        });
+    }
+    mCondition.notify_one();
+}
+
+void RenderEngineThreaded::unmapExternalTextureBuffers(std::vector<sp<GraphicBuffer>>&& buffers) {
+    SFTRACE_CALL();
+    // This function is designed so it can run asynchronously, so we do not need to wait
+    // for the futures.
+    {
+        std::lock_guard lock(mThreadMutex);
+        mFunctionCalls.push(
+                [buffers = std::move(buffers)](renderengine::RenderEngine& instance) mutable {
+                    SFTRACE_FORMAT("REThreaded::unmapExternalTextureBuffers %zu", buffers.size());
+                    instance.unmapExternalTextureBuffers(std::move(buffers));
+                });
+    }
+    mCondition.notify_one();
+}
+
 size_t RenderEngineThreaded::getMaxTextureSize() const {
     waitUntilInitialized();
     return mRenderEngine->getMaxTextureSize();
@@ -220,7 +312,10 @@ bool RenderEngineThreaded::supportsProtectedContent() const {
 }
 
 void RenderEngineThreaded::cleanupPostRender() {
-    if (canSkipPostRenderCleanup()) {
+    if (mCaptureEngine) {
+        mCaptureEngine->cleanupPostRender();
+    }
+    if (!mNeedsPostRenderCleanup) {
         return;
     }
 
@@ -238,7 +333,8 @@ void RenderEngineThreaded::cleanupPostRender() {
 }
 
 bool RenderEngineThreaded::canSkipPostRenderCleanup() const {
-    return !mNeedsPostRenderCleanup;
+    return !mNeedsPostRenderCleanup &&
+            (!mCaptureEngine || mCaptureEngine->canSkipPostRenderCleanup());
 }
 
 void RenderEngineThreaded::drawLayersInternal(
@@ -254,7 +350,7 @@ void RenderEngineThreaded::drawGainmapInternal(
         const std::shared_ptr<ExternalTexture>& sdr, base::borrowed_fd&& sdrFence,
         const std::shared_ptr<ExternalTexture>& hdr, base::borrowed_fd&& hdrFence,
         float hdrSdrRatio, ui::Dataspace dataspace,
-        const std::shared_ptr<ExternalTexture>& gainmap) {
+        const std::shared_ptr<ExternalTexture>& gainmap, const Rect& region) {
     resultPromise->set_value(Fence::NO_FENCE);
     return;
 }
@@ -262,6 +358,10 @@ void RenderEngineThreaded::drawGainmapInternal(
 ftl::Future<FenceResult> RenderEngineThreaded::drawLayers(
         const DisplaySettings& display, const std::vector<LayerSettings>& layers,
         const std::shared_ptr<ExternalTexture>& buffer, base::unique_fd&& bufferFence) {
+    if (mCaptureEngine && display.priority == DisplaySettings::Priority::Capture) {
+        return mCaptureEngine->drawLayers(display, layers, buffer, std::move(bufferFence));
+    }
+
     SFTRACE_CALL();
     const auto resultPromise = std::make_shared<std::promise<FenceResult>>();
     std::future<FenceResult> resultFuture = resultPromise->get_future();
@@ -270,6 +370,7 @@ ftl::Future<FenceResult> RenderEngineThreaded::drawLayers(
         std::lock_guard lock(mThreadMutex);
         mNeedsPostRenderCleanup = true;
         mFunctionCalls.push(
+                display.priority,
                 [resultPromise, display, layers, buffer, fd](renderengine::RenderEngine& instance) {
                     SFTRACE_NAME("REThreaded::drawLayers");
                     instance.updateProtectedContext(layers, {buffer.get()});
@@ -286,20 +387,70 @@ ftl::Future<FenceResult> RenderEngineThreaded::drawGainmap(
         const std::shared_ptr<ExternalTexture>& hdr, base::borrowed_fd&& hdrFence,
         float hdrSdrRatio, ui::Dataspace dataspace,
         const std::shared_ptr<ExternalTexture>& gainmap) {
+    if (mCaptureEngine) {
+        return mCaptureEngine->drawGainmap(sdr, std::move(sdrFence), hdr, std::move(hdrFence),
+                                           hdrSdrRatio, dataspace, gainmap);
+    }
+
     SFTRACE_CALL();
     const auto resultPromise = std::make_shared<std::promise<FenceResult>>();
     std::future<FenceResult> resultFuture = resultPromise->get_future();
+
+    // Each band of rows is queued separately, so that composition can draw between them. The
+    // result is the merged fence of all the bands, or the first error.
+    struct Tiles {
+        std::shared_ptr<std::promise<FenceResult>> resultPromise;
+        sp<Fence> fence = Fence::NO_FENCE;
+        bool failed = false;
+    };
+    const auto tiles = std::make_shared<Tiles>(Tiles{.resultPromise = resultPromise});
+    const Rect bounds = gainmap->getBounds();
+    if (bounds.isEmpty()) {
+        resultPromise->set_value(Fence::NO_FENCE);
+        return resultFuture;
+    }
+    const int32_t tileRows = mGainmapTileRows > 0 ? mGainmapTileRows : bounds.height();
+    const int sdrFd = sdrFence.get();
+    const int hdrFd = hdrFence.get();
+
     {
         std::lock_guard lock(mThreadMutex);
         mNeedsPostRenderCleanup = true;
-        mFunctionCalls.push([resultPromise, sdr, sdrFence = std::move(sdrFence), hdr,
-                             hdrFence = std::move(hdrFence), hdrSdrRatio, dataspace,
-                             gainmap](renderengine::RenderEngine& instance) mutable {
-            SFTRACE_NAME("REThreaded::drawGainmap");
-            instance.updateProtectedContext({}, {sdr.get(), hdr.get(), gainmap.get()});
-            instance.drawGainmapInternal(std::move(resultPromise), sdr, std::move(sdrFence), hdr,
-                                         std::move(hdrFence), hdrSdrRatio, dataspace, gainmap);
-        });
+        for (int32_t top = 0; top < bounds.height(); top += tileRows) {
+            const Rect region(0, top, bounds.width(), std::min(top + tileRows, bounds.height()));
+            const bool last = region.bottom == bounds.height();
+            // Gainmaps are only drawn for screenshots.
+            mFunctionCalls.push(DisplaySettings::Priority::Capture,
+                                [tiles, region, last, sdr, sdrFd, hdr, hdrFd, hdrSdrRatio,
+                                 dataspace, gainmap](renderengine::RenderEngine& instance) {
+                                    SFTRACE_NAME("REThreaded::drawGainmap");
+                                    if (tiles->failed) return;
+
+                                    const auto tilePromise =
+                                            std::make_shared<std::promise<FenceResult>>();
+                                    std::future<FenceResult> tileFuture =
+                                            tilePromise->get_future();
+                                    instance.updateProtectedContext({}, {sdr.get(), hdr.get(),
+                                                                         gainmap.get()});
+                                    instance.drawGainmapInternal(std::move(tilePromise), sdr,
+                                                                 base::borrowed_fd(sdrFd), hdr,
+                                                                 base::borrowed_fd(hdrFd),
+                                                                 hdrSdrRatio, dataspace, gainmap,
+                                                                 region);
+                                    FenceResult result = tileFuture.get();
+                                    if (!result.ok()) {
+                                        tiles->failed = true;
+                                        tiles->resultPromise->set_value(std::move(result));
+                                        return;
+                                    }
+                                    tiles->fence = tiles->fence->isValid()
+                                            ? Fence::merge("gainmap", tiles->fence, *result)
+                                            : *result;
+                                    if (last) {
+                                        tiles->resultPromise->set_value(tiles->fence);
+                                    }
+                                });
+        }
     }
     mCondition.notify_one();
     return resultFuture;
@@ -326,6 +477,10 @@ bool RenderEngineThreaded::supportsBackgroundBlur() {
 }
 
 void RenderEngineThreaded::onActiveDisplaySizeChanged(ui::Size size) {
+    if (mCaptureEngine) {
+        mCaptureEngine->onActiveDisplaySizeChanged(size);
+    }
+
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
     {
@@ -353,6 +508,10 @@ std::optional<pid_t> RenderEngineThreaded::getRenderEngineTid() const {
 }
 
 void RenderEngineThreaded::setEnableTracing(bool tracingEnabled) {
+    if (mCaptureEngine) {
+        mCaptureEngine->setEnableTracing(tracingEnabled);
+    }
+
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
     {
@@ -364,6 +523,22 @@ void RenderEngineThreaded::setEnableTracing(bool tracingEnabled) {
     }
     mCondition.notify_one();
 }
+
+int RenderEngineThreaded::reportShadersCompiled() {
+    std::promise<int> resultPromise;
+    std::future<int> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard lock(mThreadMutex);
+        mFunctionCalls.push([&resultPromise](renderengine::RenderEngine& instance) {
+            SFTRACE_NAME("REThreaded::reportShadersCompiled");
+            resultPromise.set_value(instance.reportShadersCompiled());
+        });
+    }
+    mCondition.notify_one();
+    const int shadersCompiled = resultFuture.get();
+    return mCaptureEngine ? shadersCompiled + mCaptureEngine->reportShadersCompiled()
+                          : shadersCompiled;
+}
 } // namespace threaded
 } // namespace renderengine
 } // namespace android
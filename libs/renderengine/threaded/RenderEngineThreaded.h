@@ -17,11 +17,17 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <array>
 #include <condition_variable>
 #include <mutex>
+#include <optional>
 #include <queue>
+#include <string>
 #include <thread>
 
+#include <ftl/enum.h>
+#include <utils/Timers.h>
+
 #include "renderengine/RenderEngine.h"
 
 namespace android {
@@ -34,12 +40,21 @@ using CreateInstanceFactory = std::function<std::unique_ptr<renderengine::Render
  * This class extends a basic RenderEngine class. It contains a thread. Each time a function of
  * this class is called, we create a lambda function that is put on a queue. The main thread then
  * executes the functions in order.
+ *
+ * Draws are queued by DisplaySettings::priority, and everything else is queued with composition.
+ * The thread always runs the oldest function of the highest priority next, so a composition draw
+ * only waits for the draw in progress, and not for screenshots queued before it.
+ *
+ * With parallel capture, draws with the capture priority instead go to a second instance that has
+ * its own thread and GPU context, so screenshots don't wait for composition at all. Buffers are
+ * only mapped into the first instance, and the second one imports them for each draw.
  */
 class RenderEngineThreaded : public RenderEngine {
 public:
-    static std::unique_ptr<RenderEngineThreaded> create(CreateInstanceFactory factory);
+    static std::unique_ptr<RenderEngineThreaded> create(CreateInstanceFactory factory,
+                                                        bool parallelCapture = false);
 
-    RenderEngineThreaded(CreateInstanceFactory factory);
+    RenderEngineThreaded(CreateInstanceFactory factory, bool parallelCapture = false);
     ~RenderEngineThreaded() override;
     std::future<void> primeCache(PrimeCacheConfig config) override;
 
@@ -67,10 +82,14 @@ public:
     void onActiveDisplaySizeChanged(ui::Size size) override;
     std::optional<pid_t> getRenderEngineTid() const override;
     void setEnableTracing(bool tracingEnabled) override;
+    int reportShadersCompiled() override;
 
 protected:
     void mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer, bool isRenderable) override;
     void unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer) override;
+    void mapExternalTextureBuffers(const std::vector<sp<GraphicBuffer>>& buffers,
+                                   bool isRenderable) override;
+    void unmapExternalTextureBuffers(std::vector<sp<GraphicBuffer>>&& buffers) override;
     bool canSkipPostRenderCleanup() const override;
     void drawLayersInternal(const std::shared_ptr<std::promise<FenceResult>>&& resultPromise,
                             const DisplaySettings& display,
@@ -83,9 +102,13 @@ protected:
                              const std::shared_ptr<ExternalTexture>& hdr,
                              base::borrowed_fd&& hdrFence, float hdrSdrRatio,
                              ui::Dataspace dataspace,
-                             const std::shared_ptr<ExternalTexture>& gainmap) override;
+                             const std::shared_ptr<ExternalTexture>& gainmap,
+                             const Rect& region) override;
 
 private:
+    // Creates the instance that draws screenshots for a RenderEngineThreaded with parallel capture.
+    RenderEngineThreaded(CreateInstanceFactory factory, const char* threadName);
+
     void threadMain(CreateInstanceFactory factory);
     void waitUntilInitialized() const;
     static status_t setSchedFifo(bool enabled);
@@ -96,7 +119,9 @@ private:
     /* ------------------------------------------------------------------------
      * Threading
      */
-    const char* const mThreadName = "RenderEngine";
+    const char* const mThreadName;
+    // The number of rows of each band of a gainmap, or 0 to draw gainmaps in one pass.
+    const int32_t mGainmapTileRows;
     // Protects the creation and destruction of mThread.
     mutable std::mutex mThreadMutex;
     std::thread mThread GUARDED_BY(mThreadMutex);
@@ -104,7 +129,43 @@ private:
     std::atomic<bool> mNeedsPostRenderCleanup = false;
 
     using Work = std::function<void(renderengine::RenderEngine&)>;
-    mutable std::queue<Work> mFunctionCalls GUARDED_BY(mThreadMutex);
+
+    // A queue of functions per DisplaySettings::Priority, which also tracks how long functions
+    // waited before they ran.
+    class WorkQueue {
+    public:
+        using Priority = DisplaySettings::Priority;
+
+        void push(Work work) { push(Priority::Composition, std::move(work)); }
+        void push(Priority, Work);
+
+        bool empty() const;
+
+        // Removes the oldest function of the highest priority.
+        std::optional<Work> pop();
+
+        void dump(std::string& result) const;
+
+    private:
+        static constexpr size_t kPriorityCount = ftl::enum_size<Priority>();
+
+        struct QueuedWork {
+            Work work;
+            nsecs_t queueTime;
+        };
+
+        struct QueueLatency {
+            uint64_t count = 0;
+            nsecs_t total = 0;
+            nsecs_t max = 0;
+        };
+
+        // Indexed by Priority.
+        std::array<std::queue<QueuedWork>, kPriorityCount> mQueues;
+        std::array<QueueLatency, kPriorityCount> mLatencies;
+    };
+
+    mutable WorkQueue mFunctionCalls GUARDED_BY(mThreadMutex);
     mutable std::condition_variable mCondition;
 
     // Used to allow select thread safe methods to be accessed without requiring the
@@ -117,6 +178,9 @@ private:
      * Render Engine
      */
     std::unique_ptr<renderengine::RenderEngine> mRenderEngine;
+
+    // Draws with DisplaySettings::Priority::Capture, if parallel capture is enabled.
+    std::unique_ptr<RenderEngineThreaded> mCaptureEngine;
 };
 } // namespace threaded
 } // namespace renderengine
@@ -20,6 +20,7 @@
 #include <tonemap/tonemap.h>
 #include <ui/GraphicTypes.h>
 #include <cstddef>
+#include <vector>
 
 namespace android::shaders {
 
@@ -68,12 +69,23 @@ struct LinearEffect {
 
     enum SkSLType { Shader, ColorFilter };
     SkSLType type = Shader;
+
+    // Whether the OOTF and color transform are looked up in a LUT built by
+    // buildLinearEffectLut(), instead of being evaluated for every pixel. Only supported for
+    // effects where canUseLinearEffectLut() is true.
+    bool sampleLut = false;
+
+    // Whether the gamut conversions are compiled into the shader as constants, and the OOTF is
+    // left out when neither dataspace is HDR, instead of passing them as uniforms. This gives a
+    // faster shader, with different uniforms than an effect that is not specialized.
+    bool specialized = false;
 };
 
 static inline bool operator==(const LinearEffect& lhs, const LinearEffect& rhs) {
     return lhs.inputDataspace == rhs.inputDataspace && lhs.outputDataspace == rhs.outputDataspace &&
             lhs.undoPremultipliedAlpha == rhs.undoPremultipliedAlpha &&
-            lhs.fakeOutputDataspace == rhs.fakeOutputDataspace;
+            lhs.fakeOutputDataspace == rhs.fakeOutputDataspace && lhs.sampleLut == rhs.sampleLut &&
+            lhs.specialized == rhs.specialized;
 }
 
 struct LinearEffectHasher {
@@ -86,7 +98,9 @@ struct LinearEffectHasher {
         size_t result = std::hash<ui::Dataspace>{}(le.inputDataspace);
         result = HashCombine(result, std::hash<ui::Dataspace>{}(le.outputDataspace));
         result = HashCombine(result, std::hash<bool>{}(le.undoPremultipliedAlpha));
-        return HashCombine(result, std::hash<ui::Dataspace>{}(le.fakeOutputDataspace));
+        result = HashCombine(result, std::hash<ui::Dataspace>{}(le.fakeOutputDataspace));
+        result = HashCombine(result, std::hash<bool>{}(le.sampleLut));
+        return HashCombine(result, std::hash<bool>{}(le.specialized));
     }
 };
 
@@ -103,4 +117,34 @@ std::vector<tonemap::ShaderUniform> buildLinearEffectUniforms(
         aidl::android::hardware::graphics::composer3::RenderIntent renderIntent =
                 aidl::android::hardware::graphics::composer3::RenderIntent::TONE_MAP_COLORIMETRIC);
 
+// The specialized effects for the most common dataspace conversions: sRGB to sRGB, PQ to sRGB and
+// HLG to Display P3, with and without undoing premultiplied alpha. RenderEngine compiles these
+// ahead of time.
+std::vector<LinearEffect> getCommonLinearEffects();
+
+// The number of entries along each side of the LUT built by buildLinearEffectLut().
+constexpr size_t kLinearEffectLutSize = 33;
+
+// Whether the effect tone maps HDR content and may sample a LUT, for which LinearEffect::sampleLut
+// may be set.
+bool canUseLinearEffectLut(const LinearEffect& linearEffect);
+
+// Evaluates the OOTF and color transform of the effect for a kLinearEffectLutSize^3 lattice of
+// linear sRGB colors, so that shaders built with LinearEffect::sampleLut can interpolate between
+// them instead. The lattice is evenly spaced after encoding the colors with the PQ inverse EOTF,
+// where 1.0 is 203 nits, so that most entries fall in the range of common content.
+//
+// Returns the linear output colors, with red varying fastest, then green, then blue. The LUT
+// ignores any metadata attached to the buffer, so a ToneMapper that uses it must not be used
+// with a LUT.
+//
+// The shader samples the LUT from a child named in_lut, that holds the colors in a
+// kLinearEffectLutSize^2 x kLinearEffectLutSize image with one slice of constant blue after
+// another, and scales the result by a uniform in_lutGain.
+std::vector<vec3> buildLinearEffectLut(
+        const LinearEffect& linearEffect, const mat4& colorTransform, float maxDisplayLuminance,
+        float currentDisplayLuminanceNits, float maxLuminance,
+        aidl::android::hardware::graphics::composer3::RenderIntent renderIntent =
+                aidl::android::hardware::graphics::composer3::RenderIntent::TONE_MAP_COLORIMETRIC);
+
 } // namespace android::shaders
@@ -18,8 +18,14 @@
 
 #include <tonemap/tonemap.h>
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <optional>
+#include <string>
+#include <utility>
 
 #include <math/mat4.h>
 #include <system/graphics-base-v1.0.h>
@@ -27,6 +33,8 @@
 
 namespace android::shaders {
 
+ColorSpace toColorSpace(ui::Dataspace dataspace);
+
 namespace {
 
 aidl::android::hardware::graphics::common::Dataspace toAidlDataspace(ui::Dataspace dataspace) {
@@ -52,6 +60,77 @@ void generateXYZTransforms(std::string& shader) {
     )");
 }
 
+bool isHdrTransfer(ui::Dataspace dataspace) {
+    const auto transfer = dataspace & HAL_DATASPACE_TRANSFER_MASK;
+    return transfer == HAL_DATASPACE_TRANSFER_ST2084 || transfer == HAL_DATASPACE_TRANSFER_HLG;
+}
+
+// Whether the OOTF changes the colors of the effect. Neither ToneMapper changes SDR content, and
+// ScaleLuminance and NormalizeLuminance cancel out between SDR dataspaces, so the OOTF only
+// converts to XYZ.
+bool needsOOTF(const LinearEffect& linearEffect) {
+    return isHdrTransfer(linearEffect.inputDataspace) ||
+            isHdrTransfer(linearEffect.outputDataspace);
+}
+
+void appendFloat(float value, std::string& shader) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    shader.append(buffer);
+    // SkSL needs a decimal point or an exponent to parse a float literal.
+    if (std::strpbrk(buffer, ".en") == nullptr) {
+        shader.append(".0");
+    }
+}
+
+void appendConstantMatrix(const char* name, const mat3& matrix, std::string& shader) {
+    shader.append("const float3x3 ");
+    shader.append(name);
+    shader.append(" = float3x3(");
+    for (size_t column = 0; column < 3; column++) {
+        for (size_t row = 0; row < 3; row++) {
+            appendFloat(matrix[column][row], shader);
+            shader.append(column == 2 && row == 2 ? ");\n" : ", ");
+        }
+    }
+}
+
+// The same as generateXYZTransforms, with the gamut conversions compiled in as constants.
+void generateSpecializedXYZTransforms(const LinearEffect& linearEffect, std::string& shader) {
+    appendConstantMatrix("kRgbToXyz", ColorSpace::linearExtendedSRGB().getRGBtoXYZ(), shader);
+    appendConstantMatrix("kXyzToSrcRgb", toColorSpace(linearEffect.inputDataspace).getXYZtoRGB(),
+                         shader);
+    shader.append(R"(
+        uniform float4x4 in_colorTransform;
+        float3 ToXYZ(float3 rgb) {
+            return kRgbToXyz * rgb;
+        }
+
+        float3 ToSrcRGB(float3 xyz) {
+            return kXyzToSrcRgb * xyz;
+        }
+
+        float3 ApplyColorTransform(float3 rgb) {
+            return (in_colorTransform * float4(rgb, 1.0)).rgb;
+        }
+    )");
+}
+
+// Leaves out the OOTF and the conversion to XYZ, which buildLinearEffectUniforms folds into
+// in_colorTransform instead.
+void generateSpecializedSdrTransforms(std::string& shader) {
+    shader.append(R"(
+        uniform float4x4 in_colorTransform;
+        float3 OOTF(float3 linearRGB) {
+            return linearRGB;
+        }
+
+        float3 ApplyColorTransform(float3 rgb) {
+            return (in_colorTransform * float4(rgb, 1.0)).rgb;
+        }
+    )");
+}
+
 // Conversion from relative light to absolute light
 // Note that 1.0 == 203 nits.
 void generateLuminanceScalesForOOTF(ui::Dataspace inputDataspace, std::string& shader) {
@@ -174,8 +253,43 @@ void generateOETF(std::string& shader) {
     )");
 }
 
+// Constants of the PQ transfer function, from SMPTE ST 2084.
+constexpr double kPqM1 = 2610.0 / 16384.0;
+constexpr double kPqM2 = 2523.0 / 4096.0 * 128.0;
+constexpr double kPqC1 = 3424.0 / 4096.0;
+constexpr double kPqC2 = 2413.0 / 4096.0 * 32.0;
+constexpr double kPqC3 = 2392.0 / 4096.0 * 32.0;
+constexpr double kPqMaxLuminance = 10000.0;
+
+// Samples the LUT built by buildLinearEffectLut, instead of evaluating OOTF and
+// ApplyColorTransform. The slices of constant blue are laid out side by side, so the LUT is
+// interpolated in red and green by the image's filtering and in blue here.
+void generateLutLookup(std::string& shader) {
+    shader.append(R"(
+        uniform shader in_lut;
+        uniform float in_lutGain;
+        const float kLutSize = )");
+    shader.append(std::to_string(kLinearEffectLutSize));
+    shader.append(R"(.0;
+
+        float3 LutEncode(float3 linear) {
+            float3 y = pow(clamp(linear * (203.0 / 10000.0), 0.0, 1.0), float3(0.1593017578125));
+            return pow((0.8359375 + 18.8515625 * y) / (1.0 + 18.6875 * y), float3(78.84375));
+        }
+
+        float3 LookupLut(float3 linear) {
+            float3 index = LutEncode(linear) * (kLutSize - 1.0);
+            float slice = min(floor(index.b), kLutSize - 2.0);
+            float2 xy = index.rg + 0.5;
+            float3 lower = in_lut.eval(float2(slice * kLutSize, 0.0) + xy).rgb;
+            float3 upper = in_lut.eval(float2((slice + 1.0) * kLutSize, 0.0) + xy).rgb;
+            return mix(lower, upper, index.b - slice) * in_lutGain;
+        }
+    )");
+}
+
 void generateEffectiveOOTF(bool undoPremultipliedAlpha, LinearEffect::SkSLType type,
-                           bool needsCustomOETF, std::string& shader) {
+                           bool needsCustomOETF, bool sampleLut, std::string& shader) {
     switch (type) {
         case LinearEffect::SkSLType::ColorFilter:
             shader.append(R"(
@@ -197,9 +311,15 @@ void generateEffectiveOOTF(bool undoPremultipliedAlpha, LinearEffect::SkSLType t
         )");
     }
     // We are using linear sRGB as a working space, with 1.0 == 203 nits
-    shader.append(R"(
-        c.rgb = ApplyColorTransform(OOTF(toLinearSrgb(c.rgb)));
-    )");
+    if (sampleLut) {
+        shader.append(R"(
+            c.rgb = LookupLut(toLinearSrgb(c.rgb));
+        )");
+    } else {
+        shader.append(R"(
+            c.rgb = ApplyColorTransform(OOTF(toLinearSrgb(c.rgb)));
+        )");
+    }
     if (needsCustomOETF) {
         shader.append(R"(
             c.rgb = OETF(c.rgb);
@@ -228,12 +348,87 @@ std::vector<uint8_t> buildUniformValue(T value) {
     return result;
 }
 
+// The CPU equivalent of ScaleLuminance, generated above.
+float getLuminanceScaleForOOTF(ui::Dataspace inputDataspace) {
+    return (inputDataspace & HAL_DATASPACE_TRANSFER_MASK) == HAL_DATASPACE_TRANSFER_HLG ? 264.96f
+                                                                                        : 203.f;
+}
+
+// The CPU equivalent of NormalizeLuminance, generated above.
+vec3 normalizeLuminanceForOOTF(ui::Dataspace inputDataspace, ui::Dataspace outputDataspace,
+                               float displayMaxLuminance, vec3 xyz) {
+    const auto inputTransfer = inputDataspace & HAL_DATASPACE_TRANSFER_MASK;
+    switch (outputDataspace & HAL_DATASPACE_TRANSFER_MASK) {
+        case HAL_DATASPACE_TRANSFER_ST2084:
+            return xyz / 203.f;
+        case HAL_DATASPACE_TRANSFER_HLG:
+            if (inputTransfer == HAL_DATASPACE_TRANSFER_HLG) {
+                return xyz / 264.96f;
+            }
+            if (xyz.y <= 0.f) {
+                return vec3(0.f);
+            }
+            return xyz * std::pow(xyz.y / 1000.f, -0.2f / 1.2f) / 264.96f;
+        default:
+            if (inputTransfer == HAL_DATASPACE_TRANSFER_HLG ||
+                inputTransfer == HAL_DATASPACE_TRANSFER_ST2084) {
+                return xyz / displayMaxLuminance;
+            }
+            return xyz / 203.f;
+    }
+}
+
+// Transforms xyz colors to linear source colors, then applies the color transform, then
+// transforms to linear extended RGB for skia to color manage.
+mat4 buildColorTransformMatrix(const LinearEffect& linearEffect, const mat4& colorTransform) {
+    const auto outputColorSpace = toColorSpace(linearEffect.outputDataspace);
+    return mat4(ColorSpace::linearExtendedSRGB().getXYZtoRGB()) *
+            // TODO: the color transform ideally should be applied
+            // in the source colorspace, but doing that breaks
+            // renderengine tests
+            mat4(outputColorSpace.getRGBtoXYZ()) * colorTransform *
+            mat4(outputColorSpace.getXYZtoRGB());
+}
+
+tonemap::Metadata buildTonemapMetadata(
+        float maxDisplayLuminance, float currentDisplayLuminanceNits, float maxLuminance,
+        AHardwareBuffer* buffer,
+        aidl::android::hardware::graphics::composer3::RenderIntent renderIntent) {
+    return {.displayMaxLuminance = maxDisplayLuminance,
+            // If the input luminance is unknown, use display luminance (aka,
+            // no-op any luminance changes).
+            // This is expected to only be meaningful for PQ content
+            .contentMaxLuminance = maxLuminance > 0 ? maxLuminance : maxDisplayLuminance,
+            .currentDisplayLuminance = currentDisplayLuminanceNits > 0
+                    ? currentDisplayLuminanceNits
+                    : maxDisplayLuminance,
+            .buffer = buffer,
+            .renderIntent = renderIntent};
+}
+
+// Decodes a LUT coordinate with the PQ EOTF, into linear sRGB where 1.0 is 203 nits.
+double lutDecode(double encoded) {
+    const double e = std::pow(encoded, 1.0 / kPqM2);
+    const double luminance =
+            kPqMaxLuminance * std::pow(std::max(e - kPqC1, 0.0) / (kPqC2 - kPqC3 * e), 1.0 / kPqM1);
+    return luminance / 203.0;
+}
+
 } // namespace
 
 std::string buildLinearEffectSkSL(const LinearEffect& linearEffect) {
     std::string shaderString;
-    generateXYZTransforms(shaderString);
-    generateOOTF(linearEffect.inputDataspace, linearEffect.outputDataspace, shaderString);
+    if (linearEffect.sampleLut) {
+        generateLutLookup(shaderString);
+    } else if (linearEffect.specialized && !needsOOTF(linearEffect)) {
+        generateSpecializedSdrTransforms(shaderString);
+    } else if (linearEffect.specialized) {
+        generateSpecializedXYZTransforms(linearEffect, shaderString);
+        generateOOTF(linearEffect.inputDataspace, linearEffect.outputDataspace, shaderString);
+    } else {
+        generateXYZTransforms(shaderString);
+        generateOOTF(linearEffect.inputDataspace, linearEffect.outputDataspace, shaderString);
+    }
 
     const bool needsCustomOETF = (linearEffect.fakeOutputDataspace & HAL_DATASPACE_TRANSFER_MASK) ==
             HAL_DATASPACE_TRANSFER_GAMMA2_2;
@@ -241,7 +436,7 @@ std::string buildLinearEffectSkSL(const LinearEffect& linearEffect) {
         generateOETF(shaderString);
     }
     generateEffectiveOOTF(linearEffect.undoPremultipliedAlpha, linearEffect.type, needsCustomOETF,
-                          shaderString);
+                          linearEffect.sampleLut, shaderString);
     return shaderString;
 }
 
@@ -278,36 +473,31 @@ std::vector<tonemap::ShaderUniform> buildLinearEffectUniforms(
         aidl::android::hardware::graphics::composer3::RenderIntent renderIntent) {
     std::vector<tonemap::ShaderUniform> uniforms;
 
+    if (linearEffect.specialized && !needsOOTF(linearEffect)) {
+        const mat4 rgbToXyz(ColorSpace::linearExtendedSRGB().getRGBtoXYZ());
+        uniforms.push_back({.name = "in_colorTransform",
+                            .value = buildUniformValue<mat4>(
+                                    buildColorTransformMatrix(linearEffect, colorTransform) *
+                                    rgbToXyz)});
+        return uniforms;
+    }
+
     auto inputColorSpace = toColorSpace(linearEffect.inputDataspace);
-    auto outputColorSpace = toColorSpace(linearEffect.outputDataspace);
-
-    uniforms.push_back(
-            {.name = "in_rgbToXyz",
-             .value = buildUniformValue<mat3>(ColorSpace::linearExtendedSRGB().getRGBtoXYZ())});
-    uniforms.push_back({.name = "in_xyzToSrcRgb",
-                        .value = buildUniformValue<mat3>(inputColorSpace.getXYZtoRGB())});
-    // Transforms xyz colors to linear source colors, then applies the color transform, then
-    // transforms to linear extended RGB for skia to color manage.
+
+    if (!linearEffect.specialized) {
+        uniforms.push_back({.name = "in_rgbToXyz",
+                            .value = buildUniformValue<mat3>(
+                                    ColorSpace::linearExtendedSRGB().getRGBtoXYZ())});
+        uniforms.push_back({.name = "in_xyzToSrcRgb",
+                            .value = buildUniformValue<mat3>(inputColorSpace.getXYZtoRGB())});
+    }
     uniforms.push_back({.name = "in_colorTransform",
                         .value = buildUniformValue<mat4>(
-                                mat4(ColorSpace::linearExtendedSRGB().getXYZtoRGB()) *
-                                // TODO: the color transform ideally should be applied
-                                // in the source colorspace, but doing that breaks
-                                // renderengine tests
-                                mat4(outputColorSpace.getRGBtoXYZ()) * colorTransform *
-                                mat4(outputColorSpace.getXYZtoRGB()))});
-
-    tonemap::Metadata metadata{.displayMaxLuminance = maxDisplayLuminance,
-                               // If the input luminance is unknown, use display luminance (aka,
-                               // no-op any luminance changes).
-                               // This is expected to only be meaningful for PQ content
-                               .contentMaxLuminance =
-                                       maxLuminance > 0 ? maxLuminance : maxDisplayLuminance,
-                               .currentDisplayLuminance = currentDisplayLuminanceNits > 0
-                                       ? currentDisplayLuminanceNits
-                                       : maxDisplayLuminance,
-                               .buffer = buffer,
-                               .renderIntent = renderIntent};
+                                buildColorTransformMatrix(linearEffect, colorTransform))});
+
+    const tonemap::Metadata metadata =
+            buildTonemapMetadata(maxDisplayLuminance, currentDisplayLuminanceNits, maxLuminance,
+                                 buffer, renderIntent);
 
     for (const auto uniform : tonemap::getToneMapper()->generateShaderSkSLUniforms(metadata)) {
         uniforms.push_back(uniform);
@@ -316,4 +506,76 @@ std::vector<tonemap::ShaderUniform> buildLinearEffectUniforms(
     return uniforms;
 }
 
+std::vector<LinearEffect> getCommonLinearEffects() {
+    std::vector<LinearEffect> effects;
+    for (const auto [inputDataspace, outputDataspace] :
+         {std::pair(ui::Dataspace::SRGB, ui::Dataspace::SRGB),
+          std::pair(ui::Dataspace::BT2020_ITU_PQ, ui::Dataspace::SRGB),
+          std::pair(ui::Dataspace::BT2020_HLG, ui::Dataspace::DISPLAY_P3)}) {
+        for (const bool undoPremultipliedAlpha : {false, true}) {
+            effects.push_back({.inputDataspace = inputDataspace,
+                               .outputDataspace = outputDataspace,
+                               .undoPremultipliedAlpha = undoPremultipliedAlpha,
+                               .specialized = true});
+        }
+    }
+    return effects;
+}
+
+bool canUseLinearEffectLut(const LinearEffect& linearEffect) {
+    const auto inputTransfer = linearEffect.inputDataspace & HAL_DATASPACE_TRANSFER_MASK;
+    return linearEffect.type == LinearEffect::SkSLType::Shader &&
+            (inputTransfer == HAL_DATASPACE_TRANSFER_ST2084 ||
+             inputTransfer == HAL_DATASPACE_TRANSFER_HLG);
+}
+
+std::vector<vec3> buildLinearEffectLut(
+        const LinearEffect& linearEffect, const mat4& colorTransform, float maxDisplayLuminance,
+        float currentDisplayLuminanceNits, float maxLuminance,
+        aidl::android::hardware::graphics::composer3::RenderIntent renderIntent) {
+    constexpr size_t kSize = kLinearEffectLutSize;
+    std::array<float, kSize> lattice;
+    for (size_t i = 0; i < kSize; i++) {
+        lattice[i] = static_cast<float>(lutDecode(static_cast<double>(i) / (kSize - 1)));
+    }
+
+    const mat3 rgbToXyz = ColorSpace::linearExtendedSRGB().getRGBtoXYZ();
+    const mat3 xyzToSrcRgb = toColorSpace(linearEffect.inputDataspace).getXYZtoRGB();
+    const float luminanceScale = getLuminanceScaleForOOTF(linearEffect.inputDataspace);
+
+    std::vector<tonemap::Color> colors;
+    colors.reserve(kSize * kSize * kSize);
+    for (size_t b = 0; b < kSize; b++) {
+        for (size_t g = 0; g < kSize; g++) {
+            for (size_t r = 0; r < kSize; r++) {
+                const vec3 xyz = rgbToXyz * (vec3(lattice[r], lattice[g], lattice[b]) *
+                                             luminanceScale);
+                colors.push_back({.linearRGB = xyzToSrcRgb * xyz, .xyz = xyz});
+            }
+        }
+    }
+
+    const tonemap::Metadata metadata =
+            buildTonemapMetadata(maxDisplayLuminance, currentDisplayLuminanceNits, maxLuminance,
+                                 nullptr, renderIntent);
+    const std::vector<tonemap::ToneMapper::Gain> gains =
+            tonemap::getToneMapper()->lookupTonemapGain(toAidlDataspace(
+                                                                linearEffect.inputDataspace),
+                                                        toAidlDataspace(
+                                                                linearEffect.outputDataspace),
+                                                        colors, metadata);
+
+    const mat4 transform = buildColorTransformMatrix(linearEffect, colorTransform);
+    std::vector<vec3> lut;
+    lut.reserve(colors.size());
+    for (size_t i = 0; i < colors.size(); i++) {
+        const vec3 xyz = normalizeLuminanceForOOTF(linearEffect.inputDataspace,
+                                                   linearEffect.outputDataspace,
+                                                   maxDisplayLuminance,
+                                                   colors[i].xyz * static_cast<float>(gains[i]));
+        lut.push_back((transform * vec4(xyz, 1.f)).xyz);
+    }
+    return lut;
+}
+
 } // namespace android::shaders
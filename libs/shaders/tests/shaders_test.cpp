@@ -93,4 +93,80 @@ TEST_F(ShadersTest, buildLinearEffectUniforms_selectsGamutTransformMatrices) {
     EXPECT_THAT(uniforms, Contains(UniformNameEq("in_colorTransform")));
 }
 
+TEST_F(ShadersTest, buildLinearEffectSkSL_specializesSdrEffects) {
+    const shaders::LinearEffect effect{.inputDataspace = ui::Dataspace::V0_SRGB,
+                                       .outputDataspace = ui::Dataspace::DISPLAY_P3,
+                                       .specialized = true};
+
+    const std::string sksl = shaders::buildLinearEffectSkSL(effect);
+    EXPECT_THAT(sksl, testing::Not(HasSubstr("in_rgbToXyz")));
+    EXPECT_THAT(sksl, testing::Not(HasSubstr("libtonemap")));
+
+    // The conversion to XYZ is folded into the color transform.
+    const auto uniforms =
+            shaders::buildLinearEffectUniforms(effect, mat4(), 1.f, 1.f, 1.f, nullptr,
+                                               aidl::android::hardware::graphics::composer3::
+                                                       RenderIntent::COLORIMETRIC);
+    ASSERT_EQ(1u, uniforms.size());
+    EXPECT_EQ("in_colorTransform", uniforms[0].name);
+}
+
+TEST_F(ShadersTest, buildLinearEffectSkSL_specializesHdrEffects) {
+    const shaders::LinearEffect effect{.inputDataspace = ui::Dataspace::BT2020_ITU_PQ,
+                                       .outputDataspace = ui::Dataspace::V0_SRGB,
+                                       .specialized = true};
+
+    const std::string sksl = shaders::buildLinearEffectSkSL(effect);
+    EXPECT_THAT(sksl, HasSubstr("const float3x3 kRgbToXyz = float3x3("));
+    EXPECT_THAT(sksl, HasSubstr("const float3x3 kXyzToSrcRgb = float3x3("));
+    EXPECT_THAT(sksl, testing::Not(HasSubstr("in_rgbToXyz")));
+    EXPECT_THAT(sksl, HasSubstr("libtonemap_LookupTonemapGain"));
+
+    const auto uniforms =
+            shaders::buildLinearEffectUniforms(effect, mat4(), 1.f, 1.f, 1.f, nullptr,
+                                               aidl::android::hardware::graphics::composer3::
+                                                       RenderIntent::COLORIMETRIC);
+    EXPECT_THAT(uniforms, testing::Not(Contains(UniformNameEq("in_rgbToXyz"))));
+    EXPECT_THAT(uniforms, testing::Not(Contains(UniformNameEq("in_xyzToSrcRgb"))));
+    EXPECT_THAT(uniforms, Contains(UniformNameEq("in_colorTransform")));
+    EXPECT_THAT(uniforms, Contains(UniformNameEq("in_libtonemap_displayMaxLuminance")));
+}
+
+TEST_F(ShadersTest, buildLinearEffectSkSL_samplesLut) {
+    const shaders::LinearEffect effect{.inputDataspace = ui::Dataspace::BT2020_ITU_PQ,
+                                       .outputDataspace = ui::Dataspace::V0_SRGB,
+                                       .sampleLut = true};
+    ASSERT_TRUE(shaders::canUseLinearEffectLut(effect));
+
+    const std::string sksl = shaders::buildLinearEffectSkSL(effect);
+    EXPECT_THAT(sksl, HasSubstr("uniform shader in_lut;"));
+    EXPECT_THAT(sksl, HasSubstr("LookupLut(toLinearSrgb(c.rgb))"));
+    EXPECT_THAT(sksl, testing::Not(HasSubstr("libtonemap_LookupTonemapGain")));
+}
+
+TEST_F(ShadersTest, canUseLinearEffectLut_onlyForHdrInputs) {
+    EXPECT_FALSE(shaders::canUseLinearEffectLut({.inputDataspace = ui::Dataspace::V0_SRGB,
+                                                 .outputDataspace = ui::Dataspace::DISPLAY_P3}));
+    EXPECT_TRUE(shaders::canUseLinearEffectLut({.inputDataspace = ui::Dataspace::BT2020_HLG,
+                                                .outputDataspace = ui::Dataspace::V0_SRGB}));
+}
+
+TEST_F(ShadersTest, buildLinearEffectLut_tonemapsGrays) {
+    const shaders::LinearEffect effect{.inputDataspace = ui::Dataspace::BT2020_ITU_PQ,
+                                       .outputDataspace = ui::Dataspace::V0_SRGB,
+                                       .sampleLut = true};
+    constexpr size_t kSize = shaders::kLinearEffectLutSize;
+    const std::vector<vec3> lut =
+            shaders::buildLinearEffectLut(effect, mat4(), 500.f, 500.f, 1000.f);
+    ASSERT_EQ(kSize * kSize * kSize, lut.size());
+
+    const auto gray = [&](size_t i) { return lut[i * kSize * kSize + i * kSize + i]; };
+    EXPECT_NEAR(0.f, gray(0).g, 1e-4f);
+    for (size_t i = 1; i < kSize; i++) {
+        EXPECT_GE(gray(i).g, gray(i - 1).g);
+    }
+    // The brightest content is tone mapped to the brightest the display can show, and not above.
+    EXPECT_NEAR(1.f, gray(kSize - 1).g, 0.05f);
+}
+
 } // namespace android
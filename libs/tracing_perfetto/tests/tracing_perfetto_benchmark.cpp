@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the cost of a trace point with its category disabled, enabled in a Perfetto session,
+// and enabled for atrace.
+
+#include <benchmark/benchmark.h>
+
+#include <optional>
+
+#include "trace_categories.h"
+#include "tracing_perfetto.h"
+#include "utils.h"
+
+namespace tracing_perfetto {
+
+namespace {
+
+using ::perfetto::shlib::test_utils::TracingSession;
+
+enum Backend : int64_t {
+  kNone,
+  kPerfetto,
+  kAtrace,
+};
+
+// The session that enables "input" for the backend that the argument of the benchmark selects.
+std::optional<TracingSession> startSession(benchmark::State& state) {
+  registerWithPerfetto(false /* test */);
+  switch (state.range(0)) {
+    case kPerfetto:
+      return TracingSession::Builder().add_enabled_category("input").Build();
+    case kAtrace:
+      return TracingSession::Builder().add_atrace_category("input").Build();
+    default:
+      return std::nullopt;
+  }
+}
+
+void stopSession(std::optional<TracingSession>& session) {
+  if (session) {
+    session->StopBlocking();
+  }
+}
+
+void BM_isTagEnabled(benchmark::State& state) {
+  std::optional<TracingSession> session = startSession(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(isTagEnabled(TRACE_CATEGORY_INPUT));
+  }
+  stopSession(session);
+}
+BENCHMARK(BM_isTagEnabled)->Arg(kNone)->Arg(kPerfetto)->Arg(kAtrace);
+
+void BM_traceBeginEnd(benchmark::State& state) {
+  std::optional<TracingSession> session = startSession(state);
+  for (auto _ : state) {
+    traceBegin(TRACE_CATEGORY_INPUT, "BM_traceBeginEnd");
+    traceEnd(TRACE_CATEGORY_INPUT);
+  }
+  stopSession(session);
+}
+BENCHMARK(BM_traceBeginEnd)->Arg(kNone)->Arg(kPerfetto)->Arg(kAtrace);
+
+void BM_traceCounter(benchmark::State& state) {
+  std::optional<TracingSession> session = startSession(state);
+  int64_t value = 0;
+  for (auto _ : state) {
+    traceCounter(TRACE_CATEGORY_INPUT, "BM_traceCounter", value++);
+  }
+  stopSession(session);
+}
+BENCHMARK(BM_traceCounter)->Arg(kNone)->Arg(kPerfetto)->Arg(kAtrace);
+
+}  // namespace
+
+}  // namespace tracing_perfetto
+
+BENCHMARK_MAIN();
@@ -223,4 +223,19 @@ TEST_F_WITH_FLAGS(TracingPerfettoTest, traceInstantWithPerfettoAndAtraceConcurre
   verifyAtraceEvent(atrace_trace, event_name);
   verifyAtraceEvent(perfetto_trace, event_name);
 }
+
+TEST_F_WITH_FLAGS(TracingPerfettoTest, isTagEnabledFollowsPerfettoSession,
+                  REQUIRES_FLAGS_ENABLED(PERFETTO_SDK_TRACING)) {
+  // Not a category that atrace would have enabled on the side.
+  const uint64_t category = TRACE_CATEGORY_RRO;
+  ASSERT_FALSE(tracing_perfetto::isTagEnabled(category));
+
+  TracingSession tracing_session =
+      TracingSession::Builder().add_enabled_category("rro").Build();
+  EXPECT_TRUE(tracing_perfetto::isTagEnabled(category));
+  EXPECT_FALSE(tracing_perfetto::isTagEnabled(TRACE_CATEGORY_THERMAL));
+
+  stopSession(tracing_session);
+  EXPECT_FALSE(tracing_perfetto::isTagEnabled(category));
+}
 }  // namespace tracing_perfetto
@@ -158,8 +158,28 @@ struct PerfettoTeCategory* toCategory(uint64_t inCategory) {
   }
 }
 
+/**
+ * Keeps |enabled_perfetto_categories| in sync with the state of a category. |user_arg| is the
+ * TRACE_CATEGORY_* bit of the category.
+ */
+void onCategoryStateChanged(struct PerfettoTeCategoryImpl*, PerfettoDsInstanceIndex, bool enabled,
+                            bool global_state_changed, void* user_arg) {
+  // Only the first session to enable a category, and the last to disable it, change its state.
+  if (!global_state_changed) {
+    return;
+  }
+  const uint64_t bit = reinterpret_cast<uintptr_t>(user_arg);
+  if (enabled) {
+    enabled_perfetto_categories.fetch_or(bit, std::memory_order_relaxed);
+  } else {
+    enabled_perfetto_categories.fetch_and(~bit, std::memory_order_relaxed);
+  }
+}
+
 }  // namespace
 
+alignas(64) std::atomic_uint64_t enabled_perfetto_categories = 0;
+
 bool isPerfettoCategoryEnabled(PerfettoTeCategory* category) {
   return category != nullptr;
 }
@@ -216,7 +236,7 @@ bool shouldPreferAtrace(PerfettoTeCategory *perfettoCategory, uint64_t atraceCat
   return (atraceCategory & prefer_flags.load(std::memory_order_relaxed)) == 0;
 }
 
-struct PerfettoTeCategory* toPerfettoCategory(uint64_t category) {
+struct PerfettoTeCategory* toEnabledPerfettoCategory(uint64_t category) {
   struct PerfettoTeCategory* perfettoCategory = toCategory(category);
   if (perfettoCategory == nullptr) {
     return nullptr;
@@ -239,6 +259,12 @@ void registerWithPerfetto(bool test) {
     PerfettoProducerInit(args);
     PerfettoTeInit();
     PERFETTO_TE_REGISTER_CATEGORIES(FRAMEWORK_CATEGORIES);
+    for (uint64_t bit = TRACE_CATEGORY_ALWAYS; bit <= TRACE_CATEGORY_THERMAL; bit <<= 1) {
+      if (struct PerfettoTeCategory* category = toCategory(bit)) {
+        PerfettoTeCategorySetCallback(category, onCategoryStateChanged,
+                                      reinterpret_cast<void*>(static_cast<uintptr_t>(bit)));
+      }
+    }
   });
 }
 
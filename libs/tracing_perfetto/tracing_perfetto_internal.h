@@ -19,6 +19,9 @@
 
 #include <stdint.h>
 
+#include <atomic>
+
+#include "perfetto/public/compiler.h"
 #include "perfetto/public/te_category_macros.h"
 
 namespace tracing_perfetto {
@@ -27,7 +30,26 @@ namespace internal {
 
 bool isPerfettoRegistered();
 
-struct PerfettoTeCategory* toPerfettoCategory(uint64_t category);
+/**
+ * The TRACE_CATEGORY_* bits of the categories that a Perfetto session has enabled, updated by
+ * the callbacks of the categories. Aligned to a cache line, as every trace point loads it.
+ */
+extern std::atomic_uint64_t enabled_perfetto_categories;
+
+struct PerfettoTeCategory* toEnabledPerfettoCategory(uint64_t category);
+
+/**
+ * Returns the Perfetto category of |category| if it is enabled, nullptr otherwise. A disabled
+ * category costs a relaxed load and a branch; the Perfetto state is only looked at when the bit
+ * is set.
+ */
+inline struct PerfettoTeCategory* toPerfettoCategory(uint64_t category) {
+  if (PERFETTO_LIKELY(
+          !(enabled_perfetto_categories.load(std::memory_order_relaxed) & category))) {
+    return nullptr;
+  }
+  return toEnabledPerfettoCategory(category);
+}
 
 void registerWithPerfetto(bool test = false);
 
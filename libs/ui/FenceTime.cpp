@@ -18,15 +18,166 @@
 
 #define LOG_TAG "FenceTime"
 
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
 #include <cutils/compiler.h>  // For CC_[UN]LIKELY
 #include <utils/Log.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
 
 #include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace android {
 
+// ============================================================================
+// FenceSignalWatcher
+// ============================================================================
+
+// Waits for the fences of pending FenceTimes with a single epoll set on a
+// thread of its own, and caches their signal times in the FenceTimes once they
+// signal. Callers of FenceTime::getSignalTime then read the cached value
+// instead of each making a sync_file ioctl every time they poll.
+class FenceSignalWatcher {
+public:
+    static FenceSignalWatcher& getInstance() {
+        // Never destroyed, since its thread runs until the process exits.
+        static FenceSignalWatcher* const sInstance = new FenceSignalWatcher();
+        return *sInstance;
+    }
+
+    // Watches the fence for the FenceTime. Returns false if the fence can't
+    // be watched, in which case the FenceTime has to keep polling it.
+    bool watch(const sp<Fence>& fence, std::weak_ptr<FenceTime> fenceTime) {
+        if (!mEpollFd.ok()) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (++mWatchesSinceSweep >= kSweepInterval) {
+            sweepLocked();
+        }
+
+        // Several FenceTimes can share a Fence, which is only added once.
+        auto it = mEntries.find(fence.get());
+        if (it != mEntries.end()) {
+            it->second.fenceTimes.push_back(std::move(fenceTime));
+            return true;
+        }
+
+        epoll_event event{.events = EPOLLIN, .data = {.ptr = fence.get()}};
+        if (epoll_ctl(mEpollFd.get(), EPOLL_CTL_ADD, fence->get(), &event) != 0) {
+            ALOGE("Failed to watch fence %d. errno=%d message='%s'", fence->get(), errno,
+                  strerror(errno));
+            return false;
+        }
+        mEntries.emplace(fence.get(), Entry{fence, {std::move(fenceTime)}});
+        return true;
+    }
+
+private:
+    // How many fences are watched between sweeps of the fences whose
+    // FenceTimes have all been destroyed.
+    static constexpr size_t kSweepInterval = 64;
+    static constexpr int kMaxEvents = 16;
+
+    struct Entry {
+        // Keeps the fd of the fence open while it is in the epoll set.
+        sp<Fence> fence;
+        std::vector<std::weak_ptr<FenceTime>> fenceTimes;
+    };
+
+    FenceSignalWatcher() : mEpollFd(epoll_create1(EPOLL_CLOEXEC)) {
+        if (!mEpollFd.ok()) {
+            ALOGE("Failed to create epoll set. errno=%d message='%s'", errno, strerror(errno));
+            return;
+        }
+        std::thread([this] { threadMain(); }).detach();
+    }
+
+    void threadMain() {
+        pthread_setname_np(pthread_self(), "FenceWatcher");
+        epoll_event events[kMaxEvents];
+        while (true) {
+            const int count = epoll_wait(mEpollFd.get(), events, kMaxEvents, -1);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ALOGE("Failed to wait for fences. errno=%d message='%s'", errno,
+                      strerror(errno));
+                return;
+            }
+            for (int i = 0; i < count; i++) {
+                onFenceReady(static_cast<const Fence*>(events[i].data.ptr));
+            }
+        }
+    }
+
+    void onFenceReady(const Fence* key) {
+        sp<Fence> fence;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mEntries.find(key);
+            if (it == mEntries.end()) {
+                return;
+            }
+            fence = it->second.fence;
+        }
+
+        const nsecs_t signalTime = fence->getSignalTime();
+        if (signalTime == Fence::SIGNAL_TIME_PENDING) {
+            return;
+        }
+
+        std::vector<std::weak_ptr<FenceTime>> fenceTimes;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mEntries.find(key);
+            if (it == mEntries.end()) {
+                return;
+            }
+            epoll_ctl(mEpollFd.get(), EPOLL_CTL_DEL, fence->get(), nullptr);
+            fenceTimes = std::move(it->second.fenceTimes);
+            mEntries.erase(it);
+        }
+
+        for (const auto& weakFenceTime : fenceTimes) {
+            if (std::shared_ptr<FenceTime> fenceTime = weakFenceTime.lock()) {
+                fenceTime->applyWatchedSignalTime(signalTime);
+            }
+        }
+    }
+
+    void sweepLocked() REQUIRES(mMutex) {
+        mWatchesSinceSweep = 0;
+        for (auto it = mEntries.begin(); it != mEntries.end();) {
+            auto& fenceTimes = it->second.fenceTimes;
+            std::erase_if(fenceTimes, [](const auto& fenceTime) { return fenceTime.expired(); });
+            if (fenceTimes.empty()) {
+                epoll_ctl(mEpollFd.get(), EPOLL_CTL_DEL, it->second.fence->get(), nullptr);
+                it = mEntries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    const android::base::unique_fd mEpollFd;
+    std::mutex mMutex;
+    std::unordered_map<const Fence*, Entry> mEntries GUARDED_BY(mMutex);
+    size_t mWatchesSinceSweep GUARDED_BY(mMutex) = 0;
+};
+
+namespace {
+std::atomic<bool> gSignalWatcherEnabled = false;
+} // namespace
+
 // ============================================================================
 // FenceTime
 // ============================================================================
@@ -132,6 +283,11 @@ nsecs_t FenceTime::getSignalTime() {
         return signalTime;
     }
 
+    // The watcher caches the signal time once the fence signals.
+    if (mWatched.load(std::memory_order_relaxed)) {
+        return Fence::SIGNAL_TIME_PENDING;
+    }
+
     // Hold a reference to the fence on the stack in case the class'
     // reference is removed by another thread. This prevents the
     // fence from being destroyed until the end of this method, where
@@ -166,11 +322,35 @@ nsecs_t FenceTime::getSignalTime() {
         std::lock_guard<std::mutex> lock(mMutex);
         mFence.clear();
         mSignalTime.store(signalTime, std::memory_order_relaxed);
+        return signalTime;
+    }
+
+    // Let the watcher wait for the fence, rather than polling it again. Only
+    // a FenceTime owned by a shared_ptr can be watched, as the watcher must
+    // not outlive it.
+    if (mState == State::VALID && gSignalWatcherEnabled.load(std::memory_order_relaxed)) {
+        std::weak_ptr<FenceTime> self = weak_from_this();
+        bool watched = false;
+        if (!self.expired() && mWatched.compare_exchange_strong(watched, true)) {
+            if (!FenceSignalWatcher::getInstance().watch(fence, std::move(self))) {
+                mWatched.store(false);
+            }
+        }
     }
 
     return signalTime;
 }
 
+void FenceTime::setSignalWatcherEnabled(bool enabled) {
+    gSignalWatcherEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void FenceTime::applyWatchedSignalTime(nsecs_t signalTime) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFence.clear();
+    mSignalTime.store(signalTime, std::memory_order_relaxed);
+}
+
 nsecs_t FenceTime::getCachedSignalTime() const {
     // memory_order_acquire since we don't have a lock fallback path
     // that will do an acquire.
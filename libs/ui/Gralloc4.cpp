@@ -442,6 +442,15 @@ int Gralloc4Mapper::unlock(buffer_handle_t bufferHandle) const {
     return releaseFence;
 }
 
+status_t Gralloc4Mapper::rereadLockedBuffer(buffer_handle_t bufferHandle) const {
+    auto buffer = const_cast<native_handle_t*>(bufferHandle);
+    auto ret = mMapper->rereadLockedBuffer(buffer);
+
+    auto error = (ret.isOk()) ? static_cast<Error>(ret) : kTransactionError;
+    ALOGE_IF(error != Error::NONE, "rereadLockedBuffer(%p) failed with %d", buffer, error);
+    return static_cast<status_t>(error);
+}
+
 status_t Gralloc4Mapper::isSupported(uint32_t width, uint32_t height, PixelFormat format,
                                      uint32_t layerCount, uint64_t usage,
                                      bool* outSupported) const {
@@ -590,8 +590,11 @@ status_t GraphicBuffer::unflatten(void const*& buffer, size_t& size, int const*&
 
     if (handle != nullptr) {
         buffer_handle_t importedHandle;
-        status_t err = mBufferMapper.importBuffer(handle, uint32_t(width), uint32_t(height),
-                uint32_t(layerCount), format, usage, uint32_t(stride), &importedHandle);
+        // A buffer which the process already has imported, such as one that is sent again by
+        // its producer, shares that import.
+        status_t err = mBufferMapper.importBuffer(handle, mId, mGenerationNumber, uint32_t(width),
+                                                  uint32_t(height), uint32_t(layerCount), format,
+                                                  usage, uint32_t(stride), &importedHandle);
         if (err != NO_ERROR) {
             width = height = stride = format = usage_deprecated = 0;
             layerCount = 0;
@@ -23,6 +23,8 @@
 #include <limits.h>
 #include <stdio.h>
 
+#include <algorithm>
+
 #include <grallocusage/GrallocUsageConversion.h>
 
 #include <android-base/stringprintf.h>
@@ -104,6 +106,26 @@ void GraphicBufferAllocator::dump(std::string& result, bool less) const {
     StringAppendF(&result, "Total allocated by GraphicBufferAllocator (estimate): %.2f KB\n",
                   static_cast<double>(total) / 1024.0);
 
+    const uint64_t poolRequests = mPoolHits + mPoolMisses;
+    StringAppendF(&result,
+                  "Recycling pool: %zu buffers, %.2f KiB of %.2f KiB, timeout %" PRId64
+                  " ms, %" PRIu64 " hits, %" PRIu64 " misses (%.1f%% hit rate)\n",
+                  mPool.size(), static_cast<double>(mPoolSize) / 1024.0,
+                  static_cast<double>(mPoolMaxSize) / 1024.0, ns2ms(mPoolTimeout), mPoolHits,
+                  mPoolMisses,
+                  poolRequests ? 100.0 * static_cast<double>(mPoolHits) / poolRequests : 0.0);
+    result.append("Allocation latency:");
+    for (size_t i = 0; i < kAllocationLatencyBucketCount; i++) {
+        if (i < std::size(kAllocationLatencyBuckets)) {
+            StringAppendF(&result, " <%" PRId64 "us: %" PRIu64,
+                          ns2us(kAllocationLatencyBuckets[i]), mAllocationLatencyHistogram[i]);
+        } else {
+            StringAppendF(&result, " >=%" PRId64 "us: %" PRIu64,
+                          ns2us(kAllocationLatencyBuckets[i - 1]), mAllocationLatencyHistogram[i]);
+        }
+    }
+    result.append("\n");
+
     result.append(mAllocator->dumpDebugInfo(less));
 }
 
@@ -134,6 +156,18 @@ auto GraphicBufferAllocator::allocate(const AllocationRequest& request) -> Alloc
         return AllocationResult(BAD_VALUE);
     }
 
+    const bool recyclable = request.importBuffer && request.extras.empty();
+    if (recyclable) {
+        Mutex::Autolock _l(sLock);
+        buffer_handle_t handle;
+        uint32_t stride;
+        if (takePooledBufferLocked(width, height, request.format, request.layerCount,
+                                   request.usage, &handle, &stride, request.requestorName)) {
+            return AllocationResult(handle, stride);
+        }
+    }
+
+    const nsecs_t startTime = systemTime();
     auto result = mAllocator->allocate(request);
     if (result.status == UNKNOWN_TRANSACTION) {
         if (!request.extras.empty()) {
@@ -147,6 +181,7 @@ auto GraphicBufferAllocator::allocate(const AllocationRequest& request) -> Alloc
                                              request.format, request.layerCount, request.usage,
                                              &result.stride, &result.handle, request.importBuffer);
     }
+    const nsecs_t latency = systemTime() - startTime;
 
     if (result.status != NO_ERROR) {
         ALOGE("Failed to allocate (%u x %u) layerCount %u format %d "
@@ -157,6 +192,8 @@ auto GraphicBufferAllocator::allocate(const AllocationRequest& request) -> Alloc
     }
 
     if (!request.importBuffer) {
+        Mutex::Autolock _l(sLock);
+        recordAllocationLatencyLocked(latency);
         return result;
     }
     size_t bufSize;
@@ -171,6 +208,7 @@ auto GraphicBufferAllocator::allocate(const AllocationRequest& request) -> Alloc
     }
 
     Mutex::Autolock _l(sLock);
+    recordAllocationLatencyLocked(latency);
     KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
     alloc_rec_t rec;
     rec.width = width;
@@ -181,6 +219,7 @@ auto GraphicBufferAllocator::allocate(const AllocationRequest& request) -> Alloc
     rec.usage = request.usage;
     rec.size = bufSize;
     rec.requestorName = request.requestorName;
+    rec.recyclable = recyclable;
     list.add(result.handle, rec);
 
     return result;
@@ -213,8 +252,18 @@ status_t GraphicBufferAllocator::allocateHelper(uint32_t width, uint32_t height,
     // TODO(b/72323293, b/72703005): Remove these invalid bits from callers
     usage &= ~static_cast<uint64_t>((1 << 10) | (1 << 13));
 
+    if (importBuffer) {
+        Mutex::Autolock _l(sLock);
+        if (takePooledBufferLocked(width, height, format, layerCount, usage, handle, stride,
+                                   requestorName)) {
+            return NO_ERROR;
+        }
+    }
+
+    const nsecs_t startTime = systemTime();
     status_t error = mAllocator->allocate(requestorName, width, height, format, layerCount, usage,
                                           stride, handle, importBuffer);
+    const nsecs_t latency = systemTime() - startTime;
     if (error != NO_ERROR) {
         ALOGE("Failed to allocate (%u x %u) layerCount %u format %d "
               "usage %" PRIx64 ": %d",
@@ -223,6 +272,8 @@ status_t GraphicBufferAllocator::allocateHelper(uint32_t width, uint32_t height,
     }
 
     if (!importBuffer) {
+        Mutex::Autolock _l(sLock);
+        recordAllocationLatencyLocked(latency);
         return NO_ERROR;
     }
     size_t bufSize;
@@ -237,6 +288,7 @@ status_t GraphicBufferAllocator::allocateHelper(uint32_t width, uint32_t height,
     }
 
     Mutex::Autolock _l(sLock);
+    recordAllocationLatencyLocked(latency);
     KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
     alloc_rec_t rec;
     rec.width = width;
@@ -247,6 +299,7 @@ status_t GraphicBufferAllocator::allocateHelper(uint32_t width, uint32_t height,
     rec.usage = usage;
     rec.size = bufSize;
     rec.requestorName = std::move(requestorName);
+    rec.recyclable = true;
     list.add(*handle, rec);
 
     return NO_ERROR;
@@ -280,6 +333,17 @@ status_t GraphicBufferAllocator::free(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    std::vector<buffer_handle_t> evicted;
+    bool recycled;
+    {
+        Mutex::Autolock _l(sLock);
+        recycled = recycleLocked(handle, &evicted);
+    }
+    freeEvicted(evicted);
+    if (recycled) {
+        return NO_ERROR;
+    }
+
     // We allocated a buffer from the allocator and imported it into the
     // mapper to get the handle.  We just need to free the handle now.
     mMapper.freeBuffer(handle);
@@ -291,6 +355,122 @@ status_t GraphicBufferAllocator::free(buffer_handle_t handle)
     return NO_ERROR;
 }
 
+void GraphicBufferAllocator::setRecyclingPool(uint64_t maxBytes, nsecs_t timeout) {
+    std::vector<buffer_handle_t> evicted;
+    {
+        Mutex::Autolock _l(sLock);
+        mPoolMaxSize = maxBytes;
+        mPoolTimeout = timeout;
+        trimLocked(&evicted);
+    }
+    freeEvicted(evicted);
+}
+
+void GraphicBufferAllocator::trimRecyclingPool() {
+    std::vector<buffer_handle_t> evicted;
+    {
+        Mutex::Autolock _l(sLock);
+        trimLocked(&evicted);
+    }
+    freeEvicted(evicted);
+}
+
+bool GraphicBufferAllocator::takePooledBufferLocked(uint32_t width, uint32_t height,
+                                                    PixelFormat format, uint32_t layerCount,
+                                                    uint64_t usage, buffer_handle_t* handle,
+                                                    uint32_t* stride,
+                                                    const std::string& requestorName) {
+    if (mPoolMaxSize == 0) {
+        return false;
+    }
+
+    // Hand out the most recently freed match, whose memory is the most likely to still be warm.
+    const auto match = std::find_if(mPool.rbegin(), mPool.rend(), [&](const PooledBuffer& buffer) {
+        return buffer.width == width && buffer.height == height && buffer.format == format &&
+                buffer.layerCount == layerCount && buffer.usage == usage;
+    });
+    if (match == mPool.rend()) {
+        mPoolMisses++;
+        return false;
+    }
+
+    mPoolHits++;
+    *handle = match->handle;
+    *stride = match->stride;
+    mPoolSize -= match->size;
+    mPool.erase(std::next(match).base());
+
+    const ssize_t index = sAllocList.indexOfKey(*handle);
+    if (index >= 0) {
+        sAllocList.editValueAt(index).requestorName = requestorName;
+    }
+    return true;
+}
+
+bool GraphicBufferAllocator::recycleLocked(buffer_handle_t handle,
+                                           std::vector<buffer_handle_t>* evicted) {
+    trimLocked(evicted);
+    if (mPoolMaxSize == 0) {
+        return false;
+    }
+
+    const ssize_t index = sAllocList.indexOfKey(handle);
+    if (index < 0) {
+        return false;
+    }
+    alloc_rec_t& rec = sAllocList.editValueAt(index);
+    if (!rec.recyclable || rec.size > mPoolMaxSize) {
+        return false;
+    }
+
+    while (mPoolSize + rec.size > mPoolMaxSize) {
+        evicted->push_back(mPool.front().handle);
+        mPoolSize -= mPool.front().size;
+        mPool.erase(mPool.begin());
+    }
+
+    mPool.push_back({handle, rec.width, rec.height, rec.stride, rec.format, rec.layerCount,
+                     rec.usage, rec.size, systemTime()});
+    mPoolSize += rec.size;
+    rec.requestorName = "<recycling pool>";
+    return true;
+}
+
+void GraphicBufferAllocator::trimLocked(std::vector<buffer_handle_t>* evicted) {
+    const nsecs_t now = systemTime();
+    const auto expired = [&](const PooledBuffer& buffer) {
+        return mPoolMaxSize == 0 || now - buffer.freeTime > mPoolTimeout;
+    };
+    // The pool is ordered by free time, so the expired buffers are at its front.
+    auto end = mPool.begin();
+    for (; end != mPool.end() && expired(*end); ++end) {
+        evicted->push_back(end->handle);
+        mPoolSize -= end->size;
+    }
+    mPool.erase(mPool.begin(), end);
+}
+
+void GraphicBufferAllocator::freeEvicted(const std::vector<buffer_handle_t>& evicted) {
+    if (evicted.empty()) {
+        return;
+    }
+    for (buffer_handle_t handle : evicted) {
+        mMapper.freeBuffer(handle);
+    }
+    Mutex::Autolock _l(sLock);
+    for (buffer_handle_t handle : evicted) {
+        sAllocList.removeItem(handle);
+    }
+}
+
+void GraphicBufferAllocator::recordAllocationLatencyLocked(nsecs_t latency) {
+    const size_t bucket = static_cast<size_t>(
+            std::upper_bound(std::begin(kAllocationLatencyBuckets),
+                             std::end(kAllocationLatencyBuckets), latency) -
+            std::begin(kAllocationLatencyBuckets));
+    mAllocationLatencyHistogram[bucket]++;
+}
+
 bool GraphicBufferAllocator::supportsAdditionalOptions() const {
     return mAllocator->supportsAdditionalOptions();
 }
@@ -41,6 +41,8 @@
 
 #include <system/graphics.h>
 
+#include <sys/stat.h>
+
 using unique_fd = ::android::base::unique_fd;
 
 namespace android {
@@ -50,6 +52,26 @@ using LockResult = GraphicBufferMapper::LockResult;
 
 ANDROID_SINGLETON_STATIC_INSTANCE( GraphicBufferMapper )
 
+namespace {
+
+// Whether the fds of both handles refer to the same files. The ID of a buffer comes from its
+// sender, so an import is only shared with a handle that is actually for the same buffer.
+bool sameFiles(const native_handle_t* a, const native_handle_t* b) {
+    if (a->numFds == 0 || a->numFds != b->numFds) {
+        return false;
+    }
+    for (int i = 0; i < a->numFds; i++) {
+        struct stat statA, statB;
+        if (fstat(a->data[i], &statA) != 0 || fstat(b->data[i], &statB) != 0 ||
+            statA.st_dev != statB.st_dev || statA.st_ino != statB.st_ino) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
 void GraphicBufferMapper::preloadHal() {
     Gralloc2Mapper::preload();
     Gralloc3Mapper::preload();
@@ -119,6 +141,58 @@ status_t GraphicBufferMapper::importBuffer(const native_handle_t* rawHandle, uin
     return NO_ERROR;
 }
 
+status_t GraphicBufferMapper::importBuffer(const native_handle_t* rawHandle, uint64_t bufferId,
+                                           uint32_t generationNumber, uint32_t width,
+                                           uint32_t height, uint32_t layerCount, PixelFormat format,
+                                           uint64_t usage, uint32_t stride,
+                                           buffer_handle_t* outHandle) {
+    ATRACE_CALL();
+
+    const ImportKey key{bufferId, generationNumber};
+    buffer_handle_t sharedHandle;
+    {
+        std::lock_guard lock(mImportMutex);
+        sharedHandle = acquireImportLocked(key, rawHandle);
+    }
+    if (sharedHandle != nullptr) {
+        // The description that came with the handle is still checked, as for a new import.
+        status_t error = mMapper->validateBufferSize(sharedHandle, width, height, format,
+                                                     layerCount, usage, stride);
+        if (error != NO_ERROR) {
+            ALOGE("validateBufferSize(%p) failed: %d", rawHandle, error);
+            freeBuffer(sharedHandle);
+            return static_cast<status_t>(error);
+        }
+        *outHandle = sharedHandle;
+        return NO_ERROR;
+    }
+
+    buffer_handle_t bufferHandle;
+    status_t error = importBuffer(rawHandle, width, height, layerCount, format, usage, stride,
+                                  &bufferHandle);
+    if (error != NO_ERROR) {
+        return error;
+    }
+
+    std::lock_guard lock(mImportMutex);
+    // If another thread imported the buffer meanwhile, this import is simply not shared.
+    if (mImportedBuffers.try_emplace(key, ImportedBuffer{bufferHandle, 1}).second) {
+        mImportKeys.emplace(bufferHandle, key);
+    }
+    *outHandle = bufferHandle;
+    return NO_ERROR;
+}
+
+buffer_handle_t GraphicBufferMapper::acquireImportLocked(const ImportKey& key,
+                                                         const native_handle_t* rawHandle) {
+    auto it = mImportedBuffers.find(key);
+    if (it == mImportedBuffers.end() || !sameFiles(rawHandle, it->second.handle)) {
+        return nullptr;
+    }
+    it->second.refCount++;
+    return it->second.handle;
+}
+
 status_t GraphicBufferMapper::importBufferNoValidate(const native_handle_t* rawHandle,
                                                      buffer_handle_t* outHandle) {
     return mMapper->importBuffer(rawHandle, outHandle);
@@ -134,6 +208,18 @@ status_t GraphicBufferMapper::freeBuffer(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    {
+        std::lock_guard lock(mImportMutex);
+        if (auto keyIt = mImportKeys.find(handle); keyIt != mImportKeys.end()) {
+            auto it = mImportedBuffers.find(keyIt->second);
+            if (--it->second.refCount > 0) {
+                return NO_ERROR;
+            }
+            mImportedBuffers.erase(it);
+            mImportKeys.erase(keyIt);
+        }
+    }
+
     mMapper->freeBuffer(handle);
 
     return NO_ERROR;
@@ -223,6 +309,11 @@ status_t GraphicBufferMapper::lockAsyncYCbCr(buffer_handle_t handle, uint32_t us
     return OK;
 }
 
+status_t GraphicBufferMapper::rereadLockedBuffer(buffer_handle_t handle) {
+    ATRACE_CALL();
+    return mMapper->rereadLockedBuffer(handle);
+}
+
 status_t GraphicBufferMapper::isSupported(uint32_t width, uint32_t height,
                                           android::PixelFormat format, uint32_t layerCount,
                                           uint64_t usage, bool* outSupported) {
@@ -19,6 +19,14 @@
 #include <inttypes.h>
 #include <limits.h>
 
+#include <algorithm>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <android-base/stringprintf.h>
 
 #include <utils/Log.h>
@@ -66,6 +74,164 @@ const Region Region::INVALID_REGION(Rect::INVALID_RECT);
 
 // ----------------------------------------------------------------------------
 
+namespace {
+
+bool containsRect(const Rect& outer, const Rect& inner) {
+    return outer.left <= inner.left && outer.top <= inner.top && outer.right >= inner.right &&
+            outer.bottom >= inner.bottom;
+}
+
+// Most regions only hold a handful of rects, and many operations on them have a result that
+// follows from the bounds of the operands alone. This handles those without running the sweep,
+// producing the same rects the sweep would. rhsBounds already includes any offset of rhs, and
+// assignRhs sets dst to the (offset) rhs. Returns false if the sweep is needed.
+template <typename AssignRhs>
+bool trivialBooleanOperation(uint32_t op, Region& dst, const Region& lhs, const Rect& rhsBounds,
+                             bool rhsIsRect, AssignRhs assignRhs) {
+    const Rect lhsBounds = lhs.getBounds();
+    const bool lhsEmpty = lhsBounds.isEmpty();
+    const bool rhsEmpty = rhsBounds.isEmpty();
+    const bool lhsIsRect = lhs.isRect();
+    Rect intersection;
+    const bool intersects = !lhsEmpty && !rhsEmpty && lhsBounds.intersect(rhsBounds, &intersection);
+
+    const auto assignLhs = [&] {
+        if (lhsEmpty) {
+            dst.clear();
+        } else {
+            dst = lhs;
+        }
+    };
+
+    switch (op) {
+        case op_and:
+            if (!intersects) {
+                dst.clear();
+            } else if (lhsIsRect && rhsIsRect) {
+                dst.set(intersection);
+            } else if (rhsIsRect && containsRect(rhsBounds, lhsBounds)) {
+                assignLhs();
+            } else if (lhsIsRect && containsRect(lhsBounds, rhsBounds)) {
+                assignRhs();
+            } else {
+                return false;
+            }
+            return true;
+
+        case op_or:
+            if (rhsEmpty) {
+                assignLhs();
+            } else if (lhsEmpty) {
+                assignRhs();
+            } else if (rhsIsRect && containsRect(rhsBounds, lhsBounds)) {
+                dst.set(rhsBounds);
+            } else if (lhsIsRect && containsRect(lhsBounds, rhsBounds)) {
+                dst = lhs;
+            } else if (lhsIsRect && rhsIsRect && lhsBounds.left == rhsBounds.left &&
+                       lhsBounds.right == rhsBounds.right && lhsBounds.top <= rhsBounds.bottom &&
+                       rhsBounds.top <= lhsBounds.bottom) {
+                // Stacked rects of the same width, overlapping or touching.
+                dst.set(Rect(lhsBounds.left, std::min(lhsBounds.top, rhsBounds.top),
+                             lhsBounds.right, std::max(lhsBounds.bottom, rhsBounds.bottom)));
+            } else if (lhsIsRect && rhsIsRect && lhsBounds.top == rhsBounds.top &&
+                       lhsBounds.bottom == rhsBounds.bottom && lhsBounds.left <= rhsBounds.right &&
+                       rhsBounds.left <= lhsBounds.right) {
+                // Side by side rects of the same height, overlapping or touching.
+                dst.set(Rect(std::min(lhsBounds.left, rhsBounds.left), lhsBounds.top,
+                             std::max(lhsBounds.right, rhsBounds.right), lhsBounds.bottom));
+            } else {
+                return false;
+            }
+            return true;
+
+        case op_nand:
+            if (lhsEmpty) {
+                dst.clear();
+            } else if (!intersects) {
+                dst = lhs;
+            } else if (rhsIsRect && containsRect(rhsBounds, lhsBounds)) {
+                dst.clear();
+            } else if (lhsIsRect && rhsIsRect && rhsBounds.left <= lhsBounds.left &&
+                       rhsBounds.right >= lhsBounds.right) {
+                // The rhs spans the whole width, so it cuts the top or the bottom off.
+                if (rhsBounds.top <= lhsBounds.top) {
+                    dst.set(Rect(lhsBounds.left, rhsBounds.bottom, lhsBounds.right,
+                                 lhsBounds.bottom));
+                } else if (rhsBounds.bottom >= lhsBounds.bottom) {
+                    dst.set(Rect(lhsBounds.left, lhsBounds.top, lhsBounds.right, rhsBounds.top));
+                } else {
+                    return false;
+                }
+            } else if (lhsIsRect && rhsIsRect && rhsBounds.top <= lhsBounds.top &&
+                       rhsBounds.bottom >= lhsBounds.bottom) {
+                // The rhs spans the whole height, so it cuts the left or the right off.
+                if (rhsBounds.left <= lhsBounds.left) {
+                    dst.set(Rect(rhsBounds.right, lhsBounds.top, lhsBounds.right,
+                                 lhsBounds.bottom));
+                } else if (rhsBounds.right >= lhsBounds.right) {
+                    dst.set(Rect(lhsBounds.left, lhsBounds.top, rhsBounds.left, lhsBounds.bottom));
+                } else {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+            return true;
+
+        case op_xor:
+            if (rhsEmpty) {
+                assignLhs();
+            } else if (lhsEmpty) {
+                assignRhs();
+            } else {
+                return false;
+            }
+            return true;
+    }
+    return false;
+}
+
+// Returns true if each of the count rects starting at p covers the same columns as the rect at
+// the same index starting at q.
+inline bool haveSameColumns(const Rect* p, const Rect* q, size_t count) {
+    static_assert(sizeof(Rect) == 4 * sizeof(int32_t));
+#if defined(__aarch64__)
+    // Only compare left and right, lanes 0 and 2.
+    const uint32x4_t columns = {~0u, 0u, ~0u, 0u};
+    for (; count; count--, p++, q++) {
+        const uint32x4_t diff = veorq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(p)),
+                                          vld1q_u32(reinterpret_cast<const uint32_t*>(q)));
+        if (vmaxvq_u32(vandq_u32(diff, columns))) {
+            return false;
+        }
+    }
+    return true;
+#elif defined(__SSE2__)
+    // Only compare left and right, the bytes of lanes 0 and 2.
+    constexpr int kColumnsMask = 0x0F0F;
+    for (; count; count--, p++, q++) {
+        const __m128i equal =
+                _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                                _mm_loadu_si128(reinterpret_cast<const __m128i*>(q)));
+        if ((_mm_movemask_epi8(equal) & kColumnsMask) != kColumnsMask) {
+            return false;
+        }
+    }
+    return true;
+#else
+    for (; count; count--, p++, q++) {
+        if ((p->left != q->left) || (p->right != q->right)) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+
 Region::Region() {
     mStorage.push_back(Rect(0, 0));
 }
@@ -535,15 +701,7 @@ void Region::rasterizer::flushSpan()
         Rect const* p = span.data();
         Rect const* q = head;
         if (p->top == q->bottom) {
-            merge = true;
-            while (q != tail) {
-                if ((p->left != q->left) || (p->right != q->right)) {
-                    merge = false;
-                    break;
-                }
-                p++;
-                q++;
-            }
+            merge = haveSameColumns(p, q, span.size());
         }
     }
     if (merge) {
@@ -653,6 +811,17 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     validate(dst, "boolean_operation (before): dst");
 #endif
 
+#if !VALIDATE_WITH_CORECG
+    Rect rhsBounds = rhs.getBounds();
+    rhsBounds.offsetBy(dx, dy);
+    if (trivialBooleanOperation(op, dst, lhs, rhsBounds, rhs.isRect(), [&] {
+            dst = rhs;
+            dst.translateSelf(dx, dy);
+        })) {
+        return;
+    }
+#endif
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -767,6 +936,12 @@ void Region::boolean_operation(uint32_t op, Region& dst,
 #if VALIDATE_WITH_CORECG || defined(VALIDATE_REGIONS)
     boolean_operation(op, dst, lhs, Region(rhs), dx, dy);
 #else
+    Rect rhsBounds = rhs;
+    rhsBounds.offsetBy(dx, dy);
+    if (trivialBooleanOperation(op, dst, lhs, rhsBounds, true, [&] { dst.set(rhsBounds); })) {
+        return;
+    }
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
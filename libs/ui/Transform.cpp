@@ -19,6 +19,12 @@
 
 #include <math.h>
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <android-base/stringprintf.h>
 #include <cutils/compiler.h>
 #include <ui/Region.h>
@@ -43,6 +49,110 @@ Transform::~Transform() = default;
 
 static const float EPSILON = 0.0f;
 
+namespace {
+
+static_assert(sizeof(Rect) == 4 * sizeof(int32_t));
+static_assert(sizeof(vec2) == 2 * sizeof(float));
+
+Rect boundsToRect(float left, float top, float right, float bottom, bool roundOutwards) {
+    Rect r;
+    if (roundOutwards) {
+        r.left   = static_cast<int32_t>(floorf(left));
+        r.top    = static_cast<int32_t>(floorf(top));
+        r.right  = static_cast<int32_t>(ceilf(right));
+        r.bottom = static_cast<int32_t>(ceilf(bottom));
+    } else {
+        r.left   = static_cast<int32_t>(floorf(left + 0.5f));
+        r.top    = static_cast<int32_t>(floorf(top + 0.5f));
+        r.right  = static_cast<int32_t>(floorf(right + 0.5f));
+        r.bottom = static_cast<int32_t>(floorf(bottom + 0.5f));
+    }
+    return r;
+}
+
+// Each corner of the rect only moves by the translation, so its bounds are those of two of them.
+Rect translateRect(const Rect& bounds, float tx, float ty, bool roundOutwards) {
+    const float l = static_cast<float>(bounds.left) + tx;
+    const float t = static_cast<float>(bounds.top) + ty;
+    const float r = static_cast<float>(bounds.right) + tx;
+    const float b = static_cast<float>(bounds.bottom) + ty;
+    return boundsToRect(std::min(l, r), std::min(t, b), std::max(l, r), std::max(t, b),
+                        roundOutwards);
+}
+
+#if defined(__SSE2__) && !defined(__aarch64__)
+// SSE2 has no floor, so truncate and step down where that rounded up.
+__m128i floorToInt(__m128 v) {
+    const __m128i truncated = _mm_cvttps_epi32(v);
+    const __m128 roundedUp = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), v);
+    return _mm_add_epi32(truncated, _mm_castps_si128(roundedUp));
+}
+#endif
+
+void translateRects(const Rect* in, Rect* out, size_t count, float tx, float ty,
+                    bool roundOutwards) {
+#if defined(__aarch64__)
+    // The lanes hold left, top, right and bottom.
+    const float32x4_t offset = {tx, ty, tx, ty};
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    for (; count; count--, in++, out++) {
+        const float32x4_t v =
+                vaddq_f32(vcvtq_f32_s32(vld1q_s32(reinterpret_cast<const int32_t*>(in))), offset);
+        const float32x4_t swapped = vextq_f32(v, v, 2);
+        const float32x4_t bounds = vcombine_f32(vget_low_f32(vminq_f32(v, swapped)),
+                                                vget_high_f32(vmaxq_f32(v, swapped)));
+        const float32x4_t rounded = roundOutwards
+                ? vcombine_f32(vget_low_f32(vrndmq_f32(bounds)), vget_high_f32(vrndpq_f32(bounds)))
+                : vrndmq_f32(vaddq_f32(bounds, half));
+        vst1q_s32(reinterpret_cast<int32_t*>(out), vcvtq_s32_f32(rounded));
+    }
+#elif defined(__SSE2__)
+    // The lanes hold left, top, right and bottom. Rounding right and bottom outwards is done by
+    // flooring their negation, which the sign lanes flip before and after.
+    const __m128 offset = _mm_setr_ps(tx, ty, tx, ty);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i signLanes = roundOutwards ? _mm_setr_epi32(0, 0, -1, -1) : _mm_setzero_si128();
+    const __m128 signBits = _mm_castsi128_ps(_mm_slli_epi32(signLanes, 31));
+    for (; count; count--, in++, out++) {
+        const __m128 v = _mm_add_ps(
+                _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))), offset);
+        const __m128 swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+        const __m128 bounds = _mm_shuffle_ps(_mm_min_ps(v, swapped), _mm_max_ps(v, swapped),
+                                             _MM_SHUFFLE(3, 2, 1, 0));
+        const __m128i rounded = roundOutwards
+                ? floorToInt(_mm_xor_ps(bounds, signBits))
+                : floorToInt(_mm_add_ps(bounds, half));
+        const __m128i r = _mm_sub_epi32(_mm_xor_si128(rounded, signLanes), signLanes);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), r);
+    }
+#else
+    for (; count; count--, in++, out++) {
+        *out = translateRect(*in, tx, ty, roundOutwards);
+    }
+#endif
+}
+
+void translatePoints(const vec2* in, vec2* out, size_t count, float tx, float ty) {
+#if defined(__aarch64__)
+    const float32x4_t offset = {tx, ty, tx, ty};
+    for (; count >= 2; count -= 2, in += 2, out += 2) {
+        const float32x4_t v = vld1q_f32(reinterpret_cast<const float*>(in));
+        vst1q_f32(reinterpret_cast<float*>(out), vaddq_f32(v, offset));
+    }
+#elif defined(__SSE2__)
+    const __m128 offset = _mm_setr_ps(tx, ty, tx, ty);
+    for (; count >= 2; count -= 2, in += 2, out += 2) {
+        const __m128 v = _mm_loadu_ps(reinterpret_cast<const float*>(in));
+        _mm_storeu_ps(reinterpret_cast<float*>(out), _mm_add_ps(v, offset));
+    }
+#endif
+    for (; count; count--, in++, out++) {
+        *out = vec2((*in)[0] + tx, (*in)[1] + ty);
+    }
+}
+
+} // namespace
+
 bool Transform::isZero(float f) {
     return fabs(f) <= EPSILON;
 }
@@ -67,7 +177,27 @@ Transform Transform::operator*(const Transform& rhs) const {
     if (rhs.mType == IDENTITY)
         return r;
 
-    // TODO: we could use mType to optimize the matrix multiply
+    // Composing with a translation only offsets the translation of the other transform, which
+    // keeps its 2x2 part and so its orientation.
+    if (type() <= TRANSLATE && isAffine() && rhs.isAffine()) {
+        r = rhs;
+        r.mMatrix[2][0] += tx();
+        r.mMatrix[2][1] += ty();
+        r.mType = rhs.type() & ~TRANSLATE;
+        if (!isZero(r.tx()) || !isZero(r.ty())) r.mType |= TRANSLATE;
+        return r;
+    }
+    if (rhs.type() <= TRANSLATE && isAffine() && rhs.isAffine()) {
+        const mat33& A(mMatrix);
+        const float x = rhs.tx();
+        const float y = rhs.ty();
+        r.mMatrix[2][0] = A[0][0]*x + A[1][0]*y + A[2][0];
+        r.mMatrix[2][1] = A[0][1]*x + A[1][1]*y + A[2][1];
+        r.mType = type() & ~TRANSLATE;
+        if (!isZero(r.tx()) || !isZero(r.ty())) r.mType |= TRANSLATE;
+        return r;
+    }
+
     const mat33& A(mMatrix);
     const mat33& B(rhs.mMatrix);
           mat33& D(r.mMatrix);
@@ -233,6 +363,9 @@ void Transform::set(const std::array<float, 9>& matrix) {
 }
 
 vec2 Transform::transform(const vec2& v) const {
+    if (type() <= TRANSLATE) {
+        return vec2(v[0] + tx(), v[1] + ty());
+    }
     vec2 r;
     const mat33& M(mMatrix);
     r[0] = M[0][0]*v[0] + M[1][0]*v[1] + M[2][0];
@@ -258,30 +391,44 @@ Rect Transform::makeBounds(int w, int h) const {
 }
 
 Rect Transform::transform(const Rect& bounds, bool roundOutwards) const {
-    Rect r;
-    vec2 lt( bounds.left,  bounds.top    );
-    vec2 rt( bounds.right, bounds.top    );
-    vec2 lb( bounds.left,  bounds.bottom );
-    vec2 rb( bounds.right, bounds.bottom );
+    if (type() <= TRANSLATE) {
+        return translateRect(bounds, tx(), ty(), roundOutwards);
+    }
 
-    lt = transform(lt);
-    rt = transform(rt);
-    lb = transform(lb);
-    rb = transform(rb);
+    const vec2 lt = transform(vec2(bounds.left, bounds.top));
+    const vec2 rb = transform(vec2(bounds.right, bounds.bottom));
+    if (preserveRects()) {
+        // Opposite corners stay opposite when the edges stay axis-aligned.
+        return boundsToRect(std::min(lt[0], rb[0]), std::min(lt[1], rb[1]),
+                            std::max(lt[0], rb[0]), std::max(lt[1], rb[1]), roundOutwards);
+    }
 
-    if (roundOutwards) {
-        r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]})));
-        r.top    = static_cast<int32_t>(floorf(std::min({lt[1], rt[1], lb[1], rb[1]})));
-        r.right  = static_cast<int32_t>(ceilf(std::max({lt[0], rt[0], lb[0], rb[0]})));
-        r.bottom = static_cast<int32_t>(ceilf(std::max({lt[1], rt[1], lb[1], rb[1]})));
-    } else {
-        r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]}) + 0.5f));
-        r.top    = static_cast<int32_t>(floorf(std::min({lt[1], rt[1], lb[1], rb[1]}) + 0.5f));
-        r.right  = static_cast<int32_t>(floorf(std::max({lt[0], rt[0], lb[0], rb[0]}) + 0.5f));
-        r.bottom = static_cast<int32_t>(floorf(std::max({lt[1], rt[1], lb[1], rb[1]}) + 0.5f));
+    const vec2 rt = transform(vec2(bounds.right, bounds.top));
+    const vec2 lb = transform(vec2(bounds.left, bounds.bottom));
+    return boundsToRect(std::min({lt[0], rt[0], lb[0], rb[0]}),
+                        std::min({lt[1], rt[1], lb[1], rb[1]}),
+                        std::max({lt[0], rt[0], lb[0], rb[0]}),
+                        std::max({lt[1], rt[1], lb[1], rb[1]}), roundOutwards);
+}
+
+void Transform::transform(const Rect* in, Rect* out, size_t count, bool roundOutwards) const {
+    if (type() <= TRANSLATE) {
+        translateRects(in, out, count, tx(), ty(), roundOutwards);
+        return;
     }
+    for (; count; count--, in++, out++) {
+        *out = transform(*in, roundOutwards);
+    }
+}
 
-    return r;
+void Transform::transform(const vec2* in, vec2* out, size_t count) const {
+    if (type() <= TRANSLATE) {
+        translatePoints(in, out, count, tx(), ty());
+        return;
+    }
+    for (; count; count--, in++, out++) {
+        *out = transform(*in);
+    }
 }
 
 FloatRect Transform::transform(const FloatRect& bounds) const {
@@ -324,6 +471,11 @@ Region Transform::transform(const Region& reg) const {
     return out;
 }
 
+bool Transform::isAffine() const {
+    const mat33& M(mMatrix);
+    return M[0][2] == 0.0f && M[1][2] == 0.0f && M[2][2] == 1.0f;
+}
+
 uint32_t Transform::type() const {
     if (mType & UNKNOWN_TYPE) {
         // recompute what this transform is
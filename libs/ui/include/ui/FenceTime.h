@@ -23,18 +23,21 @@
 #include <utils/Timers.h>
 
 #include <atomic>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
 
 namespace android {
 
+class FenceSignalWatcher;
 class FenceToFenceTimeMap;
 
 // A wrapper around fence that only implements isValid and getSignalTime.
 // It automatically closes the fence in a thread-safe manner once the signal
 // time is known.
-class FenceTime {
+class FenceTime : public std::enable_shared_from_this<FenceTime> {
+friend class FenceSignalWatcher;
 friend class FenceToFenceTimeMap;
 public:
     // An atomic snapshot of the FenceTime that is flattenable.
@@ -104,8 +107,17 @@ public:
 
     // Attempts to get the timestamp from the Fence if the timestamp isn't
     // already cached. Otherwise, it returns the cached value.
+    //
+    // If the signal watcher is enabled, a FenceTime owned by a shared_ptr that
+    // is found pending is handed to the watcher. The watcher waits for the
+    // fence on its own thread and caches the timestamp once it signals, so
+    // that later calls don't poll the Fence.
     nsecs_t getSignalTime();
 
+    // Enables the signal watcher for the process. It is off by default, as it
+    // runs a thread of its own.
+    static void setSignalWatcherEnabled(bool enabled);
+
     // Gets the cached timestamp without attempting to query the Fence.
     nsecs_t getCachedSignalTime() const;
 
@@ -134,6 +146,12 @@ private:
 
     const State mState{State::INVALID};
 
+    // Called by the FenceSignalWatcher once the fence has signaled.
+    void applyWatchedSignalTime(nsecs_t signalTime);
+
+    // Whether the FenceSignalWatcher waits for the fence.
+    std::atomic<bool> mWatched{false};
+
     // mMutex guards mFence and mSignalTime.
     // mSignalTime is also atomic since it is sometimes read outside the lock
     // for quick checks.
@@ -72,6 +72,14 @@ public:
     // owned by the caller
     virtual int unlock(buffer_handle_t bufferHandle) const = 0;
 
+    // rereadLockedBuffer invalidates the CPU caches of a buffer that is locked for reading, so
+    // that the data written to it since it was locked becomes visible. The caller must have
+    // waited for the writes to complete. Only supported by gralloc 4.0+, INVALID_OPERATION is
+    // returned otherwise.
+    virtual status_t rereadLockedBuffer(buffer_handle_t /*bufferHandle*/) const {
+        return INVALID_OPERATION;
+    }
+
     // isSupported queries whether or not a buffer with the given width, height,
     // format, layer count, and usage can be allocated on the device.  If
     // *outSupported is set to true, a buffer with the given specifications may be successfully
@@ -65,6 +65,8 @@ public:
 
     int unlock(buffer_handle_t bufferHandle) const override;
 
+    status_t rereadLockedBuffer(buffer_handle_t bufferHandle) const override;
+
     status_t isSupported(uint32_t width, uint32_t height, PixelFormat format, uint32_t layerCount,
                          uint64_t usage, bool* outSupported) const override;
 
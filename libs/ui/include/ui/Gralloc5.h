@@ -57,6 +57,8 @@ public:
 
     [[nodiscard]] int unlock(buffer_handle_t bufferHandle) const override;
 
+    [[nodiscard]] status_t rereadLockedBuffer(buffer_handle_t bufferHandle) const override;
+
     [[nodiscard]] status_t isSupported(uint32_t width, uint32_t height, PixelFormat format,
                                        uint32_t layerCount, uint64_t usage,
                                        bool *outSupported) const override;
@@ -20,6 +20,7 @@
 
 #include <stdint.h>
 
+#include <iterator>
 #include <memory>
 #include <string>
 #include <vector>
@@ -32,6 +33,7 @@
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/Singleton.h>
+#include <utils/Timers.h>
 
 namespace android {
 
@@ -102,6 +104,25 @@ public:
 
     status_t free(buffer_handle_t handle);
 
+    /**
+     * Enables recycling of freed buffers. Buffers that are allocated and imported without
+     * additional options are kept in a pool of at most maxBytes when they are freed, for at most
+     * timeout, and allocate() hands them out again for requests of the same width, height, format,
+     * layer count and usage instead of calling into the allocator.
+     *
+     * A recycled buffer keeps its contents and any metadata that was set on it, so this should
+     * only be enabled by processes that don't depend on either being reset.
+     *
+     * A maxBytes of 0, the default, disables recycling and frees the pooled buffers.
+     */
+    void setRecyclingPool(uint64_t maxBytes, nsecs_t timeout);
+
+    /**
+     * Frees the pooled buffers that have been in the pool for longer than its timeout. This also
+     * happens as buffers are allocated and freed.
+     */
+    void trimRecyclingPool();
+
     uint64_t getTotalSize() const;
 
     void dump(std::string& res, bool less = true) const;
@@ -119,8 +140,48 @@ protected:
         uint64_t usage;
         size_t size;
         std::string requestorName;
+        // Whether the buffer may be recycled when it is freed
+        bool recyclable = false;
+    };
+
+    struct PooledBuffer {
+        buffer_handle_t handle;
+        uint32_t width;
+        uint32_t height;
+        uint32_t stride;
+        PixelFormat format;
+        uint32_t layerCount;
+        uint64_t usage;
+        size_t size;
+        nsecs_t freeTime;
     };
 
+    // Upper bounds of the buckets of the allocation latency histogram, past the last of which
+    // are the slower allocations.
+    static constexpr nsecs_t kAllocationLatencyBuckets[] = {us2ns(100), us2ns(500), ms2ns(1),
+                                                            ms2ns(5),   ms2ns(10),  ms2ns(50)};
+    static constexpr size_t kAllocationLatencyBucketCount =
+            std::size(kAllocationLatencyBuckets) + 1;
+
+    // Takes a pooled buffer that matches the request out of the pool, and tracks it as allocated
+    // for requestorName.
+    bool takePooledBufferLocked(uint32_t width, uint32_t height, PixelFormat format,
+                                uint32_t layerCount, uint64_t usage, buffer_handle_t* handle,
+                                uint32_t* stride, const std::string& requestorName);
+
+    // Moves a freed buffer into the pool, evicting the oldest pooled buffers into evicted to stay
+    // within its budget. Returns false if the buffer must be freed instead.
+    bool recycleLocked(buffer_handle_t handle, std::vector<buffer_handle_t>* evicted);
+
+    // Moves the pooled buffers past the timeout, or all of them if the pool is disabled, into
+    // evicted.
+    void trimLocked(std::vector<buffer_handle_t>* evicted);
+
+    // Frees the buffers evicted from the pool, without sLock held.
+    void freeEvicted(const std::vector<buffer_handle_t>& evicted);
+
+    void recordAllocationLatencyLocked(nsecs_t latency);
+
     status_t allocateHelper(uint32_t w, uint32_t h, PixelFormat format, uint32_t layerCount,
                             uint64_t usage, buffer_handle_t* handle, uint32_t* stride,
                             std::string requestorName, bool importBuffer);
@@ -128,6 +189,15 @@ protected:
     static Mutex sLock;
     static KeyedVector<buffer_handle_t, alloc_rec_t> sAllocList;
 
+    // The recycling pool, from the oldest freed buffer to the latest, guarded by sLock.
+    std::vector<PooledBuffer> mPool;
+    uint64_t mPoolSize = 0;
+    uint64_t mPoolMaxSize = 0;
+    nsecs_t mPoolTimeout = 0;
+    uint64_t mPoolHits = 0;
+    uint64_t mPoolMisses = 0;
+    uint64_t mAllocationLatencyHistogram[kAllocationLatencyBucketCount] = {};
+
     friend class Singleton<GraphicBufferAllocator>;
     GraphicBufferAllocator();
     ~GraphicBufferAllocator();
@@ -20,8 +20,13 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
 
+#include <android-base/thread_annotations.h>
 #include <android-base/unique_fd.h>
 #include <ui/GraphicTypes.h>
 #include <ui/PixelFormat.h>
@@ -67,6 +72,15 @@ public:
                           uint32_t layerCount, PixelFormat format, uint64_t usage, uint32_t stride,
                           buffer_handle_t* outHandle);
 
+    // Imports a buffer identified by the ID and generation number of its GraphicBuffer. While
+    // the process still has the same buffer imported this way, the imported handle is validated
+    // and shared instead of being imported again. The handle is freed once freeBuffer has been
+    // called for each import.
+    status_t importBuffer(const native_handle_t* rawHandle, uint64_t bufferId,
+                          uint32_t generationNumber, uint32_t width, uint32_t height,
+                          uint32_t layerCount, PixelFormat format, uint64_t usage, uint32_t stride,
+                          buffer_handle_t* outHandle);
+
     status_t importBufferNoValidate(const native_handle_t* rawHandle, buffer_handle_t* outHandle);
 
     status_t freeBuffer(buffer_handle_t handle);
@@ -119,6 +133,12 @@ public:
         return result;
     }
 
+    /**
+     * Invalidates the CPU caches of a buffer locked for reading, see
+     * GrallocMapper::rereadLockedBuffer.
+     */
+    status_t rereadLockedBuffer(buffer_handle_t handle);
+
     status_t isSupported(uint32_t width, uint32_t height, android::PixelFormat format,
                          uint32_t layerCount, uint64_t usage, bool* outSupported);
 
@@ -181,9 +201,25 @@ private:
 
     GraphicBufferMapper();
 
+    // The ID and generation number of a buffer.
+    using ImportKey = std::pair<uint64_t, uint32_t>;
+
+    struct ImportedBuffer {
+        buffer_handle_t handle;
+        size_t refCount;
+    };
+
+    // Returns the shared import of the buffer, or nullptr if there is none which refers to the
+    // same files as rawHandle. The reference to it is taken if it is returned.
+    buffer_handle_t acquireImportLocked(const ImportKey& key, const native_handle_t* rawHandle);
+
     std::unique_ptr<const GrallocMapper> mMapper;
 
     Version mMapperVersion;
+
+    std::mutex mImportMutex;
+    std::map<ImportKey, ImportedBuffer> mImportedBuffers GUARDED_BY(mImportMutex);
+    std::unordered_map<buffer_handle_t, ImportKey> mImportKeys GUARDED_BY(mImportMutex);
 };
 
 // ---------------------------------------------------------------------------
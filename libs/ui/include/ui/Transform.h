@@ -103,6 +103,12 @@ public:
     vec2 transform(const vec2& v) const;
     vec3 transform(const vec3& v) const;
 
+    // Transforms count rects or points from in to out, which may be the same array, with the
+    // same results as transforming each of them on its own. The path for the type of the
+    // transform is chosen once for the whole array, and translations are vectorized.
+    void transform(const Rect* in, Rect* out, size_t count, bool roundOutwards = false) const;
+    void transform(const vec2* in, vec2* out, size_t count) const;
+
     // Expands from the internal 3x3 matrix to an equivalent 4x4 matrix
     mat4 asMatrix4() const;
 
@@ -125,6 +131,8 @@ private:
     enum { UNKNOWN_TYPE = 0x80000000 };
 
     uint32_t type() const;
+    // Whether the last row is < 0 , 0 , 1 >.
+    bool isAffine() const;
     static bool absIsOne(float f);
     static bool isZero(float f);
 
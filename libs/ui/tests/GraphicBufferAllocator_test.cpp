@@ -53,6 +53,12 @@ public:
                     allocate)
                 .WillOnce(DoAll(SetArgPointee<6>(stride), Return(err)));
     }
+    void setUpAllocateExpectations(uint32_t stride, buffer_handle_t handle) {
+        EXPECT_CALL(*(reinterpret_cast<const mock::MockGrallocAllocator*>(mAllocator.get())),
+                    allocate)
+                .WillOnce(DoAll(SetArgPointee<6>(stride), SetArgPointee<7>(handle),
+                                Return(NO_ERROR)));
+    }
     std::unique_ptr<const GrallocAllocator>& getAllocator() { return mAllocator; }
 };
 
@@ -113,4 +119,55 @@ TEST_F(GraphicBufferAllocatorTest, AllocateLargeStride) {
     ASSERT_EQ(NO_ERROR, err);
     ASSERT_EQ(expectedStride, stride);
 }
+
+TEST_F(GraphicBufferAllocatorTest, RecyclingPoolReusesFreedBuffer) {
+    // The buffers stay in the pool, so the fake handles are never passed to the mapper.
+    const auto fakeHandle = reinterpret_cast<buffer_handle_t>(0x1000);
+    mAllocator.setRecyclingPool(kTestWidth * kTestHeight * 4 * 2, s2ns(60));
+    mAllocator.setUpAllocateExpectations(kTestWidth, fakeHandle);
+
+    uint32_t stride = 0;
+    buffer_handle_t handle;
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                  kTestUsage, &handle, &stride, "GraphicBufferAllocatorTest"));
+    ASSERT_EQ(fakeHandle, handle);
+    ASSERT_EQ(NO_ERROR, mAllocator.free(handle));
+
+    // The allocator is expected to be called only once.
+    stride = 0;
+    handle = nullptr;
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                  kTestUsage, &handle, &stride, "GraphicBufferAllocatorTest"));
+    EXPECT_EQ(fakeHandle, handle);
+    EXPECT_EQ(kTestWidth, stride);
+    ASSERT_EQ(NO_ERROR, mAllocator.free(handle));
+}
+
+TEST_F(GraphicBufferAllocatorTest, RecyclingPoolOnlyReusesMatchingBuffer) {
+    const auto fakeHandle = reinterpret_cast<buffer_handle_t>(0x2000);
+    const auto otherFakeHandle = reinterpret_cast<buffer_handle_t>(0x3000);
+    mAllocator.setRecyclingPool(kTestWidth * kTestHeight * 4 * 2, s2ns(60));
+    mAllocator.setUpAllocateExpectations(kTestWidth, fakeHandle);
+
+    uint32_t stride = 0;
+    buffer_handle_t handle;
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                  kTestUsage, &handle, &stride, "GraphicBufferAllocatorTest"));
+    ASSERT_EQ(NO_ERROR, mAllocator.free(handle));
+
+    mAllocator.setUpAllocateExpectations(kTestWidth, otherFakeHandle);
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBX_8888, kTestLayerCount,
+                                  kTestUsage, &handle, &stride, "GraphicBufferAllocatorTest"));
+    EXPECT_EQ(otherFakeHandle, handle);
+    ASSERT_EQ(NO_ERROR, mAllocator.free(handle));
+
+    std::string dump;
+    mAllocator.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("2 buffers")) << dump;
+    EXPECT_NE(std::string::npos, dump.find("0 hits, 2 misses")) << dump;
+}
 } // namespace android
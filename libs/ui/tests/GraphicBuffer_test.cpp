@@ -20,6 +20,10 @@
 
 #include <gtest/gtest.h>
 
+#include <unistd.h>
+
+#include <vector>
+
 namespace android {
 
 namespace {
@@ -66,4 +70,48 @@ TEST_F(GraphicBufferTest, AllocateBadDimensions) {
     ASSERT_EQ(BAD_VALUE, gb2->initCheck());
 }
 
+TEST_F(GraphicBufferTest, UnflattenSharesImport) {
+    sp<GraphicBuffer> gb(new GraphicBuffer(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBA_8888,
+                                           kTestLayerCount, kTestUsage, std::string("test")));
+    ASSERT_EQ(NO_ERROR, gb->initCheck());
+
+    std::vector<uint8_t> flattened(gb->getFlattenedSize());
+    // The flattened fds are those of gb, which still owns them.
+    std::vector<int> fds(gb->getFdCount());
+    {
+        void* buffer = flattened.data();
+        size_t size = flattened.size();
+        int* fdsOut = fds.data();
+        size_t count = fds.size();
+        ASSERT_EQ(NO_ERROR, gb->flatten(buffer, size, fdsOut, count));
+    }
+
+    // Each unflatten takes ownership of the fds it is given, as when received over binder.
+    auto unflatten = [&]() -> sp<GraphicBuffer> {
+        std::vector<int> dupFds;
+        for (int fd : fds) {
+            dupFds.push_back(dup(fd));
+        }
+        sp<GraphicBuffer> received = sp<GraphicBuffer>::make();
+        const void* buffer = flattened.data();
+        size_t size = flattened.size();
+        const int* fdsIn = dupFds.data();
+        size_t count = dupFds.size();
+        EXPECT_EQ(NO_ERROR, received->unflatten(buffer, size, fdsIn, count));
+        return received;
+    };
+
+    sp<GraphicBuffer> first = unflatten();
+    sp<GraphicBuffer> second = unflatten();
+    ASSERT_NE(nullptr, first->handle);
+    EXPECT_EQ(first->handle, second->handle);
+    EXPECT_EQ(gb->getId(), second->getId());
+
+    // The import stays valid until the last buffer sharing it is gone.
+    first.clear();
+    void* vaddr;
+    ASSERT_EQ(NO_ERROR, second->lock(GraphicBuffer::USAGE_SW_WRITE_OFTEN, &vaddr));
+    EXPECT_EQ(NO_ERROR, second->unlock());
+}
+
 } // namespace android
@@ -179,5 +179,64 @@ TEST_F(RegionTest, RegionHash) {
     EXPECT_NE(std::hash<Region>{}(region1), std::hash<Region>{}(region2));
 }
 
+TEST_F(RegionTest, RectOperationsMatchSweep) {
+    // Operations between single rects, and between rects and regions, that skip the sweep must
+    // give the same rects as the sweep.
+    const Rect rects[] = {Rect(0, 0, 10, 10),  Rect(5, 5, 15, 15), Rect(0, 10, 10, 20),
+                          Rect(10, 0, 20, 10), Rect(0, 5, 10, 15), Rect(-5, 0, 20, 5),
+                          Rect(2, 2, 4, 4),    Rect(0, 0, 0, 0),   Rect(20, 20, 30, 30),
+                          Rect(0, -5, 5, 20),  Rect(-10, -10, 40, 40)};
+    // A rect far away from all of the others, which forces the sweep when added to an operand.
+    const Rect farAway(100, 100, 101, 101);
+
+    for (const Rect& lhs : rects) {
+        for (const Rect& rhs : rects) {
+            Region lhsRegion;
+            lhsRegion.orSelf(lhs);
+            Region sweptLhs(lhsRegion);
+            sweptLhs.orSelf(farAway);
+
+            const auto expectSame = [&](const Region& fast, Region swept) {
+                swept.subtractSelf(farAway);
+                EXPECT_TRUE(fast.hasSameRects(swept))
+                        << "lhs " << testing::PrintToString(lhs) << " rhs "
+                        << testing::PrintToString(rhs);
+            };
+            expectSame(lhsRegion.merge(rhs), sweptLhs.merge(rhs));
+            expectSame(lhsRegion.intersect(rhs), sweptLhs.intersect(rhs));
+            expectSame(lhsRegion.subtract(rhs), sweptLhs.subtract(rhs));
+            expectSame(lhsRegion.mergeExclusive(rhs), sweptLhs.mergeExclusive(rhs));
+            expectSame(lhsRegion.merge(Region(rhs), 3, -2), sweptLhs.merge(Region(rhs), 3, -2));
+            expectSame(lhsRegion.subtract(Region(rhs), 3, -2),
+                       sweptLhs.subtract(Region(rhs), 3, -2));
+        }
+    }
+}
+
+TEST_F(RegionTest, MergeOfAdjacentRectsIsSingleRect) {
+    Region region(Rect(0, 0, 10, 10));
+    region.orSelf(Rect(0, 10, 10, 20));
+    EXPECT_TRUE(region.isRect());
+    EXPECT_EQ(Rect(0, 0, 10, 20), region.getBounds());
+
+    region.orSelf(Rect(10, 0, 15, 20));
+    EXPECT_TRUE(region.isRect());
+    EXPECT_EQ(Rect(0, 0, 15, 20), region.getBounds());
+}
+
+TEST_F(RegionTest, SubtractSlabFromRect) {
+    Region region(Rect(0, 0, 10, 10));
+    region.subtractSelf(Rect(-5, 0, 15, 3));
+    EXPECT_TRUE(region.isRect());
+    EXPECT_EQ(Rect(0, 3, 10, 10), region.getBounds());
+
+    region.subtractSelf(Rect(8, -5, 12, 15));
+    EXPECT_TRUE(region.isRect());
+    EXPECT_EQ(Rect(0, 3, 8, 10), region.getBounds());
+
+    region.subtractSelf(Rect(-1, -1, 20, 20));
+    EXPECT_TRUE(region.isEmpty());
+}
+
 }; // namespace android
 
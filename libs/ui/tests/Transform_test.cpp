@@ -46,4 +46,67 @@ TEST(TransformTest, inverseRotation_hasCorrectType) {
     testRotationFlagsForInverse(Transform::FLIP_V, Transform::FLIP_V, false);
 }
 
+TEST(TransformTest, transformRects_matchesEachRect) {
+    Transform translate;
+    translate.set(10.5f, -3.25f);
+    Transform rotate(Transform::ROT_90, 100, 200);
+    Transform scale;
+    scale.set(1.5f, 0.0f, 0.0f, 0.5f);
+    Transform skew;
+    skew.set(1.0f, 0.25f, 0.5f, 1.0f);
+
+    const Rect rects[] = {{0, 0, 10, 10}, {-20, 5, 7, 40}, {3, 3, 3, 3}, {-9, -9, -1, -2}};
+    for (const Transform& t : {Transform(), translate, rotate, scale, skew}) {
+        for (bool roundOutwards : {false, true}) {
+            Rect out[std::size(rects)];
+            t.transform(rects, out, std::size(rects), roundOutwards);
+            for (size_t i = 0; i < std::size(rects); i++) {
+                EXPECT_EQ(t.transform(rects[i], roundOutwards), out[i]);
+            }
+        }
+    }
+
+    EXPECT_EQ(Rect(11, -3, 21, 7), translate.transform(rects[0]));
+    EXPECT_EQ(Rect(10, -4, 21, 7), translate.transform(rects[0], true));
+    EXPECT_EQ(Rect(90, 0, 100, 10), rotate.transform(rects[0]));
+}
+
+TEST(TransformTest, transformPoints_matchesEachPoint) {
+    Transform translate;
+    translate.set(10.5f, -3.25f);
+    Transform rotate(Transform::ROT_270, 100, 200);
+
+    const vec2 points[] = {{0.0f, 0.0f}, {1.5f, -2.0f}, {100.0f, 50.25f}};
+    for (const Transform& t : {Transform(), translate, rotate}) {
+        vec2 out[std::size(points)];
+        t.transform(points, out, std::size(points));
+        for (size_t i = 0; i < std::size(points); i++) {
+            EXPECT_EQ(t.transform(points[i]), out[i]);
+        }
+    }
+
+    EXPECT_EQ(vec2(12.0f, -5.25f), translate.transform(points[1]));
+}
+
+TEST(TransformTest, multiplyByTranslation_hasCorrectMatrixAndType) {
+    Transform translate;
+    translate.set(5.0f, 7.0f);
+    const Transform rotate(Transform::ROT_90, 100, 200);
+
+    Transform translateThenRotate;
+    translateThenRotate.set({0.0f, -1.0f, 100.0f + 5.0f, 1.0f, 0.0f, 7.0f, 0.0f, 0.0f, 1.0f});
+    EXPECT_EQ(translateThenRotate, translate * rotate);
+    EXPECT_EQ(translateThenRotate.getType(), (translate * rotate).getType());
+    EXPECT_EQ(Transform::ROT_90, (translate * rotate).getOrientation());
+
+    Transform rotateThenTranslate;
+    rotateThenTranslate.set({0.0f, -1.0f, 100.0f - 7.0f, 1.0f, 0.0f, 5.0f, 0.0f, 0.0f, 1.0f});
+    EXPECT_EQ(rotateThenTranslate, rotate * translate);
+    EXPECT_EQ(rotateThenTranslate.getType(), (rotate * translate).getType());
+
+    Transform inverse;
+    inverse.set(-5.0f, -7.0f);
+    EXPECT_EQ(Transform::IDENTITY, (translate * inverse).getType());
+}
+
 } // namespace android::ui
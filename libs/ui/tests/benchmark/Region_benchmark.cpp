@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+namespace android {
+namespace {
+
+// Layer bounds of a few typical scenes on a 1080x2400 display, from the top most layer down.
+const Rect kDisplay(0, 0, 1080, 2400);
+const Rect kStatusBar(0, 0, 1080, 120);
+const Rect kNavigationBar(0, 2280, 1080, 2400);
+const Rect kPip(600, 1500, 1040, 1748);
+const Rect kIme(0, 1500, 1080, 2280);
+const Rect kDialog(90, 800, 990, 1400);
+
+// Runs the occlusion computation done for each output while composing: every layer's visible
+// region is its bounds minus what is above, and its bounds are then added to the covered region.
+void computeVisibleRegions(benchmark::State& state, const std::vector<Rect>& layers) {
+    for (auto _ : state) {
+        Region covered;
+        for (const Rect& layer : layers) {
+            Region visible(layer);
+            visible.subtractSelf(covered);
+            covered.orSelf(layer);
+            benchmark::DoNotOptimize(visible);
+        }
+        benchmark::DoNotOptimize(covered);
+    }
+}
+
+void BM_FullscreenApp(benchmark::State& state) {
+    computeVisibleRegions(state, {kStatusBar, kNavigationBar, kDisplay});
+}
+BENCHMARK(BM_FullscreenApp);
+
+void BM_PipOverApp(benchmark::State& state) {
+    computeVisibleRegions(state, {kStatusBar, kNavigationBar, kPip, kDisplay});
+}
+BENCHMARK(BM_PipOverApp);
+
+void BM_ImeOverApp(benchmark::State& state) {
+    computeVisibleRegions(state, {kStatusBar, kNavigationBar, kIme, kDisplay});
+}
+BENCHMARK(BM_ImeOverApp);
+
+void BM_DialogOverDimmedApp(benchmark::State& state) {
+    computeVisibleRegions(state, {kStatusBar, kNavigationBar, kDialog, kDisplay, kDisplay});
+}
+BENCHMARK(BM_DialogOverDimmedApp);
+
+// Rounded screen corners, cut out of the display as a staircase of thin rects on each side.
+void BM_RoundedCorners(benchmark::State& state) {
+    const int32_t radius = static_cast<int32_t>(state.range(0));
+    Region corners;
+    for (int32_t y = 0; y < radius; y++) {
+        const int32_t inset = radius - y;
+        corners.orSelf(Rect(0, y, inset, y + 1));
+        corners.orSelf(Rect(kDisplay.right - inset, y, kDisplay.right, y + 1));
+        corners.orSelf(Rect(0, kDisplay.bottom - y - 1, inset, kDisplay.bottom - y));
+        corners.orSelf(Rect(kDisplay.right - inset, kDisplay.bottom - y - 1, kDisplay.right,
+                            kDisplay.bottom - y));
+    }
+    for (auto _ : state) {
+        Region visible(kDisplay);
+        visible.subtractSelf(corners);
+        visible.subtractSelf(kStatusBar);
+        benchmark::DoNotOptimize(visible);
+    }
+}
+BENCHMARK(BM_RoundedCorners)->Arg(16)->Arg(64);
+
+// A grid of tiles, as in a launcher or a recents overview, over a wallpaper.
+void BM_Grid(benchmark::State& state) {
+    const int32_t side = static_cast<int32_t>(state.range(0));
+    std::vector<Rect> layers = {kStatusBar, kNavigationBar};
+    const int32_t width = kDisplay.getWidth() / side;
+    const int32_t height = (kNavigationBar.top - kStatusBar.bottom) / side;
+    for (int32_t row = 0; row < side; row++) {
+        for (int32_t column = 0; column < side; column++) {
+            const int32_t left = column * width;
+            const int32_t top = kStatusBar.bottom + row * height;
+            layers.emplace_back(left + 8, top + 8, left + width - 8, top + height - 8);
+        }
+    }
+    layers.push_back(kDisplay);
+    computeVisibleRegions(state, layers);
+}
+BENCHMARK(BM_Grid)->Arg(2)->Arg(4)->Arg(8);
+
+} // namespace
+} // namespace android
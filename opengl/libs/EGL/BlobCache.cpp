@@ -25,7 +25,9 @@
 #include <log/log.h>
 #include <utils/Trace.h>
 
-#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <string_view>
 
 namespace android {
 
@@ -42,17 +44,8 @@ BlobCache::BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize
       : mMaxTotalSize(maxTotalSize),
         mMaxKeySize(maxKeySize),
         mMaxValueSize(maxValueSize),
-        mTotalSize(0) {
-    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
-#ifdef _WIN32
-    srand(now);
-#else
-    mRandState[0] = (now >> 0) & 0xFFFF;
-    mRandState[1] = (now >> 16) & 0xFFFF;
-    mRandState[2] = (now >> 32) & 0xFFFF;
-#endif
-    ALOGV("initializing random seed using %lld", (unsigned long long)now);
-}
+        mTotalSize(0),
+        mClockHand(0) {}
 
 BlobCache::InsertResult BlobCache::set(const void* key, size_t keySize, const void* value,
                                        size_t valueSize) {
@@ -81,16 +74,13 @@ BlobCache::InsertResult BlobCache::set(const void* key, size_t keySize, const vo
         return InsertResult::kInvalidValueSize;
     }
 
-    std::shared_ptr<Blob> cacheKey(new Blob(key, keySize, false));
-    CacheEntry cacheEntry(cacheKey, nullptr);
+    const uint64_t hash = hashKey(key, keySize);
 
     bool didClean = false;
     while (true) {
-        auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), cacheEntry);
-        if (index == mCacheEntries.end() || cacheEntry < *index) {
+        size_t index = findEntry(hash, key, keySize);
+        if (index == kNoEntry) {
             // Create a new cache entry.
-            std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, true));
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
             size_t newTotalSize = mTotalSize + keySize + valueSize;
             if (mMaxTotalSize < newTotalSize) {
                 if (isCleanable()) {
@@ -106,15 +96,15 @@ BlobCache::InsertResult BlobCache::set(const void* key, size_t keySize, const vo
                     return InsertResult::kNotEnoughSpace;
                 }
             }
-            mCacheEntries.insert(index, CacheEntry(keyBlob, valueBlob));
+            size_t offset = appendToArena(key, keySize, value, valueSize);
+            mEntries.push_back({hash, offset, keySize, valueSize, false, false});
+            addToIndex(mEntries.size() - 1);
             mTotalSize = newTotalSize;
             ALOGV("set: created new cache entry with %zu byte key and %zu byte value", keySize,
                   valueSize);
         } else {
             // Update the existing cache entry.
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
-            std::shared_ptr<Blob> oldValueBlob(index->getValue());
-            size_t newTotalSize = mTotalSize + valueSize - oldValueBlob->getSize();
+            size_t newTotalSize = mTotalSize + valueSize - mEntries[index].mValueSize;
             if (mMaxTotalSize < newTotalSize) {
                 if (isCleanable()) {
                     // Clean the cache and try again.
@@ -128,7 +118,12 @@ BlobCache::InsertResult BlobCache::set(const void* key, size_t keySize, const vo
                     return InsertResult::kNotEnoughSpace;
                 }
             }
-            index->setValue(valueBlob);
+            // The old key and value are left in the arena until it is compacted.
+            size_t offset = appendToArena(key, keySize, value, valueSize);
+            Entry& entry = mEntries[index];
+            entry.mOffset = offset;
+            entry.mValueSize = valueSize;
+            entry.mReferenced = true;
             mTotalSize = newTotalSize;
             ALOGV("set: updated existing cache entry with %zu byte key and %zu byte "
                   "value",
@@ -144,26 +139,24 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value, size_t value
               mMaxKeySize);
         return 0;
     }
-    std::shared_ptr<Blob> cacheKey(new Blob(key, keySize, false));
-    CacheEntry cacheEntry(cacheKey, nullptr);
-    auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), cacheEntry);
-    if (index == mCacheEntries.end() || cacheEntry < *index) {
+    size_t index = findEntry(hashKey(key, keySize), key, keySize);
+    if (index == kNoEntry) {
         ALOGV("get: no cache entry found for key of size %zu", keySize);
         return 0;
     }
 
     // The key was found. Return the value if the caller's buffer is large
     // enough.
-    std::shared_ptr<Blob> valueBlob(index->getValue());
-    size_t valueBlobSize = valueBlob->getSize();
-    if (valueBlobSize <= valueSize) {
-        ALOGV("get: copying %zu bytes to caller's buffer", valueBlobSize);
-        memcpy(value, valueBlob->getData(), valueBlobSize);
+    Entry& entry = mEntries[index];
+    entry.mReferenced = true;
+    if (entry.mValueSize <= valueSize) {
+        ALOGV("get: copying %zu bytes to caller's buffer", entry.mValueSize);
+        memcpy(value, &mArena[entry.mOffset + entry.mKeySize], entry.mValueSize);
     } else {
         ALOGV("get: caller's buffer is too small for value: %zu (needs %zu)", valueSize,
-              valueBlobSize);
+              entry.mValueSize);
     }
-    return valueBlobSize;
+    return entry.mValueSize;
 }
 
 static inline size_t align4(size_t size) {
@@ -173,10 +166,8 @@ static inline size_t align4(size_t size) {
 size_t BlobCache::getFlattenedSize() const {
     auto buildId = base::GetProperty("ro.build.id", "");
     size_t size = align4(sizeof(Header) + buildId.size());
-    for (const CacheEntry& e : mCacheEntries) {
-        std::shared_ptr<Blob> const& keyBlob = e.getKey();
-        std::shared_ptr<Blob> const& valueBlob = e.getValue();
-        size += align4(sizeof(EntryHeader) + keyBlob->getSize() + valueBlob->getSize());
+    for (const Entry& e : mEntries) {
+        size += align4(sizeof(EntryHeader) + e.mKeySize + e.mValueSize);
     }
     return size;
 }
@@ -191,7 +182,7 @@ int BlobCache::flatten(void* buffer, size_t size) const {
     header->mMagicNumber = blobCacheMagic;
     header->mBlobCacheVersion = blobCacheVersion;
     header->mDeviceVersion = blobCacheDeviceVersion;
-    header->mNumEntries = mCacheEntries.size();
+    header->mNumEntries = mEntries.size();
     auto buildId = base::GetProperty("ro.build.id", "");
     header->mBuildIdLength = buildId.size();
     memcpy(header->mBuildId, buildId.c_str(), header->mBuildIdLength);
@@ -199,11 +190,9 @@ int BlobCache::flatten(void* buffer, size_t size) const {
     // Write cache entries
     uint8_t* byteBuffer = reinterpret_cast<uint8_t*>(buffer);
     off_t byteOffset = align4(sizeof(Header) + header->mBuildIdLength);
-    for (const CacheEntry& e : mCacheEntries) {
-        std::shared_ptr<Blob> const& keyBlob = e.getKey();
-        std::shared_ptr<Blob> const& valueBlob = e.getValue();
-        size_t keySize = keyBlob->getSize();
-        size_t valueSize = valueBlob->getSize();
+    for (const Entry& e : mEntries) {
+        size_t keySize = e.mKeySize;
+        size_t valueSize = e.mValueSize;
 
         size_t entrySize = sizeof(EntryHeader) + keySize + valueSize;
         size_t totalSize = align4(entrySize);
@@ -216,8 +205,8 @@ int BlobCache::flatten(void* buffer, size_t size) const {
         eheader->mKeySize = keySize;
         eheader->mValueSize = valueSize;
 
-        memcpy(eheader->mData, keyBlob->getData(), keySize);
-        memcpy(eheader->mData + keySize, valueBlob->getData(), valueSize);
+        // The key and value are next to each other in the arena.
+        memcpy(eheader->mData, &mArena[e.mOffset], keySize + valueSize);
 
         if (totalSize > entrySize) {
             // We have padding bytes. Those will get written to storage, and contribute to the CRC,
@@ -288,88 +277,125 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
     return 0;
 }
 
-long int BlobCache::blob_random() {
-#ifdef _WIN32
-    return rand();
-#else
-    return nrand48(mRandState);
-#endif
-}
-
 void BlobCache::clean() {
     ATRACE_NAME("BlobCache::clean");
 
-    // Remove a random cache entry until the total cache size gets below half
-    // the maximum total cache size.
+    // Move the clock hand over the entries, giving the ones that were used
+    // since it last passed them another chance, and evict the others until the
+    // total cache size gets below half the maximum total cache size.
     while (mTotalSize > mMaxTotalSize / 2) {
-        size_t i = size_t(blob_random() % (mCacheEntries.size()));
-        const CacheEntry& entry(mCacheEntries[i]);
-        mTotalSize -= entry.getKey()->getSize() + entry.getValue()->getSize();
-        mCacheEntries.erase(mCacheEntries.begin() + i);
+        Entry& entry = mEntries[mClockHand];
+        if (!entry.mEvicted) {
+            if (entry.mReferenced) {
+                entry.mReferenced = false;
+            } else {
+                entry.mEvicted = true;
+                mTotalSize -= entry.mKeySize + entry.mValueSize;
+            }
+        }
+        mClockHand = (mClockHand + 1) % mEntries.size();
     }
+    compact();
 }
 
 bool BlobCache::isCleanable() const {
     return mTotalSize > mMaxTotalSize / 2;
 }
 
-BlobCache::Blob::Blob(const void* data, size_t size, bool copyData)
-      : mData(copyData ? malloc(size) : data), mSize(size), mOwnsData(copyData) {
-    if (data != nullptr && copyData) {
-        memcpy(const_cast<void*>(mData), data, size);
-    }
+uint64_t BlobCache::hashKey(const void* key, size_t keySize) {
+    return std::hash<std::string_view>{}(
+            std::string_view(reinterpret_cast<const char*>(key), keySize));
 }
 
-BlobCache::Blob::~Blob() {
-    if (mOwnsData) {
-        free(const_cast<void*>(mData));
+size_t BlobCache::findEntry(uint64_t hash, const void* key, size_t keySize) const {
+    if (mIndex.empty()) {
+        return kNoEntry;
     }
-}
-
-bool BlobCache::Blob::operator<(const Blob& rhs) const {
-    if (mSize == rhs.mSize) {
-        return memcmp(mData, rhs.mData, mSize) < 0;
-    } else {
-        return mSize < rhs.mSize;
+    const size_t mask = mIndex.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        const uint32_t index = mIndex[slot];
+        if (index == kEmptySlot) {
+            return kNoEntry;
+        }
+        const Entry& entry = mEntries[index];
+        if (entry.mHash == hash && entry.mKeySize == keySize &&
+            memcmp(&mArena[entry.mOffset], key, keySize) == 0) {
+            return index;
+        }
     }
 }
 
-const void* BlobCache::Blob::getData() const {
-    return mData;
-}
-
-size_t BlobCache::Blob::getSize() const {
-    return mSize;
-}
-
-BlobCache::CacheEntry::CacheEntry() {}
-
-BlobCache::CacheEntry::CacheEntry(const std::shared_ptr<Blob>& key,
-                                  const std::shared_ptr<Blob>& value)
-      : mKey(key), mValue(value) {}
-
-BlobCache::CacheEntry::CacheEntry(const CacheEntry& ce) : mKey(ce.mKey), mValue(ce.mValue) {}
-
-bool BlobCache::CacheEntry::operator<(const CacheEntry& rhs) const {
-    return *mKey < *rhs.mKey;
+void BlobCache::addToIndex(size_t entry) {
+    if (mEntries.size() * 2 > mIndex.size()) {
+        // The new entry is already in mEntries, so the rebuild adds it.
+        rebuildIndex(std::max(mIndex.size() * 2, size_t(64)));
+        return;
+    }
+    const size_t mask = mIndex.size() - 1;
+    size_t slot = mEntries[entry].mHash & mask;
+    while (mIndex[slot] != kEmptySlot) {
+        slot = (slot + 1) & mask;
+    }
+    mIndex[slot] = entry;
 }
 
-const BlobCache::CacheEntry& BlobCache::CacheEntry::operator=(const CacheEntry& rhs) {
-    mKey = rhs.mKey;
-    mValue = rhs.mValue;
-    return *this;
+void BlobCache::rebuildIndex(size_t slots) {
+    mIndex.assign(slots, kEmptySlot);
+    const size_t mask = slots - 1;
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        size_t slot = mEntries[i].mHash & mask;
+        while (mIndex[slot] != kEmptySlot) {
+            slot = (slot + 1) & mask;
+        }
+        mIndex[slot] = i;
+    }
 }
 
-std::shared_ptr<BlobCache::Blob> BlobCache::CacheEntry::getKey() const {
-    return mKey;
+size_t BlobCache::appendToArena(const void* key, size_t keySize, const void* value,
+                                size_t valueSize) {
+    // Replaced values are left behind in the arena, so pack it once they take
+    // more room than the cache itself.
+    if (mArena.size() - mTotalSize > mMaxTotalSize) {
+        compact();
+    }
+    const size_t offset = mArena.size();
+    mArena.resize(offset + keySize + valueSize);
+    memcpy(&mArena[offset], key, keySize);
+    memcpy(&mArena[offset + keySize], value, valueSize);
+    return offset;
 }
 
-std::shared_ptr<BlobCache::Blob> BlobCache::CacheEntry::getValue() const {
-    return mValue;
-}
+void BlobCache::compact() {
+    ATRACE_NAME("BlobCache::compact");
+
+    std::vector<uint8_t> arena;
+    arena.reserve(mTotalSize);
+    size_t kept = 0;
+    size_t clockHand = 0;
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        Entry entry = mEntries[i];
+        if (i == mClockHand) {
+            clockHand = kept;
+        }
+        if (entry.mEvicted) {
+            continue;
+        }
+        const size_t size = entry.mKeySize + entry.mValueSize;
+        const size_t offset = arena.size();
+        arena.insert(arena.end(), mArena.begin() + entry.mOffset,
+                     mArena.begin() + entry.mOffset + size);
+        entry.mOffset = offset;
+        mEntries[kept++] = entry;
+    }
+    mEntries.resize(kept);
+    mArena = std::move(arena);
+    mClockHand = kept == 0 ? 0 : clockHand % kept;
 
-void BlobCache::CacheEntry::setValue(const std::shared_ptr<Blob>& value) {
-    mValue = value;
+    size_t slots = 64;
+    while (slots < mEntries.size() * 2) {
+        slots *= 2;
+    }
+    rebuildIndex(slots);
 }
 
 } // namespace android
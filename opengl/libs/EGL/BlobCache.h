@@ -18,6 +18,7 @@
 #define ANDROID_BLOB_CACHE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <memory>
 #include <vector>
@@ -118,8 +119,11 @@ public:
     // clear flushes out all contents of the cache then the BlobCache, leaving
     // it in an empty state.
     void clear() {
-        mCacheEntries.clear();
+        mEntries.clear();
+        mIndex.clear();
+        mArena.clear();
         mTotalSize = 0;
+        mClockHand = 0;
     }
 
 protected:
@@ -135,66 +139,62 @@ private:
     BlobCache(const BlobCache&);
     void operator=(const BlobCache&);
 
-    // A random function helper to get around MinGW not having nrand48()
-    long int blob_random();
-
-    // clean evicts a randomly chosen set of entries from the cache such that
-    // the total size of all remaining entries is less than mMaxTotalSize/2.
+    // clean evicts entries from the cache such that the total size of all
+    // remaining entries is less than mMaxTotalSize/2. Entries are chosen by the
+    // CLOCK policy, so entries that were used since the last pass of the clock
+    // hand are kept over the ones that were not.
     void clean();
 
     // isCleanable returns true if the cache is full enough for the clean method
     // to have some effect, and false otherwise.
     bool isCleanable() const;
 
-    // A Blob is an immutable sized unstructured data blob.
-    class Blob {
-    public:
-        Blob(const void* data, size_t size, bool copyData);
-        ~Blob();
-
-        bool operator<(const Blob& rhs) const;
-
-        const void* getData() const;
-        size_t getSize() const;
+    // An Entry is a single key/value pair in the cache. The key and value are
+    // stored one after the other in mArena, starting at mOffset.
+    struct Entry {
+        // mHash is the hash of the key, used by mIndex.
+        uint64_t mHash;
 
-    private:
-        // Copying is not allowed.
-        Blob(const Blob&);
-        void operator=(const Blob&);
+        // mOffset is the position of the key data in mArena. The value data
+        // follows the key data.
+        size_t mOffset;
 
-        // mData points to the buffer containing the blob data.
-        const void* mData;
+        size_t mKeySize;
+        size_t mValueSize;
 
-        // mSize is the size of the blob data in bytes.
-        size_t mSize;
+        // mReferenced is set when the entry is used, and cleared when the clock
+        // hand passes it. Entries are only evicted when it is clear.
+        bool mReferenced;
 
-        // mOwnsData indicates whether or not this Blob object should free the
-        // memory pointed to by mData when the Blob gets destructed.
-        bool mOwnsData;
+        // mEvicted marks an entry that clean removed and compact has not
+        // dropped yet.
+        bool mEvicted;
     };
 
-    // A CacheEntry is a single key/value pair in the cache.
-    class CacheEntry {
-    public:
-        CacheEntry();
-        CacheEntry(const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value);
-        CacheEntry(const CacheEntry& ce);
+    static constexpr size_t kNoEntry = SIZE_MAX;
+    static constexpr uint32_t kEmptySlot = UINT32_MAX;
 
-        bool operator<(const CacheEntry& rhs) const;
-        const CacheEntry& operator=(const CacheEntry&);
+    static uint64_t hashKey(const void* key, size_t keySize);
 
-        std::shared_ptr<Blob> getKey() const;
-        std::shared_ptr<Blob> getValue() const;
+    // findEntry returns the position of the entry for the given key in
+    // mEntries, or kNoEntry if the key is not in the cache.
+    size_t findEntry(uint64_t hash, const void* key, size_t keySize) const;
 
-        void setValue(const std::shared_ptr<Blob>& value);
+    // addToIndex adds the entry at the given position in mEntries to mIndex,
+    // growing mIndex first if it would become more than half full.
+    void addToIndex(size_t entry);
 
-    private:
-        // mKey is the key that identifies the cache entry.
-        std::shared_ptr<Blob> mKey;
+    // rebuildIndex recreates mIndex with the given number of slots, which must
+    // be a power of two.
+    void rebuildIndex(size_t slots);
 
-        // mValue is the cached data associated with the key.
-        std::shared_ptr<Blob> mValue;
-    };
+    // appendToArena copies the key and value data to the end of mArena and
+    // returns the offset of the key data.
+    size_t appendToArena(const void* key, size_t keySize, const void* value, size_t valueSize);
+
+    // compact drops the evicted entries from mEntries, and the data that no
+    // entry refers to anymore from mArena, then rebuilds mIndex.
+    void compact();
 
     // A Header is the header for the entire BlobCache serialization format. No
     // need to make this portable, so we simply write the struct out.
@@ -256,13 +256,23 @@ private:
     // the cache.
     size_t mTotalSize;
 
-    // mRandState is the pseudo-random number generator state. It is passed to
-    // nrand48 to generate random numbers when needed.
-    unsigned short mRandState[3];
+    // mEntries stores all the cache entries that are resident in memory, in the
+    // order that they were added. Cache entries are added to it by the 'set'
+    // method.
+    std::vector<Entry> mEntries;
+
+    // mIndex is an open-addressing hash table, with linear probing, of the
+    // positions of the entries in mEntries. Empty slots hold kEmptySlot. Its
+    // size is a power of two, and it is at most half full.
+    std::vector<uint32_t> mIndex;
+
+    // mArena holds the key and value data of the entries. Data that is
+    // replaced by a later set is left in place until the arena is compacted.
+    std::vector<uint8_t> mArena;
 
-    // mCacheEntries stores all the cache entries that are resident in memory.
-    // Cache entries are added to it by the 'set' method.
-    std::vector<CacheEntry> mCacheEntries;
+    // mClockHand is the position in mEntries where the next call to clean
+    // continues looking for entries to evict.
+    size_t mClockHand;
 };
 
 } // namespace android
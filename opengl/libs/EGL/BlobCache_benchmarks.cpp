@@ -0,0 +1,134 @@
+/*
+ ** Copyright 2024, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "BlobCache.h"
+
+namespace android {
+
+namespace {
+
+// The limits of the monolithic cache in egl_cache.cpp.
+constexpr size_t kMaxKeySize = 12 * 1024;
+constexpr size_t kMaxValueSize = 64 * 1024;
+constexpr size_t kMaxTotalSize = 2 * 1024 * 1024;
+
+// Shader programs of an app, as a driver caches them: keys are a hash of the sources and
+// state, and values are the compiled binaries, most of them a few KB and some much larger.
+class ShaderSet {
+public:
+    explicit ShaderSet(size_t count) {
+        std::mt19937 random(count);
+        std::uniform_int_distribution<size_t> keySize(20, 64);
+        std::lognormal_distribution<double> valueSize(8.5, 1.0); // ~5KB median
+        for (size_t i = 0; i < count; i++) {
+            Shader shader;
+            shader.key.resize(keySize(random));
+            for (auto& byte : shader.key) byte = random();
+            shader.value.resize(
+                    std::clamp(static_cast<size_t>(valueSize(random)), size_t(256), kMaxValueSize));
+            mShaders.push_back(std::move(shader));
+        }
+        // A few shaders, such as the ones of the UI, are used far more than the others.
+        std::vector<double> weights;
+        for (size_t i = 0; i < count; i++) {
+            weights.push_back(1.0 / (i + 1));
+        }
+        mPopularity = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+    }
+
+    size_t size() const { return mShaders.size(); }
+
+    void set(BlobCache& cache, size_t i) const {
+        const Shader& shader = mShaders[i];
+        cache.set(shader.key.data(), shader.key.size(), shader.value.data(), shader.value.size());
+    }
+
+    size_t get(BlobCache& cache, size_t i, std::vector<uint8_t>& buffer) const {
+        const Shader& shader = mShaders[i];
+        return cache.get(shader.key.data(), shader.key.size(), buffer.data(), buffer.size());
+    }
+
+    size_t next(std::mt19937& random) { return mPopularity(random); }
+
+private:
+    struct Shader {
+        std::vector<uint8_t> key;
+        std::vector<uint8_t> value;
+    };
+    std::vector<Shader> mShaders;
+    std::discrete_distribution<size_t> mPopularity;
+};
+
+// The burst of sets at the first start of an app, when nothing is cached yet.
+void benchmarkBlobCacheColdStart(benchmark::State& state) {
+    ShaderSet shaders(state.range(0));
+    for (auto _ : state) {
+        BlobCache cache(kMaxKeySize, kMaxValueSize, kMaxTotalSize);
+        for (size_t i = 0; i < shaders.size(); i++) {
+            shaders.set(cache, i);
+        }
+        benchmark::DoNotOptimize(cache.getFlattenedSize());
+    }
+    state.SetItemsProcessed(state.iterations() * shaders.size());
+}
+BENCHMARK(benchmarkBlobCacheColdStart)->Arg(64)->Arg(256);
+
+// Later starts of the app, when the shaders are found in the cache.
+void benchmarkBlobCacheWarmGet(benchmark::State& state) {
+    ShaderSet shaders(state.range(0));
+    BlobCache cache(kMaxKeySize, kMaxValueSize, kMaxTotalSize);
+    for (size_t i = 0; i < shaders.size(); i++) {
+        shaders.set(cache, i);
+    }
+    std::vector<uint8_t> buffer(kMaxValueSize);
+    std::mt19937 random(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(shaders.get(cache, shaders.next(random), buffer));
+    }
+}
+BENCHMARK(benchmarkBlobCacheWarmGet)->Arg(64)->Arg(256);
+
+// More shaders than fit in the cache, so that a miss is followed by a set, which in turn
+// evicts some of the cached ones.
+void benchmarkBlobCacheGetOrSet(benchmark::State& state) {
+    ShaderSet shaders(state.range(0));
+    BlobCache cache(kMaxKeySize, kMaxValueSize, kMaxTotalSize);
+    std::vector<uint8_t> buffer(kMaxValueSize);
+    std::mt19937 random(0);
+    size_t misses = 0;
+    for (auto _ : state) {
+        const size_t i = shaders.next(random);
+        if (shaders.get(cache, i, buffer) == 0) {
+            shaders.set(cache, i);
+            misses++;
+        }
+    }
+    state.counters["miss_rate"] =
+            benchmark::Counter(misses, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(benchmarkBlobCacheGetOrSet)->Arg(1024)->Arg(4096);
+
+} // namespace
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -294,6 +294,68 @@ TEST_F(BlobCacheTest, ExceedingTotalLimitHalvesCacheSize) {
     ASSERT_EQ(maxEntries / 2 + 1, numCached);
 }
 
+TEST_F(BlobCacheTest, ExceedingTotalLimitKeepsRecentlyUsedEntries) {
+    // Fill up the entire cache with 1 char key/value pairs.
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set(&k, 1, "x", 1));
+    }
+    // Use the first quarter of the entries.
+    for (int i = 0; i < maxEntries / 4; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+    // Insert one more entry, causing a cache overflow.
+    {
+        uint8_t k = maxEntries;
+        ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC->set(&k, 1, "x", 1));
+    }
+    // The entries that were used, and the new one, should still be cached.
+    for (int i = 0; i < maxEntries / 4; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+    uint8_t k = maxEntries;
+    ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+}
+
+TEST_F(BlobCacheTest, KeysWithTheSamePrefixAreDistinct) {
+    unsigned char buf[2] = {0xee, 0xee};
+    ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set("a", 1, "b", 1));
+    ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set("aa", 2, "cd", 2));
+    ASSERT_EQ(size_t(1), mBC->get("a", 1, buf, 2));
+    ASSERT_EQ('b', buf[0]);
+    ASSERT_EQ(size_t(2), mBC->get("aa", 2, buf, 2));
+    ASSERT_EQ('c', buf[0]);
+    ASSERT_EQ('d', buf[1]);
+    ASSERT_EQ(size_t(0), mBC->get("aaa", 3, buf, 2));
+}
+
+TEST_F(BlobCacheTest, RepeatedSetsCacheLatestValues) {
+    // Keep replacing the values of a few entries, with values of different
+    // sizes, so that the replaced data has to be dropped from the cache.
+    const int numEntries = 2;
+    for (int round = 0; round < 64; round++) {
+        for (int i = 0; i < numEntries; i++) {
+            uint8_t k = i;
+            uint8_t value[MAX_VALUE_SIZE / 2];
+            size_t valueSize = 1 + (round + i) % sizeof(value);
+            memset(value, round, valueSize);
+            ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set(&k, 1, value, valueSize));
+        }
+    }
+    for (int i = 0; i < numEntries; i++) {
+        uint8_t k = i;
+        uint8_t value[MAX_VALUE_SIZE / 2];
+        size_t valueSize = 1 + (63 + i) % sizeof(value);
+        ASSERT_EQ(valueSize, mBC->get(&k, 1, value, sizeof(value)));
+        for (size_t j = 0; j < valueSize; j++) {
+            ASSERT_EQ(63, value[j]);
+        }
+    }
+}
+
 TEST_F(BlobCacheTest, InvalidKeySize) {
     ASSERT_EQ(BlobCache::InsertResult::kInvalidKeySize, mBC->set("", 0, "efgh", 4));
 }
@@ -24,12 +24,14 @@
 #include <cutils/properties.h>
 #include <dirent.h>
 #include <dlfcn.h>
+#include <inttypes.h>
 #include <graphicsenv/GraphicsEnv.h>
 #include <log/log.h>
 #include <utils/Timers.h>
 #include <vndksupport/linker.h>
 
 #include <string>
+#include <thread>
 
 #include "EGL/eglext_angle.h"
 #include "egl_platform_entries.h"
@@ -67,6 +69,7 @@ static const char* PERSIST_DRIVER_SUFFIX_PROPERTY = "persist.graphics.egl";
 static const char* RO_DRIVER_SUFFIX_PROPERTY = "ro.hardware.egl";
 static const char* RO_BOARD_PLATFORM_PROPERTY = "ro.board.platform";
 static const char* ANGLE_SUFFIX_VALUE = "angle";
+static const char* DEBUG_LOADER_TIMING_PROPERTY = "debug.egl.loader.timing";
 
 static const char* HAL_SUBNAME_KEY_PROPERTIES[3] = {
         PERSIST_DRIVER_SUFFIX_PROPERTY,
@@ -216,6 +219,11 @@ static void uninit_api(char const* const* api, __eglMustCastToProperFunctionPoin
 void Loader::unload_system_driver(egl_connection_t* cnx) {
     ATRACE_CALL();
 
+    {
+        std::lock_guard<std::mutex> lock(deferredGles1Lock);
+        deferredGles1 = false;
+    }
+
     uninit_api(gl_names,
                (__eglMustCastToProperFunctionPointerType*)&cnx
                        ->hooks[egl_connection_t::GLESv2_INDEX]
@@ -258,6 +266,24 @@ void* Loader::open(egl_connection_t* cnx) {
         return cnx->dso;
     }
 
+    // The system wrapper libraries do not depend on which driver is picked, so load them while
+    // the driver is found and loaded.
+    std::thread wrapperThread;
+    if (!cnx->libEgl || !cnx->libGles1 || !cnx->libGles2) {
+        wrapperThread = std::thread([cnx]() {
+            if (!cnx->libEgl) {
+                cnx->libEgl = load_wrapper(SYSTEM_LIB_PATH "/libEGL.so");
+            }
+            if (!cnx->libGles1) {
+                cnx->libGles1 = load_wrapper(SYSTEM_LIB_PATH "/libGLESv1_CM.so");
+            }
+            if (!cnx->libGles2) {
+                cnx->libGles2 = load_wrapper(SYSTEM_LIB_PATH "/libGLESv2.so");
+            }
+        });
+    }
+
+    loadTimes = {};
     driver_t* hnd = nullptr;
     // Firstly, try to load ANGLE driver, if ANGLE should be loaded and fail, abort.
     if (android::GraphicsEnv::getInstance().shouldUseAngle()) {
@@ -328,7 +354,12 @@ void* Loader::open(egl_connection_t* cnx) {
         hnd = attempt_to_load_system_driver(cnx, nullptr, false);
     }
 
+    loadTimes.driver = systemTime() - openTime;
+
     if (!hnd) {
+        if (wrapperThread.joinable()) {
+            wrapperThread.join();
+        }
         android::GraphicsEnv::getInstance().setDriverLoaded(android::GpuStatsInfo::Api::API_GL,
                                                             false, systemTime() - openTime);
     } else {
@@ -345,15 +376,11 @@ void* Loader::open(egl_connection_t* cnx) {
                         HAL_SUBNAME_KEY_PROPERTIES[0], HAL_SUBNAME_KEY_PROPERTIES[1],
                         HAL_SUBNAME_KEY_PROPERTIES[2]);
 
-    if (!cnx->libEgl) {
-        cnx->libEgl = load_wrapper(SYSTEM_LIB_PATH "/libEGL.so");
-    }
-    if (!cnx->libGles1) {
-        cnx->libGles1 = load_wrapper(SYSTEM_LIB_PATH "/libGLESv1_CM.so");
-    }
-    if (!cnx->libGles2) {
-        cnx->libGles2 = load_wrapper(SYSTEM_LIB_PATH "/libGLESv2.so");
+    const nsecs_t wrappersWaitTime = systemTime();
+    if (wrapperThread.joinable()) {
+        wrapperThread.join();
     }
+    loadTimes.wrappersWait = systemTime() - wrappersWaitTime;
 
     if (!cnx->libEgl || !cnx->libGles2 || !cnx->libGles1) {
         android::GraphicsEnv::getInstance().setDriverLoaded(android::GpuStatsInfo::Api::API_GL,
@@ -369,11 +396,22 @@ void* Loader::open(egl_connection_t* cnx) {
     android::GraphicsEnv::getInstance().setDriverLoaded(android::GpuStatsInfo::Api::API_GL, true,
                                                         systemTime() - openTime);
 
+    ALOGD_IF(base::GetBoolProperty(DEBUG_LOADER_TIMING_PROPERTY, false),
+             "Loaded GLES drivers in %" PRId64 "us: driver %" PRId64 "us (EGL api %" PRId64
+             "us, GLESv2 api %" PRId64 "us), waited %" PRId64 "us for the wrappers",
+             ns2us(systemTime() - openTime), ns2us(loadTimes.driver), ns2us(loadTimes.eglApi),
+             ns2us(loadTimes.gles2Api), ns2us(loadTimes.wrappersWait));
+
     return (void*)hnd;
 }
 
 void Loader::close(egl_connection_t* cnx)
 {
+    {
+        std::lock_guard<std::mutex> lock(deferredGles1Lock);
+        deferredGles1 = false;
+    }
+
     driver_t* hnd = (driver_t*) cnx->dso;
     delete hnd;
     cnx->dso = nullptr;
@@ -696,7 +734,24 @@ Loader::driver_t* Loader::attempt_to_load_system_driver(egl_connection_t* cnx, c
     return hnd;
 }
 
+void Loader::init_deferred_gles1_api(egl_connection_t* cnx) {
+    std::lock_guard<std::mutex> lock(deferredGles1Lock);
+    if (!deferredGles1) {
+        return;
+    }
+    ATRACE_CALL();
+    const nsecs_t startTime = systemTime();
+    init_api(deferredGles1Dso, gl_names_1, gl_names,
+        (__eglMustCastToProperFunctionPointerType*)
+            &cnx->hooks[egl_connection_t::GLESv1_INDEX]->gl,
+        deferredGles1GetProcAddress);
+    deferredGles1 = false;
+    ALOGD_IF(base::GetBoolProperty(DEBUG_LOADER_TIMING_PROPERTY, false),
+             "Resolved GLESv1 api in %" PRId64 "us", ns2us(systemTime() - startTime));
+}
+
 void Loader::initialize_api(void* dso, egl_connection_t* cnx, uint32_t mask) {
+    const nsecs_t startTime = systemTime();
     if (mask & EGL) {
         getProcAddress = (getProcAddressType)dlsym(dso, "eglGetProcAddress");
 
@@ -728,11 +783,16 @@ void Loader::initialize_api(void* dso, egl_connection_t* cnx, uint32_t mask) {
         }
     }
 
+    const nsecs_t eglApiTime = systemTime();
+    if (mask & EGL) {
+        loadTimes.eglApi += eglApiTime - startTime;
+    }
+
     if (mask & GLESv1_CM) {
-        init_api(dso, gl_names_1, gl_names,
-            (__eglMustCastToProperFunctionPointerType*)
-                &cnx->hooks[egl_connection_t::GLESv1_INDEX]->gl,
-            getProcAddress);
+        std::lock_guard<std::mutex> lock(deferredGles1Lock);
+        deferredGles1 = true;
+        deferredGles1Dso = dso;
+        deferredGles1GetProcAddress = getProcAddress;
     }
 
     if (mask & GLESv2) {
@@ -740,6 +800,7 @@ void Loader::initialize_api(void* dso, egl_connection_t* cnx, uint32_t mask) {
             (__eglMustCastToProperFunctionPointerType*)
                 &cnx->hooks[egl_connection_t::GLESv2_INDEX]->gl,
             getProcAddress);
+        loadTimes.gles2Api += systemTime() - eglApiTime;
     }
 }
 
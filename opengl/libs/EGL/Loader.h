@@ -20,6 +20,8 @@
 #include <EGL/egl.h>
 #include <stdint.h>
 
+#include <mutex>
+
 namespace android {
 
 struct egl_connection_t;
@@ -50,6 +52,10 @@ public:
     void* open(egl_connection_t* cnx);
     void close(egl_connection_t* cnx);
 
+    // Fills the GLESv1 dispatch table, if open deferred it. Must be called before the first
+    // GLESv1 context is used.
+    void init_deferred_gles1_api(egl_connection_t* cnx);
+
 private:
     Loader();
     driver_t* attempt_to_load_angle(egl_connection_t* cnx);
@@ -59,6 +65,21 @@ private:
     void initialize_api(void* dso, egl_connection_t* cnx, uint32_t mask);
     void attempt_to_init_angle_backend(void* dso, egl_connection_t* cnx);
 
+    // Only apps that create a GLESv1 context use the GLESv1 entry points, so resolving them
+    // is left to init_deferred_gles1_api.
+    std::mutex deferredGles1Lock;
+    bool deferredGles1 = false;
+    void* deferredGles1Dso = nullptr;
+    getProcAddressType deferredGles1GetProcAddress = nullptr;
+
+    // Time spent in open, logged when debug.egl.loader.timing is set.
+    struct load_times_t {
+        int64_t driver;
+        int64_t eglApi;
+        int64_t gles2Api;
+        int64_t wrappersWait;
+    } loadTimes;
+
     static __attribute__((noinline)) void init_api(void* dso, const char* const* api,
                                                    const char* const* ref_api,
                                                    __eglMustCastToProperFunctionPointerType* curr,
@@ -717,6 +717,18 @@ bool MultifileBlobCache::removeFromHotCache(uint32_t entryHash) {
 }
 
 bool MultifileBlobCache::applyLRU(size_t cacheSizeLimit, size_t cacheEntryLimit) {
+    // A trim removes many entries, so look up the directory once and unlink relative to it
+    int dirFd = open(mMultifileDirName.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd == -1) {
+        ALOGE("LRU: Unable to open multifile dir: %s", mMultifileDirName.c_str());
+        return false;
+    }
+    bool result = applyLRU(dirFd, cacheSizeLimit, cacheEntryLimit);
+    close(dirFd);
+    return result;
+}
+
+bool MultifileBlobCache::applyLRU(int dirFd, size_t cacheSizeLimit, size_t cacheEntryLimit) {
     // Walk through our map of sorted last access times and remove files until under the limit
     for (auto cacheEntryIter = mEntryStats.begin(); cacheEntryIter != mEntryStats.end();) {
         uint32_t entryHash = cacheEntryIter->first;
@@ -731,9 +743,10 @@ bool MultifileBlobCache::applyLRU(size_t cacheSizeLimit, size_t cacheEntryLimit)
         removeFromHotCache(entryHash);
 
         // Remove it from the system
-        std::string entryPath = mMultifileDirName + "/" + std::to_string(entryHash);
-        if (remove(entryPath.c_str()) != 0) {
-            ALOGE("LRU: Error removing %s: %s", entryPath.c_str(), std::strerror(errno));
+        std::string entryName = std::to_string(entryHash);
+        if (unlinkat(dirFd, entryName.c_str(), 0) != 0) {
+            ALOGE("LRU: Error removing %s/%s: %s", mMultifileDirName.c_str(), entryName.c_str(),
+                  std::strerror(errno));
             return false;
         }
 
@@ -814,67 +827,87 @@ void MultifileBlobCache::trimCache() {
     }
 }
 
-// This function performs a task.  It only knows how to write files to disk,
-// but it could be expanded if needed.
-void MultifileBlobCache::processTask(DeferredTask& task) {
-    switch (task.getTaskCommand()) {
-        case TaskCommand::Exit: {
-            ALOGV("DEFERRED: Shutting down");
-            return;
-        }
-        case TaskCommand::WriteToDisk: {
-            uint32_t entryHash = task.getEntryHash();
-            std::string& fullPath = task.getFullPath();
-            uint8_t* buffer = task.getBuffer();
-            size_t bufferSize = task.getBufferSize();
-
-            // Create the file or reset it if already present, read+write for user only
-            int fd = open(fullPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
-            if (fd == -1) {
-                ALOGE("Cache error in SET - failed to open fullPath: %s, error: %s",
-                      fullPath.c_str(), std::strerror(errno));
-                return;
-            }
+// Write a single entry queued by set to disk
+void MultifileBlobCache::writeToDisk(DeferredTask& task) {
+    std::string& fullPath = task.getFullPath();
+    uint8_t* buffer = task.getBuffer();
+    size_t bufferSize = task.getBufferSize();
+
+    // Create the file or reset it if already present, read+write for user only
+    int fd = open(fullPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        ALOGE("Cache error in SET - failed to open fullPath: %s, error: %s", fullPath.c_str(),
+              std::strerror(errno));
+        return;
+    }
 
-            ALOGV("DEFERRED: Opened fd %i from %s", fd, fullPath.c_str());
+    ALOGV("DEFERRED: Opened fd %i from %s", fd, fullPath.c_str());
 
-            // Add CRC check to the header (always do this last!)
-            MultifileHeader* header = reinterpret_cast<MultifileHeader*>(buffer);
-            header->crc =
-                    crc32c(buffer + sizeof(MultifileHeader), bufferSize - sizeof(MultifileHeader));
+    // Add CRC check to the header (always do this last!)
+    MultifileHeader* header = reinterpret_cast<MultifileHeader*>(buffer);
+    header->crc = crc32c(buffer + sizeof(MultifileHeader), bufferSize - sizeof(MultifileHeader));
 
-            ssize_t result = write(fd, buffer, bufferSize);
-            if (result != bufferSize) {
-                ALOGE("Error writing fileSize to cache entry (%s): %s", fullPath.c_str(),
-                      std::strerror(errno));
-                return;
-            }
+    ssize_t result = write(fd, buffer, bufferSize);
+    close(fd);
+    if (result != bufferSize) {
+        ALOGE("Error writing fileSize to cache entry (%s): %s", fullPath.c_str(),
+              std::strerror(errno));
+        return;
+    }
 
-            ALOGV("DEFERRED: Completed write for: %s", fullPath.c_str());
-            close(fd);
-
-            // Erase the entry from mDeferredWrites
-            // Since there could be multiple outstanding writes for an entry, find the matching one
-            {
-                // Synchronize access to deferred write status
-                std::lock_guard<std::mutex> lock(mDeferredWriteStatusMutex);
-                typedef std::multimap<uint32_t, uint8_t*>::iterator entryIter;
-                std::pair<entryIter, entryIter> iterPair = mDeferredWrites.equal_range(entryHash);
-                for (entryIter it = iterPair.first; it != iterPair.second; ++it) {
-                    if (it->second == buffer) {
-                        ALOGV("DEFERRED: Marking write complete for %u at %p", it->first,
-                              it->second);
-                        mDeferredWrites.erase(it);
-                        break;
-                    }
+    ALOGV("DEFERRED: Completed write for: %s", fullPath.c_str());
+}
+
+// This function performs a batch of tasks.  It only knows how to write files to disk,
+// but it could be expanded if needed.
+void MultifileBlobCache::processTaskBatch(std::vector<DeferredTask>& tasks) {
+    // Entries are often set again before the last write of them has been done, and only the
+    // latest value needs to reach the disk, so find the last write of each entry
+    std::unordered_map<uint32_t, size_t> lastWrites;
+    for (size_t i = 0; i < tasks.size(); i++) {
+        if (tasks[i].getTaskCommand() == TaskCommand::WriteToDisk) {
+            lastWrites[tasks[i].getEntryHash()] = i;
+        }
+    }
+
+    for (size_t i = 0; i < tasks.size(); i++) {
+        DeferredTask& task = tasks[i];
+        switch (task.getTaskCommand()) {
+            case TaskCommand::WriteToDisk: {
+                if (lastWrites[task.getEntryHash()] != i) {
+                    ALOGV("DEFERRED: Skipping write for %u, a later one is queued",
+                          task.getEntryHash());
+                    break;
                 }
+                writeToDisk(task);
+                break;
+            }
+            default: {
+                ALOGE("DEFERRED: Unhandled task type");
+                break;
             }
-
-            return;
         }
-        default: {
-            ALOGE("DEFERRED: Unhandled task type");
-            return;
+    }
+
+    // Erase the entries from mDeferredWrites, including the ones that were skipped
+    // Since there could be multiple outstanding writes for an entry, find the matching one
+    {
+        // Synchronize access to deferred write status
+        std::lock_guard<std::mutex> lock(mDeferredWriteStatusMutex);
+        for (DeferredTask& task : tasks) {
+            if (task.getTaskCommand() != TaskCommand::WriteToDisk) {
+                continue;
+            }
+            typedef std::multimap<uint32_t, uint8_t*>::iterator entryIter;
+            std::pair<entryIter, entryIter> iterPair =
+                    mDeferredWrites.equal_range(task.getEntryHash());
+            for (entryIter it = iterPair.first; it != iterPair.second; ++it) {
+                if (it->second == task.getBuffer()) {
+                    ALOGV("DEFERRED: Marking write complete for %u at %p", it->first, it->second);
+                    mDeferredWrites.erase(it);
+                    break;
+                }
+            }
         }
     }
 }
@@ -894,19 +927,27 @@ void MultifileBlobCache::processTasksImpl(bool* exitThread) {
 
         ALOGV("WORKER: Task available, waking up.");
         mWorkerThreadIdle = false;
-        DeferredTask task = std::move(mTasks.front());
-        mTasks.pop();
 
-        if (task.getTaskCommand() == TaskCommand::Exit) {
+        if (mTasks.front().getTaskCommand() == TaskCommand::Exit) {
             ALOGV("WORKER: Exiting work loop.");
+            mTasks.pop();
             *exitThread = true;
             mWorkerThreadIdle = true;
             mWorkerIdleCondition.notify_one();
             return;
         }
 
+        // Take every task queued up to the next exit, so that a burst of sets is written as one
+        // batch
+        std::vector<DeferredTask> tasks;
+        while (!mTasks.empty() && mTasks.front().getTaskCommand() != TaskCommand::Exit) {
+            tasks.push_back(std::move(mTasks.front()));
+            mTasks.pop();
+        }
+
         lock.unlock();
-        processTask(task);
+        ALOGV("WORKER: Processing %zu tasks", tasks.size());
+        processTaskBatch(tasks);
     }
 }
 
@@ -29,6 +29,7 @@
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "FileBlobCache.h"
 
@@ -144,6 +145,7 @@ private:
     bool clearCache();
     void trimCache();
     bool applyLRU(size_t cacheSizeLimit, size_t cacheEntryLimit);
+    bool applyLRU(int dirFd, size_t cacheSizeLimit, size_t cacheEntryLimit);
 
     bool mInitialized;
     std::string mMultifileDirName;
@@ -174,7 +176,8 @@ private:
     // Functions to work through tasks in the queue
     void processTasks();
     void processTasksImpl(bool* exitThread);
-    void processTask(DeferredTask& task);
+    void processTaskBatch(std::vector<DeferredTask>& tasks);
+    void writeToDisk(DeferredTask& task);
 
     // Used by main thread to create work for the worker thread
     void queueTask(DeferredTask&& task);
@@ -307,6 +307,32 @@ TEST_F(MultifileBlobCacheTest, EnsureFileDescriptorsClosed) {
     ASSERT_LT(getFileDescriptorCount(), kMaxTotalEntries / 2);
 }
 
+TEST_F(MultifileBlobCacheTest, BurstOfSetsWritesLatestValues) {
+    // Set every entry a few times in a row, so the worker finds them queued together
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < kMaxTotalEntries / 4; i++) {
+            int value = i + round;
+            mMBC->set(&i, sizeof(i), &value, sizeof(value));
+        }
+    }
+
+    // Close the cache so everything writes out
+    mMBC->finish();
+    mMBC.reset();
+
+    // Ensure there is one file per entry
+    ASSERT_EQ(getCacheEntries().size(), kMaxTotalEntries / 4);
+
+    // Open it again and ensure the last value of each entry reached the disk
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0]));
+    for (int i = 0; i < kMaxTotalEntries / 4; i++) {
+        int result = 0;
+        ASSERT_EQ(sizeof(i), mMBC->get(&i, sizeof(i), &result, sizeof(result)));
+        ASSERT_EQ(i + 2, result);
+    }
+}
+
 std::vector<std::string> MultifileBlobCacheTest::getCacheEntries() {
     std::string cachePath = &mTempFile->path[0];
     std::string multifileDirName = cachePath + ".multifile";
@@ -42,6 +42,7 @@
 #include "EGL/egl.h"
 #include "EGL/eglext.h"
 #include "EGL/eglext_angle.h"
+#include "Loader.h"
 #include "egl_display.h"
 #include "egl_layers.h"
 #include "egl_object.h"
@@ -981,6 +982,7 @@ EGLContext eglCreateContextImpl(EGLDisplay dpy, EGLConfig config, EGLContext sha
                 }
             }
             if (version == egl_connection_t::GLESv1_INDEX) {
+                Loader::getInstance().init_deferred_gles1_api(cnx);
                 android::GraphicsEnv::getInstance().setTargetStats(
                         android::GpuStatsInfo::Stats::GLES_1_IN_USE);
             }
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <bpf/BpfMap.h>
+#include <errno.h>
+#include <linux/bpf.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace android {
+namespace bpfutils {
+
+// A copy of the entries of a BPF map. Keys and values are kept in separate arrays, which is the
+// layout that BPF_MAP_LOOKUP_BATCH fills. Not for per-CPU maps, whose values are per CPU.
+template <class Key, class Value>
+class BpfMapSnapshot {
+public:
+    size_t size() const { return mKeys.size(); }
+    const Key& key(size_t i) const { return mKeys[i]; }
+    const Value& value(size_t i) const { return mValues[i]; }
+
+    // Replaces the contents with the entries of |map|. BPF_MAP_LOOKUP_BATCH (Linux 5.6) reads
+    // many entries per syscall; where the kernel or the map type does not support it, the keys
+    // are walked one at a time. As with any read of a map that is being updated, an entry
+    // may be missed or seen twice.
+    void read(const bpf::BpfMapRO<Key, Value>& map) {
+        if (!readBatched(map)) {
+            readByKey(map);
+        }
+    }
+
+private:
+    // Entries read per syscall at first. Doubled when a hash bucket holds more than that.
+    static constexpr uint32_t kInitialBatchSize = 256;
+
+    bool readBatched(const bpf::BpfMapRO<Key, Value>& map) {
+        // Where the kernel stopped; a bucket index for hash maps and a key for the others.
+        alignas(uint64_t) uint8_t inBatch[std::max(sizeof(Key), sizeof(uint64_t))];
+        alignas(uint64_t) uint8_t outBatch[sizeof(inBatch)];
+        bool first = true;
+        uint32_t batchSize = kInitialBatchSize;
+        size_t count = 0;
+        while (true) {
+            mKeys.resize(count + batchSize);
+            mValues.resize(count + batchSize);
+
+            union bpf_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.batch.in_batch = first ? 0 : reinterpret_cast<uintptr_t>(inBatch);
+            attr.batch.out_batch = reinterpret_cast<uintptr_t>(outBatch);
+            attr.batch.keys = reinterpret_cast<uintptr_t>(&mKeys[count]);
+            attr.batch.values = reinterpret_cast<uintptr_t>(&mValues[count]);
+            attr.batch.count = batchSize;
+            attr.batch.map_fd = map.getMap().get();
+            const int error =
+                    syscall(__NR_bpf, BPF_MAP_LOOKUP_BATCH, &attr, sizeof(attr)) == 0 ? 0 : errno;
+
+            if (error == 0 || error == ENOENT) {
+                count += attr.batch.count;
+            }
+            mKeys.resize(count);
+            mValues.resize(count);
+            if (error == ENOENT) {
+                // The end of the map.
+                return true;
+            }
+            if (error == ENOSPC) {
+                // The next bucket does not fit; retry it with a larger batch.
+                batchSize *= 2;
+                continue;
+            }
+            if (error != 0) {
+                return false;
+            }
+            memcpy(inBatch, outBatch, sizeof(inBatch));
+            first = false;
+        }
+    }
+
+    void readByKey(const bpf::BpfMapRO<Key, Value>& map) {
+        mKeys.clear();
+        mValues.clear();
+        auto key = map.getFirstKey();
+        while (key.ok()) {
+            auto value = map.readValue(key.value());
+            if (value.ok()) {
+                mKeys.push_back(key.value());
+                mValues.push_back(value.value());
+            }
+            key = map.getNextKey(key.value());
+        }
+    }
+
+    std::vector<Key> mKeys;
+    std::vector<Value> mValues;
+};
+
+} // namespace bpfutils
+} // namespace android
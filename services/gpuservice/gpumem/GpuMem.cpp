@@ -21,6 +21,7 @@
 #include "gpumem/GpuMem.h"
 
 #include <android-base/stringprintf.h>
+#include <bpfutils/BpfMapSnapshot.h>
 #include <libbpf.h>
 #include <bpf/WaitForProgsLoaded.h>
 #include <log/log.h>
@@ -91,27 +92,17 @@ void GpuMem::dump(const Vector<String16>& /* args */, std::string* result) {
         return;
     }
 
-    auto res = mGpuMemTotalMap.getFirstKey();
-    if (!res.ok()) {
+    bpfutils::BpfMapSnapshot<uint64_t, uint64_t> snapshot;
+    snapshot.read(mGpuMemTotalMap);
+    if (!snapshot.size()) {
         result->append("GPU memory total usage map is empty\n");
         return;
     }
-    uint64_t key = res.value();
     // unordered_map<gpu_id, vector<pair<pid, size>>>
     std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, uint64_t>>> dumpMap;
-    while (true) {
-        uint32_t gpu_id = key >> 32;
-        uint32_t pid = key;
-
-        res = mGpuMemTotalMap.readValue(key);
-        if (!res.ok()) break;
-        uint64_t size = res.value();
-
-        dumpMap[gpu_id].emplace_back(pid, size);
-
-        res = mGpuMemTotalMap.getNextKey(key);
-        if (!res.ok()) break;
-        key = res.value();
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        const uint64_t key = snapshot.key(i);
+        dumpMap[key >> 32].emplace_back(static_cast<uint32_t>(key), snapshot.value(i));
     }
 
     for (auto& gpu : dumpMap) {
@@ -137,21 +128,16 @@ void GpuMem::dump(const Vector<String16>& /* args */, std::string* result) {
 
 void GpuMem::traverseGpuMemTotals(const std::function<void(int64_t ts, uint32_t gpuId, uint32_t pid,
                                                            uint64_t size)>& callback) {
-    auto res = mGpuMemTotalMap.getFirstKey();
-    if (!res.ok()) return;
-    uint64_t key = res.value();
-    while (true) {
-        uint32_t gpu_id = key >> 32;
-        uint32_t pid = key;
-
-        res = mGpuMemTotalMap.readValue(key);
-        if (!res.ok()) break;
-        uint64_t size = res.value();
-
-        callback(systemTime(), gpu_id, pid, size);
-        res = mGpuMemTotalMap.getNextKey(key);
-        if (!res.ok()) break;
-        key = res.value();
+    ATRACE_CALL();
+
+    // The map can hold an entry for every process that uses the GPU, so it is read in batches
+    // and all of its entries share the time of the read.
+    bpfutils::BpfMapSnapshot<uint64_t, uint64_t> snapshot;
+    snapshot.read(mGpuMemTotalMap);
+    const int64_t ts = systemTime();
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        const uint64_t key = snapshot.key(i);
+        callback(ts, key >> 32, static_cast<uint32_t>(key), snapshot.value(i));
     }
 }
 
@@ -26,6 +26,8 @@
 #include <statslog.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <functional>
 #include <unordered_set>
 
 namespace android {
@@ -84,36 +86,46 @@ static void addLoadingTime(GpuStatsInfo::Driver driver, int64_t driverLoadingTim
     }
 }
 
+GpuStats::AppStatsShard& GpuStats::appStatsShard(const std::string& appStatsKey) {
+    return mAppStatsShards[std::hash<std::string>{}(appStatsKey) % kAppStatsShardCount];
+}
+
 void GpuStats::purgeOldDriverStats() {
-    ALOG_ASSERT(mAppStats.size() == MAX_NUM_APP_RECORDS);
+    std::lock_guard<std::mutex> purgeLock(mPurgeLock);
+    // Another thread purged while this one waited.
+    if (mAppCount < MAX_NUM_APP_RECORDS) return;
+
+    // The shards are locked in order, which is the only place that holds more than one, so that
+    // the least recently used apps are found across all of them.
+    std::array<std::unique_lock<std::mutex>, kAppStatsShardCount> shardLocks;
+    for (size_t i = 0; i < kAppStatsShardCount; ++i) {
+        shardLocks[i] = std::unique_lock<std::mutex>(mAppStatsShards[i].lock);
+    }
 
     struct GpuStatsApp {
-        // Key is <app package name>+<driver version code>.
-        const std::string *appStatsKey = nullptr;
-        const std::chrono::time_point<std::chrono::system_clock> *lastAccessTime = nullptr;
+        std::unordered_map<std::string, GpuStatsAppInfo>* appStats;
+        std::unordered_map<std::string, GpuStatsAppInfo>::iterator app;
     };
-    std::vector<GpuStatsApp> gpuStatsApps(MAX_NUM_APP_RECORDS);
-
-    // Create a list of pointers to package names and their last access times.
-    int index = 0;
-    for (const auto & [appStatsKey, gpuStatsAppInfo] : mAppStats) {
-        GpuStatsApp &gpuStatsApp = gpuStatsApps[index];
-        gpuStatsApp.appStatsKey = &appStatsKey;
-        gpuStatsApp.lastAccessTime = &gpuStatsAppInfo.lastAccessTime;
-        ++index;
+    std::vector<GpuStatsApp> gpuStatsApps;
+    gpuStatsApps.reserve(mAppCount);
+    for (AppStatsShard& shard : mAppStatsShards) {
+        for (auto it = shard.appStats.begin(); it != shard.appStats.end(); ++it) {
+            gpuStatsApps.push_back({&shard.appStats, it});
+        }
     }
 
-    // Sort the list with the oldest access times at the front.
-    std::sort(gpuStatsApps.begin(), gpuStatsApps.end(), [](GpuStatsApp a, GpuStatsApp b) -> bool {
-        return *a.lastAccessTime < *b.lastAccessTime;
-    });
+    // Only the oldest apps have to be ordered ahead of the others.
+    const size_t numToRemove =
+            std::min(gpuStatsApps.size(), static_cast<size_t>(APP_RECORD_HEADROOM));
+    std::nth_element(gpuStatsApps.begin(), gpuStatsApps.begin() + numToRemove,
+                     gpuStatsApps.end(), [](const GpuStatsApp& a, const GpuStatsApp& b) {
+                         return a.app->second.lastAccessTime < b.app->second.lastAccessTime;
+                     });
 
-    // Remove the oldest packages from mAppStats to make room for new apps.
-    for (int i = 0; i < APP_RECORD_HEADROOM; ++i) {
-        mAppStats.erase(*gpuStatsApps[i].appStatsKey);
-        gpuStatsApps[i].appStatsKey = nullptr;
-        gpuStatsApps[i].lastAccessTime = nullptr;
+    for (size_t i = 0; i < numToRemove; ++i) {
+        gpuStatsApps[i].appStats->erase(gpuStatsApps[i].app);
     }
+    mAppCount -= numToRemove;
 }
 
 void GpuStats::insertDriverStats(const std::string& driverPackageName,
@@ -123,7 +135,6 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
                                  bool isDriverLoaded, int64_t driverLoadingTime) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
     registerStatsdCallbacksIfNeeded();
     ALOGV("Received:\n"
           "\tdriverPackageName[%s]\n"
@@ -139,40 +150,45 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
           appPackageName.c_str(), vulkanVersion, static_cast<int32_t>(driver), isDriverLoaded,
           driverLoadingTime);
 
-    if (!mGlobalStats.count(driverVersionCode)) {
-        GpuStatsGlobalInfo globalInfo;
-        addLoadingCount(driver, isDriverLoaded, &globalInfo);
-        globalInfo.driverPackageName = driverPackageName;
-        globalInfo.driverVersionName = driverVersionName;
-        globalInfo.driverVersionCode = driverVersionCode;
-        globalInfo.driverBuildTime = driverBuildTime;
-        globalInfo.vulkanVersion = vulkanVersion;
-        mGlobalStats.insert({driverVersionCode, globalInfo});
-    } else {
-        addLoadingCount(driver, isDriverLoaded, &mGlobalStats[driverVersionCode]);
+    {
+        std::lock_guard<std::mutex> lock(mGlobalLock);
+        auto [globalInfo, inserted] = mGlobalStats.try_emplace(driverVersionCode);
+        if (inserted) {
+            globalInfo->second.driverPackageName = driverPackageName;
+            globalInfo->second.driverVersionName = driverVersionName;
+            globalInfo->second.driverVersionCode = driverVersionCode;
+            globalInfo->second.driverBuildTime = driverBuildTime;
+            globalInfo->second.vulkanVersion = vulkanVersion;
+        }
+        addLoadingCount(driver, isDriverLoaded, &globalInfo->second);
     }
 
     const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-    if (!mAppStats.count(appStatsKey)) {
-        if (mAppStats.size() >= MAX_NUM_APP_RECORDS) {
+    AppStatsShard& shard = appStatsShard(appStatsKey);
+    std::unique_lock<std::mutex> lock(shard.lock);
+    auto foundApp = shard.appStats.find(appStatsKey);
+    if (foundApp == shard.appStats.end()) {
+        // Purged with the shard unlocked, since purging locks all of them.
+        lock.unlock();
+        if (mAppCount >= MAX_NUM_APP_RECORDS) {
             ALOGV("GpuStatsAppInfo has reached maximum size. Removing old stats to make room.");
             purgeOldDriverStats();
         }
-
-        GpuStatsAppInfo appInfo;
-        addLoadingTime(driver, driverLoadingTime, &appInfo);
-        appInfo.appPackageName = appPackageName;
-        appInfo.driverVersionCode = driverVersionCode;
-        appInfo.angleInUse =
-                driver == GpuStatsInfo::Driver::ANGLE || driverPackageName == "angle";
-        appInfo.lastAccessTime = std::chrono::system_clock::now();
-        mAppStats.insert({appStatsKey, appInfo});
-    } else {
-        mAppStats[appStatsKey].angleInUse =
-                driver == GpuStatsInfo::Driver::ANGLE || driverPackageName == "angle";
-        addLoadingTime(driver, driverLoadingTime, &mAppStats[appStatsKey]);
-        mAppStats[appStatsKey].lastAccessTime = std::chrono::system_clock::now();
+        lock.lock();
+
+        bool inserted;
+        std::tie(foundApp, inserted) = shard.appStats.try_emplace(appStatsKey);
+        if (inserted) {
+            foundApp->second.appPackageName = appPackageName;
+            foundApp->second.driverVersionCode = driverVersionCode;
+            ++mAppCount;
+        }
     }
+
+    GpuStatsAppInfo& appInfo = foundApp->second;
+    appInfo.angleInUse = driver == GpuStatsInfo::Driver::ANGLE || driverPackageName == "angle";
+    addLoadingTime(driver, driverLoadingTime, &appInfo);
+    appInfo.lastAccessTime = std::chrono::system_clock::now();
 }
 
 void GpuStats::insertTargetStats(const std::string& appPackageName,
@@ -191,11 +207,12 @@ void GpuStats::addVulkanEngineName(const std::string& appPackageName,
                                           GpuStatsAppInfo::MAX_VULKAN_ENGINE_NAME_LENGTH);
     const std::string engineName{engineNameCStr, engineNameLen};
 
-    std::lock_guard<std::mutex> lock(mLock);
     registerStatsdCallbacksIfNeeded();
 
-    const auto foundApp = mAppStats.find(appStatsKey);
-    if (foundApp == mAppStats.end()) {
+    AppStatsShard& shard = appStatsShard(appStatsKey);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    const auto foundApp = shard.appStats.find(appStatsKey);
+    if (foundApp == shard.appStats.end()) {
         return;
     }
 
@@ -215,11 +232,12 @@ void GpuStats::insertTargetStatsArray(const std::string& appPackageName,
 
     const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
 
-    std::lock_guard<std::mutex> lock(mLock);
     registerStatsdCallbacksIfNeeded();
 
-    const auto foundApp = mAppStats.find(appStatsKey);
-    if (foundApp == mAppStats.end()) {
+    AppStatsShard& shard = appStatsShard(appStatsKey);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    const auto foundApp = shard.appStats.find(appStatsKey);
+    if (foundApp == shard.appStats.end()) {
         return;
     }
 
@@ -295,13 +313,45 @@ void GpuStats::interceptSystemDriverStatsLocked() {
 }
 
 void GpuStats::registerStatsdCallbacksIfNeeded() {
-    if (!mStatsdRegistered) {
+    std::call_once(mStatsdRegisterOnce, [this] {
         AStatsManager_setPullAtomCallback(android::util::GPU_STATS_GLOBAL_INFO, nullptr,
                                          GpuStats::pullAtomCallback, this);
         AStatsManager_setPullAtomCallback(android::util::GPU_STATS_APP_INFO, nullptr,
                                          GpuStats::pullAtomCallback, this);
         mStatsdRegistered = true;
+    });
+}
+
+std::vector<GpuStatsGlobalInfo> GpuStats::snapshotGlobalStats(bool clear) {
+    std::lock_guard<std::mutex> lock(mGlobalLock);
+    // flush cpuVulkanVersion and glesVersion to builtin driver stats
+    interceptSystemDriverStatsLocked();
+
+    std::vector<GpuStatsGlobalInfo> globalStats;
+    globalStats.reserve(mGlobalStats.size());
+    for (auto& ele : mGlobalStats) {
+        globalStats.push_back(clear ? std::move(ele.second) : ele.second);
+    }
+    if (clear) mGlobalStats.clear();
+    return globalStats;
+}
+
+std::vector<GpuStatsAppInfo> GpuStats::snapshotAppStats(bool clear) {
+    std::vector<GpuStatsAppInfo> appStats;
+    appStats.reserve(mAppCount);
+    // The shards are taken one at a time, so an app which is added meanwhile to a shard which was
+    // already taken is left for the next snapshot.
+    for (AppStatsShard& shard : mAppStatsShards) {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        for (auto& ele : shard.appStats) {
+            appStats.push_back(clear ? std::move(ele.second) : ele.second);
+        }
+        if (clear) {
+            mAppCount -= shard.appStats.size();
+            shard.appStats.clear();
+        }
     }
+    return appStats;
 }
 
 void GpuStats::dump(const Vector<String16>& args, std::string* result) {
@@ -312,63 +362,37 @@ void GpuStats::dump(const Vector<String16>& args, std::string* result) {
         return;
     }
 
-    std::lock_guard<std::mutex> lock(mLock);
-    bool dumpAll = true;
-
     std::unordered_set<std::string> argsSet;
     for (size_t i = 0; i < args.size(); i++) {
         argsSet.insert(String8(args[i]).c_str());
     }
 
-    const bool dumpGlobal = argsSet.count("--global") != 0;
-    if (dumpGlobal) {
-        dumpGlobalLocked(result);
-        dumpAll = false;
-    }
+    // The stats which are dumped are the ones cleared, and are taken in the same step, so that
+    // none are cleared without being dumped.
+    const bool clear = argsSet.count("--clear") != 0;
+    const bool dumpGlobalArg = argsSet.count("--global") != 0;
+    const bool dumpAppArg = argsSet.count("--app") != 0;
+    const bool dumpAll = !dumpGlobalArg && !dumpAppArg;
 
-    const bool dumpApp = argsSet.count("--app") != 0;
-    if (dumpApp) {
-        dumpAppLocked(result);
-        dumpAll = false;
+    if (dumpGlobalArg || dumpAll) {
+        dumpGlobal(result, clear);
     }
 
-    if (dumpAll) {
-        dumpGlobalLocked(result);
-        dumpAppLocked(result);
-    }
-
-    if (argsSet.count("--clear")) {
-        bool clearAll = true;
-
-        if (dumpGlobal) {
-            mGlobalStats.clear();
-            clearAll = false;
-        }
-
-        if (dumpApp) {
-            mAppStats.clear();
-            clearAll = false;
-        }
-
-        if (clearAll) {
-            mGlobalStats.clear();
-            mAppStats.clear();
-        }
+    if (dumpAppArg || dumpAll) {
+        dumpApp(result, clear);
     }
 }
 
-void GpuStats::dumpGlobalLocked(std::string* result) {
-    interceptSystemDriverStatsLocked();
-
-    for (const auto& ele : mGlobalStats) {
-        result->append(ele.second.toString());
+void GpuStats::dumpGlobal(std::string* result, bool clear) {
+    for (const auto& globalInfo : snapshotGlobalStats(clear)) {
+        result->append(globalInfo.toString());
         result->append("\n");
     }
 }
 
-void GpuStats::dumpAppLocked(std::string* result) {
-    for (const auto& ele : mAppStats) {
-        result->append(ele.second.toString());
+void GpuStats::dumpApp(std::string* result, bool clear) {
+    for (const auto& appInfo : snapshotAppStats(clear)) {
+        result->append(appInfo.toString());
         result->append("\n");
     }
 }
@@ -405,83 +429,77 @@ static std::string int64VectorToProtoByteString(const std::vector<int64_t>& valu
 AStatsManager_PullAtomCallbackReturn GpuStats::pullAppInfoAtom(AStatsEventList* data) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
+    const std::vector<GpuStatsAppInfo> appStats = snapshotAppStats(/*clear=*/true);
 
     if (data) {
-        for (const auto& ele : mAppStats) {
+        for (const auto& appInfo : appStats) {
             std::string glDriverBytes = int64VectorToProtoByteString(
-                ele.second.glDriverLoadingTime);
+                appInfo.glDriverLoadingTime);
             std::string vkDriverBytes = int64VectorToProtoByteString(
-                ele.second.vkDriverLoadingTime);
+                appInfo.vkDriverLoadingTime);
             std::string angleDriverBytes = int64VectorToProtoByteString(
-                ele.second.angleDriverLoadingTime);
+                appInfo.angleDriverLoadingTime);
 
             std::vector<const char*> engineNames;
-            for (const std::string &engineName : ele.second.vulkanEngineNames) {
+            for (const std::string &engineName : appInfo.vulkanEngineNames) {
                 engineNames.push_back(engineName.c_str());
             }
 
             android::util::addAStatsEvent(
                     data,
                     android::util::GPU_STATS_APP_INFO,
-                    ele.second.appPackageName.c_str(),
-                    ele.second.driverVersionCode,
+                    appInfo.appPackageName.c_str(),
+                    appInfo.driverVersionCode,
                     android::util::BytesField(glDriverBytes.c_str(),
                                               glDriverBytes.length()),
                     android::util::BytesField(vkDriverBytes.c_str(),
                                               vkDriverBytes.length()),
                     android::util::BytesField(angleDriverBytes.c_str(),
                                               angleDriverBytes.length()),
-                    ele.second.cpuVulkanInUse,
-                    ele.second.falsePrerotation,
-                    ele.second.gles1InUse,
-                    ele.second.angleInUse,
-                    ele.second.createdGlesContext,
-                    ele.second.createdVulkanDevice,
-                    ele.second.createdVulkanSwapchain,
-                    ele.second.vulkanApiVersion,
-                    ele.second.vulkanDeviceFeaturesEnabled,
-                    ele.second.vulkanInstanceExtensions,
-                    ele.second.vulkanDeviceExtensions,
+                    appInfo.cpuVulkanInUse,
+                    appInfo.falsePrerotation,
+                    appInfo.gles1InUse,
+                    appInfo.angleInUse,
+                    appInfo.createdGlesContext,
+                    appInfo.createdVulkanDevice,
+                    appInfo.createdVulkanSwapchain,
+                    appInfo.vulkanApiVersion,
+                    appInfo.vulkanDeviceFeaturesEnabled,
+                    appInfo.vulkanInstanceExtensions,
+                    appInfo.vulkanDeviceExtensions,
                     engineNames);
         }
     }
 
-    mAppStats.clear();
-
     return AStatsManager_PULL_SUCCESS;
 }
 
 AStatsManager_PullAtomCallbackReturn GpuStats::pullGlobalInfoAtom(AStatsEventList* data) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
-    // flush cpuVulkanVersion and glesVersion to builtin driver stats
-    interceptSystemDriverStatsLocked();
+    const std::vector<GpuStatsGlobalInfo> globalStats = snapshotGlobalStats(/*clear=*/true);
 
     if (data) {
-        for (const auto& ele : mGlobalStats) {
+        for (const auto& globalInfo : globalStats) {
           android::util::addAStatsEvent(
                   data,
                   android::util::GPU_STATS_GLOBAL_INFO,
-                  ele.second.driverPackageName.c_str(),
-                  ele.second.driverVersionName.c_str(),
-                  ele.second.driverVersionCode,
-                  ele.second.driverBuildTime,
-                  ele.second.glLoadingCount,
-                  ele.second.glLoadingFailureCount,
-                  ele.second.vkLoadingCount,
-                  ele.second.vkLoadingFailureCount,
-                  ele.second.vulkanVersion,
-                  ele.second.cpuVulkanVersion,
-                  ele.second.glesVersion,
-                  ele.second.angleLoadingCount,
-                  ele.second.angleLoadingFailureCount);
+                  globalInfo.driverPackageName.c_str(),
+                  globalInfo.driverVersionName.c_str(),
+                  globalInfo.driverVersionCode,
+                  globalInfo.driverBuildTime,
+                  globalInfo.glLoadingCount,
+                  globalInfo.glLoadingFailureCount,
+                  globalInfo.vkLoadingCount,
+                  globalInfo.vkLoadingFailureCount,
+                  globalInfo.vulkanVersion,
+                  globalInfo.cpuVulkanVersion,
+                  globalInfo.glesVersion,
+                  globalInfo.angleLoadingCount,
+                  globalInfo.angleLoadingFailureCount);
         }
     }
 
-    mGlobalStats.clear();
-
     return AStatsManager_PULL_SUCCESS;
 }
 
@@ -22,6 +22,8 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -55,7 +57,7 @@ public:
     // Below limits the memory usage of GpuStats to be less than 10KB. This is
     // the preferred number for statsd while maintaining nice data quality.
     static const size_t MAX_NUM_APP_RECORDS = 100;
-    // The number of apps to remove when mAppStats fills up.
+    // The number of apps to remove when the app stats fill up.
     static const size_t APP_RECORD_HEADROOM = 10;
 
 private:
@@ -67,30 +69,52 @@ private:
                                                                  AStatsEventList* data,
                                                                  void* cookie);
 
-    // Remove old packages from mAppStats.
+    // The apps are spread across shards by their key, so that the apps which load a driver at
+    // the same time rarely wait for each other.
+    static constexpr size_t kAppStatsShardCount = 8;
+    struct AppStatsShard {
+        std::mutex lock;
+        // Key is <app package name>+<driver version code>.
+        std::unordered_map<std::string, GpuStatsAppInfo> appStats;
+    };
+
+    AppStatsShard& appStatsShard(const std::string& appStatsKey);
+    // Runs update on the stats of the app if they are recorded. Returns false otherwise.
+    template <typename Update>
+    bool updateAppStats(const std::string& appStatsKey, Update&& update);
+    // Remove the least recently used packages from the app stats to make room for new apps.
     void purgeOldDriverStats();
+    // Copies the stats, or moves them out if clear is set, so that they are serialized without
+    // holding the locks.
+    std::vector<GpuStatsGlobalInfo> snapshotGlobalStats(bool clear);
+    std::vector<GpuStatsAppInfo> snapshotAppStats(bool clear);
 
     // Pull global into into global atom.
     AStatsManager_PullAtomCallbackReturn pullGlobalInfoAtom(AStatsEventList* data);
     // Pull app into into app atom.
     AStatsManager_PullAtomCallbackReturn pullAppInfoAtom(AStatsEventList* data);
-    // Dump global stats
-    void dumpGlobalLocked(std::string* result);
-    // Dump app stats
-    void dumpAppLocked(std::string* result);
+    // Dump global stats, and clear them if clear is set
+    void dumpGlobal(std::string* result, bool clear);
+    // Dump app stats, and clear them if clear is set
+    void dumpApp(std::string* result, bool clear);
     // Append cpuVulkanVersion and glesVersion to system driver stats
     void interceptSystemDriverStatsLocked();
     // Registers statsd callbacks if they have not already been registered
     void registerStatsdCallbacksIfNeeded();
 
-    // GpuStats access should be guarded by mLock.
-    std::mutex mLock;
+    std::once_flag mStatsdRegisterOnce;
     // True if statsd callbacks have been registered.
-    bool mStatsdRegistered = false;
+    std::atomic_bool mStatsdRegistered = false;
+    // Guards mGlobalStats.
+    std::mutex mGlobalLock;
     // Key is driver version code.
     std::unordered_map<uint64_t, GpuStatsGlobalInfo> mGlobalStats;
-    // Key is <app package name>+<driver version code>.
-    std::unordered_map<std::string, GpuStatsAppInfo> mAppStats;
+    std::array<AppStatsShard, kAppStatsShardCount> mAppStatsShards;
+    // The number of apps across the shards, which is kept within MAX_NUM_APP_RECORDS, give or
+    // take the apps which are being added at the same time.
+    std::atomic_size_t mAppCount = 0;
+    // Held while purging, so that only one thread does.
+    std::mutex mPurgeLock;
 };
 
 } // namespace android
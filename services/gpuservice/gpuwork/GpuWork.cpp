@@ -23,6 +23,7 @@
 #include <android-base/stringprintf.h>
 #include <binder/PermissionCache.h>
 #include <bpf/WaitForProgsLoaded.h>
+#include <bpfutils/BpfMapSnapshot.h>
 #include <libbpf.h>
 #include <log/log.h>
 #include <random>
@@ -173,6 +174,9 @@ void GpuWork::dump(const Vector<String16>& /* args */, std::string* result) {
 
     // Ordered map ensures output data is sorted.
     std::map<GpuIdUid, UidTrackingInfo, decltype(lessThanGpuIdUid)*> dumpMap(&lessThanGpuIdUid);
+    size_t lastPullEntries;
+    int64_t lastPullReadDuration;
+    int64_t lastPullDuration;
 
     {
         std::lock_guard<std::mutex> lock(mMutex);
@@ -194,13 +198,15 @@ void GpuWork::dump(const Vector<String16>& /* args */, std::string* result) {
         // thus the returned value is not being concurrently accessed by the BPF
         // program (no atomic reads needed below).
 
-        mGpuWorkMap.iterateWithValue(
-                [&dumpMap](const GpuIdUid& key, const UidTrackingInfo& value,
-                           const android::bpf::BpfMap<GpuIdUid, UidTrackingInfo>&)
-                        -> base::Result<void> {
-                    dumpMap[key] = value;
-                    return {};
-                });
+        bpfutils::BpfMapSnapshot<GpuIdUid, UidTrackingInfo> snapshot;
+        snapshot.read(mGpuWorkMap);
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            dumpMap[snapshot.key(i)] = snapshot.value(i);
+        }
+
+        lastPullEntries = mLastPullEntries;
+        lastPullReadDuration = mLastPullReadDuration;
+        lastPullDuration = mLastPullDuration;
     }
 
     // Dump work information.
@@ -224,6 +230,10 @@ void GpuWork::dump(const Vector<String16>& /* args */, std::string* result) {
                       idToUidInfo.second.total_active_duration_ns,
                       idToUidInfo.second.total_inactive_duration_ns);
     }
+
+    StringAppendF(result,
+                  "Last pull: %zu entries read in %" PRId64 " us, %" PRId64 " us in total\n",
+                  lastPullEntries, ns2us(lastPullReadDuration), ns2us(lastPullDuration));
 }
 
 bool GpuWork::attachTracepoint(const char* programPath, const char* tracepointGroup,
@@ -274,58 +284,83 @@ AStatsManager_PullAtomCallbackReturn GpuWork::pullWorkAtoms(AStatsEventList* dat
         return AStatsManager_PULL_SKIP;
     }
 
-    std::lock_guard<std::mutex> lock(mMutex);
-
-    if (!mGpuWorkMap.isValid()) {
-        return AStatsManager_PULL_SKIP;
-    }
+    const nsecs_t pullStartTime = systemTime();
 
     std::unordered_map<GpuIdUid, UidTrackingInfo, decltype(hashGpuIdUid)*, decltype(equalGpuIdUid)*>
             workMap(32, &hashGpuIdUid, &equalGpuIdUid);
 
-    // Iteration of BPF hash maps can be unreliable (no data races, but elements
-    // may be repeated), as the map is typically being modified by other
-    // threads. The buckets are all preallocated. Our eBPF program only updates
-    // entries (in-place) or adds entries. |GpuWork| only iterates or clears the
-    // map while holding |mMutex|. Given this, we should be able to iterate over
-    // all elements reliably. Nevertheless, we copy into a map to avoid
-    // duplicates.
-
-    // Note that userspace reads of BPF maps make a copy of the value, and thus
-    // the returned value is not being concurrently accessed by the BPF program
-    // (no atomic reads needed below).
-
-    mGpuWorkMap.iterateWithValue([&workMap](const GpuIdUid& key, const UidTrackingInfo& value,
-                                            const android::bpf::BpfMap<GpuIdUid, UidTrackingInfo>&)
-                                         -> base::Result<void> {
-        workMap[key] = value;
-        return {};
-    });
-
     // Get a list of just the UIDs; the order does not matter.
     std::vector<Uid> uids;
     // Get a list of the GPU IDs, in order.
     std::set<uint32_t> gpuIds;
+
+    int32_t duration;
+
+    // Only the snapshot and the clearing of the map are done with |mMutex| held, so that the
+    // map clearer thread and |dump| are not held up by the processing and logging below.
     {
-        // To avoid adding duplicate UIDs.
-        std::unordered_set<Uid> addedUids;
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (!mGpuWorkMap.isValid()) {
+            return AStatsManager_PULL_SKIP;
+        }
+
+        // Iteration of BPF hash maps can be unreliable (no data races, but elements
+        // may be repeated), as the map is typically being modified by other
+        // threads. The buckets are all preallocated. Our eBPF program only updates
+        // entries (in-place) or adds entries. |GpuWork| only iterates or clears the
+        // map while holding |mMutex|. Given this, we should be able to iterate over
+        // all elements reliably. Nevertheless, we copy into a map to avoid
+        // duplicates.
 
-        for (const auto& workInfo : workMap) {
-            if (addedUids.insert(workInfo.first.uid).second) {
-                // Insertion was successful.
-                uids.push_back(workInfo.first.uid);
+        // Note that userspace reads of BPF maps make a copy of the value, and thus
+        // the returned value is not being concurrently accessed by the BPF program
+        // (no atomic reads needed below).
+
+        const nsecs_t readStartTime = systemTime();
+        bpfutils::BpfMapSnapshot<GpuIdUid, UidTrackingInfo> snapshot;
+        snapshot.read(mGpuWorkMap);
+        mLastPullEntries = snapshot.size();
+        mLastPullReadDuration = systemTime() - readStartTime;
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            workMap[snapshot.key(i)] = snapshot.value(i);
+        }
+
+        {
+            // To avoid adding duplicate UIDs.
+            std::unordered_set<Uid> addedUids;
+
+            for (const auto& workInfo : workMap) {
+                if (addedUids.insert(workInfo.first.uid).second) {
+                    // Insertion was successful.
+                    uids.push_back(workInfo.first.uid);
+                }
+                gpuIds.insert(workInfo.first.gpu_id);
             }
-            gpuIds.insert(workInfo.first.gpu_id);
         }
-    }
 
-    ALOGI("pullWorkAtoms: uids.size() == %zu", uids.size());
-    ALOGI("pullWorkAtoms: gpuIds.size() == %zu", gpuIds.size());
+        ALOGI("pullWorkAtoms: uids.size() == %zu", uids.size());
+        ALOGI("pullWorkAtoms: gpuIds.size() == %zu", gpuIds.size());
 
-    if (gpuIds.size() > kNumGpusHardLimit) {
-        // If we observe a very high number of GPUs then something has probably
-        // gone wrong, so don't log any atoms.
-        return AStatsManager_PULL_SKIP;
+        if (gpuIds.size() > kNumGpusHardLimit) {
+            // If we observe a very high number of GPUs then something has probably
+            // gone wrong, so don't log any atoms.
+            return AStatsManager_PULL_SKIP;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        duration = static_cast<int32_t>(
+                std::chrono::duration_cast<std::chrono::seconds>(now - mPreviousMapClearTimePoint)
+                        .count());
+
+        // The snapshot holds everything that is logged below, so the map can be cleared now.
+        clearMap();
+
+        if (duration < 0) {
+            // This is essentially impossible. If it does somehow happen, give up,
+            // but still clear the map.
+            return AStatsManager_PULL_SKIP;
+        }
     }
 
     size_t numSampledUids = kNumSampledUids;
@@ -384,18 +419,6 @@ AStatsManager_PullAtomCallbackReturn GpuWork::pullWorkAtoms(AStatsEventList* dat
 
     ALOGI("pullWorkAtoms: after random selection: uids.size() == %zu", uids.size());
 
-    auto now = std::chrono::steady_clock::now();
-    int32_t duration =
-            static_cast<int32_t>(
-                std::chrono::duration_cast<std::chrono::seconds>(now - mPreviousMapClearTimePoint)
-                    .count());
-    if (duration < 0) {
-        // This is essentially impossible. If it does somehow happen, give up,
-        // but still clear the map.
-        clearMap();
-        return AStatsManager_PULL_SKIP;
-    }
-
     // Log an atom for each (gpu id, uid) pair for which we have data.
     for (uint32_t gpuId : gpuIds) {
         for (Uid uid : uids) {
@@ -430,7 +453,13 @@ AStatsManager_PullAtomCallbackReturn GpuWork::pullWorkAtoms(AStatsEventList* dat
                                           total_inactive_duration_ms);
         }
     }
-    clearMap();
+
+    const nsecs_t pullDuration = systemTime() - pullStartTime;
+    ALOGI("pullWorkAtoms: took %" PRId64 " us", ns2us(pullDuration));
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mLastPullDuration = pullDuration;
+    }
     return AStatsManager_PULL_SUCCESS;
 }
 
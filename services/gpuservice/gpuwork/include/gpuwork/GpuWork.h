@@ -130,6 +130,12 @@ private:
     // The previous time point at which |mGpuWorkMap| was cleared.
     std::chrono::steady_clock::time_point mPreviousMapClearTimePoint GUARDED_BY(mMutex);
 
+    // The cost of the last pull, shown by |dump|: the number of entries read from
+    // |mGpuWorkMap|, the time the read took and the time of the whole pull, in nanoseconds.
+    size_t mLastPullEntries GUARDED_BY(mMutex) = 0;
+    int64_t mLastPullReadDuration GUARDED_BY(mMutex) = 0;
+    int64_t mLastPullDuration GUARDED_BY(mMutex) = 0;
+
     // Permission to register a statsd puller.
     static constexpr char16_t kPermissionRegisterStatsPullAtom[] =
             u"android.permission.REGISTER_STATS_PULL_ATOM";
@@ -27,6 +27,9 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "TestableGpuMem.h"
 
 namespace android {
@@ -44,6 +47,8 @@ constexpr uint64_t TEST_PROC_KEY_2 = 4294967298; // (1 << 32) + 2
 constexpr uint64_t TEST_PROC_VAL_2 = 345;
 constexpr uint32_t TEST_KEY_MASK = 0x1 | 0x2 | 0x4;
 constexpr uint32_t TEST_KEY_COUNT = 3;
+// More entries than the GPU memory maps are read with in one batch.
+constexpr uint32_t TEST_MANY_PROC_COUNT = 1000;
 
 class GpuMemTest : public testing::Test {
 public:
@@ -166,5 +171,28 @@ TEST_F(GpuMemTest, traverseGpuMemTotals) {
     EXPECT_EQ(sCount, TEST_KEY_COUNT);
 }
 
+TEST_F(GpuMemTest, traverseGpuMemTotalsOfManyProcesses) {
+    mTestMap.resetMap(BPF_MAP_TYPE_HASH, TEST_MANY_PROC_COUNT, BPF_F_NO_PREALLOC);
+    ASSERT_TRUE(mTestMap.isValid());
+    for (uint32_t pid = 1; pid <= TEST_MANY_PROC_COUNT; pid++) {
+        ASSERT_RESULT_OK(mTestMap.writeValue(pid, pid * 10, BPF_ANY));
+    }
+    mTestableGpuMem.setGpuMemTotalMap(mTestMap);
+
+    static std::vector<bool> sSeen;
+    sSeen.assign(TEST_MANY_PROC_COUNT + 1, false);
+    mGpuMem->traverseGpuMemTotals([](int64_t, uint32_t gpuId, uint32_t pid, uint64_t size) {
+        EXPECT_EQ(gpuId, 0u);
+        ASSERT_GE(pid, 1u);
+        ASSERT_LE(pid, TEST_MANY_PROC_COUNT);
+        EXPECT_EQ(size, pid * 10);
+        EXPECT_FALSE(sSeen[pid]);
+        sSeen[pid] = true;
+    });
+
+    EXPECT_EQ(static_cast<uint32_t>(std::count(sSeen.begin(), sSeen.end(), true)),
+              TEST_MANY_PROC_COUNT);
+}
+
 } // namespace
 } // namespace android
@@ -25,6 +25,7 @@
 #include <gtest/gtest.h>
 #include <stats_pull_atom_callback.h>
 #include <statslog.h>
+#include <thread>
 #include <utils/Looper.h>
 #include <utils/String16.h>
 #include <utils/Vector.h>
@@ -462,6 +463,42 @@ TEST_F(GpuStatsTest, canInsertMoreThanMaxNumAppRecords) {
     }
 }
 
+// Verify the stats inserted from many threads at once are all recorded.
+TEST_F(GpuStatsTest, canInsertFromManyThreads) {
+    constexpr int kNumThreads = 4;
+    constexpr int kNumAppsPerThread = 20;
+    static_assert(kNumThreads * kNumAppsPerThread <= GpuStats::MAX_NUM_APP_RECORDS);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t) {
+        threads.emplace_back([this, t] {
+            for (int i = 0; i < kNumAppsPerThread; ++i) {
+                const std::string appPkgName =
+                        "testapp_" + std::to_string(t * kNumAppsPerThread + i);
+                mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
+                                             BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME,
+                                             appPkgName, VULKAN_VERSION,
+                                             GpuStatsInfo::Driver::GL, true,
+                                             DRIVER_LOADING_TIME_1);
+                mGpuStats->insertTargetStats(appPkgName, BUILTIN_DRIVER_VER_CODE,
+                                             GpuStatsInfo::Stats::CPU_VULKAN_IN_USE, 0);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    const std::string expectedCount =
+            "glLoadingCount = " + std::to_string(kNumThreads * kNumAppsPerThread);
+    EXPECT_THAT(inputCommand(InputCommand::DUMP_GLOBAL), HasSubstr(expectedCount));
+    const std::string appDump = inputCommand(InputCommand::DUMP_APP);
+    for (int i = 0; i < kNumThreads * kNumAppsPerThread; ++i) {
+        // Add a newline to search for the exact package name.
+        EXPECT_THAT(appDump, HasSubstr("testapp_" + std::to_string(i) + "\n"));
+    }
+}
+
 TEST_F(GpuStatsTest, canDumpAllBeforeClearAll) {
     mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
                                  BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME, APP_PKG_NAME_1,
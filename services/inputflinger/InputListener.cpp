@@ -26,8 +26,15 @@
 #include <android/log.h>
 #include <input/TraceTools.h>
 
+#include <algorithm>
+#include <optional>
+#include <type_traits>
+
 using android::base::StringPrintf;
 
+#define INDENT1 "  "
+#define INDENT2 "    "
+
 namespace android {
 
 std::list<NotifyArgs>& operator+=(std::list<NotifyArgs>& keep, std::list<NotifyArgs>&& consume) {
@@ -104,63 +111,161 @@ void QueuedInputListener::flush() {
 
 // --- TracedInputListener ---
 
+namespace {
+
+// The time that the stages after the current one of this thread took so far. A stage nests the
+// call to the next one, so each stage leaves out the time that the calls it made took.
+thread_local nsecs_t sNextStagesTime = 0;
+
+template <typename Args>
+std::optional<nsecs_t> getReadTime(const Args& args) {
+    if constexpr (std::is_same_v<Args, NotifyKeyArgs> || std::is_same_v<Args, NotifyMotionArgs>) {
+        return args.readTime;
+    }
+    return std::nullopt;
+}
+
+// Notifies the listener without copying the args into a NotifyArgs first.
+void notifyListener(InputListenerInterface& l, const NotifyInputDevicesChangedArgs& args) {
+    l.notifyInputDevicesChanged(args);
+}
+void notifyListener(InputListenerInterface& l, const NotifyKeyArgs& args) {
+    l.notifyKey(args);
+}
+void notifyListener(InputListenerInterface& l, const NotifyMotionArgs& args) {
+    l.notifyMotion(args);
+}
+void notifyListener(InputListenerInterface& l, const NotifySwitchArgs& args) {
+    l.notifySwitch(args);
+}
+void notifyListener(InputListenerInterface& l, const NotifySensorArgs& args) {
+    l.notifySensor(args);
+}
+void notifyListener(InputListenerInterface& l, const NotifyVibratorStateArgs& args) {
+    l.notifyVibratorState(args);
+}
+void notifyListener(InputListenerInterface& l, const NotifyDeviceResetArgs& args) {
+    l.notifyDeviceReset(args);
+}
+void notifyListener(InputListenerInterface& l, const NotifyPointerCaptureChangedArgs& args) {
+    l.notifyPointerCaptureChanged(args);
+}
+
+void updateMax(std::atomic<nsecs_t>& max, nsecs_t value) {
+    nsecs_t current = max.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
 TracedInputListener::TracedInputListener(const char* name, InputListenerInterface& innerListener)
-      : mInnerListener(innerListener), mName(name) {}
+      : TracedInputListener(name, innerListener, /*passThroughTypes=*/0, innerListener) {}
+
+TracedInputListener::TracedInputListener(const char* name, InputListenerInterface& innerListener,
+                                         uint32_t passThroughTypes,
+                                         InputListenerInterface& nextListener)
+      : mInnerListener(innerListener),
+        mName(name),
+        mPassThroughTypes(passThroughTypes),
+        mNextListener(nextListener) {}
+
+template <typename Args>
+void TracedInputListener::notifyStage(ArgsType type, const char* fnName, const Args& args) {
+    if (mPassThroughTypes & type) {
+        mPassedThroughCount.fetch_add(1, std::memory_order_relaxed);
+        notifyListener(mNextListener, args);
+        return;
+    }
 
-void TracedInputListener::notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs& args) {
-    constexpr static auto& fnName = __func__;
     ATRACE_NAME_IF(ATRACE_ENABLED(),
                    StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (const std::optional<nsecs_t> readTime = getReadTime(args); readTime) {
+        recordAge(start - *readTime);
+    }
+
+    const nsecs_t previousStagesTime = sNextStagesTime;
+    sNextStagesTime = 0;
+    notifyListener(mInnerListener, args);
+    const nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    recordLatency(elapsed - sNextStagesTime);
+    sNextStagesTime = previousStagesTime + elapsed;
+}
+
+void TracedInputListener::recordLatency(nsecs_t latency) {
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mTotalLatency.fetch_add(latency, std::memory_order_relaxed);
+    updateMax(mMaxLatency, latency);
+    const size_t bucket = std::upper_bound(kLatencyBuckets.begin(), kLatencyBuckets.end(),
+                                           latency) -
+            kLatencyBuckets.begin();
+    mLatencyHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void TracedInputListener::recordAge(nsecs_t age) {
+    mAgeCount.fetch_add(1, std::memory_order_relaxed);
+    mTotalAge.fetch_add(age, std::memory_order_relaxed);
+    updateMax(mMaxAge, age);
+}
+
+void TracedInputListener::notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs& args) {
+    notifyStage(INPUT_DEVICES_CHANGED, __func__, args);
 }
 
 void TracedInputListener::notifyKey(const NotifyKeyArgs& args) {
-    constexpr static auto& fnName = __func__;
-    ATRACE_NAME_IF(ATRACE_ENABLED(),
-                   StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    notifyStage(KEY, __func__, args);
 }
 
 void TracedInputListener::notifyMotion(const NotifyMotionArgs& args) {
-    constexpr static auto& fnName = __func__;
-    ATRACE_NAME_IF(ATRACE_ENABLED(),
-                   StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    notifyStage(MOTION, __func__, args);
 }
 
 void TracedInputListener::notifySwitch(const NotifySwitchArgs& args) {
-    constexpr static auto& fnName = __func__;
-    ATRACE_NAME_IF(ATRACE_ENABLED(),
-                   StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    notifyStage(SWITCH, __func__, args);
 }
 
 void TracedInputListener::notifySensor(const NotifySensorArgs& args) {
-    constexpr static auto& fnName = __func__;
-    ATRACE_NAME_IF(ATRACE_ENABLED(),
-                   StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    notifyStage(SENSOR, __func__, args);
 }
 
 void TracedInputListener::notifyVibratorState(const NotifyVibratorStateArgs& args) {
-    constexpr static auto& fnName = __func__;
-    ATRACE_NAME_IF(ATRACE_ENABLED(),
-                   StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    notifyStage(VIBRATOR_STATE, __func__, args);
 }
 
 void TracedInputListener::notifyDeviceReset(const NotifyDeviceResetArgs& args) {
-    constexpr static auto& fnName = __func__;
-    ATRACE_NAME_IF(ATRACE_ENABLED(),
-                   StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    notifyStage(DEVICE_RESET, __func__, args);
 }
 
 void TracedInputListener::notifyPointerCaptureChanged(const NotifyPointerCaptureChangedArgs& args) {
-    constexpr static auto& fnName = __func__;
-    ATRACE_NAME_IF(ATRACE_ENABLED(),
-                   StringPrintf("%s::%s(id=0x%" PRIx32 ")", mName, fnName, args.id));
-    mInnerListener.notify(args);
+    notifyStage(POINTER_CAPTURE_CHANGED, __func__, args);
+}
+
+void TracedInputListener::dump(std::string& dump) const {
+    const auto toUs = [](nsecs_t ns) { return static_cast<double>(ns) / 1e3; };
+    const uint64_t count = mCount.load(std::memory_order_relaxed);
+    dump += StringPrintf(INDENT1 "%s: %" PRIu64 " args, %" PRIu64 " passed through\n", mName,
+                         count, mPassedThroughCount.load(std::memory_order_relaxed));
+    if (count == 0) return;
+
+    dump += StringPrintf(INDENT2 "Latency: mean=%.1fus, max=%.1fus\n",
+                         toUs(mTotalLatency.load(std::memory_order_relaxed)) / count,
+                         toUs(mMaxLatency.load(std::memory_order_relaxed)));
+    dump += INDENT2 "Latency histogram:";
+    for (size_t i = 0; i < kLatencyBuckets.size(); i++) {
+        dump += StringPrintf(" <%.0fus=%" PRIu64, toUs(kLatencyBuckets[i]),
+                             mLatencyHistogram[i].load(std::memory_order_relaxed));
+    }
+    dump += StringPrintf(" >=%.0fus=%" PRIu64 "\n", toUs(kLatencyBuckets.back()),
+                         mLatencyHistogram.back().load(std::memory_order_relaxed));
+
+    const uint64_t ageCount = mAgeCount.load(std::memory_order_relaxed);
+    if (ageCount > 0) {
+        dump += StringPrintf(INDENT2 "Time since read: mean=%.1fus, max=%.1fus\n",
+                             toUs(mTotalAge.load(std::memory_order_relaxed)) / ageCount,
+                             toUs(mMaxAge.load(std::memory_order_relaxed)));
+    }
 }
 
 } // namespace android
@@ -32,6 +32,8 @@
 #include <log/log.h>
 #include <private/android_filesystem_config.h>
 
+#include <algorithm>
+
 namespace input_flags = com::android::input::flags;
 
 namespace android {
@@ -134,11 +136,17 @@ InputManager::InputManager(const sp<InputReaderPolicyInterface>& readerPolicy,
     mTracingStages.emplace_back(
             std::make_unique<TracedInputListener>("InputDispatcher", *mDispatcher));
 
+    // The types of args that each stage hands to the next one as they are, bypassing it. These
+    // must be kept in sync with the notify methods of the stages.
+    using Type = TracedInputListener::ArgsType;
     if (ENABLE_INPUT_FILTER_RUST) {
-        mInputFilter = std::make_unique<InputFilter>(*mTracingStages.back(), *mInputFlingerRust,
-                                                     inputFilterPolicy);
-        mTracingStages.emplace_back(
-                std::make_unique<TracedInputListener>("InputFilter", *mInputFilter));
+        InputListenerInterface& next = *mTracingStages.back();
+        mInputFilter = std::make_unique<InputFilter>(next, *mInputFlingerRust, inputFilterPolicy);
+        mTracingStages.emplace_back(std::make_unique<TracedInputListener>(
+                "InputFilter", *mInputFilter,
+                Type::SWITCH | Type::SENSOR | Type::VIBRATOR_STATE | Type::DEVICE_RESET |
+                        Type::POINTER_CAPTURE_CHANGED,
+                next));
     }
 
     if (ENABLE_INPUT_DEVICE_USAGE_METRICS) {
@@ -147,18 +155,26 @@ InputManager::InputManager(const sp<InputReaderPolicyInterface>& readerPolicy,
                 std::make_unique<TracedInputListener>("MetricsCollector", *mCollector));
     }
 
-    mProcessor = std::make_unique<InputProcessor>(*mTracingStages.back());
-    mTracingStages.emplace_back(
-            std::make_unique<TracedInputListener>("InputProcessor", *mProcessor));
+    InputListenerInterface& afterProcessor = *mTracingStages.back();
+    mProcessor = std::make_unique<InputProcessor>(afterProcessor);
+    mTracingStages.emplace_back(std::make_unique<TracedInputListener>(
+            "InputProcessor", *mProcessor,
+            Type::INPUT_DEVICES_CHANGED | Type::KEY | Type::SWITCH | Type::SENSOR |
+                    Type::VIBRATOR_STATE | Type::POINTER_CAPTURE_CHANGED,
+            afterProcessor));
 
+    InputListenerInterface& afterChoreographer = *mTracingStages.back();
     mChoreographer =
-            std::make_unique<PointerChoreographer>(*mTracingStages.back(), choreographerPolicy);
-    mTracingStages.emplace_back(
-            std::make_unique<TracedInputListener>("PointerChoreographer", *mChoreographer));
+            std::make_unique<PointerChoreographer>(afterChoreographer, choreographerPolicy);
+    mTracingStages.emplace_back(std::make_unique<TracedInputListener>(
+            "PointerChoreographer", *mChoreographer,
+            Type::SWITCH | Type::SENSOR | Type::VIBRATOR_STATE, afterChoreographer));
 
-    mBlocker = std::make_unique<UnwantedInteractionBlocker>(*mTracingStages.back());
-    mTracingStages.emplace_back(
-            std::make_unique<TracedInputListener>("UnwantedInteractionBlocker", *mBlocker));
+    InputListenerInterface& afterBlocker = *mTracingStages.back();
+    mBlocker = std::make_unique<UnwantedInteractionBlocker>(afterBlocker);
+    mTracingStages.emplace_back(std::make_unique<TracedInputListener>(
+            "UnwantedInteractionBlocker", *mBlocker,
+            Type::KEY | Type::SWITCH | Type::SENSOR | Type::VIBRATOR_STATE, afterBlocker));
 
     mReader = createInputReader(readerPolicy, *mTracingStages.back());
 }
@@ -256,6 +272,10 @@ void InputManager::dump(std::string& dump) {
     }
     mDispatcher->dump(dump);
     dump += '\n';
+    dump += "Input pipeline stages, from the reader to the dispatcher:\n";
+    std::for_each(mTracingStages.rbegin(), mTracingStages.rend(),
+                  [&dump](const auto& stage) { stage->dump(dump); });
+    dump += '\n';
 }
 
 // Used by tests only.
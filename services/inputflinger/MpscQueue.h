@@ -0,0 +1,86 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace android {
+
+/**
+ * A lock-free FIFO queue that any number of threads push to, and that one thread at a time
+ * takes all of the objects out of.
+ *
+ * Pushing never blocks, so producers do not contend with whatever the consumer holds while it
+ * processes the objects.
+ */
+template <class T>
+class MpscQueue {
+public:
+    MpscQueue() = default;
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() { deleteNodes(mHead.exchange(nullptr, std::memory_order_acquire)); }
+
+    /**
+     * Add a new object to the queue.
+     * Return true if the queue was empty, so the consumer may need to be woken up.
+     */
+    bool push(T t) {
+        Node* node = new Node{std::move(t), mHead.load(std::memory_order_relaxed)};
+        while (!mHead.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        }
+        return node->next == nullptr;
+    }
+
+    /** Remove all of the objects, and return them from oldest to newest. */
+    std::vector<T> popAll() {
+        // Nodes are only ever removed all at once, so there is no ABA problem with pushes.
+        Node* node = mHead.exchange(nullptr, std::memory_order_acquire);
+        std::vector<T> objects;
+        for (Node* n = node; n != nullptr; n = n->next) {
+            objects.push_back(std::move(n->t));
+        }
+        deleteNodes(node);
+        std::reverse(objects.begin(), objects.end());
+        return objects;
+    }
+
+    bool empty() const { return mHead.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node {
+        T t;
+        Node* next;
+    };
+
+    static void deleteNodes(Node* node) {
+        while (node != nullptr) {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    // The newest object, which links to the older ones.
+    std::atomic<Node*> mHead{nullptr};
+};
+
+} // namespace android
@@ -64,6 +64,18 @@ bool isMouseOrTouchpad(uint32_t sources) {
              !isFromSource(sources, AINPUT_SOURCE_STYLUS));
 }
 
+// Whether the devices differ in anything that decides which pointer controllers are shown.
+bool hasSamePointerDevices(const std::vector<InputDeviceInfo>& infos,
+                           const std::vector<InputDeviceInfo>& otherInfos) {
+    return std::equal(infos.begin(), infos.end(), otherInfos.begin(), otherInfos.end(),
+                      [](const InputDeviceInfo& info, const InputDeviceInfo& other) {
+                          return info.getId() == other.getId() &&
+                                  info.isEnabled() == other.isEnabled() &&
+                                  info.getSources() == other.getSources() &&
+                                  info.getAssociatedDisplayId() == other.getAssociatedDisplayId();
+                      });
+}
+
 inline void notifyPointerDisplayChange(
         std::optional<std::tuple<ui::LogicalDisplayId, FloatPoint>> change,
         PointerChoreographerPolicyInterface& policy) {
@@ -157,8 +169,12 @@ void PointerChoreographer::notifyInputDevicesChanged(const NotifyInputDevicesCha
     { // acquire lock
         std::scoped_lock _l(mLock);
 
+        const bool pointerDevicesChanged =
+                !hasSamePointerDevices(mInputDeviceInfos, args.inputDeviceInfos);
         mInputDeviceInfos = args.inputDeviceInfos;
-        pointerDisplayChange = updatePointerControllersLocked();
+        if (pointerDevicesChanged || !mPointerControllersReconciled) {
+            pointerDisplayChange = updatePointerControllersLocked();
+        }
     } // release lock
 
     notifyPointerDisplayChange(pointerDisplayChange, mPolicy);
@@ -226,8 +242,7 @@ NotifyMotionArgs PointerChoreographer::processMouseEventLocked(const NotifyMotio
                    << args.dump();
     }
 
-    mMouseDevices.emplace(args.deviceId);
-    auto [displayId, pc] = ensureMouseControllerLocked(args.displayId);
+    auto [displayId, pc] = ensureMouseControllerForDeviceLocked(args.deviceId, args.displayId);
     NotifyMotionArgs newArgs(args);
     newArgs.displayId = displayId;
 
@@ -258,8 +273,7 @@ NotifyMotionArgs PointerChoreographer::processMouseEventLocked(const NotifyMotio
 }
 
 NotifyMotionArgs PointerChoreographer::processTouchpadEventLocked(const NotifyMotionArgs& args) {
-    mMouseDevices.emplace(args.deviceId);
-    auto [displayId, pc] = ensureMouseControllerLocked(args.displayId);
+    auto [displayId, pc] = ensureMouseControllerForDeviceLocked(args.deviceId, args.displayId);
 
     NotifyMotionArgs newArgs(args);
     newArgs.displayId = displayId;
@@ -307,15 +321,23 @@ void PointerChoreographer::processDrawingTabletEventLocked(const android::Notify
     }
 
     // Use a mouse pointer controller for drawing tablets, or create one if it doesn't exist.
-    auto [it, controllerAdded] =
-            mDrawingTabletPointersByDevice.try_emplace(args.deviceId,
-                                                       getMouseControllerConstructor(
-                                                               args.displayId));
-    if (controllerAdded) {
-        onControllerAddedOrRemovedLocked();
+    PointerControllerInterface* controller =
+            findCachedControllerLocked(args.deviceId, CachedControllerKind::DRAWING_TABLET,
+                                       ui::LogicalDisplayId::INVALID);
+    if (controller == nullptr) {
+        auto [it, controllerAdded] =
+                mDrawingTabletPointersByDevice.try_emplace(args.deviceId,
+                                                           getMouseControllerConstructor(
+                                                                   args.displayId));
+        if (controllerAdded) {
+            onControllerAddedOrRemovedLocked();
+        }
+        controller = it->second.get();
+        cacheControllerLocked(args.deviceId, CachedControllerKind::DRAWING_TABLET,
+                              ui::LogicalDisplayId::INVALID, *controller);
     }
 
-    PointerControllerInterface& pc = *it->second;
+    PointerControllerInterface& pc = *controller;
 
     const float x = args.pointerCoords[0].getAxisValue(AMOTION_EVENT_AXIS_X);
     const float y = args.pointerCoords[0].getAxisValue(AMOTION_EVENT_AXIS_Y);
@@ -351,13 +373,21 @@ void PointerChoreographer::processTouchscreenAndStylusEventLocked(const NotifyMo
     }
 
     // Get the touch pointer controller for the device, or create one if it doesn't exist.
-    auto [it, controllerAdded] =
-            mTouchPointersByDevice.try_emplace(args.deviceId, mTouchControllerConstructor);
-    if (controllerAdded) {
-        onControllerAddedOrRemovedLocked();
+    PointerControllerInterface* controller =
+            findCachedControllerLocked(args.deviceId, CachedControllerKind::TOUCH,
+                                       ui::LogicalDisplayId::INVALID);
+    if (controller == nullptr) {
+        auto [it, controllerAdded] =
+                mTouchPointersByDevice.try_emplace(args.deviceId, mTouchControllerConstructor);
+        if (controllerAdded) {
+            onControllerAddedOrRemovedLocked();
+        }
+        controller = it->second.get();
+        cacheControllerLocked(args.deviceId, CachedControllerKind::TOUCH,
+                              ui::LogicalDisplayId::INVALID, *controller);
     }
 
-    PointerControllerInterface& pc = *it->second;
+    PointerControllerInterface& pc = *controller;
 
     const PointerCoords* coords = args.pointerCoords.data();
     const int32_t maskedAction = MotionEvent::getActionMasked(args.action);
@@ -391,14 +421,23 @@ void PointerChoreographer::processStylusHoverEventLocked(const NotifyMotionArgs&
     }
 
     // Get the stylus pointer controller for the device, or create one if it doesn't exist.
-    auto [it, controllerAdded] =
-            mStylusPointersByDevice.try_emplace(args.deviceId,
-                                                getStylusControllerConstructor(args.displayId));
-    if (controllerAdded) {
-        onControllerAddedOrRemovedLocked();
+    PointerControllerInterface* controller =
+            findCachedControllerLocked(args.deviceId, CachedControllerKind::STYLUS,
+                                       ui::LogicalDisplayId::INVALID);
+    if (controller == nullptr) {
+        auto [it, controllerAdded] =
+                mStylusPointersByDevice.try_emplace(args.deviceId,
+                                                    getStylusControllerConstructor(
+                                                            args.displayId));
+        if (controllerAdded) {
+            onControllerAddedOrRemovedLocked();
+        }
+        controller = it->second.get();
+        cacheControllerLocked(args.deviceId, CachedControllerKind::STYLUS,
+                              ui::LogicalDisplayId::INVALID, *controller);
     }
 
-    PointerControllerInterface& pc = *it->second;
+    PointerControllerInterface& pc = *controller;
 
     const float x = args.pointerCoords[0].getAxisValue(AMOTION_EVENT_AXIS_X);
     const float y = args.pointerCoords[0].getAxisValue(AMOTION_EVENT_AXIS_Y);
@@ -441,6 +480,8 @@ void PointerChoreographer::processDeviceReset(const NotifyDeviceResetArgs& args)
 }
 
 void PointerChoreographer::onControllerAddedOrRemovedLocked() {
+    mCachedControllers.clear();
+    mPointerControllersReconciled = false;
     if (!com::android::input::flags::hide_pointer_indicators_for_secure_windows()) {
         return;
     }
@@ -569,6 +610,40 @@ PointerChoreographer::ensureMouseControllerLocked(ui::LogicalDisplayId associate
     return {displayId, *it->second};
 }
 
+std::pair<ui::LogicalDisplayId, PointerControllerInterface&>
+PointerChoreographer::ensureMouseControllerForDeviceLocked(
+        DeviceId deviceId, ui::LogicalDisplayId associatedDisplayId) {
+    const ui::LogicalDisplayId displayId = getTargetMouseDisplayLocked(associatedDisplayId);
+    if (PointerControllerInterface* controller =
+                findCachedControllerLocked(deviceId, CachedControllerKind::MOUSE, displayId);
+        controller != nullptr) {
+        return {displayId, *controller};
+    }
+
+    if (mMouseDevices.emplace(deviceId).second) {
+        mPointerControllersReconciled = false;
+    }
+    auto [_, pc] = ensureMouseControllerLocked(associatedDisplayId);
+    cacheControllerLocked(deviceId, CachedControllerKind::MOUSE, displayId, pc);
+    return {displayId, pc};
+}
+
+PointerControllerInterface* PointerChoreographer::findCachedControllerLocked(
+        DeviceId deviceId, CachedControllerKind kind, ui::LogicalDisplayId displayId) {
+    for (const CachedController& cached : mCachedControllers) {
+        if (cached.deviceId == deviceId && cached.kind == kind && cached.displayId == displayId) {
+            return cached.controller;
+        }
+    }
+    return nullptr;
+}
+
+void PointerChoreographer::cacheControllerLocked(DeviceId deviceId, CachedControllerKind kind,
+                                                 ui::LogicalDisplayId displayId,
+                                                 PointerControllerInterface& controller) {
+    mCachedControllers.push_back({deviceId, kind, displayId, &controller});
+}
+
 InputDeviceInfo* PointerChoreographer::findInputDeviceLocked(DeviceId deviceId) {
     auto it = std::find_if(mInputDeviceInfos.begin(), mInputDeviceInfos.end(),
                            [deviceId](const auto& info) { return info.getId() == deviceId; });
@@ -628,26 +703,37 @@ PointerChoreographer::PointerDisplayChange PointerChoreographer::updatePointerCo
         }
     }
 
-    // Remove PointerControllers no longer needed.
-    std::erase_if(mMousePointersByDisplay, [&mouseDisplaysToKeep](const auto& pair) {
-        return mouseDisplaysToKeep.find(pair.first) == mouseDisplaysToKeep.end();
-    });
-    std::erase_if(mTouchPointersByDevice, [&touchDevicesToKeep](const auto& pair) {
+    // Remove PointerControllers no longer needed. Only the controllers that are removed need the
+    // listener and the other controllers to be updated, because the added ones already did that.
+    size_t removedCount = 0;
+    removedCount +=
+            std::erase_if(mMousePointersByDisplay, [&mouseDisplaysToKeep](const auto& pair) {
+                return mouseDisplaysToKeep.find(pair.first) == mouseDisplaysToKeep.end();
+            });
+    removedCount += std::erase_if(mTouchPointersByDevice, [&touchDevicesToKeep](const auto& pair) {
         return touchDevicesToKeep.find(pair.first) == touchDevicesToKeep.end();
     });
-    std::erase_if(mStylusPointersByDevice, [&stylusDevicesToKeep](const auto& pair) {
-        return stylusDevicesToKeep.find(pair.first) == stylusDevicesToKeep.end();
-    });
-    std::erase_if(mDrawingTabletPointersByDevice, [&drawingTabletDevicesToKeep](const auto& pair) {
-        return drawingTabletDevicesToKeep.find(pair.first) == drawingTabletDevicesToKeep.end();
-    });
+    removedCount +=
+            std::erase_if(mStylusPointersByDevice, [&stylusDevicesToKeep](const auto& pair) {
+                return stylusDevicesToKeep.find(pair.first) == stylusDevicesToKeep.end();
+            });
+    removedCount += std::erase_if(mDrawingTabletPointersByDevice,
+                                  [&drawingTabletDevicesToKeep](const auto& pair) {
+                                      return drawingTabletDevicesToKeep.find(pair.first) ==
+                                              drawingTabletDevicesToKeep.end();
+                                  });
     std::erase_if(mMouseDevices, [&](DeviceId id) REQUIRES(mLock) {
         return std::find_if(mInputDeviceInfos.begin(), mInputDeviceInfos.end(),
                             [id](const auto& info) { return info.getId() == id; }) ==
                 mInputDeviceInfos.end();
     });
 
-    onControllerAddedOrRemovedLocked();
+    if (removedCount > 0) {
+        onControllerAddedOrRemovedLocked();
+    }
+    // The devices, or the display of their mouse pointer, may have changed.
+    mCachedControllers.clear();
+    mPointerControllersReconciled = true;
 
     // Check if we need to notify the policy if there's a change on the pointer display ID.
     return calculatePointerDisplayChangeToNotify();
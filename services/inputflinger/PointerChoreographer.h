@@ -126,7 +126,21 @@ private:
             REQUIRES(mLock);
     std::pair<ui::LogicalDisplayId /*displayId*/, PointerControllerInterface&>
     ensureMouseControllerLocked(ui::LogicalDisplayId associatedDisplayId) REQUIRES(mLock);
+    std::pair<ui::LogicalDisplayId /*displayId*/, PointerControllerInterface&>
+    ensureMouseControllerForDeviceLocked(DeviceId deviceId,
+                                         ui::LogicalDisplayId associatedDisplayId)
+            REQUIRES(mLock);
     InputDeviceInfo* findInputDeviceLocked(DeviceId deviceId) REQUIRES(mLock);
+
+    // The kinds of pointer controllers that a device can be shown with.
+    enum class CachedControllerKind { MOUSE, TOUCH, STYLUS, DRAWING_TABLET };
+    PointerControllerInterface* findCachedControllerLocked(DeviceId deviceId,
+                                                           CachedControllerKind kind,
+                                                           ui::LogicalDisplayId displayId)
+            REQUIRES(mLock);
+    void cacheControllerLocked(DeviceId deviceId, CachedControllerKind kind,
+                               ui::LogicalDisplayId displayId,
+                               PointerControllerInterface& controller) REQUIRES(mLock);
     bool canUnfadeOnDisplay(ui::LogicalDisplayId displayId) REQUIRES(mLock);
 
     void fadeMouseCursorOnKeyPress(const NotifyKeyArgs& args);
@@ -194,6 +208,25 @@ private:
     ui::LogicalDisplayId mNotifiedPointerDisplayId GUARDED_BY(mLock);
     std::vector<InputDeviceInfo> mInputDeviceInfos GUARDED_BY(mLock);
     std::set<DeviceId> mMouseDevices GUARDED_BY(mLock);
+
+    /*
+     * The controllers that were last used for the motion events of each device, so that
+     * notifyMotion does not look them up in the maps above for every event. It is cleared whenever
+     * a controller is added or removed, or the devices change, and is filled again as the events
+     * arrive. Clearing it keeps its capacity, so that it doesn't allocate once it has grown.
+     */
+    struct CachedController {
+        DeviceId deviceId;
+        CachedControllerKind kind;
+        // The display of the mouse controller, or INVALID for the controllers of other kinds.
+        ui::LogicalDisplayId displayId;
+        PointerControllerInterface* controller;
+    };
+    std::vector<CachedController> mCachedControllers GUARDED_BY(mLock);
+    // Whether the controllers are the ones that updatePointerControllersLocked would keep for
+    // mInputDeviceInfos, so that a devices change that doesn't affect the pointers can skip it.
+    bool mPointerControllersReconciled GUARDED_BY(mLock) = false;
+
     std::vector<DisplayViewport> mViewports GUARDED_BY(mLock);
     bool mShowTouchesEnabled GUARDED_BY(mLock);
     bool mStylusPointerIconEnabled GUARDED_BY(mLock);
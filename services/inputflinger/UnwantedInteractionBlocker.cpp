@@ -25,6 +25,8 @@
 #include <linux/input-event-codes.h>
 #include <linux/input.h>
 #include <server_configurable_flags/get_flags.h>
+#include <algorithm>
+#include <variant>
 
 #include "ui/events/ozone/evdev/touch_filter/neural_stylus_palm_detection_filter.h"
 #include "ui/events/ozone/evdev/touch_filter/palm_model/onedevice_train_palm_detection_filter_model.h"
@@ -43,6 +45,16 @@ using PalmFilterImplementation = ::ui::NeuralStylusPalmDetectionFilter;
 
 namespace android {
 
+namespace {
+
+// Helper to std::visit with lambdas.
+template <typename... V>
+struct Visitor : V... {
+    using V::operator()...;
+};
+
+} // namespace
+
 /**
  * Log detailed debug messages about each inbound motion event notification to the blocker.
  * Enable this via "adb shell setprop log.tag.UnwantedInteractionBlockerInboundMotion DEBUG"
@@ -84,6 +96,12 @@ static const char* INPUT_NATIVE_BOOT = "input_native_boot";
  * 'true' (not case sensitive) or '1'. To disable, specify any other value.
  */
 static const char* PALM_REJECTION_ENABLED = "palm_rejection_enabled";
+/**
+ * Feature flag name. This flag determines whether palm rejection runs on a separate thread, behind
+ * the events that it rejects palms in. To enable, specify '1'. To disable, specify any other
+ * value.
+ */
+static const char* PALM_REJECTION_PIPELINED = "palm_rejection_pipelined";
 
 static std::string toLower(std::string s) {
     std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
@@ -98,18 +116,40 @@ static ::base::TimeTicks toChromeTimestamp(nsecs_t eventTime) {
     return ::base::TimeTicks::UnixEpoch() + ::base::TimeDelta::FromNanosecondsD(eventTime);
 }
 
+static bool isInputNativeBootFlagEnabled(const char* flagName) {
+    std::string value =
+            toLower(server_configurable_flags::GetServerConfigurableFlag(INPUT_NATIVE_BOOT,
+                                                                         flagName, "0"));
+    return value == "1";
+}
+
 /**
  * Return true if palm rejection is enabled via the server configurable flags. Return false
  * otherwise.
  */
 static bool isPalmRejectionEnabled() {
-    std::string value = toLower(
-            server_configurable_flags::GetServerConfigurableFlag(INPUT_NATIVE_BOOT,
-                                                                 PALM_REJECTION_ENABLED, "0"));
-    if (value == "1") {
-        return true;
-    }
-    return false;
+    return isInputNativeBootFlagEnabled(PALM_REJECTION_ENABLED);
+}
+
+/**
+ * Return true if palm rejection should run behind the events via the server configurable flags.
+ * Return false otherwise.
+ */
+static bool isPalmRejectionPipelined() {
+    return isInputNativeBootFlagEnabled(PALM_REJECTION_PIPELINED);
+}
+
+/**
+ * Return true for the events that palm rejection does not look at: hover events, button events,
+ * and scroll.
+ */
+static bool isIgnoredByPalmRejection(int32_t action) {
+    return action == AMOTION_EVENT_ACTION_HOVER_ENTER ||
+            action == AMOTION_EVENT_ACTION_HOVER_MOVE ||
+            action == AMOTION_EVENT_ACTION_HOVER_EXIT ||
+            action == AMOTION_EVENT_ACTION_BUTTON_PRESS ||
+            action == AMOTION_EVENT_ACTION_BUTTON_RELEASE ||
+            action == AMOTION_EVENT_ACTION_SCROLL;
 }
 
 static int getLinuxToolCode(ToolType toolType) {
@@ -287,6 +327,10 @@ std::vector<NotifyMotionArgs> cancelSuppressedPointers(
         const NotifyMotionArgs& args, const std::set<int32_t>& oldSuppressedPointerIds,
         const std::set<int32_t>& newSuppressedPointerIds) {
     LOG_ALWAYS_FATAL_IF(args.getPointerCount() == 0, "0 pointers in %s", args.dump().c_str());
+    if (oldSuppressedPointerIds.empty() && newSuppressedPointerIds.empty()) {
+        // Nothing is suppressed, which is the case for most of the events.
+        return {args};
+    }
 
     // First, let's remove the old suppressed pointers. They've already been canceled previously.
     NotifyMotionArgs oldArgs = removePointerIds(args, oldSuppressedPointerIds);
@@ -335,12 +379,44 @@ std::vector<NotifyMotionArgs> cancelSuppressedPointers(
     return out;
 }
 
+/**
+ * Create the PalmRejectors of the new devices, and delete the ones of the removed devices. The
+ * PalmRejectors of the devices that didn't change are kept, to prevent event stream disruption.
+ */
+static void updatePalmRejectors(std::map<int32_t /*deviceId*/, PalmRejector>& palmRejectors,
+                                const PalmFilterDevices& palmDevices) {
+    for (const auto& [deviceId, info] : palmDevices) {
+        auto [it, emplaced] = palmRejectors.try_emplace(deviceId, info);
+        if (!emplaced && info != it->second.getPalmFilterDeviceInfo()) {
+            // Re-create the PalmRejector because the device info has changed.
+            palmRejectors.erase(it);
+            palmRejectors.emplace(deviceId, info);
+        }
+    }
+    // Delete all devices that we don't need to keep
+    std::erase_if(palmRejectors, [&palmDevices](const auto& item) {
+        auto const& [deviceId, _] = item;
+        return palmDevices.find(deviceId) == palmDevices.end();
+    });
+}
+
 UnwantedInteractionBlocker::UnwantedInteractionBlocker(InputListenerInterface& listener)
-      : UnwantedInteractionBlocker(listener, isPalmRejectionEnabled()){};
+      : UnwantedInteractionBlocker(listener, isPalmRejectionEnabled(),
+                                   isPalmRejectionPipelined()){};
 
 UnwantedInteractionBlocker::UnwantedInteractionBlocker(InputListenerInterface& listener,
                                                        bool enablePalmRejection)
-      : mQueuedListener(listener), mEnablePalmRejection(enablePalmRejection) {}
+      : UnwantedInteractionBlocker(listener, enablePalmRejection,
+                                   /*pipelinePalmRejection=*/false){};
+
+UnwantedInteractionBlocker::UnwantedInteractionBlocker(InputListenerInterface& listener,
+                                                       bool enablePalmRejection,
+                                                       bool pipelinePalmRejection)
+      : mQueuedListener(listener),
+        mEnablePalmRejection(enablePalmRejection),
+        mPalmRejectionThread(enablePalmRejection && pipelinePalmRejection
+                                     ? std::make_unique<PalmRejectionThread>()
+                                     : nullptr) {}
 
 void UnwantedInteractionBlocker::notifyKey(const NotifyKeyArgs& args) {
     mQueuedListener.notifyKey(args);
@@ -372,6 +448,10 @@ void UnwantedInteractionBlocker::enqueueOutboundMotionLocked(const NotifyMotionA
 }
 
 void UnwantedInteractionBlocker::notifyMotionLocked(const NotifyMotionArgs& args) {
+    if (mPalmRejectionThread != nullptr) {
+        notifyMotionPipelinedLocked(args);
+        return;
+    }
     auto it = mPalmRejectors.find(args.deviceId);
     const bool sendToPalmRejector = it != mPalmRejectors.end() && isFromTouchscreen(args.source);
     if (!sendToPalmRejector) {
@@ -385,6 +465,25 @@ void UnwantedInteractionBlocker::notifyMotionLocked(const NotifyMotionArgs& args
     }
 }
 
+void UnwantedInteractionBlocker::notifyMotionPipelinedLocked(const NotifyMotionArgs& args) {
+    auto it = mLatePalmCancelers.find(args.deviceId);
+    if (it == mLatePalmCancelers.end() || !isFromTouchscreen(args.source)) {
+        enqueueOutboundMotionLocked(args);
+        return;
+    }
+
+    // Apply the decision that the thread made so far, and then let it look at this event. It needs
+    // all of the events of the gesture, including the ones that have pointers removed here.
+    const uint64_t eventSeq = mNextEventSeq++;
+    std::vector<NotifyMotionArgs> processedArgs =
+            it->second.processMotion(args, eventSeq,
+                                     mPalmRejectionThread->getDecision(args.deviceId));
+    for (const NotifyMotionArgs& loopArgs : processedArgs) {
+        enqueueOutboundMotionLocked(loopArgs);
+    }
+    mPalmRejectionThread->notifyMotion(args, eventSeq);
+}
+
 void UnwantedInteractionBlocker::notifySwitch(const NotifySwitchArgs& args) {
     mQueuedListener.notifySwitch(args);
     mQueuedListener.flush();
@@ -409,6 +508,11 @@ void UnwantedInteractionBlocker::notifyDeviceReset(const NotifyDeviceResetArgs&
             mPalmRejectors.erase(it);
             mPalmRejectors.emplace(args.deviceId, info);
         }
+        if (auto cancelerIt = mLatePalmCancelers.find(args.deviceId);
+            cancelerIt != mLatePalmCancelers.end()) {
+            cancelerIt->second = LatePalmCanceler();
+            mPalmRejectionThread->notifyDeviceReset(args.deviceId);
+        }
         mQueuedListener.notifyDeviceReset(args);
         mPreferStylusOverTouchBlocker.notifyDeviceReset(args);
     } // release lock
@@ -437,28 +541,28 @@ void UnwantedInteractionBlocker::onInputDevicesChanged(
         return;
     }
 
-    // Let's see which of the existing devices didn't change, so that we can keep them
-    // and prevent event stream disruption
-    std::set<int32_t /*deviceId*/> devicesToKeep;
+    PalmFilterDevices palmDevices;
     for (const InputDeviceInfo& device : inputDevices) {
         std::optional<AndroidPalmFilterDeviceInfo> info = createPalmFilterDeviceInfo(device);
-        if (!info) {
-            continue;
+        if (info) {
+            palmDevices.emplace(device.getId(), *info);
         }
+    }
 
-        auto [it, emplaced] = mPalmRejectors.try_emplace(device.getId(), *info);
-        if (!emplaced && *info != it->second.getPalmFilterDeviceInfo()) {
-            // Re-create the PalmRejector because the device info has changed.
-            mPalmRejectors.erase(it);
-            mPalmRejectors.emplace(device.getId(), *info);
+    if (mPalmRejectionThread != nullptr) {
+        // The PalmRejectors are updated on the thread, in order with the events it has yet to
+        // process. The cancelers don't depend on the device info, so only the new and the removed
+        // devices change them.
+        std::erase_if(mLatePalmCancelers, [&palmDevices](const auto& item) {
+            return palmDevices.find(item.first) == palmDevices.end();
+        });
+        for (const auto& [deviceId, _] : palmDevices) {
+            mLatePalmCancelers.try_emplace(deviceId);
         }
-        devicesToKeep.insert(device.getId());
+        mPalmRejectionThread->notifyInputDevicesChanged(std::move(palmDevices));
+    } else {
+        updatePalmRejectors(mPalmRejectors, palmDevices);
     }
-    // Delete all devices that we don't need to keep
-    std::erase_if(mPalmRejectors, [&devicesToKeep](const auto& item) {
-        auto const& [deviceId, _] = item;
-        return devicesToKeep.find(deviceId) == devicesToKeep.end();
-    });
     mPreferStylusOverTouchBlocker.notifyInputDevicesChanged(inputDevices);
 }
 
@@ -471,6 +575,17 @@ void UnwantedInteractionBlocker::dump(std::string& dump) {
                          std::to_string(mEnablePalmRejection).c_str());
     dump += StringPrintf("  isPalmRejectionEnabled (flag value): %s\n",
                          std::to_string(isPalmRejectionEnabled()).c_str());
+    if (mPalmRejectionThread != nullptr) {
+        dump += "  mPalmRejectionThread:\n";
+        dump += addLinePrefix(mPalmRejectionThread->dump(), "    ");
+        dump += mLatePalmCancelers.empty() ? "  mLatePalmCancelers: None\n"
+                                           : "  mLatePalmCancelers:\n";
+        for (const auto& [deviceId, canceler] : mLatePalmCancelers) {
+            dump += StringPrintf("    deviceId = %" PRId32 ":\n", deviceId);
+            dump += addLinePrefix(canceler.dump(), "      ");
+        }
+        return;
+    }
     dump += mPalmRejectors.empty() ? "  mPalmRejectors: None\n" : "  mPalmRejectors:\n";
     for (const auto& [deviceId, palmRejector] : mPalmRejectors) {
         dump += StringPrintf("    deviceId = %" PRId32 ":\n", deviceId);
@@ -582,6 +697,7 @@ std::vector<::ui::InProgressTouchEvdev> getTouches(const NotifyMotionArgs& args,
                                                    const SlotState& oldSlotState,
                                                    const SlotState& newSlotState) {
     std::vector<::ui::InProgressTouchEvdev> touches;
+    touches.reserve(args.getPointerCount());
 
     for (size_t i = 0; i < args.getPointerCount(); i++) {
         const int32_t pointerId = args.pointerProperties[i].id;
@@ -649,9 +765,14 @@ std::set<int32_t> PalmRejector::detectPalmPointers(const NotifyMotionArgs& args)
     std::bitset<::ui::kNumTouchEvdevSlots> slotsToSuppress;
 
     // Store the slot state before we call getTouches and update it. This way, we can find
-    // the slots that have been removed due to the incoming event.
-    SlotState oldSlotState = mSlotState;
-    mSlotState.update(args);
+    // the slots that have been removed due to the incoming event. A MOVE doesn't change the slots,
+    // so there is no need to copy them for most of the events.
+    std::optional<SlotState> slotStateBeforeEvent;
+    if (MotionEvent::getActionMasked(args.action) != AMOTION_EVENT_ACTION_MOVE) {
+        slotStateBeforeEvent = mSlotState;
+        mSlotState.update(args);
+    }
+    const SlotState& oldSlotState = slotStateBeforeEvent ? *slotStateBeforeEvent : mSlotState;
 
     std::vector<::ui::InProgressTouchEvdev> touches =
             getTouches(args, mDeviceInfo, oldSlotState, mSlotState);
@@ -686,20 +807,7 @@ std::set<int32_t> PalmRejector::detectPalmPointers(const NotifyMotionArgs& args)
     return newSuppressedIds;
 }
 
-std::vector<NotifyMotionArgs> PalmRejector::processMotion(const NotifyMotionArgs& args) {
-    if (mPalmDetectionFilter == nullptr) {
-        return {args};
-    }
-    const bool skipThisEvent = args.action == AMOTION_EVENT_ACTION_HOVER_ENTER ||
-            args.action == AMOTION_EVENT_ACTION_HOVER_MOVE ||
-            args.action == AMOTION_EVENT_ACTION_HOVER_EXIT ||
-            args.action == AMOTION_EVENT_ACTION_BUTTON_PRESS ||
-            args.action == AMOTION_EVENT_ACTION_BUTTON_RELEASE ||
-            args.action == AMOTION_EVENT_ACTION_SCROLL;
-    if (skipThisEvent) {
-        // Lets not process hover events, button events, or scroll for now.
-        return {args};
-    }
+std::set<int32_t> PalmRejector::updateSuppressedPointers(const NotifyMotionArgs& args) {
     if (args.action == AMOTION_EVENT_ACTION_DOWN) {
         mSuppressedPointerIds.clear();
     }
@@ -707,8 +815,16 @@ std::vector<NotifyMotionArgs> PalmRejector::processMotion(const NotifyMotionArgs
     std::set<int32_t> oldSuppressedIds;
     std::swap(oldSuppressedIds, mSuppressedPointerIds);
 
-    std::optional<NotifyMotionArgs> touchOnlyArgs = removeStylusPointerIds(args);
-    if (touchOnlyArgs) {
+    const bool hasStylusPointer =
+            std::any_of(args.pointerProperties.begin(), args.pointerProperties.end(),
+                        [](const PointerProperties& properties) {
+                            return isStylusToolType(properties.toolType);
+                        });
+    if (!hasStylusPointer) {
+        // There's nothing to remove, so don't make a copy of the args.
+        mSuppressedPointerIds = detectPalmPointers(args);
+    } else if (std::optional<NotifyMotionArgs> touchOnlyArgs = removeStylusPointerIds(args);
+               touchOnlyArgs) {
         mSuppressedPointerIds = detectPalmPointers(*touchOnlyArgs);
     } else {
         // This is a stylus-only event.
@@ -716,12 +832,6 @@ std::vector<NotifyMotionArgs> PalmRejector::processMotion(const NotifyMotionArgs
         mSuppressedPointerIds = oldSuppressedIds;
     }
 
-    std::vector<NotifyMotionArgs> argsWithoutUnwantedPointers =
-            cancelSuppressedPointers(args, oldSuppressedIds, mSuppressedPointerIds);
-    for (const NotifyMotionArgs& checkArgs : argsWithoutUnwantedPointers) {
-        LOG_ALWAYS_FATAL_IF(checkArgs.action == ACTION_UNKNOWN, "%s", checkArgs.dump().c_str());
-    }
-
     // Only log if new pointers are getting rejected. That means mSuppressedPointerIds is not a
     // subset of oldSuppressedIds.
     if (!std::includes(oldSuppressedIds.begin(), oldSuppressedIds.end(),
@@ -730,10 +840,35 @@ std::vector<NotifyMotionArgs> PalmRejector::processMotion(const NotifyMotionArgs
               dumpSet(mSuppressedPointerIds).c_str(), ns2ms(args.eventTime - args.downTime),
               args.dump().c_str());
     }
+    return oldSuppressedIds;
+}
+
+std::vector<NotifyMotionArgs> PalmRejector::processMotion(const NotifyMotionArgs& args) {
+    if (mPalmDetectionFilter == nullptr) {
+        return {args};
+    }
+    if (isIgnoredByPalmRejection(args.action)) {
+        // Lets not process hover events, button events, or scroll for now.
+        return {args};
+    }
 
+    const std::set<int32_t> oldSuppressedIds = updateSuppressedPointers(args);
+
+    std::vector<NotifyMotionArgs> argsWithoutUnwantedPointers =
+            cancelSuppressedPointers(args, oldSuppressedIds, mSuppressedPointerIds);
+    for (const NotifyMotionArgs& checkArgs : argsWithoutUnwantedPointers) {
+        LOG_ALWAYS_FATAL_IF(checkArgs.action == ACTION_UNKNOWN, "%s", checkArgs.dump().c_str());
+    }
     return argsWithoutUnwantedPointers;
 }
 
+const std::set<int32_t>& PalmRejector::detectSuppressedPointers(const NotifyMotionArgs& args) {
+    if (mPalmDetectionFilter != nullptr && !isIgnoredByPalmRejection(args.action)) {
+        updateSuppressedPointers(args);
+    }
+    return mSuppressedPointerIds;
+}
+
 const AndroidPalmFilterDeviceInfo& PalmRejector::getPalmFilterDeviceInfo() const {
     return mDeviceInfo;
 }
@@ -759,4 +894,161 @@ std::string PalmRejector::dump() const {
     return out;
 }
 
+PalmRejectionThread::PalmRejectionThread()
+      : mThread(
+                "PalmRejection", [this]() { threadLoop(); },
+                [this]() {
+                    // If the queue is full, the thread is not waiting, and will see that it
+                    // should exit once it returns from the next event.
+                    mQueue.try_push(std::nullopt);
+                }) {}
+
+void PalmRejectionThread::notifyInputDevicesChanged(PalmFilterDevices palmDevices) {
+    mQueue.emplace(std::move(palmDevices));
+}
+
+void PalmRejectionThread::notifyDeviceReset(int32_t deviceId) {
+    mQueue.emplace(ResetWork{deviceId});
+}
+
+void PalmRejectionThread::notifyMotion(const NotifyMotionArgs& args, uint64_t eventSeq) {
+    mQueue.emplace(MotionWork{args, eventSeq});
+}
+
+std::optional<PalmDecision> PalmRejectionThread::getDecision(int32_t deviceId) {
+    std::scoped_lock lock(mLock);
+    auto it = mDecisions.find(deviceId);
+    if (it == mDecisions.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void PalmRejectionThread::threadLoop() {
+    std::optional<Work> work = mQueue.pop();
+    if (!work) {
+        return;
+    }
+    std::visit(Visitor{
+                       [this](const MotionWork& motion) { processMotion(motion); },
+                       [this](const ResetWork& reset) {
+                           auto it = mPalmRejectors.find(reset.deviceId);
+                           if (it != mPalmRejectors.end()) {
+                               AndroidPalmFilterDeviceInfo info =
+                                       it->second.getPalmFilterDeviceInfo();
+                               // Re-create the object instead of resetting it
+                               mPalmRejectors.erase(it);
+                               mPalmRejectors.emplace(reset.deviceId, info);
+                           }
+                           std::scoped_lock lock(mLock);
+                           mDecisions.erase(reset.deviceId);
+                       },
+                       [this](const PalmFilterDevices& palmDevices) {
+                           updatePalmRejectors(mPalmRejectors, palmDevices);
+                           std::scoped_lock lock(mLock);
+                           std::erase_if(mDecisions, [&palmDevices](const auto& item) {
+                               return palmDevices.find(item.first) == palmDevices.end();
+                           });
+                       },
+               },
+               *work);
+}
+
+void PalmRejectionThread::processMotion(const MotionWork& work) {
+    const NotifyMotionArgs& args = work.args;
+    auto it = mPalmRejectors.find(args.deviceId);
+    if (it == mPalmRejectors.end()) {
+        return;
+    }
+    const std::set<int32_t>& suppressedPointerIds = it->second.detectSuppressedPointers(args);
+    if (suppressedPointerIds.empty()) {
+        // Nothing to tell about this gesture, and the decisions about the previous gestures don't
+        // apply to it.
+        return;
+    }
+    PalmDecision decision;
+    decision.downTime = args.downTime;
+    decision.eventSeq = work.eventSeq;
+    for (int32_t pointerId : suppressedPointerIds) {
+        decision.suppressedPointerIds.markBit(pointerId);
+    }
+    std::scoped_lock lock(mLock);
+    mDecisions.insert_or_assign(args.deviceId, decision);
+}
+
+std::string PalmRejectionThread::dump() {
+    std::string out;
+    out += StringPrintf("mQueue.size() = %zu\n", mQueue.size());
+    std::scoped_lock lock(mLock);
+    out += mDecisions.empty() ? "mDecisions: None\n" : "mDecisions:\n";
+    for (const auto& [deviceId, decision] : mDecisions) {
+        out += StringPrintf("  deviceId = %" PRId32 ": downTime = %" PRId64 ", eventSeq = %" PRIu64
+                            ", suppressedPointerIds = 0x%08" PRIx32 "\n",
+                            deviceId, decision.downTime, decision.eventSeq,
+                            decision.suppressedPointerIds.value);
+    }
+    return out;
+}
+
+std::vector<NotifyMotionArgs> LatePalmCanceler::processMotion(
+        const NotifyMotionArgs& args, uint64_t eventSeq,
+        const std::optional<PalmDecision>& decision) {
+    if (isIgnoredByPalmRejection(args.action)) {
+        return {args};
+    }
+    const int32_t actionMasked = MotionEvent::getActionMasked(args.action);
+    if (actionMasked == AMOTION_EVENT_ACTION_DOWN) {
+        mDownTime = args.downTime;
+        mSuppressedPointerIds.clear();
+    }
+    for (size_t i = 0; i < args.getPointerCount(); i++) {
+        const int32_t resolvedAction = resolveActionForPointer(i, args.action);
+        if (resolvedAction == AMOTION_EVENT_ACTION_DOWN ||
+            resolvedAction == AMOTION_EVENT_ACTION_POINTER_DOWN) {
+            mPointerDownSeqs[args.pointerProperties[i].id] = eventSeq;
+        }
+    }
+
+    // Only the decisions about this gesture, and about the pointers that were already down when the
+    // decision was made, apply to this event.
+    std::set<int32_t> newSuppressedPointerIds = mSuppressedPointerIds;
+    if (decision && decision->downTime == mDownTime) {
+        for (size_t i = 0; i < args.getPointerCount(); i++) {
+            const int32_t pointerId = args.pointerProperties[i].id;
+            if (decision->suppressedPointerIds.hasBit(pointerId) &&
+                mPointerDownSeqs[pointerId] <= decision->eventSeq) {
+                newSuppressedPointerIds.insert(pointerId);
+            }
+        }
+    }
+    if (newSuppressedPointerIds.size() > mSuppressedPointerIds.size()) {
+        ALOGI("Palm detected late, canceling pointer ids %s after %" PRId64 "ms",
+              dumpSet(newSuppressedPointerIds).c_str(), ns2ms(args.eventTime - args.downTime));
+    }
+
+    std::vector<NotifyMotionArgs> argsWithoutUnwantedPointers =
+            cancelSuppressedPointers(args, mSuppressedPointerIds, newSuppressedPointerIds);
+    for (const NotifyMotionArgs& checkArgs : argsWithoutUnwantedPointers) {
+        LOG_ALWAYS_FATAL_IF(checkArgs.action == ACTION_UNKNOWN, "%s", checkArgs.dump().c_str());
+    }
+
+    // Forget the pointers that went up, so that a new pointer with the same id is not suppressed.
+    mSuppressedPointerIds = std::move(newSuppressedPointerIds);
+    if (actionMasked == AMOTION_EVENT_ACTION_UP || actionMasked == AMOTION_EVENT_ACTION_CANCEL) {
+        mSuppressedPointerIds.clear();
+    } else if (actionMasked == AMOTION_EVENT_ACTION_POINTER_UP) {
+        mSuppressedPointerIds.erase(
+                args.pointerProperties[MotionEvent::getActionIndex(args.action)].id);
+    }
+    return argsWithoutUnwantedPointers;
+}
+
+std::string LatePalmCanceler::dump() const {
+    std::string out;
+    out += StringPrintf("mDownTime: %" PRId64 "\n", mDownTime);
+    out += "mSuppressedPointerIds: ";
+    out += dumpSet(mSuppressedPointerIds) + "\n";
+    return out;
+}
+
 } // namespace android
@@ -16,10 +16,16 @@
 
 #pragma once
 
+#include <array>
 #include <map>
+#include <optional>
 #include <set>
+#include <variant>
 
 #include <android-base/thread_annotations.h>
+#include <ftl/ring_queue.h>
+#include <utils/BitSet.h>
+#include "InputThread.h"
 #include "include/UnwantedInteractionBlockerInterface.h"
 #include "ui/events/ozone/evdev/touch_filter/neural_stylus_palm_detection_filter_util.h"
 #include "ui/events/ozone/evdev/touch_filter/palm_detection_filter.h"
@@ -41,6 +47,9 @@ struct AndroidPalmFilterDeviceInfo : ::ui::PalmFilterDeviceInfo {
 std::optional<AndroidPalmFilterDeviceInfo> createPalmFilterDeviceInfo(
         const InputDeviceInfo& deviceInfo);
 
+// The devices that palm rejection runs on, and their info
+using PalmFilterDevices = std::map<int32_t /*deviceId*/, AndroidPalmFilterDeviceInfo>;
+
 static constexpr int32_t ACTION_UNKNOWN = -1;
 
 /**
@@ -74,6 +83,8 @@ std::string toString(const ::ui::InProgressTouchEvdev& touch);
 // --- Main classes and interfaces ---
 
 class PalmRejector;
+class PalmRejectionThread;
+class LatePalmCanceler;
 
 // --- Implementations ---
 
@@ -84,11 +95,17 @@ class PalmRejector;
  *
  * The events of motion type are sent to PalmRejectors. PalmRejectors detect unwanted touches,
  * and emit input streams with the bad pointers removed.
+ *
+ * When palm rejection is pipelined, the PalmRejectors run on a PalmRejectionThread instead, so that
+ * the events don't wait for the model. The events are sent to the next stage right away, and the
+ * pointers that the model decides are palms are canceled with a later event of the gesture.
  */
 class UnwantedInteractionBlocker : public UnwantedInteractionBlockerInterface {
 public:
     explicit UnwantedInteractionBlocker(InputListenerInterface& listener);
     explicit UnwantedInteractionBlocker(InputListenerInterface& listener, bool enablePalmRejection);
+    explicit UnwantedInteractionBlocker(InputListenerInterface& listener, bool enablePalmRejection,
+                                        bool pipelinePalmRejection);
 
     void notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs& args) override;
     void notifyKey(const NotifyKeyArgs& args) override;
@@ -117,8 +134,17 @@ private:
     // Detect and reject unwanted palms on screen
     // Use a separate palm rejector for every touch device.
     std::map<int32_t /*deviceId*/, PalmRejector> mPalmRejectors GUARDED_BY(mLock);
+
+    // When palm rejection is pipelined, the PalmRejectors are on this thread instead, and the
+    // decisions that it makes are applied to the events of every touch device by its canceler.
+    std::unique_ptr<PalmRejectionThread> mPalmRejectionThread;
+    std::map<int32_t /*deviceId*/, LatePalmCanceler> mLatePalmCancelers GUARDED_BY(mLock);
+    // The sequence number of the next event that is sent to the PalmRejectionThread
+    uint64_t mNextEventSeq GUARDED_BY(mLock) = 0;
+
     // TODO(b/210159205): delete this when simultaneous stylus and touch is supported
     void notifyMotionLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
+    void notifyMotionPipelinedLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
 
     // Call this function for outbound events so that they can be logged when logging is enabled.
     void enqueueOutboundMotionLocked(const NotifyMotionArgs& args) REQUIRES(mLock);
@@ -165,6 +191,11 @@ public:
     explicit PalmRejector(const AndroidPalmFilterDeviceInfo& info,
                           std::unique_ptr<::ui::PalmDetectionFilter> filter = nullptr);
     std::vector<NotifyMotionArgs> processMotion(const NotifyMotionArgs& args);
+    /**
+     * Send this event to the palm rejection model, like processMotion, but only return the pointer
+     * ids that should be suppressed, instead of the events with these pointers canceled.
+     */
+    const std::set<int32_t>& detectSuppressedPointers(const NotifyMotionArgs& args);
 
     // Get the device info of this device, for comparison purposes
     const AndroidPalmFilterDeviceInfo& getPalmFilterDeviceInfo() const;
@@ -182,6 +213,11 @@ private:
      * the incoming args! Also, it will call Filter(..), which has side-effects.
      */
     std::set<int32_t> detectPalmPointers(const NotifyMotionArgs& args);
+    /**
+     * Update mSuppressedPointerIds for this event, and return the pointer ids that were suppressed
+     * before it.
+     */
+    std::set<int32_t> updateSuppressedPointers(const NotifyMotionArgs& args);
     std::unique_ptr<::ui::SharedPalmDetectionFilterState> mSharedPalmState;
     AndroidPalmFilterDeviceInfo mDeviceInfo;
     std::unique_ptr<::ui::PalmDetectionFilter> mPalmDetectionFilter;
@@ -191,4 +227,88 @@ private:
     SlotState mSlotState;
 };
 
+/**
+ * The pointers that a PalmRejectionThread has decided to suppress, after processing one of the
+ * events of a gesture.
+ */
+struct PalmDecision {
+    nsecs_t downTime;
+    // The sequence number of the event that the decision was made after
+    uint64_t eventSeq;
+    BitSet32 suppressedPointerIds;
+};
+
+/**
+ * Runs the PalmRejectors of the touch devices on a thread that it creates, so that the palm
+ * rejection model does not delay the events of the devices. The events, and the device changes and
+ * resets, are processed in the order in which they are sent. The events are handed over through a
+ * bounded lock-free queue; if the thread falls behind and the queue is full, the caller waits,
+ * rather than dropping events and losing track of the pointers.
+ *
+ * The thread is started when the PalmRejectionThread is created, and is stopped when it is
+ * destroyed.
+ */
+class PalmRejectionThread {
+public:
+    PalmRejectionThread();
+
+    void notifyInputDevicesChanged(PalmFilterDevices palmDevices);
+    void notifyDeviceReset(int32_t deviceId);
+    void notifyMotion(const NotifyMotionArgs& args, uint64_t eventSeq);
+
+    /* The latest decision that was made for this device, if one was made. */
+    std::optional<PalmDecision> getDecision(int32_t deviceId);
+    std::string dump();
+
+private:
+    static constexpr size_t QUEUE_CAPACITY = 64;
+
+    struct MotionWork {
+        NotifyMotionArgs args;
+        uint64_t eventSeq;
+    };
+    struct ResetWork {
+        int32_t deviceId;
+    };
+    using Work = std::variant<MotionWork, ResetWork, PalmFilterDevices>;
+    // An empty entry wakes the thread up when it should exit.
+    ftl::MpscQueue<std::optional<Work>, QUEUE_CAPACITY> mQueue;
+
+    // Only used on the palm rejection thread.
+    std::map<int32_t /*deviceId*/, PalmRejector> mPalmRejectors;
+
+    std::mutex mLock;
+    std::map<int32_t /*deviceId*/, PalmDecision> mDecisions GUARDED_BY(mLock);
+
+    // InputThread stops when its destructor is called. Initialize it last so that it is the
+    // first thing to be destructed. This will guarantee the thread will not access other
+    // members that have already been destructed.
+    InputThread mThread;
+
+    void threadLoop();
+    void processMotion(const MotionWork& work);
+};
+
+/**
+ * Applies the decisions of a PalmRejectionThread to the events of one touch device. The events
+ * are passed through unchanged until the thread decides that some of the pointers are palms. Those
+ * pointers are then canceled with the next event of the gesture, and removed from the events that
+ * follow, in the same way that PalmRejector::processMotion removes them.
+ *
+ * A pointer that goes up before the decision arrives can no longer be canceled.
+ */
+class LatePalmCanceler {
+public:
+    std::vector<NotifyMotionArgs> processMotion(const NotifyMotionArgs& args, uint64_t eventSeq,
+                                                const std::optional<PalmDecision>& decision);
+    std::string dump() const;
+
+private:
+    nsecs_t mDownTime = 0;
+    std::set<int32_t> mSuppressedPointerIds;
+    // The sequence number of the event that each pointer went down with, so that a decision about
+    // a pointer isn't applied to a new pointer that reuses its id.
+    std::array<uint64_t, MAX_POINTER_ID + 1> mPointerDownSeqs{};
+};
+
 } // namespace android
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <EventHub.h>
+#include <gestures/HardwareStateConverter.h>
+#include <linux/input-event-codes.h>
+#include <utils/StrongPointer.h>
+
+#include "../tests/FakeEventHub.h"
+#include "../tests/FakeInputReaderPolicy.h"
+#include "../tests/InstrumentedInputReader.h"
+#include "../tests/TestInputListener.h"
+#include "MultiTouchMotionAccumulator.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Counts the allocations of the whole process, so that the benchmark can report how many of them
+// the conversion makes per frame.
+std::atomic<size_t> gAllocationCount{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace android {
+
+namespace {
+
+constexpr int32_t DEVICE_ID = END_RESERVED_ID + 1000;
+constexpr int32_t EVENTHUB_ID = 1;
+constexpr size_t SLOT_COUNT = 8;
+
+// Replays the evdev frames of fingers moving across a touchpad into a HardwareStateConverter, the
+// way that TouchpadInputMapper feeds it.
+class TouchpadReplay {
+public:
+    explicit TouchpadReplay(size_t fingerCount)
+          : mFakeEventHub(std::make_shared<FakeEventHub>()),
+            mFakePolicy(sp<FakeInputReaderPolicy>::make()),
+            mReader(mFakeEventHub, mFakePolicy, mFakeListener),
+            mDevice(newDevice()),
+            mDeviceContext(*mDevice, EVENTHUB_ID),
+            mFingerCount(fingerCount) {
+        mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, ABS_MT_SLOT, 0, SLOT_COUNT - 1, 0, 0, 0);
+        mAccumulator.configure(mDeviceContext, SLOT_COUNT, /*usingSlotsProtocol=*/true);
+        mConverter = std::make_unique<HardwareStateConverter>(mDeviceContext, mAccumulator);
+        for (size_t i = 0; i < mFingerCount; i++) {
+            process(EV_ABS, ABS_MT_SLOT, i);
+            process(EV_ABS, ABS_MT_TRACKING_ID, i);
+        }
+        process(EV_KEY, BTN_TOUCH, 1);
+    }
+
+    // Returns the number of fingers in the HardwareState of the frame.
+    size_t replayFrame() {
+        for (size_t i = 0; i < mFingerCount; i++) {
+            process(EV_ABS, ABS_MT_SLOT, i);
+            process(EV_ABS, ABS_MT_POSITION_X, mFrame % 1000 + i * 100);
+            process(EV_ABS, ABS_MT_POSITION_Y, mFrame % 1000);
+            process(EV_ABS, ABS_MT_PRESSURE, 40);
+        }
+        mFrame++;
+        std::optional<SelfContainedHardwareState> schs = process(EV_SYN, SYN_REPORT, 0);
+        return schs ? schs->state.finger_cnt : 0;
+    }
+
+private:
+    std::shared_ptr<InputDevice> newDevice() {
+        InputDeviceIdentifier identifier;
+        identifier.name = "touchpad";
+        identifier.location = "USB1";
+        std::shared_ptr<InputDevice> device =
+                std::make_shared<InputDevice>(mReader.getContext(), DEVICE_ID, /*generation=*/2,
+                                              identifier);
+        mReader.pushNextDevice(device);
+        mFakeEventHub->addDevice(EVENTHUB_ID, identifier.name, InputDeviceClass::TOUCHPAD,
+                                 identifier.bus);
+        mReader.loopOnce();
+        return device;
+    }
+
+    std::optional<SelfContainedHardwareState> process(int32_t type, int32_t code, int32_t value) {
+        RawEvent event;
+        event.when = mFrame * 8'000'000;
+        event.readTime = event.when;
+        event.deviceId = EVENTHUB_ID;
+        event.type = type;
+        event.code = code;
+        event.value = value;
+        return mConverter->processRawEvent(event);
+    }
+
+    std::shared_ptr<FakeEventHub> mFakeEventHub;
+    sp<FakeInputReaderPolicy> mFakePolicy;
+    TestInputListener mFakeListener;
+    InstrumentedInputReader mReader;
+    std::shared_ptr<InputDevice> mDevice;
+    InputDeviceContext mDeviceContext;
+    MultiTouchMotionAccumulator mAccumulator;
+    std::unique_ptr<HardwareStateConverter> mConverter;
+    const size_t mFingerCount;
+    nsecs_t mFrame = 1;
+};
+
+void benchmarkHardwareStateConversion(benchmark::State& state) {
+    TouchpadReplay replay(state.range(0));
+
+    size_t allocations = 0;
+    for (auto _ : state) {
+        const size_t before = gAllocationCount.load(std::memory_order_relaxed);
+        benchmark::DoNotOptimize(replay.replayFrame());
+        allocations += gAllocationCount.load(std::memory_order_relaxed) - before;
+    }
+    state.counters["allocs/frame"] =
+            benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+
+} // namespace
+
+BENCHMARK(benchmarkHardwareStateConversion)->Arg(1)->Arg(2)->Arg(5);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/logging.h>
+#include <input/InputConsumer.h>
+#include <input/InputConsumerNoResampling.h>
+#include <input/InputTransport.h>
+#include <utils/Looper.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Counts the allocations of the whole process, so that the benchmarks can report how many of them
+// the consumer makes per frame.
+std::atomic<size_t> gAllocationCount{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace android {
+
+namespace {
+
+constexpr int32_t DEVICE_ID = 1;
+
+// A 240Hz touchscreen produces 4 samples for every frame at 60Hz.
+constexpr size_t SAMPLES_PER_FRAME = 4;
+
+class FramePublisher {
+public:
+    FramePublisher(std::unique_ptr<InputChannel> channel, size_t pointerCount)
+          : mPublisher(std::move(channel)), mPointerCount(pointerCount) {
+        for (size_t i = 0; i < pointerCount; i++) {
+            mPointerProperties[i].clear();
+            mPointerProperties[i].id = i;
+            mPointerProperties[i].toolType = ToolType::FINGER;
+            mPointerCoords[i].clear();
+        }
+        mDownTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        publish(AMOTION_EVENT_ACTION_DOWN);
+    }
+
+    void publishFrame() {
+        for (size_t i = 0; i < SAMPLES_PER_FRAME; i++) {
+            for (size_t p = 0; p < mPointerCount; p++) {
+                mPointerCoords[p].setAxisValue(AMOTION_EVENT_AXIS_X, mSeq % 1000 + p * 10);
+                mPointerCoords[p].setAxisValue(AMOTION_EVENT_AXIS_Y, mSeq % 1000);
+            }
+            publish(AMOTION_EVENT_ACTION_MOVE);
+        }
+    }
+
+    void receiveFinishedSignals() {
+        while (mPublisher.receiveConsumerResponse().ok()) {
+        }
+    }
+
+private:
+    void publish(int32_t action) {
+        // Only the first pointer goes down, so that the stream stays consistent.
+        const size_t pointerCount = action == AMOTION_EVENT_ACTION_DOWN ? 1 : mPointerCount;
+        ui::Transform identityTransform;
+        status_t status =
+                mPublisher.publishMotionEvent(mSeq++, InputEvent::nextId(), DEVICE_ID,
+                                              AINPUT_SOURCE_TOUCHSCREEN,
+                                              ui::LogicalDisplayId::DEFAULT, INVALID_HMAC, action,
+                                              /*actionButton=*/0, /*flags=*/0, /*edgeFlags=*/0,
+                                              AMETA_NONE, /*buttonState=*/0,
+                                              MotionClassification::NONE, identityTransform,
+                                              /*xPrecision=*/0, /*yPrecision=*/0,
+                                              AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                              AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                              identityTransform, mDownTime,
+                                              systemTime(SYSTEM_TIME_MONOTONIC), pointerCount,
+                                              mPointerProperties, mPointerCoords);
+        LOG_IF(FATAL, status != OK) << "Could not publish, status=" << statusToString(status);
+    }
+
+    InputPublisher mPublisher;
+    const size_t mPointerCount;
+    PointerProperties mPointerProperties[MAX_POINTERS];
+    PointerCoords mPointerCoords[MAX_POINTERS];
+    nsecs_t mDownTime;
+    uint32_t mSeq = 1;
+};
+
+void benchmarkInputConsumer(benchmark::State& state) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel);
+    FramePublisher publisher(std::move(serverChannel), state.range(0));
+    InputConsumer consumer(std::move(clientChannel), /*enableTouchResampling=*/false);
+    PooledInputEventFactory factory;
+
+    size_t allocations = 0;
+    for (auto _ : state) {
+        publisher.publishFrame();
+
+        const size_t before = gAllocationCount.load(std::memory_order_relaxed);
+        uint32_t seq;
+        InputEvent* event;
+        while (consumer.consume(&factory, /*consumeBatches=*/true, /*frameTime=*/-1, &seq,
+                                &event) == OK) {
+            consumer.sendFinishedSignal(seq, /*handled=*/true);
+            factory.recycle(event);
+        }
+        allocations += gAllocationCount.load(std::memory_order_relaxed) - before;
+
+        publisher.receiveFinishedSignals();
+    }
+    state.counters["allocs/frame"] =
+            benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+
+class RecyclingCallbacks : public InputConsumerCallbacks {
+public:
+    InputConsumerNoResampling* consumer = nullptr;
+
+    void onKeyEvent(std::unique_ptr<KeyEvent>, uint32_t seq) override { finish(seq); }
+    void onMotionEvent(std::unique_ptr<MotionEvent> event, uint32_t seq) override {
+        finish(seq);
+        consumer->recycleMotionEvent(std::move(event));
+    }
+    void onBatchedInputEventPending(int32_t) override {
+        consumer->consumeBatchedInputEvents(/*requestedFrameTime=*/std::nullopt);
+    }
+    void onFocusEvent(std::unique_ptr<FocusEvent>, uint32_t seq) override { finish(seq); }
+    void onCaptureEvent(std::unique_ptr<CaptureEvent>, uint32_t seq) override { finish(seq); }
+    void onDragEvent(std::unique_ptr<DragEvent>, uint32_t seq) override { finish(seq); }
+    void onTouchModeEvent(std::unique_ptr<TouchModeEvent>, uint32_t seq) override { finish(seq); }
+
+private:
+    void finish(uint32_t seq) { consumer->finishInputEvent(seq, /*handled=*/true); }
+};
+
+void benchmarkInputConsumerNoResampling(benchmark::State& state) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel);
+    FramePublisher publisher(std::move(serverChannel), state.range(0));
+    sp<Looper> looper = sp<Looper>::make(/*allowNonCallbacks=*/false);
+    Looper::setForThread(looper);
+    RecyclingCallbacks callbacks;
+    InputConsumerNoResampling consumer(std::move(clientChannel), looper, callbacks,
+                                       /*resampler=*/nullptr);
+    callbacks.consumer = &consumer;
+
+    size_t allocations = 0;
+    for (auto _ : state) {
+        publisher.publishFrame();
+
+        const size_t before = gAllocationCount.load(std::memory_order_relaxed);
+        looper->pollOnce(/*timeoutMillis=*/0);
+        allocations += gAllocationCount.load(std::memory_order_relaxed) - before;
+
+        publisher.receiveFinishedSignals();
+    }
+    state.counters["allocs/frame"] =
+            benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+    Looper::setForThread(nullptr);
+}
+
+} // namespace
+
+BENCHMARK(benchmarkInputConsumer)->Arg(1)->Arg(5);
+BENCHMARK(benchmarkInputConsumerNoResampling)->Arg(1)->Arg(5);
+
+} // namespace android
+
+BENCHMARK_MAIN();
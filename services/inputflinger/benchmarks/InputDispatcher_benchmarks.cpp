@@ -16,6 +16,11 @@
 
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include <android/os/IInputConstants.h>
 #include <binder/Binder.h>
 #include "../dispatcher/InputDispatcher.h"
@@ -41,10 +46,83 @@ constexpr ui::LogicalDisplayId DISPLAY_ID = ui::LogicalDisplayId::DEFAULT;
 
 static constexpr std::chrono::duration INJECT_EVENT_TIMEOUT = 5s;
 
+// An arbitrary pid for the global monitors.
+static constexpr gui::Pid MONITOR_PID{2001};
+
+constexpr int32_t DISPLAY_WIDTH = 1080;
+constexpr int32_t DISPLAY_HEIGHT = 2400;
+
 static nsecs_t now() {
     return systemTime(SYSTEM_TIME_MONOTONIC);
 }
 
+/**
+ * Collects latencies, and reports their percentiles as counters of the benchmark, in microseconds.
+ */
+class LatencyRecorder {
+public:
+    void record(nsecs_t latency) { mLatencies.push_back(latency); }
+
+    void report(benchmark::State& state, const std::string& name) {
+        if (mLatencies.empty()) {
+            return;
+        }
+        std::sort(mLatencies.begin(), mLatencies.end());
+        const auto percentile = [this](size_t p) {
+            const size_t index = std::min(mLatencies.size() - 1, mLatencies.size() * p / 100);
+            return mLatencies[index] / 1000.0;
+        };
+        state.counters[name + "_p50_us"] = percentile(50);
+        state.counters[name + "_p90_us"] = percentile(90);
+        state.counters[name + "_p99_us"] = percentile(99);
+        state.counters[name + "_max_us"] = mLatencies.back() / 1000.0;
+    }
+
+private:
+    std::vector<nsecs_t> mLatencies;
+};
+
+/**
+ * Measures how long another thread waits for the dispatcher lock while the benchmark runs. The
+ * dispatcher is not instrumented, so the time it takes a cheap call that only takes mLock to
+ * return is used as a bound on how long the dispatcher holds mLock at a time.
+ */
+class LockProbe {
+public:
+    explicit LockProbe(InputDispatcher& dispatcher)
+          : mDispatcher(dispatcher), mThread([this]() { run(); }) {}
+
+    ~LockProbe() { stop(); }
+
+    void report(benchmark::State& state) {
+        stop();
+        mWaits.report(state, "lock_wait");
+    }
+
+private:
+    void stop() {
+        if (mThread.joinable()) {
+            mStop = true;
+            mThread.join();
+        }
+    }
+
+    void run() {
+        while (!mStop) {
+            const nsecs_t start = now();
+            mDispatcher.isPointerInWindow(mToken, DISPLAY_ID, DEVICE_ID, /*pointerId=*/0);
+            mWaits.record(now() - start);
+            std::this_thread::sleep_for(100us);
+        }
+    }
+
+    InputDispatcher& mDispatcher;
+    const sp<IBinder> mToken = sp<BBinder>::make();
+    LatencyRecorder mWaits;
+    std::atomic<bool> mStop = false;
+    std::thread mThread;
+};
+
 static MotionEvent generateMotionEvent() {
     PointerProperties pointerProperties[1];
     PointerCoords pointerCoords[1];
@@ -149,22 +227,382 @@ static void benchmarkInjectMotion(benchmark::State& state) {
 
     dispatcher->onWindowInfosChanged({{*window->getInfo()}, {}, 0, 0});
 
+    LatencyRecorder latencies;
     for (auto _ : state) {
         MotionEvent event = generateMotionEvent();
         // Send ACTION_DOWN
+        nsecs_t start = now();
         dispatcher->injectInputEvent(&event, /*targetUid=*/{}, InputEventInjectionSync::NONE,
                                      INJECT_EVENT_TIMEOUT,
                                      POLICY_FLAG_FILTERED | POLICY_FLAG_PASS_TO_USER);
+        window->consumeMotionEvent();
+        latencies.record(now() - start);
 
         // Send ACTION_UP
         event.setAction(AMOTION_EVENT_ACTION_UP);
+        start = now();
         dispatcher->injectInputEvent(&event, /*targetUid=*/{}, InputEventInjectionSync::NONE,
                                      INJECT_EVENT_TIMEOUT,
                                      POLICY_FLAG_FILTERED | POLICY_FLAG_PASS_TO_USER);
-
-        window->consumeMotionEvent();
         window->consumeMotionEvent();
+        latencies.record(now() - start);
+    }
+    latencies.report(state, "latency");
+
+    dispatcher->stop();
+}
+
+static NotifyMotionArgs generateHoverArgs(float x, float y) {
+    PointerProperties pointerProperties[1];
+    PointerCoords pointerCoords[1];
+
+    pointerProperties[0].clear();
+    pointerProperties[0].id = 0;
+    pointerProperties[0].toolType = ToolType::MOUSE;
+
+    pointerCoords[0].clear();
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, x);
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, y);
+
+    const nsecs_t currentTime = now();
+    return NotifyMotionArgs(IInputConstants::INVALID_INPUT_EVENT_ID, currentTime, currentTime,
+                            DEVICE_ID, AINPUT_SOURCE_MOUSE, ui::LogicalDisplayId::DEFAULT,
+                            POLICY_FLAG_PASS_TO_USER, AMOTION_EVENT_ACTION_HOVER_MOVE,
+                            /* actionButton */ 0, /* flags */ 0, AMETA_NONE, /* buttonState */ 0,
+                            MotionClassification::NONE, AMOTION_EVENT_EDGE_FLAG_NONE, 1,
+                            pointerProperties, pointerCoords,
+                            /* xPrecision */ 0, /* yPrecision */ 0, x, y, currentTime,
+                            /* videoFrames */ {});
+}
+
+static NotifyMotionArgs generateTouchArgs(int32_t action, const std::vector<PointF>& points,
+                                          nsecs_t downTime,
+                                          ui::LogicalDisplayId displayId = DISPLAY_ID) {
+    PointerProperties pointerProperties[MAX_POINTERS];
+    PointerCoords pointerCoords[MAX_POINTERS];
+
+    for (size_t i = 0; i < points.size(); i++) {
+        pointerProperties[i].clear();
+        pointerProperties[i].id = i;
+        pointerProperties[i].toolType = ToolType::FINGER;
+
+        pointerCoords[i].clear();
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X, points[i].x);
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, points[i].y);
+    }
+
+    const nsecs_t currentTime = now();
+    return NotifyMotionArgs(IInputConstants::INVALID_INPUT_EVENT_ID, currentTime, currentTime,
+                            DEVICE_ID, AINPUT_SOURCE_TOUCHSCREEN, displayId,
+                            POLICY_FLAG_PASS_TO_USER, action,
+                            /* actionButton */ 0, /* flags */ 0, AMETA_NONE, /* buttonState */ 0,
+                            MotionClassification::NONE, AMOTION_EVENT_EDGE_FLAG_NONE,
+                            points.size(), pointerProperties, pointerCoords,
+                            /* xPrecision */ 0, /* yPrecision */ 0,
+                            AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                            AMOTION_EVENT_INVALID_CURSOR_POSITION, downTime,
+                            /* videoFrames */ {});
+}
+
+static int32_t pointerAction(int32_t action, int32_t pointerIndex) {
+    return action | (pointerIndex << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+}
+
+/**
+ * Add windowCount windows, most of them overlays that are not touchable, so that finding the
+ * touched window has to skip over them.
+ */
+static void addOverlayWindows(const std::shared_ptr<FakeApplicationHandle>& application,
+                              const std::unique_ptr<InputDispatcher>& dispatcher,
+                              int64_t windowCount, std::vector<sp<FakeWindowHandle>>& windows,
+                              std::vector<gui::WindowInfo>& windowInfos) {
+    for (int64_t i = 0; i < windowCount; i++) {
+        sp<FakeWindowHandle> window =
+                sp<FakeWindowHandle>::make(application, dispatcher,
+                                           "Window " + std::to_string(i), DISPLAY_ID);
+        if (i % 10 == 0) {
+            // A small touchable window along the top of the display.
+            window->setFrame(Rect(i * 10, 0, i * 10 + 10, 10));
+        } else {
+            window->setFrame(Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT));
+            window->setTouchable(false);
+        }
+        windowInfos.push_back(*window->getInfo());
+        windows.push_back(window);
+    }
+}
+
+/**
+ * Consume the events of a window until the end of its gesture, and return how many there were.
+ */
+static size_t consumeGesture(const sp<FakeWindowHandle>& window) {
+    for (size_t count = 1;; count++) {
+        std::unique_ptr<MotionEvent> event = window->consumeMotionEvent();
+        if (event == nullptr || event->getActionMasked() == AMOTION_EVENT_ACTION_UP) {
+            return count;
+        }
+    }
+}
+
+// Hover moves over a display with many windows, most of them overlays that are not touchable, so
+// that finding the hovered window dominates the dispatch time.
+static void benchmarkHoverManyWindows(benchmark::State& state) {
+    const int64_t windowCount = state.range(0);
+
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    auto dispatcher = std::make_unique<InputDispatcher>(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    std::vector<sp<FakeWindowHandle>> windows;
+    std::vector<gui::WindowInfo> windowInfos;
+    addOverlayWindows(application, dispatcher, windowCount - 1, windows, windowInfos);
+    // The window that all of the hover moves go to.
+    sp<FakeWindowHandle> appWindow =
+            sp<FakeWindowHandle>::make(application, dispatcher, "App Window", DISPLAY_ID);
+    appWindow->setFrame(Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT));
+    windowInfos.push_back(*appWindow->getInfo());
+
+    dispatcher->onWindowInfosChanged({windowInfos, {}, 0, 0});
+
+    LatencyRecorder latencies;
+    LockProbe lockProbe(*dispatcher);
+    float y = 500;
+    for (auto _ : state) {
+        y = y < 2000 ? y + 1 : 500;
+        const nsecs_t start = now();
+        dispatcher->notifyMotion(generateHoverArgs(540, y));
+        appWindow->consumeMotionEvent();
+        latencies.record(now() - start);
+    }
+    lockProbe.report(state);
+    latencies.report(state, "latency");
+
+    dispatcher->stop();
+}
+
+// Touches that go to the app window, and to the spy windows and global monitors above it. The
+// latency of an event is the time until all of its targets have received it.
+static void benchmarkTouchWithSpiesAndMonitors(benchmark::State& state) {
+    const int64_t spyCount = state.range(0);
+    const int64_t monitorCount = state.range(1);
+
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    auto dispatcher = std::make_unique<InputDispatcher>(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    std::vector<sp<FakeWindowHandle>> spies;
+    std::vector<gui::WindowInfo> windowInfos;
+    for (int64_t i = 0; i < spyCount; i++) {
+        sp<FakeWindowHandle> spy =
+                sp<FakeWindowHandle>::make(application, dispatcher, "Spy " + std::to_string(i),
+                                           DISPLAY_ID);
+        spy->setFrame(Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT));
+        spy->setSpy(true);
+        spy->setTrustedOverlay(true);
+        windowInfos.push_back(*spy->getInfo());
+        spies.push_back(spy);
+    }
+    sp<FakeWindowHandle> appWindow =
+            sp<FakeWindowHandle>::make(application, dispatcher, "App Window", DISPLAY_ID);
+    appWindow->setFrame(Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT));
+    windowInfos.push_back(*appWindow->getInfo());
+
+    std::vector<std::unique_ptr<FakeInputReceiver>> monitors;
+    for (int64_t i = 0; i < monitorCount; i++) {
+        const std::string name = "Monitor " + std::to_string(i);
+        monitors.push_back(std::make_unique<FakeInputReceiver>(
+                *dispatcher->createInputMonitor(DISPLAY_ID, name, MONITOR_PID), name));
+    }
+
+    dispatcher->onWindowInfosChanged({windowInfos, {}, 0, 0});
+
+    LatencyRecorder latencies;
+    LockProbe lockProbe(*dispatcher);
+    for (auto _ : state) {
+        const nsecs_t downTime = now();
+        for (int32_t action : {AMOTION_EVENT_ACTION_DOWN, AMOTION_EVENT_ACTION_UP}) {
+            const nsecs_t start = now();
+            dispatcher->notifyMotion(generateTouchArgs(action, {{540, 1200}}, downTime));
+            for (const sp<FakeWindowHandle>& spy : spies) {
+                spy->consumeMotionEvent();
+            }
+            for (const std::unique_ptr<FakeInputReceiver>& monitor : monitors) {
+                monitor->consumeMotion();
+            }
+            appWindow->consumeMotionEvent();
+            latencies.record(now() - start);
+        }
+    }
+    lockProbe.report(state);
+    latencies.report(state, "latency");
+
+    dispatcher->stop();
+}
+
+// A two-finger gesture that is split across two windows side by side, above many overlays.
+static void benchmarkSplitTouch(benchmark::State& state) {
+    const int64_t overlayCount = state.range(0);
+
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    auto dispatcher = std::make_unique<InputDispatcher>(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    std::vector<sp<FakeWindowHandle>> windows;
+    std::vector<gui::WindowInfo> windowInfos;
+    addOverlayWindows(application, dispatcher, overlayCount, windows, windowInfos);
+    sp<FakeWindowHandle> leftWindow =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Left Window", DISPLAY_ID);
+    leftWindow->setFrame(Rect(0, 0, DISPLAY_WIDTH / 2, DISPLAY_HEIGHT));
+    windowInfos.push_back(*leftWindow->getInfo());
+    sp<FakeWindowHandle> rightWindow =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Right Window", DISPLAY_ID);
+    rightWindow->setFrame(Rect(DISPLAY_WIDTH / 2, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT));
+    windowInfos.push_back(*rightWindow->getInfo());
+
+    dispatcher->onWindowInfosChanged({windowInfos, {}, 0, 0});
+
+    LatencyRecorder latencies;
+    LockProbe lockProbe(*dispatcher);
+    const PointF left{270, 1200};
+    const PointF right{810, 1200};
+    const PointF leftMoved{280, 1210};
+    const PointF rightMoved{820, 1210};
+    size_t eventCount = 0;
+    for (auto _ : state) {
+        const nsecs_t downTime = now();
+        dispatcher->notifyMotion(generateTouchArgs(AMOTION_EVENT_ACTION_DOWN, {left}, downTime));
+        dispatcher->notifyMotion(
+                generateTouchArgs(pointerAction(AMOTION_EVENT_ACTION_POINTER_DOWN, 1),
+                                  {left, right}, downTime));
+        dispatcher->notifyMotion(generateTouchArgs(AMOTION_EVENT_ACTION_MOVE,
+                                                   {leftMoved, rightMoved}, downTime));
+        dispatcher->notifyMotion(
+                generateTouchArgs(pointerAction(AMOTION_EVENT_ACTION_POINTER_UP, 1),
+                                  {leftMoved, rightMoved}, downTime));
+        dispatcher->notifyMotion(
+                generateTouchArgs(AMOTION_EVENT_ACTION_UP, {leftMoved}, downTime));
+        eventCount += consumeGesture(leftWindow);
+        eventCount += consumeGesture(rightWindow);
+        latencies.record(now() - downTime);
+    }
+    state.counters["events/gesture"] =
+            benchmark::Counter(eventCount, benchmark::Counter::kAvgIterations);
+    lockProbe.report(state);
+    latencies.report(state, "gesture_latency");
+
+    dispatcher->stop();
+}
+
+// Touches that go to the windows of many displays in turn.
+static void benchmarkTouchMultipleDisplays(benchmark::State& state) {
+    const int64_t displayCount = state.range(0);
+
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    auto dispatcher = std::make_unique<InputDispatcher>(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    std::vector<sp<FakeWindowHandle>> windows;
+    std::vector<gui::WindowInfo> windowInfos;
+    std::vector<gui::DisplayInfo> displayInfos;
+    for (int64_t i = 0; i < displayCount; i++) {
+        const ui::LogicalDisplayId displayId{static_cast<int32_t>(i)};
+        sp<FakeWindowHandle> window =
+                sp<FakeWindowHandle>::make(application, dispatcher,
+                                           "Window " + std::to_string(i), displayId);
+        window->setFrame(Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT));
+        windowInfos.push_back(*window->getInfo());
+        windows.push_back(window);
+
+        gui::DisplayInfo info;
+        info.displayId = displayId;
+        info.logicalWidth = DISPLAY_WIDTH;
+        info.logicalHeight = DISPLAY_HEIGHT;
+        displayInfos.push_back(info);
+    }
+
+    dispatcher->onWindowInfosChanged({windowInfos, displayInfos, 0, 0});
+
+    LatencyRecorder latencies;
+    LockProbe lockProbe(*dispatcher);
+    size_t display = 0;
+    for (auto _ : state) {
+        const ui::LogicalDisplayId displayId{static_cast<int32_t>(display)};
+        const nsecs_t downTime = now();
+        for (int32_t action : {AMOTION_EVENT_ACTION_DOWN, AMOTION_EVENT_ACTION_UP}) {
+            const nsecs_t start = now();
+            dispatcher->notifyMotion(
+                    generateTouchArgs(action, {{540, 1200}}, downTime, displayId));
+            windows[display]->consumeMotionEvent();
+            latencies.record(now() - start);
+        }
+        display = (display + 1) % displayCount;
+    }
+    lockProbe.report(state);
+    latencies.report(state, "latency");
+
+    dispatcher->stop();
+}
+
+// Hover moves over many windows, while another thread keeps sending window updates, as
+// SurfaceFlinger does during animations.
+static void benchmarkHoverDuringWindowInfosChanges(benchmark::State& state) {
+    const int64_t windowCount = state.range(0);
+
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    auto dispatcher = std::make_unique<InputDispatcher>(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    std::vector<sp<FakeWindowHandle>> windows;
+    std::vector<gui::WindowInfo> windowInfos;
+    addOverlayWindows(application, dispatcher, windowCount - 1, windows, windowInfos);
+    sp<FakeWindowHandle> appWindow =
+            sp<FakeWindowHandle>::make(application, dispatcher, "App Window", DISPLAY_ID);
+    appWindow->setFrame(Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT));
+    windowInfos.push_back(*appWindow->getInfo());
+
+    dispatcher->onWindowInfosChanged({windowInfos, {}, 0, 0});
+
+    std::atomic<bool> stopUpdates = false;
+    std::atomic<size_t> updateCount = 0;
+    std::thread updater([&]() {
+        for (int64_t vsyncId = 1; !stopUpdates; vsyncId++) {
+            dispatcher->onWindowInfosChanged({windowInfos, {}, vsyncId, now()});
+            updateCount++;
+            // About one update per frame at 120Hz.
+            std::this_thread::sleep_for(8ms);
+        }
+    });
+
+    LatencyRecorder latencies;
+    LockProbe lockProbe(*dispatcher);
+    float y = 500;
+    for (auto _ : state) {
+        y = y < 2000 ? y + 1 : 500;
+        const nsecs_t start = now();
+        dispatcher->notifyMotion(generateHoverArgs(540, y));
+        appWindow->consumeMotionEvent();
+        latencies.record(now() - start);
     }
+    stopUpdates = true;
+    updater.join();
+    state.counters["updates"] = updateCount;
+    lockProbe.report(state);
+    latencies.report(state, "latency");
 
     dispatcher->stop();
 }
@@ -200,6 +638,11 @@ static void benchmarkOnWindowInfosChanged(benchmark::State& state) {
 BENCHMARK(benchmarkNotifyMotion);
 BENCHMARK(benchmarkInjectMotion);
 BENCHMARK(benchmarkOnWindowInfosChanged);
+BENCHMARK(benchmarkHoverManyWindows)->Arg(10)->Arg(50)->Arg(150)->Arg(500);
+BENCHMARK(benchmarkTouchWithSpiesAndMonitors)->Args({0, 0})->Args({2, 2})->Args({10, 10});
+BENCHMARK(benchmarkSplitTouch)->Arg(0)->Arg(50)->Arg(500);
+BENCHMARK(benchmarkTouchMultipleDisplays)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK(benchmarkHoverDuringWindowInfosChanges)->Arg(50)->Arg(500);
 
 } // namespace android::inputdispatcher
 
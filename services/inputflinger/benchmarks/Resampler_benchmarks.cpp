@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <input/InputEventBuilders.h>
+#include <input/Resampler.h>
+
+#include <chrono>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// A 240Hz touchscreen.
+constexpr std::chrono::nanoseconds SAMPLE_INTERVAL = 4ms;
+// How far the resample time is past the latest sample that was consumed.
+constexpr std::chrono::nanoseconds RESAMPLE_OFFSET = 1ms;
+
+MotionEvent createMotionEvent(size_t pointerCount, std::chrono::nanoseconds eventTime) {
+    MotionEventBuilder builder = MotionEventBuilder(AMOTION_EVENT_ACTION_MOVE,
+                                                    AINPUT_SOURCE_TOUCHSCREEN)
+                                         .downTime(0)
+                                         .eventTime(eventTime.count());
+    for (size_t i = 0; i < pointerCount; i++) {
+        builder.pointer(PointerBuilder(i, ToolType::FINGER).x(100 * i).y(200 * i).axis(
+                AMOTION_EVENT_AXIS_PRESSURE, 0.5f));
+    }
+    return builder.build();
+}
+
+InputMessage createFutureSample(size_t pointerCount, std::chrono::nanoseconds eventTime) {
+    InputMessageBuilder builder = InputMessageBuilder(InputMessage::Type::MOTION, /*seq=*/0)
+                                          .eventTime(eventTime.count())
+                                          .source(AINPUT_SOURCE_TOUCHSCREEN)
+                                          .downTime(0);
+    for (size_t i = 0; i < pointerCount; i++) {
+        builder.pointer(PointerBuilder(i, ToolType::FINGER).x(100 * i + 10).y(200 * i + 20));
+    }
+    return builder.build();
+}
+
+/**
+ * Resamples a motion event with the given number of pointers between its sample and the next one,
+ * as the consumer does for every frame while the next sample is already there. Each iteration
+ * copies the motion event, since resampling adds a sample to it.
+ */
+void benchmarkInterpolation(benchmark::State& state) {
+    const size_t pointerCount = state.range(0);
+    const MotionEvent motionEvent = createMotionEvent(pointerCount, 0ms);
+    const InputMessage futureSample = createFutureSample(pointerCount, SAMPLE_INTERVAL);
+    LegacyResampler resampler;
+    const std::chrono::nanoseconds frameTime = RESAMPLE_OFFSET + resampler.getResampleLatency();
+    for (auto _ : state) {
+        MotionEvent resampled = motionEvent;
+        resampler.resampleMotionEvent(frameTime, resampled, &futureSample);
+        benchmark::DoNotOptimize(resampled);
+    }
+}
+
+/**
+ * Resamples a motion event with the given number of pointers after its latest sample, as the
+ * consumer does for every frame when the next sample has not arrived yet.
+ */
+void benchmarkExtrapolation(benchmark::State& state) {
+    const size_t pointerCount = state.range(0);
+    MotionEvent motionEvent = createMotionEvent(pointerCount, 0ms);
+    std::vector<PointerCoords> coords(motionEvent.getSamplePointerCoords(),
+                                      motionEvent.getSamplePointerCoords() + pointerCount);
+    for (PointerCoords& pointerCoords : coords) {
+        pointerCoords.setAxisValue(AMOTION_EVENT_AXIS_X, pointerCoords.getX() + 10);
+    }
+    motionEvent.addSample(std::chrono::nanoseconds(SAMPLE_INTERVAL).count(), coords.data(),
+                          motionEvent.getId());
+    LegacyResampler resampler;
+    const std::chrono::nanoseconds frameTime =
+            SAMPLE_INTERVAL + RESAMPLE_OFFSET + resampler.getResampleLatency();
+    for (auto _ : state) {
+        MotionEvent resampled = motionEvent;
+        resampler.resampleMotionEvent(frameTime, resampled, /*futureSample=*/nullptr);
+        benchmark::DoNotOptimize(resampled);
+    }
+}
+
+} // namespace
+
+BENCHMARK(benchmarkInterpolation)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
+BENCHMARK(benchmarkExtrapolation)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
+
+} // namespace android
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <input/VelocityTracker.h>
+
+#include <cmath>
+
+namespace android {
+
+namespace {
+
+constexpr nsecs_t SAMPLE_INTERVAL = 4'000'000; // A 240Hz touchscreen.
+constexpr int32_t POINTER_ID = 0;
+
+/**
+ * Adds a sample to a moving pointer, and gets its velocity along both axes, as a fling does for
+ * every frame. The pointer keeps moving, so the horizon of the strategy is always full.
+ */
+void benchmarkVelocityTracker(benchmark::State& state, VelocityTracker::Strategy strategy) {
+    VelocityTracker tracker(strategy);
+    nsecs_t eventTime = 0;
+    for (auto _ : state) {
+        eventTime += SAMPLE_INTERVAL;
+        const float t = eventTime * 1E-9f;
+        tracker.addMovement(eventTime, POINTER_ID, AMOTION_EVENT_AXIS_X, 500 + 300 * std::sin(t));
+        tracker.addMovement(eventTime, POINTER_ID, AMOTION_EVENT_AXIS_Y, 1000 * t);
+        benchmark::DoNotOptimize(tracker.getVelocity(AMOTION_EVENT_AXIS_X, POINTER_ID));
+        benchmark::DoNotOptimize(tracker.getVelocity(AMOTION_EVENT_AXIS_Y, POINTER_ID));
+    }
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(benchmarkVelocityTracker, lsq1, VelocityTracker::Strategy::LSQ1);
+BENCHMARK_CAPTURE(benchmarkVelocityTracker, lsq2, VelocityTracker::Strategy::LSQ2);
+BENCHMARK_CAPTURE(benchmarkVelocityTracker, lsq3, VelocityTracker::Strategy::LSQ3);
+BENCHMARK_CAPTURE(benchmarkVelocityTracker, wlsq2_delta, VelocityTracker::Strategy::WLSQ2_DELTA);
+BENCHMARK_CAPTURE(benchmarkVelocityTracker, impulse, VelocityTracker::Strategy::IMPULSE);
+BENCHMARK_CAPTURE(benchmarkVelocityTracker, legacy, VelocityTracker::Strategy::LEGACY);
+
+} // namespace android
@@ -20,6 +20,7 @@
 
 #include "Connection.h"
 #include "DebugConfig.h"
+#include "EntryPool.h"
 
 #include <android-base/stringprintf.h>
 #include <cutils/atomic.h>
@@ -176,6 +177,33 @@ std::string TouchModeEntry::getDescription() const {
 
 // --- MotionEntry ---
 
+namespace {
+
+// The pools are never destroyed, as entries may still be released while the process exits.
+EntryPool& motionEntryPool() {
+    static EntryPool* const pool = new EntryPool(sizeof(MotionEntry));
+    return *pool;
+}
+
+EntryPool& dispatchEntryPool() {
+    static EntryPool* const pool = new EntryPool(sizeof(DispatchEntry));
+    return *pool;
+}
+
+} // namespace
+
+void* MotionEntry::operator new(size_t size) {
+    return motionEntryPool().allocate(size);
+}
+
+void MotionEntry::operator delete(void* entry, size_t size) {
+    motionEntryPool().deallocate(entry, size);
+}
+
+std::string MotionEntry::dumpPool() {
+    return motionEntryPool().dump();
+}
+
 MotionEntry::MotionEntry(int32_t id, std::shared_ptr<InjectionState> injectionState,
                          nsecs_t eventTime, int32_t deviceId, uint32_t source,
                          ui::LogicalDisplayId displayId, uint32_t policyFlags, int32_t action,
@@ -278,6 +306,18 @@ std::string SensorEntry::getDescription() const {
 
 volatile int32_t DispatchEntry::sNextSeqAtomic;
 
+void* DispatchEntry::operator new(size_t size) {
+    return dispatchEntryPool().allocate(size);
+}
+
+void DispatchEntry::operator delete(void* entry, size_t size) {
+    dispatchEntryPool().deallocate(entry, size);
+}
+
+std::string DispatchEntry::dumpPool() {
+    return dispatchEntryPool().dump();
+}
+
 DispatchEntry::DispatchEntry(std::shared_ptr<const EventEntry> eventEntry,
                              ftl::Flags<InputTargetFlags> targetFlags,
                              const ui::Transform& transform, const ui::Transform& rawTransform,
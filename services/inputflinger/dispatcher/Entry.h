@@ -177,6 +177,11 @@ struct MotionEntry : EventEntry {
                 const std::vector<PointerProperties>& pointerProperties,
                 const std::vector<PointerCoords>& pointerCoords);
     std::string getDescription() const override;
+
+    // Allocated from an EntryPool, as there is at least one for every motion event.
+    static void* operator new(size_t size);
+    static void operator delete(void* entry, size_t size);
+    static std::string dumpPool();
 };
 
 std::ostream& operator<<(std::ostream& out, const MotionEntry& motionEntry);
@@ -245,6 +250,11 @@ struct DispatchEntry {
 
     inline bool isSplit() const { return targetFlags.test(InputTargetFlags::SPLIT); }
 
+    // Allocated from an EntryPool, as there is one for every target of every event.
+    static void* operator new(size_t size);
+    static void operator delete(void* entry, size_t size);
+    static std::string dumpPool();
+
 private:
     static volatile int32_t sNextSeqAtomic;
 
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EntryPool.h"
+
+#include <android-base/stringprintf.h>
+
+#include <inttypes.h>
+#include <new>
+
+namespace android::inputdispatcher {
+
+EntryPool::~EntryPool() {
+    for (void* block : mFreeBlocks) {
+        ::operator delete(block);
+    }
+}
+
+void* EntryPool::allocate(std::size_t size) {
+    if (size == mBlockSize) {
+        std::scoped_lock lock(mLock);
+        mAllocations++;
+        if (!mFreeBlocks.empty()) {
+            void* block = mFreeBlocks.back();
+            mFreeBlocks.pop_back();
+            mReuses++;
+            return block;
+        }
+    }
+    return ::operator new(size);
+}
+
+void EntryPool::deallocate(void* block, std::size_t size) {
+    if (size == mBlockSize) {
+        std::scoped_lock lock(mLock);
+        if (mFreeBlocks.size() < kMaxFreeBlocks) {
+            if (mFreeBlocks.capacity() == 0) {
+                mFreeBlocks.reserve(kMaxFreeBlocks);
+            }
+            mFreeBlocks.push_back(block);
+            return;
+        }
+    }
+    ::operator delete(block);
+}
+
+std::string EntryPool::dump() const {
+    std::scoped_lock lock(mLock);
+    return base::StringPrintf("%" PRIu64 " allocations, %" PRIu64 " reused, %zu free",
+                              mAllocations, mReuses, mFreeBlocks.size());
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace android::inputdispatcher {
+
+/**
+ * Keeps the memory of released entries of one type, so that the entries the dispatcher creates
+ * for every event reuse it rather than going through malloc.
+ *
+ * Entries are created and released on the reader, binder and dispatcher threads, so the pool is
+ * locked. At most kMaxFreeBlocks blocks are kept, which is more than the entries in flight at the
+ * touch rates of a device, so that a burst of events does not hold on to memory after it ends.
+ */
+class EntryPool {
+public:
+    explicit EntryPool(std::size_t blockSize) : mBlockSize(blockSize) {}
+    ~EntryPool();
+
+    // Requests for other sizes, such as those of a derived type, go to operator new.
+    void* allocate(std::size_t size);
+    void deallocate(void* block, std::size_t size);
+
+    std::string dump() const;
+
+    static constexpr std::size_t kMaxFreeBlocks = 64;
+
+private:
+    const std::size_t mBlockSize;
+    mutable std::mutex mLock;
+    std::vector<void*> mFreeBlocks GUARDED_BY(mLock);
+    uint64_t mAllocations GUARDED_BY(mLock) = 0;
+    uint64_t mReuses GUARDED_BY(mLock) = 0;
+};
+
+} // namespace android::inputdispatcher
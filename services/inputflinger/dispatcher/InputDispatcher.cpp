@@ -162,6 +162,12 @@ constexpr int LOGTAG_INPUT_CANCEL = 62003;
 
 const ui::Transform kIdentityTransform;
 
+// The number of messages, a power of two, that each shared memory ring of a window's input channel
+// holds, or 0 for the messages to go through the socket. Rings save the system call per message
+// on both ends, which adds up for windows that get high-rate input.
+const uint32_t INPUT_CHANNEL_RING_CAPACITY =
+        android::base::GetUintProperty<uint32_t>("ro.input.channel_ring_capacity", 0);
+
 inline nsecs_t now() {
     return systemTime(SYSTEM_TIME_MONOTONIC);
 }
@@ -924,6 +930,21 @@ Error<EnumErrorWrapper<InputEventInjectionResult>> injectionError(InputEventInje
             std::forward<InputEventInjectionResult>(e));
 }
 
+bool isSameDisplayInfo(const std::unordered_map<ui::LogicalDisplayId, DisplayInfo>& oldInfos,
+                       const std::unordered_map<ui::LogicalDisplayId, DisplayInfo>& newInfos,
+                       ui::LogicalDisplayId displayId) {
+    const auto oldIt = oldInfos.find(displayId);
+    const auto newIt = newInfos.find(displayId);
+    if (oldIt == oldInfos.end() || newIt == newInfos.end()) {
+        return oldIt == oldInfos.end() && newIt == newInfos.end();
+    }
+    const DisplayInfo& oldInfo = oldIt->second;
+    const DisplayInfo& newInfo = newIt->second;
+    return oldInfo.logicalWidth == newInfo.logicalWidth &&
+            oldInfo.logicalHeight == newInfo.logicalHeight &&
+            oldInfo.transform == newInfo.transform;
+}
+
 } // namespace
 
 // --- InputDispatcher ---
@@ -948,7 +969,8 @@ InputDispatcher::InputDispatcher(InputDispatcherPolicyInterface& policy,
         mWindowTokenWithPointerCapture(nullptr),
         mAwaitedApplicationDisplayId(ui::LogicalDisplayId::INVALID),
         mLatencyAggregator(),
-        mLatencyTracker(&mLatencyAggregator) {
+        mLatencyTimelineProcessor(mLatencyAggregator),
+        mLatencyTracker(&mLatencyTimelineProcessor) {
     mLooper = sp<Looper>::make(false);
     mReporter = createInputReporter();
 
@@ -1022,7 +1044,7 @@ void InputDispatcher::dispatchOnce() {
 
         // We are about to enter an infinitely long sleep, because we have no commands or
         // pending or queued events
-        if (nextWakeupTime == LLONG_MAX) {
+        if (nextWakeupTime == LLONG_MAX && mStagedInboundEvents.empty()) {
             mDispatcherEnteredIdle.notify_all();
         }
     } // release lock
@@ -1113,6 +1135,9 @@ std::chrono::nanoseconds InputDispatcher::getDispatchingTimeoutLocked(
 }
 
 void InputDispatcher::dispatchOnceInnerLocked(nsecs_t& nextWakeupTime) {
+    // The dispatch below handles what enqueuing would wake the dispatcher for.
+    enqueueStagedInboundEventsLocked();
+
     nsecs_t currentTime = now();
 
     // Reset the key repeat timer whenever normal dispatch is suspended while the
@@ -1341,7 +1366,76 @@ bool InputDispatcher::shouldPruneInboundQueueLocked(const MotionEntry& motionEnt
     return false;
 }
 
+void InputDispatcher::stageInboundEvent(StagedInboundEvent&& event) {
+    // Otherwise the dispatcher has yet to run for the event that made the queue non-empty.
+    if (mStagedInboundEvents.push(std::move(event))) {
+        mLooper->wake();
+    }
+}
+
 bool InputDispatcher::enqueueInboundEventLocked(std::unique_ptr<EventEntry> newEntry) {
+    bool needWake = enqueueStagedInboundEventsLocked();
+    needWake |= addInboundEventLocked(std::move(newEntry));
+    return needWake;
+}
+
+bool InputDispatcher::enqueueStagedInboundEventsLocked() {
+    bool needWake = false;
+    for (StagedInboundEvent& staged : mStagedInboundEvents.popAll()) {
+        EventEntry& entry = *staged.entry;
+        switch (entry.type) {
+            case EventEntry::Type::KEY: {
+                if (mInputFilterEnabled && !(entry.policyFlags & POLICY_FLAG_FILTERED)) {
+                    // Staged before the input filter was enabled, which dropped every event
+                    // before it.
+                    continue;
+                }
+                if (input_flags::keyboard_repeat_keys() && !mConfig.keyRepeatEnabled) {
+                    entry.policyFlags |= POLICY_FLAG_DISABLE_KEY_REPEAT;
+                }
+                auto& keyEntry = static_cast<KeyEntry&>(entry);
+                if (mTracer) {
+                    keyEntry.traceTracker = mTracer->traceInboundEvent(keyEntry);
+                }
+                break;
+            }
+            case EventEntry::Type::MOTION: {
+                if (mInputFilterEnabled && !(entry.policyFlags & POLICY_FLAG_FILTERED)) {
+                    continue;
+                }
+                auto& motionEntry = static_cast<MotionEntry&>(entry);
+                if (!(motionEntry.policyFlags & POLICY_FLAG_PASS_TO_USER)) {
+                    // Set the flag anyway if we already have an ongoing gesture. That would
+                    // allow us to complete the processing of the current stroke.
+                    const auto touchStateIt = mTouchStatesByDisplay.find(motionEntry.displayId);
+                    if (touchStateIt != mTouchStatesByDisplay.end()) {
+                        const TouchState& touchState = touchStateIt->second;
+                        if (touchState.hasTouchingPointers(motionEntry.deviceId) ||
+                            touchState.hasHoveringPointers(motionEntry.deviceId)) {
+                            motionEntry.policyFlags |= POLICY_FLAG_PASS_TO_USER;
+                        }
+                    }
+                }
+                if (mTracer) {
+                    motionEntry.traceTracker = mTracer->traceInboundEvent(motionEntry);
+                }
+                if (staged.latencySources) {
+                    mLatencyTracker.trackListener(motionEntry.id, motionEntry.eventTime,
+                                                  staged.readTime, motionEntry.deviceId,
+                                                  *staged.latencySources, motionEntry.action,
+                                                  InputEventType::MOTION);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        needWake |= addInboundEventLocked(std::move(staged.entry));
+    }
+    return needWake;
+}
+
+bool InputDispatcher::addInboundEventLocked(std::unique_ptr<EventEntry> newEntry) {
     bool needWake = mInboundQueue.empty();
     mInboundQueue.push_back(std::move(newEntry));
     const EventEntry& entry = *(mInboundQueue.back());
@@ -1433,15 +1527,15 @@ sp<WindowInfoHandle> InputDispatcher::findTouchedWindowAtLocked(ui::LogicalDispl
                                                                 float x, float y, bool isStylus,
                                                                 bool ignoreDragWindow) const {
     // Traverse windows from front to back to find touched window.
-    const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+    const ui::Transform displayTransform = getTransformLocked(displayId);
+    for (const sp<WindowInfoHandle>& windowHandle : getTouchCandidatesLocked(displayId, x, y)) {
         if (ignoreDragWindow && haveSameToken(windowHandle, mDragState->dragWindow)) {
             continue;
         }
 
         const WindowInfo& info = *windowHandle->getInfo();
         if (!info.isSpy() &&
-            windowAcceptsTouchAt(info, displayId, x, y, isStylus, getTransformLocked(displayId))) {
+            windowAcceptsTouchAt(info, displayId, x, y, isStylus, displayTransform)) {
             return windowHandle;
         }
     }
@@ -1480,10 +1574,10 @@ std::vector<sp<WindowInfoHandle>> InputDispatcher::findTouchedSpyWindowsAtLocked
         ui::LogicalDisplayId displayId, float x, float y, bool isStylus, DeviceId deviceId) const {
     // Traverse windows from front to back and gather the touched spy windows.
     std::vector<sp<WindowInfoHandle>> spyWindows;
-    const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+    const ui::Transform displayTransform = getTransformLocked(displayId);
+    for (const sp<WindowInfoHandle>& windowHandle : getTouchCandidatesLocked(displayId, x, y)) {
         const WindowInfo& info = *windowHandle->getInfo();
-        if (!windowAcceptsTouchAt(info, displayId, x, y, isStylus, getTransformLocked(displayId))) {
+        if (!windowAcceptsTouchAt(info, displayId, x, y, isStylus, displayTransform)) {
             // Generally, we would skip any pointer that's outside of the window. However, if the
             // spy prevents splitting, and already has some of the pointers from this device, then
             // it should get more pointers from the same device, even if they are outside of that
@@ -1610,6 +1704,7 @@ void InputDispatcher::postCommandLocked(Command&& command) {
 }
 
 void InputDispatcher::drainInboundQueueLocked() {
+    enqueueStagedInboundEventsLocked();
     while (!mInboundQueue.empty()) {
         std::shared_ptr<const EventEntry> entry = mInboundQueue.front();
         mInboundQueue.pop_front();
@@ -2004,6 +2099,7 @@ bool InputDispatcher::flushSensor(int deviceId, InputDeviceSensorType sensorType
     { // acquire lock
         std::scoped_lock _l(mLock);
 
+        enqueueStagedInboundEventsLocked();
         for (auto it = mInboundQueue.begin(); it != mInboundQueue.end(); it++) {
             std::shared_ptr<const EventEntry> entry = *it;
             if (entry->type == EventEntry::Type::SENSOR) {
@@ -3793,14 +3889,20 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
         ALOGD("channel '%s' ~ startDispatchCycle", connection->getInputChannelName().c_str());
     }
 
-    while (connection->status == Connection::Status::NORMAL && !connection->outboundQueue.empty()) {
-        std::unique_ptr<DispatchEntry>& dispatchEntry = connection->outboundQueue.front();
+    if (connection->status != Connection::Status::NORMAL) {
+        return;
+    }
+
+    // Publish everything that is queued as one batch, so that the events are written to the
+    // channel with a single system call rather than one each.
+    connection->inputPublisher.beginBatch();
+    status_t status = OK;
+    for (const std::unique_ptr<DispatchEntry>& dispatchEntry : connection->outboundQueue) {
         dispatchEntry->deliveryTime = currentTime;
         const std::chrono::nanoseconds timeout = getDispatchingTimeoutLocked(connection);
         dispatchEntry->timeoutTime = currentTime + timeout.count();
 
         // Publish the event.
-        status_t status;
         const EventEntry& eventEntry = *(dispatchEntry->eventEntry);
         switch (eventEntry.type) {
             case EventEntry::Type::KEY: {
@@ -3889,47 +3991,65 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
                 return;
             }
         }
-
-        // Check the result.
-        if (status) {
-            if (status == WOULD_BLOCK) {
-                if (connection->waitQueue.empty()) {
-                    ALOGE("channel '%s' ~ Could not publish event because the pipe is full. "
-                          "This is unexpected because the wait queue is empty, so the pipe "
-                          "should be empty and we shouldn't have any problems writing an "
-                          "event to it, status=%s(%d)",
-                          connection->getInputChannelName().c_str(), statusToString(status).c_str(),
-                          status);
-                    abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
-                } else {
-                    // Pipe is full and we are waiting for the app to finish process some events
-                    // before sending more events to it.
-                    if (DEBUG_DISPATCH_CYCLE) {
-                        ALOGD("channel '%s' ~ Could not publish event because the pipe is full, "
-                              "waiting for the application to catch up",
-                              connection->getInputChannelName().c_str());
-                    }
-                }
-            } else {
-                ALOGE("channel '%s' ~ Could not publish event due to an unexpected error, "
-                      "status=%s(%d)",
-                      connection->getInputChannelName().c_str(), statusToString(status).c_str(),
-                      status);
-                abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
-            }
-            return;
+        if (status != OK) {
+            break;
         }
+    }
 
-        // Re-enqueue the event on the wait queue.
+    // Whatever was sent goes on the wait queue, even if the rest of the batch could not be sent.
+    size_t sentCount = 0;
+    const status_t sendStatus = connection->inputPublisher.sendBatch(sentCount);
+    for (size_t i = 0; i < sentCount; i++) {
+        std::unique_ptr<DispatchEntry>& dispatchEntry = connection->outboundQueue.front();
         const nsecs_t timeoutTime = dispatchEntry->timeoutTime;
         connection->waitQueue.emplace_back(std::move(dispatchEntry));
         connection->outboundQueue.erase(connection->outboundQueue.begin());
-        traceOutboundQueueLength(*connection);
         if (connection->responsive) {
             mAnrTracker.insert(timeoutTime, connection->getToken());
         }
+    }
+    if (sentCount > 0) {
+        traceOutboundQueueLength(*connection);
         traceWaitQueueLength(*connection);
     }
+    if (status == OK) {
+        status = sendStatus;
+        if (status == BAD_VALUE) {
+            // The verifier rejected one of the motion events that were sent.
+            logDispatchStateLocked();
+            LOG(FATAL) << "Publisher failed for a motion event sent to "
+                       << connection->getInputChannelName();
+        }
+    }
+
+    // Check the result.
+    if (status) {
+        if (status == WOULD_BLOCK) {
+            if (connection->waitQueue.empty()) {
+                ALOGE("channel '%s' ~ Could not publish event because the pipe is full. "
+                      "This is unexpected because the wait queue is empty, so the pipe "
+                      "should be empty and we shouldn't have any problems writing an "
+                      "event to it, status=%s(%d)",
+                      connection->getInputChannelName().c_str(), statusToString(status).c_str(),
+                      status);
+                abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
+            } else {
+                // Pipe is full and we are waiting for the app to finish process some events
+                // before sending more events to it.
+                if (DEBUG_DISPATCH_CYCLE) {
+                    ALOGD("channel '%s' ~ Could not publish event because the pipe is full, "
+                          "waiting for the application to catch up",
+                          connection->getInputChannelName().c_str());
+                }
+            }
+        } else {
+            ALOGE("channel '%s' ~ Could not publish event due to an unexpected error, "
+                  "status=%s(%d)",
+                  connection->getInputChannelName().c_str(), statusToString(status).c_str(),
+                  status);
+            abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
+        }
+    }
 }
 
 std::array<uint8_t, 32> InputDispatcher::sign(const VerifiedInputEvent& event) const {
@@ -4494,41 +4614,32 @@ void InputDispatcher::notifyKey(const NotifyKeyArgs& args) {
               std::to_string(t.duration().count()).c_str());
     }
 
-    bool needWake = false;
-    { // acquire lock
-        mLock.lock();
-
-        if (input_flags::keyboard_repeat_keys() && !mConfig.keyRepeatEnabled) {
-            policyFlags |= POLICY_FLAG_DISABLE_KEY_REPEAT;
-        }
-
-        if (shouldSendKeyToInputFilterLocked(args)) {
-            mLock.unlock();
+    // Only the input filter needs the dispatcher state here, and it is rarely enabled. The rest
+    // of the policy flags are set when the event is moved to the inbound queue.
+    if (mInputFilterEnabled) {
+        bool filter;
+        { // acquire lock
+            std::scoped_lock _l(mLock);
+            filter = shouldSendKeyToInputFilterLocked(args);
+            if (filter && input_flags::keyboard_repeat_keys() && !mConfig.keyRepeatEnabled) {
+                policyFlags |= POLICY_FLAG_DISABLE_KEY_REPEAT;
+            }
+        } // release lock
 
+        if (filter) {
             policyFlags |= POLICY_FLAG_FILTERED;
             if (!mPolicy.filterInputEvent(event, policyFlags)) {
                 return; // event was consumed by the filter
             }
-
-            mLock.lock();
         }
-
-        std::unique_ptr<KeyEntry> newEntry =
-                std::make_unique<KeyEntry>(args.id, /*injectionState=*/nullptr, args.eventTime,
-                                           args.deviceId, args.source, args.displayId, policyFlags,
-                                           args.action, flags, keyCode, args.scanCode, metaState,
-                                           repeatCount, args.downTime);
-        if (mTracer) {
-            newEntry->traceTracker = mTracer->traceInboundEvent(*newEntry);
-        }
-
-        needWake = enqueueInboundEventLocked(std::move(newEntry));
-        mLock.unlock();
-    } // release lock
-
-    if (needWake) {
-        mLooper->wake();
     }
+
+    stageInboundEvent(
+            {.entry = std::make_unique<KeyEntry>(args.id, /*injectionState=*/nullptr,
+                                                 args.eventTime, args.deviceId, args.source,
+                                                 args.displayId, policyFlags, args.action, flags,
+                                                 keyCode, args.scanCode, metaState, repeatCount,
+                                                 args.downTime)});
 }
 
 bool InputDispatcher::shouldSendKeyToInputFilterLocked(const NotifyKeyArgs& args) {
@@ -4596,36 +4707,26 @@ void InputDispatcher::notifyMotion(const NotifyMotionArgs& args) {
               std::to_string(t.duration().count()).c_str());
     }
 
-    bool needWake = false;
-    { // acquire lock
-        mLock.lock();
-        if (!(policyFlags & POLICY_FLAG_PASS_TO_USER)) {
-            // Set the flag anyway if we already have an ongoing gesture. That would allow us to
-            // complete the processing of the current stroke.
-            const auto touchStateIt = mTouchStatesByDisplay.find(args.displayId);
-            if (touchStateIt != mTouchStatesByDisplay.end()) {
-                const TouchState& touchState = touchStateIt->second;
-                if (touchState.hasTouchingPointers(args.deviceId) ||
-                    touchState.hasHoveringPointers(args.deviceId)) {
-                    policyFlags |= POLICY_FLAG_PASS_TO_USER;
+    if (mInputFilterEnabled) {
+        std::optional<ui::Transform> displayTransform;
+        { // acquire lock
+            std::scoped_lock _l(mLock);
+            if (shouldSendMotionToInputFilterLocked(args)) {
+                displayTransform.emplace();
+                if (const auto it = mDisplayInfos.find(args.displayId);
+                    it != mDisplayInfos.end()) {
+                    displayTransform = it->second.transform;
                 }
             }
-        }
-
-        if (shouldSendMotionToInputFilterLocked(args)) {
-            ui::Transform displayTransform;
-            if (const auto it = mDisplayInfos.find(args.displayId); it != mDisplayInfos.end()) {
-                displayTransform = it->second.transform;
-            }
-
-            mLock.unlock();
+        } // release lock
 
+        if (displayTransform) {
             MotionEvent event;
             event.initialize(args.id, args.deviceId, args.source, args.displayId, INVALID_HMAC,
                              args.action, args.actionButton, args.flags, args.edgeFlags,
                              args.metaState, args.buttonState, args.classification,
-                             displayTransform, args.xPrecision, args.yPrecision,
-                             args.xCursorPosition, args.yCursorPosition, displayTransform,
+                             *displayTransform, args.xPrecision, args.yPrecision,
+                             args.xCursorPosition, args.yCursorPosition, *displayTransform,
                              args.downTime, args.eventTime, args.getPointerCount(),
                              args.pointerProperties.data(), args.pointerCoords.data());
 
@@ -4633,39 +4734,28 @@ void InputDispatcher::notifyMotion(const NotifyMotionArgs& args) {
             if (!mPolicy.filterInputEvent(event, policyFlags)) {
                 return; // event was consumed by the filter
             }
-
-            mLock.lock();
-        }
-
-        // Just enqueue a new motion event.
-        std::unique_ptr<MotionEntry> newEntry =
-                std::make_unique<MotionEntry>(args.id, /*injectionState=*/nullptr, args.eventTime,
-                                              args.deviceId, args.source, args.displayId,
-                                              policyFlags, args.action, args.actionButton,
-                                              args.flags, args.metaState, args.buttonState,
-                                              args.classification, args.edgeFlags, args.xPrecision,
-                                              args.yPrecision, args.xCursorPosition,
-                                              args.yCursorPosition, args.downTime,
-                                              args.pointerProperties, args.pointerCoords);
-        if (mTracer) {
-            newEntry->traceTracker = mTracer->traceInboundEvent(*newEntry);
-        }
-
-        if (args.id != android::os::IInputConstants::INVALID_INPUT_EVENT_ID &&
-            IdGenerator::getSource(args.id) == IdGenerator::Source::INPUT_READER &&
-            !mInputFilterEnabled) {
-            std::set<InputDeviceUsageSource> sources = getUsageSourcesForMotionArgs(args);
-            mLatencyTracker.trackListener(args.id, args.eventTime, args.readTime, args.deviceId,
-                                          sources, args.action, InputEventType::MOTION);
         }
+    }
 
-        needWake = enqueueInboundEventLocked(std::move(newEntry));
-        mLock.unlock();
-    } // release lock
-
-    if (needWake) {
-        mLooper->wake();
+    // Just enqueue a new motion event.
+    StagedInboundEvent staged{
+            .entry = std::make_unique<MotionEntry>(args.id, /*injectionState=*/nullptr,
+                                                   args.eventTime, args.deviceId, args.source,
+                                                   args.displayId, policyFlags, args.action,
+                                                   args.actionButton, args.flags, args.metaState,
+                                                   args.buttonState, args.classification,
+                                                   args.edgeFlags, args.xPrecision,
+                                                   args.yPrecision, args.xCursorPosition,
+                                                   args.yCursorPosition, args.downTime,
+                                                   args.pointerProperties, args.pointerCoords),
+            .readTime = args.readTime,
+    };
+    if (args.id != android::os::IInputConstants::INVALID_INPUT_EVENT_ID &&
+        IdGenerator::getSource(args.id) == IdGenerator::Source::INPUT_READER &&
+        !(policyFlags & POLICY_FLAG_FILTERED)) {
+        staged.latencySources = getUsageSourcesForMotionArgs(args);
     }
+    stageInboundEvent(std::move(staged));
 }
 
 void InputDispatcher::notifySensor(const NotifySensorArgs& args) {
@@ -4676,23 +4766,13 @@ void InputDispatcher::notifySensor(const NotifySensorArgs& args) {
               ftl::enum_string(args.sensorType).c_str());
     }
 
-    bool needWake = false;
-    { // acquire lock
-        mLock.lock();
-
-        // Just enqueue a new sensor event.
-        std::unique_ptr<SensorEntry> newEntry =
-                std::make_unique<SensorEntry>(args.id, args.eventTime, args.deviceId, args.source,
-                                              /* policyFlags=*/0, args.hwTimestamp, args.sensorType,
-                                              args.accuracy, args.accuracyChanged, args.values);
-
-        needWake = enqueueInboundEventLocked(std::move(newEntry));
-        mLock.unlock();
-    } // release lock
-
-    if (needWake) {
-        mLooper->wake();
-    }
+    // Just enqueue a new sensor event.
+    stageInboundEvent(
+            {.entry = std::make_unique<SensorEntry>(args.id, args.eventTime, args.deviceId,
+                                                    args.source, /* policyFlags=*/0,
+                                                    args.hwTimestamp, args.sensorType,
+                                                    args.accuracy, args.accuracyChanged,
+                                                    args.values)});
 }
 
 void InputDispatcher::notifyVibratorState(const NotifyVibratorStateArgs& args) {
@@ -5153,6 +5233,16 @@ const std::vector<sp<WindowInfoHandle>>& InputDispatcher::getWindowHandlesLocked
     return it != mWindowHandlesByDisplay.end() ? it->second : EMPTY_WINDOW_HANDLES;
 }
 
+std::vector<sp<WindowInfoHandle>> InputDispatcher::getTouchCandidatesLocked(
+        ui::LogicalDisplayId displayId, float x, float y) const {
+    const auto it = mHitTestIndexByDisplay.find(displayId);
+    if (it != mHitTestIndexByDisplay.end() &&
+        it->second.getDisplayTransform() == getTransformLocked(displayId)) {
+        return it->second.getCandidatesAt(x, y);
+    }
+    return getWindowHandlesLocked(displayId);
+}
+
 sp<WindowInfoHandle> InputDispatcher::getWindowHandleLocked(
         const sp<IBinder>& windowHandleToken, std::optional<ui::LogicalDisplayId> displayId) const {
     if (windowHandleToken == nullptr) {
@@ -5279,6 +5369,7 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     if (windowInfoHandles.empty()) {
         // Remove all handles on a display if there are no windows left.
         mWindowHandlesByDisplay.erase(displayId);
+        mHitTestIndexByDisplay.erase(displayId);
         return;
     }
 
@@ -5324,6 +5415,9 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     }
 
     // Insert or replace
+    const ui::Transform displayTransform = getTransformLocked(displayId);
+    mHitTestIndexByDisplay.insert_or_assign(displayId,
+                                            WindowHitTestIndex(newHandles, displayTransform));
     mWindowHandlesByDisplay[displayId] = newHandles;
 }
 
@@ -5978,6 +6072,10 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) const {
             } else {
                 dump += INDENT2 "No DisplayInfo found!\n";
             }
+            if (const auto it = mHitTestIndexByDisplay.find(displayId);
+                it != mHitTestIndexByDisplay.end()) {
+                dump += INDENT2 "HitTestIndex: " + it->second.dump() + "\n";
+            }
 
             if (!windowHandles.empty()) {
                 dump += INDENT2 "Windows:\n";
@@ -6039,6 +6137,9 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) const {
     } else {
         dump += INDENT "InboundQueue: <empty>\n";
     }
+    if (!mStagedInboundEvents.empty()) {
+        dump += INDENT "StagedInboundEvents: not yet enqueued\n";
+    }
 
     if (!mCommandQueue.empty()) {
         dump += StringPrintf(INDENT "CommandQueue: size=%zu\n", mCommandQueue.size());
@@ -6092,7 +6193,11 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) const {
     dump += StringPrintf(INDENT2 "KeyRepeatTimeout: %" PRId64 "ms\n",
                          ns2ms(mConfig.keyRepeatTimeout));
     dump += mLatencyTracker.dump(INDENT2);
+    dump += mLatencyTimelineProcessor.dump(INDENT2);
     dump += mLatencyAggregator.dump(INDENT2);
+    dump += INDENT "EntryPools:\n";
+    dump += INDENT2 "MotionEntry: " + MotionEntry::dumpPool() + "\n";
+    dump += INDENT2 "DispatchEntry: " + DispatchEntry::dumpPool() + "\n";
     dump += INDENT "InputTracer: ";
     dump += mTracer == nullptr ? "Disabled" : "Enabled";
 }
@@ -6123,7 +6228,10 @@ Result<std::unique_ptr<InputChannel>> InputDispatcher::createInputChannel(const
 
     std::unique_ptr<InputChannel> serverChannel;
     std::unique_ptr<InputChannel> clientChannel;
-    status_t result = InputChannel::openInputChannelPair(name, serverChannel, clientChannel);
+    status_t result = INPUT_CHANNEL_RING_CAPACITY > 0
+            ? InputChannel::openInputChannelPair(name, INPUT_CHANNEL_RING_CAPACITY, serverChannel,
+                                                 clientChannel)
+            : InputChannel::openInputChannelPair(name, serverChannel, clientChannel);
 
     if (result) {
         return base::Error(result) << "Failed to open input channel pair with name " << name;
@@ -7077,12 +7185,20 @@ void InputDispatcher::onWindowInfosChanged(const gui::WindowInfosUpdate& update)
             handlesPerDisplay[displayId];
         }
 
+        const std::unordered_map<ui::LogicalDisplayId, gui::DisplayInfo> oldDisplayInfos =
+                std::move(mDisplayInfos);
         mDisplayInfos.clear();
         for (const auto& displayInfo : update.displayInfos) {
             mDisplayInfos.emplace(displayInfo.displayId, displayInfo);
         }
 
         for (const auto& [displayId, handles] : handlesPerDisplay) {
+            // Most updates only touch a few windows. Leave displays whose windows and geometry
+            // are unchanged alone instead of re-running focus and touch state updates for them.
+            if (isSameDisplayInfo(oldDisplayInfos, mDisplayInfos, displayId) &&
+                hasSameWindowsLocked(handles, displayId)) {
+                continue;
+            }
             setInputWindowsLocked(handles, displayId);
         }
 
@@ -7097,6 +7213,20 @@ void InputDispatcher::onWindowInfosChanged(const gui::WindowInfosUpdate& update)
     mLooper->wake();
 }
 
+bool InputDispatcher::hasSameWindowsLocked(const std::vector<sp<WindowInfoHandle>>& windowHandles,
+                                           ui::LogicalDisplayId displayId) const {
+    const std::vector<sp<WindowInfoHandle>>& oldWindowHandles = getWindowHandlesLocked(displayId);
+    if (oldWindowHandles.size() != windowHandles.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < windowHandles.size(); i++) {
+        if (!oldWindowHandles[i]->getInfo()->hasSameContent(*windowHandles[i]->getInfo())) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool InputDispatcher::shouldDropInput(
         const EventEntry& entry, const sp<android::gui::WindowInfoHandle>& windowHandle) const {
     if (windowHandle->getInfo()->inputConfig.test(WindowInfo::InputConfig::DROP_INPUT) ||
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "../MpscQueue.h"
+
 #include "AnrTracker.h"
 #include "CancelationOptions.h"
 #include "DragState.h"
@@ -30,8 +32,10 @@
 #include "LatencyAggregator.h"
 #include "LatencyTracker.h"
 #include "Monitor.h"
+#include "ThreadedTimelineProcessor.h"
 #include "TouchState.h"
 #include "TouchedWindow.h"
+#include "WindowHitTestIndex.h"
 #include "trace/InputTracerInterface.h"
 #include "trace/InputTracingBackendInterface.h"
 
@@ -48,10 +52,12 @@
 #include <utils/Looper.h>
 #include <utils/Timers.h>
 #include <utils/threads.h>
+#include <atomic>
 #include <bitset>
 #include <condition_variable>
 #include <deque>
 #include <optional>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -188,6 +194,19 @@ private:
 
     std::shared_ptr<const EventEntry> mPendingEvent GUARDED_BY(mLock);
     std::deque<std::shared_ptr<const EventEntry>> mInboundQueue GUARDED_BY(mLock);
+
+    // An event from notifyKey, notifyMotion or notifySensor, on its way to mInboundQueue. These
+    // are staged without mLock, so that the reader does not wait for dispatching. The parts of
+    // enqueuing that need the dispatcher state happen when the events are moved to the queue.
+    struct StagedInboundEvent {
+        std::unique_ptr<EventEntry> entry;
+        // Set for motion events from the reader whose latency is tracked.
+        std::optional<std::set<InputDeviceUsageSource>> latencySources;
+        nsecs_t readTime = 0;
+    };
+    MpscQueue<StagedInboundEvent> mStagedInboundEvents;
+    // Stages an inbound event, and wakes the dispatcher if it may be waiting for one.
+    void stageInboundEvent(StagedInboundEvent&& event);
     std::deque<std::shared_ptr<const EventEntry>> mRecentQueue GUARDED_BY(mLock);
 
     // A command entry captures state and behavior for an action to be performed in the
@@ -228,8 +247,14 @@ private:
 
     void dispatchOnceInnerLocked(nsecs_t& nextWakeupTime) REQUIRES(mLock);
 
-    // Enqueues an inbound event.  Returns true if mLooper->wake() should be called.
+    // Enqueues an inbound event, after any staged ones.  Returns true if mLooper->wake() should
+    // be called.
     bool enqueueInboundEventLocked(std::unique_ptr<EventEntry> entry) REQUIRES(mLock);
+    // Moves the staged inbound events to the inbound queue.  Must happen before the queue is
+    // inspected, so that they are not overtaken by newer events.  Returns true if
+    // mLooper->wake() should be called.
+    bool enqueueStagedInboundEventsLocked() REQUIRES(mLock);
+    bool addInboundEventLocked(std::unique_ptr<EventEntry> entry) REQUIRES(mLock);
 
     // Cleans up input state when dropping an inbound event.
     void dropInboundEventLocked(const EventEntry& entry, DropReason dropReason) REQUIRES(mLock);
@@ -341,7 +366,8 @@ private:
     // Dispatch state.
     bool mDispatchEnabled GUARDED_BY(mLock);
     bool mDispatchFrozen GUARDED_BY(mLock);
-    bool mInputFilterEnabled GUARDED_BY(mLock);
+    // Written with mLock held, and read without it when staging inbound events.
+    std::atomic_bool mInputFilterEnabled;
     float mMaximumObscuringOpacityForTouch GUARDED_BY(mLock);
 
     // This map is not really needed, but it helps a lot with debugging (dumpsys input).
@@ -365,13 +391,25 @@ private:
             mWindowHandlesByDisplay GUARDED_BY(mLock);
     std::unordered_map<ui::LogicalDisplayId /*displayId*/, android::gui::DisplayInfo> mDisplayInfos
             GUARDED_BY(mLock);
+    // Rebuilt with the window handles of the display.
+    std::unordered_map<ui::LogicalDisplayId /*displayId*/, WindowHitTestIndex>
+            mHitTestIndexByDisplay GUARDED_BY(mLock);
     void setInputWindowsLocked(
             const std::vector<sp<android::gui::WindowInfoHandle>>& inputWindowHandles,
             ui::LogicalDisplayId displayId) REQUIRES(mLock);
+    // Returns true if the handles describe the same windows, in the same order, as the ones
+    // currently set for the display.
+    bool hasSameWindowsLocked(
+            const std::vector<sp<android::gui::WindowInfoHandle>>& windowHandles,
+            ui::LogicalDisplayId displayId) const REQUIRES(mLock);
     // Get a reference to window handles by display, return an empty vector if not found.
     const std::vector<sp<android::gui::WindowInfoHandle>>& getWindowHandlesLocked(
             ui::LogicalDisplayId displayId) const REQUIRES(mLock);
     ui::Transform getTransformLocked(ui::LogicalDisplayId displayId) const REQUIRES(mLock);
+    // Get the window handles, front to back, that might accept a touch at the location. The
+    // hit test still has to be run on each.
+    std::vector<sp<android::gui::WindowInfoHandle>> getTouchCandidatesLocked(
+            ui::LogicalDisplayId displayId, float x, float y) const REQUIRES(mLock);
 
     sp<android::gui::WindowInfoHandle> getWindowHandleLocked(
             const sp<IBinder>& windowHandleToken,
@@ -696,8 +734,10 @@ private:
     bool windowHasTouchingPointersLocked(const sp<android::gui::WindowInfoHandle>& windowHandle,
                                          DeviceId deviceId) const REQUIRES(mLock);
 
-    // Statistics gathering.
-    LatencyAggregator mLatencyAggregator GUARDED_BY(mLock);
+    // Statistics gathering. The timelines are aggregated on a separate thread, so that it does not
+    // add to the time spent holding mLock.
+    LatencyAggregator mLatencyAggregator;
+    ThreadedTimelineProcessor mLatencyTimelineProcessor;
     LatencyTracker mLatencyTracker GUARDED_BY(mLock);
     void traceInboundQueueLengthLocked() REQUIRES(mLock);
     void traceOutboundQueueLength(const Connection& connection);
@@ -121,12 +121,12 @@ AStatsManager_PullAtomCallbackReturn LatencyAggregator::pullAtomCallback(int32_t
 }
 
 void LatencyAggregator::processTimeline(const InputEventTimeline& timeline) {
+    std::scoped_lock lock(mLock);
     processStatistics(timeline);
     processSlowEvent(timeline);
 }
 
 void LatencyAggregator::processStatistics(const InputEventTimeline& timeline) {
-    std::scoped_lock lock(mLock);
     // Before we do any processing, check that we have not yet exceeded MAX_SIZE
     if (mNumSketchEventsProcessed >= MAX_EVENTS_FOR_STATISTICS) {
         return;
@@ -53,7 +53,7 @@ class LatencyAggregator final : public InputEventTimelineProcessor {
 public:
     LatencyAggregator();
     /**
-     * Record a complete event timeline
+     * Record a complete event timeline. This is thread-safe.
      */
     void processTimeline(const InputEventTimeline& timeline) override;
 
@@ -62,26 +62,28 @@ public:
     ~LatencyAggregator();
 
 private:
-    // Binder call -- called on a binder thread. This is different from the thread where the rest of
-    // the public API is called.
+    // Binder call -- called on a binder thread. This is different from the threads where the rest
+    // of the public API is called.
     static AStatsManager_PullAtomCallbackReturn pullAtomCallback(int32_t atom_tag,
                                                                  AStatsEventList* data,
                                                                  void* cookie);
     AStatsManager_PullAtomCallbackReturn pullData(AStatsEventList* data);
 
+    // The timelines are processed on a different thread from the one that dumps the state, and the
+    // statistics are pulled on a binder thread. The lock is needed to protect all of the data.
+    mutable std::mutex mLock;
+
     // ---------- Slow event handling ----------
-    void processSlowEvent(const InputEventTimeline& timeline);
-    nsecs_t mLastSlowEventTime = 0;
+    void processSlowEvent(const InputEventTimeline& timeline) REQUIRES(mLock);
+    nsecs_t mLastSlowEventTime GUARDED_BY(mLock) = 0;
     // How many slow events have been skipped due to rate limiting
-    size_t mNumSkippedSlowEvents = 0;
+    size_t mNumSkippedSlowEvents GUARDED_BY(mLock) = 0;
     // How many events have been received since the last time we reported a slow event
-    size_t mNumEventsSinceLastSlowEventReport = 0;
+    size_t mNumEventsSinceLastSlowEventReport GUARDED_BY(mLock) = 0;
 
     // ---------- Statistics handling ----------
-    // Statistics is pulled rather than pushed. It's pulled on a binder thread, and therefore will
-    // be accessed by two different threads. The lock is needed to protect the pulled data.
-    mutable std::mutex mLock;
-    void processStatistics(const InputEventTimeline& timeline);
+    // Statistics is pulled rather than pushed.
+    void processStatistics(const InputEventTimeline& timeline) REQUIRES(mLock);
     // Sketches
     std::array<std::unique_ptr<dist_proc::aggregation::KllQuantile>, SketchIndex::SIZE>
             mDownSketches GUARDED_BY(mLock);
@@ -19,6 +19,7 @@
 #include "../InputDeviceMetricsSource.h"
 
 #include <inttypes.h>
+#include <bit>
 
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
@@ -47,39 +48,89 @@ static bool isMatureEvent(nsecs_t eventTime, nsecs_t now) {
     return age > ANR_TIMEOUT;
 }
 
+static constexpr size_t INDEX_SIZE = 2 * LatencyTracker::MAX_TRACKED_EVENTS;
+static constexpr int32_t EMPTY_INDEX_ENTRY = -1;
+static_assert(std::has_single_bit(LatencyTracker::MAX_TRACKED_EVENTS));
+
 /**
- * A multimap allows to have several entries with the same key. This function just erases a specific
- * key-value pair. Equivalent to the imaginary std api std::multimap::erase(key, value).
+ * The position in the index at which the lookup for an inputEventId starts. Input event ids are
+ * random, but scramble them anyway, so that ids that differ in the high bits only do not collide.
  */
-template <typename K, typename V>
-static void eraseByValue(std::multimap<K, V>& map, const V& value) {
-    for (auto it = map.begin(); it != map.end();) {
-        if (it->second == value) {
-            it = map.erase(it);
-        } else {
-            it++;
-        }
-    }
+static size_t hashEventId(int32_t inputEventId) {
+    return (static_cast<uint32_t>(inputEventId) * 0x9E3779B1u >> 16) & (INDEX_SIZE - 1);
 }
 
 LatencyTracker::LatencyTracker(InputEventTimelineProcessor* processor)
-      : mTimelineProcessor(processor) {
+      : mEvents(MAX_TRACKED_EVENTS),
+        mIndex(INDEX_SIZE, EMPTY_INDEX_ENTRY),
+        mTimelineProcessor(processor) {
     LOG_ALWAYS_FATAL_IF(processor == nullptr);
 }
 
+/**
+ * Return the position of the index entry for inputEventId, or the position of the empty entry that
+ * ends its probe sequence if the event is not tracked.
+ */
+size_t LatencyTracker::findIndexPosition(int32_t inputEventId) const {
+    for (size_t position = hashEventId(inputEventId);; position = (position + 1) % INDEX_SIZE) {
+        const int32_t event = mIndex[position];
+        if (event == EMPTY_INDEX_ENTRY || mEvents[event].inputEventId == inputEventId) {
+            return position;
+        }
+    }
+}
+
+InputEventTimeline* LatencyTracker::findTimeline(int32_t inputEventId) {
+    const int32_t event = mIndex[findIndexPosition(inputEventId)];
+    return event == EMPTY_INDEX_ENTRY ? nullptr : &*mEvents[event].timeline;
+}
+
+/**
+ * Remove an entry from the index, and shift the entries that follow it back into the hole if their
+ * probe sequence passes through it, so that lookups never need tombstones.
+ */
+void LatencyTracker::eraseFromIndex(size_t position) {
+    size_t hole = position;
+    for (size_t next = (hole + 1) % INDEX_SIZE; mIndex[next] != EMPTY_INDEX_ENTRY;
+         next = (next + 1) % INDEX_SIZE) {
+        const size_t home = hashEventId(mEvents[mIndex[next]].inputEventId);
+        if ((next - home) % INDEX_SIZE >= (next - hole) % INDEX_SIZE) {
+            mIndex[hole] = mIndex[next];
+            hole = next;
+        }
+    }
+    mIndex[hole] = EMPTY_INDEX_ENTRY;
+}
+
+void LatencyTracker::reportAndPopOldestEvent() {
+    TrackedEvent& oldest = mEvents[mOldestEvent];
+    if (oldest.timeline) {
+        mTimelineProcessor->processTimeline(*oldest.timeline);
+        eraseFromIndex(findIndexPosition(oldest.inputEventId));
+        oldest.timeline.reset();
+    }
+    mOldestEvent = (mOldestEvent + 1) % MAX_TRACKED_EVENTS;
+    mEventCount--;
+}
+
 void LatencyTracker::trackListener(int32_t inputEventId, nsecs_t eventTime, nsecs_t readTime,
                                    DeviceId deviceId,
                                    const std::set<InputDeviceUsageSource>& sources,
                                    int32_t inputEventAction, InputEventType inputEventType) {
     reportAndPruneMatureRecords(eventTime);
-    const auto it = mTimelines.find(inputEventId);
-    if (it != mTimelines.end()) {
+    if (mEventCount == MAX_TRACKED_EVENTS) {
+        // The apps are not reporting the timelines fast enough for a table of this size. Report
+        // the oldest event without waiting for the rest of its timeline.
+        reportAndPopOldestEvent();
+    }
+    const size_t indexPosition = findIndexPosition(inputEventId);
+    if (const int32_t event = mIndex[indexPosition]; event != EMPTY_INDEX_ENTRY) {
         // Input event ids are randomly generated, so it's possible that two events have the same
         // event id. Drop this event, and also drop the existing event because the apps would
         // confuse us by reporting the rest of the timeline for one of them. This should happen
         // rarely, so we won't lose much data
-        mTimelines.erase(it);
-        eraseByValue(mEventTimes, inputEventId);
+        mEvents[event].timeline.reset();
+        eraseFromIndex(indexPosition);
         return;
     }
 
@@ -134,30 +185,31 @@ void LatencyTracker::trackListener(int32_t inputEventId, nsecs_t eventTime, nsec
         }
     }();
 
-    mTimelines.emplace(inputEventId,
-                       InputEventTimeline(eventTime, readTime, identifier->vendor,
-                                          identifier->product, sources, inputEventActionType));
-    mEventTimes.emplace(eventTime, inputEventId);
+    const size_t event = (mOldestEvent + mEventCount) % MAX_TRACKED_EVENTS;
+    mEvents[event].inputEventId = inputEventId;
+    mEvents[event].timeline.emplace(eventTime, readTime, identifier->vendor, identifier->product,
+                                    sources, inputEventActionType);
+    mIndex[indexPosition] = static_cast<int32_t>(event);
+    mEventCount++;
 }
 
 void LatencyTracker::trackFinishedEvent(int32_t inputEventId, const sp<IBinder>& connectionToken,
                                         nsecs_t deliveryTime, nsecs_t consumeTime,
                                         nsecs_t finishTime) {
-    const auto it = mTimelines.find(inputEventId);
-    if (it == mTimelines.end()) {
+    InputEventTimeline* const timeline = findTimeline(inputEventId);
+    if (timeline == nullptr) {
         // This could happen if we erased this event when duplicate events were detected. It's
         // also possible that an app sent a bad (or late) 'Finish' signal, since it's free to do
         // anything in its process. Just drop the report and move on.
         return;
     }
 
-    InputEventTimeline& timeline = it->second;
-    const auto connectionIt = timeline.connectionTimelines.find(connectionToken);
-    if (connectionIt == timeline.connectionTimelines.end()) {
+    const auto connectionIt = timeline->connectionTimelines.find(connectionToken);
+    if (connectionIt == timeline->connectionTimelines.end()) {
         // Most likely case: app calls 'finishInputEvent' before it reports the graphics timeline
-        timeline.connectionTimelines.emplace(connectionToken,
-                                             ConnectionTimeline{deliveryTime, consumeTime,
-                                                                finishTime});
+        timeline->connectionTimelines.emplace(connectionToken,
+                                              ConnectionTimeline{deliveryTime, consumeTime,
+                                                                 finishTime});
     } else {
         // Already have a record for this connectionToken
         ConnectionTimeline& connectionTimeline = connectionIt->second;
@@ -166,7 +218,7 @@ void LatencyTracker::trackFinishedEvent(int32_t inputEventId, const sp<IBinder>&
         if (!success) {
             // We are receiving unreliable data from the app. Just delete the entire connection
             // timeline for this event
-            timeline.connectionTimelines.erase(connectionIt);
+            timeline->connectionTimelines.erase(connectionIt);
         }
     }
 }
@@ -174,18 +226,17 @@ void LatencyTracker::trackFinishedEvent(int32_t inputEventId, const sp<IBinder>&
 void LatencyTracker::trackGraphicsLatency(
         int32_t inputEventId, const sp<IBinder>& connectionToken,
         std::array<nsecs_t, GraphicsTimeline::SIZE> graphicsTimeline) {
-    const auto it = mTimelines.find(inputEventId);
-    if (it == mTimelines.end()) {
+    InputEventTimeline* const timeline = findTimeline(inputEventId);
+    if (timeline == nullptr) {
         // This could happen if we erased this event when duplicate events were detected. It's
         // also possible that an app sent a bad (or late) 'Timeline' signal, since it's free to do
         // anything in its process. Just drop the report and move on.
         return;
     }
 
-    InputEventTimeline& timeline = it->second;
-    const auto connectionIt = timeline.connectionTimelines.find(connectionToken);
-    if (connectionIt == timeline.connectionTimelines.end()) {
-        timeline.connectionTimelines.emplace(connectionToken, std::move(graphicsTimeline));
+    const auto connectionIt = timeline->connectionTimelines.find(connectionToken);
+    if (connectionIt == timeline->connectionTimelines.end()) {
+        timeline->connectionTimelines.emplace(connectionToken, std::move(graphicsTimeline));
     } else {
         // Most likely case
         ConnectionTimeline& connectionTimeline = connectionIt->second;
@@ -193,7 +244,7 @@ void LatencyTracker::trackGraphicsLatency(
         if (!success) {
             // We are receiving unreliable data from the app. Just delete the entire connection
             // timeline for this event
-            timeline.connectionTimelines.erase(connectionIt);
+            timeline->connectionTimelines.erase(connectionIt);
         }
     }
 }
@@ -204,29 +255,21 @@ void LatencyTracker::trackGraphicsLatency(
  * 'trackListener' should happen soon after the event occurs.
  */
 void LatencyTracker::reportAndPruneMatureRecords(nsecs_t newEventTime) {
-    while (!mEventTimes.empty()) {
-        const auto& [oldestEventTime, oldestInputEventId] = *mEventTimes.begin();
-        if (isMatureEvent(oldestEventTime, /*now=*/newEventTime)) {
-            // Report and drop this event
-            const auto it = mTimelines.find(oldestInputEventId);
-            LOG_ALWAYS_FATAL_IF(it == mTimelines.end(),
-                                "Event %" PRId32 " is in mEventTimes, but not in mTimelines",
-                                oldestInputEventId);
-            const InputEventTimeline& timeline = it->second;
-            mTimelineProcessor->processTimeline(timeline);
-            mTimelines.erase(it);
-            mEventTimes.erase(mEventTimes.begin());
-        } else {
+    while (mEventCount != 0) {
+        const TrackedEvent& oldest = mEvents[mOldestEvent];
+        if (oldest.timeline && !isMatureEvent(oldest.timeline->eventTime, /*now=*/newEventTime)) {
             // If the oldest event does not need to be pruned, no events should be pruned.
             return;
         }
+        // Report and drop this event. Dropped duplicates can go right away.
+        reportAndPopOldestEvent();
     }
 }
 
 std::string LatencyTracker::dump(const char* prefix) const {
     return StringPrintf("%sLatencyTracker:\n", prefix) +
-            StringPrintf("%s  mTimelines.size() = %zu\n", prefix, mTimelines.size()) +
-            StringPrintf("%s  mEventTimes.size() = %zu\n", prefix, mEventTimes.size());
+            StringPrintf("%s  mEventCount = %zu (max %zu)\n", prefix, mEventCount,
+                         MAX_TRACKED_EVENTS);
 }
 
 void LatencyTracker::setInputDevices(const std::vector<InputDeviceInfo>& inputDevices) {
@@ -18,8 +18,8 @@
 
 #include "../InputDeviceMetricsSource.h"
 
-#include <map>
-#include <unordered_map>
+#include <optional>
+#include <vector>
 
 #include <binder/IBinder.h>
 #include <input/Input.h>
@@ -34,10 +34,16 @@ namespace android::inputdispatcher {
  * and processed by the apps. Once an event becomes "mature" (older than the ANR timeout), report
  * the entire input event latency history to the reporting function.
  *
+ * The records are kept in a table that is allocated once, so that tracking an event does not
+ * allocate. If the table is full, the oldest event is reported early to make room for the new one.
+ *
  * All calls to LatencyTracker should come from the same thread. It is not thread-safe.
  */
 class LatencyTracker {
 public:
+    // The maximum number of events that are tracked at the same time. Must be a power of two.
+    static constexpr size_t MAX_TRACKED_EVENTS = 1024;
+
     /**
      * Create a LatencyTracker.
      * param reportingFunction: the function that will be called in order to report full latency.
@@ -64,22 +70,33 @@ public:
     void setInputDevices(const std::vector<InputDeviceInfo>& inputDevices);
 
 private:
+    struct TrackedEvent {
+        int32_t inputEventId;
+        // Empty if the event was dropped because another event had the same inputEventId.
+        std::optional<InputEventTimeline> timeline;
+    };
     /**
-     * A collection of InputEventTimelines keyed by inputEventId. An InputEventTimeline is first
-     * created when 'trackListener' is called.
-     * When either 'trackFinishedEvent' or 'trackGraphicsLatency' is called for this input event,
-     * the corresponding InputEventTimeline will be updated for that token.
+     * A ring of the tracked events, in the order that 'trackListener' was called for them. An
+     * InputEventTimeline is first created when 'trackListener' is called. Since events arrive in
+     * the order of their eventTime, the oldest events are at the front of the ring, and are pruned
+     * from there.
      */
-    std::unordered_map<int32_t /*inputEventId*/, InputEventTimeline> mTimelines;
+    std::vector<TrackedEvent> mEvents;
+    size_t mOldestEvent = 0;
+    size_t mEventCount = 0;
+
     /**
-     * The collection of eventTimes will help us quickly find the events that we should prune
-     * from the 'mTimelines'. Since 'mTimelines' is keyed by inputEventId, it would be inefficient
-     * to walk through it directly to find the oldest input events to get rid of.
-     * There is a 1:1 mapping between 'mTimelines' and 'mEventTimes'.
-     * We are using 'multimap' instead of 'map' because there could be more than 1 event with the
-     * same eventTime.
+     * An open-addressing hash table from inputEventId to the position of the event in 'mEvents',
+     * with linear probing. It is twice as large as 'mEvents', so that probe sequences stay short.
+     * When either 'trackFinishedEvent' or 'trackGraphicsLatency' is called for an input event,
+     * this is how the corresponding InputEventTimeline is found.
      */
-    std::multimap<nsecs_t /*eventTime*/, int32_t /*inputEventId*/> mEventTimes;
+    std::vector<int32_t> mIndex;
+
+    size_t findIndexPosition(int32_t inputEventId) const;
+    InputEventTimeline* findTimeline(int32_t inputEventId);
+    void eraseFromIndex(size_t position);
+    void reportAndPopOldestEvent();
 
     InputEventTimelineProcessor* mTimelineProcessor;
     std::vector<InputDeviceInfo> mInputDevices;
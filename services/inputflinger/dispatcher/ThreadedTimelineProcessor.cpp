@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ThreadedTimelineProcessor"
+
+#include "ThreadedTimelineProcessor.h"
+
+#include <android-base/stringprintf.h>
+
+using android::base::StringPrintf;
+
+namespace android::inputdispatcher {
+
+ThreadedTimelineProcessor::ThreadedTimelineProcessor(InputEventTimelineProcessor& innerProcessor)
+      : mInnerProcessor(innerProcessor),
+        mThread(
+                "InputLatency", [this]() { threadLoop(); },
+                [this]() {
+                    // If the queue is full, the thread is not waiting, and will see that it
+                    // should exit once it returns from the next timeline.
+                    mQueue.try_push(std::nullopt);
+                }) {}
+
+void ThreadedTimelineProcessor::processTimeline(const InputEventTimeline& timeline) {
+    if (!mQueue.try_emplace(timeline)) {
+        mNumDroppedTimelines.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ThreadedTimelineProcessor::threadLoop() {
+    std::optional<InputEventTimeline> timeline = mQueue.pop();
+    if (!timeline) {
+        return;
+    }
+    mInnerProcessor.processTimeline(*timeline);
+}
+
+std::string ThreadedTimelineProcessor::dump(const char* prefix) const {
+    return StringPrintf("%sThreadedTimelineProcessor:\n", prefix) +
+            StringPrintf("%s  mQueue.size() = %zu\n", prefix, mQueue.size()) +
+            StringPrintf("%s  mNumDroppedTimelines = %zu\n", prefix,
+                         mNumDroppedTimelines.load(std::memory_order_relaxed));
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "InputEventTimeline.h"
+#include "InputThread.h"
+
+#include <ftl/ring_queue.h>
+
+#include <atomic>
+#include <optional>
+#include <string>
+
+namespace android::inputdispatcher {
+
+/**
+ * A wrapper around an InputEventTimelineProcessor that processes the timelines on a single new
+ * thread that it creates, so that the expensive processing (such as adding to the latency
+ * sketches) does not happen on the dispatcher thread. The timelines are handed over through a
+ * bounded lock-free queue, which does not allocate. If the processing thread falls behind and the
+ * queue is full, the new timelines are dropped rather than delaying the caller.
+ *
+ * The thread is started when the ThreadedTimelineProcessor is created, and is stopped when it is
+ * destroyed. The timelines that are still queued at that point are not processed.
+ */
+class ThreadedTimelineProcessor final : public InputEventTimelineProcessor {
+public:
+    explicit ThreadedTimelineProcessor(InputEventTimelineProcessor& innerProcessor);
+
+    void processTimeline(const InputEventTimeline& timeline) override;
+
+    std::string dump(const char* prefix) const;
+
+private:
+    static constexpr size_t QUEUE_CAPACITY = 256;
+
+    InputEventTimelineProcessor& mInnerProcessor;
+    // An empty entry wakes the processing thread up when it should exit.
+    ftl::MpscQueue<std::optional<InputEventTimeline>, QUEUE_CAPACITY> mQueue;
+    // How many timelines have been dropped because the queue was full
+    std::atomic<size_t> mNumDroppedTimelines{0};
+
+    // InputThread stops when its destructor is called. Initialize it last so that it is the
+    // first thing to be destructed. This will guarantee the thread will not access other
+    // members that have already been destructed.
+    InputThread mThread;
+
+    void threadLoop();
+};
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WindowHitTestIndex.h"
+
+#include <android-base/stringprintf.h>
+
+#include <algorithm>
+#include <cmath>
+
+using android::base::StringPrintf;
+using android::gui::WindowInfo;
+using android::gui::WindowInfoHandle;
+
+namespace android::inputdispatcher {
+
+namespace {
+
+// The grid is at most this many cells wide and high, whatever the size of the display.
+constexpr int64_t MAX_CELLS_PER_SIDE = 16;
+// Smaller cells would mostly duplicate windows across cells.
+constexpr int64_t MIN_CELL_SIZE = 64;
+
+bool canBeTouched(const WindowInfo& info) {
+    if (info.inputConfig.test(WindowInfo::InputConfig::NOT_VISIBLE)) {
+        return false;
+    }
+    // A stylus can touch a window that intercepts it even if it is not touchable.
+    return !info.inputConfig.test(WindowInfo::InputConfig::NOT_TOUCHABLE) ||
+            info.interceptsStylus();
+}
+
+} // namespace
+
+WindowHitTestIndex::WindowHitTestIndex(const std::vector<sp<WindowInfoHandle>>& windowHandles,
+                                       const ui::Transform& displayTransform)
+      : mDisplayTransform(displayTransform), mWindowHandles(windowHandles) {
+    std::vector<std::pair<uint32_t, Rect>> indexed;
+    for (uint32_t i = 0; i < mWindowHandles.size(); i++) {
+        const WindowInfo& info = *mWindowHandles[i]->getInfo();
+        if (!info.supportsSplitTouch()) {
+            mAlwaysCandidates.push_back(i);
+            continue;
+        }
+        if (!canBeTouched(info)) {
+            continue;
+        }
+        const Rect bounds = displayTransform.transform(info.touchableRegion).getBounds();
+        if (bounds.isEmpty()) {
+            continue;
+        }
+        if (indexed.empty()) {
+            mBounds = bounds;
+        } else {
+            mBounds.left = std::min(mBounds.left, bounds.left);
+            mBounds.top = std::min(mBounds.top, bounds.top);
+            mBounds.right = std::max(mBounds.right, bounds.right);
+            mBounds.bottom = std::max(mBounds.bottom, bounds.bottom);
+        }
+        indexed.emplace_back(i, bounds);
+    }
+    if (indexed.empty()) {
+        return;
+    }
+
+    const int64_t width = int64_t(mBounds.right) - mBounds.left;
+    const int64_t height = int64_t(mBounds.bottom) - mBounds.top;
+    const int64_t cellSize =
+            std::max(MIN_CELL_SIZE,
+                     (std::max(width, height) + MAX_CELLS_PER_SIDE - 1) / MAX_CELLS_PER_SIDE);
+    mCellSize = static_cast<int32_t>(cellSize);
+    mColumns = static_cast<int32_t>((width + cellSize - 1) / cellSize);
+    mRows = static_cast<int32_t>((height + cellSize - 1) / cellSize);
+    mCells.resize(static_cast<size_t>(mColumns) * mRows);
+
+    for (const auto& [i, bounds] : indexed) {
+        const int64_t firstColumn = (int64_t(bounds.left) - mBounds.left) / cellSize;
+        const int64_t lastColumn = (int64_t(bounds.right) - 1 - mBounds.left) / cellSize;
+        const int64_t firstRow = (int64_t(bounds.top) - mBounds.top) / cellSize;
+        const int64_t lastRow = (int64_t(bounds.bottom) - 1 - mBounds.top) / cellSize;
+        for (int64_t row = firstRow; row <= lastRow; row++) {
+            for (int64_t column = firstColumn; column <= lastColumn; column++) {
+                mCells[row * mColumns + column].push_back(i);
+            }
+        }
+    }
+}
+
+std::vector<sp<WindowInfoHandle>> WindowHitTestIndex::getCandidatesAt(float x, float y) const {
+    // Same rounding as the hit test, so a point is never in a different cell than it is tested in.
+    const auto p = mDisplayTransform.transform(x, y);
+    const float px = std::floor(p.x);
+    const float py = std::floor(p.y);
+
+    static const std::vector<uint32_t> NO_WINDOWS;
+    const std::vector<uint32_t>* cell = &NO_WINDOWS;
+    if (!mCells.empty() && px >= mBounds.left && px < mBounds.right && py >= mBounds.top &&
+        py < mBounds.bottom) {
+        const int64_t column = (static_cast<int64_t>(px) - mBounds.left) / mCellSize;
+        const int64_t row = (static_cast<int64_t>(py) - mBounds.top) / mCellSize;
+        cell = &mCells[row * mColumns + column];
+    }
+
+    // A window is either in cells or always a candidate, so merging the two keeps the Z order.
+    std::vector<sp<WindowInfoHandle>> candidates;
+    candidates.reserve(cell->size() + mAlwaysCandidates.size());
+    auto cellIt = cell->begin();
+    auto alwaysIt = mAlwaysCandidates.begin();
+    while (cellIt != cell->end() || alwaysIt != mAlwaysCandidates.end()) {
+        const bool fromCell = alwaysIt == mAlwaysCandidates.end() ||
+                (cellIt != cell->end() && *cellIt < *alwaysIt);
+        candidates.push_back(mWindowHandles[fromCell ? *cellIt++ : *alwaysIt++]);
+    }
+    return candidates;
+}
+
+std::string WindowHitTestIndex::dump() const {
+    size_t entries = 0;
+    for (const std::vector<uint32_t>& cell : mCells) {
+        entries += cell.size();
+    }
+    return StringPrintf("%dx%d cells of %dpx over %s, %zu entries, %zu always candidates", mColumns,
+                        mRows, mCellSize, to_string(mBounds).c_str(), entries,
+                        mAlwaysCandidates.size());
+}
+
+} // namespace android::inputdispatcher
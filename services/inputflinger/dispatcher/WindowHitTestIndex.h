@@ -0,0 +1,71 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <gui/WindowInfo.h>
+#include <ui/Rect.h>
+#include <ui/Transform.h>
+#include <utils/StrongPointer.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace android::inputdispatcher {
+
+/**
+ * Finds the windows of a display that might accept a touch at a point, without testing the
+ * touchable region of each window.
+ *
+ * The windows are put in the cells of a coarse grid that their touchable region overlaps, in the
+ * logical display space where InputDispatcher runs its hit tests. Windows that cannot be touched
+ * are left out. The candidates are a superset of the windows that accept the touch, so the exact
+ * check still runs on each of them.
+ *
+ * Windows that prevent splitting are always candidates, since they may get pointers outside of
+ * their touchable region.
+ */
+class WindowHitTestIndex {
+public:
+    WindowHitTestIndex(const std::vector<sp<gui::WindowInfoHandle>>& windowHandles,
+                       const ui::Transform& displayTransform);
+
+    // The display transform that the index was built for. The index must not be used with any
+    // other.
+    const ui::Transform& getDisplayTransform() const { return mDisplayTransform; }
+
+    // Returns the candidate windows at a point in display coordinates, front to back.
+    std::vector<sp<gui::WindowInfoHandle>> getCandidatesAt(float x, float y) const;
+
+    std::string dump() const;
+
+private:
+    ui::Transform mDisplayTransform;
+    std::vector<sp<gui::WindowInfoHandle>> mWindowHandles;
+
+    // The area that the grid covers, in logical display coordinates.
+    Rect mBounds;
+    int32_t mCellSize = 0;
+    int32_t mColumns = 0;
+    int32_t mRows = 0;
+    // Indices in mWindowHandles of the windows in each cell, row by row, in Z order.
+    std::vector<std::vector<uint32_t>> mCells;
+    // Indices in mWindowHandles of the windows that are candidates everywhere, in Z order.
+    std::vector<uint32_t> mAlwaysCandidates;
+};
+
+} // namespace android::inputdispatcher
@@ -103,7 +103,7 @@ void AndroidInputEventProtoConverter::toProtoKeyEvent(const TracedKeyEvent& even
 void AndroidInputEventProtoConverter::toProtoWindowDispatchEvent(
         const WindowDispatchArgs& args, proto::AndroidWindowInputDispatchEvent& outProto,
         bool isRedacted) {
-    std::visit([&](auto entry) { outProto.set_event_id(entry.id); }, args.eventEntry);
+    std::visit([&](const auto& entry) { outProto.set_event_id(entry.id); }, args.eventEntry);
     outProto.set_vsync_id(args.vsyncId);
     outProto.set_window_id(args.windowId);
     outProto.set_resolved_flags(args.resolvedFlags);
@@ -101,6 +101,8 @@ struct TracedEventMetadata {
     bool isImeConnectionActive;
     // The timestamp for when the dispatching decisions were made for the event by the system.
     nsecs_t processingTimestamp;
+
+    bool operator==(const TracedEventMetadata&) const = default;
 };
 
 /** Additional information about an input event being dispatched to a window. */
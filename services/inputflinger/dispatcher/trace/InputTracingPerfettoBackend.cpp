@@ -136,15 +136,22 @@ bool PerfettoBackend::InputEventDataSource::shouldIgnoreTracedInputEvent(
 }
 
 TraceLevel PerfettoBackend::InputEventDataSource::resolveTraceLevel(
-        const TracedEventMetadata& metadata) const {
+        const TracedEventMetadata& metadata) {
+    if (mLastResolvedMetadata == metadata) {
+        return mLastResolvedTraceLevel;
+    }
+    // The event is not traced if it matched zero rules.
+    TraceLevel level = TraceLevel::TRACE_LEVEL_NONE;
     // Check for matches with the rules in the order that they are defined.
     for (const auto& rule : mConfig.rules) {
         if (ruleMatches(rule, metadata)) {
-            return rule.level;
+            level = rule.level;
+            break;
         }
     }
-    // The event is not traced if it matched zero rules.
-    return TraceLevel::TRACE_LEVEL_NONE;
+    mLastResolvedMetadata = metadata;
+    mLastResolvedTraceLevel = level;
+    return level;
 }
 
 bool PerfettoBackend::InputEventDataSource::ruleMatches(const TraceRule& rule,
@@ -24,6 +24,7 @@
 #include <ftl/flags.h>
 #include <perfetto/tracing.h>
 #include <mutex>
+#include <optional>
 #include <set>
 
 namespace android::inputdispatcher::trace::impl {
@@ -75,7 +76,7 @@ private:
         void initializeUidMap();
         bool shouldIgnoreTracedInputEvent(const EventType&) const;
         inline ftl::Flags<TraceFlag> getFlags() const { return mConfig.flags; }
-        TraceLevel resolveTraceLevel(const TracedEventMetadata&) const;
+        TraceLevel resolveTraceLevel(const TracedEventMetadata&);
 
     private:
         const int32_t mInstanceId;
@@ -84,6 +85,12 @@ private:
         bool ruleMatches(const TraceRule&, const TracedEventMetadata&) const;
 
         std::optional<std::map<std::string, gui::Uid>> mUidMap;
+
+        // The metadata that the trace level was last resolved for, and the level. An event and its
+        // window dispatches share their metadata, so the rules are evaluated once per event rather
+        // than once for every window that it is dispatched to.
+        std::optional<TracedEventMetadata> mLastResolvedMetadata;
+        TraceLevel mLastResolvedTraceLevel{TraceLevel::TRACE_LEVEL_NONE};
     };
 
     static std::once_flag sDataSourceRegistrationFlag;
@@ -39,6 +39,8 @@ struct Visitor : V... {
 template <typename Backend>
 ThreadedBackend<Backend>::ThreadedBackend(Backend&& innerBackend)
       : mBackend(std::move(innerBackend)),
+        mRing(RING_CAPACITY),
+        mProgress(std::make_shared<Progress>()),
         mTracerThread(
                 "InputTracer", [this]() { threadLoop(); },
                 [this]() { mThreadWakeCondition.notify_all(); }) {}
@@ -55,98 +57,120 @@ ThreadedBackend<Backend>::~ThreadedBackend() {
 template <typename Backend>
 void ThreadedBackend<Backend>::traceMotionEvent(const TracedMotionEvent& event,
                                                 const TracedEventMetadata& metadata) {
-    std::scoped_lock lock(mLock);
-    mQueue.emplace_back(event, metadata);
-    setIdleStatus(false);
-    mThreadWakeCondition.notify_all();
+    enqueue(event, metadata);
 }
 
 template <typename Backend>
 void ThreadedBackend<Backend>::traceKeyEvent(const TracedKeyEvent& event,
                                              const TracedEventMetadata& metadata) {
-    std::scoped_lock lock(mLock);
-    mQueue.emplace_back(event, metadata);
-    setIdleStatus(false);
-    mThreadWakeCondition.notify_all();
+    enqueue(event, metadata);
 }
 
 template <typename Backend>
 void ThreadedBackend<Backend>::traceWindowDispatch(const WindowDispatchArgs& dispatchArgs,
                                                    const TracedEventMetadata& metadata) {
-    std::scoped_lock lock(mLock);
-    mQueue.emplace_back(dispatchArgs, metadata);
-    setIdleStatus(false);
-    mThreadWakeCondition.notify_all();
+    enqueue(dispatchArgs, metadata);
 }
 
 template <typename Backend>
-void ThreadedBackend<Backend>::threadLoop() {
-    std::vector<TraceEntry> entries;
+template <typename Entry>
+void ThreadedBackend<Backend>::enqueue(const Entry& entry, const TracedEventMetadata& metadata) {
+    const size_t tail = mTail.load(std::memory_order_relaxed);
+    if (tail - mHead.load(std::memory_order_acquire) == RING_CAPACITY) {
+        mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Assigning to the slot, rather than constructing a new entry in it, reuses the storage of the
+    // entry that was there before if it is of the same type.
+    TraceEntry& slot = mRing[tail % RING_CAPACITY];
+    slot.first = entry;
+    slot.second = metadata;
+    mTail.store(tail + 1, std::memory_order_release);
+    mProgress->queuedCount.store(tail + 1, std::memory_order_release);
+
+    // Either the tracing thread sees the new entry before it sleeps, or this sees that it sleeps.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mThreadWaiting.load(std::memory_order_relaxed)) {
+        std::scoped_lock lock(mLock);
+        mThreadWakeCondition.notify_all();
+    }
+}
 
+template <typename Backend>
+void ThreadedBackend<Backend>::threadLoop() {
     { // acquire lock
         std::unique_lock lock(mLock);
         base::ScopedLockAssertion assumeLocked(mLock);
 
-        if (mQueue.empty()) {
-            setIdleStatus(true);
-        }
-
         // Wait until we need to process more events or exit.
-        mThreadWakeCondition.wait(lock,
-                                  [&]() REQUIRES(mLock) { return mThreadExit || !mQueue.empty(); });
+        mThreadWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        mThreadWakeCondition.wait(lock, [&]() REQUIRES(mLock) {
+            return mThreadExit ||
+                    mTail.load(std::memory_order_acquire) != mHead.load(std::memory_order_relaxed);
+        });
+        mThreadWaiting.store(false, std::memory_order_relaxed);
         if (mThreadExit) {
-            setIdleStatus(true);
+            updateProgress(mHead.load(std::memory_order_relaxed), /*threadExited=*/true);
             return;
         }
-
-        mQueue.swap(entries);
     } // release lock
 
-    // Trace the events into the backend without holding the lock to reduce the amount of
-    // work performed in the critical section.
-    for (const auto& [entry, traceArgs] : entries) {
-        std::visit(Visitor{[&](const TracedMotionEvent& e) {
-                               mBackend.traceMotionEvent(e, traceArgs);
-                           },
-                           [&](const TracedKeyEvent& e) { mBackend.traceKeyEvent(e, traceArgs); },
-                           [&](const WindowDispatchArgs& args) {
-                               mBackend.traceWindowDispatch(args, traceArgs);
-                           }},
-                   entry);
+    // Trace all of the entries that are ready, and hand each slot back as soon as it is written.
+    const size_t tail = mTail.load(std::memory_order_acquire);
+    for (size_t head = mHead.load(std::memory_order_relaxed); head != tail; head++) {
+        traceEntry(mRing[head % RING_CAPACITY]);
+        mHead.store(head + 1, std::memory_order_release);
     }
-    entries.clear();
+
+    if (const size_t droppedCount = mDroppedCount.load(std::memory_order_relaxed);
+        droppedCount != mLoggedDroppedCount) {
+        LOG(WARNING) << "Dropped " << droppedCount - mLoggedDroppedCount
+                     << " trace entries because the tracing thread fell behind";
+        mLoggedDroppedCount = droppedCount;
+    }
+    updateProgress(tail, /*threadExited=*/false);
 }
 
 template <typename Backend>
-std::function<void()> ThreadedBackend<Backend>::getIdleWaiterForTesting() {
-    std::scoped_lock lock(mLock);
-    if (!mIdleWaiter) {
-        mIdleWaiter = std::make_shared<IdleWaiter>();
+void ThreadedBackend<Backend>::traceEntry(const TraceEntry& slot) {
+    const auto& [entry, traceArgs] = slot;
+    std::visit(Visitor{[&](const TracedMotionEvent& e) { mBackend.traceMotionEvent(e, traceArgs); },
+                       [&](const TracedKeyEvent& e) { mBackend.traceKeyEvent(e, traceArgs); },
+                       [&](const WindowDispatchArgs& args) {
+                           mBackend.traceWindowDispatch(args, traceArgs);
+                       }},
+               entry);
+}
+
+template <typename Backend>
+void ThreadedBackend<Backend>::updateProgress(size_t tracedCount, bool threadExited) {
+    std::scoped_lock lock(mProgress->lock);
+    mProgress->tracedCount = tracedCount;
+    mProgress->threadExited = threadExited;
+    // Only tests wait for the progress, so don't pay for the notification otherwise.
+    if (mProgress->waiterCount > 0) {
+        mProgress->tracedCondition.notify_all();
     }
+}
 
-    // Return a lambda that holds a strong reference to the idle waiter, whose lifetime can extend
+template <typename Backend>
+std::function<void()> ThreadedBackend<Backend>::getIdleWaiterForTesting() {
+    // Return a lambda that holds a strong reference to the progress, whose lifetime can extend
     // beyond this threaded backend object.
-    return [idleWaiter = mIdleWaiter]() {
-        std::unique_lock idleLock(idleWaiter->idleLock);
-        base::ScopedLockAssertion assumeLocked(idleWaiter->idleLock);
-        idleWaiter->threadIdleCondition.wait(idleLock, [&]() REQUIRES(idleWaiter->idleLock) {
-            return idleWaiter->isIdle;
+    return [progress = mProgress]() {
+        const size_t queuedCount = progress->queuedCount.load(std::memory_order_acquire);
+        std::unique_lock lock(progress->lock);
+        base::ScopedLockAssertion assumeLocked(progress->lock);
+        progress->waiterCount++;
+        progress->tracedCondition.wait(lock, [&]() REQUIRES(progress->lock) {
+            return progress->threadExited || progress->tracedCount >= queuedCount;
         });
+        progress->waiterCount--;
     };
 }
 
-template <typename Backend>
-void ThreadedBackend<Backend>::setIdleStatus(bool isIdle) {
-    if (!mIdleWaiter) {
-        return;
-    }
-    std::scoped_lock idleLock(mIdleWaiter->idleLock);
-    mIdleWaiter->isIdle = isIdle;
-    if (isIdle) {
-        mIdleWaiter->threadIdleCondition.notify_all();
-    }
-}
-
 // Explicit template instantiation for the PerfettoBackend.
 template class ThreadedBackend<PerfettoBackend>;
 
@@ -20,6 +20,9 @@
 #include "InputTracingPerfettoBackend.h"
 
 #include <android-base/thread_annotations.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <variant>
 #include <vector>
@@ -29,8 +32,17 @@ namespace android::inputdispatcher::trace::impl {
 /**
  * A wrapper around an InputTracingBackend implementation that writes to the inner tracing backend
  * from a single new thread that it creates. The new tracing thread is started when the
- * ThreadedBackend is created, and is stopped when it is destroyed. The ThreadedBackend is
- * thread-safe.
+ * ThreadedBackend is created, and is stopped when it is destroyed.
+ *
+ * The entries are handed over through a lock-free ring of slots that are allocated once and then
+ * reused. Copying an entry into a slot reuses the storage of the pointers and targets of the entry
+ * that was in it before, so once the ring has warmed up, tracing typical events does not allocate
+ * on the caller's thread. The tracing thread writes all of the entries that are ready in one pass,
+ * straight from their slots. If it falls behind and the ring is full, new entries are dropped
+ * rather than delaying the caller.
+ *
+ * The trace functions must not be called concurrently, which InputTracer ensures by only being
+ * used with the dispatcher lock held. The other functions are thread-safe.
  */
 template <typename Backend>
 class ThreadedBackend : public InputTracingBackendInterface {
@@ -46,30 +58,53 @@ public:
     std::function<void()> getIdleWaiterForTesting();
 
 private:
-    std::mutex mLock;
-    bool mThreadExit GUARDED_BY(mLock){false};
-    std::condition_variable mThreadWakeCondition;
+    static constexpr size_t RING_CAPACITY = 512;
+
     Backend mBackend;
     using TraceEntry =
             std::pair<std::variant<TracedKeyEvent, TracedMotionEvent, WindowDispatchArgs>,
                       TracedEventMetadata>;
-    std::vector<TraceEntry> mQueue GUARDED_BY(mLock);
+    std::vector<TraceEntry> mRing;
+    // The position of the next entry to trace, written by the tracing thread.
+    std::atomic<size_t> mHead{0};
+    // The position of the next slot to write, written by the caller.
+    std::atomic<size_t> mTail{0};
+    // How many entries have been dropped because the ring was full.
+    std::atomic<size_t> mDroppedCount{0};
+    // The dropped entries that the tracing thread has logged.
+    size_t mLoggedDroppedCount{0};
+
+    // The tracing thread only takes the lock to sleep while the ring is empty, and the caller only
+    // takes it to wake the tracing thread up.
+    std::mutex mLock;
+    bool mThreadExit GUARDED_BY(mLock){false};
+    std::atomic<bool> mThreadWaiting{false};
+    std::condition_variable mThreadWakeCondition;
+
+    // The progress of the tracing thread, shared with the idle waiters used by tests, which can
+    // outlive this object.
+    struct Progress {
+        // The number of entries that have been queued, written by the caller.
+        std::atomic<size_t> queuedCount{0};
 
-    struct IdleWaiter {
-        std::mutex idleLock;
-        std::condition_variable threadIdleCondition;
-        bool isIdle GUARDED_BY(idleLock){false};
+        std::mutex lock;
+        std::condition_variable tracedCondition;
+        size_t tracedCount GUARDED_BY(lock){0};
+        bool threadExited GUARDED_BY(lock){false};
+        size_t waiterCount GUARDED_BY(lock){0};
     };
-    // The lazy-initialized object used to wait for the tracing thread to idle.
-    std::shared_ptr<IdleWaiter> mIdleWaiter GUARDED_BY(mLock);
+    const std::shared_ptr<Progress> mProgress;
 
     // InputThread stops when its destructor is called. Initialize it last so that it is the
     // first thing to be destructed. This will guarantee the thread will not access other
     // members that have already been destructed.
     InputThread mTracerThread;
 
+    template <typename Entry>
+    void enqueue(const Entry& entry, const TracedEventMetadata& metadata);
     void threadLoop();
-    void setIdleStatus(bool isIdle) REQUIRES(mLock);
+    void traceEntry(const TraceEntry& entry);
+    void updateProgress(size_t tracedCount, bool threadExited);
 };
 
 } // namespace android::inputdispatcher::trace::impl
@@ -16,11 +16,15 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <string>
 #include <vector>
 
 #include <input/Input.h>
 #include <input/InputDevice.h>
 #include <input/TouchVideoFrame.h>
+#include <utils/Timers.h>
 #include "NotifyArgs.h"
 
 namespace android {
@@ -75,11 +79,30 @@ private:
 };
 
 /*
- * An implementation of the listener interface that traces the calls to its inner listener.
+ * An implementation of the listener interface that traces the calls to its inner listener, which
+ * is a stage of the input pipeline. It also measures how long the stage takes for the args, not
+ * counting the time that they spend in the stages after it, and how long after they were read
+ * they reach it.
  */
 class TracedInputListener : public InputListenerInterface {
 public:
+    // The types of args, as bits of the types that a stage passes through.
+    enum ArgsType : uint32_t {
+        INPUT_DEVICES_CHANGED = 1 << 0,
+        KEY = 1 << 1,
+        MOTION = 1 << 2,
+        SWITCH = 1 << 3,
+        SENSOR = 1 << 4,
+        VIBRATOR_STATE = 1 << 5,
+        DEVICE_RESET = 1 << 6,
+        POINTER_CAPTURE_CHANGED = 1 << 7,
+    };
+
     explicit TracedInputListener(const char* name, InputListenerInterface& innerListener);
+    // The args of passThroughTypes bypass the inner listener, which would only hand them to
+    // nextListener as they are.
+    TracedInputListener(const char* name, InputListenerInterface& innerListener,
+                        uint32_t passThroughTypes, InputListenerInterface& nextListener);
 
     virtual void notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs& args) override;
     virtual void notifyKey(const NotifyKeyArgs& args) override;
@@ -90,9 +113,33 @@ public:
     void notifyVibratorState(const NotifyVibratorStateArgs& args) override;
     void notifyPointerCaptureChanged(const NotifyPointerCaptureChangedArgs& args) override;
 
+    void dump(std::string& dump) const;
+
 private:
+    // Upper bounds of the buckets of the latency histogram. The last bucket is unbounded.
+    static constexpr std::array<nsecs_t, 6> kLatencyBuckets = {us2ns(10),  us2ns(50), us2ns(100),
+                                                               us2ns(500), ms2ns(1),  ms2ns(5)};
+
+    template <typename Args>
+    void notifyStage(ArgsType type, const char* fnName, const Args& args);
+    void recordLatency(nsecs_t latency);
+    void recordAge(nsecs_t age);
+
     InputListenerInterface& mInnerListener;
     const char* mName;
+    const uint32_t mPassThroughTypes;
+    InputListenerInterface& mNextListener;
+
+    // The stages can be notified from more than one thread, and are dumped from another.
+    std::atomic<uint64_t> mPassedThroughCount = 0;
+    std::atomic<uint64_t> mCount = 0;
+    std::atomic<nsecs_t> mTotalLatency = 0;
+    std::atomic<nsecs_t> mMaxLatency = 0;
+    std::array<std::atomic<uint64_t>, kLatencyBuckets.size() + 1> mLatencyHistogram{};
+    // Of the key and motion args only, which have a read time.
+    std::atomic<uint64_t> mAgeCount = 0;
+    std::atomic<nsecs_t> mTotalAge = 0;
+    std::atomic<nsecs_t> mMaxAge = 0;
 };
 
 } // namespace android
@@ -16,17 +16,36 @@
 
 #pragma once
 
+#include <ftl/small_vector.h>
 #include <include/gestures.h>
-#include <vector>
 
 namespace android {
 
 // A Gestures library HardwareState struct (from libchrome-gestures), but bundled
 // with a vector to contain its FingerStates, so you don't have to worry about where
 // that memory is allocated.
+//
+// The FingerStates are stored inline for up to MAX_INLINE_FINGERS fingers, so that producing a
+// HardwareState on every sync does not allocate. Copies point their HardwareState at their own
+// FingerStates.
 struct SelfContainedHardwareState {
+    // More fingers than this, which few touchpads can report, are stored on the heap.
+    static constexpr size_t MAX_INLINE_FINGERS = 10;
+
     HardwareState state;
-    std::vector<FingerState> fingers;
+    ftl::SmallVector<FingerState, MAX_INLINE_FINGERS> fingers;
+
+    SelfContainedHardwareState() = default;
+    SelfContainedHardwareState(const SelfContainedHardwareState& other)
+          : state(other.state), fingers(other.fingers) {
+        state.fingers = fingers.begin();
+    }
+    SelfContainedHardwareState& operator=(const SelfContainedHardwareState& other) {
+        state = other.state;
+        fingers = other.fingers;
+        state.fingers = fingers.begin();
+        return *this;
+    }
 };
 
 } // namespace android
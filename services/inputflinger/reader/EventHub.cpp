@@ -53,9 +53,11 @@
 #include <utils/Log.h>
 #include <utils/Timers.h>
 
+#include <atomic>
 #include <filesystem>
 #include <optional>
 #include <regex>
+#include <thread>
 #include <utility>
 
 #include "EventHub.h"
@@ -85,6 +87,13 @@ static constexpr int32_t FF_WEAK_MAGNITUDE_CHANNEL_IDX = 1;
 
 static constexpr size_t EVENT_BUFFER_SIZE = 256;
 
+// Bounds of the number of events that are read from a device at once.
+static constexpr size_t MIN_READ_BUFFER_SIZE = 64;
+static constexpr size_t MAX_READ_BUFFER_SIZE = 1024;
+
+// The most devices that are probed at the same time when scanning for devices.
+static constexpr size_t MAX_DEVICE_PROBE_THREADS = 4;
+
 // Mapping for input battery class node IDs lookup.
 // https://www.kernel.org/doc/Documentation/power/power_supply_class.txt
 static const std::unordered_map<std::string, InputBatteryClass> BATTERY_CLASSES =
@@ -1846,9 +1855,8 @@ std::optional<int32_t> EventHub::getBatteryStatus(int32_t deviceId, int32_t batt
 std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
     std::scoped_lock _l(mLock);
 
-    std::array<input_event, EVENT_BUFFER_SIZE> readBuffer;
-
     std::vector<RawEvent> events;
+    events.reserve(EVENT_BUFFER_SIZE);
     bool awoken = false;
     for (;;) {
         nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
@@ -1976,9 +1984,12 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
             }
             // This must be an input event
             if (eventItem.events & EPOLLIN) {
-                int32_t readSize =
-                        read(device->fd, readBuffer.data(),
-                             sizeof(decltype(readBuffer)::value_type) * readBuffer.size());
+                std::vector<input_event>& readBuffer = device->readBuffer;
+                if (readBuffer.empty()) {
+                    readBuffer.resize(MIN_READ_BUFFER_SIZE);
+                }
+                int32_t readSize = read(device->fd, readBuffer.data(),
+                                        sizeof(input_event) * readBuffer.size());
                 if (readSize == 0 || (readSize < 0 && errno == ENODEV)) {
                     // Device was removed before INotify noticed.
                     ALOGW("could not get event, removed? (fd: %d size: %" PRId32
@@ -1996,17 +2007,30 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
                     const int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
 
                     const size_t count = size_t(readSize) / sizeof(struct input_event);
+                    const nsecs_t readTime = systemTime(SYSTEM_TIME_MONOTONIC);
+                    Device::ReadStats& stats = device->readStats;
                     for (size_t i = 0; i < count; i++) {
                         struct input_event& iev = readBuffer[i];
                         device->trackInputEvent(iev);
+                        const nsecs_t when = processEventTimestamp(iev);
                         events.push_back({
-                                .when = processEventTimestamp(iev),
-                                .readTime = systemTime(SYSTEM_TIME_MONOTONIC),
+                                .when = when,
+                                .readTime = readTime,
                                 .deviceId = deviceId,
                                 .type = iev.type,
                                 .code = iev.code,
                                 .value = iev.value,
                         });
+                        const nsecs_t latency = readTime - when;
+                        stats.totalLatency += latency;
+                        stats.maxLatency = std::max(stats.maxLatency, latency);
+                    }
+                    stats.readCount++;
+                    stats.eventCount += count;
+                    if (count == readBuffer.size() && readBuffer.size() < MAX_READ_BUFFER_SIZE) {
+                        // The device had more events than the buffer could hold, so read more
+                        // of them at once from now on.
+                        readBuffer.resize(readBuffer.size() * 2);
                     }
                     if (events.size() >= EVENT_BUFFER_SIZE) {
                         // The result buffer is full.  Reset the pending event index
@@ -2226,17 +2250,35 @@ void EventHub::reportDeviceAddedForStatisticsLocked(const InputDeviceIdentifier&
                                identifier.bus, obfuscatedId.c_str(), classes.get());
 }
 
-void EventHub::openDeviceLocked(const std::string& devicePath) {
+bool EventHub::hasDeviceWithPathLocked(const std::string& devicePath) const {
     // If an input device happens to register around the time when EventHub's constructor runs, it
     // is possible that the same input event node (for example, /dev/input/event3) will be noticed
     // in both 'inotify' callback and also in the 'scanDirLocked' pass. To prevent duplicate devices
     // from getting registered, ensure that this path is not already covered by an existing device.
     for (const auto& [deviceId, device] : mDevices) {
         if (device->path == devicePath) {
-            return; // device was already registered
+            return true;
         }
     }
+    return false;
+}
 
+void EventHub::openDeviceLocked(const std::string& devicePath) {
+    if (hasDeviceWithPathLocked(devicePath)) {
+        return; // device was already registered
+    }
+    const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    std::optional<ProbedDevice> probedDevice =
+            probeDevice(devicePath, mNextDeviceId++, mExcludedDevices);
+    if (probedDevice) {
+        probedDevice->device->openDuration = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+        addProbedDeviceLocked(std::move(*probedDevice));
+    }
+}
+
+std::optional<EventHub::ProbedDevice> EventHub::probeDevice(
+        const std::string& devicePath, int32_t deviceId,
+        const std::vector<std::string>& excludedDevices) {
     char buffer[80];
 
     ALOGV("Opening device: %s", devicePath.c_str());
@@ -2244,7 +2286,7 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     int fd = open(devicePath.c_str(), O_RDWR | O_CLOEXEC | O_NONBLOCK);
     if (fd < 0) {
         ALOGE("could not open %s, %s\n", devicePath.c_str(), strerror(errno));
-        return;
+        return std::nullopt;
     }
 
     InputDeviceIdentifier identifier;
@@ -2258,12 +2300,12 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     }
 
     // Check to see if the device is on our excluded list
-    for (size_t i = 0; i < mExcludedDevices.size(); i++) {
-        const std::string& item = mExcludedDevices[i];
+    for (size_t i = 0; i < excludedDevices.size(); i++) {
+        const std::string& item = excludedDevices[i];
         if (identifier.name == item) {
             ALOGI("ignoring event id %s driver %s\n", devicePath.c_str(), item.c_str());
             close(fd);
-            return;
+            return std::nullopt;
         }
     }
 
@@ -2272,7 +2314,7 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     if (ioctl(fd, EVIOCGVERSION, &driverVersion)) {
         ALOGE("could not get driver version for %s, %s\n", devicePath.c_str(), strerror(errno));
         close(fd);
-        return;
+        return std::nullopt;
     }
 
     // Get device identifier.
@@ -2280,7 +2322,7 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     if (ioctl(fd, EVIOCGID, &inputId)) {
         ALOGE("could not get device input id for %s, %s\n", devicePath.c_str(), strerror(errno));
         close(fd);
-        return;
+        return std::nullopt;
     }
     identifier.bus = inputId.bustype;
     identifier.product = inputId.product;
@@ -2314,14 +2356,11 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
         }
     }
 
-    // Fill in the descriptor.
-    assignDescriptorLocked(identifier);
-
-    // Allocate device.  (The device object takes ownership of the fd at this point.)
-    int32_t deviceId = mNextDeviceId++;
+    // Allocate device.  (The device object takes ownership of the fd at this point.) The
+    // descriptor and the associated device depend on the other devices, and are filled in by
+    // addProbedDeviceLocked.
     std::unique_ptr<Device> device =
-            std::make_unique<Device>(fd, deviceId, devicePath, identifier,
-                                     obtainAssociatedDeviceLocked(devicePath));
+            std::make_unique<Device>(fd, deviceId, devicePath, identifier, nullptr);
 
     ALOGV("add device %d: %s\n", deviceId, devicePath.c_str());
     ALOGV("  bus:        %04x\n"
@@ -2332,7 +2371,6 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     ALOGV("  name:       \"%s\"\n", identifier.name.c_str());
     ALOGV("  location:   \"%s\"\n", identifier.location.c_str());
     ALOGV("  unique id:  \"%s\"\n", identifier.uniqueId.c_str());
-    ALOGV("  descriptor: \"%s\"\n", identifier.descriptor.c_str());
     ALOGV("  driver:     v%d.%d.%d\n", driverVersion >> 16, (driverVersion >> 8) & 0xff,
           driverVersion & 0xff);
 
@@ -2454,13 +2492,6 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
 
     // Configure the keyboard, gamepad or virtual keyboard.
     if (device->classes.test(InputDeviceClass::KEYBOARD)) {
-        // Register the keyboard as a built-in keyboard if it is eligible.
-        if (!keyMapStatus && mBuiltInKeyboardId == NO_BUILT_IN_KEYBOARD &&
-            isEligibleBuiltInKeyboard(device->identifier, device->configuration.get(),
-                                      &device->keyMap)) {
-            mBuiltInKeyboardId = device->id;
-        }
-
         // 'Q' key support = cheap test of whether this is an alpha-capable kbd
         if (device->hasKeycodeLocked(AKEYCODE_Q)) {
             device->classes |= InputDeviceClass::ALPHAKEY;
@@ -2497,9 +2528,33 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     if (device->classes == ftl::Flags<InputDeviceClass>(0)) {
         ALOGV("Dropping device: id=%d, path='%s', name='%s'", deviceId, devicePath.c_str(),
               device->identifier.name.c_str());
-        return;
+        return std::nullopt;
     }
 
+    // Determine whether the device has a mic.
+    if (device->deviceHasMicLocked()) {
+        device->classes |= InputDeviceClass::MIC;
+    }
+
+    // Determine whether the device is external or internal.
+    if (device->isExternalDeviceLocked()) {
+        device->classes |= InputDeviceClass::EXTERNAL;
+    }
+
+    return ProbedDevice{std::move(device), keyMapStatus == OK};
+}
+
+void EventHub::addProbedDeviceLocked(ProbedDevice probedDevice) {
+    const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    std::unique_ptr<Device>& device = probedDevice.device;
+    const int32_t deviceId = device->id;
+
+    // Fill in the descriptor.
+    assignDescriptorLocked(device->identifier);
+    ALOGV("  descriptor: \"%s\"\n", device->identifier.descriptor.c_str());
+
+    device->associatedDevice = obtainAssociatedDeviceLocked(device->path);
+
     // Classify InputDeviceClass::BATTERY.
     if (device->associatedDevice && !device->associatedDevice->batteryInfos.empty()) {
         device->classes |= InputDeviceClass::BATTERY;
@@ -2510,14 +2565,12 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
         device->classes |= InputDeviceClass::LIGHT;
     }
 
-    // Determine whether the device has a mic.
-    if (device->deviceHasMicLocked()) {
-        device->classes |= InputDeviceClass::MIC;
-    }
-
-    // Determine whether the device is external or internal.
-    if (device->isExternalDeviceLocked()) {
-        device->classes |= InputDeviceClass::EXTERNAL;
+    // Register the keyboard as a built-in keyboard if it is eligible.
+    if (device->classes.test(InputDeviceClass::KEYBOARD) && probedDevice.keyMapLoaded &&
+        mBuiltInKeyboardId == NO_BUILT_IN_KEYBOARD &&
+        isEligibleBuiltInKeyboard(device->identifier, device->configuration.get(),
+                                  &device->keyMap)) {
+        mBuiltInKeyboardId = device->id;
     }
 
     if (device->classes.any(InputDeviceClass::JOYSTICK | InputDeviceClass::DPAD) &&
@@ -2531,13 +2584,15 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     }
 
     device->configureFd();
+    device->openDuration += systemTime(SYSTEM_TIME_MONOTONIC) - start;
 
     ALOGI("New device: id=%d, fd=%d, path='%s', name='%s', classes=%s, "
-          "configuration='%s', keyLayout='%s', keyCharacterMap='%s', builtinKeyboard=%s, ",
-          deviceId, fd, devicePath.c_str(), device->identifier.name.c_str(),
+          "configuration='%s', keyLayout='%s', keyCharacterMap='%s', builtinKeyboard=%s, "
+          "openTime=%.1fms",
+          deviceId, device->fd, device->path.c_str(), device->identifier.name.c_str(),
           device->classes.string().c_str(), device->configurationFile.c_str(),
           device->keyMap.keyLayoutFile.c_str(), device->keyMap.keyCharacterMapFile.c_str(),
-          toString(mBuiltInKeyboardId == deviceId));
+          toString(mBuiltInKeyboardId == deviceId), device->openDuration / 1E6);
 
     addDeviceLocked(std::move(device));
 }
@@ -2808,9 +2863,48 @@ void EventHub::handleNotifyEventLocked(const inotify_event& event) {
 }
 
 status_t EventHub::scanDirLocked(const std::string& dirname) {
+    const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    std::vector<std::string> devicePaths;
+    std::vector<int32_t> deviceIds;
     for (const auto& entry : std::filesystem::directory_iterator(dirname)) {
-        openDeviceLocked(entry.path());
+        if (!hasDeviceWithPathLocked(entry.path())) {
+            devicePaths.push_back(entry.path());
+            deviceIds.push_back(mNextDeviceId++);
+        }
+    }
+
+    // Opening a device takes many ioctls and reads its configuration files, which for some
+    // devices is slow, so the devices are probed at the same time. Only adding them to the
+    // EventHub, in the order of the directory, is serialized.
+    std::vector<std::optional<ProbedDevice>> probedDevices(devicePaths.size());
+    std::atomic_size_t next = 0;
+    auto probe = [&, &excludedDevices = mExcludedDevices]() {
+        for (size_t i = next++; i < devicePaths.size(); i = next++) {
+            const nsecs_t probeStart = systemTime(SYSTEM_TIME_MONOTONIC);
+            probedDevices[i] = probeDevice(devicePaths[i], deviceIds[i], excludedDevices);
+            if (probedDevices[i]) {
+                probedDevices[i]->device->openDuration =
+                        systemTime(SYSTEM_TIME_MONOTONIC) - probeStart;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(devicePaths.size(), MAX_DEVICE_PROBE_THREADS); i++) {
+        threads.emplace_back(probe);
+    }
+    probe();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (std::optional<ProbedDevice>& probedDevice : probedDevices) {
+        if (probedDevice) {
+            addProbedDeviceLocked(std::move(*probedDevice));
+        }
     }
+    mLastScan = {.deviceCount = devicePaths.size(),
+                 .threadCount = threads.size() + 1,
+                 .duration = systemTime(SYSTEM_TIME_MONOTONIC) - start};
     return 0;
 }
 
@@ -2841,6 +2935,9 @@ void EventHub::dump(std::string& dump) const {
         std::scoped_lock _l(mLock);
 
         dump += StringPrintf(INDENT "BuiltInKeyboardId: %d\n", mBuiltInKeyboardId);
+        dump += StringPrintf(INDENT "LastDeviceScan: %zu devices on %zu threads in %.1fms\n",
+                             mLastScan.deviceCount, mLastScan.threadCount,
+                             mLastScan.duration / 1E6);
 
         dump += INDENT "Devices:\n";
 
@@ -2855,6 +2952,7 @@ void EventHub::dump(std::string& dump) const {
             dump += StringPrintf(INDENT3 "Classes: %s\n", device->classes.string().c_str());
             dump += StringPrintf(INDENT3 "Path: %s\n", device->path.c_str());
             dump += StringPrintf(INDENT3 "Enabled: %s\n", toString(device->enabled));
+            dump += StringPrintf(INDENT3 "OpenTime: %.1fms\n", device->openDuration / 1E6);
             dump += StringPrintf(INDENT3 "Descriptor: %s\n", device->identifier.descriptor.c_str());
             dump += StringPrintf(INDENT3 "Location: %s\n", device->identifier.location.c_str());
             dump += StringPrintf(INDENT3 "ControllerNumber: %d\n", device->controllerNumber);
@@ -2883,6 +2981,14 @@ void EventHub::dump(std::string& dump) const {
                                  device->associatedDevice
                                          ? device->associatedDevice->sysfsRootPath.c_str()
                                          : "<none>");
+            const Device::ReadStats& stats = device->readStats;
+            dump += StringPrintf(INDENT3 "Reads: count=%zu, events=%zu, bufferSize=%zu, "
+                                         "averageLatency=%.3fms, maxLatency=%.3fms\n",
+                                 stats.readCount, stats.eventCount, device->readBuffer.size(),
+                                 stats.eventCount == 0
+                                         ? 0.0
+                                         : stats.totalLatency / (stats.eventCount * 1E6),
+                                 stats.maxLatency / 1E6);
             if (device->keyBitmask.any(0, KEY_MAX + 1)) {
                 const auto pressedKeys = device->keyState.dumpSetIndices(", ", [](int i) {
                     return InputEventLookup::getLinuxEvdevLabel(EV_KEY, i, 1).code;
@@ -18,6 +18,7 @@
 
 #include "InputReader.h"
 
+#include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <errno.h>
 #include <input/Keyboard.h>
@@ -41,6 +42,22 @@ namespace android {
 
 namespace {
 
+// The upper bound of the ro.input.reader.parallel_device_threads property. The devices that can be
+// processed in parallel are few, so more threads than this would only sit idle.
+constexpr size_t MAX_PARALLEL_DEVICE_THREADS = 4;
+
+// The classes of the devices whose mappers only change the state of their own device, or reader
+// state that is guarded by mSharedStateLock, while they process events. Only such devices are
+// processed in parallel. Keyboards, for instance, change the global meta state.
+constexpr ftl::Flags<InputDeviceClass> PARALLEL_DEVICE_CLASSES = InputDeviceClass::TOUCH |
+        InputDeviceClass::TOUCH_MT | InputDeviceClass::CURSOR | InputDeviceClass::TOUCHPAD |
+        InputDeviceClass::EXTERNAL_STYLUS | InputDeviceClass::BATTERY | InputDeviceClass::VIRTUAL |
+        InputDeviceClass::EXTERNAL;
+
+// The classes of the devices that share state through external stylus fusion.
+constexpr ftl::Flags<InputDeviceClass> STYLUS_FUSION_DEVICE_CLASSES =
+        InputDeviceClass::TOUCH | InputDeviceClass::EXTERNAL_STYLUS;
+
 /**
  * Determines if the identifiers passed are a sub-devices. Sub-devices are physical devices
  * that expose multiple input device paths such a keyboard that also has a touchpad input.
@@ -92,8 +109,94 @@ std::optional<DeviceId> getDeviceIdOfNewGesture(const NotifyArgs& args) {
     return std::nullopt;
 }
 
+// The time of the event, or LLONG_MIN for the arguments that do not have one.
+nsecs_t getEventTime(const NotifyArgs& args) {
+    return std::visit(
+            [](const auto& args) -> nsecs_t {
+                if constexpr (requires { args.eventTime; }) {
+                    return args.eventTime;
+                } else {
+                    return LLONG_MIN;
+                }
+            },
+            args);
+}
+
 } // namespace
 
+// --- InputReader::DeviceWorkerPool ---
+
+/**
+ * A fixed set of worker threads that run the tasks of a batch, along with the thread that submits
+ * the batch.
+ */
+class InputReader::DeviceWorkerPool {
+public:
+    explicit DeviceWorkerPool(size_t threadCount) : mExiting(threadCount, false) {
+        for (size_t i = 0; i < threadCount; i++) {
+            mThreads.push_back(std::make_unique<InputThread>(
+                    "InputReaderPool", [this, i]() { runTasks(i); }, [this, i]() { wake(i); }));
+        }
+    }
+
+    // Run task(0) to task(count - 1), and return once all of them are done.
+    void run(size_t count, const std::function<void(size_t)>& task) {
+        std::unique_lock lock(mLock);
+        mTask = &task;
+        mTaskCount = count;
+        mNextTask = 0;
+        mPendingTasks = count;
+        mWorkAvailable.notify_all();
+        while (mNextTask < mTaskCount) {
+            runNextTaskLocked(lock);
+        }
+        mWorkDone.wait(lock, [this]() { return mPendingTasks == 0; });
+        mTask = nullptr;
+    }
+
+private:
+    // The loop of a worker thread.
+    void runTasks(size_t worker) {
+        std::unique_lock lock(mLock);
+        mWorkAvailable.wait(lock,
+                            [&]() { return mExiting[worker] || mNextTask < mTaskCount; });
+        while (!mExiting[worker] && mNextTask < mTaskCount) {
+            runNextTaskLocked(lock);
+        }
+    }
+
+    void runNextTaskLocked(std::unique_lock<std::mutex>& lock) {
+        const size_t index = mNextTask++;
+        const std::function<void(size_t)>& task = *mTask;
+        lock.unlock();
+        task(index);
+        lock.lock();
+        if (--mPendingTasks == 0) {
+            mWorkDone.notify_all();
+        }
+    }
+
+    // Called when the thread of the worker is being destroyed.
+    void wake(size_t worker) {
+        std::scoped_lock lock(mLock);
+        mExiting[worker] = true;
+        mWorkAvailable.notify_all();
+    }
+
+    // Guards all of the state below, except for the threads.
+    std::mutex mLock;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mWorkDone;
+    const std::function<void(size_t)>* mTask = nullptr;
+    size_t mTaskCount = 0;
+    size_t mNextTask = 0;
+    size_t mPendingTasks = 0;
+    std::vector<bool> mExiting;
+
+    // Declared last, so that the threads stop before the state they use is destroyed.
+    std::vector<std::unique_ptr<InputThread>> mThreads;
+};
+
 // --- InputReader ---
 
 InputReader::InputReader(std::shared_ptr<EventHubInterface> eventHub,
@@ -113,10 +216,20 @@ InputReader::InputReader(std::shared_ptr<EventHubInterface> eventHub,
         mConfigurationChangesToRefresh(0) {
     refreshConfigurationLocked(/*changes=*/{});
     updateGlobalMetaStateLocked();
+    setParallelDeviceThreadCount(
+            base::GetUintProperty<size_t>("ro.input.reader.parallel_device_threads",
+                                          /*default_value=*/0, MAX_PARALLEL_DEVICE_THREADS));
 }
 
 InputReader::~InputReader() {}
 
+void InputReader::setParallelDeviceThreadCount(size_t threadCount) {
+    std::unique_ptr<DeviceWorkerPool> pool =
+            threadCount > 0 ? std::make_unique<DeviceWorkerPool>(threadCount) : nullptr;
+    std::scoped_lock _l(mLock);
+    std::swap(pool, mDeviceWorkerPool);
+}
+
 status_t InputReader::start() {
     if (mThread) {
         return ALREADY_EXISTS;
@@ -231,18 +344,13 @@ std::list<NotifyArgs> InputReader::processEventsLocked(const RawEvent* rawEvents
         int32_t type = rawEvent->type;
         size_t batchSize = 1;
         if (type < EventHubInterface::FIRST_SYNTHETIC_EVENT) {
-            int32_t deviceId = rawEvent->deviceId;
-            while (batchSize < count) {
-                if (rawEvent[batchSize].type >= EventHubInterface::FIRST_SYNTHETIC_EVENT ||
-                    rawEvent[batchSize].deviceId != deviceId) {
-                    break;
-                }
+            // Take the events of all devices up to the next synthetic event, so that the events of
+            // independent devices can be processed in parallel.
+            while (batchSize < count &&
+                   rawEvent[batchSize].type < EventHubInterface::FIRST_SYNTHETIC_EVENT) {
                 batchSize += 1;
             }
-            if (debugRawEvents()) {
-                ALOGD("BatchSize: %zu Count: %zu", batchSize, count);
-            }
-            out += processEventsForDeviceLocked(deviceId, rawEvent, batchSize);
+            out += processDeviceEventsLocked(rawEvent, batchSize);
         } else {
             switch (rawEvent->type) {
                 case EventHubInterface::DEVICE_ADDED:
@@ -262,6 +370,121 @@ std::list<NotifyArgs> InputReader::processEventsLocked(const RawEvent* rawEvents
     return out;
 }
 
+std::list<NotifyArgs> InputReader::processDeviceEventsLocked(const RawEvent* rawEvents,
+                                                             size_t count) {
+    if (mDeviceWorkerPool != nullptr) {
+        std::optional<std::list<NotifyArgs>> out =
+                processDeviceEventsInParallelLocked(rawEvents, count);
+        if (out) {
+            return std::move(*out);
+        }
+    }
+
+    std::list<NotifyArgs> out;
+    for (const RawEvent* rawEvent = rawEvents; count;) {
+        int32_t deviceId = rawEvent->deviceId;
+        size_t batchSize = 1;
+        while (batchSize < count && rawEvent[batchSize].deviceId == deviceId) {
+            batchSize += 1;
+        }
+        if (debugRawEvents()) {
+            ALOGD("BatchSize: %zu Count: %zu", batchSize, count);
+        }
+        out += processEventsForDeviceLocked(deviceId, rawEvent, batchSize);
+        count -= batchSize;
+        rawEvent += batchSize;
+    }
+    return out;
+}
+
+std::optional<std::list<NotifyArgs>> InputReader::processDeviceEventsInParallelLocked(
+        const RawEvent* rawEvents, size_t count) {
+    struct Batch {
+        InputDevice* device;
+        const RawEvent* rawEvents;
+        size_t count;
+    };
+    // The devices of a group are processed one after the other, in the order of their events.
+    struct Group {
+        InputDevice* key;
+        std::vector<Batch> batches;
+        std::list<NotifyArgs> out;
+    };
+
+    // All of the touch devices react to the state of an external stylus, so they are processed
+    // along with the external stylus devices while there is one.
+    const bool hasExternalStylus =
+            std::any_of(mDevices.begin(), mDevices.end(), [](const auto& devicePair) {
+                InputDevice& device = *devicePair.second;
+                return device.getClasses().test(InputDeviceClass::EXTERNAL_STYLUS) &&
+                        !device.isIgnored();
+            });
+
+    std::vector<Group> groups;
+    for (const RawEvent* rawEvent = rawEvents; count;) {
+        int32_t eventHubId = rawEvent->deviceId;
+        size_t batchSize = 1;
+        while (batchSize < count && rawEvent[batchSize].deviceId == eventHubId) {
+            batchSize += 1;
+        }
+        auto deviceIt = mDevices.find(eventHubId);
+        if (deviceIt != mDevices.end() && !deviceIt->second->isIgnored()) {
+            InputDevice* device = deviceIt->second.get();
+            const ftl::Flags<InputDeviceClass> classes = device->getClasses();
+            if (!PARALLEL_DEVICE_CLASSES.all(classes)) {
+                return std::nullopt;
+            }
+            InputDevice* key =
+                    hasExternalStylus && classes.any(STYLUS_FUSION_DEVICE_CLASSES) ? nullptr
+                                                                                   : device;
+            auto groupIt = std::find_if(groups.begin(), groups.end(),
+                                        [key](const Group& group) { return group.key == key; });
+            if (groupIt == groups.end()) {
+                groupIt = groups.insert(groups.end(), Group{.key = key});
+            }
+            groupIt->batches.push_back({device, rawEvent, batchSize});
+        } else {
+            // Let the serial path report the events of unknown devices.
+            return std::nullopt;
+        }
+        count -= batchSize;
+        rawEvent += batchSize;
+    }
+    if (groups.size() < 2) {
+        return std::nullopt;
+    }
+
+    mDeviceWorkerPool->run(groups.size(), [&groups](size_t index) {
+        Group& group = groups[index];
+        for (const Batch& batch : group.batches) {
+            group.out += batch.device->process(batch.rawEvents, batch.count);
+        }
+    });
+
+    // Merge the output of the groups in the order of the event times. The arguments without a
+    // time stay right after the ones that their group produced before them.
+    std::list<NotifyArgs> out;
+    while (true) {
+        Group* next = nullptr;
+        nsecs_t nextTime = LLONG_MAX;
+        for (Group& group : groups) {
+            if (group.out.empty()) {
+                continue;
+            }
+            const nsecs_t time = getEventTime(group.out.front());
+            if (next == nullptr || time < nextTime) {
+                next = &group;
+                nextTime = time;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+        out.splice(out.end(), next->out, next->out.begin());
+    }
+    return out;
+}
+
 void InputReader::addDeviceLocked(nsecs_t when, int32_t eventHubId) {
     if (mDevices.find(eventHubId) != mDevices.end()) {
         ALOGW("Ignoring spurious device added event for eventHubId %d.", eventHubId);
@@ -1037,23 +1260,27 @@ nsecs_t InputReader::ContextImpl::getLastKeyDownTimestamp() {
 }
 
 void InputReader::ContextImpl::disableVirtualKeysUntil(nsecs_t time) {
-    // lock is already held by the input loop
+    // lock is already held by the input loop, which may be processing devices in parallel
+    std::scoped_lock _l(mReader->mSharedStateLock);
     mReader->disableVirtualKeysUntilLocked(time);
 }
 
 bool InputReader::ContextImpl::shouldDropVirtualKey(nsecs_t now, int32_t keyCode,
                                                     int32_t scanCode) {
-    // lock is already held by the input loop
+    // lock is already held by the input loop, which may be processing devices in parallel
+    std::scoped_lock _l(mReader->mSharedStateLock);
     return mReader->shouldDropVirtualKeyLocked(now, keyCode, scanCode);
 }
 
 void InputReader::ContextImpl::requestTimeoutAtTime(nsecs_t when) {
-    // lock is already held by the input loop
+    // lock is already held by the input loop, which may be processing devices in parallel
+    std::scoped_lock _l(mReader->mSharedStateLock);
     mReader->requestTimeoutAtTimeLocked(when);
 }
 
 int32_t InputReader::ContextImpl::bumpGeneration() {
-    // lock is already held by the input loop
+    // lock is already held by the input loop, which may be processing devices in parallel
+    std::scoped_lock _l(mReader->mSharedStateLock);
     return mReader->bumpGenerationLocked();
 }
 
@@ -26,8 +26,10 @@
 #include <sys/mman.h>
 #include <unistd.h>
 #include <iostream>
+#include <mutex>
 
 #include <android-base/stringprintf.h>
+#include <android-base/thread_annotations.h>
 #include <android-base/unique_fd.h>
 #include <log/log.h>
 
@@ -36,6 +38,69 @@ using android::base::unique_fd;
 
 namespace android {
 
+class TouchVideoDevice::FramePool : public std::enable_shared_from_this<FramePool> {
+public:
+    /**
+     * How many released arrays to keep. Frames are dropped from the queue of the device beyond
+     * MAX_QUEUE_SIZE, so more than that are rarely in flight at once.
+     */
+    static constexpr size_t MAX_FREE_FRAMES = MAX_QUEUE_SIZE;
+
+    explicit FramePool(size_t frameSize) : mFrameSize(frameSize) {}
+
+    /**
+     * Get an array of the size of a frame, with undefined contents. The pool may be destroyed
+     * before the array is released, in which case the array is freed instead.
+     */
+    std::shared_ptr<std::vector<int16_t>> acquire() {
+        std::unique_ptr<std::vector<int16_t>> data;
+        {
+            std::scoped_lock lock(mLock);
+            mInFlight++;
+            if (!mFree.empty()) {
+                data = std::move(mFree.back());
+                mFree.pop_back();
+                mReused++;
+            } else {
+                mAllocated++;
+            }
+        }
+        if (!data) {
+            data = std::make_unique<std::vector<int16_t>>(mFrameSize);
+        }
+        std::weak_ptr<FramePool> weakPool = weak_from_this();
+        auto recycle = [weakPool](std::vector<int16_t>* released) {
+            std::unique_ptr<std::vector<int16_t>> owned(released);
+            if (std::shared_ptr<FramePool> pool = weakPool.lock()) {
+                pool->release(std::move(owned));
+            }
+        };
+        return std::shared_ptr<std::vector<int16_t>>(data.release(), recycle);
+    }
+
+    std::string dump() const {
+        std::scoped_lock lock(mLock);
+        return StringPrintf("%zu allocated, %zu reused, %zu in flight, %zu free", mAllocated,
+                            mReused, mInFlight, mFree.size());
+    }
+
+private:
+    void release(std::unique_ptr<std::vector<int16_t>> data) {
+        std::scoped_lock lock(mLock);
+        mInFlight--;
+        if (mFree.size() < MAX_FREE_FRAMES) {
+            mFree.push_back(std::move(data));
+        }
+    }
+
+    const size_t mFrameSize;
+    mutable std::mutex mLock;
+    std::vector<std::unique_ptr<std::vector<int16_t>>> mFree GUARDED_BY(mLock);
+    size_t mAllocated GUARDED_BY(mLock) = 0;
+    size_t mReused GUARDED_BY(mLock) = 0;
+    size_t mInFlight GUARDED_BY(mLock) = 0;
+};
+
 TouchVideoDevice::TouchVideoDevice(int fd, std::string&& name, std::string&& devicePath,
                                    uint32_t height, uint32_t width,
                                    const std::array<const int16_t*, NUM_BUFFERS>& readLocations)
@@ -44,7 +109,8 @@ TouchVideoDevice::TouchVideoDevice(int fd, std::string&& name, std::string&& dev
         mPath(std::move(devicePath)),
         mHeight(height),
         mWidth(width),
-        mReadLocations(readLocations) {
+        mReadLocations(readLocations),
+        mFramePool(std::make_shared<FramePool>(height * width)) {
     mFrames.reserve(MAX_QUEUE_SIZE);
 };
 
@@ -202,10 +268,13 @@ std::optional<TouchVideoFrame> TouchVideoDevice::readFrame() {
               static_cast<long long>(buf.timestamp.tv_sec),
               static_cast<long long>(buf.timestamp.tv_usec));
     }
-    std::vector<int16_t> data(mHeight * mWidth);
+    // The buffer is copied out, rather than shared, because the driver only has NUM_BUFFERS of
+    // them and needs it back to write the next frame into.
+    std::shared_ptr<std::vector<int16_t>> data = mFramePool->acquire();
     const int16_t* readFrom = mReadLocations[buf.index];
-    std::copy(readFrom, readFrom + mHeight * mWidth, data.begin());
-    TouchVideoFrame frame(mHeight, mWidth, std::move(data), buf.timestamp);
+    std::copy(readFrom, readFrom + mHeight * mWidth, data->begin());
+    TouchVideoFrame frame =
+            TouchVideoFrame::fromSharedData(mHeight, mWidth, std::move(data), buf.timestamp);
 
     result = ioctl(mFd.get(), VIDIOC_QBUF, &buf);
     if (result == -1) {
@@ -248,9 +317,9 @@ TouchVideoDevice::~TouchVideoDevice() {
 
 std::string TouchVideoDevice::dump() const {
     return StringPrintf("Video device %s (%s) : height=%" PRIu32 ", width=%" PRIu32
-                        ", fd=%i, hasValidFd=%s",
+                        ", fd=%i, hasValidFd=%s, frames=(%s)",
                         mName.c_str(), mPath.c_str(), mHeight, mWidth, mFd.get(),
-                        hasValidFd() ? "true" : "false");
+                        hasValidFd() ? "true" : "false", mFramePool->dump().c_str());
 }
 
 } // namespace android
@@ -624,7 +624,9 @@ private:
         int fd; // may be -1 if device is closed
         const int32_t id;
         const std::string path;
-        const InputDeviceIdentifier identifier;
+        // The descriptor is filled in once the device is probed, as it must differ from the
+        // descriptors of the other devices.
+        InputDeviceIdentifier identifier;
 
         std::unique_ptr<TouchVideoDevice> videoDevice;
 
@@ -692,12 +694,50 @@ private:
         bool currentFrameDropped;
         void trackInputEvent(const struct input_event& event);
         void readDeviceState();
+
+        // The buffer that the events are read into. It grows when a read fills it up, so that a
+        // device that reports many events at once is drained with fewer reads.
+        std::vector<struct input_event> readBuffer;
+
+        // Statistics about the reads from the device, for dumpsys.
+        struct ReadStats {
+            size_t readCount = 0;
+            size_t eventCount = 0;
+            // Time between the timestamp of the events and their read.
+            nsecs_t totalLatency = 0;
+            nsecs_t maxLatency = 0;
+        };
+        ReadStats readStats;
+
+        // The time it took to open the device, for dumpsys.
+        nsecs_t openDuration = 0;
+    };
+
+    // A device that was opened and classified, but not yet added to the EventHub.
+    struct ProbedDevice {
+        std::unique_ptr<Device> device;
+        bool keyMapLoaded;
     };
 
     /**
      * Create a new device for the provided path.
      */
     void openDeviceLocked(const std::string& devicePath) REQUIRES(mLock);
+    bool hasDeviceWithPathLocked(const std::string& devicePath) const REQUIRES(mLock);
+    /**
+     * Open the device at the provided path, read what it reports and load its configuration
+     * files. This does not use the state of the EventHub, so several devices can be probed at
+     * once. Returns nullopt if the device cannot be opened, is excluded, or is of no class that
+     * is handled.
+     */
+    static std::optional<ProbedDevice> probeDevice(const std::string& devicePath,
+                                                   int32_t deviceId,
+                                                   const std::vector<std::string>& excludedDevices);
+    /**
+     * Finish opening a probed device with the parts that depend on the other devices, such as its
+     * descriptor, and add it.
+     */
+    void addProbedDeviceLocked(ProbedDevice probedDevice) REQUIRES(mLock);
     void openVideoDeviceLocked(const std::string& devicePath) REQUIRES(mLock);
     /**
      * Try to associate a video device with an input device. If the association succeeds,
@@ -790,6 +830,14 @@ private:
     bool mNeedToScanDevices;
     std::vector<std::string> mExcludedDevices;
 
+    // The most recent scan of the input devices directory, for dumpsys.
+    struct DeviceScan {
+        size_t deviceCount = 0;
+        size_t threadCount = 0;
+        nsecs_t duration = 0;
+    };
+    DeviceScan mLastScan;
+
     int mEpollFd;
     int mINotifyFd;
     int mWakeReadPipeFd;
@@ -130,6 +130,10 @@ protected:
     // the EventHub.
     void loopOnce();
 
+    // Process the events of independent devices on threadCount worker threads, in addition to the
+    // reader thread. With no worker threads, all of the events are processed on the reader thread.
+    void setParallelDeviceThreadCount(size_t threadCount) EXCLUDES(mLock);
+
     class ContextImpl : public InputReaderContext {
         InputReader* mReader;
         IdGenerator mIdGenerator;
@@ -210,10 +214,24 @@ private:
     // The input device that produced a new gesture most recently.
     DeviceId mLastUsedDeviceId GUARDED_BY(mLock){ReservedInputDeviceId::INVALID_INPUT_DEVICE_ID};
 
+    // Processes the events of independent devices in parallel. Null when that is disabled.
+    class DeviceWorkerPool;
+    std::unique_ptr<DeviceWorkerPool> mDeviceWorkerPool GUARDED_BY(mLock);
+
+    // While devices are processed in parallel, their mappers can reach the reader state through
+    // the context from several threads at once. This guards the parts of that state that they
+    // change: the timeout, the virtual key disabling and the generation.
+    std::mutex mSharedStateLock;
+
     // low-level input event decoding and device management
     [[nodiscard]] std::list<NotifyArgs> processEventsLocked(const RawEvent* rawEvents, size_t count)
             REQUIRES(mLock);
 
+    [[nodiscard]] std::list<NotifyArgs> processDeviceEventsLocked(const RawEvent* rawEvents,
+                                                                  size_t count) REQUIRES(mLock);
+    [[nodiscard]] std::optional<std::list<NotifyArgs>> processDeviceEventsInParallelLocked(
+            const RawEvent* rawEvents, size_t count) REQUIRES(mLock);
+
     void addDeviceLocked(nsecs_t when, int32_t eventHubId) REQUIRES(mLock);
     void removeDeviceLocked(nsecs_t when, int32_t eventHubId) REQUIRES(mLock);
     [[nodiscard]] std::list<NotifyArgs> processEventsForDeviceLocked(int32_t eventHubId,
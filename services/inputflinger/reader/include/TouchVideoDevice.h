@@ -20,6 +20,7 @@
 #include <input/TouchVideoFrame.h>
 #include <stdint.h>
 #include <array>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -103,6 +104,14 @@ private:
      */
     static constexpr size_t MAX_QUEUE_SIZE = 20;
     std::vector<TouchVideoFrame> mFrames;
+    /**
+     * The arrays that the frames are read into. The copies of a frame share its array, which is
+     * returned to the pool once the last of them is released, wherever it was passed to.
+     * Reading frames at the rate of the panel therefore does not allocate once the pool has
+     * grown to the number of frames in flight.
+     */
+    class FramePool;
+    std::shared_ptr<FramePool> mFramePool;
 
     /**
      * The constructor is private because opening a v4l2 device requires many checks.
@@ -1278,6 +1278,30 @@ void TouchInputMapper::resolveCalibration() {
     } else {
         mCalibration.distanceCalibration = Calibration::DistanceCalibration::NONE;
     }
+
+    // Size sources
+    using Pointer = RawPointerData::Pointer;
+    mSizeSources = {};
+    if (mRawPointerAxes.touchMajor) {
+        mSizeSources.touchMajor = &Pointer::touchMajor;
+        mSizeSources.touchMinor =
+                mRawPointerAxes.touchMinor ? &Pointer::touchMinor : &Pointer::touchMajor;
+    }
+    if (mRawPointerAxes.toolMajor) {
+        mSizeSources.toolMajor = &Pointer::toolMajor;
+        mSizeSources.toolMinor =
+                mRawPointerAxes.toolMinor ? &Pointer::toolMinor : &Pointer::toolMajor;
+    }
+    if (!mSizeSources.touchMajor) {
+        mSizeSources.touchMajor = mSizeSources.toolMajor;
+        mSizeSources.touchMinor = mSizeSources.toolMinor;
+    }
+    if (!mSizeSources.toolMajor) {
+        mSizeSources.toolMajor = mSizeSources.touchMajor;
+        mSizeSources.toolMinor = mSizeSources.touchMinor;
+    }
+    mSizeCalibrationScale = mCalibration.sizeScale.value_or(1.0f);
+    mSizeCalibrationBias = mCalibration.sizeBias.value_or(0.0f);
 }
 
 void TouchInputMapper::dumpCalibration(std::string& dump) {
@@ -2229,210 +2253,248 @@ const BitSet32& TouchInputMapper::findActiveIdBits(const CookedPointerData& cook
 }
 
 void TouchInputMapper::cookPointerData() {
-    uint32_t currentPointerCount = mCurrentRawState.rawPointerData.pointerCount;
+    const RawPointerData& raw = mCurrentRawState.rawPointerData;
+    const uint32_t currentPointerCount = raw.pointerCount;
+    CookedPointerData& cooked = mCurrentCookedState.cookedPointerData;
 
-    mCurrentCookedState.cookedPointerData.clear();
-    mCurrentCookedState.cookedPointerData.pointerCount = currentPointerCount;
-    mCurrentCookedState.cookedPointerData.hoveringIdBits =
-            mCurrentRawState.rawPointerData.hoveringIdBits;
-    mCurrentCookedState.cookedPointerData.touchingIdBits =
-            mCurrentRawState.rawPointerData.touchingIdBits;
-    mCurrentCookedState.cookedPointerData.canceledIdBits =
-            mCurrentRawState.rawPointerData.canceledIdBits;
+    cooked.clear();
+    cooked.pointerCount = currentPointerCount;
+    cooked.hoveringIdBits = raw.hoveringIdBits;
+    cooked.touchingIdBits = raw.touchingIdBits;
+    cooked.canceledIdBits = raw.canceledIdBits;
 
-    if (mCurrentCookedState.cookedPointerData.pointerCount == 0) {
+    if (cooked.pointerCount == 0) {
         mCurrentCookedState.buttonState = 0;
     } else {
         mCurrentCookedState.buttonState = mCurrentRawState.buttonState;
     }
 
-    // Walk through the the active pointers and map device coordinates onto
-    // display coordinates and adjust for display orientation.
-    for (uint32_t i = 0; i < currentPointerCount; i++) {
-        const RawPointerData::Pointer& in = mCurrentRawState.rawPointerData.pointers[i];
-
-        // Size
-        float touchMajor, touchMinor, toolMajor, toolMinor, size;
-        switch (mCalibration.sizeCalibration) {
-            case Calibration::SizeCalibration::GEOMETRIC:
-            case Calibration::SizeCalibration::DIAMETER:
-            case Calibration::SizeCalibration::BOX:
-            case Calibration::SizeCalibration::AREA:
-                if (mRawPointerAxes.touchMajor && mRawPointerAxes.toolMajor) {
-                    touchMajor = in.touchMajor;
-                    touchMinor = mRawPointerAxes.touchMinor ? in.touchMinor : in.touchMajor;
-                    toolMajor = in.toolMajor;
-                    toolMinor = mRawPointerAxes.toolMinor ? in.toolMinor : in.toolMajor;
-                    size = mRawPointerAxes.touchMinor ? avg(in.touchMajor, in.touchMinor)
-                                                      : in.touchMajor;
-                } else if (mRawPointerAxes.touchMajor) {
-                    toolMajor = touchMajor = in.touchMajor;
-                    toolMinor = touchMinor =
-                            mRawPointerAxes.touchMinor ? in.touchMinor : in.touchMajor;
-                    size = mRawPointerAxes.touchMinor ? avg(in.touchMajor, in.touchMinor)
-                                                      : in.touchMajor;
-                } else if (mRawPointerAxes.toolMajor) {
-                    touchMajor = toolMajor = in.toolMajor;
-                    touchMinor = toolMinor =
-                            mRawPointerAxes.toolMinor ? in.toolMinor : in.toolMajor;
-                    size = mRawPointerAxes.toolMinor ? avg(in.toolMajor, in.toolMinor)
-                                                     : in.toolMajor;
-                } else {
-                    ALOG_ASSERT(false,
-                                "No touch or tool axes.  "
-                                "Size calibration should have been resolved to NONE.");
-                    touchMajor = 0;
-                    touchMinor = 0;
-                    toolMajor = 0;
-                    toolMinor = 0;
-                    size = 0;
-                }
-
-                if (mCalibration.sizeIsSummed && *mCalibration.sizeIsSummed) {
-                    uint32_t touchingCount = mCurrentRawState.rawPointerData.touchingIdBits.count();
-                    if (touchingCount > 1) {
-                        touchMajor /= touchingCount;
-                        touchMinor /= touchingCount;
-                        toolMajor /= touchingCount;
-                        toolMinor /= touchingCount;
-                        size /= touchingCount;
-                    }
-                }
-
-                if (mCalibration.sizeCalibration == Calibration::SizeCalibration::GEOMETRIC) {
-                    touchMajor *= mGeometricScale;
-                    touchMinor *= mGeometricScale;
-                    toolMajor *= mGeometricScale;
-                    toolMinor *= mGeometricScale;
-                } else if (mCalibration.sizeCalibration == Calibration::SizeCalibration::AREA) {
-                    touchMajor = touchMajor > 0 ? sqrtf(touchMajor) : 0;
-                    touchMinor = touchMajor;
-                    toolMajor = toolMajor > 0 ? sqrtf(toolMajor) : 0;
-                    toolMinor = toolMajor;
-                } else if (mCalibration.sizeCalibration == Calibration::SizeCalibration::DIAMETER) {
-                    touchMinor = touchMajor;
-                    toolMinor = toolMajor;
-                }
-
-                mCalibration.applySizeScaleAndBias(touchMajor);
-                mCalibration.applySizeScaleAndBias(touchMinor);
-                mCalibration.applySizeScaleAndBias(toolMajor);
-                mCalibration.applySizeScaleAndBias(toolMinor);
-                size *= mSizeScale;
-                break;
-            case Calibration::SizeCalibration::DEFAULT:
-                LOG_ALWAYS_FATAL("Resolution should not be 'DEFAULT' at this point");
-                break;
-            case Calibration::SizeCalibration::NONE:
-                touchMajor = 0;
-                touchMinor = 0;
-                toolMajor = 0;
-                toolMinor = 0;
-                size = 0;
-                break;
-        }
-
-        // Pressure
-        float pressure;
-        switch (mCalibration.pressureCalibration) {
-            case Calibration::PressureCalibration::PHYSICAL:
-            case Calibration::PressureCalibration::AMPLITUDE:
-                pressure = in.pressure * mPressureScale;
-                break;
-            default:
-                pressure = in.isHovering ? 0 : 1;
-                break;
-        }
+    // Cook the axes of all of the pointers one step at a time. The steps branch on the
+    // calibration once rather than for each pointer. The orientation step runs after the size
+    // step because a vector orientation scales the sizes.
+    CookedAxes axes;
+    cookSizes(raw, axes);
+    cookPressures(raw, axes);
+    cookOrientations(raw, axes);
+    cookDistances(raw, axes);
+    cookCoordinates(raw, axes);
 
-        // Tilt and Orientation
-        float tilt;
-        float orientation;
-        if (mHaveTilt) {
-            float tiltXAngle = (in.tiltX - mTiltXCenter) * mTiltXScale;
-            float tiltYAngle = (in.tiltY - mTiltYCenter) * mTiltYScale;
-            orientation = transformAngle(mRawRotation, atan2f(-sinf(tiltXAngle), sinf(tiltYAngle)),
-                                         /*isDirectional=*/true);
-            tilt = acosf(cosf(tiltXAngle) * cosf(tiltYAngle));
-        } else {
-            tilt = 0;
-
-            switch (mCalibration.orientationCalibration) {
-                case Calibration::OrientationCalibration::INTERPOLATED:
-                    orientation = transformAngle(mRawRotation, in.orientation * mOrientationScale,
-                                                 /*isDirectional=*/true);
-                    break;
-                case Calibration::OrientationCalibration::VECTOR: {
-                    int32_t c1 = signExtendNybble((in.orientation & 0xf0) >> 4);
-                    int32_t c2 = signExtendNybble(in.orientation & 0x0f);
-                    if (c1 != 0 || c2 != 0) {
-                        orientation = transformAngle(mRawRotation, atan2f(c1, c2) * 0.5f,
-                                                     /*isDirectional=*/true);
-                        float confidence = hypotf(c1, c2);
-                        float scale = 1.0f + confidence / 16.0f;
-                        touchMajor *= scale;
-                        touchMinor /= scale;
-                        toolMajor *= scale;
-                        toolMinor /= scale;
-                    } else {
-                        orientation = 0;
-                    }
-                    break;
-                }
-                default:
-                    orientation = 0;
-            }
-        }
-
-        // Distance
-        float distance;
-        switch (mCalibration.distanceCalibration) {
-            case Calibration::DistanceCalibration::SCALED:
-                distance = in.distance * mDistanceScale;
-                break;
-            default:
-                distance = 0;
-        }
-
-        // Adjust X,Y coords for device calibration and convert to the natural display coordinates.
-        vec2 transformed = {in.x, in.y};
-        mAffineTransform.applyTo(transformed.x /*byRef*/, transformed.y /*byRef*/);
-        transformed = mRawToDisplay.transform(transformed);
+    for (uint32_t i = 0; i < currentPointerCount; i++) {
+        const RawPointerData::Pointer& in = raw.pointers[i];
 
         // Write output coords.
-        PointerCoords& out = mCurrentCookedState.cookedPointerData.pointerCoords[i];
+        PointerCoords& out = cooked.pointerCoords[i];
         out.clear();
-        out.setAxisValue(AMOTION_EVENT_AXIS_X, transformed.x);
-        out.setAxisValue(AMOTION_EVENT_AXIS_Y, transformed.y);
-        out.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, pressure);
-        out.setAxisValue(AMOTION_EVENT_AXIS_SIZE, size);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, touchMajor);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, touchMinor);
-        out.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, orientation);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TILT, tilt);
-        out.setAxisValue(AMOTION_EVENT_AXIS_DISTANCE, distance);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, toolMajor);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MINOR, toolMinor);
+        out.setAxisValue(AMOTION_EVENT_AXIS_X, axes.x[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_Y, axes.y[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, axes.pressure[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_SIZE, axes.size[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, axes.touchMajor[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, axes.touchMinor[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, axes.orientation[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_TILT, axes.tilt[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_DISTANCE, axes.distance[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, axes.toolMajor[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MINOR, axes.toolMinor[i]);
 
         // Write output relative fields if applicable.
         uint32_t id = in.id;
         if (mSource == AINPUT_SOURCE_TOUCHPAD &&
             mLastCookedState.cookedPointerData.hasPointerCoordsForId(id)) {
             const PointerCoords& p = mLastCookedState.cookedPointerData.pointerCoordsForId(id);
-            float dx = transformed.x - p.getAxisValue(AMOTION_EVENT_AXIS_X);
-            float dy = transformed.y - p.getAxisValue(AMOTION_EVENT_AXIS_Y);
+            float dx = axes.x[i] - p.getAxisValue(AMOTION_EVENT_AXIS_X);
+            float dy = axes.y[i] - p.getAxisValue(AMOTION_EVENT_AXIS_Y);
             out.setAxisValue(AMOTION_EVENT_AXIS_RELATIVE_X, dx);
             out.setAxisValue(AMOTION_EVENT_AXIS_RELATIVE_Y, dy);
         }
 
         // Write output properties.
-        PointerProperties& properties = mCurrentCookedState.cookedPointerData.pointerProperties[i];
+        PointerProperties& properties = cooked.pointerProperties[i];
         properties.clear();
         properties.id = id;
         properties.toolType = in.toolType;
 
         // Write id index and mark id as valid.
-        mCurrentCookedState.cookedPointerData.idToIndex[id] = i;
-        mCurrentCookedState.cookedPointerData.validIdBits.markBit(id);
+        cooked.idToIndex[id] = i;
+        cooked.validIdBits.markBit(id);
+    }
+}
+
+void TouchInputMapper::cookSizes(const RawPointerData& raw, CookedAxes& axes) const {
+    const uint32_t count = raw.pointerCount;
+    const Calibration::SizeCalibration calibration = mCalibration.sizeCalibration;
+    LOG_ALWAYS_FATAL_IF(calibration == Calibration::SizeCalibration::DEFAULT,
+                        "Resolution should not be 'DEFAULT' at this point");
+    if (calibration == Calibration::SizeCalibration::NONE || !mSizeSources.touchMajor) {
+        ALOG_ASSERT(calibration == Calibration::SizeCalibration::NONE,
+                    "No touch or tool axes.  "
+                    "Size calibration should have been resolved to NONE.");
+        std::fill_n(axes.touchMajor.begin(), count, 0.0f);
+        std::fill_n(axes.touchMinor.begin(), count, 0.0f);
+        std::fill_n(axes.toolMajor.begin(), count, 0.0f);
+        std::fill_n(axes.toolMinor.begin(), count, 0.0f);
+        std::fill_n(axes.size.begin(), count, 0.0f);
+        return;
+    }
+
+    const SizeSources& sources = mSizeSources;
+    for (uint32_t i = 0; i < count; i++) {
+        const RawPointerData::Pointer& in = raw.pointers[i];
+        axes.touchMajor[i] = in.*sources.touchMajor;
+        axes.touchMinor[i] = in.*sources.touchMinor;
+        axes.toolMajor[i] = in.*sources.toolMajor;
+        axes.toolMinor[i] = in.*sources.toolMinor;
+        axes.size[i] = avg(in.*sources.touchMajor, in.*sources.touchMinor);
+    }
+
+    if (mCalibration.sizeIsSummed && *mCalibration.sizeIsSummed) {
+        const uint32_t touchingCount = raw.touchingIdBits.count();
+        if (touchingCount > 1) {
+            for (uint32_t i = 0; i < count; i++) {
+                axes.touchMajor[i] /= touchingCount;
+                axes.touchMinor[i] /= touchingCount;
+                axes.toolMajor[i] /= touchingCount;
+                axes.toolMinor[i] /= touchingCount;
+                axes.size[i] /= touchingCount;
+            }
+        }
+    }
+
+    switch (calibration) {
+        case Calibration::SizeCalibration::GEOMETRIC:
+            for (uint32_t i = 0; i < count; i++) {
+                axes.touchMajor[i] *= mGeometricScale;
+                axes.touchMinor[i] *= mGeometricScale;
+                axes.toolMajor[i] *= mGeometricScale;
+                axes.toolMinor[i] *= mGeometricScale;
+            }
+            break;
+        case Calibration::SizeCalibration::AREA:
+            for (uint32_t i = 0; i < count; i++) {
+                axes.touchMajor[i] = axes.touchMajor[i] > 0 ? sqrtf(axes.touchMajor[i]) : 0;
+                axes.touchMinor[i] = axes.touchMajor[i];
+                axes.toolMajor[i] = axes.toolMajor[i] > 0 ? sqrtf(axes.toolMajor[i]) : 0;
+                axes.toolMinor[i] = axes.toolMajor[i];
+            }
+            break;
+        case Calibration::SizeCalibration::DIAMETER:
+            std::copy_n(axes.touchMajor.begin(), count, axes.touchMinor.begin());
+            std::copy_n(axes.toolMajor.begin(), count, axes.toolMinor.begin());
+            break;
+        default:
+            break;
+    }
+
+    // Apply the scale and the bias as separate operations, as the calibration defines them.
+    const auto applyScaleAndBias = [this](float size) {
+        size *= mSizeCalibrationScale;
+        size += mSizeCalibrationBias;
+        return size < 0 ? 0 : size;
+    };
+    for (uint32_t i = 0; i < count; i++) {
+        axes.touchMajor[i] = applyScaleAndBias(axes.touchMajor[i]);
+        axes.touchMinor[i] = applyScaleAndBias(axes.touchMinor[i]);
+        axes.toolMajor[i] = applyScaleAndBias(axes.toolMajor[i]);
+        axes.toolMinor[i] = applyScaleAndBias(axes.toolMinor[i]);
+        axes.size[i] *= mSizeScale;
+    }
+}
+
+void TouchInputMapper::cookPressures(const RawPointerData& raw, CookedAxes& axes) const {
+    const uint32_t count = raw.pointerCount;
+    switch (mCalibration.pressureCalibration) {
+        case Calibration::PressureCalibration::PHYSICAL:
+        case Calibration::PressureCalibration::AMPLITUDE:
+            for (uint32_t i = 0; i < count; i++) {
+                axes.pressure[i] = raw.pointers[i].pressure * mPressureScale;
+            }
+            break;
+        default:
+            for (uint32_t i = 0; i < count; i++) {
+                axes.pressure[i] = raw.pointers[i].isHovering ? 0 : 1;
+            }
+            break;
+    }
+}
+
+void TouchInputMapper::cookOrientations(const RawPointerData& raw, CookedAxes& axes) const {
+    const uint32_t count = raw.pointerCount;
+    if (mHaveTilt) {
+        for (uint32_t i = 0; i < count; i++) {
+            const RawPointerData::Pointer& in = raw.pointers[i];
+            float tiltXAngle = (in.tiltX - mTiltXCenter) * mTiltXScale;
+            float tiltYAngle = (in.tiltY - mTiltYCenter) * mTiltYScale;
+            axes.orientation[i] =
+                    transformAngle(mRawRotation, atan2f(-sinf(tiltXAngle), sinf(tiltYAngle)),
+                                   /*isDirectional=*/true);
+            axes.tilt[i] = acosf(cosf(tiltXAngle) * cosf(tiltYAngle));
+        }
+        return;
+    }
+
+    std::fill_n(axes.tilt.begin(), count, 0.0f);
+    switch (mCalibration.orientationCalibration) {
+        case Calibration::OrientationCalibration::INTERPOLATED:
+            for (uint32_t i = 0; i < count; i++) {
+                const float angle = raw.pointers[i].orientation * mOrientationScale;
+                axes.orientation[i] = transformAngle(mRawRotation, angle, /*isDirectional=*/true);
+            }
+            break;
+        case Calibration::OrientationCalibration::VECTOR:
+            for (uint32_t i = 0; i < count; i++) {
+                const int32_t rawOrientation = raw.pointers[i].orientation;
+                int32_t c1 = signExtendNybble((rawOrientation & 0xf0) >> 4);
+                int32_t c2 = signExtendNybble(rawOrientation & 0x0f);
+                if (c1 != 0 || c2 != 0) {
+                    axes.orientation[i] = transformAngle(mRawRotation, atan2f(c1, c2) * 0.5f,
+                                                         /*isDirectional=*/true);
+                    float confidence = hypotf(c1, c2);
+                    float scale = 1.0f + confidence / 16.0f;
+                    axes.touchMajor[i] *= scale;
+                    axes.touchMinor[i] /= scale;
+                    axes.toolMajor[i] *= scale;
+                    axes.toolMinor[i] /= scale;
+                } else {
+                    axes.orientation[i] = 0;
+                }
+            }
+            break;
+        default:
+            std::fill_n(axes.orientation.begin(), count, 0.0f);
+    }
+}
+
+void TouchInputMapper::cookDistances(const RawPointerData& raw, CookedAxes& axes) const {
+    const uint32_t count = raw.pointerCount;
+    switch (mCalibration.distanceCalibration) {
+        case Calibration::DistanceCalibration::SCALED:
+            for (uint32_t i = 0; i < count; i++) {
+                axes.distance[i] = raw.pointers[i].distance * mDistanceScale;
+            }
+            break;
+        default:
+            std::fill_n(axes.distance.begin(), count, 0.0f);
+    }
+}
+
+void TouchInputMapper::cookCoordinates(const RawPointerData& raw, CookedAxes& axes) const {
+    // Adjust X,Y coords for device calibration and convert to the natural display coordinates.
+    // Both steps are written out with the coefficients of the transforms, so that the loop has
+    // no calls or branches in it.
+    const TouchAffineTransformation& affine = mAffineTransform;
+    const float dsdx = mRawToDisplay.dsdx();
+    const float dtdx = mRawToDisplay.dtdx();
+    const float tx = mRawToDisplay.tx();
+    const float dtdy = mRawToDisplay.dtdy();
+    const float dsdy = mRawToDisplay.dsdy();
+    const float ty = mRawToDisplay.ty();
+    for (uint32_t i = 0; i < raw.pointerCount; i++) {
+        const float rawX = raw.pointers[i].x;
+        const float rawY = raw.pointers[i].y;
+        const float x = rawX * affine.x_scale + rawY * affine.x_ymix + affine.x_offset;
+        const float y = rawX * affine.y_xmix + rawY * affine.y_scale + affine.y_offset;
+        axes.x[i] = dsdx * x + dtdx * y + tx;
+        axes.y[i] = dtdy * x + dsdy * y + ty;
     }
 }
 
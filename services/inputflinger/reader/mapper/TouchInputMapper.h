@@ -310,20 +310,22 @@ protected:
 
         DistanceCalibration distanceCalibration;
         std::optional<float> distanceScale;
-
-        inline void applySizeScaleAndBias(float& outSize) const {
-            if (sizeScale) {
-                outSize *= *sizeScale;
-            }
-            if (sizeBias) {
-                outSize += *sizeBias;
-            }
-            if (outSize < 0) {
-                outSize = 0;
-            }
-        }
     } mCalibration;
 
+    // The raw axes that the touch and tool sizes are read from, resolved along with the
+    // calibration. A device that reports only one of the two sizes uses it for both, and a minor
+    // axis that is not reported is read from the major one.
+    struct SizeSources {
+        int32_t RawPointerData::Pointer::*touchMajor{nullptr};
+        int32_t RawPointerData::Pointer::*touchMinor{nullptr};
+        int32_t RawPointerData::Pointer::*toolMajor{nullptr};
+        int32_t RawPointerData::Pointer::*toolMinor{nullptr};
+    } mSizeSources;
+
+    // The size scale and bias of the calibration, or the values that leave the sizes unchanged.
+    float mSizeCalibrationScale{1.0f};
+    float mSizeCalibrationBias{0.0f};
+
     // Affine location transformation/calibration
     struct TouchAffineTransformation mAffineTransform;
 
@@ -776,6 +778,18 @@ private:
                                                                      nsecs_t readTime);
     const BitSet32& findActiveIdBits(const CookedPointerData& cookedPointerData);
     void cookPointerData();
+
+    // The cooked axes of the current pointers, with one array per axis so that each step of
+    // cooking is a single pass over all of the pointers.
+    struct CookedAxes {
+        std::array<float, MAX_POINTERS> x, y, pressure, size, touchMajor, touchMinor, toolMajor,
+                toolMinor, orientation, tilt, distance;
+    };
+    void cookSizes(const RawPointerData& raw, CookedAxes& axes) const;
+    void cookPressures(const RawPointerData& raw, CookedAxes& axes) const;
+    void cookOrientations(const RawPointerData& raw, CookedAxes& axes) const;
+    void cookDistances(const RawPointerData& raw, CookedAxes& axes) const;
+    void cookCoordinates(const RawPointerData& raw, CookedAxes& axes) const;
     [[nodiscard]] std::list<NotifyArgs> abortTouches(nsecs_t when, nsecs_t readTime,
                                                      uint32_t policyFlags);
 
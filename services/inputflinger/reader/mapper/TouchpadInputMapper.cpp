@@ -435,21 +435,24 @@ std::list<NotifyArgs> TouchpadInputMapper::process(const RawEvent& rawEvent) {
 }
 
 void TouchpadInputMapper::updatePalmDetectionMetrics() {
-    std::set<int32_t> currentTrackingIds;
+    // This runs on every sync, so the tracking IDs are kept sorted in inline storage rather than in
+    // sets.
+    TrackingIds currentTrackingIds;
     for (size_t i = 0; i < mMotionAccumulator.getSlotCount(); i++) {
         const MultiTouchMotionAccumulator::Slot& slot = mMotionAccumulator.getSlot(i);
         if (!slot.isInUse()) {
             continue;
         }
-        currentTrackingIds.insert(slot.getTrackingId());
+        currentTrackingIds.push_back(slot.getTrackingId());
         if (slot.getToolType() == ToolType::PALM) {
             mPalmTrackingIds.insert(slot.getTrackingId());
         }
     }
-    std::vector<int32_t> liftedTouches;
+    std::sort(currentTrackingIds.begin(), currentTrackingIds.end());
+    TrackingIds liftedTouches;
     std::set_difference(mLastFrameTrackingIds.begin(), mLastFrameTrackingIds.end(),
                         currentTrackingIds.begin(), currentTrackingIds.end(),
-                        std::inserter(liftedTouches, liftedTouches.begin()));
+                        std::back_inserter(liftedTouches));
     for (int32_t trackingId : liftedTouches) {
         if (mPalmTrackingIds.erase(trackingId) > 0) {
             MetricsAccumulator::getInstance().recordPalm(mMetricsId);
@@ -461,7 +464,7 @@ void TouchpadInputMapper::updatePalmDetectionMetrics() {
 }
 
 std::list<NotifyArgs> TouchpadInputMapper::sendHardwareState(nsecs_t when, nsecs_t readTime,
-                                                             SelfContainedHardwareState schs) {
+                                                             SelfContainedHardwareState& schs) {
     ALOGD_IF(DEBUG_TOUCHPAD_GESTURES, "New hardware state: %s", schs.state.String().c_str());
     mGestureInterpreter->PushHardwareState(&schs.state);
     return processGestures(when, readTime);
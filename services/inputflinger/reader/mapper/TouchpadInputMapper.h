@@ -22,6 +22,7 @@
 #include <vector>
 
 #include <PointerControllerInterface.h>
+#include <ftl/small_vector.h>
 #include <utils/Timers.h>
 
 #include "CapturedTouchpadEventConverter.h"
@@ -76,7 +77,7 @@ private:
                                  const InputReaderConfiguration& readerConfig);
     void updatePalmDetectionMetrics();
     [[nodiscard]] std::list<NotifyArgs> sendHardwareState(nsecs_t when, nsecs_t readTime,
-                                                          SelfContainedHardwareState schs);
+                                                          SelfContainedHardwareState& schs);
     [[nodiscard]] std::list<NotifyArgs> processGestures(nsecs_t when, nsecs_t readTime);
 
     std::unique_ptr<gestures::GestureInterpreter, void (*)(gestures::GestureInterpreter*)>
@@ -104,8 +105,10 @@ private:
         return std::make_tuple(id.bus, id.vendor, id.product, id.version);
     }
     const MetricsIdentifier mMetricsId;
-    // Tracking IDs for touches on the pad in the last evdev frame.
-    std::set<int32_t> mLastFrameTrackingIds;
+    using TrackingIds =
+            ftl::SmallVector<int32_t, SelfContainedHardwareState::MAX_INLINE_FINGERS>;
+    // Tracking IDs for touches on the pad in the last evdev frame, in ascending order.
+    TrackingIds mLastFrameTrackingIds;
     // Tracking IDs for touches that have at some point been reported as palms by the touchpad.
     std::set<int32_t> mPalmTrackingIds;
 
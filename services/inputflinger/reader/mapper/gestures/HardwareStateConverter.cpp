@@ -111,7 +111,7 @@ SelfContainedHardwareState HardwareStateConverter::produceHardwareState(nsecs_t
                     : FingerState::ToolType::kFinger;
         }
     }
-    schs.state.fingers = schs.fingers.data();
+    schs.state.fingers = schs.fingers.begin();
     schs.state.finger_cnt = schs.fingers.size();
     schs.state.touch_cnt = mTouchButtonAccumulator.getTouchCount() - numPalms;
     return schs;
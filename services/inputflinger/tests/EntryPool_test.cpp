@@ -0,0 +1,66 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../dispatcher/EntryPool.h"
+
+// atest inputflinger_tests:EntryPoolTest
+
+namespace android::inputdispatcher {
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+
+} // namespace
+
+TEST(EntryPoolTest, ReusesReleasedBlocks) {
+    EntryPool pool(kBlockSize);
+    void* first = pool.allocate(kBlockSize);
+    pool.deallocate(first, kBlockSize);
+
+    void* second = pool.allocate(kBlockSize);
+    EXPECT_EQ(first, second);
+    pool.deallocate(second, kBlockSize);
+    EXPECT_EQ("2 allocations, 1 reused, 1 free", pool.dump());
+}
+
+TEST(EntryPoolTest, BypassesOtherSizes) {
+    EntryPool pool(kBlockSize);
+    void* block = pool.allocate(2 * kBlockSize);
+    pool.deallocate(block, 2 * kBlockSize);
+    EXPECT_EQ("0 allocations, 0 reused, 0 free", pool.dump());
+}
+
+TEST(EntryPoolTest, KeepsAtMostMaxFreeBlocks) {
+    EntryPool pool(kBlockSize);
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < EntryPool::kMaxFreeBlocks + 1; i++) {
+        blocks.push_back(pool.allocate(kBlockSize));
+    }
+    for (void* block : blocks) {
+        pool.deallocate(block, kBlockSize);
+    }
+    EXPECT_EQ(std::to_string(EntryPool::kMaxFreeBlocks + 1) + " allocations, 0 reused, " +
+                      std::to_string(EntryPool::kMaxFreeBlocks) + " free",
+              pool.dump());
+}
+
+} // namespace android::inputdispatcher
@@ -346,4 +346,20 @@ TEST_F(HardwareStateConverterTest, MscTimestamp) {
     EXPECT_NEAR(1.2, schs->state.msc_timestamp, EPSILON);
 }
 
+TEST_F(HardwareStateConverterTest, CopyPointsAtItsOwnFingers) {
+    processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_SLOT, 0);
+    processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_TRACKING_ID, 123);
+    processAxis(ARBITRARY_TIME, EV_ABS, ABS_MT_POSITION_X, 50);
+    processAxis(ARBITRARY_TIME, EV_KEY, BTN_TOUCH, 1);
+    std::optional<SelfContainedHardwareState> schs = processSync(ARBITRARY_TIME);
+    ASSERT_TRUE(schs.has_value());
+
+    SelfContainedHardwareState copy = *schs;
+    schs.reset();
+    ASSERT_EQ(1, copy.state.finger_cnt);
+    EXPECT_EQ(copy.fingers.begin(), copy.state.fingers);
+    EXPECT_EQ(123, copy.state.fingers[0].tracking_id);
+    EXPECT_NEAR(50, copy.state.fingers[0].position_x, EPSILON);
+}
+
 } // namespace android
@@ -1241,6 +1241,79 @@ TEST_F(InputReaderTest, GetLastUsedInputDeviceId) {
     ASSERT_EQ(SECOND_DEVICE_ID, mReader->getLastUsedInputDeviceId());
 }
 
+TEST_F(InputReaderTest, ParallelDeviceProcessing_MergesEventsInTimeOrder) {
+    constexpr int32_t FIRST_DEVICE_ID = END_RESERVED_ID + 1000;
+    constexpr int32_t SECOND_DEVICE_ID = FIRST_DEVICE_ID + 1;
+    mReader->setParallelDeviceThreadCount(1);
+    FakeInputMapper& firstMapper =
+            addDeviceWithFakeInputMapper(FIRST_DEVICE_ID, FIRST_DEVICE_ID, "first",
+                                         InputDeviceClass::TOUCH | InputDeviceClass::TOUCH_MT,
+                                         AINPUT_SOURCE_TOUCHSCREEN, /*configuration=*/nullptr);
+    FakeInputMapper& secondMapper =
+            addDeviceWithFakeInputMapper(SECOND_DEVICE_ID, SECOND_DEVICE_ID, "second",
+                                         InputDeviceClass::CURSOR, AINPUT_SOURCE_MOUSE,
+                                         /*configuration=*/nullptr);
+    firstMapper.setProcessResult({MotionArgsBuilder(AMOTION_EVENT_ACTION_DOWN,
+                                                    AINPUT_SOURCE_TOUCHSCREEN)
+                                          .deviceId(FIRST_DEVICE_ID)
+                                          .eventTime(ARBITRARY_TIME + 20)
+                                          .pointer(PointerBuilder(/*id=*/0, ToolType::FINGER))
+                                          .build()});
+    secondMapper.setProcessResult({MotionArgsBuilder(AMOTION_EVENT_ACTION_HOVER_MOVE,
+                                                     AINPUT_SOURCE_MOUSE)
+                                           .deviceId(SECOND_DEVICE_ID)
+                                           .eventTime(ARBITRARY_TIME + 10)
+                                           .pointer(PointerBuilder(/*id=*/0, ToolType::MOUSE))
+                                           .build()});
+
+    // The devices are processed in parallel, and their events come out in the order of their times
+    // instead of the order of the raw events.
+    mFakeEventHub->enqueueEvent(ARBITRARY_TIME, ARBITRARY_TIME, FIRST_DEVICE_ID, 0, 0, 0);
+    mFakeEventHub->enqueueEvent(ARBITRARY_TIME, ARBITRARY_TIME, SECOND_DEVICE_ID, 0, 0, 0);
+    mReader->loopOnce();
+    ASSERT_NO_FATAL_FAILURE(firstMapper.assertProcessWasCalled());
+    ASSERT_NO_FATAL_FAILURE(secondMapper.assertProcessWasCalled());
+    mFakeListener->assertNotifyMotionWasCalled(WithDeviceId(SECOND_DEVICE_ID));
+    mFakeListener->assertNotifyMotionWasCalled(WithDeviceId(FIRST_DEVICE_ID));
+    mFakeListener->assertNotifyMotionWasNotCalled();
+}
+
+TEST_F(InputReaderTest, ParallelDeviceProcessing_KeyboardKeepsEventsInReadOrder) {
+    constexpr int32_t FIRST_DEVICE_ID = END_RESERVED_ID + 1000;
+    constexpr int32_t SECOND_DEVICE_ID = FIRST_DEVICE_ID + 1;
+    mReader->setParallelDeviceThreadCount(1);
+    FakeInputMapper& firstMapper =
+            addDeviceWithFakeInputMapper(FIRST_DEVICE_ID, FIRST_DEVICE_ID, "first",
+                                         InputDeviceClass::TOUCH | InputDeviceClass::TOUCH_MT,
+                                         AINPUT_SOURCE_TOUCHSCREEN, /*configuration=*/nullptr);
+    FakeInputMapper& secondMapper =
+            addDeviceWithFakeInputMapper(SECOND_DEVICE_ID, SECOND_DEVICE_ID, "second",
+                                         InputDeviceClass::KEYBOARD, AINPUT_SOURCE_KEYBOARD,
+                                         /*configuration=*/nullptr);
+    firstMapper.setProcessResult({MotionArgsBuilder(AMOTION_EVENT_ACTION_DOWN,
+                                                    AINPUT_SOURCE_TOUCHSCREEN)
+                                          .deviceId(FIRST_DEVICE_ID)
+                                          .eventTime(ARBITRARY_TIME + 20)
+                                          .pointer(PointerBuilder(/*id=*/0, ToolType::FINGER))
+                                          .build()});
+    // The mapper of the keyboard produces a motion, so that the order of the events can be seen.
+    secondMapper.setProcessResult({MotionArgsBuilder(AMOTION_EVENT_ACTION_HOVER_MOVE,
+                                                     AINPUT_SOURCE_MOUSE)
+                                           .deviceId(SECOND_DEVICE_ID)
+                                           .eventTime(ARBITRARY_TIME + 10)
+                                           .pointer(PointerBuilder(/*id=*/0, ToolType::MOUSE))
+                                           .build()});
+
+    // A keyboard changes the state of the reader, so the events are processed in the order they
+    // were read.
+    mFakeEventHub->enqueueEvent(ARBITRARY_TIME, ARBITRARY_TIME, FIRST_DEVICE_ID, 0, 0, 0);
+    mFakeEventHub->enqueueEvent(ARBITRARY_TIME, ARBITRARY_TIME, SECOND_DEVICE_ID, 0, 0, 0);
+    mReader->loopOnce();
+    mFakeListener->assertNotifyMotionWasCalled(WithDeviceId(FIRST_DEVICE_ID));
+    mFakeListener->assertNotifyMotionWasCalled(WithDeviceId(SECOND_DEVICE_ID));
+    mFakeListener->assertNotifyMotionWasNotCalled();
+}
+
 class FakeVibratorInputMapper : public FakeInputMapper {
 public:
     FakeVibratorInputMapper(InputDeviceContext& deviceContext,
@@ -7926,6 +7999,35 @@ TEST_F(MultiTouchInputMapperTest, Process_TouchAndToolAxes_GeometricCalibration)
             x, y, 1.0f, size, touchMajor, touchMinor, toolMajor, toolMinor, 0, 0));
 }
 
+TEST_F(MultiTouchInputMapperTest, Process_ToolAxesOnly_GeometricCalibration) {
+    addConfigurationProperty("touch.deviceType", "touchScreen");
+    prepareDisplay(ui::ROTATION_0);
+    prepareAxes(POSITION | TOOL);
+    addConfigurationProperty("touch.size.calibration", "geometric");
+    MultiTouchInputMapper& mapper = constructAndAddMapper<MultiTouchInputMapper>();
+
+    // Without touch axes, the tool major axis is used for all of the sizes, because there is no
+    // tool minor axis either.
+    int32_t rawX = 100;
+    int32_t rawY = 200;
+    int32_t rawToolMajor = 180;
+
+    float x = toDisplayX(rawX);
+    float y = toDisplayY(rawY);
+    float size = float(rawToolMajor) / RAW_TOOL_MAX;
+    float tool = float(rawToolMajor) * GEOMETRIC_SCALE;
+
+    processPosition(mapper, rawX, rawY);
+    processToolMajor(mapper, rawToolMajor);
+    processMTSync(mapper);
+    processSync(mapper);
+
+    NotifyMotionArgs args;
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&args));
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(args.pointerCoords[0],
+            x, y, 1.0f, size, tool, tool, tool, tool, 0, 0));
+}
+
 TEST_F(MultiTouchInputMapperTest, Process_TouchAndToolAxes_SummedLinearCalibration) {
     addConfigurationProperty("touch.deviceType", "touchScreen");
     prepareDisplay(ui::ROTATION_0);
@@ -41,6 +41,7 @@ public:
 
     // Make the protected loopOnce method accessible to tests.
     using InputReader::loopOnce;
+    using InputReader::setParallelDeviceThreadCount;
 
 protected:
     virtual std::shared_ptr<InputDevice> createDeviceLocked(
@@ -351,6 +351,46 @@ TEST_F(LatencyTrackerTest, EventsAreTracked_WhenTrackListenerIsCalledFirst) {
                                               expected.sources, expected.inputEventActionType});
 }
 
+/**
+ * When more events are in flight than the tracker has room for, the oldest event is reported
+ * early to make room for the new one, and the tracking of the rest is not affected.
+ */
+TEST_F(LatencyTrackerTest, FullTable_ReportsOldestEventEarly) {
+    InputEventTimeline expected = getTestTimeline();
+    const ConnectionTimeline& expectedCT = expected.connectionTimelines.begin()->second;
+    const sp<IBinder>& token = expected.connectionTimelines.begin()->first;
+    for (size_t i = 1; i <= LatencyTracker::MAX_TRACKED_EVENTS; i++) {
+        mTracker->trackListener(/*inputEventId=*/i, expected.eventTime, expected.readTime,
+                                DEVICE_ID, {InputDeviceUsageSource::UNKNOWN},
+                                AMOTION_EVENT_ACTION_CANCEL, InputEventType::MOTION);
+    }
+    assertReceivedTimelines({});
+
+    // The first event is reported, without waiting for it to become mature.
+    const int32_t lastInputEventId = LatencyTracker::MAX_TRACKED_EVENTS + 1;
+    mTracker->trackListener(lastInputEventId, expected.eventTime, expected.readTime, DEVICE_ID,
+                            {InputDeviceUsageSource::UNKNOWN}, AMOTION_EVENT_ACTION_CANCEL,
+                            InputEventType::MOTION);
+    assertReceivedTimeline(InputEventTimeline{expected.eventTime, expected.readTime,
+                                              expected.vendorId, expected.productId,
+                                              expected.sources, expected.inputEventActionType});
+
+    // The newest event is still tracked.
+    mTracker->trackFinishedEvent(lastInputEventId, token, expectedCT.deliveryTime,
+                                 expectedCT.consumeTime, expectedCT.finishTime);
+    mTracker->trackGraphicsLatency(lastInputEventId, token, expectedCT.graphicsTimeline);
+    triggerEventReporting(expected.eventTime);
+    std::vector<InputEventTimeline> expectedTimelines;
+    for (size_t i = 2; i <= LatencyTracker::MAX_TRACKED_EVENTS; i++) {
+        expectedTimelines.push_back(InputEventTimeline{expected.eventTime, expected.readTime,
+                                                       expected.vendorId, expected.productId,
+                                                       expected.sources,
+                                                       expected.inputEventActionType});
+    }
+    expectedTimelines.push_back(expected);
+    assertReceivedTimelines(expectedTimelines);
+}
+
 /**
  * Check that LatencyTracker has the received timeline that contains the correctly
  * resolved product ID, vendor ID and source for a particular device ID from
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../MpscQueue.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+
+namespace android {
+
+// --- MpscQueueTest ---
+
+// Make sure the queue returns the objects from oldest to newest, and is empty afterwards.
+TEST(MpscQueueTest, PopAllIsFIFO) {
+    MpscQueue<int> queue;
+    ASSERT_TRUE(queue.empty());
+
+    ASSERT_TRUE(queue.push(1)) << "Push to an empty queue should report it";
+    ASSERT_FALSE(queue.push(2));
+    ASSERT_FALSE(queue.push(3));
+    ASSERT_FALSE(queue.empty());
+
+    ASSERT_EQ(queue.popAll(), std::vector<int>({1, 2, 3}));
+    ASSERT_TRUE(queue.empty());
+    ASSERT_TRUE(queue.popAll().empty());
+
+    ASSERT_TRUE(queue.push(4));
+    ASSERT_EQ(queue.popAll(), std::vector<int>({4}));
+}
+
+// Objects that are never popped are destroyed with the queue.
+TEST(MpscQueueTest, DestroysRemainingObjects) {
+    std::shared_ptr<int> object = std::make_shared<int>(1);
+    {
+        MpscQueue<std::shared_ptr<int>> queue;
+        queue.push(object);
+        queue.push(object);
+        ASSERT_EQ(3, object.use_count());
+    }
+    ASSERT_EQ(1, object.use_count());
+}
+
+// Every object pushed by several threads is popped once, in the order each thread pushed them.
+TEST(MpscQueueTest, AllowsMultipleProducers) {
+    MpscQueue<std::pair<int, int>> queue;
+
+    // Test with a large number of items to increase likelihood that threads overlap
+    constexpr int numThreads = 4;
+    constexpr int numItems = 1000;
+
+    std::vector<std::thread> producers;
+    for (int thread = 0; thread < numThreads; thread++) {
+        producers.emplace_back([&queue, thread]() {
+            for (int i = 0; i < numItems; i++) {
+                queue.push({thread, i});
+            }
+        });
+    }
+
+    std::vector<int> next(numThreads, 0);
+    int received = 0;
+    while (received < numThreads * numItems) {
+        for (const auto& [thread, i] : queue.popAll()) {
+            EXPECT_EQ(next[thread], i) << "Out of order item from thread " << thread;
+            next[thread]++;
+            received++;
+        }
+    }
+
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    ASSERT_TRUE(queue.empty());
+}
+
+} // namespace android
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "InputListener.h"
+
+#include <NotifyArgsBuilders.h>
+#include <android/input.h>
+#include <gtest/gtest.h>
+#include <input/Input.h>
+
+#include "TestInputListener.h"
+
+namespace android {
+
+namespace {
+
+NotifyKeyArgs newKey() {
+    return KeyArgsBuilder(AKEY_EVENT_ACTION_DOWN, AINPUT_SOURCE_KEYBOARD).build();
+}
+
+NotifyMotionArgs newMotion() {
+    return MotionArgsBuilder(AMOTION_EVENT_ACTION_DOWN, AINPUT_SOURCE_TOUCHSCREEN)
+            .pointer(PointerBuilder(/*id=*/0, ToolType::FINGER).x(100).y(200))
+            .build();
+}
+
+} // namespace
+
+class TracedInputListenerTest : public testing::Test {
+protected:
+    TestInputListener mStage;
+    TestInputListener mNextStage;
+};
+
+TEST_F(TracedInputListenerTest, NotifiesStage) {
+    TracedInputListener traced("Stage", mStage);
+
+    traced.notifyKey(newKey());
+    traced.notifyMotion(newMotion());
+
+    mStage.assertNotifyKeyWasCalled();
+    mStage.assertNotifyMotionWasCalled();
+
+    std::string dump;
+    traced.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("Stage: 2 args, 0 passed through"));
+}
+
+TEST_F(TracedInputListenerTest, PassesThroughTypesToNextStage) {
+    TracedInputListener traced("Stage", mStage, TracedInputListener::ArgsType::KEY, mNextStage);
+
+    traced.notifyKey(newKey());
+    traced.notifyMotion(newMotion());
+
+    mStage.assertNotifyKeyWasNotCalled();
+    mNextStage.assertNotifyKeyWasCalled();
+    mStage.assertNotifyMotionWasCalled();
+    mNextStage.assertNotifyMotionWasNotCalled();
+
+    std::string dump;
+    traced.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("Stage: 1 args, 1 passed through"));
+}
+
+} // namespace android
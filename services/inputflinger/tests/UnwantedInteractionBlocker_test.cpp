@@ -1080,4 +1080,142 @@ TEST_F(PalmRejectorFakeFilterTest, CancelTwoPointers) {
     ASSERT_EQ(CANCEL, argsList[0].action);
 }
 
+// --- LatePalmCancelerTest ---
+
+static PalmDecision createPalmDecision(nsecs_t downTime, uint64_t eventSeq,
+                                       const std::vector<int32_t>& pointerIds) {
+    PalmDecision decision;
+    decision.downTime = downTime;
+    decision.eventSeq = eventSeq;
+    for (int32_t pointerId : pointerIds) {
+        decision.suppressedPointerIds.markBit(pointerId);
+    }
+    return decision;
+}
+
+/**
+ * Until a decision arrives, the events are passed through as they are.
+ */
+TEST(LatePalmCancelerTest, EventsArePassedThroughWithoutDecision) {
+    LatePalmCanceler canceler;
+    std::vector<NotifyMotionArgs> result =
+            canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/0, DOWN,
+                                                      {{1, 2, 3}}),
+                                   /*eventSeq=*/0, /*decision=*/std::nullopt);
+    ASSERT_EQ(1u, result.size());
+    assertArgs(result[0], DOWN, {{0, {1, 2, 3}}});
+
+    result = canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/1, MOVE,
+                                                       {{4, 5, 6}}),
+                                    /*eventSeq=*/1, /*decision=*/std::nullopt);
+    ASSERT_EQ(1u, result.size());
+    assertArgs(result[0], MOVE, {{0, {4, 5, 6}}});
+}
+
+/**
+ * A pointer that the thread decided is a palm is canceled with the next event, and is removed from
+ * the events after that.
+ */
+TEST(LatePalmCancelerTest, SuppressedPointerIsCanceledWithNextEvent) {
+    LatePalmCanceler canceler;
+    canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/0, DOWN, {{1, 2, 3}}),
+                           /*eventSeq=*/0, /*decision=*/std::nullopt);
+    canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/1, POINTER_1_DOWN,
+                                              {{1, 2, 3}, {4, 5, 6}}),
+                           /*eventSeq=*/1, /*decision=*/std::nullopt);
+
+    const PalmDecision decision = createPalmDecision(/*downTime=*/0, /*eventSeq=*/1, {1});
+    std::vector<NotifyMotionArgs> result =
+            canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/2, MOVE,
+                                                      {{1, 2, 3}, {4, 5, 6}}),
+                                   /*eventSeq=*/2, decision);
+    ASSERT_EQ(2u, result.size());
+    assertArgs(result[0], POINTER_1_UP, {{0, {1, 2, 3}}, {1, {4, 5, 6}}});
+    ASSERT_EQ(FLAG_CANCELED, result[0].flags);
+    assertArgs(result[1], MOVE, {{0, {1, 2, 3}}});
+
+    result = canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/3, MOVE,
+                                                       {{7, 8, 9}, {4, 5, 6}}),
+                                    /*eventSeq=*/3, decision);
+    ASSERT_EQ(1u, result.size());
+    assertArgs(result[0], MOVE, {{0, {7, 8, 9}}});
+}
+
+/**
+ * A decision that was made during the previous gesture does not apply to the new one.
+ */
+TEST(LatePalmCancelerTest, DecisionAboutPreviousGestureIsIgnored) {
+    LatePalmCanceler canceler;
+    canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/0, DOWN, {{1, 2, 3}}),
+                           /*eventSeq=*/0, /*decision=*/std::nullopt);
+    canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/1, UP, {{1, 2, 3}}),
+                           /*eventSeq=*/1, /*decision=*/std::nullopt);
+    canceler.processMotion(generateMotionArgs(/*downTime=*/2, /*eventTime=*/2, DOWN, {{1, 2, 3}}),
+                           /*eventSeq=*/2, /*decision=*/std::nullopt);
+
+    std::vector<NotifyMotionArgs> result =
+            canceler.processMotion(generateMotionArgs(/*downTime=*/2, /*eventTime=*/3, MOVE,
+                                                      {{4, 5, 6}}),
+                                   /*eventSeq=*/3,
+                                   createPalmDecision(/*downTime=*/0, /*eventSeq=*/1, {0}));
+    ASSERT_EQ(1u, result.size());
+    assertArgs(result[0], MOVE, {{0, {4, 5, 6}}});
+}
+
+/**
+ * A decision about a pointer that went up is not applied to a new pointer that reuses its id.
+ */
+TEST(LatePalmCancelerTest, DecisionIsNotAppliedToNewPointerWithSameId) {
+    LatePalmCanceler canceler;
+    canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/0, DOWN, {{1, 2, 3}}),
+                           /*eventSeq=*/0, /*decision=*/std::nullopt);
+    canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/1, POINTER_1_DOWN,
+                                              {{1, 2, 3}, {4, 5, 6}}),
+                           /*eventSeq=*/1, /*decision=*/std::nullopt);
+    canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/2, POINTER_1_UP,
+                                              {{1, 2, 3}, {4, 5, 6}}),
+                           /*eventSeq=*/2, /*decision=*/std::nullopt);
+    canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/3, POINTER_1_DOWN,
+                                              {{1, 2, 3}, {7, 8, 9}}),
+                           /*eventSeq=*/3, /*decision=*/std::nullopt);
+
+    // The decision was made before the new pointer 1 went down.
+    std::vector<NotifyMotionArgs> result =
+            canceler.processMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/4, MOVE,
+                                                      {{1, 2, 3}, {7, 8, 9}}),
+                                   /*eventSeq=*/4,
+                                   createPalmDecision(/*downTime=*/0, /*eventSeq=*/2, {1}));
+    ASSERT_EQ(1u, result.size());
+    assertArgs(result[0], MOVE, {{0, {1, 2, 3}}, {1, {7, 8, 9}}});
+}
+
+/**
+ * When palm rejection is pipelined, the events are sent to the next stage without waiting for the
+ * model.
+ */
+TEST(UnwantedInteractionBlockerPipelinedTest, EventsArePassedThroughRightAway) {
+    TestInputListener listener;
+    UnwantedInteractionBlocker blocker(listener, /*enablePalmRejection=*/true,
+                                       /*pipelinePalmRejection=*/true);
+    blocker.notifyInputDevicesChanged({/*id=*/0, {generateTestDeviceInfo()}});
+    listener.assertNotifyInputDevicesChangedWasCalled();
+
+    blocker.notifyMotion(generateMotionArgs(/*downTime=*/0, /*eventTime=*/0, DOWN, {{1, 2, 3}}));
+    listener.assertNotifyMotionWasCalled(WithMotionAction(DOWN));
+    blocker.notifyMotion(
+            generateMotionArgs(/*downTime=*/0, RESAMPLE_PERIOD, MOVE, {{4, 5, 6}}));
+    listener.assertNotifyMotionWasCalled(WithMotionAction(MOVE));
+    blocker.notifyMotion(
+            generateMotionArgs(/*downTime=*/0, 2 * RESAMPLE_PERIOD, UP, {{4, 5, 6}}));
+    listener.assertNotifyMotionWasCalled(WithMotionAction(UP));
+
+    NotifyDeviceResetArgs resetArgs(/*id=*/1, /*eventTime=*/3 * RESAMPLE_PERIOD, DEVICE_ID);
+    blocker.notifyDeviceReset(resetArgs);
+    listener.assertNotifyDeviceResetWasCalled();
+
+    std::string dump;
+    blocker.dump(dump);
+    ASSERT_NE(std::string::npos, dump.find("mPalmRejectionThread"));
+}
+
 } // namespace android
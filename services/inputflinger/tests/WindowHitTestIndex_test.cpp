@@ -0,0 +1,111 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "../WindowHitTestIndex.h"
+
+// atest inputflinger_tests:WindowHitTestIndexTest
+
+using android::gui::WindowInfo;
+using android::gui::WindowInfoHandle;
+
+namespace android::inputdispatcher {
+
+namespace {
+
+using InputConfig = WindowInfo::InputConfig;
+
+class FakeWindowHandle : public WindowInfoHandle {
+public:
+    FakeWindowHandle(const std::string& name, const Rect& frame) {
+        mInfo.name = name;
+        mInfo.frame = frame;
+        mInfo.touchableRegion = Region(frame);
+    }
+
+    void setInputConfig(InputConfig config, bool value) { mInfo.setInputConfig(config, value); }
+};
+
+std::vector<std::string> namesOf(const std::vector<sp<WindowInfoHandle>>& windowHandles) {
+    std::vector<std::string> names;
+    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+        names.push_back(windowHandle->getName());
+    }
+    return names;
+}
+
+} // namespace
+
+TEST(WindowHitTestIndexTest, ReturnsOverlappingWindowsInZOrder) {
+    sp<FakeWindowHandle> top = sp<FakeWindowHandle>::make("top", Rect(0, 0, 100, 100));
+    sp<FakeWindowHandle> middle = sp<FakeWindowHandle>::make("middle", Rect(900, 900, 1000, 1000));
+    sp<FakeWindowHandle> bottom = sp<FakeWindowHandle>::make("bottom", Rect(0, 0, 1000, 1000));
+    WindowHitTestIndex index({top, middle, bottom}, ui::Transform());
+
+    EXPECT_EQ(std::vector<std::string>({"top", "bottom"}), namesOf(index.getCandidatesAt(50, 50)));
+    EXPECT_EQ(std::vector<std::string>({"middle", "bottom"}),
+              namesOf(index.getCandidatesAt(950, 950)));
+    EXPECT_EQ(std::vector<std::string>({"bottom"}), namesOf(index.getCandidatesAt(500, 500)));
+    EXPECT_TRUE(index.getCandidatesAt(1000, 500).empty());
+    EXPECT_TRUE(index.getCandidatesAt(-1, 500).empty());
+}
+
+TEST(WindowHitTestIndexTest, LeavesOutWindowsThatCannotBeTouched) {
+    sp<FakeWindowHandle> overlay = sp<FakeWindowHandle>::make("overlay", Rect(0, 0, 1000, 1000));
+    overlay->setInputConfig(InputConfig::NOT_TOUCHABLE, true);
+    sp<FakeWindowHandle> invisible =
+            sp<FakeWindowHandle>::make("invisible", Rect(0, 0, 1000, 1000));
+    invisible->setInputConfig(InputConfig::NOT_VISIBLE, true);
+    sp<FakeWindowHandle> stylusOverlay =
+            sp<FakeWindowHandle>::make("stylusOverlay", Rect(0, 0, 1000, 1000));
+    stylusOverlay->setInputConfig(InputConfig::NOT_TOUCHABLE, true);
+    stylusOverlay->setInputConfig(InputConfig::INTERCEPTS_STYLUS, true);
+    sp<FakeWindowHandle> app = sp<FakeWindowHandle>::make("app", Rect(0, 0, 1000, 1000));
+    WindowHitTestIndex index({overlay, invisible, stylusOverlay, app}, ui::Transform());
+
+    EXPECT_EQ(std::vector<std::string>({"stylusOverlay", "app"}),
+              namesOf(index.getCandidatesAt(500, 500)));
+}
+
+TEST(WindowHitTestIndexTest, WindowsThatPreventSplittingAreAlwaysCandidates) {
+    sp<FakeWindowHandle> top = sp<FakeWindowHandle>::make("top", Rect(0, 0, 100, 100));
+    sp<FakeWindowHandle> unsplittable =
+            sp<FakeWindowHandle>::make("unsplittable", Rect(0, 0, 100, 100));
+    unsplittable->setInputConfig(InputConfig::PREVENT_SPLITTING, true);
+    sp<FakeWindowHandle> bottom = sp<FakeWindowHandle>::make("bottom", Rect(0, 0, 1000, 1000));
+    WindowHitTestIndex index({top, unsplittable, bottom}, ui::Transform());
+
+    EXPECT_EQ(std::vector<std::string>({"top", "unsplittable", "bottom"}),
+              namesOf(index.getCandidatesAt(50, 50)));
+    EXPECT_EQ(std::vector<std::string>({"unsplittable", "bottom"}),
+              namesOf(index.getCandidatesAt(500, 500)));
+    EXPECT_EQ(std::vector<std::string>({"unsplittable"}),
+              namesOf(index.getCandidatesAt(5000, 5000)));
+}
+
+TEST(WindowHitTestIndexTest, UsesTheLogicalDisplaySpace) {
+    // A 1000x2000 display, rotated by 90 degrees.
+    ui::Transform displayTransform(ui::Transform::toRotationFlags(ui::ROTATION_90), 1000, 2000);
+    sp<FakeWindowHandle> corner = sp<FakeWindowHandle>::make("corner", Rect(0, 0, 100, 100));
+    WindowHitTestIndex index({corner}, displayTransform);
+
+    EXPECT_EQ(std::vector<std::string>({"corner"}), namesOf(index.getCandidatesAt(50, 50)));
+    EXPECT_TRUE(index.getCandidatesAt(150, 50).empty());
+    EXPECT_TRUE(index.getCandidatesAt(50, 150).empty());
+}
+
+} // namespace android::inputdispatcher
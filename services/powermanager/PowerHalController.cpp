@@ -113,8 +113,25 @@ HalResult<T> PowerHalController::processHalResult(HalResult<T>&& result, const c
 
 HalResult<void> PowerHalController::setBoost(aidl::android::hardware::power::Boost boost,
                                              int32_t durationMs) {
+    const auto now = std::chrono::steady_clock::now();
+    const size_t idx = static_cast<size_t>(boost);
+    if (idx < mLastSentBoosts.size()) {
+        std::lock_guard<std::mutex> lock(mBoostMutex);
+        const std::optional<SentBoost>& last = mLastSentBoosts[idx];
+        if (last.has_value() && last->durationMs == durationMs &&
+            now - last->time < mBoostCoalescingWindow) {
+            ++mCoalescedBoostCount;
+            return HalResult<void>::ok();
+        }
+    }
+
     std::shared_ptr<HalWrapper> handle = initHal();
-    return processHalResult(handle->setBoost(boost, durationMs), "setBoost");
+    auto result = processHalResult(handle->setBoost(boost, durationMs), "setBoost");
+    if (result.isOk() && idx < mLastSentBoosts.size()) {
+        std::lock_guard<std::mutex> lock(mBoostMutex);
+        mLastSentBoosts[idx] = SentBoost{durationMs, now};
+    }
+    return result;
 }
 
 HalResult<void> PowerHalController::setMode(aidl::android::hardware::power::Mode mode,
@@ -123,6 +140,16 @@ HalResult<void> PowerHalController::setMode(aidl::android::hardware::power::Mode
     return processHalResult(handle->setMode(mode, enabled), "setMode");
 }
 
+void PowerHalController::setBoostCoalescingWindow(std::chrono::nanoseconds window) {
+    std::lock_guard<std::mutex> lock(mBoostMutex);
+    mBoostCoalescingWindow = window;
+}
+
+int64_t PowerHalController::getCoalescedBoostCount() {
+    std::lock_guard<std::mutex> lock(mBoostMutex);
+    return mCoalescedBoostCount;
+}
+
 // Aidl-only methods
 
 HalResult<std::shared_ptr<PowerHintSessionWrapper>> PowerHalController::createHintSession(
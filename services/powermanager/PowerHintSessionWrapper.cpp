@@ -59,16 +59,100 @@ PowerHintSessionWrapper::PowerHintSessionWrapper(std::shared_ptr<IPowerHintSessi
 // is no way to check for it, so in the future if a way to check that is added,
 // this will need to be updated.
 
-FWD_CALL(2, updateTargetWorkDuration, (int64_t in_targetDurationNanos), (in_targetDurationNanos));
-FWD_CALL(2, reportActualWorkDuration, (const std::vector<WorkDuration>& in_durations),
-         (in_durations));
-FWD_CALL(2, pause, (), ());
 FWD_CALL(2, resume, (), ());
-FWD_CALL(2, close, (), ());
 FWD_CALL(4, sendHint, (SessionHint in_hint), (in_hint));
 FWD_CALL(4, setThreads, (const std::vector<int32_t>& in_threadIds), (in_threadIds));
 FWD_CALL(5, setMode, (SessionMode in_type, bool in_enabled), (in_type, in_enabled));
 
+// The durations buffered so far were measured against the current target, so they are sent
+// before it changes.
+HalResult<void> PowerHintSessionWrapper::updateTargetWorkDuration(int64_t in_targetDurationNanos) {
+    CHECK_SESSION(void)
+    std::lock_guard<std::mutex> lock(mBatchMutex);
+    if (mLastTargetDuration == in_targetDurationNanos) {
+        ++mCoalescedCallCount;
+        return HalResult<void>::ok();
+    }
+    flushActualWorkDurationsLocked();
+    auto result = CACHE_SUPPORT(2,
+                                HalResult<void>::fromStatus(mSession->updateTargetWorkDuration(
+                                        in_targetDurationNanos)));
+    if (result.isOk()) {
+        mLastTargetDuration = in_targetDurationNanos;
+    }
+    return result;
+}
+
+HalResult<void> PowerHintSessionWrapper::reportActualWorkDuration(
+        const std::vector<WorkDuration>& in_durations) {
+    CHECK_SESSION(void)
+    std::lock_guard<std::mutex> lock(mBatchMutex);
+    if (mMaxBatchedDurations <= 1 && mBatchedDurations.empty()) {
+        return sendActualWorkDurations(in_durations);
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (mBatchedDurations.empty()) {
+        mFirstBatchedTime = now;
+    }
+    mBatchedDurations.insert(mBatchedDurations.end(), in_durations.begin(), in_durations.end());
+    if (mBatchedDurations.size() < mMaxBatchedDurations &&
+        now - mFirstBatchedTime < mMaxBatchDelay) {
+        ++mCoalescedCallCount;
+        return HalResult<void>::ok();
+    }
+    return flushActualWorkDurationsLocked();
+}
+
+HalResult<void> PowerHintSessionWrapper::flushActualWorkDurations() {
+    CHECK_SESSION(void)
+    std::lock_guard<std::mutex> lock(mBatchMutex);
+    return flushActualWorkDurationsLocked();
+}
+
+HalResult<void> PowerHintSessionWrapper::flushActualWorkDurationsLocked() {
+    if (mBatchedDurations.empty()) {
+        return HalResult<void>::ok();
+    }
+    // Dropped even if the call fails: the HAL session is then gone, and the caller with it.
+    auto result = sendActualWorkDurations(mBatchedDurations);
+    mBatchedDurations.clear();
+    return result;
+}
+
+HalResult<void> PowerHintSessionWrapper::sendActualWorkDurations(
+        const std::vector<WorkDuration>& durations) {
+    return CACHE_SUPPORT(2,
+                         HalResult<void>::fromStatus(
+                                 mSession->reportActualWorkDuration(durations)));
+}
+
+HalResult<void> PowerHintSessionWrapper::pause() {
+    CHECK_SESSION(void)
+    flushActualWorkDurations();
+    return CACHE_SUPPORT(2, HalResult<void>::fromStatus(mSession->pause()));
+}
+
+HalResult<void> PowerHintSessionWrapper::close() {
+    CHECK_SESSION(void)
+    flushActualWorkDurations();
+    return CACHE_SUPPORT(2, HalResult<void>::fromStatus(mSession->close()));
+}
+
+void PowerHintSessionWrapper::setReportBatching(size_t maxDurations,
+                                                std::chrono::nanoseconds maxDelay) {
+    std::lock_guard<std::mutex> lock(mBatchMutex);
+    mMaxBatchedDurations = maxDurations;
+    mMaxBatchDelay = maxDelay;
+    if (mMaxBatchedDurations <= 1) {
+        flushActualWorkDurationsLocked();
+    }
+}
+
+int64_t PowerHintSessionWrapper::getCoalescedCallCount() {
+    std::lock_guard<std::mutex> lock(mBatchMutex);
+    return mCoalescedCallCount;
+}
+
 HalResult<SessionConfig> PowerHintSessionWrapper::getSessionConfig() {
     CHECK_SESSION(SessionConfig);
     SessionConfig config;
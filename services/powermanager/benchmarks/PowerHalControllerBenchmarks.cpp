@@ -18,6 +18,7 @@
 
 #include <aidl/android/hardware/power/Boost.h>
 #include <aidl/android/hardware/power/Mode.h>
+#include <aidl/android/hardware/power/WorkDuration.h>
 #include <benchmark/benchmark.h>
 #include <powermanager/PowerHalController.h>
 #include <testUtil.h>
@@ -25,8 +26,10 @@
 
 using aidl::android::hardware::power::Boost;
 using aidl::android::hardware::power::Mode;
+using aidl::android::hardware::power::WorkDuration;
 using android::power::HalResult;
 using android::power::PowerHalController;
+using android::power::PowerHintSessionWrapper;
 
 using namespace android;
 using namespace std::chrono_literals;
@@ -108,9 +111,66 @@ static void BM_PowerHalControllerBenchmarks_setModeCached(benchmark::State& stat
     runCachedBenchmark(state, &PowerHalController::setMode, mode, false);
 }
 
+// Boosts sent at frame rate, with the ones repeated within the window (the argument, in ms)
+// coalesced. "hal_calls" is the share of the calls that reached the HAL.
+static void BM_PowerHalControllerBenchmarks_setBoostCoalesced(benchmark::State& state) {
+    PowerHalController controller;
+    controller.setBoostCoalescingWindow(std::chrono::milliseconds(state.range(0)));
+    // First call out of test, to cache HAL service and isSupported result.
+    if (!controller.setBoost(Boost::INTERACTION, 0).isOk()) {
+        state.SkipWithMessage("operation unsupported");
+        return;
+    }
+    const int64_t coalescedBefore = controller.getCoalescedBoostCount();
+
+    while (state.KeepRunning()) {
+        HalResult<void> ret = controller.setBoost(Boost::INTERACTION, 0);
+        state.PauseTiming();
+        if (ret.isFailed()) state.SkipWithError("Power HAL request failed");
+        testDelaySpin(
+                std::chrono::duration_cast<std::chrono::duration<float>>(ONEWAY_API_DELAY).count());
+        state.ResumeTiming();
+    }
+    const int64_t coalesced = controller.getCoalescedBoostCount() - coalescedBefore;
+    state.counters["hal_calls"] =
+            benchmark::Counter(state.iterations() - coalesced, benchmark::Counter::kAvgIterations);
+}
+
+// One actual work duration reported per frame, batched up to the argument per HAL call.
+// "hal_calls" is the share of the reports that reached the HAL.
+static void BM_PowerHalControllerBenchmarks_reportActualWorkDurationBatched(
+        benchmark::State& state) {
+    PowerHalController controller;
+    // do not use tid from the benchmark process, use 1 for init
+    auto session = controller.createHintSession(1, 0, {1}, 16666666L);
+    if (!session.isOk() || session.value() == nullptr) {
+        state.SkipWithMessage("operation unsupported");
+        return;
+    }
+    std::shared_ptr<PowerHintSessionWrapper> wrapper = session.value();
+    wrapper->setReportBatching(state.range(0), 1s);
+    std::vector<WorkDuration> durations(1);
+    durations[0].durationNanos = 8000000L;
+
+    while (state.KeepRunning()) {
+        HalResult<void> ret = wrapper->reportActualWorkDuration(durations);
+        state.PauseTiming();
+        if (ret.isFailed()) state.SkipWithError("Power HAL request failed");
+        testDelaySpin(
+                std::chrono::duration_cast<std::chrono::duration<float>>(ONEWAY_API_DELAY).count());
+        state.ResumeTiming();
+    }
+    state.counters["hal_calls"] =
+            benchmark::Counter(state.iterations() - wrapper->getCoalescedCallCount(),
+                               benchmark::Counter::kAvgIterations);
+    wrapper->close();
+}
+
 BENCHMARK(BM_PowerHalControllerBenchmarks_init);
 BENCHMARK(BM_PowerHalControllerBenchmarks_initCached);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setBoost)->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setBoostCached)->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setMode)->DenseRange(FIRST_MODE, LAST_MODE, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setModeCached)->DenseRange(FIRST_MODE, LAST_MODE, 1);
+BENCHMARK(BM_PowerHalControllerBenchmarks_setBoostCoalesced)->Arg(0)->Arg(100);
+BENCHMARK(BM_PowerHalControllerBenchmarks_reportActualWorkDurationBatched)->Arg(1)->Arg(4)->Arg(16);
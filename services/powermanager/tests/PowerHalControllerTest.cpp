@@ -278,3 +278,32 @@ TEST_F(PowerHalControllerTest, TestMultiThreadWithFailureReconnectIsThreadSafe)
     int powerHalResetCount = mHalConnector->getResetCount();
     EXPECT_THAT(powerHalResetCount, Le(10));
 }
+
+TEST_F(PowerHalControllerTest, TestRepeatedBoostsWithinWindowAreCoalesced) {
+    {
+        InSequence seg;
+        EXPECT_CALL(*mMockHal.get(), powerHint(Eq(PowerHint::INTERACTION), Eq(100)))
+                .Times(Exactly(1));
+        EXPECT_CALL(*mMockHal.get(), powerHint(Eq(PowerHint::INTERACTION), Eq(200)))
+                .Times(Exactly(1));
+    }
+
+    mHalController->setBoostCoalescingWindow(1h);
+    ASSERT_TRUE(mHalController->setBoost(Boost::INTERACTION, 100).isOk());
+    ASSERT_TRUE(mHalController->setBoost(Boost::INTERACTION, 100).isOk());
+    ASSERT_TRUE(mHalController->setBoost(Boost::INTERACTION, 100).isOk());
+    // A different duration is a different boost.
+    ASSERT_TRUE(mHalController->setBoost(Boost::INTERACTION, 200).isOk());
+
+    EXPECT_EQ(mHalController->getCoalescedBoostCount(), 2);
+}
+
+TEST_F(PowerHalControllerTest, TestRepeatedBoostsAreSentWithoutWindow) {
+    EXPECT_CALL(*mMockHal.get(), powerHint(Eq(PowerHint::INTERACTION), Eq(100)))
+            .Times(Exactly(2));
+
+    ASSERT_TRUE(mHalController->setBoost(Boost::INTERACTION, 100).isOk());
+    ASSERT_TRUE(mHalController->setBoost(Boost::INTERACTION, 100).isOk());
+
+    EXPECT_EQ(mHalController->getCoalescedBoostCount(), 0);
+}
@@ -20,6 +20,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <thread>
+
 using aidl::android::hardware::power::IPowerHintSession;
 using android::power::PowerHintSessionWrapper;
 
@@ -27,6 +29,8 @@ using namespace android;
 using namespace std::chrono_literals;
 using namespace testing;
 
+static const std::vector<::aidl::android::hardware::power::WorkDuration> ONE_DURATION(1);
+
 class MockIPowerHintSession : public IPowerHintSession {
 public:
     MockIPowerHintSession() = default;
@@ -89,6 +93,50 @@ TEST_F(PowerHintSessionWrapperTest, reportActualWorkDuration) {
     ASSERT_TRUE(status.isOk());
 }
 
+TEST_F(PowerHintSessionWrapperTest, updateTargetWorkDurationSkipsRepeatedTarget) {
+    EXPECT_CALL(*mMockSession.get(), updateTargetWorkDuration(1000000000))
+            .WillOnce(Return(ndk::ScopedAStatus::ok()));
+    EXPECT_CALL(*mMockSession.get(), updateTargetWorkDuration(2000000000))
+            .WillOnce(Return(ndk::ScopedAStatus::ok()));
+    ASSERT_TRUE(mSession->updateTargetWorkDuration(1000000000).isOk());
+    ASSERT_TRUE(mSession->updateTargetWorkDuration(1000000000).isOk());
+    ASSERT_TRUE(mSession->updateTargetWorkDuration(2000000000).isOk());
+    ASSERT_EQ(1, mSession->getCoalescedCallCount());
+}
+
+TEST_F(PowerHintSessionWrapperTest, reportActualWorkDurationBatchesDurations) {
+    mSession->setReportBatching(3, 1s);
+    EXPECT_CALL(*mMockSession.get(), reportActualWorkDuration(SizeIs(3)))
+            .WillOnce(Return(ndk::ScopedAStatus::ok()));
+    for (int64_t i = 1; i <= 3; i++) {
+        ::aidl::android::hardware::power::WorkDuration duration;
+        duration.durationNanos = i;
+        ASSERT_TRUE(mSession->reportActualWorkDuration({duration}).isOk());
+    }
+    ASSERT_EQ(2, mSession->getCoalescedCallCount());
+}
+
+TEST_F(PowerHintSessionWrapperTest, reportActualWorkDurationSendsAfterDelay) {
+    mSession->setReportBatching(100, 1ms);
+    EXPECT_CALL(*mMockSession.get(), reportActualWorkDuration(SizeIs(2)))
+            .WillOnce(Return(ndk::ScopedAStatus::ok()));
+    ASSERT_TRUE(mSession->reportActualWorkDuration(ONE_DURATION).isOk());
+    std::this_thread::sleep_for(2ms);
+    ASSERT_TRUE(mSession->reportActualWorkDuration(ONE_DURATION).isOk());
+}
+
+TEST_F(PowerHintSessionWrapperTest, closeSendsBatchedDurations) {
+    mSession->setReportBatching(100, 1s);
+    {
+        InSequence seq;
+        EXPECT_CALL(*mMockSession.get(), reportActualWorkDuration(SizeIs(1)))
+                .WillOnce(Return(ndk::ScopedAStatus::ok()));
+        EXPECT_CALL(*mMockSession.get(), close()).WillOnce(Return(ndk::ScopedAStatus::ok()));
+    }
+    ASSERT_TRUE(mSession->reportActualWorkDuration(ONE_DURATION).isOk());
+    ASSERT_TRUE(mSession->close().isOk());
+}
+
 TEST_F(PowerHintSessionWrapperTest, pause) {
     EXPECT_CALL(*mMockSession.get(), pause()).WillOnce(Return(ndk::ScopedAStatus::ok()));
     auto status = mSession->pause();
@@ -59,6 +59,51 @@ enum EventQueueFlagBitsInternal : uint32_t {
     INTERNAL_WAKE = 1 << 16,
 };
 
+void initSensorEvent(const Event &src, sensors_event_t *dst) {
+    *dst = {};
+    dst->version = sizeof(sensors_event_t);
+    dst->sensor = src.sensorHandle;
+    dst->type = static_cast<int32_t>(src.sensorType);
+    dst->timestamp = src.timestamp;
+}
+
+// Converts an event from the FMQ. The payloads of the sensors with the highest rates, which are 3
+// axes with or without their bias, are converted here directly, and the others by
+// convertToSensorEvent().
+void convertEvent(const Event &src, sensors_event_t *dst) {
+    switch (src.sensorType) {
+        case SensorType::ACCELEROMETER:
+        case SensorType::MAGNETIC_FIELD:
+        case SensorType::GYROSCOPE:
+        case SensorType::GRAVITY:
+        case SensorType::LINEAR_ACCELERATION: {
+            const Event::EventPayload::Vec3 &vec3 = src.payload.get<Event::EventPayload::vec3>();
+            initSensorEvent(src, dst);
+            dst->acceleration.x = vec3.x;
+            dst->acceleration.y = vec3.y;
+            dst->acceleration.z = vec3.z;
+            dst->acceleration.status = static_cast<int8_t>(vec3.status);
+            break;
+        }
+        case SensorType::ACCELEROMETER_UNCALIBRATED:
+        case SensorType::MAGNETIC_FIELD_UNCALIBRATED:
+        case SensorType::GYROSCOPE_UNCALIBRATED: {
+            const Event::EventPayload::Uncal &uncal = src.payload.get<Event::EventPayload::uncal>();
+            initSensorEvent(src, dst);
+            dst->uncalibrated_gyro.x_uncalib = uncal.x;
+            dst->uncalibrated_gyro.y_uncalib = uncal.y;
+            dst->uncalibrated_gyro.z_uncalib = uncal.z;
+            dst->uncalibrated_gyro.x_bias = uncal.xBias;
+            dst->uncalibrated_gyro.y_bias = uncal.yBias;
+            dst->uncalibrated_gyro.z_bias = uncal.zBias;
+            break;
+        }
+        default:
+            convertToSensorEvent(src, dst);
+            break;
+    }
+}
+
 } // anonymous namespace
 
 class AidlSensorsCallback : public ::aidl::android::hardware::sensors::BnSensorsCallback {
@@ -158,7 +203,7 @@ ssize_t AidlSensorHalWrapper::poll(sensors_event_t * /* buffer */, size_t /* cou
 }
 
 ssize_t AidlSensorHalWrapper::pollFmq(sensors_event_t *buffer, size_t maxNumEventsToRead) {
-    ssize_t eventsRead = 0;
+    size_t eventsRead = 0;
     size_t availableEvents = mEventQueue->availableToRead();
 
     if (availableEvents == 0) {
@@ -186,23 +231,31 @@ ssize_t AidlSensorHalWrapper::pollFmq(sensors_event_t *buffer, size_t maxNumEven
         }
     }
 
-    size_t eventsToRead = std::min({availableEvents, maxNumEventsToRead, mEventBuffer.size()});
-    if (eventsToRead > 0) {
-        if (mEventQueue->read(mEventBuffer.data(), eventsToRead)) {
-            // Notify the Sensors HAL that sensor events have been read. This is required to support
-            // the use of writeBlocking by the Sensors HAL.
-            if (mEventQueueFlag != nullptr) {
-                mEventQueueFlag->wake(asBaseType(ISensors::EVENT_QUEUE_FLAG_BITS_EVENTS_READ));
-            }
-
-            for (size_t i = 0; i < eventsToRead; i++) {
-                convertToSensorEvent(mEventBuffer[i], &buffer[i]);
-            }
-            eventsRead = eventsToRead;
-        } else {
+    // Read everything that is available, including the events that the HAL writes while the
+    // earlier ones are converted, up to the size of the buffer.
+    size_t eventsToRead = std::min(availableEvents, maxNumEventsToRead);
+    while (eventsToRead > 0) {
+        // The events are converted where they are in the FMQ, rather than copied out of it first.
+        AidlMessageQueue<Event, SynchronizedReadWrite>::MemTransaction tx;
+        if (!mEventQueue->beginRead(eventsToRead, &tx)) {
             ALOGW("Failed to read %zu events, currently %zu events available", eventsToRead,
                   availableEvents);
+            break;
+        }
+        for (size_t i = 0; i < eventsToRead; i++) {
+            convertEvent(*tx.getSlot(i), &buffer[eventsRead + i]);
         }
+        mEventQueue->commitRead(eventsToRead);
+        eventsRead += eventsToRead;
+
+        // Notify the Sensors HAL that sensor events have been read. This is required to support
+        // the use of writeBlocking by the Sensors HAL.
+        if (mEventQueueFlag != nullptr) {
+            mEventQueueFlag->wake(asBaseType(ISensors::EVENT_QUEUE_FLAG_BITS_EVENTS_READ));
+        }
+
+        availableEvents = mEventQueue->availableToRead();
+        eventsToRead = std::min(availableEvents, maxNumEventsToRead - eventsRead);
     }
 
     return eventsRead;
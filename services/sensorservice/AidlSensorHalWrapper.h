@@ -85,9 +85,6 @@ private:
     ::android::hardware::EventFlag *mEventQueueFlag;
     ::android::hardware::EventFlag *mWakeLockQueueFlag;
     SensorDeviceCallback *mSensorDeviceCallback;
-    std::array<::aidl::android::hardware::sensors::Event,
-               ::android::SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT>
-            mEventBuffer;
 
     ndk::ScopedAIBinder_DeathRecipient mDeathRecipient;
 };
@@ -311,6 +311,10 @@ bool Fusion::checkInitComplete(int what, const vec3_t& d, float dT) {
 }
 
 void Fusion::handleGyro(const vec3_t& w, float dT) {
+    // the geomagnetic fusion predicts from its own bias in handleAcc()
+    if (mMode == FUSION_NOGYRO)
+        return;
+
     if (!checkInitComplete(GYRO, w, dT))
         return;
 
@@ -431,9 +435,11 @@ void Fusion::predict(const vec3_t& w, float dT) {
     const vec4_t q  = x0;
     const vec3_t b  = x1;
     vec3_t we = w - b;
+    float lwe = length(we);
 
-    if (length(we) < WVEC_EPS) {
+    if (lwe < WVEC_EPS) {
         we = (we[0]>0.f)?WVEC_EPS:-WVEC_EPS;
+        lwe = length(we);
     }
     // q(k+1) = O(we)*q(k)
     // --------------------
@@ -460,14 +466,23 @@ void Fusion::predict(const vec3_t& w, float dT) {
     //  Phi10 =   [w]x   * (1        - cos(||w||*dt))/||w||^2
     //          - [w]x^2 * (||w||*dT - sin(||w||*dt))/||w||^3
     //          - I33*dT
+    //
+    // Since the bottom row of Phi is | 0 I33 |, and P is symmetric, the
+    // product is expanded by blocks below:
+    //
+    //  P00 = (Phi00*P00 + Phi10*P10t)*Phi00' + (Phi00*P10 + Phi10*P11)*Phi10'
+    //  P10 = Phi00*P10 + Phi10*P11
+    //  P11 = P11
+    //
+    // which takes 6 3x3 products instead of the 16 of the full 6x6 one.
 
     const mat33_t I33(1);
     const mat33_t I33dT(dT);
     const mat33_t wx(crossMatrix(we, 0));
     const mat33_t wx2(wx*wx);
-    const float lwedT = length(we)*dT;
+    const float lwedT = lwe*dT;
     const float hlwedT = 0.5f*lwedT;
-    const float ilwe = 1.f/length(we);
+    const float ilwe = 1.f/lwe;
     const float k0 = (1-cosf(lwedT))*(ilwe*ilwe);
     const float k1 = sinf(lwedT);
     const float k2 = cosf(hlwedT);
@@ -487,7 +502,15 @@ void Fusion::predict(const vec3_t& w, float dT) {
     if (x0.w < 0)
         x0 = -x0;
 
-    P = Phi*P*transpose(Phi) + GQGt;
+    const mat33_t& Phi00(Phi[0][0]);
+    const mat33_t& Phi10(Phi[1][0]);
+    const mat33_t P10t(transpose(P[1][0]));
+    const mat33_t PhiP10(Phi00*P[1][0] + Phi10*P[1][1]);
+    P[0][0] = (Phi00*P[0][0] + Phi10*P10t)*transpose(Phi00) + PhiP10*transpose(Phi10)
+            + GQGt[0][0];
+    P[1][0] = PhiP10 + GQGt[1][0];
+    P[0][1] = transpose(P[1][0]);
+    P[1][1] += GQGt[1][1];
 
     checkState();
 }
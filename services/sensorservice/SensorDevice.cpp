@@ -17,6 +17,7 @@
 #include "SensorDevice.h"
 
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 #include <android/util/ProtoOutputStream.h>
 #include <com_android_frameworks_sensorservice_flags.h>
 #include <cutils/atomic.h>
@@ -68,6 +69,12 @@ enum DevicePrivateBase : int32_t {
 
 } // anonymous namespace
 
+SensorDevice::HalWrapperFactory SensorDevice::sHalWrapperFactory;
+
+void SensorDevice::setHalWrapperFactory(HalWrapperFactory factory) {
+    sHalWrapperFactory = std::move(factory);
+}
+
 SensorDevice::SensorDevice() : mInHalBypassMode(false) {
     if (!connectHalService()) {
         return;
@@ -76,6 +83,12 @@ SensorDevice::SensorDevice() : mInHalBypassMode(false) {
     initializeSensorList();
 
     mIsDirectReportSupported = (mHalWrapper->unregisterDirectChannel(-1) != INVALID_OPERATION);
+
+    mCoalescingDelayNs =
+            ms2ns(base::GetIntProperty("ro.sensorservice.coalescing_delay_ms", 0, 0, 1000));
+    if (mCoalescingDelayNs > 0) {
+        mCoalescingThread = std::thread(&SensorDevice::coalescingThreadMain, this);
+    }
 }
 
 void SensorDevice::initializeSensorList() {
@@ -136,9 +149,27 @@ void SensorDevice::initializeSensorList() {
     }
 }
 
-SensorDevice::~SensorDevice() {}
+SensorDevice::~SensorDevice() {
+    if (mCoalescingThread.joinable()) {
+        {
+            Mutex::Autolock _l(mLock);
+            mExitCoalescingThread = true;
+            mCoalescingCondition.signal();
+        }
+        mCoalescingThread.join();
+    }
+}
 
 bool SensorDevice::connectHalService() {
+    if (sHalWrapperFactory) {
+        std::unique_ptr<ISensorHalWrapper> wrapper = sHalWrapperFactory();
+        if (wrapper != nullptr && wrapper->connect(this)) {
+            mHalWrapper = std::move(wrapper);
+            return true;
+        }
+        return false;
+    }
+
     std::unique_ptr<ISensorHalWrapper> aidl_wrapper = std::make_unique<AidlSensorHalWrapper>();
     if (aidl_wrapper->connect(this)) {
         mHalWrapper = std::move(aidl_wrapper);
@@ -303,6 +334,9 @@ std::string SensorDevice::dump() const {
         }
         result.appendFormat("}, selected = %.2f ms\n", info.bestBatchParams.mTBatch / 1e6f);
     }
+    result.appendFormat("HAL call coalescing delay = %" PRId64 " ms; %" PRIu64
+                        " updates deferred, %" PRIu64 " HAL calls made for them\n",
+                        ns2ms(mCoalescingDelayNs), mDeferredHalUpdates, mCoalescedHalCalls);
 
     return result.c_str();
 }
@@ -519,7 +553,10 @@ status_t SensorDevice::activateLocked(void* ident, int handle, int enabled) {
         // End of TODO(b/316958439)
 
         if (info.removeBatchParamsForIdent(ident) >= 0) {
-            if (info.numActiveClients() == 0) {
+            if (mCoalescingDelayNs > 0 && info.isActive) {
+                // Another client may want the sensor before the delay is over.
+                deferHalUpdateLocked(info);
+            } else if (info.numActiveClients() == 0) {
                 // This is the last connection, we need to de-activate the underlying h/w sensor.
                 activateHardware = true;
             } else {
@@ -625,17 +662,70 @@ status_t SensorDevice::updateBatchParamsLocked(int handle, Info& info) {
              prevBestBatchParams.mTBatch, info.bestBatchParams.mTBatch);
 
     status_t err(NO_ERROR);
-    // If the min period or min timeout has changed since the last batch call, call batch.
-    if (prevBestBatchParams != info.bestBatchParams && info.numActiveClients() > 0) {
+    // If the min period or min timeout has changed since the last batch call, call batch. A
+    // deferred update may also have left the HAL with stale parameters.
+    if ((prevBestBatchParams != info.bestBatchParams || info.halUpdatePending) &&
+        info.numActiveClients() > 0) {
         ALOGD_IF(DEBUG_CONNECTIONS, "\t>>> actuating h/w BATCH 0x%08x %" PRId64 " %" PRId64, handle,
                  info.bestBatchParams.mTSample, info.bestBatchParams.mTBatch);
         err = mHalWrapper->batch(handle, info.bestBatchParams.mTSample,
                                  info.bestBatchParams.mTBatch);
+        info.halUpdatePending = false;
     }
 
     return err;
 }
 
+void SensorDevice::deferHalUpdateLocked(Info& info) {
+    info.halUpdatePending = true;
+    mDeferredHalUpdates++;
+    if (!mCoalescingScheduled) {
+        mCoalescingScheduled = true;
+        mCoalescingDeadline = systemTime(SYSTEM_TIME_MONOTONIC) + mCoalescingDelayNs;
+        mCoalescingCondition.signal();
+    }
+}
+
+void SensorDevice::coalescingThreadMain() {
+    Mutex::Autolock _l(mLock);
+    while (!mExitCoalescingThread) {
+        if (!mCoalescingScheduled) {
+            mCoalescingCondition.wait(mLock);
+            continue;
+        }
+        const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (now < mCoalescingDeadline) {
+            mCoalescingCondition.waitRelative(mLock, mCoalescingDeadline - now);
+            continue;
+        }
+        mCoalescingScheduled = false;
+        flushDeferredHalUpdatesLocked();
+    }
+}
+
+void SensorDevice::flushDeferredHalUpdatesLocked() {
+    for (size_t i = 0; i < mActivationCount.size(); ++i) {
+        Info& info = mActivationCount.editValueAt(i);
+        if (!info.halUpdatePending) continue;
+        info.halUpdatePending = false;
+        // The sensor was deactivated or auto-disabled in the meantime.
+        if (!info.isActive) continue;
+
+        const int handle = mActivationCount.keyAt(i);
+        if (info.numActiveClients() == 0) {
+            // As in activateLocked, the flag is cleared even if the HAL fails to disable it.
+            doActivateHardwareLocked(handle, false);
+            info.isActive = false;
+        } else {
+            ALOGD_IF(DEBUG_CONNECTIONS, "\t>>> actuating h/w batch 0x%08x %" PRId64 " %" PRId64,
+                     handle, info.bestBatchParams.mTSample, info.bestBatchParams.mTBatch);
+            mHalWrapper->batch(handle, info.bestBatchParams.mTSample,
+                               info.bestBatchParams.mTBatch);
+        }
+        mCoalescedHalCalls++;
+    }
+}
+
 status_t SensorDevice::setDelay(void* ident, int handle, int64_t samplingPeriodNs) {
     return batch(ident, handle, 0, samplingPeriodNs, 0);
 }
@@ -29,6 +29,7 @@
 #include <sensor/SensorEventQueue.h>
 #include <stdint.h>
 #include <sys/types.h>
+#include <utils/Condition.h>
 #include <utils/KeyedVector.h>
 #include <utils/Singleton.h>
 #include <utils/String8.h>
@@ -36,9 +37,11 @@
 
 #include <algorithm> //std::max std::min
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <queue>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -54,6 +57,13 @@ class SensorDevice : public Singleton<SensorDevice>,
                      public SensorServiceUtil::Dumpable,
                      public ISensorHalWrapper::SensorDeviceCallback {
 public:
+    using HalWrapperFactory = std::function<std::unique_ptr<ISensorHalWrapper>()>;
+
+    // Makes the SensorDevice connect to the HAL wrapper returned by this factory, in place of the
+    // AIDL or HIDL sensors HAL, so that SensorService can be run on a fake HAL. This has to be
+    // called before the first getInstance().
+    static void setHalWrapperFactory(HalWrapperFactory factory);
+
     ~SensorDevice();
     void prepareForReconnect();
     void reconnect();
@@ -121,6 +131,8 @@ public:
 private:
     friend class Singleton<SensorDevice>;
 
+    static HalWrapperFactory sHalWrapperFactory;
+
     std::unique_ptr<ISensorHalWrapper> mHalWrapper;
 
     std::vector<sensor_t> mSensorList;
@@ -171,6 +183,10 @@ private:
         // Flag to track if the sensor is active
         bool isActive = false;
 
+        // Set when the HAL calls needed by a client going away were held back, so that they can be
+        // coalesced with the other changes made within the coalescing delay.
+        bool halUpdatePending = false;
+
         // Sets batch parameters for this ident. Returns error if this ident is not already present
         // in the KeyedVector above.
         status_t setBatchParamsForIdent(void* ident, int flags, int64_t samplingPeriodNs,
@@ -229,6 +245,24 @@ private:
     status_t updateBatchParamsLocked(int handle, Info& info);
     status_t doActivateHardwareLocked(int handle, bool enable);
 
+    // The HAL calls which deactivate a sensor or lower its rate once a client goes away are held
+    // back for this long, so that an app switch, whose new clients often want the same sensors,
+    // makes one pass of HAL calls with the final state of each sensor. Set with
+    // ro.sensorservice.coalescing_delay_ms; 0, the default, makes the calls right away.
+    nsecs_t mCoalescingDelayNs = 0;
+    Condition mCoalescingCondition;
+    bool mCoalescingScheduled = false;
+    nsecs_t mCoalescingDeadline = 0;
+    bool mExitCoalescingThread = false;
+    std::thread mCoalescingThread;
+    // The HAL updates held back, and the HAL calls that the passes made for them in the end.
+    uint64_t mDeferredHalUpdates = 0;
+    uint64_t mCoalescedHalCalls = 0;
+
+    void deferHalUpdateLocked(Info& info);
+    void coalescingThreadMain();
+    void flushDeferredHalUpdatesLocked();
+
     bool isClientDisabled(void* ident) const;
     bool isClientDisabledLocked(void* ident) const;
     std::vector<void*> getDisabledClientsLocked() const;
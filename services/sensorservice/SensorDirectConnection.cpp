@@ -18,14 +18,33 @@
 #include <android/util/ProtoOutputStream.h>
 #include <frameworks/base/core/proto/android/service/sensor_service.proto.h>
 #include <hardware/sensors.h>
+#include <sys/mman.h>
 #include "SensorDevice.h"
 
+#include <algorithm>
+
 #define UNUSED(x) (void)(x)
 
 namespace android {
 
 using util::ProtoOutputStream;
 
+namespace {
+
+// The nominal sampling period of each direct report rate level.
+nsecs_t directReportPeriodNs(int rateLevel) {
+    switch (rateLevel) {
+        case SENSOR_DIRECT_RATE_VERY_FAST:
+            return 1250000; // 800Hz
+        case SENSOR_DIRECT_RATE_FAST:
+            return 5000000; // 200Hz
+        default:
+            return 20000000; // 50Hz
+    }
+}
+
+} // namespace
+
 SensorService::SensorDirectConnection::SensorDirectConnection(
         const sp<SensorService>& service, uid_t uid, pid_t pid, const sensors_direct_mem_t* mem,
         int32_t halChannelHandle, const String16& opPackageName, int deviceId)
@@ -54,6 +73,13 @@ void SensorService::SensorDirectConnection::destroy() {
     }
 
     stopAll();
+    {
+        Mutex::Autolock _l(mConnectionLock);
+        if (mEmulatedMemory != nullptr) {
+            munmap(mEmulatedMemory, mMem.size);
+            mEmulatedMemory = nullptr;
+        }
+    }
     mService->cleanupConnection(this);
     if (mMem.handle != nullptr) {
         native_handle_close_with_tag(mMem.handle);
@@ -295,7 +321,9 @@ void SensorService::SensorDirectConnection::uncapRates() {
 
 int SensorService::SensorDirectConnection::configure(
         int handle, const sensors_direct_cfg_t* config) {
-    if (mDeviceId == RuntimeSensor::DEFAULT_DEVICE_ID) {
+    if (mDeviceId == RuntimeSensor::DEFAULT_DEVICE_ID && mService->isDirectReportEmulated()) {
+        return configureEmulated(handle, config);
+    } else if (mDeviceId == RuntimeSensor::DEFAULT_DEVICE_ID) {
         SensorDevice& dev(SensorDevice::getInstance());
         return dev.configureDirectChannel(handle, getHalChannelHandle(), config);
     } else {
@@ -303,6 +331,90 @@ int SensorService::SensorDirectConnection::configure(
     }
 }
 
+int SensorService::SensorDirectConnection::configureEmulated(
+        int handle, const sensors_direct_cfg_t* config) {
+    std::shared_ptr<SensorInterface> si = mService->getSensorInterfaceFromHandle(handle);
+    if (si == nullptr) {
+        return NAME_NOT_FOUND;
+    }
+
+    if (config->rate_level == SENSOR_DIRECT_RATE_STOP) {
+        if (mEmulatedReports.erase(handle) > 0) {
+            si->activate(this, false);
+        }
+        return NO_ERROR;
+    }
+
+    if (mMem.size < sizeof(sensors_event_t)) {
+        return BAD_VALUE;
+    }
+    if (mEmulatedMemory == nullptr) {
+        void* memory = mmap(nullptr, mMem.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                            mMem.handle->data[0], 0);
+        if (memory == MAP_FAILED) {
+            ALOGE("Could not map direct channel memory: %s", strerror(errno));
+            return NO_MEMORY;
+        }
+        mEmulatedMemory = static_cast<uint8_t*>(memory);
+    }
+
+    const nsecs_t periodNs =
+            std::max(directReportPeriodNs(config->rate_level), si->getSensor().getMinDelayNs());
+    status_t err = si->batch(this, handle, /*flags=*/0, periodNs, /*maxBatchReportLatencyNs=*/0);
+    if (err == NO_ERROR) {
+        err = si->activate(this, true);
+    }
+    if (err != NO_ERROR) {
+        mEmulatedReports.erase(handle);
+        si->activate(this, false);
+        return err;
+    }
+    mEmulatedReports[handle] = {.periodNs = periodNs, .lastTimestamp = 0};
+    // Sensor handles are unique, so they can be the report tokens of the channel.
+    return handle;
+}
+
+void SensorService::SensorDirectConnection::writeEmulatedReports(const sensors_event_t* buffer,
+                                                                 size_t count) {
+    Mutex::Autolock _l(mConnectionLock);
+    if (mEmulatedReports.empty()) {
+        return;
+    }
+
+    const size_t capacity = mMem.size / sizeof(sensors_event_t);
+    for (size_t i = 0; i < count; i++) {
+        const sensors_event_t& event = buffer[i];
+        if (event.type == SENSOR_TYPE_META_DATA) {
+            continue;
+        }
+        auto it = mEmulatedReports.find(event.sensor);
+        if (it == mEmulatedReports.end()) {
+            continue;
+        }
+        // Other clients can run the sensor faster than the rate level of this channel, so drop the
+        // events that would take it above the range of its rate level.
+        EmulatedReport& report = it->second;
+        if (report.lastTimestamp != 0 &&
+            event.timestamp - report.lastTimestamp < report.periodNs / 2) {
+            continue;
+        }
+        report.lastTimestamp = event.timestamp;
+
+        sensors_event_t* slot =
+                reinterpret_cast<sensors_event_t*>(mEmulatedMemory) + mNextEmulatedReport;
+        mNextEmulatedReport = (mNextEmulatedReport + 1) % capacity;
+        // The counter of a report is 0 until it is first written, and the reader checks it to tell
+        // whether the report is new, so it is written last, after the rest of the report.
+        mEmulatedCounter = mEmulatedCounter == UINT32_MAX ? 1 : mEmulatedCounter + 1;
+        sensors_event_t out = event;
+        out.version = sizeof(sensors_event_t);
+        out.reserved0 = slot->reserved0;
+        *slot = out;
+        __atomic_store_n(&slot->reserved0, static_cast<int32_t>(mEmulatedCounter),
+                         __ATOMIC_RELEASE);
+    }
+}
+
 void SensorService::SensorDirectConnection::stopAll(bool backupRecord) {
     Mutex::Autolock _l(mConnectionLock);
     stopAllLocked(backupRecord);
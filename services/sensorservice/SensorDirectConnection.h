@@ -21,6 +21,7 @@
 #include <stdint.h>
 #include <sys/types.h>
 #include <optional>
+#include <unordered_map>
 
 #include <binder/BinderService.h>
 
@@ -56,6 +57,10 @@ public:
     userid_t getUserId() const { return mUserId; }
     int getDeviceId() const { return mDeviceId; }
 
+    // Writes the events that this channel reports into its memory, when the sensor service writes
+    // the direct reports instead of the HAL.
+    void writeEmulatedReports(const sensors_event_t* buffer, size_t count);
+
 protected:
     virtual ~SensorDirectConnection();
     // ISensorEventConnection functions
@@ -72,6 +77,9 @@ private:
 
     // Sends the configuration to the relevant sensor device.
     int configure(int handle, const sensors_direct_cfg_t* config);
+    // Same as configure(), for a channel whose reports are written by the sensor service. The
+    // sensor is enabled at the period of the rate level, with this connection as the client.
+    int configureEmulated(int handle, const sensors_direct_cfg_t* config);
 
     // Stops all active sensor direct report requests.
     //
@@ -118,6 +126,17 @@ private:
 
     std::optional<bool> mIsRateCappedBasedOnPermission;
 
+    // The state of the sensors whose reports the sensor service writes into this channel.
+    struct EmulatedReport {
+        nsecs_t periodNs;
+        int64_t lastTimestamp;
+    };
+    std::unordered_map<int, EmulatedReport> mEmulatedReports;
+    // The memory of the channel, mapped when the first sensor is configured.
+    uint8_t* mEmulatedMemory = nullptr;
+    size_t mNextEmulatedReport = 0;
+    uint32_t mEmulatedCounter = 0;
+
     bool isRateCappedBasedOnPermission() {
       if (!mIsRateCappedBasedOnPermission.has_value()) {
         mIsRateCappedBasedOnPermission =
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <inttypes.h>
 #include <log/log.h>
 #include <sys/socket.h>
 #include <utils/threads.h>
@@ -42,7 +43,8 @@ SensorService::SensorEventConnection::SensorEventConnection(
         const String16& opPackageName, const String16& attributionTag)
     : mService(service), mUid(uid), mWakeLockRefCount(0), mHasLooperCallbacks(false),
       mDead(false), mDataInjectionMode(isDataInjectionMode), mEventCache(nullptr),
-      mCacheSize(0), mMaxCacheSize(0), mTimeOfLastEventDrop(0), mEventsDropped(0),
+      mCacheHead(0), mCacheSize(0), mMaxCacheSize(0), mCacheHighWaterMark(0),
+      mTimeOfLastEventDrop(0), mEventsDropped(0), mTotalEventsDropped(0),
       mPackageName(packageName), mOpPackageName(opPackageName), mAttributionTag(attributionTag),
       mTargetSdk(kTargetSdkUnknown), mDestroyed(false) {
     mUserId = multiuser_get_user_id(mUid);
@@ -93,6 +95,8 @@ void SensorService::SensorEventConnection::dump(String8& result) {
                         "max cache size %d | has sensor access: %s\n",
                         mPackageName.c_str(), mWakeLockRefCount, mUid, mCacheSize, mMaxCacheSize,
                         hasSensorAccess() ? "true" : "false");
+    result.appendFormat("\t cache high water mark %d | events dropped from cache %" PRIu64 "\n",
+                        mCacheHighWaterMark, mTotalEventsDropped);
     for (auto& it : mSensorInfo) {
         const FlushInfo& flushInfo = it.second;
         result.appendFormat("\t %s 0x%08x | first flush pending: %s | pending flush events %d \n",
@@ -416,11 +420,6 @@ status_t SensorService::SensorEventConnection::sendEvents(
             --mTotalAcksNeeded;
 #endif
         }
-        if (mEventCache == nullptr) {
-            mMaxCacheSize = computeMaxCacheSizeLocked();
-            mEventCache = new sensors_event_t[mMaxCacheSize];
-            mCacheSize = 0;
-        }
         // Save the events so that they can be written later
         appendEventsToCacheLocked(scratch, count);
 
@@ -478,75 +477,94 @@ bool SensorService::SensorEventConnection::noteOpIfRequired(const sensors_event_
     return success;
 }
 
-void SensorService::SensorEventConnection::reAllocateCacheLocked(sensors_event_t const* scratch,
-                                                                 int count) {
-    sensors_event_t *eventCache_new;
-    const int new_cache_size = computeMaxCacheSizeLocked();
-    // Allocate new cache, copy over events from the old cache & scratch, free up memory.
-    eventCache_new = new sensors_event_t[new_cache_size];
-    memcpy(eventCache_new, mEventCache, mCacheSize * sizeof(sensors_event_t));
-    memcpy(&eventCache_new[mCacheSize], scratch, count * sizeof(sensors_event_t));
+void SensorService::SensorEventConnection::reAllocateCacheLocked(int maxCacheSize) {
+    // Allocate new cache, copy over the events from the old cache in order, free up memory.
+    sensors_event_t* eventCache_new = new sensors_event_t[maxCacheSize];
+    const int firstPart = std::min(mCacheSize, mMaxCacheSize - mCacheHead);
+    if (mCacheSize > 0) {
+        memcpy(eventCache_new, &mEventCache[mCacheHead], firstPart * sizeof(sensors_event_t));
+        memcpy(&eventCache_new[firstPart], mEventCache,
+               (mCacheSize - firstPart) * sizeof(sensors_event_t));
+    }
 
     ALOGD_IF(DEBUG_CONNECTIONS, "reAllocateCacheLocked maxCacheSize=%d %d", mMaxCacheSize,
-            new_cache_size);
+            maxCacheSize);
 
     delete[] mEventCache;
     mEventCache = eventCache_new;
-    mCacheSize += count;
-    mMaxCacheSize = new_cache_size;
+    mCacheHead = 0;
+    mMaxCacheSize = maxCacheSize;
+}
+
+sensors_event_t& SensorService::SensorEventConnection::cachedEventLocked(int index) {
+    return mEventCache[(mCacheHead + index) % mMaxCacheSize];
+}
+
+void SensorService::SensorEventConnection::dropCachedEventLocked() {
+    // Drop the oldest event of a non wake-up sensor, so that wake-up events, which the app has to
+    // acknowledge, are kept for as long as possible.
+    int index = 0;
+    while (index < mCacheSize && mService->isWakeUpSensorEvent(cachedEventLocked(index))) {
+        index++;
+    }
+    if (index == mCacheSize) {
+        index = 0;
+    }
+    countFlushCompleteEventsLocked(&cachedEventLocked(index), 1);
+    for (int i = index; i > 0; i--) {
+        cachedEventLocked(i) = cachedEventLocked(i - 1);
+    }
+    mCacheHead = (mCacheHead + 1) % mMaxCacheSize;
+    mCacheSize--;
 }
 
 void SensorService::SensorEventConnection::appendEventsToCacheLocked(sensors_event_t const* events,
                                                                      int count) {
     if (count <= 0) {
         return;
-    } else if (mCacheSize + count <= mMaxCacheSize) {
-        // The events fit within the current cache: add them
-        memcpy(&mEventCache[mCacheSize], events, count * sizeof(sensors_event_t));
-        mCacheSize += count;
-    } else if (mCacheSize + count <= computeMaxCacheSizeLocked()) {
-        // The events fit within a resized cache: resize the cache and add the events
-        reAllocateCacheLocked(events, count);
-    } else {
-        // The events do not fit within the cache: drop the oldest events.
-        int freeSpace = mMaxCacheSize - mCacheSize;
-
-        // Drop up to the currently cached number of events to make room for new events
-        int cachedEventsToDrop = std::min(mCacheSize, count - freeSpace);
+    }
+    if (mCacheSize + count > mMaxCacheSize) {
+        // The cache only grows when the sensors of the connection need a larger one.
+        const int maxCacheSize = computeMaxCacheSizeLocked();
+        if (maxCacheSize > mMaxCacheSize) {
+            reAllocateCacheLocked(maxCacheSize);
+        }
+    }
 
-        // New events need to be dropped if there are more new events than the size of the cache
-        int newEventsToDrop = std::max(0, count - mMaxCacheSize);
+    int eventsDropped = 0;
+    if (count > mMaxCacheSize) {
+        // There are more new events than the size of the cache: only the newest ones fit.
+        const int newEventsToDrop = count - mMaxCacheSize;
+        countFlushCompleteEventsLocked(events, newEventsToDrop);
+        events += newEventsToDrop;
+        count = mMaxCacheSize;
+        eventsDropped += newEventsToDrop;
+    }
+    while (mCacheSize + count > mMaxCacheSize) {
+        dropCachedEventLocked();
+        eventsDropped++;
+    }
 
-        // Determine the number of new events to copy into the cache
-        int eventsToCopy = std::min(mMaxCacheSize, count);
+    // Copy the events into the cache, wrapping around its end.
+    const int tail = (mCacheHead + mCacheSize) % mMaxCacheSize;
+    const int firstPart = std::min(count, mMaxCacheSize - tail);
+    memcpy(&mEventCache[tail], events, firstPart * sizeof(sensors_event_t));
+    memcpy(mEventCache, &events[firstPart], (count - firstPart) * sizeof(sensors_event_t));
+    mCacheSize += count;
+    mCacheHighWaterMark = std::max(mCacheHighWaterMark, mCacheSize);
 
+    if (eventsDropped > 0) {
+        mTotalEventsDropped += eventsDropped;
         constexpr nsecs_t kMinimumTimeBetweenDropLogNs = 2 * 1000 * 1000 * 1000; // 2 sec
         if (events[0].timestamp - mTimeOfLastEventDrop > kMinimumTimeBetweenDropLogNs) {
-            ALOGW("Dropping %d cached events (%d/%d) to save %d/%d new events. %d events previously"
-                    " dropped", cachedEventsToDrop, mCacheSize, mMaxCacheSize, eventsToCopy,
-                    count, mEventsDropped);
+            ALOGW("Dropped %d events to save %d new events in cache of %d. %d events previously"
+                    " dropped", eventsDropped, count, mMaxCacheSize, mEventsDropped);
             mEventsDropped = 0;
             mTimeOfLastEventDrop = events[0].timestamp;
         } else {
             // Record the number dropped
-            mEventsDropped += cachedEventsToDrop + newEventsToDrop;
-        }
-
-        // Check for any flush complete events in the events that will be dropped
-        countFlushCompleteEventsLocked(mEventCache, cachedEventsToDrop);
-        countFlushCompleteEventsLocked(events, newEventsToDrop);
-
-        // Only shift the events if they will not all be overwritten
-        if (eventsToCopy != mMaxCacheSize) {
-            memmove(mEventCache, &mEventCache[cachedEventsToDrop],
-                    (mCacheSize - cachedEventsToDrop) * sizeof(sensors_event_t));
+            mEventsDropped += eventsDropped;
         }
-        mCacheSize -= cachedEventsToDrop;
-
-        // Copy the events into the cache
-        memcpy(&mEventCache[mCacheSize], &events[newEventsToDrop],
-                eventsToCopy * sizeof(sensors_event_t));
-        mCacheSize += eventsToCopy;
     }
 }
 
@@ -591,15 +609,16 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
     Mutex::Autolock _l(mConnectionLock);
     // Send pending flush complete events (if any)
     sendPendingFlushEventsLocked();
-    for (int numEventsSent = 0; numEventsSent < mCacheSize;) {
-        const int numEventsToWrite = helpers::min(mCacheSize - numEventsSent, maxWriteSize);
+    while (mCacheSize > 0) {
+        // Write the events up to the end of the cache, or up to the newest one if it comes first.
+        const int numEventsToWrite =
+                helpers::min(helpers::min(mCacheSize, mMaxCacheSize - mCacheHead), maxWriteSize);
+        sensors_event_t* events = mEventCache + mCacheHead;
         int index_wake_up_event = -1;
         if (hasSensorAccess()) {
-            index_wake_up_event =
-                      findWakeUpSensorEventLocked(mEventCache + numEventsSent, numEventsToWrite);
+            index_wake_up_event = findWakeUpSensorEventLocked(events, numEventsToWrite);
             if (index_wake_up_event >= 0) {
-                mEventCache[index_wake_up_event + numEventsSent].flags |=
-                        WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
+                events[index_wake_up_event].flags |= WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
                 ++mWakeLockRefCount;
 #if DEBUG_CONNECTIONS
                 ++mTotalAcksNeeded;
@@ -608,13 +627,11 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
         }
 
         ssize_t size = SensorEventQueue::write(mChannel,
-                          reinterpret_cast<ASensorEvent const*>(mEventCache + numEventsSent),
-                          numEventsToWrite);
+                          reinterpret_cast<ASensorEvent const*>(events), numEventsToWrite);
         if (size < 0) {
             if (index_wake_up_event >= 0) {
                 // If there was a wake_up sensor_event, reset the flag.
-                mEventCache[index_wake_up_event + numEventsSent].flags  &=
-                        ~WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
+                events[index_wake_up_event].flags &= ~WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
                 if (mWakeLockRefCount > 0) {
                     --mWakeLockRefCount;
                 }
@@ -622,21 +639,18 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
                 --mTotalAcksNeeded;
 #endif
             }
-            memmove(mEventCache, &mEventCache[numEventsSent],
-                                 (mCacheSize - numEventsSent) * sizeof(sensors_event_t));
-            ALOGD_IF(DEBUG_CONNECTIONS, "wrote %d events from cache size==%d ",
-                    numEventsSent, mCacheSize);
-            mCacheSize -= numEventsSent;
+            ALOGD_IF(DEBUG_CONNECTIONS, "%d events left in cache", mCacheSize);
             return;
         }
-        numEventsSent += numEventsToWrite;
+        mCacheHead = (mCacheHead + numEventsToWrite) % mMaxCacheSize;
+        mCacheSize -= numEventsToWrite;
 #if DEBUG_CONNECTIONS
         mEventsSentFromCache += numEventsToWrite;
 #endif
     }
-    ALOGD_IF(DEBUG_CONNECTIONS, "wrote all events from cache size=%d ", mCacheSize);
-    // All events from the cache have been sent. Reset cache size to zero.
-    mCacheSize = 0;
+    ALOGD_IF(DEBUG_CONNECTIONS, "wrote all events from cache");
+    // All events from the cache have been sent.
+    mCacheHead = 0;
     // There are no more events in the cache. We don't need to poll for write on the fd.
     // Update Looper registration.
     updateLooperRegistrationLocked(mService->getLooper());
@@ -109,12 +109,19 @@ private:
     // amongst wake-up sensors and non-wake up sensors.
     int computeMaxCacheSizeLocked() const;
 
-    // When more sensors register, the maximum cache size desired may change.  Compute max cache
-    // size, reallocate memory and copy over events from the older cache.
-    void reAllocateCacheLocked(sensors_event_t const* scratch, int count);
+    // When more sensors register, the maximum cache size desired may change. Reallocate memory of
+    // the given size and copy over events from the older cache.
+    void reAllocateCacheLocked(int maxCacheSize);
 
-    // Add the events to the cache. If the cache would be exceeded, drop events at the beginning of
-    // the cache.
+    // Returns the cached event at the given position, 0 being the oldest one.
+    sensors_event_t& cachedEventLocked(int index);
+
+    // Drops the oldest cached event of a non wake-up sensor, or the oldest event if they are all
+    // from wake-up sensors.
+    void dropCachedEventLocked();
+
+    // Add the events to the cache. If the cache would be exceeded, drop the oldest events of non
+    // wake-up sensors first.
     void appendEventsToCacheLocked(sensors_event_t const* events, int count);
 
     // LooperCallback method. If there is data to read on this fd, it is an ack from the app that it
@@ -179,10 +186,16 @@ private:
     // protected by SensorService::mLock. Key for this map is the sensor handle.
     std::unordered_map<int32_t, FlushInfo> mSensorInfo;
 
+    // A ring of mMaxCacheSize events, of which mCacheSize are cached, starting at mCacheHead. It is
+    // only reallocated when the sensors of the connection need a larger one.
     sensors_event_t *mEventCache;
-    int mCacheSize, mMaxCacheSize;
+    int mCacheHead, mCacheSize, mMaxCacheSize;
+    // The largest number of events that have been cached at once, for dumpsys.
+    int mCacheHighWaterMark;
     int64_t mTimeOfLastEventDrop;
+    // The number of events dropped since the last drop was logged.
     int mEventsDropped;
+    uint64_t mTotalEventsDropped;
     String8 mPackageName;
     const String16 mOpPackageName;
     const String16 mAttributionTag;
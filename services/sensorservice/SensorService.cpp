@@ -48,6 +48,7 @@
 #include <unistd.h>
 #include <utils/SystemClock.h>
 
+#include <algorithm>
 #include <condition_variable>
 #include <ctime>
 #include <future>
@@ -99,6 +100,9 @@ std::atomic_uint64_t SensorService::completedCallbackSeq(0);
 #define SENSOR_SERVICE_DIR "/data/system/sensor_service"
 #define SENSOR_SERVICE_HMAC_KEY_FILE  SENSOR_SERVICE_DIR "/hmac_key"
 #define SENSOR_SERVICE_SCHED_FIFO_PRIORITY 10
+// Opts in to writing the reports of ashmem direct channels in the sensor service, on devices whose
+// HAL has no direct report support.
+#define SENSOR_SERVICE_EMULATED_DIRECT_REPORT_PROPERTY "ro.sensorservice.emulated_direct_report"
 
 // Permissions.
 static const String16 sAccessHighSensorSamplingRatePermission(
@@ -131,6 +135,29 @@ class RuntimeSensorCallbackProxy : public RuntimeSensor::SensorCallback {
     sp<SensorService::RuntimeSensorCallback> mCallback;
 };
 
+bool supportsDirectReport(const sensor_t& sensor) {
+    return (sensor.flags & SENSOR_FLAG_MASK_DIRECT_REPORT) != 0;
+}
+
+// Returns the highest direct report rate level at which the sensor service can write the events of
+// this HAL sensor into a direct channel, or SENSOR_DIRECT_RATE_STOP if it cannot. Direct report is
+// only defined for continuous sensors, and the sensor has to reach the nominal rate of the level.
+int32_t emulatedDirectReportRateLevel(const sensor_t& sensor) {
+    if ((sensor.flags & REPORTING_MODE_MASK) != SENSOR_FLAG_CONTINUOUS_MODE ||
+        (sensor.flags & SENSOR_FLAG_WAKE_UP) != 0 || sensor.minDelay <= 0) {
+        return SENSOR_DIRECT_RATE_STOP;
+    }
+    const int32_t maxRateHz = 1000000 / sensor.minDelay;
+    if (maxRateHz >= 800) {
+        return SENSOR_DIRECT_RATE_VERY_FAST;
+    } else if (maxRateHz >= 200) {
+        return SENSOR_DIRECT_RATE_FAST;
+    } else if (maxRateHz >= 50) {
+        return SENSOR_DIRECT_RATE_NORMAL;
+    }
+    return SENSOR_DIRECT_RATE_STOP;
+}
+
 } // namespace
 
 static bool isAutomotive() {
@@ -316,6 +343,10 @@ void SensorService::onFirstRef() {
                     (1<<SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR) |
                     (1<<SENSOR_TYPE_GAME_ROTATION_VECTOR);
 
+            mDirectReportEmulated =
+                    property_get_bool(SENSOR_SERVICE_EMULATED_DIRECT_REPORT_PROPERTY, false) &&
+                    std::none_of(list, list + count, supportsDirectReport);
+
             for (ssize_t i=0 ; i<count ; i++) {
                 bool useThisSensor = true;
 
@@ -361,6 +392,14 @@ void SensorService::onFirstRef() {
                         if (registerSensor(std::move(s))) {
                             mProxSensorHandles.push_back(handle);
                         }
+                    } else if (mDirectReportEmulated) {
+                        sensor_t sensor = list[i];
+                        const int32_t rateLevel = emulatedDirectReportRateLevel(sensor);
+                        if (rateLevel != SENSOR_DIRECT_RATE_STOP) {
+                            sensor.flags |= (rateLevel << SENSOR_FLAG_SHIFT_DIRECT_REPORT) |
+                                    SENSOR_FLAG_DIRECT_CHANNEL_ASHMEM;
+                        }
+                        registerSensor(std::make_shared<HardwareSensor>(sensor));
                     } else {
                         registerSensor(std::make_shared<HardwareSensor>(list[i]));
                     }
@@ -689,7 +728,8 @@ status_t SensorService::dump(int fd, const Vector<String16>& args) {
             }
 
             const auto& directConnections = connLock.getDirectConnections();
-            result.appendFormat("%zd open direct connections\n", directConnections.size());
+            result.appendFormat("%zd open direct connections%s\n", directConnections.size(),
+                                mDirectReportEmulated ? " (written by sensor service)" : "");
             for (size_t i = 0 ; i < directConnections.size() ; i++) {
                 result.appendFormat("Direct connection %zu:\n", i);
                 directConnections[i]->dump(result);
@@ -1284,6 +1324,12 @@ bool SensorService::threadLoop() {
         // Send our events to clients. Check the state of wake lock for each client and release the
         // lock if none of the clients need it.
         sendEventsToAllClients(activeConnections, count);
+
+        if (mDirectReportEmulated) {
+            for (const sp<SensorDirectConnection>& connection : connLock.getDirectConnections()) {
+                connection->writeEmulatedReports(mSensorEventBuffer, count);
+            }
+        }
     } while (!Thread::exitPending());
 
     ALOGW("Exiting SensorService::threadLoop => aborting...");
@@ -1727,7 +1773,15 @@ sp<ISensorEventConnection> SensorService::createSensorDirectConnection(
 
     sp<SensorDirectConnection> conn;
     int channelHandle = 0;
-    if (deviceId == RuntimeSensor::DEFAULT_DEVICE_ID) {
+    if (deviceId == RuntimeSensor::DEFAULT_DEVICE_ID && mDirectReportEmulated) {
+        // The sensor service writes the reports of this channel, so the HAL does not know of it.
+        if (type == SENSOR_DIRECT_MEM_TYPE_ASHMEM) {
+            channelHandle = mNextEmulatedDirectChannelHandle++;
+        } else {
+            ALOGE("Direct channel memory type %d is not supported without HAL direct report",
+                  type);
+        }
+    } else if (deviceId == RuntimeSensor::DEFAULT_DEVICE_ID) {
         SensorDevice& dev(SensorDevice::getInstance());
         channelHandle = dev.registerDirectChannel(&mem);
     } else {
@@ -1935,7 +1989,9 @@ void SensorService::cleanupConnection(SensorDirectConnection* c) {
     Mutex::Autolock _l(mLock);
 
     int deviceId = c->getDeviceId();
-    if (deviceId == RuntimeSensor::DEFAULT_DEVICE_ID) {
+    if (deviceId == RuntimeSensor::DEFAULT_DEVICE_ID && mDirectReportEmulated) {
+        // The channel was never registered with the HAL.
+    } else if (deviceId == RuntimeSensor::DEFAULT_DEVICE_ID) {
         SensorDevice& dev(SensorDevice::getInstance());
         dev.unregisterDirectChannel(c->getHalChannelHandle());
     } else {
@@ -413,6 +413,7 @@ private:
     String8 getSensorStringType(int handle) const;
     bool isVirtualSensor(int handle) const;
     std::shared_ptr<SensorInterface> getSensorInterfaceFromHandle(int handle) const;
+    bool isDirectReportEmulated() const { return mDirectReportEmulated; }
     int getDeviceIdFromHandle(int handle) const;
     bool isWakeUpSensor(int type) const;
     void recordLastValueLocked(sensors_event_t const* buffer, size_t count);
@@ -605,6 +606,12 @@ private:
     // Stores the handle of the dynamic_meta sensor to send clean up event once
     // HAL crashes.
     std::optional<int> mDynamicMetaSensorHandle;
+
+    // Whether the sensor service writes the reports of direct channels itself, because the HAL
+    // does not support direct report. Set once, in onFirstRef().
+    bool mDirectReportEmulated = false;
+    // The handle of the next direct channel that is not registered with the HAL.
+    int32_t mNextEmulatedDirectChannelHandle = 1;
 };
 
 } // namespace android
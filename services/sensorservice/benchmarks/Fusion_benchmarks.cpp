@@ -0,0 +1,97 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <math.h>
+
+#include "Fusion.h"
+
+namespace android {
+
+namespace {
+
+constexpr float GYRO_DT = 1.0f / 200; // 200Hz
+constexpr float ACC_DT = 1.0f / 100;  // 100Hz
+constexpr int GYRO_PER_ACC = 2;
+constexpr int ACC_PER_MAG = 2;        // 50Hz
+
+// Feeds a slowly rotating device into the fusion modes, in the way that SensorFusion does, and
+// returns the attitude so that the work is not optimized away.
+class FusionReplay {
+public:
+    explicit FusionReplay(bool allModes) : mAllModes(allModes) {
+        for (int i = 0; i < NUM_FUSION_MODE; i++) {
+            mFusions[i].init(i);
+        }
+        // run until every mode has its initial estimate
+        for (int i = 0; i < 10; i++) {
+            replayAccPeriod();
+        }
+    }
+
+    vec4_t replayAccPeriod() {
+        const float angle = mTime * 0.5f;
+        const float gyro[] = {0.01f, 0.02f, 0.5f};
+        const float acc[] = {0.981f * sinf(angle), 0.1f, 9.81f};
+        const float mag[] = {30 * cosf(angle), 30 * sinf(angle), -20};
+        const vec3_t w(gyro), a(acc), m(mag);
+        for (int i = 0; i < GYRO_PER_ACC; i++) {
+            forEachMode([&](Fusion& fusion) { fusion.handleGyro(w, GYRO_DT); });
+            mTime += GYRO_DT;
+        }
+        if (mAccCount++ % ACC_PER_MAG == 0) {
+            forEachMode([&](Fusion& fusion) { fusion.handleMag(m); });
+        }
+        forEachMode([&](Fusion& fusion) { fusion.handleAcc(a, ACC_DT); });
+        return mFusions[FUSION_9AXIS].getAttitude();
+    }
+
+private:
+    template <typename F>
+    void forEachMode(F f) {
+        for (int i = 0; i < (mAllModes ? NUM_FUSION_MODE : 1); i++) {
+            f(mFusions[i]);
+        }
+    }
+
+    const bool mAllModes;
+    Fusion mFusions[NUM_FUSION_MODE];
+    float mTime = 0;
+    int mAccCount = 0;
+};
+
+void benchmarkFusion9Axis(benchmark::State& state) {
+    FusionReplay replay(/*allModes=*/false);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(replay.replayAccPeriod());
+    }
+}
+BENCHMARK(benchmarkFusion9Axis);
+
+void benchmarkFusionAllModes(benchmark::State& state) {
+    FusionReplay replay(/*allModes=*/true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(replay.replayAccPeriod());
+    }
+}
+BENCHMARK(benchmarkFusionAllModes);
+
+} // namespace
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,606 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <binder/ProcessState.h>
+#include <cutils/ashmem.h>
+#include <cutils/native_handle.h>
+#include <hardware/sensors.h>
+#include <poll.h>
+#include <sensor/BitTube.h>
+#include <sensor/ISensorEventConnection.h>
+#include <sensor/ISensorServer.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <utils/SystemClock.h>
+
+#include "ISensorHalWrapper.h"
+#include "SensorDevice.h"
+#include "SensorService.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr int32_t FIRST_HANDLE = 1;
+constexpr size_t MAX_SENSORS = 16;
+// Every WAKE_UP_INTERVAL-th sensor is a wake-up sensor.
+constexpr size_t WAKE_UP_INTERVAL = 4;
+constexpr size_t DIRECT_CHANNEL_EVENTS = 256;
+constexpr auto WARM_UP_TIME = 200ms;
+constexpr auto WINDOW = 500ms;
+// The slot of the events that carries their sequence number, past the quantized axes.
+constexpr size_t SEQUENCE_SLOT = 4;
+
+nsecs_t threadCpuTimeNs() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+}
+
+nsecs_t directRatePeriodNs(int32_t rateLevel) {
+    switch (rateLevel) {
+        case SENSOR_DIRECT_RATE_NORMAL:
+            return 20'000'000;
+        case SENSOR_DIRECT_RATE_FAST:
+            return 5'000'000;
+        case SENSOR_DIRECT_RATE_VERY_FAST:
+            return 1'250'000;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * A sensors HAL that generates the events of its sensors at the requested rates, stamped with the
+ * time at which SensorService polls them, and that writes the reports of its direct channels. It
+ * also measures the CPU time that the SensorService thread spends between two polls, which is the
+ * time that it takes to dispatch the events of the previous one.
+ */
+class FakeSensorHal : public ISensorHalWrapper {
+public:
+    FakeSensorHal() {
+        for (size_t i = 0; i < MAX_SENSORS; i++) {
+            const bool wakeUp = (i + 1) % WAKE_UP_INTERVAL == 0;
+            sensor_t sensor = {};
+            sensor.name = wakeUp ? "Fake wake-up accelerometer" : "Fake accelerometer";
+            sensor.vendor = "AOSP";
+            sensor.version = 1;
+            sensor.handle = FIRST_HANDLE + i;
+            sensor.type = SENSOR_TYPE_ACCELEROMETER;
+            sensor.maxRange = 78.4f;
+            sensor.resolution = 0.01f;
+            sensor.power = 0.1f;
+            sensor.minDelay = 1000;
+            sensor.maxDelay = 1'000'000;
+            sensor.flags = SENSOR_FLAG_CONTINUOUS_MODE | SENSOR_FLAG_DIRECT_CHANNEL_ASHMEM |
+                    (SENSOR_DIRECT_RATE_VERY_FAST << SENSOR_FLAG_SHIFT_DIRECT_REPORT) |
+                    (wakeUp ? SENSOR_FLAG_WAKE_UP : 0);
+            mSensors.push_back(sensor);
+            mStates[sensor.handle] = {};
+        }
+    }
+
+    bool connect(SensorDeviceCallback*) override { return true; }
+    void prepareForReconnect() override {}
+    bool supportsPolling() override { return true; }
+    bool supportsMessageQueues() override { return false; }
+
+    ssize_t poll(sensors_event_t* buffer, size_t count) override {
+        const nsecs_t pollCpuTime = threadCpuTimeNs();
+        std::unique_lock lock(mLock);
+        if (mLastPollCpuTime != 0) {
+            mServiceCpuTimeNs += pollCpuTime - mLastPollCpuTime;
+        }
+
+        size_t n = 0;
+        while (n == 0) {
+            nsecs_t due = INT64_MAX;
+            for (const auto& [handle, state] : mStates) {
+                if (state.active) due = std::min(due, state.nextEventTime);
+            }
+            for (const auto& [key, report] : mDirectReports) {
+                due = std::min(due, report.nextEventTime);
+            }
+            const nsecs_t now = elapsedRealtimeNano();
+            if (due > now) {
+                if (due == INT64_MAX) {
+                    mCondition.wait(lock);
+                } else {
+                    mCondition.wait_for(lock, std::chrono::nanoseconds(due - now));
+                }
+                continue;
+            }
+            n = generateEventsLocked(buffer, count, now);
+        }
+
+        mEventsPolled += n;
+        mLastPollCpuTime = threadCpuTimeNs();
+        return n;
+    }
+
+    ssize_t pollFmq(sensors_event_t*, size_t) override { return INVALID_OPERATION; }
+
+    std::vector<sensor_t> getSensorsList() override { return mSensors; }
+
+    status_t setOperationMode(SensorService::Mode) override { return NO_ERROR; }
+
+    status_t activate(int32_t sensorHandle, bool enabled) override {
+        std::scoped_lock lock(mLock);
+        auto it = mStates.find(sensorHandle);
+        if (it == mStates.end()) return BAD_VALUE;
+        it->second.active = enabled;
+        it->second.nextEventTime = elapsedRealtimeNano() + it->second.periodNs;
+        mCondition.notify_all();
+        return NO_ERROR;
+    }
+
+    status_t batch(int32_t sensorHandle, int64_t samplingPeriodNs, int64_t) override {
+        std::scoped_lock lock(mLock);
+        auto it = mStates.find(sensorHandle);
+        if (it == mStates.end()) return BAD_VALUE;
+        it->second.periodNs = std::max<int64_t>(samplingPeriodNs, 1'000'000);
+        return NO_ERROR;
+    }
+
+    status_t flush(int32_t sensorHandle) override {
+        std::scoped_lock lock(mLock);
+        mPendingFlushes.push_back(sensorHandle);
+        mCondition.notify_all();
+        return NO_ERROR;
+    }
+
+    status_t injectSensorData(const sensors_event_t*) override { return INVALID_OPERATION; }
+
+    status_t registerDirectChannel(const sensors_direct_mem_t* memory,
+                                   int32_t* channelHandle) override {
+        if (memory->type != SENSOR_DIRECT_MEM_TYPE_ASHMEM) return BAD_VALUE;
+        void* base = mmap(nullptr, memory->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          memory->handle->data[0], 0);
+        if (base == MAP_FAILED) return NO_MEMORY;
+        std::scoped_lock lock(mLock);
+        *channelHandle = mNextChannelHandle++;
+        mChannels[*channelHandle] = {static_cast<sensors_event_t*>(base),
+                                     memory->size / sizeof(sensors_event_t), memory->size};
+        return NO_ERROR;
+    }
+
+    status_t unregisterDirectChannel(int32_t channelHandle) override {
+        std::scoped_lock lock(mLock);
+        auto it = mChannels.find(channelHandle);
+        if (it == mChannels.end()) {
+            // SensorDevice probes for direct report support with an invalid handle.
+            return BAD_VALUE;
+        }
+        std::erase_if(mDirectReports, [channelHandle](const auto& entry) {
+            return entry.first.first == channelHandle;
+        });
+        munmap(it->second.events, it->second.size);
+        mChannels.erase(it);
+        return NO_ERROR;
+    }
+
+    status_t configureDirectChannel(int32_t sensorHandle, int32_t channelHandle,
+                                    const sensors_direct_cfg_t* config) override {
+        std::scoped_lock lock(mLock);
+        if (mChannels.find(channelHandle) == mChannels.end()) return BAD_VALUE;
+        const nsecs_t periodNs = directRatePeriodNs(config->rate_level);
+        if (periodNs == 0) {
+            std::erase_if(mDirectReports, [=](const auto& entry) {
+                return entry.first.first == channelHandle &&
+                        (sensorHandle == -1 || entry.first.second == sensorHandle);
+            });
+            return NO_ERROR;
+        }
+        if (mStates.find(sensorHandle) == mStates.end()) return BAD_VALUE;
+        mDirectReports[{channelHandle, sensorHandle}] = {periodNs,
+                                                         elapsedRealtimeNano() + periodNs};
+        mCondition.notify_all();
+        // Any positive token works, since the reports of a sensor go to one channel only once.
+        return sensorHandle;
+    }
+
+    void writeWakeLockHandled(uint32_t) override {}
+
+    // Returns the SensorService CPU time and the number of events polled since the last call.
+    std::pair<nsecs_t, size_t> takeServiceCost() {
+        std::scoped_lock lock(mLock);
+        std::pair<nsecs_t, size_t> cost(mServiceCpuTimeNs, mEventsPolled);
+        mServiceCpuTimeNs = 0;
+        mEventsPolled = 0;
+        return cost;
+    }
+
+private:
+    struct SensorState {
+        bool active = false;
+        nsecs_t periodNs = 0;
+        nsecs_t nextEventTime = 0;
+        uint64_t sequence = 0;
+    };
+
+    struct Channel {
+        sensors_event_t* events;
+        size_t capacity;
+        size_t size;
+        uint32_t counter = 0;
+    };
+
+    struct DirectReport {
+        nsecs_t periodNs;
+        nsecs_t nextEventTime;
+        uint64_t sequence = 0;
+    };
+
+    static void initEvent(sensors_event_t* event, int32_t handle, nsecs_t now, uint64_t sequence) {
+        *event = {};
+        event->version = sizeof(sensors_event_t);
+        event->sensor = handle;
+        event->type = SENSOR_TYPE_ACCELEROMETER;
+        event->timestamp = now;
+        event->acceleration.x = 0.1f;
+        event->acceleration.y = 0.2f;
+        event->acceleration.z = 9.8f;
+        event->u64.data[SEQUENCE_SLOT] = sequence;
+    }
+
+    // Does not try to catch up after falling behind, as a sensor would not either.
+    static nsecs_t followingEventTime(nsecs_t eventTime, nsecs_t periodNs, nsecs_t now) {
+        eventTime += periodNs;
+        return eventTime > now ? eventTime : now + periodNs;
+    }
+
+    // Returns the number of events written to buffer.
+    size_t generateEventsLocked(sensors_event_t* buffer, size_t count, nsecs_t now) {
+        size_t n = 0;
+        while (!mPendingFlushes.empty() && n < count) {
+            sensors_event_t& event = buffer[n++];
+            event = {};
+            event.version = META_DATA_VERSION;
+            event.type = SENSOR_TYPE_META_DATA;
+            event.meta_data.what = META_DATA_FLUSH_COMPLETE;
+            event.meta_data.sensor = mPendingFlushes.front();
+            mPendingFlushes.erase(mPendingFlushes.begin());
+        }
+        for (auto& [handle, state] : mStates) {
+            if (!state.active || state.nextEventTime > now || n == count) continue;
+            initEvent(&buffer[n++], handle, now, ++state.sequence);
+            state.nextEventTime = followingEventTime(state.nextEventTime, state.periodNs, now);
+        }
+        for (auto& [key, report] : mDirectReports) {
+            if (report.nextEventTime > now) continue;
+            Channel& channel = mChannels[key.first];
+            sensors_event_t* slot = &channel.events[channel.counter % channel.capacity];
+            initEvent(slot, key.second, now, ++report.sequence);
+            slot->reserved0 = 0;
+            // The counter is written last, so that the reader sees a complete report.
+            __atomic_store_n(&slot->reserved0, ++channel.counter, __ATOMIC_RELEASE);
+            report.nextEventTime = followingEventTime(report.nextEventTime, report.periodNs, now);
+        }
+        return n;
+    }
+
+    std::vector<sensor_t> mSensors;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::map<int32_t, SensorState> mStates;
+    std::vector<int32_t> mPendingFlushes;
+    std::map<int32_t, Channel> mChannels;
+    // Keyed by the channel handle and the sensor handle.
+    std::map<std::pair<int32_t, int32_t>, DirectReport> mDirectReports;
+    int32_t mNextChannelHandle = 1;
+
+    nsecs_t mLastPollCpuTime = 0;
+    nsecs_t mServiceCpuTimeNs = 0;
+    size_t mEventsPolled = 0;
+};
+
+// The delivery statistics of a window, which the readers of all connections add to.
+struct DeliveryStats {
+    std::mutex lock;
+    std::vector<nsecs_t> latencies;
+    uint64_t dropped = 0;
+
+    void add(const std::vector<nsecs_t>& newLatencies, uint64_t newDropped) {
+        std::scoped_lock l(lock);
+        latencies.insert(latencies.end(), newLatencies.begin(), newLatencies.end());
+        dropped += newDropped;
+    }
+};
+
+// Counts a gap in the sequence numbers of a sensor as dropped events.
+uint64_t countDropped(std::map<int32_t, uint64_t>& lastSequences, int32_t sensor,
+                      uint64_t sequence) {
+    uint64_t& last = lastSequences[sensor];
+    const uint64_t dropped = (last != 0 && sequence > last + 1) ? sequence - last - 1 : 0;
+    last = sequence;
+    return dropped;
+}
+
+/**
+ * Reads the events of a regular connection from its socket, and acknowledges the events of the
+ * wake-up sensors like SensorEventQueue does.
+ */
+class EventConnectionReader {
+public:
+    EventConnectionReader(sp<ISensorEventConnection> connection, DeliveryStats& stats)
+          : mConnection(std::move(connection)),
+            mChannel(mConnection->getSensorChannel()),
+            mStats(stats),
+            mThread(&EventConnectionReader::run, this) {}
+
+    ~EventConnectionReader() {
+        mStopping = true;
+        mThread.join();
+    }
+
+    const sp<ISensorEventConnection>& getConnection() const { return mConnection; }
+
+private:
+    void run() {
+        sensors_event_t events[64];
+        std::vector<nsecs_t> latencies;
+        std::map<int32_t, uint64_t> lastSequences;
+        while (!mStopping) {
+            pollfd fd = {.fd = mChannel->getFd(), .events = POLLIN, .revents = 0};
+            if (::poll(&fd, 1, /*timeout=*/50) <= 0) {
+                continue;
+            }
+            const ssize_t count = BitTube::recvObjects(mChannel, events, std::size(events));
+            if (count <= 0) {
+                continue;
+            }
+            const nsecs_t now = elapsedRealtimeNano();
+            uint32_t acks = 0;
+            uint64_t dropped = 0;
+            latencies.clear();
+            for (ssize_t i = 0; i < count; i++) {
+                const sensors_event_t& event = events[i];
+                if (event.flags & WAKE_UP_SENSOR_EVENT_NEEDS_ACK) {
+                    acks++;
+                }
+                if (event.type == SENSOR_TYPE_META_DATA) {
+                    continue;
+                }
+                latencies.push_back(now - event.timestamp);
+                dropped += countDropped(lastSequences, event.sensor,
+                                        event.u64.data[SEQUENCE_SLOT]);
+            }
+            if (acks > 0) {
+                ::send(mChannel->getFd(), &acks, sizeof(acks), MSG_DONTWAIT | MSG_NOSIGNAL);
+            }
+            mStats.add(latencies, dropped);
+        }
+    }
+
+    const sp<ISensorEventConnection> mConnection;
+    const sp<BitTube> mChannel;
+    DeliveryStats& mStats;
+    std::atomic<bool> mStopping = false;
+    std::thread mThread;
+};
+
+/**
+ * Polls the shared memory of a direct connection for new reports, like a direct channel client
+ * does.
+ */
+class DirectConnectionReader {
+public:
+    DirectConnectionReader(const sp<ISensorServer>& server, DeliveryStats& stats)
+          : mSize(DIRECT_CHANNEL_EVENTS * sizeof(sensors_event_t)), mStats(stats) {
+        mFd = ashmem_create_region("sensorservice_benchmarks", mSize);
+        mEvents = static_cast<sensors_event_t*>(
+                mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0));
+        mHandle = native_handle_create(/*numFds=*/1, /*numInts=*/0);
+        mHandle->data[0] = mFd;
+        mConnection = server->createSensorDirectConnection(String16("sensorservice_benchmarks"),
+                                                           RuntimeSensor::DEFAULT_DEVICE_ID, mSize,
+                                                           SENSOR_DIRECT_MEM_TYPE_ASHMEM,
+                                                           SENSOR_DIRECT_FMT_SENSORS_EVENT,
+                                                           mHandle);
+        mThread = std::thread(&DirectConnectionReader::run, this);
+    }
+
+    ~DirectConnectionReader() {
+        mStopping = true;
+        mThread.join();
+        mConnection.clear();
+        munmap(mEvents, mSize);
+        native_handle_close(mHandle);
+        native_handle_delete(mHandle);
+    }
+
+    const sp<ISensorEventConnection>& getConnection() const { return mConnection; }
+
+private:
+    void run() {
+        std::vector<nsecs_t> latencies;
+        std::map<int32_t, uint64_t> lastSequences;
+        uint32_t nextCounter = 1;
+        while (!mStopping) {
+            std::this_thread::sleep_for(100us);
+            latencies.clear();
+            uint64_t dropped = 0;
+            const nsecs_t now = elapsedRealtimeNano();
+            while (true) {
+                const sensors_event_t& slot = mEvents[(nextCounter - 1) % DIRECT_CHANNEL_EVENTS];
+                const uint32_t counter = __atomic_load_n(&slot.reserved0, __ATOMIC_ACQUIRE);
+                if (counter < nextCounter) {
+                    break;
+                }
+                // When the writer laps the reader, the reports that it skips show up as gaps of
+                // their sequence numbers.
+                latencies.push_back(now - slot.timestamp);
+                dropped += countDropped(lastSequences, slot.sensor, slot.u64.data[SEQUENCE_SLOT]);
+                nextCounter = counter + 1;
+            }
+            mStats.add(latencies, dropped);
+        }
+    }
+
+    const size_t mSize;
+    DeliveryStats& mStats;
+    int mFd;
+    sensors_event_t* mEvents;
+    native_handle_t* mHandle;
+    sp<ISensorEventConnection> mConnection;
+    std::atomic<bool> mStopping = false;
+    std::thread mThread;
+};
+
+FakeSensorHal* gFakeHal = nullptr;
+
+const sp<ISensorServer>& sensorService() {
+    static const sp<ISensorServer> service = sp<SensorService>::make();
+    return service;
+}
+
+nsecs_t percentile(std::vector<nsecs_t>& values, double p) {
+    if (values.empty()) return 0;
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(values.size() * p));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+int32_t directRateLevel(int64_t rateHz) {
+    if (rateHz > 200) return SENSOR_DIRECT_RATE_VERY_FAST;
+    if (rateHz > 50) return SENSOR_DIRECT_RATE_FAST;
+    return SENSOR_DIRECT_RATE_NORMAL;
+}
+
+/**
+ * Generates the events of N sensors at a rate, for M regular connections and D direct connections
+ * that all use every sensor. Every WAKE_UP_INTERVAL-th sensor is a wake-up sensor.
+ *
+ * Reports the percentiles of the latency from the HAL to the clients, the CPU time of the
+ * SensorService thread for each event that it polled, and the number of events that the clients
+ * did not receive.
+ */
+void benchmarkSensorServiceFanOut(benchmark::State& state) {
+    const size_t sensorCount = std::min<size_t>(state.range(0), MAX_SENSORS);
+    const size_t connectionCount = state.range(1);
+    const size_t directConnectionCount = state.range(2);
+    const int64_t rateHz = state.range(3);
+    const nsecs_t periodNs = 1'000'000'000LL / rateHz;
+
+    const sp<ISensorServer>& service = sensorService();
+    DeliveryStats stats;
+    std::vector<std::unique_ptr<EventConnectionReader>> readers;
+    for (size_t i = 0; i < connectionCount; i++) {
+        sp<ISensorEventConnection> connection =
+                service->createSensorEventConnection(String8("sensorservice_benchmarks"),
+                                                     SensorService::NORMAL,
+                                                     String16("sensorservice_benchmarks"),
+                                                     String16(""));
+        for (size_t s = 0; s < sensorCount; s++) {
+            connection->enableDisable(FIRST_HANDLE + s, /*enabled=*/true, periodNs,
+                                      /*maxBatchReportLatencyNs=*/0, /*reservedFlags=*/0);
+        }
+        readers.push_back(std::make_unique<EventConnectionReader>(connection, stats));
+    }
+    std::vector<std::unique_ptr<DirectConnectionReader>> directReaders;
+    for (size_t i = 0; i < directConnectionCount; i++) {
+        auto reader = std::make_unique<DirectConnectionReader>(service, stats);
+        if (reader->getConnection() == nullptr) {
+            state.SkipWithError("Could not create a direct connection");
+            return;
+        }
+        for (size_t s = 0; s < sensorCount; s++) {
+            reader->getConnection()->configureChannel(FIRST_HANDLE + s, directRateLevel(rateHz));
+        }
+        directReaders.push_back(std::move(reader));
+    }
+
+    std::this_thread::sleep_for(WARM_UP_TIME);
+    gFakeHal->takeServiceCost();
+    {
+        std::scoped_lock lock(stats.lock);
+        stats.latencies.clear();
+        stats.dropped = 0;
+    }
+
+    for (auto _ : state) {
+        std::this_thread::sleep_for(WINDOW);
+    }
+
+    for (const auto& reader : readers) {
+        for (size_t s = 0; s < sensorCount; s++) {
+            reader->getConnection()->enableDisable(FIRST_HANDLE + s, /*enabled=*/false, 0, 0, 0);
+        }
+    }
+    for (const auto& reader : directReaders) {
+        reader->getConnection()->configureChannel(-1, SENSOR_DIRECT_RATE_STOP);
+    }
+    const auto [serviceCpuTimeNs, eventsPolled] = gFakeHal->takeServiceCost();
+    readers.clear();
+    directReaders.clear();
+
+    std::scoped_lock lock(stats.lock);
+    state.counters["events"] = stats.latencies.size();
+    state.counters["dropped"] = stats.dropped;
+    state.counters["p50_us"] = percentile(stats.latencies, 0.50) / 1000.0;
+    state.counters["p90_us"] = percentile(stats.latencies, 0.90) / 1000.0;
+    state.counters["p99_us"] = percentile(stats.latencies, 0.99) / 1000.0;
+    state.counters["service_ns/event"] =
+            eventsPolled == 0 ? 0.0 : static_cast<double>(serviceCpuTimeNs) / eventsPolled;
+}
+
+BENCHMARK(benchmarkSensorServiceFanOut)
+        ->ArgNames({"sensors", "connections", "direct", "rate_hz"})
+        ->Args({1, 1, 0, 200})
+        ->Args({4, 1, 0, 200})
+        ->Args({4, 8, 0, 200})
+        ->Args({8, 16, 0, 400})
+        ->Args({4, 4, 2, 200})
+        ->Args({8, 8, 4, 400})
+        ->Iterations(4)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+} // namespace
+
+} // namespace android
+
+int main(int argc, char** argv) {
+    // SensorService runs in this process, on the fake HAL, and without being published.
+    android::SensorDevice::setHalWrapperFactory([] {
+        auto hal = std::make_unique<android::FakeSensorHal>();
+        android::gFakeHal = hal.get();
+        return hal;
+    });
+    android::ProcessState::self()->startThreadPool();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
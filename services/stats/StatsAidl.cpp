@@ -91,28 +91,28 @@ bool write_field_annotations(AStatsEvent* event, const std::vector<Annotation>&
     return true;
 }
 
-ndk::ScopedAStatus StatsHal::reportVendorAtom(const VendorAtom& vendorAtom) {
+ndk::ScopedAStatus validate_vendor_atom(const VendorAtom& vendorAtom) {
     if (vendorAtom.atomId < 100000 || vendorAtom.atomId >= 200000) {
         ALOGE("Atom ID %ld is not a valid vendor atom ID", (long)vendorAtom.atomId);
-        Counter::logIncrement(g_AtomErrorMetricName);
         return ndk::ScopedAStatus::fromServiceSpecificErrorWithMessage(
                 -1, "Not a valid vendor atom ID");
     }
     if (vendorAtom.reverseDomainName.length() > 50) {
         ALOGE("Vendor atom reverse domain name %s is too long.",
               vendorAtom.reverseDomainName.c_str());
-        Counter::logIncrement(g_AtomErrorMetricName);
         return ndk::ScopedAStatus::fromServiceSpecificErrorWithMessage(
                 -1, "Vendor atom reverse domain name is too long");
     }
-    AStatsEvent* event = AStatsEvent_obtain();
+    return ndk::ScopedAStatus::ok();
+}
+
+// Writes a validated atom into |event|, which the caller releases.
+ndk::ScopedAStatus write_vendor_atom(AStatsEvent* event, const VendorAtom& vendorAtom) {
     AStatsEvent_setAtomId(event, vendorAtom.atomId);
 
     if (vendorAtom.atomAnnotations) {
         if (!write_atom_annotations(event, *vendorAtom.atomAnnotations)) {
-            AStatsEvent_release(event);
             ALOGE("Atom ID %ld has incompatible atom level annotation", (long)vendorAtom.atomId);
-            Counter::logIncrement(g_AtomErrorMetricName);
             return ndk::ScopedAStatus::fromServiceSpecificErrorWithMessage(
                     -1, "invalid atom annotation");
         }
@@ -231,9 +231,7 @@ ndk::ScopedAStatus StatsHal::reportVendorAtom(const VendorAtom& vendorAtom) {
                 break;
             }
             default: {
-                AStatsEvent_release(event);
                 ALOGE("Atom ID %ld has invalid atomValue.getTag", (long)vendorAtom.atomId);
-                Counter::logIncrement(g_AtomErrorMetricName);
                 return ndk::ScopedAStatus::fromServiceSpecificErrorWithMessage(
                         -1, "invalid atomValue.getTag");
                 break;
@@ -247,10 +245,8 @@ ndk::ScopedAStatus StatsHal::reportVendorAtom(const VendorAtom& vendorAtom) {
             VLOG("Atom ID %ld has %ld annotations for field #%ld", (long)vendorAtom.atomId,
                  (long)fieldAnnotations.size(), (long)atomValueIdx + 2);
             if (!write_field_annotations(event, fieldAnnotations)) {
-                AStatsEvent_release(event);
                 ALOGE("Atom ID %ld has incompatible field level annotation for field #%ld",
                       (long)vendorAtom.atomId, (long)atomValueIdx + 2);
-                Counter::logIncrement(g_AtomErrorMetricName);
                 return ndk::ScopedAStatus::fromServiceSpecificErrorWithMessage(
                         -1, "invalid atom field annotation");
             }
@@ -258,6 +254,22 @@ ndk::ScopedAStatus StatsHal::reportVendorAtom(const VendorAtom& vendorAtom) {
         atomValueIdx++;
     }
     AStatsEvent_build(event);
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus StatsHal::reportVendorAtom(const VendorAtom& vendorAtom) {
+    ndk::ScopedAStatus status = validate_vendor_atom(vendorAtom);
+    if (!status.isOk()) {
+        Counter::logIncrement(g_AtomErrorMetricName);
+        return status;
+    }
+    AStatsEvent* event = AStatsEvent_obtain();
+    status = write_vendor_atom(event, vendorAtom);
+    if (!status.isOk()) {
+        AStatsEvent_release(event);
+        Counter::logIncrement(g_AtomErrorMetricName);
+        return status;
+    }
     const int ret = AStatsEvent_write(event);
     AStatsEvent_release(event);
     if (ret <= 0) {
@@ -269,6 +281,40 @@ ndk::ScopedAStatus StatsHal::reportVendorAtom(const VendorAtom& vendorAtom) {
                     : ndk::ScopedAStatus::ok();
 }
 
+ndk::ScopedAStatus StatsHal::reportVendorAtoms(const std::vector<VendorAtom>& vendorAtoms) {
+    // The whole batch is validated before any of it is written, so that the atoms that pass are
+    // written to the socket back to back. An atom which fails does not stop the others.
+    std::vector<bool> valid(vendorAtoms.size());
+    size_t errors = 0;
+    for (size_t i = 0; i < vendorAtoms.size(); i++) {
+        valid[i] = validate_vendor_atom(vendorAtoms[i]).isOk();
+        if (!valid[i]) errors++;
+    }
+
+    for (size_t i = 0; i < vendorAtoms.size(); i++) {
+        if (!valid[i]) continue;
+        AStatsEvent* event = AStatsEvent_obtain();
+        if (!write_vendor_atom(event, vendorAtoms[i]).isOk()) {
+            AStatsEvent_release(event);
+            errors++;
+            continue;
+        }
+        const int ret = AStatsEvent_write(event);
+        AStatsEvent_release(event);
+        if (ret <= 0) {
+            ALOGE("Error writing Atom ID %ld. Result: %d", (long)vendorAtoms[i].atomId, ret);
+            errors++;
+        }
+    }
+
+    if (errors == 0) {
+        return ndk::ScopedAStatus::ok();
+    }
+    Counter::logIncrement(g_AtomErrorMetricName, errors);
+    return ndk::ScopedAStatus::fromServiceSpecificErrorWithMessage(
+            -1, "some atoms of the batch were not reported");
+}
+
 }  // namespace stats
 }  // namespace frameworks
 }  // namespace android
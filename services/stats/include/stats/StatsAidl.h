@@ -29,6 +29,13 @@ public:
      * Binder call to get vendor atom.
      */
     virtual ndk::ScopedAStatus reportVendorAtom(const VendorAtom& in_vendorAtom) override;
+
+    /**
+     * Reports a batch of vendor atoms, for the batched call of a later version of IStats. Each
+     * atom is validated and written the way reportVendorAtom does, and an error is returned if
+     * any of them was not reported.
+     */
+    ndk::ScopedAStatus reportVendorAtoms(const std::vector<VendorAtom>& in_vendorAtoms);
 };
 
 }  // namespace stats
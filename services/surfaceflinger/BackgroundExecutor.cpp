@@ -19,10 +19,12 @@
 #define LOG_TAG "BackgroundExecutor"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <android-base/stringprintf.h>
 #include <processgroup/sched_policy.h>
 #include <pthread.h>
 #include <sched.h>
 #include <utils/Log.h>
+#include <cinttypes>
 #include <mutex>
 
 #include "BackgroundExecutor.h"
@@ -38,9 +40,18 @@ void set_thread_priority(bool highPriority) {
     sched_setscheduler(gettid(), highPriority ? SCHED_FIFO : SCHED_NORMAL, &param);
 }
 
+void dumpLatency(std::string& result, const char* name, const LatencyHistogram& histogram) {
+    const LatencyHistogram::Summary summary = histogram.summarize();
+    base::StringAppendF(&result,
+                        "    %-6s %10" PRIu64 " %10" PRId64 " %10" PRId64 " %10" PRId64
+                        " %10" PRId64 "\n",
+                        name, summary.count, ns2us(summary.p50), ns2us(summary.p90),
+                        ns2us(summary.p99), ns2us(summary.max));
+}
+
 } // anonymous namespace
 
-BackgroundExecutor::BackgroundExecutor(bool highPriority) {
+BackgroundExecutor::BackgroundExecutor(bool highPriority) : mHighPriority(highPriority) {
     // mSemaphore must be initialized before any calls to
     // BackgroundExecutor::sendCallbacks. For this reason, we initialize it
     // within the constructor instead of within mThread.
@@ -49,12 +60,12 @@ BackgroundExecutor::BackgroundExecutor(bool highPriority) {
         set_thread_priority(highPriority);
         while (!mDone) {
             LOG_ALWAYS_FATAL_IF(sem_wait(&mSemaphore), "sem_wait failed (%d)", errno);
-            auto callbacks = mCallbacksQueue.pop();
-            if (!callbacks) {
-                continue;
-            }
-            for (auto& callback : *callbacks) {
-                callback();
+            if (auto batch = mCallbacksQueue.pop()) {
+                run(std::move(*batch));
+            } else if (auto unorderedBatch = popUnorderedBatch()) {
+                // Nothing ordered to do, help with the unordered work.
+                mStolenBatches++;
+                run(std::move(*unorderedBatch));
             }
         }
     });
@@ -67,6 +78,13 @@ BackgroundExecutor::BackgroundExecutor(bool highPriority) {
 
 BackgroundExecutor::~BackgroundExecutor() {
     mDone = true;
+    {
+        std::scoped_lock lock(mUnorderedMutex);
+        mUnorderedCondition.notify_all();
+    }
+    if (mHelperThread.joinable()) {
+        mHelperThread.join();
+    }
     LOG_ALWAYS_FATAL_IF(sem_post(&mSemaphore), "sem_post failed");
     if (mThread.joinable()) {
         mThread.join();
@@ -74,11 +92,76 @@ BackgroundExecutor::~BackgroundExecutor() {
     }
 }
 
+void BackgroundExecutor::run(Batch&& batch) {
+    mQueueDepth--;
+    const nsecs_t startTime = systemTime();
+    mQueueLatency.record(startTime - batch.queueTime);
+    for (auto& callback : batch.callbacks) {
+        callback();
+    }
+    mRunLatency.record(systemTime() - startTime);
+}
+
+std::optional<BackgroundExecutor::Batch> BackgroundExecutor::popUnorderedBatch() {
+    std::scoped_lock lock(mUnorderedMutex);
+    if (mUnorderedQueue.empty()) {
+        return std::nullopt;
+    }
+    Batch batch = std::move(mUnorderedQueue.front());
+    mUnorderedQueue.pop_front();
+    return batch;
+}
+
+void BackgroundExecutor::startHelperThread() {
+    mHelperThread = std::thread([&]() {
+        set_thread_priority(mHighPriority);
+        while (true) {
+            Batch batch;
+            {
+                std::unique_lock lock(mUnorderedMutex);
+                mUnorderedCondition.wait(lock,
+                                         [&] { return mDone || !mUnorderedQueue.empty(); });
+                if (mDone) {
+                    return;
+                }
+                batch = std::move(mUnorderedQueue.front());
+                mUnorderedQueue.pop_front();
+            }
+            run(std::move(batch));
+        }
+    });
+    if (mHighPriority) {
+        pthread_setname_np(mHelperThread.native_handle(), "BckgrndHelp HP");
+    } else {
+        pthread_setname_np(mHelperThread.native_handle(), "BckgrndHelp LP");
+    }
+}
+
+void BackgroundExecutor::countQueuedBatch() {
+    const size_t depth = ++mQueueDepth;
+    size_t maxDepth = mMaxQueueDepth.load();
+    while (depth > maxDepth && !mMaxQueueDepth.compare_exchange_weak(maxDepth, depth)) {
+    }
+}
+
 void BackgroundExecutor::sendCallbacks(Callbacks&& tasks) {
-    mCallbacksQueue.push(std::move(tasks));
+    countQueuedBatch();
+    mCallbacksQueue.push({std::move(tasks), systemTime()});
     LOG_ALWAYS_FATAL_IF(sem_post(&mSemaphore), "sem_post failed");
 }
 
+void BackgroundExecutor::sendUnorderedCallbacks(Callbacks&& tasks) {
+    std::call_once(mHelperThreadFlag, [this] { startHelperThread(); });
+
+    countQueuedBatch();
+    {
+        std::scoped_lock lock(mUnorderedMutex);
+        mUnorderedQueue.push_back({std::move(tasks), systemTime()});
+    }
+    mUnorderedCondition.notify_one();
+    // Wakes up the executor thread too, in case it is idle and can take the batch first.
+    LOG_ALWAYS_FATAL_IF(sem_post(&mSemaphore), "sem_post failed");
+}
 void BackgroundExecutor::flushQueue() {
     std::mutex mutex;
     std::condition_variable cv;
@@ -92,4 +175,22 @@ void BackgroundExecutor::flushQueue() {
     cv.wait(lock, [&]() { return flushComplete; });
 }
 
+void BackgroundExecutor::dump(std::string& result) const {
+    base::StringAppendF(&result,
+                        "  %s priority: queue depth %zu (max %zu), %" PRIu64
+                        " unordered batches run on the executor thread\n",
+                        mHighPriority ? "High" : "Low", mQueueDepth.load(), mMaxQueueDepth.load(),
+                        mStolenBatches.load());
+    base::StringAppendF(&result, "    %-6s %10s %10s %10s %10s %10s\n", "us", "count", "p50",
+                        "p90", "p99", "max");
+    dumpLatency(result, "queued", mQueueLatency);
+    dumpLatency(result, "run", mRunLatency);
+}
+
+void BackgroundExecutor::dumpAll(std::string& result) {
+    result.append("BackgroundExecutor:\n");
+    getInstance().dump(result);
+    getLowPriorityInstance().dump(result);
+}
+
 } // namespace android
@@ -18,13 +18,26 @@
 
 #include <ftl/small_vector.h>
 #include <semaphore.h>
+#include <utils/Timers.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <thread>
 
 #include "LocklessQueue.h"
+#include "TimeStats/LatencyHistogram.h"
 
 namespace android {
 
 // Executes tasks off the main thread.
+//
+// Callbacks sent with sendCallbacks run in order on the executor thread. Callbacks that don't
+// depend on each other or on the ordered ones can be sent with sendUnorderedCallbacks instead.
+// Those run on a helper thread, or on the executor thread whenever it has no ordered work, so a
+// slow ordered callback does not hold them up.
 class BackgroundExecutor {
 public:
     ~BackgroundExecutor();
@@ -43,16 +56,49 @@ public:
     // Queues callbacks onto a work queue to be executed by a background thread.
     // This is safe to call from multiple threads.
     void sendCallbacks(Callbacks&& tasks);
+    // Queues callbacks that may run concurrently with, and out of order relative to, any other
+    // callbacks. This is safe to call from multiple threads.
+    void sendUnorderedCallbacks(Callbacks&& tasks);
+    // Waits until the callbacks sent with sendCallbacks before this call have run.
     void flushQueue();
 
+    // Dumps the queue depth, and how long callbacks waited in the queue and took to run.
+    void dump(std::string& result) const;
+    static void dumpAll(std::string& result);
+
 private:
+    struct Batch {
+        Callbacks callbacks;
+        nsecs_t queueTime = 0;
+    };
+
     BackgroundExecutor(bool highPriority);
 
+    void run(Batch&& batch);
+    std::optional<Batch> popUnorderedBatch();
+    void startHelperThread();
+    void countQueuedBatch();
+
+    const bool mHighPriority;
     sem_t mSemaphore;
     std::atomic_bool mDone = false;
 
-    LocklessQueue<Callbacks> mCallbacksQueue;
+    LocklessQueue<Batch> mCallbacksQueue;
     std::thread mThread;
+
+    // The unordered queue has more than one consumer, so it can't use a LocklessQueue.
+    std::mutex mUnorderedMutex;
+    std::condition_variable mUnorderedCondition;
+    std::deque<Batch> mUnorderedQueue;
+    // The helper thread is only started once unordered callbacks are sent.
+    std::once_flag mHelperThreadFlag;
+    std::thread mHelperThread;
+
+    std::atomic<size_t> mQueueDepth = 0;
+    std::atomic<size_t> mMaxQueueDepth = 0;
+    std::atomic<uint64_t> mStolenBatches = 0;
+    LatencyHistogram mQueueLatency;
+    LatencyHistogram mRunLatency;
 };
 
 } // namespace android
@@ -0,0 +1,259 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#undef LOG_TAG
+#define LOG_TAG "ChangedAreaEstimator"
+
+#include "ChangedAreaEstimator.h"
+
+#include <common/trace.h>
+#include <log/log.h>
+#include <renderengine/DisplaySettings.h>
+#include <renderengine/LayerSettings.h>
+#include <renderengine/RenderEngine.h>
+#include <renderengine/impl/ExternalTexture.h>
+#include <ui/GraphicBuffer.h>
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "RegionSamplingThread.h"
+
+namespace android {
+
+Rect changedSampleBounds(const uint32_t* previous, const uint32_t* current, int32_t width,
+                         int32_t height) {
+    Rect bounds = Rect::EMPTY_RECT;
+    for (int32_t y = 0; y < height; y++) {
+        const uint32_t* previousRow = previous + static_cast<size_t>(y) * width;
+        const uint32_t* currentRow = current + static_cast<size_t>(y) * width;
+        if (std::memcmp(previousRow, currentRow, width * sizeof(uint32_t)) == 0) {
+            continue;
+        }
+
+        int32_t left = 0;
+        while (previousRow[left] == currentRow[left]) {
+            left++;
+        }
+        int32_t right = width;
+        while (previousRow[right - 1] == currentRow[right - 1]) {
+            right--;
+        }
+
+        if (bounds.isEmpty()) {
+            bounds = Rect(left, y, right, y + 1);
+        } else {
+            bounds.left = std::min(bounds.left, left);
+            bounds.right = std::max(bounds.right, right);
+            bounds.bottom = y + 1;
+        }
+    }
+    return bounds;
+}
+
+Rect scaleChangedBounds(const Rect& bounds, ui::Size sampleSize, ui::Size bufferSize) {
+    if (bounds.isEmpty() || sampleSize == bufferSize) {
+        return bounds;
+    }
+    if (sampleSize.width <= 0 || sampleSize.height <= 0) {
+        return Rect::INVALID_RECT;
+    }
+
+    // A sample pixel is filtered from the buffer pixels around it, so the edges round outwards.
+    const auto floorScale = [](int32_t value, int64_t to, int64_t from) {
+        return static_cast<int32_t>(int64_t{value} * to / from);
+    };
+    const auto ceilScale = [](int32_t value, int64_t to, int64_t from) {
+        return static_cast<int32_t>((int64_t{value} * to + from - 1) / from);
+    };
+    Rect scaled(floorScale(bounds.left, bufferSize.width, sampleSize.width),
+                floorScale(bounds.top, bufferSize.height, sampleSize.height),
+                ceilScale(bounds.right, bufferSize.width, sampleSize.width),
+                ceilScale(bounds.bottom, bufferSize.height, sampleSize.height));
+    Rect clipped;
+    scaled.intersect(Rect(bufferSize.width, bufferSize.height), &clipped);
+    return clipped;
+}
+
+ChangedAreaEstimator::ChangedAreaEstimator(renderengine::RenderEngine& renderEngine,
+                                           int32_t maxSampleSide)
+      : mRenderEngine(renderEngine),
+        mMaxSampleSide(maxSampleSide),
+        mThread(&ChangedAreaEstimator::threadMain, this) {
+    pthread_setname_np(mThread.native_handle(), "ChangedAreaEst");
+}
+
+ChangedAreaEstimator::~ChangedAreaEstimator() {
+    {
+        std::lock_guard lock(mMutex);
+        mRunning = false;
+    }
+    mCondition.notify_one();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void ChangedAreaEstimator::queueBuffer(int32_t layerId,
+                                       std::shared_ptr<renderengine::ExternalTexture> buffer,
+                                       sp<Fence> acquireFence) {
+    // The content of protected buffers can't be read back.
+    if (!buffer || (buffer->getUsage() & GRALLOC_USAGE_PROTECTED)) {
+        return;
+    }
+    {
+        std::lock_guard lock(mMutex);
+        mLayers.insert(layerId);
+        // Only the latest buffer of a layer is sampled.
+        mRequests[layerId] = Request{std::move(buffer), std::move(acquireFence)};
+    }
+    mCondition.notify_one();
+}
+
+std::optional<Rect> ChangedAreaEstimator::getChangedBounds(int32_t layerId) const {
+    std::lock_guard lock(mMutex);
+    const auto it = mSamples.find(layerId);
+    if (it == mSamples.end()) {
+        return std::nullopt;
+    }
+    return it->second.changedBounds;
+}
+
+void ChangedAreaEstimator::removeLayer(int32_t layerId) {
+    std::lock_guard lock(mMutex);
+    mLayers.erase(layerId);
+    mRequests.erase(layerId);
+    mSamples.erase(layerId);
+}
+
+// NO_THREAD_SAFETY_ANALYSIS is because std::unique_lock presently lacks thread safety annotations.
+void ChangedAreaEstimator::threadMain() NO_THREAD_SAFETY_ANALYSIS {
+    std::unique_lock lock(mMutex);
+    while (true) {
+        mCondition.wait(lock,
+                        [this]() REQUIRES(mMutex) { return !mRunning || !mRequests.empty(); });
+        if (!mRunning) {
+            break;
+        }
+
+        std::unordered_map<int32_t, Request> requests = std::move(mRequests);
+        mRequests.clear();
+        for (auto& [layerId, request] : requests) {
+            const ui::Size bufferSize(static_cast<int32_t>(request.buffer->getWidth()),
+                                      static_cast<int32_t>(request.buffer->getHeight()));
+            const ui::Size sampleSize = getSampleBufferSize(bufferSize, mMaxSampleSide);
+
+            lock.unlock();
+            std::vector<uint32_t> pixels;
+            const bool sampled = sample(request, sampleSize, &pixels);
+            // The layer's buffer is not held past its sample.
+            request.buffer.reset();
+            lock.lock();
+
+            // The layer may have been removed while it was sampled.
+            if (!sampled || mLayers.count(layerId) == 0) {
+                continue;
+            }
+            LayerSample& layerSample = mSamples[layerId];
+            if (layerSample.bufferSize == bufferSize && layerSample.sampleSize == sampleSize) {
+                const Rect bounds = changedSampleBounds(layerSample.pixels.data(), pixels.data(),
+                                                        sampleSize.width, sampleSize.height);
+                layerSample.changedBounds = scaleChangedBounds(bounds, sampleSize, bufferSize);
+            } else {
+                // There is nothing to compare with until the next buffer of the same size.
+                layerSample.changedBounds = std::nullopt;
+            }
+            layerSample.bufferSize = bufferSize;
+            layerSample.sampleSize = sampleSize;
+            layerSample.pixels = std::move(pixels);
+        }
+    }
+}
+
+bool ChangedAreaEstimator::sample(const Request& request, ui::Size sampleSize,
+                                  std::vector<uint32_t>* pixels) {
+    SFTRACE_CALL();
+    if (!mSampleBuffer || mSampleBuffer->getWidth() != static_cast<uint32_t>(sampleSize.width) ||
+        mSampleBuffer->getHeight() != static_cast<uint32_t>(sampleSize.height)) {
+        const uint32_t usage =
+                GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE;
+        sp<GraphicBuffer> graphicBuffer =
+                sp<GraphicBuffer>::make(sampleSize.width, sampleSize.height,
+                                        PIXEL_FORMAT_RGBA_8888, 1, usage, "ChangedAreaEstimator");
+        const status_t bufferStatus = graphicBuffer->initCheck();
+        if (bufferStatus != OK) {
+            ALOGE("Failed to allocate a sample buffer: %d", bufferStatus);
+            return false;
+        }
+        mSampleBuffer = std::make_shared<
+                renderengine::impl::ExternalTexture>(graphicBuffer, mRenderEngine,
+                                                     renderengine::impl::ExternalTexture::Usage::
+                                                             WRITEABLE);
+    }
+
+    const Rect sampleBounds(sampleSize.width, sampleSize.height);
+    renderengine::DisplaySettings display;
+    display.physicalDisplay = sampleBounds;
+    display.clip = sampleBounds;
+    display.outputDataspace = ui::Dataspace::V0_SRGB;
+    // Queued behind composition, like screenshots and region sampling.
+    display.priority = renderengine::DisplaySettings::Priority::Capture;
+
+    const float bufferWidth = static_cast<float>(request.buffer->getWidth());
+    const float bufferHeight = static_cast<float>(request.buffer->getHeight());
+    renderengine::LayerSettings layer;
+    layer.geometry.boundaries = FloatRect(0.0f, 0.0f, bufferWidth, bufferHeight);
+    layer.geometry.positionTransform =
+            mat4::scale(vec4(static_cast<float>(sampleSize.width) / bufferWidth,
+                             static_cast<float>(sampleSize.height) / bufferHeight, 1.0f, 1.0f));
+    layer.source.buffer.buffer = request.buffer;
+    layer.source.buffer.fence = request.acquireFence;
+    layer.source.buffer.useTextureFiltering = true;
+    // Only the colors are compared, the same way for every buffer of the layer.
+    layer.source.buffer.isOpaque = true;
+    layer.sourceDataspace = ui::Dataspace::V0_SRGB;
+    layer.alpha = 1.0f;
+
+    FenceResult result =
+            mRenderEngine.drawLayers(display, {layer}, mSampleBuffer, base::unique_fd()).get();
+    if (!result.ok()) {
+        ALOGW("Failed to sample a buffer: %d", result.error());
+        return false;
+    }
+    result.value()->waitForever(LOG_TAG);
+
+    const sp<GraphicBuffer>& graphicBuffer = mSampleBuffer->getBuffer();
+    void* data = nullptr;
+    if (graphicBuffer->lock(GRALLOC_USAGE_SW_READ_OFTEN, &data) != OK || data == nullptr) {
+        ALOGW("Failed to read a sample");
+        return false;
+    }
+    pixels->resize(static_cast<size_t>(sampleSize.width) * sampleSize.height);
+    for (int32_t y = 0; y < sampleSize.height; y++) {
+        std::memcpy(pixels->data() + static_cast<size_t>(y) * sampleSize.width,
+                    static_cast<const uint32_t*>(data) +
+                            static_cast<size_t>(y) * graphicBuffer->getStride(),
+                    sampleSize.width * sizeof(uint32_t));
+    }
+    graphicBuffer->unlock();
+    return true;
+}
+
+} // namespace android
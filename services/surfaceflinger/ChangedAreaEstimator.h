@@ -0,0 +1,108 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <renderengine/ExternalTexture.h>
+#include <ui/Fence.h>
+#include <ui/Rect.h>
+#include <ui/Size.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace android {
+
+namespace renderengine {
+class RenderEngine;
+} // namespace renderengine
+
+// Returns the bounds of the pixels that differ between two samples of width by height pixels, or
+// an empty Rect if none do.
+Rect changedSampleBounds(const uint32_t* previous, const uint32_t* current, int32_t width,
+                         int32_t height);
+
+// Maps bounds in a sample of sampleSize to a buffer of bufferSize that the sample was scaled down
+// from. The result covers every pixel of the buffer that contributes to the bounds.
+Rect scaleChangedBounds(const Rect& bounds, ui::Size sampleSize, ui::Size bufferSize);
+
+// Estimates which part of a layer's buffer changed since its previous buffer, for the small area
+// detection of layers whose clients report the whole surface as damaged.
+//
+// Like region sampling, each buffer is scaled down by RenderEngine, with the priority of
+// screenshots, into a small buffer that is read back. Consecutive samples of a layer are compared
+// on the CPU. The estimate runs on its own thread, so it describes an earlier buffer than the one
+// that was just latched, and a layer only has one pending buffer: if buffers arrive faster than
+// they are sampled, the estimate covers the changes of several frames.
+class ChangedAreaEstimator {
+public:
+    // Samples are scaled down so that neither side is longer than maxSampleSide.
+    ChangedAreaEstimator(renderengine::RenderEngine& renderEngine, int32_t maxSampleSide);
+    ~ChangedAreaEstimator();
+
+    // Queues the buffer of a layer to be compared with the previous buffer queued for it.
+    void queueBuffer(int32_t layerId, std::shared_ptr<renderengine::ExternalTexture> buffer,
+                     sp<Fence> acquireFence);
+
+    // Returns the bounds, in buffer space, of the area that changed between the last two buffers
+    // of the layer that were compared, or std::nullopt if none were.
+    std::optional<Rect> getChangedBounds(int32_t layerId) const;
+
+    void removeLayer(int32_t layerId);
+
+private:
+    struct Request {
+        std::shared_ptr<renderengine::ExternalTexture> buffer;
+        sp<Fence> acquireFence;
+    };
+
+    struct LayerSample {
+        ui::Size bufferSize;
+        ui::Size sampleSize;
+        std::vector<uint32_t> pixels;
+        std::optional<Rect> changedBounds;
+    };
+
+    void threadMain();
+    // Renders the buffer scaled down into pixels, and returns false if it could not.
+    bool sample(const Request& request, ui::Size sampleSize, std::vector<uint32_t>* pixels);
+
+    renderengine::RenderEngine& mRenderEngine;
+    const int32_t mMaxSampleSide;
+
+    // The buffer that the samples are rendered into, which is only used by the thread.
+    std::shared_ptr<renderengine::ExternalTexture> mSampleBuffer;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mRunning GUARDED_BY(mMutex) = true;
+    // The layers that have queued buffers and have not been removed since.
+    std::unordered_set<int32_t> mLayers GUARDED_BY(mMutex);
+    std::unordered_map<int32_t, Request> mRequests GUARDED_BY(mMutex);
+    std::unordered_map<int32_t, LayerSample> mSamples GUARDED_BY(mMutex);
+
+    std::thread mThread;
+};
+
+} // namespace android
@@ -23,7 +23,9 @@
 
 #include <android-base/stringprintf.h>
 #include <common/trace.h>
+#include <gui/ITransactionCompletedListener.h>
 #include <renderengine/impl/ExternalTexture.h>
+#include <ui/PixelFormat.h>
 
 #include "ClientCache.h"
 
@@ -33,6 +35,17 @@ ANDROID_SINGLETON_STATIC_INSTANCE(ClientCache);
 
 ClientCache::ClientCache() : mDeathRecipient(sp<CacheDeathRecipient>::make()) {}
 
+size_t ClientCache::bufferSizeInBytes(const GraphicBuffer& buffer) {
+    // Formats without a fixed number of bytes per pixel, like YUV formats, are estimated as if they
+    // were RGBA_8888.
+    size_t bytesPerPixel = android::bytesPerPixel(buffer.getPixelFormat());
+    if (bytesPerPixel == 0) {
+        bytesPerPixel = 4;
+    }
+    return static_cast<size_t>(buffer.getStride()) * buffer.getHeight() * buffer.getLayerCount() *
+            bytesPerPixel;
+}
+
 bool ClientCache::getBuffer(const client_cache_t& cacheId,
                             ClientCacheBuffer** outClientCacheBuffer) {
     auto& [processToken, id] = cacheId;
@@ -46,7 +59,7 @@ bool ClientCache::getBuffer(const client_cache_t& cacheId,
         return false;
     }
 
-    auto& processBuffers = it->second.second;
+    auto& processBuffers = it->second.buffers;
 
     auto bufItr = processBuffers.find(id);
     if (bufItr == processBuffers.end()) {
@@ -60,7 +73,8 @@ bool ClientCache::getBuffer(const client_cache_t& cacheId,
 }
 
 base::expected<std::shared_ptr<renderengine::ExternalTexture>, ClientCache::AddError>
-ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer) {
+ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer, int pid,
+                 int uid) {
     auto& [processToken, id] = cacheId;
     if (processToken == nullptr) {
         ALOGE_AND_TRACE("ClientCache::add - invalid (nullptr) process token");
@@ -72,7 +86,7 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
         return base::unexpected(AddError::Unspecified);
     }
 
-    std::lock_guard lock(mMutex);
+    std::unique_lock lock(mMutex);
     sp<IBinder> token;
 
     // If this is a new process token, set a death recipient. If the client process dies, we will
@@ -93,17 +107,18 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
                 return base::unexpected(AddError::Unspecified);
             }
         }
-        auto [itr, success] =
-                mBuffers.emplace(processToken,
-                                 std::make_pair(token,
-                                                std::unordered_map<uint64_t, ClientCacheBuffer>()));
+        ProcessCache processCache;
+        processCache.token = token;
+        processCache.pid = pid;
+        processCache.uid = uid;
+        auto [itr, success] = mBuffers.emplace(processToken, std::move(processCache));
         LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
         it = itr;
     }
 
-    auto& processBuffers = it->second.second;
+    auto& processCache = it->second;
 
-    if (processBuffers.size() > BUFFER_CACHE_MAX_SIZE) {
+    if (processCache.buffers.size() > BUFFER_CACHE_MAX_SIZE) {
         ALOGE_AND_TRACE("ClientCache::add - cache is full");
         return base::unexpected(AddError::CacheFull);
     }
@@ -112,10 +127,178 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
                         "Attempted to build the ClientCache before a RenderEngine instance was "
                         "ready!");
 
-    return (processBuffers[id].buffer = std::make_shared<
-                    renderengine::impl::ExternalTexture>(buffer, *mRenderEngine,
-                                                         renderengine::impl::ExternalTexture::
-                                                                 Usage::READABLE));
+    // Replacing a cached buffer releases its memory first.
+    auto& clientCacheBuffer = processCache.buffers[id];
+    processCache.sizeInBytes -= clientCacheBuffer.sizeInBytes;
+    mSizeInBytes -= clientCacheBuffer.sizeInBytes;
+    clientCacheBuffer.sizeInBytes = 0;
+    clientCacheBuffer.lastUsed = ++mUseCounter;
+
+    const size_t sizeInBytes = bufferSizeInBytes(*buffer);
+    std::vector<Eviction> evictions;
+    // The process is held to its own budget first, so that it does not evict the buffers of
+    // other processes to stay within the total budget.
+    evictClientLocked(sizeInBytes, processToken, processCache, id, evictions);
+    evictLocked(sizeInBytes, cacheId, evictions);
+
+    clientCacheBuffer.buffer = std::make_shared<
+            renderengine::impl::ExternalTexture>(buffer, *mRenderEngine,
+                                                 renderengine::impl::ExternalTexture::Usage::
+                                                         READABLE);
+    clientCacheBuffer.sizeInBytes = sizeInBytes;
+    processCache.sizeInBytes += sizeInBytes;
+    mSizeInBytes += sizeInBytes;
+    auto externalTexture = clientCacheBuffer.buffer;
+    if (mClientMemoryBudget != 0 && processCache.sizeInBytes > mClientMemoryBudget) {
+        ALOGW("ClientCache - process %d (uid %d) caches %zu KB, over its budget of %zu KB",
+              processCache.pid, processCache.uid, processCache.sizeInBytes / 1024,
+              mClientMemoryBudget / 1024);
+    }
+
+    // Erased recipients may call back into the cache, and notifying the clients is a binder call,
+    // so neither can happen with the lock held.
+    lock.unlock();
+    notifyEvictions(evictions);
+    return externalTexture;
+}
+
+void ClientCache::evictLocked(size_t bytes, const client_cache_t& addedCacheId,
+                              std::vector<Eviction>& outEvictions) {
+    if (mMemoryBudget == 0) {
+        return;
+    }
+
+    while (mSizeInBytes + bytes > mMemoryBudget) {
+        // The cache holds a few thousand buffers at most, so a linear scan for the least recently
+        // used one is cheaper than maintaining an ordered index on every get.
+        ProcessCache* lruProcess = nullptr;
+        wp<IBinder> lruProcessToken;
+        std::unordered_map<uint64_t, ClientCacheBuffer>::iterator lruItr;
+        for (auto& [processToken, processCache] : mBuffers) {
+            for (auto itr = processCache.buffers.begin(); itr != processCache.buffers.end();
+                 itr++) {
+                if (processToken == addedCacheId.token && itr->first == addedCacheId.id) {
+                    continue;
+                }
+                if (!lruProcess || itr->second.lastUsed < lruItr->second.lastUsed) {
+                    lruProcess = &processCache;
+                    lruProcessToken = processToken;
+                    lruItr = itr;
+                }
+            }
+        }
+
+        // The budget is soft: a single buffer larger than the budget is still cached.
+        if (!lruProcess) {
+            return;
+        }
+        evictBufferLocked(lruProcessToken, *lruProcess, lruItr, outEvictions);
+    }
+}
+
+void ClientCache::evictClientLocked(size_t bytes, const wp<IBinder>& processToken,
+                                    ProcessCache& processCache, std::optional<uint64_t> addedId,
+                                    std::vector<Eviction>& outEvictions) {
+    if (mClientMemoryBudget == 0) {
+        return;
+    }
+
+    while (processCache.sizeInBytes + bytes > mClientMemoryBudget) {
+        auto lruItr = processCache.buffers.end();
+        for (auto itr = processCache.buffers.begin(); itr != processCache.buffers.end(); itr++) {
+            if (itr->first == addedId) {
+                continue;
+            }
+            if (lruItr == processCache.buffers.end() ||
+                itr->second.lastUsed < lruItr->second.lastUsed) {
+                lruItr = itr;
+            }
+        }
+        if (lruItr == processCache.buffers.end()) {
+            return;
+        }
+        evictBufferLocked(processToken, processCache, lruItr, outEvictions);
+    }
+}
+
+void ClientCache::evictBufferLocked(const wp<IBinder>& processToken, ProcessCache& processCache,
+                                    std::unordered_map<uint64_t, ClientCacheBuffer>::iterator itr,
+                                    std::vector<Eviction>& outEvictions) {
+    Eviction eviction{.token = processCache.token, .cacheId = {processToken, itr->first}};
+    for (auto& recipient : itr->second.recipients) {
+        sp<ErasedRecipient> erasedRecipient = recipient.promote();
+        if (erasedRecipient) {
+            eviction.recipients.push_back(erasedRecipient);
+        }
+    }
+    ATRACE_FORMAT_INSTANT("ClientCache evict %" PRIu64, itr->first);
+
+    processCache.sizeInBytes -= itr->second.sizeInBytes;
+    mSizeInBytes -= itr->second.sizeInBytes;
+    processCache.evictions++;
+    mEvictedBufferIds.push_back(itr->second.buffer->getBuffer()->getId());
+    processCache.buffers.erase(itr);
+    outEvictions.push_back(std::move(eviction));
+}
+
+void ClientCache::notifyEvictions(const std::vector<Eviction>& evictions) {
+    for (const auto& eviction : evictions) {
+        for (auto& recipient : eviction.recipients) {
+            recipient->bufferErased(eviction.cacheId);
+        }
+        // The cache is keyed by the client's transaction completed listener, which forgets the
+        // buffer so that it sends the buffer again the next time it is used.
+        if (eviction.token->localBinder() == nullptr) {
+            interface_cast<ITransactionCompletedListener>(eviction.token)
+                    ->onBufferUncached(eviction.cacheId.id);
+        }
+    }
+}
+
+void ClientCache::setMemoryBudget(size_t bytes) {
+    std::vector<Eviction> evictions;
+    {
+        std::lock_guard lock(mMutex);
+        mMemoryBudget = bytes;
+        evictLocked(0, {}, evictions);
+    }
+    notifyEvictions(evictions);
+}
+
+void ClientCache::setClientMemoryBudget(size_t bytes) {
+    std::vector<Eviction> evictions;
+    {
+        std::lock_guard lock(mMutex);
+        mClientMemoryBudget = bytes;
+        for (auto& [processToken, processCache] : mBuffers) {
+            evictClientLocked(0, processToken, processCache, std::nullopt, evictions);
+        }
+    }
+    notifyEvictions(evictions);
+}
+
+size_t ClientCache::getClientMemoryBudget() {
+    std::lock_guard lock(mMutex);
+    return mClientMemoryBudget;
+}
+
+std::vector<ClientCache::CachedBuffer> ClientCache::getCachedBuffers() {
+    std::lock_guard lock(mMutex);
+    std::vector<CachedBuffer> cachedBuffers;
+    for (const auto& [_, processCache] : mBuffers) {
+        for (const auto& [id, buffer] : processCache.buffers) {
+            cachedBuffers.push_back({.uid = processCache.uid,
+                                     .pid = processCache.pid,
+                                     .bufferId = buffer.buffer->getBuffer()->getId(),
+                                     .sizeInBytes = buffer.sizeInBytes});
+        }
+    }
+    return cachedBuffers;
+}
+
+std::vector<uint64_t> ClientCache::takeEvictedBufferIds() {
+    std::lock_guard lock(mMutex);
+    return std::exchange(mEvictedBufferIds, {});
 }
 
 sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
@@ -139,7 +322,10 @@ sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
             }
         }
 
-        mBuffers[processToken].second.erase(id);
+        auto& processCache = mBuffers[processToken];
+        processCache.sizeInBytes -= buf->sizeInBytes;
+        mSizeInBytes -= buf->sizeInBytes;
+        processCache.buffers.erase(id);
     }
 
     for (auto& recipient : pendingErase) {
@@ -154,9 +340,14 @@ std::shared_ptr<renderengine::ExternalTexture> ClientCache::get(const client_cac
     ClientCacheBuffer* buf = nullptr;
     if (!getBuffer(cacheId, &buf)) {
         ALOGE("failed to get buffer, could not retrieve buffer");
+        if (auto it = mBuffers.find(cacheId.token); it != mBuffers.end()) {
+            it->second.misses++;
+        }
         return nullptr;
     }
 
+    mBuffers[cacheId.token].hits++;
+    buf->lastUsed = ++mUseCounter;
     return buf->buffer;
 }
 
@@ -188,6 +379,7 @@ void ClientCache::unregisterErasedRecipient(const client_cache_t& cacheId,
 
 void ClientCache::removeProcess(const wp<IBinder>& processToken) {
     std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>> pendingErase;
+    ProcessCache removedProcessCache;
     {
         if (processToken == nullptr) {
             ALOGE("failed to remove process, invalid (nullptr) process token");
@@ -200,7 +392,7 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
             return;
         }
 
-        for (auto& [id, clientCacheBuffer] : itr->second.second) {
+        for (auto& [id, clientCacheBuffer] : itr->second.buffers) {
             client_cache_t cacheId = {processToken, id};
             for (auto& recipient : clientCacheBuffer.recipients) {
                 sp<ErasedRecipient> erasedRecipient = recipient.promote();
@@ -209,9 +401,18 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
                 }
             }
         }
+        mSizeInBytes -= itr->second.sizeInBytes;
+        removedProcessCache = std::move(itr->second);
         mBuffers.erase(itr);
     }
 
+    // A process that exits may have cached dozens of buffers, so RenderEngine unmaps them all at
+    // once rather than one at a time. The other holders of a texture unmap it when they drop it.
+    if (!removedProcessCache.buffers.empty()) {
+        renderengine::impl::ExternalTexture::Batch batch(*mRenderEngine);
+        removedProcessCache.buffers.clear();
+    }
+
     for (auto& [recipient, cacheId] : pendingErase) {
         recipient->bufferErased(cacheId);
     }
@@ -223,10 +424,26 @@ void ClientCache::CacheDeathRecipient::binderDied(const wp<IBinder>& who) {
 
 void ClientCache::dump(std::string& result) {
     std::lock_guard lock(mMutex);
+    base::StringAppendF(&result, " Total size: %zu KB, budget: ", mSizeInBytes / 1024);
+    if (mMemoryBudget == 0) {
+        result.append("unlimited");
+    } else {
+        base::StringAppendF(&result, "%zu KB", mMemoryBudget / 1024);
+    }
+    result.append(", budget per process: ");
+    if (mClientMemoryBudget == 0) {
+        result.append("unlimited\n");
+    } else {
+        base::StringAppendF(&result, "%zu KB\n", mClientMemoryBudget / 1024);
+    }
     for (const auto& [_, cache] : mBuffers) {
-        base::StringAppendF(&result, " Cache owner: %p\n", cache.first.get());
+        base::StringAppendF(&result,
+                            " Cache owner: %p, pid: %d, uid: %d, buffers: %zu, size: %zu KB, "
+                            "hits: %" PRIu64 ", misses: %" PRIu64 ", evictions: %" PRIu64 "\n",
+                            cache.token.get(), cache.pid, cache.uid, cache.buffers.size(),
+                            cache.sizeInBytes / 1024, cache.hits, cache.misses, cache.evictions);
 
-        for (const auto& [id, entry] : cache.second) {
+        for (const auto& [id, entry] : cache.buffers) {
             const auto& buffer = entry.buffer->getBuffer();
             base::StringAppendF(&result, "\tID: %" PRIu64 ", size: %ux%u\n", id, buffer->getWidth(),
                                 buffer->getHeight());
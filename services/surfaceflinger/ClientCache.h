@@ -26,8 +26,10 @@
 
 #include <map>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 // 4096 is based on 64 buffers * 64 layers. Once this limit is reached, the least recently used
 // buffer is uncached before the new buffer is cached.
@@ -52,8 +54,11 @@ public:
 
     enum class AddError { CacheFull, Unspecified };
 
+    // |pid| and |uid| are those of the process that caches the buffer, which are recorded the
+    // first time that it adds a buffer.
     base::expected<std::shared_ptr<renderengine::ExternalTexture>, AddError> add(
-            const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer);
+            const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer, int pid = -1,
+            int uid = -1);
 
     sp<GraphicBuffer> erase(const client_cache_t& cacheId);
 
@@ -75,6 +80,34 @@ public:
     void unregisterErasedRecipient(const client_cache_t& cacheId,
                                    const wp<ErasedRecipient>& recipient);
 
+    // Limits the total size of the buffers cached for all processes, or 0 for no limit. Adding a
+    // buffer past the limit evicts the least recently used buffers. Their erased recipients are
+    // notified, and so are the processes that cached them, so that they send the buffers again
+    // the next time they use them.
+    void setMemoryBudget(size_t bytes);
+
+    // Limits the size of the buffers cached for each process, or 0 for no limit. A process that
+    // adds a buffer past its limit has its own least recently used buffers evicted, and a warning
+    // is logged if it is still past the limit afterwards.
+    void setClientMemoryBudget(size_t bytes);
+    size_t getClientMemoryBudget();
+
+    struct CachedBuffer {
+        int uid;
+        int pid;
+        uint64_t bufferId;
+        size_t sizeInBytes;
+    };
+    // Returns the buffers cached for all processes, for accounting the memory held by each client.
+    std::vector<CachedBuffer> getCachedBuffers();
+
+    // An estimate of the memory used by a buffer.
+    static size_t bufferSizeInBytes(const GraphicBuffer& buffer);
+
+    // Returns the ids of the buffers that were evicted since the last call, so that they can also
+    // be purged from the Composer HAL cache.
+    std::vector<uint64_t> takeEvictedBufferIds();
+
     void dump(std::string& result);
 
 private:
@@ -83,11 +116,28 @@ private:
     struct ClientCacheBuffer {
         std::shared_ptr<renderengine::ExternalTexture> buffer;
         std::set<wp<ErasedRecipient>> recipients;
+        size_t sizeInBytes = 0;
+        // The value of mUseCounter when the buffer was last added or used.
+        uint64_t lastUsed = 0;
+    };
+
+    struct ProcessCache {
+        sp<IBinder> token; // strong ref to caching process
+        int uid = -1;
+        int pid = -1;
+        std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer> buffers;
+        size_t sizeInBytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+    std::map<wp<IBinder> /*caching process*/, ProcessCache> mBuffers GUARDED_BY(mMutex);
+
+    struct Eviction {
+        sp<IBinder> token;
+        client_cache_t cacheId;
+        std::vector<sp<ErasedRecipient>> recipients;
     };
-    std::map<wp<IBinder> /*caching process*/,
-             std::pair<sp<IBinder> /*strong ref to caching process*/,
-                       std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer>>>
-            mBuffers GUARDED_BY(mMutex);
 
     class CacheDeathRecipient : public IBinder::DeathRecipient {
     public:
@@ -99,6 +149,25 @@ private:
 
     bool getBuffer(const client_cache_t& cacheId, ClientCacheBuffer** outClientCacheBuffer)
             REQUIRES(mMutex);
+    // Evicts least recently used buffers until bytes more fit in the budget, or no other buffer
+    // can be evicted.
+    void evictLocked(size_t bytes, const client_cache_t& addedCacheId,
+                     std::vector<Eviction>& outEvictions) REQUIRES(mMutex);
+    // Evicts the least recently used buffers of a process, other than the one being added, until
+    // bytes more fit in its budget.
+    void evictClientLocked(size_t bytes, const wp<IBinder>& processToken,
+                           ProcessCache& processCache, std::optional<uint64_t> addedId,
+                           std::vector<Eviction>& outEvictions) REQUIRES(mMutex);
+    void evictBufferLocked(const wp<IBinder>& processToken, ProcessCache& processCache,
+                           std::unordered_map<uint64_t, ClientCacheBuffer>::iterator itr,
+                           std::vector<Eviction>& outEvictions) REQUIRES(mMutex);
+    static void notifyEvictions(const std::vector<Eviction>& evictions);
+
+    size_t mMemoryBudget GUARDED_BY(mMutex) = 0;
+    size_t mClientMemoryBudget GUARDED_BY(mMutex) = 0;
+    size_t mSizeInBytes GUARDED_BY(mMutex) = 0;
+    uint64_t mUseCounter GUARDED_BY(mMutex) = 0;
+    std::vector<uint64_t> mEvictedBufferIds GUARDED_BY(mMutex);
 };
 
 }; // namespace android
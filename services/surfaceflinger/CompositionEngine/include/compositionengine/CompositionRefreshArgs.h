@@ -101,6 +101,10 @@ struct CompositionRefreshArgs {
 
     // System time for when frame refresh starts. Used for stats.
     nsecs_t refreshStartTime = 0;
+
+    // If set, outputs that don't share any layers and whose displays support multi-threaded
+    // present run their whole Output::present at the same time, each on its own thread.
+    bool concurrentOutputPresent = false;
 };
 
 } // namespace android::compositionengine
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <ui/Rect.h>
+
+namespace android::compositionengine {
+
+// A coarse, conservative index of the area opaquely covered by layers, used to reject fully
+// occluded layers before doing any Region arithmetic for them.
+//
+// The bounds are split into at most kMaxTilesPerSide x kMaxTilesPerSide tiles, and a tile is
+// marked once a single opaque rect covers it completely. A rect whose tiles are all marked is
+// guaranteed to be occluded. Rects that are not reported as occluded may still be, and need the
+// exact Region math.
+class OcclusionGrid {
+public:
+    static constexpr int32_t kMaxTilesPerSide = 64;
+
+    explicit OcclusionGrid(const Rect& bounds);
+
+    void addOpaqueRect(const Rect& rect);
+
+    // Returns true if rect is known to be fully covered by the opaque rects added so far.
+    bool isOccluded(const Rect& rect) const;
+
+private:
+    using RowMask = uint64_t;
+    static_assert(sizeof(RowMask) * 8 == kMaxTilesPerSide);
+
+    static RowMask columnMask(int32_t begin, int32_t end);
+
+    const Rect mBounds;
+    int32_t mTileWidth = 1;
+    int32_t mTileHeight = 1;
+    int32_t mColumns = 0;
+    int32_t mRows = 0;
+    // Bit i of row j is set when the tile in column i of that row is covered.
+    std::array<RowMask, kMaxTilesPerSide> mCoveredTiles{};
+};
+
+} // namespace android::compositionengine
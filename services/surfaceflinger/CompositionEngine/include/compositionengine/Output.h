@@ -26,7 +26,9 @@
 #include <vector>
 
 #include <compositionengine/LayerFE.h>
+#include <compositionengine/OcclusionGrid.h>
 #include <ftl/future.h>
+#include <renderengine/DisplaySettings.h>
 #include <renderengine/LayerSettings.h>
 #include <ui/Fence.h>
 #include <ui/FenceTime.h>
@@ -157,6 +159,9 @@ public:
         // only has a value if there's something needing it, like when a TrustedPresentationListener
         // is set
         std::optional<Region> aboveCoveredLayersExcludingOverlays;
+        // Tracks aboveOpaqueLayers coarsely to skip layers that are fully occluded. Only set when
+        // there are enough layers for it to pay off.
+        std::optional<OcclusionGrid> occlusionGrid;
     };
 
     virtual ~Output();
@@ -271,6 +276,13 @@ public:
     // Whether this output can be presented from another thread.
     virtual bool supportsOffloadPresent() const = 0;
 
+    // Returns the buffer this output rendered the given client composition into during the frame
+    // that started at refreshStartTime, or null. An output that mirrors the same layer stack can
+    // copy it instead of drawing every layer again.
+    virtual std::shared_ptr<renderengine::ExternalTexture> findClientCompositionForMirror(
+            nsecs_t refreshStartTime, const renderengine::DisplaySettings&,
+            const std::vector<LayerFE::LayerSettings>&) = 0;
+
     // Make the next call to `present` run asynchronously.
     virtual void offloadPresentNextFrame() = 0;
 
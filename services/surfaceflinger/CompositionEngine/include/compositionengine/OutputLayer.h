@@ -109,6 +109,11 @@ public:
     // Updates the cursor position with the HWC
     virtual void writeCursorPositionToHWC() const = 0;
 
+    // Makes the next writeStateToHWC send all of the state again, rather than
+    // only what changed since it was last accepted by the HWC. Used when the
+    // HWC may not have applied the commands that were sent.
+    virtual void forceResendStateToHWC() = 0;
+
     // Returns the HWC2::Layer associated with this layer, if it exists
     virtual HWC2::Layer* getHwcLayer() const = 0;
 
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <compositionengine/LayerFE.h>
+#include <renderengine/DisplaySettings.h>
+
+namespace android::compositionengine::impl {
+
+// Identifies what each blur layer of a client composition request blurs, so that RenderEngine can
+// reuse the blur it generated for an earlier frame, such as for a notification shade or a dialog
+// over a static launcher.
+//
+// The layers beneath each blur layer are compared with the ones beneath the blur layer at the same
+// position of the previous request. A blur layer keeps its id for as long as they are equal, and
+// gets a new id once any of them changes.
+class BlurBackdropTracker {
+public:
+    // Sets LayerSettings::blurBackdropId for every layer in layerSettings that blurs.
+    void assignIds(const renderengine::DisplaySettings& display,
+                   std::vector<LayerFE::LayerSettings>& layerSettings);
+
+private:
+    struct Backdrop {
+        uint64_t id = 0;
+        // Snapshots of the layers beneath the blur layer.
+        std::vector<LayerFE::LayerSettings> layerSettings;
+    };
+
+    renderengine::DisplaySettings mDisplay;
+    // The backdrops of the previous request, in the order of its blur layers.
+    std::vector<Backdrop> mBackdrops;
+    uint64_t mNextId = 1;
+};
+
+} // namespace android::compositionengine::impl
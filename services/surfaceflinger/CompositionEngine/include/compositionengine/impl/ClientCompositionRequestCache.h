@@ -18,15 +18,26 @@
 
 #include <cstdint>
 #include <deque>
+#include <memory>
+#include <optional>
 
 #include <compositionengine/LayerFE.h>
 #include <renderengine/DisplaySettings.h>
+#include <renderengine/ExternalTexture.h>
 #include <renderengine/LayerSettings.h>
+#include <ui/FloatRect.h>
 
 namespace android {
 
 namespace compositionengine::impl {
 
+// Returns a copy of the settings that does not hold a reference to the layer's buffer.
+LayerFE::LayerSettings getLayerSettingsSnapshot(const LayerFE::LayerSettings& settings);
+
+// Whether both settings draw the same pixels. Buffers are compared by id and frame number, so
+// either settings may be a snapshot.
+bool layerSettingsAreEqual(const LayerFE::LayerSettings& lhs, const LayerFE::LayerSettings& rhs);
+
 // The cache is used to skip duplicate client composition requests. We do so by keeping track
 // of every composition request and the buffer that the request is rendered into. During the
 // next composition request, if the request matches what was rendered into the buffer, then
@@ -37,29 +48,79 @@ namespace compositionengine::impl {
 // the composition request. We need to make sure the request, including the order of the
 // layers, do not change from call to call. The snapshot removes strong references to the
 // client buffer id so we don't extend the lifetime of the buffer by storing it in the cache.
+//
+// Each snapshot is keyed by a hash of the request, so that a lookup only walks the layer
+// settings of requests that are likely to match. A lookup that misses the buffer it is rendering
+// into may still find the same content in another buffer, which can then be copied instead of
+// redrawing every layer.
 class ClientCompositionRequestCache {
 public:
+    enum class Result {
+        // Nothing that was rendered matches the request.
+        Miss,
+        // The buffer being rendered into already holds the result of the request.
+        Hit,
+        // Another buffer holds the result of the request.
+        HitOtherBuffer,
+    };
+
+    struct Lookup {
+        Result result = Result::Miss;
+        // The hash of the request, to pass back to add().
+        size_t requestHash = 0;
+        // Set for Result::HitOtherBuffer, if that buffer is still alive.
+        std::shared_ptr<renderengine::ExternalTexture> otherBuffer;
+    };
+
     explicit ClientCompositionRequestCache(uint32_t cacheSize) : mMaxCacheSize(cacheSize){};
     ~ClientCompositionRequestCache() = default;
+
+    // Looks up the request for rendering into the buffer with bufferId, counting the result.
+    Lookup lookup(uint64_t bufferId, const renderengine::DisplaySettings& display,
+                  const std::vector<LayerFE::LayerSettings>& layerSettings);
     bool exists(uint64_t bufferId, const renderengine::DisplaySettings& display,
                 const std::vector<LayerFE::LayerSettings>& layerSettings) const;
-    void add(uint64_t bufferId, const renderengine::DisplaySettings& display,
+    // Returns the area, in layer stack space, where the buffer with bufferId differs from the
+    // result of the request. Returns std::nullopt if the whole buffer needs to be redrawn, because
+    // the buffer holds a different composition, or because a layer blurs what is beneath it or
+    // changed in a way that draws outside of its bounds.
+    std::optional<FloatRect> getDamage(
+            uint64_t bufferId, const renderengine::DisplaySettings& display,
+            const std::vector<LayerFE::LayerSettings>& layerSettings) const;
+    // Records that the request with requestHash was rendered into buffer. Only a weak reference
+    // to the buffer is kept.
+    void add(const std::shared_ptr<renderengine::ExternalTexture>& buffer, size_t requestHash,
+             const renderengine::DisplaySettings& display,
              const std::vector<LayerFE::LayerSettings>& layerSettings);
     void remove(uint64_t bufferId);
 
+    static size_t getRequestHash(const renderengine::DisplaySettings& display,
+                                 const std::vector<LayerFE::LayerSettings>& layerSettings);
+
+    void dump(std::string& out) const;
+
 private:
     uint32_t mMaxCacheSize;
     struct ClientCompositionRequest {
+        size_t hash;
         renderengine::DisplaySettings display;
         std::vector<LayerFE::LayerSettings> layerSettings;
-        ClientCompositionRequest(const renderengine::DisplaySettings& _display,
-                                 const std::vector<LayerFE::LayerSettings>& _layerSettings);
-        bool equals(const renderengine::DisplaySettings& _display,
+        std::weak_ptr<renderengine::ExternalTexture> buffer;
+        ClientCompositionRequest(size_t _hash, const renderengine::DisplaySettings& _display,
+                                 const std::vector<LayerFE::LayerSettings>& _layerSettings,
+                                 std::weak_ptr<renderengine::ExternalTexture> _buffer);
+        bool equals(size_t _hash, const renderengine::DisplaySettings& _display,
                     const std::vector<LayerFE::LayerSettings>& _layerSettings) const;
     };
 
+    void add(uint64_t bufferId, ClientCompositionRequest&& request);
+
     // Cache of requests, keyed by corresponding GraphicBuffer ID.
     std::deque<std::pair<uint64_t /* bufferId */, ClientCompositionRequest>> mCache;
+
+    size_t mHitCount = 0;
+    size_t mOtherBufferHitCount = 0;
+    size_t mMissCount = 0;
 };
 
 } // namespace compositionengine::impl
@@ -17,6 +17,12 @@
 #pragma once
 
 #include <compositionengine/CompositionEngine.h>
+#include <compositionengine/impl/HwcAsyncWorker.h>
+#include <ftl/future.h>
+#include <ui/DisplayMap.h>
+
+#include <memory>
+#include <vector>
 
 namespace android::compositionengine::impl {
 
@@ -59,11 +65,20 @@ public:
     void setNeedsAnotherUpdateForTest(bool);
 
 private:
+    // Presents the outputs that can run independently at the same time, see
+    // CompositionRefreshArgs::concurrentOutputPresent. Returns false if the outputs have to be
+    // presented one at a time.
+    bool presentOutputsConcurrently(CompositionRefreshArgs&,
+                                    ui::DisplayVector<ftl::Future<std::monostate>>&);
+
     std::unique_ptr<HWComposer> mHwComposer;
-    renderengine::RenderEngine* mRenderEngine;
+    renderengine::RenderEngine* mRenderEngine = nullptr;
     std::shared_ptr<TimeStats> mTimeStats;
     bool mNeedsAnotherUpdate = false;
     nsecs_t mRefreshStartTime = 0;
+    // Run Output::present for all but one of the outputs presented concurrently. Created on first
+    // use.
+    std::vector<std::unique_ptr<HwcAsyncWorker>> mPresentWorkers;
 };
 
 std::unique_ptr<compositionengine::CompositionEngine> createCompositionEngine();
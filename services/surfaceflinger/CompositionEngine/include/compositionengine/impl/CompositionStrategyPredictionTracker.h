@@ -0,0 +1,95 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ui/FenceTime.h>
+#include <utils/Timers.h>
+
+namespace android::compositionengine::impl {
+
+// Counts how often the composition strategy predicted for an output matches the one HWC chooses,
+// and how long the GPU compositions drawn for mispredicted strategies took.
+//
+// If a minimum hit rate is set, prediction is paused once the hit rate of the recent predictions
+// drops below it, since every miss composes the frame on the GPU twice. Prediction resumes after
+// a number of frames, with the recent predictions forgotten.
+class CompositionStrategyPredictionTracker {
+public:
+    struct Config {
+        // The fraction of recent predictions that must hit. 0 never pauses prediction.
+        float minHitRate = 0.f;
+        // The number of recent predictions the hit rate is computed over.
+        size_t windowSize = 60;
+        // The number of frames that could have been predicted to skip once paused.
+        size_t pausedFrames = 600;
+    };
+
+    struct Stats {
+        size_t predictions = 0;
+        size_t hits = 0;
+        // From the start of each mispredicted composition to the time its fence signaled.
+        nsecs_t wastedCompositionTime = 0;
+        size_t pauses = 0;
+    };
+
+    CompositionStrategyPredictionTracker() = default;
+    explicit CompositionStrategyPredictionTracker(const Config& config) : mConfig(config) {}
+
+    void setConfig(const Config& config) { mConfig = config; }
+
+    // Returns whether a frame whose strategy could be predicted should be. Called once per frame.
+    bool shouldPredict();
+
+    // Records whether the strategy predicted for a frame was the one HWC chose.
+    void onPredictionResult(bool hit);
+
+    // Records the composition drawn for a mispredicted strategy, which started at startTime and
+    // completes when fence signals. Its duration is counted once the fence has signaled.
+    void onMispredictedComposition(nsecs_t startTime, std::shared_ptr<FenceTime> fence);
+
+    const Stats& getStats() const { return mStats; }
+    bool isPaused() const { return mPausedFramesLeft > 0; }
+
+    void dump(std::string& out) const;
+
+private:
+    // Only so many compositions are waited on, in case their fences never signal.
+    static constexpr size_t kMaxPendingCompositions = 8;
+
+    struct PendingComposition {
+        nsecs_t startTime;
+        std::shared_ptr<FenceTime> fence;
+    };
+
+    void updatePendingCompositions();
+
+    Config mConfig;
+    Stats mStats;
+    // Whether each of the recent predictions hit, oldest first.
+    std::deque<bool> mRecentResults;
+    size_t mRecentHits = 0;
+    size_t mPausedFramesLeft = 0;
+    std::vector<PendingComposition> mPendingCompositions;
+};
+
+} // namespace android::compositionengine::impl
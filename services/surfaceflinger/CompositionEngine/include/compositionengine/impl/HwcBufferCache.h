@@ -19,6 +19,7 @@
 #include <cstdint>
 #include <stack>
 #include <unordered_map>
+#include <vector>
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
 #pragma clang diagnostic push
@@ -92,6 +93,26 @@ public:
     //
     uint32_t uncache(uint64_t graphicBufferId);
 
+    //
+    // Purges a batch of discarded buffers from the cache, such as all the buffers that clients
+    // uncached since the last frame.
+    //
+    // The active buffer is uncached last, so that its slot is the first to be reused. Returns the
+    // slots of the buffers that were found in the cache, which is empty when none of them were.
+    //
+    std::vector<uint32_t> uncache(const std::vector<uint64_t>& graphicBufferIds,
+                                  uint64_t activeBufferId);
+
+    struct Stats {
+        // Buffers that were already cached, so only their slot was sent to HWC.
+        uint64_t hits = 0;
+        // Buffers that had to be sent to HWC.
+        uint64_t misses = 0;
+        // Cached buffers that lost their slot to another buffer.
+        uint64_t evictions = 0;
+    };
+    const Stats& getStats() const { return mStats; }
+
 private:
     uint32_t cache(const sp<GraphicBuffer>& buffer);
     uint32_t getLeastRecentlyUsedSlot();
@@ -102,12 +123,17 @@ private:
         // Cache entries are evicted according to least-recently-used when more than
         // kMaxLayerBufferCount unique buffers have been sent to a layer.
         uint64_t lruCounter;
+        // The number of times the buffer was sent again after it was cached. Buffers that are
+        // reused are kept over buffers that were only sent once, unless they've gone unused for
+        // longer than it takes to cycle through all the slots.
+        uint32_t reuseCount = 0;
     };
 
     std::unordered_map<uint64_t, Cache> mCacheByBufferId;
     sp<GraphicBuffer> mLastOverrideBuffer;
     std::stack<uint32_t> mFreeSlots;
     uint64_t mLeastRecentlyUsedCounter;
+    Stats mStats;
 };
 
 } // namespace compositionengine::impl
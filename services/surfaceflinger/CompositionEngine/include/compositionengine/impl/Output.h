@@ -19,6 +19,8 @@
 #include <compositionengine/CompositionEngine.h>
 #include <compositionengine/LayerFECompositionState.h>
 #include <compositionengine/Output.h>
+#include <compositionengine/impl/BlurBackdropTracker.h>
+#include <compositionengine/impl/CompositionStrategyPredictionTracker.h>
 #include <compositionengine/impl/ClientCompositionRequestCache.h>
 #include <compositionengine/impl/GpuCompositionResult.h>
 #include <compositionengine/impl/HwcAsyncWorker.h>
@@ -82,6 +84,9 @@ public:
     void prepare(const CompositionRefreshArgs&, LayerFESet&) override;
     ftl::Future<std::monostate> present(const CompositionRefreshArgs&) override;
     bool supportsOffloadPresent() const override { return false; }
+    std::shared_ptr<renderengine::ExternalTexture> findClientCompositionForMirror(
+            nsecs_t refreshStartTime, const renderengine::DisplaySettings&,
+            const std::vector<LayerFE::LayerSettings>&) override;
     void offloadPresentNextFrame() override;
 
     void uncacheBuffers(const std::vector<uint64_t>& bufferIdsToUncache) override;
@@ -174,6 +179,13 @@ private:
             const compositionengine::CompositionRefreshArgs&) const;
     void updateHwcAsyncWorker();
     float getHdrSdrRatio(const std::shared_ptr<renderengine::ExternalTexture>& buffer) const;
+    void updateMirrorSources(const compositionengine::CompositionRefreshArgs&);
+    std::shared_ptr<renderengine::ExternalTexture> findMirrorSourceClientComposition(
+            const std::shared_ptr<renderengine::ExternalTexture>& target,
+            const renderengine::DisplaySettings&, const std::vector<LayerFE::LayerSettings>&);
+    void recordClientCompositionForMirrors(
+            const std::shared_ptr<renderengine::ExternalTexture>& buffer,
+            const renderengine::DisplaySettings&, const std::vector<LayerFE::LayerSettings>&);
 
     std::string mName;
     std::string mNamePlusId;
@@ -184,10 +196,33 @@ private:
     ReleasedLayers mReleasedLayers;
     OutputLayer* mLayerRequestingBackgroundBlur = nullptr;
     std::unique_ptr<ClientCompositionRequestCache> mClientCompositionRequestCache;
+    // Whether a client composition result found in another buffer is copied instead of redrawn.
+    bool mReuseClientCompositionAcrossBuffers = false;
+    // Whether client composition only redraws the layers that changed since the request cached
+    // for the buffer being drawn into. This can be set by debug.sf.partial_client_composition
+    bool mPartialClientComposition = false;
+    // Whether outputs that show the same layer stack share their client composition results, so
+    // that a mirroring virtual display whose configuration matches its source copies the source's
+    // composited buffer instead of drawing every layer again. This can be set by
+    // debug.sf.share_mirror_client_composition
+    bool mShareClientCompositionWithMirrors = false;
+    // The last client composition of this output, keyed without the output's name so that other
+    // outputs can match it, and the frame it was rendered in.
+    std::unique_ptr<ClientCompositionRequestCache> mMirroredClientComposition;
+    nsecs_t mMirroredClientCompositionFrame = 0;
+    // Set if RenderEngine may reuse the blurs of layers whose backdrop did not change. This can be
+    // set by debug.sf.cache_blur_backdrops
+    std::unique_ptr<BlurBackdropTracker> mBlurBackdropTracker;
+    // The outputs showing the same layer stack that present before this one in the current frame.
+    std::vector<compositionengine::Output*> mMirrorSources;
+    nsecs_t mRefreshStartTime = 0;
     std::unique_ptr<planner::Planner> mPlanner;
     std::unique_ptr<HwcAsyncWorker> mHwComposerAsyncWorker;
 
     bool mPredictCompositionStrategy = false;
+    // Prediction is paused for a while once fewer than this percentage of the recent predictions
+    // hit. This can be set by debug.sf.prediction_min_hit_rate_percent
+    CompositionStrategyPredictionTracker mPredictionTracker;
     bool mOffloadPresent = false;
 
     // Whether the content must be recomposed this frame.
@@ -165,6 +165,10 @@ struct OutputCompositionState {
 
     bool treat170mAsSrgb = false;
 
+    // Number of layers rejected as fully occluded by the OcclusionGrid, without computing their
+    // visible region.
+    uint64_t occlusionCulledLayers = 0;
+
     uint64_t lastOutputLayerHash = 0;
     uint64_t outputLayerHash = 0;
 
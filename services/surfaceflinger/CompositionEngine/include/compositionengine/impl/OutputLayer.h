@@ -52,6 +52,7 @@ public:
     void writeStateToHWC(bool includeGeometry, bool skipLayer, uint32_t z, bool zIsOverridden,
                          bool isPeekingThrough) override;
     void writeCursorPositionToHWC() const override;
+    void forceResendStateToHWC() override;
 
     HWC2::Layer* getHwcLayer() const override;
     bool requiresClientComposition() const override;
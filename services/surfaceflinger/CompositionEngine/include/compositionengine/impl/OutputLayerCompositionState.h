@@ -18,6 +18,7 @@
 
 #include <compositionengine/ProjectionSpace.h>
 #include <compositionengine/impl/HwcBufferCache.h>
+#include <math/mat4.h>
 #include <renderengine/ExternalTexture.h>
 #include <ui/FloatRect.h>
 #include <ui/GraphicTypes.h>
@@ -105,6 +106,8 @@ struct OutputLayerCompositionState {
         std::shared_ptr<renderengine::ExternalTexture> buffer = nullptr;
         sp<Fence> acquireFence = nullptr;
         Rect displayFrame = {};
+        // The area of the buffer to display. The whole buffer is displayed if empty.
+        Rect sourceCrop = {};
         ui::Dataspace dataspace{ui::Dataspace::UNKNOWN};
         ProjectionSpace displaySpace;
         Region damageRegion = Region::INVALID_REGION;
@@ -151,6 +154,22 @@ struct OutputLayerCompositionState {
 
         // True when this layer was skipped as part of SF-side layer caching.
         bool layerSkipped = false;
+
+        // The values most recently accepted by the HWC for this layer, which are not sent again
+        // until they change. An unset value is sent on the next write.
+        struct SentState {
+            std::optional<Rect> displayFrame;
+            std::optional<FloatRect> sourceCrop;
+            std::optional<uint32_t> z;
+            std::optional<Hwc2::Transform> transform;
+            std::optional<Hwc2::IComposerClient::BlendMode> blendMode;
+            std::optional<float> planeAlpha;
+            std::optional<Region> visibleRegion;
+            std::optional<Region> blockingRegion;
+            std::optional<ui::Dataspace> dataspace;
+            std::optional<float> brightness;
+            std::optional<mat4> colorTransform;
+        } sentState;
     };
 
     // The HWC state is optional, and is only set up if there is any potential
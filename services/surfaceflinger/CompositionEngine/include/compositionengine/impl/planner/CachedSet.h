@@ -65,9 +65,11 @@ public:
     size_t getLayerCount() const { return mLayers.size(); }
     const Layer& getFirstLayer() const { return mLayers[0]; }
     const Rect& getBounds() const { return mBounds; }
-    Rect getTextureBounds() const {
-        return mTexture ? mTexture->get()->getBuffer()->getBounds() : Rect::INVALID_RECT;
-    }
+    // The area of the display covered by the rendered texture.
+    Rect getTextureBounds() const { return mTexture ? mTextureBounds : Rect::INVALID_RECT; }
+    // The area of the rendered texture that holds the cached set, which is less than the whole
+    // texture when it was borrowed from a smaller bucket than the display.
+    Rect getTextureSourceCrop() const { return mTexture ? mTextureSourceCrop : Rect::INVALID_RECT; }
     const Region& getVisibleRegion() const { return mVisibleRegion; }
     size_t getAge() const { return mAge; }
     std::shared_ptr<renderengine::ExternalTexture> getBuffer() const {
@@ -114,8 +116,11 @@ public:
     size_t getSkipCount() { return mSkipCount; }
 
     // Renders the cached set with the supplied output composition state.
+    // If renderBoundsOnly is true, the cached set is rendered into the smallest texture bucket
+    // that holds its bounds where the output allows it, rather than a display-sized texture.
     void render(renderengine::RenderEngine& re, TexturePool& texturePool,
-                const OutputCompositionState& outputState, bool deviceHandlesColorTransform);
+                const OutputCompositionState& outputState, bool deviceHandlesColorTransform,
+                bool renderBoundsOnly = false);
 
     void dump(std::string& result) const;
 
@@ -166,6 +171,8 @@ private:
     // TODO(b/190411067): This is a shared pointer only because CachedSets are copied into different
     // containers in the Flattener. Logically this should have unique ownership otherwise.
     std::shared_ptr<TexturePool::AutoTexture> mTexture;
+    Rect mTextureBounds;
+    Rect mTextureSourceCrop;
     sp<Fence> mDrawFence;
     ProjectionSpace mOutputSpace;
     ui::Dataspace mOutputDataspace;
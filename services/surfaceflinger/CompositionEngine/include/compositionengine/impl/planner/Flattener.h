@@ -70,6 +70,17 @@ public:
             const size_t maxDeferRenderAttempts;
         };
 
+        // Tunables for rendering cached sets ahead of time, for layer stacks that the Predictor
+        // expects to be flattened. A predicted cached set is only rendered after a frame has been
+        // presented, when there is enough time left before the next one, and is used once the
+        // layers it contains become inactive, so the frame that first uses it does not render it.
+        struct PredictiveRendering {
+            static const constexpr std::chrono::milliseconds kDefaultLead = 50ms;
+
+            // How long before its layers become inactive a cached set may be rendered.
+            const std::chrono::milliseconds lead;
+        };
+
         static const constexpr std::chrono::milliseconds kDefaultActiveLayerTimeout = 150ms;
 
         static const constexpr bool kDefaultEnableHolePunch = true;
@@ -85,6 +96,14 @@ public:
 
         // True if the hole punching feature should be enabled.
         const bool mEnableHolePunch;
+
+        // Toggles for rendering predicted cached sets. Disabled if unset.
+        // See: PredictiveRendering
+        const std::optional<PredictiveRendering> mPredictiveRendering = std::nullopt;
+
+        // True if cached sets should be rendered into textures sized to their bounds rather than
+        // to the display.
+        const bool mRenderCachedSetBoundsOnly = false;
     };
 
     // Constants not yet backed by a sysprop
@@ -111,10 +130,17 @@ public:
 
     void setTexturePoolEnabled(bool enabled) { mTexturePool.setEnabled(enabled); }
 
+    // Whether the Predictor expects the layer stack passed to the next flattenLayers call to be
+    // flattened. Only such stacks have cached sets rendered ahead of time.
+    void setFlatteningPredicted(bool predicted) { mFlatteningPredicted = predicted; }
+
     void dump(std::string& result) const;
     void dumpLayers(std::string& result) const;
 
     const std::optional<CachedSet>& getNewCachedSetForTesting() const { return mNewCachedSet; }
+    const std::optional<CachedSet>& getPredictedCachedSetForTesting() const {
+        return mPredictedCachedSet;
+    }
 
 private:
     size_t calculateDisplayCost(const std::vector<const LayerState*>& layers) const;
@@ -227,8 +253,21 @@ private:
 
     std::optional<Run> findBestRun(std::vector<Run>& runs) const;
 
+    CachedSet buildCachedSet(const Run& run, std::chrono::steady_clock::time_point now) const;
+
     void buildCachedSets(std::chrono::steady_clock::time_point now);
 
+    // Drops the predicted cached set if its layers changed, and predicts a new one if the layer
+    // stack is expected to be flattened.
+    void updatePredictedCachedSet(std::chrono::steady_clock::time_point now);
+
+    void resetPredictedCachedSet();
+
+    void renderPredictedCachedSet(
+            const OutputCompositionState& outputState,
+            std::optional<std::chrono::steady_clock::time_point> renderDeadline,
+            bool deviceHandlesColorTransform);
+
     renderengine::RenderEngine& mRenderEngine;
     const Tunables mTunables;
 
@@ -237,6 +276,9 @@ private:
 protected:
     // mNewCachedSet must be destroyed before mTexturePool is.
     std::optional<CachedSet> mNewCachedSet;
+    // The cached set expected to be built next, rendered ahead of time. Like mNewCachedSet, it
+    // must be destroyed before mTexturePool is.
+    std::optional<CachedSet> mPredictedCachedSet;
 
 private:
     ui::Size mDisplaySize;
@@ -246,6 +288,8 @@ private:
 
     std::vector<CachedSet> mLayers;
 
+    bool mFlatteningPredicted = false;
+
     // Statistics
     size_t mUnflattenedDisplayCost = 0;
     size_t mFlattenedDisplayCost = 0;
@@ -254,6 +298,11 @@ private:
     size_t mCachedSetCreationCount = 0;
     size_t mCachedSetCreationCost = 0;
     std::unordered_map<size_t, size_t> mInvalidatedCachedSetAges;
+    size_t mPredictedCachedSetRenderCount = 0;
+    // Predicted cached sets that were used as the new cached set.
+    size_t mPredictedCachedSetHitCount = 0;
+    // Predicted cached sets that were rendered, then dropped without being used.
+    size_t mPredictedCachedSetWasteCount = 0;
 };
 
 } // namespace compositionengine::impl::planner
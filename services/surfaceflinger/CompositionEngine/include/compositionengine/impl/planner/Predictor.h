@@ -249,6 +249,15 @@ public:
     void recordResult(std::optional<PredictedPlan> predictedPlan, NonBufferHash flattenedHash,
                       const std::vector<const LayerState*>&, bool hasSkippedLayers, Plan result);
 
+    // Records whether the layer stack with the given geometry hash was flattened this frame. A
+    // layer stack is observed once each time it becomes the current stack, and counts as flattened
+    // if any frame of that observation was.
+    void recordFlattening(NonBufferHash geometryHash, bool flattened);
+
+    // Whether the layer stack with the given geometry hash was flattened in at least half of its
+    // previous observations.
+    bool isLikelyToFlatten(NonBufferHash geometryHash) const;
+
     void dump(std::string&) const;
 
     void compareLayerStacks(NonBufferHash leftHash, NonBufferHash rightHash, std::string&) const;
@@ -306,6 +315,16 @@ private:
 
     std::vector<ApproximateStack> mApproximateStacks;
 
+    struct FlatteningHistory {
+        size_t observations = 0;
+        size_t flattenedObservations = 0;
+        bool flattenedInCurrentObservation = false;
+    };
+
+    static constexpr const size_t MAX_FLATTENING_HISTORIES = 32;
+    std::unordered_map<NonBufferHash, FlatteningHistory> mFlatteningHistories;
+    std::optional<NonBufferHash> mCurrentFlatteningHash;
+
     mutable size_t mExactHitCount = 0;
     mutable size_t mApproximateHitCount = 0;
     mutable size_t mMissCount = 0;
@@ -23,16 +23,19 @@
 
 #include <renderengine/ExternalTexture.h>
 #include <chrono>
+#include <map>
 #include "android-base/macros.h"
 
 namespace android::compositionengine::impl::planner {
 
-// A pool of textures that only manages textures of a single size.
-// While it is possible to define a texture pool supporting variable-sized textures to save on
-// memory, it is a simpler implementation to only manage screen-sized textures. The texture pool is
-// unbounded - there are a minimum number of textures preallocated. Under heavy system load, new
-// textures may be allocated, but only a maximum number of retained once those textures are no
-// longer necessary.
+// A pool of textures sized in buckets relative to the display size.
+// Each dimension of a bucket is a multiple of 1/kBucketSteps of the same display dimension, so a
+// cached set covering part of the screen borrows the smallest bucket that fits it rather than a
+// screen-sized texture. The texture pool is unbounded - there are a minimum number of screen-sized
+// textures preallocated, and under heavy system load new textures may be allocated. Once textures
+// are returned, the pool only retains up to a byte budget of them, evicting the least recently
+// returned textures first, and textures that stay unused for kIdleTimeout are trimmed back down to
+// the preallocated size.
 class TexturePool {
 public:
     // RAII class helping with managing textures from the texture pool
@@ -41,10 +44,14 @@ public:
     class AutoTexture {
     public:
         AutoTexture(TexturePool& texturePool,
-                    std::shared_ptr<renderengine::ExternalTexture> texture, const sp<Fence>& fence)
-              : mTexturePool(texturePool), mTexture(texture), mFence(fence) {}
+                    std::shared_ptr<renderengine::ExternalTexture> texture, const sp<Fence>& fence,
+                    uint64_t generation)
+              : mTexturePool(texturePool),
+                mTexture(texture),
+                mFence(fence),
+                mGeneration(generation) {}
 
-        ~AutoTexture() { mTexturePool.returnTexture(std::move(mTexture), mFence); }
+        ~AutoTexture() { mTexturePool.returnTexture(std::move(mTexture), mFence, mGeneration); }
 
         sp<Fence> getReadyFence() { return mFence; }
 
@@ -61,6 +68,7 @@ public:
         TexturePool& mTexturePool;
         std::shared_ptr<renderengine::ExternalTexture> mTexture;
         sp<Fence> mFence;
+        const uint64_t mGeneration;
     };
 
     TexturePool(renderengine::RenderEngine& renderEngine)
@@ -79,6 +87,17 @@ public:
     // to the pool.
     std::shared_ptr<AutoTexture> borrowTexture();
 
+    // Borrows a texture from the smallest bucket that is at least minSize, which is clamped to
+    // the display size.
+    std::shared_ptr<AutoTexture> borrowTexture(ui::Size minSize);
+
+    // Returns the size of the bucket that borrowTexture(minSize) hands out.
+    ui::Size getBucketSize(ui::Size minSize) const;
+
+    // Frees pooled textures that have not been used since kIdleTimeout before now, least recently
+    // used first, without going below the preallocated pool.
+    void trimIdle(std::chrono::steady_clock::time_point now);
+
     // Enables or disables the pool. When the pool is disabled, no buffers will
     // be held by the pool. This is useful when the active display changes.
     void setEnabled(bool enable);
@@ -88,24 +107,46 @@ public:
 protected:
     // Proteted visibility so that they can be used for testing
     const static constexpr size_t kMinPoolSize = 3;
+    // The byte budget of the pool, in screen-sized textures.
     const static constexpr size_t kMaxPoolSize = 4;
+    const static constexpr int32_t kBucketSteps = 4;
+    const static constexpr std::chrono::steady_clock::duration kIdleTimeout =
+            std::chrono::seconds(2);
 
     struct Entry {
         std::shared_ptr<renderengine::ExternalTexture> texture;
         sp<Fence> fence;
+        std::chrono::steady_clock::time_point lastUsed;
     };
 
+    // Ordered from least to most recently returned.
     std::deque<Entry> mPool;
 
+    size_t getPoolBytes() const { return mPoolBytes; }
+    size_t getBudgetBytes() const { return kMaxPoolSize * textureBytes(mSize); }
+
 private:
-    std::shared_ptr<renderengine::ExternalTexture> genTexture();
-    // Returns a previously borrowed texture to the pool.
+    struct BucketStats {
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    static size_t textureBytes(ui::Size size);
+    std::shared_ptr<renderengine::ExternalTexture> genTexture(ui::Size size);
+    // Returns a previously borrowed texture to the pool, unless it was allocated for a previous
+    // generation of the pool.
     void returnTexture(std::shared_ptr<renderengine::ExternalTexture>&& texture,
-                       const sp<Fence>& fence);
+                       const sp<Fence>& fence, uint64_t generation);
     void allocatePool();
+    void evictFront();
     renderengine::RenderEngine& mRenderEngine;
     ui::Size mSize;
     bool mEnabled;
+    size_t mPoolBytes = 0;
+    // Incremented whenever the pool is reallocated.
+    uint64_t mGeneration = 0;
+    // Keyed by bucket width and height.
+    std::map<std::pair<int32_t, int32_t>, BucketStats> mBucketStats;
 };
 
 } // namespace android::compositionengine::impl::planner
@@ -83,6 +83,10 @@ public:
     MOCK_METHOD1(present,
                  ftl::Future<std::monostate>(const compositionengine::CompositionRefreshArgs&));
     MOCK_CONST_METHOD0(supportsOffloadPresent, bool());
+    MOCK_METHOD(std::shared_ptr<renderengine::ExternalTexture>, findClientCompositionForMirror,
+                (nsecs_t, const renderengine::DisplaySettings&,
+                 const std::vector<LayerFE::LayerSettings>&),
+                (override));
     MOCK_METHOD(void, offloadPresentNextFrame, ());
 
     MOCK_METHOD1(uncacheBuffers, void(const std::vector<uint64_t>&));
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include <compositionengine/impl/BlurBackdropTracker.h>
+#include <compositionengine/impl/ClientCompositionRequestCache.h>
+
+namespace android::compositionengine::impl {
+
+void BlurBackdropTracker::assignIds(const renderengine::DisplaySettings& display,
+                                    std::vector<LayerFE::LayerSettings>& layerSettings) {
+    // Everything beneath the blur layers is drawn differently.
+    if (display != mDisplay) {
+        mDisplay = display;
+        mBackdrops.clear();
+    }
+
+    size_t blurLayerCount = 0;
+    for (auto layer = layerSettings.begin(); layer != layerSettings.end(); layer++) {
+        if (layer->backgroundBlurRadius <= 0 && layer->blurRegions.empty()) {
+            continue;
+        }
+
+        if (blurLayerCount == mBackdrops.size()) {
+            mBackdrops.push_back({});
+        }
+        Backdrop& backdrop = mBackdrops[blurLayerCount++];
+        if (backdrop.id == 0 ||
+            !std::equal(backdrop.layerSettings.begin(), backdrop.layerSettings.end(),
+                        layerSettings.begin(), layer, layerSettingsAreEqual)) {
+            backdrop.id = mNextId++;
+            backdrop.layerSettings.clear();
+            std::transform(layerSettings.begin(), layer,
+                           std::back_inserter(backdrop.layerSettings), getLayerSettingsSnapshot);
+        }
+        layer->blurBackdropId = backdrop.id;
+    }
+    mBackdrops.resize(blurLayerCount);
+}
+
+} // namespace android::compositionengine::impl
@@ -15,20 +15,17 @@
  */
 
 #include <algorithm>
+#include <limits>
 
+#include <android-base/stringprintf.h>
 #include <compositionengine/impl/ClientCompositionRequestCache.h>
+#include <math/HashCombine.h>
 #include <renderengine/DisplaySettings.h>
 #include <renderengine/LayerSettings.h>
 
 namespace android::compositionengine::impl {
 
 namespace {
-LayerFE::LayerSettings getLayerSettingsSnapshot(const LayerFE::LayerSettings& settings) {
-    LayerFE::LayerSettings snapshot = settings;
-    snapshot.source.buffer.buffer = nullptr;
-    snapshot.source.buffer.fence = nullptr;
-    return snapshot;
-}
 
 inline bool equalIgnoringSource(const renderengine::LayerSettings& lhs,
                                 const renderengine::LayerSettings& rhs) {
@@ -60,17 +57,67 @@ inline bool equalIgnoringBuffer(const renderengine::LayerSettings& lhs,
             equalIgnoringBuffer(lhs.source.buffer, rhs.source.buffer);
 }
 
+// The bounds of the layer in layer stack space.
+FloatRect getLayerStackBounds(const renderengine::LayerSettings& settings) {
+    const FloatRect& bounds = settings.geometry.boundaries;
+    const mat4& transform = settings.geometry.positionTransform;
+    FloatRect result{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                     std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (const vec2& corner : {vec2(bounds.left, bounds.top), vec2(bounds.right, bounds.top),
+                               vec2(bounds.left, bounds.bottom),
+                               vec2(bounds.right, bounds.bottom)}) {
+        const vec4 point = transform * vec4(corner, 0.f, 1.f);
+        result.left = std::min(result.left, point.x);
+        result.top = std::min(result.top, point.y);
+        result.right = std::max(result.right, point.x);
+        result.bottom = std::max(result.bottom, point.y);
+    }
+    return result;
+}
+
+void unionBounds(std::optional<FloatRect>& damage, const FloatRect& bounds) {
+    if (bounds.isEmpty()) {
+        return;
+    }
+    if (!damage) {
+        damage = bounds;
+        return;
+    }
+    damage->left = std::min(damage->left, bounds.left);
+    damage->top = std::min(damage->top, bounds.top);
+    damage->right = std::max(damage->right, bounds.right);
+    damage->bottom = std::max(damage->bottom, bounds.bottom);
+}
+
+// Whether redrawing only the bounds of the layer, as it was and as it is, is enough to replace it.
+bool drawsWithinBounds(const renderengine::LayerSettings& settings) {
+    return settings.shadow.length <= 0 && !settings.stretchEffect.hasEffect() &&
+            !settings.edgeExtensionEffect.hasEffect();
+}
+
+bool hasBlur(const renderengine::LayerSettings& settings) {
+    return settings.backgroundBlurRadius > 0 || !settings.blurRegions.empty();
+}
+
+} // namespace
+
+LayerFE::LayerSettings getLayerSettingsSnapshot(const LayerFE::LayerSettings& settings) {
+    LayerFE::LayerSettings snapshot = settings;
+    snapshot.source.buffer.buffer = nullptr;
+    snapshot.source.buffer.fence = nullptr;
+    return snapshot;
+}
+
 bool layerSettingsAreEqual(const LayerFE::LayerSettings& lhs, const LayerFE::LayerSettings& rhs) {
     return lhs.bufferId == rhs.bufferId && lhs.frameNumber == rhs.frameNumber &&
             equalIgnoringBuffer(lhs, rhs);
 }
 
-} // namespace
-
 ClientCompositionRequestCache::ClientCompositionRequest::ClientCompositionRequest(
-        const renderengine::DisplaySettings& initDisplay,
-        const std::vector<LayerFE::LayerSettings>& initLayerSettings)
-      : display(initDisplay) {
+        size_t initHash, const renderengine::DisplaySettings& initDisplay,
+        const std::vector<LayerFE::LayerSettings>& initLayerSettings,
+        std::weak_ptr<renderengine::ExternalTexture> initBuffer)
+      : hash(initHash), display(initDisplay), buffer(std::move(initBuffer)) {
     layerSettings.reserve(initLayerSettings.size());
     for (const LayerFE::LayerSettings& settings : initLayerSettings) {
         layerSettings.push_back(getLayerSettingsSnapshot(settings));
@@ -78,28 +125,122 @@ ClientCompositionRequestCache::ClientCompositionRequest::ClientCompositionReques
 }
 
 bool ClientCompositionRequestCache::ClientCompositionRequest::equals(
-        const renderengine::DisplaySettings& newDisplay,
+        size_t newHash, const renderengine::DisplaySettings& newDisplay,
         const std::vector<LayerFE::LayerSettings>& newLayerSettings) const {
-    return newDisplay == display &&
+    return newHash == hash && newDisplay == display &&
             std::equal(layerSettings.begin(), layerSettings.end(), newLayerSettings.begin(),
                        newLayerSettings.end(), layerSettingsAreEqual);
 }
 
+size_t ClientCompositionRequestCache::getRequestHash(
+        const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
+    // Only the fields that commonly change between frames are hashed. Requests with equal hashes
+    // are still compared field by field.
+    size_t hash = hashCombine(display.physicalDisplay, display.clip, display.outputDataspace,
+                              display.orientation, display.targetLuminanceNits);
+    for (const LayerFE::LayerSettings& settings : layerSettings) {
+        hashCombineSingle(hash, settings.bufferId);
+        hashCombineSingle(hash, settings.frameNumber);
+        hashCombineSingle(hash, settings.geometry.boundaries);
+        hashCombineSingle(hash, settings.alpha);
+        hashCombineSingle(hash, settings.source.solidColor);
+        hashCombineSingle(hash, settings.sourceDataspace);
+        hashCombineSingle(hash, settings.backgroundBlurRadius);
+        hashCombineSingle(hash, settings.disableBlending);
+    }
+    return hash;
+}
+
+ClientCompositionRequestCache::Lookup ClientCompositionRequestCache::lookup(
+        uint64_t bufferId, const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
+    Lookup lookup{.requestHash = getRequestHash(display, layerSettings)};
+    for (const auto& [cachedBufferId, cachedRequest] : mCache) {
+        if (!cachedRequest.equals(lookup.requestHash, display, layerSettings)) {
+            continue;
+        }
+        if (cachedBufferId == bufferId) {
+            lookup.result = Result::Hit;
+            lookup.otherBuffer = nullptr;
+            break;
+        }
+        if (lookup.result == Result::Miss) {
+            if (auto otherBuffer = cachedRequest.buffer.lock()) {
+                lookup.result = Result::HitOtherBuffer;
+                lookup.otherBuffer = std::move(otherBuffer);
+            }
+        }
+    }
+
+    switch (lookup.result) {
+        case Result::Hit:
+            mHitCount++;
+            break;
+        case Result::HitOtherBuffer:
+            mOtherBufferHitCount++;
+            break;
+        case Result::Miss:
+            mMissCount++;
+            break;
+    }
+    return lookup;
+}
+
 bool ClientCompositionRequestCache::exists(
         uint64_t bufferId, const renderengine::DisplaySettings& display,
         const std::vector<LayerFE::LayerSettings>& layerSettings) const {
     for (const auto& [cachedBufferId, cachedRequest] : mCache) {
         if (cachedBufferId == bufferId) {
-            return cachedRequest.equals(display, layerSettings);
+            return cachedRequest.equals(getRequestHash(display, layerSettings), display,
+                                        layerSettings);
         }
     }
     return false;
 }
 
-void ClientCompositionRequestCache::add(uint64_t bufferId,
-                                        const renderengine::DisplaySettings& display,
-                                        const std::vector<LayerFE::LayerSettings>& layerSettings) {
-    const ClientCompositionRequest request(display, layerSettings);
+std::optional<FloatRect> ClientCompositionRequestCache::getDamage(
+        uint64_t bufferId, const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) const {
+    const auto it = std::find_if(mCache.begin(), mCache.end(),
+                                 [bufferId](const auto& entry) { return entry.first == bufferId; });
+    if (it == mCache.end()) {
+        return std::nullopt;
+    }
+    const ClientCompositionRequest& cachedRequest = it->second;
+    if (cachedRequest.display != display ||
+        cachedRequest.layerSettings.size() != layerSettings.size()) {
+        return std::nullopt;
+    }
+
+    std::optional<FloatRect> damage;
+    for (size_t i = 0; i < layerSettings.size(); i++) {
+        const LayerFE::LayerSettings& cachedLayer = cachedRequest.layerSettings[i];
+        const LayerFE::LayerSettings& layer = layerSettings[i];
+        if (hasBlur(cachedLayer) || hasBlur(layer)) {
+            return std::nullopt;
+        }
+        if (layerSettingsAreEqual(cachedLayer, layer)) {
+            continue;
+        }
+        if (!drawsWithinBounds(cachedLayer) || !drawsWithinBounds(layer)) {
+            return std::nullopt;
+        }
+        unionBounds(damage, getLayerStackBounds(cachedLayer));
+        unionBounds(damage, getLayerStackBounds(layer));
+    }
+    return damage;
+}
+
+void ClientCompositionRequestCache::add(
+        const std::shared_ptr<renderengine::ExternalTexture>& buffer, size_t requestHash,
+        const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
+    add(buffer->getBuffer()->getId(),
+        ClientCompositionRequest(requestHash, display, layerSettings, buffer));
+}
+
+void ClientCompositionRequestCache::add(uint64_t bufferId, ClientCompositionRequest&& request) {
     for (auto& [cachedBufferId, cachedRequest] : mCache) {
         if (cachedBufferId == bufferId) {
             cachedRequest = std::move(request);
@@ -123,4 +264,13 @@ void ClientCompositionRequestCache::remove(uint64_t bufferId) {
     }
 }
 
+void ClientCompositionRequestCache::dump(std::string& out) const {
+    const size_t lookups = mHitCount + mOtherBufferHitCount + mMissCount;
+    base::StringAppendF(&out,
+                        "   Client composition cache: %zu/%" PRIu32 " entries, %zu hits, "
+                        "%zu hits in other buffers, %zu misses (%.2f%% hit rate)\n",
+                        mCache.size(), mMaxCacheSize, mHitCount, mOtherBufferHitCount, mMissCount,
+                        lookups ? 100.0f * (mHitCount + mOtherBufferHitCount) / lookups : 0.0f);
+}
+
 } // namespace android::compositionengine::impl
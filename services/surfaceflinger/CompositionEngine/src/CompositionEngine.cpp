@@ -25,6 +25,9 @@
 
 #include <renderengine/RenderEngine.h>
 
+#include <algorithm>
+#include <unordered_set>
+
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
@@ -130,6 +133,7 @@ void offloadOutputs(Outputs& outputs) {
 void CompositionEngine::present(CompositionRefreshArgs& args) {
     SFTRACE_CALL();
     ALOGV(__FUNCTION__);
+    const nsecs_t presentStartTime = systemTime();
 
     preComposition(args);
 
@@ -144,14 +148,16 @@ void CompositionEngine::present(CompositionRefreshArgs& args) {
         }
     }
 
-    // Offloading the HWC call for `present` allows us to simultaneously call it
-    // on multiple displays. This is desirable because these calls block and can
-    // be slow.
-    offloadOutputs(args.outputs);
-
     ui::DisplayVector<ftl::Future<std::monostate>> presentFutures;
-    for (const auto& output : args.outputs) {
-        presentFutures.push_back(output->present(args));
+    if (!args.concurrentOutputPresent || !presentOutputsConcurrently(args, presentFutures)) {
+        // Offloading the HWC call for `present` allows us to simultaneously call it
+        // on multiple displays. This is desirable because these calls block and can
+        // be slow.
+        offloadOutputs(args.outputs);
+
+        for (const auto& output : args.outputs) {
+            presentFutures.push_back(output->present(args));
+        }
     }
 
     {
@@ -163,6 +169,84 @@ void CompositionEngine::present(CompositionRefreshArgs& args) {
         }
     }
     postComposition(args);
+
+    if (mTimeStats) {
+        mTimeStats->recordStageLatency(TimeStats::LatencyStage::CompositionEnginePresent,
+                                       systemTime() - presentStartTime);
+    }
+}
+
+bool CompositionEngine::presentOutputsConcurrently(
+        CompositionRefreshArgs& args,
+        ui::DisplayVector<ftl::Future<std::monostate>>& presentFutures) {
+    if (args.outputs.size() < 2) {
+        return false;
+    }
+    // Client composition from several threads relies on RenderEngine serializing its work.
+    if (mRenderEngine && !mRenderEngine->isThreaded()) {
+        return false;
+    }
+
+    // The same rules as offloading HWC present: every enabled HWC display must support
+    // multi-threaded present, since their HWC calls will now overlap.
+    ui::PhysicalDisplayVector<compositionengine::Output*> concurrentOutputs;
+    for (const auto& output : args.outputs) {
+        if (!ftl::Optional(output->getDisplayId()).and_then(HalDisplayId::tryCast) ||
+            !output->getState().isEnabled) {
+            continue;
+        }
+        if (!output->supportsOffloadPresent()) {
+            return false;
+        }
+        concurrentOutputs.push_back(output.get());
+    }
+    if (concurrentOutputs.size() < 2) {
+        return false;
+    }
+
+    // Presenting updates the LayerFEs of the output (release fences, client composition
+    // results), so outputs that share a layer must not run at the same time. This includes the
+    // outputs left on the main thread, such as virtual displays mirroring a physical one.
+    std::unordered_set<const LayerFE*> presentedLayers;
+    for (const auto& output : args.outputs) {
+        for (const auto* outputLayer : output->getOutputLayersOrderedByZ()) {
+            if (!presentedLayers.insert(&outputLayer->getLayerFE()).second) {
+                return false;
+            }
+        }
+    }
+
+    SFTRACE_NAME("PresentOutputsConcurrently");
+    // Leave the last output on the main thread, presenting it while the others run.
+    const size_t workerCount = concurrentOutputs.size() - 1;
+    while (mPresentWorkers.size() < workerCount) {
+        mPresentWorkers.push_back(std::make_unique<HwcAsyncWorker>());
+    }
+    std::vector<std::future<bool>> workerFutures;
+    workerFutures.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++) {
+        workerFutures.push_back(mPresentWorkers[i]->send([output = concurrentOutputs[i], &args] {
+            output->present(args).get();
+            return true;
+        }));
+    }
+
+    // Outputs without HWC, such as GPU virtual displays, only depend on RenderEngine and
+    // present on the main thread as before.
+    for (const auto& output : args.outputs) {
+        if (std::find(concurrentOutputs.begin(), concurrentOutputs.end() - 1, output.get()) ==
+            concurrentOutputs.end() - 1) {
+            presentFutures.push_back(output->present(args));
+        }
+    }
+
+    {
+        SFTRACE_NAME("Waiting on concurrent present");
+        for (auto& future : workerFutures) {
+            future.get();
+        }
+    }
+    return true;
 }
 
 void CompositionEngine::updateCursorAsync(CompositionRefreshArgs& args) {
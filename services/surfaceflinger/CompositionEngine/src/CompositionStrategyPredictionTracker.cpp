@@ -0,0 +1,103 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <android-base/stringprintf.h>
+#include <common/trace.h>
+#include <compositionengine/impl/CompositionStrategyPredictionTracker.h>
+#include <ui/Fence.h>
+
+namespace android::compositionengine::impl {
+
+bool CompositionStrategyPredictionTracker::shouldPredict() {
+    if (mPausedFramesLeft == 0) {
+        return true;
+    }
+    if (--mPausedFramesLeft == 0) {
+        SFTRACE_NAME("CompositionStrategyPredictionResumed");
+        mRecentResults.clear();
+        mRecentHits = 0;
+    }
+    return false;
+}
+
+void CompositionStrategyPredictionTracker::onPredictionResult(bool hit) {
+    updatePendingCompositions();
+
+    mStats.predictions++;
+    if (hit) {
+        mStats.hits++;
+    }
+
+    if (mConfig.minHitRate <= 0.f || mConfig.windowSize == 0) {
+        return;
+    }
+
+    mRecentResults.push_back(hit);
+    mRecentHits += hit ? 1 : 0;
+    if (mRecentResults.size() > mConfig.windowSize) {
+        mRecentHits -= mRecentResults.front() ? 1 : 0;
+        mRecentResults.pop_front();
+    }
+
+    if (mRecentResults.size() < mConfig.windowSize || mConfig.pausedFrames == 0) {
+        return;
+    }
+    const float recentHitRate =
+            static_cast<float>(mRecentHits) / static_cast<float>(mConfig.windowSize);
+    if (recentHitRate < mConfig.minHitRate) {
+        SFTRACE_NAME("CompositionStrategyPredictionPaused");
+        mPausedFramesLeft = mConfig.pausedFrames;
+        mStats.pauses++;
+    }
+}
+
+void CompositionStrategyPredictionTracker::onMispredictedComposition(
+        nsecs_t startTime, std::shared_ptr<FenceTime> fence) {
+    updatePendingCompositions();
+    if (mPendingCompositions.size() == kMaxPendingCompositions) {
+        mPendingCompositions.erase(mPendingCompositions.begin());
+    }
+    mPendingCompositions.push_back({startTime, std::move(fence)});
+    updatePendingCompositions();
+}
+
+void CompositionStrategyPredictionTracker::updatePendingCompositions() {
+    std::erase_if(mPendingCompositions, [this](const PendingComposition& composition) {
+        const nsecs_t signalTime = composition.fence->getSignalTime();
+        if (signalTime == Fence::SIGNAL_TIME_PENDING) {
+            return false;
+        }
+        if (signalTime != Fence::SIGNAL_TIME_INVALID) {
+            mStats.wastedCompositionTime +=
+                    std::max(signalTime - composition.startTime, nsecs_t{0});
+        }
+        return true;
+    });
+}
+
+void CompositionStrategyPredictionTracker::dump(std::string& out) const {
+    base::StringAppendF(&out,
+                        "   Composition strategy prediction: %zu predictions, %zu hits "
+                        "(%.2f%% hit rate), %.3fms wasted on misses, paused %zu times%s\n",
+                        mStats.predictions, mStats.hits,
+                        mStats.predictions ? 100.0f * mStats.hits / mStats.predictions : 0.0f,
+                        static_cast<double>(mStats.wastedCompositionTime) / 1e6, mStats.pauses,
+                        isPaused() ? " (paused now)" : "");
+}
+
+} // namespace android::compositionengine::impl
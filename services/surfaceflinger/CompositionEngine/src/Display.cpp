@@ -259,11 +259,20 @@ bool Display::chooseCompositionStrategy(
         result != NO_ERROR) {
         ALOGE("chooseCompositionStrategy failed for %s: %d (%s)", getName().c_str(), result,
               strerror(-result));
+        // The layer commands of this frame may not have been applied.
+        for (auto* layer : getOutputLayersOrderedByZ()) {
+            layer->forceResendStateToHWC();
+        }
         return false;
     }
 
+    const TimePoint hwcValidateEndTime = TimePoint::now();
+    if (auto timeStats = getCompositionEngine().getTimeStats()) {
+        timeStats->recordStageLatency(TimeStats::LatencyStage::HwcValidate,
+                                      hwcValidateEndTime.ns() - hwcValidateStartTime.ns());
+    }
     if (isPowerHintSessionEnabled()) {
-        mPowerAdvisor->setHwcValidateTiming(mId, hwcValidateStartTime, TimePoint::now());
+        mPowerAdvisor->setHwcValidateTiming(mId, hwcValidateStartTime, hwcValidateEndTime);
         if (auto halDisplayId = HalDisplayId::tryCast(mId)) {
             mPowerAdvisor->setSkippedValidate(mId, hwc.getValidateSkipped(*halDisplayId));
         }
@@ -386,8 +395,13 @@ compositionengine::Output::FrameFences Display::presentFrame() {
 
     hwc.presentAndGetReleaseFences(*halDisplayIdOpt, getState().earliestPresentTime);
 
+    const TimePoint endTime = TimePoint::now();
+    if (auto timeStats = getCompositionEngine().getTimeStats()) {
+        timeStats->recordStageLatency(TimeStats::LatencyStage::HwcPresent,
+                                      endTime.ns() - startTime.ns());
+    }
     if (isPowerHintSessionEnabled()) {
-        mPowerAdvisor->setHwcPresentTiming(mId, startTime, TimePoint::now());
+        mPowerAdvisor->setHwcPresentTiming(mId, startTime, endTime);
     }
 
     fences.presentFence = hwc.getPresentFence(*halDisplayIdOpt);
@@ -43,6 +43,10 @@ void dumpVal(std::string& out, const char* name, uint32_t value) {
     StringAppendF(&out, "%s=%u ", name, value);
 }
 
+void dumpVal(std::string& out, const char* name, uint64_t value) {
+    StringAppendF(&out, "%s=%" PRIu64 " ", name, value);
+}
+
 void dumpHex(std::string& out, const char* name, uint64_t value) {
     StringAppendF(&out, "%s=0x08%" PRIx64 " ", name, value);
 }
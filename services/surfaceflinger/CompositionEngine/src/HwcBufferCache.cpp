@@ -21,7 +21,7 @@
 
 namespace android::compositionengine::impl {
 
-HwcBufferCache::HwcBufferCache() {
+HwcBufferCache::HwcBufferCache() : mLeastRecentlyUsedCounter(0) {
     for (uint32_t i = kMaxLayerBufferCount; i-- > 0;) {
         mFreeSlots.push(i);
     }
@@ -32,8 +32,11 @@ HwcSlotAndBuffer HwcBufferCache::getHwcSlotAndBuffer(const sp<GraphicBuffer>& bu
         Cache& cache = i->second;
         // mark this cache slot as more recently used so it won't get evicted anytime soon
         cache.lruCounter = mLeastRecentlyUsedCounter++;
+        cache.reuseCount++;
+        mStats.hits++;
         return {cache.slot, nullptr};
     }
+    mStats.misses++;
     return {cache(buffer), buffer};
 }
 
@@ -59,6 +62,25 @@ uint32_t HwcBufferCache::uncache(uint64_t bufferId) {
     return UINT32_MAX;
 }
 
+std::vector<uint32_t> HwcBufferCache::uncache(const std::vector<uint64_t>& bufferIds,
+                                              uint64_t activeBufferId) {
+    std::vector<uint32_t> slots;
+    bool uncacheActiveBuffer = false;
+    for (uint64_t bufferId : bufferIds) {
+        if (bufferId == activeBufferId) {
+            uncacheActiveBuffer = true;
+        } else if (uint32_t slot = uncache(bufferId); slot != UINT32_MAX) {
+            slots.push_back(slot);
+        }
+    }
+    if (uncacheActiveBuffer) {
+        if (uint32_t slot = uncache(activeBufferId); slot != UINT32_MAX) {
+            slots.push_back(slot);
+        }
+    }
+    return slots;
+}
+
 uint32_t HwcBufferCache::cache(const sp<GraphicBuffer>& buffer) {
     Cache cache;
     cache.slot = getLeastRecentlyUsedSlot();
@@ -71,16 +93,33 @@ uint32_t HwcBufferCache::cache(const sp<GraphicBuffer>& buffer) {
 uint32_t HwcBufferCache::getLeastRecentlyUsedSlot() {
     if (mFreeSlots.empty()) {
         assert(!mCacheByBufferId.empty());
-        // evict the least recently used cache entry
-        auto cacheToErase = mCacheByBufferId.begin();
-        for (auto i = cacheToErase; i != mCacheByBufferId.end(); ++i) {
-            if (i->second.lruCounter < cacheToErase->second.lruCounter) {
+        // Evict the least recently used entry among those that are unlikely to be sent again:
+        // buffers that were never reused, and buffers that haven't been used for longer than it
+        // takes to cycle through all the slots. Only if every buffer is in active reuse, evict the
+        // least recently used one.
+        const auto isReused = [this](const Cache& cache) {
+            return cache.reuseCount > 0 &&
+                    mLeastRecentlyUsedCounter - cache.lruCounter <= kMaxLayerBufferCount;
+        };
+        auto cacheToErase = mCacheByBufferId.end();
+        auto leastRecentlyUsed = mCacheByBufferId.begin();
+        for (auto i = mCacheByBufferId.begin(); i != mCacheByBufferId.end(); ++i) {
+            if (i->second.lruCounter < leastRecentlyUsed->second.lruCounter) {
+                leastRecentlyUsed = i;
+            }
+            if (!isReused(i->second) &&
+                (cacheToErase == mCacheByBufferId.end() ||
+                 i->second.lruCounter < cacheToErase->second.lruCounter)) {
                 cacheToErase = i;
             }
         }
+        if (cacheToErase == mCacheByBufferId.end()) {
+            cacheToErase = leastRecentlyUsed;
+        }
         uint32_t slot = cacheToErase->second.slot;
         mCacheByBufferId.erase(cacheToErase);
         mFreeSlots.push(slot);
+        mStats.evictions++;
     }
     uint32_t slot = mFreeSlots.top();
     mFreeSlots.pop();
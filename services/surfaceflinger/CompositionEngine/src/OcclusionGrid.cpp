@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/OcclusionGrid.h>
+
+namespace android::compositionengine {
+
+namespace {
+
+int32_t divideRoundingUp(int32_t value, int32_t divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+} // namespace
+
+OcclusionGrid::OcclusionGrid(const Rect& bounds) : mBounds(bounds) {
+    if (!mBounds.isValid() || mBounds.isEmpty()) {
+        return;
+    }
+    mTileWidth = divideRoundingUp(mBounds.getWidth(), kMaxTilesPerSide);
+    mTileHeight = divideRoundingUp(mBounds.getHeight(), kMaxTilesPerSide);
+    mColumns = divideRoundingUp(mBounds.getWidth(), mTileWidth);
+    mRows = divideRoundingUp(mBounds.getHeight(), mTileHeight);
+}
+
+OcclusionGrid::RowMask OcclusionGrid::columnMask(int32_t begin, int32_t end) {
+    const int32_t count = end - begin;
+    const RowMask bits = count >= kMaxTilesPerSide ? ~RowMask{0} : (RowMask{1} << count) - 1;
+    return bits << begin;
+}
+
+void OcclusionGrid::addOpaqueRect(const Rect& rect) {
+    Rect clipped;
+    if (mColumns == 0 || !rect.intersect(mBounds, &clipped)) {
+        return;
+    }
+
+    // Only the tiles that lie entirely within the rect. The last column and row may be narrower
+    // than the others, and are only covered by a rect that reaches the edge of the bounds.
+    const int32_t columnBegin = divideRoundingUp(clipped.left - mBounds.left, mTileWidth);
+    const int32_t columnEnd = clipped.right == mBounds.right
+            ? mColumns
+            : (clipped.right - mBounds.left) / mTileWidth;
+    const int32_t rowBegin = divideRoundingUp(clipped.top - mBounds.top, mTileHeight);
+    const int32_t rowEnd = clipped.bottom == mBounds.bottom
+            ? mRows
+            : (clipped.bottom - mBounds.top) / mTileHeight;
+    if (columnBegin >= columnEnd || rowBegin >= rowEnd) {
+        return;
+    }
+
+    const RowMask mask = columnMask(columnBegin, columnEnd);
+    for (int32_t row = rowBegin; row < rowEnd; row++) {
+        mCoveredTiles[row] |= mask;
+    }
+}
+
+bool OcclusionGrid::isOccluded(const Rect& rect) const {
+    if (mColumns == 0 || rect.isEmpty() || rect.left < mBounds.left || rect.top < mBounds.top ||
+        rect.right > mBounds.right || rect.bottom > mBounds.bottom) {
+        return false;
+    }
+
+    // Every tile the rect touches must be covered.
+    const int32_t columnBegin = (rect.left - mBounds.left) / mTileWidth;
+    const int32_t columnEnd = (rect.right - 1 - mBounds.left) / mTileWidth + 1;
+    const int32_t rowBegin = (rect.top - mBounds.top) / mTileHeight;
+    const int32_t rowEnd = (rect.bottom - 1 - mBounds.top) / mTileHeight + 1;
+
+    const RowMask mask = columnMask(columnBegin, columnEnd);
+    for (int32_t row = rowBegin; row < rowEnd; row++) {
+        if ((mCoveredTiles[row] & mask) != mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace android::compositionengine
@@ -36,6 +36,8 @@
 #include <scheduler/FrameTargeter.h>
 #include <scheduler/Time.h>
 
+#include <algorithm>
+#include <cmath>
 #include <optional>
 #include <thread>
 
@@ -68,6 +70,10 @@ using CompositionStrategyPredictionState =
         OutputCompositionState::CompositionStrategyPredictionState;
 namespace {
 
+// Below this many layers, the Region math for occluded layers is cheaper than maintaining an
+// OcclusionGrid.
+constexpr size_t kMinLayersForOcclusionGrid = 32;
+
 template <typename T>
 class Reversed {
 public:
@@ -98,6 +104,21 @@ ScaleVector getScale(const Rect& from, const Rect& to) {
             .y = static_cast<float>(to.height()) / from.height()};
 }
 
+// Builds a request that copies all of source into target unchanged, to reuse a client composition
+// result that was rendered into another buffer.
+renderengine::LayerSettings makeBufferCopyLayer(
+        const std::shared_ptr<renderengine::ExternalTexture>& source, ui::Dataspace dataspace) {
+    renderengine::LayerSettings layer;
+    layer.geometry.boundaries = source->getBuffer()->getBounds().toFloatRect();
+    layer.source.buffer.buffer = source;
+    layer.source.buffer.usePremultipliedAlpha = true;
+    layer.sourceDataspace = dataspace;
+    layer.alpha = 1.f;
+    layer.disableBlending = true;
+    layer.name = "client composition copy";
+    return layer;
+}
+
 } // namespace
 
 std::shared_ptr<Output> createOutput(
@@ -322,6 +343,16 @@ void Output::dumpBase(std::string& out) const {
         out.append("    No render surface!\n");
     }
 
+    if (mPredictCompositionStrategy) {
+        out += '\n';
+        mPredictionTracker.dump(out);
+    }
+
+    if (mClientCompositionRequestCache) {
+        out += '\n';
+        mClientCompositionRequestCache->dump(out);
+    }
+
     base::StringAppendF(&out, "\n   %zu Layers\n", getOutputLayerCount());
     for (const auto* outputLayer : getOutputLayersOrderedByZ()) {
         if (!outputLayer) {
@@ -376,9 +407,97 @@ void Output::cacheClientCompositionRequests(uint32_t cacheSize) {
         mClientCompositionRequestCache.reset();
     } else {
         mClientCompositionRequestCache = std::make_unique<ClientCompositionRequestCache>(cacheSize);
+        mReuseClientCompositionAcrossBuffers =
+                base::GetBoolProperty("debug.sf.reuse_client_composition_across_buffers", false);
+        mPartialClientComposition =
+                base::GetBoolProperty("debug.sf.partial_client_composition", false);
+    }
+
+    mShareClientCompositionWithMirrors =
+            base::GetBoolProperty("debug.sf.share_mirror_client_composition", false);
+    if (mShareClientCompositionWithMirrors) {
+        mMirroredClientComposition = std::make_unique<ClientCompositionRequestCache>(1u);
+    } else {
+        mMirroredClientComposition.reset();
+    }
+
+    if (base::GetBoolProperty("debug.sf.cache_blur_backdrops", false)) {
+        mBlurBackdropTracker = std::make_unique<BlurBackdropTracker>();
+    } else {
+        mBlurBackdropTracker.reset();
     }
 };
 
+std::shared_ptr<renderengine::ExternalTexture> Output::findClientCompositionForMirror(
+        nsecs_t refreshStartTime, const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
+    // A result from an earlier frame may have been overwritten since.
+    if (!mMirroredClientComposition || mMirroredClientCompositionFrame != refreshStartTime) {
+        return nullptr;
+    }
+    // The caller renders into its own buffer, so a match is always in another buffer.
+    auto lookup = mMirroredClientComposition->lookup(/*bufferId*/ 0, display, layerSettings);
+    return std::move(lookup.otherBuffer);
+}
+
+void Output::updateMirrorSources(const compositionengine::CompositionRefreshArgs& refreshArgs) {
+    mRefreshStartTime = refreshArgs.refreshStartTime;
+    mMirrorSources.clear();
+    if (!mShareClientCompositionWithMirrors) {
+        return;
+    }
+    // Outputs that share layers present one after the other, in order, so only the outputs before
+    // this one can have composed the current frame already.
+    const auto layerStack = getState().layerFilter.layerStack;
+    for (const auto& output : refreshArgs.outputs) {
+        if (output.get() == this) {
+            break;
+        }
+        if (output->getState().isEnabled && output->getState().layerFilter.layerStack == layerStack) {
+            mMirrorSources.push_back(output.get());
+        }
+    }
+}
+
+std::shared_ptr<renderengine::ExternalTexture> Output::findMirrorSourceClientComposition(
+        const std::shared_ptr<renderengine::ExternalTexture>& target,
+        const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
+    if (mMirrorSources.empty()) {
+        return nullptr;
+    }
+    renderengine::DisplaySettings unnamedDisplay = display;
+    unnamedDisplay.namePlusId.clear();
+    for (auto* source : mMirrorSources) {
+        auto buffer =
+                source->findClientCompositionForMirror(mRefreshStartTime, unnamedDisplay,
+                                                       layerSettings);
+        // The copy is drawn at the size of the source buffer, and protected content can't be
+        // copied into an unprotected buffer.
+        if (buffer && buffer->getBuffer()->getBounds() == target->getBuffer()->getBounds() &&
+            (buffer->getUsage() & GRALLOC_USAGE_PROTECTED) == 0) {
+            return buffer;
+        }
+    }
+    return nullptr;
+}
+
+void Output::recordClientCompositionForMirrors(
+        const std::shared_ptr<renderengine::ExternalTexture>& buffer,
+        const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
+    if (!mMirroredClientComposition) {
+        return;
+    }
+    renderengine::DisplaySettings unnamedDisplay = display;
+    unnamedDisplay.namePlusId.clear();
+    mMirroredClientComposition->add(buffer,
+                                    ClientCompositionRequestCache::getRequestHash(unnamedDisplay,
+                                                                                  layerSettings),
+                                    unnamedDisplay, layerSettings);
+    mMirroredClientCompositionFrame = mRefreshStartTime;
+}
+
 void Output::setRenderSurfaceForTest(std::unique_ptr<compositionengine::RenderSurface> surface) {
     mRenderSurface = std::move(surface);
 }
@@ -457,6 +576,7 @@ ftl::Future<std::monostate> Output::present(
                    stringifyExpectedPresentTime().c_str());
     ALOGV(__FUNCTION__);
 
+    updateMirrorSources(refreshArgs);
     updateColorProfile(refreshArgs);
     updateCompositionState(refreshArgs);
     planComposition();
@@ -526,6 +646,9 @@ void Output::rebuildLayerStacks(const compositionengine::CompositionRefreshArgs&
     coverage.aboveCoveredLayersExcludingOverlays = refreshArgs.hasTrustedPresentationListener
             ? std::make_optional<Region>()
             : std::nullopt;
+    if (refreshArgs.layers.size() >= kMinLayersForOcclusionGrid) {
+        coverage.occlusionGrid.emplace(outputState.layerStackSpace.getContent());
+    }
     collectVisibleLayers(refreshArgs, coverage);
 
     // Compute the resulting coverage for this output, and store it for later
@@ -651,6 +774,14 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
         return;
     }
 
+    // A layer under opaque layers only contributes to the regions that track coverage
+    // excluding overlays, and those would need the exact computation.
+    if (coverage.occlusionGrid && !computeAboveCoveredExcludingOverlays &&
+        coverage.occlusionGrid->isOccluded(visibleRegion.getBounds())) {
+        editState().occlusionCulledLayers++;
+        return;
+    }
+
     // Remove the transparent area from the visible region
     if (!layerFEState->isOpaque) {
         if (tr.preserveRects()) {
@@ -760,6 +891,9 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
 
     // Update accumAboveOpaqueLayers for next (lower) layer
     coverage.aboveOpaqueLayers.orSelf(opaqueRegion);
+    if (coverage.occlusionGrid && !opaqueRegion.isEmpty()) {
+        coverage.occlusionGrid->addOpaqueRect(opaqueRegion.getBounds());
+    }
 
     // Compute the visible non-transparent region
     Region visibleNonTransparentRegion = visibleRegion.subtract(transparentRegion);
@@ -1146,6 +1280,7 @@ GpuCompositionResult Output::prepareFrameAsync() {
     updateProtectedContentState();
     const bool dequeueSucceeded = dequeueRenderBuffer(&bufferFence, &buffer);
     GpuCompositionResult compositionResult;
+    const nsecs_t compositionStartTime = systemTime();
     if (dequeueSucceeded) {
         std::optional<base::unique_fd> optFd =
                 composeSurfaces(Region::INVALID_REGION, buffer, bufferFence);
@@ -1158,8 +1293,15 @@ GpuCompositionResult Output::prepareFrameAsync() {
     const bool predictionSucceeded = dequeueSucceeded && changes == previousChanges;
     state.strategyPrediction = predictionSucceeded ? CompositionStrategyPredictionState::SUCCESS
                                                    : CompositionStrategyPredictionState::FAIL;
+    mPredictionTracker.onPredictionResult(predictionSucceeded);
     if (!predictionSucceeded) {
         SFTRACE_NAME("CompositionStrategyPredictionMiss");
+        if (compositionResult.fence.ok()) {
+            mPredictionTracker.onMispredictedComposition(
+                    compositionStartTime,
+                    std::make_shared<FenceTime>(
+                            sp<Fence>::make(dup(compositionResult.fence.get()))));
+        }
         resetCompositionStrategy();
         if (chooseCompositionSuccess) {
             applyCompositionStrategy(changes);
@@ -1325,27 +1467,52 @@ std::optional<base::unique_fd> Output::composeSurfaces(
 
     OutputCompositionState& outputCompositionState = editState();
     // Check if the client composition requests were rendered into the provided graphic buffer. If
-    // so, we can reuse the buffer and avoid client composition.
+    // so, we can reuse the buffer and avoid client composition. If they were rendered into another
+    // buffer, that buffer may be copied instead of drawing every layer again.
+    std::shared_ptr<renderengine::ExternalTexture> copySource;
+    std::optional<FloatRect> damage;
     if (mClientCompositionRequestCache) {
-        if (mClientCompositionRequestCache->exists(tex->getBuffer()->getId(),
-                                                   clientCompositionDisplay,
-                                                   clientCompositionLayers)) {
+        auto lookup = mClientCompositionRequestCache->lookup(tex->getBuffer()->getId(),
+                                                             clientCompositionDisplay,
+                                                             clientCompositionLayers);
+        if (lookup.result == ClientCompositionRequestCache::Result::Hit) {
             SFTRACE_NAME("ClientCompositionCacheHit");
             outputCompositionState.reusedClientComposition = true;
             setExpensiveRenderingExpected(false);
+            recordClientCompositionForMirrors(tex, clientCompositionDisplay,
+                                              clientCompositionLayers);
             // b/239944175 pass the fence associated with the buffer.
             return base::unique_fd(std::move(fd));
         }
-        SFTRACE_NAME("ClientCompositionCacheMiss");
-        mClientCompositionRequestCache->add(tex->getBuffer()->getId(), clientCompositionDisplay,
+        if (mReuseClientCompositionAcrossBuffers && lookup.otherBuffer) {
+            SFTRACE_NAME("ClientCompositionCacheHitOtherBuffer");
+            copySource = std::move(lookup.otherBuffer);
+        } else {
+            SFTRACE_NAME("ClientCompositionCacheMiss");
+            if (mPartialClientComposition) {
+                damage = mClientCompositionRequestCache->getDamage(tex->getBuffer()->getId(),
+                                                                   clientCompositionDisplay,
+                                                                   clientCompositionLayers);
+            }
+        }
+        mClientCompositionRequestCache->add(tex, lookup.requestHash, clientCompositionDisplay,
                                             clientCompositionLayers);
     }
+    if (!copySource) {
+        // RenderEngine runs its work in order, so the source's composition of this frame has
+        // finished by the time the copy samples it.
+        copySource = findMirrorSourceClientComposition(tex, clientCompositionDisplay,
+                                                       clientCompositionLayers);
+        if (copySource) {
+            SFTRACE_NAME("ClientCompositionCopiedFromMirrorSource");
+        }
+    }
 
     // We boost GPU frequency here because there will be color spaces conversion
     // or complex GPU shaders and it's expensive. We boost the GPU frequency so that
     // GPU composition can finish in time. We must reset GPU frequency afterwards,
     // because high frequency consumes extra battery.
-    const bool expensiveRenderingExpected =
+    const bool expensiveRenderingExpected = !copySource &&
             std::any_of(clientCompositionLayers.begin(), clientCompositionLayers.end(),
                         [outputDataspace =
                                  clientCompositionDisplay.outputDataspace](const auto& layer) {
@@ -1356,24 +1523,60 @@ std::optional<base::unique_fd> Output::composeSurfaces(
         setExpensiveRenderingExpected(true);
     }
 
+    if (mBlurBackdropTracker && !copySource) {
+        mBlurBackdropTracker->assignIds(clientCompositionDisplay, clientCompositionLayers);
+    }
+
     std::vector<renderengine::LayerSettings> clientRenderEngineLayers;
-    clientRenderEngineLayers.reserve(clientCompositionLayers.size());
-    std::transform(clientCompositionLayers.begin(), clientCompositionLayers.end(),
-                   std::back_inserter(clientRenderEngineLayers),
-                   [](LayerFE::LayerSettings& settings) -> renderengine::LayerSettings {
-                       return settings;
-                   });
+    if (copySource) {
+        clientRenderEngineLayers.push_back(
+                makeBufferCopyLayer(copySource, clientCompositionDisplay.outputDataspace));
+    } else {
+        clientRenderEngineLayers.reserve(clientCompositionLayers.size());
+        std::transform(clientCompositionLayers.begin(), clientCompositionLayers.end(),
+                       std::back_inserter(clientRenderEngineLayers),
+                       [](LayerFE::LayerSettings& settings) -> renderengine::LayerSettings {
+                           return settings;
+                       });
+    }
+
+    // The copy is drawn in buffer space, without any of the output's transforms.
+    renderengine::DisplaySettings renderEngineDisplay = copySource
+            ? renderengine::DisplaySettings{.namePlusId = clientCompositionDisplay.namePlusId,
+                                            .physicalDisplay = tex->getBuffer()->getBounds(),
+                                            .clip = tex->getBuffer()->getBounds(),
+                                            .outputDataspace =
+                                                    clientCompositionDisplay.outputDataspace}
+            : clientCompositionDisplay;
+    if (damage && !copySource) {
+        // Round out, so that pixels the changed layers partially cover are redrawn too.
+        const FloatRect bufferDamage =
+                outputState.layerStackSpace.getTransform(outputState.framebufferSpace)
+                        .transform(*damage);
+        const Rect damageRect(static_cast<int32_t>(std::floor(bufferDamage.left)),
+                              static_cast<int32_t>(std::floor(bufferDamage.top)),
+                              static_cast<int32_t>(std::ceil(bufferDamage.right)),
+                              static_cast<int32_t>(std::ceil(bufferDamage.bottom)));
+        damageRect.intersect(tex->getBuffer()->getBounds(), &renderEngineDisplay.damage);
+        SFTRACE_NAME("ClientCompositionPartialRedraw");
+    }
 
     const nsecs_t renderEngineStart = systemTime();
     auto fenceResult = renderEngine
-                               .drawLayers(clientCompositionDisplay, clientRenderEngineLayers, tex,
+                               .drawLayers(renderEngineDisplay, clientRenderEngineLayers, tex,
                                            std::move(fd))
                                .get();
+    const nsecs_t renderEngineEnd = systemTime();
 
     if (mClientCompositionRequestCache && fenceStatus(fenceResult) != NO_ERROR) {
         // If rendering was not successful, remove the request from the cache.
         mClientCompositionRequestCache->remove(tex->getBuffer()->getId());
     }
+    if (fenceStatus(fenceResult) == NO_ERROR) {
+        recordClientCompositionForMirrors(tex, clientCompositionDisplay, clientCompositionLayers);
+    } else if (mMirroredClientComposition) {
+        mMirroredClientComposition->remove(tex->getBuffer()->getId());
+    }
     const auto fence = std::move(fenceResult).value_or(Fence::NO_FENCE);
     if (isPowerHintSessionEnabled()) {
         if (fence != Fence::NO_FENCE && fence->isValid() &&
@@ -1390,6 +1593,8 @@ std::optional<base::unique_fd> Output::composeSurfaces(
     }
 
     if (auto timeStats = getCompositionEngine().getTimeStats()) {
+        timeStats->recordStageLatency(TimeStats::LatencyStage::RenderEngine,
+                                      renderEngineEnd - renderEngineStart);
         if (fence->isValid()) {
             timeStats->recordRenderEngineDuration(renderEngineStart,
                                                   std::make_shared<FenceTime>(fence));
@@ -1687,6 +1892,12 @@ compositionengine::Output::FrameFences Output::presentFrame() {
 
 void Output::setPredictCompositionStrategy(bool predict) {
     mPredictCompositionStrategy = predict;
+    if (predict) {
+        const int minHitRatePercent =
+                base::GetIntProperty("debug.sf.prediction_min_hit_rate_percent", 0);
+        mPredictionTracker.setConfig(
+                {.minHitRate = static_cast<float>(std::clamp(minHitRatePercent, 0, 100)) / 100.f});
+    }
     updateHwcAsyncWorker();
 }
 
@@ -1741,6 +1952,11 @@ bool Output::canPredictCompositionStrategy(const CompositionRefreshArgs& refresh
         return false;
     }
 
+    if (!mPredictionTracker.shouldPredict()) {
+        ALOGV("canPredictCompositionStrategy paused after mispredictions");
+        return false;
+    }
+
     return true;
 }
 
@@ -67,6 +67,7 @@ void OutputCompositionState::dump(std::string& out) const {
 
     out.append("\n   ");
     dumpVal(out, "treat170mAsSrgb", treat170mAsSrgb);
+    dumpVal(out, "occlusionCulledLayers", occlusionCulledLayers);
     out.append("\n");
 }
 
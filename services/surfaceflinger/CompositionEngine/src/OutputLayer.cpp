@@ -55,6 +55,32 @@ FloatRect reduce(const FloatRect& win, const Region& exclude) {
     return Region(Rect{win}).subtract(exclude).getBounds().toFloatRect();
 }
 
+template <typename T>
+bool isSameAsSent(const T& sent, const T& value) {
+    return sent == value;
+}
+
+bool isSameAsSent(const Region& sent, const Region& value) {
+    return sent.hasSameRects(value);
+}
+
+// Calls |setter| with |value| unless it is what the HWC layer already has. The value is only
+// remembered once the HWC accepts it, so that a failed call is made again on the next frame.
+template <typename T, typename Arg>
+hal::Error setIfChanged(HWC2::Layer* hwcLayer, hal::Error (HWC2::Layer::*setter)(Arg),
+                        std::optional<T>& sent, const T& value) {
+    if (sent && isSameAsSent(*sent, value)) {
+        return hal::Error::NONE;
+    }
+    const hal::Error error = (hwcLayer->*setter)(value);
+    if (error == hal::Error::NONE) {
+        sent = value;
+    } else {
+        sent.reset();
+    }
+    return error;
+}
+
 } // namespace
 
 std::unique_ptr<OutputLayer> createOutputLayer(const compositionengine::Output& output,
@@ -428,30 +454,38 @@ void OutputLayer::writeOutputDependentGeometryStateToHWC(HWC2::Layer* hwcLayer,
                                                          Composition requestedCompositionType,
                                                          uint32_t z) {
     const auto& outputDependentState = getState();
+    auto& sentState = editState().hwc->sentState;
 
     Rect displayFrame = outputDependentState.displayFrame;
     FloatRect sourceCrop = outputDependentState.sourceCrop;
 
     if (outputDependentState.overrideInfo.buffer != nullptr) {
         displayFrame = outputDependentState.overrideInfo.displayFrame;
-        sourceCrop =
-                FloatRect(0.f, 0.f,
-                          static_cast<float>(outputDependentState.overrideInfo.buffer->getBuffer()
-                                                     ->getWidth()),
-                          static_cast<float>(outputDependentState.overrideInfo.buffer->getBuffer()
-                                                     ->getHeight()));
+        sourceCrop = outputDependentState.overrideInfo.sourceCrop.isEmpty()
+                ? FloatRect(0.f, 0.f,
+                            static_cast<float>(
+                                    outputDependentState.overrideInfo.buffer->getBuffer()
+                                            ->getWidth()),
+                            static_cast<float>(
+                                    outputDependentState.overrideInfo.buffer->getBuffer()
+                                            ->getHeight()))
+                : outputDependentState.overrideInfo.sourceCrop.toFloatRect();
     }
 
     ALOGV("Writing display frame [%d, %d, %d, %d]", displayFrame.left, displayFrame.top,
           displayFrame.right, displayFrame.bottom);
 
-    if (auto error = hwcLayer->setDisplayFrame(displayFrame); error != hal::Error::NONE) {
+    if (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setDisplayFrame,
+                                  sentState.displayFrame, displayFrame);
+        error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set display frame [%d, %d, %d, %d]: %s (%d)",
               getLayerFE().getDebugName(), displayFrame.left, displayFrame.top, displayFrame.right,
               displayFrame.bottom, to_string(error).c_str(), static_cast<int32_t>(error));
     }
 
-    if (auto error = hwcLayer->setSourceCrop(sourceCrop); error != hal::Error::NONE) {
+    if (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setSourceCrop, sentState.sourceCrop,
+                                  sourceCrop);
+        error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set source crop [%.3f, %.3f, %.3f, %.3f]: "
               "%s (%d)",
               getLayerFE().getDebugName(), sourceCrop.left, sourceCrop.top, sourceCrop.right,
@@ -471,7 +505,8 @@ void OutputLayer::writeOutputDependentGeometryStateToHWC(HWC2::Layer* hwcLayer,
         z_udfps = getUdfpsZOrder(z, true);
     }
 
-    if (auto error = hwcLayer->setZOrder(z_udfps); error != hal::Error::NONE) {
+    if (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setZOrder, sentState.z, z_udfps);
+        error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set Z %u: %s (%d)", getLayerFE().getDebugName(), z,
               to_string(error).c_str(), static_cast<int32_t>(error));
     }
@@ -481,7 +516,8 @@ void OutputLayer::writeOutputDependentGeometryStateToHWC(HWC2::Layer* hwcLayer,
                                   getState().overrideInfo.buffer == nullptr)
             ? outputDependentState.bufferTransform
             : static_cast<hal::Transform>(0);
-    if (auto error = hwcLayer->setTransform(static_cast<hal::Transform>(bufferTransform));
+    if (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setTransform, sentState.transform,
+                                  static_cast<hal::Transform>(bufferTransform));
         error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set transform %s: %s (%d)", getLayerFE().getDebugName(),
               toString(outputDependentState.bufferTransform).c_str(), to_string(error).c_str(),
@@ -495,10 +531,13 @@ void OutputLayer::writeOutputIndependentGeometryStateToHWC(
     // If there is a peekThroughLayer, then this layer has a hole in it. We need to use
     // PREMULTIPLIED so it will peek through.
     const auto& overrideInfo = getState().overrideInfo;
+    auto& sentState = editState().hwc->sentState;
     const auto blendMode = overrideInfo.buffer || overrideInfo.peekThroughLayer
             ? hardware::graphics::composer::hal::BlendMode::PREMULTIPLIED
             : outputIndependentState.blendMode;
-    if (auto error = hwcLayer->setBlendMode(blendMode); error != hal::Error::NONE) {
+    if (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setBlendMode, sentState.blendMode,
+                                  blendMode);
+        error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set blend mode %s: %s (%d)", getLayerFE().getDebugName(),
               toString(blendMode).c_str(), to_string(error).c_str(), static_cast<int32_t>(error));
     }
@@ -508,7 +547,9 @@ void OutputLayer::writeOutputIndependentGeometryStateToHWC(
             : (getState().overrideInfo.buffer ? 1.0f : outputIndependentState.alpha);
     ALOGV("Writing alpha %f", alpha);
 
-    if (auto error = hwcLayer->setPlaneAlpha(alpha); error != hal::Error::NONE) {
+    if (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setPlaneAlpha, sentState.planeAlpha,
+                                  alpha);
+        error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set plane alpha %.3f: %s (%d)", getLayerFE().getDebugName(), alpha,
               to_string(error).c_str(), static_cast<int32_t>(error));
     }
@@ -524,20 +565,24 @@ void OutputLayer::writeOutputIndependentGeometryStateToHWC(
 
 void OutputLayer::writeOutputDependentPerFrameStateToHWC(HWC2::Layer* hwcLayer) {
     const auto& outputDependentState = getState();
+    auto& sentState = editState().hwc->sentState;
 
     // TODO(lpique): b/121291683 outputSpaceVisibleRegion is output-dependent geometry
     // state and should not change every frame.
     Region visibleRegion = outputDependentState.overrideInfo.buffer
             ? Region(outputDependentState.overrideInfo.visibleRegion)
             : outputDependentState.outputSpaceVisibleRegion;
-    if (auto error = hwcLayer->setVisibleRegion(visibleRegion); error != hal::Error::NONE) {
+    if (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setVisibleRegion,
+                                  sentState.visibleRegion, visibleRegion);
+        error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set visible region: %s (%d)", getLayerFE().getDebugName(),
               to_string(error).c_str(), static_cast<int32_t>(error));
         visibleRegion.dump(LOG_TAG);
     }
 
-    if (auto error =
-                hwcLayer->setBlockingRegion(outputDependentState.outputSpaceBlockingRegionHint);
+    if (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setBlockingRegion,
+                                  sentState.blockingRegion,
+                                  outputDependentState.outputSpaceBlockingRegionHint);
         error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set blocking region: %s (%d)", getLayerFE().getDebugName(),
               to_string(error).c_str(), static_cast<int32_t>(error));
@@ -548,7 +593,9 @@ void OutputLayer::writeOutputDependentPerFrameStateToHWC(HWC2::Layer* hwcLayer)
             ? outputDependentState.overrideInfo.dataspace
             : outputDependentState.dataspace;
 
-    if (auto error = hwcLayer->setDataspace(dataspace); error != hal::Error::NONE) {
+    if (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setDataspace, sentState.dataspace,
+                                  dataspace);
+        error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set dataspace %d: %s (%d)", getLayerFE().getDebugName(), dataspace,
               to_string(error).c_str(), static_cast<int32_t>(error));
     }
@@ -566,7 +613,9 @@ void OutputLayer::writeOutputDependentPerFrameStateToHWC(HWC2::Layer* hwcLayer)
                        : 1.f)
             : outputDependentState.dimmingRatio;
 
-    if (auto error = hwcLayer->setBrightness(dimmingRatio); error != hal::Error::NONE) {
+    if (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setBrightness, sentState.brightness,
+                                  dimmingRatio);
+        error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set brightness %f: %s (%d)", getLayerFE().getDebugName(),
               dimmingRatio, to_string(error).c_str(), static_cast<int32_t>(error));
     }
@@ -575,7 +624,9 @@ void OutputLayer::writeOutputDependentPerFrameStateToHWC(HWC2::Layer* hwcLayer)
 void OutputLayer::writeOutputIndependentPerFrameStateToHWC(
         HWC2::Layer* hwcLayer, const LayerFECompositionState& outputIndependentState,
         Composition compositionType, bool skipLayer) {
-    switch (auto error = hwcLayer->setColorTransform(outputIndependentState.colorTransform)) {
+    switch (auto error = setIfChanged(hwcLayer, &HWC2::Layer::setColorTransform,
+                                      editState().hwc->sentState.colorTransform,
+                                      outputIndependentState.colorTransform)) {
         case hal::Error::NONE:
             break;
         case hal::Error::UNSUPPORTED:
@@ -650,21 +701,12 @@ void OutputLayer::uncacheBuffers(const std::vector<uint64_t>& bufferIdsToUncache
 
     // Uncache the active buffer last so that it's the first buffer to be purged from the cache
     // next time a buffer is sent to this layer.
-    bool uncacheActiveBuffer = false;
-
-    std::vector<uint32_t> slotsToClear;
-    for (uint64_t bufferId : bufferIdsToUncache) {
-        if (bufferId == state.hwc->activeBufferId) {
-            uncacheActiveBuffer = true;
-        } else {
-            uint32_t slot = state.hwc->hwcBufferCache.uncache(bufferId);
-            if (slot != UINT32_MAX) {
-                slotsToClear.push_back(slot);
-            }
-        }
-    }
-    if (uncacheActiveBuffer) {
-        slotsToClear.push_back(state.hwc->hwcBufferCache.uncache(state.hwc->activeBufferId));
+    std::vector<uint32_t> slotsToClear =
+            state.hwc->hwcBufferCache.uncache(bufferIdsToUncache, state.hwc->activeBufferId);
+    // The uncached buffers usually belong to other layers, so most layers have nothing to clear
+    // and don't need to send a command to HWC.
+    if (slotsToClear.empty()) {
+        return;
     }
 
     hal::Error error =
@@ -776,6 +818,13 @@ void OutputLayer::writeCursorPositionToHWC() const {
     }
 }
 
+void OutputLayer::forceResendStateToHWC() {
+    auto& state = editState();
+    if (state.hwc) {
+        state.hwc->sentState = {};
+    }
+}
+
 HWC2::Layer* OutputLayer::getHwcLayer() const {
     const auto& state = getState();
     return state.hwc ? state.hwc->hwcLayer.get() : nullptr;
@@ -883,18 +932,32 @@ std::optional<LayerFE::LayerSettings> OutputLayer::getOverrideCompositionSetting
     const ui::Transform transform = getState().overrideInfo.displaySpace.getTransform(layerSpace);
     const Rect boundaries = transform.transform(getState().overrideInfo.displayFrame);
 
+    // If only part of the buffer holds the override, scale the texture coordinates down to it.
+    const auto& overrideBuffer = getState().overrideInfo.buffer->getBuffer();
+    const Rect& crop = getState().overrideInfo.sourceCrop;
+    mat4 cropTransform;
+    if (!crop.isEmpty()) {
+        const auto bufferWidth = static_cast<float>(overrideBuffer->getWidth());
+        const auto bufferHeight = static_cast<float>(overrideBuffer->getHeight());
+        cropTransform = mat4::translate(vec4(static_cast<float>(crop.left) / bufferWidth,
+                                             static_cast<float>(crop.top) / bufferHeight, 0.f,
+                                             1.f)) *
+                mat4::scale(vec4(static_cast<float>(crop.getWidth()) / bufferWidth,
+                                 static_cast<float>(crop.getHeight()) / bufferHeight, 1.f, 1.f));
+    }
+
     LayerFE::LayerSettings settings;
     settings.geometry = renderengine::Geometry{
             .boundaries = boundaries.toFloatRect(),
     };
-    settings.bufferId = getState().overrideInfo.buffer->getBuffer()->getId();
+    settings.bufferId = overrideBuffer->getId();
     settings.source = renderengine::PixelSource{
             .buffer = renderengine::Buffer{
                     .buffer = getState().overrideInfo.buffer,
                     .fence = getState().overrideInfo.acquireFence,
                     // If the transform from layer space to display space contains a rotation, we
                     // need to undo the rotation in the texture transform
-                    .textureTransform =
+                    .textureTransform = cropTransform *
                             ui::Transform(transform.inverse().getOrientation(), 1, 1).asMatrix4(),
             }};
     settings.sourceDataspace = getState().overrideInfo.dataspace;
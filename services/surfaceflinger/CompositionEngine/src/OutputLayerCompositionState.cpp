@@ -40,6 +40,11 @@ void dumpHwc(const OutputLayerCompositionState::Hwc& hwc, std::string& out) {
     }
 
     dumpVal(out, "composition", toString(hwc.hwcCompositionType), hwc.hwcCompositionType);
+
+    const auto& stats = hwc.hwcBufferCache.getStats();
+    dumpVal(out, "bufferCacheHits", stats.hits);
+    dumpVal(out, "bufferCacheMisses", stats.misses);
+    dumpVal(out, "bufferCacheEvictions", stats.evictions);
 }
 
 } // namespace
@@ -75,6 +80,7 @@ void OutputLayerCompositionState::dump(std::string& out) const {
     dumpVal(out, "override buffer", overrideInfo.buffer.get());
     dumpVal(out, "override acquire fence", overrideInfo.acquireFence.get());
     dumpVal(out, "override display frame", overrideInfo.displayFrame);
+    dumpVal(out, "override source crop", overrideInfo.sourceCrop);
     dumpVal(out, "override dataspace", toString(overrideInfo.dataspace), overrideInfo.dataspace);
     dumpVal(out, "override display space", to_string(overrideInfo.displaySpace));
     std::string damageRegionString;
@@ -159,7 +159,7 @@ void CachedSet::updateAge(std::chrono::steady_clock::time_point now) {
 
 void CachedSet::render(renderengine::RenderEngine& renderEngine, TexturePool& texturePool,
                        const OutputCompositionState& outputState,
-                       bool deviceHandlesColorTransform) {
+                       bool deviceHandlesColorTransform, bool renderBoundsOnly) {
     SFTRACE_CALL();
     if (outputState.powerCallback) {
         outputState.powerCallback->notifyCpuLoadUp();
@@ -169,14 +169,26 @@ void CachedSet::render(renderengine::RenderEngine& renderEngine, TexturePool& te
     const ui::Transform::RotationFlags orientation =
             ui::Transform::toRotationFlags(outputState.framebufferSpace.getOrientation());
 
+    // When the layer stack is only offset from the display, the cached set can be rendered into
+    // the top left of a texture that is just large enough to hold its bounds. Blurs and hole
+    // punches may reach outside of the bounds, so they keep rendering the whole display.
+    const ui::Transform displayToLayerStack =
+            outputState.displaySpace.getTransform(outputState.layerStackSpace);
+    renderBoundsOnly = renderBoundsOnly && !mBlurLayer && !mHolePunchLayer &&
+            (displayToLayerStack.getType() & ~ui::Transform::TRANSLATE) == 0 &&
+            displayToLayerStack ==
+                    outputState.framebufferSpace.getTransform(outputState.layerStackSpace);
+
     renderengine::DisplaySettings displaySettings{
-            .physicalDisplay = outputState.framebufferSpace.getContent(),
-            .clip = viewport,
+            .physicalDisplay = renderBoundsOnly ? Rect(mBounds.getWidth(), mBounds.getHeight())
+                                                : outputState.framebufferSpace.getContent(),
+            .clip = renderBoundsOnly ? displayToLayerStack.transform(mBounds) : viewport,
             .outputDataspace = outputDataspace,
             .colorTransform = outputState.colorTransformMatrix,
             .deviceHandlesColorTransform = deviceHandlesColorTransform,
             .orientation = orientation,
             .targetLuminanceNits = outputState.displayBrightnessNits,
+            .priority = renderengine::DisplaySettings::Priority::Flattening,
     };
 
     LayerFE::ClientCompositionTargetSettings
@@ -262,7 +274,8 @@ void CachedSet::render(renderengine::RenderEngine& renderEngine, TexturePool& te
         layerSettings.emplace_back(highlight);
     }
 
-    auto texture = texturePool.borrowTexture();
+    auto texture = renderBoundsOnly ? texturePool.borrowTexture(mBounds.getSize())
+                                    : texturePool.borrowTexture();
     LOG_ALWAYS_FATAL_IF(texture->get()->getBuffer()->initCheck() != OK);
 
     base::unique_fd bufferFence;
@@ -284,6 +297,8 @@ void CachedSet::render(renderengine::RenderEngine& renderEngine, TexturePool& te
         mOutputSpace = outputState.framebufferSpace;
         mTexture = texture;
         mTexture->setReadyFence(mDrawFence);
+        mTextureBounds = renderBoundsOnly ? mBounds : texture->get()->getBuffer()->getBounds();
+        mTextureSourceCrop = Rect(mTextureBounds.getWidth(), mTextureBounds.getHeight());
         mOutputSpace.setOrientation(outputState.framebufferSpace.getOrientation());
         mOutputDataspace = outputDataspace;
         mOrientation = orientation;
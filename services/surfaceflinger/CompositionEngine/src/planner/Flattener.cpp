@@ -69,6 +69,24 @@ bool isSameStack(const std::vector<const LayerState*>& incomingLayers,
     return true;
 }
 
+// True if both cached sets draw the same layers, in the same state, the same way.
+bool isSameCachedSet(const CachedSet& left, const CachedSet& right) {
+    const auto& leftLayers = left.getConstituentLayers();
+    const auto& rightLayers = right.getConstituentLayers();
+    if (leftLayers.size() != rightLayers.size() ||
+        left.getHolePunchLayer() != right.getHolePunchLayer() ||
+        left.getBlurLayer() != right.getBlurLayer()) {
+        return false;
+    }
+    for (size_t i = 0; i < leftLayers.size(); i++) {
+        if (leftLayers[i].getState() != rightLayers[i].getState() ||
+            leftLayers[i].getHash() != rightLayers[i].getHash()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 } // namespace
 
 Flattener::Flattener(renderengine::RenderEngine& renderEngine, const Tunables& tunables)
@@ -77,6 +95,7 @@ Flattener::Flattener(renderengine::RenderEngine& renderEngine, const Tunables& t
 NonBufferHash Flattener::flattenLayers(const std::vector<const LayerState*>& layers,
                                        NonBufferHash hash, time_point now) {
     SFTRACE_CALL();
+    mTexturePool.trimIdle(now);
     const size_t unflattenedDisplayCost = calculateDisplayCost(layers);
     mUnflattenedDisplayCost += unflattenedDisplayCost;
 
@@ -102,6 +121,9 @@ NonBufferHash Flattener::flattenLayers(const std::vector<const LayerState*>& lay
 
     if (alreadyHadCachedSets) {
         buildCachedSets(now);
+        if (mTunables.mPredictiveRendering) {
+            updatePredictedCachedSet(now);
+        }
         hash = computeLayersHash();
     }
 
@@ -115,6 +137,7 @@ void Flattener::renderCachedSets(
     SFTRACE_CALL();
 
     if (!mNewCachedSet) {
+        renderPredictedCachedSet(outputState, renderDeadline, deviceHandlesColorTransform);
         return;
     }
 
@@ -148,7 +171,32 @@ void Flattener::renderCachedSets(
         }
     }
 
-    mNewCachedSet->render(mRenderEngine, mTexturePool, outputState, deviceHandlesColorTransform);
+    mNewCachedSet->render(mRenderEngine, mTexturePool, outputState, deviceHandlesColorTransform,
+                          mTunables.mRenderCachedSetBoundsOnly);
+}
+
+void Flattener::renderPredictedCachedSet(
+        const OutputCompositionState& outputState,
+        std::optional<std::chrono::steady_clock::time_point> renderDeadline,
+        bool deviceHandlesColorTransform) {
+    if (!mPredictedCachedSet || mPredictedCachedSet->hasRenderedBuffer() || !renderDeadline) {
+        return;
+    }
+
+    // A predicted cached set may never be used, so only render it if it fits in the time left
+    // before the next frame, and never defer the next frame for it.
+    const auto renderDuration = mTunables.mRenderScheduling
+            ? mTunables.mRenderScheduling->cachedSetRenderDuration
+            : Tunables::RenderScheduling::kDefaultCachedSetRenderDuration;
+    if (std::chrono::steady_clock::now() + renderDuration > *renderDeadline) {
+        SFTRACE_NAME("PredictedCachedSet: not enough idle time");
+        return;
+    }
+
+    SFTRACE_NAME("PredictedCachedSet: render");
+    mPredictedCachedSet->render(mRenderEngine, mTexturePool, outputState,
+                                deviceHandlesColorTransform, mTunables.mRenderCachedSetBoundsOnly);
+    ++mPredictedCachedSetRenderCount;
 }
 
 void Flattener::dumpLayers(std::string& result) const {
@@ -200,6 +248,15 @@ void Flattener::dump(std::string& result) const {
     base::StringAppendF(&result, "    Cost: %.2f\n",
                         static_cast<float>(mCachedSetCreationCost) / displayArea);
 
+    if (mTunables.mPredictiveRendering) {
+        const size_t renders = mPredictedCachedSetRenderCount;
+        base::StringAppendF(&result, "\n    Predicted cached sets rendered: %zd\n", renders);
+        base::StringAppendF(&result, "      Used:   %zd (%.2f%%)\n", mPredictedCachedSetHitCount,
+                            renders ? 100.0f * mPredictedCachedSetHitCount / renders : 0.0f);
+        base::StringAppendF(&result, "      Wasted: %zd (%.2f%%)\n", mPredictedCachedSetWasteCount,
+                            renders ? 100.0f * mPredictedCachedSetWasteCount / renders : 0.0f);
+    }
+
     const auto lastUpdate =
             std::chrono::duration_cast<std::chrono::milliseconds>(now - mLastGeometryUpdate);
     base::StringAppendF(&result, "\n  Current hash %016zx, last update %sago\n\n", mCurrentGeometry,
@@ -256,6 +313,8 @@ void Flattener::resetActivities(NonBufferHash hash, time_point now) {
         ++mInvalidatedCachedSetAges[mNewCachedSet->getAge()];
         mNewCachedSet = std::nullopt;
     }
+
+    resetPredictedCachedSet();
 }
 
 NonBufferHash Flattener::computeLayersHash() const{
@@ -329,6 +388,7 @@ bool Flattener::mergeWithCachedSets(const std::vector<const LayerState*>& layers
                                 .buffer = mNewCachedSet->getBuffer(),
                                 .acquireFence = mNewCachedSet->getDrawFence(),
                                 .displayFrame = mNewCachedSet->getTextureBounds(),
+                                .sourceCrop = mNewCachedSet->getTextureSourceCrop(),
                                 .dataspace = mNewCachedSet->getOutputDataspace(),
                                 .displaySpace = mNewCachedSet->getOutputSpace(),
                                 .damageRegion = Region::INVALID_REGION,
@@ -369,6 +429,7 @@ bool Flattener::mergeWithCachedSets(const std::vector<const LayerState*>& layers
                         .buffer = currentLayerIter->getBuffer(),
                         .acquireFence = currentLayerIter->getDrawFence(),
                         .displayFrame = currentLayerIter->getTextureBounds(),
+                        .sourceCrop = currentLayerIter->getTextureSourceCrop(),
                         .dataspace = currentLayerIter->getOutputDataspace(),
                         .displaySpace = currentLayerIter->getOutputSpace(),
                         .damageRegion = Region(),
@@ -492,6 +553,29 @@ std::optional<Flattener::Run> Flattener::findBestRun(std::vector<Flattener::Run>
     return runs[0];
 }
 
+CachedSet Flattener::buildCachedSet(const Run& run, time_point now) const {
+    CachedSet cachedSet(*run.getStart());
+    cachedSet.setLastUpdate(now);
+    auto currentSet = run.getStart();
+    while (cachedSet.getLayerCount() < run.getLayerLength()) {
+        ++currentSet;
+        cachedSet.append(*currentSet);
+    }
+
+    if (run.getBlurringLayer()) {
+        cachedSet.addBackgroundBlurLayer(*run.getBlurringLayer());
+    }
+
+    if (mTunables.mEnableHolePunch && run.getHolePunchCandidate() &&
+        run.getHolePunchCandidate()->requiresHolePunch()) {
+        // Add the pip layer to the cached set, but in a special way - it should
+        // replace the buffer with a clear round rect.
+        cachedSet.addHolePunchLayerIfFeasible(*run.getHolePunchCandidate(),
+                                              run.getStart() == mLayers.cbegin());
+    }
+    return cachedSet;
+}
+
 void Flattener::buildCachedSets(time_point now) {
     SFTRACE_CALL();
     if (mLayers.empty()) {
@@ -520,24 +604,20 @@ void Flattener::buildCachedSets(time_point now) {
         return;
     }
 
-    mNewCachedSet.emplace(*bestRun->getStart());
-    mNewCachedSet->setLastUpdate(now);
-    auto currentSet = bestRun->getStart();
-    while (mNewCachedSet->getLayerCount() < bestRun->getLayerLength()) {
-        ++currentSet;
-        mNewCachedSet->append(*currentSet);
-    }
-
-    if (bestRun->getBlurringLayer()) {
-        mNewCachedSet->addBackgroundBlurLayer(*bestRun->getBlurringLayer());
-    }
-
-    if (mTunables.mEnableHolePunch && bestRun->getHolePunchCandidate() &&
-        bestRun->getHolePunchCandidate()->requiresHolePunch()) {
-        // Add the pip layer to mNewCachedSet, but in a special way - it should
-        // replace the buffer with a clear round rect.
-        mNewCachedSet->addHolePunchLayerIfFeasible(*bestRun->getHolePunchCandidate(),
-                                                   bestRun->getStart() == mLayers.cbegin());
+    mNewCachedSet.emplace(buildCachedSet(*bestRun, now));
+
+    if (mPredictedCachedSet) {
+        // Use the buffer rendered ahead of time, so the cached set needs no rendering.
+        if (mPredictedCachedSet->hasRenderedBuffer() && !mPredictedCachedSet->hasBufferUpdate() &&
+            isSameCachedSet(*mPredictedCachedSet, *mNewCachedSet)) {
+            SFTRACE_NAME("PredictedCachedSet: hit");
+            mNewCachedSet.emplace(std::move(*mPredictedCachedSet));
+            mNewCachedSet->setLastUpdate(now);
+            mPredictedCachedSet = std::nullopt;
+            ++mPredictedCachedSetHitCount;
+        } else {
+            resetPredictedCachedSet();
+        }
     }
 
     // TODO(b/181192467): Actually compute new LayerState vector and corresponding hash for each run
@@ -555,4 +635,36 @@ void Flattener::buildCachedSets(time_point now) {
     ALOGV("[%s] Added new cached set:\n%s", __func__, dumper().c_str());
 }
 
+void Flattener::updatePredictedCachedSet(time_point now) {
+    SFTRACE_CALL();
+    if (mPredictedCachedSet && mPredictedCachedSet->hasBufferUpdate()) {
+        ALOGV("[%s] Dropping predicted cached set", __func__);
+        resetPredictedCachedSet();
+    }
+
+    if (!mFlatteningPredicted || mNewCachedSet || mPredictedCachedSet) {
+        return;
+    }
+
+    for (const CachedSet& layer : mLayers) {
+        if (layer.hasProtectedLayers()) {
+            return;
+        }
+    }
+
+    // Look for the run that buildCachedSets will find once the layers have been inactive for
+    // the rest of the lead time.
+    std::vector<Run> runs = findCandidateRuns(now + mTunables.mPredictiveRendering->lead);
+    if (std::optional<Run> bestRun = findBestRun(runs)) {
+        mPredictedCachedSet.emplace(buildCachedSet(*bestRun, now));
+    }
+}
+
+void Flattener::resetPredictedCachedSet() {
+    if (mPredictedCachedSet && mPredictedCachedSet->hasRenderedBuffer()) {
+        ++mPredictedCachedSetWasteCount;
+    }
+    mPredictedCachedSet = std::nullopt;
+}
+
 } // namespace android::compositionengine::impl::planner
@@ -53,6 +53,26 @@ std::optional<Flattener::Tunables::RenderScheduling> buildRenderSchedulingTunabl
             });
 }
 
+// Rendering cached sets ahead of time relies on the Predictor's history, so it also needs
+// debug.sf.enable_planner_prediction.
+std::optional<Flattener::Tunables::PredictiveRendering> buildPredictiveRenderingTunables() {
+    if (!base::GetBoolProperty(std::string("debug.sf.enable_predictive_cached_set_rendering"),
+                               false)) {
+        return std::nullopt;
+    }
+
+    const auto lead = std::chrono::milliseconds(
+            base::GetIntProperty<int32_t>(std::string(
+                                                  "debug.sf.predictive_cached_set_render_lead_ms"),
+                                          Flattener::Tunables::PredictiveRendering::kDefaultLead
+                                                  .count()));
+
+    return std::make_optional<Flattener::Tunables::PredictiveRendering>(
+            Flattener::Tunables::PredictiveRendering{
+                    .lead = lead,
+            });
+}
+
 Flattener::Tunables buildFlattenerTuneables() {
     const auto activeLayerTimeout = std::chrono::milliseconds(
             base::GetIntProperty<int32_t>(std::string(
@@ -65,6 +85,11 @@ Flattener::Tunables buildFlattenerTuneables() {
             .mActiveLayerTimeout = activeLayerTimeout,
             .mRenderScheduling = buildRenderSchedulingTunables(),
             .mEnableHolePunch = enableHolePunch,
+            .mPredictiveRendering = buildPredictiveRenderingTunables(),
+            .mRenderCachedSetBoundsOnly =
+                    base::GetBoolProperty(std::string(
+                                                  "debug.sf.render_cached_set_bounds_only"),
+                                          false),
     };
 }
 
@@ -133,6 +158,9 @@ void Planner::plan(
                    });
 
     const NonBufferHash hash = getNonBufferHash(mCurrentLayers);
+    if (mPredictorEnabled) {
+        mFlattener.setFlatteningPredicted(mPredictor.isLikelyToFlatten(hash));
+    }
     mFlattenedHash =
             mFlattener.flattenLayers(mCurrentLayers, hash, std::chrono::steady_clock::now());
     const bool layersWereFlattened = hash != mFlattenedHash;
@@ -140,6 +168,7 @@ void Planner::plan(
     ALOGV("[%s] Initial hash %zx flattened hash %zx", __func__, hash, mFlattenedHash);
 
     if (mPredictorEnabled) {
+        mPredictor.recordFlattening(hash, layersWereFlattened);
         mPredictedPlan =
                 mPredictor.getPredictedPlan(layersWereFlattened ? std::vector<const LayerState*>()
                                                                 : mCurrentLayers,
@@ -219,6 +219,42 @@ void Predictor::recordResult(std::optional<PredictedPlan> predictedPlan,
     }
 }
 
+void Predictor::recordFlattening(NonBufferHash geometryHash, bool flattened) {
+    if (mCurrentFlatteningHash != geometryHash) {
+        mCurrentFlatteningHash = geometryHash;
+        if (mFlatteningHistories.size() >= MAX_FLATTENING_HISTORIES &&
+            mFlatteningHistories.count(geometryHash) == 0) {
+            // Forget the stack seen least often.
+            const auto leastObserved =
+                    std::min_element(mFlatteningHistories.begin(), mFlatteningHistories.end(),
+                                     [](const auto& left, const auto& right) {
+                                         return left.second.observations <
+                                                 right.second.observations;
+                                     });
+            mFlatteningHistories.erase(leastObserved);
+        }
+        FlatteningHistory& history = mFlatteningHistories[geometryHash];
+        ++history.observations;
+        history.flattenedInCurrentObservation = false;
+    }
+
+    FlatteningHistory& history = mFlatteningHistories[geometryHash];
+    if (flattened && !history.flattenedInCurrentObservation) {
+        history.flattenedInCurrentObservation = true;
+        ++history.flattenedObservations;
+    }
+}
+
+bool Predictor::isLikelyToFlatten(NonBufferHash geometryHash) const {
+    const auto it = mFlatteningHistories.find(geometryHash);
+    if (it == mFlatteningHistories.end()) {
+        return false;
+    }
+    const FlatteningHistory& history = it->second;
+    return history.flattenedObservations > 0 &&
+            history.flattenedObservations * 2 >= history.observations;
+}
+
 void Predictor::dump(std::string& result) const {
     result.append("Predictor state:\n");
 
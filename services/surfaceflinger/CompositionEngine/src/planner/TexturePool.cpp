@@ -25,13 +25,37 @@
 
 namespace android::compositionengine::impl::planner {
 
+namespace {
+
+// Rounds value up to the next multiple of 1/steps of max, never going past max.
+int32_t roundUpToStep(int32_t value, int32_t max, int32_t steps) {
+    for (int32_t step = 1; step < steps; step++) {
+        const int32_t stepValue = (max * step + steps - 1) / steps;
+        if (value <= stepValue) {
+            return stepValue;
+        }
+    }
+    return max;
+}
+
+} // namespace
+
+size_t TexturePool::textureBytes(ui::Size size) {
+    // All textures are RGBA_8888.
+    return static_cast<size_t>(size.getWidth()) * static_cast<size_t>(size.getHeight()) * 4;
+}
+
 void TexturePool::allocatePool() {
+    mGeneration++;
     mPool.clear();
+    mPoolBytes = 0;
     if (mEnabled && mSize.isValid()) {
         mPool.resize(kMinPoolSize);
+        const auto now = std::chrono::steady_clock::now();
         std::generate_n(mPool.begin(), kMinPoolSize, [&]() {
-            return Entry{genTexture(), nullptr};
+            return Entry{genTexture(mSize), nullptr, now};
         });
+        mPoolBytes = kMinPoolSize * textureBytes(mSize);
     }
 }
 
@@ -40,53 +64,96 @@ void TexturePool::setDisplaySize(ui::Size size) {
         return;
     }
     mSize = size;
+    mBucketStats.clear();
     allocatePool();
 }
 
+ui::Size TexturePool::getBucketSize(ui::Size minSize) const {
+    return ui::Size(roundUpToStep(minSize.getWidth(), mSize.getWidth(), kBucketSteps),
+                    roundUpToStep(minSize.getHeight(), mSize.getHeight(), kBucketSteps));
+}
+
 std::shared_ptr<TexturePool::AutoTexture> TexturePool::borrowTexture() {
-    if (mPool.empty()) {
-        return std::make_shared<AutoTexture>(*this, genTexture(), nullptr);
+    return borrowTexture(mSize);
+}
+
+std::shared_ptr<TexturePool::AutoTexture> TexturePool::borrowTexture(ui::Size minSize) {
+    const ui::Size size = getBucketSize(minSize);
+    auto& stats = mBucketStats[{size.getWidth(), size.getHeight()}];
+
+    // Prefer the least recently returned texture, as its fence is the most likely to have
+    // signaled.
+    const auto it = std::find_if(mPool.begin(), mPool.end(), [&](const Entry& entry) {
+        return static_cast<int32_t>(entry.texture->getBuffer()->getWidth()) == size.getWidth() &&
+                static_cast<int32_t>(entry.texture->getBuffer()->getHeight()) == size.getHeight();
+    });
+    if (it == mPool.end()) {
+        stats.misses++;
+        return std::make_shared<AutoTexture>(*this, genTexture(size), nullptr, mGeneration);
     }
 
-    const auto entry = mPool.front();
-    mPool.pop_front();
-    return std::make_shared<AutoTexture>(*this, entry.texture, entry.fence);
+    stats.hits++;
+    const auto entry = *it;
+    mPool.erase(it);
+    mPoolBytes -= textureBytes(size);
+    return std::make_shared<AutoTexture>(*this, entry.texture, entry.fence,
+                                         mGeneration);
 }
 
 void TexturePool::returnTexture(std::shared_ptr<renderengine::ExternalTexture>&& texture,
-                                const sp<Fence>& fence) {
+                                const sp<Fence>& fence, uint64_t generation) {
     // Drop the texture on the floor if the pool is not enabled
     if (!mEnabled) {
         return;
     }
 
     // Or the texture on the floor if the pool is no longer tracking textures of the same size.
-    if (static_cast<int32_t>(texture->getBuffer()->getWidth()) != mSize.getWidth() ||
-        static_cast<int32_t>(texture->getBuffer()->getHeight()) != mSize.getHeight()) {
+    const ui::Size size(static_cast<int32_t>(texture->getBuffer()->getWidth()),
+                        static_cast<int32_t>(texture->getBuffer()->getHeight()));
+    if (generation != mGeneration) {
         ALOGV("Deallocating texture from Planner's pool - display size changed (previous: (%dx%d), "
               "current: (%dx%d))",
-              texture->getBuffer()->getWidth(), texture->getBuffer()->getHeight(), mSize.getWidth(),
-              mSize.getHeight());
+              size.getWidth(), size.getHeight(), mSize.getWidth(), mSize.getHeight());
         return;
     }
 
-    // Also ensure the pool does not grow beyond a maximum size.
-    if (mPool.size() == kMaxPoolSize) {
-        ALOGD("Deallocating texture from Planner's pool - max size [%" PRIu64 "] reached",
-              static_cast<uint64_t>(kMaxPoolSize));
+    // Also ensure the pool does not grow beyond its budget, by evicting the least recently
+    // returned textures.
+    const size_t bytes = textureBytes(size);
+    const size_t budget = getBudgetBytes();
+    if (bytes > budget) {
         return;
     }
+    while (mPoolBytes + bytes > budget) {
+        ALOGD("Deallocating texture from Planner's pool - budget of %zu bytes reached", budget);
+        evictFront();
+    }
 
-    mPool.push_back({std::move(texture), fence});
+    mPool.push_back({std::move(texture), fence, std::chrono::steady_clock::now()});
+    mPoolBytes += bytes;
+}
+
+void TexturePool::evictFront() {
+    const auto& buffer = mPool.front().texture->getBuffer();
+    mPoolBytes -= textureBytes(ui::Size(static_cast<int32_t>(buffer->getWidth()),
+                                        static_cast<int32_t>(buffer->getHeight())));
+    mPool.pop_front();
 }
 
-std::shared_ptr<renderengine::ExternalTexture> TexturePool::genTexture() {
-    LOG_ALWAYS_FATAL_IF(!mSize.isValid(), "Attempted to generate texture with invalid size");
+void TexturePool::trimIdle(std::chrono::steady_clock::time_point now) {
+    while (mPool.size() > kMinPoolSize && now - mPool.front().lastUsed > kIdleTimeout) {
+        ALOGV("Deallocating idle texture from Planner's pool");
+        evictFront();
+    }
+}
+
+std::shared_ptr<renderengine::ExternalTexture> TexturePool::genTexture(ui::Size size) {
+    LOG_ALWAYS_FATAL_IF(!size.isValid(), "Attempted to generate texture with invalid size");
     return std::make_shared<
             renderengine::impl::
                     ExternalTexture>(sp<GraphicBuffer>::
-                                             make(static_cast<uint32_t>(mSize.getWidth()),
-                                                  static_cast<uint32_t>(mSize.getHeight()),
+                                             make(static_cast<uint32_t>(size.getWidth()),
+                                                  static_cast<uint32_t>(size.getHeight()),
                                                   HAL_PIXEL_FORMAT_RGBA_8888, 1U,
                                                   static_cast<uint64_t>(
                                                           GraphicBuffer::USAGE_HW_RENDER |
@@ -105,8 +172,18 @@ void TexturePool::setEnabled(bool enabled) {
 
 void TexturePool::dump(std::string& out) const {
     base::StringAppendF(&out,
-                        "TexturePool (%s) has %zu buffers of size [%" PRId32 ", %" PRId32 "]\n",
-                        mEnabled ? "enabled" : "disabled", mPool.size(), mSize.width, mSize.height);
+                        "TexturePool (%s) has %zu buffers (%zu of %zu KiB) for display size "
+                        "[%" PRId32 ", %" PRId32 "]\n",
+                        mEnabled ? "enabled" : "disabled", mPool.size(), mPoolBytes / 1024,
+                        getBudgetBytes() / 1024, mSize.width, mSize.height);
+    for (const auto& [bucket, stats] : mBucketStats) {
+        const size_t borrows = stats.hits + stats.misses;
+        base::StringAppendF(&out,
+                            "    Bucket [%" PRId32 ", %" PRId32 "]: %zu hits, %zu misses "
+                            "(%.2f%% hit rate)\n",
+                            bucket.first, bucket.second, stats.hits, stats.misses,
+                            borrows ? 100.0f * stats.hits / borrows : 0.0f);
+    }
 }
 
 } // namespace android::compositionengine::impl::planner
\ No newline at end of file
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/impl/BlurBackdropTracker.h>
+#include <gtest/gtest.h>
+
+namespace android::compositionengine {
+namespace {
+
+using impl::BlurBackdropTracker;
+
+class BlurBackdropTrackerTest : public testing::Test {
+public:
+    BlurBackdropTrackerTest() {
+        mDisplay.physicalDisplay = Rect(10, 10);
+        mDisplay.clip = Rect(10, 10);
+
+        LayerFE::LayerSettings wallpaper;
+        wallpaper.geometry.boundaries = FloatRect{0, 0, 10, 10};
+        wallpaper.bufferId = 42;
+        wallpaper.frameNumber = 1;
+        mLayers.push_back(wallpaper);
+
+        LayerFE::LayerSettings shade;
+        shade.geometry.boundaries = FloatRect{0, 0, 10, 5};
+        shade.backgroundBlurRadius = 20;
+        mLayers.push_back(shade);
+    }
+
+    uint64_t assignIds() {
+        mTracker.assignIds(mDisplay, mLayers);
+        return mLayers.back().blurBackdropId;
+    }
+
+    renderengine::DisplaySettings mDisplay;
+    std::vector<LayerFE::LayerSettings> mLayers;
+    BlurBackdropTracker mTracker;
+};
+
+TEST_F(BlurBackdropTrackerTest, onlyAssignsIdsToBlurLayers) {
+    EXPECT_NE(0u, assignIds());
+    EXPECT_EQ(0u, mLayers.front().blurBackdropId);
+}
+
+TEST_F(BlurBackdropTrackerTest, keepsIdWhileBackdropIsUnchanged) {
+    const uint64_t id = assignIds();
+    EXPECT_EQ(id, assignIds());
+
+    // Changes to the blur layer itself do not change what it blurs.
+    mLayers.back().alpha = 0.5f;
+    EXPECT_EQ(id, assignIds());
+}
+
+TEST_F(BlurBackdropTrackerTest, changesIdWhenBackdropChanges) {
+    const uint64_t id = assignIds();
+
+    mLayers.front().frameNumber++;
+    const uint64_t newId = assignIds();
+    EXPECT_NE(id, newId);
+
+    mDisplay.clip = Rect(5, 5);
+    EXPECT_NE(newId, assignIds());
+}
+
+TEST_F(BlurBackdropTrackerTest, tracksEachBlurLayer) {
+    LayerFE::LayerSettings dialog;
+    dialog.geometry.boundaries = FloatRect{2, 2, 8, 8};
+    dialog.blurRegions.push_back(BlurRegion{.blurRadius = 10});
+    mLayers.push_back(dialog);
+
+    mTracker.assignIds(mDisplay, mLayers);
+    const uint64_t shadeId = mLayers[1].blurBackdropId;
+    const uint64_t dialogId = mLayers[2].blurBackdropId;
+    EXPECT_NE(shadeId, dialogId);
+
+    // Only the dialog blurs the shade.
+    mLayers[1].alpha = 0.5f;
+    mTracker.assignIds(mDisplay, mLayers);
+    EXPECT_EQ(shadeId, mLayers[1].blurBackdropId);
+    EXPECT_NE(dialogId, mLayers[2].blurBackdropId);
+}
+
+} // namespace
+} // namespace android::compositionengine
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/impl/ClientCompositionRequestCache.h>
+#include <gtest/gtest.h>
+#include <renderengine/impl/ExternalTexture.h>
+#include <renderengine/mock/RenderEngine.h>
+#include <ui/GraphicBuffer.h>
+
+namespace android::compositionengine {
+namespace {
+
+using impl::ClientCompositionRequestCache;
+using Result = ClientCompositionRequestCache::Result;
+
+class ClientCompositionRequestCacheTest : public testing::Test {
+public:
+    ClientCompositionRequestCacheTest() {
+        mDisplay.physicalDisplay = Rect(10, 10);
+        mDisplay.clip = Rect(10, 10);
+
+        LayerFE::LayerSettings layer;
+        layer.geometry.boundaries = FloatRect{1, 2, 3, 4};
+        layer.bufferId = 42;
+        layer.frameNumber = 1;
+        mLayers.push_back(layer);
+    }
+
+    std::shared_ptr<renderengine::ExternalTexture> makeBuffer() {
+        return std::make_shared<
+                renderengine::impl::
+                        ExternalTexture>(sp<GraphicBuffer>::make(), mRenderEngine,
+                                         renderengine::impl::ExternalTexture::Usage::READABLE |
+                                                 renderengine::impl::ExternalTexture::Usage::
+                                                         WRITEABLE);
+    }
+
+    uint64_t idOf(const std::shared_ptr<renderengine::ExternalTexture>& buffer) {
+        return buffer->getBuffer()->getId();
+    }
+
+    renderengine::mock::RenderEngine mRenderEngine;
+    renderengine::DisplaySettings mDisplay;
+    std::vector<LayerFE::LayerSettings> mLayers;
+    ClientCompositionRequestCache mCache{3};
+};
+
+TEST_F(ClientCompositionRequestCacheTest, missesWhenEmpty) {
+    const auto buffer = makeBuffer();
+    const auto lookup = mCache.lookup(idOf(buffer), mDisplay, mLayers);
+    EXPECT_EQ(Result::Miss, lookup.result);
+    EXPECT_EQ(ClientCompositionRequestCache::getRequestHash(mDisplay, mLayers),
+              lookup.requestHash);
+}
+
+TEST_F(ClientCompositionRequestCacheTest, hitsSameBuffer) {
+    const auto buffer = makeBuffer();
+    auto lookup = mCache.lookup(idOf(buffer), mDisplay, mLayers);
+    mCache.add(buffer, lookup.requestHash, mDisplay, mLayers);
+
+    lookup = mCache.lookup(idOf(buffer), mDisplay, mLayers);
+    EXPECT_EQ(Result::Hit, lookup.result);
+    EXPECT_EQ(nullptr, lookup.otherBuffer);
+    EXPECT_TRUE(mCache.exists(idOf(buffer), mDisplay, mLayers));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, missesWhenContentChanges) {
+    const auto buffer = makeBuffer();
+    mCache.add(buffer, ClientCompositionRequestCache::getRequestHash(mDisplay, mLayers), mDisplay,
+               mLayers);
+
+    mLayers[0].frameNumber++;
+    EXPECT_EQ(Result::Miss, mCache.lookup(idOf(buffer), mDisplay, mLayers).result);
+    EXPECT_FALSE(mCache.exists(idOf(buffer), mDisplay, mLayers));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, findsContentInOtherBuffer) {
+    const auto buffer1 = makeBuffer();
+    const auto buffer2 = makeBuffer();
+    mCache.add(buffer1, ClientCompositionRequestCache::getRequestHash(mDisplay, mLayers), mDisplay,
+               mLayers);
+
+    const auto lookup = mCache.lookup(idOf(buffer2), mDisplay, mLayers);
+    EXPECT_EQ(Result::HitOtherBuffer, lookup.result);
+    EXPECT_EQ(buffer1, lookup.otherBuffer);
+}
+
+TEST_F(ClientCompositionRequestCacheTest, doesNotExtendBufferLifetime) {
+    auto buffer1 = makeBuffer();
+    const auto buffer2 = makeBuffer();
+    mCache.add(buffer1, ClientCompositionRequestCache::getRequestHash(mDisplay, mLayers), mDisplay,
+               mLayers);
+    buffer1.reset();
+
+    EXPECT_EQ(Result::Miss, mCache.lookup(idOf(buffer2), mDisplay, mLayers).result);
+}
+
+TEST_F(ClientCompositionRequestCacheTest, evictsOldestRequest) {
+    std::vector<std::shared_ptr<renderengine::ExternalTexture>> buffers;
+    for (int i = 0; i < 4; i++) {
+        buffers.push_back(makeBuffer());
+        mLayers[0].frameNumber = static_cast<uint64_t>(i);
+        mCache.add(buffers.back(), ClientCompositionRequestCache::getRequestHash(mDisplay, mLayers),
+                   mDisplay, mLayers);
+    }
+
+    mLayers[0].frameNumber = 0;
+    EXPECT_FALSE(mCache.exists(idOf(buffers[0]), mDisplay, mLayers));
+    mLayers[0].frameNumber = 3;
+    EXPECT_TRUE(mCache.exists(idOf(buffers[3]), mDisplay, mLayers));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, damagesBoundsOfChangedLayers) {
+    LayerFE::LayerSettings background;
+    background.geometry.boundaries = FloatRect{0, 0, 10, 10};
+    background.source.solidColor = half3(1.f, 0.f, 0.f);
+    mLayers.insert(mLayers.begin(), background);
+
+    const auto buffer = makeBuffer();
+    mCache.add(buffer, ClientCompositionRequestCache::getRequestHash(mDisplay, mLayers), mDisplay,
+               mLayers);
+
+    mLayers[1].frameNumber++;
+    mLayers[1].geometry.positionTransform = mat4::translate(vec4(4.f, 0.f, 0.f, 0.f));
+    const auto damage = mCache.getDamage(idOf(buffer), mDisplay, mLayers);
+    ASSERT_TRUE(damage);
+    EXPECT_EQ((FloatRect{1, 2, 7, 4}), *damage);
+}
+
+TEST_F(ClientCompositionRequestCacheTest, noDamageForOtherRequests) {
+    const auto buffer1 = makeBuffer();
+    const auto buffer2 = makeBuffer();
+    mCache.add(buffer1, ClientCompositionRequestCache::getRequestHash(mDisplay, mLayers), mDisplay,
+               mLayers);
+    mLayers[0].frameNumber++;
+
+    EXPECT_FALSE(mCache.getDamage(idOf(buffer2), mDisplay, mLayers));
+
+    auto display = mDisplay;
+    display.clip = Rect(5, 5);
+    EXPECT_FALSE(mCache.getDamage(idOf(buffer1), display, mLayers));
+
+    auto layers = mLayers;
+    layers.push_back(mLayers[0]);
+    EXPECT_FALSE(mCache.getDamage(idOf(buffer1), mDisplay, layers));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, noDamageWhenLayersDrawOutsideTheirBounds) {
+    LayerFE::LayerSettings blur;
+    blur.geometry.boundaries = FloatRect{0, 0, 10, 10};
+    blur.backgroundBlurRadius = 10;
+    auto layers = mLayers;
+    layers.push_back(blur);
+
+    const auto buffer = makeBuffer();
+    mCache.add(buffer, ClientCompositionRequestCache::getRequestHash(mDisplay, layers), mDisplay,
+               layers);
+    layers[0].frameNumber++;
+    EXPECT_FALSE(mCache.getDamage(idOf(buffer), mDisplay, layers));
+
+    mCache.add(buffer, ClientCompositionRequestCache::getRequestHash(mDisplay, mLayers), mDisplay,
+               mLayers);
+    mLayers[0].frameNumber++;
+    mLayers[0].shadow.length = 5.f;
+    EXPECT_FALSE(mCache.getDamage(idOf(buffer), mDisplay, mLayers));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, dumpsLookupCounts) {
+    const auto buffer1 = makeBuffer();
+    const auto buffer2 = makeBuffer();
+    auto lookup = mCache.lookup(idOf(buffer1), mDisplay, mLayers);
+    mCache.add(buffer1, lookup.requestHash, mDisplay, mLayers);
+    mCache.lookup(idOf(buffer1), mDisplay, mLayers);
+    mCache.lookup(idOf(buffer2), mDisplay, mLayers);
+
+    std::string dump;
+    mCache.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("1 hits, 1 hits in other buffers, 1 misses"));
+}
+
+} // namespace
+} // namespace android::compositionengine
@@ -487,6 +487,50 @@ TEST_F(CompositionEngineOffloadTest, disabledDisplaysDoNotPreventOthersFromOfflo
     mEngine.present(mRefreshArgs);
 }
 
+TEST_F(CompositionEngineOffloadTest, concurrentPresent) {
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mDisplay2, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mDisplay1, getOutputLayerCount).WillRepeatedly(Return(0u));
+    EXPECT_CALL(*mDisplay2, getOutputLayerCount).WillRepeatedly(Return(0u));
+
+    // Both outputs run their whole present, so there is nothing left to offload.
+    EXPECT_CALL(*mDisplay1, offloadPresentNextFrame).Times(0);
+    EXPECT_CALL(*mDisplay2, offloadPresentNextFrame).Times(0);
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, true);
+    mRefreshArgs.concurrentOutputPresent = true;
+    setOutputs({mDisplay1, mDisplay2});
+
+    mEngine.present(mRefreshArgs);
+}
+
+TEST_F(CompositionEngineOffloadTest, concurrentPresentRequiresDistinctLayers) {
+    sp<StrictMock<mock::LayerFE>> layerFE = sp<StrictMock<mock::LayerFE>>::make();
+    StrictMock<mock::OutputLayer> outputLayer1;
+    StrictMock<mock::OutputLayer> outputLayer2;
+    EXPECT_CALL(outputLayer1, getLayerFE).WillRepeatedly(ReturnRef(*layerFE));
+    EXPECT_CALL(outputLayer2, getLayerFE).WillRepeatedly(ReturnRef(*layerFE));
+
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillRepeatedly(Return(true));
+    EXPECT_CALL(*mDisplay2, supportsOffloadPresent).WillRepeatedly(Return(true));
+    EXPECT_CALL(*mDisplay1, getOutputLayerCount).WillRepeatedly(Return(1u));
+    EXPECT_CALL(*mDisplay2, getOutputLayerCount).WillRepeatedly(Return(1u));
+    EXPECT_CALL(*mDisplay1, getOutputLayerOrderedByZByIndex(0))
+            .WillRepeatedly(Return(&outputLayer1));
+    EXPECT_CALL(*mDisplay2, getOutputLayerOrderedByZByIndex(0))
+            .WillRepeatedly(Return(&outputLayer2));
+
+    // The outputs share a layer, so only the HWC present is offloaded.
+    EXPECT_CALL(*mDisplay1, offloadPresentNextFrame).Times(1);
+    EXPECT_CALL(*mDisplay2, offloadPresentNextFrame).Times(0);
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, true);
+    mRefreshArgs.concurrentOutputPresent = true;
+    setOutputs({mDisplay1, mDisplay2});
+
+    mEngine.present(mRefreshArgs);
+}
+
 struct CompositionEnginePostCompositionTest : public CompositionEngineTest {
     sp<StrictMock<mock::LayerFE>> mLayer1FE = sp<StrictMock<mock::LayerFE>>::make();
     sp<StrictMock<mock::LayerFE>> mLayer2FE = sp<StrictMock<mock::LayerFE>>::make();
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/impl/CompositionStrategyPredictionTracker.h>
+#include <gtest/gtest.h>
+
+namespace android::compositionengine {
+namespace {
+
+using impl::CompositionStrategyPredictionTracker;
+
+constexpr CompositionStrategyPredictionTracker::Config kConfig{.minHitRate = 0.5f,
+                                                               .windowSize = 4,
+                                                               .pausedFrames = 3};
+
+TEST(CompositionStrategyPredictionTrackerTest, countsPredictionsAndHits) {
+    CompositionStrategyPredictionTracker tracker;
+    tracker.onPredictionResult(true);
+    tracker.onPredictionResult(false);
+    tracker.onPredictionResult(true);
+
+    EXPECT_EQ(3u, tracker.getStats().predictions);
+    EXPECT_EQ(2u, tracker.getStats().hits);
+}
+
+TEST(CompositionStrategyPredictionTrackerTest, neverPausesWithoutMinHitRate) {
+    CompositionStrategyPredictionTracker tracker;
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(tracker.shouldPredict());
+        tracker.onPredictionResult(false);
+    }
+    EXPECT_EQ(0u, tracker.getStats().pauses);
+}
+
+TEST(CompositionStrategyPredictionTrackerTest, keepsPredictingAboveMinHitRate) {
+    CompositionStrategyPredictionTracker tracker(kConfig);
+    for (int i = 0; i < 20; i++) {
+        EXPECT_TRUE(tracker.shouldPredict());
+        tracker.onPredictionResult(i % 2 == 0);
+    }
+    EXPECT_FALSE(tracker.isPaused());
+}
+
+TEST(CompositionStrategyPredictionTrackerTest, pausesBelowMinHitRateAndResumes) {
+    CompositionStrategyPredictionTracker tracker(kConfig);
+    tracker.onPredictionResult(true);
+    tracker.onPredictionResult(false);
+    tracker.onPredictionResult(false);
+    EXPECT_FALSE(tracker.isPaused());
+    tracker.onPredictionResult(false);
+    EXPECT_TRUE(tracker.isPaused());
+    EXPECT_EQ(1u, tracker.getStats().pauses);
+
+    for (size_t i = 0; i < kConfig.pausedFrames; i++) {
+        EXPECT_FALSE(tracker.shouldPredict());
+    }
+    EXPECT_FALSE(tracker.isPaused());
+    EXPECT_TRUE(tracker.shouldPredict());
+
+    // The predictions before the pause are forgotten, so a single miss does not pause again.
+    tracker.onPredictionResult(false);
+    EXPECT_FALSE(tracker.isPaused());
+}
+
+TEST(CompositionStrategyPredictionTrackerTest, countsTimeOfMispredictedCompositions) {
+    CompositionStrategyPredictionTracker tracker;
+    tracker.onMispredictedComposition(100, std::make_shared<FenceTime>(nsecs_t{350}));
+    tracker.onMispredictedComposition(400, std::make_shared<FenceTime>(nsecs_t{500}));
+
+    EXPECT_EQ(350, tracker.getStats().wastedCompositionTime);
+}
+
+TEST(CompositionStrategyPredictionTrackerTest, ignoresInvalidFences) {
+    CompositionStrategyPredictionTracker tracker;
+    tracker.onMispredictedComposition(100, FenceTime::NO_FENCE);
+
+    EXPECT_EQ(0, tracker.getStats().wastedCompositionTime);
+}
+
+TEST(CompositionStrategyPredictionTrackerTest, dumpsStats) {
+    CompositionStrategyPredictionTracker tracker;
+    tracker.onPredictionResult(true);
+    tracker.onPredictionResult(false);
+
+    std::string out;
+    tracker.dump(out);
+    EXPECT_NE(std::string::npos, out.find("2 predictions, 1 hits (50.00% hit rate)"));
+}
+
+} // namespace
+} // namespace android::compositionengine
@@ -166,6 +166,7 @@ struct DisplayTestCommon : public testing::Test {
 
     DisplayTestCommon() {
         EXPECT_CALL(mCompositionEngine, getHwComposer()).WillRepeatedly(ReturnRef(mHwComposer));
+        EXPECT_CALL(mCompositionEngine, getTimeStats()).WillRepeatedly(Return(nullptr));
         EXPECT_CALL(mCompositionEngine, getRenderEngine()).WillRepeatedly(ReturnRef(mRenderEngine));
         EXPECT_CALL(mRenderEngine, supportsProtectedContent()).WillRepeatedly(Return(false));
         EXPECT_CALL(mRenderEngine, isProtected()).WillRepeatedly(Return(false));
@@ -580,10 +581,15 @@ TEST_F(DisplayChooseCompositionStrategyTest, takesEarlyOutIfGpuDisplay) {
 }
 
 TEST_F(DisplayChooseCompositionStrategyTest, takesEarlyOutOnHwcError) {
+    StrictMock<mock::OutputLayer> outputLayer;
+
     EXPECT_CALL(*mDisplay, anyLayersRequireClientComposition()).WillOnce(Return(false));
     EXPECT_CALL(mHwComposer,
                 getDeviceCompositionChanges(HalDisplayId(DEFAULT_DISPLAY_ID), false, _, _, _, _))
             .WillOnce(Return(INVALID_OPERATION));
+    // The HWC may not have applied the state of the layers, so all of it is sent next frame.
+    EXPECT_CALL(*mDisplay, getOutputLayerOrderedByZByIndex(0u)).WillOnce(Return(&outputLayer));
+    EXPECT_CALL(outputLayer, forceResendStateToHWC());
 
     chooseCompositionStrategy(mDisplay.get());
 
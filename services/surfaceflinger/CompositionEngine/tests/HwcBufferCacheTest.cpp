@@ -85,6 +85,84 @@ TEST_F(HwcBufferCacheTest, getHwcSlotAndBuffer_whenSlotsFull_evictsOldestCachedB
     EXPECT_EQ(cache.uncache(graphicBuffers[0]->getId()), UINT32_MAX);
 }
 
+TEST_F(HwcBufferCacheTest, getHwcSlotAndBuffer_whenSlotsFull_keepsReusedBuffer) {
+    HwcBufferCache cache;
+
+    // The first buffer is sent twice, so it is expected to be sent again.
+    HwcSlotAndBuffer reusedSlotAndBuffer = cache.getHwcSlotAndBuffer(mBuffer1);
+    ASSERT_EQ(cache.getHwcSlotAndBuffer(mBuffer1).buffer, nullptr);
+
+    sp<GraphicBuffer> graphicBuffers[100];
+    HwcSlotAndBuffer slotsAndBuffers[100];
+    int firstEvictingIndex = -1;
+    for (int i = 0; i < 100; ++i) {
+        graphicBuffers[i] = sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u);
+        slotsAndBuffers[i] = cache.getHwcSlotAndBuffer(graphicBuffers[i]);
+        if (i > 0 && slotsAndBuffers[i].slot == slotsAndBuffers[0].slot) {
+            firstEvictingIndex = i;
+            break;
+        }
+    }
+    // The oldest buffer that was only sent once was evicted instead of the reused buffer, even
+    // though the reused buffer was used less recently.
+    ASSERT_GT(firstEvictingIndex, 1);
+    EXPECT_EQ(cache.getStats().evictions, 1u);
+    HwcSlotAndBuffer finalSlotAndBuffer = cache.getHwcSlotAndBuffer(mBuffer1);
+    EXPECT_EQ(finalSlotAndBuffer.slot, reusedSlotAndBuffer.slot);
+    EXPECT_EQ(finalSlotAndBuffer.buffer, nullptr);
+}
+
+TEST_F(HwcBufferCacheTest, getHwcSlotAndBuffer_whenSlotsFull_evictsBufferUnusedForAWhile) {
+    HwcBufferCache cache;
+
+    HwcSlotAndBuffer reusedSlotAndBuffer = cache.getHwcSlotAndBuffer(mBuffer1);
+    ASSERT_EQ(cache.getHwcSlotAndBuffer(mBuffer1).buffer, nullptr);
+
+    // Keep sending two buffers for longer than it takes to cycle through all the slots, so that
+    // the first buffer is no longer considered in use.
+    for (int i = 0; i < 100; ++i) {
+        cache.getHwcSlotAndBuffer(mBuffer2);
+    }
+
+    bool evictedReusedBuffer = false;
+    for (int i = 0; i < 100 && !evictedReusedBuffer; ++i) {
+        auto buffer = sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u);
+        evictedReusedBuffer = cache.getHwcSlotAndBuffer(buffer).slot == reusedSlotAndBuffer.slot;
+    }
+    EXPECT_TRUE(evictedReusedBuffer);
+    EXPECT_EQ(cache.uncache(mBuffer1->getId()), UINT32_MAX);
+}
+
+TEST_F(HwcBufferCacheTest, getStats_countsHitsAndMisses) {
+    HwcBufferCache cache;
+
+    cache.getHwcSlotAndBuffer(mBuffer1);
+    cache.getHwcSlotAndBuffer(mBuffer1);
+    cache.getHwcSlotAndBuffer(mBuffer2);
+    cache.getHwcSlotAndBuffer(mBuffer1);
+
+    EXPECT_EQ(cache.getStats().hits, 2u);
+    EXPECT_EQ(cache.getStats().misses, 2u);
+    EXPECT_EQ(cache.getStats().evictions, 0u);
+}
+
+TEST_F(HwcBufferCacheTest, uncacheBatch_returnsActiveBufferSlotLast) {
+    HwcBufferCache cache;
+    sp<GraphicBuffer> buffer3 = sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u);
+
+    uint32_t slot1 = cache.getHwcSlotAndBuffer(mBuffer1).slot;
+    uint32_t slot2 = cache.getHwcSlotAndBuffer(mBuffer2).slot;
+
+    // The third buffer isn't cached, so it has no slot to clear.
+    std::vector<uint32_t> expectedSlots = {slot2, slot1};
+    EXPECT_EQ(cache.uncache({mBuffer1->getId(), buffer3->getId(), mBuffer2->getId()},
+                            /*activeBufferId*/ mBuffer1->getId()),
+              expectedSlots);
+    EXPECT_TRUE(cache.uncache({mBuffer1->getId(), mBuffer2->getId()},
+                              /*activeBufferId*/ mBuffer1->getId())
+                        .empty());
+}
+
 TEST_F(HwcBufferCacheTest, uncache_whenCached_returnsSlotNumber) {
     HwcBufferCache cache;
     sp<GraphicBuffer> outBuffer;
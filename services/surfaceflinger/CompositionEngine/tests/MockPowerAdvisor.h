@@ -41,6 +41,7 @@ public:
     MOCK_METHOD(bool, supportsGpuReporting, (), (override));
     MOCK_METHOD(void, updateTargetWorkDuration, (Duration targetDuration), (override));
     MOCK_METHOD(void, reportActualWorkDuration, (), (override));
+    MOCK_METHOD(std::optional<Duration>, getLastActualWorkDuration, (), (const, override));
     MOCK_METHOD(void, enablePowerHintSession, (bool enabled), (override));
     MOCK_METHOD(bool, startPowerHintSession, (std::vector<int32_t> && threadIds), (override));
     MOCK_METHOD(void, setGpuStartTime, (DisplayId displayId, TimePoint startTime), (override));
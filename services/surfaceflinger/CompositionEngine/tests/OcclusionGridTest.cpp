@@ -0,0 +1,82 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/OcclusionGrid.h>
+#include <gtest/gtest.h>
+
+namespace android::compositionengine {
+namespace {
+
+const Rect kBounds{0, 0, 1000, 600};
+
+TEST(OcclusionGridTest, emptyGridOccludesNothing) {
+    OcclusionGrid grid(kBounds);
+    EXPECT_FALSE(grid.isOccluded(Rect(10, 10, 20, 20)));
+    EXPECT_FALSE(grid.isOccluded(kBounds));
+}
+
+TEST(OcclusionGridTest, fullScreenRectOccludesEverythingInBounds) {
+    OcclusionGrid grid(kBounds);
+    grid.addOpaqueRect(kBounds);
+
+    EXPECT_TRUE(grid.isOccluded(kBounds));
+    EXPECT_TRUE(grid.isOccluded(Rect(10, 10, 20, 20)));
+    EXPECT_TRUE(grid.isOccluded(Rect(990, 590, 1000, 600)));
+    // Nothing is known outside the bounds.
+    EXPECT_FALSE(grid.isOccluded(Rect(990, 590, 1010, 600)));
+    EXPECT_FALSE(grid.isOccluded(Rect(-5, 0, 10, 10)));
+}
+
+TEST(OcclusionGridTest, partiallyCoveredTilesAreNotMarked) {
+    OcclusionGrid grid(kBounds);
+    // The tiles are 16x10, this rect doesn't cover any of them completely.
+    grid.addOpaqueRect(Rect(1, 1, 15, 9));
+    EXPECT_FALSE(grid.isOccluded(Rect(2, 2, 4, 4)));
+
+    grid.addOpaqueRect(Rect(0, 0, 32, 20));
+    EXPECT_TRUE(grid.isOccluded(Rect(2, 2, 4, 4)));
+    EXPECT_TRUE(grid.isOccluded(Rect(0, 0, 32, 20)));
+    EXPECT_FALSE(grid.isOccluded(Rect(0, 0, 33, 20)));
+    EXPECT_FALSE(grid.isOccluded(Rect(0, 0, 32, 21)));
+}
+
+TEST(OcclusionGridTest, combinesAdjacentRects) {
+    OcclusionGrid grid(kBounds);
+    grid.addOpaqueRect(Rect(0, 0, 500, 600));
+    EXPECT_FALSE(grid.isOccluded(Rect(400, 100, 600, 200)));
+
+    grid.addOpaqueRect(Rect(496, 0, 1000, 600));
+    EXPECT_TRUE(grid.isOccluded(Rect(400, 100, 600, 200)));
+    EXPECT_TRUE(grid.isOccluded(kBounds));
+}
+
+TEST(OcclusionGridTest, handlesBoundsNotAtOrigin) {
+    const Rect bounds{100, 200, 163, 230};
+    OcclusionGrid grid(bounds);
+    grid.addOpaqueRect(Rect(120, 200, 200, 230));
+
+    EXPECT_TRUE(grid.isOccluded(Rect(120, 200, 163, 230)));
+    EXPECT_FALSE(grid.isOccluded(Rect(119, 200, 163, 230)));
+}
+
+TEST(OcclusionGridTest, invalidBoundsOccludeNothing) {
+    OcclusionGrid grid(Rect::INVALID_RECT);
+    grid.addOpaqueRect(kBounds);
+    EXPECT_FALSE(grid.isOccluded(Rect(10, 10, 20, 20)));
+}
+
+} // namespace
+} // namespace android::compositionengine
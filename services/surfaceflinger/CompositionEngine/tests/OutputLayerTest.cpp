@@ -901,6 +901,32 @@ struct OutputLayerWriteStateToHWCTest : public OutputLayerTest {
                 .WillOnce(Return(kError));
     }
 
+    // Expects every geometry and per-frame call, and has the HWC accept all of them.
+    void expectAllStateAccepted() {
+        EXPECT_CALL(*mHwcLayer, setDisplayFrame(kDisplayFrame)).WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setSourceCrop(kSourceCrop)).WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setZOrder(_)).WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setTransform(kBufferTransform)).WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setBlendMode(kBlendMode)).WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setPlaneAlpha(kAlpha)).WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setVisibleRegion(RegionEq(kOutputSpaceVisibleRegion)))
+                .WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setDataspace(kDataspace)).WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setBrightness(kLayerBrightness))
+                .WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setColorTransform(kColorTransform))
+                .WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setBlockingRegion(RegionEq(Region())))
+                .WillOnce(Return(hal::Error::NONE));
+        expectSurfaceDamageCall();
+    }
+
+    // The surface damage goes with the buffer of the frame, so it is sent every frame.
+    void expectSurfaceDamageCall() {
+        EXPECT_CALL(*mHwcLayer, setSurfaceDamage(RegionEq(kSurfaceDamage)))
+                .WillOnce(Return(hal::Error::NONE));
+    }
+
     void expectSetCompositionTypeCall(Composition compositionType) {
         EXPECT_CALL(*mHwcLayer, setCompositionType(compositionType)).WillOnce(Return(kError));
     }
@@ -1331,6 +1357,63 @@ TEST_F(OutputLayerWriteStateToHWCTest, setCompositionTypeRefreshRateIndicator) {
                                  /*zIsOverridden*/ false, /*isPeekingThrough*/ false);
 }
 
+TEST_F(OutputLayerWriteStateToHWCTest, unchangedStateIsNotResent) {
+    expectNoSetCompositionTypeCall();
+    EXPECT_CALL(mLayerFE, hasRoundedCorners()).WillRepeatedly(Return(false));
+
+    expectAllStateAccepted();
+    mOutputLayer.writeStateToHWC(/*includeGeometry*/ true, /*skipLayer*/ false, 0,
+                                 /*zIsOverridden*/ false, /*isPeekingThrough*/ false);
+    Mock::VerifyAndClearExpectations(mHwcLayer.get());
+
+    expectSurfaceDamageCall();
+    mOutputLayer.writeStateToHWC(/*includeGeometry*/ true, /*skipLayer*/ false, 0,
+                                 /*zIsOverridden*/ false, /*isPeekingThrough*/ false);
+    Mock::VerifyAndClearExpectations(mHwcLayer.get());
+
+    // Only what changed is sent.
+    const Rect displayFrame{1101, 1102, 1103, 11044};
+    mOutputLayer.editState().displayFrame = displayFrame;
+    mOutputLayer.editState().dataspace = kOverrideDataspace;
+    EXPECT_CALL(*mHwcLayer, setDisplayFrame(displayFrame)).WillOnce(Return(hal::Error::NONE));
+    EXPECT_CALL(*mHwcLayer, setDataspace(kOverrideDataspace)).WillOnce(Return(hal::Error::NONE));
+    expectSurfaceDamageCall();
+    mOutputLayer.writeStateToHWC(/*includeGeometry*/ true, /*skipLayer*/ false, 0,
+                                 /*zIsOverridden*/ false, /*isPeekingThrough*/ false);
+}
+
+TEST_F(OutputLayerWriteStateToHWCTest, failedStateIsResent) {
+    expectNoSetCompositionTypeCall();
+    EXPECT_CALL(mLayerFE, hasRoundedCorners()).WillRepeatedly(Return(false));
+
+    expectGeometryCommonCalls();
+    expectPerFrameCommonCalls();
+    mOutputLayer.writeStateToHWC(/*includeGeometry*/ true, /*skipLayer*/ false, 0,
+                                 /*zIsOverridden*/ false, /*isPeekingThrough*/ false);
+    Mock::VerifyAndClearExpectations(mHwcLayer.get());
+
+    expectGeometryCommonCalls();
+    expectPerFrameCommonCalls();
+    mOutputLayer.writeStateToHWC(/*includeGeometry*/ true, /*skipLayer*/ false, 0,
+                                 /*zIsOverridden*/ false, /*isPeekingThrough*/ false);
+}
+
+TEST_F(OutputLayerWriteStateToHWCTest, forceResendStateToHWCResendsAllState) {
+    expectNoSetCompositionTypeCall();
+    EXPECT_CALL(mLayerFE, hasRoundedCorners()).WillRepeatedly(Return(false));
+
+    expectAllStateAccepted();
+    mOutputLayer.writeStateToHWC(/*includeGeometry*/ true, /*skipLayer*/ false, 0,
+                                 /*zIsOverridden*/ false, /*isPeekingThrough*/ false);
+    Mock::VerifyAndClearExpectations(mHwcLayer.get());
+
+    mOutputLayer.forceResendStateToHWC();
+
+    expectAllStateAccepted();
+    mOutputLayer.writeStateToHWC(/*includeGeometry*/ true, /*skipLayer*/ false, 0,
+                                 /*zIsOverridden*/ false, /*isPeekingThrough*/ false);
+}
+
 /*
  * OutputLayer::uncacheBuffers
  */
@@ -1418,6 +1501,19 @@ TEST_F(OutputLayerUncacheBufferTest, canUncacheAndReuseSlot) {
     Mock::VerifyAndClearExpectations(&mHwcLayer);
 }
 
+TEST_F(OutputLayerUncacheBufferTest, skipsClearingWhenNoBufferIsCached) {
+    mLayerFEState.buffer = kBuffer1;
+    EXPECT_CALL(mHwcLayer, setBuffer(/*slot*/ 0, kBuffer1, kFence));
+    mOutputLayer.writeStateToHWC(/*includeGeometry*/ false, /*skipLayer*/ false, 0,
+                                 /*zIsOverridden*/ false, /*isPeekingThrough*/ false);
+    Mock::VerifyAndClearExpectations(&mHwcLayer);
+
+    // The uncached buffers belong to other layers.
+    EXPECT_CALL(mHwcLayer, setBufferSlotsToClear(_, _)).Times(0);
+    mOutputLayer.uncacheBuffers({kBuffer2->getId(), kBuffer3->getId()});
+    Mock::VerifyAndClearExpectations(&mHwcLayer);
+}
+
 /*
  * OutputLayer::writeCursorPositionToHWC()
  */
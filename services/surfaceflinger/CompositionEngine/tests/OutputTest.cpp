@@ -3797,6 +3797,31 @@ TEST_F(OutputComposeSurfacesTest, renderDuplicateClientCompositionRequestsWithou
     EXPECT_FALSE(mOutput.mState.reusedClientComposition);
 }
 
+TEST_F(OutputComposeSurfacesTest, doesNotShareClientCompositionWithMirrorsByDefault) {
+    LayerFE::LayerSettings r1;
+    r1.geometry.boundaries = FloatRect{1, 2, 3, 4};
+
+    EXPECT_CALL(mOutput, getSkipColorTransform()).WillRepeatedly(Return(false));
+    EXPECT_CALL(*mDisplayColorProfile, hasWideColorGamut()).WillRepeatedly(Return(true));
+    EXPECT_CALL(mRenderEngine, supportsProtectedContent()).WillRepeatedly(Return(false));
+    EXPECT_CALL(mRenderEngine, isProtected()).WillRepeatedly(Return(false));
+    EXPECT_CALL(mOutput, generateClientCompositionRequests(_, kDefaultOutputDataspace, _))
+            .WillRepeatedly(Return(std::vector<LayerFE::LayerSettings>{r1}));
+    EXPECT_CALL(mOutput, appendRegionFlashRequests(RegionEq(kDebugRegion), _))
+            .WillRepeatedly(Return());
+    EXPECT_CALL(*mRenderSurface, dequeueBuffer(_)).WillRepeatedly(Return(mOutputBuffer));
+    EXPECT_CALL(mRenderEngine, drawLayers(_, ElementsAre(r1), _, _))
+            .WillOnce(Return(ByMove(ftl::yield<FenceResult>(Fence::NO_FENCE))));
+
+    verify().execute().expectAFenceWasReturned();
+
+    // Without debug.sf.share_mirror_client_composition, nothing is recorded for mirrors.
+    EXPECT_EQ(mOutput.findClientCompositionForMirror(/*refreshStartTime*/ 0,
+                                                     renderengine::DisplaySettings{},
+                                                     std::vector<LayerFE::LayerSettings>{r1}),
+              nullptr);
+}
+
 TEST_F(OutputComposeSurfacesTest, skipDuplicateClientCompositionRequests) {
     mOutput.cacheClientCompositionRequests(3);
     LayerFE::LayerSettings r1;
@@ -577,6 +577,71 @@ TEST_F(CachedSetTest, rendersWithOffsetFramebufferContent) {
     cachedSet.append(CachedSet(layer3));
 }
 
+TEST_F(CachedSetTest, rendersBoundsOnlyIntoBucketedTexture) {
+    // Skip the 0th layer to ensure that the bounding box of the layers is offset from (0, 0)
+    CachedSet::Layer& layer1 = *mTestLayers[1]->cachedSetLayer.get();
+    sp<mock::LayerFE> layerFE1 = mTestLayers[1]->layerFE;
+    CachedSet::Layer& layer2 = *mTestLayers[2]->cachedSetLayer.get();
+    sp<mock::LayerFE> layerFE2 = mTestLayers[2]->layerFE;
+
+    CachedSet cachedSet(layer1);
+    cachedSet.append(CachedSet(layer2));
+    ASSERT_EQ(Rect(1, 1, 3, 3), cachedSet.getBounds());
+
+    // An unrotated output whose layer stack is offset from the display.
+    const ui::Size displaySize(8, 8);
+    mTexturePool.setDisplaySize(displaySize);
+    mOutputState.displaySpace = ProjectionSpace(displaySize, Rect(displaySize));
+    mOutputState.framebufferSpace = ProjectionSpace(displaySize, Rect(displaySize));
+    mOutputState.layerStackSpace = ProjectionSpace(displaySize, Rect(2, 2, 10, 10));
+
+    const auto drawLayers = [&](const renderengine::DisplaySettings& displaySettings,
+                                const std::vector<renderengine::LayerSettings>&,
+                                const std::shared_ptr<renderengine::ExternalTexture>& texture,
+                                base::unique_fd&&) -> ftl::Future<FenceResult> {
+        EXPECT_EQ(Rect(2, 2), displaySettings.physicalDisplay);
+        EXPECT_EQ(Rect(3, 3, 5, 5), displaySettings.clip);
+        EXPECT_EQ(2u, texture->getBuffer()->getWidth());
+        EXPECT_EQ(2u, texture->getBuffer()->getHeight());
+        return ftl::yield<FenceResult>(Fence::NO_FENCE);
+    };
+
+    EXPECT_CALL(*layerFE1, prepareClientComposition(_))
+            .WillOnce(Return(std::optional<compositionengine::LayerFE::LayerSettings>()));
+    EXPECT_CALL(*layerFE2, prepareClientComposition(_))
+            .WillOnce(Return(std::optional<compositionengine::LayerFE::LayerSettings>()));
+    EXPECT_CALL(mRenderEngine, drawLayers(_, _, _, _)).WillOnce(Invoke(drawLayers));
+    cachedSet.render(mRenderEngine, mTexturePool, mOutputState, true, true);
+    expectReadyBuffer(cachedSet);
+
+    EXPECT_EQ(Rect(1, 1, 3, 3), cachedSet.getTextureBounds());
+    EXPECT_EQ(Rect(2, 2), cachedSet.getTextureSourceCrop());
+}
+
+TEST_F(CachedSetTest, rendersWholeDisplayForRotatedOutputs) {
+    CachedSet::Layer& layer1 = *mTestLayers[1]->cachedSetLayer.get();
+    sp<mock::LayerFE> layerFE1 = mTestLayers[1]->layerFE;
+
+    CachedSet cachedSet(layer1);
+
+    const auto drawLayers = [&](const renderengine::DisplaySettings& displaySettings,
+                                const std::vector<renderengine::LayerSettings>&,
+                                const std::shared_ptr<renderengine::ExternalTexture>&,
+                                base::unique_fd&&) -> ftl::Future<FenceResult> {
+        EXPECT_EQ(mOutputState.framebufferSpace.getContent(), displaySettings.physicalDisplay);
+        EXPECT_EQ(mOutputState.layerStackSpace.getContent(), displaySettings.clip);
+        return ftl::yield<FenceResult>(Fence::NO_FENCE);
+    };
+
+    EXPECT_CALL(*layerFE1, prepareClientComposition(_))
+            .WillOnce(Return(std::optional<compositionengine::LayerFE::LayerSettings>()));
+    EXPECT_CALL(mRenderEngine, drawLayers(_, _, _, _)).WillOnce(Invoke(drawLayers));
+    cachedSet.render(mRenderEngine, mTexturePool, mOutputState, true, true);
+    expectReadyBuffer(cachedSet);
+
+    EXPECT_EQ(Rect(kOutputSize.width, kOutputSize.height), cachedSet.getTextureBounds());
+}
+
 TEST_F(CachedSetTest, cachingHintIncludesLayersByDefault) {
     CachedSet cachedSet(*mTestLayers[0]->cachedSetLayer.get());
     EXPECT_FALSE(cachedSet.cachingHintExcludesLayers());
@@ -1140,6 +1140,120 @@ TEST_F(FlattenerRenderSchedulingTest, flattenLayers_renderCachedSets_defersUpToM
                                  true);
 }
 
+class FlattenerPredictiveRenderingTest : public FlattenerTest {
+public:
+    FlattenerPredictiveRenderingTest()
+          : FlattenerTest(
+                    Flattener::Tunables{.mActiveLayerTimeout = 100ms,
+                                        .mRenderScheduling = std::nullopt,
+                                        .mEnableHolePunch = true,
+                                        .mPredictiveRendering = Flattener::Tunables::
+                                                PredictiveRendering{.lead = 50ms}}) {}
+
+protected:
+    // Flattens the layers shortly before they become inactive, and renders the predicted cached
+    // set in the idle time after the frame.
+    void renderPredictedCachedSet(const std::vector<const LayerState*>& layers) {
+        mFlattener->setFlatteningPredicted(true);
+        mTime += 60ms;
+
+        initializeOverrideBuffer(layers);
+        EXPECT_EQ(getNonBufferHash(layers),
+                  mFlattener->flattenLayers(layers, getNonBufferHash(layers), mTime));
+        EXPECT_FALSE(mFlattener->getNewCachedSetForTesting());
+        ASSERT_TRUE(mFlattener->getPredictedCachedSetForTesting());
+
+        // Without a deadline there is no known idle time to render in.
+        EXPECT_CALL(mRenderEngine, drawLayers(_, _, _, _)).Times(0);
+        mFlattener->renderCachedSets(mOutputState, std::nullopt, true);
+
+        EXPECT_CALL(mRenderEngine, drawLayers(_, _, _, _))
+                .WillOnce(Return(ByMove(ftl::yield<FenceResult>(Fence::NO_FENCE))));
+        mFlattener->renderCachedSets(mOutputState, std::chrono::steady_clock::now() + 100ms,
+                                     true);
+        EXPECT_TRUE(mFlattener->getPredictedCachedSetForTesting()->hasRenderedBuffer());
+    }
+};
+
+TEST_F(FlattenerPredictiveRenderingTest, flattenLayers_usesPredictedCachedSet) {
+    auto& layerState1 = mTestLayers[0]->layerState;
+    auto& layerState2 = mTestLayers[1]->layerState;
+    const auto& overrideBuffer1 = layerState1->getOutputLayer()->getState().overrideInfo.buffer;
+    const auto& overrideBuffer2 = layerState2->getOutputLayer()->getState().overrideInfo.buffer;
+
+    const std::vector<const LayerState*> layers = {
+            layerState1.get(),
+            layerState2.get(),
+    };
+
+    initializeFlattener(layers);
+    renderPredictedCachedSet(layers);
+
+    // Once the layers are inactive, the flattened layers need no rendering.
+    mTime += 50ms;
+    EXPECT_CALL(mRenderEngine, drawLayers(_, _, _, _)).Times(0);
+    initializeOverrideBuffer(layers);
+    EXPECT_EQ(getNonBufferHash(layers),
+              mFlattener->flattenLayers(layers, getNonBufferHash(layers), mTime));
+    ASSERT_TRUE(mFlattener->getNewCachedSetForTesting());
+    EXPECT_TRUE(mFlattener->getNewCachedSetForTesting()->hasRenderedBuffer());
+    EXPECT_FALSE(mFlattener->getPredictedCachedSetForTesting());
+    mFlattener->renderCachedSets(mOutputState, std::nullopt, true);
+
+    initializeOverrideBuffer(layers);
+    EXPECT_NE(getNonBufferHash(layers),
+              mFlattener->flattenLayers(layers, getNonBufferHash(layers), mTime));
+    EXPECT_NE(nullptr, overrideBuffer1);
+    EXPECT_EQ(overrideBuffer1, overrideBuffer2);
+
+    std::string dump;
+    mFlattener->dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("Predicted cached sets rendered: 1"));
+    EXPECT_NE(std::string::npos, dump.find("Used:   1"));
+}
+
+TEST_F(FlattenerPredictiveRenderingTest, flattenLayers_dropsPredictedCachedSetOnBufferUpdate) {
+    auto& layerState1 = mTestLayers[0]->layerState;
+    auto& layerState2 = mTestLayers[1]->layerState;
+
+    const std::vector<const LayerState*> layers = {
+            layerState1.get(),
+            layerState2.get(),
+    };
+
+    initializeFlattener(layers);
+    renderPredictedCachedSet(layers);
+
+    layerState1->resetFramesSinceBufferUpdate();
+    mFlattener->setFlatteningPredicted(false);
+    initializeOverrideBuffer(layers);
+    EXPECT_EQ(getNonBufferHash(layers),
+              mFlattener->flattenLayers(layers, getNonBufferHash(layers), mTime));
+    EXPECT_FALSE(mFlattener->getPredictedCachedSetForTesting());
+
+    std::string dump;
+    mFlattener->dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("Wasted: 1"));
+}
+
+TEST_F(FlattenerPredictiveRenderingTest, flattenLayers_onlyPredictsWhenFlatteningIsPredicted) {
+    auto& layerState1 = mTestLayers[0]->layerState;
+    auto& layerState2 = mTestLayers[1]->layerState;
+
+    const std::vector<const LayerState*> layers = {
+            layerState1.get(),
+            layerState2.get(),
+    };
+
+    initializeFlattener(layers);
+
+    mTime += 60ms;
+    initializeOverrideBuffer(layers);
+    EXPECT_EQ(getNonBufferHash(layers),
+              mFlattener->flattenLayers(layers, getNonBufferHash(layers), mTime));
+    EXPECT_FALSE(mFlattener->getPredictedCachedSetForTesting());
+}
+
 TEST_F(FlattenerTest, flattenLayers_skipsLayersDisabledFromCaching) {
     auto& layerState1 = mTestLayers[0]->layerState;
     const auto& overrideBuffer1 = layerState1->getOutputLayer()->getState().overrideInfo.buffer;
@@ -571,5 +571,32 @@ TEST_F(PredictorTest, recordMissedPlan_skipsApproximateMatch) {
     EXPECT_FALSE(predictedPlanTwo);
 }
 
+TEST_F(PredictorTest, isLikelyToFlatten_followsFlatteningHistory) {
+    Predictor predictor;
+    constexpr NonBufferHash kHashOne = 0x1;
+    constexpr NonBufferHash kHashTwo = 0x2;
+
+    EXPECT_FALSE(predictor.isLikelyToFlatten(kHashOne));
+
+    // The first observation of kHashOne flattens after a few frames.
+    predictor.recordFlattening(kHashOne, false);
+    predictor.recordFlattening(kHashOne, false);
+    predictor.recordFlattening(kHashOne, true);
+    predictor.recordFlattening(kHashOne, true);
+    EXPECT_TRUE(predictor.isLikelyToFlatten(kHashOne));
+
+    // kHashTwo never flattens.
+    predictor.recordFlattening(kHashTwo, false);
+    EXPECT_FALSE(predictor.isLikelyToFlatten(kHashTwo));
+
+    // The second observation of kHashOne has not flattened yet, which is still half of them.
+    predictor.recordFlattening(kHashOne, false);
+    EXPECT_TRUE(predictor.isLikelyToFlatten(kHashOne));
+
+    predictor.recordFlattening(kHashTwo, false);
+    predictor.recordFlattening(kHashOne, false);
+    EXPECT_FALSE(predictor.isLikelyToFlatten(kHashOne));
+}
+
 } // namespace
 } // namespace android::compositionengine::impl::planner
@@ -27,6 +27,7 @@ namespace {
 
 const ui::Size kDisplaySize(1, 1);
 const ui::Size kDisplaySizeTwo(2, 2);
+const ui::Size kDisplaySizeFour(4, 4);
 
 class TestableTexturePool : public TexturePool {
 public:
@@ -35,6 +36,9 @@ public:
     size_t getMinPoolSize() const { return kMinPoolSize; }
     size_t getMaxPoolSize() const { return kMaxPoolSize; }
     size_t getPoolSize() const { return mPool.size(); }
+    size_t getPoolBytes() const { return TexturePool::getPoolBytes(); }
+    size_t getBudgetBytes() const { return TexturePool::getBudgetBytes(); }
+    std::chrono::steady_clock::duration getIdleTimeout() const { return kIdleTimeout; }
 };
 
 struct TexturePoolTest : public testing::Test {
@@ -170,5 +174,96 @@ TEST_F(TexturePoolTest, reallocatesWhenReEnabled) {
     EXPECT_EQ(mTexturePool.getPoolSize(), mTexturePool.getMinPoolSize());
 }
 
+TEST_F(TexturePoolTest, roundsUpToBucketSizes) {
+    mTexturePool.setDisplaySize(ui::Size(100, 40));
+
+    EXPECT_EQ(ui::Size(25, 10), mTexturePool.getBucketSize(ui::Size(1, 1)));
+    EXPECT_EQ(ui::Size(50, 30), mTexturePool.getBucketSize(ui::Size(26, 21)));
+    EXPECT_EQ(ui::Size(100, 40), mTexturePool.getBucketSize(ui::Size(76, 31)));
+    // Sizes larger than the display are clamped to it.
+    EXPECT_EQ(ui::Size(100, 40), mTexturePool.getBucketSize(ui::Size(200, 80)));
+
+    auto texture = mTexturePool.borrowTexture(ui::Size(26, 21));
+    EXPECT_EQ(50u, texture->get()->getBuffer()->getWidth());
+    EXPECT_EQ(30u, texture->get()->getBuffer()->getHeight());
+}
+
+TEST_F(TexturePoolTest, reusesTexturesOfTheSameBucket) {
+    mTexturePool.setDisplaySize(kDisplaySizeFour);
+
+    uint64_t smallId;
+    {
+        auto texture = mTexturePool.borrowTexture(ui::Size(1, 1));
+        smallId = texture->get()->getBuffer()->getId();
+    }
+
+    auto fullTexture = mTexturePool.borrowTexture();
+    EXPECT_NE(smallId, fullTexture->get()->getBuffer()->getId());
+
+    auto smallTexture = mTexturePool.borrowTexture(ui::Size(1, 1));
+    EXPECT_EQ(smallId, smallTexture->get()->getBuffer()->getId());
+}
+
+TEST_F(TexturePoolTest, retainsMoreSmallTexturesWithinBudget) {
+    mTexturePool.setDisplaySize(kDisplaySizeFour);
+
+    std::vector<std::shared_ptr<TexturePool::AutoTexture>> textures;
+    for (size_t i = 0; i < 2 * mTexturePool.getMaxPoolSize(); i++) {
+        textures.emplace_back(mTexturePool.borrowTexture(ui::Size(1, 1)));
+    }
+    textures.clear();
+
+    EXPECT_EQ(mTexturePool.getMinPoolSize() + 2 * mTexturePool.getMaxPoolSize(),
+              mTexturePool.getPoolSize());
+    EXPECT_LE(mTexturePool.getPoolBytes(), mTexturePool.getBudgetBytes());
+}
+
+TEST_F(TexturePoolTest, evictsLeastRecentlyReturnedTexturesOverBudget) {
+    std::deque<std::shared_ptr<TexturePool::AutoTexture>> textures;
+    for (size_t i = 0; i < mTexturePool.getMaxPoolSize() + 1; i++) {
+        textures.emplace_back(mTexturePool.borrowTexture());
+    }
+    const uint64_t firstId = textures.front()->get()->getBuffer()->getId();
+    while (!textures.empty()) {
+        textures.pop_front();
+    }
+
+    EXPECT_EQ(mTexturePool.getMaxPoolSize(), mTexturePool.getPoolSize());
+    EXPECT_EQ(mTexturePool.getBudgetBytes(), mTexturePool.getPoolBytes());
+
+    for (size_t i = 0; i < mTexturePool.getMaxPoolSize(); i++) {
+        textures.emplace_back(mTexturePool.borrowTexture());
+        EXPECT_NE(firstId, textures.back()->get()->getBuffer()->getId());
+    }
+}
+
+TEST_F(TexturePoolTest, trimsIdleTexturesDownToMinPool) {
+    std::vector<std::shared_ptr<TexturePool::AutoTexture>> textures;
+    for (size_t i = 0; i < mTexturePool.getMaxPoolSize(); i++) {
+        textures.emplace_back(mTexturePool.borrowTexture());
+    }
+    textures.clear();
+    EXPECT_EQ(mTexturePool.getMaxPoolSize(), mTexturePool.getPoolSize());
+
+    const auto now = std::chrono::steady_clock::now();
+    mTexturePool.trimIdle(now);
+    EXPECT_EQ(mTexturePool.getMaxPoolSize(), mTexturePool.getPoolSize());
+
+    mTexturePool.trimIdle(now + mTexturePool.getIdleTimeout() + std::chrono::seconds(1));
+    EXPECT_EQ(mTexturePool.getMinPoolSize(), mTexturePool.getPoolSize());
+}
+
+TEST_F(TexturePoolTest, dumpsBucketHitsAndMisses) {
+    mTexturePool.setDisplaySize(kDisplaySizeFour);
+    mTexturePool.borrowTexture(ui::Size(1, 1));
+    mTexturePool.borrowTexture(ui::Size(1, 1));
+    mTexturePool.borrowTexture();
+
+    std::string dump;
+    mTexturePool.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("Bucket [1, 1]: 1 hits, 1 misses"));
+    EXPECT_NE(std::string::npos, dump.find("Bucket [4, 4]: 1 hits, 0 misses"));
+}
+
 } // namespace
 } // namespace android::compositionengine::impl::planner
@@ -22,6 +22,8 @@
 
 #include <SurfaceFlingerProperties.h>
 #include <android-base/file.h>
+#include <android-base/properties.h>
+#include <android-base/stringprintf.h>
 #include <android/binder_ibinder_platform.h>
 #include <android/binder_manager.h>
 #include <common/FlagManager.h>
@@ -49,6 +51,7 @@ using aidl::android::hardware::graphics::composer3::PowerMode;
 using aidl::android::hardware::graphics::composer3::VirtualDisplay;
 
 using aidl::android::hardware::graphics::composer3::CommandResultPayload;
+using aidl::android::hardware::graphics::composer3::DisplayCommand;
 
 using AidlColorMode = aidl::android::hardware::graphics::composer3::ColorMode;
 using AidlContentType = aidl::android::hardware::graphics::composer3::ContentType;
@@ -282,6 +285,8 @@ AidlComposer::AidlComposer(const std::string& serviceName) {
         mEnableLayerCommandBatchingFlag =
                 FlagManager::getInstance().enable_layer_command_batching();
     }
+    mBatchDisplayCommands =
+            base::GetBoolProperty(std::string("debug.sf.hwc_batch_display_commands"), false);
     ALOGI("Loaded AIDL composer3 HAL service");
 }
 
@@ -341,7 +346,37 @@ std::string AidlComposer::dumpDebugInfo() {
     std::string hash;
     mAidlComposer->getInterfaceHash(&hash);
     return std::string(mAidlComposer->descriptor) +
-            " version:" + std::to_string(mComposerInterfaceVersion) + " hash:" + hash + str;
+            " version:" + std::to_string(mComposerInterfaceVersion) + " hash:" + hash + str +
+            dumpCommandStats();
+}
+
+std::string AidlComposer::dumpCommandStats() const {
+    const uint64_t executeCalls = mCommandStats.executeCalls.load(std::memory_order_relaxed);
+    const uint64_t frames = mCommandStats.frames.load(std::memory_order_relaxed);
+    const uint64_t commands = mCommandStats.commands.load(std::memory_order_relaxed);
+    const auto perFrame = [frames](uint64_t count) {
+        return frames == 0 ? 0.0 : static_cast<double>(count) / static_cast<double>(frames);
+    };
+    const auto latency = mCommandStats.executeLatency.summarize();
+
+    std::string result = "\nHAL command stats:\n";
+    base::StringAppendF(&result, "  Display command batching: %s\n",
+                        mBatchDisplayCommands ? "enabled" : "disabled");
+    base::StringAppendF(&result,
+                        "  executeCommands calls: %" PRIu64 " (%.2f per frame), frames: %" PRIu64
+                        ", displays batched: %" PRIu64 "\n",
+                        executeCalls, perFrame(executeCalls), frames,
+                        mCommandStats.batchedDisplays.load(std::memory_order_relaxed));
+    base::StringAppendF(&result,
+                        "  Commands: %" PRIu64 " (%.2f per frame), layer commands: %" PRIu64 "\n",
+                        commands, perFrame(commands),
+                        mCommandStats.layerCommands.load(std::memory_order_relaxed));
+    base::StringAppendF(&result,
+                        "  executeCommands latency (us): p50 %" PRId64 ", p90 %" PRId64
+                        ", p99 %" PRId64 ", max %" PRId64 "\n",
+                        ns2us(latency.p50), ns2us(latency.p90), ns2us(latency.p99),
+                        ns2us(latency.max));
+    return result;
 }
 
 void AidlComposer::registerCallback(HWC2::ComposerCallback& callback) {
@@ -1139,10 +1174,33 @@ Error AidlComposer::execute(Display display) {
     if (commands.empty()) {
         return Error::NONE;
     }
+    const size_t displayCommandCount = commands.size();
+    if (mBatchDisplayCommands && mSingleReader) {
+        mCommandStats.batchedDisplays.fetch_add(takeOtherDisplaysPendingCommands(display,
+                                                                                 commands),
+                                                std::memory_order_relaxed);
+    }
+
+    size_t layerCommandCount = 0;
+    size_t frameCount = 0;
+    for (const auto& command : commands) {
+        layerCommandCount += command.layers.size();
+        // Every frame of a display starts with either a validate or a presentOrValidate, which
+        // may be followed by a present.
+        if (command.validateDisplay || command.presentOrValidateDisplay) {
+            frameCount++;
+        }
+    }
+    mCommandStats.executeCalls.fetch_add(1, std::memory_order_relaxed);
+    mCommandStats.frames.fetch_add(frameCount, std::memory_order_relaxed);
+    mCommandStats.commands.fetch_add(commands.size(), std::memory_order_relaxed);
+    mCommandStats.layerCommands.fetch_add(layerCommandCount, std::memory_order_relaxed);
 
     { // scope for results
         std::vector<CommandResultPayload> results;
+        const nsecs_t startTime = systemTime();
         auto status = mAidlComposerClient->executeCommands(commands, &results);
+        mCommandStats.executeLatency.record(systemTime() - startTime);
         if (!status.isOk()) {
             ALOGE("executeCommands failed %s", status.getDescription().c_str());
             return static_cast<Error>(status.getServiceSpecificError());
@@ -1160,7 +1218,11 @@ Error AidlComposer::execute(Display display) {
         }
 
         const auto& command = commands[index];
-        if (command.validateDisplay || command.presentDisplay || command.presentOrValidateDisplay) {
+        // Only the errors of this display's commands are returned. The commands that were batched
+        // in from other displays never validate or present, so their errors are only logged.
+        if (index < displayCommandCount &&
+            (command.validateDisplay || command.presentDisplay ||
+             command.presentOrValidateDisplay)) {
             error = translate<Error>(cmdErr.errorCode);
         } else {
             ALOGW("command '%s' generated error %" PRId32, command.toString().c_str(),
@@ -1633,6 +1695,24 @@ Error AidlComposer::getPhysicalDisplayOrientation(Display displayId,
     return Error::NONE;
 }
 
+size_t AidlComposer::takeOtherDisplaysPendingCommands(Display display,
+                                                      std::vector<DisplayCommand>& commands) {
+    size_t displayCount = 0;
+    for (auto& [otherDisplay, writer] : mWriters) {
+        if (otherDisplay == display) {
+            continue;
+        }
+        auto otherCommands = writer.takePendingCommands();
+        if (otherCommands.empty()) {
+            continue;
+        }
+        commands.insert(commands.end(), std::make_move_iterator(otherCommands.begin()),
+                        std::make_move_iterator(otherCommands.end()));
+        displayCount++;
+    }
+    return displayCount;
+}
+
 ftl::Optional<std::reference_wrapper<ComposerClientWriter>> AidlComposer::getWriter(Display display)
         REQUIRES_SHARED(mMutex) {
     return mWriters.get(display);
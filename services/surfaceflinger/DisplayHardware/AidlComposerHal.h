@@ -17,10 +17,12 @@
 #pragma once
 
 #include "ComposerHal.h"
+#include "../TimeStats/LatencyHistogram.h"
 
 #include <ftl/shared_mutex.h>
 #include <ui/DisplayMap.h>
 
+#include <atomic>
 #include <functional>
 #include <optional>
 #include <string>
@@ -258,6 +260,14 @@ private:
     // this function to execute the command queue.
     Error execute(Display) REQUIRES_SHARED(mMutex);
 
+    // Moves the pending commands of all displays other than the given one to the end of commands,
+    // so that a single executeCommands call flushes them. Returns the number of displays whose
+    // commands were added.
+    size_t takeOtherDisplaysPendingCommands(
+            Display, std::vector<aidl::android::hardware::graphics::composer3::DisplayCommand>&)
+            REQUIRES_SHARED(mMutex);
+    std::string dumpCommandStats() const;
+
     // returns the default instance name for the given service
     static std::string instance(const std::string& serviceName);
 
@@ -301,6 +311,23 @@ private:
 
     int32_t mComposerInterfaceVersion = 1;
     bool mEnableLayerCommandBatchingFlag = false;
+    // Flush the pending commands of every display whenever any display executes its commands,
+    // which saves a HAL round trip for each other display that has commands queued. Only used with
+    // a single reader, which can demultiplex the results of all displays. This can be set by
+    // debug.sf.hwc_batch_display_commands
+    bool mBatchDisplayCommands = false;
+
+    // HAL command traffic, reported in dumpDebugInfo.
+    struct CommandStats {
+        std::atomic<uint64_t> executeCalls = 0;
+        std::atomic<uint64_t> frames = 0;
+        std::atomic<uint64_t> commands = 0;
+        std::atomic<uint64_t> layerCommands = 0;
+        // The number of other displays whose commands were flushed by another display's call.
+        std::atomic<uint64_t> batchedDisplays = 0;
+        LatencyHistogram executeLatency;
+    };
+    CommandStats mCommandStats;
     std::atomic<int64_t> mLayerID = 1;
 
     // Buffer slots for layers are cleared by setting the slot buffer to this buffer.
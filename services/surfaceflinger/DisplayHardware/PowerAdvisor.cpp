@@ -320,7 +320,8 @@ void PowerAdvisor::updateTargetWorkDuration(Duration targetDuration) {
 }
 
 void PowerAdvisor::reportActualWorkDuration() {
-    if (!mBootFinished || !sUseReportActualDuration || !usePowerHintSession()) {
+    mLastActualWorkDuration.reset();
+    if (!mBootFinished || !usePowerHintSession()) {
         ALOGV("Actual work duration power hint cannot be sent, skipping");
         return;
     }
@@ -330,6 +331,11 @@ void PowerAdvisor::reportActualWorkDuration() {
         ALOGV("Failed to send actual work duration, skipping");
         return;
     }
+    mLastActualWorkDuration = Duration::fromNs(actualDuration->durationNanos);
+    if (!sUseReportActualDuration) {
+        ALOGV("Actual work duration power hint reporting is disabled, skipping");
+        return;
+    }
     actualDuration->durationNanos += sTargetSafetyMargin.ns();
     if (sTraceHintSessionData) {
         SFTRACE_INT64("Measured duration", actualDuration->durationNanos);
@@ -551,6 +557,11 @@ void PowerAdvisor::setCompositeEnd(TimePoint compositeEndTime) {
 
 void PowerAdvisor::setDisplays(std::vector<DisplayId>& displayIds) {
     mDisplayIds = displayIds;
+    // Outputs may present concurrently and report their timing from different threads. Creating
+    // the entries up front means those threads only touch their own display's data.
+    for (DisplayId displayId : mDisplayIds) {
+        mDisplayTimingData.try_emplace(displayId);
+    }
 }
 
 void PowerAdvisor::setTotalFrameTargetWorkDuration(Duration targetDuration) {
@@ -18,6 +18,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -66,6 +67,9 @@ public:
     virtual void updateTargetWorkDuration(Duration targetDuration) = 0;
     // Sends a power hint for the actual known work duration at the end of the frame
     virtual void reportActualWorkDuration() = 0;
+    // Returns the work duration estimated by the latest reportActualWorkDuration call, including
+    // the GPU, or nullopt if it could not be estimated
+    virtual std::optional<Duration> getLastActualWorkDuration() const = 0;
     // Sets whether the power hint session is enabled
     virtual void enablePowerHintSession(bool enabled) = 0;
     // Initializes the power hint session
@@ -127,6 +131,9 @@ public:
     bool supportsGpuReporting() override;
     void updateTargetWorkDuration(Duration targetDuration) override;
     void reportActualWorkDuration() override;
+    std::optional<Duration> getLastActualWorkDuration() const override {
+        return mLastActualWorkDuration;
+    }
     void enablePowerHintSession(bool enabled) override;
     bool startPowerHintSession(std::vector<int32_t>&& threadIds) override;
     void setGpuStartTime(DisplayId displayId, TimePoint startTime) override;
@@ -254,6 +261,8 @@ private:
     TimePoint mLastSfPresentEndTime;
     // Target duration for the entire pipeline including gpu
     std::optional<Duration> mTotalFrameTargetDuration;
+    // Work duration estimated by the latest reportActualWorkDuration, before the safety margin
+    std::optional<Duration> mLastActualWorkDuration;
     // Updated list of display IDs
     std::vector<DisplayId> mDisplayIds;
 
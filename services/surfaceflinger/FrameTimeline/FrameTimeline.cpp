@@ -25,6 +25,7 @@
 #include <common/trace.h>
 #include <utils/Log.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cinttypes>
 #include <numeric>
@@ -888,19 +889,20 @@ namespace impl {
 int64_t TokenManager::generateTokenForPredictions(TimelineItem&& predictions) {
     SFTRACE_CALL();
     std::scoped_lock lock(mMutex);
-    while (mPredictions.size() >= kMaxTokens) {
-        mPredictions.erase(mPredictions.begin());
-    }
     const int64_t assignedToken = mCurrentToken++;
-    mPredictions[assignedToken] = predictions;
+    mPredictions[static_cast<size_t>(assignedToken) % kMaxTokens] = {assignedToken, predictions};
+    mPredictionCount = std::min(mPredictionCount + 1, kMaxTokens);
     return assignedToken;
 }
 
 std::optional<TimelineItem> TokenManager::getPredictionsForToken(int64_t token) const {
+    if (token < 0) {
+        return {};
+    }
     std::scoped_lock lock(mMutex);
-    auto predictionsIterator = mPredictions.find(token);
-    if (predictionsIterator != mPredictions.end()) {
-        return predictionsIterator->second;
+    const PredictionSlot& slot = mPredictions[static_cast<size_t>(token) % kMaxTokens];
+    if (slot.token == token) {
+        return slot.predictions;
     }
     return {};
 }
@@ -917,7 +919,7 @@ FrameTimeline::FrameTimeline(std::shared_ptr<TimeStats> timeStats, pid_t surface
         mSurfaceFlingerPid(surfaceFlingerPid),
         mJankClassificationThresholds(thresholds) {
     mCurrentDisplayFrame =
-            std::make_shared<DisplayFrame>(mTimeStats, thresholds, &mTraceCookieCounter);
+            makePooledShared<DisplayFrame>(mTimeStats, thresholds, &mTraceCookieCounter);
 }
 
 void FrameTimeline::onBootFinished() {
@@ -938,7 +940,7 @@ std::shared_ptr<SurfaceFrame> FrameTimeline::createSurfaceFrameForToken(
         std::string layerName, std::string debugName, bool isBuffer, GameMode gameMode) {
     SFTRACE_CALL();
     if (frameTimelineInfo.vsyncId == FrameTimelineInfo::INVALID_VSYNC_ID) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
+        return makePooledShared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
                                               std::move(layerName), std::move(debugName),
                                               PredictionState::None, TimelineItem(), mTimeStats,
                                               mJankClassificationThresholds, &mTraceCookieCounter,
@@ -947,13 +949,13 @@ std::shared_ptr<SurfaceFrame> FrameTimeline::createSurfaceFrameForToken(
     std::optional<TimelineItem> predictions =
             mTokenManager.getPredictionsForToken(frameTimelineInfo.vsyncId);
     if (predictions) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
+        return makePooledShared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
                                               std::move(layerName), std::move(debugName),
                                               PredictionState::Valid, std::move(*predictions),
                                               mTimeStats, mJankClassificationThresholds,
                                               &mTraceCookieCounter, isBuffer, gameMode);
     }
-    return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
+    return makePooledShared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
                                           std::move(layerName), std::move(debugName),
                                           PredictionState::Expired, TimelineItem(), mTimeStats,
                                           mJankClassificationThresholds, &mTraceCookieCounter,
@@ -1002,7 +1004,7 @@ void FrameTimeline::onCommitNotComposited() {
     std::scoped_lock lock(mMutex);
     mCurrentDisplayFrame->onCommitNotComposited();
     mCurrentDisplayFrame.reset();
-    mCurrentDisplayFrame = std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
+    mCurrentDisplayFrame = makePooledShared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
                                                           &mTraceCookieCounter);
 }
 
@@ -1521,7 +1523,7 @@ void FrameTimeline::finalizeCurrentDisplayFrame() {
     }
     mDisplayFrames.push_back(mCurrentDisplayFrame);
     mCurrentDisplayFrame.reset();
-    mCurrentDisplayFrame = std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
+    mCurrentDisplayFrame = makePooledShared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
                                                           &mTraceCookieCounter);
 }
 
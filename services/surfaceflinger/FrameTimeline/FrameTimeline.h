@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <deque>
@@ -38,6 +39,7 @@
 #include <scheduler/Fps.h>
 
 #include "../TimeStats/TimeStats.h"
+#include "ObjectPool.h"
 
 namespace android::frametimeline {
 
@@ -359,12 +361,19 @@ private:
     // Friend class for testing
     friend class android::frametimeline::FrameTimelineTest;
 
-    void flushTokens(nsecs_t flushTime) REQUIRES(mMutex);
+    static constexpr size_t kMaxTokens = 500;
+
+    struct PredictionSlot {
+        int64_t token = FrameTimelineInfo::INVALID_VSYNC_ID;
+        TimelineItem predictions;
+    };
 
-    std::map<int64_t, TimelineItem> mPredictions GUARDED_BY(mMutex);
+    // Tokens are generated in order, so the predictions of a token are kept in slot
+    // token % kMaxTokens until kMaxTokens newer tokens replace them.
+    std::array<PredictionSlot, kMaxTokens> mPredictions GUARDED_BY(mMutex);
+    size_t mPredictionCount GUARDED_BY(mMutex) = 0;
     int64_t mCurrentToken GUARDED_BY(mMutex);
     mutable std::mutex mMutex;
-    static constexpr size_t kMaxTokens = 500;
 };
 
 class FrameTimeline : public android::frametimeline::FrameTimeline {
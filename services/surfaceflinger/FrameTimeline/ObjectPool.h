@@ -0,0 +1,120 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+
+namespace android::frametimeline {
+
+// A free list of blocks of one size, for objects that are created and destroyed at a high rate.
+// Up to kMaxFreeBlocks freed blocks are kept for reuse, and the others go back to the heap.
+// Blocks can be allocated and freed from any thread.
+template <size_t kSize, size_t kAlignment>
+class BlockPool {
+public:
+    static constexpr size_t kMaxFreeBlocks = 1024;
+
+    // The pool is never destroyed, so that objects that outlive static destruction can still
+    // return their blocks.
+    static BlockPool& getInstance() {
+        static BlockPool* const sPool = new BlockPool;
+        return *sPool;
+    }
+
+    void* allocate() {
+        {
+            std::scoped_lock lock(mMutex);
+            if (!mFreeBlocks.empty()) {
+                void* const block = mFreeBlocks.back();
+                mFreeBlocks.pop_back();
+                return block;
+            }
+        }
+        return ::operator new(kSize, std::align_val_t{kAlignment});
+    }
+
+    void deallocate(void* block) {
+        {
+            std::scoped_lock lock(mMutex);
+            if (mFreeBlocks.size() < kMaxFreeBlocks) {
+                mFreeBlocks.push_back(block);
+                return;
+            }
+        }
+        ::operator delete(block, std::align_val_t{kAlignment});
+    }
+
+    size_t getFreeBlockCount() const {
+        std::scoped_lock lock(mMutex);
+        return mFreeBlocks.size();
+    }
+
+private:
+    BlockPool() { mFreeBlocks.reserve(kMaxFreeBlocks); }
+
+    mutable std::mutex mMutex;
+    std::vector<void*> mFreeBlocks GUARDED_BY(mMutex);
+};
+
+// An allocator that takes single objects from the BlockPool of their size. With
+// std::allocate_shared, the object and its control block share one pooled block.
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        if (count != 1) {
+            return std::allocator<T>().allocate(count);
+        }
+        return static_cast<T*>(Pool::getInstance().allocate());
+    }
+
+    void deallocate(T* object, size_t count) {
+        if (count != 1) {
+            std::allocator<T>().deallocate(object, count);
+            return;
+        }
+        Pool::getInstance().deallocate(object);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const {
+        return true;
+    }
+
+private:
+    using Pool = BlockPool<sizeof(T), alignof(T)>;
+};
+
+template <typename T, typename... Args>
+std::shared_ptr<T> makePooledShared(Args&&... args) {
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+} // namespace android::frametimeline
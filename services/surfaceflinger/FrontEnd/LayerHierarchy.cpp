@@ -20,9 +20,10 @@
 
 #include <android-base/logging.h>
 
+#include <unordered_set>
+
 #include "LayerHierarchy.h"
 #include "LayerLog.h"
-#include "SwapErase.h"
 
 namespace android::surfaceflinger::frontend {
 
@@ -198,15 +199,12 @@ bool LayerHierarchy::hasRelZLoop(uint32_t& outInvalidRelativeRoot) const {
 
 void LayerHierarchyBuilder::init(const std::vector<std::unique_ptr<RequestedLayerState>>& layers) {
     mLayerIdToHierarchy.clear();
-    mHierarchies.clear();
     mRoot = nullptr;
     mOffscreenRoot = nullptr;
 
-    mHierarchies.reserve(layers.size());
     mLayerIdToHierarchy.reserve(layers.size());
     for (auto& layer : layers) {
-        mHierarchies.emplace_back(std::make_unique<LayerHierarchy>(layer.get()));
-        mLayerIdToHierarchy[layer->id] = mHierarchies.back().get();
+        mLayerIdToHierarchy[layer->id] = std::make_unique<LayerHierarchy>(layer.get());
     }
     for (const auto& layer : layers) {
         onLayerAdded(layer.get());
@@ -295,6 +293,38 @@ void LayerHierarchyBuilder::detachHierarchyFromRelativeParent(LayerHierarchy* ro
     }
 }
 
+// Onscreen layers are attached to their relative parents and offscreen layers are detached from
+// them. Only the layers that were moved by an update, and their descendants, may need to change.
+void LayerHierarchyBuilder::updateRelativeParentsOfMovedLayers(
+        const std::vector<uint32_t>& movedLayerIds) {
+    std::unordered_set<const LayerHierarchy*> moved;
+    std::vector<LayerHierarchy*> hierarchies;
+    for (uint32_t layerId : movedLayerIds) {
+        // The layer may have been destroyed later in the same update.
+        LayerHierarchy* hierarchy = getHierarchyFromId(layerId, /*crashOnFailure=*/false);
+        if (hierarchy && moved.insert(hierarchy).second) {
+            hierarchies.push_back(hierarchy);
+        }
+    }
+
+    for (LayerHierarchy* hierarchy : hierarchies) {
+        // Find the root of the tree that the layer is now in. A layer below another moved layer
+        // is updated along with it, and a parent loop never reaches a root.
+        const LayerHierarchy* ancestor = hierarchy->mParent;
+        for (size_t depth = 0; ancestor && ancestor->mLayer && !moved.contains(ancestor) &&
+             depth < mLayerIdToHierarchy.size();
+             depth++) {
+            ancestor = ancestor->mParent;
+        }
+        if (ancestor == &mOffscreenRoot) {
+            detachHierarchyFromRelativeParent(hierarchy);
+        } else if (ancestor == &mRoot) {
+            detachHierarchyFromRelativeParent(hierarchy);
+            attachHierarchyToRelativeParent(hierarchy);
+        }
+    }
+}
+
 void LayerHierarchyBuilder::onLayerAdded(RequestedLayerState* layer) {
     LayerHierarchy* hierarchy = getHierarchyFromId(layer->id);
     attachToParent(hierarchy);
@@ -312,7 +342,8 @@ void LayerHierarchyBuilder::onLayerAdded(RequestedLayerState* layer) {
     }
 }
 
-void LayerHierarchyBuilder::onLayerDestroyed(RequestedLayerState* layer) {
+void LayerHierarchyBuilder::onLayerDestroyed(RequestedLayerState* layer,
+                                             std::vector<uint32_t>& outMovedLayerIds) {
     LLOGV(layer->id, "");
     LayerHierarchy* hierarchy = getHierarchyFromId(layer->id, /*crashOnFailure=*/false);
     if (!hierarchy) {
@@ -330,15 +361,14 @@ void LayerHierarchyBuilder::onLayerDestroyed(RequestedLayerState* layer) {
             variant == LayerHierarchy::Variant::Detached) {
             mOffscreenRoot.addChild(child, LayerHierarchy::Variant::Attached);
             child->mParent = &mOffscreenRoot;
+            outMovedLayerIds.push_back(child->mLayer->id);
         } else if (variant == LayerHierarchy::Variant::Relative) {
             mOffscreenRoot.addChild(child, LayerHierarchy::Variant::Attached);
             child->mRelativeParent = &mOffscreenRoot;
+            outMovedLayerIds.push_back(child->mLayer->id);
         }
     }
 
-    swapErase(mHierarchies, [hierarchy](std::unique_ptr<LayerHierarchy>& layerHierarchy) {
-        return layerHierarchy.get() == hierarchy;
-    });
     mLayerIdToHierarchy.erase(layer->id);
 }
 
@@ -364,33 +394,45 @@ void LayerHierarchyBuilder::updateMirrorLayer(RequestedLayerState* layer) {
     }
 }
 
-void LayerHierarchyBuilder::doUpdate(
+bool LayerHierarchyBuilder::doUpdate(
         const std::vector<std::unique_ptr<RequestedLayerState>>& layers,
         const std::vector<std::unique_ptr<RequestedLayerState>>& destroyedLayers) {
     // rebuild map
     for (auto& layer : layers) {
         if (layer->changes.test(RequestedLayerState::Changes::Created)) {
-            mHierarchies.emplace_back(std::make_unique<LayerHierarchy>(layer.get()));
-            mLayerIdToHierarchy[layer->id] = mHierarchies.back().get();
+            mLayerIdToHierarchy[layer->id] = std::make_unique<LayerHierarchy>(layer.get());
         }
     }
 
+    // The layers that were added, reparented, relatively reparented or orphaned, which may have
+    // moved between the onscreen and offscreen trees.
+    std::vector<uint32_t> movedLayerIds;
+    // A relative z loop needs a new relative, parent or mirror edge. Layers that are created
+    // without any, such as short lived layers attached to a window, cannot add one.
+    bool mayHaveRelZLoop = false;
     for (auto& layer : layers) {
         if (layer->changes.get() == 0) {
             continue;
         }
         if (layer->changes.test(RequestedLayerState::Changes::Created)) {
             onLayerAdded(layer.get());
+            movedLayerIds.push_back(layer->id);
+            mayHaveRelZLoop |= layer->isRelativeOf || !layer->mirrorIds.empty() ||
+                    layer->layerIdToMirror != UNASSIGNED_LAYER_ID;
             continue;
         }
         LayerHierarchy* hierarchy = getHierarchyFromId(layer->id);
         if (layer->changes.test(RequestedLayerState::Changes::Parent)) {
             detachFromParent(hierarchy);
             attachToParent(hierarchy);
+            movedLayerIds.push_back(layer->id);
+            mayHaveRelZLoop = true;
         }
         if (layer->changes.test(RequestedLayerState::Changes::RelativeParent)) {
             detachFromRelativeParent(hierarchy);
             attachToRelativeParent(hierarchy);
+            movedLayerIds.push_back(layer->id);
+            mayHaveRelZLoop = true;
         }
         if (layer->changes.test(RequestedLayerState::Changes::Z)) {
             hierarchy->mParent->sortChildrenByZOrder();
@@ -400,33 +442,55 @@ void LayerHierarchyBuilder::doUpdate(
         }
         if (layer->changes.test(RequestedLayerState::Changes::Mirror)) {
             updateMirrorLayer(layer.get());
+            mayHaveRelZLoop = true;
         }
     }
 
     for (auto& layer : destroyedLayers) {
-        onLayerDestroyed(layer.get());
+        onLayerDestroyed(layer.get(), movedLayerIds);
     }
     // When moving from onscreen to offscreen and vice versa, we need to attach and detach
-    // from our relative parents. This walks down both trees to do so. We can optimize this
-    // further by tracking onscreen, offscreen state in LayerHierarchy.
-    detachHierarchyFromRelativeParent(&mOffscreenRoot);
-    attachHierarchyToRelativeParent(&mRoot);
+    // from our relative parents. Only the moved layers and their descendants are walked, rather
+    // than both trees.
+    updateRelativeParentsOfMovedLayers(movedLayerIds);
+    return mayHaveRelZLoop;
+}
+
+void LayerHierarchyBuilder::verifyAgainstFullBuild(
+        const std::vector<std::unique_ptr<RequestedLayerState>>& layers) const {
+    SFTRACE_CALL();
+    LayerHierarchyBuilder fullBuild;
+    fullBuild.init(layers);
+    const std::string hierarchy = mRoot.dump();
+    const std::string expectedHierarchy = fullBuild.mRoot.dump();
+    LLOG_ALWAYS_FATAL_WITH_TRACE_IF(hierarchy != expectedHierarchy,
+                                    "Updated hierarchy differs from a full build:\n%s\n"
+                                    "Expected:\n%s",
+                                    hierarchy.c_str(), expectedHierarchy.c_str());
+    const std::string offscreenHierarchy = mOffscreenRoot.dump();
+    const std::string expectedOffscreenHierarchy = fullBuild.mOffscreenRoot.dump();
+    LLOG_ALWAYS_FATAL_WITH_TRACE_IF(offscreenHierarchy != expectedOffscreenHierarchy,
+                                    "Updated offscreen hierarchy differs from a full build:\n%s\n"
+                                    "Expected:\n%s",
+                                    offscreenHierarchy.c_str(), expectedOffscreenHierarchy.c_str());
 }
 
 void LayerHierarchyBuilder::update(LayerLifecycleManager& layerLifecycleManager) {
+    bool mayHaveRelZLoop = true;
     if (!mInitialized) {
         SFTRACE_NAME("LayerHierarchyBuilder:init");
         init(layerLifecycleManager.getLayers());
     } else if (layerLifecycleManager.getGlobalChanges().test(
                        RequestedLayerState::Changes::Hierarchy)) {
         SFTRACE_NAME("LayerHierarchyBuilder:update");
-        doUpdate(layerLifecycleManager.getLayers(), layerLifecycleManager.getDestroyedLayers());
+        mayHaveRelZLoop = doUpdate(layerLifecycleManager.getLayers(),
+                                   layerLifecycleManager.getDestroyedLayers());
     } else {
         return; // nothing to do
     }
 
-    uint32_t invalidRelativeRoot;
-    bool hasRelZLoop = mRoot.hasRelZLoop(invalidRelativeRoot);
+    uint32_t invalidRelativeRoot = UNASSIGNED_LAYER_ID;
+    bool hasRelZLoop = mayHaveRelZLoop && mRoot.hasRelZLoop(invalidRelativeRoot);
     while (hasRelZLoop) {
         SFTRACE_NAME("FixRelZLoop");
         TransactionTraceWriter::getInstance().invoke("relz_loop_detected",
@@ -437,6 +501,10 @@ void LayerHierarchyBuilder::update(LayerLifecycleManager& layerLifecycleManager)
         // check if we have any remaining loops
         hasRelZLoop = mRoot.hasRelZLoop(invalidRelativeRoot);
     }
+
+    if (mVerifyUpdates) {
+        verifyAgainstFullBuild(layerLifecycleManager.getLayers());
+    }
 }
 
 const LayerHierarchy& LayerHierarchyBuilder::getHierarchy() const {
@@ -453,7 +521,7 @@ std::string LayerHierarchyBuilder::getDebugString(uint32_t layerId, uint32_t dep
     auto it = mLayerIdToHierarchy.find(layerId);
     if (it == mLayerIdToHierarchy.end()) return "not found";
 
-    LayerHierarchy* hierarchy = it->second;
+    const LayerHierarchy* hierarchy = it->second.get();
     if (!hierarchy->mLayer) return "none";
 
     std::string debug =
@@ -484,7 +552,7 @@ LayerHierarchy* LayerHierarchyBuilder::getHierarchyFromId(uint32_t layerId, bool
         return nullptr;
     };
 
-    return it->second;
+    return it->second.get();
 }
 
 void LayerHierarchyBuilder::logSampledChildren(const LayerHierarchy& hierarchy) const {
@@ -207,6 +207,9 @@ class LayerHierarchyBuilder {
 public:
     LayerHierarchyBuilder() = default;
     void update(LayerLifecycleManager& layerLifecycleManager);
+    // When enabled, every update of the hierarchy is compared against a hierarchy built from
+    // scratch, and a mismatch is fatal. This is slow and is meant for debugging.
+    void setVerifyUpdates(bool verifyUpdates) { mVerifyUpdates = verifyUpdates; }
     LayerHierarchy getPartialHierarchy(uint32_t, bool childrenOnly) const;
     const LayerHierarchy& getHierarchy() const;
     const LayerHierarchy& getOffscreenHierarchy() const;
@@ -224,18 +227,22 @@ private:
     std::vector<LayerHierarchy*> getDescendants(LayerHierarchy*);
     void attachHierarchyToRelativeParent(LayerHierarchy*);
     void detachHierarchyFromRelativeParent(LayerHierarchy*);
+    void updateRelativeParentsOfMovedLayers(const std::vector<uint32_t>& movedLayerIds);
     void init(const std::vector<std::unique_ptr<RequestedLayerState>>&);
-    void doUpdate(const std::vector<std::unique_ptr<RequestedLayerState>>& layers,
+    // Returns true if the update may have added a relative z loop.
+    bool doUpdate(const std::vector<std::unique_ptr<RequestedLayerState>>& layers,
                   const std::vector<std::unique_ptr<RequestedLayerState>>& destroyedLayers);
-    void onLayerDestroyed(RequestedLayerState* layer);
+    void onLayerDestroyed(RequestedLayerState* layer, std::vector<uint32_t>& outMovedLayerIds);
+    void verifyAgainstFullBuild(
+            const std::vector<std::unique_ptr<RequestedLayerState>>& layers) const;
     void updateMirrorLayer(RequestedLayerState* layer);
     LayerHierarchy* getHierarchyFromId(uint32_t layerId, bool crashOnFailure = true);
 
-    std::unordered_map<uint32_t, LayerHierarchy*> mLayerIdToHierarchy;
-    std::vector<std::unique_ptr<LayerHierarchy>> mHierarchies;
+    std::unordered_map<uint32_t, std::unique_ptr<LayerHierarchy>> mLayerIdToHierarchy;
     LayerHierarchy mRoot{nullptr};
     LayerHierarchy mOffscreenRoot{nullptr};
     bool mInitialized = false;
+    bool mVerifyUpdates = false;
 };
 
 } // namespace android::surfaceflinger::frontend
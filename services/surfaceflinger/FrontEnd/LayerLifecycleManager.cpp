@@ -184,102 +184,153 @@ void LayerLifecycleManager::onHandlesDestroyed(
 
 void LayerLifecycleManager::applyTransactions(const std::vector<TransactionState>& transactions,
                                               bool ignoreUnknownLayers) {
+    // Fold the states of a layer from all the transactions into one, so that each layer is
+    // merged and its changes are computed once. A state that has to be applied in order starts
+    // a new update for its layer.
+    std::vector<LayerUpdate> updates;
+    std::unordered_map<uint32_t, size_t> pendingUpdates;
     for (const auto& transaction : transactions) {
+        const bool animation = transaction.flags & ISurfaceComposer::eAnimation;
         for (const auto& resolvedComposerState : transaction.states) {
-            const auto& clientState = resolvedComposerState.state;
-            uint32_t layerId = resolvedComposerState.layerId;
-            if (layerId == UNASSIGNED_LAYER_ID) {
-                ALOGW("%s Handle %p is not valid", __func__, clientState.surface.get());
-                continue;
+            const uint32_t layerId = resolvedComposerState.layerId;
+            if (layerId != UNASSIGNED_LAYER_ID) {
+                auto it = pendingUpdates.find(layerId);
+                if (it != pendingUpdates.end() &&
+                    updates[it->second].tryMerge(resolvedComposerState, animation)) {
+                    continue;
+                }
+                pendingUpdates[layerId] = updates.size();
             }
+            updates.push_back({.state = &resolvedComposerState, .animation = animation});
+        }
+    }
 
-            RequestedLayerState* layer = getLayerFromId(layerId);
-            if (layer == nullptr) {
-                LLOG_ALWAYS_FATAL_WITH_TRACE_IF(!ignoreUnknownLayers,
-                                                "%s Layer with layerid=%d not found", __func__,
-                                                layerId);
-                continue;
-            }
+    for (const auto& update : updates) {
+        applyState(update.merged ? *update.merged : *update.state, update.animation,
+                   ignoreUnknownLayers);
+    }
+}
 
-            LLOG_ALWAYS_FATAL_WITH_TRACE_IF(!layer->handleAlive,
-                                            "%s Layer's with layerid=%d) is not alive. Possible "
-                                            "out of "
-                                            "order LayerLifecycleManager updates",
-                                            __func__, layerId);
+bool LayerLifecycleManager::LayerUpdate::tryMerge(const ResolvedComposerState& other,
+                                                  bool otherAnimation) {
+    const uint64_t pendingWhat = merged ? merged->state.what : state->state.what;
+    // Each buffer is latched with its own frame number.
+    if (pendingWhat & other.state.what & layer_state_t::eBufferChanged) {
+        return false;
+    }
+    // The outcome of a reparent or a relative reparent depends on what was applied before it.
+    if ((pendingWhat | other.state.what) &
+        (layer_state_t::eReparent | layer_state_t::eRelativeLayerChanged)) {
+        return false;
+    }
 
-            if (layer->changes.get() == 0) {
-                mChangedLayers.push_back(layer);
-            }
+    if (!merged) {
+        merged = *state;
+    }
+    merged->state.merge(other.state);
+    if (other.state.what & layer_state_t::eBufferChanged) {
+        merged->externalTexture = other.externalTexture;
+    }
+    if (other.state.what & layer_state_t::eInputInfoChanged) {
+        merged->touchCropId = other.touchCropId;
+    }
+    animation |= otherAnimation;
+    return true;
+}
 
-            if (transaction.flags & ISurfaceComposer::eAnimation) {
-                layer->changes |= RequestedLayerState::Changes::Animation;
-            }
+void LayerLifecycleManager::applyState(const ResolvedComposerState& resolvedComposerState,
+                                       bool animation, bool ignoreUnknownLayers) {
+    const auto& clientState = resolvedComposerState.state;
+    uint32_t layerId = resolvedComposerState.layerId;
+    if (layerId == UNASSIGNED_LAYER_ID) {
+        ALOGW("%s Handle %p is not valid", __func__, clientState.surface.get());
+        return;
+    }
 
-            uint32_t oldParentId = layer->parentId;
-            uint32_t oldRelativeParentId = layer->relativeParentId;
-            uint32_t oldTouchCropId = layer->touchCropId;
-            layer->merge(resolvedComposerState);
-
-            if (layer->what & layer_state_t::eBackgroundColorChanged) {
-                if (layer->bgColorLayerId == UNASSIGNED_LAYER_ID && layer->bgColor.a != 0) {
-                    LayerCreationArgs
-                            backgroundLayerArgs(LayerCreationArgs::getInternalLayerId(
-                                                        LayerCreationArgs::sInternalSequence++),
-                                                /*internalLayer=*/true);
-                    backgroundLayerArgs.parentId = layer->id;
-                    backgroundLayerArgs.name = layer->name + "BackgroundColorLayer";
-                    backgroundLayerArgs.flags = ISurfaceComposerClient::eFXSurfaceEffect;
-                    std::vector<std::unique_ptr<RequestedLayerState>> newLayers;
-                    newLayers.emplace_back(
-                            std::make_unique<RequestedLayerState>(backgroundLayerArgs));
-                    RequestedLayerState* backgroundLayer = newLayers.back().get();
-                    backgroundLayer->bgColorLayer = true;
-                    backgroundLayer->handleAlive = false;
-                    backgroundLayer->parentId = layer->id;
-                    backgroundLayer->z = std::numeric_limits<int32_t>::min();
-                    backgroundLayer->color = layer->bgColor;
-                    backgroundLayer->dataspace = layer->bgColorDataspace;
-                    layer->bgColorLayerId = backgroundLayer->id;
-                    addLayers({std::move(newLayers)});
-                } else if (layer->bgColorLayerId != UNASSIGNED_LAYER_ID && layer->bgColor.a == 0) {
-                    RequestedLayerState* bgColorLayer = getLayerFromId(layer->bgColorLayerId);
-                    layer->bgColorLayerId = UNASSIGNED_LAYER_ID;
-                    bgColorLayer->parentId = unlinkLayer(bgColorLayer->parentId, bgColorLayer->id);
-                    onHandlesDestroyed({{bgColorLayer->id, bgColorLayer->debugName}});
-                } else if (layer->bgColorLayerId != UNASSIGNED_LAYER_ID) {
-                    RequestedLayerState* bgColorLayer = getLayerFromId(layer->bgColorLayerId);
-                    bgColorLayer->color = layer->bgColor;
-                    bgColorLayer->dataspace = layer->bgColorDataspace;
-                    bgColorLayer->what |= layer_state_t::eColorChanged |
-                            layer_state_t::eDataspaceChanged | layer_state_t::eAlphaChanged;
-                    bgColorLayer->changes |= RequestedLayerState::Changes::Content;
-                    mChangedLayers.push_back(bgColorLayer);
-                    mGlobalChanges |= RequestedLayerState::Changes::Content;
-                }
-            }
+    RequestedLayerState* layer = getLayerFromId(layerId);
+    if (layer == nullptr) {
+        LLOG_ALWAYS_FATAL_WITH_TRACE_IF(!ignoreUnknownLayers,
+                                        "%s Layer with layerid=%d not found", __func__, layerId);
+        return;
+    }
 
-            if (oldParentId != layer->parentId) {
-                unlinkLayer(oldParentId, layer->id);
-                layer->parentId = linkLayer(layer->parentId, layer->id);
-                if (oldParentId == UNASSIGNED_LAYER_ID) {
-                    updateDisplayMirrorLayers(*layer);
-                }
-            }
-            if (layer->what & layer_state_t::eLayerStackChanged && layer->isRoot()) {
-                updateDisplayMirrorLayers(*layer);
-            }
-            if (oldRelativeParentId != layer->relativeParentId) {
-                unlinkLayer(oldRelativeParentId, layer->id);
-                layer->relativeParentId = linkLayer(layer->relativeParentId, layer->id);
-            }
-            if (oldTouchCropId != layer->touchCropId) {
-                unlinkLayer(oldTouchCropId, layer->id);
-                layer->touchCropId = linkLayer(layer->touchCropId, layer->id);
-            }
+    LLOG_ALWAYS_FATAL_WITH_TRACE_IF(!layer->handleAlive,
+                                    "%s Layer's with layerid=%d) is not alive. Possible "
+                                    "out of "
+                                    "order LayerLifecycleManager updates",
+                                    __func__, layerId);
+
+    if (layer->changes.get() == 0) {
+        mChangedLayers.push_back(layer);
+    }
 
-            mGlobalChanges |= layer->changes;
+    if (animation) {
+        layer->changes |= RequestedLayerState::Changes::Animation;
+    }
+
+    uint32_t oldParentId = layer->parentId;
+    uint32_t oldRelativeParentId = layer->relativeParentId;
+    uint32_t oldTouchCropId = layer->touchCropId;
+    layer->merge(resolvedComposerState);
+
+    if (layer->what & layer_state_t::eBackgroundColorChanged) {
+        if (layer->bgColorLayerId == UNASSIGNED_LAYER_ID && layer->bgColor.a != 0) {
+            LayerCreationArgs
+                    backgroundLayerArgs(LayerCreationArgs::getInternalLayerId(
+                                                LayerCreationArgs::sInternalSequence++),
+                                        /*internalLayer=*/true);
+            backgroundLayerArgs.parentId = layer->id;
+            backgroundLayerArgs.name = layer->name + "BackgroundColorLayer";
+            backgroundLayerArgs.flags = ISurfaceComposerClient::eFXSurfaceEffect;
+            std::vector<std::unique_ptr<RequestedLayerState>> newLayers;
+            newLayers.emplace_back(
+                    std::make_unique<RequestedLayerState>(backgroundLayerArgs));
+            RequestedLayerState* backgroundLayer = newLayers.back().get();
+            backgroundLayer->bgColorLayer = true;
+            backgroundLayer->handleAlive = false;
+            backgroundLayer->parentId = layer->id;
+            backgroundLayer->z = std::numeric_limits<int32_t>::min();
+            backgroundLayer->color = layer->bgColor;
+            backgroundLayer->dataspace = layer->bgColorDataspace;
+            layer->bgColorLayerId = backgroundLayer->id;
+            addLayers({std::move(newLayers)});
+        } else if (layer->bgColorLayerId != UNASSIGNED_LAYER_ID && layer->bgColor.a == 0) {
+            RequestedLayerState* bgColorLayer = getLayerFromId(layer->bgColorLayerId);
+            layer->bgColorLayerId = UNASSIGNED_LAYER_ID;
+            bgColorLayer->parentId = unlinkLayer(bgColorLayer->parentId, bgColorLayer->id);
+            onHandlesDestroyed({{bgColorLayer->id, bgColorLayer->debugName}});
+        } else if (layer->bgColorLayerId != UNASSIGNED_LAYER_ID) {
+            RequestedLayerState* bgColorLayer = getLayerFromId(layer->bgColorLayerId);
+            bgColorLayer->color = layer->bgColor;
+            bgColorLayer->dataspace = layer->bgColorDataspace;
+            bgColorLayer->what |= layer_state_t::eColorChanged |
+                    layer_state_t::eDataspaceChanged | layer_state_t::eAlphaChanged;
+            bgColorLayer->changes |= RequestedLayerState::Changes::Content;
+            mChangedLayers.push_back(bgColorLayer);
+            mGlobalChanges |= RequestedLayerState::Changes::Content;
+        }
+    }
+
+    if (oldParentId != layer->parentId) {
+        unlinkLayer(oldParentId, layer->id);
+        layer->parentId = linkLayer(layer->parentId, layer->id);
+        if (oldParentId == UNASSIGNED_LAYER_ID) {
+            updateDisplayMirrorLayers(*layer);
         }
     }
+    if (layer->what & layer_state_t::eLayerStackChanged && layer->isRoot()) {
+        updateDisplayMirrorLayers(*layer);
+    }
+    if (oldRelativeParentId != layer->relativeParentId) {
+        unlinkLayer(oldRelativeParentId, layer->id);
+        layer->relativeParentId = linkLayer(layer->relativeParentId, layer->id);
+    }
+    if (oldTouchCropId != layer->touchCropId) {
+        unlinkLayer(oldTouchCropId, layer->id);
+        layer->touchCropId = linkLayer(layer->touchCropId, layer->id);
+    }
+
+    mGlobalChanges |= layer->changes;
 }
 
 void LayerLifecycleManager::commitChanges() {
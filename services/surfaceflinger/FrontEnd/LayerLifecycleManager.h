@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <optional>
+
 #include "RequestedLayerState.h"
 #include "TransactionState.h"
 
@@ -95,6 +97,20 @@ private:
 
     void updateDisplayMirrorLayers(RequestedLayerState& rootLayer);
 
+    // The states of a layer from one or more transactions, applied to the layer as one.
+    struct LayerUpdate {
+        // Lifetime tied to the transactions being applied
+        const ResolvedComposerState* state;
+        // Set once a later state has been merged into this update.
+        std::optional<ResolvedComposerState> merged;
+        bool animation = false;
+
+        // Merges a later state of the layer into this update if that gives the same result as
+        // applying the two in turn.
+        bool tryMerge(const ResolvedComposerState& other, bool otherAnimation);
+    };
+    void applyState(const ResolvedComposerState&, bool animation, bool ignoreUnknownLayers);
+
     struct References {
         // Lifetime tied to mLayers
         RequestedLayerState& owner;
@@ -356,7 +356,7 @@ Hwc2::IComposerClient::BlendMode LayerSnapshot::getBlendMode(
 
 void LayerSnapshot::merge(const RequestedLayerState& requested, bool forceUpdate,
                           bool displayChanges, bool forceFullDamage,
-                          uint32_t displayRotationFlags) {
+                          uint32_t displayRotationFlags, const LayerSnapshot* mergedSibling) {
     clientChanges = requested.what;
     changes = requested.changes;
     contentDirty = requested.what & layer_state_t::CONTENT_DIRTY;
@@ -378,7 +378,8 @@ void LayerSnapshot::merge(const RequestedLayerState& requested, bool forceUpdate
         geomBufferUsesDisplayInverseTransform = requested.transformToDisplayInverse;
     }
     if (forceUpdate || requested.what & layer_state_t::eDataspaceChanged) {
-        dataspace = Layer::translateDataspace(requested.dataspace);
+        dataspace = mergedSibling ? mergedSibling->dataspace
+                                  : Layer::translateDataspace(requested.dataspace);
     }
     if (forceUpdate || requested.what & layer_state_t::eExtendedRangeBrightnessChanged) {
         currentHdrSdrRatio = requested.currentHdrSdrRatio;
@@ -425,7 +426,8 @@ void LayerSnapshot::merge(const RequestedLayerState& requested, bool forceUpdate
         requested.what &
                 (layer_state_t::eFlagsChanged | layer_state_t::eBufferChanged |
                  layer_state_t::eSidebandStreamChanged)) {
-        compositionType = requested.getCompositionType();
+        compositionType =
+                mergedSibling ? mergedSibling->compositionType : requested.getCompositionType();
     }
 
     if (forceUpdate || requested.what & layer_state_t::eInputInfoChanged) {
@@ -449,7 +451,14 @@ void LayerSnapshot::merge(const RequestedLayerState& requested, bool forceUpdate
         color.rgb = requested.getColor().rgb;
     }
 
-    if (forceUpdate || requested.what & layer_state_t::eBufferChanged) {
+    if ((forceUpdate || requested.what & layer_state_t::eBufferChanged) && mergedSibling) {
+        acquireFence = mergedSibling->acquireFence;
+        buffer = mergedSibling->buffer;
+        externalTexture = mergedSibling->externalTexture;
+        frameNumber = mergedSibling->frameNumber;
+        hasProtectedContent = mergedSibling->hasProtectedContent;
+        geomUsesSourceCrop = mergedSibling->geomUsesSourceCrop;
+    } else if (forceUpdate || requested.what & layer_state_t::eBufferChanged) {
         acquireFence =
                 (requested.externalTexture &&
                  requested.bufferData->flags.test(BufferData::BufferDataChange::fenceChanged))
@@ -469,10 +478,17 @@ void LayerSnapshot::merge(const RequestedLayerState& requested, bool forceUpdate
                  layer_state_t::eBufferTransformChanged |
                  layer_state_t::eTransformToDisplayInverseChanged) ||
         requested.changes.test(RequestedLayerState::Changes::BufferSize) || displayChanges) {
-        bufferSize = requested.getBufferSize(displayRotationFlags);
-        geomBufferSize = bufferSize;
-        croppedBufferSize = requested.getCroppedBufferSize(bufferSize);
-        geomContentCrop = requested.getBufferCrop();
+        if (mergedSibling) {
+            bufferSize = mergedSibling->bufferSize;
+            geomBufferSize = mergedSibling->geomBufferSize;
+            croppedBufferSize = mergedSibling->croppedBufferSize;
+            geomContentCrop = mergedSibling->geomContentCrop;
+        } else {
+            bufferSize = requested.getBufferSize(displayRotationFlags);
+            geomBufferSize = bufferSize;
+            croppedBufferSize = requested.getCroppedBufferSize(bufferSize);
+            geomContentCrop = requested.getBufferCrop();
+        }
     }
 
     if ((forceUpdate ||
@@ -483,8 +499,13 @@ void LayerSnapshot::merge(const RequestedLayerState& requested, bool forceUpdate
                   layer_state_t::eTransformToDisplayInverseChanged) ||
          requested.changes.test(RequestedLayerState::Changes::BufferSize) || displayChanges) &&
         !ignoreLocalTransform) {
-        localTransform = requested.getTransform(displayRotationFlags);
-        localTransformInverse = localTransform.inverse();
+        if (mergedSibling && !mergedSibling->ignoreLocalTransform) {
+            localTransform = mergedSibling->localTransform;
+            localTransformInverse = mergedSibling->localTransformInverse;
+        } else {
+            localTransform = requested.getTransform(displayRotationFlags);
+            localTransformInverse = localTransform.inverse();
+        }
     }
 
     if (forceUpdate || requested.what & (layer_state_t::eColorChanged) ||
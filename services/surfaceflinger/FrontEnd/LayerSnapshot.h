@@ -149,8 +149,12 @@ struct LayerSnapshot : public compositionengine::LayerFECompositionState {
     bool isFrontBuffered() const;
     Hwc2::IComposerClient::BlendMode getBlendMode(const RequestedLayerState& requested) const;
     friend std::ostream& operator<<(std::ostream& os, const LayerSnapshot& obj);
+    // |mergedSibling| is a snapshot of the same layer, such as the one a mirror was cloned from,
+    // which was merged with |requested| in this update. The state that only depends on the
+    // requested state is copied from it rather than derived again.
     void merge(const RequestedLayerState& requested, bool forceUpdate, bool displayChanges,
-               bool forceFullDamage, uint32_t displayRotationFlags);
+               bool forceFullDamage, uint32_t displayRotationFlags,
+               const LayerSnapshot* mergedSibling = nullptr);
 };
 
 } // namespace android::surfaceflinger::frontend
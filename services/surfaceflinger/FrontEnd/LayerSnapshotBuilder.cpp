@@ -19,10 +19,13 @@
 #undef LOG_TAG
 #define LOG_TAG "SurfaceFlinger"
 
+#include <algorithm>
+#include <cinttypes>
 #include <numeric>
 #include <optional>
 
 #include <common/FlagManager.h>
+#include <android-base/stringprintf.h>
 #include <common/trace.h>
 #include <ftl/small_map.h>
 #include <ui/DisplayMap.h>
@@ -320,6 +323,44 @@ void clearChanges(LayerSnapshot& snapshot) {
     snapshot.surfaceDamage.clear();
 }
 
+// Parallel traversal only pays off when there is enough work to split.
+constexpr size_t kMinLayersForParallelUpdate = 64;
+constexpr size_t kMaxParallelUpdateWorkers = 3;
+constexpr int kMaxTraversalDepth = 50;
+
+using TraversalPathToSubtree =
+        std::unordered_map<LayerHierarchy::TraversalPath, size_t, LayerHierarchy::TraversalPathHash>;
+
+// Walks the subtree and records which root subtree first reached each snapshot that can be
+// visited from more than one place in the hierarchy. Relative and detached paths are visited
+// once via their parent and once via their relative parent. If the two visits happen in
+// different root subtrees, mergeUpTo is updated so those subtrees are updated together.
+// Returns false if the hierarchy is too deep to walk, in which case the caller should fall back
+// to the serial traversal which reports the cycle.
+bool collectSharedPaths(const LayerHierarchy& hierarchy, LayerHierarchy::TraversalPath& path,
+                        size_t subtree, TraversalPathToSubtree& firstSubtree,
+                        std::vector<size_t>& mergeUpTo, int depth) {
+    if (depth > kMaxTraversalDepth) {
+        return false;
+    }
+    if (path.isRelative() || !path.isAttached()) {
+        auto [it, inserted] = firstSubtree.try_emplace(path, subtree);
+        if (!inserted && it->second != subtree) {
+            mergeUpTo[it->second] = std::max(mergeUpTo[it->second], subtree);
+        }
+    }
+    for (auto& [childHierarchy, variant] : hierarchy.mChildren) {
+        LayerHierarchy::ScopedAddToTraversalPath addChildToPath(path,
+                                                                childHierarchy->getLayer()->id,
+                                                                variant);
+        if (!collectSharedPaths(*childHierarchy, path, subtree, firstSubtree, mergeUpTo,
+                                depth + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // TODO (b/259407931): Remove.
 uint32_t getPrimaryDisplayRotationFlags(
         const ui::DisplayMap<ui::LayerStack, frontend::DisplayInfo>& displays) {
@@ -370,6 +411,7 @@ LayerSnapshotBuilder::LayerSnapshotBuilder() {}
 LayerSnapshotBuilder::LayerSnapshotBuilder(Args args) : LayerSnapshotBuilder() {
     args.forceUpdate = ForceUpdateFlags::ALL;
     updateSnapshots(args);
+    updateHotFields();
 }
 
 bool LayerSnapshotBuilder::tryFastUpdate(const Args& args) {
@@ -385,13 +427,17 @@ bool LayerSnapshotBuilder::tryFastUpdate(const Args& args) {
     SFTRACE_NAME("FastPath");
 
     uint32_t primaryDisplayRotationFlags = getPrimaryDisplayRotationFlags(args.displays);
+    // A layer has a snapshot for each of its mirrors, which are all merged with the same requested
+    // state, so the state derived from it is only computed for the first of them.
     if (forceUpdate || args.displayChanges) {
+        std::unordered_map<uint32_t, const LayerSnapshot*> mergedSnapshots;
         for (auto& snapshot : mSnapshots) {
             const RequestedLayerState* requested =
                     args.layerLifecycleManager.getLayerFromId(snapshot->path.id);
             if (!requested) continue;
+            auto [it, first] = mergedSnapshots.try_emplace(snapshot->path.id, snapshot.get());
             snapshot->merge(*requested, forceUpdate, args.displayChanges, args.forceFullDamage,
-                            primaryDisplayRotationFlags);
+                            primaryDisplayRotationFlags, first ? nullptr : it->second);
         }
         return false;
     }
@@ -399,9 +445,11 @@ bool LayerSnapshotBuilder::tryFastUpdate(const Args& args) {
     // Walk through all the updated requested layer states and update the corresponding snapshots.
     for (const RequestedLayerState* requested : args.layerLifecycleManager.getChangedLayers()) {
         auto range = mIdToSnapshots.equal_range(requested->id);
+        const LayerSnapshot* mergedSibling = nullptr;
         for (auto it = range.first; it != range.second; it++) {
             it->second->merge(*requested, forceUpdate, args.displayChanges, args.forceFullDamage,
-                              primaryDisplayRotationFlags);
+                              primaryDisplayRotationFlags, mergedSibling);
+            mergedSibling = it->second;
         }
     }
 
@@ -439,6 +487,7 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
         }
     }
 
+    mStats.hierarchyUpdates++;
     LayerHierarchy::TraversalPath root = LayerHierarchy::TraversalPath::ROOT;
     if (args.root.getLayer()) {
         // The hierarchy can have a root layer when used for screenshots otherwise, it will have
@@ -446,7 +495,7 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
         LayerHierarchy::ScopedAddToTraversalPath addChildToPath(root, args.root.getLayer()->id,
                                                                 LayerHierarchy::Variant::Attached);
         updateSnapshotsInHierarchy(args, args.root, root, rootSnapshot, /*depth=*/0);
-    } else {
+    } else if (!tryParallelUpdate(args, rootSnapshot)) {
         for (auto& [childHierarchy, variant] : args.root.mChildren) {
             LayerHierarchy::ScopedAddToTraversalPath addChildToPath(root,
                                                                     childHierarchy->getLayer()->id,
@@ -503,31 +552,152 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
     }
 }
 
+std::vector<std::pair<size_t, size_t>> LayerSnapshotBuilder::partitionRootSubtrees(
+        const LayerHierarchy& root) const {
+    const size_t subtreeCount = root.mChildren.size();
+    std::vector<size_t> mergeUpTo(subtreeCount);
+    std::iota(mergeUpTo.begin(), mergeUpTo.end(), 0);
+    TraversalPathToSubtree firstSubtree;
+    for (size_t i = 0; i < subtreeCount; i++) {
+        auto& [childHierarchy, variant] = root.mChildren[i];
+        LayerHierarchy::TraversalPath path = LayerHierarchy::TraversalPath::ROOT;
+        LayerHierarchy::ScopedAddToTraversalPath addChildToPath(path,
+                                                                childHierarchy->getLayer()->id,
+                                                                variant);
+        if (!collectSharedPaths(*childHierarchy, path, i, firstSubtree, mergeUpTo,
+                                /*depth=*/0)) {
+            return {};
+        }
+    }
+
+    // Keep the ranges contiguous so merging them back in order reproduces the serial traversal.
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t begin = 0;
+    while (begin < subtreeCount) {
+        size_t end = mergeUpTo[begin];
+        for (size_t i = begin; i <= end; i++) {
+            end = std::max(end, mergeUpTo[i]);
+        }
+        ranges.emplace_back(begin, end + 1);
+        begin = end + 1;
+    }
+    return ranges;
+}
+
+bool LayerSnapshotBuilder::tryParallelUpdate(const Args& args,
+                                             const LayerSnapshot& rootSnapshot) {
+    if (!args.parallelTraversal || args.root.mChildren.size() < 2 ||
+        args.layerLifecycleManager.getLayers().size() < kMinLayersForParallelUpdate) {
+        return false;
+    }
+
+    SFTRACE_NAME("ParallelUpdate");
+    const std::vector<std::pair<size_t, size_t>> ranges = partitionRootSubtrees(args.root);
+    if (ranges.size() < 2) {
+        return false;
+    }
+
+    if (!mWorkerPool) {
+        const size_t workerCount = std::clamp<size_t>(std::thread::hardware_concurrency(), 2,
+                                                      kMaxParallelUpdateWorkers + 1) -
+                1;
+        mWorkerPool = std::make_unique<utils::WorkerPool>(workerCount, "LSBuilder");
+    }
+
+    std::vector<SubtreeContext> contexts(ranges.size());
+    std::vector<utils::WorkerPool::Task> tasks;
+    tasks.reserve(ranges.size());
+    for (size_t i = 0; i < ranges.size(); i++) {
+        tasks.emplace_back([&, i] {
+            SFTRACE_NAME("UpdateSubtrees");
+            auto [begin, end] = ranges[i];
+            for (size_t child = begin; child < end; child++) {
+                auto& [childHierarchy, variant] = args.root.mChildren[child];
+                const uint32_t childId = childHierarchy->getLayer()->id;
+                LayerHierarchy::TraversalPath path = LayerHierarchy::TraversalPath::ROOT;
+                LayerHierarchy::ScopedAddToTraversalPath addChildToPath(path, childId, variant);
+                updateSnapshotsInHierarchy(args, *childHierarchy, path, rootSnapshot,
+                                           /*depth=*/0, &contexts[i]);
+            }
+        });
+    }
+    mWorkerPool->run(tasks);
+
+    for (SubtreeContext& context : contexts) {
+        mergeSubtreeContext(context);
+    }
+    mStats.parallelUpdates++;
+    mStats.parallelSubtreeGroups += ranges.size();
+    return true;
+}
+
+void LayerSnapshotBuilder::mergeSubtreeContext(SubtreeContext& context) {
+    for (auto& snapshot : context.createdSnapshots) {
+        snapshot->globalZ = mSnapshots.size();
+        mPathToSnapshot[snapshot->path] = snapshot.get();
+        mIdToSnapshots.emplace(snapshot->path.id, snapshot.get());
+        mSnapshots.emplace_back(std::move(snapshot));
+    }
+    mNeedsTouchableRegionCrop.insert(context.needsTouchableRegionCrop.begin(),
+                                     context.needsTouchableRegionCrop.end());
+    mResortSnapshots |= context.resortSnapshots;
+}
+
+void LayerSnapshotBuilder::dumpStats(std::string& result) const {
+    base::StringAppendF(&result,
+                        "LayerSnapshotBuilder: hierarchyUpdates=%" PRIu64
+                        " parallelUpdates=%" PRIu64 " parallelSubtreeGroups=%" PRIu64
+                        " workers=%zu\n",
+                        mStats.hierarchyUpdates, mStats.parallelUpdates,
+                        mStats.parallelSubtreeGroups,
+                        mWorkerPool ? mWorkerPool->getWorkerCount() : 0);
+}
+
 void LayerSnapshotBuilder::update(const Args& args) {
     for (auto& snapshot : mSnapshots) {
         clearChanges(*snapshot);
     }
 
-    if (tryFastUpdate(args)) {
-        return;
+    if (!tryFastUpdate(args)) {
+        updateSnapshots(args);
+    }
+    updateHotFields();
+}
+
+void LayerSnapshotBuilder::updateHotFields() {
+    mHotFields.resize(mSnapshots.size());
+    for (size_t i = 0; i < mSnapshots.size(); i++) {
+        const LayerSnapshot& snapshot = *mSnapshots[i];
+        HotFields& hot = mHotFields[i];
+        hot.transformedBounds = snapshot.transformedBounds;
+        hot.changes = snapshot.changes;
+        hot.layerStack = snapshot.outputFilter.layerStack;
+        hot.alpha = snapshot.alpha;
+        hot.isVisible = snapshot.isVisible;
+        hot.hasInputInfo = snapshot.hasInputInfo();
     }
-    updateSnapshots(args);
 }
 
 const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
         const Args& args, const LayerHierarchy& hierarchy,
         LayerHierarchy::TraversalPath& traversalPath, const LayerSnapshot& parentSnapshot,
-        int depth) {
-    LLOG_ALWAYS_FATAL_WITH_TRACE_IF(depth > 50,
+        int depth, SubtreeContext* context) {
+    LLOG_ALWAYS_FATAL_WITH_TRACE_IF(depth > kMaxTraversalDepth,
                                     "Cycle detected in LayerSnapshotBuilder. See "
                                     "builder_stack_overflow_transactions.winscope");
 
     const RequestedLayerState* layer = hierarchy.getLayer();
     LayerSnapshot* snapshot = getSnapshot(traversalPath);
+    if (!snapshot && context) {
+        auto it = context->createdPathToSnapshot.find(traversalPath);
+        if (it != context->createdPathToSnapshot.end()) {
+            snapshot = it->second;
+        }
+    }
     const bool newSnapshot = snapshot == nullptr;
     uint32_t primaryDisplayRotationFlags = getPrimaryDisplayRotationFlags(args.displays);
     if (newSnapshot) {
-        snapshot = createSnapshot(traversalPath, *layer, parentSnapshot);
+        snapshot = createSnapshot(traversalPath, *layer, parentSnapshot, context);
         snapshot->merge(*layer, /*forceUpdate=*/true, /*displayChanges=*/true, args.forceFullDamage,
                         primaryDisplayRotationFlags);
         snapshot->changes |= RequestedLayerState::Changes::Created;
@@ -540,7 +710,7 @@ const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
         if (traversalPath.isAttached()) {
             resetRelativeState(*snapshot);
         }
-        updateSnapshot(*snapshot, args, *layer, parentSnapshot, traversalPath);
+        updateSnapshot(*snapshot, args, *layer, parentSnapshot, traversalPath, context);
     }
 
     bool childHasValidFrameRate = false;
@@ -550,7 +720,7 @@ const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
                                                                 variant);
         const LayerSnapshot& childSnapshot =
                 updateSnapshotsInHierarchy(args, *childHierarchy, traversalPath, *snapshot,
-                                           depth + 1);
+                                           depth + 1, context);
         updateFrameRateFromChildSnapshot(*snapshot, childSnapshot, *childHierarchy->getLayer(),
                                          args, &childHasValidFrameRate);
     }
@@ -573,15 +743,26 @@ LayerSnapshot* LayerSnapshotBuilder::getSnapshot(const LayerHierarchy::Traversal
 
 LayerSnapshot* LayerSnapshotBuilder::createSnapshot(const LayerHierarchy::TraversalPath& path,
                                                     const RequestedLayerState& layer,
-                                                    const LayerSnapshot& parentSnapshot) {
-    mSnapshots.emplace_back(std::make_unique<LayerSnapshot>(layer, path));
-    LayerSnapshot* snapshot = mSnapshots.back().get();
+                                                    const LayerSnapshot& parentSnapshot,
+                                                    SubtreeContext* context) {
+    if (context) {
+        // The snapshot is moved into mSnapshots by mergeSubtreeContext.
+        context->createdSnapshots.emplace_back(std::make_unique<LayerSnapshot>(layer, path));
+    } else {
+        mSnapshots.emplace_back(std::make_unique<LayerSnapshot>(layer, path));
+    }
+    LayerSnapshot* snapshot =
+            context ? context->createdSnapshots.back().get() : mSnapshots.back().get();
     snapshot->globalZ = static_cast<size_t>(mSnapshots.size()) - 1;
     if (path.isClone() && !LayerHierarchy::isMirror(path.variant)) {
         snapshot->mirrorRootPath = parentSnapshot.mirrorRootPath;
     }
     snapshot->ignoreLocalTransform =
             path.isClone() && path.variant == LayerHierarchy::Variant::Detached_Mirror;
+    if (context) {
+        context->createdPathToSnapshot[path] = snapshot;
+        return snapshot;
+    }
     mPathToSnapshot[path] = snapshot;
 
     mIdToSnapshots.emplace(path.id, snapshot);
@@ -713,7 +894,8 @@ void LayerSnapshotBuilder::resetRelativeState(LayerSnapshot& snapshot) {
 void LayerSnapshotBuilder::updateSnapshot(LayerSnapshot& snapshot, const Args& args,
                                           const RequestedLayerState& requested,
                                           const LayerSnapshot& parentSnapshot,
-                                          const LayerHierarchy::TraversalPath& path) {
+                                          const LayerHierarchy::TraversalPath& path,
+                                          SubtreeContext* context) {
     // Always update flags and visibility
     ftl::Flags<RequestedLayerState::Changes> parentChanges = parentSnapshot.changes &
             (RequestedLayerState::Changes::Hierarchy | RequestedLayerState::Changes::Geometry |
@@ -763,7 +945,7 @@ void LayerSnapshotBuilder::updateSnapshot(LayerSnapshot& snapshot, const Args& a
             snapshot.changes.any(RequestedLayerState::Changes::Geometry |
                                  RequestedLayerState::Changes::BufferSize |
                                  RequestedLayerState::Changes::Input)) {
-            updateInput(snapshot, requested, parentSnapshot, path, args);
+            updateInput(snapshot, requested, parentSnapshot, path, args, context);
         }
         if (forceUpdate ||
             (args.includeMetadata &&
@@ -913,7 +1095,8 @@ void LayerSnapshotBuilder::updateSnapshot(LayerSnapshot& snapshot, const Args& a
 
     if (forceUpdate || snapshot.changes.any(RequestedLayerState::Changes::Geometry)) {
         uint32_t primaryDisplayRotationFlags = getPrimaryDisplayRotationFlags(args.displays);
-        updateLayerBounds(snapshot, requested, parentSnapshot, primaryDisplayRotationFlags);
+        updateLayerBounds(snapshot, requested, parentSnapshot, primaryDisplayRotationFlags,
+                          context);
     }
 
     if (snapshot.edgeExtensionEffect.hasEffect()) {
@@ -934,7 +1117,7 @@ void LayerSnapshotBuilder::updateSnapshot(LayerSnapshot& snapshot, const Args& a
     if (forceUpdate ||
         snapshot.changes.any(RequestedLayerState::Changes::Geometry |
                              RequestedLayerState::Changes::Input)) {
-        updateInput(snapshot, requested, parentSnapshot, path, args);
+        updateInput(snapshot, requested, parentSnapshot, path, args, context);
     }
 
     // computed snapshot properties
@@ -1022,7 +1205,8 @@ void LayerSnapshotBuilder::updateBoundsForEdgeExtension(LayerSnapshot& snapshot)
 void LayerSnapshotBuilder::updateLayerBounds(LayerSnapshot& snapshot,
                                              const RequestedLayerState& requested,
                                              const LayerSnapshot& parentSnapshot,
-                                             uint32_t primaryDisplayRotationFlags) {
+                                             uint32_t primaryDisplayRotationFlags,
+                                             SubtreeContext* context) {
     snapshot.geomLayerTransform = parentSnapshot.geomLayerTransform * snapshot.localTransform;
     const bool transformWasInvalid = snapshot.invalidTransform;
     snapshot.invalidTransform = !LayerSnapshot::isTransformValid(snapshot.geomLayerTransform);
@@ -1051,7 +1235,7 @@ void LayerSnapshotBuilder::updateLayerBounds(LayerSnapshot& snapshot,
     }
     if (transformWasInvalid != snapshot.invalidTransform) {
         // If transform is invalid, the layer will be hidden.
-        mResortSnapshots = true;
+        (context ? context->resortSnapshots : mResortSnapshots) = true;
     }
     snapshot.geomInverseLayerTransform = snapshot.geomLayerTransform.inverse();
 
@@ -1106,7 +1290,7 @@ void LayerSnapshotBuilder::updateInput(LayerSnapshot& snapshot,
                                        const RequestedLayerState& requested,
                                        const LayerSnapshot& parentSnapshot,
                                        const LayerHierarchy::TraversalPath& path,
-                                       const Args& args) {
+                                       const Args& args, SubtreeContext* context) {
     using InputConfig = gui::WindowInfo::InputConfig;
 
     if (requested.windowInfoHandle) {
@@ -1176,7 +1360,11 @@ void LayerSnapshotBuilder::updateInput(LayerSnapshot& snapshot,
     }
 
     if (requested.touchCropId != UNASSIGNED_LAYER_ID || path.isClone()) {
-        mNeedsTouchableRegionCrop.insert(path);
+        if (context) {
+            context->needsTouchableRegionCrop.push_back(path);
+        } else {
+            mNeedsTouchableRegionCrop.insert(path);
+        }
     }
     auto cropLayerSnapshot = getSnapshot(requested.touchCropId);
     if (!cropLayerSnapshot && snapshot.inputInfo.replaceTouchableRegionWithCrop) {
@@ -1210,9 +1398,8 @@ std::vector<std::unique_ptr<LayerSnapshot>>& LayerSnapshotBuilder::getSnapshots(
 
 void LayerSnapshotBuilder::forEachVisibleSnapshot(const ConstVisitor& visitor) const {
     for (int i = 0; i < mNumInterestingSnapshots; i++) {
-        LayerSnapshot& snapshot = *mSnapshots[(size_t)i];
-        if (!snapshot.isVisible) continue;
-        visitor(snapshot);
+        if (!mHotFields[(size_t)i].isVisible) continue;
+        visitor(*mSnapshots[(size_t)i]);
     }
 }
 
@@ -1232,9 +1419,8 @@ void LayerSnapshotBuilder::forEachVisibleSnapshot(const ConstVisitor& visitor,
 
 void LayerSnapshotBuilder::forEachVisibleSnapshot(const Visitor& visitor) {
     for (int i = 0; i < mNumInterestingSnapshots; i++) {
-        std::unique_ptr<LayerSnapshot>& snapshot = mSnapshots.at((size_t)i);
-        if (!snapshot->isVisible) continue;
-        visitor(snapshot);
+        if (!mHotFields[(size_t)i].isVisible) continue;
+        visitor(mSnapshots.at((size_t)i));
     }
 }
 
@@ -1255,9 +1441,8 @@ void LayerSnapshotBuilder::forEachSnapshot(const ConstVisitor& visitor) const {
 
 void LayerSnapshotBuilder::forEachInputSnapshot(const ConstVisitor& visitor) const {
     for (int i = mNumInterestingSnapshots - 1; i >= 0; i--) {
-        LayerSnapshot& snapshot = *mSnapshots[(size_t)i];
-        if (!snapshot.hasInputInfo()) continue;
-        visitor(snapshot);
+        if (!mHotFields[(size_t)i].hasInputInfo) continue;
+        visitor(*mSnapshots[(size_t)i]);
     }
 }
 
@@ -21,6 +21,7 @@
 #include "LayerHierarchy.h"
 #include "LayerSnapshot.h"
 #include "RequestedLayerState.h"
+#include "Utils/WorkerPool.h"
 
 namespace android::surfaceflinger::frontend {
 
@@ -58,6 +59,9 @@ public:
         const std::unordered_map<std::string, bool>& supportedLayerGenericMetadata;
         const std::unordered_map<std::string, uint32_t>& genericLayerMetadataKeyMap;
         bool skipRoundCornersWhenProtected = false;
+        // If true, independent root subtrees are updated concurrently on a worker pool when
+        // the fast path cannot be taken.
+        bool parallelTraversal = false;
         LayerSnapshot rootSnapshot = getRootSnapshot();
     };
     LayerSnapshotBuilder();
@@ -97,20 +101,65 @@ public:
     // Visit each snapshot interesting to input reverse z-order
     void forEachInputSnapshot(const ConstVisitor& visitor) const;
 
+    // Compact copy of the per-frame fields read by the iterators above. The entry at index i
+    // describes mSnapshots[i], so i is also the snapshot's globalZ. This lets the iterators skip
+    // snapshots without touching the much larger LayerSnapshot. The table is refreshed at the
+    // end of every update.
+    struct HotFields {
+        FloatRect transformedBounds;
+        ftl::Flags<RequestedLayerState::Changes> changes;
+        ui::LayerStack layerStack;
+        float alpha = 1.f;
+        bool isVisible = false;
+        bool hasInputInfo = false;
+    };
+    const std::vector<HotFields>& getHotFields() const { return mHotFields; }
+
+    struct Stats {
+        // Number of updates that walked the hierarchy.
+        uint64_t hierarchyUpdates = 0;
+        // Number of hierarchy walks that were split across the worker pool.
+        uint64_t parallelUpdates = 0;
+        // Number of subtree groups processed by the parallel path.
+        uint64_t parallelSubtreeGroups = 0;
+    };
+    const Stats& getStats() const { return mStats; }
+    void dumpStats(std::string& result) const;
+
 private:
     friend class LayerSnapshotTest;
 
+    // Snapshots created and state collected while updating a group of root subtrees off the
+    // main thread. The state is merged back into the builder in subtree order once all groups
+    // are done, so the result matches a serial traversal.
+    struct SubtreeContext {
+        std::vector<std::unique_ptr<LayerSnapshot>> createdSnapshots;
+        std::unordered_map<LayerHierarchy::TraversalPath, LayerSnapshot*,
+                           LayerHierarchy::TraversalPathHash>
+                createdPathToSnapshot;
+        std::vector<LayerHierarchy::TraversalPath> needsTouchableRegionCrop;
+        bool resortSnapshots = false;
+    };
+
     // return true if we were able to successfully update the snapshots via
     // the fast path.
     bool tryFastUpdate(const Args& args);
 
     void updateSnapshots(const Args& args);
 
+    // Returns true if the root subtrees were updated on the worker pool.
+    bool tryParallelUpdate(const Args& args, const LayerSnapshot& rootSnapshot);
+    // Splits the root children into contiguous ranges that can be updated independently of each
+    // other. Root children that visit the same snapshot (via relative z) share a range.
+    std::vector<std::pair<size_t, size_t>> partitionRootSubtrees(const LayerHierarchy& root) const;
+
     const LayerSnapshot& updateSnapshotsInHierarchy(const Args&, const LayerHierarchy& hierarchy,
                                                     LayerHierarchy::TraversalPath& traversalPath,
-                                                    const LayerSnapshot& parentSnapshot, int depth);
+                                                    const LayerSnapshot& parentSnapshot, int depth,
+                                                    SubtreeContext* context = nullptr);
     void updateSnapshot(LayerSnapshot&, const Args&, const RequestedLayerState&,
-                        const LayerSnapshot& parentSnapshot, const LayerHierarchy::TraversalPath&);
+                        const LayerSnapshot& parentSnapshot, const LayerHierarchy::TraversalPath&,
+                        SubtreeContext* context = nullptr);
     static void updateRelativeState(LayerSnapshot& snapshot, const LayerSnapshot& parentSnapshot,
                                     bool parentIsRelative, const Args& args);
     static void resetRelativeState(LayerSnapshot& snapshot);
@@ -121,22 +170,27 @@ private:
                                               const LayerSnapshot& parentSnapshot);
     static void updateBoundsForEdgeExtension(LayerSnapshot& snapshot);
     void updateLayerBounds(LayerSnapshot& snapshot, const RequestedLayerState& layerState,
-                           const LayerSnapshot& parentSnapshot, uint32_t displayRotationFlags);
+                           const LayerSnapshot& parentSnapshot, uint32_t displayRotationFlags,
+                           SubtreeContext* context = nullptr);
     static void updateShadows(LayerSnapshot& snapshot, const RequestedLayerState& requested,
                               const ShadowSettings& globalShadowSettings);
     void updateInput(LayerSnapshot& snapshot, const RequestedLayerState& requested,
                      const LayerSnapshot& parentSnapshot, const LayerHierarchy::TraversalPath& path,
-                     const Args& args);
+                     const Args& args, SubtreeContext* context = nullptr);
     // Return true if there are unreachable snapshots
     bool sortSnapshotsByZ(const Args& args);
     LayerSnapshot* createSnapshot(const LayerHierarchy::TraversalPath& id,
                                   const RequestedLayerState& layer,
-                                  const LayerSnapshot& parentSnapshot);
+                                  const LayerSnapshot& parentSnapshot,
+                                  SubtreeContext* context = nullptr);
+    // Moves the snapshots created by a parallel subtree update into the builder.
+    void mergeSubtreeContext(SubtreeContext& context);
     void updateFrameRateFromChildSnapshot(LayerSnapshot& snapshot,
                                           const LayerSnapshot& childSnapshot,
                                           const RequestedLayerState& requestedCHildState,
                                           const Args& args, bool* outChildHasValidFrameRate);
     void updateTouchableRegionCrop(const Args& args);
+    void updateHotFields();
 
     std::unordered_map<LayerHierarchy::TraversalPath, LayerSnapshot*,
                        LayerHierarchy::TraversalPathHash>
@@ -147,8 +201,13 @@ private:
     std::unordered_set<LayerHierarchy::TraversalPath, LayerHierarchy::TraversalPathHash>
             mNeedsTouchableRegionCrop;
     std::vector<std::unique_ptr<LayerSnapshot>> mSnapshots;
+    std::vector<HotFields> mHotFields;
     bool mResortSnapshots = false;
     int mNumInterestingSnapshots = 0;
+
+    // Lazily created the first time a parallel traversal is requested.
+    std::unique_ptr<utils::WorkerPool> mWorkerPool;
+    Stats mStats;
 };
 
 } // namespace android::surfaceflinger::frontend
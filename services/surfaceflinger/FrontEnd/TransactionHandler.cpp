@@ -19,8 +19,11 @@
 #define LOG_TAG "SurfaceFlinger"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <android-base/stringprintf.h>
 #include <common/trace.h>
 #include <cutils/trace.h>
+#include <inttypes.h>
+#include <poll.h>
 #include <utils/Log.h>
 #include "FrontEnd/LayerLog.h"
 
@@ -40,16 +43,26 @@ void TransactionHandler::collectTransactions() {
         if (!maybeTransaction.has_value()) {
             break;
         }
-        auto transaction = maybeTransaction.value();
+        auto transaction = std::move(maybeTransaction.value());
         mPendingTransactionQueues[transaction.applyToken].emplace(std::move(transaction));
     }
 }
 
 std::vector<TransactionState> TransactionHandler::flushTransactions() {
     // Collect transaction that are ready to be applied.
-    std::vector<TransactionState> transactions;
+    std::vector<TransactionState> transactions = std::move(mRecycledTransactions);
+    mRecycledTransactions.clear();
+    // Only the transactions that are pending can be flushed, so reserving for them avoids
+    // regrowing the vector and moving the transactions while collecting them.
+    const size_t pendingTransactionCount = mPendingTransactionCount.load();
+    if (transactions.capacity() < pendingTransactionCount) {
+        transactions.reserve(pendingTransactionCount);
+        mStats.storageAllocations++;
+    }
+    prefetchFenceStatuses();
     TransactionFlushState flushState;
     flushState.queueProcessTime = systemTime();
+    flushState.fenceStatuses = &mFenceStatuses;
     // Transactions with a buffer pending on a barrier may be on a different applyToken
     // than the transaction which satisfies our barrier. In fact this is the exact use case
     // that the primitive is designed for. This means we may first process
@@ -69,12 +82,120 @@ std::vector<TransactionState> TransactionHandler::flushTransactions() {
     } while (lastTransactionsPendingBarrier != transactionsPendingBarrier);
 
     applyUnsignaledBufferTransaction(transactions, flushState);
+    mFenceStatuses.clear();
 
     mPendingTransactionCount.fetch_sub(transactions.size());
     SFTRACE_INT("TransactionQueue", static_cast<int>(mPendingTransactionCount.load()));
+    mStats.flushes++;
+    mStats.transactionsFlushed += transactions.size();
+    mStats.maxTransactionsPerFlush = std::max(mStats.maxTransactionsPerFlush, transactions.size());
     return transactions;
 }
 
+void TransactionHandler::recycleFlushedTransactions(std::vector<TransactionState>&& transactions) {
+    // Don't hold on to the storage of an unusually large burst of transactions.
+    static constexpr size_t kMaxRecycledTransactions = 256;
+    if (transactions.capacity() > kMaxRecycledTransactions ||
+        transactions.capacity() <= mRecycledTransactions.capacity()) {
+        return;
+    }
+    transactions.clear();
+    mRecycledTransactions = std::move(transactions);
+}
+
+void TransactionHandler::dumpStats(std::string& result) const {
+    base::StringAppendF(&result,
+                        "TransactionHandler: flushes=%" PRIu64 " transactionsFlushed=%" PRIu64
+                        " maxTransactionsPerFlush=%zu storageAllocations=%" PRIu64
+                        " fencesPolled=%" PRIu64 " fencePolls=%" PRIu64 "\n",
+                        mStats.flushes, mStats.transactionsFlushed, mStats.maxTransactionsPerFlush,
+                        mStats.storageAllocations, mStats.fencesPolled, mStats.fencePolls);
+}
+
+void TransactionHandler::prefetchFenceStatuses() {
+    // Bounds the poll() call when a client floods the queues.
+    static constexpr size_t kMaxPrefetchedFences = 128;
+
+    mFenceStatuses.clear();
+    for (const auto& [_, queue] : mPendingTransactionQueues) {
+        // std::queue doesn't expose iterators, only the transactions at the front can be
+        // flushed in most frames anyway.
+        const TransactionState& transaction = queue.front();
+        transaction.traverseStatesWithBuffers([&](const layer_state_t& state) {
+            if (state.bufferData->flags.test(BufferData::BufferDataChange::fenceChanged) &&
+                state.bufferData->acquireFence && mPrefetchFences.size() < kMaxPrefetchedFences) {
+                mPrefetchFences.push_back(state.bufferData->acquireFence);
+            }
+        });
+    }
+    if (mPrefetchFences.empty()) {
+        return;
+    }
+
+    SFTRACE_NAME("PrefetchFenceStatuses");
+    if (const size_t polled = mFenceStatuses.prefetch(mPrefetchFences); polled > 0) {
+        mStats.fencesPolled += polled;
+        mStats.fencePolls++;
+    }
+    mPrefetchFences.clear();
+}
+
+void TransactionHandler::FenceStatusCache::clear() {
+    mStatuses.clear();
+}
+
+size_t TransactionHandler::FenceStatusCache::prefetch(const std::vector<sp<Fence>>& fences) {
+    mPollFds.clear();
+    mPollFences.clear();
+    for (const auto& fence : fences) {
+        // Fences without a file descriptor are resolved by getStatus, they may be fakes.
+        if (fence->get() < 0 || mStatuses.contains(fence.get())) {
+            continue;
+        }
+        mStatuses.emplace(fence.get(), Fence::Status::Unsignaled);
+        mPollFds.push_back({.fd = fence->get(), .events = POLLIN, .revents = 0});
+        mPollFences.push_back(fence.get());
+    }
+    if (mPollFds.empty()) {
+        return 0;
+    }
+
+    int result;
+    do {
+        result = poll(mPollFds.data(), mPollFds.size(), /*timeout=*/0);
+    } while (result == -1 && (errno == EINTR || errno == EAGAIN));
+    if (result == -1) {
+        ALOGW("Failed to poll %zu acquire fences: %s", mPollFds.size(), strerror(errno));
+        for (const Fence* fence : mPollFences) {
+            mStatuses.erase(fence);
+        }
+        return 0;
+    }
+
+    // Matches the sync_wait() behind Fence::getStatus.
+    for (size_t i = 0; i < mPollFds.size(); i++) {
+        const short revents = mPollFds[i].revents;
+        Fence::Status status = Fence::Status::Unsignaled;
+        if (revents & (POLLERR | POLLNVAL)) {
+            status = Fence::Status::Invalid;
+        } else if (revents & POLLIN) {
+            status = Fence::Status::Signaled;
+        }
+        mStatuses[mPollFences[i]] = status;
+    }
+    return mPollFds.size();
+}
+
+Fence::Status TransactionHandler::FenceStatusCache::getStatus(const sp<Fence>& fence) {
+    auto it = mStatuses.find(fence.get());
+    if (it != mStatuses.end()) {
+        return it->second;
+    }
+    const Fence::Status status = fence->getStatus();
+    mStatuses.emplace(fence.get(), status);
+    return status;
+}
+
 void TransactionHandler::applyUnsignaledBufferTransaction(
         std::vector<TransactionState>& transactions, TransactionFlushState& flushState) {
     if (!flushState.queueWithUnsignaledBuffer) {
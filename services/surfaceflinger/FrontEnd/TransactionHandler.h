@@ -16,9 +16,12 @@
 
 #pragma once
 
+#include <poll.h>
 #include <semaphore.h>
 #include <cstdint>
 #include <optional>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <LocklessQueue.h>
@@ -26,6 +29,7 @@
 #include <android-base/thread_annotations.h>
 #include <ftl/small_map.h>
 #include <ftl/small_vector.h>
+#include <ui/Fence.h>
 
 namespace android {
 
@@ -34,6 +38,24 @@ namespace surfaceflinger::frontend {
 
 class TransactionHandler {
 public:
+    // Acquire fence states sampled once per flush. The fences of every pending transaction are
+    // polled together with a single poll() instead of one sync_wait() per fence, and the filters
+    // never query the same fence twice while the queues are flushed.
+    class FenceStatusCache {
+    public:
+        void clear();
+        // Polls the fences that are not cached yet in one pass. Returns the number of fences
+        // that were polled.
+        size_t prefetch(const std::vector<sp<Fence>>& fences);
+        // Returns the cached status, querying the fence if it was not prefetched.
+        Fence::Status getStatus(const sp<Fence>& fence);
+
+    private:
+        std::unordered_map<const Fence*, Fence::Status> mStatuses;
+        std::vector<pollfd> mPollFds;
+        std::vector<const Fence*> mPollFences;
+    };
+
     struct TransactionFlushState {
         TransactionState* transaction;
         bool firstTransaction = true;
@@ -45,6 +67,8 @@ public:
         // LatchUnsignaledConfig::AutoSingleLayer to ensure we only apply an unsignaled buffer
         // if it's the only transaction that is ready to be applied.
         sp<IBinder> queueWithUnsignaledBuffer = nullptr;
+        // Filters should check acquire fences through the cache when it is set.
+        FenceStatusCache* fenceStatuses = nullptr;
     };
     enum class TransactionReadiness {
         // Transaction is ready to be applied
@@ -62,6 +86,9 @@ public:
     // Moves transactions from the lockless queue.
     void collectTransactions();
     std::vector<TransactionState> flushTransactions();
+    // Hands the vector returned by flushTransactions back once the frame is done with it. The
+    // transactions are destroyed and the storage is reused by the next flush.
+    void recycleFlushedTransactions(std::vector<TransactionState>&&);
     void addTransactionReadyFilter(TransactionFilter&&);
     void queueTransaction(TransactionState&&);
 
@@ -77,6 +104,19 @@ public:
     std::optional<StalledTransactionInfo> getStalledTransactionInfo(pid_t pid);
     void onLayerDestroyed(uint32_t layerId);
 
+    struct Stats {
+        uint64_t flushes = 0;
+        uint64_t transactionsFlushed = 0;
+        size_t maxTransactionsPerFlush = 0;
+        // Number of flushes that could not reuse recycled storage and had to allocate.
+        uint64_t storageAllocations = 0;
+        // Acquire fences sampled by batched polls, and the number of poll() calls it took.
+        uint64_t fencesPolled = 0;
+        uint64_t fencePolls = 0;
+    };
+    const Stats& getStats() const { return mStats; }
+    void dumpStats(std::string& result) const;
+
 private:
     // For unit tests
     friend class ::android::TestableSurfaceFlinger;
@@ -86,11 +126,18 @@ private:
     void popTransactionFromPending(std::vector<TransactionState>&, TransactionFlushState&,
                                    std::queue<TransactionState>&);
     TransactionReadiness applyFilters(TransactionFlushState&);
+    void prefetchFenceStatuses();
     std::unordered_map<sp<IBinder>, std::queue<TransactionState>, IListenerHash>
             mPendingTransactionQueues;
     LocklessQueue<TransactionState> mLocklessTransactionQueue;
     std::atomic<size_t> mPendingTransactionCount = 0;
     ftl::SmallVector<TransactionFilter, 2> mTransactionReadyFilters;
+    // Storage of the last flushed vector, kept to avoid reallocating it every frame.
+    std::vector<TransactionState> mRecycledTransactions;
+    // Kept across flushes to reuse the allocations.
+    FenceStatusCache mFenceStatuses;
+    std::vector<sp<Fence>> mPrefetchFences;
+    Stats mStats;
 
     std::mutex mStalledMutex;
     std::unordered_map<uint64_t /* transactionId */, StalledTransactionInfo> mStalledTransactions
@@ -16,6 +16,8 @@
 
 #include "JankTracker.h"
 
+#include <pthread.h>
+
 #include <android/gui/IJankListener.h>
 #include "BackgroundExecutor.h"
 
@@ -23,14 +25,31 @@ namespace android {
 
 namespace {
 
-constexpr size_t kJankDataBatchSize = 50;
+constexpr size_t kDefaultJankDataBatchSize = 50;
 
 } // anonymous namespace
 
 std::atomic<size_t> JankTracker::sListenerCount(0);
 std::atomic<bool> JankTracker::sCollectAllJankDataForTesting(false);
+std::atomic<size_t> JankTracker::sBatchSize(kDefaultJankDataBatchSize);
+std::atomic<nsecs_t> JankTracker::sFlushIntervalNs(0);
 
-JankTracker::~JankTracker() {}
+JankTracker::~JankTracker() {
+    {
+        const std::lock_guard<std::mutex> _l(mJankDataLock);
+        mDone = true;
+    }
+    mFlushCondition.notify_all();
+    if (mFlushThread.joinable()) {
+        mFlushThread.join();
+    }
+}
+
+void JankTracker::setBatching(size_t batchSize, nsecs_t flushIntervalNs) {
+    sBatchSize = std::max(batchSize, size_t{1});
+    sFlushIntervalNs = std::max(flushIntervalNs, nsecs_t{0});
+    getInstance().mFlushCondition.notify_all();
+}
 
 void JankTracker::addJankListener(int32_t layerId, sp<IBinder> listener) {
     // Increment right away, so that if an onJankData call comes in before the background thread has
@@ -54,8 +73,24 @@ void JankTracker::removeJankListener(int32_t layerId, sp<IBinder> listener, int6
     BackgroundExecutor::getLowPriorityInstance().sendCallbacks(
             {[layerId, listener = std::move(listener), afterVsync]() {
                 JankTracker& tracker = getInstance();
-                const std::lock_guard<std::mutex> _l(tracker.mLock);
+                tracker.mLock.lock();
                 tracker.markJankListenerForRemovalLocked(layerId, listener, afterVsync);
+                tracker.mLock.unlock();
+
+                // Rather than waiting for the next batch, flush right away if the buffered data
+                // already reaches the frame that the listener is removed after, so that it gets
+                // its last frames and is dropped.
+                tracker.mJankDataLock.lock();
+                int64_t maxVsync = 0;
+                auto range = tracker.mJankData.equal_range(layerId);
+                for (auto it = range.first; it != range.second; it++) {
+                    maxVsync = std::max(it->second.frameVsyncId, maxVsync);
+                }
+                tracker.mJankDataLock.unlock();
+
+                if (maxVsync >= afterVsync) {
+                    tracker.doFlushJankData(layerId);
+                }
             }});
 }
 
@@ -76,13 +111,22 @@ void JankTracker::onJankData(int32_t layerId, gui::JankData data) {
                     return;
                 }
 
+                const bool hasFlushInterval = sFlushIntervalNs > 0;
                 tracker.mJankDataLock.lock();
                 tracker.mJankData.emplace(layerId, data);
                 size_t count = tracker.mJankData.count(layerId);
+                const bool isOldest =
+                        tracker.mOldestJankDataTime.try_emplace(layerId, systemTime()).second;
                 tracker.mJankDataLock.unlock();
 
-                if (count >= kJankDataBatchSize && !sCollectAllJankDataForTesting) {
+                if (sCollectAllJankDataForTesting) {
+                    return;
+                }
+                if (count >= sBatchSize) {
                     tracker.doFlushJankData(layerId);
+                } else if (isOldest && hasFlushInterval) {
+                    tracker.startFlushThread();
+                    tracker.mFlushCondition.notify_all();
                 }
             }});
 }
@@ -144,6 +188,7 @@ void JankTracker::markJankListenerForRemovalLocked(int32_t layerId, sp<IBinder>
 int64_t JankTracker::transferAvailableJankData(int32_t layerId,
                                                std::vector<gui::JankData>& outJankData) {
     const std::lock_guard<std::mutex> _l(mJankDataLock);
+    mOldestJankDataTime.erase(layerId);
     int64_t maxVsync = 0;
     auto range = mJankData.equal_range(layerId);
     for (auto it = range.first; it != range.second;) {
@@ -165,6 +210,52 @@ void JankTracker::dropJankListener(int32_t layerId, sp<IBinder> listener) {
     }
 }
 
+void JankTracker::startFlushThread() {
+    std::call_once(mFlushThreadFlag, [this] {
+        mFlushThread = std::thread(&JankTracker::flushThreadMain, this);
+        pthread_setname_np(mFlushThread.native_handle(), "JankFlush");
+    });
+}
+
+void JankTracker::flushThreadMain() {
+    std::unique_lock<std::mutex> lock(mJankDataLock);
+    while (!mDone) {
+        const nsecs_t flushInterval = sFlushIntervalNs;
+        if (mOldestJankDataTime.empty() || flushInterval == 0) {
+            mFlushCondition.wait(lock);
+            continue;
+        }
+
+        const nsecs_t now = systemTime();
+        nsecs_t nextDeadline = INT64_MAX;
+        std::vector<int32_t> dueLayers;
+        for (auto it = mOldestJankDataTime.begin(); it != mOldestJankDataTime.end();) {
+            const nsecs_t deadline = it->second + flushInterval;
+            if (deadline <= now) {
+                dueLayers.push_back(it->first);
+                it = mOldestJankDataTime.erase(it);
+            } else {
+                nextDeadline = std::min(nextDeadline, deadline);
+                it++;
+            }
+        }
+
+        if (!dueLayers.empty()) {
+            lock.unlock();
+            // On the executor, so that the listeners are still called in order with the other
+            // flushes.
+            BackgroundExecutor::Callbacks callbacks;
+            for (int32_t layerId : dueLayers) {
+                callbacks.push_back([layerId]() { getInstance().doFlushJankData(layerId); });
+            }
+            BackgroundExecutor::getLowPriorityInstance().sendCallbacks(std::move(callbacks));
+            lock.lock();
+            continue;
+        }
+        mFlushCondition.wait_for(lock, std::chrono::nanoseconds(nextDeadline - now));
+    }
+}
+
 void JankTracker::clearAndStartCollectingAllJankDataForTesting() {
     BackgroundExecutor::getLowPriorityInstance().flushQueue();
 
@@ -172,6 +263,7 @@ void JankTracker::clearAndStartCollectingAllJankDataForTesting() {
     JankTracker& tracker = getInstance();
     const std::lock_guard<std::mutex> _l(tracker.mJankDataLock);
     tracker.mJankData.clear();
+    tracker.mOldestJankDataTime.clear();
 
     // Pretend there's at least one listener.
     sListenerCount++;
@@ -201,6 +293,7 @@ void JankTracker::clearAndStopCollectingAllJankDataForTesting() {
     JankTracker& tracker = getInstance();
     const std::lock_guard<std::mutex> _l(tracker.mJankDataLock);
     tracker.mJankData.clear();
+    tracker.mOldestJankDataTime.clear();
 }
 
 } // namespace android
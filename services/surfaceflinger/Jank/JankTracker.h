@@ -16,13 +16,16 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <cstdint>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #include <android/gui/JankData.h>
 #include <binder/IBinder.h>
 #include <utils/Mutex.h>
+#include <utils/Timers.h>
 
 namespace android {
 namespace frametimeline {
@@ -43,6 +46,11 @@ public:
 
     static void onJankData(int32_t layerId, gui::JankData data);
 
+    // The jank data of a layer is sent to its listeners once |batchSize| frames of it are
+    // buffered, or once the oldest of them has been buffered for |flushIntervalNs|, if that is
+    // not 0.
+    static void setBatching(size_t batchSize, nsecs_t flushIntervalNs);
+
 protected:
     // The following methods can be used to force the tracker to collect all jank data and not
     // flush it for a short time period and should *only* be used for testing. Every call to
@@ -74,6 +82,8 @@ private:
 
     int64_t transferAvailableJankData(int32_t layerId, std::vector<gui::JankData>& jankData);
     void dropJankListener(int32_t layerId, sp<IBinder> listener);
+    void startFlushThread();
+    void flushThreadMain();
 
     struct Listener {
         sp<IBinder> mListener;
@@ -87,11 +97,22 @@ private:
     // locking) if there are no listeners registered, which is the most common case.
     static std::atomic<size_t> sListenerCount;
     static std::atomic<bool> sCollectAllJankDataForTesting;
+    static std::atomic<size_t> sBatchSize;
+    static std::atomic<nsecs_t> sFlushIntervalNs;
 
     std::mutex mLock;
     std::unordered_multimap<int32_t, Listener> mJankListeners GUARDED_BY(mLock);
     std::mutex mJankDataLock;
     std::unordered_multimap<int32_t, gui::JankData> mJankData GUARDED_BY(mJankDataLock);
+    // When the oldest jank data still buffered for each layer was added.
+    std::unordered_map<int32_t, nsecs_t> mOldestJankDataTime GUARDED_BY(mJankDataLock);
+
+    // Flushes the layers whose oldest jank data has waited for sFlushIntervalNs. Started with the
+    // first jank data that is buffered while there is a flush interval.
+    std::once_flag mFlushThreadFlag;
+    std::thread mFlushThread;
+    std::condition_variable mFlushCondition;
+    bool mDone GUARDED_BY(mJankDataLock) = false;
 
     friend class JankTrackerTest;
 };
@@ -62,6 +62,7 @@
 #include <algorithm>
 #include <optional>
 
+#include "ChangedAreaEstimator.h"
 #include "DisplayDevice.h"
 #include "DisplayHardware/HWComposer.h"
 #include "FrameTimeline.h"
@@ -175,9 +176,10 @@ Layer::~Layer() {
                         "Layer destructor called off the main thread.");
 
     if (mBufferInfo.mBuffer != nullptr) {
+        // The layer may be destroyed outside of a frame, so don't wait for the next callbacks.
         callReleaseBufferCallback(mDrawingState.releaseBufferListener,
                                   mBufferInfo.mBuffer->getBuffer(), mBufferInfo.mFrameNumber,
-                                  mBufferInfo.mFence);
+                                  mBufferInfo.mFence, /*canBatch*/ false);
     }
     const int32_t layerId = getSequence();
     mFlinger->mTimeStats->onDestroy(layerId);
@@ -670,7 +672,7 @@ Region Layer::getVisibleRegion(const DisplayDevice* display) const {
 
 void Layer::callReleaseBufferCallback(const sp<ITransactionCompletedListener>& listener,
                                       const sp<GraphicBuffer>& buffer, uint64_t framenumber,
-                                      const sp<Fence>& releaseFence) {
+                                      const sp<Fence>& releaseFence, bool canBatch) {
     if (!listener && !mBufferReleaseChannel) {
         return;
     }
@@ -683,7 +685,13 @@ void Layer::callReleaseBufferCallback(const sp<ITransactionCompletedListener>& l
             mFlinger->getMaxAcquiredBufferCountForCurrentRefreshRate(mOwnerUid);
 
     if (listener) {
-        listener->onReleaseBuffer(callbackId, fence, currentMaxAcquiredBufferCount);
+        if (canBatch && mFlinger->mBatchReleaseCallbacks) {
+            mFlinger->getTransactionCallbackInvoker()
+                    .addReleasedBuffer(IInterface::asBinder(listener),
+                                       {callbackId, fence, currentMaxAcquiredBufferCount});
+        } else {
+            listener->onReleaseBuffer(callbackId, fence, currentMaxAcquiredBufferCount);
+        }
     }
 
     if (mBufferReleaseChannel) {
@@ -852,7 +860,7 @@ void Layer::releasePreviousBuffer() {
         // call any release buffer callbacks if set.
         callReleaseBufferCallback(mDrawingState.releaseBufferListener,
                                   mDrawingState.buffer->getBuffer(), mDrawingState.frameNumber,
-                                  mDrawingState.acquireFence);
+                                  mDrawingState.acquireFence, /*canBatch*/ true);
         const int32_t layerId = getSequence();
         mFlinger->mTimeStats->removeTimeRecord(layerId, mDrawingState.frameNumber);
         decrementPendingBufferCount();
@@ -864,7 +872,7 @@ void Layer::releasePreviousBuffer() {
     } else if (EARLY_RELEASE_ENABLED && mLastClientCompositionFence != nullptr) {
         callReleaseBufferCallback(mDrawingState.releaseBufferListener,
                                   mDrawingState.buffer->getBuffer(), mDrawingState.frameNumber,
-                                  mLastClientCompositionFence);
+                                  mLastClientCompositionFence, /*canBatch*/ true);
         mLastClientCompositionFence = nullptr;
     }
 }
@@ -1599,6 +1607,24 @@ void Layer::setIsSmallDirty(frontend::LayerSnapshot* snapshot) {
     }
 
     Rect bounds = snapshot->surfaceDamage.getBounds();
+    if (mFlinger->mChangedAreaEstimator && snapshot->externalTexture) {
+        // Clients that report the whole buffer as damaged would never be small dirty, so the area
+        // that changed is estimated from the buffers instead.
+        const Rect bufferBounds(snapshot->externalTexture->getWidth(),
+                                snapshot->externalTexture->getHeight());
+        Rect damagedBounds;
+        if (!bounds.isValid() ||
+            (bounds.intersect(bufferBounds, &damagedBounds) && damagedBounds == bufferBounds)) {
+            if (snapshot->changes.test(frontend::RequestedLayerState::Changes::Buffer)) {
+                mFlinger->mChangedAreaEstimator->queueBuffer(sequence, snapshot->externalTexture,
+                                                             snapshot->acquireFence);
+            }
+            if (const auto changedBounds =
+                        mFlinger->mChangedAreaEstimator->getChangedBounds(sequence)) {
+                bounds = *changedBounds;
+            }
+        }
+    }
     if (!bounds.isValid()) {
         snapshot->isSmallDirty = false;
         return;
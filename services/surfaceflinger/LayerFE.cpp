@@ -95,27 +95,46 @@ const compositionengine::LayerFECompositionState* LayerFE::getCompositionState()
 }
 
 bool LayerFE::onPreComposition(bool) {
+    // The snapshot may have changed since the last frame.
+    mClientCompositionCache.clear();
     return mSnapshot->hasReadyFrame;
 }
 
+LayerFE::ClientCompositionKey LayerFE::makeClientCompositionKey(
+        const compositionengine::LayerFE::ClientCompositionTargetSettings& targetSettings) {
+    return {.needsFiltering = targetSettings.needsFiltering,
+            .isSecure = targetSettings.isSecure,
+            .isProtected = targetSettings.isProtected,
+            .viewport = targetSettings.viewport,
+            .realContentIsVisible = targetSettings.realContentIsVisible,
+            .clearContent = targetSettings.clearContent,
+            .blurSetting = targetSettings.blurSetting,
+            .whitePointNits = targetSettings.whitePointNits,
+            .treat170mAsSrgb = targetSettings.treat170mAsSrgb};
+}
+
 std::optional<compositionengine::LayerFE::LayerSettings> LayerFE::prepareClientComposition(
         compositionengine::LayerFE::ClientCompositionTargetSettings& targetSettings) const {
-    std::optional<compositionengine::LayerFE::LayerSettings> layerSettings =
-            prepareClientCompositionInternal(targetSettings);
-    // Nothing to render.
-    if (!layerSettings) {
-        return {};
+    const ClientCompositionKey key = makeClientCompositionKey(targetSettings);
+    for (const auto& [cachedKey, cachedSettings] : mClientCompositionCache) {
+        if (cachedKey == key) {
+            return cachedSettings;
+        }
     }
 
-    // HWC requests to clear this layer.
-    if (targetSettings.clearContent) {
-        prepareClearClientComposition(*layerSettings, false /* blackout */);
-        return layerSettings;
+    std::optional<compositionengine::LayerFE::LayerSettings> layerSettings =
+            prepareClientCompositionInternal(targetSettings);
+    if (layerSettings) {
+        if (targetSettings.clearContent) {
+            // HWC requests to clear this layer.
+            prepareClearClientComposition(*layerSettings, false /* blackout */);
+        } else {
+            // set the shadow for the layer if needed
+            prepareShadowClientComposition(*layerSettings, targetSettings.viewport);
+        }
     }
-
-    // set the shadow for the layer if needed
-    prepareShadowClientComposition(*layerSettings, targetSettings.viewport);
-
+    // Nothing to render if there are no settings, which is cached as well.
+    mClientCompositionCache.emplace_back(key, layerSettings);
     return layerSettings;
 }
 
@@ -262,6 +281,7 @@ void LayerFE::prepareBufferStateClientComposition(
         }
     }
     layerSettings.source.buffer.maxLuminanceNits = maxLuminance;
+    layerSettings.source.buffer.frameNumber = mSnapshot->frameNumber;
     layerSettings.frameNumber = mSnapshot->frameNumber;
     layerSettings.bufferId = mSnapshot->externalTexture->getId();
 
@@ -72,6 +72,25 @@ private:
             compositionengine::LayerFE::LayerSettings&,
             compositionengine::LayerFE::ClientCompositionTargetSettings&) const;
 
+    // The fields of ClientCompositionTargetSettings that prepareClientComposition reads. The
+    // settings of a layer are the same for outputs that agree on these, such as a display and a
+    // virtual display that records its layer stack, so they are only prepared once per frame.
+    struct ClientCompositionKey {
+        bool needsFiltering;
+        bool isSecure;
+        bool isProtected;
+        Rect viewport;
+        bool realContentIsVisible;
+        bool clearContent;
+        compositionengine::LayerFE::ClientCompositionTargetSettings::BlurSetting blurSetting;
+        float whitePointNits;
+        bool treat170mAsSrgb;
+
+        bool operator==(const ClientCompositionKey&) const = default;
+    };
+    static ClientCompositionKey makeClientCompositionKey(
+            const compositionengine::LayerFE::ClientCompositionTargetSettings&);
+
     bool hasEffect() const { return fillsColor() || drawShadows() || hasBlur(); }
     bool hasBufferOrSidebandStream() const;
 
@@ -82,6 +101,10 @@ private:
     const sp<GraphicBuffer> getBuffer() const;
 
     CompositionResult mCompositionResult;
+    // Settings prepared during this frame, cleared by onPreComposition.
+    mutable std::vector<std::pair<ClientCompositionKey,
+                                  std::optional<compositionengine::LayerFE::LayerSettings>>>
+            mClientCompositionCache;
     std::string mName;
     std::promise<FenceResult> mReleaseFence;
     ReleaseFencePromiseStatus mReleaseFencePromiseStatus = ReleaseFencePromiseStatus::UNINITIALIZED;
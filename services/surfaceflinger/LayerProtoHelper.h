@@ -93,7 +93,8 @@ public:
     // root
     LayerProtoFromSnapshotGenerator& withOffscreenLayers(
             const frontend::LayerHierarchy& offscreenRoot);
-    perfetto::protos::LayersProto generate() { return mLayersProto; };
+    // Moves the generated layers out, so a generator is used once.
+    perfetto::protos::LayersProto generate() { return std::move(mLayersProto); };
 
 private:
     void writeHierarchyToProto(const frontend::LayerHierarchy& root,
@@ -16,71 +16,64 @@
 
 #pragma once
 
+#include <ftl/ring_queue.h>
+
 #include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
 #include <optional>
 
-// Single consumer multi producer queue. We can understand the two operations independently to see
-// why they are without race condition.
-//
-// push is responsible for maintaining a linked list stored in mPush, and called from multiple
-// threads without lock. We can see that if two threads never observe the same value from
-// mPush.load, it just functions as a normal linked list. In the case where two threads observe the
-// same value, one of them has to execute the compare_exchange first. The one that doesn't execute
-// the compare exchange first, will receive false from compare_exchange. previousHead is updated (by
-// compare_exchange) to the most recent value of mPush, and we try again. It's relatively clear to
-// see that the process can repeat with an arbitrary number of threads.
+// Single consumer multi producer queue, whose values are popped in the order each producer pushed
+// them.
 //
-// Pop is much simpler. If mPop is empty (as it begins) it atomically exchanges
-// the entire push list with null. This is safe, since the only other reader (push)
-// of mPush will retry if it changes in between it's read and atomic compare. We
-// then store the list and pop one element.
+// Values are pushed onto a lock-free ring of N slots, so push does not allocate as long as the
+// consumer keeps up. Once the ring is full, push falls back to an overflow queue behind a mutex,
+// and keeps doing so until the consumer has drained the overflow. The consumer only pops from the
+// overflow once the ring is empty, so a value in the ring is never overtaken by one that the same
+// producer pushed later.
 //
-// If we already had something in the pop list we just pop directly.
-template <typename T>
+// pop only returns std::nullopt if the queue is empty. If another producer is midway through a push
+// onto the ring, pop waits for it to publish its value rather than skipping the slot.
+template <typename T, std::size_t N = 64>
 class LocklessQueue {
 public:
-    bool isEmpty() { return (mPush.load() == nullptr) && (mPop.load() == nullptr); }
+    bool isEmpty() const {
+        return mRing.empty() && !mOverflowing.load(std::memory_order_acquire);
+    }
 
     void push(T value) {
-        Entry* entry = new Entry(std::move(value));
-        Entry* previousHead = mPush.load(/*std::memory_order_relaxed*/);
-        do {
-            entry->mNext = previousHead;
-        } while (!mPush.compare_exchange_weak(previousHead, entry)); /*std::memory_order_release*/
+        if (!mOverflowing.load(std::memory_order_acquire) && mRing.try_push(std::move(value))) {
+            return;
+        }
+
+        std::scoped_lock lock(mOverflowMutex);
+        mOverflow.push_back(std::move(value));
+        mOverflowing.store(true, std::memory_order_release);
     }
 
     std::optional<T> pop() {
-        Entry* popped = mPop.load(/*std::memory_order_acquire*/);
-        if (popped) {
-            // Single consumer so this is fine
-            mPop.store(popped->mNext /* , std::memory_order_release */);
-            auto value = std::move(popped->mValue);
-            delete popped;
-            return value;
-        } else {
-            Entry* grabbedList = mPush.exchange(nullptr /* , std::memory_order_acquire */);
-            if (!grabbedList) return std::nullopt;
-            // Reverse the list
-            while (grabbedList->mNext) {
-                Entry* next = grabbedList->mNext;
-                grabbedList->mNext = popped;
-                popped = grabbedList;
-                grabbedList = next;
+        for (;;) {
+            if (!mRing.empty()) return mRing.pop();
+            if (!mOverflowing.load(std::memory_order_acquire)) return std::nullopt;
+
+            std::scoped_lock lock(mOverflowMutex);
+            // A value pushed onto the ring before one in the overflow is visible under the lock.
+            if (!mRing.empty()) continue;
+
+            std::optional<T> value(std::move(mOverflow.front()));
+            mOverflow.pop_front();
+            if (mOverflow.empty()) {
+                mOverflowing.store(false, std::memory_order_release);
             }
-            mPop.store(popped /* , std::memory_order_release */);
-            auto value = std::move(grabbedList->mValue);
-            delete grabbedList;
             return value;
         }
     }
 
 private:
-    class Entry {
-    public:
-        T mValue;
-        std::atomic<Entry*> mNext;
-        Entry(T value) : mValue(value) {}
-    };
-    std::atomic<Entry*> mPush = nullptr;
-    std::atomic<Entry*> mPop = nullptr;
+    android::ftl::MpscQueue<T, N> mRing;
+
+    std::atomic_bool mOverflowing = false;
+    std::mutex mOverflowMutex;
+    std::deque<T> mOverflow;
 };
@@ -36,6 +36,7 @@
 #include <renderengine/impl/ExternalTexture.h>
 #include <ui/DisplayStatInfo.h>
 
+#include <algorithm>
 #include <string>
 
 #include "DisplayDevice.h"
@@ -64,6 +65,7 @@ constexpr auto defaultRegionSamplingWorkDuration = 3ms;
 constexpr auto defaultRegionSamplingPeriod = 100ms;
 constexpr auto defaultRegionSamplingTimerTimeout = 100ms;
 constexpr auto maxRegionSamplingDelay = 100ms;
+constexpr int32_t defaultRegionSamplingMaxBufferSize = 0;
 // TODO: (b/127403193) duration to string conversion could probably be constexpr
 template <typename Rep, typename Per>
 inline std::string toNsString(std::chrono::duration<Rep, Per> t) {
@@ -100,6 +102,8 @@ RegionSamplingThread::EnvironmentTimingTunables::EnvironmentTimingTunables() {
 RegionSamplingThread::RegionSamplingThread(SurfaceFlinger& flinger, const TimingTunables& tunables)
       : mFlinger(flinger),
         mTunables(tunables),
+        mMaxSampleBufferSize(property_get_int32("debug.sf.region_sampling_max_buffer_size",
+                                                defaultRegionSamplingMaxBufferSize)),
         mIdleTimer(
                 "RegSampIdle",
                 std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -225,8 +229,46 @@ float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t st
     return accumulatedLuma / (255.0f * pixelCount);
 }
 
+ui::Size getSampleBufferSize(ui::Size sampledSize, int32_t maxSide) {
+    const int32_t longestSide = std::max(sampledSize.width, sampledSize.height);
+    if (maxSide <= 0 || longestSide <= maxSide) {
+        return sampledSize;
+    }
+
+    const auto scale = [&](int32_t side) {
+        const int64_t scaled = (int64_t{side} * maxSide + longestSide / 2) / longestSide;
+        return std::max(static_cast<int32_t>(scaled), 1);
+    };
+    return {scale(sampledSize.width), scale(sampledSize.height)};
+}
+
+Rect scaleSampleArea(const Rect& area, const Rect& sampledBounds, ui::Size bufferSize) {
+    const Rect offset = area - sampledBounds.leftTop();
+    const int64_t sampledWidth = sampledBounds.getWidth();
+    const int64_t sampledHeight = sampledBounds.getHeight();
+    if (sampledWidth == bufferSize.width && sampledHeight == bufferSize.height) {
+        return offset;
+    }
+    if (sampledWidth <= 0 || sampledHeight <= 0) {
+        return Rect::INVALID_RECT;
+    }
+
+    const auto floorScale = [](int32_t value, int64_t to, int64_t from) {
+        return static_cast<int32_t>(int64_t{value} * to / from);
+    };
+    const auto ceilScale = [](int32_t value, int64_t to, int64_t from) {
+        return static_cast<int32_t>((int64_t{value} * to + from - 1) / from);
+    };
+    Rect scaled(floorScale(offset.left, bufferSize.width, sampledWidth),
+                floorScale(offset.top, bufferSize.height, sampledHeight),
+                ceilScale(offset.right, bufferSize.width, sampledWidth),
+                ceilScale(offset.bottom, bufferSize.height, sampledHeight));
+    scaled.intersect(Rect(bufferSize), &scaled);
+    return scaled;
+}
+
 std::vector<float> RegionSamplingThread::sampleBuffer(
-        const sp<GraphicBuffer>& buffer, const Point& leftTop,
+        const sp<GraphicBuffer>& buffer, const Rect& sampledBounds,
         const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation) {
     void* data_raw = nullptr;
     buffer->lock(GRALLOC_USAGE_SW_READ_OFTEN, &data_raw);
@@ -241,7 +283,8 @@ std::vector<float> RegionSamplingThread::sampleBuffer(
     std::transform(descriptors.begin(), descriptors.end(), lumas.begin(),
                    [&](auto const& descriptor) {
                        return sampleArea(data.get(), width, height, stride, orientation,
-                                         descriptor.area - leftTop);
+                                         scaleSampleArea(descriptor.area, sampledBounds,
+                                                         ui::Size(width, height)));
                    });
     return lumas;
 }
@@ -277,6 +320,8 @@ void RegionSamplingThread::captureSample() {
     }
 
     const Rect sampledBounds = sampleRegion.bounds();
+    // All of the areas are rendered at once, into a buffer that may be smaller than their bounds.
+    const ui::Size bufferSize = getSampleBufferSize(sampledBounds.getSize(), mMaxSampleBufferSize);
 
     std::unordered_set<sp<IRegionSamplingListener>, SpHash<IRegionSamplingListener>> listeners;
 
@@ -325,14 +370,14 @@ void RegionSamplingThread::captureSample() {
             mFlinger.getLayerSnapshotsForScreenshots(layerStack, CaptureArgs::UNSET_UID, filterFn);
 
     std::shared_ptr<renderengine::ExternalTexture> buffer = nullptr;
-    if (mCachedBuffer && mCachedBuffer->getBuffer()->getWidth() == sampledBounds.getWidth() &&
-        mCachedBuffer->getBuffer()->getHeight() == sampledBounds.getHeight()) {
+    if (mCachedBuffer && mCachedBuffer->getBuffer()->getWidth() == bufferSize.width &&
+        mCachedBuffer->getBuffer()->getHeight() == bufferSize.height) {
         buffer = mCachedBuffer;
     } else {
         const uint32_t usage =
                 GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE;
         sp<GraphicBuffer> graphicBuffer =
-                sp<GraphicBuffer>::make(sampledBounds.getWidth(), sampledBounds.getHeight(),
+                sp<GraphicBuffer>::make(bufferSize.width, bufferSize.height,
                                         PIXEL_FORMAT_RGBA_8888, 1, usage, "RegionSamplingThread");
         const status_t bufferStatus = graphicBuffer->initCheck();
         LOG_ALWAYS_FATAL_IF(bufferStatus != OK, "captureSample: Buffer failed to allocate: %d",
@@ -350,7 +395,7 @@ void RegionSamplingThread::captureSample() {
 
     SurfaceFlinger::RenderAreaBuilderVariant
             renderAreaBuilder(std::in_place_type<DisplayRenderAreaBuilder>, sampledBounds,
-                              sampledBounds.getSize(), ui::Dataspace::V0_SRGB, displayWeak,
+                              bufferSize, ui::Dataspace::V0_SRGB, displayWeak,
                               RenderArea::Options::CAPTURE_SECURE_LAYERS);
 
     FenceResult fenceResult;
@@ -381,8 +426,8 @@ void RegionSamplingThread::captureSample() {
     }
 
     ALOGV("Sampling %zu descriptors", activeDescriptors.size());
-    std::vector<float> lumas = sampleBuffer(buffer->getBuffer(), sampledBounds.leftTop(),
-                                            activeDescriptors, orientation);
+    std::vector<float> lumas =
+            sampleBuffer(buffer->getBuffer(), sampledBounds, activeDescriptors, orientation);
     if (lumas.size() != activeDescriptors.size()) {
         ALOGW("collected %zu median luma values for %zu descriptors", lumas.size(),
               activeDescriptors.size());
@@ -22,6 +22,7 @@
 #include <renderengine/ExternalTexture.h>
 #include <ui/GraphicBuffer.h>
 #include <ui/Rect.h>
+#include <ui/Size.h>
 #include <utils/StrongPointer.h>
 
 #include <chrono>
@@ -45,6 +46,15 @@ using gui::IRegionSamplingListener;
 float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t stride,
                  uint32_t orientation, const Rect& area);
 
+// Returns the size of the buffer that an area of sampledSize is rendered into for sampling. The
+// size is scaled down, keeping the aspect ratio, so that neither side is longer than maxSide. A
+// maxSide of 0 or less keeps the full size.
+ui::Size getSampleBufferSize(ui::Size sampledSize, int32_t maxSide);
+
+// Maps area, in display space, to the pixels of a buffer of bufferSize that sampledBounds was
+// rendered into. The result covers every pixel that area contributes to.
+Rect scaleSampleArea(const Rect& area, const Rect& sampledBounds, ui::Size bufferSize);
+
 class RegionSamplingThread : public IBinder::DeathRecipient {
 public:
     struct TimingTunables {
@@ -92,7 +102,7 @@ private:
     };
 
     std::vector<float> sampleBuffer(
-            const sp<GraphicBuffer>& buffer, const Point& leftTop,
+            const sp<GraphicBuffer>& buffer, const Rect& sampledBounds,
             const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation);
 
     void doSample(std::optional<std::chrono::steady_clock::time_point> samplingDeadline);
@@ -104,6 +114,11 @@ private:
 
     SurfaceFlinger& mFlinger;
     const TimingTunables mTunables;
+    // The longest side of the buffer that the sampled area is rendered into. Larger areas are
+    // scaled down by RenderEngine while rendering, so that only a small buffer is read back and
+    // reduced on the CPU. 0 renders at full resolution.
+    // This can be set by debug.sf.region_sampling_max_buffer_size
+    const int32_t mMaxSampleBufferSize;
     scheduler::OneShotTimer mIdleTimer;
 
     std::thread mThread;
@@ -30,12 +30,14 @@
 #include <type_traits>
 #include <utility>
 
+#include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 
 #include <binder/IPCThreadState.h>
 #include <common/trace.h>
 #include <cutils/compiler.h>
 #include <cutils/sched_policy.h>
+#include <ftl/small_map.h>
 
 #include <gui/DisplayEventReceiver.h>
 #include <gui/SchedulingPolicy.h>
@@ -239,6 +241,25 @@ binder::Status EventThreadConnection::getLatestVsyncEventData(
     return binder::Status::ok();
 }
 
+binder::Status EventThreadConnection::getSharedVsyncEventData(os::ParcelFileDescriptor* outFd) {
+    std::scoped_lock lock(mLock);
+    if (!mSharedVsyncEventData) {
+        std::string name = StringPrintf("SharedVsyncEventData-%d", mOwnerUid);
+        const status_t status =
+                gui::SharedVsyncEventData::createWriter(std::move(name), mSharedVsyncEventData);
+        if (status != OK) {
+            return binder::Status::fromStatusT(status);
+        }
+    }
+
+    base::unique_fd fd = mSharedVsyncEventData->dupReaderFd();
+    if (!fd.ok()) {
+        return binder::Status::fromStatusT(NO_MEMORY);
+    }
+    *outFd = os::ParcelFileDescriptor(std::move(fd));
+    return binder::Status::ok();
+}
+
 binder::Status EventThreadConnection::getSchedulingPolicy(gui::SchedulingPolicy* outPolicy) {
     return gui::getSchedulingPolicy(outPolicy);
 }
@@ -261,6 +282,15 @@ status_t EventThreadConnection::postEvent(const DisplayEventReceiver::Event& eve
         return toStatus(size);
     }
 
+    if (event.header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
+        // Published before the event is sent, so that the page is up to date when the app wakes
+        // up for it.
+        std::scoped_lock lock(mLock);
+        if (mSharedVsyncEventData) {
+            mSharedVsyncEventData->publish(event.vsync.vsyncData);
+        }
+    }
+
     auto size = DisplayEventReceiver::sendEvents(&mChannel, &event, 1);
     return toStatus(size);
 }
@@ -282,7 +312,9 @@ EventThread::EventThread(const char* name, std::shared_ptr<scheduler::VsyncSched
         mVsyncSchedule(std::move(vsyncSchedule)),
         mVsyncRegistration(mVsyncSchedule->getDispatch(), createDispatchCallback(), name),
         mTokenManager(tokenManager),
-        mCallback(callback) {
+        mCallback(callback),
+        mShareFrameTimelines(
+                base::GetBoolProperty("debug.sf.event_thread_share_frame_timelines", false)) {
     mThread = std::thread([this]() NO_THREAD_SAFETY_ANALYSIS {
         std::unique_lock<std::mutex> lock(mMutex);
         threadMain(lock);
@@ -701,14 +733,30 @@ void EventThread::generateFrameTimeline(VsyncEventData& outVsyncEventData, nsecs
 
 void EventThread::dispatchEvent(const DisplayEventReceiver::Event& event,
                                 const DisplayEventConsumers& consumers) {
+    // Consumers with the same frame interval get the same predictions. When sharing is enabled, the
+    // frame timelines and their tokens are generated once per frame interval rather than once per
+    // consumer.
+    ftl::SmallMap<nsecs_t, VsyncEventData, 4> frameTimelinesByInterval;
+
     for (const auto& consumer : consumers) {
         DisplayEventReceiver::Event copy = event;
         if (event.header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
             const Period frameInterval = mCallback.getVsyncPeriod(consumer->mOwnerUid);
-            copy.vsync.vsyncData.frameInterval = frameInterval.ns();
-            generateFrameTimeline(copy.vsync.vsyncData, frameInterval.ns(), copy.header.timestamp,
-                                  event.vsync.vsyncData.preferredExpectedPresentationTime(),
-                                  event.vsync.vsyncData.preferredDeadlineTimestamp());
+            const auto it = mShareFrameTimelines ? frameTimelinesByInterval.find(frameInterval.ns())
+                                                 : frameTimelinesByInterval.end();
+            if (it != frameTimelinesByInterval.end()) {
+                copy.vsync.vsyncData = it->second;
+            } else {
+                copy.vsync.vsyncData.frameInterval = frameInterval.ns();
+                generateFrameTimeline(copy.vsync.vsyncData, frameInterval.ns(),
+                                      copy.header.timestamp,
+                                      event.vsync.vsyncData.preferredExpectedPresentationTime(),
+                                      event.vsync.vsyncData.preferredDeadlineTimestamp());
+                if (mShareFrameTimelines) {
+                    frameTimelinesByInterval.try_emplace(frameInterval.ns(),
+                                                         copy.vsync.vsyncData);
+                }
+            }
         }
         switch (consumer->postEvent(copy)) {
             case NO_ERROR:
@@ -19,6 +19,7 @@
 #include <android-base/thread_annotations.h>
 #include <android/gui/BnDisplayEventConnection.h>
 #include <gui/DisplayEventReceiver.h>
+#include <gui/SharedVsyncEventData.h>
 #include <private/gui/BitTube.h>
 #include <sys/types.h>
 #include <utils/Errors.h>
@@ -78,6 +79,7 @@ public:
     binder::Status setVsyncRate(int rate) override;
     binder::Status requestNextVsync() override; // asynchronous
     binder::Status getLatestVsyncEventData(ParcelableVsyncEventData* outVsyncEventData) override;
+    binder::Status getSharedVsyncEventData(os::ParcelFileDescriptor* outFd) override;
     binder::Status getSchedulingPolicy(gui::SchedulingPolicy* outPolicy) override;
 
     VSyncRequest vsyncRequest = VSyncRequest::None;
@@ -92,6 +94,8 @@ private:
     EventThread* const mEventThread;
     std::mutex mLock;
     gui::BitTube mChannel GUARDED_BY(mLock);
+    // Created when the app first asks for it, and updated with every vsync event sent.
+    std::unique_ptr<gui::SharedVsyncEventData::Writer> mSharedVsyncEventData GUARDED_BY(mLock);
 
     std::vector<DisplayEventReceiver::Event> mPendingEvents;
 };
@@ -226,6 +230,10 @@ private:
 
     IEventThreadCallback& mCallback;
 
+    // Whether consumers that share a frame interval also share the vsyncIds of their frame
+    // timelines, see dispatchEvent.
+    bool mShareFrameTimelines GUARDED_BY(mMutex);
+
     std::thread mThread;
     mutable std::mutex mMutex;
     mutable std::condition_variable mCondition;
@@ -64,6 +64,10 @@ bool traceEnabled() {
     return property_get_bool("debug.sf.layer_history_trace", false);
 }
 
+bool voteCachingEnabled() {
+    return property_get_bool("debug.sf.layer_history_cache_votes", false);
+}
+
 bool useFrameRatePriority() {
     char value[PROPERTY_VALUE_MAX];
     property_get("debug.sf.use_frame_rate_priority", value, "1");
@@ -105,6 +109,7 @@ LayerHistory::LayerVoteType getVoteType(FrameRateCompatibility compatibility,
 LayerHistory::LayerHistory()
       : mTraceEnabled(traceEnabled()), mUseFrameRatePriority(useFrameRatePriority()) {
     LayerInfo::setTraceEnabled(mTraceEnabled);
+    LayerInfo::setVoteCachingEnabled(voteCachingEnabled());
 }
 
 LayerHistory::~LayerHistory() = default;
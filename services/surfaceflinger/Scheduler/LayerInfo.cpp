@@ -24,6 +24,7 @@
 #include "LayerInfo.h"
 
 #include <algorithm>
+#include <limits>
 #include <utility>
 
 #include <android/native_window.h>
@@ -39,6 +40,7 @@
 namespace android::scheduler {
 
 bool LayerInfo::sTraceEnabled = false;
+bool LayerInfo::sVoteCachingEnabled = false;
 
 LayerInfo::LayerInfo(const std::string& name, uid_t ownerUid,
                      LayerHistory::LayerVoteType defaultVote)
@@ -56,6 +58,7 @@ void LayerInfo::setLastPresentTime(nsecs_t lastPresentTime, nsecs_t now, LayerUp
     lastPresentTime = std::max(lastPresentTime, static_cast<nsecs_t>(0));
 
     *mLayerProps = props;
+    mCachedVotes.reset();
     switch (updateType) {
         case LayerUpdateType::AnimationTX:
             mLastUpdatedTime = std::max(lastPresentTime, now);
@@ -72,16 +75,14 @@ void LayerInfo::setLastPresentTime(nsecs_t lastPresentTime, nsecs_t now, LayerUp
                                        .queueTime = mLastUpdatedTime,
                                        .pendingModeChange = pendingModeChange,
                                        .isSmallDirty = props.isSmallDirty};
-            mFrameTimes.push_back(frameTime);
-            if (mFrameTimes.size() > HISTORY_SIZE) {
-                mFrameTimes.pop_front();
-            }
+            mFrameTimes.push(frameTime);
             break;
     }
 }
 
 void LayerInfo::setProperties(const android::scheduler::LayerProps& properties) {
     *mLayerProps = properties;
+    mCachedVotes.reset();
 }
 
 bool LayerInfo::isFrameTimeValid(const FrameTimeData& frameTime) const {
@@ -114,10 +115,10 @@ LayerInfo::Frequent LayerInfo::isFrequent(nsecs_t now) const {
     int32_t smallDirtyCount = 0;
     const auto n = mFrameTimes.size() - 1;
     for (size_t i = 0; i < kFrequentLayerWindowSize - 1; i++) {
-        if (mFrameTimes[n - i].queueTime - mFrameTimes[n - i - 1].queueTime <
+        if (mFrameTimes.queueTime(n - i) - mFrameTimes.queueTime(n - i - 1) <
             kMaxPeriodForFrequentLayerNs.count()) {
             isInfrequent = false;
-            if (mFrameTimes[n - i].presentTime == 0 && mFrameTimes[n - i].isSmallDirty) {
+            if (mFrameTimes.presentTime(n - i) == 0 && mFrameTimes.isSmallDirty(n - i)) {
                 smallDirtyCount++;
             }
         } else {
@@ -157,20 +158,21 @@ LayerInfo::Frequent LayerInfo::isFrequent(nsecs_t now) const {
 
 Fps LayerInfo::getFps(nsecs_t now) const {
     // Find the first active frame
-    auto it = mFrameTimes.begin();
-    for (; it != mFrameTimes.end(); ++it) {
-        if (it->queueTime >= getActiveLayerThreshold(now)) {
+    size_t first = 0;
+    for (; first < mFrameTimes.size(); first++) {
+        if (mFrameTimes.queueTime(first) >= getActiveLayerThreshold(now)) {
             break;
         }
     }
 
-    const auto numFrames = std::distance(it, mFrameTimes.end());
+    const auto numFrames = static_cast<nsecs_t>(mFrameTimes.size() - first);
     if (numFrames < kFrequentLayerWindowSize) {
         return Fps();
     }
 
     // Layer is considered frequent if the average frame rate is higher than the threshold
-    const auto totalTime = mFrameTimes.back().queueTime - it->queueTime;
+    const auto totalTime =
+            mFrameTimes.queueTime(mFrameTimes.size() - 1) - mFrameTimes.queueTime(first);
     return Fps::fromPeriodNsecs(totalTime / (numFrames - 1));
 }
 
@@ -185,12 +187,13 @@ bool LayerInfo::hasEnoughDataForHeuristic() const {
         return false;
     }
 
-    if (!isFrameTimeValid(mFrameTimes.front())) {
+    if (!isFrameTimeValid(mFrameTimes[0])) {
         ALOGV("%s stale frames still captured", mName.c_str());
         return false;
     }
 
-    const auto totalDuration = mFrameTimes.back().queueTime - mFrameTimes.front().queueTime;
+    const auto totalDuration =
+            mFrameTimes.queueTime(mFrameTimes.size() - 1) - mFrameTimes.queueTime(0);
     if (mFrameTimes.size() < HISTORY_SIZE && totalDuration < HISTORY_DURATION.count()) {
         ALOGV("%s not enough frames captured: %zu | %.2f seconds", mName.c_str(),
               mFrameTimes.size(), totalDuration / 1e9f);
@@ -202,16 +205,11 @@ bool LayerInfo::hasEnoughDataForHeuristic() const {
 
 std::optional<nsecs_t> LayerInfo::calculateAverageFrameTime() const {
     // Ignore frames captured during a mode change
-    const bool isDuringModeChange =
-            std::any_of(mFrameTimes.begin(), mFrameTimes.end(),
-                        [](const auto& frame) { return frame.pendingModeChange; });
-    if (isDuringModeChange) {
+    if (mFrameTimes.hasPendingModeChange()) {
         return std::nullopt;
     }
 
-    const bool isMissingPresentTime =
-            std::any_of(mFrameTimes.begin(), mFrameTimes.end(),
-                        [](auto frame) { return frame.presentTime == 0; });
+    const bool isMissingPresentTime = mFrameTimes.isMissingPresentTime();
 
     // Calculate the average frame time based on presentation timestamps. If those
     // doesn't exist, we look at the time the buffer was queued only. We can do that only if
@@ -221,15 +219,24 @@ std::optional<nsecs_t> LayerInfo::calculateAverageFrameTime() const {
     // presentation timestamps we look at the queue time to see if the current refresh rate still
     // matches the content.
 
-    auto getFrameTime = isMissingPresentTime ? [](FrameTimeData data) { return data.queueTime; }
-                                             : [](FrameTimeData data) { return data.presentTime; };
+    const auto getFrameTime = [this, isMissingPresentTime](size_t i) {
+        return isMissingPresentTime ? mFrameTimes.queueTime(i) : mFrameTimes.presentTime(i);
+    };
+
+    // When no interval needs to be skipped, the deltas add up to the time between the first and
+    // the last frame.
+    if (mFrameTimes.size() >= 2 && mFrameTimes.hasRegularIntervals(!isMissingPresentTime)) {
+        const auto totalTime = getFrameTime(mFrameTimes.size() - 1) - getFrameTime(0);
+        return static_cast<nsecs_t>(static_cast<double>(totalTime) /
+                                    static_cast<double>(mFrameTimes.size() - 1));
+    }
 
     nsecs_t totalDeltas = 0;
     int numDeltas = 0;
     int32_t smallDirtyCount = 0;
-    auto prevFrame = mFrameTimes.begin();
-    for (auto it = mFrameTimes.begin() + 1; it != mFrameTimes.end(); ++it) {
-        const auto currDelta = getFrameTime(*it) - getFrameTime(*prevFrame);
+    size_t prevFrame = 0;
+    for (size_t i = 1; i < mFrameTimes.size(); i++) {
+        const auto currDelta = getFrameTime(i) - getFrameTime(prevFrame);
         if (currDelta < kMinPeriodBetweenFrames) {
             // Skip this frame, but count the delta into the next frame
             continue;
@@ -237,12 +244,12 @@ std::optional<nsecs_t> LayerInfo::calculateAverageFrameTime() const {
 
         // If this is a small area update, we don't want to consider it for calculating the average
         // frame time. Instead, we let the bigger frame updates to drive the calculation.
-        if (it->isSmallDirty && currDelta < kMinPeriodBetweenSmallDirtyFrames) {
+        if (mFrameTimes.isSmallDirty(i) && currDelta < kMinPeriodBetweenSmallDirtyFrames) {
             smallDirtyCount++;
             continue;
         }
 
-        prevFrame = it;
+        prevFrame = i;
 
         if (currDelta > kMaxPeriodBetweenFrames) {
             // Skip this frame and the current delta.
@@ -303,7 +310,25 @@ std::optional<Fps> LayerInfo::calculateRefreshRateIfPossible(const RefreshRateSe
 LayerInfo::RefreshRateVotes LayerInfo::getRefreshRateVote(const RefreshRateSelector& selector,
                                                           nsecs_t now) {
     SFTRACE_CALL();
+    if (sVoteCachingEnabled && mCachedVotes && now < mCachedVotes->validUntil) {
+        SFTRACE_FORMAT_INSTANT("cached");
+        return mCachedVotes->votes;
+    }
+
+    nsecs_t validUntil = now;
+    auto votes = calculateRefreshRateVote(selector, now, validUntil);
+    if (sVoteCachingEnabled && validUntil > now) {
+        mCachedVotes = {votes, validUntil};
+    } else {
+        mCachedVotes.reset();
+    }
+    return votes;
+}
+
+LayerInfo::RefreshRateVotes LayerInfo::calculateRefreshRateVote(const RefreshRateSelector& selector,
+                                                                nsecs_t now, nsecs_t& validUntil) {
     LayerInfo::RefreshRateVotes votes;
+    constexpr nsecs_t kForever = std::numeric_limits<nsecs_t>::max();
 
     if (mLayerVote.type != LayerHistory::LayerVoteType::Heuristic) {
         if (mLayerVote.category != FrameRateCategory::Default) {
@@ -327,6 +352,8 @@ LayerInfo::RefreshRateVotes LayerInfo::getRefreshRateVote(const RefreshRateSelec
                              FrameRateCategory::Default, mLayerVote.categorySmoothSwitchOnly});
         }
 
+        // Explicit votes only depend on the layer vote.
+        validUntil = kForever;
         return votes;
     }
 
@@ -335,6 +362,8 @@ LayerInfo::RefreshRateVotes LayerInfo::getRefreshRateVote(const RefreshRateSelec
         ALOGV("%s is animating", mName.c_str());
         mLastRefreshRate.animating = true;
         votes.push_back({LayerHistory::LayerVoteType::Max, Fps()});
+        // The layer keeps animating until its last animation falls out of the active window.
+        validUntil = mLastAnimationTime + MAX_ACTIVE_LAYER_PERIOD_NS.count() + 1;
         return votes;
     }
 
@@ -343,6 +372,7 @@ LayerInfo::RefreshRateVotes LayerInfo::getRefreshRateVote(const RefreshRateSelec
         SFTRACE_FORMAT_INSTANT("front buffered");
         ALOGV("%s is front-buffered", mName.c_str());
         votes.push_back({LayerHistory::LayerVoteType::Max, Fps()});
+        validUntil = kForever;
         return votes;
     }
 
@@ -356,6 +386,9 @@ LayerInfo::RefreshRateVotes LayerInfo::getRefreshRateVote(const RefreshRateSelec
         // Infrequent layers vote for minimal refresh rate for
         // battery saving purposes and also to prevent b/135718869.
         votes.push_back({LayerHistory::LayerVoteType::Min, Fps()});
+        // Without new frames the layer stays infrequent until it becomes inactive, which clears
+        // the cached votes.
+        validUntil = kForever;
         return votes;
     }
 
@@ -387,6 +420,74 @@ LayerInfo::RefreshRateVotes LayerInfo::getRefreshRateVote(const RefreshRateSelec
     return votes;
 }
 
+void LayerInfo::FrameTimeHistory::push(const FrameTimeData& frame) {
+    if (mSize == kCapacity) {
+        popFront();
+    }
+
+    const size_t index = slot(mSize);
+    mPresentTimes[index] = frame.presentTime;
+    mQueueTimes[index] = frame.queueTime;
+    mPendingModeChange[index] = frame.pendingModeChange;
+    mSmallDirty[index] = frame.isSmallDirty;
+    mPendingModeChangeCount += frame.pendingModeChange;
+    mMissingPresentTimeCount += frame.presentTime == 0;
+
+    if (mSize > 0) {
+        const size_t previous = slot(mSize - 1);
+        mIrregularPresentInterval[index] =
+                isIrregularInterval(frame.presentTime - mPresentTimes[previous],
+                                    frame.isSmallDirty);
+        mIrregularQueueInterval[index] =
+                isIrregularInterval(frame.queueTime - mQueueTimes[previous], frame.isSmallDirty);
+    } else {
+        mIrregularPresentInterval[index] = false;
+        mIrregularQueueInterval[index] = false;
+    }
+    mIrregularPresentIntervalCount += mIrregularPresentInterval[index];
+    mIrregularQueueIntervalCount += mIrregularQueueInterval[index];
+    mSize++;
+}
+
+void LayerInfo::FrameTimeHistory::popFront() {
+    const size_t index = mBegin;
+    mPendingModeChangeCount -= mPendingModeChange[index];
+    mMissingPresentTimeCount -= mPresentTimes[index] == 0;
+    mIrregularPresentIntervalCount -= mIrregularPresentInterval[index];
+    mIrregularQueueIntervalCount -= mIrregularQueueInterval[index];
+    mIrregularPresentInterval[index] = false;
+    mIrregularQueueInterval[index] = false;
+    mBegin = slot(1);
+    mSize--;
+
+    // The new first frame has no interval before it.
+    if (mSize > 0) {
+        mIrregularPresentIntervalCount -= mIrregularPresentInterval[mBegin];
+        mIrregularQueueIntervalCount -= mIrregularQueueInterval[mBegin];
+        mIrregularPresentInterval[mBegin] = false;
+        mIrregularQueueInterval[mBegin] = false;
+    }
+}
+
+void LayerInfo::FrameTimeHistory::clear() {
+    *this = {};
+}
+
+LayerInfo::FrameTimeData LayerInfo::FrameTimeHistory::operator[](size_t i) const {
+    const size_t index = slot(i);
+    return {.presentTime = mPresentTimes[index],
+            .queueTime = mQueueTimes[index],
+            .pendingModeChange = mPendingModeChange[index],
+            .isSmallDirty = mSmallDirty[index]};
+}
+
+bool LayerInfo::FrameTimeHistory::isIrregularInterval(nsecs_t interval, bool isSmallDirty) {
+    // Matches the intervals that calculateAverageFrameTime skips or merges into the next one.
+    return interval < kMinPeriodBetweenFrames ||
+            (isSmallDirty && interval < kMinPeriodBetweenSmallDirtyFrames) ||
+            interval > kMaxPeriodBetweenFrames;
+}
+
 const char* LayerInfo::getTraceTag(LayerHistory::LayerVoteType type) const {
     if (mTraceTags.count(type) == 0) {
         auto tag = "LFPS " + mName + " " + ftl::enum_string(type);
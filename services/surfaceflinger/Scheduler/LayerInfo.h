@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <array>
+#include <bitset>
 #include <chrono>
 #include <deque>
 #include <optional>
@@ -76,6 +78,12 @@ public:
 
         // Returns true if the layer explicitly should contribute to frame rate scoring.
         bool isNoVote() const { return RefreshRateSelector::isNoVote(type); }
+
+        bool operator==(const LayerVote& other) const {
+            return type == other.type && isApproxEqual(fps, other.fps) &&
+                    seamlessness == other.seamlessness && category == other.category &&
+                    categorySmoothSwitchOnly == other.categorySmoothSwitchOnly;
+        }
     };
 
     using RefreshRateVotes = ftl::SmallVector<LayerInfo::LayerVote, 2>;
@@ -170,6 +178,10 @@ public:
 
     static void setTraceEnabled(bool enabled) { sTraceEnabled = enabled; }
 
+    // Whether getRefreshRateVote may return the votes it computed in an earlier call, as long as
+    // none of their inputs changed since.
+    static void setVoteCachingEnabled(bool enabled) { sVoteCachingEnabled = enabled; }
+
     LayerInfo(const std::string& name, uid_t ownerUid, LayerHistory::LayerVoteType defaultVote);
 
     LayerInfo(const LayerInfo&) = delete;
@@ -184,18 +196,26 @@ public:
     // Sets an explicit layer vote. This usually comes directly from the application via
     // ANativeWindow_setFrameRate API. This is also used by Game Default Frame Rate and
     // Game Mode Intervention Frame Rate.
-    void setLayerVote(LayerVote vote) { mLayerVote = vote; }
+    void setLayerVote(LayerVote vote) {
+        if (!(mLayerVote == vote)) {
+            mLayerVote = vote;
+            mCachedVotes.reset();
+        }
+    }
 
     // Sets the default layer vote. This will be the layer vote after calling to resetLayerVote().
     // This is used for layers that called to setLayerVote() and then removed the vote, so that the
     // layer can go back to whatever vote it had before the app voted for it.
-    void setDefaultLayerVote(LayerHistory::LayerVoteType type) { mDefaultVote = type; }
+    void setDefaultLayerVote(LayerHistory::LayerVoteType type) {
+        mDefaultVote = type;
+        mCachedVotes.reset();
+    }
 
     void setProperties(const LayerProps&);
 
     // Resets the layer vote to its default.
     void resetLayerVote() {
-        mLayerVote = {mDefaultVote, Fps(), Seamlessness::Default, FrameRateCategory::Default};
+        setLayerVote({mDefaultVote, Fps(), Seamlessness::Default, FrameRateCategory::Default});
     }
 
     std::string getName() const { return mName; }
@@ -231,6 +251,7 @@ public:
         mLastRefreshRate = {};
         mRefreshRateHistory.clear();
         mIsFrequencyConclusive = true;
+        mCachedVotes.reset();
     }
 
     void clearHistory(nsecs_t now) {
@@ -304,6 +325,61 @@ private:
         static constexpr float MARGIN_CONSISTENT_FPS_FOR_CLOSEST_REFRESH_RATE = 5.0;
     };
 
+    // Holds the most recent frames of the layer, oldest first. The fields of the frames are kept in
+    // separate fixed size arrays, and the history keeps the counts that let the average frame time
+    // be computed without walking the frames in the common case of a steady cadence.
+    class FrameTimeHistory {
+    public:
+        static constexpr size_t kCapacity = RefreshRateHistory::HISTORY_SIZE;
+
+        size_t size() const { return mSize; }
+        bool empty() const { return mSize == 0; }
+
+        // Adds a frame, dropping the oldest one if the history is full.
+        void push(const FrameTimeData&);
+        void clear();
+
+        nsecs_t presentTime(size_t i) const { return mPresentTimes[slot(i)]; }
+        nsecs_t queueTime(size_t i) const { return mQueueTimes[slot(i)]; }
+        bool isSmallDirty(size_t i) const { return mSmallDirty[slot(i)]; }
+        FrameTimeData operator[](size_t i) const;
+
+        // Whether any of the frames was recorded during a mode change.
+        bool hasPendingModeChange() const { return mPendingModeChangeCount > 0; }
+
+        // Whether any of the frames is missing a present time.
+        bool isMissingPresentTime() const { return mMissingPresentTimeCount > 0; }
+
+        // Whether all the intervals between consecutive frames, measured in present or queue
+        // time, are used as is when averaging the frame time.
+        bool hasRegularIntervals(bool usePresentTime) const {
+            return (usePresentTime ? mIrregularPresentIntervalCount
+                                   : mIrregularQueueIntervalCount) == 0;
+        }
+
+        // Whether the interval ending with a frame is skipped or merged when averaging.
+        static bool isIrregularInterval(nsecs_t interval, bool isSmallDirty);
+
+    private:
+        size_t slot(size_t i) const { return (mBegin + i) % kCapacity; }
+        void popFront();
+
+        std::array<nsecs_t, kCapacity> mPresentTimes{};
+        std::array<nsecs_t, kCapacity> mQueueTimes{};
+        std::bitset<kCapacity> mPendingModeChange;
+        std::bitset<kCapacity> mSmallDirty;
+        // Set for a frame whose interval from the frame before it is irregular.
+        std::bitset<kCapacity> mIrregularPresentInterval;
+        std::bitset<kCapacity> mIrregularQueueInterval;
+
+        size_t mBegin = 0;
+        size_t mSize = 0;
+        size_t mPendingModeChangeCount = 0;
+        size_t mMissingPresentTimeCount = 0;
+        size_t mIrregularPresentIntervalCount = 0;
+        size_t mIrregularQueueIntervalCount = 0;
+    };
+
     // Represents whether we were able to determine either layer is frequent or infrequent
     bool mIsFrequencyConclusive = true;
     struct Frequent {
@@ -321,6 +397,19 @@ private:
     std::optional<nsecs_t> calculateAverageFrameTime() const;
     bool isFrameTimeValid(const FrameTimeData&) const;
 
+    // Computes the votes, and the time until which they remain valid if none of the layer's
+    // inputs change. Votes that are recomputed from the frame times on every call expire now.
+    RefreshRateVotes calculateRefreshRateVote(const RefreshRateSelector&, nsecs_t now,
+                                              nsecs_t& validUntil);
+
+    // The votes last returned by getRefreshRateVote. Cleared whenever the frame times, the layer
+    // properties or the layer vote change.
+    struct CachedVotes {
+        RefreshRateVotes votes;
+        nsecs_t validUntil = 0;
+    };
+    std::optional<CachedVotes> mCachedVotes;
+
     const std::string mName;
     const uid_t mOwnerUid;
 
@@ -346,7 +435,7 @@ private:
 
     RefreshRateHeuristicData mLastRefreshRate;
 
-    std::deque<FrameTimeData> mFrameTimes;
+    FrameTimeHistory mFrameTimes;
     std::chrono::time_point<std::chrono::steady_clock> mFrameTimeValidSince =
             std::chrono::steady_clock::now();
     static constexpr size_t HISTORY_SIZE = RefreshRateHistory::HISTORY_SIZE;
@@ -364,6 +453,7 @@ private:
 
     // Shared for all LayerInfo instances
     static bool sTraceEnabled;
+    static bool sVoteCachingEnabled;
 };
 
 struct LayerProps {
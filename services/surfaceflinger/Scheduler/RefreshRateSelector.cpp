@@ -21,7 +21,9 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wextra"
 
+#include <algorithm>
 #include <chrono>
+#include <cinttypes>
 #include <cmath>
 #include <deque>
 #include <map>
@@ -474,20 +476,70 @@ float RefreshRateSelector::calculateLayerScoreLocked(const LayerRequirement& lay
             kNonExactMatchingPenalty;
 }
 
+size_t RefreshRateSelector::GetRankedFrameRatesCache::computeHash(
+        const std::vector<LayerRequirement>& layers, GlobalSignals signals, Fps pacesetterFps) {
+    // Frame rates are compared approximately, so they are hashed at a coarser resolution. Inputs
+    // that hash differently but compare equal only cause a cache miss.
+    const auto hashFps = [](Fps fps) { return std::hash<long>{}(std::lround(fps.getValue())); };
+    const auto combine = [](size_t& hash, size_t value) { hash = 31 * hash + value; };
+
+    size_t hash = 0;
+    combine(hash, static_cast<size_t>(signals.touch) | static_cast<size_t>(signals.idle) << 1 |
+                    static_cast<size_t>(signals.powerOnImminent) << 2 |
+                    static_cast<size_t>(signals.heuristicIdle) << 3);
+    combine(hash, hashFps(pacesetterFps));
+    for (const auto& layer : layers) {
+        combine(hash, std::hash<std::string>{}(layer.name));
+        combine(hash, static_cast<size_t>(layer.vote));
+        combine(hash, hashFps(layer.desiredRefreshRate));
+        combine(hash, static_cast<size_t>(layer.seamlessness));
+        combine(hash, static_cast<size_t>(layer.frameRateCategory));
+        combine(hash, std::hash<float>{}(layer.weight));
+        combine(hash, static_cast<size_t>(layer.focused));
+    }
+    return hash;
+}
+
+bool RefreshRateSelector::GetRankedFrameRatesCache::matches(
+        const GetRankedFrameRatesCache& other) const {
+    // LayerRequirement equality ignores frameRateCategorySmoothSwitchOnly, which affects the
+    // ranking, so it is compared here as well.
+    return hash == other.hash && signals == other.signals &&
+            isApproxEqual(pacesetterFps, other.pacesetterFps) && layers == other.layers &&
+            std::equal(layers.begin(), layers.end(), other.layers.begin(),
+                       [](const LayerRequirement& lhs, const LayerRequirement& rhs) {
+                           return lhs.frameRateCategorySmoothSwitchOnly ==
+                                   rhs.frameRateCategorySmoothSwitchOnly;
+                       });
+}
+
 auto RefreshRateSelector::getRankedFrameRates(const std::vector<LayerRequirement>& layers,
                                               GlobalSignals signals, Fps pacesetterFps) const
         -> RankedFrameRates {
-    GetRankedFrameRatesCache cache{layers, signals, pacesetterFps};
+    GetRankedFrameRatesCache cache{GetRankedFrameRatesCache::computeHash(layers, signals,
+                                                                         pacesetterFps),
+                                   layers, signals, pacesetterFps};
 
     std::lock_guard lock(mLock);
 
-    if (mGetRankedFrameRatesCache && mGetRankedFrameRatesCache->matches(cache)) {
-        return mGetRankedFrameRatesCache->result;
+    const auto it = std::find_if(mGetRankedFrameRatesCache.begin(),
+                                 mGetRankedFrameRatesCache.end(),
+                                 [&cache](const auto& entry) { return entry.matches(cache); });
+    if (it != mGetRankedFrameRatesCache.end()) {
+        mRankedFrameRatesCacheHits++;
+        if (it != mGetRankedFrameRatesCache.begin()) {
+            std::rotate(mGetRankedFrameRatesCache.begin(), it, std::next(it));
+        }
+        return mGetRankedFrameRatesCache.front().result;
     }
 
+    mRankedFrameRatesCacheMisses++;
     cache.result = getRankedFrameRatesLocked(layers, signals, pacesetterFps);
-    mGetRankedFrameRatesCache = std::move(cache);
-    return mGetRankedFrameRatesCache->result;
+    mGetRankedFrameRatesCache.push_front(std::move(cache));
+    if (mGetRankedFrameRatesCache.size() > kMaxRankedFrameRatesCacheSize) {
+        mGetRankedFrameRatesCache.pop_back();
+    }
+    return mGetRankedFrameRatesCache.front().result;
 }
 
 auto RefreshRateSelector::getRankedFrameRatesLocked(const std::vector<LayerRequirement>& layers,
@@ -1303,7 +1355,7 @@ void RefreshRateSelector::setActiveMode(DisplayModeId modeId, Fps renderFrameRat
 
     // Invalidate the cached invocation to getRankedFrameRates. This forces
     // the refresh rate to be recomputed on the next call to getRankedFrameRates.
-    mGetRankedFrameRatesCache.reset();
+    mGetRankedFrameRatesCache.clear();
 
     const auto activeModeOpt = mDisplayModes.get(modeId);
     LOG_ALWAYS_FATAL_IF(!activeModeOpt);
@@ -1344,7 +1396,7 @@ void RefreshRateSelector::updateDisplayModes(DisplayModes modes, DisplayModeId a
 
     // Invalidate the cached invocation to getRankedFrameRates. This forces
     // the refresh rate to be recomputed on the next call to getRankedFrameRates.
-    mGetRankedFrameRatesCache.reset();
+    mGetRankedFrameRatesCache.clear();
 
     mDisplayModes = std::move(modes);
     const auto activeModeOpt = mDisplayModes.get(activeModeId);
@@ -1444,7 +1496,7 @@ auto RefreshRateSelector::setPolicy(const PolicyVariant& policy) -> SetPolicyRes
             return SetPolicyResult::Invalid;
         }
 
-        mGetRankedFrameRatesCache.reset();
+        mGetRankedFrameRatesCache.clear();
 
         const auto& idleScreenConfigOpt = getCurrentPolicyLocked()->idleScreenConfigOpt;
         if (idleScreenConfigOpt != oldPolicy.idleScreenConfigOpt) {
@@ -1670,6 +1722,17 @@ void RefreshRateSelector::dump(utils::Dumper& dumper) const {
 
     dumper.dump("frameRateOverrideConfig"sv, *ftl::enum_name(mFrameRateOverrideConfig));
 
+    {
+        const uint64_t lookups = mRankedFrameRatesCacheHits + mRankedFrameRatesCacheMisses;
+        dumper.dump("rankedFrameRatesCache"sv,
+                    base::StringPrintf("hits=%" PRIu64 " misses=%" PRIu64 " hitRate=%.1f%%",
+                                       mRankedFrameRatesCacheHits, mRankedFrameRatesCacheMisses,
+                                       lookups == 0 ? 0.0
+                                                    : 100.0 * static_cast<double>(
+                                                                      mRankedFrameRatesCacheHits) /
+                                                              static_cast<double>(lookups)));
+    }
+
     dumper.dump("idleTimer"sv);
     {
         utils::Dumper::Indent indent(dumper);
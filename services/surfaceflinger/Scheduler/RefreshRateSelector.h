@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <deque>
 #include <type_traits>
 #include <utility>
 #include <variant>
@@ -570,19 +571,25 @@ private:
 
     Config::FrameRateOverride mFrameRateOverrideConfig;
 
+    // Memoized invocations of getRankedFrameRates, most recently used first. Several entries are
+    // kept since the selector is queried with different inputs in the same frame, for example with
+    // and without touch, or by follower displays with a pacesetter refresh rate.
     struct GetRankedFrameRatesCache {
+        size_t hash = 0;
         std::vector<LayerRequirement> layers;
         GlobalSignals signals;
         Fps pacesetterFps;
 
         RankedFrameRates result;
 
-        bool matches(const GetRankedFrameRatesCache& other) const {
-            return layers == other.layers && signals == other.signals &&
-                    isApproxEqual(pacesetterFps, other.pacesetterFps);
-        }
+        static size_t computeHash(const std::vector<LayerRequirement>&, GlobalSignals, Fps);
+
+        bool matches(const GetRankedFrameRatesCache& other) const;
     };
-    mutable std::optional<GetRankedFrameRatesCache> mGetRankedFrameRatesCache GUARDED_BY(mLock);
+    static constexpr size_t kMaxRankedFrameRatesCacheSize = 4;
+    mutable std::deque<GetRankedFrameRatesCache> mGetRankedFrameRatesCache GUARDED_BY(mLock);
+    mutable uint64_t mRankedFrameRatesCacheHits GUARDED_BY(mLock) = 0;
+    mutable uint64_t mRankedFrameRatesCacheMisses GUARDED_BY(mLock) = 0;
 
     // Declare mIdleTimer last to ensure its thread joins before the mutex/callbacks are destroyed.
     std::mutex mIdleTimerCallbacksMutex;
@@ -882,6 +882,9 @@ void Scheduler::dump(utils::Dumper& dumper) const {
     mVsyncConfiguration->dump(dumper.out());
     dumper.eol();
 
+    mVsyncModulator->dump(dumper.out());
+    dumper.eol();
+
     mRefreshRateStats->dump(dumper.out());
     dumper.eol();
 
@@ -16,6 +16,7 @@
 
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <algorithm>
 #include <vector>
 
 #include <android-base/stringprintf.h>
@@ -146,6 +147,14 @@ bool VSyncDispatchTimerQueueEntry::hasPendingWorkloadUpdate() const {
     return mWorkloadUpdateInfo.has_value();
 }
 
+void VSyncDispatchTimerQueueEntry::recordWakeupSlop(nsecs_t slop) {
+    if (slop < 0) {
+        mEarlyWakeupCount++;
+    } else {
+        mLateWakeups.record(slop);
+    }
+}
+
 nsecs_t VSyncDispatchTimerQueueEntry::adjustVsyncIfNeeded(VSyncTracker& tracker,
                                                           nsecs_t nextVsyncTime) const {
     bool const alreadyDispatchedForVsync = mLastDispatchTime &&
@@ -280,6 +289,13 @@ void VSyncDispatchTimerQueueEntry::dump(std::string& result) const {
     } else {
         StringAppendF(&result, "\t\t\tmLastDispatchTime unknown\n");
     }
+
+    const auto late = mLateWakeups.summarize();
+    StringAppendF(&result,
+                  "\t\t\twakeup slop: early=%" PRIu64 " late=%" PRIu64
+                  " p50=%.3fms p90=%.3fms p99=%.3fms max=%.3fms\n",
+                  mEarlyWakeupCount, late.count, late.p50 / 1e6f, late.p90 / 1e6f, late.p99 / 1e6f,
+                  late.max / 1e6f);
 }
 
 VSyncDispatchTimerQueue::VSyncDispatchTimerQueue(std::unique_ptr<TimeKeeper> tk,
@@ -312,36 +328,65 @@ void VSyncDispatchTimerQueue::setTimer(nsecs_t targetTime, nsecs_t /*now*/) {
     mLastTimerSchedule = mTimeKeeper->now();
 }
 
+void VSyncDispatchTimerQueue::reindex(CallbackToken token,
+                                      const std::shared_ptr<VSyncDispatchTimerQueueEntry>& entry,
+                                      std::optional<nsecs_t> previousWakeupTime) {
+    const size_t id = ftl::to_underlying(token);
+    if (previousWakeupTime) {
+        mWakeupIndex.erase({*previousWakeupTime, id, entry});
+    }
+    if (const auto wakeupTime = entry->wakeupTime()) {
+        mWakeupIndex.insert({*wakeupTime, id, entry});
+    }
+
+    if (entry->hasPendingWorkloadUpdate()) {
+        mPendingWorkloadUpdates.insert({id, entry});
+    } else {
+        mPendingWorkloadUpdates.erase({id, entry});
+    }
+}
+
+void VSyncDispatchTimerQueue::unindex(CallbackToken token,
+                                      const std::shared_ptr<VSyncDispatchTimerQueueEntry>& entry) {
+    const size_t id = ftl::to_underlying(token);
+    if (const auto wakeupTime = entry->wakeupTime()) {
+        mWakeupIndex.erase({*wakeupTime, id, entry});
+    }
+    mPendingWorkloadUpdates.erase({id, entry});
+}
+
 void VSyncDispatchTimerQueue::rearmTimer(nsecs_t now) {
-    rearmTimerSkippingUpdateFor(now, mCallbacks.cend());
+    rearmTimerSkippingUpdateFor(now, nullptr);
 }
 
 void VSyncDispatchTimerQueue::rearmTimerSkippingUpdateFor(
-        nsecs_t now, CallbackMap::const_iterator skipUpdateIt) {
+        nsecs_t now, const VSyncDispatchTimerQueueEntry* skipUpdate) {
     SFTRACE_CALL();
-    std::optional<nsecs_t> min;
-    std::optional<nsecs_t> targetVsync;
-    std::optional<std::string_view> nextWakeupName;
-    for (auto it = mCallbacks.cbegin(); it != mCallbacks.cend(); ++it) {
-        auto& callback = it->second;
-        if (!callback->wakeupTime() && !callback->hasPendingWorkloadUpdate()) {
-            continue;
-        }
 
-        if (it != skipUpdateIt) {
-            callback->update(*mTracker, now);
+    // Updating an entry to the latest vsync model moves its wakeup time, so collect the armed
+    // entries and those with a pending workload update before updating any of them.
+    mRearmEntries.clear();
+    for (const auto& [wakeupTime, id, entry] : mWakeupIndex) {
+        mRearmEntries.emplace_back(id, entry);
+    }
+    for (const auto& [id, entry] : mPendingWorkloadUpdates) {
+        if (!entry->wakeupTime()) {
+            mRearmEntries.emplace_back(id, entry);
         }
+    }
 
-        traceEntry(*callback, now);
-
-        const auto wakeupTime = *callback->wakeupTime();
-        if (!min || *min > wakeupTime) {
-            nextWakeupName = callback->name();
-            min = wakeupTime;
-            targetVsync = callback->targetVsync();
+    for (const auto& [id, entry] : mRearmEntries) {
+        if (entry.get() != skipUpdate) {
+            const auto previousWakeupTime = entry->wakeupTime();
+            entry->update(*mTracker, now);
+            reindex(CallbackToken(id), entry, previousWakeupTime);
         }
+
+        traceEntry(*entry, now);
     }
 
+    const auto min = mWakeupIndex.empty() ? std::nullopt
+                                          : std::make_optional(std::get<0>(*mWakeupIndex.begin()));
     if (min && min < mIntendedWakeupTime) {
         setTimer(*min, now);
     } else {
@@ -367,22 +412,32 @@ void VSyncDispatchTimerQueue::timerCallback() {
         }
         auto const now = mTimeKeeper->now();
         mLastTimerCallback = now;
-        for (auto it = mCallbacks.begin(); it != mCallbacks.end(); it++) {
-            auto& callback = it->second;
-            auto const wakeupTime = callback->wakeupTime();
-            if (!wakeupTime) {
-                continue;
-            }
 
-            traceEntry(*callback, now);
-
-            auto const readyTime = callback->readyTime();
-            auto const lagAllowance = std::max(now - mIntendedWakeupTime, static_cast<nsecs_t>(0));
-            if (*wakeupTime < mIntendedWakeupTime + mTimerSlack + lagAllowance) {
-                callback->executing();
-                invocations.emplace_back(Invocation{callback, *callback->lastExecutedVsyncTarget(),
-                                                    *wakeupTime, *readyTime});
+        // The index is ordered by wakeup time, so the due entries are at its front.
+        auto const lagAllowance = std::max(now - mIntendedWakeupTime, static_cast<nsecs_t>(0));
+        auto const dueBefore = mIntendedWakeupTime + mTimerSlack + lagAllowance;
+        mRearmEntries.clear();
+        for (const auto& [wakeupTime, id, entry] : mWakeupIndex) {
+            if (wakeupTime >= dueBefore) {
+                break;
             }
+            mRearmEntries.emplace_back(id, entry);
+        }
+
+        // Dispatch in token order rather than in wakeup order, so that callbacks due in the same
+        // wakeup keep a stable order.
+        std::sort(mRearmEntries.begin(), mRearmEntries.end(),
+                  [](const EntryRef& lhs, const EntryRef& rhs) { return lhs.first < rhs.first; });
+        for (const auto& [id, entry] : mRearmEntries) {
+            traceEntry(*entry, now);
+
+            auto const wakeupTime = *entry->wakeupTime();
+            auto const readyTime = *entry->readyTime();
+            entry->recordWakeupSlop(now - wakeupTime);
+            entry->executing();
+            reindex(CallbackToken(id), entry, wakeupTime);
+            invocations.emplace_back(Invocation{entry, *entry->lastExecutedVsyncTarget(),
+                                                wakeupTime, readyTime});
         }
 
         mIntendedWakeupTime = kInvalidTime;
@@ -415,6 +470,7 @@ void VSyncDispatchTimerQueue::unregisterCallback(CallbackToken token) {
         auto it = mCallbacks.find(token);
         if (it != mCallbacks.end()) {
             entry = it->second;
+            unindex(token, entry);
             mCallbacks.erase(it->first);
         }
     }
@@ -443,13 +499,17 @@ std::optional<ScheduleResult> VSyncDispatchTimerQueue::scheduleLocked(
      * timer recalculation to avoid cancelling a callback that is about to fire. */
     auto const rearmImminent = now > mIntendedWakeupTime;
     if (CC_UNLIKELY(rearmImminent)) {
-        return callback->addPendingWorkloadUpdate(*mTracker, now, scheduleTiming);
+        const auto result = callback->addPendingWorkloadUpdate(*mTracker, now, scheduleTiming);
+        reindex(token, callback, callback->wakeupTime());
+        return result;
     }
 
+    const auto previousWakeupTime = callback->wakeupTime();
     const auto result = callback->schedule(scheduleTiming, *mTracker, now);
+    reindex(token, callback, previousWakeupTime);
 
     if (callback->wakeupTime() < mIntendedWakeupTime - mTimerSlack) {
-        rearmTimerSkippingUpdateFor(now, it);
+        rearmTimerSkippingUpdateFor(now, callback.get());
     }
 
     return result;
@@ -483,6 +543,7 @@ CancelResult VSyncDispatchTimerQueue::cancel(CallbackToken token) {
     auto const wakeupTime = callback->wakeupTime();
     if (wakeupTime) {
         callback->disarm();
+        reindex(token, callback, wakeupTime);
 
         if (*wakeupTime == mIntendedWakeupTime) {
             mIntendedWakeupTime = kInvalidTime;
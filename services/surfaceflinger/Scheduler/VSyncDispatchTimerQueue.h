@@ -18,12 +18,17 @@
 
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include <android-base/thread_annotations.h>
 #include <ftl/small_map.h>
 
+#include "../TimeStats/LatencyHistogram.h"
 #include "VSyncDispatch.h"
 #include "VsyncSchedule.h"
 
@@ -74,6 +79,10 @@ public:
 
     // Checks if there is a pending update to the workload, returning true if so.
     bool hasPendingWorkloadUpdate() const;
+
+    // Records how long after its wakeup time the callback was dispatched. A negative slop means
+    // the callback was dispatched early, together with another callback within the timer slack.
+    void recordWakeupSlop(nsecs_t slop);
     // End: functions that are not threadsafe.
 
     // Invoke the callback with the two given timestamps, moving the state from running->disarmed.
@@ -105,6 +114,9 @@ private:
 
     std::optional<VSyncDispatch::ScheduleTiming> mWorkloadUpdateInfo;
 
+    LatencyHistogram mLateWakeups;
+    uint64_t mEarlyWakeupCount = 0;
+
     mutable std::mutex mRunningMutex;
     std::condition_variable mCv;
     bool mRunning GUARDED_BY(mRunningMutex) = false;
@@ -145,7 +157,14 @@ private:
     void timerCallback();
     void setTimer(nsecs_t, nsecs_t) REQUIRES(mMutex);
     void rearmTimer(nsecs_t now) REQUIRES(mMutex);
-    void rearmTimerSkippingUpdateFor(nsecs_t now, CallbackMap::const_iterator skipUpdate)
+    void rearmTimerSkippingUpdateFor(nsecs_t now, const VSyncDispatchTimerQueueEntry* skipUpdate)
+            REQUIRES(mMutex);
+
+    // Updates the indices of the given entry after its wakeup time or pending workload changed,
+    // previousWakeupTime being its wakeup time before the change.
+    void reindex(CallbackToken, const std::shared_ptr<VSyncDispatchTimerQueueEntry>&,
+                 std::optional<nsecs_t> previousWakeupTime) REQUIRES(mMutex);
+    void unindex(CallbackToken, const std::shared_ptr<VSyncDispatchTimerQueueEntry>&)
             REQUIRES(mMutex);
     void cancelTimer() REQUIRES(mMutex);
     std::optional<ScheduleResult> scheduleLocked(CallbackToken, ScheduleTiming) REQUIRES(mMutex);
@@ -167,6 +186,16 @@ private:
     CallbackMap mCallbacks GUARDED_BY(mMutex);
     nsecs_t mIntendedWakeupTime GUARDED_BY(mMutex) = kInvalidTime;
 
+    // The armed entries ordered by wakeup time, then by token, so that the next wakeup and the
+    // entries due in the timer callback are found without visiting every registered callback.
+    using EntryRef = std::pair<size_t, std::shared_ptr<VSyncDispatchTimerQueueEntry>>;
+    std::set<std::tuple<nsecs_t, size_t, std::shared_ptr<VSyncDispatchTimerQueueEntry>>>
+            mWakeupIndex GUARDED_BY(mMutex);
+    // The entries with a workload update to apply on the next rearm.
+    std::set<EntryRef> mPendingWorkloadUpdates GUARDED_BY(mMutex);
+    // Scratch space for rearming, kept to avoid allocating on every rearm.
+    std::vector<EntryRef> mRearmEntries GUARDED_BY(mMutex);
+
     // For debugging purposes
     nsecs_t mLastTimerCallback GUARDED_BY(mMutex) = kInvalidTime;
     nsecs_t mLastTimerSchedule GUARDED_BY(mMutex) = kInvalidTime;
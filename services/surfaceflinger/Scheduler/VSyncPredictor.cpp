@@ -25,6 +25,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <numeric>
 #include <sstream>
 
 #include <android-base/logging.h>
@@ -34,6 +35,7 @@
 #include <cutils/compiler.h>
 #include <cutils/properties.h>
 #include <ftl/concat.h>
+#include <ftl/enum.h>
 #include <utils/Log.h>
 
 #include "RefreshRateSelector.h"
@@ -45,6 +47,10 @@ using base::StringAppendF;
 
 static auto constexpr kMaxPercent = 100u;
 
+// The mean of the ordinals must be precise for the intercept calculation, so they are scaled up
+// for fixed-point arithmetic.
+static constexpr int64_t kOrdinalScalingFactor = 1000;
+
 namespace {
 int numVsyncsPerFrame(const ftl::NonNull<DisplayModePtr>& displayModePtr) {
     const auto idealPeakRefreshPeriod = displayModePtr->getPeakFps().getPeriodNsecs();
@@ -65,11 +71,18 @@ VSyncPredictor::VSyncPredictor(std::unique_ptr<Clock> clock, ftl::NonNull<Displa
         kHistorySize(historySize),
         kMinimumSamplesForPrediction(minimumSamplesForPrediction),
         kOutlierTolerancePercent(std::min(outlierTolerancePercent, kMaxPercent)),
+        mModelFit(property_get_bool("debug.sf.vsp_robust_fit", false) ? ModelFit::TheilSen
+                                                                      : ModelFit::LeastSquares),
         mDisplayModePtr(modePtr),
         mNumVsyncsForFrame(numVsyncsPerFrame(mDisplayModePtr)) {
     resetModel();
 }
 
+void VSyncPredictor::setModelFit(ModelFit modelFit) {
+    std::lock_guard lock(mMutex);
+    mModelFit = modelFit;
+}
+
 inline void VSyncPredictor::traceInt64If(const char* name, int64_t value) const {
     if (CC_UNLIKELY(mTraceOn)) {
         traceInt64(name, value);
@@ -185,6 +198,51 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
         return true;
     }
 
+    // Fit a line of the vsync timestamps over their ordinals. The slope is the vsync period.
+    mFitTimestamps.resize(numSamples);
+    mFitOrdinals.resize(numSamples);
+
+    // Normalizing to the oldest timestamp cuts down on error in calculating the intercept.
+    const auto oldestTS = *std::min_element(mTimestamps.begin(), mTimestamps.end());
+    auto it = mRateMap.find(idealPeriod());
+    auto const currentPeriod = it->second.slope;
+
+    for (size_t i = 0; i < numSamples; i++) {
+        const auto timestamp = mTimestamps[i] - oldestTS;
+        mFitTimestamps[i] = timestamp;
+        mFitOrdinals[i] = currentPeriod == 0
+                ? 0
+                : (timestamp + currentPeriod / 2) / currentPeriod * kOrdinalScalingFactor;
+    }
+
+    const auto model = mModelFit == ModelFit::TheilSen ? fitTheilSen() : fitLeastSquares();
+    if (CC_UNLIKELY(!model)) {
+        it->second = {idealPeriod(), 0};
+        mModelResetCount++;
+        clearTimestamps(/* clearTimelines */ true);
+        return false;
+    }
+
+    auto const [anticipatedPeriod, intercept] = *model;
+    auto const percent = std::abs(anticipatedPeriod - idealPeriod()) * kMaxPercent / idealPeriod();
+    if (percent >= kOutlierTolerancePercent) {
+        it->second = {idealPeriod(), 0};
+        mModelResetCount++;
+        clearTimestamps(/* clearTimelines */ true);
+        return false;
+    }
+
+    traceInt64If("VSP-period", anticipatedPeriod);
+    traceInt64If("VSP-intercept", intercept);
+
+    it->second = {anticipatedPeriod, intercept};
+
+    ALOGV("model update ts %" PRIu64 ": %" PRId64 " slope: %" PRId64 " intercept: %" PRId64,
+          mId.value, timestamp, anticipatedPeriod, intercept);
+    return true;
+}
+
+auto VSyncPredictor::fitLeastSquares() -> std::optional<Model> {
     // This is a 'simple linear regression' calculation of Y over X, with Y being the
     // vsync timestamps, and X being the ordinal of vsync count.
     // The calculated slope is the vsync period.
@@ -200,72 +258,83 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     //
     // intercept = mean(Y) - slope * mean(X)
     //
-    std::vector<nsecs_t> vsyncTS(numSamples);
-    std::vector<nsecs_t> ordinals(numSamples);
-
-    // Normalizing to the oldest timestamp cuts down on error in calculating the intercept.
-    const auto oldestTS = *std::min_element(mTimestamps.begin(), mTimestamps.end());
-    auto it = mRateMap.find(idealPeriod());
-    auto const currentPeriod = it->second.slope;
-
-    // The mean of the ordinals must be precise for the intercept calculation, so scale them up for
-    // fixed-point arithmetic.
-    constexpr int64_t kScalingFactor = 1000;
+    const size_t numSamples = mFitTimestamps.size();
+    const auto& vsyncTS = mFitTimestamps;
+    const auto& ordinals = mFitOrdinals;
 
     nsecs_t meanTS = 0;
     nsecs_t meanOrdinal = 0;
-
     for (size_t i = 0; i < numSamples; i++) {
-        const auto timestamp = mTimestamps[i] - oldestTS;
-        vsyncTS[i] = timestamp;
-        meanTS += timestamp;
-
-        const auto ordinal = currentPeriod == 0
-                ? 0
-                : (vsyncTS[i] + currentPeriod / 2) / currentPeriod * kScalingFactor;
-        ordinals[i] = ordinal;
-        meanOrdinal += ordinal;
+        meanTS += vsyncTS[i];
+        meanOrdinal += ordinals[i];
     }
 
     meanTS /= numSamples;
     meanOrdinal /= numSamples;
 
-    for (size_t i = 0; i < numSamples; i++) {
-        vsyncTS[i] -= meanTS;
-        ordinals[i] -= meanOrdinal;
-    }
-
     nsecs_t top = 0;
     nsecs_t bottom = 0;
     for (size_t i = 0; i < numSamples; i++) {
-        top += vsyncTS[i] * ordinals[i];
-        bottom += ordinals[i] * ordinals[i];
+        const auto ts = vsyncTS[i] - meanTS;
+        const auto ordinal = ordinals[i] - meanOrdinal;
+        top += ts * ordinal;
+        bottom += ordinal * ordinal;
     }
 
-    if (CC_UNLIKELY(bottom == 0)) {
-        it->second = {idealPeriod(), 0};
-        clearTimestamps(/* clearTimelines */ true);
-        return false;
+    if (bottom == 0) {
+        return std::nullopt;
     }
 
-    nsecs_t const anticipatedPeriod = top * kScalingFactor / bottom;
-    nsecs_t const intercept = meanTS - (anticipatedPeriod * meanOrdinal / kScalingFactor);
+    nsecs_t const anticipatedPeriod = top * kOrdinalScalingFactor / bottom;
+    nsecs_t const intercept = meanTS - (anticipatedPeriod * meanOrdinal / kOrdinalScalingFactor);
+    return Model{anticipatedPeriod, intercept};
+}
 
-    auto const percent = std::abs(anticipatedPeriod - idealPeriod()) * kMaxPercent / idealPeriod();
-    if (percent >= kOutlierTolerancePercent) {
-        it->second = {idealPeriod(), 0};
-        clearTimestamps(/* clearTimelines */ true);
-        return false;
+auto VSyncPredictor::fitTheilSen() -> std::optional<Model> {
+    const size_t numSamples = mFitTimestamps.size();
+
+    // Pair each timestamp with the one half the history after it in time order, rather than
+    // taking all pairs, which keeps the median at O(n log n) while still tolerating up to a
+    // quarter of the timestamps being outliers.
+    mFitOrder.resize(numSamples);
+    std::iota(mFitOrder.begin(), mFitOrder.end(), 0);
+    std::sort(mFitOrder.begin(), mFitOrder.end(), [this](size_t lhs, size_t rhs) {
+        return mFitTimestamps[lhs] < mFitTimestamps[rhs];
+    });
+
+    const size_t stride = numSamples / 2;
+    mFitScratch.clear();
+    for (size_t i = 0; i + stride < numSamples; i++) {
+        const size_t first = mFitOrder[i];
+        const size_t second = mFitOrder[i + stride];
+        const auto ordinalDelta = mFitOrdinals[second] - mFitOrdinals[first];
+        if (ordinalDelta == 0) {
+            continue;
+        }
+        mFitScratch.push_back((mFitTimestamps[second] - mFitTimestamps[first]) *
+                              kOrdinalScalingFactor / ordinalDelta);
     }
 
-    traceInt64If("VSP-period", anticipatedPeriod);
-    traceInt64If("VSP-intercept", intercept);
+    if (mFitScratch.empty()) {
+        return std::nullopt;
+    }
 
-    it->second = {anticipatedPeriod, intercept};
+    const auto median = [](std::vector<nsecs_t>& values) {
+        const auto middle = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+        std::nth_element(values.begin(), middle, values.end());
+        return *middle;
+    };
 
-    ALOGV("model update ts %" PRIu64 ": %" PRId64 " slope: %" PRId64 " intercept: %" PRId64,
-          mId.value, timestamp, anticipatedPeriod, intercept);
-    return true;
+    const nsecs_t anticipatedPeriod = median(mFitScratch);
+
+    // The intercept is the median of the residuals once the slope is removed.
+    mFitScratch.resize(numSamples);
+    for (size_t i = 0; i < numSamples; i++) {
+        mFitScratch[i] = mFitTimestamps[i] -
+                anticipatedPeriod * mFitOrdinals[i] / kOrdinalScalingFactor;
+    }
+    const nsecs_t intercept = median(mFitScratch);
+    return Model{anticipatedPeriod, intercept};
 }
 
 nsecs_t VSyncPredictor::snapToVsync(nsecs_t timePoint) const {
@@ -631,6 +700,8 @@ void VSyncPredictor::dump(std::string& result) const {
                       periodInterceptTuple.intercept);
     }
     StringAppendF(&result, "\tmTimelines.size()=%zu\n", mTimelines.size());
+    StringAppendF(&result, "\tmModelFit=%s mModelResetCount=%zu\n",
+                  ftl::enum_string(mModelFit).c_str(), mModelResetCount);
 }
 
 void VSyncPredictor::purgeTimelines(android::TimePoint now) {
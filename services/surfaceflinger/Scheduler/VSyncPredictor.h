@@ -65,6 +65,20 @@ public:
 
     VSyncPredictor::Model getVSyncPredictionModel() const EXCLUDES(mMutex);
 
+    // How the model is fitted to the vsync timestamps.
+    enum class ModelFit {
+        // Ordinary least squares over all the timestamps.
+        LeastSquares,
+        // The median of the slopes between pairs of timestamps half the history apart, which is
+        // much less sensitive to outliers from noisy vsync sources.
+        TheilSen,
+
+        ftl_last = TheilSen
+    };
+
+    // Overrides the fit chosen by debug.sf.vsp_robust_fit. Takes effect with the next timestamp.
+    void setModelFit(ModelFit) EXCLUDES(mMutex);
+
     bool isVSyncInPhase(nsecs_t timePoint, Fps frameRate) final EXCLUDES(mMutex);
 
     void setDisplayModePtr(ftl::NonNull<DisplayModePtr>) final EXCLUDES(mMutex);
@@ -145,6 +159,11 @@ private:
 
     nsecs_t idealPeriod() const REQUIRES(mMutex);
 
+    // Fit the model to mFitTimestamps and mFitOrdinals, which are relative to the oldest timestamp.
+    // Return nullopt if the ordinals are degenerate.
+    std::optional<Model> fitLeastSquares() REQUIRES(mMutex);
+    std::optional<Model> fitTheilSen() REQUIRES(mMutex);
+
     bool const mTraceOn;
     size_t const kHistorySize;
     size_t const kMinimumSamplesForPrediction;
@@ -159,6 +178,15 @@ private:
     size_t mLastTimestampIndex GUARDED_BY(mMutex) = 0;
     std::vector<nsecs_t> mTimestamps GUARDED_BY(mMutex);
 
+    ModelFit mModelFit GUARDED_BY(mMutex);
+    // Scratch space for fitting the model, kept to avoid allocating for every timestamp.
+    std::vector<nsecs_t> mFitTimestamps GUARDED_BY(mMutex);
+    std::vector<nsecs_t> mFitOrdinals GUARDED_BY(mMutex);
+    std::vector<size_t> mFitOrder GUARDED_BY(mMutex);
+    std::vector<nsecs_t> mFitScratch GUARDED_BY(mMutex);
+    // The number of times the fitted model was rejected and the timestamps were cleared.
+    size_t mModelResetCount GUARDED_BY(mMutex) = 0;
+
     ftl::NonNull<DisplayModePtr> mDisplayModePtr GUARDED_BY(mMutex);
     int mNumVsyncsForFrame GUARDED_BY(mMutex);
 
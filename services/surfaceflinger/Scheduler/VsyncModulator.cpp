@@ -21,11 +21,14 @@
 
 #include "VsyncModulator.h"
 
+#include <android-base/stringprintf.h>
 #include <common/trace.h>
 #include <log/log.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cinttypes>
+#include <cmath>
 #include <mutex>
 
 using namespace std::chrono_literals;
@@ -33,6 +36,8 @@ using namespace std::chrono_literals;
 namespace android::scheduler {
 
 const std::chrono::nanoseconds VsyncModulator::MIN_EARLY_TRANSACTION_TIME = 1ms;
+const std::chrono::nanoseconds VsyncModulator::ADAPTIVE_WORK_DURATION_MARGIN = 1ms;
+const std::chrono::nanoseconds VsyncModulator::ADAPTIVE_WORK_DURATION_HYSTERESIS = 500us;
 
 VsyncModulator::VsyncModulator(const VsyncConfigSet& config, Now now)
       : mVsyncConfigSet(config),
@@ -41,6 +46,10 @@ VsyncModulator::VsyncModulator(const VsyncConfigSet& config, Now now)
 VsyncConfig VsyncModulator::setVsyncConfigSet(const VsyncConfigSet& config) {
     std::lock_guard<std::mutex> lock(mMutex);
     mVsyncConfigSet = config;
+    if (mAdaptiveSfWorkDuration) {
+        mAdaptiveSfWorkDuration = clampAdaptiveWorkDurationLocked(*mAdaptiveSfWorkDuration);
+    }
+    updateAdaptiveVsyncConfigsLocked();
     return updateVsyncConfigLocked();
 }
 
@@ -123,6 +132,83 @@ VsyncModulator::VsyncConfigOpt VsyncModulator::onDisplayRefresh(bool usedGpuComp
     return updateVsyncConfig();
 }
 
+VsyncModulator::VsyncConfigOpt VsyncModulator::setAdaptiveWorkDurationEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mAdaptiveWorkDurationEnabled == enabled) return std::nullopt;
+    mAdaptiveWorkDurationEnabled = enabled;
+
+    mWorkDurationCount = 0;
+    mNextWorkDurationIndex = 0;
+    if (!mAdaptiveSfWorkDuration) return std::nullopt;
+    mAdaptiveSfWorkDuration.reset();
+    return updateVsyncConfigLocked();
+}
+
+VsyncModulator::VsyncConfigOpt VsyncModulator::onFrameWorkDuration(
+        std::chrono::nanoseconds duration) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mAdaptiveWorkDurationEnabled) return std::nullopt;
+
+    mWorkDurations[mNextWorkDurationIndex] = duration.count();
+    mNextWorkDurationIndex = (mNextWorkDurationIndex + 1) % ADAPTIVE_WORK_DURATION_WINDOW;
+    mWorkDurationCount = std::min(mWorkDurationCount + 1, ADAPTIVE_WORK_DURATION_WINDOW);
+    if (mWorkDurationCount < MIN_ADAPTIVE_WORK_DURATION_FRAMES) return std::nullopt;
+
+    const auto target = clampAdaptiveWorkDurationLocked(adaptiveWorkDurationPercentileLocked() +
+                                                        ADAPTIVE_WORK_DURATION_MARGIN);
+    if (mAdaptiveSfWorkDuration) {
+        // Wake up earlier as soon as frames get more expensive, but only wake up later once
+        // frames got noticeably cheaper.
+        const auto current = *mAdaptiveSfWorkDuration;
+        if (target == current ||
+            (target < current && current - target < ADAPTIVE_WORK_DURATION_HYSTERESIS)) {
+            return std::nullopt;
+        }
+    }
+
+    mAdaptiveSfWorkDuration = target;
+    SFTRACE_INT64("AdaptiveSfWorkDuration", target.count());
+    updateAdaptiveVsyncConfigsLocked();
+
+    if (getNextVsyncConfigType() == VsyncConfigType::Early) return std::nullopt;
+    return updateVsyncConfigLocked();
+}
+
+std::chrono::nanoseconds VsyncModulator::adaptiveWorkDurationPercentileLocked() const {
+    std::array<nsecs_t, ADAPTIVE_WORK_DURATION_WINDOW> durations;
+    const auto begin = durations.begin();
+    const auto end = std::copy_n(mWorkDurations.begin(), mWorkDurationCount, begin);
+
+    const auto rank = static_cast<size_t>(
+            std::ceil(ADAPTIVE_WORK_DURATION_PERCENTILE * static_cast<double>(mWorkDurationCount)));
+    const auto nth = begin + static_cast<std::ptrdiff_t>(std::max(rank, size_t{1}) - 1);
+    std::nth_element(begin, nth, end);
+    return std::chrono::nanoseconds(*nth);
+}
+
+std::chrono::nanoseconds VsyncModulator::clampAdaptiveWorkDurationLocked(
+        std::chrono::nanoseconds duration) const {
+    // Never wake up earlier than the static configs ever do, nor so late that the HWC or half of
+    // the late work duration would not fit.
+    const auto upper = std::max({mVsyncConfigSet.early.sfWorkDuration,
+                                 mVsyncConfigSet.earlyGpu.sfWorkDuration,
+                                 mVsyncConfigSet.late.sfWorkDuration});
+    const auto lower = std::min(upper,
+                                std::max(mVsyncConfigSet.late.sfWorkDuration / 2,
+                                         mVsyncConfigSet.hwcMinWorkDuration));
+    return std::clamp(duration, lower, upper);
+}
+
+void VsyncModulator::updateAdaptiveVsyncConfigsLocked() {
+    mAdaptiveLate = mVsyncConfigSet.late;
+    mAdaptiveEarlyGpu = mVsyncConfigSet.earlyGpu;
+    if (!mAdaptiveSfWorkDuration) return;
+
+    mAdaptiveLate.sfWorkDuration = *mAdaptiveSfWorkDuration;
+    mAdaptiveEarlyGpu.sfWorkDuration =
+            std::max(mVsyncConfigSet.earlyGpu.sfWorkDuration, *mAdaptiveSfWorkDuration);
+}
+
 VsyncConfig VsyncModulator::getVsyncConfig() const {
     std::lock_guard<std::mutex> lock(mMutex);
     return mVsyncConfig;
@@ -146,9 +232,9 @@ const VsyncConfig& VsyncModulator::getNextVsyncConfig() const {
         case VsyncConfigType::Early:
             return mVsyncConfigSet.early;
         case VsyncConfigType::EarlyGpu:
-            return mVsyncConfigSet.earlyGpu;
+            return mAdaptiveSfWorkDuration ? mAdaptiveEarlyGpu : mVsyncConfigSet.earlyGpu;
         case VsyncConfigType::Late:
-            return mVsyncConfigSet.late;
+            return mAdaptiveSfWorkDuration ? mAdaptiveLate : mVsyncConfigSet.late;
     }
 }
 
@@ -189,4 +275,24 @@ bool VsyncModulator::isVsyncConfigEarly() const {
     return getNextVsyncConfigType() != VsyncConfigType::Late;
 }
 
+void VsyncModulator::dump(std::string& result) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    base::StringAppendF(&result, "VsyncModulator: SF duration: %9lld ns\n",
+                        mVsyncConfig.sfWorkDuration.count());
+    if (!mAdaptiveWorkDurationEnabled) {
+        result.append("  adaptive SF duration: disabled\n");
+        return;
+    }
+    if (!mAdaptiveSfWorkDuration) {
+        base::StringAppendF(&result, "  adaptive SF duration: measuring (%zu of %zu frames)\n",
+                            mWorkDurationCount, MIN_ADAPTIVE_WORK_DURATION_FRAMES);
+        return;
+    }
+    base::StringAppendF(&result,
+                        "  adaptive SF duration: %9lld ns (p%d of %zu frames: %9lld ns)\n",
+                        mAdaptiveSfWorkDuration->count(),
+                        static_cast<int>(ADAPTIVE_WORK_DURATION_PERCENTILE * 100),
+                        mWorkDurationCount, adaptiveWorkDurationPercentileLocked().count());
+}
+
 } // namespace android::scheduler
@@ -16,9 +16,11 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
 #include <mutex>
 #include <optional>
+#include <string>
 #include <unordered_set>
 
 #include <android-base/thread_annotations.h>
@@ -45,6 +47,19 @@ public:
     // This may keep early offsets for an extra frame, but avoids a race with transaction commit.
     static const std::chrono::nanoseconds MIN_EARLY_TRANSACTION_TIME;
 
+    // Number of recent frame work durations that the adaptive SF work duration is chosen from, and
+    // how many of them are needed before it is used.
+    static constexpr size_t ADAPTIVE_WORK_DURATION_WINDOW = 64;
+    static constexpr size_t MIN_ADAPTIVE_WORK_DURATION_FRAMES = 8;
+    static constexpr double ADAPTIVE_WORK_DURATION_PERCENTILE = 0.9;
+
+    // Headroom added to the percentile of recent work durations.
+    static const std::chrono::nanoseconds ADAPTIVE_WORK_DURATION_MARGIN;
+
+    // The adaptive SF work duration only decreases by at least this much at a time, so that SF
+    // doesn't reschedule its wakeup every frame while work durations stay about the same.
+    static const std::chrono::nanoseconds ADAPTIVE_WORK_DURATION_HYSTERESIS;
+
     using VsyncConfigOpt = std::optional<VsyncConfig>;
 
     using Clock = std::chrono::steady_clock;
@@ -76,6 +91,15 @@ public:
 
     [[nodiscard]] VsyncConfigOpt onDisplayRefresh(bool usedGpuComposition);
 
+    // When enabled, the SF work duration of the late and GPU offsets follows the measured work
+    // duration of recent frames, bounded by the work durations of the VsyncConfigSet.
+    [[nodiscard]] VsyncConfigOpt setAdaptiveWorkDurationEnabled(bool) EXCLUDES(mMutex);
+
+    // Called with the commit, composite and GPU duration of each frame.
+    [[nodiscard]] VsyncConfigOpt onFrameWorkDuration(std::chrono::nanoseconds) EXCLUDES(mMutex);
+
+    void dump(std::string&) const EXCLUDES(mMutex);
+
 protected:
     // Called from unit tests as well
     void binderDied(const wp<IBinder>&) override EXCLUDES(mMutex);
@@ -88,6 +112,11 @@ private:
     [[nodiscard]] VsyncConfig updateVsyncConfig() EXCLUDES(mMutex);
     [[nodiscard]] VsyncConfig updateVsyncConfigLocked() REQUIRES(mMutex);
 
+    std::chrono::nanoseconds adaptiveWorkDurationPercentileLocked() const REQUIRES(mMutex);
+    std::chrono::nanoseconds clampAdaptiveWorkDurationLocked(std::chrono::nanoseconds) const
+            REQUIRES(mMutex);
+    void updateAdaptiveVsyncConfigsLocked() REQUIRES(mMutex);
+
     mutable std::mutex mMutex;
     VsyncConfigSet mVsyncConfigSet GUARDED_BY(mMutex);
 
@@ -104,6 +133,18 @@ private:
     std::atomic<TimePoint> mEarlyTransactionStartTime = TimePoint();
     std::atomic<TimePoint> mLastTransactionCommitTime = TimePoint();
 
+    bool mAdaptiveWorkDurationEnabled GUARDED_BY(mMutex) = false;
+
+    // Ring buffer of the work durations of recent frames, in ns.
+    std::array<nsecs_t, ADAPTIVE_WORK_DURATION_WINDOW> mWorkDurations GUARDED_BY(mMutex){};
+    size_t mWorkDurationCount GUARDED_BY(mMutex) = 0;
+    size_t mNextWorkDurationIndex GUARDED_BY(mMutex) = 0;
+
+    // Set once enough frames have been measured, and used in place of the late and GPU configs.
+    std::optional<std::chrono::nanoseconds> mAdaptiveSfWorkDuration GUARDED_BY(mMutex);
+    VsyncConfig mAdaptiveLate GUARDED_BY(mMutex){mVsyncConfigSet.late};
+    VsyncConfig mAdaptiveEarlyGpu GUARDED_BY(mMutex){mVsyncConfigSet.earlyGpu};
+
     const Now mNow;
 };
 
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "ScreenCaptureCoalescer"
+
+#include "ScreenCaptureCoalescer.h"
+
+#include <algorithm>
+
+#include <android-base/stringprintf.h>
+#include <android/gui/BnScreenCaptureListener.h>
+
+namespace android {
+
+using base::StringAppendF;
+using gui::IScreenCaptureListener;
+using gui::ScreenCaptureResults;
+
+// The listener a shared capture is rendered for, which hands the results to the coalescer.
+class ScreenCaptureCoalescer::CaptureListener : public gui::BnScreenCaptureListener {
+public:
+    explicit CaptureListener(ScreenCaptureCoalescer& coalescer) : mCoalescer(coalescer) {}
+
+    binder::Status onScreenCaptureCompleted(const ScreenCaptureResults& results) override {
+        mCoalescer.onCaptureCompleted(this, results);
+        return binder::Status::ok();
+    }
+
+private:
+    ScreenCaptureCoalescer& mCoalescer;
+};
+
+bool ScreenCaptureCoalescer::Key::operator==(const Key& other) const {
+    return displayToken == other.displayToken && sourceCrop == other.sourceCrop &&
+            size == other.size && dataspace == other.dataspace &&
+            pixelFormat == other.pixelFormat && uid == other.uid &&
+            captureSecureLayers == other.captureSecureLayers &&
+            allowProtected == other.allowProtected && grayscale == other.grayscale &&
+            attachGainmap == other.attachGainmap &&
+            hintForSeamlessTransition == other.hintForSeamlessTransition &&
+            excludeLayerIds == other.excludeLayerIds;
+}
+
+sp<IScreenCaptureListener> ScreenCaptureCoalescer::coalesce(
+        Key key, const sp<IScreenCaptureListener>& listener) {
+    std::sort(key.excludeLayerIds.begin(), key.excludeLayerIds.end());
+
+    std::unique_lock lock(mMutex);
+    const auto cached = std::find_if(mCachedCaptures.begin(), mCachedCaptures.end(),
+                                     [&](const CachedCapture& capture) {
+                                         return capture.key == key;
+                                     });
+    if (cached != mCachedCaptures.end()) {
+        mStats.cached++;
+        const ScreenCaptureResults results = cached->results;
+        lock.unlock();
+        listener->onScreenCaptureCompleted(results);
+        return nullptr;
+    }
+
+    const auto inProgress =
+            std::find_if(mCapturesInProgress.begin(), mCapturesInProgress.end(),
+                         [&](const Capture& capture) {
+                             return capture.generation == mGeneration && capture.key == key;
+                         });
+    if (inProgress != mCapturesInProgress.end()) {
+        mStats.joined++;
+        inProgress->waiters.push_back(listener);
+        return nullptr;
+    }
+
+    mStats.rendered++;
+    auto captureListener = sp<CaptureListener>::make(*this);
+    mCapturesInProgress.push_back({std::move(key), mGeneration, captureListener, {listener}});
+    return captureListener;
+}
+
+void ScreenCaptureCoalescer::onCaptureCompleted(const CaptureListener* listener,
+                                                const ScreenCaptureResults& results) {
+    std::vector<sp<IScreenCaptureListener>> waiters;
+    {
+        std::lock_guard lock(mMutex);
+        const auto it = std::find_if(mCapturesInProgress.begin(), mCapturesInProgress.end(),
+                                     [&](const Capture& capture) {
+                                         return capture.listener.get() == listener;
+                                     });
+        if (it == mCapturesInProgress.end()) {
+            ALOGE("%s: Completed a capture that is not in progress", __func__);
+            return;
+        }
+
+        waiters = std::move(it->waiters);
+        // Failed captures are not cached, so that the next request tries again.
+        if (it->generation == mGeneration && results.fenceResult.ok()) {
+            if (mCachedCaptures.size() == kMaxCachedCaptures) {
+                mCachedCaptures.pop_front();
+            }
+            mCachedCaptures.push_back({std::move(it->key), results});
+        }
+        mCapturesInProgress.erase(it);
+    }
+
+    for (const auto& waiter : waiters) {
+        waiter->onScreenCaptureCompleted(results);
+    }
+}
+
+void ScreenCaptureCoalescer::onFrameCommitted() {
+    std::deque<CachedCapture> cachedCaptures;
+    {
+        std::lock_guard lock(mMutex);
+        mGeneration++;
+        // Release the buffers outside of the lock.
+        std::swap(cachedCaptures, mCachedCaptures);
+    }
+}
+
+ScreenCaptureCoalescer::Stats ScreenCaptureCoalescer::getStats() const {
+    std::lock_guard lock(mMutex);
+    return mStats;
+}
+
+void ScreenCaptureCoalescer::dump(std::string& result) const {
+    std::lock_guard lock(mMutex);
+    StringAppendF(&result,
+                  "Screen capture coalescing: %" PRIu64 " rendered, %" PRIu64
+                  " joined in progress, %" PRIu64 " from cache, %zu in progress\n",
+                  mStats.rendered, mStats.joined, mStats.cached, mCapturesInProgress.size());
+}
+
+} // namespace android
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cinttypes>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+#include <android/gui/IScreenCaptureListener.h>
+#include <binder/IBinder.h>
+#include <gui/ScreenCaptureResults.h>
+#include <ui/Rect.h>
+#include <ui/Size.h>
+
+namespace android {
+
+// Shares the rendering of a display capture between the clients that ask for an equivalent
+// capture of the same frame, such as recents thumbnails, accessibility and screen recording.
+//
+// A capture is only shared while nothing new has been committed since it was requested. A request
+// that matches a capture in progress is completed along with it, and one that matches a capture
+// that completed is answered with the same results right away.
+class ScreenCaptureCoalescer {
+public:
+    // Everything that determines the content of a display capture.
+    struct Key {
+        sp<IBinder> displayToken;
+        Rect sourceCrop;
+        ui::Size size;
+        int32_t dataspace = 0;
+        int32_t pixelFormat = 0;
+        int32_t uid = 0;
+        bool captureSecureLayers = false;
+        bool allowProtected = false;
+        bool grayscale = false;
+        bool attachGainmap = false;
+        bool hintForSeamlessTransition = false;
+        // Sorted, so that the order in which the excluded layers are passed doesn't matter.
+        std::vector<uint32_t> excludeLayerIds;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct Stats {
+        uint64_t rendered = 0;
+        uint64_t joined = 0;
+        uint64_t cached = 0;
+    };
+
+    // The number of completed captures that are kept for the current frame.
+    static constexpr size_t kMaxCachedCaptures = 2;
+
+    // Returns the listener to render the capture for, which completes listener and every request
+    // that joins it. Returns nullptr if the request was joined to a capture in progress or
+    // completed from the cache, in which case there is nothing to render.
+    sp<gui::IScreenCaptureListener> coalesce(Key key,
+                                             const sp<gui::IScreenCaptureListener>& listener);
+
+    // Called once something new was committed, after which captures are no longer shared.
+    void onFrameCommitted();
+
+    Stats getStats() const;
+    void dump(std::string& result) const;
+
+private:
+    class CaptureListener;
+
+    struct Capture {
+        Key key;
+        uint64_t generation;
+        sp<CaptureListener> listener;
+        std::vector<sp<gui::IScreenCaptureListener>> waiters;
+    };
+
+    struct CachedCapture {
+        Key key;
+        gui::ScreenCaptureResults results;
+    };
+
+    void onCaptureCompleted(const CaptureListener*, const gui::ScreenCaptureResults&);
+
+    mutable std::mutex mMutex;
+    uint64_t mGeneration GUARDED_BY(mMutex) = 0;
+    std::vector<Capture> mCapturesInProgress GUARDED_BY(mMutex);
+    // The captures completed for mGeneration, most recent last.
+    std::deque<CachedCapture> mCachedCaptures GUARDED_BY(mMutex);
+    Stats mStats GUARDED_BY(mMutex);
+};
+
+} // namespace android
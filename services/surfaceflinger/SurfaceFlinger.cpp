@@ -91,6 +91,7 @@
 #include <ui/DisplayStatInfo.h>
 #include <ui/DisplayState.h>
 #include <ui/DynamicDisplayInfo.h>
+#include <ui/FenceTime.h>
 #include <ui/GraphicBufferAllocator.h>
 #include <ui/HdrRenderTypeUtils.h>
 #include <ui/LayerStack.h>
@@ -123,6 +124,7 @@
 #include <gui/SyncScreenCaptureListener.h>
 #include <ui/DisplayIdentification.h>
 #include "BackgroundExecutor.h"
+#include "ChangedAreaEstimator.h"
 #include "Client.h"
 #include "ClientCache.h"
 #include "Colorizer.h"
@@ -320,6 +322,19 @@ bool fileNewerThan(const std::string& path, std::chrono::minutes duration) {
     return duration > (Clock::now() - updateTime);
 }
 
+// Records how long a stage of the frame took when it goes out of scope.
+class ScopedStageLatency {
+public:
+    ScopedStageLatency(TimeStats& timeStats, TimeStats::LatencyStage stage)
+          : mTimeStats(timeStats), mStage(stage), mStartTime(systemTime()) {}
+    ~ScopedStageLatency() { mTimeStats.recordStageLatency(mStage, systemTime() - mStartTime); }
+
+private:
+    TimeStats& mTimeStats;
+    const TimeStats::LatencyStage mStage;
+    const nsecs_t mStartTime;
+};
+
 bool isFrameIntervalOnCadence(TimePoint expectedPresentTime, TimePoint lastExpectedPresentTimestamp,
                               Fps lastFrameInterval, Period timeout, Duration threshold) {
     if (lastFrameInterval.getPeriodNsecs() == 0) {
@@ -434,6 +449,10 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory, SkipInitializationTag)
                 getDensityFromProperty("ro.sf.lcd_density", !mEmulatedDisplayDensity)),
         mPowerAdvisor(std::make_unique<Hwc2::impl::PowerAdvisor>(*this)),
         mWindowInfosListenerInvoker(sp<WindowInfosListenerInvoker>::make()),
+        mTransactionChannelManager(sp<TransactionChannelManager>::make(
+                [this](TransactionChannelManager::ChannelTransaction&& transaction) {
+                    queueChannelTransaction(std::move(transaction));
+                })),
         mSkipPowerOnForQuiescent(base::GetBoolProperty("ro.boot.quiescent"s, false)) {
     ALOGI("Using HWComposer service: %s", mHwcServiceName.c_str());
 }
@@ -499,6 +518,9 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
     property_get("debug.sf.luma_sampling", value, "1");
     mLumaSampling = atoi(value);
 
+    mSmallAreaEstimationSampleSize =
+            std::max(property_get_int32("debug.sf.small_area_estimation_sample_size", 0), 0);
+
     property_get("debug.sf.disable_client_composition_cache", value, "0");
     mDisableClientCompositionCache = atoi(value);
 
@@ -514,6 +536,37 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
     mIgnoreHwcPhysicalDisplayOrientation =
             base::GetBoolProperty("debug.sf.ignore_hwc_physical_display_orientation"s, false);
 
+    mParallelSnapshotTraversal =
+            base::GetBoolProperty("debug.sf.parallel_snapshot_traversal"s, false);
+
+    mConcurrentOutputPresent =
+            base::GetBoolProperty("debug.sf.concurrent_output_present"s, false);
+
+    mCoalesceScreenCaptures = base::GetBoolProperty("debug.sf.coalesce_screen_captures"s, false);
+
+    mBatchReleaseCallbacks = base::GetBoolProperty("debug.sf.batch_release_callbacks"s, false);
+
+    // Recycling is opt-in, since a recycled buffer keeps the contents and metadata it had.
+    if (const uint64_t recyclingPoolKb =
+                base::GetUintProperty("debug.sf.buffer_recycling_pool_kb"s, uint64_t{0})) {
+        const nsecs_t recyclingTimeout = ms2ns(
+                base::GetIntProperty("debug.sf.buffer_recycling_timeout_ms"s, nsecs_t{5000}));
+        GraphicBufferAllocator::get().setRecyclingPool(recyclingPoolKb * 1024, recyclingTimeout);
+    }
+
+    // Lets the fences of the frame timeline and frame stats be waited for on one thread, rather
+    // than polled on every lookup while they are pending.
+    FenceTime::setSignalWatcherEnabled(
+            base::GetBoolProperty("debug.sf.fence_signal_watcher"s, false));
+
+    // Jank data is sent to the listeners of a layer in batches, and at least once a second.
+    JankTracker::setBatching(base::GetUintProperty("debug.sf.jank_data_batch_size"s, size_t{50}),
+                             ms2ns(base::GetIntProperty("debug.sf.jank_data_flush_interval_ms"s,
+                                                        nsecs_t{1000})));
+
+    mScreenshotGainmapDownscale =
+            std::max(base::GetUintProperty("debug.sf.screenshot_gainmap_downscale"s, 1u), 1u);
+
     // We should be reading 'persist.sys.sf.color_saturation' here
     // but since /data may be encrypted, we need to wait until after vold
     // comes online to attempt to read the property. The property is
@@ -541,6 +594,9 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
         mLayerTracing.setTransactionTracing(*mTransactionTracing);
     }
 
+    mLayerTracing.setDeltaKeyframeInterval(
+            base::GetUintProperty<uint32_t>("debug.sf.layer_tracing_keyframe_interval"s, 0));
+
     mIgnoreHdrCameraLayers = ignore_hdr_camera_layers(false);
 
     // These are set by the HWC implementation to indicate that they will use the workarounds.
@@ -741,6 +797,7 @@ void SurfaceFlinger::bootFinished() {
     const nsecs_t now = systemTime();
     const nsecs_t duration = now - mBootTime;
     ALOGI("Boot is finished (%ld ms)", long(ns2ms(duration)) );
+    mBootFinishedTime = now;
 
     mFrameTracer->initialize();
     mFrameTimeline->onBootFinished();
@@ -875,6 +932,7 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     addTransactionReadyFilters();
     Mutex::Autolock lock(mStateLock);
 
+    startInitStep("RenderEngine creation");
     // Get a RenderEngine for the given display / config (can't fail)
     // TODO(b/77156734): We need to stop casting and use HAL types when possible.
     // Sending maxFrameBufferAcquiredBuffers as the cache size is tightly tuned to single-display.
@@ -887,12 +945,12 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
                            .setContextPriority(
                                    useContextPriority
                                            ? renderengine::RenderEngine::ContextPriority::REALTIME
-                                           : renderengine::RenderEngine::ContextPriority::MEDIUM);
+                                           : renderengine::RenderEngine::ContextPriority::MEDIUM)
+                           .setParallelCapture(base::GetBoolProperty(
+                                   PROPERTY_DEBUG_RENDERENGINE_PARALLEL_CAPTURE, false));
     chooseRenderEngineType(builder);
     mRenderEngine = renderengine::RenderEngine::create(builder.build());
     mCompositionEngine->setRenderEngine(mRenderEngine.get());
-    mMaxRenderTargetSize =
-            std::min(getRenderEngine().getMaxTextureSize(), getRenderEngine().getMaxViewportDims());
 
     // Set SF main policy after initializing RenderEngine which has its own policy.
     if (!SetTaskProfiles(0, {"SFMainPolicy"})) {
@@ -901,12 +959,22 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
 
     mCompositionEngine->setTimeStats(mTimeStats);
 
+    startInitStep("HWC connection");
     mCompositionEngine->setHwComposer(getFactory().createHWComposer(mHwcServiceName));
     auto& composer = mCompositionEngine->getHwComposer();
     composer.setCallback(*this);
     mDisplayModeController.setHwComposer(&composer);
 
     ClientCache::getInstance().setRenderEngine(&getRenderEngine());
+    ClientCache::getInstance().setMemoryBudget(
+            base::GetUintProperty<size_t>("debug.sf.client_cache_budget_mb"s, 0) * 1024 * 1024);
+    ClientCache::getInstance().setClientMemoryBudget(
+            base::GetUintProperty<size_t>("debug.sf.client_cache_budget_per_client_mb"s, 0) *
+            1024 * 1024);
+
+    // Checks every update of the layer hierarchy against one built from scratch.
+    mLayerHierarchyBuilder.setVerifyUpdates(
+            base::GetBoolProperty("debug.sf.verify_layer_hierarchy"s, false));
 
     mHasReliablePresentFences =
             !getHwComposer().hasCapability(Capability::PRESENT_FENCE_IS_NOT_RELIABLE);
@@ -918,12 +986,21 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     mFirstApiLevel = android::base::GetIntProperty("ro.product.first_api_level", 0);
 
     // Process hotplug for displays connected at boot.
+    startInitStep("Initial hotplug");
     LOG_ALWAYS_FATAL_IF(!configureLocked(),
                         "Initial display configuration failed: HWC did not hotplug");
 
     mActiveDisplayId = getPrimaryDisplayIdLocked();
 
+    // A threaded RenderEngine creates its context on its own thread, which overlaps with the
+    // connection to the HWC and the identification of the displays above. Nothing before this
+    // point waits on RenderEngine, and the displays cannot be committed without it.
+    startInitStep("RenderEngine ready");
+    mMaxRenderTargetSize =
+            std::min(getRenderEngine().getMaxTextureSize(), getRenderEngine().getMaxViewportDims());
+
     // Commit primary display.
+    startInitStep("Primary display");
     sp<const DisplayDevice> display;
     if (const auto indexOpt = mCurrentState.getDisplayIndex(mActiveDisplayId)) {
         const auto& displays = mCurrentState.displays;
@@ -944,6 +1021,7 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     // TODO(b/241285876): The Scheduler needlessly depends on creating the CompositionEngine part of
     // the DisplayDevice, hence the above commit of the primary display. Remove that special case by
     // initializing the Scheduler after configureLocked, once decoupled from DisplayDevice.
+    startInitStep("Scheduler");
     initScheduler(display);
 
     // Start listening after creating the Scheduler, since the listener calls into it.
@@ -972,6 +1050,7 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     });
 
     // Commit secondary display(s).
+    startInitStep("Secondary displays");
     processDisplayChangesLocked();
 
     // initialize our drawing state
@@ -982,7 +1061,9 @@ void SurfaceFlinger::init() FTL_FAKE_GUARD(kMainThreadContext) {
     static_cast<void>(mScheduler->schedule(
             [this]() FTL_FAKE_GUARD(kMainThreadContext) { initializeDisplays(); }));
 
+    startInitStep("Power advisor");
     mPowerAdvisor->init();
+    startInitStep(nullptr);
 
     if (base::GetBoolProperty("service.sf.prime_shader_cache"s, true)) {
         if (setSchedFifo(false) != NO_ERROR) {
@@ -1050,6 +1131,18 @@ void SurfaceFlinger::initBootProperties() {
     }
 }
 
+void SurfaceFlinger::startInitStep(const char* name) {
+    const nsecs_t now = systemTime();
+    if (!mInitSteps.empty() && mInitSteps.back().duration < 0) {
+        SFTRACE_END();
+        mInitSteps.back().duration = now - mInitSteps.back().start;
+    }
+    if (name) {
+        SFTRACE_BEGIN(name);
+        mInitSteps.push_back({.name = name, .start = now});
+    }
+}
+
 void SurfaceFlinger::initTransactionTraceWriter() {
     if (!mTransactionTracing) {
         return;
@@ -2307,9 +2400,11 @@ void SurfaceFlinger::updateLayerHistory(nsecs_t now) {
             continue;
         }
 
+        // The changed area of each new buffer is estimated when clients report full damage.
         const bool updateSmallDirty = FlagManager::getInstance().enable_small_area_detection() &&
                 ((snapshot->clientChanges & layer_state_t::eSurfaceDamageRegionChanged) ||
-                 snapshot->changes.any(Changes::Geometry));
+                 snapshot->changes.any(Changes::Geometry) ||
+                 (mChangedAreaEstimator && snapshot->changes.test(Changes::Buffer)));
 
         const bool hasChanges =
                 snapshot->changes.any(Changes::FrameRate | Changes::Buffer | Changes::Animation |
@@ -2372,9 +2467,11 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, nsecs_t frameTimeNs,
                                           bool flushTransactions, bool& outTransactionsAreEmpty) {
     using Changes = frontend::RequestedLayerState::Changes;
     SFTRACE_CALL();
+    ScopedStageLatency stageLatency(*mTimeStats, TimeStats::LatencyStage::UpdateLayerSnapshots);
     frontend::Update update;
     if (flushTransactions) {
         SFTRACE_NAME("TransactionHandler:flushTransactions");
+        const nsecs_t flushStartTime = systemTime();
         // Locking:
         // 1. to prevent onHandleDestroyed from being called while the state lock is held,
         // we must keep a copy of the transactions (specifically the composer
@@ -2400,6 +2497,8 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, nsecs_t frameTimeNs,
 
         mLayerLifecycleManager.addLayers(std::move(update.newLayers));
         update.transactions = mTransactionHandler.flushTransactions();
+        mTimeStats->recordStageLatency(TimeStats::LatencyStage::TransactionFlush,
+                                       systemTime() - flushStartTime);
         if (mTransactionTracing) {
             mTransactionTracing->addCommittedTransactions(ftl::to_underlying(vsyncId), frameTimeNs,
                                                           update, mFrontEndDisplayInfos,
@@ -2438,7 +2537,8 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, nsecs_t frameTimeNs,
                              getHwComposer().getSupportedLayerGenericMetadata(),
                      .genericLayerMetadataKeyMap = getGenericLayerMetadataKeyMap(),
                      .skipRoundCornersWhenProtected =
-                             !getRenderEngine().supportsProtectedContent()};
+                             !getRenderEngine().supportsProtectedContent(),
+                     .parallelTraversal = mParallelSnapshotTraversal};
         mLayerSnapshotBuilder.update(args);
     }
 
@@ -2553,6 +2653,7 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, nsecs_t frameTimeNs,
         commitTransactions();
     }
 
+    mTransactionHandler.recycleFlushedTransactions(std::move(update.transactions));
     return mustComposite;
 }
 
@@ -2699,6 +2800,10 @@ bool SurfaceFlinger::commit(PhysicalDisplayId pacesetterId,
     doActiveLayersTracingIfNeeded(false, mVisibleRegionsDirty,
                                   pacesetterFrameTarget.frameBeginTime(), vsyncId);
 
+    if (mustComposite) {
+        mScreenCaptureCoalescer.onFrameCommitted();
+    }
+
     mLastCommittedVsyncId = vsyncId;
 
     persistDisplayBrightness(mustComposite);
@@ -2775,6 +2880,7 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
     }
 
     refreshArgs.devOptForceClientComposition = mDebugDisableHWC;
+    refreshArgs.concurrentOutputPresent = mConcurrentOutputPresent;
 
     if (mDebugFlashDelay != 0) {
         refreshArgs.devOptForceClientComposition = true;
@@ -2888,6 +2994,11 @@ CompositeResultsPerDisplay SurfaceFlinger::composite(
         mPowerAdvisor->setSfPresentTiming(TimePoint::fromNs(previousPresentFence->getSignalTime()),
                                           TimePoint::now());
         mPowerAdvisor->reportActualWorkDuration();
+
+        if (const auto workDuration = mPowerAdvisor->getLastActualWorkDuration()) {
+            mScheduler->modulateVsync({}, &VsyncModulator::onFrameWorkDuration,
+                                      std::chrono::nanoseconds(*workDuration));
+        }
     }
 
     if (mScheduler->onCompositionPresented(presentTime)) {
@@ -3284,6 +3395,7 @@ void SurfaceFlinger::onCompositionPresented(PhysicalDisplayId pacesetterId,
 
 void SurfaceFlinger::commitTransactions() {
     SFTRACE_CALL();
+    ScopedStageLatency stageLatency(*mTimeStats, TimeStats::LatencyStage::CommitTransactions);
     mDebugInTransaction = systemTime();
 
     // Here we're guaranteed that some transaction flags are set
@@ -3984,6 +4096,7 @@ void SurfaceFlinger::updateInputFlinger(VsyncId vsyncId, TimePoint frameTime) {
         return;
     }
     SFTRACE_CALL();
+    ScopedStageLatency stageLatency(*mTimeStats, TimeStats::LatencyStage::UpdateInputFlinger);
 
     std::vector<WindowInfo> windowInfos;
     std::vector<DisplayInfo> displayInfos;
@@ -4349,6 +4462,10 @@ void SurfaceFlinger::initScheduler(const sp<const DisplayDevice>& display) {
                                   /*applyImmediately*/ true);
     }
 
+    if (base::GetBoolProperty("debug.sf.adaptive_sf_work_duration"s, false)) {
+        mScheduler->modulateVsync({}, &VsyncModulator::setAdaptiveWorkDurationEnabled, true);
+    }
+
     const auto configs = mScheduler->getVsyncConfiguration().getCurrentConfigs();
 
     mScheduler->createEventThread(scheduler::Cycle::Render, mFrameTimeline->getTokenManager(),
@@ -4367,6 +4484,12 @@ void SurfaceFlinger::initScheduler(const sp<const DisplayDevice>& display) {
     mRegionSamplingThread =
             sp<RegionSamplingThread>::make(*this,
                                            RegionSamplingThread::EnvironmentTimingTunables());
+    if (FlagManager::getInstance().enable_small_area_detection() &&
+        mSmallAreaEstimationSampleSize > 0) {
+        mChangedAreaEstimator =
+                std::make_unique<ChangedAreaEstimator>(getRenderEngine(),
+                                                       mSmallAreaEstimationSampleSize);
+    }
     mFpsReporter = sp<FpsReporter>::make(*mFrameTimeline);
 
     // Timer callbacks may fire, so do this last.
@@ -4571,7 +4694,10 @@ TransactionHandler::TransactionReadiness SurfaceFlinger::transactionReadyBufferC
                         s.bufferData->flags.test(BufferData::BufferDataChange::fenceChanged) &&
                         s.bufferData->acquireFence;
                 const bool fenceSignaled = !acquireFenceAvailable ||
-                        s.bufferData->acquireFence->getStatus() != Fence::Status::Unsignaled;
+                        (flushState.fenceStatuses
+                                 ? flushState.fenceStatuses->getStatus(s.bufferData->acquireFence)
+                                 : s.bufferData->acquireFence->getStatus()) !=
+                                Fence::Status::Unsignaled;
                 if (!fenceSignaled) {
                     // check fence status
                     const bool allowLatchUnsignaled =
@@ -4617,7 +4743,9 @@ void SurfaceFlinger::addTransactionReadyFilters() {
 bool SurfaceFlinger::flushTransactionQueues() {
     mTransactionHandler.collectTransactions();
     std::vector<TransactionState> transactions = mTransactionHandler.flushTransactions();
-    return applyTransactions(transactions);
+    const bool needsTraversal = applyTransactions(transactions);
+    mTransactionHandler.recycleFlushedTransactions(std::move(transactions));
+    return needsTraversal;
 }
 
 bool SurfaceFlinger::applyTransactions(std::vector<TransactionState>& transactions) {
@@ -4742,6 +4870,11 @@ status_t SurfaceFlinger::setTransactionState(
 
     const int64_t postTime = systemTime();
 
+    // The buffers that the transaction caches, uncaches and sets are mapped and unmapped by
+    // RenderEngine together, once they are all resolved.
+    std::optional<renderengine::impl::ExternalTexture::Batch> textureBatch;
+    textureBatch.emplace(getRenderEngine());
+
     std::vector<uint64_t> uncacheBufferIds;
     uncacheBufferIds.reserve(uncacheBuffers.size());
     for (const auto& uncacheBuffer : uncacheBuffers) {
@@ -4750,6 +4883,11 @@ status_t SurfaceFlinger::setTransactionState(
             uncacheBufferIds.push_back(buffer->getId());
         }
     }
+    // Buffers that the cache evicted to stay within its memory budget are purged from the
+    // Composer HAL cache as well.
+    for (uint64_t evictedBufferId : ClientCache::getInstance().takeEvictedBufferIds()) {
+        uncacheBufferIds.push_back(evictedBufferId);
+    }
 
     std::vector<ResolvedComposerState> resolvedStates;
     resolvedStates.reserve(states.size());
@@ -4763,7 +4901,8 @@ status_t SurfaceFlinger::setTransactionState(
                     layer->getDebugName() : std::to_string(resolvedState.state.layerId);
             resolvedState.externalTexture =
                     getExternalTextureFromBufferData(*resolvedState.state.bufferData,
-                                                     layerName.c_str(), transactionId);
+                                                     layerName.c_str(), transactionId, originPid,
+                                                     originUid);
             if (resolvedState.externalTexture) {
                 resolvedState.state.bufferData->buffer = resolvedState.externalTexture->getBuffer();
             }
@@ -4785,6 +4924,7 @@ status_t SurfaceFlinger::setTransactionState(
                     LayerHandle::getLayerId(touchableRegionCropHandle.promote());
         }
     }
+    textureBatch.reset();
 
     TransactionState state{frameTimelineInfo,
                            resolvedStates,
@@ -4814,12 +4954,12 @@ status_t SurfaceFlinger::setTransactionState(
     }(state.flags);
 
     const auto frameHint = state.isFrameActive() ? FrameHint::kActive : FrameHint::kNone;
-    {
+    mTransactionChannelManager->onBinderTransaction(originPid, transactionId, [&] {
         // Transactions are added via a lockless queue and does not need to be added from the main
         // thread.
         ftl::FakeGuard guard(kMainThreadContext);
         mTransactionHandler.queueTransaction(std::move(state));
-    }
+    });
 
     for (const auto& [displayId, data] : mNotifyExpectedPresentMap) {
         if (data.hintStatus.load() == NotifyExpectedPresentHintStatus::ScheduleOnTx) {
@@ -4830,6 +4970,70 @@ status_t SurfaceFlinger::setTransactionState(
     return NO_ERROR;
 }
 
+void SurfaceFlinger::queueChannelTransaction(
+        TransactionChannelManager::ChannelTransaction&& transaction) {
+    SFTRACE_CALL();
+
+    const uint32_t permissions =
+            LayerStatePermissions::getTransactionPermissions(transaction.originPid,
+                                                             transaction.originUid);
+    std::vector<ResolvedComposerState> resolvedStates;
+    resolvedStates.reserve(transaction.states.size());
+    for (auto& composerState : transaction.states) {
+        composerState.state.sanitize(permissions);
+        resolvedStates.emplace_back(std::move(composerState));
+        auto& resolvedState = resolvedStates.back();
+        resolvedState.layerId = LayerHandle::getLayerId(resolvedState.state.surface);
+    }
+
+    TransactionState state{FrameTimelineInfo{},
+                           resolvedStates,
+                           /*displayStates=*/{},
+                           transaction.flags,
+                           transaction.applyToken,
+                           /*inputWindowCommands=*/{},
+                           /*desiredPresentTime=*/0,
+                           /*isAutoTimestamp=*/true,
+                           /*uncacheBufferIds=*/{},
+                           systemTime(),
+                           /*hasListenerCallbacks=*/false,
+                           /*listenerCallbacks=*/{},
+                           transaction.originPid,
+                           transaction.originUid,
+                           transaction.transactionId,
+                           /*mergedTransactionIds=*/{}};
+
+    if (mTransactionTracing) {
+        mTransactionTracing->addQueuedTransaction(state);
+    }
+
+    {
+        ftl::FakeGuard guard(kMainThreadContext);
+        mTransactionHandler.queueTransaction(std::move(state));
+    }
+    setTransactionFlags(eTransactionFlushNeeded, TransactionSchedule::Late, transaction.applyToken);
+}
+
+status_t SurfaceFlinger::setTransactionChannel(int pid, int uid, base::unique_fd channelFd,
+                                               const sp<IBinder>& applyToken) {
+    return mTransactionChannelManager->setChannel(pid, uid, std::move(channelFd), applyToken);
+}
+
+status_t SurfaceFlinger::registerTransactionChannelLayer(int pid, const sp<IBinder>& layerHandle,
+                                                         int32_t* outLayerId) {
+    const uint32_t layerId = LayerHandle::getLayerId(layerHandle);
+    if (layerId == UNASSIGNED_LAYER_ID) {
+        return BAD_VALUE;
+    }
+    if (status_t err = mTransactionChannelManager->registerLayer(pid, layerHandle,
+                                                                 static_cast<int32_t>(layerId));
+        err != OK) {
+        return err;
+    }
+    *outLayerId = static_cast<int32_t>(layerId);
+    return OK;
+}
+
 bool SurfaceFlinger::applyTransactionState(const FrameTimelineInfo& frameTimelineInfo,
                                            std::vector<ResolvedComposerState>& states,
                                            Vector<DisplayState>& displays, uint32_t flags,
@@ -5520,6 +5724,8 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
     }
 
     static const std::unordered_map<std::string, Dumper> dumpers = {
+            {"--boot-timing"s, dumper(&SurfaceFlinger::dumpBootTiming)},
+            {"--buffer-memory"s, mainThreadDumper(&SurfaceFlinger::dumpBufferMemory)},
             {"--comp-displays"s, dumper(&SurfaceFlinger::dumpCompositionDisplays)},
             {"--display-id"s, dumper(&SurfaceFlinger::dumpDisplayIdentificationData)},
             {"--displays"s, dumper(&SurfaceFlinger::dumpDisplays)},
@@ -5531,6 +5737,7 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
             {"--hwclayers"s, mainThreadDumper(&SurfaceFlinger::dumpHwcLayersMinidump)},
             {"--latency"s, argsMainThreadDumper(&SurfaceFlinger::dumpStats)},
             {"--latency-clear"s, argsMainThreadDumper(&SurfaceFlinger::clearStats)},
+            {"--latency-histograms"s, dumper(&SurfaceFlinger::dumpLatencyHistograms)},
             {"--list"s, mainThreadDumper(&SurfaceFlinger::listLayers)},
             {"--planner"s, argsDumper(&SurfaceFlinger::dumpPlannerInfo)},
             {"--scheduler"s, dumper(&SurfaceFlinger::dumpScheduler)},
@@ -5551,6 +5758,7 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
     mScheduler
             ->schedule([&]() FTL_FAKE_GUARD(mStateLock) FTL_FAKE_GUARD(kMainThreadContext) {
                 dumpVisibleFrontEnd(compositionLayers);
+                dumpBufferMemory(compositionLayers);
             })
             .get();
     // get window info listener data without the state lock
@@ -5562,6 +5770,20 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
                   windowInfosDebug.maxSendDelayDuration);
     StringAppendF(&compositionLayers, "  unsent messages: %zu\n",
                   windowInfosDebug.pendingMessageCount);
+    StringAppendF(&compositionLayers, "  complete updates sent: %zu\n",
+                  windowInfosDebug.fullUpdatesSent);
+    StringAppendF(&compositionLayers, "  delta updates sent: %zu\n",
+                  windowInfosDebug.deltaUpdatesSent);
+    StringAppendF(&compositionLayers, "  coalesced updates: %zu\n",
+                  windowInfosDebug.coalescedUpdates);
+    StringAppendF(&compositionLayers, "  acks received: %zu\n", windowInfosDebug.acksReceived);
+    StringAppendF(&compositionLayers, "  average ack latency (ns): %" PRId64 " ns\n",
+                  windowInfosDebug.acksReceived == 0
+                          ? 0
+                          : windowInfosDebug.totalAckLatency /
+                                  static_cast<nsecs_t>(windowInfosDebug.acksReceived));
+    StringAppendF(&compositionLayers, "  max ack latency (ns): %" PRId64 " ns\n",
+                  windowInfosDebug.maxAckLatency);
     compositionLayers.append("\n");
     dumpAll(args, compositionLayers, result);
     write(fd, result.c_str(), result.size());
@@ -5578,6 +5800,50 @@ void SurfaceFlinger::listLayers(std::string& result) const {
     }
 }
 
+void SurfaceFlinger::dumpBufferMemory(std::string& result) const {
+    struct ClientMemory {
+        size_t cachedBytes = 0;
+        size_t layerBytes = 0;
+        size_t bufferCount = 0;
+    };
+    std::map<std::pair<int /* uid */, int /* pid */>, ClientMemory> clients;
+
+    // A cached buffer that a layer holds as well is only counted for the cache.
+    std::unordered_set<uint64_t> cachedBufferIds;
+    for (const auto& buffer : ClientCache::getInstance().getCachedBuffers()) {
+        ClientMemory& client = clients[{buffer.uid, buffer.pid}];
+        client.cachedBytes += buffer.sizeInBytes;
+        client.bufferCount++;
+        cachedBufferIds.insert(buffer.bufferId);
+    }
+    std::unordered_set<uint64_t> layerBufferIds;
+    for (const auto& layer : mLayerLifecycleManager.getLayers()) {
+        if (!layer->externalTexture) continue;
+        const auto& buffer = layer->externalTexture->getBuffer();
+        if (cachedBufferIds.count(buffer->getId()) ||
+            !layerBufferIds.insert(buffer->getId()).second) {
+            continue;
+        }
+        ClientMemory& client = clients[{static_cast<int>(layer->ownerUid.val()),
+                                        static_cast<int>(layer->ownerPid.val())}];
+        client.layerBytes += ClientCache::bufferSizeInBytes(*buffer);
+        client.bufferCount++;
+    }
+
+    const size_t budget = ClientCache::getInstance().getClientMemoryBudget();
+    result.append("Graphic buffer memory held for clients:\n");
+    for (const auto& [owner, client] : clients) {
+        const size_t totalBytes = client.cachedBytes + client.layerBytes;
+        StringAppendF(&result,
+                      "  uid: %d, pid: %d, buffers: %zu, total: %zu KB (client cache: %zu KB, "
+                      "layers: %zu KB)%s\n",
+                      owner.first, owner.second, client.bufferCount, totalBytes / 1024,
+                      client.cachedBytes / 1024, client.layerBytes / 1024,
+                      budget != 0 && totalBytes > budget ? " over budget" : "");
+    }
+    result.append("\n");
+}
+
 void SurfaceFlinger::dumpStats(const DumpArgs& args, std::string& result) const {
     StringAppendF(&result, "%" PRId64 "\n", mScheduler->getPacesetterVsyncPeriod().ns());
     if (args.size() < 2) return;
@@ -5605,6 +5871,10 @@ void SurfaceFlinger::dumpTimeStats(const DumpArgs& args, bool asProto, std::stri
     mTimeStats->parseArgs(asProto, args, result);
 }
 
+void SurfaceFlinger::dumpLatencyHistograms(std::string& result) const {
+    mTimeStats->dumpStageLatencies(result);
+}
+
 void SurfaceFlinger::dumpFrameTimeline(const DumpArgs& args, std::string& result) const {
     mFrameTimeline->parseArgs(args, result);
 }
@@ -5772,6 +6042,23 @@ void SurfaceFlinger::dumpHdrInfo(std::string& result) const {
     }
 }
 
+void SurfaceFlinger::dumpBootTiming(std::string& result) const {
+    // The times are relative to the creation of SurfaceFlinger.
+    for (const auto& step : mInitSteps) {
+        StringAppendF(&result, "  %-22s: start=%.3fms duration=", step.name,
+                      static_cast<double>(step.start - mBootTime) / 1e6);
+        if (step.duration < 0) {
+            result.append("running\n");
+        } else {
+            StringAppendF(&result, "%.3fms\n", static_cast<double>(step.duration) / 1e6);
+        }
+    }
+    if (const nsecs_t bootFinishedTime = mBootFinishedTime; bootFinishedTime != 0) {
+        StringAppendF(&result, "  %-22s: %.3fms\n", "Boot finished",
+                      static_cast<double>(bootFinishedTime - mBootTime) / 1e6);
+    }
+}
+
 void SurfaceFlinger::dumpFrontEnd(std::string& result) {
     std::ostringstream out;
     out << "\nComposition list\n";
@@ -5798,6 +6085,9 @@ void SurfaceFlinger::dumpFrontEnd(std::string& result) {
         << mLayerHierarchyBuilder.getHierarchy().dump() << "\nOffscreen Hierarchy\n"
         << mLayerHierarchyBuilder.getOffscreenHierarchy().dump() << "\n\n";
     result.append(out.str());
+    mLayerSnapshotBuilder.dumpStats(result);
+    mTransactionHandler.dumpStats(result);
+    mTransactionChannelManager->dump(result);
 }
 
 void SurfaceFlinger::dumpVisibleFrontEnd(std::string& result) {
@@ -5957,12 +6247,24 @@ void SurfaceFlinger::dumpAll(const DumpArgs& args, const std::string& compositio
 
     dumpHdrInfo(result);
 
+    colorizer.bold(result);
+    result.append("Boot timing:\n");
+    colorizer.reset(result);
+    dumpBootTiming(result);
+    result.append("\n");
+
     colorizer.bold(result);
     result.append("Sync configuration: ");
     colorizer.reset(result);
     result.append(SyncFeatures::getInstance().toString());
     result.append("\n\n");
 
+    mScreenCaptureCoalescer.dump(result);
+    result.append("\n");
+
+    BackgroundExecutor::dumpAll(result);
+    result.append("\n");
+
     colorizer.bold(result);
     result.append("Scheduler:\n");
     colorizer.reset(result);
@@ -6988,6 +7290,28 @@ void SurfaceFlinger::captureDisplay(const DisplayCaptureArgs& args,
         }
     }
 
+    sp<IScreenCaptureListener> listener = captureListener;
+    if (mCoalesceScreenCaptures) {
+        ScreenCaptureCoalescer::Key key{
+                .displayToken = args.displayToken,
+                .sourceCrop = gui::aidl_utils::fromARect(captureArgs.sourceCrop),
+                .size = reqSize,
+                .dataspace = captureArgs.dataspace,
+                .pixelFormat = captureArgs.pixelFormat,
+                .uid = captureArgs.uid,
+                .captureSecureLayers = captureArgs.captureSecureLayers,
+                .allowProtected = captureArgs.allowProtected,
+                .grayscale = captureArgs.grayscale,
+                .attachGainmap = captureArgs.attachGainmap,
+                .hintForSeamlessTransition = captureArgs.hintForSeamlessTransition,
+                .excludeLayerIds = {excludeLayerIds.begin(), excludeLayerIds.end()},
+        };
+        listener = mScreenCaptureCoalescer.coalesce(std::move(key), captureListener);
+        if (!listener) {
+            return;
+        }
+    }
+
     GetLayerSnapshotsFunction getLayerSnapshotsFn =
             getLayerSnapshotsForScreenshots(layerStack, captureArgs.uid,
                                             std::move(excludeLayerIds));
@@ -7004,7 +7328,7 @@ void SurfaceFlinger::captureDisplay(const DisplayCaptureArgs& args,
                         getLayerSnapshotsFn, reqSize,
                         static_cast<ui::PixelFormat>(captureArgs.pixelFormat),
                         captureArgs.allowProtected, captureArgs.grayscale,
-                        captureArgs.attachGainmap, captureListener);
+                        captureArgs.attachGainmap, listener);
 }
 
 void SurfaceFlinger::captureDisplay(DisplayId displayId, const CaptureArgs& args,
@@ -7394,8 +7718,13 @@ ftl::SharedFuture<FenceResult> SurfaceFlinger::captureScreenshot(
                 getFactory().createGraphicBuffer(buffer->getWidth(), buffer->getHeight(),
                                                  HAL_PIXEL_FORMAT_RGBA_FP16, 1 /* layerCount */,
                                                  buffer->getUsage(), "screenshot-hdr");
+        // Gainmaps are smooth, so a downscaled gainmap loses little detail.
+        const auto gainmapSize = [&](uint32_t size) {
+            return (size + mScreenshotGainmapDownscale - 1) / mScreenshotGainmapDownscale;
+        };
         sp<GraphicBuffer> gainmapBuffer =
-                getFactory().createGraphicBuffer(buffer->getWidth(), buffer->getHeight(),
+                getFactory().createGraphicBuffer(gainmapSize(buffer->getWidth()),
+                                                 gainmapSize(buffer->getHeight()),
                                                  buffer->getPixelFormat(), 1 /* layerCount */,
                                                  buffer->getUsage(), "screenshot-gainmap");
 
@@ -7922,6 +8251,9 @@ void SurfaceFlinger::onLayerFirstRef(Layer* layer) {
 void SurfaceFlinger::onLayerDestroyed(Layer* layer) {
     mNumLayers--;
     mScheduler->deregisterLayer(layer);
+    if (mChangedAreaEstimator) {
+        mChangedAreaEstimator->removeLayer(layer->getSequence());
+    }
     if (mTransactionTracing) {
         mTransactionTracing->onLayerRemoved(layer->getSequence());
     }
@@ -8189,7 +8521,8 @@ void SurfaceFlinger::updateHdcpLevels(hal::HWDisplayId hwcDisplayId, int32_t con
 }
 
 std::shared_ptr<renderengine::ExternalTexture> SurfaceFlinger::getExternalTextureFromBufferData(
-        BufferData& bufferData, const char* layerName, uint64_t transactionId) {
+        BufferData& bufferData, const char* layerName, uint64_t transactionId, int originPid,
+        int originUid) {
     if (bufferData.buffer &&
         exceedsMaxRenderTargetSize(bufferData.buffer->getWidth(), bufferData.buffer->getHeight())) {
         std::string errorMessage =
@@ -8208,7 +8541,8 @@ std::shared_ptr<renderengine::ExternalTexture> SurfaceFlinger::getExternalTextur
     bool cachedBufferChanged =
             bufferData.flags.test(BufferData::BufferDataChange::cachedBufferChanged);
     if (cachedBufferChanged && bufferData.buffer) {
-        auto result = ClientCache::getInstance().add(bufferData.cachedBuffer, bufferData.buffer);
+        auto result = ClientCache::getInstance().add(bufferData.cachedBuffer, bufferData.buffer,
+                                                     originPid, originUid);
         if (result.ok()) {
             return result.value();
         }
@@ -9310,6 +9644,33 @@ binder::Status SurfaceComposerAIDL::getStalledTransactionInfo(
     return binderStatusFromStatusT(status);
 }
 
+binder::Status SurfaceComposerAIDL::setTransactionChannel(const os::ParcelFileDescriptor& channel,
+                                                          const sp<IBinder>& applyToken) {
+    if (!applyToken) {
+        return binder::Status::fromExceptionCode(binder::Status::EX_NULL_POINTER);
+    }
+    base::unique_fd channelFd(dup(channel.get()));
+    if (!channelFd.ok()) {
+        return binder::Status::fromExceptionCode(binder::Status::EX_ILLEGAL_ARGUMENT);
+    }
+
+    const int pid = IPCThreadState::self()->getCallingPid();
+    const int uid = IPCThreadState::self()->getCallingUid();
+    status_t status = mFlinger->setTransactionChannel(pid, uid, std::move(channelFd), applyToken);
+    return binderStatusFromStatusT(status);
+}
+
+binder::Status SurfaceComposerAIDL::registerTransactionChannelLayer(const sp<IBinder>& layerHandle,
+                                                                    int32_t* outLayerId) {
+    if (!layerHandle) {
+        return binder::Status::fromExceptionCode(binder::Status::EX_NULL_POINTER);
+    }
+
+    const int pid = IPCThreadState::self()->getCallingPid();
+    status_t status = mFlinger->registerTransactionChannelLayer(pid, layerHandle, outLayerId);
+    return binderStatusFromStatusT(status);
+}
+
 binder::Status SurfaceComposerAIDL::getSchedulingPolicy(gui::SchedulingPolicy* outPolicy) {
     return gui::getSchedulingPolicy(outPolicy);
 }
@@ -84,11 +84,13 @@
 #include "Scheduler/ISchedulerCallback.h"
 #include "Scheduler/RefreshRateSelector.h"
 #include "Scheduler/Scheduler.h"
+#include "ScreenCaptureCoalescer.h"
 #include "SurfaceFlingerFactory.h"
 #include "ThreadContext.h"
 #include "Tracing/LayerTracing.h"
 #include "Tracing/TransactionTracing.h"
 #include "TransactionCallbackInvoker.h"
+#include "TransactionChannelManager.h"
 #include "TransactionState.h"
 #include "Utils/OnceFuture.h"
 
@@ -125,6 +127,7 @@ class TunnelModeEnabledReporter;
 class HdrLayerInfoReporter;
 class HWComposer;
 class IGraphicBufferProducer;
+class ChangedAreaEstimator;
 class Layer;
 class MessageBase;
 class RefreshRateOverlay;
@@ -331,6 +334,27 @@ public:
     // TODO(b/246793311): Clean up a temporary property
     bool mIgnoreHwcPhysicalDisplayOrientation = false;
 
+    // If set, LayerSnapshotBuilder updates independent root subtrees on a worker pool. This can
+    // be set by debug.sf.parallel_snapshot_traversal
+    bool mParallelSnapshotTraversal = false;
+
+    // If set, independent outputs run Output::present at the same time. This can be set by
+    // debug.sf.concurrent_output_present
+    bool mConcurrentOutputPresent = false;
+
+    // If set, equivalent display captures of the same frame share a single render. This can be
+    // set by debug.sf.coalesce_screen_captures
+    bool mCoalesceScreenCaptures = false;
+
+    // If set, buffers that are released outside of a completed transaction are sent to the client
+    // with the transaction callbacks of the same frame. This can be set by
+    // debug.sf.batch_release_callbacks
+    bool mBatchReleaseCallbacks = false;
+
+    // The factor that the gainmaps of HDR screenshots are downscaled by in each dimension. This can
+    // be set by debug.sf.screenshot_gainmap_downscale
+    uint32_t mScreenshotGainmapDownscale = 1;
+
     void forceFutureUpdate(int delayInMs);
     const DisplayDevice* getDisplayFromLayerStack(ui::LayerStack)
             REQUIRES(mStateLock, kMainThreadContext);
@@ -351,7 +375,8 @@ protected:
             REQUIRES(mStateLock);
 
     virtual std::shared_ptr<renderengine::ExternalTexture> getExternalTextureFromBufferData(
-            BufferData& bufferData, const char* layerName, uint64_t transactionId);
+            BufferData& bufferData, const char* layerName, uint64_t transactionId,
+            int originPid, int originUid);
 
     // Returns true if any display matches a `bool(const DisplayDevice&)` predicate.
     template <typename Predicate>
@@ -554,6 +579,10 @@ private:
             bool isAutoTimestamp, const std::vector<client_cache_t>& uncacheBuffers,
             bool hasListenerCallbacks, const std::vector<ListenerCallbacks>& listenerCallbacks,
             uint64_t transactionId, const std::vector<uint64_t>& mergedTransactionIds) override;
+    status_t setTransactionChannel(int pid, int uid, base::unique_fd channelFd,
+                                   const sp<IBinder>& applyToken);
+    status_t registerTransactionChannelLayer(int pid, const sp<IBinder>& layerHandle,
+                                             int32_t* outLayerId);
     void bootFinished();
     status_t getSupportedFrameTimestamps(std::vector<FrameEvent>* outSupported) const;
     sp<IDisplayEventConnection> createDisplayEventConnection(
@@ -773,6 +802,8 @@ private:
     /*
      * Transactions
      */
+    // Queues a transaction read from a TransactionChannel.
+    void queueChannelTransaction(TransactionChannelManager::ChannelTransaction&& transaction);
     bool applyTransactionState(const FrameTimelineInfo& info,
                                std::vector<ResolvedComposerState>& state,
                                Vector<DisplayState>& displays, uint32_t flags,
@@ -1102,10 +1133,14 @@ private:
 
     void appendSfConfigString(std::string& result) const;
     void listLayers(std::string& result) const REQUIRES(kMainThreadContext);
+    // Dumps the memory of the buffers that SurfaceFlinger holds for each client, in the client
+    // cache and in the layers.
+    void dumpBufferMemory(std::string& result) const REQUIRES(kMainThreadContext);
     void dumpStats(const DumpArgs& args, std::string& result) const
             REQUIRES(mStateLock, kMainThreadContext);
     void clearStats(const DumpArgs& args, std::string& result) REQUIRES(kMainThreadContext);
     void dumpTimeStats(const DumpArgs& args, bool asProto, std::string& result) const;
+    void dumpLatencyHistograms(std::string& result) const;
     void dumpFrameTimeline(const DumpArgs& args, std::string& result) const;
     void logFrameStats(TimePoint now) REQUIRES(kMainThreadContext);
 
@@ -1119,6 +1154,7 @@ private:
     void dumpRawDisplayIdentificationData(const DumpArgs&, std::string& result) const;
     void dumpWideColorInfo(std::string& result) const REQUIRES(mStateLock);
     void dumpHdrInfo(std::string& result) const REQUIRES(mStateLock);
+    void dumpBootTiming(std::string& result) const REQUIRES(mStateLock);
     void dumpFrontEnd(std::string& result) REQUIRES(kMainThreadContext);
     void dumpVisibleFrontEnd(std::string& result) REQUIRES(mStateLock, kMainThreadContext);
 
@@ -1174,6 +1210,10 @@ private:
     void initBootProperties();
     void initTransactionTraceWriter();
 
+    // Ends the running step of init(), if any, and starts the next one unless |name| is null.
+    // Each step is a slice in the trace and a line of the boot timing in dumpsys.
+    void startInitStep(const char* name) REQUIRES(mStateLock);
+
     surfaceflinger::Factory& mFactory;
     pid_t mPid;
 
@@ -1182,6 +1222,14 @@ private:
 
     utils::OnceFuture mRenderEnginePrimeCacheFuture;
 
+    struct InitStep {
+        const char* name;
+        nsecs_t start;
+        nsecs_t duration = -1; // Running
+    };
+    std::vector<InitStep> mInitSteps GUARDED_BY(mStateLock);
+    std::atomic<nsecs_t> mBootFinishedTime = 0;
+
     // mStateLock has conventions related to the current thread, because only
     // the main thread should modify variables protected by mStateLock.
     // - read access from a non-main thread must lock mStateLock, since the main
@@ -1358,6 +1406,12 @@ private:
 
     bool mLumaSampling = true;
     sp<RegionSamplingThread> mRegionSamplingThread;
+    // The longest side of the samples that the changed area of full damage buffers is estimated
+    // from for small area detection, or 0 to trust the damage that clients report.
+    // This can be set by debug.sf.small_area_estimation_sample_size
+    int32_t mSmallAreaEstimationSampleSize = 0;
+    std::unique_ptr<ChangedAreaEstimator> mChangedAreaEstimator;
+    ScreenCaptureCoalescer mScreenCaptureCoalescer;
     sp<FpsReporter> mFpsReporter;
     sp<TunnelModeEnabledReporter> mTunnelModeEnabledReporter;
     ui::DisplayPrimaries mInternalDisplayPrimaries;
@@ -1409,6 +1463,7 @@ private:
             bool childrenOnly, const std::optional<FloatRect>& optionalParentCrop);
 
     const sp<WindowInfosListenerInvoker> mWindowInfosListenerInvoker;
+    const sp<TransactionChannelManager> mTransactionChannelManager;
 
     bool mAllowHwcForVDS = false;
     bool mAllowHwcForWFD = false;
@@ -1608,6 +1663,10 @@ public:
             const sp<gui::IWindowInfosListener>& windowInfosListener) override;
     binder::Status getStalledTransactionInfo(
             int pid, std::optional<gui::StalledTransactionInfo>* outInfo) override;
+    binder::Status setTransactionChannel(const os::ParcelFileDescriptor& channel,
+                                         const sp<IBinder>& applyToken) override;
+    binder::Status registerTransactionChannelLayer(const sp<IBinder>& layerHandle,
+                                                   int32_t* outLayerId) override;
     binder::Status getSchedulingPolicy(gui::SchedulingPolicy* outPolicy) override;
     binder::Status notifyShutdown() override;
     binder::Status addJankListener(const sp<IBinder>& layer,
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <utils/Timers.h>
+
+namespace android {
+
+// A fixed size histogram of durations that any thread can record to without taking a lock.
+//
+// Durations from 1us to about 1s fall into one of kSubBuckets logarithmically spaced buckets per
+// power of two, so percentiles are accurate to within 1/kSubBuckets of the actual value. Shorter
+// and longer durations are counted in an underflow and an overflow bucket.
+//
+// Reads are not synchronized with concurrent records, so a snapshot may miss a few of the
+// durations that are being recorded while it is taken.
+class LatencyHistogram {
+public:
+    struct Summary {
+        uint64_t count = 0;
+        nsecs_t p50 = 0;
+        nsecs_t p90 = 0;
+        nsecs_t p99 = 0;
+        nsecs_t max = 0;
+        // The sum of all recorded durations, for reporting a mean.
+        nsecs_t total = 0;
+    };
+
+    void record(nsecs_t duration) {
+        duration = std::max(duration, nsecs_t{0});
+        mCounts[bucketIndex(duration)].fetch_add(1, std::memory_order_relaxed);
+        mTotal.fetch_add(duration, std::memory_order_relaxed);
+
+        nsecs_t max = mMax.load(std::memory_order_relaxed);
+        while (duration > max &&
+               !mMax.compare_exchange_weak(max, duration, std::memory_order_relaxed)) {
+        }
+    }
+
+    Summary summarize() const {
+        std::array<uint64_t, kNumBuckets> counts;
+        Summary summary;
+        for (size_t i = 0; i < kNumBuckets; i++) {
+            counts[i] = mCounts[i].load(std::memory_order_relaxed);
+            summary.count += counts[i];
+        }
+        summary.max = mMax.load(std::memory_order_relaxed);
+        summary.total = mTotal.load(std::memory_order_relaxed);
+        if (summary.count == 0) {
+            return summary;
+        }
+
+        summary.p50 = percentile(counts, summary.count, summary.max, 0.5);
+        summary.p90 = percentile(counts, summary.count, summary.max, 0.9);
+        summary.p99 = percentile(counts, summary.count, summary.max, 0.99);
+        return summary;
+    }
+
+    void clear() {
+        for (auto& count : mCounts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        mMax.store(0, std::memory_order_relaxed);
+        mTotal.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int kSubBucketBits = 2;
+    static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+    // The first power of two that is bucketed, 1024ns.
+    static constexpr int kMinExponent = 10;
+    // The last power of two that is bucketed, durations from 2^30ns (about 1.07s) overflow.
+    static constexpr int kMaxExponent = 29;
+    static constexpr size_t kNumBuckets = (kMaxExponent - kMinExponent + 1) * kSubBuckets + 2;
+
+    static int msb(nsecs_t duration) {
+        return 63 - __builtin_clzll(static_cast<uint64_t>(duration));
+    }
+
+    static size_t bucketIndex(nsecs_t duration) {
+        if (duration < (nsecs_t{1} << kMinExponent)) {
+            return 0;
+        }
+        const int exponent = msb(duration);
+        if (exponent > kMaxExponent) {
+            return kNumBuckets - 1;
+        }
+        const size_t subBucket = static_cast<size_t>(duration >> (exponent - kSubBucketBits)) &
+                (kSubBuckets - 1);
+        return 1 + static_cast<size_t>(exponent - kMinExponent) * kSubBuckets + subBucket;
+    }
+
+    // The smallest duration that falls into the bucket after index.
+    static nsecs_t bucketEnd(size_t index) {
+        if (index == 0) {
+            return nsecs_t{1} << kMinExponent;
+        }
+        const size_t exponent = (index - 1) / kSubBuckets + kMinExponent;
+        const size_t subBucket = (index - 1) % kSubBuckets + 1;
+        return static_cast<nsecs_t>(kSubBuckets + subBucket) << (exponent - kSubBucketBits);
+    }
+
+    // Reports the end of the bucket the percentile falls into, but never more than the longest
+    // duration recorded.
+    static nsecs_t percentile(const std::array<uint64_t, kNumBuckets>& counts, uint64_t total,
+                              nsecs_t max, double fraction) {
+        const auto rank = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(total)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kNumBuckets - 1; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(bucketEnd(i), max);
+            }
+        }
+        return max;
+    }
+
+    std::array<std::atomic<uint64_t>, kNumBuckets> mCounts{};
+    std::atomic<nsecs_t> mMax = 0;
+    std::atomic<nsecs_t> mTotal = 0;
+};
+
+} // namespace android
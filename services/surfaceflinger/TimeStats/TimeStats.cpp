@@ -89,10 +89,33 @@ SurfaceflingerStatsLayerInfo_SetFrameRateVote frameRateVoteToProto(
     proto.set_seamlessness(static_cast<SeamlessnessEnum>(setFrameRateVote.seamlessness));
     return proto;
 }
+
+const char* toString(TimeStats::LatencyStage stage) {
+    using LatencyStage = TimeStats::LatencyStage;
+    switch (stage) {
+        case LatencyStage::TransactionFlush:
+            return "TransactionFlush";
+        case LatencyStage::UpdateLayerSnapshots:
+            return "UpdateLayerSnapshots";
+        case LatencyStage::CommitTransactions:
+            return "CommitTransactions";
+        case LatencyStage::UpdateInputFlinger:
+            return "UpdateInputFlinger";
+        case LatencyStage::CompositionEnginePresent:
+            return "CompositionEnginePresent";
+        case LatencyStage::HwcValidate:
+            return "HwcValidate";
+        case LatencyStage::HwcPresent:
+            return "HwcPresent";
+        case LatencyStage::RenderEngine:
+            return "RenderEngine";
+    }
+}
 } // namespace
 
 bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
     std::lock_guard<std::mutex> lock(mMutex);
+    mergePendingStatsLocked();
 
     if (mTimeStats.statsStartLegacy == 0) {
         return false;
@@ -146,6 +169,7 @@ bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
 
 bool TimeStats::populateLayerAtom(std::vector<uint8_t>* pulledData) {
     std::lock_guard<std::mutex> lock(mMutex);
+    mergePendingStatsLocked();
 
     std::vector<TimeStatsHelper::TimeStatsLayer*> dumpStats;
     uint32_t numLayers = 0;
@@ -242,6 +266,29 @@ bool TimeStats::populateLayerAtom(std::vector<uint8_t>* pulledData) {
     return atomList.SerializeToArray(pulledData->data(), atomList.ByteSizeLong());
 }
 
+bool TimeStats::populateStageLatencyAtom(std::vector<uint8_t>* pulledData) {
+    SurfaceflingerStageLatencyWrapper atomList;
+    for (size_t i = 0; i < mStageLatencies.size(); i++) {
+        const LatencyHistogram::Summary summary = mStageLatencies[i].summarize();
+        // Like the other atoms, only report what happened since the previous pull.
+        mStageLatencies[i].clear();
+        if (summary.count == 0) {
+            continue;
+        }
+
+        SurfaceflingerStageLatency* atom = atomList.add_atom();
+        atom->set_stage(static_cast<SurfaceflingerStageLatency::Stage>(i + 1));
+        atom->set_count(static_cast<int64_t>(summary.count));
+        atom->set_p50_micros(ns2us(summary.p50));
+        atom->set_p90_micros(ns2us(summary.p90));
+        atom->set_p99_micros(ns2us(summary.p99));
+        atom->set_max_micros(ns2us(summary.max));
+    }
+
+    pulledData->resize(atomList.ByteSizeLong());
+    return atomList.SerializeToArray(pulledData->data(), atomList.ByteSizeLong());
+}
+
 TimeStats::TimeStats() : TimeStats(std::nullopt, std::nullopt) {}
 
 TimeStats::TimeStats(std::optional<size_t> maxPulledLayers,
@@ -261,6 +308,8 @@ bool TimeStats::onPullAtom(const int atomId, std::vector<uint8_t>* pulledData) {
         success = populateGlobalAtom(pulledData);
     } else if (atomId == 10063) { // SURFACEFLINGER_STATS_LAYER_INFO
         success = populateLayerAtom(pulledData);
+    } else if (atomId == 10224) { // SURFACEFLINGER_STAGE_LATENCY
+        success = populateStageLatencyAtom(pulledData);
     }
 
     // Enable timestats now. The first full pull for a given build is expected to
@@ -309,7 +358,7 @@ std::string TimeStats::miniDump() {
     std::string result = "TimeStats miniDump:\n";
     std::lock_guard<std::mutex> lock(mMutex);
     android::base::StringAppendF(&result, "Number of layers currently being tracked is %zu\n",
-                                 mTimeStatsTracker.size());
+                                 mNumLayerRecords.load());
     android::base::StringAppendF(&result, "Number of layers in the stats pool is %zu\n",
                                  mTimeStats.stats.size());
     return result;
@@ -401,6 +450,29 @@ void TimeStats::recordRenderEngineDuration(nsecs_t startTime,
     mGlobalRecord.renderEngineDurations.push_back({startTime, endTime});
 }
 
+void TimeStats::recordStageLatency(LatencyStage stage, nsecs_t duration) {
+    mStageLatencies[static_cast<size_t>(stage)].record(duration);
+}
+
+LatencyHistogram::Summary TimeStats::getStageLatency(LatencyStage stage) const {
+    return mStageLatencies[static_cast<size_t>(stage)].summarize();
+}
+
+void TimeStats::dumpStageLatencies(std::string& result) const {
+    result.append("Stage latencies since the last statsd pull, in microseconds:\n");
+    android::base::StringAppendF(&result, "  %-26s %10s %10s %10s %10s %10s\n", "stage", "count",
+                                 "p50", "p90", "p99", "max");
+    for (size_t i = 0; i < mStageLatencies.size(); i++) {
+        const LatencyHistogram::Summary summary = mStageLatencies[i].summarize();
+        android::base::StringAppendF(&result,
+                                     "  %-26s %10" PRIu64 " %10" PRId64 " %10" PRId64
+                                     " %10" PRId64 " %10" PRId64 "\n",
+                                     toString(static_cast<LatencyStage>(i)), summary.count,
+                                     ns2us(summary.p50), ns2us(summary.p90), ns2us(summary.p99),
+                                     ns2us(summary.max));
+    }
+}
+
 bool TimeStats::recordReadyLocked(int32_t layerId, TimeRecord* timeRecord) {
     if (!timeRecord->ready) {
         ALOGV("[%d]-[%" PRIu64 "]-presentFence is still not received", layerId,
@@ -441,14 +513,18 @@ static int32_t clampToNearestBucket(Fps fps, size_t bucketWidth) {
     return std::round(fps.getValue() / bucketWidth) * bucketWidth;
 }
 
-void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayRefreshRate,
+TimeStats::LayerShard& TimeStats::getLayerShard(int32_t layerId) {
+    return mLayerShards[static_cast<uint32_t>(layerId) % kNumLayerShards];
+}
+
+bool TimeStats::flushAvailableRecordsToShardLocked(int32_t layerId, LayerRecord& layerRecord,
+                                                   LayerShard& shard, Fps displayRefreshRate,
                                                    std::optional<Fps> renderRate,
                                                    SetFrameRateVote frameRateVote,
                                                    GameMode gameMode) {
     SFTRACE_CALL();
-    ALOGV("[%d]-flushAvailableRecordsToStatsLocked", layerId);
+    ALOGV("[%d]-flushAvailableRecordsToShardLocked", layerId);
 
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     TimeRecord& prevTimeRecord = layerRecord.prevTimeRecord;
     std::optional<int32_t>& prevPresentToPresentMs = layerRecord.prevPresentToPresentMs;
     std::deque<TimeRecord>& timeRecords = layerRecord.timeRecords;
@@ -463,82 +539,116 @@ void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayR
               timeRecords[0].frameTime.frameNumber, timeRecords[0].frameTime.presentTime);
 
         if (prevTimeRecord.ready) {
-            uid_t uid = layerRecord.uid;
-            const std::string& layerName = layerRecord.layerName;
-            TimeStatsHelper::TimelineStatsKey timelineKey = {refreshRateBucket, renderRateBucket};
-            if (!mTimeStats.stats.count(timelineKey)) {
-                mTimeStats.stats[timelineKey].key = timelineKey;
-            }
-
-            TimeStatsHelper::TimelineStats& displayStats = mTimeStats.stats[timelineKey];
-
-            TimeStatsHelper::LayerStatsKey layerKey = {uid, layerName, gameMode};
-            if (!displayStats.stats.count(layerKey)) {
-                displayStats.stats[layerKey].displayRefreshRateBucket = refreshRateBucket;
-                displayStats.stats[layerKey].renderRateBucket = renderRateBucket;
-                displayStats.stats[layerKey].uid = uid;
-                displayStats.stats[layerKey].layerName = layerName;
-                displayStats.stats[layerKey].gameMode = gameMode;
-            }
-            if (frameRateVote.frameRate > 0.0f) {
-                displayStats.stats[layerKey].setFrameRateVote = frameRateVote;
+            const FrameTime& frameTime = timeRecords[0].frameTime;
+            LayerFrameSample sample = {
+                    .timelineKey = {refreshRateBucket, renderRateBucket},
+                    .layerKey = {layerRecord.uid, layerRecord.layerName, gameMode},
+                    .frameRateVote = frameRateVote,
+                    .droppedFrames = layerRecord.droppedFrames,
+                    .lateAcquireFrames = layerRecord.lateAcquireFrames,
+                    .badDesiredPresentFrames = layerRecord.badDesiredPresentFrames,
+                    .postToAcquireMs = msBetween(frameTime.postTime, frameTime.acquireTime),
+                    .postToPresentMs = msBetween(frameTime.postTime, frameTime.presentTime),
+                    .acquireToPresentMs = msBetween(frameTime.acquireTime, frameTime.presentTime),
+                    .latchToPresentMs = msBetween(frameTime.latchTime, frameTime.presentTime),
+                    .desiredToPresentMs = msBetween(frameTime.desiredTime, frameTime.presentTime),
+                    .presentToPresentMs =
+                            msBetween(prevTimeRecord.frameTime.presentTime, frameTime.presentTime),
+            };
+            ALOGV("[%d]-[%" PRIu64 "]-post2acquire[%d]-post2present[%d]-acquire2present[%d]"
+                  "-latch2present[%d]-desired2present[%d]-present2present[%d]",
+                  layerId, frameTime.frameNumber, sample.postToAcquireMs, sample.postToPresentMs,
+                  sample.acquireToPresentMs, sample.latchToPresentMs, sample.desiredToPresentMs,
+                  sample.presentToPresentMs);
+            if (prevPresentToPresentMs) {
+                sample.presentToPresentDeltaMs =
+                        std::abs(sample.presentToPresentMs - *prevPresentToPresentMs);
             }
-            TimeStatsHelper::TimeStatsLayer& timeStatsLayer = displayStats.stats[layerKey];
-            timeStatsLayer.totalFrames++;
-            timeStatsLayer.droppedFrames += layerRecord.droppedFrames;
-            timeStatsLayer.lateAcquireFrames += layerRecord.lateAcquireFrames;
-            timeStatsLayer.badDesiredPresentFrames += layerRecord.badDesiredPresentFrames;
+            prevPresentToPresentMs = sample.presentToPresentMs;
 
             layerRecord.droppedFrames = 0;
             layerRecord.lateAcquireFrames = 0;
             layerRecord.badDesiredPresentFrames = 0;
-
-            const int32_t postToAcquireMs = msBetween(timeRecords[0].frameTime.postTime,
-                                                      timeRecords[0].frameTime.acquireTime);
-            ALOGV("[%d]-[%" PRIu64 "]-post2acquire[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, postToAcquireMs);
-            timeStatsLayer.deltas["post2acquire"].insert(postToAcquireMs);
-
-            const int32_t postToPresentMs = msBetween(timeRecords[0].frameTime.postTime,
-                                                      timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-post2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, postToPresentMs);
-            timeStatsLayer.deltas["post2present"].insert(postToPresentMs);
-
-            const int32_t acquireToPresentMs = msBetween(timeRecords[0].frameTime.acquireTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-acquire2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, acquireToPresentMs);
-            timeStatsLayer.deltas["acquire2present"].insert(acquireToPresentMs);
-
-            const int32_t latchToPresentMs = msBetween(timeRecords[0].frameTime.latchTime,
-                                                       timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-latch2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, latchToPresentMs);
-            timeStatsLayer.deltas["latch2present"].insert(latchToPresentMs);
-
-            const int32_t desiredToPresentMs = msBetween(timeRecords[0].frameTime.desiredTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-desired2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, desiredToPresentMs);
-            timeStatsLayer.deltas["desired2present"].insert(desiredToPresentMs);
-
-            const int32_t presentToPresentMs = msBetween(prevTimeRecord.frameTime.presentTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-present2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, presentToPresentMs);
-            timeStatsLayer.deltas["present2present"].insert(presentToPresentMs);
-            if (prevPresentToPresentMs) {
-                const int32_t presentToPresentDeltaMs =
-                        std::abs(presentToPresentMs - *prevPresentToPresentMs);
-                timeStatsLayer.deltas["present2presentDelta"].insert(presentToPresentDeltaMs);
-            }
-            prevPresentToPresentMs = presentToPresentMs;
+            shard.pendingSamples.push_back(std::move(sample));
         }
         prevTimeRecord = timeRecords[0];
         timeRecords.pop_front();
         layerRecord.waitData--;
     }
+    return shard.pendingSamples.size() >= MAX_NUM_PENDING_SAMPLES;
+}
+
+void TimeStats::mergePendingStats() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mergePendingStatsLocked();
+}
+
+void TimeStats::mergePendingStatsLocked() {
+    SFTRACE_CALL();
+
+    // Layer samples go first, so that janky frames are attributed to the layers that presented
+    // in the same interval.
+    std::vector<LayerFrameSample> samples;
+    for (LayerShard& shard : mLayerShards) {
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            samples.swap(shard.pendingSamples);
+        }
+        for (const LayerFrameSample& sample : samples) {
+            mergeLayerFrameSampleLocked(sample);
+        }
+        samples.clear();
+    }
+
+    std::vector<JankyFramesInfo> jankyFrames;
+    {
+        std::lock_guard<std::mutex> lock(mPendingJankyFramesMutex);
+        jankyFrames.swap(mPendingJankyFrames);
+    }
+    for (const JankyFramesInfo& info : jankyFrames) {
+        mergeJankyFramesLocked(info);
+    }
+}
+
+void TimeStats::mergeLayerFrameSampleLocked(const LayerFrameSample& sample) {
+    const TimeStatsHelper::LayerStatsKey& layerKey = sample.layerKey;
+    if (!canAddNewAggregatedStats(layerKey.uid, layerKey.layerName, layerKey.gameMode)) {
+        return;
+    }
+
+    const TimeStatsHelper::TimelineStatsKey& timelineKey = sample.timelineKey;
+    if (!mTimeStats.stats.count(timelineKey)) {
+        mTimeStats.stats[timelineKey].key = timelineKey;
+    }
+
+    TimeStatsHelper::TimelineStats& displayStats = mTimeStats.stats[timelineKey];
+
+    if (!displayStats.stats.count(layerKey)) {
+        displayStats.stats[layerKey].displayRefreshRateBucket =
+                timelineKey.displayRefreshRateBucket;
+        displayStats.stats[layerKey].renderRateBucket = timelineKey.renderRateBucket;
+        displayStats.stats[layerKey].uid = layerKey.uid;
+        displayStats.stats[layerKey].layerName = layerKey.layerName;
+        displayStats.stats[layerKey].gameMode = layerKey.gameMode;
+    }
+    if (sample.frameRateVote.frameRate > 0.0f) {
+        displayStats.stats[layerKey].setFrameRateVote = sample.frameRateVote;
+    }
+    TimeStatsHelper::TimeStatsLayer& timeStatsLayer = displayStats.stats[layerKey];
+    timeStatsLayer.totalFrames++;
+    timeStatsLayer.droppedFrames += sample.droppedFrames;
+    timeStatsLayer.lateAcquireFrames += sample.lateAcquireFrames;
+    timeStatsLayer.badDesiredPresentFrames += sample.badDesiredPresentFrames;
+
+    timeStatsLayer.deltas["post2acquire"].insert(sample.postToAcquireMs);
+    timeStatsLayer.deltas["post2present"].insert(sample.postToPresentMs);
+    timeStatsLayer.deltas["acquire2present"].insert(sample.acquireToPresentMs);
+    timeStatsLayer.deltas["latch2present"].insert(sample.latchToPresentMs);
+    timeStatsLayer.deltas["desired2present"].insert(sample.desiredToPresentMs);
+    timeStatsLayer.deltas["present2present"].insert(sample.presentToPresentMs);
+    if (sample.presentToPresentDeltaMs) {
+        timeStatsLayer.deltas["present2presentDelta"].insert(*sample.presentToPresentDeltaMs);
+    }
 }
 
 static constexpr const char* kPopupWindowPrefix = "PopupWindow";
@@ -572,22 +682,25 @@ void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::st
     ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerId, frameNumber, layerName.c_str(),
           postTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!canAddNewAggregatedStats(uid, layerName, gameMode)) {
-        return;
-    }
-    if (!mTimeStatsTracker.count(layerId) && mTimeStatsTracker.size() < MAX_NUM_LAYER_RECORDS &&
-        layerNameIsValid(layerName)) {
-        mTimeStatsTracker[layerId].uid = uid;
-        mTimeStatsTracker[layerId].layerName = layerName;
-        mTimeStatsTracker[layerId].gameMode = gameMode;
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) {
+        if (mNumLayerRecords.load() >= MAX_NUM_LAYER_RECORDS || !layerNameIsValid(layerName)) {
+            return;
+        }
+        it = shard.records.try_emplace(layerId).first;
+        mNumLayerRecords++;
+        it->second.uid = uid;
+        it->second.layerName = layerName;
+        it->second.gameMode = gameMode;
     }
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.timeRecords.size() == MAX_NUM_TIME_RECORDS) {
         ALOGE("[%d]-[%s]-timeRecords is at its maximum size[%zu]. Ignore this when unittesting.",
               layerId, layerRecord.layerName.c_str(), MAX_NUM_TIME_RECORDS);
-        mTimeStatsTracker.erase(layerId);
+        shard.records.erase(it);
+        mNumLayerRecords--;
         return;
     }
     // For most media content, the acquireFence is invalid because the buffer is
@@ -615,9 +728,11 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
     SFTRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerId, frameNumber, latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -634,9 +749,11 @@ void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
     ALOGV("[%d]-LatchSkipped-Reason[%d]", layerId,
           static_cast<std::underlying_type<LatchSkipReason>::type>(reason));
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
 
     switch (reason) {
         case LatchSkipReason::LateAcquire:
@@ -651,10 +768,11 @@ void TimeStats::incrementBadDesiredPresent(int32_t layerId) {
     SFTRACE_CALL();
     ALOGV("[%d]-BadDesiredPresent", layerId);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    layerRecord.badDesiredPresentFrames++;
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    it->second.badDesiredPresentFrames++;
 }
 
 void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t desiredTime) {
@@ -663,9 +781,11 @@ void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t de
     SFTRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerId, frameNumber, desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -681,9 +801,11 @@ void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t ac
     SFTRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerId, frameNumber, acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -701,9 +823,11 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerId, frameNumber,
           acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -721,21 +845,30 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
     SFTRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerId, frameNumber, presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.presentTime = presentTime;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
-    }
+    bool shouldMerge = false;
+    {
+        LayerShard& shard = getLayerShard(layerId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.records.find(layerId);
+        if (it == shard.records.end()) return;
+        LayerRecord& layerRecord = it->second;
+        if (layerRecord.waitData < 0 ||
+            layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
+            return;
+        TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+        if (timeRecord.frameTime.frameNumber == frameNumber) {
+            timeRecord.frameTime.presentTime = presentTime;
+            timeRecord.ready = true;
+            layerRecord.waitData++;
+        }
 
-    flushAvailableRecordsToStatsLocked(layerId, displayRefreshRate, renderRate, frameRateVote,
-                                       gameMode);
+        shouldMerge =
+                flushAvailableRecordsToShardLocked(layerId, layerRecord, shard, displayRefreshRate,
+                                                   renderRate, frameRateVote, gameMode);
+    }
+    if (shouldMerge) {
+        mergePendingStats();
+    }
 }
 
 void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
@@ -748,21 +881,30 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerId, frameNumber,
           presentFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.presentFence = presentFence;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
-    }
+    bool shouldMerge = false;
+    {
+        LayerShard& shard = getLayerShard(layerId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.records.find(layerId);
+        if (it == shard.records.end()) return;
+        LayerRecord& layerRecord = it->second;
+        if (layerRecord.waitData < 0 ||
+            layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
+            return;
+        TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+        if (timeRecord.frameTime.frameNumber == frameNumber) {
+            timeRecord.presentFence = presentFence;
+            timeRecord.ready = true;
+            layerRecord.waitData++;
+        }
 
-    flushAvailableRecordsToStatsLocked(layerId, displayRefreshRate, renderRate, frameRateVote,
-                                       gameMode);
+        shouldMerge =
+                flushAvailableRecordsToShardLocked(layerId, layerRecord, shard, displayRefreshRate,
+                                                   renderRate, frameRateVote, gameMode);
+    }
+    if (shouldMerge) {
+        mergePendingStats();
+    }
 }
 
 static const constexpr int32_t kValidJankyReason = JankType::DisplayHAL |
@@ -806,8 +948,18 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
     if (!mEnabled.load()) return;
 
     SFTRACE_CALL();
-    std::lock_guard<std::mutex> lock(mMutex);
+    bool shouldMerge = false;
+    {
+        std::lock_guard<std::mutex> lock(mPendingJankyFramesMutex);
+        mPendingJankyFrames.push_back(info);
+        shouldMerge = mPendingJankyFrames.size() >= MAX_NUM_PENDING_SAMPLES;
+    }
+    if (shouldMerge) {
+        mergePendingStats();
+    }
+}
 
+void TimeStats::mergeJankyFramesLocked(const JankyFramesInfo& info) {
     // Only update layer stats if we're already tracking the layer in TimeStats.
     // Otherwise, continue tracking the statistic but use a default layer name instead.
     // As an implementation detail, we do this because this method is expected to be
@@ -815,9 +967,9 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
     // that occurs without a buffer. But, in general those layer names are not suitable as
     // aggregation keys: e.g., it's normal and expected for Window Manager to include the hash code
     // for an animation leash. So while we can show that jank in dumpsys, aggregating based on the
-    // layer blows up the stats size, so as a workaround drop those stats. This assumes that
-    // TimeStats will flush the first present fence for a layer *before* FrameTimeline does so that
-    // the first jank record is not dropped.
+    // layer blows up the stats size, so as a workaround drop those stats. The layer samples that
+    // are pending are merged before the janky frames, so that the first jank record of a layer is
+    // not dropped.
 
     static const std::string kDefaultLayerName = "none";
     constexpr GameMode kDefaultGameMode = GameMode::Unsupported;
@@ -863,8 +1015,9 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
 void TimeStats::onDestroy(int32_t layerId) {
     SFTRACE_CALL();
     ALOGV("[%d]-onDestroy", layerId);
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStatsTracker.erase(layerId);
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    mNumLayerRecords -= shard.records.erase(layerId);
 }
 
 void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
@@ -873,9 +1026,11 @@ void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
     SFTRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerId, frameNumber);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     size_t removeAt = 0;
     for (const TimeRecord& record : layerRecord.timeRecords) {
         if (record.frameTime.frameNumber == frameNumber) break;
@@ -1080,7 +1235,16 @@ void TimeStats::clearGlobalLocked() {
 void TimeStats::clearLayersLocked() {
     SFTRACE_CALL();
 
-    mTimeStatsTracker.clear();
+    for (LayerShard& shard : mLayerShards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        mNumLayerRecords -= shard.records.size();
+        shard.records.clear();
+        shard.pendingSamples.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mPendingJankyFramesMutex);
+        mPendingJankyFrames.clear();
+    }
 
     for (auto& globalRecord : mTimeStats.stats) {
         globalRecord.second.stats.clear();
@@ -1100,6 +1264,7 @@ void TimeStats::dump(bool asProto, std::optional<uint32_t> maxLayers, std::strin
         return;
     }
 
+    mergePendingStatsLocked();
     mTimeStats.statsEndLegacy = static_cast<int64_t>(std::time(0));
 
     flushPowerTimeLocked();
@@ -16,12 +16,15 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <deque>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include <android/hardware/graphics/composer/2.4/IComposerClient.h>
 #include <gui/JankInfo.h>
@@ -34,6 +37,8 @@
 
 #include <scheduler/Fps.h>
 
+#include "LatencyHistogram.h"
+
 using android::gui::GameMode;
 using android::gui::LayerMetadata;
 using namespace android::surfaceflinger;
@@ -72,6 +77,25 @@ public:
     virtual void recordRenderEngineDuration(nsecs_t startTime,
                                             const std::shared_ptr<FenceTime>& readyFence) = 0;
 
+    // Stages of committing and compositing a frame whose latency distributions are tracked.
+    enum class LatencyStage {
+        TransactionFlush,
+        UpdateLayerSnapshots,
+        CommitTransactions,
+        UpdateInputFlinger,
+        CompositionEnginePresent,
+        HwcValidate,
+        HwcPresent,
+        // CPU time spent in RenderEngine::drawLayers. The GPU time is tracked by
+        // recordRenderEngineDuration.
+        RenderEngine,
+        ftl_last = RenderEngine
+    };
+    // Records how long a stage of the frame took. Unlike the other stats, stage latencies are
+    // always recorded, and this can be called from any thread without blocking.
+    virtual void recordStageLatency(LatencyStage stage, nsecs_t duration) = 0;
+    virtual void dumpStageLatencies(std::string& result) const = 0;
+
     virtual void setPostTime(int32_t layerId, uint64_t frameNumber, const std::string& layerName,
                              uid_t uid, nsecs_t postTime, GameMode) = 0;
     virtual void setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latchTime) = 0;
@@ -220,6 +244,32 @@ class TimeStats : public android::TimeStats {
         std::deque<TimeRecord> timeRecords;
     };
 
+    // A presented frame of a layer that is waiting to be merged into mTimeStats.
+    struct LayerFrameSample {
+        TimeStatsHelper::TimelineStatsKey timelineKey;
+        TimeStatsHelper::LayerStatsKey layerKey;
+        SetFrameRateVote frameRateVote;
+        uint32_t droppedFrames = 0;
+        uint32_t lateAcquireFrames = 0;
+        uint32_t badDesiredPresentFrames = 0;
+        int32_t postToAcquireMs = 0;
+        int32_t postToPresentMs = 0;
+        int32_t acquireToPresentMs = 0;
+        int32_t latchToPresentMs = 0;
+        int32_t desiredToPresentMs = 0;
+        int32_t presentToPresentMs = 0;
+        std::optional<int32_t> presentToPresentDeltaMs;
+    };
+
+    // The layer records are split by layer id across shards with a lock each, so that the per
+    // buffer calls from the main thread and binder threads don't contend on mMutex. Presented
+    // frames are kept in the shard until statsd pulls or the stats are dumped.
+    struct LayerShard {
+        std::mutex mutex;
+        std::unordered_map<int32_t, LayerRecord> records;
+        std::vector<LayerFrameSample> pendingSamples;
+    };
+
     struct PowerTime {
         PowerMode powerMode = PowerMode::OFF;
         nsecs_t prevTime = 0;
@@ -255,6 +305,9 @@ public:
     void recordRenderEngineDuration(nsecs_t startTime, nsecs_t endTime) override;
     void recordRenderEngineDuration(nsecs_t startTime,
                                     const std::shared_ptr<FenceTime>& readyFence) override;
+    void recordStageLatency(LatencyStage stage, nsecs_t duration) override;
+    void dumpStageLatencies(std::string& result) const override;
+    LatencyHistogram::Summary getStageLatency(LatencyStage stage) const;
 
     void setPostTime(int32_t layerId, uint64_t frameNumber, const std::string& layerName, uid_t uid,
                      nsecs_t postTime, GameMode) override;
@@ -291,10 +344,19 @@ public:
 private:
     bool populateGlobalAtom(std::vector<uint8_t>* pulledData);
     bool populateLayerAtom(std::vector<uint8_t>* pulledData);
+    bool populateStageLatencyAtom(std::vector<uint8_t>* pulledData);
+    LayerShard& getLayerShard(int32_t layerId);
     bool recordReadyLocked(int32_t layerId, TimeRecord* timeRecord);
-    void flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayRefreshRate,
+    // Returns true if the shard has too many pending samples, and should be merged.
+    bool flushAvailableRecordsToShardLocked(int32_t layerId, LayerRecord& layerRecord,
+                                            LayerShard& shard, Fps displayRefreshRate,
                                             std::optional<Fps> renderRate, SetFrameRateVote,
                                             GameMode);
+    // Merges the samples and janky frames recorded since the last merge into mTimeStats.
+    void mergePendingStats();
+    void mergePendingStatsLocked();
+    void mergeLayerFrameSampleLocked(const LayerFrameSample& sample);
+    void mergeJankyFramesLocked(const JankyFramesInfo& info);
     void flushPowerTimeLocked();
     void flushAvailableGlobalRecordsToStatsLocked();
     bool canAddNewAggregatedStats(uid_t uid, const std::string& layerName, GameMode);
@@ -309,12 +371,22 @@ private:
     std::atomic<bool> mEnabled = false;
     std::mutex mMutex;
     TimeStatsHelper::TimeStatsGlobal mTimeStats;
-    // Hashmap for LayerRecord with layerId as the hash key
-    std::unordered_map<int32_t, LayerRecord> mTimeStatsTracker;
+    static constexpr size_t kNumLayerShards = 8;
+    std::array<LayerShard, kNumLayerShards> mLayerShards;
+    // The number of layer records across all shards.
+    std::atomic<size_t> mNumLayerRecords = 0;
+    std::mutex mPendingJankyFramesMutex;
+    std::vector<JankyFramesInfo> mPendingJankyFrames;
     PowerTime mPowerTime;
     GlobalRecord mGlobalRecord;
+    // Not guarded by mMutex, see recordStageLatency.
+    std::array<LatencyHistogram, static_cast<size_t>(LatencyStage::ftl_last) + 1>
+            mStageLatencies;
 
     static const size_t MAX_NUM_LAYER_RECORDS = 200;
+    // The number of pending samples or janky frames after which they are merged on the
+    // recording thread.
+    static const size_t MAX_NUM_PENDING_SAMPLES = 256;
 
     static const size_t REFRESH_RATE_BUCKET_WIDTH = 30;
     static const size_t RENDER_RATE_BUCKET_WIDTH = REFRESH_RATE_BUCKET_WIDTH;
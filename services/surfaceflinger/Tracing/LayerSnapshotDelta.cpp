@@ -0,0 +1,123 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LayerTracing"
+
+#include "LayerSnapshotDelta.h"
+
+#include <log/log.h>
+
+#include <cinttypes>
+#include <string_view>
+#include <unordered_map>
+
+namespace android {
+
+perfetto::protos::LayersSnapshotProto LayerSnapshotDeltaEncoder::encode(
+        perfetto::protos::LayersSnapshotProto&& snapshot) {
+    const auto& layers = snapshot.layers().layers();
+    std::vector<int32_t> layerIds;
+    std::vector<std::string> serializedLayers;
+    layerIds.reserve(static_cast<size_t>(layers.size()));
+    serializedLayers.reserve(static_cast<size_t>(layers.size()));
+    for (const auto& layer : layers) {
+        layerIds.push_back(layer.id());
+        serializedLayers.push_back(layer.SerializeAsString());
+    }
+
+    const bool isKeyframe = !mHasKeyframe || ++mSnapshotsSinceKeyframe >= mKeyframeInterval ||
+            layerIds != mLayerIds;
+    if (isKeyframe) {
+        mHasKeyframe = true;
+        mSnapshotsSinceKeyframe = 0;
+        mLayerIds = std::move(layerIds);
+        mLayers = std::move(serializedLayers);
+        return std::move(snapshot);
+    }
+
+    perfetto::protos::LayersProto changedLayers;
+    auto* allLayers = snapshot.mutable_layers()->mutable_layers();
+    for (size_t i = 0; i < serializedLayers.size(); i++) {
+        if (serializedLayers[i] != mLayers[i]) {
+            *changedLayers.add_layers() = std::move(*allLayers->Mutable(static_cast<int>(i)));
+            mLayers[i] = std::move(serializedLayers[i]);
+        }
+    }
+
+    // Everything but the layers is kept as it is.
+    perfetto::protos::LayersSnapshotProto delta = std::move(snapshot);
+    *delta.mutable_layers() = std::move(changedLayers);
+    delta.set_where(kDeltaPrefix + delta.where());
+    return delta;
+}
+
+void LayerSnapshotDeltaEncoder::reset() {
+    mHasKeyframe = false;
+    mSnapshotsSinceKeyframe = 0;
+    mLayerIds.clear();
+    mLayers.clear();
+}
+
+bool isDeltaSnapshot(const perfetto::protos::LayersSnapshotProto& snapshot) {
+    return std::string_view(snapshot.where()).starts_with(LayerSnapshotDeltaEncoder::kDeltaPrefix);
+}
+
+bool expandDeltaSnapshots(perfetto::protos::LayersTraceFileProto& trace) {
+    const perfetto::protos::LayersSnapshotProto* previous = nullptr;
+    for (auto& snapshot : *trace.mutable_entry()) {
+        if (!isDeltaSnapshot(snapshot)) {
+            previous = &snapshot;
+            continue;
+        }
+        if (!previous) {
+            ALOGE("Layers snapshot delta at vsync %" PRId64 " has no keyframe", snapshot.vsync_id());
+            return false;
+        }
+
+        std::unordered_map<int32_t, const perfetto::protos::LayerProto*> changedLayers;
+        for (const auto& layer : snapshot.layers().layers()) {
+            changedLayers[layer.id()] = &layer;
+        }
+
+        perfetto::protos::LayersProto layers;
+        layers.mutable_layers()->Reserve(previous->layers().layers_size());
+        for (const auto& layer : previous->layers().layers()) {
+            const auto it = changedLayers.find(layer.id());
+            if (it == changedLayers.end()) {
+                *layers.add_layers() = layer;
+            } else {
+                *layers.add_layers() = *it->second;
+                changedLayers.erase(it);
+            }
+        }
+        if (!changedLayers.empty()) {
+            ALOGE("Layers snapshot delta at vsync %" PRId64 " has layers that are not in the "
+                  "previous snapshot",
+                  snapshot.vsync_id());
+            return false;
+        }
+
+        *snapshot.mutable_layers() = std::move(layers);
+        snapshot.set_where(
+                snapshot.where().substr(std::string_view(LayerSnapshotDeltaEncoder::kDeltaPrefix)
+                                                .size()));
+        previous = &snapshot;
+    }
+    return true;
+}
+
+} // namespace android
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <layerproto/LayerProtoHeader.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace android {
+
+/*
+ * Delta encoding of layers snapshots, for keeping continuous layer tracing cheap.
+ *
+ * A keyframe is a full snapshot. It is written every keyframeInterval snapshots, and whenever the
+ * set or order of layers changes. The snapshots in between are deltas, which only hold the layers
+ * that changed since the previous snapshot, along with the displays and the rest of the snapshot
+ * fields. A delta is marked by prefixing its 'where' field with kDeltaPrefix.
+ *
+ * expandDeltaSnapshots rebuilds the full snapshots of a trace from its keyframes and deltas.
+ */
+class LayerSnapshotDeltaEncoder {
+public:
+    static constexpr const char* kDeltaPrefix = "delta:";
+
+    explicit LayerSnapshotDeltaEncoder(uint32_t keyframeInterval)
+          : mKeyframeInterval(keyframeInterval) {}
+
+    perfetto::protos::LayersSnapshotProto encode(perfetto::protos::LayersSnapshotProto&& snapshot);
+
+    // Makes the next snapshot a keyframe, e.g. when a new tracing session starts.
+    void reset();
+
+private:
+    const uint32_t mKeyframeInterval;
+    uint32_t mSnapshotsSinceKeyframe = 0;
+    bool mHasKeyframe = false;
+    // The ids and serialized protos of the layers in the previous snapshot, in order.
+    std::vector<int32_t> mLayerIds;
+    std::vector<std::string> mLayers;
+};
+
+bool isDeltaSnapshot(const perfetto::protos::LayersSnapshotProto& snapshot);
+
+// Replaces the deltas in trace with the full snapshots they encode. Returns false if a delta has
+// no keyframe before it, or doesn't apply to the snapshot before it.
+bool expandDeltaSnapshots(perfetto::protos::LayersTraceFileProto& trace);
+
+} // namespace android
@@ -42,6 +42,16 @@ LayerTracing::LayerTracing(std::ostream& outStream) : LayerTracing() {
 
 LayerTracing::~LayerTracing() {
     LayerDataSource::UnregisterLayerTracing();
+    std::thread thread;
+    {
+        std::scoped_lock lock(mWriterMutex);
+        mWriterDone = true;
+        mSnapshotsQueuedCv.notify_all();
+        thread = std::move(mWriterThread);
+    }
+    if (thread.joinable()) {
+        thread.join();
+    }
 }
 
 void LayerTracing::setTakeLayersSnapshotProtoFunction(
@@ -53,9 +63,25 @@ void LayerTracing::setTransactionTracing(TransactionTracing& transactionTracing)
     mTransactionTracing = &transactionTracing;
 }
 
+void LayerTracing::setDeltaKeyframeInterval(uint32_t keyframeInterval) {
+    std::scoped_lock lock(mDeltaEncoderMutex);
+    if (keyframeInterval == 0) {
+        mDeltaEncoder.reset();
+    } else {
+        mDeltaEncoder.emplace(keyframeInterval);
+    }
+}
+
 void LayerTracing::onStart(Mode mode, uint32_t flags) {
     switch (mode) {
         case Mode::MODE_ACTIVE: {
+            {
+                // The new session needs a keyframe to start from.
+                std::scoped_lock lock(mDeltaEncoderMutex);
+                if (mDeltaEncoder) {
+                    mDeltaEncoder->reset();
+                }
+            }
             mActiveTracingFlags.store(flags);
             mIsActiveTracingStarted.store(true);
             ALOGV("Starting active tracing (waiting for initial snapshot)");
@@ -128,6 +154,8 @@ void LayerTracing::onFlush(Mode mode, uint32_t flags, bool isBugreport) {
 void LayerTracing::onStop(Mode mode) {
     if (mode == Mode::MODE_ACTIVE) {
         mIsActiveTracingStarted.store(false);
+        // Perfetto drops what is written after the session stops.
+        flushActiveSnapshots();
         ALOGD("Stopped active tracing");
     }
 }
@@ -135,6 +163,70 @@ void LayerTracing::onStop(Mode mode) {
 void LayerTracing::addProtoSnapshotToOstream(perfetto::protos::LayersSnapshotProto&& snapshot,
                                              Mode mode) {
     SFTRACE_CALL();
+    if (mode == Mode::MODE_ACTIVE && !mOutStream) {
+        queueActiveSnapshot(std::move(snapshot));
+        return;
+    }
+    writeSnapshot(std::move(snapshot), mode);
+}
+
+void LayerTracing::queueActiveSnapshot(perfetto::protos::LayersSnapshotProto&& snapshot) {
+    std::unique_lock lock(mWriterMutex);
+    base::ScopedLockAssertion assumeLocked(mWriterMutex);
+    if (!mWriterThread.joinable()) {
+        mWriterThread = std::thread(&LayerTracing::writerLoop, this);
+    }
+    if (mPendingSnapshots.size() >= kMaxPendingSnapshots) {
+        SFTRACE_NAME("waitForLayerTracingWriter");
+        mSnapshotsWrittenCv.wait(lock, [&]() REQUIRES(mWriterMutex) {
+            return mPendingSnapshots.size() < kMaxPendingSnapshots;
+        });
+    }
+    mPendingSnapshots.push_back(std::move(snapshot));
+    mSnapshotsQueuedCv.notify_one();
+}
+
+void LayerTracing::flushActiveSnapshots() {
+    std::unique_lock lock(mWriterMutex);
+    base::ScopedLockAssertion assumeLocked(mWriterMutex);
+    mSnapshotsWrittenCv.wait(lock, [&]() REQUIRES(mWriterMutex) {
+        return mWriterDone || (mPendingSnapshots.empty() && !mWriting);
+    });
+}
+
+void LayerTracing::writerLoop() {
+    while (true) {
+        perfetto::protos::LayersSnapshotProto snapshot;
+        {
+            std::unique_lock lock(mWriterMutex);
+            base::ScopedLockAssertion assumeLocked(mWriterMutex);
+            mWriting = false;
+            mSnapshotsWrittenCv.notify_all();
+            mSnapshotsQueuedCv.wait(lock, [&]() REQUIRES(mWriterMutex) {
+                return mWriterDone || !mPendingSnapshots.empty();
+            });
+            if (mWriterDone) {
+                mPendingSnapshots.clear();
+                mSnapshotsWrittenCv.notify_all();
+                break;
+            }
+            snapshot = std::move(mPendingSnapshots.front());
+            mPendingSnapshots.pop_front();
+            mWriting = true;
+        } // unlock mWriterMutex
+
+        writeSnapshot(std::move(snapshot), Mode::MODE_ACTIVE);
+    }
+}
+
+void LayerTracing::writeSnapshot(perfetto::protos::LayersSnapshotProto&& snapshot, Mode mode) {
+    SFTRACE_CALL();
+    if (mode == Mode::MODE_ACTIVE) {
+        std::scoped_lock lock(mDeltaEncoderMutex);
+        if (mDeltaEncoder) {
+            snapshot = mDeltaEncoder->encode(std::move(snapshot));
+        }
+    }
     if (mOutStream) {
         writeSnapshotToStream(std::move(snapshot));
     } else {
@@ -16,12 +16,19 @@
 
 #pragma once
 
+#include <android-base/thread_annotations.h>
 #include <layerproto/LayerProtoHeader.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <mutex>
 #include <optional>
 #include <ostream>
+#include <thread>
+
+#include "LayerSnapshotDelta.h"
 
 namespace android {
 
@@ -42,7 +49,11 @@ class TransactionTracing;
  * Tracing can operate in the following modes.
  *
  * ACTIVE mode:
- * A layers snapshot is taken and written to perfetto for each vsyncid commit.
+ * A layers snapshot is taken and written to perfetto for each vsyncid commit. If a delta keyframe
+ * interval is set, only every keyframeInterval-th snapshot is written in full and the others only
+ * hold the layers that changed (see LayerSnapshotDeltaEncoder). The snapshot is taken on the main
+ * thread, and encoded, serialized and written to perfetto on a writer thread, so that large
+ * snapshots do not delay the next frame.
  *
  * GENERATED mode:
  * Listens to the perfetto 'flush' event (e.g. when a bugreport is taken).
@@ -104,6 +115,9 @@ public:
     void setTakeLayersSnapshotProtoFunction(
             const std::function<perfetto::protos::LayersSnapshotProto(uint32_t)>&);
     void setTransactionTracing(TransactionTracing&);
+    // Writes active mode snapshots as deltas, with a full snapshot every keyframeInterval
+    // snapshots. 0 writes every snapshot in full.
+    void setDeltaKeyframeInterval(uint32_t keyframeInterval);
 
     // Start event from perfetto data source
     void onStart(Mode mode, uint32_t flags);
@@ -112,6 +126,7 @@ public:
     // Stop event from perfetto data source
     void onStop(Mode mode);
 
+    // Active mode snapshots are handed off to the writer thread, unless writing to an ostream.
     void addProtoSnapshotToOstream(perfetto::protos::LayersSnapshotProto&& snapshot, Mode mode);
     bool isActiveTracingStarted() const;
     uint32_t getActiveTracingFlags() const;
@@ -119,6 +134,17 @@ public:
     static perfetto::protos::LayersTraceFileProto createTraceFileProto();
 
 private:
+    // Snapshots waiting for the writer thread. The main thread waits when the writer falls this
+    // far behind, rather than holding on to more snapshots.
+    static constexpr size_t kMaxPendingSnapshots = 4;
+
+    void writeSnapshot(perfetto::protos::LayersSnapshotProto&& snapshot, Mode mode);
+    void queueActiveSnapshot(perfetto::protos::LayersSnapshotProto&& snapshot)
+            EXCLUDES(mWriterMutex);
+    // Waits for the queued snapshots to be written.
+    void flushActiveSnapshots() EXCLUDES(mWriterMutex);
+    void writerLoop() EXCLUDES(mWriterMutex);
+
     void writeSnapshotToStream(perfetto::protos::LayersSnapshotProto&& snapshot) const;
     void writeSnapshotToPerfetto(const perfetto::protos::LayersSnapshotProto& snapshot, Mode mode);
     bool checkAndUpdateLastVsyncIdWrittenToPerfetto(Mode mode, std::int64_t vsyncId);
@@ -130,6 +156,20 @@ private:
     std::atomic<uint32_t> mActiveTracingFlags{0};
     std::atomic<std::int64_t> mLastVsyncIdWrittenToPerfetto{-1};
     std::optional<std::reference_wrapper<std::ostream>> mOutStream;
+
+    // Snapshots are written from the main thread, and when tracing starts.
+    std::mutex mDeltaEncoderMutex;
+    std::optional<LayerSnapshotDeltaEncoder> mDeltaEncoder GUARDED_BY(mDeltaEncoderMutex);
+
+    // Started with the first active tracing session.
+    std::mutex mWriterMutex;
+    std::thread mWriterThread GUARDED_BY(mWriterMutex);
+    bool mWriterDone GUARDED_BY(mWriterMutex) = false;
+    // Whether the writer thread is writing a snapshot that it took off the queue.
+    bool mWriting GUARDED_BY(mWriterMutex) = false;
+    std::deque<perfetto::protos::LayersSnapshotProto> mPendingSnapshots GUARDED_BY(mWriterMutex);
+    std::condition_variable mSnapshotsQueuedCv;
+    std::condition_variable mSnapshotsWrittenCv;
 };
 
 } // namespace android
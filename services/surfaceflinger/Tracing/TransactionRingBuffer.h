@@ -21,35 +21,73 @@
 
 #include <common/trace.h>
 #include <log/log.h>
+#include <lz4.h>
 #include <utils/Errors.h>
 #include <utils/Timers.h>
 #include <chrono>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <vector>
 
 namespace android {
 
 class SurfaceFlinger;
 
+// Keeps the most recent serialized entries that fit in a memory budget.
+//
+// The newest entries are kept as they are in an open segment. Once the open segment holds
+// kSegmentSizeInBytes, its entries are compressed together with LZ4 into a sealed segment, which
+// is only decompressed again when the buffer is written out or the segment is evicted. Sealed
+// segments are evicted as a whole, so compression is only used when the budget holds several of
+// them.
 template <typename FileProto, typename EntryProto>
 class TransactionRingBuffer {
 public:
+    static constexpr size_t kSegmentSizeInBytes = 64 * 1024;
+    static constexpr size_t kMinSegmentsForCompression = 8;
+
     size_t size() const { return mSizeInBytes; }
     size_t used() const { return mUsedInBytes; }
-    size_t frameCount() const { return mStorage.size(); }
+    size_t frameCount() const { return mSealedEntryCount + mOpenSegment.size(); }
     void setSize(size_t newSize) { mSizeInBytes = newSize; }
-    const std::string& front() const { return mStorage.front(); }
-    const std::string& back() const { return mStorage.back(); }
+
+    std::string front() const {
+        if (!mSealedSegments.empty()) {
+            const std::vector<std::string> entries = unseal(mSealedSegments.front());
+            return entries.empty() ? std::string() : entries.front();
+        }
+        return mOpenSegment.front();
+    }
+
+    std::string back() const {
+        if (!mOpenSegment.empty()) {
+            return mOpenSegment.back();
+        }
+        const std::vector<std::string> entries = unseal(mSealedSegments.back());
+        return entries.empty() ? std::string() : entries.back();
+    }
 
     void reset() {
         // use the swap trick to make sure memory is released
-        std::deque<std::string>().swap(mStorage);
+        std::deque<std::string>().swap(mOpenSegment);
+        std::deque<SealedSegment>().swap(mSealedSegments);
+        mOpenSegmentBytes = 0U;
+        mSealedEntryCount = 0U;
+        mSealedUncompressedBytes = 0U;
         mUsedInBytes = 0U;
     }
 
     void writeToProto(FileProto& fileProto) const {
-        fileProto.mutable_entry()->Reserve(static_cast<int>(mStorage.size()) +
+        fileProto.mutable_entry()->Reserve(static_cast<int>(frameCount()) +
                                            fileProto.entry().size());
-        for (const std::string& entry : mStorage) {
+        for (const SealedSegment& segment : mSealedSegments) {
+            for (const std::string& entry : unseal(segment)) {
+                EntryProto* entryProto = fileProto.add_entry();
+                entryProto->ParseFromString(entry);
+            }
+        }
+        for (const std::string& entry : mOpenSegment) {
             EntryProto* entryProto = fileProto.add_entry();
             entryProto->ParseFromString(entry);
         }
@@ -72,15 +110,33 @@ public:
         std::vector<std::string> replacedEntries;
         size_t protoSize = static_cast<size_t>(serializedProto.size());
         while (mUsedInBytes + protoSize > mSizeInBytes) {
-            if (mStorage.empty()) {
+            if (!mSealedSegments.empty()) {
+                std::vector<std::string> entries = unseal(mSealedSegments.front());
+                mUsedInBytes -= mSealedSegments.front().data.size();
+                mSealedEntryCount -= mSealedSegments.front().entryCount;
+                mSealedUncompressedBytes -= mSealedSegments.front().uncompressedSize;
+                mSealedSegments.pop_front();
+                replacedEntries.insert(replacedEntries.end(),
+                                       std::make_move_iterator(entries.begin()),
+                                       std::make_move_iterator(entries.end()));
+                continue;
+            }
+            if (mOpenSegment.empty()) {
                 return {};
             }
-            mUsedInBytes -= static_cast<size_t>(mStorage.front().size());
-            replacedEntries.emplace_back(mStorage.front());
-            mStorage.pop_front();
+            mUsedInBytes -= static_cast<size_t>(mOpenSegment.front().size());
+            mOpenSegmentBytes -= static_cast<size_t>(mOpenSegment.front().size());
+            replacedEntries.emplace_back(mOpenSegment.front());
+            mOpenSegment.pop_front();
         }
         mUsedInBytes += protoSize;
-        mStorage.emplace_back(serializedProto);
+        mOpenSegmentBytes += protoSize;
+        mOpenSegment.emplace_back(serializedProto);
+
+        if (mOpenSegmentBytes >= kSegmentSizeInBytes &&
+            mSizeInBytes >= kSegmentSizeInBytes * kMinSegmentsForCompression) {
+            sealOpenSegment();
+        }
         return replacedEntries;
     }
 
@@ -94,7 +150,7 @@ public:
         std::chrono::milliseconds duration(0);
         if (frameCount() > 0) {
             EntryProto entry;
-            entry.ParseFromString(mStorage.front());
+            entry.ParseFromString(front());
             duration = std::chrono::duration_cast<std::chrono::milliseconds>(
                     std::chrono::nanoseconds(systemTime() - entry.elapsed_realtime_nanos()));
         }
@@ -103,12 +159,92 @@ public:
                             "  number of entries: %zu (%.2fMB / %.2fMB) duration: %" PRIi64 "ms\n",
                             frameCount(), float(used()) / (1024.f * 1024.f),
                             float(size()) / (1024.f * 1024.f), durationCount);
+        if (!mSealedSegments.empty()) {
+            const size_t compressedBytes = mUsedInBytes - mOpenSegmentBytes;
+            base::StringAppendF(&result,
+                                "  compressed segments: %zu (%zu entries, %.2fMB -> %.2fMB)\n",
+                                mSealedSegments.size(), mSealedEntryCount,
+                                float(mSealedUncompressedBytes) / (1024.f * 1024.f),
+                                float(compressedBytes) / (1024.f * 1024.f));
+        }
     }
 
 private:
+    struct SealedSegment {
+        // The entries, each prefixed by its size, compressed unless compression didn't help.
+        std::string data;
+        size_t uncompressedSize = 0;
+        size_t entryCount = 0;
+        bool compressed = false;
+    };
+
+    void sealOpenSegment() {
+        SFTRACE_CALL();
+        std::string raw;
+        raw.reserve(mOpenSegmentBytes + mOpenSegment.size() * sizeof(uint32_t));
+        for (const std::string& entry : mOpenSegment) {
+            const auto entrySize = static_cast<uint32_t>(entry.size());
+            raw.append(reinterpret_cast<const char*>(&entrySize), sizeof(entrySize));
+            raw.append(entry);
+        }
+
+        SealedSegment segment;
+        segment.uncompressedSize = raw.size();
+        segment.entryCount = mOpenSegment.size();
+        segment.data.resize(static_cast<size_t>(LZ4_compressBound(static_cast<int>(raw.size()))));
+        const int compressedSize =
+                LZ4_compress_default(raw.data(), segment.data.data(), static_cast<int>(raw.size()),
+                                     static_cast<int>(segment.data.size()));
+        if (compressedSize > 0 && static_cast<size_t>(compressedSize) < mOpenSegmentBytes) {
+            segment.data.resize(static_cast<size_t>(compressedSize));
+            segment.data.shrink_to_fit();
+            segment.compressed = true;
+        } else {
+            segment.data = std::move(raw);
+        }
+
+        mUsedInBytes = mUsedInBytes - mOpenSegmentBytes + segment.data.size();
+        mSealedEntryCount += mOpenSegment.size();
+        mSealedUncompressedBytes += segment.uncompressedSize;
+        mSealedSegments.emplace_back(std::move(segment));
+        std::deque<std::string>().swap(mOpenSegment);
+        mOpenSegmentBytes = 0U;
+    }
+
+    static std::vector<std::string> unseal(const SealedSegment& segment) {
+        std::string decompressed;
+        if (segment.compressed) {
+            decompressed.resize(segment.uncompressedSize);
+            const int size =
+                    LZ4_decompress_safe(segment.data.data(), decompressed.data(),
+                                        static_cast<int>(segment.data.size()),
+                                        static_cast<int>(decompressed.size()));
+            if (size < 0 || static_cast<size_t>(size) != segment.uncompressedSize) {
+                ALOGE("Could not decompress transaction trace segment: %d", size);
+                return {};
+            }
+        }
+        const std::string& raw = segment.compressed ? decompressed : segment.data;
+
+        std::vector<std::string> entries;
+        size_t offset = 0;
+        while (offset + sizeof(uint32_t) <= raw.size()) {
+            uint32_t entrySize;
+            std::memcpy(&entrySize, raw.data() + offset, sizeof(entrySize));
+            offset += sizeof(entrySize);
+            entries.emplace_back(raw, offset, entrySize);
+            offset += entrySize;
+        }
+        return entries;
+    }
+
     size_t mUsedInBytes = 0U;
     size_t mSizeInBytes = 0U;
-    std::deque<std::string> mStorage;
+    std::deque<SealedSegment> mSealedSegments;
+    size_t mSealedEntryCount = 0U;
+    size_t mSealedUncompressedBytes = 0U;
+    std::deque<std::string> mOpenSegment;
+    size_t mOpenSegmentBytes = 0U;
 };
 
 } // namespace android
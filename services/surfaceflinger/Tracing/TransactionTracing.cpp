@@ -167,9 +167,7 @@ void TransactionTracing::dump(std::string& result) const {
 }
 
 void TransactionTracing::addQueuedTransaction(const TransactionState& transaction) {
-    perfetto::protos::TransactionState* state =
-            new perfetto::protos::TransactionState(mProtoParser.toProto(transaction));
-    mTransactionQueue.push(state);
+    mTransactionQueue.push(mProtoParser.toProto(transaction));
 }
 
 void TransactionTracing::addCommittedTransactions(int64_t vsyncId, nsecs_t commitTime,
@@ -233,9 +231,8 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
     perfetto::protos::TransactionTraceEntry entryProto;
 
     while (auto incomingTransaction = mTransactionQueue.pop()) {
-        auto transaction = *incomingTransaction;
-        mQueuedTransactions[incomingTransaction->transaction_id()] = transaction;
-        delete incomingTransaction;
+        const uint64_t transactionId = incomingTransaction->transaction_id();
+        mQueuedTransactions[transactionId] = std::move(*incomingTransaction);
     }
     for (const CommittedUpdates& update : committedUpdates) {
         entryProto.set_elapsed_realtime_nanos(update.timestamp);
@@ -30,7 +30,7 @@
 #include "FrontEnd/DisplayInfo.h"
 #include "FrontEnd/LayerCreationArgs.h"
 #include "FrontEnd/Update.h"
-#include "LocklessStack.h"
+#include "LocklessQueue.h"
 #include "TransactionProtoParser.h"
 #include "TransactionRingBuffer.h"
 
@@ -169,7 +169,7 @@ private:
             mBuffer GUARDED_BY(mTraceLock);
     std::unordered_map<uint64_t, perfetto::protos::TransactionState> mQueuedTransactions
             GUARDED_BY(mTraceLock);
-    LocklessStack<perfetto::protos::TransactionState> mTransactionQueue;
+    LocklessQueue<perfetto::protos::TransactionState> mTransactionQueue;
     nsecs_t mStartingTimestamp GUARDED_BY(mTraceLock);
     std::unordered_map<int, perfetto::protos::LayerCreationArgs> mCreatedLayers
             GUARDED_BY(mTraceLock);
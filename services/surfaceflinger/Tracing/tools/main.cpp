@@ -21,15 +21,49 @@
 #include <iostream>
 #include <string>
 
+#include <Tracing/LayerSnapshotDelta.h>
 #include <Tracing/LayerTracing.h>
 #include "LayerTraceGenerator.h"
 
 using namespace android;
 
+// Rewrites a layers trace with delta snapshots as a trace of full snapshots.
+static int expandDeltas(const char* inputPath, const char* outputPath) {
+    std::fstream input(inputPath, std::ios::in | std::ios::binary);
+    if (!input) {
+        std::cout << "Error: Could not open " << inputPath << "\n";
+        return -1;
+    }
+
+    perfetto::protos::LayersTraceFileProto layersTraceFile;
+    if (!layersTraceFile.ParseFromIstream(&input)) {
+        std::cout << "Error: Failed to parse " << inputPath << "\n";
+        return -1;
+    }
+
+    if (!expandDeltaSnapshots(layersTraceFile)) {
+        std::cout << "Error: Failed to expand the delta snapshots of " << inputPath << "\n";
+        return -1;
+    }
+
+    auto outStream = std::ofstream{outputPath, std::ios::binary | std::ios::out};
+    if (!layersTraceFile.SerializeToOstream(&outStream)) {
+        std::cout << "Error: Failed to write " << outputPath << "\n";
+        return -1;
+    }
+    return 0;
+}
+
 int main(int argc, char** argv) {
+    if (argc == 4 && std::string_view(argv[1]) == "--expand-deltas") {
+        return expandDeltas(argv[2], argv[3]);
+    }
+
     if (argc > 4) {
         std::cout << "Usage: " << argv[0]
-                  << " [transaction-trace-path] [output-layers-trace-path] [--last-entry-only]\n";
+                  << " [transaction-trace-path] [output-layers-trace-path] [--last-entry-only]\n"
+                  << "       " << argv[0]
+                  << " --expand-deltas [layers-trace-path] [output-layers-trace-path]\n";
         return -1;
     }
 
@@ -27,6 +27,8 @@
 #include "BackgroundExecutor.h"
 #include "Utils/FenceUtils.h"
 
+#include <algorithm>
+
 #include <binder/IInterface.h>
 #include <common/FlagManager.h>
 #include <common/trace.h>
@@ -164,11 +166,28 @@ void TransactionCallbackInvoker::addPresentFence(sp<Fence> presentFence) {
     mPresentFence = std::move(presentFence);
 }
 
+void TransactionCallbackInvoker::addReleasedBuffer(const sp<IBinder>& listener,
+                                                   ReleasedBufferStats releasedBuffer) {
+    mReleasedBuffers[listener].push_back(std::move(releasedBuffer));
+}
+
 void TransactionCallbackInvoker::sendCallbacks(bool onCommitOnly) {
-    for (const auto& bufferRelease : mBufferReleases) {
-        bufferRelease.channel->writeReleaseFence(bufferRelease.callbackId, bufferRelease.fence,
-                                                 bufferRelease.currentMaxAcquiredBufferCount);
+    // Send the releases for each channel together, so that they take as few socket messages as
+    // possible. The releases for a channel stay in order.
+    std::stable_sort(mBufferReleases.begin(), mBufferReleases.end(),
+                     [](const BufferRelease& lhs, const BufferRelease& rhs) {
+                         return lhs.channel.get() < rhs.channel.get();
+                     });
+    for (auto it = mBufferReleases.begin(); it != mBufferReleases.end();) {
+        const auto& channel = it->channel;
+        mBufferReleaseMessages.clear();
+        for (; it != mBufferReleases.end() && it->channel == channel; it++) {
+            mBufferReleaseMessages.emplace_back(it->callbackId, it->fence,
+                                                it->currentMaxAcquiredBufferCount);
+        }
+        channel->writeReleaseFences(mBufferReleaseMessages);
     }
+    mBufferReleaseMessages.clear();
     mBufferReleases.clear();
 
     // For each listener
@@ -198,8 +217,13 @@ void TransactionCallbackInvoker::sendCallbacks(bool onCommitOnly) {
             listenerStats.transactionStats.push_back(std::move(transactionStats));
             transactionStatsItr = transactionStatsDeque.erase(transactionStatsItr);
         }
-        // If the listener has completed transactions
-        if (!listenerStats.transactionStats.empty()) {
+        if (const auto it = mReleasedBuffers.find(listener); it != mReleasedBuffers.end()) {
+            listenerStats.releasedBuffers = std::move(it->second);
+            mReleasedBuffers.erase(it);
+        }
+
+        // If the listener has completed transactions or released buffers
+        if (!listenerStats.transactionStats.empty() || !listenerStats.releasedBuffers.empty()) {
             // If the listener is still alive
             if (listener->isBinderAlive()) {
                 // Send callback.  The listener stored in listenerStats
@@ -214,6 +238,18 @@ void TransactionCallbackInvoker::sendCallbacks(bool onCommitOnly) {
         completedTransactionsItr++;
     }
 
+    // Listeners that only have released buffers this frame
+    for (auto& [listener, releasedBuffers] : mReleasedBuffers) {
+        if (!listener->isBinderAlive()) {
+            continue;
+        }
+        ListenerStats listenerStats;
+        listenerStats.listener = listener;
+        listenerStats.releasedBuffers = std::move(releasedBuffers);
+        listenerStatsToSend.emplace_back(std::move(listenerStats));
+    }
+    mReleasedBuffers.clear();
+
     if (mPresentFence) {
         mPresentFence.clear();
     }
@@ -68,6 +68,10 @@ public:
 
     void addPresentFence(sp<Fence>);
 
+    // Queues a released buffer to be sent with the next callbacks for the listener, so that a
+    // client gets one binder transaction per frame.
+    void addReleasedBuffer(const sp<IBinder>& listener, ReleasedBufferStats releasedBuffer);
+
     void sendCallbacks(bool onCommitOnly);
     void clearCompletedTransactions() {
         mCompletedTransactions.clear();
@@ -90,6 +94,11 @@ private:
         uint32_t currentMaxAcquiredBufferCount;
     };
     std::vector<BufferRelease> mBufferReleases;
+    // Reused to batch the releases sent to each channel.
+    std::vector<gui::BufferReleaseChannel::Message> mBufferReleaseMessages;
+
+    std::unordered_map<sp<IBinder>, std::vector<ReleasedBufferStats>, IListenerHash>
+            mReleasedBuffers;
 
     sp<Fence> mPresentFence;
 };
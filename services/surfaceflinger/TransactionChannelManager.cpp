@@ -0,0 +1,342 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "TransactionChannelManager"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include <pthread.h>
+
+#include <cinttypes>
+
+#include <android-base/stringprintf.h>
+#include <common/trace.h>
+#include <gui/ISurfaceComposer.h>
+#include <utils/Log.h>
+
+#include "TransactionChannelManager.h"
+
+namespace android {
+
+using gui::TransactionChannel;
+
+TransactionChannelManager::Channel::Channel(int pid, int uid, base::unique_fd channelFd,
+                                            sp<IBinder> applyToken)
+      : pid(pid),
+        uid(uid),
+        applyToken(std::move(applyToken)),
+        fd(channelFd.get()),
+        consumer(base::StringPrintf("TransactionChannel(pid=%d)", pid), std::move(channelFd)) {}
+
+TransactionChannelManager::TransactionChannelManager(QueueTransactionFn queueTransaction)
+      : mQueueTransaction(std::move(queueTransaction)) {}
+
+TransactionChannelManager::~TransactionChannelManager() {
+    if (mThread.joinable()) {
+        mStopped = true;
+        mLooper->wake();
+        mThread.join();
+    }
+}
+
+status_t TransactionChannelManager::setChannel(int pid, int uid, base::unique_fd channelFd,
+                                               const sp<IBinder>& applyToken) {
+    if (!channelFd.ok() || !applyToken) {
+        return BAD_VALUE;
+    }
+
+    auto channel = std::make_shared<Channel>(pid, uid, std::move(channelFd), applyToken);
+    if (status_t err = applyToken->linkToDeath(sp<DeathRecipient>::fromExisting(this));
+        err != OK) {
+        return err;
+    }
+
+    std::shared_ptr<Channel> previousChannel;
+    {
+        std::scoped_lock lock(mMutex);
+        if (!mLooper) {
+            mLooper = sp<Looper>::make(/*allowNonCallbacks=*/false);
+            mThread = std::thread(&TransactionChannelManager::threadMain, this);
+            pthread_setname_np(mThread.native_handle(), "TxnChannel");
+        }
+        if (auto it = mChannels.find(pid); it != mChannels.end()) {
+            previousChannel = it->second;
+        }
+        mChannels[pid] = channel;
+        mChannelsByFd[channel->fd] = channel;
+        mChannelCount = mChannels.size();
+    }
+    if (previousChannel) {
+        removeChannel(previousChannel);
+    }
+
+    mLooper->addFd(channel->fd, Looper::POLL_CALLBACK,
+                   Looper::EVENT_INPUT | Looper::EVENT_HANGUP | Looper::EVENT_ERROR,
+                   &TransactionChannelManager::handleLooperEvent, this);
+    return OK;
+}
+
+status_t TransactionChannelManager::registerLayer(int pid, const sp<IBinder>& layerHandle,
+                                                  int32_t layerId) {
+    std::shared_ptr<Channel> channel = getChannel(pid);
+    if (!channel) {
+        return NAME_NOT_FOUND;
+    }
+    std::scoped_lock lock(channel->mutex);
+    channel->layers[layerId] = layerHandle;
+    return OK;
+}
+
+void TransactionChannelManager::onBinderTransaction(int pid, uint64_t transactionId,
+                                                    const std::function<void()>& queueTransaction) {
+    std::shared_ptr<Channel> channel = mChannelCount ? getChannel(pid) : nullptr;
+    if (!channel) {
+        queueTransaction();
+        return;
+    }
+
+    SFTRACE_CALL();
+    DrainResult result;
+    {
+        std::scoped_lock lock(channel->mutex);
+        channel->binderTransactions++;
+        if (channel->pendingBarrier == transactionId) {
+            channel->pendingBarrier.reset();
+            mPendingBarrierCount--;
+        } else {
+            result = drainLocked(*channel, transactionId);
+            if (result == DrainResult::Blocked &&
+                channel->arrivedBinderTransactions.size() < kMaxArrivedBinderTransactions) {
+                // The process sent another binder transaction first, on a different thread. Skip
+                // this transaction's barrier once it is read.
+                channel->arrivedBinderTransactions.insert(transactionId);
+            }
+        }
+
+        queueTransaction();
+        result = drainLocked(*channel, std::nullopt);
+    }
+    if (result == DrainResult::Broken) {
+        removeChannel(channel);
+    }
+}
+
+TransactionChannelManager::DrainResult TransactionChannelManager::drainLocked(
+        Channel& channel, std::optional<uint64_t> untilBarrier) {
+    if (channel.pendingBarrier) {
+        return DrainResult::Blocked;
+    }
+
+    TransactionChannel::Message message;
+    while (true) {
+        const status_t err = channel.consumer.readMessage(message);
+        if (err == WOULD_BLOCK) {
+            return DrainResult::Empty;
+        }
+        if (err != OK) {
+            return DrainResult::Broken;
+        }
+
+        if (message.type == TransactionChannel::MessageType::BinderBarrier) {
+            if (message.transactionId == untilBarrier) {
+                return DrainResult::FoundBarrier;
+            }
+            if (channel.arrivedBinderTransactions.erase(message.transactionId)) {
+                continue;
+            }
+            channel.pendingBarrier = message.transactionId;
+            channel.pendingBarrierTime = systemTime();
+            mPendingBarrierCount++;
+            return DrainResult::Blocked;
+        }
+
+        queueMessageLocked(channel, message);
+    }
+}
+
+void TransactionChannelManager::queueMessageLocked(Channel& channel,
+                                                   const TransactionChannel::Message& message) {
+    channel.transactionsRead++;
+
+    ChannelTransaction transaction;
+    transaction.states.setCapacity(message.layerUpdates.size());
+    for (const auto& update : message.layerUpdates) {
+        auto it = channel.layers.find(update.layerId);
+        if (it == channel.layers.end()) {
+            ALOGW("pid %d sent an update for unregistered layer %d", channel.pid, update.layerId);
+            continue;
+        }
+        sp<IBinder> handle = it->second.promote();
+        if (!handle) {
+            channel.layers.erase(it);
+            continue;
+        }
+
+        ComposerState state;
+        update.applyTo(state.state);
+        state.state.surface = std::move(handle);
+        transaction.states.add(state);
+    }
+    if (transaction.states.empty()) {
+        return;
+    }
+
+    transaction.flags = message.flags & ISurfaceComposer::eAnimation;
+    transaction.applyToken = channel.applyToken;
+    transaction.transactionId = message.transactionId;
+    transaction.originPid = channel.pid;
+    transaction.originUid = channel.uid;
+    mQueueTransaction(std::move(transaction));
+}
+
+std::shared_ptr<TransactionChannelManager::Channel> TransactionChannelManager::getChannel(
+        int pid) const {
+    std::scoped_lock lock(mMutex);
+    auto it = mChannels.find(pid);
+    return it == mChannels.end() ? nullptr : it->second;
+}
+
+void TransactionChannelManager::removeChannel(const std::shared_ptr<Channel>& channel) {
+    {
+        std::scoped_lock lock(mMutex);
+        if (auto it = mChannels.find(channel->pid); it != mChannels.end() && it->second == channel) {
+            mChannels.erase(it);
+        }
+        if (auto it = mChannelsByFd.find(channel->fd);
+            it != mChannelsByFd.end() && it->second == channel) {
+            mChannelsByFd.erase(it);
+            mLooper->removeFd(channel->fd);
+        }
+        mChannelCount = mChannels.size();
+    }
+
+    std::scoped_lock lock(channel->mutex);
+    if (channel->pendingBarrier) {
+        channel->pendingBarrier.reset();
+        mPendingBarrierCount--;
+    }
+    channel->applyToken->unlinkToDeath(sp<DeathRecipient>::fromExisting(this));
+}
+
+int TransactionChannelManager::handleLooperEvent(int fd, int events, void* data) {
+    static_cast<TransactionChannelManager*>(data)->onChannelEvent(fd, events);
+    // Channels are unregistered through removeChannel.
+    return 1;
+}
+
+void TransactionChannelManager::onChannelEvent(int fd, int events) {
+    std::shared_ptr<Channel> channel;
+    {
+        std::scoped_lock lock(mMutex);
+        auto it = mChannelsByFd.find(fd);
+        if (it == mChannelsByFd.end()) {
+            return;
+        }
+        channel = it->second;
+    }
+
+    SFTRACE_CALL();
+    DrainResult result;
+    {
+        std::scoped_lock lock(channel->mutex);
+        result = drainLocked(*channel, std::nullopt);
+    }
+    // Keep reading until the socket is empty, the producer may have written before hanging up.
+    if (result == DrainResult::Broken ||
+        (result == DrainResult::Empty && (events & (Looper::EVENT_HANGUP | Looper::EVENT_ERROR)))) {
+        removeChannel(channel);
+    }
+}
+
+void TransactionChannelManager::expirePendingBarriers() {
+    if (mPendingBarrierCount == 0) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<Channel>> channels;
+    {
+        std::scoped_lock lock(mMutex);
+        for (const auto& [_, channel] : mChannels) {
+            channels.push_back(channel);
+        }
+    }
+
+    const nsecs_t now = systemTime();
+    for (const auto& channel : channels) {
+        DrainResult result;
+        {
+            std::scoped_lock lock(channel->mutex);
+            if (!channel->pendingBarrier || now - channel->pendingBarrierTime < kBarrierTimeout) {
+                continue;
+            }
+            ALOGW("pid %d: binder transaction %" PRIu64 " never arrived, resuming its channel",
+                  channel->pid, *channel->pendingBarrier);
+            channel->pendingBarrier.reset();
+            mPendingBarrierCount--;
+            result = drainLocked(*channel, std::nullopt);
+        }
+        if (result == DrainResult::Broken) {
+            removeChannel(channel);
+        }
+    }
+}
+
+void TransactionChannelManager::threadMain() {
+    while (!mStopped) {
+        const int timeoutMillis =
+                mPendingBarrierCount ? static_cast<int>(ns2ms(kBarrierTimeout)) : -1;
+        mLooper->pollOnce(timeoutMillis);
+        expirePendingBarriers();
+    }
+}
+
+void TransactionChannelManager::binderDied(const wp<IBinder>& who) {
+    std::vector<std::shared_ptr<Channel>> channels;
+    {
+        std::scoped_lock lock(mMutex);
+        for (const auto& [_, channel] : mChannels) {
+            if (who == channel->applyToken) {
+                channels.push_back(channel);
+            }
+        }
+    }
+    for (const auto& channel : channels) {
+        removeChannel(channel);
+    }
+}
+
+void TransactionChannelManager::dump(std::string& result) const {
+    std::vector<std::shared_ptr<Channel>> channels;
+    {
+        std::scoped_lock lock(mMutex);
+        for (const auto& [_, channel] : mChannels) {
+            channels.push_back(channel);
+        }
+    }
+
+    base::StringAppendF(&result, "TransactionChannels: %zu\n", channels.size());
+    for (const auto& channel : channels) {
+        std::scoped_lock lock(channel->mutex);
+        base::StringAppendF(&result,
+                            "  pid=%d uid=%d layers=%zu transactionsRead=%" PRIu64
+                            " binderTransactions=%" PRIu64 " pendingBarrier=%s\n",
+                            channel->pid, channel->uid, channel->layers.size(),
+                            channel->transactionsRead, channel->binderTransactions,
+                            channel->pendingBarrier ? "yes" : "no");
+    }
+}
+
+} // namespace android
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <binder/IBinder.h>
+#include <gui/LayerState.h>
+#include <gui/TransactionChannel.h>
+#include <utils/Looper.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// Reads the TransactionChannels that processes set up with
+// ISurfaceComposer::setTransactionChannel and hands their messages back as transactions, see
+// gui/TransactionChannel.h. Channels are read on a dedicated thread, and on the binder thread of
+// any transaction the same process sends through binder so the two stay ordered.
+class TransactionChannelManager : public IBinder::DeathRecipient {
+public:
+    struct ChannelTransaction {
+        Vector<ComposerState> states;
+        uint32_t flags = 0;
+        sp<IBinder> applyToken;
+        uint64_t transactionId = 0;
+        int originPid = 0;
+        int originUid = 0;
+    };
+    using QueueTransactionFn = std::function<void(ChannelTransaction&&)>;
+
+    // queueTransaction is called with a channel lock held and must not call back into the
+    // manager.
+    explicit TransactionChannelManager(QueueTransactionFn queueTransaction);
+    ~TransactionChannelManager();
+
+    // Replaces the process' channel.
+    status_t setChannel(int pid, int uid, base::unique_fd channelFd, const sp<IBinder>& applyToken);
+
+    // Lets the process' channel update the layer.
+    status_t registerLayer(int pid, const sp<IBinder>& layerHandle, int32_t layerId);
+
+    // Must wrap the queueing of every binder transaction. Queues the channel transactions the
+    // process sent before transactionId, calls queueTransaction and queues the channel
+    // transactions that follow it.
+    void onBinderTransaction(int pid, uint64_t transactionId,
+                             const std::function<void()>& queueTransaction);
+
+    void dump(std::string& result) const;
+
+private:
+    struct Channel {
+        Channel(int pid, int uid, base::unique_fd channelFd, sp<IBinder> applyToken);
+
+        const int pid;
+        const int uid;
+        const sp<IBinder> applyToken;
+        const int fd;
+
+        std::mutex mutex;
+        gui::TransactionChannel::ConsumerEndpoint consumer GUARDED_BY(mutex);
+        // Set when a BinderBarrier was read before its binder transaction arrived. Nothing more
+        // is read from the channel until it does.
+        std::optional<uint64_t> pendingBarrier GUARDED_BY(mutex);
+        nsecs_t pendingBarrierTime GUARDED_BY(mutex) = 0;
+        // Binder transactions that were queued before their BinderBarrier was read.
+        std::unordered_set<uint64_t> arrivedBinderTransactions GUARDED_BY(mutex);
+        std::unordered_map<int32_t, wp<IBinder>> layers GUARDED_BY(mutex);
+        uint64_t transactionsRead GUARDED_BY(mutex) = 0;
+        uint64_t binderTransactions GUARDED_BY(mutex) = 0;
+    };
+
+    // Result of reading a channel until it is empty, malformed or waiting on a binder
+    // transaction.
+    enum class DrainResult { Empty, Blocked, FoundBarrier, Broken };
+
+    // Queues the transactions in the channel. Stops early if the channel reaches the
+    // BinderBarrier for untilBarrier.
+    DrainResult drainLocked(Channel& channel, std::optional<uint64_t> untilBarrier)
+            REQUIRES(channel.mutex);
+    void queueMessageLocked(Channel& channel, const gui::TransactionChannel::Message& message)
+            REQUIRES(channel.mutex);
+
+    std::shared_ptr<Channel> getChannel(int pid) const;
+    void removeChannel(const std::shared_ptr<Channel>& channel);
+
+    static int handleLooperEvent(int fd, int events, void* data);
+    void onChannelEvent(int fd, int events);
+    void expirePendingBarriers();
+    void threadMain();
+
+    void binderDied(const wp<IBinder>& who) override;
+
+    // Give up on a BinderBarrier whose binder transaction never arrives.
+    static constexpr nsecs_t kBarrierTimeout = ms2ns(500);
+    // Bounds arrivedBinderTransactions for processes that send binder transactions from many
+    // threads at once.
+    static constexpr size_t kMaxArrivedBinderTransactions = 64;
+
+    const QueueTransactionFn mQueueTransaction;
+
+    mutable std::mutex mMutex;
+    std::unordered_map<int /* pid */, std::shared_ptr<Channel>> mChannels GUARDED_BY(mMutex);
+    std::unordered_map<int /* fd */, std::shared_ptr<Channel>> mChannelsByFd GUARDED_BY(mMutex);
+    std::atomic<size_t> mChannelCount = 0;
+    std::atomic<size_t> mPendingBarrierCount = 0;
+
+    sp<Looper> mLooper;
+    std::thread mThread;
+    std::atomic<bool> mStopped = false;
+};
+
+} // namespace android
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android::utils {
+
+// A small fork-join pool. run() hands a batch of independent tasks to the worker threads and
+// blocks until every task has finished. The calling thread also executes tasks so a pool with N
+// workers runs up to N + 1 tasks at once. Batches are executed one at a time; run() must not be
+// called from one of the pool's tasks.
+class WorkerPool {
+    WorkerPool(const WorkerPool&) = delete;
+    void operator=(const WorkerPool&) = delete;
+
+public:
+    using Task = std::function<void()>;
+
+    WorkerPool(size_t workerCount, const char* name) {
+        mThreads.reserve(workerCount);
+        for (size_t i = 0; i < workerCount; i++) {
+            mThreads.emplace_back([this] { threadMain(); });
+            const std::string threadName = std::string(name) + std::to_string(i);
+            pthread_setname_np(mThreads.back().native_handle(), threadName.c_str());
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard lock(mMutex);
+            mDone = true;
+        }
+        mWorkAvailable.notify_all();
+        for (auto& thread : mThreads) {
+            thread.join();
+        }
+    }
+
+    size_t getWorkerCount() const { return mThreads.size(); }
+
+    void run(std::vector<Task>& tasks) {
+        if (tasks.empty()) return;
+
+        std::unique_lock lock(mMutex);
+        mTasks = &tasks;
+        mNextTask = 0;
+        mPendingTasks = tasks.size();
+        mWorkAvailable.notify_all();
+
+        // Help out instead of idling while the workers drain the batch.
+        while (mNextTask < mTasks->size()) {
+            Task& task = (*mTasks)[mNextTask++];
+            lock.unlock();
+            task();
+            lock.lock();
+            mPendingTasks--;
+        }
+        mBatchDone.wait(lock, [this] { return mPendingTasks == 0; });
+        mTasks = nullptr;
+    }
+
+private:
+    void threadMain() {
+        std::unique_lock lock(mMutex);
+        while (true) {
+            mWorkAvailable.wait(lock, [this] {
+                return mDone || (mTasks && mNextTask < mTasks->size());
+            });
+            if (mDone) return;
+
+            Task& task = (*mTasks)[mNextTask++];
+            lock.unlock();
+            task();
+            lock.lock();
+            if (--mPendingTasks == 0) {
+                mBatchDone.notify_one();
+            }
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mBatchDone;
+    std::vector<Task>* mTasks = nullptr;
+    size_t mNextTask = 0;
+    size_t mPendingTasks = 0;
+    bool mDone = false;
+    std::vector<std::thread> mThreads;
+};
+
+} // namespace android::utils
@@ -45,8 +45,11 @@ void WindowInfosListenerInvoker::addWindowInfosListener(sp<IWindowInfosListener>
                 SFTRACE_NAME("WindowInfosListenerInvoker::addWindowInfosListener");
                 sp<IBinder> asBinder = IInterface::asBinder(listener);
                 asBinder->linkToDeath(sp<DeathRecipient>::fromExisting(this));
+                // The listener is only sent the updates that come after it was added.
                 mWindowInfosListeners.try_emplace(asBinder,
-                                                  std::make_pair(listenerId, std::move(listener)));
+                                                  ListenerState{.id = listenerId,
+                                                                .listener = std::move(listener),
+                                                                .ackedGeneration = mGeneration});
             }});
 }
 
@@ -69,20 +72,23 @@ void WindowInfosListenerInvoker::binderDied(const wp<IBinder>& who) {
 
 void WindowInfosListenerInvoker::eraseListenerAndAckMessages(const wp<IBinder>& binder) {
     auto it = mWindowInfosListeners.find(binder);
-    int64_t listenerId = it->second.first;
+    int64_t listenerId = it->second.id;
     mWindowInfosListeners.erase(binder);
+    mDeltaListenerBases.erase(listenerId);
 
-    std::vector<int64_t> vsyncIds;
-    for (auto& [vsyncId, state] : mUnackedState) {
-        if (std::find(state.unackedListenerIds.begin(), state.unackedListenerIds.end(),
-                      listenerId) != state.unackedListenerIds.end()) {
-            vsyncIds.push_back(vsyncId);
-        }
-    }
+    // The updates the listener did not ack no longer hold back the reported listeners.
+    finishSendDelayIfSent();
+    reportAckedUpdates();
+}
 
-    for (int64_t vsyncId : vsyncIds) {
-        ackWindowInfosReceived(vsyncId, listenerId);
+WindowInfosListenerInvoker::ListenerState* WindowInfosListenerInvoker::findListener(
+        int64_t listenerId) {
+    for (auto& pair : mWindowInfosListeners) {
+        if (pair.second.id == listenerId) {
+            return &pair.second;
+        }
     }
+    return nullptr;
 }
 
 void WindowInfosListenerInvoker::windowInfosChanged(
@@ -95,61 +101,146 @@ void WindowInfosListenerInvoker::windowInfosChanged(
         };
     }
 
-    // If there are unacked messages and this isn't a forced call, then return immediately.
-    // If a forced window infos change doesn't happen first, the update will be sent after
-    // the WindowInfosReportedListeners are called. If a forced window infos change happens or
-    // if there are subsequent delayed messages before this update is sent, then this message
-    // will be dropped and the listeners will only be called with the latest info. This is done
-    // to reduce the amount of binder memory used.
-    if (!mUnackedState.empty() && !forceImmediateCall) {
-        mDelayedUpdate = std::move(update);
-        mReportedListeners.merge(reportedListeners);
-        return;
-    }
-
-    if (mDelayedUpdate) {
-        mDelayedUpdate.reset();
-    }
-
     if (CC_UNLIKELY(mWindowInfosListeners.empty())) {
         mReportedListeners.merge(reportedListeners);
         mDelayInfo.reset();
         return;
     }
 
+    update.generation = ++mGeneration;
+    mLatestUpdate = std::make_shared<const gui::WindowInfosUpdate>(std::move(update));
     reportedListeners.merge(mReportedListeners);
     mReportedListeners.clear();
+    if (!reportedListeners.empty()) {
+        mUnreportedListeners.emplace(mGeneration, std::move(reportedListeners));
+    }
 
-    // Update mUnackedState to include the message we're about to send
-    auto [it, _] = mUnackedState.try_emplace(update.vsyncId,
-                                             UnackedState{.reportedListeners =
-                                                                  std::move(reportedListeners)});
-    auto& unackedState = it->second;
+    // Each listener has a single slot for an update it has not been sent yet. While a listener
+    // has not acked an earlier update, this update replaces the one in its slot, and is sent once
+    // the listener acks. So a slow listener is not sent updates it would only skip over, and it
+    // does not hold up the other listeners. This is done to reduce the amount of binder memory
+    // used. A forced update is sent right away.
+    DeltaCache deltas;
     for (auto& pair : mWindowInfosListeners) {
-        int64_t listenerId = pair.second.first;
-        unackedState.unackedListenerIds.push_back(listenerId);
+        ListenerState& listener = pair.second;
+        if (listener.hasPendingUpdate) {
+            mDebugInfo.coalescedUpdates++;
+        }
+        listener.hasPendingUpdate = !forceImmediateCall && !listener.unackedUpdates.empty();
+        if (!listener.hasPendingUpdate) {
+            sendLatestUpdate(listener, deltas);
+        }
     }
 
-    mDelayInfo.reset();
-    updateMaxSendDelay();
+    finishSendDelayIfSent();
+    // Listeners which failed to receive the update do not ack it.
+    reportAckedUpdates();
+}
 
-    // Call the listeners
-    for (auto& pair : mWindowInfosListeners) {
-        auto& [listenerId, listener] = pair.second;
-        auto status = listener->onWindowInfosChanged(update);
-        if (!status.isOk()) {
-            ackWindowInfosReceived(update.vsyncId, listenerId);
+void WindowInfosListenerInvoker::sendLatestUpdate(ListenerState& listener, DeltaCache& deltas) {
+    const gui::WindowInfosUpdate& update = *mLatestUpdate;
+    const gui::WindowInfosUpdate* sentUpdate = &update;
+    auto baseIt = mDeltaListenerBases.find(listener.id);
+    if (baseIt != mDeltaListenerBases.end() && baseIt->second) {
+        const gui::WindowInfosUpdate& base = *baseIt->second;
+        auto [deltaIt, inserted] = deltas.try_emplace(base.generation);
+        if (inserted) {
+            deltaIt->second = makeDeltaUpdate(update, base);
         }
+        if (deltaIt->second) {
+            sentUpdate = &*deltaIt->second;
+        }
+    }
+
+    auto status = listener.listener->onWindowInfosChanged(*sentUpdate);
+    if (sentUpdate->isDelta) {
+        mDebugInfo.deltaUpdatesSent++;
+    } else {
+        mDebugInfo.fullUpdatesSent++;
+    }
+    if (baseIt != mDeltaListenerBases.end()) {
+        baseIt->second = status.isOk() ? mLatestUpdate : nullptr;
+    }
+    if (status.isOk()) {
+        listener.unackedUpdates.push_back(SentUpdate{.vsyncId = update.vsyncId,
+                                                     .generation = update.generation,
+                                                     .sentTime = TimePoint::now().ns()});
+    } else {
+        listener.ackedGeneration = std::max(listener.ackedGeneration, update.generation);
     }
 }
 
+void WindowInfosListenerInvoker::reportAckedUpdates() {
+    int64_t ackedGeneration = mGeneration;
+    for (const auto& pair : mWindowInfosListeners) {
+        ackedGeneration = std::min(ackedGeneration, pair.second.ackedGeneration);
+    }
+
+    while (!mUnreportedListeners.empty() &&
+           mUnreportedListeners.begin()->first <= ackedGeneration) {
+        WindowInfosReportedListenerSet reportedListeners{
+                std::move(mUnreportedListeners.begin()->second)};
+        mUnreportedListeners.erase(mUnreportedListeners.begin());
+
+        for (const auto& reportedListener : reportedListeners) {
+            sp<IBinder> asBinder = IInterface::asBinder(reportedListener);
+            if (asBinder->isBinderAlive()) {
+                reportedListener->onWindowInfosReported();
+            }
+        }
+    }
+}
+
+std::optional<gui::WindowInfosUpdate> WindowInfosListenerInvoker::makeDeltaUpdate(
+        const gui::WindowInfosUpdate& update, const gui::WindowInfosUpdate& base) {
+    SFTRACE_CALL();
+    std::unordered_map<int32_t, const WindowInfo*> baseWindows;
+    baseWindows.reserve(base.windowInfos.size());
+    for (const auto& windowInfo : base.windowInfos) {
+        baseWindows.emplace(windowInfo.id, &windowInfo);
+    }
+
+    gui::WindowInfosUpdate delta;
+    delta.displayInfos = update.displayInfos;
+    delta.vsyncId = update.vsyncId;
+    delta.timestamp = update.timestamp;
+    delta.isDelta = true;
+    delta.generation = update.generation;
+    delta.baseGeneration = base.generation;
+    delta.windowIds.reserve(update.windowInfos.size());
+    for (const auto& windowInfo : update.windowInfos) {
+        delta.windowIds.push_back(windowInfo.id);
+        auto it = baseWindows.find(windowInfo.id);
+        if (it != baseWindows.end() && it->second->hasSameContent(windowInfo)) {
+            continue;
+        }
+        // Sending more than half the windows saves little over a complete update.
+        if (delta.windowInfos.size() * 2 >= update.windowInfos.size()) {
+            return std::nullopt;
+        }
+        delta.windowInfos.push_back(windowInfo);
+    }
+    return delta;
+}
+
+binder::Status WindowInfosListenerInvoker::enableDeltaUpdates(int64_t listenerId) {
+    BackgroundExecutor::getInstance().sendCallbacks({[this, listenerId]() {
+        SFTRACE_NAME("WindowInfosListenerInvoker::enableDeltaUpdates");
+        mDeltaListenerBases[listenerId] = nullptr;
+    }});
+    return binder::Status::ok();
+}
+
 WindowInfosListenerInvoker::DebugInfo WindowInfosListenerInvoker::getDebugInfo() {
     DebugInfo result;
     BackgroundExecutor::getInstance().sendCallbacks({[&, this]() {
         SFTRACE_NAME("WindowInfosListenerInvoker::getDebugInfo");
         updateMaxSendDelay();
         result = mDebugInfo;
-        result.pendingMessageCount = mUnackedState.size();
+        result.pendingMessageCount = 0;
+        for (const auto& pair : mWindowInfosListeners) {
+            result.pendingMessageCount += pair.second.unackedUpdates.size();
+        }
     }});
     BackgroundExecutor::getInstance().flushQueue();
     return result;
@@ -166,39 +257,47 @@ void WindowInfosListenerInvoker::updateMaxSendDelay() {
     }
 }
 
+void WindowInfosListenerInvoker::finishSendDelayIfSent() {
+    for (const auto& pair : mWindowInfosListeners) {
+        if (pair.second.hasPendingUpdate) {
+            return;
+        }
+    }
+    updateMaxSendDelay();
+    mDelayInfo.reset();
+}
+
 binder::Status WindowInfosListenerInvoker::ackWindowInfosReceived(int64_t vsyncId,
                                                                   int64_t listenerId) {
     BackgroundExecutor::getInstance().sendCallbacks({[this, vsyncId, listenerId]() {
         SFTRACE_NAME("WindowInfosListenerInvoker::ackWindowInfosReceived");
-        auto it = mUnackedState.find(vsyncId);
-        if (it == mUnackedState.end()) {
+        ListenerState* listener = findListener(listenerId);
+        if (!listener) {
             return;
         }
-
-        auto& state = it->second;
-        state.unackedListenerIds.unstable_erase(std::find(state.unackedListenerIds.begin(),
-                                                          state.unackedListenerIds.end(),
-                                                          listenerId));
-        if (!state.unackedListenerIds.empty()) {
+        auto& unackedUpdates = listener->unackedUpdates;
+        auto it = std::find_if(unackedUpdates.begin(), unackedUpdates.end(),
+                               [vsyncId](const SentUpdate& sent) {
+                                   return sent.vsyncId == vsyncId;
+                               });
+        if (it == unackedUpdates.end()) {
             return;
         }
 
-        WindowInfosReportedListenerSet reportedListeners{std::move(state.reportedListeners)};
-        mUnackedState.erase(vsyncId);
+        const nsecs_t latency = TimePoint::now().ns() - it->sentTime;
+        mDebugInfo.acksReceived++;
+        mDebugInfo.totalAckLatency += latency;
+        mDebugInfo.maxAckLatency = std::max(mDebugInfo.maxAckLatency, latency);
+        listener->ackedGeneration = std::max(listener->ackedGeneration, it->generation);
+        unackedUpdates.unstable_erase(it);
 
-        for (const auto& reportedListener : reportedListeners) {
-            sp<IBinder> asBinder = IInterface::asBinder(reportedListener);
-            if (asBinder->isBinderAlive()) {
-                reportedListener->onWindowInfosReported();
-            }
-        }
-
-        if (!mDelayedUpdate || !mUnackedState.empty()) {
-            return;
+        if (listener->hasPendingUpdate && unackedUpdates.empty()) {
+            listener->hasPendingUpdate = false;
+            DeltaCache deltas;
+            sendLatestUpdate(*listener, deltas);
+            finishSendDelayIfSent();
         }
-        gui::WindowInfosUpdate update{std::move(*mDelayedUpdate)};
-        mDelayedUpdate.reset();
-        windowInfosChanged(std::move(update), {}, false);
+        reportAckedUpdates();
     }});
     return binder::Status::ok();
 }
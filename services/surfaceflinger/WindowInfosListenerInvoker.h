@@ -16,7 +16,10 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
 #include <optional>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <android/gui/BnWindowInfosPublisher.h>
@@ -47,11 +50,20 @@ public:
                             bool forceImmediateCall);
 
     binder::Status ackWindowInfosReceived(int64_t, int64_t) override;
+    binder::Status enableDeltaUpdates(int64_t listenerId) override;
 
     struct DebugInfo {
         VsyncId maxSendDelayVsyncId;
         nsecs_t maxSendDelayDuration;
         size_t pendingMessageCount;
+        size_t fullUpdatesSent = 0;
+        size_t deltaUpdatesSent = 0;
+        // Updates that a listener was never sent, since a later one replaced them while the
+        // listener had not acked an earlier update yet.
+        size_t coalescedUpdates = 0;
+        size_t acksReceived = 0;
+        nsecs_t totalAckLatency = 0;
+        nsecs_t maxAckLatency = 0;
     };
     DebugInfo getDebugInfo();
 
@@ -61,20 +73,44 @@ protected:
 private:
     static constexpr size_t kStaticCapacity = 3;
     std::atomic<int64_t> mNextListenerId{0};
-    ftl::SmallMap<wp<IBinder>, const std::pair<int64_t, sp<gui::IWindowInfosListener>>,
-                  kStaticCapacity>
-            mWindowInfosListeners;
 
-    std::optional<gui::WindowInfosUpdate> mDelayedUpdate;
+    struct SentUpdate {
+        int64_t vsyncId;
+        int64_t generation;
+        nsecs_t sentTime;
+    };
+    struct ListenerState {
+        int64_t id;
+        sp<gui::IWindowInfosListener> listener;
+        // Updates the listener was sent and has not acked yet. There is only more than one if
+        // updates were forced.
+        ftl::SmallVector<SentUpdate, 2> unackedUpdates;
+        // Whether mLatestUpdate is to be sent to the listener once it acks the updates above.
+        bool hasPendingUpdate = false;
+        // The latest generation which the listener acked, or which it does not need to ack.
+        int64_t ackedGeneration = 0;
+    };
+    ftl::SmallMap<wp<IBinder>, ListenerState, kStaticCapacity> mWindowInfosListeners;
+    ListenerState* findListener(int64_t listenerId);
+
+    // The last update, which is sent to the listeners that are still acking an earlier one once
+    // they ack it.
+    std::shared_ptr<const gui::WindowInfosUpdate> mLatestUpdate;
+    int64_t mGeneration = 0;
+
+    // Deltas of mLatestUpdate, mapped to the generation they are based on.
+    using DeltaCache =
+            std::unordered_map<int64_t /* baseGeneration */, std::optional<gui::WindowInfosUpdate>>;
+    void sendLatestUpdate(ListenerState&, DeltaCache&);
+
+    // Reported listeners of updates that are sent before any window infos listener is added.
     WindowInfosReportedListenerSet mReportedListeners;
+    // Reported listeners, mapped to the generation of their update. They are called once every
+    // listener has acked that generation or a later one.
+    std::map<int64_t /* generation */, WindowInfosReportedListenerSet> mUnreportedListeners;
+    void reportAckedUpdates();
     void eraseListenerAndAckMessages(const wp<IBinder>&);
 
-    struct UnackedState {
-        ftl::SmallVector<int64_t, kStaticCapacity> unackedListenerIds;
-        WindowInfosReportedListenerSet reportedListeners;
-    };
-    ftl::SmallMap<int64_t /* vsyncId */, UnackedState, 5> mUnackedState;
-
     DebugInfo mDebugInfo;
     struct DelayInfo {
         int64_t vsyncId;
@@ -82,6 +118,18 @@ private:
     };
     std::optional<DelayInfo> mDelayInfo;
     void updateMaxSendDelay();
+    // Ends the send delay once no listener is waiting to be sent mLatestUpdate.
+    void finishSendDelayIfSent();
+
+    // Builds an update that only holds the windows of |update| that changed since |base|.
+    // Returns nullopt if most windows changed and a complete update is just as cheap.
+    static std::optional<gui::WindowInfosUpdate> makeDeltaUpdate(
+            const gui::WindowInfosUpdate& update, const gui::WindowInfosUpdate& base);
+
+    // Listeners that accept delta updates, mapped to the last update they were sent, which is
+    // the base of their next delta. Null until they are sent a complete update.
+    std::unordered_map<int64_t /* listenerId */, std::shared_ptr<const gui::WindowInfosUpdate>>
+            mDeltaListenerBases;
 };
 
 } // namespace android
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <malloc.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <utils/Timers.h>
+
+#include <FrontEnd/LayerCreationArgs.h>
+#include <FrontEnd/LayerHierarchy.h>
+#include <FrontEnd/LayerLifecycleManager.h>
+#include <FrontEnd/LayerSnapshotBuilder.h>
+#include <FrontEnd/RequestedLayerState.h>
+#include <Tracing/TransactionProtoParser.h>
+#include <Tracing/TransactionTracing.h>
+#include <TransactionState.h>
+
+// Replays a transaction trace through the front end, the way layertracegenerator does, and
+// measures each stage. Set SF_FRONTEND_REPLAY_TRACE to the path of a trace written by
+// TransactionTracing, such as the one dumped to /data/misc/wmtrace/transactions_trace.winscope,
+// which is also the default. The trace is parsed before the replay, so that the time spent in
+// protobuf is not measured.
+//
+// The front end does not read the clock, so the frames are replayed back to back and the trace's
+// vsync IDs and timestamps only label them. The CPU time of the replaying thread is reported per
+// frame for each stage, along with the heap that each stage grew by and the peak heap and RSS.
+// Set SF_FRONTEND_REPLAY_CSV to a path to also write the measurements of every frame of the last
+// replay there, so that a CI job can look for the frames that regressed.
+
+namespace android::surfaceflinger::frontend {
+namespace {
+
+constexpr char kDefaultTracePath[] = "/data/misc/wmtrace/transactions_trace.winscope";
+
+struct Frame {
+    int64_t vsyncId;
+    int64_t timestamp;
+    std::vector<LayerCreationArgs> addedLayers;
+    std::vector<TransactionState> transactions;
+    std::vector<std::pair<uint32_t, std::string>> destroyedHandles;
+    std::optional<ui::DisplayMap<ui::LayerStack, DisplayInfo>> displays;
+
+    size_t stateCount() const {
+        size_t count = 0;
+        for (const auto& transaction : transactions) {
+            count += transaction.states.size();
+        }
+        return count;
+    }
+};
+
+std::optional<std::vector<Frame>> readTrace(const char* path) {
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+    perfetto::protos::TransactionTraceFile traceFile;
+    if (!input || !traceFile.ParseFromIstream(&input)) {
+        return std::nullopt;
+    }
+
+    TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+    std::vector<Frame> frames;
+    frames.reserve(static_cast<size_t>(traceFile.entry_size()));
+    for (const auto& entry : traceFile.entry()) {
+        Frame frame{.vsyncId = entry.vsync_id(), .timestamp = entry.elapsed_realtime_nanos()};
+        for (const auto& layer : entry.added_layers()) {
+            parser.fromProto(layer, frame.addedLayers.emplace_back());
+        }
+        for (const auto& transactionProto : entry.transactions()) {
+            TransactionState transaction = parser.fromProto(transactionProto);
+            for (auto& resolvedComposerState : transaction.states) {
+                if (resolvedComposerState.state.what & layer_state_t::eInputInfoChanged &&
+                    !resolvedComposerState.state.windowInfoHandle->getInfo()->inputConfig.test(
+                            gui::WindowInfo::InputConfig::NO_INPUT_CHANNEL)) {
+                    // The front end expects a valid token, as in layertracegenerator.
+                    resolvedComposerState.state.windowInfoHandle->editInfo()->token =
+                            sp<BBinder>::make();
+                }
+            }
+            frame.transactions.emplace_back(std::move(transaction));
+        }
+        for (const auto handle : entry.destroyed_layer_handles()) {
+            frame.destroyedHandles.push_back({handle, ""});
+        }
+        if (entry.displays_changed()) {
+            parser.fromProto(entry.displays(), frame.displays.emplace());
+        }
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+enum Stage : size_t { kLifecycle, kHierarchy, kSnapshots, kStageCount };
+constexpr std::array<const char*, kStageCount> kStageNames = {"lifecycle", "hierarchy",
+                                                              "snapshots"};
+
+struct FrameStats {
+    std::array<nsecs_t, kStageCount> cpuTime{};
+    std::array<int64_t, kStageCount> heapGrowth{};
+    size_t layers = 0;
+    size_t snapshots = 0;
+};
+
+size_t heapInUse() {
+    return mallinfo().uordblks;
+}
+
+// Measures the thread CPU time and heap growth of a stage of a frame.
+class StageTimer {
+public:
+    StageTimer(FrameStats& stats, Stage stage)
+          : mStats(stats),
+            mStage(stage),
+            mStartHeap(heapInUse()),
+            mStartTime(systemTime(SYSTEM_TIME_THREAD)) {}
+
+    ~StageTimer() {
+        mStats.cpuTime[mStage] = systemTime(SYSTEM_TIME_THREAD) - mStartTime;
+        mStats.heapGrowth[mStage] =
+                static_cast<int64_t>(heapInUse()) - static_cast<int64_t>(mStartHeap);
+    }
+
+private:
+    FrameStats& mStats;
+    const Stage mStage;
+    const size_t mStartHeap;
+    const nsecs_t mStartTime;
+};
+
+struct ReplayStats {
+    std::vector<FrameStats> frames;
+    size_t peakHeap = 0;
+};
+
+void replay(const std::vector<Frame>& frames, ReplayStats& stats) {
+    LayerLifecycleManager lifecycleManager;
+    LayerHierarchyBuilder hierarchyBuilder;
+    LayerSnapshotBuilder snapshotBuilder;
+    ui::DisplayMap<ui::LayerStack, DisplayInfo> displayInfos;
+    const ShadowSettings globalShadowSettings{.ambientColor = {1, 1, 1, 1}};
+
+    // Allocated up front, so that the stats are not counted as the growth of a stage.
+    stats.frames.assign(frames.size(), {});
+    stats.peakHeap = heapInUse();
+    for (size_t i = 0; i < frames.size(); i++) {
+        const Frame& frame = frames[i];
+        FrameStats& frameStats = stats.frames[i];
+
+        // The layers are moved into the lifecycle manager, so they are created for every replay.
+        std::vector<std::unique_ptr<RequestedLayerState>> addedLayers;
+        addedLayers.reserve(frame.addedLayers.size());
+        for (const auto& args : frame.addedLayers) {
+            addedLayers.emplace_back(std::make_unique<RequestedLayerState>(args));
+        }
+        if (frame.displays) {
+            displayInfos = *frame.displays;
+        }
+
+        {
+            StageTimer timer(frameStats, kLifecycle);
+            lifecycleManager.addLayers(std::move(addedLayers));
+            lifecycleManager.applyTransactions(frame.transactions, /*ignoreUnknownLayers=*/true);
+            lifecycleManager.onHandlesDestroyed(frame.destroyedHandles,
+                                                /*ignoreUnknownHandles=*/true);
+        }
+        {
+            StageTimer timer(frameStats, kHierarchy);
+            hierarchyBuilder.update(lifecycleManager);
+        }
+        {
+            StageTimer timer(frameStats, kSnapshots);
+            snapshotBuilder.update({.root = hierarchyBuilder.getHierarchy(),
+                                    .layerLifecycleManager = lifecycleManager,
+                                    .displays = displayInfos,
+                                    .displayChanges = frame.displays.has_value(),
+                                    .globalShadowSettings = globalShadowSettings,
+                                    .supportsBlur = true,
+                                    .forceFullDamage = false,
+                                    .supportedLayerGenericMetadata = {},
+                                    .genericLayerMetadataKeyMap = {}});
+        }
+        lifecycleManager.commitChanges();
+
+        frameStats.layers = lifecycleManager.getLayers().size();
+        frameStats.snapshots = snapshotBuilder.getSnapshots().size();
+        stats.peakHeap = std::max(stats.peakHeap, heapInUse());
+    }
+}
+
+double percentile(std::vector<nsecs_t> times, double fraction) {
+    if (times.empty()) return 0.0;
+    const auto nth = times.begin() +
+            static_cast<std::ptrdiff_t>(fraction * static_cast<double>(times.size() - 1));
+    std::nth_element(times.begin(), nth, times.end());
+    return static_cast<double>(*nth);
+}
+
+void writeCsv(const char* path, const std::vector<Frame>& frames, const ReplayStats& stats) {
+    std::ofstream csv(path);
+    csv << "vsync_id,timestamp_ns,transactions,states,layers,snapshots";
+    for (const char* name : kStageNames) {
+        csv << "," << name << "_cpu_ns," << name << "_heap_bytes";
+    }
+    csv << "\n";
+    for (size_t i = 0; i < frames.size(); i++) {
+        const FrameStats& frameStats = stats.frames[i];
+        csv << frames[i].vsyncId << "," << frames[i].timestamp << ","
+            << frames[i].transactions.size() << "," << frames[i].stateCount() << ","
+            << frameStats.layers << "," << frameStats.snapshots;
+        for (size_t stage = 0; stage < kStageCount; stage++) {
+            csv << "," << frameStats.cpuTime[stage] << "," << frameStats.heapGrowth[stage];
+        }
+        csv << "\n";
+    }
+}
+
+void replayTransactionTrace(benchmark::State& state) {
+    const char* path = std::getenv("SF_FRONTEND_REPLAY_TRACE");
+    const std::optional<std::vector<Frame>> frames = readTrace(path ? path : kDefaultTracePath);
+    if (!frames) {
+        state.SkipWithError("Failed to read SF_FRONTEND_REPLAY_TRACE");
+        return;
+    }
+    if (frames->empty()) {
+        state.SkipWithError("The trace has no entries");
+        return;
+    }
+
+    ReplayStats stats;
+    std::array<std::vector<nsecs_t>, kStageCount> cpuTimes;
+    std::array<int64_t, kStageCount> heapGrowth{};
+    size_t peakHeap = 0;
+    for (auto _ : state) {
+        replay(*frames, stats);
+        benchmark::DoNotOptimize(stats);
+
+        state.PauseTiming();
+        for (const FrameStats& frameStats : stats.frames) {
+            for (size_t stage = 0; stage < kStageCount; stage++) {
+                cpuTimes[stage].push_back(frameStats.cpuTime[stage]);
+                heapGrowth[stage] += frameStats.heapGrowth[stage];
+            }
+        }
+        peakHeap = std::max(peakHeap, stats.peakHeap);
+        state.ResumeTiming();
+    }
+
+    const double frameCount = static_cast<double>(cpuTimes[kLifecycle].size());
+    state.SetItemsProcessed(static_cast<int64_t>(frameCount));
+    state.counters["frames"] = static_cast<double>(frames->size());
+    for (size_t stage = 0; stage < kStageCount; stage++) {
+        const std::string name = kStageNames[stage];
+        state.counters[name + "P50Us"] = percentile(cpuTimes[stage], 0.5) / 1e3;
+        state.counters[name + "P90Us"] = percentile(cpuTimes[stage], 0.9) / 1e3;
+        state.counters[name + "P99Us"] = percentile(cpuTimes[stage], 0.99) / 1e3;
+        state.counters[name + "MaxUs"] = percentile(cpuTimes[stage], 1.0) / 1e3;
+        state.counters[name + "HeapBytesPerFrame"] =
+                static_cast<double>(heapGrowth[stage]) / frameCount;
+    }
+    state.counters["peakHeapKiB"] = static_cast<double>(peakHeap) / 1024;
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        state.counters["maxRssKiB"] = static_cast<double>(usage.ru_maxrss);
+    }
+
+    if (const char* csvPath = std::getenv("SF_FRONTEND_REPLAY_CSV")) {
+        writeCsv(csvPath, *frames, stats);
+    }
+}
+BENCHMARK(replayTransactionTrace)->Unit(benchmark::kMillisecond);
+
+} // namespace
+} // namespace android::surfaceflinger::frontend
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <Scheduler/LayerInfo.h>
+#include <Scheduler/RefreshRateSelector.h>
+#include <Scheduler/VSyncPredictor.h>
+#include <mock/DisplayHardware/MockDisplayMode.h>
+
+// Replays a trace of hardware vsyncs and layer presents through the refresh rate heuristics and
+// the vsync model, using the trace timestamps as the clock. Set SF_SCHEDULER_REPLAY_TRACE to the
+// path of a text file with one event per line:
+//
+//   mode <fps>                          A display mode the selector can choose.
+//   vsync <timestamp ns>                A hardware vsync.
+//   present <timestamp ns> <layer id>   A buffer presented by a layer.
+//
+// Lines starting with '#' are ignored, and events may be listed in any order. Events extracted
+// from a Perfetto trace can be written in this format. Without a trace, a synthetic one with a
+// video followed by scrolling is replayed.
+//
+// Reports how many frames SF woke up for at each selected refresh rate, the number of mode
+// switches, and the mean error of the vsync predicted before each hardware vsync arrived. The
+// time per item is the CPU time spent per frame.
+//
+// LayerHistory needs real Layers, so the replay keeps a LayerInfo per layer and summarizes the
+// ones that are active the same way, with each layer covering the whole display. The trace's
+// vsyncs are fed to the predictor as they are, so its ideal period is that of the mode closest to
+// the trace's median vsync interval, and not the selected mode.
+
+namespace android::scheduler {
+namespace {
+
+constexpr size_t kHistorySize = 20;
+constexpr size_t kMinimumSamplesForPrediction = 6;
+constexpr uint32_t kOutlierTolerancePercent = 25;
+
+struct TraceEvent {
+    enum class Type { Vsync, Present };
+
+    Type type;
+    nsecs_t timestamp;
+    int32_t layerId = 0;
+};
+
+struct Trace {
+    std::vector<Fps> modes;
+    std::vector<TraceEvent> events;
+};
+
+void sortEvents(Trace& trace) {
+    std::stable_sort(trace.events.begin(), trace.events.end(),
+                     [](const TraceEvent& lhs, const TraceEvent& rhs) {
+                         return lhs.timestamp < rhs.timestamp;
+                     });
+}
+
+std::optional<Trace> readTrace(const char* path) {
+    std::ifstream file(path);
+    if (!file) {
+        return std::nullopt;
+    }
+
+    Trace trace;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string type;
+        if (!(stream >> type) || type.front() == '#') {
+            continue;
+        }
+
+        float fps;
+        nsecs_t timestamp;
+        int32_t layerId;
+        if (type == "mode" && stream >> fps) {
+            trace.modes.push_back(Fps::fromValue(fps));
+        } else if (type == "vsync" && stream >> timestamp) {
+            trace.events.push_back({TraceEvent::Type::Vsync, timestamp});
+        } else if (type == "present" && stream >> timestamp >> layerId) {
+            trace.events.push_back({TraceEvent::Type::Present, timestamp, layerId});
+        }
+    }
+
+    sortEvents(trace);
+    return trace;
+}
+
+// Hardware vsyncs at 120Hz with some jitter, a 24fps video for 4s, scrolling at 60fps for 2s,
+// and then 2s of idle.
+Trace synthesizeTrace() {
+    using namespace std::chrono_literals;
+
+    Trace trace{.modes = {60_Hz, 90_Hz, 120_Hz}};
+
+    constexpr nsecs_t kJitter = 100'000;
+    std::mt19937 generator(0);
+    std::uniform_int_distribution<nsecs_t> jitter(-kJitter, kJitter);
+
+    const nsecs_t videoEnd = std::chrono::nanoseconds(4s).count();
+    const nsecs_t scrollEnd = std::chrono::nanoseconds(6s).count();
+    const nsecs_t traceEnd = std::chrono::nanoseconds(8s).count();
+
+    for (nsecs_t time = 0; time < traceEnd; time += (120_Hz).getPeriodNsecs()) {
+        trace.events.push_back({TraceEvent::Type::Vsync, time + jitter(generator)});
+    }
+    for (nsecs_t time = 0; time < videoEnd; time += (24_Hz).getPeriodNsecs()) {
+        trace.events.push_back({TraceEvent::Type::Present, time, 1});
+    }
+    for (nsecs_t time = videoEnd; time < scrollEnd; time += (60_Hz).getPeriodNsecs()) {
+        trace.events.push_back({TraceEvent::Type::Present, time, 2});
+    }
+
+    sortEvents(trace);
+    return trace;
+}
+
+class SimulatedClock : public Clock {
+public:
+    explicit SimulatedClock(const nsecs_t& now) : mNow(now) {}
+
+    nsecs_t now() const override { return mNow; }
+
+private:
+    const nsecs_t& mNow;
+};
+
+struct ReplayStats {
+    size_t wakeups = 0;
+    size_t modeSwitches = 0;
+    size_t rejectedVsyncs = 0;
+    size_t predictions = 0;
+    double totalPredictionErrorNs = 0;
+    // Keyed by the integer render rate.
+    std::map<int, size_t> wakeupsPerRenderRate;
+};
+
+using LayerInfos = std::map<int32_t, std::unique_ptr<LayerInfo>>;
+
+DisplayModePtr closestModeToMedianVsyncInterval(const Trace& trace, const DisplayModes& modes) {
+    std::vector<nsecs_t> intervals;
+    std::optional<nsecs_t> lastVsync;
+    for (const auto& event : trace.events) {
+        if (event.type != TraceEvent::Type::Vsync) continue;
+        if (lastVsync) {
+            intervals.push_back(event.timestamp - *lastVsync);
+        }
+        lastVsync = event.timestamp;
+    }
+
+    if (intervals.empty()) {
+        return modes.begin()->second;
+    }
+
+    const auto median = intervals.begin() + static_cast<std::ptrdiff_t>(intervals.size() / 2);
+    std::nth_element(intervals.begin(), median, intervals.end());
+    return std::min_element(modes.begin(), modes.end(),
+                            [median](const auto& lhs, const auto& rhs) {
+                                return std::abs(lhs.second->getVsyncRate().getPeriodNsecs() -
+                                                *median) <
+                                        std::abs(rhs.second->getVsyncRate().getPeriodNsecs() -
+                                                 *median);
+                            })
+            ->second;
+}
+
+// Summarizes the active layers, and switches to the best ranked mode. Returns whether the mode
+// changed.
+bool selectMode(RefreshRateSelector& selector, LayerInfos& layers, nsecs_t now) {
+    const nsecs_t threshold = getActiveLayerThreshold(now);
+
+    std::vector<RefreshRateSelector::LayerRequirement> summary;
+    for (const auto& [id, info] : layers) {
+        if (info->getLastUpdatedTime() < threshold) {
+            info->onLayerInactive(now);
+            continue;
+        }
+
+        for (const LayerInfo::LayerVote& vote : info->getRefreshRateVote(selector, now)) {
+            if (vote.isNoVote()) continue;
+            summary.push_back({info->getName(), info->getOwnerUid(), vote.type, vote.fps,
+                               vote.seamlessness, vote.category, vote.categorySmoothSwitchOnly,
+                               /*weight*/ 1.f, /*focused*/ true});
+        }
+    }
+
+    const FrameRateMode mode =
+            selector.getRankedFrameRates(summary, {}).ranking.front().frameRateMode;
+    if (mode == selector.getActiveMode()) {
+        return false;
+    }
+    selector.setActiveMode(mode.modePtr->getId(), mode.fps);
+    return true;
+}
+
+ReplayStats replay(const Trace& trace) {
+    DisplayModes modes;
+    for (size_t i = 0; i < trace.modes.size(); i++) {
+        const DisplayModeId modeId(static_cast<int32_t>(i));
+        modes.try_emplace(modeId, mock::createDisplayMode(modeId, trace.modes[i]));
+    }
+    const DisplayModePtr vsyncMode = closestModeToMedianVsyncInterval(trace, modes);
+    RefreshRateSelector selector(std::move(modes), vsyncMode->getId());
+
+    nsecs_t now = trace.events.front().timestamp;
+    VSyncPredictor predictor(std::make_unique<SimulatedClock>(now), ftl::as_non_null(vsyncMode),
+                             kHistorySize, kMinimumSamplesForPrediction, kOutlierTolerancePercent);
+
+    const LayerProps props{.visible = true};
+    LayerInfos layers;
+    ReplayStats stats;
+
+    // Whether a layer presented since the last vsync, so SF wakes up for the next one.
+    bool framePending = false;
+    std::optional<nsecs_t> lastVsync;
+
+    for (const auto& event : trace.events) {
+        now = event.timestamp;
+
+        switch (event.type) {
+            case TraceEvent::Type::Present: {
+                auto& info = layers[event.layerId];
+                if (!info) {
+                    info = std::make_unique<LayerInfo>("layer " + std::to_string(event.layerId),
+                                                       /*ownerUid*/ 0,
+                                                       LayerHistory::LayerVoteType::Heuristic);
+                }
+                info->setLastPresentTime(now, now, LayerHistory::LayerUpdateType::Buffer,
+                                         /*pendingModeChange*/ false, props);
+                framePending = true;
+                break;
+            }
+            case TraceEvent::Type::Vsync: {
+                if (lastVsync) {
+                    const nsecs_t predicted = predictor.nextAnticipatedVSyncTimeFrom(
+                            *lastVsync + predictor.currentPeriod() / 2);
+                    stats.totalPredictionErrorNs += static_cast<double>(std::abs(predicted - now));
+                    stats.predictions++;
+                }
+                if (!predictor.addVsyncTimestamp(now)) {
+                    stats.rejectedVsyncs++;
+                }
+                lastVsync = now;
+
+                if (!framePending) break;
+                framePending = false;
+
+                stats.wakeups++;
+                if (selectMode(selector, layers, now)) {
+                    stats.modeSwitches++;
+                }
+                stats.wakeupsPerRenderRate[selector.getActiveMode().fps.getIntValue()]++;
+                break;
+            }
+        }
+    }
+
+    return stats;
+}
+
+void replayTrace(benchmark::State& state) {
+    const char* const path = std::getenv("SF_SCHEDULER_REPLAY_TRACE");
+    const std::optional<Trace> trace = path ? readTrace(path) : synthesizeTrace();
+    if (!trace) {
+        state.SkipWithError("Failed to read SF_SCHEDULER_REPLAY_TRACE");
+        return;
+    }
+    if (trace->modes.empty() || trace->events.empty()) {
+        state.SkipWithError("The trace needs at least one mode and one event");
+        return;
+    }
+
+    ReplayStats stats;
+    for (auto _ : state) {
+        stats = replay(*trace);
+        benchmark::DoNotOptimize(stats);
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(stats.wakeups));
+    state.counters["wakeups"] = static_cast<double>(stats.wakeups);
+    state.counters["modeSwitches"] = static_cast<double>(stats.modeSwitches);
+    state.counters["rejectedVsyncs"] = static_cast<double>(stats.rejectedVsyncs);
+    state.counters["vsyncErrorNs"] = stats.predictions == 0
+            ? 0.0
+            : stats.totalPredictionErrorNs / static_cast<double>(stats.predictions);
+    for (const auto& [renderRate, wakeups] : stats.wakeupsPerRenderRate) {
+        state.counters["wakeupsAt" + std::to_string(renderRate) + "Hz"] =
+                static_cast<double>(wakeups);
+    }
+}
+BENCHMARK(replayTrace)->Unit(benchmark::kMillisecond);
+
+} // namespace
+} // namespace android::scheduler
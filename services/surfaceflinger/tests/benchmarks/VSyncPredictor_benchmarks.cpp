@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <memory>
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include <Scheduler/VSyncPredictor.h>
+#include <mock/DisplayHardware/MockDisplayMode.h>
+
+namespace android::scheduler {
+
+namespace {
+
+constexpr nsecs_t kPeriod = 16'666'667;
+constexpr size_t kHistorySize = 20;
+constexpr size_t kMinimumSamplesForPrediction = 6;
+constexpr uint32_t kOutlierTolerancePercent = 25;
+
+class FakeClock : public Clock {
+public:
+    nsecs_t now() const override { return 0; }
+};
+
+// Feeds hardware vsyncs with a small jitter, and with one in kOutlierInterval of them late by a
+// fifth of the period, which is still accepted as a valid sample. Reports the time taken to add a
+// timestamp and the mean absolute error of the fitted period.
+void addVsyncTimestamp(benchmark::State& state, VSyncPredictor::ModelFit modelFit) {
+    constexpr nsecs_t kJitter = 100'000;
+    const int outlierInterval = static_cast<int>(state.range(0));
+
+    VSyncPredictor predictor(std::make_unique<FakeClock>(),
+                             ftl::as_non_null(mock::createDisplayMode(DisplayModeId(0),
+                                                                      Fps::fromPeriodNsecs(
+                                                                              kPeriod))),
+                             kHistorySize, kMinimumSamplesForPrediction, kOutlierTolerancePercent);
+    predictor.setModelFit(modelFit);
+
+    std::mt19937 generator(0);
+    std::uniform_int_distribution<nsecs_t> jitter(-kJitter, kJitter);
+
+    nsecs_t vsync = 0;
+    int count = 0;
+    double totalError = 0;
+    int resets = 0;
+    for (auto _ : state) {
+        vsync += kPeriod;
+        nsecs_t timestamp = vsync + jitter(generator);
+        if (++count % outlierInterval == 0) {
+            timestamp += kPeriod / 5;
+        }
+        if (!predictor.addVsyncTimestamp(timestamp)) {
+            resets++;
+        }
+        totalError += static_cast<double>(std::abs(predictor.currentPeriod() - kPeriod));
+    }
+
+    state.counters["periodErrorNs"] = totalError / static_cast<double>(count);
+    state.counters["rejected"] = resets;
+}
+
+void leastSquares(benchmark::State& state) {
+    addVsyncTimestamp(state, VSyncPredictor::ModelFit::LeastSquares);
+}
+BENCHMARK(leastSquares)->Arg(5)->Arg(20);
+
+void theilSen(benchmark::State& state) {
+    addVsyncTimestamp(state, VSyncPredictor::ModelFit::TheilSen);
+}
+BENCHMARK(theilSen)->Arg(5)->Arg(20);
+
+} // namespace
+} // namespace android::scheduler
@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Drives SurfaceFlinger::commit and SurfaceFlinger::composite over synthetic layer trees, with a
+// fake HWC and RenderEngine, and reports the time spent in each stage per frame.
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <ftl/enum.h>
+#include <ftl/future.h>
+#include <gmock/gmock.h>
+#include <gui/fake/BufferData.h>
+
+#include <compositionengine/Display.h>
+#include <compositionengine/mock/DisplaySurface.h>
+#include <renderengine/mock/FakeExternalTexture.h>
+#include <renderengine/mock/RenderEngine.h>
+
+#include "FrontEnd/RequestedLayerState.h"
+#include "Layer.h"
+#include "TestableSurfaceFlinger.h"
+#include "TimeStats/TimeStats.h"
+#include "mock/DisplayHardware/MockComposer.h"
+#include "mock/DisplayHardware/MockPowerAdvisor.h"
+#include "mock/system/window/MockNativeWindow.h"
+
+namespace android::surfaceflinger {
+
+namespace {
+
+using testing::_;
+using testing::DoAll;
+using testing::NiceMock;
+using testing::Return;
+using testing::ReturnRef;
+using testing::SetArgPointee;
+
+using FakeHwcDisplayInjector = TestableSurfaceFlinger::FakeHwcDisplayInjector;
+using FakeDisplayDeviceInjector = TestableSurfaceFlinger::FakeDisplayDeviceInjector;
+using LatencyStage = TimeStats::LatencyStage;
+using namespace std::chrono_literals;
+
+constexpr PhysicalDisplayId kPrimaryDisplayId = PhysicalDisplayId::fromPort(42u);
+constexpr hal::HWDisplayId kPrimaryHwcDisplayId = FakeHwcDisplayInjector::DEFAULT_HWC_DISPLAY_ID;
+constexpr int kDisplayWidth = 1920;
+constexpr int kDisplayHeight = 1080;
+constexpr uint32_t kBufferSize = 256;
+constexpr uint64_t kBufferUsage = GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_COMPOSER;
+
+// Every kEffectInterval'th layer draws the scene's effect, forcing it to client composition.
+constexpr uint32_t kEffectInterval = 8;
+
+enum class Effect { None, Shadow, Blur };
+
+struct SceneArgs {
+    uint32_t layerCount;
+    // The number of layers in each chain of parent and child layers.
+    uint32_t hierarchyDepth;
+    // How many of the layers latch a new buffer each frame.
+    uint32_t bufferUpdatePercent;
+    uint32_t displayCount;
+    Effect effect;
+
+    static SceneArgs from(const benchmark::State& state) {
+        return {.layerCount = static_cast<uint32_t>(state.range(0)),
+                .hierarchyDepth = static_cast<uint32_t>(state.range(1)),
+                .bufferUpdatePercent = static_cast<uint32_t>(state.range(2)),
+                .displayCount = static_cast<uint32_t>(state.range(3)),
+                .effect = static_cast<Effect>(state.range(4))};
+    }
+};
+
+class SyntheticScene {
+public:
+    explicit SyntheticScene(const SceneArgs& args) : mArgs(args) {
+        mFlinger.setupMockScheduler({.displayId = kPrimaryDisplayId, .useNiceMock = true});
+        mFlinger.setupRenderEngine(std::unique_ptr<renderengine::RenderEngine>(mRenderEngine));
+        mFlinger.setupComposer(std::unique_ptr<Hwc2::Composer>(mComposer));
+        mFlinger.setupPowerAdvisor(std::unique_ptr<Hwc2::PowerAdvisor>(mPowerAdvisor));
+        mFlinger.setupDefaultTimeStats();
+
+        ON_CALL(*mComposer, createLayer(_, _))
+                .WillByDefault([this](Hwc2::Display, Hwc2::Layer* outLayer) {
+                    *outLayer = mNextHwcLayerId++;
+                    return hal::Error::NONE;
+                });
+        ON_CALL(*mRenderEngine, drawLayers)
+                .WillByDefault([](const renderengine::DisplaySettings&,
+                                  const std::vector<renderengine::LayerSettings>&,
+                                  const std::shared_ptr<renderengine::ExternalTexture>&,
+                                  base::unique_fd&&) -> ftl::Future<FenceResult> {
+                    return ftl::yield<FenceResult>(Fence::NO_FENCE);
+                });
+
+        for (uint32_t i = 0; i < mArgs.displayCount; i++) {
+            injectDisplay(i);
+        }
+        // Rebuild the front end's display infos from the injected displays on the first commit.
+        mFlinger.mutableTransactionFlags() |= eDisplayTransactionNeeded;
+
+        createLayers();
+    }
+
+    // Latches a new buffer on the next bufferUpdatePercent of the layers, then commits and
+    // composites a frame.
+    void runFrame() {
+        TransactionState transaction;
+        transaction.applyToken = mApplyToken;
+        transaction.isAutoTimestamp = true;
+
+        const uint32_t updates = mArgs.layerCount * mArgs.bufferUpdatePercent / 100;
+        for (uint32_t i = 0; i < updates; i++) {
+            const uint32_t layerId = mLayerIds[mNextUpdatedLayer];
+            mNextUpdatedLayer = (mNextUpdatedLayer + 1) % mLayerIds.size();
+
+            ResolvedComposerState& state = transaction.states.emplace_back();
+            setNewBuffer(state, layerId);
+        }
+        if (!transaction.states.empty()) {
+            mFlinger.setTransactionStateInternal(transaction);
+        }
+
+        const TimePoint frameTime = scheduler::SchedulerClock::now();
+        mFlinger.commitAndComposite(frameTime, VsyncId{mNextVsyncId++}, frameTime + Period(16ms));
+    }
+
+    impl::TimeStats& timeStats() { return static_cast<impl::TimeStats&>(mFlinger.getTimeStats()); }
+
+private:
+    void injectDisplay(uint32_t index) {
+        const bool isPrimary = index == 0;
+        const auto displayId = PhysicalDisplayId::fromPort(static_cast<uint8_t>(42u + index));
+        const hal::HWDisplayId hwcDisplayId = kPrimaryHwcDisplayId + index;
+
+        FakeHwcDisplayInjector(displayId, hal::DisplayType::PHYSICAL, isPrimary)
+                .setHwcDisplayId(hwcDisplayId)
+                .setPowerMode(hal::PowerMode::ON)
+                .inject(&mFlinger, mComposer);
+
+        auto nativeWindow = sp<NiceMock<android::mock::NativeWindow>>::make();
+        ON_CALL(*nativeWindow, query(NATIVE_WINDOW_WIDTH, _))
+                .WillByDefault(DoAll(SetArgPointee<1>(kDisplayWidth), Return(0)));
+        ON_CALL(*nativeWindow, query(NATIVE_WINDOW_HEIGHT, _))
+                .WillByDefault(DoAll(SetArgPointee<1>(kDisplayHeight), Return(0)));
+        ON_CALL(*nativeWindow, dequeueBuffer(_, _))
+                .WillByDefault(DoAll(SetArgPointee<0>(mClientTargetBuffer->getNativeBuffer()),
+                                     SetArgPointee<1>(-1), Return(0)));
+
+        auto displaySurface = sp<NiceMock<compositionengine::mock::DisplaySurface>>::make();
+        ON_CALL(*displaySurface, getClientTargetAcquireFence())
+                .WillByDefault(ReturnRef(mClientTargetAcquireFence));
+
+        auto compositionDisplay = compositionengine::impl::createDisplay(
+                mFlinger.getCompositionEngine(),
+                compositionengine::DisplayCreationArgsBuilder()
+                        .setId(displayId)
+                        .setPixels({kDisplayWidth, kDisplayHeight})
+                        .setPowerAdvisor(mPowerAdvisor)
+                        .setName("Synthetic display " + std::to_string(index))
+                        .build());
+
+        FakeDisplayDeviceInjector injector(mFlinger, compositionDisplay,
+                                           ui::DisplayConnectionType::Internal, hwcDisplayId,
+                                           isPrimary);
+        injector.setDisplaySurface(displaySurface)
+                .setNativeWindow(nativeWindow)
+                .setPowerMode(hal::PowerMode::ON)
+                .skipSchedulerRegistration();
+        if (isPrimary) {
+            injector.setRefreshRateSelector(mFlinger.scheduler()->refreshRateSelector());
+        }
+        sp<DisplayDevice> display = injector.inject();
+        display->setLayerFilter({layerStackForDisplay(index), /*toInternalDisplay=*/true});
+
+        mNativeWindows.push_back(std::move(nativeWindow));
+        mDisplaySurfaces.push_back(std::move(displaySurface));
+    }
+
+    static ui::LayerStack layerStackForDisplay(uint32_t index) {
+        return ui::LayerStack::fromValue(index + 1);
+    }
+
+    // Creates the layers as chains of hierarchyDepth layers, and assigns the chains to the
+    // displays in turn. Each layer gets an initial buffer and its own position.
+    void createLayers() {
+        TransactionState transaction;
+        transaction.applyToken = mApplyToken;
+        transaction.isAutoTimestamp = true;
+
+        const uint32_t depth = std::max(mArgs.hierarchyDepth, 1u);
+        std::optional<uint32_t> parentId;
+        for (uint32_t i = 0; i < mArgs.layerCount; i++) {
+            const uint32_t layerId = i + 1;
+            const uint32_t chain = i / depth;
+            if (i % depth == 0) {
+                parentId.reset();
+            }
+
+            LayerCreationArgs args(std::make_optional(layerId));
+            args.flinger = mFlinger.flinger();
+            args.name = "SyntheticLayer#" + std::to_string(layerId);
+            args.addToRoot = !parentId;
+            if (parentId) {
+                args.parentId = *parentId;
+            }
+            mFlinger.injectLegacyLayer(sp<Layer>::make(args));
+            auto layer = std::make_unique<frontend::RequestedLayerState>(args);
+            mFlinger.addLayer(layer);
+
+            ResolvedComposerState& state = transaction.states.emplace_back();
+            setNewBuffer(state, layerId);
+            state.state.what |= layer_state_t::ePositionChanged;
+            // Children are offset from their parent, so chains spread across the display.
+            state.state.x = parentId ? 8.f : static_cast<float>((chain * 37) % kDisplayWidth);
+            state.state.y = parentId ? 8.f : static_cast<float>((chain * 23) % kDisplayHeight);
+            if (!parentId) {
+                state.state.what |= layer_state_t::eLayerStackChanged;
+                state.state.layerStack = layerStackForDisplay(chain % mArgs.displayCount);
+            }
+            if (i % kEffectInterval == 0) {
+                applyEffect(state);
+            }
+
+            mLayerIds.push_back(layerId);
+            parentId = layerId;
+        }
+        mFlinger.setTransactionStateInternal(transaction);
+    }
+
+    void applyEffect(ResolvedComposerState& state) const {
+        switch (mArgs.effect) {
+            case Effect::None:
+                break;
+            case Effect::Shadow:
+                state.state.what |= layer_state_t::eShadowRadiusChanged;
+                state.state.shadowRadius = 24.f;
+                break;
+            case Effect::Blur:
+                state.state.what |= layer_state_t::eBackgroundBlurRadiusChanged;
+                state.state.backgroundBlurRadius = 40;
+                break;
+        }
+    }
+
+    void setNewBuffer(ResolvedComposerState& state, uint32_t layerId) {
+        const uint64_t bufferId = mNextBufferId++;
+        state.state.what |= layer_state_t::eBufferChanged;
+        state.state.bufferData =
+                std::make_shared<fake::BufferData>(bufferId, kBufferSize, kBufferSize,
+                                                   HAL_PIXEL_FORMAT_RGBA_8888, kBufferUsage);
+        state.externalTexture =
+                std::make_shared<renderengine::mock::FakeExternalTexture>(kBufferSize,
+                                                                          kBufferSize, bufferId,
+                                                                          HAL_PIXEL_FORMAT_RGBA_8888,
+                                                                          kBufferUsage);
+        state.state.surface = mFlinger.getLegacyLayer(layerId)->getHandle();
+        state.layerId = static_cast<int32_t>(layerId);
+    }
+
+    const SceneArgs mArgs;
+
+    TestableSurfaceFlinger mFlinger;
+    NiceMock<renderengine::mock::RenderEngine>* mRenderEngine =
+            new NiceMock<renderengine::mock::RenderEngine>();
+    NiceMock<Hwc2::mock::Composer>* mComposer = new NiceMock<Hwc2::mock::Composer>();
+    NiceMock<Hwc2::mock::PowerAdvisor>* mPowerAdvisor = new NiceMock<Hwc2::mock::PowerAdvisor>();
+
+    std::vector<sp<android::mock::NativeWindow>> mNativeWindows;
+    std::vector<sp<compositionengine::mock::DisplaySurface>> mDisplaySurfaces;
+    sp<GraphicBuffer> mClientTargetBuffer =
+            sp<GraphicBuffer>::make(1u, 1u, PIXEL_FORMAT_RGBA_8888,
+                                    GRALLOC_USAGE_SW_WRITE_OFTEN | GRALLOC_USAGE_SW_READ_OFTEN);
+    sp<Fence> mClientTargetAcquireFence = Fence::NO_FENCE;
+    const sp<IBinder> mApplyToken = sp<BBinder>::make();
+
+    std::vector<uint32_t> mLayerIds;
+    size_t mNextUpdatedLayer = 0;
+    uint64_t mNextBufferId = 1;
+    Hwc2::Layer mNextHwcLayerId = 1;
+    int64_t mNextVsyncId = 1;
+};
+
+using StageTotals = std::array<nsecs_t, ftl::enum_size_v<LatencyStage>>;
+
+StageTotals getStageTotals(impl::TimeStats& timeStats) {
+    StageTotals totals;
+    for (const LatencyStage stage : ftl::enum_range<LatencyStage>()) {
+        totals[ftl::to_underlying(stage)] = timeStats.getStageLatency(stage).total;
+    }
+    return totals;
+}
+
+// Reports the mean time spent in each stage per frame, from the TimeStats stage histograms that
+// SurfaceFlinger and CompositionEngine record to.
+void reportStageLatencies(benchmark::State& state, const StageTotals& before,
+                          const StageTotals& after) {
+    const auto frames = static_cast<double>(std::max<benchmark::IterationCount>(state.iterations(),
+                                                                                1));
+    for (const LatencyStage stage : ftl::enum_range<LatencyStage>()) {
+        const size_t index = ftl::to_underlying(stage);
+        state.counters[std::string(ftl::enum_string(stage)) + "_ns"] =
+                benchmark::Counter(static_cast<double>(after[index] - before[index]) / frames);
+    }
+}
+
+static void commitAndComposite(benchmark::State& state) {
+    SyntheticScene scene(SceneArgs::from(state));
+
+    // Latch the initial buffers and let the layers settle before measuring.
+    constexpr int kWarmupFrames = 4;
+    for (int i = 0; i < kWarmupFrames; i++) {
+        scene.runFrame();
+    }
+
+    const StageTotals before = getStageTotals(scene.timeStats());
+    for (auto _ : state) {
+        scene.runFrame();
+    }
+    reportStageLatencies(state, before, getStageTotals(scene.timeStats()));
+}
+
+// Arguments: layer count, hierarchy depth, buffer update percent, display count, effect.
+static void sceneArguments(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"layers", "depth", "bufferUpdatePercent", "displays", "effect"});
+    for (const int64_t layers : {8, 32, 128}) {
+        benchmark->Args({layers, 1, 10, 1, static_cast<int64_t>(Effect::None)});
+    }
+    for (const int64_t depth : {4, 16}) {
+        benchmark->Args({64, depth, 10, 1, static_cast<int64_t>(Effect::None)});
+    }
+    for (const int64_t percent : {0, 50, 100}) {
+        benchmark->Args({64, 1, percent, 1, static_cast<int64_t>(Effect::None)});
+    }
+    benchmark->Args({64, 1, 10, 2, static_cast<int64_t>(Effect::None)});
+    benchmark->Args({64, 1, 10, 1, static_cast<int64_t>(Effect::Shadow)});
+    benchmark->Args({64, 1, 10, 1, static_cast<int64_t>(Effect::Blur)});
+}
+BENCHMARK(commitAndComposite)->Apply(sceneArguments);
+
+} // namespace
+} // namespace android::surfaceflinger
+
+int main(int argc, char** argv) {
+    // The mocks stand in for the HWC and RenderEngine, their uninteresting calls are expected.
+    GMOCK_FLAG_SET(verbose, "error");
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
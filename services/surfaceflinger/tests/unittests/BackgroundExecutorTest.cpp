@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <condition_variable>
+#include <future>
 
 #include "BackgroundExecutor.h"
 
@@ -52,6 +53,45 @@ TEST_F(BackgroundExecutorTest, multipleProducers) {
     ASSERT_EQ(backgroundTaskCount, backgroundTaskCompleteCount);
 }
 
+TEST_F(BackgroundExecutorTest, unorderedCallbacksDontWaitForOrderedCallbacks) {
+    std::promise<void> unblockOrdered;
+    std::promise<void> orderedStarted;
+    BackgroundExecutor::getInstance().sendCallbacks(
+            {[&, unblocked = unblockOrdered.get_future().share()]() {
+                orderedStarted.set_value();
+                unblocked.wait();
+            }});
+    orderedStarted.get_future().wait();
+
+    std::promise<void> unorderedDone;
+    BackgroundExecutor::getInstance().sendUnorderedCallbacks(
+            {[&unorderedDone]() { unorderedDone.set_value(); }});
+    EXPECT_EQ(std::future_status::ready,
+              unorderedDone.get_future().wait_for(std::chrono::seconds(5)));
+
+    unblockOrdered.set_value();
+    BackgroundExecutor::getInstance().flushQueue();
+}
+
+TEST_F(BackgroundExecutorTest, orderedCallbacksRunInOrder) {
+    std::vector<int> order;
+    for (int i = 0; i < 10; i++) {
+        BackgroundExecutor::getInstance().sendCallbacks({[&order, i]() { order.push_back(i); }});
+    }
+    BackgroundExecutor::getInstance().flushQueue();
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), order);
+}
+
+TEST_F(BackgroundExecutorTest, dumpsQueueMetrics) {
+    BackgroundExecutor::getInstance().flushQueue();
+
+    std::string result;
+    BackgroundExecutor::dumpAll(result);
+    EXPECT_NE(std::string::npos, result.find("High priority: queue depth 0"));
+    EXPECT_NE(std::string::npos, result.find("Low priority: queue depth"));
+    EXPECT_NE(std::string::npos, result.find("queued"));
+}
+
 } // namespace
 
 } // namespace android
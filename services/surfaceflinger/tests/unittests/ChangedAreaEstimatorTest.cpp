@@ -0,0 +1,80 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "ChangedAreaEstimatorTest"
+
+#include <gtest/gtest.h>
+
+#include <array>
+
+#include "ChangedAreaEstimator.h"
+
+namespace android {
+namespace {
+
+constexpr int32_t kWidth = 8;
+constexpr int32_t kHeight = 6;
+
+struct ChangedAreaEstimatorTest : testing::Test {
+    std::array<uint32_t, kWidth * kHeight> previous{};
+    std::array<uint32_t, kWidth * kHeight> current{};
+
+    void change(int32_t x, int32_t y) { current[y * kWidth + x] = 0xffffffff; }
+
+    Rect changedBounds() const {
+        return changedSampleBounds(previous.data(), current.data(), kWidth, kHeight);
+    }
+};
+
+TEST_F(ChangedAreaEstimatorTest, identicalSamplesHaveNoChange) {
+    EXPECT_TRUE(changedBounds().isEmpty());
+}
+
+TEST_F(ChangedAreaEstimatorTest, singlePixelChange) {
+    change(3, 2);
+    EXPECT_EQ(Rect(3, 2, 4, 3), changedBounds());
+}
+
+TEST_F(ChangedAreaEstimatorTest, boundsCoverAllChanges) {
+    change(5, 1);
+    change(1, 3);
+    change(6, 4);
+    EXPECT_EQ(Rect(1, 1, 7, 5), changedBounds());
+}
+
+TEST_F(ChangedAreaEstimatorTest, wholeSampleChange) {
+    current.fill(1);
+    EXPECT_EQ(Rect(kWidth, kHeight), changedBounds());
+}
+
+TEST_F(ChangedAreaEstimatorTest, scaleKeepsSameSize) {
+    EXPECT_EQ(Rect(1, 2, 3, 4), scaleChangedBounds(Rect(1, 2, 3, 4), {8, 8}, {8, 8}));
+}
+
+TEST_F(ChangedAreaEstimatorTest, scaleKeepsEmptyBounds) {
+    EXPECT_TRUE(scaleChangedBounds(Rect::EMPTY_RECT, {8, 8}, {1080, 2400}).isEmpty());
+}
+
+TEST_F(ChangedAreaEstimatorTest, scaleRoundsOutwards) {
+    // Each sample pixel covers 10 by 10 pixels of the buffer, except for the partial last one.
+    EXPECT_EQ(Rect(10, 20, 30, 40), scaleChangedBounds(Rect(1, 2, 3, 4), {10, 10}, {100, 100}));
+    EXPECT_EQ(Rect(0, 0, 34, 34), scaleChangedBounds(Rect(0, 0, 1, 1), {3, 3}, {100, 100}));
+    EXPECT_EQ(Rect(66, 66, 100, 100), scaleChangedBounds(Rect(2, 2, 3, 3), {3, 3}, {100, 100}));
+}
+
+} // namespace
+} // namespace android
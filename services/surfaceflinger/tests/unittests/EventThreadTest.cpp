@@ -112,6 +112,11 @@ protected:
     void expectUidFrameRateMappingEventReceivedByConnection(PhysicalDisplayId expectedDisplayId,
                                                             std::vector<FrameRateOverride>);
 
+    void setShareFrameTimelines(bool enabled) {
+        std::lock_guard lock(mThread->mMutex);
+        mThread->mShareFrameTimelines = enabled;
+    }
+
     void onVSyncEvent(nsecs_t timestamp, nsecs_t expectedPresentationTime,
                       nsecs_t deadlineTimestamp) {
         mThread->onVsync(expectedPresentationTime, timestamp, deadlineTimestamp);
@@ -456,6 +461,34 @@ TEST_F(EventThreadTest, requestNextVsyncEventFrameTimelinesCorrect) {
     expectVsyncEventFrameTimelinesCorrect(123, {-1, 789, 456});
 }
 
+TEST_F(EventThreadTest, connectionsWithSameFrameIntervalShareFrameTimelines) {
+    setupEventThread();
+    setShareFrameTimelines(true);
+
+    ConnectionEventRecorder secondConnectionEventRecorder{0};
+    sp<MockEventThreadConnection> secondConnection =
+            createConnection(secondConnectionEventRecorder);
+    mThread->requestNextVsync(mConnection);
+    mThread->requestNextVsync(secondConnection);
+
+    expectVSyncCallbackScheduleReceived(true);
+    onVSyncEvent(123, 456, 789);
+
+    auto args = mConnectionEventCallRecorder.waitForCall();
+    ASSERT_TRUE(args.has_value());
+    auto secondArgs = secondConnectionEventRecorder.waitForCall();
+    ASSERT_TRUE(secondArgs.has_value());
+
+    const VsyncEventData& vsyncData = std::get<0>(args.value()).vsync.vsyncData;
+    const VsyncEventData& secondVsyncData = std::get<0>(secondArgs.value()).vsync.vsyncData;
+    ASSERT_EQ(vsyncData.frameTimelinesLength, secondVsyncData.frameTimelinesLength);
+    for (size_t i = 0; i < vsyncData.frameTimelinesLength; i++) {
+        EXPECT_EQ(static_cast<int64_t>(i), secondVsyncData.frameTimelines[i].vsyncId)
+                << "Vsync ID not shared for frame timeline " << i;
+        EXPECT_EQ(vsyncData.frameTimelines[i].vsyncId, secondVsyncData.frameTimelines[i].vsyncId);
+    }
+}
+
 TEST_F(EventThreadTest, requestNextVsyncEventFrameTimelinesValidLength) {
     setupEventThread();
     // The VsyncEventData should not have kFrameTimelinesCapacity amount of valid frame timelines,
@@ -147,7 +147,7 @@ public:
         for (size_t i = 0; i < maxTokens; i++) {
             mTokenManager->generateTokenForPredictions({});
         }
-        EXPECT_EQ(getPredictions().size(), maxTokens);
+        EXPECT_EQ(getPredictionCount(), maxTokens);
     }
 
     SurfaceFrame& getSurfaceFrame(size_t displayFrameIdx, size_t surfaceFrameIdx) {
@@ -166,8 +166,9 @@ public:
                 a.presentTime == b.presentTime;
     }
 
-    const std::map<int64_t, TimelineItem>& getPredictions() const {
-        return mTokenManager->mPredictions;
+    size_t getPredictionCount() const {
+        std::lock_guard<std::mutex> lock(mTokenManager->mMutex);
+        return mTokenManager->mPredictionCount;
     }
 
     uint32_t getNumberOfDisplayFrames() const {
@@ -211,7 +212,7 @@ public:
 
 TEST_F(FrameTimelineTest, tokenManagerRemovesStalePredictions) {
     int64_t token1 = mTokenManager->generateTokenForPredictions({0, 0, 0});
-    EXPECT_EQ(getPredictions().size(), 1u);
+    EXPECT_EQ(getPredictionCount(), 1u);
     flushTokens();
     int64_t token2 = mTokenManager->generateTokenForPredictions({10, 20, 30});
     std::optional<TimelineItem> predictions = mTokenManager->getPredictionsForToken(token1);
@@ -223,6 +224,46 @@ TEST_F(FrameTimelineTest, tokenManagerRemovesStalePredictions) {
     EXPECT_EQ(compareTimelineItems(*predictions, TimelineItem(10, 20, 30)), true);
 }
 
+TEST_F(FrameTimelineTest, tokenManagerKeepsLastMaxTokensPredictions) {
+    const int64_t firstToken = mTokenManager->generateTokenForPredictions({0, 0, 0});
+    for (size_t i = 1; i < maxTokens; i++) {
+        mTokenManager->generateTokenForPredictions({static_cast<nsecs_t>(i), 0, 0});
+    }
+    // All of the last maxTokens tokens are still valid.
+    auto predictions = mTokenManager->getPredictionsForToken(firstToken);
+    ASSERT_TRUE(predictions.has_value());
+    EXPECT_TRUE(compareTimelineItems(*predictions, TimelineItem(0, 0, 0)));
+
+    // The next token takes over the slot of the oldest one.
+    const int64_t nextToken = mTokenManager->generateTokenForPredictions({10, 20, 30});
+    EXPECT_FALSE(mTokenManager->getPredictionsForToken(firstToken).has_value());
+    predictions = mTokenManager->getPredictionsForToken(nextToken);
+    ASSERT_TRUE(predictions.has_value());
+    EXPECT_TRUE(compareTimelineItems(*predictions, TimelineItem(10, 20, 30)));
+    EXPECT_EQ(getPredictionCount(), maxTokens);
+
+    EXPECT_FALSE(mTokenManager->getPredictionsForToken(FrameTimelineInfo::INVALID_VSYNC_ID)
+                         .has_value());
+}
+
+TEST_F(FrameTimelineTest, surfaceFrameAllocationsAreReused) {
+    FrameTimelineInfo ftInfo;
+    ftInfo.vsyncId = mTokenManager->generateTokenForPredictions({10, 20, 30});
+    ftInfo.inputEventId = sInputEventId;
+    auto surfaceFrame =
+            mFrameTimeline->createSurfaceFrameForToken(ftInfo, sPidOne, sUidOne, sLayerIdOne,
+                                                       sLayerNameOne, sLayerNameOne,
+                                                       /*isBuffer*/ true, sGameMode);
+    const void* const address = surfaceFrame.get();
+    surfaceFrame.reset();
+
+    surfaceFrame =
+            mFrameTimeline->createSurfaceFrameForToken(ftInfo, sPidOne, sUidOne, sLayerIdOne,
+                                                       sLayerNameOne, sLayerNameOne,
+                                                       /*isBuffer*/ true, sGameMode);
+    EXPECT_EQ(surfaceFrame.get(), address);
+}
+
 TEST_F(FrameTimelineTest, createSurfaceFrameForToken_getOwnerPidReturnsCorrectPid) {
     auto surfaceFrame1 =
             mFrameTimeline->createSurfaceFrameForToken({}, sPidOne, sUidOne, sLayerIdOne,
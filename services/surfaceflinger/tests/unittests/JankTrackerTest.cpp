@@ -22,6 +22,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <future>
+
 namespace android {
 
 namespace {
@@ -45,6 +47,8 @@ public:
 
     void SetUp() override { mListener = sp<StrictMock<MockJankListener>>::make(); }
 
+    void TearDown() override { JankTracker::setBatching(kDefaultBatchSize, 0); }
+
     void addJankListener(int32_t layerId) {
         JankTracker::addJankListener(layerId, IInterface::asBinder(mListener));
     }
@@ -69,6 +73,8 @@ public:
         return JankTracker::getCollectedJankDataForTesting(layerId);
     }
 
+    static constexpr size_t kDefaultBatchSize = 50;
+
     sp<StrictMock<MockJankListener>> mListener = nullptr;
     int64_t mVsyncId = 1000;
 };
@@ -153,6 +159,54 @@ TEST_F(JankTrackerTest, jankDataIsAutomaticallyFlushedInBatches) {
     EXPECT_EQ(jankDataReceived, kNumberOfJankDataToSend);
 }
 
+TEST_F(JankTrackerTest, jankDataIsFlushedInConfiguredBatches) {
+    ASSERT_EQ(listenerCount(), 0u);
+    JankTracker::setBatching(2, 0);
+
+    EXPECT_CALL(*mListener.get(), onJankData(SizeIs(2)))
+            .Times(2)
+            .WillRepeatedly(Return(binder::Status::ok()));
+    EXPECT_CALL(*mListener.get(), onJankData(SizeIs(1))).WillOnce(Return(binder::Status::ok()));
+
+    addJankListener(123);
+    for (int i = 0; i < 5; i++) {
+        addJankData(123, 0);
+    }
+    flushBackgroundThread();
+
+    // The listener is removed after the last frame, so it is flushed right away.
+    removeJankListener(123, mVsyncId - 1);
+    flushBackgroundThread();
+    EXPECT_EQ(listenerCount(), 0u);
+}
+
+TEST_F(JankTrackerTest, jankDataIsFlushedAfterInterval) {
+    ASSERT_EQ(listenerCount(), 0u);
+    JankTracker::setBatching(kDefaultBatchSize, ms2ns(10));
+
+    // Nothing reaches the batch size, so only the interval flushes the data, in one or more
+    // flushes depending on how long its posting takes.
+    size_t jankDataReceived = 0;
+    std::promise<void> receivedAll;
+    EXPECT_CALL(*mListener.get(), onJankData(_))
+            .WillRepeatedly([&](const std::vector<gui::JankData>& jankData) {
+                jankDataReceived += jankData.size();
+                if (jankDataReceived == 2) receivedAll.set_value();
+                return binder::Status::ok();
+            });
+
+    addJankListener(123);
+    addJankData(123, 1);
+    addJankData(123, 2);
+
+    ASSERT_EQ(receivedAll.get_future().wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+
+    removeJankListener(123, 0);
+    flushBackgroundThread();
+    EXPECT_EQ(listenerCount(), 0u);
+}
+
 TEST_F(JankTrackerTest, jankListenerIsRemovedWhenReturningNullError) {
     ASSERT_EQ(listenerCount(), 0u);
 
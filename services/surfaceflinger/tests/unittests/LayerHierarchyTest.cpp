@@ -482,6 +482,49 @@ TEST_F(LayerHierarchyTest, offscreenLayerCannotBeRelativeToOnscreenLayer) {
     EXPECT_EQ(getTraversalPath(hierarchyBuilder.getOffscreenHierarchy()), expectedTraversalPath);
 }
 
+TEST_F(LayerHierarchyTest, shortLivedLayersKeepRestOfHierarchy) {
+    LayerHierarchyBuilder hierarchyBuilder;
+    hierarchyBuilder.setVerifyUpdates(true);
+    hierarchyBuilder.update(mLifecycleManager);
+    reparentRelativeLayer(1221, 2);
+    UPDATE_AND_VERIFY(hierarchyBuilder);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        createLayer(1000 + i, 122);
+        createLayer(2000 + i, 1000 + i);
+        UPDATE_AND_VERIFY(hierarchyBuilder);
+        destroyLayerHandle(2000 + i);
+        destroyLayerHandle(1000 + i);
+        UPDATE_AND_VERIFY(hierarchyBuilder);
+    }
+
+    std::vector<uint32_t> expectedTraversalPath = {1, 11, 111, 12, 121, 122, 1221, 13, 2, 1221};
+    EXPECT_EQ(getTraversalPath(hierarchyBuilder.getHierarchy()), expectedTraversalPath);
+    expectedTraversalPath = {1, 11, 111, 12, 121, 122, 13, 2, 1221};
+    EXPECT_EQ(getTraversalPathInZOrder(hierarchyBuilder.getHierarchy()), expectedTraversalPath);
+    expectedTraversalPath = {};
+    EXPECT_EQ(getTraversalPath(hierarchyBuilder.getOffscreenHierarchy()), expectedTraversalPath);
+}
+
+TEST_F(LayerHierarchyTest, layerMovesOffscreenWhenShortLivedRelativeParentDies) {
+    LayerHierarchyBuilder hierarchyBuilder;
+    hierarchyBuilder.setVerifyUpdates(true);
+    hierarchyBuilder.update(mLifecycleManager);
+    createLayer(3, 1);
+    reparentRelativeLayer(13, 3);
+    UPDATE_AND_VERIFY(hierarchyBuilder);
+
+    destroyLayerHandle(3);
+    UPDATE_AND_VERIFY(hierarchyBuilder);
+
+    std::vector<uint32_t> expectedTraversalPath = {1, 11, 111, 12, 121, 122, 1221, 13, 2};
+    EXPECT_EQ(getTraversalPath(hierarchyBuilder.getHierarchy()), expectedTraversalPath);
+    expectedTraversalPath = {1, 11, 111, 12, 121, 122, 1221, 2};
+    EXPECT_EQ(getTraversalPathInZOrder(hierarchyBuilder.getHierarchy()), expectedTraversalPath);
+    expectedTraversalPath = {13};
+    EXPECT_EQ(getTraversalPath(hierarchyBuilder.getOffscreenHierarchy()), expectedTraversalPath);
+}
+
 TEST_F(LayerHierarchyTest, backgroundLayersAreBehindParentLayer) {
     LayerHierarchyBuilder hierarchyBuilder;
     hierarchyBuilder.update(mLifecycleManager);
@@ -45,7 +45,10 @@ protected:
     LayerInfoTest() { mFlinger.resetScheduler(mScheduler); }
 
     void setFrameTimes(const std::deque<FrameTimeData>& frameTimes) {
-        layerInfo.mFrameTimes = frameTimes;
+        layerInfo.mFrameTimes.clear();
+        for (const auto& frameTime : frameTimes) {
+            layerInfo.mFrameTimes.push(frameTime);
+        }
     }
 
     void setLastRefreshRate(Fps fps) {
@@ -55,6 +58,8 @@ protected:
 
     auto calculateAverageFrameTime() { return layerInfo.calculateAverageFrameTime(); }
 
+    bool hasCachedVotes() const { return layerInfo.mCachedVotes.has_value(); }
+
     LayerInfo layerInfo{"TestLayerInfo", 0, LayerHistory::LayerVoteType::Heuristic};
 
     std::shared_ptr<RefreshRateSelector> mSelector =
@@ -196,6 +201,41 @@ TEST_F(LayerInfoTest, ignoresLargePeriods) {
     ASSERT_EQ(kExpectedFps, Fps::fromPeriodNsecs(*averageFrameTime));
 }
 
+// The average of a steady cadence is computed without walking the frames, and must match the
+// average computed when some of the intervals have to be skipped.
+TEST_F(LayerInfoTest, averagesRegularAndIrregularIntervalsAlike) {
+    std::deque<FrameTimeData> frameTimes;
+    constexpr auto kExpectedFps = 50_Hz;
+    constexpr auto kPeriod = kExpectedFps.getPeriodNsecs();
+    constexpr auto kSmallPeriod = (250_Hz).getPeriodNsecs();
+    for (int i = 1; i <= 60; i++) {
+        frameTimes.push_back(FrameTimeData{.presentTime = kPeriod * i,
+                                           .queueTime = 0,
+                                           .pendingModeChange = false});
+    }
+    setFrameTimes(frameTimes);
+    auto averageFrameTime = calculateAverageFrameTime();
+    ASSERT_TRUE(averageFrameTime.has_value());
+    EXPECT_EQ(kExpectedFps, Fps::fromPeriodNsecs(*averageFrameTime));
+
+    // A duplicate frame that is later dropped from the history no longer affects the average.
+    frameTimes.push_front(FrameTimeData{.presentTime = kPeriod - kSmallPeriod,
+                                        .queueTime = 0,
+                                        .pendingModeChange = true});
+    setFrameTimes(frameTimes);
+    averageFrameTime = calculateAverageFrameTime();
+    ASSERT_TRUE(averageFrameTime.has_value());
+    EXPECT_EQ(kExpectedFps, Fps::fromPeriodNsecs(*averageFrameTime));
+
+    frameTimes.push_back(FrameTimeData{.presentTime = kPeriod * 60 + kSmallPeriod,
+                                       .queueTime = 0,
+                                       .pendingModeChange = false});
+    setFrameTimes(frameTimes);
+    averageFrameTime = calculateAverageFrameTime();
+    ASSERT_TRUE(averageFrameTime.has_value());
+    EXPECT_EQ(kExpectedFps, Fps::fromPeriodNsecs(*averageFrameTime));
+}
+
 TEST_F(LayerInfoTest, getRefreshRateVote_explicitVote) {
     LayerInfo::LayerVote vote = {.type = LayerHistory::LayerVoteType::ExplicitDefault,
                                  .fps = 20_Hz};
@@ -269,6 +309,52 @@ TEST_F(LayerInfoTest, getRefreshRateVote_noData) {
     ASSERT_EQ(actualVotes[0].fps, vote.fps);
 }
 
+TEST_F(LayerInfoTest, getRefreshRateVote_reusesCachedVotes) {
+    LayerInfo::setVoteCachingEnabled(true);
+    const auto& selector = *mScheduler->refreshRateSelector();
+
+    LayerInfo::LayerVote vote = {.type = LayerHistory::LayerVoteType::ExplicitDefault,
+                                 .fps = 20_Hz};
+    layerInfo.setLayerVote(vote);
+    const nsecs_t now = systemTime();
+    ASSERT_EQ(1u, layerInfo.getRefreshRateVote(selector, now).size());
+    EXPECT_TRUE(hasCachedVotes());
+
+    // Setting the same vote again keeps the cached votes, but a different vote replaces them.
+    layerInfo.setLayerVote(vote);
+    EXPECT_TRUE(hasCachedVotes());
+
+    vote.fps = 30_Hz;
+    layerInfo.setLayerVote(vote);
+    EXPECT_FALSE(hasCachedVotes());
+    auto actualVotes = layerInfo.getRefreshRateVote(selector, now);
+    ASSERT_EQ(1u, actualVotes.size());
+    EXPECT_EQ(30_Hz, actualVotes[0].fps);
+
+    LayerInfo::setVoteCachingEnabled(false);
+}
+
+TEST_F(LayerInfoTest, getRefreshRateVote_cachedAnimationVoteExpires) {
+    LayerInfo::setVoteCachingEnabled(true);
+    const auto& selector = *mScheduler->refreshRateSelector();
+    layerInfo.setLayerVote({.type = LayerHistory::LayerVoteType::Heuristic});
+
+    const nsecs_t time = systemTime();
+    layerInfo.setLastPresentTime(time, time, LayerHistory::LayerUpdateType::AnimationTX, false,
+                                 {.visible = true});
+    auto actualVotes = layerInfo.getRefreshRateVote(selector, time);
+    ASSERT_EQ(1u, actualVotes.size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Max, actualVotes[0].type);
+    EXPECT_TRUE(hasCachedVotes());
+
+    // Once the animation is no longer recent, the votes are recomputed from the frame times.
+    const nsecs_t later = time + MAX_ACTIVE_LAYER_PERIOD_NS.count() + 1;
+    layerInfo.getRefreshRateVote(selector, later);
+    EXPECT_FALSE(hasCachedVotes());
+
+    LayerInfo::setVoteCachingEnabled(false);
+}
+
 TEST_F(LayerInfoTest, isFrontBuffered) {
     SET_FLAG_FOR_TEST(flags::vrr_config, true);
     ASSERT_FALSE(layerInfo.isFrontBuffered());
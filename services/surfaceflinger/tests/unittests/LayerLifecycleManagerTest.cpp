@@ -629,4 +629,79 @@ TEST_F(LayerLifecycleManagerTest, testInputInfoOfRequestedLayerState) {
     EXPECT_TRUE(getRequestedLayerState(mLifecycleManager, 111)->needsInputInfo());
 }
 
+
+TEST_F(LayerLifecycleManagerTest, statesOfALayerAreMergedAcrossTransactions) {
+    std::vector<TransactionState> transactions;
+    transactions.emplace_back();
+    transactions.back().states.push_back({});
+    transactions.back().states.front().state.what =
+            layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged;
+    transactions.back().states.front().state.x = 1;
+    transactions.back().states.front().state.y = 2;
+    transactions.back().states.front().state.color.a = 0.5_hf;
+    transactions.back().states.front().layerId = 111;
+    transactions.emplace_back();
+    transactions.back().states.push_back({});
+    transactions.back().states.front().state.what =
+            layer_state_t::ePositionChanged | layer_state_t::eCropChanged;
+    transactions.back().states.front().state.x = 3;
+    transactions.back().states.front().state.y = 4;
+    transactions.back().states.front().state.crop = Rect(0, 0, 10, 10);
+    transactions.back().states.front().layerId = 111;
+    mLifecycleManager.applyTransactions(transactions);
+
+    const RequestedLayerState* layer = getRequestedLayerState(mLifecycleManager, 111);
+    EXPECT_EQ(layer->x, 3);
+    EXPECT_EQ(layer->y, 4);
+    EXPECT_EQ(layer->color.a, 0.5_hf);
+    EXPECT_EQ(layer->crop, Rect(0, 0, 10, 10));
+    EXPECT_TRUE(layer->changes.test(RequestedLayerState::Changes::Geometry));
+    EXPECT_TRUE(layer->changes.test(RequestedLayerState::Changes::Content));
+    mLifecycleManager.commitChanges();
+}
+
+TEST_F(LayerLifecycleManagerTest, buffersOfALayerAreAppliedInOrder) {
+    std::vector<TransactionState> transactions;
+    for (uint64_t bufferId = 1; bufferId <= 2; bufferId++) {
+        auto texture = std::make_shared<
+                renderengine::mock::FakeExternalTexture>(1U /*width*/, 1U /*height*/, bufferId,
+                                                         HAL_PIXEL_FORMAT_RGBA_8888,
+                                                         GRALLOC_USAGE_PROTECTED /*usage*/);
+        transactions.emplace_back();
+        transactions.back().states.push_back({});
+        transactions.back().states.front().state.what = layer_state_t::eBufferChanged;
+        transactions.back().states.front().layerId = 111;
+        transactions.back().states.front().externalTexture = texture;
+        transactions.back().states.front().state.bufferData =
+                std::make_shared<fake::BufferData>(texture->getId(), texture->getWidth(),
+                                                   texture->getHeight(), texture->getPixelFormat(),
+                                                   texture->getUsage());
+    }
+    mLifecycleManager.applyTransactions(transactions);
+
+    // Each buffer takes the next frame number.
+    const RequestedLayerState* layer = getRequestedLayerState(mLifecycleManager, 111);
+    EXPECT_EQ(layer->externalTexture->getId(), 2u);
+    EXPECT_EQ(layer->bufferData->frameNumber, 2u);
+    mLifecycleManager.commitChanges();
+}
+
+TEST_F(LayerLifecycleManagerTest, relativeZAndReparentAreAppliedInOrder) {
+    std::vector<TransactionState> transactions = relativeLayerTransaction(111, 2);
+    for (auto& transaction : reparentLayerTransaction(111, UNASSIGNED_LAYER_ID)) {
+        transactions.push_back(std::move(transaction));
+    }
+    mLifecycleManager.applyTransactions(transactions);
+    EXPECT_FALSE(getRequestedLayerState(mLifecycleManager, 111)->isRelativeOf);
+    mLifecycleManager.commitChanges();
+
+    transactions = reparentLayerTransaction(121, UNASSIGNED_LAYER_ID);
+    for (auto& transaction : relativeLayerTransaction(121, 2)) {
+        transactions.push_back(std::move(transaction));
+    }
+    mLifecycleManager.applyTransactions(transactions);
+    EXPECT_TRUE(getRequestedLayerState(mLifecycleManager, 121)->isRelativeOf);
+    mLifecycleManager.commitChanges();
+}
+
 } // namespace android::surfaceflinger::frontend
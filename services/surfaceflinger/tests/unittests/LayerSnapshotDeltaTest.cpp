@@ -0,0 +1,107 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Tracing/LayerSnapshotDelta.h"
+
+namespace android {
+namespace {
+
+using perfetto::protos::LayersSnapshotProto;
+
+LayersSnapshotProto makeSnapshot(int64_t vsyncId, const std::vector<std::pair<int32_t, int32_t>>&
+                                                          layerIdsAndZ) {
+    LayersSnapshotProto snapshot;
+    snapshot.set_vsync_id(vsyncId);
+    snapshot.set_where("visibleRegionsDirty");
+    for (const auto& [id, z] : layerIdsAndZ) {
+        auto* layer = snapshot.mutable_layers()->add_layers();
+        layer->set_id(id);
+        layer->set_name("layer " + std::to_string(id));
+        layer->set_z(z);
+    }
+    return snapshot;
+}
+
+TEST(LayerSnapshotDeltaTest, writesOnlyChangedLayersBetweenKeyframes) {
+    LayerSnapshotDeltaEncoder encoder(/*keyframeInterval=*/3);
+
+    auto snapshot = encoder.encode(makeSnapshot(1, {{1, 0}, {2, 0}, {3, 0}}));
+    EXPECT_FALSE(isDeltaSnapshot(snapshot));
+    EXPECT_EQ(3, snapshot.layers().layers_size());
+
+    snapshot = encoder.encode(makeSnapshot(2, {{1, 0}, {2, 5}, {3, 0}}));
+    EXPECT_TRUE(isDeltaSnapshot(snapshot));
+    ASSERT_EQ(1, snapshot.layers().layers_size());
+    EXPECT_EQ(2, snapshot.layers().layers(0).id());
+    EXPECT_EQ(2, snapshot.vsync_id());
+
+    snapshot = encoder.encode(makeSnapshot(3, {{1, 0}, {2, 5}, {3, 0}}));
+    EXPECT_TRUE(isDeltaSnapshot(snapshot));
+    EXPECT_EQ(0, snapshot.layers().layers_size());
+
+    snapshot = encoder.encode(makeSnapshot(4, {{1, 0}, {2, 5}, {3, 0}}));
+    EXPECT_FALSE(isDeltaSnapshot(snapshot));
+    EXPECT_EQ(3, snapshot.layers().layers_size());
+}
+
+TEST(LayerSnapshotDeltaTest, writesKeyframeWhenLayersChange) {
+    LayerSnapshotDeltaEncoder encoder(/*keyframeInterval=*/100);
+    encoder.encode(makeSnapshot(1, {{1, 0}, {2, 0}}));
+
+    EXPECT_FALSE(isDeltaSnapshot(encoder.encode(makeSnapshot(2, {{1, 0}, {2, 0}, {3, 0}}))));
+    EXPECT_FALSE(isDeltaSnapshot(encoder.encode(makeSnapshot(3, {{2, 0}, {1, 0}, {3, 0}}))));
+    EXPECT_TRUE(isDeltaSnapshot(encoder.encode(makeSnapshot(4, {{2, 0}, {1, 0}, {3, 0}}))));
+
+    encoder.reset();
+    EXPECT_FALSE(isDeltaSnapshot(encoder.encode(makeSnapshot(5, {{2, 0}, {1, 0}, {3, 0}}))));
+}
+
+TEST(LayerSnapshotDeltaTest, expandsDeltasToFullSnapshots) {
+    const std::vector<LayersSnapshotProto> snapshots = {
+            makeSnapshot(1, {{1, 0}, {2, 0}}), makeSnapshot(2, {{1, 1}, {2, 0}}),
+            makeSnapshot(3, {{1, 1}, {2, 2}}), makeSnapshot(4, {{1, 1}, {2, 2}, {3, 0}}),
+            makeSnapshot(5, {{1, 1}, {2, 2}, {3, 3}}),
+    };
+
+    LayerSnapshotDeltaEncoder encoder(/*keyframeInterval=*/10);
+    perfetto::protos::LayersTraceFileProto trace;
+    for (auto snapshot : snapshots) {
+        *trace.add_entry() = encoder.encode(std::move(snapshot));
+    }
+    ASSERT_TRUE(isDeltaSnapshot(trace.entry(1)));
+
+    ASSERT_TRUE(expandDeltaSnapshots(trace));
+    ASSERT_EQ(static_cast<int>(snapshots.size()), trace.entry_size());
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        EXPECT_EQ(snapshots[i].SerializeAsString(),
+                  trace.entry(static_cast<int>(i)).SerializeAsString())
+                << "snapshot " << i;
+    }
+}
+
+TEST(LayerSnapshotDeltaTest, failsToExpandDeltaWithoutKeyframe) {
+    LayerSnapshotDeltaEncoder encoder(/*keyframeInterval=*/10);
+    encoder.encode(makeSnapshot(1, {{1, 0}}));
+
+    perfetto::protos::LayersTraceFileProto trace;
+    *trace.add_entry() = encoder.encode(makeSnapshot(2, {{1, 1}}));
+    EXPECT_FALSE(expandDeltaSnapshots(trace));
+}
+
+} // namespace
+} // namespace android
@@ -611,6 +611,33 @@ TEST_F(LayerSnapshotTest, mirrorLayerTouchIsCroppedByMirrorRoot) {
                         ->inputInfo.touchableRegion.hasSameRects(touchCroppedByMirrorRoot));
 }
 
+// Mirrors share the state derived from the requested state of the layer they mirror.
+TEST_F(LayerSnapshotTest, mirrorLayerGetsBufferOfMirroredLayer) {
+    reparentLayer(12, UNASSIGNED_LAYER_ID);
+    createDisplayMirrorLayer(3, ui::LayerStack::fromValue(0));
+    setLayerStack(3, 3);
+    std::vector<uint32_t> expected = {1, 11, 111, 13, 2, 3, 1, 11, 111, 13, 2};
+    UPDATE_AND_VERIFY(mSnapshotBuilder, expected);
+
+    setBuffer(111,
+              std::make_shared<renderengine::mock::FakeExternalTexture>(10U /*width*/,
+                                                                        20U /*height*/,
+                                                                        42ULL /* bufferId */,
+                                                                        HAL_PIXEL_FORMAT_RGBA_8888,
+                                                                        0 /*usage*/));
+    UPDATE_AND_VERIFY(mSnapshotBuilder, expected);
+
+    const LayerSnapshot* snapshot = getSnapshot(111);
+    const LayerSnapshot* mirrorSnapshot = getSnapshot({.id = 111, .mirrorRootIds = 3u});
+    ASSERT_NE(mirrorSnapshot, nullptr);
+    ASSERT_NE(snapshot->externalTexture, nullptr);
+    EXPECT_EQ(mirrorSnapshot->externalTexture, snapshot->externalTexture);
+    EXPECT_EQ(mirrorSnapshot->frameNumber, snapshot->frameNumber);
+    EXPECT_EQ(mirrorSnapshot->bufferSize, Rect(0, 0, 10, 20));
+    EXPECT_EQ(mirrorSnapshot->compositionType, snapshot->compositionType);
+    EXPECT_EQ(mirrorSnapshot->outputFilter.layerStack.id, 3u);
+}
+
 TEST_F(LayerSnapshotTest, canRemoveDisplayMirror) {
     setFlags(12, layer_state_t::eLayerSkipScreenshot, layer_state_t::eLayerSkipScreenshot);
     createDisplayMirrorLayer(3, ui::LayerStack::fromValue(0));
@@ -1935,4 +1962,61 @@ TEST_F(LayerSnapshotTest, shouldUpdateInputWhenNoInputInfo) {
     EXPECT_FALSE(getSnapshot(2)->hasInputInfo());
 }
 
+TEST_F(LayerSnapshotTest, hotFieldsTrackSnapshots) {
+    hideLayer(12);
+    setAlpha(2, 0.5f);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 11, 111, 13, 2});
+
+    const auto& hotFields = mSnapshotBuilder.getHotFields();
+    const auto& snapshots = mSnapshotBuilder.getSnapshots();
+    ASSERT_EQ(hotFields.size(), snapshots.size());
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        EXPECT_EQ(hotFields[i].isVisible, snapshots[i]->isVisible);
+        EXPECT_EQ(hotFields[i].hasInputInfo, snapshots[i]->hasInputInfo());
+        EXPECT_EQ(hotFields[i].layerStack, snapshots[i]->outputFilter.layerStack);
+        EXPECT_EQ(hotFields[i].alpha, snapshots[i]->alpha);
+        EXPECT_EQ(hotFields[i].transformedBounds, snapshots[i]->transformedBounds);
+    }
+    EXPECT_EQ(hotFields[getSnapshot(2)->globalZ].alpha, 0.5f);
+}
+
+TEST_F(LayerSnapshotTest, parallelTraversalMatchesSerialTraversal) {
+    // Add enough layers across several root subtrees for the parallel path to kick in, with a
+    // relative layer that ties two of the subtrees together.
+    for (uint32_t root = 3; root <= 5; root++) {
+        createRootLayer(root * 100);
+        for (uint32_t child = 1; child <= 30; child++) {
+            createLayer(root * 100 + child, root * 100);
+        }
+    }
+    reparentRelativeLayer(301, 401);
+
+    LayerSnapshotBuilder::Args args{.root = mHierarchyBuilder.getHierarchy(),
+                                    .layerLifecycleManager = mLifecycleManager,
+                                    .includeMetadata = false,
+                                    .displays = mFrontEndDisplayInfos,
+                                    .globalShadowSettings = globalShadowSettings,
+                                    .supportsBlur = true,
+                                    .supportedLayerGenericMetadata = {},
+                                    .genericLayerMetadataKeyMap = {},
+                                    .parallelTraversal = true};
+    update(mSnapshotBuilder, args);
+    EXPECT_EQ(mSnapshotBuilder.getStats().parallelUpdates, 1u);
+
+    args.parallelTraversal = false;
+    LayerSnapshotBuilder serialBuilder(args);
+    mLifecycleManager.commitChanges();
+
+    std::vector<LayerHierarchy::TraversalPath> parallelZOrder;
+    mSnapshotBuilder.forEachVisibleSnapshot(
+            [&](const LayerSnapshot& snapshot) { parallelZOrder.push_back(snapshot.path); });
+    std::vector<LayerHierarchy::TraversalPath> serialZOrder;
+    serialBuilder.forEachVisibleSnapshot(
+            [&](const LayerSnapshot& snapshot) { serialZOrder.push_back(snapshot.path); });
+    EXPECT_EQ(parallelZOrder, serialZOrder);
+    EXPECT_EQ(mSnapshotBuilder.getSnapshots().size(), serialBuilder.getSnapshots().size());
+    EXPECT_EQ(getSnapshot(301)->outputFilter.layerStack,
+              serialBuilder.getSnapshot(301)->outputFilter.layerStack);
+}
+
 } // namespace android::surfaceflinger::frontend
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "LocklessQueue.h"
+
+namespace android {
+namespace {
+
+TEST(LocklessQueueTest, overflowKeepsOrder) {
+    LocklessQueue<std::string, 2> queue;
+    EXPECT_TRUE(queue.isEmpty());
+
+    for (int i = 0; i < 10; i++) {
+        queue.push(std::to_string(i));
+    }
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(queue.pop(), std::to_string(i));
+    }
+
+    // Values are pushed onto the overflow until it is drained.
+    queue.push("10");
+    for (int i = 5; i <= 10; i++) {
+        EXPECT_EQ(queue.pop(), std::to_string(i));
+    }
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_EQ(queue.pop(), std::nullopt);
+
+    queue.push("11");
+    EXPECT_FALSE(queue.isEmpty());
+    EXPECT_EQ(queue.pop(), "11");
+}
+
+TEST(LocklessQueueTest, multipleProducersKeepOrder) {
+    constexpr int kProducers = 4;
+    constexpr int kCount = 10'000;
+    LocklessQueue<std::pair<int, int>, 4> queue;
+
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < kProducers; producer++) {
+        producers.emplace_back([&queue, producer] {
+            for (int i = 0; i < kCount; i++) {
+                queue.push({producer, i});
+            }
+        });
+    }
+
+    std::vector<int> next(kProducers, 0);
+    for (int popped = 0; popped < kProducers * kCount;) {
+        if (const auto value = queue.pop()) {
+            ASSERT_EQ(value->second, next[value->first]++);
+            popped++;
+        }
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+} // namespace
+} // namespace android
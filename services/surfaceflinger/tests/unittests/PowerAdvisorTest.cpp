@@ -352,6 +352,11 @@ TEST_F(PowerAdvisorTest, hintSessionUseHwcDisplay) {
     mPowerAdvisor->setHwcPresentTiming(displayIds[0], startTime + 2ms, startTime + 2500us);
     mPowerAdvisor->setSfPresentTiming(startTime, startTime + presentDuration);
     mPowerAdvisor->reportActualWorkDuration();
+
+    // The estimate is kept without the safety margin.
+    const auto lastDuration = mPowerAdvisor->getLastActualWorkDuration();
+    ASSERT_TRUE(lastDuration.has_value());
+    EXPECT_EQ(presentDuration.ns() + postCompDuration.ns(), lastDuration->ns());
 }
 
 TEST_F(PowerAdvisorTest, hintSessionSubtractsHwcFenceTime) {
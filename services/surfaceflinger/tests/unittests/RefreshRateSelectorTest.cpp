@@ -100,6 +100,7 @@ struct TestableRefreshRateSelector : RefreshRateSelector {
     const std::vector<Fps>& knownFrameRates() const { return mKnownFrameRates; }
 
     using RefreshRateSelector::GetRankedFrameRatesCache;
+    using RefreshRateSelector::kMaxRankedFrameRatesCacheSize;
     auto& mutableGetRankedRefreshRatesCache() { return mGetRankedFrameRatesCache; }
 
     auto getRankedFrameRates(const std::vector<LayerRequirement>& layers,
@@ -3256,19 +3257,22 @@ TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ReadsCache) {
                                                                   {90_Hz, kMode90}}},
                                                           GlobalSignals{.touch = true}};
 
-    selector.mutableGetRankedRefreshRatesCache() = {.layers = std::vector<LayerRequirement>{},
-                                                    .signals = GlobalSignals{.touch = true,
-                                                                             .idle = true},
-                                                    .result = result};
+    const std::vector<LayerRequirement> layers;
+    const GlobalSignals signals{.touch = true, .idle = true};
+    using Cache = TestableRefreshRateSelector::GetRankedFrameRatesCache;
+    selector.mutableGetRankedRefreshRatesCache().push_front(
+            {.hash = Cache::computeHash(layers, signals, Fps()),
+             .layers = layers,
+             .signals = signals,
+             .result = result});
 
-    const auto& cache = *selector.mutableGetRankedRefreshRatesCache();
-    EXPECT_EQ(result, selector.getRankedFrameRates(cache.layers, cache.signals));
+    EXPECT_EQ(result, selector.getRankedFrameRates(layers, signals));
 }
 
 TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_WritesCache) {
     auto selector = createSelector(kModes_30_60_72_90_120, kModeId60);
 
-    EXPECT_FALSE(selector.mutableGetRankedRefreshRatesCache());
+    EXPECT_TRUE(selector.mutableGetRankedRefreshRatesCache().empty());
 
     const std::vector<LayerRequirement> layers = {{.weight = 1.f}, {.weight = 0.5f}};
     const RefreshRateSelector::GlobalSignals globalSignals{.touch = true, .idle = true};
@@ -3277,12 +3281,37 @@ TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_WritesCache) {
     const auto result = selector.getRankedFrameRates(layers, globalSignals, pacesetterFps);
 
     const auto& cache = selector.mutableGetRankedRefreshRatesCache();
-    ASSERT_TRUE(cache);
+    ASSERT_EQ(1u, cache.size());
 
-    EXPECT_EQ(cache->layers, layers);
-    EXPECT_EQ(cache->signals, globalSignals);
-    EXPECT_EQ(cache->pacesetterFps, pacesetterFps);
-    EXPECT_EQ(cache->result, result);
+    EXPECT_EQ(cache.front().layers, layers);
+    EXPECT_EQ(cache.front().signals, globalSignals);
+    EXPECT_EQ(cache.front().pacesetterFps, pacesetterFps);
+    EXPECT_EQ(cache.front().result, result);
+}
+
+TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_KeepsRecentlyUsedCacheEntries) {
+    auto selector = createSelector(kModes_30_60_72_90_120, kModeId60);
+
+    const std::vector<LayerRequirement> layers = {{.weight = 1.f}};
+    const RefreshRateSelector::GlobalSignals touch{.touch = true};
+    const RefreshRateSelector::GlobalSignals idle{.idle = true};
+
+    selector.getRankedFrameRates(layers, touch);
+    selector.getRankedFrameRates(layers, idle);
+
+    const auto& cache = selector.mutableGetRankedRefreshRatesCache();
+    ASSERT_EQ(2u, cache.size());
+    EXPECT_EQ(idle, cache.front().signals);
+
+    // A hit moves the entry to the front instead of adding another one.
+    selector.getRankedFrameRates(layers, touch);
+    ASSERT_EQ(2u, cache.size());
+    EXPECT_EQ(touch, cache.front().signals);
+
+    for (int i = 0; i < 8; i++) {
+        selector.getRankedFrameRates(layers, {}, Fps::fromValue(30.f + static_cast<float>(i)));
+    }
+    EXPECT_EQ(TestableRefreshRateSelector::kMaxRankedFrameRatesCacheSize, cache.size());
 }
 
 TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ExplicitExactTouchBoost) {
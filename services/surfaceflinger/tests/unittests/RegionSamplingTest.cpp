@@ -106,6 +106,29 @@ TEST_F(RegionSamplingTest, bounds_checking) {
                 testing::Eq(0.0));
 }
 
+TEST_F(RegionSamplingTest, sample_buffer_size_is_capped) {
+    EXPECT_EQ(ui::Size(1080, 120), getSampleBufferSize(ui::Size(1080, 120), 0));
+    EXPECT_EQ(ui::Size(60, 50), getSampleBufferSize(ui::Size(60, 50), 64));
+    EXPECT_EQ(ui::Size(64, 7), getSampleBufferSize(ui::Size(1080, 120), 64));
+    EXPECT_EQ(ui::Size(1, 64), getSampleBufferSize(ui::Size(10, 2400), 64));
+}
+
+TEST_F(RegionSamplingTest, sample_area_is_scaled_to_buffer) {
+    const Rect sampledBounds{100, 200, 1180, 320};
+
+    // Rendered at full size, the area is only offset.
+    EXPECT_EQ(Rect(0, 0, 540, 120),
+              scaleSampleArea(Rect(100, 200, 640, 320), sampledBounds, ui::Size(1080, 120)));
+
+    // Scaled down, the area covers every pixel it contributes to.
+    EXPECT_EQ(Rect(0, 0, 32, 12),
+              scaleSampleArea(Rect(100, 200, 640, 320), sampledBounds, ui::Size(64, 12)));
+    EXPECT_EQ(Rect(30, 0, 34, 12),
+              scaleSampleArea(Rect(620, 200, 660, 320), sampledBounds, ui::Size(64, 12)));
+    EXPECT_EQ(Rect(63, 11, 64, 12),
+              scaleSampleArea(Rect(1170, 310, 1180, 320), sampledBounds, ui::Size(64, 12)));
+}
+
 } // namespace android
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
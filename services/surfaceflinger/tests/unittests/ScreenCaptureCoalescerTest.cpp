@@ -0,0 +1,137 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android/gui/BnScreenCaptureListener.h>
+#include <binder/Binder.h>
+#include <gtest/gtest.h>
+
+#include "ScreenCaptureCoalescer.h"
+
+namespace android {
+namespace {
+
+using gui::ScreenCaptureResults;
+
+class Listener : public gui::BnScreenCaptureListener {
+public:
+    binder::Status onScreenCaptureCompleted(const ScreenCaptureResults& results) override {
+        mResults.push_back(results);
+        return binder::Status::ok();
+    }
+
+    std::vector<ScreenCaptureResults> mResults;
+};
+
+class ScreenCaptureCoalescerTest : public testing::Test {
+protected:
+    ScreenCaptureCoalescer::Key makeKey() const {
+        return {.displayToken = mDisplayToken,
+                .sourceCrop = Rect(0, 0, 100, 200),
+                .size = ui::Size(100, 200)};
+    }
+
+    static ScreenCaptureResults makeResults(status_t status = NO_ERROR) {
+        ScreenCaptureResults results;
+        if (status != NO_ERROR) {
+            results.fenceResult = base::unexpected(status);
+        }
+        results.capturedSecureLayers = true;
+        return results;
+    }
+
+    const sp<IBinder> mDisplayToken = sp<BBinder>::make();
+    ScreenCaptureCoalescer mCoalescer;
+};
+
+TEST_F(ScreenCaptureCoalescerTest, sharesCaptureInProgress) {
+    const auto first = sp<Listener>::make();
+    const auto second = sp<Listener>::make();
+
+    const auto capture = mCoalescer.coalesce(makeKey(), first);
+    ASSERT_NE(nullptr, capture);
+    EXPECT_EQ(nullptr, mCoalescer.coalesce(makeKey(), second));
+    EXPECT_TRUE(second->mResults.empty());
+
+    capture->onScreenCaptureCompleted(makeResults());
+    ASSERT_EQ(1u, first->mResults.size());
+    ASSERT_EQ(1u, second->mResults.size());
+    EXPECT_TRUE(second->mResults[0].capturedSecureLayers);
+    EXPECT_EQ(1u, mCoalescer.getStats().joined);
+}
+
+TEST_F(ScreenCaptureCoalescerTest, answersFromCacheUntilFrameCommitted) {
+    const auto first = sp<Listener>::make();
+    mCoalescer.coalesce(makeKey(), first)->onScreenCaptureCompleted(makeResults());
+
+    const auto second = sp<Listener>::make();
+    EXPECT_EQ(nullptr, mCoalescer.coalesce(makeKey(), second));
+    EXPECT_EQ(1u, second->mResults.size());
+    EXPECT_EQ(1u, mCoalescer.getStats().cached);
+
+    mCoalescer.onFrameCommitted();
+    const auto third = sp<Listener>::make();
+    EXPECT_NE(nullptr, mCoalescer.coalesce(makeKey(), third));
+    EXPECT_TRUE(third->mResults.empty());
+}
+
+TEST_F(ScreenCaptureCoalescerTest, doesNotJoinCaptureOfPreviousFrame) {
+    const auto capture = mCoalescer.coalesce(makeKey(), sp<Listener>::make());
+    mCoalescer.onFrameCommitted();
+
+    const auto second = sp<Listener>::make();
+    const auto secondCapture = mCoalescer.coalesce(makeKey(), second);
+    ASSERT_NE(nullptr, secondCapture);
+
+    // The capture of the previous frame is not cached once it completes.
+    capture->onScreenCaptureCompleted(makeResults());
+    EXPECT_TRUE(second->mResults.empty());
+    EXPECT_NE(nullptr, mCoalescer.coalesce(makeKey(), sp<Listener>::make()));
+}
+
+TEST_F(ScreenCaptureCoalescerTest, doesNotShareDifferentCaptures) {
+    auto key = makeKey();
+    key.grayscale = true;
+    EXPECT_NE(nullptr, mCoalescer.coalesce(makeKey(), sp<Listener>::make()));
+    EXPECT_NE(nullptr, mCoalescer.coalesce(key, sp<Listener>::make()));
+
+    key = makeKey();
+    key.uid = 10001;
+    EXPECT_NE(nullptr, mCoalescer.coalesce(key, sp<Listener>::make()));
+}
+
+TEST_F(ScreenCaptureCoalescerTest, ignoresOrderOfExcludedLayers) {
+    auto key = makeKey();
+    key.excludeLayerIds = {3, 1, 2};
+    EXPECT_NE(nullptr, mCoalescer.coalesce(key, sp<Listener>::make()));
+
+    key.excludeLayerIds = {2, 3, 1};
+    EXPECT_EQ(nullptr, mCoalescer.coalesce(key, sp<Listener>::make()));
+}
+
+TEST_F(ScreenCaptureCoalescerTest, doesNotCacheFailedCaptures) {
+    const auto first = sp<Listener>::make();
+    const auto second = sp<Listener>::make();
+    const auto capture = mCoalescer.coalesce(makeKey(), first);
+    mCoalescer.coalesce(makeKey(), second);
+
+    capture->onScreenCaptureCompleted(makeResults(NO_MEMORY));
+    ASSERT_EQ(1u, second->mResults.size());
+    EXPECT_FALSE(second->mResults[0].fenceResult.ok());
+    EXPECT_NE(nullptr, mCoalescer.coalesce(makeKey(), sp<Listener>::make()));
+}
+
+} // namespace
+} // namespace android
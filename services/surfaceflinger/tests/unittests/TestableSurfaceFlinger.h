@@ -198,6 +198,9 @@ public:
         mFlinger->mCompositionEngine->setTimeStats(timeStats);
     }
 
+    // Shares SurfaceFlinger's own TimeStats with CompositionEngine, as SurfaceFlinger::init does.
+    void setupDefaultTimeStats() { setupTimeStats(mFlinger->mTimeStats); }
+
     void setupCompositionEngine(
             std::unique_ptr<compositionengine::CompositionEngine> compositionEngine) {
         mFlinger->mCompositionEngine = std::move(compositionEngine);
@@ -32,6 +32,7 @@
 
 #include <chrono>
 #include <random>
+#include <thread>
 #include <unordered_set>
 
 #include "libsurfaceflinger_unittest_main.h"
@@ -742,6 +743,32 @@ TEST_F(TimeStatsTest, canInsertMultipleLayersTimeStats) {
     EXPECT_EQ(2, globalProto.stats_size());
 }
 
+TEST_F(TimeStatsTest, canInsertLayerTimeStatsFromMultipleThreads) {
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    // Enough frames for the pending samples to be merged while recording.
+    constexpr uint64_t kFrameCount = 1000;
+    const auto recordFrames = [&](int32_t layerId) {
+        for (uint64_t frameNumber = 1; frameNumber <= kFrameCount; frameNumber++) {
+            insertTimeRecord(NORMAL_SEQUENCE, layerId, frameNumber,
+                             static_cast<nsecs_t>(frameNumber) * 10000000);
+        }
+    };
+    std::thread thread0(recordFrames, LAYER_ID_0);
+    std::thread thread1(recordFrames, LAYER_ID_1);
+    thread0.join();
+    thread1.join();
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(2, globalProto.stats_size());
+    for (const SFTimeStatsLayerProto& layerProto : globalProto.stats()) {
+        // The first frame of a layer has no previous present to compare with.
+        EXPECT_EQ(static_cast<int32_t>(kFrameCount - 1), layerProto.total_frames());
+    }
+}
+
 TEST_F(TimeStatsTest, canInsertUnorderedLayerTimeStats) {
     EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
 
@@ -1539,6 +1566,85 @@ TEST_F(TimeStatsTest, layerStatsCallback_limitsLayers) {
     EXPECT_EQ(atomList.atom(0).layer_name(), genLayerName(LAYER_ID_1));
 }
 
+TEST(LatencyHistogramTest, summarizesPercentiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.summarize().count, 0u);
+
+    // 100us, 200us, ..., 10ms.
+    for (nsecs_t i = 100; i > 0; i--) {
+        histogram.record(i * us2ns(100));
+    }
+
+    // Percentiles are reported as the end of their bucket, within 25% of the actual value.
+    const LatencyHistogram::Summary summary = histogram.summarize();
+    EXPECT_EQ(summary.count, 100u);
+    EXPECT_GE(summary.p50, us2ns(5000));
+    EXPECT_LE(summary.p50, us2ns(6250));
+    EXPECT_GE(summary.p90, us2ns(9000));
+    EXPECT_LE(summary.p90, us2ns(10000));
+    EXPECT_EQ(summary.p99, us2ns(10000));
+    EXPECT_EQ(summary.max, us2ns(10000));
+    // The total is exact.
+    EXPECT_EQ(summary.total, us2ns(100) * 5050);
+
+    histogram.clear();
+    EXPECT_EQ(histogram.summarize().count, 0u);
+    EXPECT_EQ(histogram.summarize().max, 0);
+    EXPECT_EQ(histogram.summarize().total, 0);
+}
+
+TEST(LatencyHistogramTest, countsOutOfRangeDurations) {
+    LatencyHistogram histogram;
+    histogram.record(-1);
+    histogram.record(10);
+    histogram.record(s2ns(5));
+
+    const LatencyHistogram::Summary summary = histogram.summarize();
+    EXPECT_EQ(summary.count, 3u);
+    EXPECT_LE(summary.p50, us2ns(2));
+    EXPECT_EQ(summary.p99, s2ns(5));
+    EXPECT_EQ(summary.max, s2ns(5));
+}
+
+TEST_F(TimeStatsTest, recordsStageLatenciesWhileDisabled) {
+    ASSERT_FALSE(mTimeStats->isEnabled());
+    mTimeStats->recordStageLatency(TimeStats::LatencyStage::HwcPresent, ms2ns(2));
+
+    std::string result;
+    mTimeStats->dumpStageLatencies(result);
+    EXPECT_THAT(result, HasSubstr("HwcPresent"));
+    EXPECT_THAT(result, HasSubstr("2000"));
+}
+
+TEST_F(TimeStatsTest, canPullStageLatencyAtom) {
+    mTimeStats->recordStageLatency(TimeStats::LatencyStage::TransactionFlush, us2ns(300));
+    mTimeStats->recordStageLatency(TimeStats::LatencyStage::TransactionFlush, us2ns(300));
+    mTimeStats->recordStageLatency(TimeStats::LatencyStage::RenderEngine, ms2ns(4));
+
+    std::vector<uint8_t> pulledBytes;
+    EXPECT_TRUE(mTimeStats->onPullAtom(10224 /*SURFACEFLINGER_STAGE_LATENCY*/, &pulledBytes));
+    std::string pulledData;
+    pulledData.assign(pulledBytes.begin(), pulledBytes.end());
+
+    android::surfaceflinger::SurfaceflingerStageLatencyWrapper atomList;
+    ASSERT_TRUE(atomList.ParseFromString(pulledData));
+    ASSERT_EQ(atomList.atom_size(), 2);
+
+    using android::surfaceflinger::SurfaceflingerStageLatency;
+    EXPECT_EQ(atomList.atom(0).stage(), SurfaceflingerStageLatency::TRANSACTION_FLUSH);
+    EXPECT_EQ(atomList.atom(0).count(), 2);
+    EXPECT_EQ(atomList.atom(0).max_micros(), 300);
+    EXPECT_EQ(atomList.atom(1).stage(), SurfaceflingerStageLatency::RENDER_ENGINE);
+    EXPECT_EQ(atomList.atom(1).count(), 1);
+    EXPECT_EQ(atomList.atom(1).p50_micros(), 4000);
+
+    // Pulling starts over.
+    EXPECT_TRUE(mTimeStats->onPullAtom(10224 /*SURFACEFLINGER_STAGE_LATENCY*/, &pulledBytes));
+    pulledData.assign(pulledBytes.begin(), pulledBytes.end());
+    ASSERT_TRUE(atomList.ParseFromString(pulledData));
+    EXPECT_EQ(atomList.atom_size(), 0);
+}
+
 TEST_F(TimeStatsTest, canSurviveMonkey) {
     if (g_noSlowTests) {
         GTEST_SKIP();
@@ -17,6 +17,7 @@
 #undef LOG_TAG
 #define LOG_TAG "TransactionApplicationTest"
 
+#include <android-base/unique_fd.h>
 #include <binder/Binder.h>
 #include <common/test/FlagUtils.h>
 #include <compositionengine/Display.h>
@@ -29,6 +30,7 @@
 #include <log/log.h>
 #include <renderengine/mock/RenderEngine.h>
 #include <ui/MockFence.h>
+#include <unistd.h>
 #include <utils/String8.h>
 #include <vector>
 
@@ -966,6 +968,52 @@ TEST(TransactionHandlerTest, QueueTransaction) {
     EXPECT_EQ(transactionsReadyToBeApplied.front().id, 42u);
 }
 
+TEST(TransactionHandlerTest, RecyclesFlushedTransactionStorage) {
+    TransactionHandler handler;
+    for (uint64_t frame = 0; frame < 3; frame++) {
+        for (uint64_t i = 0; i < 4; i++) {
+            TransactionState transaction;
+            transaction.applyToken = sp<BBinder>::make();
+            transaction.id = frame * 4 + i;
+            handler.queueTransaction(std::move(transaction));
+        }
+        handler.collectTransactions();
+        std::vector<TransactionState> transactions = handler.flushTransactions();
+        EXPECT_EQ(transactions.size(), 4u);
+        handler.recycleFlushedTransactions(std::move(transactions));
+    }
+
+    EXPECT_EQ(handler.getStats().flushes, 3u);
+    EXPECT_EQ(handler.getStats().transactionsFlushed, 12u);
+    EXPECT_EQ(handler.getStats().maxTransactionsPerFlush, 4u);
+    EXPECT_EQ(handler.getStats().storageAllocations, 1u);
+}
+
+TEST(TransactionHandlerTest, FenceStatusCachePollsEachFenceOncePerFlush) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    base::unique_fd writeFd(fds[1]);
+    // A pipe's read end polls like a fence that signals once data is written.
+    const auto fence = sp<Fence>::make(fds[0]);
+    const auto fakeFence = sp<mock::MockFence>::make();
+    EXPECT_CALL(*fakeFence, getStatus()).Times(1).WillOnce(Return(Fence::Status::Signaled));
+
+    TransactionHandler::FenceStatusCache cache;
+    EXPECT_EQ(cache.prefetch({fence, fence, fakeFence}), 1u);
+    EXPECT_EQ(cache.getStatus(fence), Fence::Status::Unsignaled);
+    EXPECT_EQ(cache.getStatus(fakeFence), Fence::Status::Signaled);
+    EXPECT_EQ(cache.getStatus(fakeFence), Fence::Status::Signaled);
+
+    // The cached state holds until the next flush.
+    ASSERT_EQ(write(writeFd.get(), "x", 1), 1);
+    EXPECT_EQ(cache.prefetch({fence}), 0u);
+    EXPECT_EQ(cache.getStatus(fence), Fence::Status::Unsignaled);
+
+    cache.clear();
+    EXPECT_EQ(cache.prefetch({fence}), 1u);
+    EXPECT_EQ(cache.getStatus(fence), Fence::Status::Signaled);
+}
+
 TEST(TransactionHandlerTest, TransactionsKeepTrackOfDirectMerges) {
     SurfaceComposerClient::Transaction transaction1, transaction2, transaction3, transaction4;
 
@@ -338,4 +338,67 @@ TEST(LayerTraceTest, canStreamLayersTrace) {
     // magic?
     EXPECT_EQ(outProto.entry().size(), 3);
 }
+
+TEST(TransactionRingBufferTest, compressesOlderEntries) {
+    using RingBuffer = TransactionRingBuffer<perfetto::protos::TransactionTraceFile,
+                                             perfetto::protos::TransactionTraceEntry>;
+    RingBuffer buffer;
+    buffer.setSize(RingBuffer::kSegmentSizeInBytes * RingBuffer::kMinSegmentsForCompression);
+
+    size_t totalBytes = 0;
+    int64_t vsyncId = 0;
+    while (totalBytes < 4 * RingBuffer::kSegmentSizeInBytes) {
+        perfetto::protos::TransactionTraceEntry entry;
+        entry.set_vsync_id(++vsyncId);
+        entry.set_elapsed_realtime_nanos(vsyncId * 16'666'667);
+        auto* transaction = entry.add_transactions();
+        transaction->set_pid(1);
+        transaction->set_uid(2);
+        transaction->add_layer_changes()->set_z(static_cast<int32_t>(vsyncId % 4));
+        totalBytes += static_cast<size_t>(entry.ByteSizeLong());
+        EXPECT_TRUE(buffer.emplace(std::move(entry)).empty());
+    }
+
+    // Similar entries compress well, so they all fit in much less than their size.
+    EXPECT_LT(buffer.used(), totalBytes / 2);
+    EXPECT_EQ(static_cast<size_t>(vsyncId), buffer.frameCount());
+
+    perfetto::protos::TransactionTraceFile proto;
+    buffer.writeToProto(proto);
+    ASSERT_EQ(vsyncId, proto.entry().size());
+    for (int i = 0; i < proto.entry().size(); i++) {
+        EXPECT_EQ(i + 1, proto.entry(i).vsync_id());
+        EXPECT_EQ(1, proto.entry(i).transactions(0).pid());
+    }
+}
+
+TEST(TransactionRingBufferTest, evictsCompressedEntriesInOrder) {
+    using RingBuffer = TransactionRingBuffer<perfetto::protos::TransactionTraceFile,
+                                             perfetto::protos::TransactionTraceEntry>;
+    RingBuffer buffer;
+    buffer.setSize(RingBuffer::kSegmentSizeInBytes * RingBuffer::kMinSegmentsForCompression);
+
+    // Random-ish payloads, so that the buffer fills up even when compressed.
+    int64_t nextEvictedVsyncId = 1;
+    uint32_t seed = 1;
+    for (int64_t vsyncId = 1; nextEvictedVsyncId == 1 || vsyncId < 20000; vsyncId++) {
+        perfetto::protos::TransactionTraceEntry entry;
+        entry.set_vsync_id(vsyncId);
+        for (int i = 0; i < 16; i++) {
+            seed = seed * 1103515245 + 12345;
+            entry.add_destroyed_layers(seed);
+        }
+        for (const std::string& evicted : buffer.emplace(std::move(entry))) {
+            perfetto::protos::TransactionTraceEntry evictedEntry;
+            evictedEntry.ParseFromString(evicted);
+            EXPECT_EQ(nextEvictedVsyncId++, evictedEntry.vsync_id());
+        }
+        EXPECT_LE(buffer.used(), buffer.size());
+    }
+
+    perfetto::protos::TransactionTraceEntry front;
+    front.ParseFromString(buffer.front());
+    EXPECT_EQ(nextEvictedVsyncId, front.vsync_id());
+}
+
 } // namespace android
@@ -297,6 +297,20 @@ TEST_F(VSyncDispatchTimerQueueTest, updateAlarmSettingFuture) {
     EXPECT_THAT(cb.mWakeupTime[0], Eq(700));
 }
 
+TEST_F(VSyncDispatchTimerQueueTest, dumpsWakeupSlop) {
+    EXPECT_CALL(mMockClock, alarmAt(_, 900));
+
+    CountingCallback cb(mDispatch);
+    mDispatch->schedule(cb,
+                        {.workDuration = 100, .readyDuration = 0, .lastVsync = mPeriod - 230});
+    advanceToNextCallback();
+    ASSERT_THAT(cb.mCalls.size(), Eq(1));
+
+    std::string dump;
+    mDispatch->dump(dump);
+    EXPECT_THAT(dump, HasSubstr("wakeup slop: early=0 late=1"));
+}
+
 TEST_F(VSyncDispatchTimerQueueTest, updateDoesntSchedule) {
     auto intended = mPeriod - 230;
     EXPECT_CALL(mMockClock, alarmAt(_, _)).Times(0);
@@ -304,6 +304,23 @@ TEST_F(VSyncPredictorTest, againstOutliersDiscontinuous_500hzLowVariance) {
     EXPECT_THAT(intercept, IsCloseTo(expectedIntercept, mMaxRoundingError));
 }
 
+TEST_F(VSyncPredictorTest, theilSenFitIgnoresInPhaseOutliers) {
+    tracker.setModelFit(VSyncPredictor::ModelFit::TheilSen);
+
+    // Late enough to skew a least squares fit, but close enough to the ideal period to be
+    // accepted as valid timestamps.
+    auto vsyncs = generateVsyncTimestamps(kHistorySize, mPeriod, 0);
+    vsyncs[kHistorySize - 2] += mPeriod / 5;
+    vsyncs[kHistorySize - 1] += mPeriod / 5;
+    for (auto const& timestamp : vsyncs) {
+        tracker.addVsyncTimestamp(timestamp);
+    }
+
+    auto [slope, intercept] = tracker.getVSyncPredictionModel();
+    EXPECT_EQ(mPeriod, slope);
+    EXPECT_EQ(0, intercept);
+}
+
 TEST_F(VSyncPredictorTest, handlesVsyncChange) {
     auto const fastPeriod = 100;
     auto const fastTimeBase = 100;
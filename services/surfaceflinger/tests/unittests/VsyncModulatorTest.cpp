@@ -209,4 +209,46 @@ TEST_F(VsyncModulatorTest, EarlyStartWithBinderDeath) {
     CHECK_COMMIT(std::nullopt, kLate);
 }
 
+TEST_F(VsyncModulatorTest, AdaptiveWorkDurationFollowsFrameWorkDurations) {
+    using namespace std::chrono_literals;
+
+    const VsyncConfig early{0, 0, 12ms, 10ms};
+    const VsyncConfig earlyGpu{0, 0, 14ms, 10ms};
+    const VsyncConfig late{0, 0, 10ms, 10ms};
+    const auto modulator = sp<VsyncModulator>::make(VsyncConfigSet{early, earlyGpu, late, 2ms});
+
+    EXPECT_EQ(std::nullopt, modulator->setAdaptiveWorkDurationEnabled(true));
+    for (size_t i = 1; i < VsyncModulator::MIN_ADAPTIVE_WORK_DURATION_FRAMES; i++) {
+        EXPECT_EQ(std::nullopt, modulator->onFrameWorkDuration(6ms));
+    }
+
+    // Cheap frames let SF wake up later, with some margin.
+    VsyncConfig adaptiveLate = late;
+    adaptiveLate.sfWorkDuration = 7ms;
+    EXPECT_EQ(adaptiveLate, modulator->onFrameWorkDuration(6ms));
+    EXPECT_EQ(adaptiveLate, modulator->getVsyncConfig());
+
+    // Slightly cheaper frames don't move the wakeup.
+    EXPECT_EQ(std::nullopt, modulator->onFrameWorkDuration(5800us));
+
+    // A single expensive frame is an outlier, but once the percentile moves SF wakes up earlier
+    // right away, though no earlier than any of the static configs.
+    EXPECT_EQ(std::nullopt, modulator->onFrameWorkDuration(20ms));
+    adaptiveLate.sfWorkDuration = 14ms;
+    EXPECT_EQ(adaptiveLate, modulator->onFrameWorkDuration(20ms));
+
+    // Frames that are too cheap don't move the wakeup past half of the late work duration.
+    adaptiveLate.sfWorkDuration = 5ms;
+    for (size_t i = 0; i < VsyncModulator::ADAPTIVE_WORK_DURATION_WINDOW; i++) {
+        static_cast<void>(modulator->onFrameWorkDuration(1ms));
+    }
+    EXPECT_EQ(adaptiveLate, modulator->getVsyncConfig());
+
+    // GPU composition keeps at least the static GPU work duration.
+    EXPECT_EQ(earlyGpu, modulator->onDisplayRefresh(true));
+
+    EXPECT_EQ(earlyGpu, modulator->setAdaptiveWorkDurationEnabled(false));
+    EXPECT_EQ(std::nullopt, modulator->onFrameWorkDuration(20ms));
+}
+
 } // namespace android::scheduler
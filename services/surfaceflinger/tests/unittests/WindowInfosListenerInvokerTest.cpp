@@ -1,4 +1,5 @@
 #include <android/gui/BnWindowInfosListener.h>
+#include <android/gui/BnWindowInfosReportedListener.h>
 #include <gtest/gtest.h>
 #include <gui/SurfaceComposerClient.h>
 #include <gui/WindowInfosUpdate.h>
@@ -283,4 +284,150 @@ TEST_F(WindowInfosListenerInvokerTest, removeListenerAcks) {
     EXPECT_EQ(callCount, 2);
 }
 
+class ReportedListener : public gui::BnWindowInfosReportedListener {
+public:
+    ReportedListener(std::function<void()> callback) : mCallback(std::move(callback)) {}
+
+    binder::Status onWindowInfosReported() override {
+        mCallback();
+        return binder::Status::ok();
+    }
+
+private:
+    std::function<void()> mCallback;
+};
+
+// Test that a listener which has not acked an update is only sent the latest of the updates that
+// came after it, that it does not hold up the other listeners, and that the reported listeners are
+// called once it acks an update that supersedes theirs.
+TEST_F(WindowInfosListenerInvokerTest, coalescesUpdatesForSlowListener) {
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::vector<int64_t> slowUpdateIds;
+    gui::WindowInfosListenerInfo slowListenerInfo;
+    mInvoker->addWindowInfosListener(sp<Listener>::make([&](const gui::WindowInfosUpdate& update) {
+                                         std::scoped_lock lock{mutex};
+                                         slowUpdateIds.push_back(update.vsyncId);
+                                         cv.notify_one();
+                                     }),
+                                     &slowListenerInfo);
+
+    std::vector<int64_t> fastUpdateIds;
+    gui::WindowInfosListenerInfo fastListenerInfo;
+    mInvoker->addWindowInfosListener(sp<Listener>::make([&](const gui::WindowInfosUpdate& update) {
+                                         std::scoped_lock lock{mutex};
+                                         fastUpdateIds.push_back(update.vsyncId);
+                                         cv.notify_one();
+                                         fastListenerInfo.windowInfosPublisher
+                                                 ->ackWindowInfosReceived(update.vsyncId,
+                                                                          fastListenerInfo
+                                                                                  .listenerId);
+                                     }),
+                                     &fastListenerInfo);
+
+    bool reported = false;
+    auto reportedListener = sp<ReportedListener>::make([&]() {
+        std::scoped_lock lock{mutex};
+        reported = true;
+        cv.notify_one();
+    });
+
+    for (int64_t vsyncId = 1; vsyncId <= 3; vsyncId++) {
+        BackgroundExecutor::getInstance().sendCallbacks({[&, vsyncId]() {
+            WindowInfosReportedListenerSet reportedListeners;
+            if (vsyncId == 2) {
+                reportedListeners.insert(reportedListener);
+            }
+            mInvoker->windowInfosChanged({{}, {}, vsyncId, 0}, std::move(reportedListeners),
+                                         false);
+        }});
+        BackgroundExecutor::getInstance().flushQueue();
+    }
+
+    {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return fastUpdateIds.size() == 3; });
+    }
+    EXPECT_EQ(fastUpdateIds, (std::vector<int64_t>{1, 2, 3}));
+    EXPECT_EQ(slowUpdateIds, (std::vector<int64_t>{1}));
+    EXPECT_FALSE(reported);
+
+    // Ack the first message. Only the third update should be sent.
+    slowListenerInfo.windowInfosPublisher->ackWindowInfosReceived(1, slowListenerInfo.listenerId);
+    {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return slowUpdateIds.size() == 2; });
+    }
+    EXPECT_EQ(slowUpdateIds, (std::vector<int64_t>{1, 3}));
+    EXPECT_FALSE(reported);
+
+    slowListenerInfo.windowInfosPublisher->ackWindowInfosReceived(3, slowListenerInfo.listenerId);
+    {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return reported; });
+    }
+
+    auto debugInfo = mInvoker->getDebugInfo();
+    EXPECT_EQ(debugInfo.coalescedUpdates, 1u);
+    EXPECT_EQ(debugInfo.acksReceived, 5u);
+    EXPECT_EQ(debugInfo.pendingMessageCount, 0u);
+}
+
+// Test that listeners which opted into delta updates receive only the changed windows once they
+// have a complete update, and can rebuild the full window list from it.
+TEST_F(WindowInfosListenerInvokerTest, sendsDeltaUpdates) {
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::vector<gui::WindowInfosUpdate> updates;
+    gui::WindowInfosListenerInfo listenerInfo;
+    mInvoker->addWindowInfosListener(sp<Listener>::make([&](const gui::WindowInfosUpdate& update) {
+                                         std::scoped_lock lock{mutex};
+                                         updates.push_back(update);
+                                         cv.notify_one();
+                                         listenerInfo.windowInfosPublisher
+                                                 ->ackWindowInfosReceived(update.vsyncId,
+                                                                          listenerInfo.listenerId);
+                                     }),
+                                     &listenerInfo);
+    listenerInfo.windowInfosPublisher->enableDeltaUpdates(listenerInfo.listenerId);
+
+    std::vector<gui::WindowInfo> windowInfos(4);
+    for (size_t i = 0; i < windowInfos.size(); i++) {
+        windowInfos[i].id = static_cast<int32_t>(i);
+        windowInfos[i].name = "window" + std::to_string(i);
+    }
+
+    BackgroundExecutor::getInstance().sendCallbacks({[&, this]() {
+        mInvoker->windowInfosChanged(gui::WindowInfosUpdate{windowInfos, {}, 0, 0}, {}, false);
+    }});
+    {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return updates.size() == 1; });
+    }
+
+    windowInfos[2].alpha = 0.5f;
+    windowInfos.erase(windowInfos.begin() + 3);
+    BackgroundExecutor::getInstance().sendCallbacks({[&, this]() {
+        mInvoker->windowInfosChanged(gui::WindowInfosUpdate{windowInfos, {}, 1, 0}, {}, false);
+    }});
+
+    std::unique_lock lock{mutex};
+    cv.wait(lock, [&]() { return updates.size() == 2; });
+
+    EXPECT_FALSE(updates[0].isDelta);
+    ASSERT_TRUE(updates[1].isDelta);
+    EXPECT_EQ(updates[1].baseGeneration, updates[0].generation);
+    ASSERT_EQ(updates[1].windowInfos.size(), 1u);
+    EXPECT_EQ(updates[1].windowInfos[0].id, 2);
+
+    std::vector<gui::WindowInfo> resolved = updates[0].windowInfos;
+    ASSERT_TRUE(updates[1].applyDelta(resolved));
+    ASSERT_EQ(resolved.size(), windowInfos.size());
+    for (size_t i = 0; i < resolved.size(); i++) {
+        EXPECT_TRUE(resolved[i].hasSameContent(windowInfos[i]));
+    }
+}
+
 } // namespace android
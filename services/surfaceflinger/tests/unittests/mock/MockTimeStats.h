@@ -37,6 +37,8 @@ public:
     MOCK_METHOD2(recordFrameDuration, void(nsecs_t, nsecs_t));
     MOCK_METHOD2(recordRenderEngineDuration, void(nsecs_t, nsecs_t));
     MOCK_METHOD2(recordRenderEngineDuration, void(nsecs_t, const std::shared_ptr<FenceTime>&));
+    MOCK_METHOD(void, recordStageLatency, (LatencyStage, nsecs_t), (override));
+    MOCK_METHOD(void, dumpStageLatencies, (std::string&), (const, override));
     MOCK_METHOD(void, setPostTime,
                 (int32_t, uint64_t, const std::string&, uid_t, nsecs_t, GameMode), (override));
     MOCK_METHOD2(incrementLatchSkipped, void(int32_t layerId, LatchSkipReason reason));
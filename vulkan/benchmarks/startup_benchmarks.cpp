@@ -0,0 +1,196 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how long vkCreateInstance and vkCreateDevice take, through the
+// loader with the driver of the device, and straight into the null driver.
+// The null driver does next to nothing, so the latter is the floor that the
+// loader adds its own work to.
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/properties.h>
+#include <dlfcn.h>
+#include <hardware/hwvulkan.h>
+#include <vndksupport/linker.h>
+#include <vulkan/vulkan.h>
+
+namespace {
+
+constexpr char kLazyDispatchProperty[] = "debug.vulkan.lazy_dispatch";
+
+const VkApplicationInfo kAppInfo = {
+    .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+    .pApplicationName = "startup_benchmarks",
+    .apiVersion = VK_API_VERSION_1_3,
+};
+
+const VkInstanceCreateInfo kInstanceInfo = {
+    .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+    .pApplicationInfo = &kAppInfo,
+};
+
+const float kQueuePriority = 1.0f;
+
+const VkDeviceQueueCreateInfo kQueueInfo = {
+    .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+    .queueFamilyIndex = 0,
+    .queueCount = 1,
+    .pQueuePriorities = &kQueuePriority,
+};
+
+const VkDeviceCreateInfo kDeviceInfo = {
+    .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+    .queueCreateInfoCount = 1,
+    .pQueueCreateInfos = &kQueueInfo,
+};
+
+// The argument of the loader benchmarks selects debug.vulkan.lazy_dispatch.
+void SetLazyDispatch(benchmark::State& state) {
+    android::base::SetProperty(kLazyDispatchProperty,
+                               state.range(0) ? "true" : "false");
+}
+
+void BM_LoaderCreateInstance(benchmark::State& state) {
+    SetLazyDispatch(state);
+    for (auto _ : state) {
+        VkInstance instance;
+        if (vkCreateInstance(&kInstanceInfo, nullptr, &instance) !=
+            VK_SUCCESS) {
+            state.SkipWithError("vkCreateInstance failed");
+            break;
+        }
+        vkDestroyInstance(instance, nullptr);
+    }
+    android::base::SetProperty(kLazyDispatchProperty, "");
+}
+BENCHMARK(BM_LoaderCreateInstance)->Arg(0)->Arg(1);
+
+void BM_LoaderCreateDevice(benchmark::State& state) {
+    SetLazyDispatch(state);
+    VkInstance instance;
+    uint32_t count = 1;
+    VkPhysicalDevice gpu;
+    if (vkCreateInstance(&kInstanceInfo, nullptr, &instance) != VK_SUCCESS) {
+        state.SkipWithError("vkCreateInstance failed");
+        return;
+    }
+    if (vkEnumeratePhysicalDevices(instance, &count, &gpu) < 0 || !count) {
+        state.SkipWithError("no physical device");
+        vkDestroyInstance(instance, nullptr);
+        return;
+    }
+    for (auto _ : state) {
+        VkDevice device;
+        if (vkCreateDevice(gpu, &kDeviceInfo, nullptr, &device) !=
+            VK_SUCCESS) {
+            state.SkipWithError("vkCreateDevice failed");
+            break;
+        }
+        vkDestroyDevice(device, nullptr);
+    }
+    vkDestroyInstance(instance, nullptr);
+    android::base::SetProperty(kLazyDispatchProperty, "");
+}
+BENCHMARK(BM_LoaderCreateDevice)->Arg(0)->Arg(1);
+
+// The null driver, vulkan.default, opened the way that the loader opens a
+// HAL module.
+class NullDriver {
+   public:
+    NullDriver() {
+        void* so = android_load_sphal_library("vulkan.default.so",
+                                              RTLD_LOCAL | RTLD_NOW);
+        if (!so)
+            return;
+        auto hmi =
+            static_cast<hw_module_t*>(dlsym(so, HAL_MODULE_INFO_SYM_AS_STR));
+        if (!hmi || hmi->methods->open(hmi, HWVULKAN_DEVICE_0,
+                                       reinterpret_cast<hw_device_t**>(
+                                           &device_)) != 0) {
+            device_ = nullptr;
+        }
+    }
+
+    bool IsValid() const { return device_ != nullptr; }
+
+    VkResult CreateInstance(VkInstance* instance) const {
+        return device_->CreateInstance(&kInstanceInfo, nullptr, instance);
+    }
+
+    template <typename PFN>
+    PFN Get(VkInstance instance, const char* name) const {
+        return reinterpret_cast<PFN>(
+            device_->GetInstanceProcAddr(instance, name));
+    }
+
+   private:
+    hwvulkan_device_t* device_ = nullptr;
+};
+
+const NullDriver& GetNullDriver() {
+    static const NullDriver driver;
+    return driver;
+}
+
+void BM_NullDriverCreateInstance(benchmark::State& state) {
+    const NullDriver& driver = GetNullDriver();
+    if (!driver.IsValid()) {
+        state.SkipWithError("vulkan.default.so is not installed");
+        return;
+    }
+    for (auto _ : state) {
+        VkInstance instance;
+        if (driver.CreateInstance(&instance) != VK_SUCCESS) {
+            state.SkipWithError("vkCreateInstance failed");
+            break;
+        }
+        driver.Get<PFN_vkDestroyInstance>(instance, "vkDestroyInstance")(
+            instance, nullptr);
+    }
+}
+BENCHMARK(BM_NullDriverCreateInstance);
+
+void BM_NullDriverCreateDevice(benchmark::State& state) {
+    const NullDriver& driver = GetNullDriver();
+    VkInstance instance;
+    if (!driver.IsValid() || driver.CreateInstance(&instance) != VK_SUCCESS) {
+        state.SkipWithError("vulkan.default.so is not installed");
+        return;
+    }
+    auto destroy_instance =
+        driver.Get<PFN_vkDestroyInstance>(instance, "vkDestroyInstance");
+    uint32_t count = 1;
+    VkPhysicalDevice gpu;
+    driver.Get<PFN_vkEnumeratePhysicalDevices>(
+        instance, "vkEnumeratePhysicalDevices")(instance, &count, &gpu);
+    auto create_device =
+        driver.Get<PFN_vkCreateDevice>(instance, "vkCreateDevice");
+    for (auto _ : state) {
+        VkDevice device;
+        if (create_device(gpu, &kDeviceInfo, nullptr, &device) != VK_SUCCESS) {
+            state.SkipWithError("vkCreateDevice failed");
+            break;
+        }
+        driver.Get<PFN_vkDestroyDevice>(instance, "vkDestroyDevice")(device,
+                                                                     nullptr);
+    }
+    destroy_instance(instance, nullptr);
+}
+BENCHMARK(BM_NullDriverCreateDevice);
+
+}  // namespace
+
+BENCHMARK_MAIN();
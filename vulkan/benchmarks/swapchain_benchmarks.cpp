@@ -0,0 +1,355 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the CPU time per frame of vkAcquireNextImageKHR and
+// vkQueuePresentKHR, through the loader on top of the null driver, into a
+// BufferQueue whose consumer latches every buffer as soon as it is queued.
+// Neither the null driver nor the consumer waits on anything, so what is
+// measured is the swapchain of the loader and libgui, without the noise of a
+// GPU driver.
+//
+// The loader picks the null driver from debug.vulkan.driver, which it reads
+// once per process, so these run in their own binary and set it before the
+// first Vulkan call.
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/properties.h>
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/IConsumerListener.h>
+#include <gui/Surface.h>
+#include <ui/Fence.h>
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+using android::BufferItem;
+using android::BufferQueue;
+using android::IGraphicBufferConsumer;
+using android::IGraphicBufferProducer;
+using android::sp;
+
+constexpr char kDriverProperty[] = "debug.vulkan.driver";
+constexpr char kNullDriver[] = "default";
+constexpr char kNullDriverDeviceName[] = "Android Vulkan Null Driver";
+
+constexpr uint32_t kWidth = 1920;
+constexpr uint32_t kHeight = 1080;
+
+// Stands in for the compositor. A buffer is latched as soon as it is queued,
+// and the buffer that it replaces on screen is released.
+class LatchingConsumer : public android::BnConsumerListener {
+   public:
+    explicit LatchingConsumer(const sp<IGraphicBufferConsumer>& consumer)
+        : consumer_(consumer) {}
+
+    void onFrameAvailable(const BufferItem&) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        BufferItem item;
+        if (consumer_->acquireBuffer(&item, 0) != android::OK)
+            return;
+        if (latched_slot_ != BufferQueue::INVALID_BUFFER_SLOT) {
+            consumer_->releaseHelper(latched_slot_, latched_frame_,
+                                     android::Fence::NO_FENCE);
+        }
+        latched_slot_ = item.mSlot;
+        latched_frame_ = item.mFrameNumber;
+    }
+    void onBuffersReleased() override {}
+    void onSidebandStreamChanged() override {}
+
+   private:
+    const sp<IGraphicBufferConsumer> consumer_;
+    std::mutex mutex_;
+    int latched_slot_ = BufferQueue::INVALID_BUFFER_SLOT;
+    uint64_t latched_frame_ = 0;
+};
+
+// A window backed by a BufferQueue in this process.
+class Window {
+   public:
+    Window() {
+        sp<IGraphicBufferProducer> producer;
+        BufferQueue::createBufferQueue(&producer, &consumer_);
+        consumer_->setDefaultBufferSize(kWidth, kHeight);
+        listener_ = sp<LatchingConsumer>::make(consumer_);
+        consumer_->consumerConnect(listener_, false);
+        surface_ = sp<android::Surface>::make(producer);
+    }
+
+    ~Window() { consumer_->consumerDisconnect(); }
+
+    ANativeWindow* Get() const { return surface_.get(); }
+
+   private:
+    sp<IGraphicBufferConsumer> consumer_;
+    sp<LatchingConsumer> listener_;
+    sp<android::Surface> surface_;
+};
+
+struct VulkanContext {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice gpu = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    PFN_vkGetPastPresentationTimingGOOGLE get_past_presentation_timing =
+        nullptr;
+    // Set if the context could not be created.
+    std::string error;
+};
+
+VulkanContext CreateContext() {
+    VulkanContext context;
+
+    const char* const instance_extensions[] = {
+        VK_KHR_SURFACE_EXTENSION_NAME,
+        VK_KHR_ANDROID_SURFACE_EXTENSION_NAME,
+    };
+    const VkApplicationInfo app_info = {
+        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .pApplicationName = "swapchain_benchmarks",
+        .apiVersion = VK_API_VERSION_1_1,
+    };
+    const VkInstanceCreateInfo instance_info = {
+        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pApplicationInfo = &app_info,
+        .enabledExtensionCount = 2,
+        .ppEnabledExtensionNames = instance_extensions,
+    };
+    if (vkCreateInstance(&instance_info, nullptr, &context.instance) !=
+        VK_SUCCESS) {
+        context.error = "vkCreateInstance failed";
+        return context;
+    }
+
+    uint32_t count = 1;
+    if (vkEnumeratePhysicalDevices(context.instance, &count, &context.gpu) <
+            0 ||
+        !count) {
+        context.error = "no physical device";
+        return context;
+    }
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.gpu, &properties);
+    if (strcmp(properties.deviceName, kNullDriverDeviceName) != 0) {
+        context.error = std::string("the null driver was not loaded, but ") +
+                        properties.deviceName +
+                        "; is the process debuggable and vulkan.default.so "
+                        "installed?";
+        return context;
+    }
+
+    const char* const device_extensions[] = {
+        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+        VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME,
+    };
+    const float priority = 1.0f;
+    const VkDeviceQueueCreateInfo queue_info = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        .queueFamilyIndex = 0,
+        .queueCount = 1,
+        .pQueuePriorities = &priority,
+    };
+    const VkDeviceCreateInfo device_info = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .queueCreateInfoCount = 1,
+        .pQueueCreateInfos = &queue_info,
+        .enabledExtensionCount = 2,
+        .ppEnabledExtensionNames = device_extensions,
+    };
+    if (vkCreateDevice(context.gpu, &device_info, nullptr, &context.device) !=
+        VK_SUCCESS) {
+        context.error = "vkCreateDevice failed";
+        return context;
+    }
+    vkGetDeviceQueue(context.device, 0, 0, &context.queue);
+    context.get_past_presentation_timing =
+        reinterpret_cast<PFN_vkGetPastPresentationTimingGOOGLE>(
+            vkGetDeviceProcAddr(context.device,
+                                "vkGetPastPresentationTimingGOOGLE"));
+    return context;
+}
+
+const VulkanContext& GetContext() {
+    static const VulkanContext context = CreateContext();
+    return context;
+}
+
+using Clock = std::chrono::steady_clock;
+
+int64_t ElapsedNs(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+        .count();
+}
+
+// The arguments are the number of swapchain images, the present mode, and
+// whether VK_GOOGLE_display_timing is used the way that an app which paces
+// its frames uses it: a present time on every present, and a poll of the
+// past presentation timings every frame.
+void BM_AcquirePresent(benchmark::State& state) {
+    const VulkanContext& context = GetContext();
+    if (!context.error.empty()) {
+        state.SkipWithError(context.error.c_str());
+        return;
+    }
+    const auto image_count = static_cast<uint32_t>(state.range(0));
+    const auto present_mode = static_cast<VkPresentModeKHR>(state.range(1));
+    const bool display_timing = state.range(2) != 0;
+
+    Window window;
+    const VkAndroidSurfaceCreateInfoKHR surface_info = {
+        .sType = VK_STRUCTURE_TYPE_ANDROID_SURFACE_CREATE_INFO_KHR,
+        .window = window.Get(),
+    };
+    VkSurfaceKHR surface;
+    if (vkCreateAndroidSurfaceKHR(context.instance, &surface_info, nullptr,
+                                  &surface) != VK_SUCCESS) {
+        state.SkipWithError("vkCreateAndroidSurfaceKHR failed");
+        return;
+    }
+
+    VkSurfaceCapabilitiesKHR capabilities;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(context.gpu, surface,
+                                              &capabilities);
+    uint32_t mode_count = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(context.gpu, surface,
+                                              &mode_count, nullptr);
+    std::vector<VkPresentModeKHR> modes(mode_count);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(context.gpu, surface,
+                                              &mode_count, modes.data());
+    if (image_count < capabilities.minImageCount ||
+        (capabilities.maxImageCount &&
+         image_count > capabilities.maxImageCount) ||
+        std::find(modes.begin(), modes.end(), present_mode) == modes.end()) {
+        state.SkipWithError("image count or present mode not supported");
+        vkDestroySurfaceKHR(context.instance, surface, nullptr);
+        return;
+    }
+
+    const VkSwapchainCreateInfoKHR swapchain_info = {
+        .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+        .surface = surface,
+        .minImageCount = image_count,
+        .imageFormat = VK_FORMAT_R8G8B8A8_UNORM,
+        .imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
+        .imageExtent = {kWidth, kHeight},
+        .imageArrayLayers = 1,
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .preTransform = capabilities.currentTransform,
+        .compositeAlpha = VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR,
+        .presentMode = present_mode,
+        .clipped = VK_TRUE,
+    };
+    VkSwapchainKHR swapchain;
+    if (vkCreateSwapchainKHR(context.device, &swapchain_info, nullptr,
+                             &swapchain) != VK_SUCCESS) {
+        state.SkipWithError("vkCreateSwapchainKHR failed");
+        vkDestroySurfaceKHR(context.instance, surface, nullptr);
+        return;
+    }
+    const VkSemaphoreCreateInfo semaphore_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    };
+    VkSemaphore semaphore;
+    vkCreateSemaphore(context.device, &semaphore_info, nullptr, &semaphore);
+
+    std::vector<VkPastPresentationTimingGOOGLE> timings;
+    uint32_t present_id = 0;
+    int64_t acquire_ns = 0;
+    int64_t present_ns = 0;
+    for (auto _ : state) {
+        const Clock::time_point start = Clock::now();
+        uint32_t index;
+        VkResult result =
+            vkAcquireNextImageKHR(context.device, swapchain, UINT64_MAX,
+                                  semaphore, VK_NULL_HANDLE, &index);
+        const Clock::time_point acquired = Clock::now();
+        if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            state.SkipWithError("vkAcquireNextImageKHR failed");
+            break;
+        }
+
+        const VkPresentTimeGOOGLE present_time = {
+            .presentID = ++present_id,
+            .desiredPresentTime = 0,
+        };
+        const VkPresentTimesInfoGOOGLE present_times = {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE,
+            .swapchainCount = 1,
+            .pTimes = &present_time,
+        };
+        const VkPresentInfoKHR present_info = {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .pNext = display_timing ? &present_times : nullptr,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &semaphore,
+            .swapchainCount = 1,
+            .pSwapchains = &swapchain,
+            .pImageIndices = &index,
+        };
+        result = vkQueuePresentKHR(context.queue, &present_info);
+        if (display_timing) {
+            uint32_t count = 0;
+            context.get_past_presentation_timing(context.device, swapchain,
+                                                 &count, nullptr);
+            timings.resize(count);
+            if (count) {
+                context.get_past_presentation_timing(
+                    context.device, swapchain, &count, timings.data());
+            }
+        }
+        const Clock::time_point presented = Clock::now();
+        if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            state.SkipWithError("vkQueuePresentKHR failed");
+            break;
+        }
+
+        acquire_ns += ElapsedNs(start, acquired);
+        present_ns += ElapsedNs(acquired, presented);
+    }
+    state.counters["acquireNs"] = benchmark::Counter(
+        static_cast<double>(acquire_ns), benchmark::Counter::kAvgIterations);
+    state.counters["presentNs"] = benchmark::Counter(
+        static_cast<double>(present_ns), benchmark::Counter::kAvgIterations);
+
+    vkDestroySemaphore(context.device, semaphore, nullptr);
+    vkDestroySwapchainKHR(context.device, swapchain, nullptr);
+    vkDestroySurfaceKHR(context.instance, surface, nullptr);
+}
+BENCHMARK(BM_AcquirePresent)
+    ->ArgsProduct({{2, 3, 4},
+                   {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR},
+                   {0, 1}})
+    ->ArgNames({"images", "mode", "timing"});
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    android::base::SetProperty(kDriverProperty, kNullDriver);
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    android::base::SetProperty(kDriverProperty, "");
+    return 0;
+}
@@ -499,6 +499,10 @@ class LayerChain {
     const driver::DebugReportLogger& logger_;
     const VkAllocationCallbacks& allocator_;
 
+    // debug.vulkan.lazy_dispatch resolves the optional entries of the
+    // dispatch tables on their first call
+    const bool lazy_dispatch_;
+
     OverrideLayerNames override_layers_;
     OverrideExtensionNames override_extensions_;
 
@@ -524,6 +528,7 @@ LayerChain::LayerChain(bool is_instance,
     : is_instance_(is_instance),
       logger_(logger),
       allocator_(allocator),
+      lazy_dispatch_(property_get_bool("debug.vulkan.lazy_dispatch", false)),
       override_layers_(is_instance, allocator),
       override_extensions_(is_instance, allocator),
       layers_(nullptr),
@@ -832,7 +837,7 @@ VkResult LayerChain::Create(const VkInstanceCreateInfo* create_info,
     InstanceData& data = GetData(instance);
 
     if (!InitDispatchTable(instance, get_instance_proc_addr_,
-                           enabled_extensions_)) {
+                           enabled_extensions_, lazy_dispatch_)) {
         if (data.dispatch.DestroyInstance)
             data.dispatch.DestroyInstance(instance, allocator);
 
@@ -904,7 +909,8 @@ VkResult LayerChain::Create(VkPhysicalDevice physical_dev,
     // initialize DeviceData
     DeviceData& data = GetData(dev);
 
-    if (!InitDispatchTable(dev, get_device_proc_addr_, enabled_extensions_)) {
+    if (!InitDispatchTable(dev, get_device_proc_addr_, enabled_extensions_,
+                           lazy_dispatch_)) {
         if (data.dispatch.DestroyDevice)
             data.dispatch.DestroyDevice(dev, allocator);
 
@@ -53,6 +53,16 @@ namespace api {
             data.dispatch.proc = disabled##proc; \
     } while (0)
 
+// Entries that are optional may be left to stubs that resolve them on their
+// first call, so that the apps that never use them do not pay for them.
+#define INIT_PROC_LAZY(obj, proc)            \
+    do {                                     \
+        if (lazy)                            \
+            data.dispatch.proc = lazy##proc; \
+        else                                 \
+            INIT_PROC(false, obj, proc);     \
+    } while (0)
+
 namespace {
 
 // clang-format off
@@ -140,6 +150,557 @@ VKAPI_ATTR VkResult disabledGetMemoryAndroidHardwareBufferANDROID(VkDevice devic
     return VK_SUCCESS;
 }
 
+PFN_vkVoidFunction ResolveLazyProc(InstanceData& data, const char* name) {
+    PFN_vkVoidFunction proc = data.get_instance_proc_addr(data.instance, name);
+    LOG_ALWAYS_FATAL_IF(!proc, "missing instance proc: %s", name);
+    return proc;
+}
+
+PFN_vkVoidFunction ResolveLazyProc(DeviceData& data, const char* name) {
+    PFN_vkVoidFunction proc = data.get_device_proc_addr(data.device, name);
+    LOG_ALWAYS_FATAL_IF(!proc, "missing device proc: %s", name);
+    return proc;
+}
+
+VKAPI_ATTR void lazyResetQueryPool(VkDevice device, VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkResetQueryPool>(ResolveLazyProc(data, "vkResetQueryPool"));
+    __atomic_store_n(&data.dispatch.ResetQueryPool, proc, __ATOMIC_RELAXED);
+    proc(device, queryPool, firstQuery, queryCount);
+}
+
+VKAPI_ATTR void lazyGetPhysicalDeviceFeatures2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures2* pFeatures) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(ResolveLazyProc(data, "vkGetPhysicalDeviceFeatures2"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceFeatures2, proc, __ATOMIC_RELAXED);
+    proc(physicalDevice, pFeatures);
+}
+
+VKAPI_ATTR void lazyGetPhysicalDeviceProperties2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties2* pProperties) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(ResolveLazyProc(data, "vkGetPhysicalDeviceProperties2"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceProperties2, proc, __ATOMIC_RELAXED);
+    proc(physicalDevice, pProperties);
+}
+
+VKAPI_ATTR void lazyGetPhysicalDeviceFormatProperties2(VkPhysicalDevice physicalDevice, VkFormat format, VkFormatProperties2* pFormatProperties) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceFormatProperties2>(ResolveLazyProc(data, "vkGetPhysicalDeviceFormatProperties2"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceFormatProperties2, proc, __ATOMIC_RELAXED);
+    proc(physicalDevice, format, pFormatProperties);
+}
+
+VKAPI_ATTR VkResult lazyGetPhysicalDeviceImageFormatProperties2(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceImageFormatInfo2* pImageFormatInfo, VkImageFormatProperties2* pImageFormatProperties) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceImageFormatProperties2>(ResolveLazyProc(data, "vkGetPhysicalDeviceImageFormatProperties2"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceImageFormatProperties2, proc, __ATOMIC_RELAXED);
+    return proc(physicalDevice, pImageFormatInfo, pImageFormatProperties);
+}
+
+VKAPI_ATTR void lazyGetPhysicalDeviceQueueFamilyProperties2(VkPhysicalDevice physicalDevice, uint32_t* pQueueFamilyPropertyCount, VkQueueFamilyProperties2* pQueueFamilyProperties) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceQueueFamilyProperties2>(ResolveLazyProc(data, "vkGetPhysicalDeviceQueueFamilyProperties2"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceQueueFamilyProperties2, proc, __ATOMIC_RELAXED);
+    proc(physicalDevice, pQueueFamilyPropertyCount, pQueueFamilyProperties);
+}
+
+VKAPI_ATTR void lazyGetPhysicalDeviceMemoryProperties2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceMemoryProperties2* pMemoryProperties) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2>(ResolveLazyProc(data, "vkGetPhysicalDeviceMemoryProperties2"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceMemoryProperties2, proc, __ATOMIC_RELAXED);
+    proc(physicalDevice, pMemoryProperties);
+}
+
+VKAPI_ATTR void lazyGetPhysicalDeviceSparseImageFormatProperties2(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceSparseImageFormatInfo2* pFormatInfo, uint32_t* pPropertyCount, VkSparseImageFormatProperties2* pProperties) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceSparseImageFormatProperties2>(ResolveLazyProc(data, "vkGetPhysicalDeviceSparseImageFormatProperties2"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceSparseImageFormatProperties2, proc, __ATOMIC_RELAXED);
+    proc(physicalDevice, pFormatInfo, pPropertyCount, pProperties);
+}
+
+VKAPI_ATTR void lazyTrimCommandPool(VkDevice device, VkCommandPool commandPool, VkCommandPoolTrimFlags flags) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkTrimCommandPool>(ResolveLazyProc(data, "vkTrimCommandPool"));
+    __atomic_store_n(&data.dispatch.TrimCommandPool, proc, __ATOMIC_RELAXED);
+    proc(device, commandPool, flags);
+}
+
+VKAPI_ATTR void lazyGetPhysicalDeviceExternalBufferProperties(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceExternalBufferInfo* pExternalBufferInfo, VkExternalBufferProperties* pExternalBufferProperties) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceExternalBufferProperties>(ResolveLazyProc(data, "vkGetPhysicalDeviceExternalBufferProperties"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceExternalBufferProperties, proc, __ATOMIC_RELAXED);
+    proc(physicalDevice, pExternalBufferInfo, pExternalBufferProperties);
+}
+
+VKAPI_ATTR void lazyGetPhysicalDeviceExternalSemaphoreProperties(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceExternalSemaphoreInfo* pExternalSemaphoreInfo, VkExternalSemaphoreProperties* pExternalSemaphoreProperties) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceExternalSemaphoreProperties>(ResolveLazyProc(data, "vkGetPhysicalDeviceExternalSemaphoreProperties"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceExternalSemaphoreProperties, proc, __ATOMIC_RELAXED);
+    proc(physicalDevice, pExternalSemaphoreInfo, pExternalSemaphoreProperties);
+}
+
+VKAPI_ATTR void lazyGetPhysicalDeviceExternalFenceProperties(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceExternalFenceInfo* pExternalFenceInfo, VkExternalFenceProperties* pExternalFenceProperties) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceExternalFenceProperties>(ResolveLazyProc(data, "vkGetPhysicalDeviceExternalFenceProperties"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceExternalFenceProperties, proc, __ATOMIC_RELAXED);
+    proc(physicalDevice, pExternalFenceInfo, pExternalFenceProperties);
+}
+
+VKAPI_ATTR VkResult lazyEnumeratePhysicalDeviceGroups(VkInstance instance, uint32_t* pPhysicalDeviceGroupCount, VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    auto& data = GetData(instance);
+    auto proc = reinterpret_cast<PFN_vkEnumeratePhysicalDeviceGroups>(ResolveLazyProc(data, "vkEnumeratePhysicalDeviceGroups"));
+    __atomic_store_n(&data.dispatch.EnumeratePhysicalDeviceGroups, proc, __ATOMIC_RELAXED);
+    return proc(instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+}
+
+VKAPI_ATTR void lazyGetDeviceGroupPeerMemoryFeatures(VkDevice device, uint32_t heapIndex, uint32_t localDeviceIndex, uint32_t remoteDeviceIndex, VkPeerMemoryFeatureFlags* pPeerMemoryFeatures) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetDeviceGroupPeerMemoryFeatures>(ResolveLazyProc(data, "vkGetDeviceGroupPeerMemoryFeatures"));
+    __atomic_store_n(&data.dispatch.GetDeviceGroupPeerMemoryFeatures, proc, __ATOMIC_RELAXED);
+    proc(device, heapIndex, localDeviceIndex, remoteDeviceIndex, pPeerMemoryFeatures);
+}
+
+VKAPI_ATTR VkResult lazyBindBufferMemory2(VkDevice device, uint32_t bindInfoCount, const VkBindBufferMemoryInfo* pBindInfos) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkBindBufferMemory2>(ResolveLazyProc(data, "vkBindBufferMemory2"));
+    __atomic_store_n(&data.dispatch.BindBufferMemory2, proc, __ATOMIC_RELAXED);
+    return proc(device, bindInfoCount, pBindInfos);
+}
+
+VKAPI_ATTR VkResult lazyBindImageMemory2(VkDevice device, uint32_t bindInfoCount, const VkBindImageMemoryInfo* pBindInfos) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkBindImageMemory2>(ResolveLazyProc(data, "vkBindImageMemory2"));
+    __atomic_store_n(&data.dispatch.BindImageMemory2, proc, __ATOMIC_RELAXED);
+    return proc(device, bindInfoCount, pBindInfos);
+}
+
+VKAPI_ATTR void lazyCmdSetDeviceMask(VkCommandBuffer commandBuffer, uint32_t deviceMask) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetDeviceMask>(ResolveLazyProc(data, "vkCmdSetDeviceMask"));
+    __atomic_store_n(&data.dispatch.CmdSetDeviceMask, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, deviceMask);
+}
+
+VKAPI_ATTR void lazyCmdDispatchBase(VkCommandBuffer commandBuffer, uint32_t baseGroupX, uint32_t baseGroupY, uint32_t baseGroupZ, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdDispatchBase>(ResolveLazyProc(data, "vkCmdDispatchBase"));
+    __atomic_store_n(&data.dispatch.CmdDispatchBase, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, baseGroupX, baseGroupY, baseGroupZ, groupCountX, groupCountY, groupCountZ);
+}
+
+VKAPI_ATTR VkResult lazyCreateDescriptorUpdateTemplate(VkDevice device, const VkDescriptorUpdateTemplateCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDescriptorUpdateTemplate* pDescriptorUpdateTemplate) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkCreateDescriptorUpdateTemplate>(ResolveLazyProc(data, "vkCreateDescriptorUpdateTemplate"));
+    __atomic_store_n(&data.dispatch.CreateDescriptorUpdateTemplate, proc, __ATOMIC_RELAXED);
+    return proc(device, pCreateInfo, pAllocator, pDescriptorUpdateTemplate);
+}
+
+VKAPI_ATTR void lazyDestroyDescriptorUpdateTemplate(VkDevice device, VkDescriptorUpdateTemplate descriptorUpdateTemplate, const VkAllocationCallbacks* pAllocator) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkDestroyDescriptorUpdateTemplate>(ResolveLazyProc(data, "vkDestroyDescriptorUpdateTemplate"));
+    __atomic_store_n(&data.dispatch.DestroyDescriptorUpdateTemplate, proc, __ATOMIC_RELAXED);
+    proc(device, descriptorUpdateTemplate, pAllocator);
+}
+
+VKAPI_ATTR void lazyUpdateDescriptorSetWithTemplate(VkDevice device, VkDescriptorSet descriptorSet, VkDescriptorUpdateTemplate descriptorUpdateTemplate, const void* pData) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkUpdateDescriptorSetWithTemplate>(ResolveLazyProc(data, "vkUpdateDescriptorSetWithTemplate"));
+    __atomic_store_n(&data.dispatch.UpdateDescriptorSetWithTemplate, proc, __ATOMIC_RELAXED);
+    proc(device, descriptorSet, descriptorUpdateTemplate, pData);
+}
+
+VKAPI_ATTR void lazyGetBufferMemoryRequirements2(VkDevice device, const VkBufferMemoryRequirementsInfo2* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetBufferMemoryRequirements2>(ResolveLazyProc(data, "vkGetBufferMemoryRequirements2"));
+    __atomic_store_n(&data.dispatch.GetBufferMemoryRequirements2, proc, __ATOMIC_RELAXED);
+    proc(device, pInfo, pMemoryRequirements);
+}
+
+VKAPI_ATTR void lazyGetImageMemoryRequirements2(VkDevice device, const VkImageMemoryRequirementsInfo2* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetImageMemoryRequirements2>(ResolveLazyProc(data, "vkGetImageMemoryRequirements2"));
+    __atomic_store_n(&data.dispatch.GetImageMemoryRequirements2, proc, __ATOMIC_RELAXED);
+    proc(device, pInfo, pMemoryRequirements);
+}
+
+VKAPI_ATTR void lazyGetImageSparseMemoryRequirements2(VkDevice device, const VkImageSparseMemoryRequirementsInfo2* pInfo, uint32_t* pSparseMemoryRequirementCount, VkSparseImageMemoryRequirements2* pSparseMemoryRequirements) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetImageSparseMemoryRequirements2>(ResolveLazyProc(data, "vkGetImageSparseMemoryRequirements2"));
+    __atomic_store_n(&data.dispatch.GetImageSparseMemoryRequirements2, proc, __ATOMIC_RELAXED);
+    proc(device, pInfo, pSparseMemoryRequirementCount, pSparseMemoryRequirements);
+}
+
+VKAPI_ATTR void lazyGetDeviceBufferMemoryRequirements(VkDevice device, const VkDeviceBufferMemoryRequirements* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetDeviceBufferMemoryRequirements>(ResolveLazyProc(data, "vkGetDeviceBufferMemoryRequirements"));
+    __atomic_store_n(&data.dispatch.GetDeviceBufferMemoryRequirements, proc, __ATOMIC_RELAXED);
+    proc(device, pInfo, pMemoryRequirements);
+}
+
+VKAPI_ATTR void lazyGetDeviceImageMemoryRequirements(VkDevice device, const VkDeviceImageMemoryRequirements* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetDeviceImageMemoryRequirements>(ResolveLazyProc(data, "vkGetDeviceImageMemoryRequirements"));
+    __atomic_store_n(&data.dispatch.GetDeviceImageMemoryRequirements, proc, __ATOMIC_RELAXED);
+    proc(device, pInfo, pMemoryRequirements);
+}
+
+VKAPI_ATTR void lazyGetDeviceImageSparseMemoryRequirements(VkDevice device, const VkDeviceImageMemoryRequirements* pInfo, uint32_t* pSparseMemoryRequirementCount, VkSparseImageMemoryRequirements2* pSparseMemoryRequirements) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetDeviceImageSparseMemoryRequirements>(ResolveLazyProc(data, "vkGetDeviceImageSparseMemoryRequirements"));
+    __atomic_store_n(&data.dispatch.GetDeviceImageSparseMemoryRequirements, proc, __ATOMIC_RELAXED);
+    proc(device, pInfo, pSparseMemoryRequirementCount, pSparseMemoryRequirements);
+}
+
+VKAPI_ATTR VkResult lazyCreateSamplerYcbcrConversion(VkDevice device, const VkSamplerYcbcrConversionCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkSamplerYcbcrConversion* pYcbcrConversion) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkCreateSamplerYcbcrConversion>(ResolveLazyProc(data, "vkCreateSamplerYcbcrConversion"));
+    __atomic_store_n(&data.dispatch.CreateSamplerYcbcrConversion, proc, __ATOMIC_RELAXED);
+    return proc(device, pCreateInfo, pAllocator, pYcbcrConversion);
+}
+
+VKAPI_ATTR void lazyDestroySamplerYcbcrConversion(VkDevice device, VkSamplerYcbcrConversion ycbcrConversion, const VkAllocationCallbacks* pAllocator) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkDestroySamplerYcbcrConversion>(ResolveLazyProc(data, "vkDestroySamplerYcbcrConversion"));
+    __atomic_store_n(&data.dispatch.DestroySamplerYcbcrConversion, proc, __ATOMIC_RELAXED);
+    proc(device, ycbcrConversion, pAllocator);
+}
+
+VKAPI_ATTR void lazyGetDeviceQueue2(VkDevice device, const VkDeviceQueueInfo2* pQueueInfo, VkQueue* pQueue) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetDeviceQueue2>(ResolveLazyProc(data, "vkGetDeviceQueue2"));
+    __atomic_store_n(&data.dispatch.GetDeviceQueue2, proc, __ATOMIC_RELAXED);
+    proc(device, pQueueInfo, pQueue);
+}
+
+VKAPI_ATTR void lazyGetDescriptorSetLayoutSupport(VkDevice device, const VkDescriptorSetLayoutCreateInfo* pCreateInfo, VkDescriptorSetLayoutSupport* pSupport) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetDescriptorSetLayoutSupport>(ResolveLazyProc(data, "vkGetDescriptorSetLayoutSupport"));
+    __atomic_store_n(&data.dispatch.GetDescriptorSetLayoutSupport, proc, __ATOMIC_RELAXED);
+    proc(device, pCreateInfo, pSupport);
+}
+
+VKAPI_ATTR VkResult lazyCreateRenderPass2(VkDevice device, const VkRenderPassCreateInfo2* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkRenderPass* pRenderPass) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkCreateRenderPass2>(ResolveLazyProc(data, "vkCreateRenderPass2"));
+    __atomic_store_n(&data.dispatch.CreateRenderPass2, proc, __ATOMIC_RELAXED);
+    return proc(device, pCreateInfo, pAllocator, pRenderPass);
+}
+
+VKAPI_ATTR void lazyCmdBeginRenderPass2(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo* pRenderPassBegin, const VkSubpassBeginInfo* pSubpassBeginInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdBeginRenderPass2>(ResolveLazyProc(data, "vkCmdBeginRenderPass2"));
+    __atomic_store_n(&data.dispatch.CmdBeginRenderPass2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pRenderPassBegin, pSubpassBeginInfo);
+}
+
+VKAPI_ATTR void lazyCmdNextSubpass2(VkCommandBuffer commandBuffer, const VkSubpassBeginInfo* pSubpassBeginInfo, const VkSubpassEndInfo* pSubpassEndInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdNextSubpass2>(ResolveLazyProc(data, "vkCmdNextSubpass2"));
+    __atomic_store_n(&data.dispatch.CmdNextSubpass2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pSubpassBeginInfo, pSubpassEndInfo);
+}
+
+VKAPI_ATTR void lazyCmdEndRenderPass2(VkCommandBuffer commandBuffer, const VkSubpassEndInfo* pSubpassEndInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdEndRenderPass2>(ResolveLazyProc(data, "vkCmdEndRenderPass2"));
+    __atomic_store_n(&data.dispatch.CmdEndRenderPass2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pSubpassEndInfo);
+}
+
+VKAPI_ATTR VkResult lazyGetSemaphoreCounterValue(VkDevice device, VkSemaphore semaphore, uint64_t* pValue) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetSemaphoreCounterValue>(ResolveLazyProc(data, "vkGetSemaphoreCounterValue"));
+    __atomic_store_n(&data.dispatch.GetSemaphoreCounterValue, proc, __ATOMIC_RELAXED);
+    return proc(device, semaphore, pValue);
+}
+
+VKAPI_ATTR VkResult lazyWaitSemaphores(VkDevice device, const VkSemaphoreWaitInfo* pWaitInfo, uint64_t timeout) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkWaitSemaphores>(ResolveLazyProc(data, "vkWaitSemaphores"));
+    __atomic_store_n(&data.dispatch.WaitSemaphores, proc, __ATOMIC_RELAXED);
+    return proc(device, pWaitInfo, timeout);
+}
+
+VKAPI_ATTR VkResult lazySignalSemaphore(VkDevice device, const VkSemaphoreSignalInfo* pSignalInfo) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkSignalSemaphore>(ResolveLazyProc(data, "vkSignalSemaphore"));
+    __atomic_store_n(&data.dispatch.SignalSemaphore, proc, __ATOMIC_RELAXED);
+    return proc(device, pSignalInfo);
+}
+
+VKAPI_ATTR void lazyCmdDrawIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdDrawIndirectCount>(ResolveLazyProc(data, "vkCmdDrawIndirectCount"));
+    __atomic_store_n(&data.dispatch.CmdDrawIndirectCount, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+}
+
+VKAPI_ATTR void lazyCmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(ResolveLazyProc(data, "vkCmdDrawIndexedIndirectCount"));
+    __atomic_store_n(&data.dispatch.CmdDrawIndexedIndirectCount, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+}
+
+VKAPI_ATTR uint64_t lazyGetBufferOpaqueCaptureAddress(VkDevice device, const VkBufferDeviceAddressInfo* pInfo) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetBufferOpaqueCaptureAddress>(ResolveLazyProc(data, "vkGetBufferOpaqueCaptureAddress"));
+    __atomic_store_n(&data.dispatch.GetBufferOpaqueCaptureAddress, proc, __ATOMIC_RELAXED);
+    return proc(device, pInfo);
+}
+
+VKAPI_ATTR VkDeviceAddress lazyGetBufferDeviceAddress(VkDevice device, const VkBufferDeviceAddressInfo* pInfo) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetBufferDeviceAddress>(ResolveLazyProc(data, "vkGetBufferDeviceAddress"));
+    __atomic_store_n(&data.dispatch.GetBufferDeviceAddress, proc, __ATOMIC_RELAXED);
+    return proc(device, pInfo);
+}
+
+VKAPI_ATTR uint64_t lazyGetDeviceMemoryOpaqueCaptureAddress(VkDevice device, const VkDeviceMemoryOpaqueCaptureAddressInfo* pInfo) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetDeviceMemoryOpaqueCaptureAddress>(ResolveLazyProc(data, "vkGetDeviceMemoryOpaqueCaptureAddress"));
+    __atomic_store_n(&data.dispatch.GetDeviceMemoryOpaqueCaptureAddress, proc, __ATOMIC_RELAXED);
+    return proc(device, pInfo);
+}
+
+VKAPI_ATTR VkResult lazyGetPhysicalDeviceToolProperties(VkPhysicalDevice physicalDevice, uint32_t* pToolCount, VkPhysicalDeviceToolProperties* pToolProperties) {
+    auto& data = GetData(physicalDevice);
+    auto proc = reinterpret_cast<PFN_vkGetPhysicalDeviceToolProperties>(ResolveLazyProc(data, "vkGetPhysicalDeviceToolProperties"));
+    __atomic_store_n(&data.dispatch.GetPhysicalDeviceToolProperties, proc, __ATOMIC_RELAXED);
+    return proc(physicalDevice, pToolCount, pToolProperties);
+}
+
+VKAPI_ATTR void lazyCmdSetCullMode(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetCullMode>(ResolveLazyProc(data, "vkCmdSetCullMode"));
+    __atomic_store_n(&data.dispatch.CmdSetCullMode, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, cullMode);
+}
+
+VKAPI_ATTR void lazyCmdSetFrontFace(VkCommandBuffer commandBuffer, VkFrontFace frontFace) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetFrontFace>(ResolveLazyProc(data, "vkCmdSetFrontFace"));
+    __atomic_store_n(&data.dispatch.CmdSetFrontFace, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, frontFace);
+}
+
+VKAPI_ATTR void lazyCmdSetPrimitiveTopology(VkCommandBuffer commandBuffer, VkPrimitiveTopology primitiveTopology) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetPrimitiveTopology>(ResolveLazyProc(data, "vkCmdSetPrimitiveTopology"));
+    __atomic_store_n(&data.dispatch.CmdSetPrimitiveTopology, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, primitiveTopology);
+}
+
+VKAPI_ATTR void lazyCmdSetViewportWithCount(VkCommandBuffer commandBuffer, uint32_t viewportCount, const VkViewport* pViewports) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetViewportWithCount>(ResolveLazyProc(data, "vkCmdSetViewportWithCount"));
+    __atomic_store_n(&data.dispatch.CmdSetViewportWithCount, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, viewportCount, pViewports);
+}
+
+VKAPI_ATTR void lazyCmdSetScissorWithCount(VkCommandBuffer commandBuffer, uint32_t scissorCount, const VkRect2D* pScissors) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetScissorWithCount>(ResolveLazyProc(data, "vkCmdSetScissorWithCount"));
+    __atomic_store_n(&data.dispatch.CmdSetScissorWithCount, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, scissorCount, pScissors);
+}
+
+VKAPI_ATTR void lazyCmdBindVertexBuffers2(VkCommandBuffer commandBuffer, uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets, const VkDeviceSize* pSizes, const VkDeviceSize* pStrides) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdBindVertexBuffers2>(ResolveLazyProc(data, "vkCmdBindVertexBuffers2"));
+    __atomic_store_n(&data.dispatch.CmdBindVertexBuffers2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, firstBinding, bindingCount, pBuffers, pOffsets, pSizes, pStrides);
+}
+
+VKAPI_ATTR void lazyCmdSetDepthTestEnable(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetDepthTestEnable>(ResolveLazyProc(data, "vkCmdSetDepthTestEnable"));
+    __atomic_store_n(&data.dispatch.CmdSetDepthTestEnable, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, depthTestEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetDepthWriteEnable(VkCommandBuffer commandBuffer, VkBool32 depthWriteEnable) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetDepthWriteEnable>(ResolveLazyProc(data, "vkCmdSetDepthWriteEnable"));
+    __atomic_store_n(&data.dispatch.CmdSetDepthWriteEnable, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, depthWriteEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetDepthCompareOp(VkCommandBuffer commandBuffer, VkCompareOp depthCompareOp) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetDepthCompareOp>(ResolveLazyProc(data, "vkCmdSetDepthCompareOp"));
+    __atomic_store_n(&data.dispatch.CmdSetDepthCompareOp, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, depthCompareOp);
+}
+
+VKAPI_ATTR void lazyCmdSetDepthBoundsTestEnable(VkCommandBuffer commandBuffer, VkBool32 depthBoundsTestEnable) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetDepthBoundsTestEnable>(ResolveLazyProc(data, "vkCmdSetDepthBoundsTestEnable"));
+    __atomic_store_n(&data.dispatch.CmdSetDepthBoundsTestEnable, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, depthBoundsTestEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetStencilTestEnable(VkCommandBuffer commandBuffer, VkBool32 stencilTestEnable) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetStencilTestEnable>(ResolveLazyProc(data, "vkCmdSetStencilTestEnable"));
+    __atomic_store_n(&data.dispatch.CmdSetStencilTestEnable, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, stencilTestEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetStencilOp(VkCommandBuffer commandBuffer, VkStencilFaceFlags faceMask, VkStencilOp failOp, VkStencilOp passOp, VkStencilOp depthFailOp, VkCompareOp compareOp) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetStencilOp>(ResolveLazyProc(data, "vkCmdSetStencilOp"));
+    __atomic_store_n(&data.dispatch.CmdSetStencilOp, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, faceMask, failOp, passOp, depthFailOp, compareOp);
+}
+
+VKAPI_ATTR void lazyCmdSetRasterizerDiscardEnable(VkCommandBuffer commandBuffer, VkBool32 rasterizerDiscardEnable) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetRasterizerDiscardEnable>(ResolveLazyProc(data, "vkCmdSetRasterizerDiscardEnable"));
+    __atomic_store_n(&data.dispatch.CmdSetRasterizerDiscardEnable, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, rasterizerDiscardEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetDepthBiasEnable(VkCommandBuffer commandBuffer, VkBool32 depthBiasEnable) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetDepthBiasEnable>(ResolveLazyProc(data, "vkCmdSetDepthBiasEnable"));
+    __atomic_store_n(&data.dispatch.CmdSetDepthBiasEnable, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, depthBiasEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetPrimitiveRestartEnable(VkCommandBuffer commandBuffer, VkBool32 primitiveRestartEnable) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetPrimitiveRestartEnable>(ResolveLazyProc(data, "vkCmdSetPrimitiveRestartEnable"));
+    __atomic_store_n(&data.dispatch.CmdSetPrimitiveRestartEnable, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, primitiveRestartEnable);
+}
+
+VKAPI_ATTR VkResult lazyCreatePrivateDataSlot(VkDevice device, const VkPrivateDataSlotCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkPrivateDataSlot* pPrivateDataSlot) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkCreatePrivateDataSlot>(ResolveLazyProc(data, "vkCreatePrivateDataSlot"));
+    __atomic_store_n(&data.dispatch.CreatePrivateDataSlot, proc, __ATOMIC_RELAXED);
+    return proc(device, pCreateInfo, pAllocator, pPrivateDataSlot);
+}
+
+VKAPI_ATTR void lazyDestroyPrivateDataSlot(VkDevice device, VkPrivateDataSlot privateDataSlot, const VkAllocationCallbacks* pAllocator) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkDestroyPrivateDataSlot>(ResolveLazyProc(data, "vkDestroyPrivateDataSlot"));
+    __atomic_store_n(&data.dispatch.DestroyPrivateDataSlot, proc, __ATOMIC_RELAXED);
+    proc(device, privateDataSlot, pAllocator);
+}
+
+VKAPI_ATTR VkResult lazySetPrivateData(VkDevice device, VkObjectType objectType, uint64_t objectHandle, VkPrivateDataSlot privateDataSlot, uint64_t data) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkSetPrivateData>(ResolveLazyProc(data, "vkSetPrivateData"));
+    __atomic_store_n(&data.dispatch.SetPrivateData, proc, __ATOMIC_RELAXED);
+    return proc(device, objectType, objectHandle, privateDataSlot, data);
+}
+
+VKAPI_ATTR void lazyGetPrivateData(VkDevice device, VkObjectType objectType, uint64_t objectHandle, VkPrivateDataSlot privateDataSlot, uint64_t* pData) {
+    auto& data = GetData(device);
+    auto proc = reinterpret_cast<PFN_vkGetPrivateData>(ResolveLazyProc(data, "vkGetPrivateData"));
+    __atomic_store_n(&data.dispatch.GetPrivateData, proc, __ATOMIC_RELAXED);
+    proc(device, objectType, objectHandle, privateDataSlot, pData);
+}
+
+VKAPI_ATTR void lazyCmdCopyBuffer2(VkCommandBuffer commandBuffer, const VkCopyBufferInfo2* pCopyBufferInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdCopyBuffer2>(ResolveLazyProc(data, "vkCmdCopyBuffer2"));
+    __atomic_store_n(&data.dispatch.CmdCopyBuffer2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pCopyBufferInfo);
+}
+
+VKAPI_ATTR void lazyCmdCopyImage2(VkCommandBuffer commandBuffer, const VkCopyImageInfo2* pCopyImageInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdCopyImage2>(ResolveLazyProc(data, "vkCmdCopyImage2"));
+    __atomic_store_n(&data.dispatch.CmdCopyImage2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pCopyImageInfo);
+}
+
+VKAPI_ATTR void lazyCmdBlitImage2(VkCommandBuffer commandBuffer, const VkBlitImageInfo2* pBlitImageInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdBlitImage2>(ResolveLazyProc(data, "vkCmdBlitImage2"));
+    __atomic_store_n(&data.dispatch.CmdBlitImage2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pBlitImageInfo);
+}
+
+VKAPI_ATTR void lazyCmdCopyBufferToImage2(VkCommandBuffer commandBuffer, const VkCopyBufferToImageInfo2* pCopyBufferToImageInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdCopyBufferToImage2>(ResolveLazyProc(data, "vkCmdCopyBufferToImage2"));
+    __atomic_store_n(&data.dispatch.CmdCopyBufferToImage2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pCopyBufferToImageInfo);
+}
+
+VKAPI_ATTR void lazyCmdCopyImageToBuffer2(VkCommandBuffer commandBuffer, const VkCopyImageToBufferInfo2* pCopyImageToBufferInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdCopyImageToBuffer2>(ResolveLazyProc(data, "vkCmdCopyImageToBuffer2"));
+    __atomic_store_n(&data.dispatch.CmdCopyImageToBuffer2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pCopyImageToBufferInfo);
+}
+
+VKAPI_ATTR void lazyCmdResolveImage2(VkCommandBuffer commandBuffer, const VkResolveImageInfo2* pResolveImageInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdResolveImage2>(ResolveLazyProc(data, "vkCmdResolveImage2"));
+    __atomic_store_n(&data.dispatch.CmdResolveImage2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pResolveImageInfo);
+}
+
+VKAPI_ATTR void lazyCmdSetEvent2(VkCommandBuffer commandBuffer, VkEvent event, const VkDependencyInfo* pDependencyInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdSetEvent2>(ResolveLazyProc(data, "vkCmdSetEvent2"));
+    __atomic_store_n(&data.dispatch.CmdSetEvent2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, event, pDependencyInfo);
+}
+
+VKAPI_ATTR void lazyCmdResetEvent2(VkCommandBuffer commandBuffer, VkEvent event, VkPipelineStageFlags2 stageMask) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdResetEvent2>(ResolveLazyProc(data, "vkCmdResetEvent2"));
+    __atomic_store_n(&data.dispatch.CmdResetEvent2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, event, stageMask);
+}
+
+VKAPI_ATTR void lazyCmdWaitEvents2(VkCommandBuffer commandBuffer, uint32_t eventCount, const VkEvent* pEvents, const VkDependencyInfo* pDependencyInfos) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdWaitEvents2>(ResolveLazyProc(data, "vkCmdWaitEvents2"));
+    __atomic_store_n(&data.dispatch.CmdWaitEvents2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, eventCount, pEvents, pDependencyInfos);
+}
+
+VKAPI_ATTR void lazyCmdPipelineBarrier2(VkCommandBuffer commandBuffer, const VkDependencyInfo* pDependencyInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdPipelineBarrier2>(ResolveLazyProc(data, "vkCmdPipelineBarrier2"));
+    __atomic_store_n(&data.dispatch.CmdPipelineBarrier2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pDependencyInfo);
+}
+
+VKAPI_ATTR VkResult lazyQueueSubmit2(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2* pSubmits, VkFence fence) {
+    auto& data = GetData(queue);
+    auto proc = reinterpret_cast<PFN_vkQueueSubmit2>(ResolveLazyProc(data, "vkQueueSubmit2"));
+    __atomic_store_n(&data.dispatch.QueueSubmit2, proc, __ATOMIC_RELAXED);
+    return proc(queue, submitCount, pSubmits, fence);
+}
+
+VKAPI_ATTR void lazyCmdWriteTimestamp2(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 stage, VkQueryPool queryPool, uint32_t query) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdWriteTimestamp2>(ResolveLazyProc(data, "vkCmdWriteTimestamp2"));
+    __atomic_store_n(&data.dispatch.CmdWriteTimestamp2, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, stage, queryPool, query);
+}
+
+VKAPI_ATTR void lazyCmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo* pRenderingInfo) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdBeginRendering>(ResolveLazyProc(data, "vkCmdBeginRendering"));
+    __atomic_store_n(&data.dispatch.CmdBeginRendering, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer, pRenderingInfo);
+}
+
+VKAPI_ATTR void lazyCmdEndRendering(VkCommandBuffer commandBuffer) {
+    auto& data = GetData(commandBuffer);
+    auto proc = reinterpret_cast<PFN_vkCmdEndRendering>(ResolveLazyProc(data, "vkCmdEndRendering"));
+    __atomic_store_n(&data.dispatch.CmdEndRendering, proc, __ATOMIC_RELAXED);
+    proc(commandBuffer);
+}
+
 // clang-format on
 
 }  // namespace
@@ -147,10 +708,14 @@ VKAPI_ATTR VkResult disabledGetMemoryAndroidHardwareBufferANDROID(VkDevice devic
 bool InitDispatchTable(
     VkInstance instance,
     PFN_vkGetInstanceProcAddr get_proc,
-    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions) {
+    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions,
+    bool lazy) {
     auto& data = GetData(instance);
     bool success = true;
 
+    data.instance = instance;
+    data.get_instance_proc_addr = get_proc;
+
     // clang-format off
     INIT_PROC(true, instance, DestroyInstance);
     INIT_PROC(true, instance, EnumeratePhysicalDevices);
@@ -170,19 +735,19 @@ bool InitDispatchTable(
     INIT_PROC_EXT(KHR_surface, true, instance, GetPhysicalDeviceSurfaceCapabilitiesKHR);
     INIT_PROC_EXT(KHR_surface, true, instance, GetPhysicalDeviceSurfaceFormatsKHR);
     INIT_PROC_EXT(KHR_surface, true, instance, GetPhysicalDeviceSurfacePresentModesKHR);
-    INIT_PROC(false, instance, GetPhysicalDeviceFeatures2);
-    INIT_PROC(false, instance, GetPhysicalDeviceProperties2);
-    INIT_PROC(false, instance, GetPhysicalDeviceFormatProperties2);
-    INIT_PROC(false, instance, GetPhysicalDeviceImageFormatProperties2);
-    INIT_PROC(false, instance, GetPhysicalDeviceQueueFamilyProperties2);
-    INIT_PROC(false, instance, GetPhysicalDeviceMemoryProperties2);
-    INIT_PROC(false, instance, GetPhysicalDeviceSparseImageFormatProperties2);
-    INIT_PROC(false, instance, GetPhysicalDeviceExternalBufferProperties);
-    INIT_PROC(false, instance, GetPhysicalDeviceExternalSemaphoreProperties);
-    INIT_PROC(false, instance, GetPhysicalDeviceExternalFenceProperties);
-    INIT_PROC(false, instance, EnumeratePhysicalDeviceGroups);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceFeatures2);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceProperties2);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceFormatProperties2);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceImageFormatProperties2);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceQueueFamilyProperties2);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceMemoryProperties2);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceSparseImageFormatProperties2);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceExternalBufferProperties);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceExternalSemaphoreProperties);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceExternalFenceProperties);
+    INIT_PROC_LAZY(instance, EnumeratePhysicalDeviceGroups);
     INIT_PROC_EXT(KHR_swapchain, true, instance, GetPhysicalDevicePresentRectanglesKHR);
-    INIT_PROC(false, instance, GetPhysicalDeviceToolProperties);
+    INIT_PROC_LAZY(instance, GetPhysicalDeviceToolProperties);
     // clang-format on
 
     return success;
@@ -191,10 +756,14 @@ bool InitDispatchTable(
 bool InitDispatchTable(
     VkDevice dev,
     PFN_vkGetDeviceProcAddr get_proc,
-    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions) {
+    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions,
+    bool lazy) {
     auto& data = GetData(dev);
     bool success = true;
 
+    data.device = dev;
+    data.get_device_proc_addr = get_proc;
+
     // clang-format off
     INIT_PROC(true, dev, GetDeviceProcAddr);
     INIT_PROC(true, dev, DestroyDevice);
@@ -230,7 +799,7 @@ bool InitDispatchTable(
     INIT_PROC(true, dev, CreateQueryPool);
     INIT_PROC(true, dev, DestroyQueryPool);
     INIT_PROC(true, dev, GetQueryPoolResults);
-    INIT_PROC(false, dev, ResetQueryPool);
+    INIT_PROC_LAZY(dev, ResetQueryPool);
     INIT_PROC(true, dev, CreateBuffer);
     INIT_PROC(true, dev, DestroyBuffer);
     INIT_PROC(true, dev, CreateBufferView);
@@ -323,75 +892,75 @@ bool InitDispatchTable(
     INIT_PROC_EXT(KHR_swapchain, true, dev, GetSwapchainImagesKHR);
     INIT_PROC_EXT(KHR_swapchain, true, dev, AcquireNextImageKHR);
     INIT_PROC_EXT(KHR_swapchain, true, dev, QueuePresentKHR);
-    INIT_PROC(false, dev, TrimCommandPool);
-    INIT_PROC(false, dev, GetDeviceGroupPeerMemoryFeatures);
-    INIT_PROC(false, dev, BindBufferMemory2);
-    INIT_PROC(false, dev, BindImageMemory2);
-    INIT_PROC(false, dev, CmdSetDeviceMask);
+    INIT_PROC_LAZY(dev, TrimCommandPool);
+    INIT_PROC_LAZY(dev, GetDeviceGroupPeerMemoryFeatures);
+    INIT_PROC_LAZY(dev, BindBufferMemory2);
+    INIT_PROC_LAZY(dev, BindImageMemory2);
+    INIT_PROC_LAZY(dev, CmdSetDeviceMask);
     INIT_PROC_EXT(KHR_swapchain, true, dev, GetDeviceGroupPresentCapabilitiesKHR);
     INIT_PROC_EXT(KHR_swapchain, true, dev, GetDeviceGroupSurfacePresentModesKHR);
     INIT_PROC_EXT(KHR_swapchain, true, dev, AcquireNextImage2KHR);
-    INIT_PROC(false, dev, CmdDispatchBase);
-    INIT_PROC(false, dev, CreateDescriptorUpdateTemplate);
-    INIT_PROC(false, dev, DestroyDescriptorUpdateTemplate);
-    INIT_PROC(false, dev, UpdateDescriptorSetWithTemplate);
-    INIT_PROC(false, dev, GetBufferMemoryRequirements2);
-    INIT_PROC(false, dev, GetImageMemoryRequirements2);
-    INIT_PROC(false, dev, GetImageSparseMemoryRequirements2);
-    INIT_PROC(false, dev, GetDeviceBufferMemoryRequirements);
-    INIT_PROC(false, dev, GetDeviceImageMemoryRequirements);
-    INIT_PROC(false, dev, GetDeviceImageSparseMemoryRequirements);
-    INIT_PROC(false, dev, CreateSamplerYcbcrConversion);
-    INIT_PROC(false, dev, DestroySamplerYcbcrConversion);
-    INIT_PROC(false, dev, GetDeviceQueue2);
-    INIT_PROC(false, dev, GetDescriptorSetLayoutSupport);
-    INIT_PROC(false, dev, CreateRenderPass2);
-    INIT_PROC(false, dev, CmdBeginRenderPass2);
-    INIT_PROC(false, dev, CmdNextSubpass2);
-    INIT_PROC(false, dev, CmdEndRenderPass2);
-    INIT_PROC(false, dev, GetSemaphoreCounterValue);
-    INIT_PROC(false, dev, WaitSemaphores);
-    INIT_PROC(false, dev, SignalSemaphore);
+    INIT_PROC_LAZY(dev, CmdDispatchBase);
+    INIT_PROC_LAZY(dev, CreateDescriptorUpdateTemplate);
+    INIT_PROC_LAZY(dev, DestroyDescriptorUpdateTemplate);
+    INIT_PROC_LAZY(dev, UpdateDescriptorSetWithTemplate);
+    INIT_PROC_LAZY(dev, GetBufferMemoryRequirements2);
+    INIT_PROC_LAZY(dev, GetImageMemoryRequirements2);
+    INIT_PROC_LAZY(dev, GetImageSparseMemoryRequirements2);
+    INIT_PROC_LAZY(dev, GetDeviceBufferMemoryRequirements);
+    INIT_PROC_LAZY(dev, GetDeviceImageMemoryRequirements);
+    INIT_PROC_LAZY(dev, GetDeviceImageSparseMemoryRequirements);
+    INIT_PROC_LAZY(dev, CreateSamplerYcbcrConversion);
+    INIT_PROC_LAZY(dev, DestroySamplerYcbcrConversion);
+    INIT_PROC_LAZY(dev, GetDeviceQueue2);
+    INIT_PROC_LAZY(dev, GetDescriptorSetLayoutSupport);
+    INIT_PROC_LAZY(dev, CreateRenderPass2);
+    INIT_PROC_LAZY(dev, CmdBeginRenderPass2);
+    INIT_PROC_LAZY(dev, CmdNextSubpass2);
+    INIT_PROC_LAZY(dev, CmdEndRenderPass2);
+    INIT_PROC_LAZY(dev, GetSemaphoreCounterValue);
+    INIT_PROC_LAZY(dev, WaitSemaphores);
+    INIT_PROC_LAZY(dev, SignalSemaphore);
     INIT_PROC_EXT(ANDROID_external_memory_android_hardware_buffer, true, dev, GetAndroidHardwareBufferPropertiesANDROID);
     INIT_PROC_EXT(ANDROID_external_memory_android_hardware_buffer, true, dev, GetMemoryAndroidHardwareBufferANDROID);
-    INIT_PROC(false, dev, CmdDrawIndirectCount);
-    INIT_PROC(false, dev, CmdDrawIndexedIndirectCount);
-    INIT_PROC(false, dev, GetBufferOpaqueCaptureAddress);
-    INIT_PROC(false, dev, GetBufferDeviceAddress);
-    INIT_PROC(false, dev, GetDeviceMemoryOpaqueCaptureAddress);
-    INIT_PROC(false, dev, CmdSetCullMode);
-    INIT_PROC(false, dev, CmdSetFrontFace);
-    INIT_PROC(false, dev, CmdSetPrimitiveTopology);
-    INIT_PROC(false, dev, CmdSetViewportWithCount);
-    INIT_PROC(false, dev, CmdSetScissorWithCount);
-    INIT_PROC(false, dev, CmdBindVertexBuffers2);
-    INIT_PROC(false, dev, CmdSetDepthTestEnable);
-    INIT_PROC(false, dev, CmdSetDepthWriteEnable);
-    INIT_PROC(false, dev, CmdSetDepthCompareOp);
-    INIT_PROC(false, dev, CmdSetDepthBoundsTestEnable);
-    INIT_PROC(false, dev, CmdSetStencilTestEnable);
-    INIT_PROC(false, dev, CmdSetStencilOp);
-    INIT_PROC(false, dev, CmdSetRasterizerDiscardEnable);
-    INIT_PROC(false, dev, CmdSetDepthBiasEnable);
-    INIT_PROC(false, dev, CmdSetPrimitiveRestartEnable);
-    INIT_PROC(false, dev, CreatePrivateDataSlot);
-    INIT_PROC(false, dev, DestroyPrivateDataSlot);
-    INIT_PROC(false, dev, SetPrivateData);
-    INIT_PROC(false, dev, GetPrivateData);
-    INIT_PROC(false, dev, CmdCopyBuffer2);
-    INIT_PROC(false, dev, CmdCopyImage2);
-    INIT_PROC(false, dev, CmdBlitImage2);
-    INIT_PROC(false, dev, CmdCopyBufferToImage2);
-    INIT_PROC(false, dev, CmdCopyImageToBuffer2);
-    INIT_PROC(false, dev, CmdResolveImage2);
-    INIT_PROC(false, dev, CmdSetEvent2);
-    INIT_PROC(false, dev, CmdResetEvent2);
-    INIT_PROC(false, dev, CmdWaitEvents2);
-    INIT_PROC(false, dev, CmdPipelineBarrier2);
-    INIT_PROC(false, dev, QueueSubmit2);
-    INIT_PROC(false, dev, CmdWriteTimestamp2);
-    INIT_PROC(false, dev, CmdBeginRendering);
-    INIT_PROC(false, dev, CmdEndRendering);
+    INIT_PROC_LAZY(dev, CmdDrawIndirectCount);
+    INIT_PROC_LAZY(dev, CmdDrawIndexedIndirectCount);
+    INIT_PROC_LAZY(dev, GetBufferOpaqueCaptureAddress);
+    INIT_PROC_LAZY(dev, GetBufferDeviceAddress);
+    INIT_PROC_LAZY(dev, GetDeviceMemoryOpaqueCaptureAddress);
+    INIT_PROC_LAZY(dev, CmdSetCullMode);
+    INIT_PROC_LAZY(dev, CmdSetFrontFace);
+    INIT_PROC_LAZY(dev, CmdSetPrimitiveTopology);
+    INIT_PROC_LAZY(dev, CmdSetViewportWithCount);
+    INIT_PROC_LAZY(dev, CmdSetScissorWithCount);
+    INIT_PROC_LAZY(dev, CmdBindVertexBuffers2);
+    INIT_PROC_LAZY(dev, CmdSetDepthTestEnable);
+    INIT_PROC_LAZY(dev, CmdSetDepthWriteEnable);
+    INIT_PROC_LAZY(dev, CmdSetDepthCompareOp);
+    INIT_PROC_LAZY(dev, CmdSetDepthBoundsTestEnable);
+    INIT_PROC_LAZY(dev, CmdSetStencilTestEnable);
+    INIT_PROC_LAZY(dev, CmdSetStencilOp);
+    INIT_PROC_LAZY(dev, CmdSetRasterizerDiscardEnable);
+    INIT_PROC_LAZY(dev, CmdSetDepthBiasEnable);
+    INIT_PROC_LAZY(dev, CmdSetPrimitiveRestartEnable);
+    INIT_PROC_LAZY(dev, CreatePrivateDataSlot);
+    INIT_PROC_LAZY(dev, DestroyPrivateDataSlot);
+    INIT_PROC_LAZY(dev, SetPrivateData);
+    INIT_PROC_LAZY(dev, GetPrivateData);
+    INIT_PROC_LAZY(dev, CmdCopyBuffer2);
+    INIT_PROC_LAZY(dev, CmdCopyImage2);
+    INIT_PROC_LAZY(dev, CmdBlitImage2);
+    INIT_PROC_LAZY(dev, CmdCopyBufferToImage2);
+    INIT_PROC_LAZY(dev, CmdCopyImageToBuffer2);
+    INIT_PROC_LAZY(dev, CmdResolveImage2);
+    INIT_PROC_LAZY(dev, CmdSetEvent2);
+    INIT_PROC_LAZY(dev, CmdResetEvent2);
+    INIT_PROC_LAZY(dev, CmdWaitEvents2);
+    INIT_PROC_LAZY(dev, CmdPipelineBarrier2);
+    INIT_PROC_LAZY(dev, QueueSubmit2);
+    INIT_PROC_LAZY(dev, CmdWriteTimestamp2);
+    INIT_PROC_LAZY(dev, CmdBeginRendering);
+    INIT_PROC_LAZY(dev, CmdEndRendering);
     // clang-format on
 
     return success;
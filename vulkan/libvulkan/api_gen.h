@@ -271,11 +271,13 @@ struct DeviceDispatchTable {
 bool InitDispatchTable(
     VkInstance instance,
     PFN_vkGetInstanceProcAddr get_proc,
-    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions);
+    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions,
+    bool lazy);
 bool InitDispatchTable(
     VkDevice dev,
     PFN_vkGetDeviceProcAddr get_proc,
-    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions);
+    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions,
+    bool lazy);
 
 }  // namespace api
 }  // namespace vulkan
@@ -164,6 +164,10 @@ const std::array<const char*, 2> HAL_SUBNAME_KEY_PROPERTIES = {{
 }};
 constexpr int LIB_DL_FLAGS = RTLD_LOCAL | RTLD_NOW;
 constexpr char RO_VULKAN_APEX_PROPERTY[] = "ro.vulkan.apex";
+// Names a builtin driver to load in place of the one of the device, such as
+// "default" for the null driver, so that benchmarks can measure the loader on
+// its own. Only honored when the process is debuggable.
+constexpr char DEBUG_VULKAN_DRIVER_PROPERTY[] = "debug.vulkan.driver";
 
 // LoadDriver returns:
 // * 0 when succeed, or
@@ -175,8 +179,15 @@ int LoadDriver(android_namespace_t* library_namespace,
                const hwvulkan_module_t** module) {
     ATRACE_CALL();
 
+    std::vector<const char*> keys(HAL_SUBNAME_KEY_PROPERTIES.begin(),
+                                  HAL_SUBNAME_KEY_PROPERTIES.end());
+    if (!library_namespace &&
+        android::GraphicsEnv::getInstance().isDebuggable()) {
+        keys.insert(keys.begin(), DEBUG_VULKAN_DRIVER_PROPERTY);
+    }
+
     void* so = nullptr;
-    for (auto key : HAL_SUBNAME_KEY_PROPERTIES) {
+    for (auto key : keys) {
         std::string lib_name = android::base::GetProperty(key, "");
         if (lib_name.empty())
             continue;
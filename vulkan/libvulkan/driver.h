@@ -49,10 +49,18 @@ struct InstanceData {
     // debug.vulkan.enable_callback
     PFN_vkDestroyDebugReportCallbackEXT destroy_debug_callback;
     VkDebugReportCallbackEXT debug_callback;
+
+    // resolves the lazy entries of dispatch
+    VkInstance instance;
+    PFN_vkGetInstanceProcAddr get_instance_proc_addr;
 };
 
 struct DeviceData {
     DeviceDispatchTable dispatch;
+
+    // resolves the lazy entries of dispatch
+    VkDevice device;
+    PFN_vkGetDeviceProcAddr get_device_proc_addr;
 };
 
 }  // namespace api
@@ -339,6 +339,9 @@ struct Swapchain {
     } images[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
 
     std::vector<TimingInfo> timing;
+
+    // KHR_incremental_present
+    std::vector<android_native_rect_t> damage_rects;
 };
 
 VkSwapchainKHR HandleFromSwapchain(Swapchain* swapchain) {
@@ -2384,8 +2387,11 @@ static VkResult WorstPresentResult(VkResult a, VkResult b) {
 }
 
 // KHR_incremental_present aspect of QueuePresentKHR
-static void SetSwapchainSurfaceDamage(ANativeWindow *window, const VkPresentRegionKHR *pRegion) {
-    std::vector<android_native_rect_t> rects(pRegion->rectangleCount);
+static void SetSwapchainSurfaceDamage(Swapchain &swapchain, const VkPresentRegionKHR *pRegion) {
+    // The rects are kept with the swapchain, so that presenting does not
+    // allocate once they have grown to the size that the app uses.
+    std::vector<android_native_rect_t>& rects = swapchain.damage_rects;
+    rects.resize(pRegion->rectangleCount);
     for (auto i = 0u; i < pRegion->rectangleCount; i++) {
         auto const& rect = pRegion->pRectangles[i];
         if (rect.layer > 0) {
@@ -2398,38 +2404,36 @@ static void SetSwapchainSurfaceDamage(ANativeWindow *window, const VkPresentRegi
         rects[i].right = rect.offset.x + rect.extent.width;
         rects[i].top = rect.offset.y + rect.extent.height;
     }
-    native_window_set_surface_damage(window, rects.data(), rects.size());
+    native_window_set_surface_damage(swapchain.surface.window.get(), rects.data(),
+                                     rects.size());
 }
 
 // GOOGLE_display_timing aspect of QueuePresentKHR
 static void SetSwapchainFrameTimestamp(Swapchain &swapchain, const VkPresentTimeGOOGLE *pTime) {
     ANativeWindow *window = swapchain.surface.window.get();
 
-    // We don't know whether the app will actually use GOOGLE_display_timing
-    // with a particular swapchain until QueuePresent; enable it on the BQ
-    // now if needed
-    if (!swapchain.frame_timestamps_enabled) {
-        ALOGV("Calling native_window_enable_frame_timestamps(true)");
-        native_window_enable_frame_timestamps(window, true);
-        swapchain.frame_timestamps_enabled = true;
-    }
-
-    // Record the nativeFrameId so it can be later correlated to
-    // this present.
-    uint64_t nativeFrameId = 0;
-    int err = native_window_get_next_frame_id(
-            window, &nativeFrameId);
-    if (err != android::OK) {
-        ALOGE("Failed to get next native frame ID.");
-    }
+    // Many apps only pass a desiredPresentTime, and never ask for the past
+    // timings. Collecting frame timestamps makes the BQ track the events of
+    // every frame, so it is only enabled by GetPastPresentationTimingGOOGLE,
+    // and the presents are only recorded from then on.
+    if (swapchain.frame_timestamps_enabled) {
+        // Record the nativeFrameId so it can be later correlated to
+        // this present.
+        uint64_t nativeFrameId = 0;
+        int err = native_window_get_next_frame_id(
+                window, &nativeFrameId);
+        if (err != android::OK) {
+            ALOGE("Failed to get next native frame ID.");
+        }
 
-    // Add a new timing record with the user's presentID and
-    // the nativeFrameId.
-    swapchain.timing.emplace_back(pTime, nativeFrameId);
-    if (swapchain.timing.size() > MAX_TIMING_INFOS) {
-        swapchain.timing.erase(
-            swapchain.timing.begin(),
-            swapchain.timing.begin() + swapchain.timing.size() - MAX_TIMING_INFOS);
+        // Add a new timing record with the user's presentID and
+        // the nativeFrameId.
+        swapchain.timing.emplace_back(pTime, nativeFrameId);
+        if (swapchain.timing.size() > MAX_TIMING_INFOS) {
+            swapchain.timing.erase(
+                swapchain.timing.begin(),
+                swapchain.timing.begin() + swapchain.timing.size() - MAX_TIMING_INFOS);
+        }
     }
     if (pTime->desiredPresentTime) {
         ALOGV(
@@ -2514,7 +2518,7 @@ static VkResult PresentOneSwapchain(
             }
 
             if (pRegion) {
-                SetSwapchainSurfaceDamage(window, pRegion);
+                SetSwapchainSurfaceDamage(swapchain, pRegion);
             }
             if (pTime) {
                 SetSwapchainFrameTimestamp(swapchain, pTime);
@@ -90,11 +90,13 @@ struct DeviceDispatchTable {
 bool InitDispatchTable(
     VkInstance instance,
     PFN_vkGetInstanceProcAddr get_proc,
-    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions);
+    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions,
+    bool lazy);
 bool InitDispatchTable(
     VkDevice dev,
     PFN_vkGetDeviceProcAddr get_proc,
-    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions);
+    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions,
+    bool lazy);
 
 }  // namespace api
 }  // namespace vulkan
@@ -132,6 +134,63 @@ def _define_extension_stub(cmd, f):
     f.write('}\n\n')
 
 
+def _is_lazy(cmd):
+  """Returns true if a dispatch table entry may be resolved on its first call.
+
+  Core functions promoted after Vulkan 1.0 are optional, so they may be left
+  unresolved until used.  Extension functions are only resolved when their
+  extensions are enabled.
+
+  Args:
+    cmd: Vulkan function name.
+  """
+  return (cmd not in gencom.extension_dict and
+          gencom.version_dict[cmd] != 'VK_VERSION_1_0')
+
+
+def _define_lazy_stub(cmd, f):
+  """Emits a stub that resolves a lazy dispatch table entry and calls it.
+
+  Args:
+    cmd: Vulkan function name.
+    f: Output file handle.
+  """
+  params = gencom.param_dict[cmd]
+  param_list = [''.join(i) for i in params]
+  base = gencom.base_name(cmd)
+
+  f.write('VKAPI_ATTR ' + gencom.return_type_dict[cmd] + ' lazy' + base +
+          '(' + ', '.join(param_list) + ') {\n')
+  f.write(gencom.indent(1) + 'auto& data = GetData(' + params[0][1] + ');\n')
+  f.write(gencom.indent(1) + 'auto proc = reinterpret_cast<PFN_' + cmd +
+          '>(ResolveLazyProc(data, "' + cmd + '"));\n')
+  f.write(gencom.indent(1) + '__atomic_store_n(&data.dispatch.' + base +
+          ', proc, __ATOMIC_RELAXED);\n')
+  f.write(gencom.indent(1))
+  if gencom.return_type_dict[cmd] != 'void':
+    f.write('return ')
+  f.write('proc(' + ', '.join(i[1] for i in params) + ');\n')
+  f.write('}\n\n')
+
+
+def _init_proc(cmd, f):
+  """Emits code to initialize a dispatch table entry.
+
+  Args:
+    cmd: Vulkan function name.
+    f: Output file handle.
+  """
+  if _is_lazy(cmd):
+    f.write(gencom.indent(1) + 'INIT_PROC_LAZY(')
+    if gencom.is_instance_dispatched(cmd):
+      f.write('instance, ')
+    else:
+      f.write('dev, ')
+    f.write(gencom.base_name(cmd) + ');\n')
+  else:
+    gencom.init_proc(cmd, f)
+
+
 def _is_intercepted(cmd):
   """Returns true if a function is intercepted by vulkan::api.
 
@@ -314,6 +373,16 @@ namespace api {
             data.dispatch.proc = disabled##proc; \\
     } while (0)
 
+// Entries that are optional may be left to stubs that resolve them on their
+// first call, so that the apps that never use them do not pay for them.
+#define INIT_PROC_LAZY(obj, proc)            \\
+    do {                                     \\
+        if (lazy)                            \\
+            data.dispatch.proc = lazy##proc; \\
+        else                                 \\
+            INIT_PROC(false, obj, proc);     \\
+    } while (0)
+
 namespace {
 
 // clang-format off\n\n""")
@@ -321,6 +390,26 @@ namespace {
     for cmd in gencom.command_list:
       _define_extension_stub(cmd, f)
 
+    f.write("""\
+PFN_vkVoidFunction ResolveLazyProc(InstanceData& data, const char* name) {
+    PFN_vkVoidFunction proc = data.get_instance_proc_addr(data.instance, name);
+    LOG_ALWAYS_FATAL_IF(!proc, "missing instance proc: %s", name);
+    return proc;
+}
+
+PFN_vkVoidFunction ResolveLazyProc(DeviceData& data, const char* name) {
+    PFN_vkVoidFunction proc = data.get_device_proc_addr(data.device, name);
+    LOG_ALWAYS_FATAL_IF(!proc, "missing device proc: %s", name);
+    return proc;
+}
+
+""")
+
+    for cmd in gencom.command_list:
+      if ((gencom.is_instance_dispatch_table_entry(cmd) or
+           gencom.is_device_dispatch_table_entry(cmd)) and _is_lazy(cmd)):
+        _define_lazy_stub(cmd, f)
+
     f.write("""\
 // clang-format on
 
@@ -329,15 +418,19 @@ namespace {
 bool InitDispatchTable(
     VkInstance instance,
     PFN_vkGetInstanceProcAddr get_proc,
-    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions) {
+    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions,
+    bool lazy) {
     auto& data = GetData(instance);
     bool success = true;
 
+    data.instance = instance;
+    data.get_instance_proc_addr = get_proc;
+
     // clang-format off\n""")
 
     for cmd in gencom.command_list:
       if gencom.is_instance_dispatch_table_entry(cmd):
-        gencom.init_proc(cmd, f)
+        _init_proc(cmd, f)
 
     f.write("""\
     // clang-format on
@@ -348,15 +441,19 @@ bool InitDispatchTable(
 bool InitDispatchTable(
     VkDevice dev,
     PFN_vkGetDeviceProcAddr get_proc,
-    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions) {
+    const std::bitset<driver::ProcHook::EXTENSION_COUNT>& extensions,
+    bool lazy) {
     auto& data = GetData(dev);
     bool success = true;
 
+    data.device = dev;
+    data.get_device_proc_addr = get_proc;
+
     // clang-format off\n""")
 
     for cmd in gencom.command_list:
       if gencom.is_device_dispatch_table_entry(cmd):
-        gencom.init_proc(cmd, f)
+        _init_proc(cmd, f)
 
     f.write("""\
     // clang-format on